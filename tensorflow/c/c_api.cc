@@ -2473,6 +2473,103 @@ void TF_SessionPRun(TF_Session* session, const char* handle,
                 output_values, target_names, nullptr, status);
 }
 
+TF_SessionCallable* TF_SessionMakeCallable(
+    TF_Session* session, const TF_Buffer* run_options, const TF_Output* inputs,
+    int ninputs, const TF_Output* outputs, int noutputs,
+    const TF_Operation* const* target_opers, int ntargets, TF_Status* status) {
+  status->status = ::tensorflow::OkStatus();
+  if (session->extend_before_run &&
+      !ExtendSessionGraphHelper(session, status)) {
+    return nullptr;
+  }
+
+  tensorflow::CallableOptions options;
+  if (run_options != nullptr &&
+      !options.mutable_run_options()->ParseFromArray(run_options->data,
+                                                     run_options->length)) {
+    status->status = InvalidArgument("Unparseable RunOptions proto");
+    return nullptr;
+  }
+  for (int i = 0; i < ninputs; ++i) {
+    options.add_feed(OutputName(inputs[i]));
+  }
+  for (int i = 0; i < noutputs; ++i) {
+    options.add_fetch(OutputName(outputs[i]));
+  }
+  for (int i = 0; i < ntargets; ++i) {
+    options.add_target(target_opers[i]->node.name());
+  }
+
+  auto callable = std::make_unique<TF_SessionCallable>();
+  status->status = session->session->MakeCallable(options, &callable->handle);
+  if (!status->status.ok()) return nullptr;
+  callable->ninputs = ninputs;
+  callable->noutputs = noutputs;
+  return callable.release();
+}
+
+void TF_SessionRunCallable(TF_Session* session, TF_SessionCallable* callable,
+                           TF_Tensor* const* input_values,
+                           TF_Tensor** output_values, TF_Buffer* run_metadata,
+                           TF_Status* status) {
+  status->status = ::tensorflow::OkStatus();
+  if (run_metadata != nullptr && run_metadata->data != nullptr) {
+    status->status =
+        InvalidArgument("Passing non-empty run_metadata is invalid.");
+    return;
+  }
+
+  std::vector<Tensor> feeds(callable->ninputs);
+  for (int i = 0; i < callable->ninputs; ++i) {
+    status->status = TF_TensorToTensorV1(input_values[i], &feeds[i]);
+    if (!status->status.ok()) return;
+  }
+
+  std::vector<Tensor> fetches;
+  RunMetadata run_metadata_proto;
+  status->status = session->session->RunCallable(callable->handle, feeds,
+                                                 &fetches, &run_metadata_proto);
+  if (!status->status.ok()) return;
+  if (run_metadata != nullptr) {
+    status->status = MessageToBuffer(run_metadata_proto, run_metadata);
+    if (!status->status.ok()) return;
+  }
+
+  for (int i = 0; i < callable->noutputs; ++i) {
+    const Tensor& src = fetches[i];
+    const bool empty = !src.IsInitialized() || src.NumElements() == 0;
+    if (output_values[i] != nullptr) {
+      // Point the tensor returned by an earlier call at the new output, which
+      // shares its buffer instead of being copied.
+      Tensor& dst = tensorflow::TensorFromInterface(output_values[i]->tensor);
+      if (empty) {
+        dst = Tensor(src.dtype(), src.shape());
+      } else if (!dst.CopyFrom(src, src.shape())) {
+        status->status = tensorflow::errors::Internal(
+            "Unable to reuse the tensor of output ", i);
+        return;
+      }
+      continue;
+    }
+    if (empty) {
+      output_values[i] =
+          EmptyTensor(static_cast<TF_DataType>(src.dtype()), src.shape());
+      continue;
+    }
+    output_values[i] = TF_TensorFromTensor(src, &status->status);
+    if (!status->status.ok()) return;
+  }
+}
+
+void TF_SessionReleaseCallable(TF_Session* session,
+                               TF_SessionCallable* callable,
+                               TF_Status* status) {
+  status->status = ::tensorflow::OkStatus();
+  if (callable == nullptr) return;
+  status->status = session->session->ReleaseCallable(callable->handle);
+  delete callable;
+}
+
 unsigned char TF_TryEvaluateConstant(TF_Graph* graph, TF_Output output,
                                      TF_Tensor** result, TF_Status* status) {
   *result = nullptr;
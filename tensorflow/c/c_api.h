@@ -1359,6 +1359,59 @@ TF_CAPI_EXPORT extern void TF_SessionPRun(
 // Once called, no more calls to TF_SessionPRun should be made.
 TF_CAPI_EXPORT extern void TF_DeletePRunHandle(const char* handle);
 
+// A subgraph of a session prepared with TF_SessionMakeCallable, which can be
+// run many times with little overhead.
+typedef struct TF_SessionCallable TF_SessionCallable;
+
+// Prepares the subgraph that feeds `inputs`, fetches `outputs` and runs
+// `target_opers`, so that it can be run repeatedly with
+// TF_SessionRunCallable without looking up the feeds and fetches by name on
+// every call. `run_options` may be NULL, or point to a `TF_Buffer` containing
+// the serialized representation of a `RunOptions` protocol buffer that applies
+// to every run.
+//
+// The callable runs the graph as it is when this function is called: later
+// additions to the graph are not seen by it.
+//
+// On success, returns a callable that must be released with
+// TF_SessionReleaseCallable. On failure, returns NULL.
+TF_CAPI_EXPORT extern TF_SessionCallable* TF_SessionMakeCallable(
+    TF_Session* session,
+    // RunOptions
+    const TF_Buffer* run_options,
+    // Input tensors
+    const TF_Output* inputs, int ninputs,
+    // Output tensors
+    const TF_Output* outputs, int noutputs,
+    // Target operations
+    const TF_Operation* const* target_opers, int ntargets,
+    // Output status
+    TF_Status* status);
+
+// Runs `callable` with input_values[i] fed to the i-th input it was made with.
+// `run_metadata` may be NULL, or point to an empty, freshly allocated
+// `TF_Buffer` like in TF_SessionRun.
+//
+// On success, output_values[i] holds the value of the i-th output. If
+// output_values[i] is NULL on entry, a new tensor is allocated and ownership
+// is transferred to the caller, who must eventually call TF_DeleteTensor on
+// it. Otherwise output_values[i] must be a tensor returned by an earlier call,
+// which is updated in place to hold the new value: reusing the same output
+// array across calls avoids allocating a tensor per output and run. In both
+// cases the output buffer is shared with the runtime instead of being copied.
+//
+// On failure, the elements of output_values[] that were NULL on entry may
+// still be NULL.
+TF_CAPI_EXPORT extern void TF_SessionRunCallable(
+    TF_Session* session, TF_SessionCallable* callable,
+    TF_Tensor* const* input_values, TF_Tensor** output_values,
+    TF_Buffer* run_metadata, TF_Status* status);
+
+// Releases a callable created by TF_SessionMakeCallable. `callable` may not be
+// used after this call.
+TF_CAPI_EXPORT extern void TF_SessionReleaseCallable(
+    TF_Session* session, TF_SessionCallable* callable, TF_Status* status);
+
 // --------------------------------------------------------------------------
 // The deprecated session API.  Please switch to the above instead of
 // TF_ExtendGraph(). This deprecated API can be removed at any time without
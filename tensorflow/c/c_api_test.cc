@@ -1165,6 +1165,59 @@ TEST(CAPI, SessionPRun) {
   TF_DeleteStatus(s);
 }
 
+TEST(CAPI, SessionCallable) {
+  TF_Status* s = TF_NewStatus();
+  TF_Graph* graph = TF_NewGraph();
+
+  // Construct the graph: A + 2
+  TF_Operation* a = Placeholder(graph, s, "A");
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_Operation* two = ScalarConst(2, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_Operation* plus2 = Add(a, two, graph, s, "plus2");
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_SessionOptions* opts = TF_NewSessionOptions();
+  TF_Session* sess = TF_NewSession(graph, opts, s);
+  TF_DeleteSessionOptions(opts);
+
+  TF_Output feeds[] = {TF_Output{a, 0}};
+  TF_Output fetches[] = {TF_Output{plus2, 0}};
+  TF_SessionCallable* callable = TF_SessionMakeCallable(
+      sess, nullptr, feeds, TF_ARRAYSIZE(feeds), fetches,
+      TF_ARRAYSIZE(fetches), nullptr, 0, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  // The first run allocates the output tensor.
+  TF_Tensor* feedValues[] = {Int32Tensor(1)};
+  TF_Tensor* fetchValues[] = {nullptr};
+  TF_SessionRunCallable(sess, callable, feedValues, fetchValues, nullptr, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Tensor* output = fetchValues[0];
+  ASSERT_NE(nullptr, output);
+  EXPECT_EQ(3, *(static_cast<int32*>(TF_TensorData(output))));
+  TF_DeleteTensor(feedValues[0]);
+
+  // The next runs update it in place.
+  feedValues[0] = Int32Tensor(5);
+  TF_SessionRunCallable(sess, callable, feedValues, fetchValues, nullptr, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  EXPECT_EQ(output, fetchValues[0]);
+  EXPECT_EQ(7, *(static_cast<int32*>(TF_TensorData(output))));
+  TF_DeleteTensor(feedValues[0]);
+  TF_DeleteTensor(output);
+
+  // Clean up.
+  TF_SessionReleaseCallable(sess, callable, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteSession(sess, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteGraph(graph);
+  TF_DeleteStatus(s);
+}
+
 TEST(CAPI, ShapeInferenceError) {
   // TF_FinishOperation should fail if the shape of the added operation cannot
   // be inferred.
@@ -52,21 +52,18 @@ struct TF_VariableInputLockHolder {
   std::unique_ptr<std::vector<tensorflow::tf_shared_lock>> shared_locks;
 };
 
-tensorflow::Status EnsureSparseVariableAccess(
+// REQUIRES: *var->mu() is held exclusively.
+tensorflow::Status EnsureSparseVariableAccessLocked(
     TF_OpKernelContext* ctx, bool variantType,
     void (*copyFunc)(TF_OpKernelContext* ctx, TF_Tensor* source,
                      TF_Tensor* dest),
     tensorflow::Var* var) {
   auto* context = reinterpret_cast<::tensorflow::OpKernelContext*>(ctx);
-  if (var->copy_on_read_mode.load()) {
-    return ::tensorflow::OkStatus();
-  }
-  mutex_lock ml(*var->mu());
-  // Once copy-on-read mode is True the refcount is guaranteed to be 1. This can
-  // also happen if there are no concurrent reads of the variable and
-  // copy-on-read mode is false.
+  // The refcount is 1 if no live tensor aliases the variable's buffer, in
+  // which case it can be updated in place.
   if (var->tensor()->RefCountIsOne()) {
     var->copy_on_read_mode.store(true);
+    var->aliased_by_reads.store(false);
     return ::tensorflow::OkStatus();
   }
   Tensor tmp;
@@ -94,9 +91,22 @@ tensorflow::Status EnsureSparseVariableAccess(
   }
   *var->tensor() = tmp;
   var->copy_on_read_mode.store(true);
+  var->aliased_by_reads.store(false);
   return ::tensorflow::OkStatus();
 }
 
+tensorflow::Status EnsureSparseVariableAccess(
+    TF_OpKernelContext* ctx, bool variantType,
+    void (*copyFunc)(TF_OpKernelContext* ctx, TF_Tensor* source,
+                     TF_Tensor* dest),
+    tensorflow::Var* var) {
+  if (var->copy_on_read_mode.load()) {
+    return ::tensorflow::OkStatus();
+  }
+  mutex_lock ml(*var->mu());
+  return EnsureSparseVariableAccessLocked(ctx, variantType, copyFunc, var);
+}
+
 tensorflow::Status PrepareToUpdateVariable(
     TF_OpKernelContext* ctx, tensorflow::Tensor* tensor, bool copy_on_read_mode,
     bool variantType,
@@ -187,20 +197,11 @@ void TF_AssignVariable(TF_OpKernelContext* ctx, int input_index,
                     value.shape().DebugString()));
   }
 
+  // In copy-on-read mode the value is aliased too; the first sparse write
+  // copies it if it is still shared by then.
+  *variable->tensor() = value;
   if (variable->copy_on_read_mode.load()) {
-    tensorflow::Tensor tmp;
-    tensorflow::AllocatorAttributes attr;
-    attr.set_gpu_compatible(true);
-    attr.set_nic_compatible(true);
-    OP_REQUIRES_OK(cc_ctx, cc_ctx->allocate_temp(value.dtype(), value.shape(),
-                                                 &tmp, attr));
-    tensorflow::Status s;
-    TF_Tensor* tf_tmp = TF_TensorFromTensor(tmp, &s);
-    TF_Tensor* tf_value = TF_TensorFromTensor(value, &s);
-    copyFunc(ctx, tf_value, tf_tmp);
-    *variable->tensor() = tmp;
-  } else {
-    *variable->tensor() = value;
+    variable->aliased_by_reads.store(true);
   }
   variable->is_initialized = true;
   TF_SetStatus(status, TF_OK, "");
@@ -329,6 +330,33 @@ void TF_MaybeLockVariableInputMutexesInOrder(
       }
     }
   }
+  if (sparse &&
+      std::any_of(vars.begin(), vars.end(), [](tensorflow::Var* var) {
+        return var->aliased_by_reads.load();
+      })) {
+    // A dense read aliased the buffer of a variable that is about to be
+    // updated in place, so it may need to be copied, which requires exclusive
+    // locks.
+    if (!do_lock) {
+      shared_locks->clear();
+      for (auto acquire : acquire_order) {
+        tensorflow::mutex* mu = mutexes[acquire];
+        if (mu != nullptr) {
+          locks->emplace_back(*mu);
+        }
+      }
+    }
+    for (tensorflow::Var* var : vars) {
+      if (var->aliased_by_reads.load()) {
+        tensorflow::Status s =
+            EnsureSparseVariableAccessLocked(ctx, false, copyFunc, var);
+        if (!s.ok()) {
+          ::tensorflow::Set_TF_Status_from_Status(status, s);
+          return;
+        }
+      }
+    }
+  }
   *lockHolder = new TF_VariableInputLockHolder(
       std::move(vars), std::move(locks), std::move(shared_locks));
   TF_SetStatus(status, TF_OK, "");
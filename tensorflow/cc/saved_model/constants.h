@@ -24,6 +24,12 @@ constexpr char kSavedModelAssetsDirectory[] = "assets";
 // SavedModel assets.extra directory.
 constexpr char kSavedModelAssetsExtraDirectory[] = "assets.extra";
 
+// File in the assets.extra directory holding a serialized AutotuneMapsProto,
+// as produced by SerializeAutotuneMaps(). When present, its entries seed the
+// process-wide conv autotune maps before the graph is first run so that a
+// freshly started replica skips re-autotuning on matching devices.
+constexpr char kSavedModelAutotuneMapsFilename[] = "tf_autotune_maps.pb";
+
 // SavedModel assets key for graph collection-def.
 constexpr char kSavedModelAssetsKey[] = "saved_model_assets";
 
@@ -41,6 +41,8 @@ limitations under the License.
 #include "tensorflow/core/protobuf/saver.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/autotune_maps/autotune_serialize.h"
+#include "tensorflow/core/util/port.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 
 namespace tensorflow {
@@ -261,6 +263,31 @@ Status RunRestore(const RunOptions& run_options, const string& export_dir,
                  nullptr /* outputs */, &run_metadata, session);
 }
 
+// Seeds the autotune maps from assets.extra/tf_autotune_maps.pb if the
+// SavedModel ships one. This is a best-effort optimization: entries recorded
+// for other devices or an older ConvParameters version are rejected by
+// LoadSerializedAutotuneMaps, and any failure only costs re-autotuning, so it
+// is logged rather than failing the load.
+void LoadAutotuneMapsIfPresent(const string& export_dir) {
+  // Only GPU builds have autotune maps to seed.
+  if (!IsGoogleCudaEnabled() && !IsBuiltWithROCm()) return;
+  const string autotune_maps_path =
+      io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory,
+                   kSavedModelAutotuneMapsFilename);
+  if (!Env::Default()->FileExists(autotune_maps_path).ok()) return;
+
+  string serialized;
+  Status status =
+      ReadFileToString(Env::Default(), autotune_maps_path, &serialized);
+  if (status.ok()) status = LoadSerializedAutotuneMaps(serialized);
+  if (status.ok()) {
+    LOG(INFO) << "Loaded autotune maps from " << autotune_maps_path;
+  } else {
+    LOG(WARNING) << "Ignoring autotune maps at " << autotune_maps_path << ": "
+                 << status;
+  }
+}
+
 }  // namespace
 
 SavedModelBundleInterface::~SavedModelBundleInterface() {}
@@ -284,6 +311,7 @@ Status LoadSavedModelInternal(const SessionOptions& session_options,
                                                     &bundle->meta_graph_def));
   TF_RETURN_IF_ERROR(
       ReadSavedModelDebugInfoIfPresent(export_dir, &bundle->debug_info));
+  LoadAutotuneMapsIfPresent(export_dir);
   TF_RETURN_IF_ERROR(LoadMetagraphIntoSession(
       session_options, bundle->meta_graph_def, &bundle->session));
   TF_RETURN_IF_ERROR(RestoreSession(run_options, bundle->meta_graph_def,
@@ -33,6 +33,8 @@ limitations under the License.
 #include "tensorflow/core/platform/file_system_helper.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/protobuf/saved_model.pb.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/mapped_graph_def.h"
 #include "tensorflow/core/util/tensor_bundle/byte_swap.h"
 
 namespace tensorflow {
@@ -51,8 +53,20 @@ Status ReadSavedModel(absl::string_view export_dir,
       bool saved_model_pb_exists,
       internal::FileExists(Env::Default(), saved_model_pb_path));
   if (saved_model_pb_exists) {
+    // Big constants of graphs written by
+    // WriteBinarySavedModelWithAlignedConstants() can alias the file instead
+    // of being copied, halving the peak memory use of loading them.
+    bool map_constants;
+    TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_SAVED_MODEL_MAP_CONSTANTS",
+                                          /*default_val=*/false,
+                                          &map_constants));
     Status result =
-        ReadBinaryProto(Env::Default(), saved_model_pb_path, saved_model_proto);
+        map_constants
+            ? ReadBinarySavedModelWithMappedConstants(
+                  Env::Default(), saved_model_pb_path, MappedGraphDefOptions(),
+                  saved_model_proto)
+            : ReadBinaryProto(Env::Default(), saved_model_pb_path,
+                              saved_model_proto);
     if (result.ok()) {
       metrics::SavedModelRead(saved_model::GetWriteVersion(*saved_model_proto))
           .IncrementBy(1);
@@ -18,6 +18,8 @@ limitations under the License.
 #include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/metrics.h"
 #include "tensorflow/cc/saved_model/tag_constants.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
@@ -25,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/resource_loader.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/mapped_graph_def.h"
 
 namespace tensorflow {
 namespace {
@@ -107,6 +110,35 @@ TEST_F(ReaderTest, InvalidExportPath) {
   EXPECT_FALSE(st.ok());
 }
 
+TEST_F(ReaderTest, MapsAlignedConstants) {
+  const string export_dir = io::JoinPath(testing::TmpDir(), "mapped_model");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(export_dir));
+  SavedModel saved_model;
+  MetaGraphDef* meta_graph = saved_model.add_meta_graphs();
+  meta_graph->mutable_meta_info_def()->add_tags(kSavedModelTagServe);
+  const MappedGraphDefOptions options;
+  Tensor big(DT_FLOAT, TensorShape({options.min_mapped_bytes}));
+  big.flat<float>().setZero();
+  TF_ASSERT_OK(NodeDefBuilder("big", "Const")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("value", big)
+                   .Finalize(meta_graph->mutable_graph_def()->add_node()));
+  TF_ASSERT_OK(WriteBinarySavedModelWithAlignedConstants(
+      Env::Default(), io::JoinPath(export_dir, kSavedModelFilenamePb),
+      saved_model, options));
+
+  MetaGraphDef meta_graph_def;
+  TF_ASSERT_OK(ReadMetaGraphDefFromSavedModel(export_dir, {kSavedModelTagServe},
+                                              &meta_graph_def));
+  EXPECT_EQ(meta_graph_def.graph_def().node(0).op(), "Const");
+
+  setenv("TF_SAVED_MODEL_MAP_CONSTANTS", "true", /*overwrite=*/1);
+  TF_ASSERT_OK(ReadMetaGraphDefFromSavedModel(export_dir, {kSavedModelTagServe},
+                                              &meta_graph_def));
+  unsetenv("TF_SAVED_MODEL_MAP_CONSTANTS");
+  EXPECT_EQ(meta_graph_def.graph_def().node(0).op(), "ImmutableConst");
+}
+
 TEST_F(ReaderTest, ReadSavedModelDebugInfoIfPresent) {
   const string export_dir = GetDataDependencyFilepath(TestDataSharded());
   std::unique_ptr<GraphDebugInfo> debug_info_proto;
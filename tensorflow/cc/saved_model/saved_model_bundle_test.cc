@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
+#include "tensorflow/core/util/autotune_maps/autotune_serialize.h"
 
 namespace tensorflow {
 namespace {
@@ -62,6 +63,38 @@ class LoaderTest : public ::testing::Test {
     return example.SerializeAsString();
   }
 
+  // Copies the SavedModel at 'kTestDataSharded' to a new directory 'name' in
+  // the test's temporary directory, and returns the copy's path.
+  string CopyShardedSavedModel(const string& name) {
+    const string src =
+        io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded);
+    const string dst = io::JoinPath(testing::TmpDir(), name);
+    for (const char* file :
+         {"saved_model.pb", "assets/foo.txt", "variables/variables.index",
+          "variables/variables.data-00000-of-00001"}) {
+      string contents;
+      TF_CHECK_OK(ReadFileToString(Env::Default(), io::JoinPath(src, file),
+                                   &contents));
+      const string dst_file = io::JoinPath(dst, file);
+      TF_CHECK_OK(
+          Env::Default()->RecursivelyCreateDir(string(io::Dirname(dst_file))));
+      TF_CHECK_OK(WriteStringToFile(Env::Default(), dst_file, contents));
+    }
+    return dst;
+  }
+
+  // Writes 'contents' as the autotune maps file of the SavedModel at
+  // 'export_dir'.
+  void WriteAutotuneMaps(const string& export_dir, const string& contents) {
+    const string assets_extra =
+        io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory);
+    TF_CHECK_OK(Env::Default()->RecursivelyCreateDir(assets_extra));
+    TF_CHECK_OK(WriteStringToFile(
+        Env::Default(),
+        io::JoinPath(assets_extra, kSavedModelAutotuneMapsFilename),
+        contents));
+  }
+
   void ValidateAssets(const string& export_dir,
                       const SavedModelBundle& bundle) {
     const string asset_directory =
@@ -137,6 +170,33 @@ TEST_F(LoaderTest, TagMatch) {
   CheckSavedModelBundle(export_dir, bundle);
 }
 
+TEST_F(LoaderTest, LoadsAutotuneMaps) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+
+  const string export_dir = CopyShardedSavedModel("autotune_maps");
+  string serialized;
+  TF_ASSERT_OK(SerializeAutotuneMaps(&serialized));
+  WriteAutotuneMaps(export_dir, serialized);
+  TF_ASSERT_OK(LoadSavedModel(session_options, run_options, export_dir,
+                              {kSavedModelTagServe}, &bundle));
+  CheckSavedModelBundle(export_dir, bundle);
+}
+
+TEST_F(LoaderTest, IgnoresInvalidAutotuneMaps) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+
+  // Autotune maps only save autotuning, so bad ones do not fail the load.
+  const string export_dir = CopyShardedSavedModel("invalid_autotune_maps");
+  WriteAutotuneMaps(export_dir, "not an AutotuneMapsProto");
+  TF_ASSERT_OK(LoadSavedModel(session_options, run_options, export_dir,
+                              {kSavedModelTagServe}, &bundle));
+  CheckSavedModelBundle(export_dir, bundle);
+}
+
 TEST_F(LoaderTest, ReadMetaGraphFromSavedModel) {
   SavedModelBundle bundle;
   SessionOptions session_options;
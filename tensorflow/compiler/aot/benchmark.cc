@@ -25,6 +25,7 @@ limitations under the License.
 #include <algorithm>
 #include <functional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -103,37 +104,76 @@ void DumpStatsToStdout(const Stats& stats) {
   // Dump stats out.
   printf("Benchmark ran %zu iterations over %lld us\n", count_us,
          static_cast<long long>(stats.total_us));  // NOLINT
+  if (stats.total_us > 0) {
+    printf("  Throughput: %.3f iterations/s\n",
+           count_us * 1e6 / stats.total_us);
+  }
   for (const auto& g : groups) {
     printf("  %-*s %*.3f us\n", max_label_size, g.first.c_str(), max_digits + 4,
            g.second);
   }
 }
 
-void Benchmark(const Options& options, const BenchmarkFn& fn, Stats* stats) {
+// Returns the time to run a benchmark for, as configured by `options`.
+static int64_t MaxMicros(const Options& options) {
   // If neither max_seconds or max_iters is set, stop at kDefaultMicros.
-  const int64_t max_us = (options.max_micros <= 0 && options.max_iters <= 0)
-                             ? Options::kDefaultMicros
-                             : options.max_micros;
-  // NOLINTNEXTLINE
-  printf("Running benchmark for %lld us\n", static_cast<long long>(max_us));
-  const int64_t start_us = NowMicros();
+  return (options.max_micros <= 0 && options.max_iters <= 0)
+             ? Options::kDefaultMicros
+             : options.max_micros;
+}
+
+// Runs `fn` until `max_us` have passed since `start_us` or `max_iters`
+// iterations have run, appending the time of each iteration to `per_iter_us`.
+static void RunIterations(const BenchmarkFn& fn, int64_t start_us,
+                          int64_t max_us, int64_t max_iters,
+                          std::vector<int64_t>* per_iter_us) {
   int64_t iters = 0;
   while (true) {
     const int64_t iter_start_us = NowMicros();
     fn();
     const int64_t end_us = NowMicros();
-    // Collect stats and decide whether to stop.
-    stats->per_iter_us.push_back(end_us - iter_start_us);
-    const int64_t total_us = end_us - start_us;
+    per_iter_us->push_back(end_us - iter_start_us);
     ++iters;
-    if ((max_us > 0 && total_us >= max_us) ||
-        (options.max_iters > 0 && iters >= options.max_iters)) {
-      stats->total_us = total_us;
+    if ((max_us > 0 && end_us - start_us >= max_us) ||
+        (max_iters > 0 && iters >= max_iters)) {
       break;
     }
   }
 }
 
+void Benchmark(const Options& options, const BenchmarkFn& fn, Stats* stats) {
+  const int64_t max_us = MaxMicros(options);
+  // NOLINTNEXTLINE
+  printf("Running benchmark for %lld us\n", static_cast<long long>(max_us));
+  const int64_t start_us = NowMicros();
+  RunIterations(fn, start_us, max_us, options.max_iters, &stats->per_iter_us);
+  stats->total_us = NowMicros() - start_us;
+}
+
+void BenchmarkInstances(const Options& options,
+                        const std::vector<BenchmarkFn>& fns, Stats* stats) {
+  const int64_t max_us = MaxMicros(options);
+  // NOLINTNEXTLINE
+  printf("Running benchmark of %zu instances for %lld us\n", fns.size(),
+         static_cast<long long>(max_us));
+  std::vector<std::vector<int64_t>> per_thread_us(fns.size());
+  std::vector<std::thread> threads;
+  threads.reserve(fns.size());
+  const int64_t start_us = NowMicros();
+  for (size_t i = 0; i < fns.size(); ++i) {
+    threads.emplace_back(RunIterations, std::cref(fns[i]), start_us, max_us,
+                         options.max_iters, &per_thread_us[i]);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  stats->total_us = NowMicros() - start_us;
+  for (const std::vector<int64_t>& thread_us : per_thread_us) {
+    stats->per_iter_us.insert(stats->per_iter_us.end(), thread_us.begin(),
+                              thread_us.end());
+  }
+}
+
 }  // namespace benchmark
 }  // namespace tfcompile
 }  // namespace tensorflow
@@ -63,6 +63,14 @@ typedef std::function<void()> BenchmarkFn;
 // Use `options` to configure benchmarking options.
 void Benchmark(const Options& options, const BenchmarkFn& fn, Stats* stats);
 
+// BenchmarkInstances runs each of `fns` on its own thread, e.g. one function
+// per instance of a generated class, to measure the throughput of running them
+// concurrently. Each thread stops as configured by `options`. The per-iteration
+// stats of all threads are collected in `stats`, whose total_us is the wall
+// time of the whole run.
+void BenchmarkInstances(const Options& options,
+                        const std::vector<BenchmarkFn>& fns, Stats* stats);
+
 }  // namespace benchmark
 }  // namespace tfcompile
 }  // namespace tensorflow
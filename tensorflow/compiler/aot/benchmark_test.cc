@@ -40,6 +40,18 @@ TEST(Benchmark, Benchmark) {
   EXPECT_EQ(stats5.per_iter_us.size(), 5);
 }
 
+TEST(Benchmark, BenchmarkInstances) {
+  AddComp add1;
+  AddComp add2;
+
+  Options options;
+  options.max_iters = 3;
+  Stats stats;
+  BenchmarkInstances(options, {[&] { add1.Run(); }, [&] { add2.Run(); }},
+                     &stats);
+  EXPECT_EQ(stats.per_iter_us.size(), 6);
+}
+
 }  // namespace
 }  // namespace benchmark
 }  // namespace tfcompile
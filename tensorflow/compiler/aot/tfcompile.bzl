@@ -144,6 +144,7 @@ def tf_library(
         include_standard_runtime_deps = True,
         enable_xla_hlo_profiling = False,
         enable_tracemes = False,
+        enable_parallel_task_assignment = False,
         mlir_components = "None",
         deps = None,
         tags = []):
@@ -199,6 +200,9 @@ def tf_library(
       enable_tracemes: Tell tfcompile to generate calls to
         TraceMe::Activity{Start|End} around HLO instructions that can be used by
         Xprof to construct profiler timelines.
+      enable_parallel_task_assignment: Split large HLOs into tasks that the
+        generated code runs in parallel on the thread pool passed to
+        set_thread_pool, as the XLA CPU JIT does.
       mlir_components: When the value is "None", no components use MLIR. When
         the value is "Bridge", use MLIR to translate GraphDef to HLO.
       deps: a list of deps to include on the build rules for the generated
@@ -301,6 +305,13 @@ def tf_library(
     else:
         traceme_flags = ["--xla_cpu_enable_xprof_traceme=false"]
 
+    if enable_parallel_task_assignment:
+        parallel_task_flags = [
+            "--xla_backend_extra_options=xla_cpu_aot_parallel_task_assignment",
+        ]
+    else:
+        parallel_task_flags = []
+
     mlir_flags = ["--mlir_components=" + mlir_components]
 
     srcs = [tfcompile_graph, config]
@@ -323,7 +334,8 @@ def tf_library(
         target_cpu = tfcompile_target_cpu(),
         target_triple = target_llvm_triple(),
         flags = flags,
-        extra_flags = debug_info_flags + profiling_flags + mlir_flags + traceme_flags,
+        extra_flags = (debug_info_flags + profiling_flags + mlir_flags +
+                       traceme_flags + parallel_task_flags),
         dfsan = tfcompile_dfsan_enabled(),
         dfsan_abilists = tfcompile_dfsan_abilists(),
         is_linux = select({
@@ -364,6 +376,8 @@ def tf_library(
             "//tensorflow/compiler/xla:xla_data_proto_cc",
         ] or []) + (enable_xla_hlo_profiling and [
             "//tensorflow/compiler/xla/service:hlo_profile_printer_data_cc",
+        ] or []) + (enable_parallel_task_assignment and [
+            "//tensorflow/compiler/xla/service/cpu:runtime_fork_join",
         ] or []) + (include_standard_runtime_deps and [
             # TODO(cwhipkey): only depend on kernel code that the model actually
             # needed.
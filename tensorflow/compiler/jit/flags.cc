@@ -149,7 +149,13 @@ void AppendMarkForCompilationPassFlagsInternal(std::vector<Flag>* flag_list) {
       Flag("tf_xla_persistent_cache_prefix",
            &mark_for_compilation_flags->tf_xla_persistent_cache_prefix,
            "Specifies the persistance cache prefix. Default is "
-           "\"xla_compile_cache\"")};
+           "\"xla_compile_cache\""),
+      Flag("tf_xla_clustering_profile",
+           &mark_for_compilation_flags->tf_xla_clustering_profile,
+           "(experimental) Path to a StepStats proto, in binary or text "
+           "format, recorded from a run without auto-clustering.  Clusters "
+           "that the measured op timings predict to be slower under XLA than "
+           "under TensorFlow are declustered.")};
   flag_list->insert(flag_list->end(), new_flags.begin(), new_flags.end());
 }
 
@@ -200,6 +206,7 @@ void AllocateAndParseFlags() {
   mark_for_compilation_flags->tf_xla_disable_strict_signature_checks = false;
   mark_for_compilation_flags->tf_xla_persistent_cache_prefix =
       "xla_compile_cache";
+  mark_for_compilation_flags->tf_xla_clustering_profile = "";
 
   device_flags = new XlaDeviceFlags;
   device_flags->tf_xla_compile_on_demand = false;
@@ -208,6 +215,8 @@ void AllocateAndParseFlags() {
   ops_flags = new XlaOpsCommonFlags;
   ops_flags->tf_xla_always_defer_compilation = false;
   ops_flags->tf_xla_async_compilation = false;
+  ops_flags->tf_xla_async_compilation_max_ongoing = 10;
+  ops_flags->tf_xla_shape_buckets = "";
 
   jitter_flags = new IntroduceFloatingPointJitterPassFlags;
   jitter_flags->jitter_amount = 1e-5;
@@ -268,6 +277,17 @@ void AllocateAndParseFlags() {
             "When lazy compilation is enabled, asynchronous compilation starts "
             "the cluster compilation in the background, and the fallback path "
             "is executed until the compilation has finished."),
+       Flag("tf_xla_async_compilation_max_ongoing",
+            &ops_flags->tf_xla_async_compilation_max_ongoing,
+            "The maximum number of clusters compiled asynchronously at a time "
+            "per device. Clusters that would exceed it run on the fallback "
+            "path and are compiled on a later execution."),
+       Flag("tf_xla_shape_buckets", &ops_flags->tf_xla_shape_buckets,
+            "If non-empty, the leading dimension of the non-constant inputs "
+            "of a cluster is padded up to a bucket size and compiled as a "
+            "dynamic dimension, so that one executable serves all sizes "
+            "within a bucket. Either \"pow2\" for powers of two, or a "
+            "comma-separated list of increasing bucket sizes."),
 
        Flag("tf_introduce_floating_point_jitter_to_tensors",
             setter_for_jitter_tensor_names, "",
@@ -97,6 +97,11 @@ struct MarkForCompilationPassFlags {
 
   // Specifies the persistance cache prefix. Default is "xla_compile_cache"
   string tf_xla_persistent_cache_prefix;
+
+  // If non-empty, a StepStats proto (binary or text) recorded from a run
+  // without auto-clustering.  Clusters that the per-op timings in it predict
+  // to be slower under XLA than under TensorFlow are declustered.
+  string tf_xla_clustering_profile;
 };
 
 // Flags associated with the XLA bridge's xla_device module.
@@ -119,6 +124,16 @@ struct XlaOpsCommonFlags {
   // If true, _XlaCompile compiles the cluster asynchronously with respect to
   // the main execution. The fallback path is taken while compilation happens.
   bool tf_xla_async_compilation;
+  // The maximum number of clusters compiled asynchronously at a time per
+  // device. Clusters that would exceed it take the fallback path and are
+  // compiled on a later execution. Defaults to 10.
+  int32 tf_xla_async_compilation_max_ongoing;
+  // If non-empty, the leading dimension of the non-constant inputs of a
+  // cluster is padded up to a bucket size and compiled as a dynamic dimension,
+  // so that one executable serves all sizes within a bucket. Either "pow2" for
+  // powers of two, or a comma-separated list of increasing bucket sizes.
+  // Empty (disabled) by default.
+  std::string tf_xla_shape_buckets;
 };
 
 // Flags for the build_xla_ops pass.
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/compiler/jit/xla_activity_listener.h"
 #include "tensorflow/compiler/jit/xla_cluster_util.h"
 #include "tensorflow/compiler/jit/xla_platform_info.h"
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
 #include "tensorflow/compiler/tf2xla/tf2xla_util.h"
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
@@ -86,12 +87,14 @@ class XlaExecutableClosure {
   explicit XlaExecutableClosure(
       xla::LocalClient* client, xla::LocalExecutable* executable,
       const XlaCompiler::CompilationResult* compilation_result,
-      ResourceVarsSnapshot resource_var_snapshots, int num_constant_args)
+      ResourceVarsSnapshot resource_var_snapshots, int num_constant_args,
+      std::map<int, Tensor> bucketed_inputs)
       : client_(client),
         executable_(executable),
         compilation_result_(compilation_result),
         resource_var_snapshots_(std::move(resource_var_snapshots)),
-        num_constant_args_(num_constant_args) {}
+        num_constant_args_(num_constant_args),
+        bucketed_inputs_(std::move(bucketed_inputs)) {}
 
   XlaExecutableClosure(XlaExecutableClosure&&) = default;
   XlaExecutableClosure& operator=(XlaExecutableClosure&&) = default;
@@ -105,6 +108,9 @@ class XlaExecutableClosure {
     return resource_var_snapshots_;
   }
   int num_constant_args() const { return num_constant_args_; }
+  const std::map<int, Tensor>& bucketed_inputs() const {
+    return bucketed_inputs_;
+  }
 
  private:
   xla::LocalClient* client_;
@@ -112,6 +118,8 @@ class XlaExecutableClosure {
   const XlaCompiler::CompilationResult* compilation_result_;
   ResourceVarsSnapshot resource_var_snapshots_;
   int num_constant_args_;
+  // The padded inputs, if the cluster was compiled with bucketed shapes.
+  std::map<int, Tensor> bucketed_inputs_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(XlaExecutableClosure);
 };
@@ -228,7 +236,8 @@ static Status CompileToLocalExecutable(
     XlaCompilationCache::CompileMode compile_mode,
     bool may_alias_resource_update, xla::LocalClient** client,
     const XlaCompiler::CompilationResult** compilation_result,
-    xla::LocalExecutable** executable) {
+    xla::LocalExecutable** executable,
+    std::optional<XlaShapeBucketing>* bucketing) {
   // We store information about the JIT-compiled XLA computation
   // in the ResourceMgr.
   ResourceMgr* rm = ctx->resource_manager();
@@ -267,6 +276,27 @@ static Status CompileToLocalExecutable(
           constants, inputs, variable_infos,
           static_cast<Device*>(ctx->device()));
   TF_RETURN_IF_ERROR(args.status());
+
+  // Tensors on XLA devices can not be padded with a plain copy.
+  bucketing->reset();
+  if (!platform_info.is_on_xla_device()) {
+    std::vector<XlaCompiler::Argument> bucketed_args = *args;
+    std::optional<XlaShapeBucketing> arg_bucketing = BucketXlaCompilerArguments(
+        XlaShapeBuckets::FromFlags(), &bucketed_args);
+    if (arg_bucketing.has_value()) {
+      Status s = cache->Compile(options, function, bucketed_args,
+                                compile_options, compile_mode,
+                                compilation_result, executable);
+      if (s.ok()) {
+        *bucketing = std::move(arg_bucketing);
+        return s;
+      }
+      // Not every op supports dynamic dimensions.
+      VLOG(1) << "Compiling " << function.name()
+              << " with bucketed shapes failed, compiling for exact shapes: "
+              << s;
+    }
+  }
   return cache->Compile(options, function, *args, compile_options, compile_mode,
                         compilation_result, executable);
 }
@@ -281,6 +311,7 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
   xla::LocalClient* client;
   const XlaCompiler::CompilationResult* compilation_result;
   xla::LocalExecutable* executable;
+  std::optional<XlaShapeBucketing> bucketing;
 
   std::vector<VariableInfo> variable_infos;
   {
@@ -292,10 +323,16 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
         ctx, function_, /*has_ref_vars=*/has_ref_vars_, platform_info_, inputs,
         variable_infos, constants_, XlaCompilationCache::CompileMode::kStrict,
         /*may_alias_resource_update=*/true, &client, &compilation_result,
-        &executable);
+        &executable, &bucketing);
     OP_REQUIRES_OK(ctx, s);
   }
 
+  std::map<int, Tensor> bucketed_inputs;
+  if (bucketing.has_value()) {
+    OP_REQUIRES_OK(ctx, BuildBucketedInputs(ctx, *bucketing, inputs,
+                                            &bucketed_inputs));
+  }
+
   std::map<int, const Tensor*> resource_var_ptrs;
   for (int i = 0; i < resources_.size(); i++) {
     resource_var_ptrs[resources_[i]] = variable_infos[i].var()->tensor();
@@ -310,7 +347,7 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
   StatusOr<std::vector<xla::ExecutionInput>> execution_inputs =
       launch_context.PopulateInputs(ctx, compilation_result, resource_var_ptrs,
                                     /*missing_ctx_input_prefix=*/0,
-                                    input_output_alias);
+                                    input_output_alias, bucketed_inputs);
   OP_REQUIRES_OK(ctx, execution_inputs.status());
 
   // Execute the computation.
@@ -423,6 +460,7 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   const XlaCompiler::CompilationResult* kernel;
   xla::LocalExecutable* executable;
   ResourceVarsSnapshot variables;
+  std::optional<XlaShapeBucketing> bucketing;
 
   std::vector<const Tensor*> inputs = InputsFromContext(ctx);
   bool cannot_compile_cluster;
@@ -454,7 +492,7 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
     Status status = CompileToLocalExecutable(
         ctx, function_, has_ref_vars_, platform_info_, inputs, variable_infos,
         constants_, compile_mode, /*may_alias_resource_update=*/false, &client,
-        &kernel, &executable);
+        &kernel, &executable, &bucketing);
     OP_REQUIRES_OK(ctx, SnapshotResourceVariables(ctx, resources_,
                                                   variable_infos, &variables));
     if (compile_mode != XlaCompilationCache::CompileMode::kLazy ||
@@ -492,13 +530,22 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
     return;
   }
 
+  // The padded inputs are built here, where the compiler saw the inputs, and
+  // passed to XlaRun in the closure.
+  std::map<int, Tensor> bucketed_inputs;
+  if (bucketing.has_value()) {
+    OP_REQUIRES_OK(ctx, BuildBucketedInputs(ctx, *bucketing, inputs,
+                                            &bucketed_inputs));
+  }
+
   // Each execution of an XlaCompile op creates a new XlaExecutableClosure, even
   // if it didn't have to compile the cluster because of a compilation-cache
   // hit.  This is because we at least need new snapshots of the resource
   // variables.
   XlaExecutableClosureStore::KeyT key =
       XlaExecutableClosureStore::Global()->Produce(XlaExecutableClosure(
-          client, executable, kernel, std::move(variables), constants_.size()));
+          client, executable, kernel, std::move(variables), constants_.size(),
+          std::move(bucketed_inputs)));
 
   Tensor compilation_key(cpu_allocator, DT_STRING, TensorShape({}));
   compilation_key.flat<tstring>()(0) = key;
@@ -548,7 +595,7 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
     execution_inputs = launch_context.PopulateInputs(
         ctx, closure.compilation_result(), snapshot_ptrs,
         /*missing_ctx_input_prefix=*/closure.num_constant_args(),
-        input_output_alias);
+        input_output_alias, closure.bucketed_inputs());
     OP_REQUIRES_OK(ctx, execution_inputs.status());
   }
 
@@ -15,10 +15,15 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/partially_decluster_pass.h"
 
+#include <algorithm>
+#include <map>
+
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/jit/device_util.h"
+#include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/jit/xla_cluster_util.h"
 #include "tensorflow/compiler/tf2xla/const_analysis.h"
 #include "tensorflow/compiler/tf2xla/xla_op_registry.h"
@@ -27,8 +32,11 @@ limitations under the License.
 #include "tensorflow/core/framework/memory_types.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/graph/graph_node_util.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
@@ -367,6 +375,150 @@ Status PartiallyDeclusterGraph(Graph* graph,
 }
 }  // namespace reduce_recompilation
 
+namespace decluster_unprofitable_clusters {
+// Assumed cost of running a cluster on top of running its ops: the _XlaCompile
+// cache lookup, the _XlaRun launch and argument marshalling.
+constexpr double kClusterLaunchMicros = 20;
+
+// Fraction of its TensorFlow time that an op XLA can fuse with its neighbors
+// is assumed to take when clustered, mostly from saved memory traffic.
+constexpr double kFusibleOpCostFraction = 0.5;
+
+// Assumed cost of one XLA compilation of a cluster.
+constexpr double kCompilationMicros = 1e5;
+
+// What the profile says about one node.
+struct NodeProfile {
+  int64_t executions = 0;
+  int64_t total_micros = 0;
+  // The distinct output shapes seen, each encoded as one string.
+  absl::flat_hash_set<std::string> output_shapes;
+};
+
+using Profile = absl::flat_hash_map<std::string, NodeProfile>;
+
+Status LoadProfile(Env* env, const std::string& path, Profile* profile) {
+  StepStats step_stats;
+  if (!ReadBinaryProto(env, path, &step_stats).ok()) {
+    Status status = ReadTextProto(env, path, &step_stats);
+    if (!status.ok()) {
+      return errors::InvalidArgument(
+          "Could not read --tf_xla_clustering_profile=", path,
+          " as a StepStats proto: ", status.error_message());
+    }
+  }
+
+  for (const DeviceStepStats& dev_stats : step_stats.dev_stats()) {
+    for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+      // Some producers append ":<op type>" to the node name.
+      absl::string_view name = node_stats.node_name();
+      name = name.substr(0, name.find(':'));
+      NodeProfile& node_profile = (*profile)[std::string(name)];
+      node_profile.executions++;
+      node_profile.total_micros +=
+          node_stats.op_end_rel_micros() > node_stats.op_start_rel_micros()
+              ? node_stats.op_end_rel_micros() -
+                    node_stats.op_start_rel_micros()
+              : node_stats.all_end_rel_micros();
+      std::string shapes;
+      for (const NodeOutput& output : node_stats.output()) {
+        absl::StrAppend(&shapes, TensorShapeRep::DebugString(
+                                     output.tensor_description().shape()));
+      }
+      node_profile.output_shapes.insert(std::move(shapes));
+    }
+  }
+  return OkStatus();
+}
+
+// Returns true if XLA lowers `n` to the same library call (cuBLAS, cuDNN,
+// Eigen) that the TensorFlow kernel uses, so clustering it does not make it
+// faster.
+bool IsLibraryCallOp(const Node& n) {
+  static const auto* const kLibraryCallOps =
+      new absl::flat_hash_set<std::string>({
+          "BatchMatMul",
+          "BatchMatMulV2",
+          "BatchMatMulV3",
+          "Conv2D",
+          "Conv2DBackpropFilter",
+          "Conv2DBackpropInput",
+          "Conv3D",
+          "Conv3DBackpropFilterV2",
+          "Conv3DBackpropInputV2",
+          "DepthwiseConv2dNative",
+          "DepthwiseConv2dNativeBackpropFilter",
+          "DepthwiseConv2dNativeBackpropInput",
+          "Einsum",
+          "MatMul",
+      });
+  return kLibraryCallOps->contains(n.type_string());
+}
+
+// Declusters every cluster whose estimated cost under XLA exceeds its measured
+// cost under TensorFlow.  The estimate charges each op its measured TensorFlow
+// time, discounted for ops that XLA can fuse, plus a fixed launch cost and the
+// cost of recompiling the cluster for each new shape seen in the profile,
+// amortized over the profiled executions.  Clusters with an op that is missing
+// from the profile or that must be compiled are left alone.
+Status PartiallyDeclusterGraph(Graph* graph, const std::string& profile_path,
+                               Env* env) {
+  Profile profile;
+  TF_RETURN_IF_ERROR(LoadProfile(env, profile_path, &profile));
+
+  std::map<std::string, std::vector<Node*>> clusters;
+  for (Node* n : graph->op_nodes()) {
+    if (std::optional<absl::string_view> cluster = GetXlaClusterForNode(*n)) {
+      clusters[std::string(*cluster)].push_back(n);
+    }
+  }
+
+  for (const auto& [cluster_name, members] : clusters) {
+    double tf_micros = 0;
+    double xla_micros = kClusterLaunchMicros;
+    int64_t executions = 0;
+    int64_t shape_signatures = 0;
+    bool can_estimate = true;
+    for (Node* n : members) {
+      bool must_compile;
+      TF_RETURN_IF_ERROR(
+          reduce_recompilation::MustCompileNode(n, &must_compile));
+      auto it = profile.find(n->name());
+      if (must_compile || it == profile.end()) {
+        can_estimate = false;
+        break;
+      }
+      const NodeProfile& node_profile = it->second;
+      double micros = static_cast<double>(node_profile.total_micros) /
+                      node_profile.executions;
+      tf_micros += micros;
+      xla_micros += IsLibraryCallOp(*n) ? micros
+                                        : micros * kFusibleOpCostFraction;
+      executions = std::max(executions, node_profile.executions);
+      shape_signatures = std::max<int64_t>(shape_signatures,
+                                           node_profile.output_shapes.size());
+    }
+    if (!can_estimate) {
+      continue;
+    }
+    // The first compilation is amortized over the whole run, but every new
+    // shape recompiles.
+    xla_micros += kCompilationMicros * (shape_signatures - 1) / executions;
+
+    VLOG(3) << "Cluster " << cluster_name << ": estimated " << xla_micros
+            << "us under XLA, measured " << tf_micros << "us under TensorFlow";
+    if (xla_micros > tf_micros) {
+      VLOG(2) << "Declustering " << cluster_name
+              << " because it is estimated to be slower under XLA";
+      for (Node* n : members) {
+        RemoveFromXlaCluster(n);
+      }
+    }
+  }
+  return OkStatus();
+}
+}  // namespace decluster_unprofitable_clusters
+
 namespace decluster_root_shape_consumers {
 
 Status PartiallyDeclusterGraph(Graph* graph) {
@@ -424,6 +576,15 @@ Status PartiallyDeclusterPass::Run(
         "GraphOptimizationPassOptions::session_options::env must be set for "
         "PartiallyDeclusterPass.");
   }
+  // Decluster whole clusters before the finer-grained declustering below, so
+  // that it only looks at the clusters that remain.
+  const std::string& profile_path =
+      GetMarkForCompilationPassFlags()->tf_xla_clustering_profile;
+  if (!profile_path.empty()) {
+    TF_RETURN_IF_ERROR(decluster_unprofitable_clusters::PartiallyDeclusterGraph(
+        graph, profile_path, options.session_options->env));
+  }
+
   TF_RETURN_IF_ERROR(reduce_recompilation::PartiallyDeclusterGraph(
       graph, options.flib_def, options.session_options->env));
 
@@ -23,7 +23,10 @@ limitations under the License.
 #include "tensorflow/cc/ops/function_ops.h"
 #include "tensorflow/cc/ops/sendrecv_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/cc/ops/nn_ops.h"
 #include "tensorflow/compiler/jit/defs.h"
+#include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/jit/test_util.h"
 #include "tensorflow/compiler/jit/xla_cluster_util.h"
 #include "tensorflow/compiler/tf2xla/cc/ops/xla_ops.h"
@@ -35,9 +38,12 @@ limitations under the License.
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -557,5 +563,104 @@ TEST(PartiallyDeclusterPassTest,
   EXPECT_EQ(GetXlaClusterForNode(*n_c), "cluster_0");
 }
 
+// Adds `executions` executions of `node_name` taking `micros` each, with a
+// different output shape for each execution if `vary_shapes` is true.
+void AddToProfile(StepStats* step_stats, const string& node_name,
+                  int64_t micros, int executions, bool vary_shapes = false) {
+  DeviceStepStats* dev_stats = step_stats->dev_stats_size() > 0
+                                   ? step_stats->mutable_dev_stats(0)
+                                   : step_stats->add_dev_stats();
+  for (int i = 0; i < executions; ++i) {
+    NodeExecStats* node_stats = dev_stats->add_node_stats();
+    node_stats->set_node_name(node_name);
+    node_stats->set_op_start_rel_micros(0);
+    node_stats->set_op_end_rel_micros(micros);
+    node_stats->add_output()
+        ->mutable_tensor_description()
+        ->mutable_shape()
+        ->add_dim()
+        ->set_size(vary_shapes ? i + 1 : 1);
+  }
+}
+
+Status PartiallyDeclusterWithProfile(std::unique_ptr<Graph>* graph,
+                                     const StepStats& step_stats) {
+  string path = io::JoinPath(testing::TmpDir(), "clustering_profile.pb");
+  TF_RETURN_IF_ERROR(WriteBinaryProto(Env::Default(), path, step_stats));
+  MarkForCompilationPassFlags* flags = GetMarkForCompilationPassFlags();
+  flags->tf_xla_clustering_profile = path;
+  Status status = PartiallyDecluster(graph);
+  flags->tf_xla_clustering_profile = "";
+  return status;
+}
+
+TEST(PartiallyDeclusterPassTest, ProfileDeclustersUnprofitableClusters) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::Scope in_cluster_0 = root.WithXlaCluster("cluster_0");
+  tensorflow::Scope in_cluster_1 = root.WithXlaCluster("cluster_1");
+  tensorflow::Scope in_cluster_2 = root.WithXlaCluster("cluster_2");
+  Output a = ops::Placeholder(root.WithOpName("a"), DT_FLOAT);
+  Output b = ops::Placeholder(root.WithOpName("b"), DT_FLOAT);
+
+  // A matmul gains nothing from XLA, so the launch cost makes it slower.
+  Output matmul = ops::MatMul(in_cluster_0.WithOpName("matmul"), a, b);
+  Output relu = ops::Relu(in_cluster_0.WithOpName("relu"), matmul);
+
+  // An elementwise chain is faster under XLA.
+  Output add = ops::Add(in_cluster_1.WithOpName("add"), a, b);
+  Output mul = ops::Mul(in_cluster_1.WithOpName("mul"), add, b);
+  Output tanh = ops::Tanh(in_cluster_1.WithOpName("tanh"), mul);
+
+  // Unless it recompiles on every execution.
+  Output sub = ops::Sub(in_cluster_2.WithOpName("sub"), a, b);
+  Output neg = ops::Neg(in_cluster_2.WithOpName("neg"), sub);
+
+  auto graph = std::make_unique<Graph>(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(graph.get()));
+
+  StepStats step_stats;
+  AddToProfile(&step_stats, "matmul", 1000, 10);
+  AddToProfile(&step_stats, "relu", 10, 10);
+  AddToProfile(&step_stats, "add", 30, 10);
+  AddToProfile(&step_stats, "mul", 30, 10);
+  AddToProfile(&step_stats, "tanh", 30, 10);
+  AddToProfile(&step_stats, "sub", 30, 10, /*vary_shapes=*/true);
+  AddToProfile(&step_stats, "neg", 30, 10, /*vary_shapes=*/true);
+  TF_ASSERT_OK(PartiallyDeclusterWithProfile(&graph, step_stats));
+
+  for (const char* name : {"matmul", "relu", "sub", "neg"}) {
+    Node* n = FindNodeByName(*graph, name);
+    ASSERT_NE(n, nullptr);
+    EXPECT_EQ(GetXlaClusterForNode(*n), std::nullopt) << name;
+  }
+  for (const char* name : {"add", "mul", "tanh"}) {
+    Node* n = FindNodeByName(*graph, name);
+    ASSERT_NE(n, nullptr);
+    EXPECT_EQ(GetXlaClusterForNode(*n), "cluster_1") << name;
+  }
+}
+
+TEST(PartiallyDeclusterPassTest, ProfileKeepsClustersWithUnmeasuredNodes) {
+  tensorflow::Scope root = tensorflow::Scope::NewRootScope();
+  tensorflow::Scope in_cluster_0 = root.WithXlaCluster("cluster_0");
+  Output a = ops::Placeholder(root.WithOpName("a"), DT_FLOAT);
+  Output b = ops::Placeholder(root.WithOpName("b"), DT_FLOAT);
+  Output matmul = ops::MatMul(in_cluster_0.WithOpName("matmul"), a, b);
+  Output relu = ops::Relu(in_cluster_0.WithOpName("relu"), matmul);
+
+  auto graph = std::make_unique<Graph>(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(graph.get()));
+
+  StepStats step_stats;
+  AddToProfile(&step_stats, "matmul", 1000, 10);
+  TF_ASSERT_OK(PartiallyDeclusterWithProfile(&graph, step_stats));
+
+  for (const char* name : {"matmul", "relu"}) {
+    Node* n = FindNodeByName(*graph, name);
+    ASSERT_NE(n, nullptr);
+    EXPECT_EQ(GetXlaClusterForNode(*n), "cluster_0") << name;
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -16,7 +16,10 @@ limitations under the License.
 #include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/jit/mark_for_compilation_pass.h"
 #include "tensorflow/compiler/jit/tests/xla_compilation_cache_test_helper.h"
+#include "absl/strings/match.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
 namespace {
@@ -62,6 +65,41 @@ TEST_F(XlaCompilationCacheSerializeTest, PersistentCacheTest) {
   }
 }
 
+TEST_F(XlaCompilationCacheSerializeTest, SavedEntriesAreWrittenAndLoaded) {
+  const std::string cache_dir =
+      io::JoinPath(tensorflow::testing::TmpDir(), "saved_entries");
+  std::string& flag =
+      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_directory;
+  const std::string saved_flag = flag;
+  flag = cache_dir;
+  GraphDef graph = GetTestGraph({-1, 4});
+
+  // Entries are saved in the background. The session's compilation caches are
+  // destroyed when the run completes, which waits for the saves.
+  testing::ResetClusterSequenceNumber();
+  listener()->ClearListenerHistory();
+  TF_ASSERT_OK(ExecuteWithBatch(graph, 1));
+  TF_ASSERT_OK(
+      listener()->VerifyListenerHistory(/*expect_persistent_cache_use=*/false));
+
+  std::vector<string> file_names;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &file_names));
+  EXPECT_FALSE(file_names.empty());
+  for (const auto& file_name : file_names) {
+    // No temporary files are left behind.
+    EXPECT_TRUE(absl::EndsWith(file_name, ".pb")) << file_name;
+  }
+
+  testing::ResetClusterSequenceNumber();
+  listener()->ClearListenerHistory();
+  TF_ASSERT_OK(ExecuteWithBatch(graph, 1));
+  TF_ASSERT_OK(
+      listener()->VerifyListenerHistory(/*expect_persistent_cache_use=*/true));
+
+  testing::ResetClusterSequenceNumber();
+  flag = saved_flag;
+}
+
 }  // namespace
 }  // namespace tensorflow
 
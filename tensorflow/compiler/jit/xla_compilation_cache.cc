@@ -140,16 +140,14 @@ std::string XlaSerializedCacheKeyToString(const XlaSerializedCacheKey& key) {
       key.prefix(), key.prefix().empty() ? "" : kXlaSerializedCacheKeySeparator,
       key.signature_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.cluster_fingerprint(), kXlaSerializedCacheKeySeparator,
-      key.device_type());
+      key.device_type(), kXlaSerializedCacheKeySeparator,
+      Hash64Combine(key.compile_options_fingerprint(),
+                    Fingerprint64(key.device_model())));
 }
 
 }  // namespace
 
 constexpr int64_t XlaCompilationCache::kDefaultCompilationThreshold;
-constexpr int64_t
-    XlaCompilationCache::AsyncCompilationState::kNumCompilerThreads;
-constexpr int64_t
-    XlaCompilationCache::AsyncCompilationState::kMaxNumOngoingCompilations;
 
 XlaCompilationCache::XlaCompilationCache(Config config,
                                          xla::LocalClient* client,
@@ -158,7 +156,13 @@ XlaCompilationCache::XlaCompilationCache(Config config,
       device_type_(std::move(device_type)),
       disable_strict_signature_checks_(config.disable_strict_signature_checks),
       persistance_prefix_(config.persistance_prefix),
-      persistent_cache_directory_(config.persistent_cache_directory) {}
+      async_compilation_state_(config.max_ongoing_async_compilations),
+      persistent_cache_directory_(config.persistent_cache_directory) {
+  if (!persistent_cache_directory_.empty()) {
+    serialization_thread_ = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "xla_cache_serialization_thread", 1);
+  }
+}
 
 XlaCompilationCache::~XlaCompilationCache() {
   // Ensure any use of our programs have completed by waiting for all stream
@@ -176,6 +180,9 @@ XlaCompilationCache::~XlaCompilationCache() {
   // is destructed, which is dependent on the order of the members in the
   // XlaCompilationCache class, which is error prone if the order changes.
   async_compilation_state_.compiler_threads.reset();
+  // Asynchronous compilations may have scheduled saves, so wait for the saves
+  // only after the compilations have finished.
+  serialization_thread_.reset();
   // TODO(b/110813685): Think about the program ownership model. Programs are
   // currently owned by the compilation cache which means we must wait for
   // program completion in the destructor. There are multiple compilation caches
@@ -521,7 +528,9 @@ Status XlaCompilationCache::CompileStrict(
     const xla::HloModuleProto& hlo_module =
         entry->compilation_result.computation->proto();
 
-    XlaSerializedCacheKey cache_key = BuildSerializedCacheKey(sig, hlo_module);
+    TF_ASSIGN_OR_RETURN(
+        XlaSerializedCacheKey cache_key,
+        BuildSerializedCacheKey(options, sig, entry->compilation_result));
 
     {
       XLA_SCOPED_LOGGING_TIMER(absl::StrCat(
@@ -550,11 +559,8 @@ Status XlaCompilationCache::CompileStrict(
     // Caching is done regardless of the entry->compilation_status. To take
     // advantage of newer compilation code, a cache flush is required.
     if (!persistent_cache_directory_.empty()) {
-      XLA_SCOPED_LOGGING_TIMER(absl::StrCat(
-          "Serializing and saving cache entry: ", sig.HumanString()));
-      TF_ASSIGN_OR_RETURN(XlaSerializedCacheEntry serialized_entry,
-                          SerializeEntry(options, sig, *entry));
-      TF_RETURN_IF_ERROR(SaveSerializedEntry(std::move(serialized_entry)));
+      TF_RETURN_IF_ERROR(VerifyEntryIsSerializable(*entry));
+      SaveSerializedEntryAsync(options, sig, entry->compilation_result);
     }
   }
 
@@ -614,7 +620,10 @@ Status XlaCompilationCache::CompileAsynchronous(
   // All values are captured by value. Make sure that all pointer values (like
   // entry) do not get freed until the lambda has finished,\.
   const std::string& function_name = function.name();
+  const uint64 queued_us = Env::Default()->NowMicros();
   async_compilation_state_.compiler_threads->Schedule([=] {
+    metrics::UpdateXlaAsyncCompilationQueueTime(Env::Default()->NowMicros() -
+                                                queued_us);
     Entry local_entry;
     VLOG(2) << "Starting asynchronous compilation of cluster " << function_name
             << '.';
@@ -670,21 +679,23 @@ bool XlaCompilationCache::ShouldCompileCluster(CompileMode compile_mode,
     return false;
   }
 
-  if (is_first_execution) {
-    return true;
-  }
-
   if (compile_mode == CompileMode::kAsync) {
-    // Asynchronous compilation is enabled.
+    // Asynchronous compilation is enabled. The bound also applies to the first
+    // execution of a cluster, which is not held up by deferring it.
     mutex_lock lock(async_compilation_state_.async_compilation_state_mu);
     if (async_compilation_state_.num_ongoing_compilations >=
-        async_compilation_state_.kMaxNumOngoingCompilations) {
+        async_compilation_state_.max_num_ongoing_compilations) {
       VLOG(2) << "Not asynchronously compiling cluster " << function.name()
               << " because of too many ongoing compilations.";
+      metrics::IncrementXlaAsyncCompilationsDeferred();
       return false;
     }
   }
 
+  if (is_first_execution) {
+    return true;
+  }
+
   bool reached_compile_threshold = current_request_count >= *compile_threshold;
   if (!reached_compile_threshold) {
     VLOG(2) << "Not compiling cluster " << function.name()
@@ -826,14 +837,26 @@ Status XlaCompilationCache::CompileImpl(
   return OkStatus();
 }
 
-XlaSerializedCacheKey XlaCompilationCache::BuildSerializedCacheKey(
-    const Signature& sig, const xla::HloModuleProto& hlo_module) const {
+StatusOr<XlaSerializedCacheKey> XlaCompilationCache::BuildSerializedCacheKey(
+    const XlaCompiler::Options& options, const Signature& sig,
+    const XlaCompiler::CompilationResult& result) const {
+  const xla::ExecutableBuildOptions build_options =
+      GetBuildOptions(options, result, client_->default_device_ordinal());
+  TF_ASSIGN_OR_RETURN(
+      se::StreamExecutor * executor,
+      client_->backend().stream_executor(build_options.device_ordinal()));
+  const se::DeviceDescription& description = executor->GetDeviceDescription();
+
   XlaSerializedCacheKey serialized_cache_key;
   serialized_cache_key.set_signature_fingerprint(Signature::Hash()(sig));
   serialized_cache_key.set_cluster_fingerprint(
-      DeterministicProtoHash64(hlo_module));
+      DeterministicProtoHash64(result.computation->proto()));
   serialized_cache_key.set_device_type(device_type_.type_string());
   serialized_cache_key.set_prefix(persistance_prefix_);
+  serialized_cache_key.set_compile_options_fingerprint(
+      DeterministicProtoHash64(build_options.debug_options()));
+  serialized_cache_key.set_device_model(
+      absl::StrCat(description.name(), " ", description.platform_version()));
   return serialized_cache_key;
 }
 
@@ -869,9 +892,7 @@ Status XlaCompilationCache::VerifyLoadedCacheEntry(
   return OkStatus();
 }
 
-StatusOr<XlaSerializedCacheEntry> XlaCompilationCache::SerializeEntry(
-    const XlaCompiler::Options& options, const Signature& sig,
-    const Entry& entry) {
+Status XlaCompilationCache::VerifyEntryIsSerializable(const Entry& entry) {
   if (entry.compile_state != CompileState::kCompiled) {
     return errors::FailedPrecondition(
         "Cache entry to serialize is not compiled.");
@@ -884,21 +905,46 @@ StatusOr<XlaSerializedCacheEntry> XlaCompilationCache::SerializeEntry(
     return errors::FailedPrecondition(
         "Executable not found for cache entry to serialize.");
   }
+  return OkStatus();
+}
 
+StatusOr<XlaSerializedCacheEntry> XlaCompilationCache::SerializeEntry(
+    const XlaCompiler::Options& options, const Signature& sig,
+    const XlaCompiler::CompilationResult& result) {
   XlaSerializedCacheEntry serialized_entry;
-  const xla::HloModuleProto& hlo_module =
-      entry.compilation_result.computation->proto();
-  *serialized_entry.mutable_key() = BuildSerializedCacheKey(sig, hlo_module);
-  *serialized_entry.mutable_hlo_module() = hlo_module;
+  TF_ASSIGN_OR_RETURN(*serialized_entry.mutable_key(),
+                      BuildSerializedCacheKey(options, sig, result));
+  *serialized_entry.mutable_hlo_module() = result.computation->proto();
 
-  TF_ASSIGN_OR_RETURN(
-      std::unique_ptr<xla::AotCompilationResult> aot_result,
-      BuildSerializedExecutable(options, entry.compilation_result));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<xla::AotCompilationResult> aot_result,
+                      BuildSerializedExecutable(options, result));
   TF_ASSIGN_OR_RETURN(std::string serialized, aot_result->SerializeAsString());
   serialized_entry.set_executable(std::move(serialized));
   return serialized_entry;
 }
 
+void XlaCompilationCache::SaveSerializedEntryAsync(
+    const XlaCompiler::Options& options, const Signature& sig,
+    const XlaCompiler::CompilationResult& result) {
+  // As for asynchronous compilation, the ThreadPool is destroyed in the
+  // destructor and waits for all scheduled work, so 'this' outlives the
+  // lambda. Everything else is captured by value.
+  serialization_thread_->Schedule(
+      [this, options, sig, result] {
+        XLA_SCOPED_LOGGING_TIMER(absl::StrCat(
+            "Serializing and saving cache entry: ", sig.HumanString()));
+        StatusOr<XlaSerializedCacheEntry> serialized_entry =
+            SerializeEntry(options, sig, result);
+        Status s = serialized_entry.ok()
+                       ? SaveSerializedEntry(*serialized_entry)
+                       : serialized_entry.status();
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to save persistent XLA compilation cache "
+                       << "entry for " << sig.HumanString() << ": " << s;
+        }
+      });
+}
+
 namespace {
 
 std::string GetFilePath(const XlaSerializedCacheKey& key,
@@ -916,7 +962,17 @@ Status XlaCompilationCache::SaveSerializedEntry(
   TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(persistent_cache_directory_));
   const std::string file_path =
       GetFilePath(entry.key(), persistent_cache_directory_);
-  return WriteBinaryProto(env, file_path, entry);
+  // The temporary file name must not end in '.pb', so that it is never
+  // mistaken for a complete entry.
+  std::string temp_file_path = absl::StrCat(file_path, ".");
+  if (!env->CreateUniqueFileName(&temp_file_path, ".tmp")) {
+    return errors::Internal("Failed to create a unique file name for ",
+                            file_path);
+  }
+  Status s = WriteBinaryProto(env, temp_file_path, entry);
+  if (s.ok()) s = env->RenameFile(temp_file_path, file_path);
+  if (!s.ok()) env->DeleteFile(temp_file_path).IgnoreError();
+  return s;
 }
 
 StatusOr<std::optional<XlaSerializedCacheEntry>>
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_XLA_COMPILATION_CACHE_H_
 #define TENSORFLOW_COMPILER_JIT_XLA_COMPILATION_CACHE_H_
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -71,6 +72,11 @@ class XlaCompilationCache : public ResourceBase {
 
     // The cache persistence prefix to use if serializing/deserialzing entries.
     std::string persistance_prefix;
+
+    // The maximum number of asynchronous compilations (CompileMode::kAsync)
+    // that can be ongoing at a time, which is also the number of compiler
+    // threads.
+    int64_t max_ongoing_async_compilations = 10;
   };
   XlaCompilationCache(Config config, xla::LocalClient* client,
                       DeviceType device_type);
@@ -224,13 +230,26 @@ class XlaCompilationCache : public ResourceBase {
 
   // Returns a cache key proto that identifies an entry in the compilation
   // cache.
-  XlaSerializedCacheKey BuildSerializedCacheKey(
-      const Signature& sig, const xla::HloModuleProto& hlo_module) const;
+  StatusOr<XlaSerializedCacheKey> BuildSerializedCacheKey(
+      const XlaCompiler::Options& options, const Signature& sig,
+      const XlaCompiler::CompilationResult& result) const;
+
+  // Checks that `entry` holds an executable that can be serialized.
+  Status VerifyEntryIsSerializable(const Entry& entry)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(entry.mu);
 
-  // Serializes the signature and its corresponding entry to a proto message.
+  // Serializes the signature and its corresponding compilation result to a
+  // proto message.
   StatusOr<XlaSerializedCacheEntry> SerializeEntry(
       const XlaCompiler::Options& options, const Signature& sig,
-      const Entry& entry) TF_EXCLUSIVE_LOCKS_REQUIRED(entry.mu);
+      const XlaCompiler::CompilationResult& result);
+
+  // Serializes and saves an entry on `serialization_thread_`. Serializing
+  // builds the executable a second time, so this keeps it off the path of the
+  // first execution of the cluster. Errors are logged rather than returned.
+  void SaveSerializedEntryAsync(const XlaCompiler::Options& options,
+                                const Signature& sig,
+                                const XlaCompiler::CompilationResult& result);
 
   // Checks if the loaded `entry` matches the expected `key` and `hlo_module`.
   Status VerifyLoadedCacheEntry(const XlaSerializedCacheKey& key,
@@ -252,7 +271,9 @@ class XlaCompilationCache : public ResourceBase {
                              CompileScope scope);
 
   // Saves the cache entry in the file directory supplied during the
-  // construction of this class. Overwrites existing entries.
+  // construction of this class. Overwrites existing entries. The entry is
+  // written to a temporary file that is then renamed into place, so readers
+  // sharing the directory never observe a partially written entry.
   Status SaveSerializedEntry(const XlaSerializedCacheEntry& entry);
 
   // Tries to load a cache entry given a `key` by searching the file directory
@@ -290,11 +311,9 @@ class XlaCompilationCache : public ResourceBase {
   struct AsyncCompilationState {
     mutex async_compilation_state_mu;
 
-    // Number of threads for asynchronous compilations.
-    static constexpr int64_t kNumCompilerThreads = 10;
-
-    // Maximum number of ongoing compilations.
-    static constexpr int64_t kMaxNumOngoingCompilations = kNumCompilerThreads;
+    // Maximum number of ongoing compilations, and the number of threads for
+    // asynchronous compilations.
+    const int64_t max_num_ongoing_compilations;
 
     // Number of ongoing compilations.
     int64_t num_ongoing_compilations TF_GUARDED_BY(async_compilation_state_mu) =
@@ -303,10 +322,12 @@ class XlaCompilationCache : public ResourceBase {
     // Pool of threads for asynchronous compilations.
     std::unique_ptr<thread::ThreadPool> compiler_threads;
 
-    AsyncCompilationState() {
+    explicit AsyncCompilationState(int64_t max_num_ongoing_compilations)
+        : max_num_ongoing_compilations(
+              std::max<int64_t>(max_num_ongoing_compilations, 1)) {
       compiler_threads = std::make_unique<tensorflow::thread::ThreadPool>(
           tensorflow::Env::Default(), "async_compiler_threads",
-          kNumCompilerThreads);
+          this->max_num_ongoing_compilations);
     }
 
   } async_compilation_state_;
@@ -319,6 +340,11 @@ class XlaCompilationCache : public ResourceBase {
   // specified file system directory path.
   std::string persistent_cache_directory_;
 
+  // Thread that serializes and saves entries to the persistent cache, if
+  // there is one. It is separate from the compiler threads, so that saving
+  // does not count towards the bound on ongoing asynchronous compilations.
+  std::unique_ptr<thread::ThreadPool> serialization_thread_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(XlaCompilationCache);
 };
 
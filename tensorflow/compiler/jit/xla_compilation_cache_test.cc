@@ -18,6 +18,10 @@ limitations under the License.
 #include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
 #include "tensorflow/compiler/xla/client/client_library.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -92,6 +96,62 @@ TEST(XlaCompilationCacheTest, SignatureUniqueness) {
   EXPECT_FALSE(s1 == s2);
 }
 
+TEST(XlaCompilationCacheTest, MaxOngoingAsyncCompilations) {
+  xla::LocalClient* client = xla::ClientLibrary::LocalClientOrDie();
+  FunctionLibraryDefinition flib_def(OpRegistry::Global(),
+                                     FunctionDefLibrary());
+
+  // Blocks every compilation until `unblock` is notified, and counts the
+  // compilations that were started.
+  mutex mu;
+  int num_started = 0;
+  Notification unblock;
+  std::function<Status(ResourceMgr*)> block_compilation =
+      [&](ResourceMgr* resource_manager) {
+        {
+          mutex_lock lock(mu);
+          ++num_started;
+        }
+        unblock.WaitForNotification();
+        return OkStatus();
+      };
+  XlaCompiler::Options options;
+  options.device_type = DeviceType(DEVICE_CPU_XLA_JIT);
+  options.client = client;
+  options.flib_def = &flib_def;
+  options.populate_resource_manager = &block_compilation;
+
+  XlaCompilationCache::Config config;
+  config.max_ongoing_async_compilations = 2;
+  auto cache = new XlaCompilationCache(std::move(config), client,
+                                       DeviceType(DEVICE_CPU_XLA_JIT));
+
+  std::vector<XlaCompiler::Argument> args(1);
+  args[0].kind = XlaCompiler::Argument::kParameter;
+  args[0].type = DT_FLOAT;
+  args[0].shape = TensorShape({2});
+
+  // Only the first two clusters are queued, even though each of them is
+  // executed for the first time. The others run on the fallback path.
+  for (int i = 0; i < 4; ++i) {
+    NameAttrList fn;
+    fn.set_name(absl::StrCat("cluster", i));
+    const XlaCompiler::CompilationResult* compilation_result;
+    xla::LocalExecutable* executable;
+    TF_EXPECT_OK(cache->Compile(options, fn, args,
+                                XlaCompiler::CompileOptions{},
+                                XlaCompilationCache::CompileMode::kAsync,
+                                &compilation_result, &executable));
+    EXPECT_EQ(executable, nullptr);
+  }
+
+  // Destroying the cache waits for the queued compilations.
+  unblock.Notify();
+  cache->Unref();
+  mutex_lock lock(mu);
+  EXPECT_EQ(num_started, 2);
+}
+
 void BM_BuildSignature(::testing::benchmark::State& state) {
   const int n_args = state.range(0);
 
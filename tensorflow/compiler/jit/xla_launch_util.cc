@@ -249,7 +249,8 @@ XlaComputationLaunchContext::PopulateInputs(
     const XlaCompiler::CompilationResult* compilation_result,
     const std::map<int, const Tensor*>& resource_vars,
     int missing_ctx_input_prefix,
-    const xla::HloInputOutputAliasConfig& input_output_alias) {
+    const xla::HloInputOutputAliasConfig& input_output_alias,
+    const std::map<int, Tensor>& bucketed_inputs) {
   std::vector<xla::ExecutionInput> arguments;
   arguments.reserve(compilation_result->xla_input_shapes.size());
 
@@ -272,9 +273,15 @@ XlaComputationLaunchContext::PopulateInputs(
                                 update.modified;
                        });
 
-    const Tensor* t = is_resource_variable
-                          ? resource_vars.at(arg_num)
-                          : &(ctx->input(arg_num - missing_ctx_input_prefix));
+    auto bucketed_input = bucketed_inputs.find(arg_num);
+    const Tensor* t;
+    if (is_resource_variable) {
+      t = resource_vars.at(arg_num);
+    } else if (bucketed_input != bucketed_inputs.end()) {
+      t = &bucketed_input->second;
+    } else {
+      t = &(ctx->input(arg_num - missing_ctx_input_prefix));
+    }
     CHECK(t);
     bool donate_buffer =
         t->RefCountIsOne() && is_updated_resource_variable &&
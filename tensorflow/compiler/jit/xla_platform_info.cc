@@ -50,6 +50,8 @@ Status BuildXlaCompilationCache(DeviceBase* device, FunctionLibraryRuntime* flr,
       GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_directory,
       GetMarkForCompilationPassFlags()->tf_xla_disable_strict_signature_checks,
       GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_prefix);
+  cache_config.max_ongoing_async_compilations =
+      GetXlaOpsCommonFlags().tf_xla_async_compilation_max_ongoing;
 
   if (platform_info.xla_device_metadata()) {
     *cache = new XlaCompilationCache(
@@ -0,0 +1,199 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
+
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/types/variant.h"
+#include "tensorflow/compiler/jit/flags.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/stream_executor_no_cuda.h"
+
+namespace tensorflow {
+
+StatusOr<XlaShapeBuckets> XlaShapeBuckets::Parse(absl::string_view spec) {
+  XlaShapeBuckets buckets;
+  if (spec.empty()) return buckets;
+  if (spec == "pow2") {
+    buckets.powers_of_two_ = true;
+    return buckets;
+  }
+  for (absl::string_view size_str : absl::StrSplit(spec, ',')) {
+    int64_t size;
+    if (!absl::SimpleAtoi(size_str, &size) || size <= 0) {
+      return errors::InvalidArgument("Invalid shape bucket size '", size_str,
+                                     "' in '", spec, "'");
+    }
+    if (!buckets.sizes_.empty() && size <= buckets.sizes_.back()) {
+      return errors::InvalidArgument("Shape bucket sizes must be increasing: '",
+                                     spec, "'");
+    }
+    buckets.sizes_.push_back(size);
+  }
+  return buckets;
+}
+
+const XlaShapeBuckets& XlaShapeBuckets::FromFlags() {
+  static const XlaShapeBuckets* buckets = [] {
+    StatusOr<XlaShapeBuckets> parsed =
+        Parse(GetXlaOpsCommonFlags().tf_xla_shape_buckets);
+    if (!parsed.ok()) {
+      LOG(ERROR) << "Ignoring --tf_xla_shape_buckets: " << parsed.status();
+      return new XlaShapeBuckets();
+    }
+    return new XlaShapeBuckets(std::move(parsed).value());
+  }();
+  return *buckets;
+}
+
+std::optional<int64_t> XlaShapeBuckets::BucketFor(int64_t size) const {
+  if (powers_of_two_) {
+    int64_t bucket = 1;
+    while (bucket < size) {
+      if (bucket > std::numeric_limits<int64_t>::max() / 2) {
+        return std::nullopt;
+      }
+      bucket *= 2;
+    }
+    return bucket;
+  }
+  for (int64_t bucket : sizes_) {
+    if (bucket >= size) return bucket;
+  }
+  return std::nullopt;
+}
+
+std::optional<XlaShapeBucketing> BucketXlaCompilerArguments(
+    const XlaShapeBuckets& buckets, std::vector<XlaCompiler::Argument>* args) {
+  if (!buckets.enabled()) return std::nullopt;
+
+  XlaShapeBucketing bucketing;
+  for (int i = 0; i < args->size(); ++i) {
+    const XlaCompiler::Argument& arg = (*args)[i];
+    // Only plain array parameters, which are padded with a memcpy.
+    if (arg.kind != XlaCompiler::Argument::kParameter ||
+        !absl::holds_alternative<TensorShape>(arg.shape) ||
+        absl::get<TensorShape>(arg.shape).dims() == 0 ||
+        !DataTypeCanUseMemcpy(arg.type) ||
+        !arg.dynamic_dim_to_arg_num_map.empty()) {
+      continue;
+    }
+    const int64_t size = absl::get<TensorShape>(arg.shape).dim_size(0);
+    if (bucketing.padded_args.empty()) {
+      bucketing.size = size;
+    } else if (size != bucketing.size) {
+      continue;
+    }
+    bucketing.padded_args.push_back(i);
+  }
+  if (bucketing.padded_args.empty() ||
+      bucketing.size > std::numeric_limits<int32>::max()) {
+    return std::nullopt;
+  }
+  std::optional<int64_t> bucket = buckets.BucketFor(bucketing.size);
+  if (!bucket.has_value() || *bucket > std::numeric_limits<int32>::max()) {
+    return std::nullopt;
+  }
+  bucketing.bucket = *bucket;
+  bucketing.size_arg = args->size();
+
+  for (int i : bucketing.padded_args) {
+    XlaCompiler::Argument& arg = (*args)[i];
+    TensorShape shape = absl::get<TensorShape>(arg.shape);
+    shape.set_dim(0, bucketing.bucket);
+    arg.shape = shape;
+    arg.dynamic_dim_to_arg_num_map[0] = bucketing.size_arg;
+  }
+  XlaCompiler::Argument size_arg;
+  size_arg.kind = XlaCompiler::Argument::kParameter;
+  size_arg.type = DT_INT32;
+  size_arg.shape = TensorShape();
+  size_arg.name = "bucketed_dim_size";
+  args->push_back(std::move(size_arg));
+  return bucketing;
+}
+
+Status BuildBucketedInputs(OpKernelContext* ctx,
+                           const XlaShapeBucketing& bucketing,
+                           absl::Span<const Tensor* const> inputs,
+                           std::map<int, Tensor>* bucketed_inputs) {
+  se::Stream* stream =
+      ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
+  bucketed_inputs->clear();
+
+  int64_t real_elements = 0;
+  int64_t padding_elements = 0;
+  for (int i : bucketing.padded_args) {
+    TF_RET_CHECK(i < inputs.size());
+    const Tensor& input = *inputs[i];
+    TF_RET_CHECK(input.dims() > 0 && input.dim_size(0) == bucketing.size);
+    TensorShape shape = input.shape();
+    shape.set_dim(0, bucketing.bucket);
+    Tensor padded;
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(input.dtype(), shape, &padded));
+
+    // The leading dimension is the outermost, so the input is a prefix of the
+    // padded tensor.
+    const int64_t input_bytes = input.TotalBytes();
+    const int64_t padding_bytes = padded.TotalBytes() - input_bytes;
+    char* dst = const_cast<char*>(padded.tensor_data().data());
+    const char* src = input.tensor_data().data();
+    if (stream != nullptr) {
+      se::DeviceMemoryBase dst_mem(dst, input_bytes);
+      stream->ThenMemcpyD2D(&dst_mem,
+                            se::DeviceMemoryBase(const_cast<char*>(src),
+                                                 input_bytes),
+                            input_bytes);
+      if (padding_bytes > 0) {
+        se::DeviceMemoryBase padding_mem(dst + input_bytes, padding_bytes);
+        stream->ThenMemZero(&padding_mem, padding_bytes);
+      }
+    } else {
+      std::memcpy(dst, src, input_bytes);
+      std::memset(dst + input_bytes, 0, padding_bytes);
+    }
+    real_elements += input.NumElements();
+    padding_elements += padded.NumElements() - input.NumElements();
+    bucketed_inputs->emplace(i, std::move(padded));
+  }
+
+  Tensor size;
+  TF_RETURN_IF_ERROR(ctx->allocate_temp(DT_INT32, TensorShape(), &size));
+  if (stream != nullptr) {
+    se::DeviceMemoryBase size_mem(const_cast<char*>(size.tensor_data().data()),
+                                  sizeof(int32));
+    stream->ThenMemset32(&size_mem, static_cast<uint32>(bucketing.size),
+                         sizeof(int32));
+    if (!stream->ok()) {
+      return errors::Internal("Failed to pad the inputs of an XLA cluster");
+    }
+  } else {
+    size.scalar<int32>()() = bucketing.size;
+  }
+  bucketed_inputs->emplace(bucketing.size_arg, std::move(size));
+
+  metrics::RecordXlaShapeBucketingElements(real_elements, padding_elements);
+  return OkStatus();
+}
+
+}  // namespace tensorflow
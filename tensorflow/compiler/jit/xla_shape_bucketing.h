@@ -0,0 +1,91 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
+#define TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
+
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_compiler.h"
+#include "tensorflow/compiler/xla/statusor.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+
+namespace tensorflow {
+
+// The bucket sizes that the leading dimension of the inputs of a cluster is
+// padded to, so that clusters fed with many distinct batch sizes compile one
+// executable per bucket rather than one per size.
+class XlaShapeBuckets {
+ public:
+  // Parses `spec`, which is either empty (no bucketing), "pow2" for powers of
+  // two, or a comma-separated list of increasing positive sizes.
+  static StatusOr<XlaShapeBuckets> Parse(absl::string_view spec);
+
+  // Returns the buckets set by --tf_xla_shape_buckets. An invalid value is
+  // logged and disables bucketing.
+  static const XlaShapeBuckets& FromFlags();
+
+  bool enabled() const { return powers_of_two_ || !sizes_.empty(); }
+
+  // Returns the smallest bucket that holds `size`, or std::nullopt if `size`
+  // is larger than every bucket.
+  std::optional<int64_t> BucketFor(int64_t size) const;
+
+ private:
+  bool powers_of_two_ = false;
+  std::vector<int64_t> sizes_;
+};
+
+// Describes how the arguments of a cluster were bucketed.
+struct XlaShapeBucketing {
+  // The runtime size of the leading dimension of the padded arguments.
+  int64_t size = 0;
+
+  // The size the leading dimension was padded to.
+  int64_t bucket = 0;
+
+  // The indices of the padded arguments.
+  std::vector<int> padded_args;
+
+  // The index of the appended argument that holds `size`.
+  int size_arg = -1;
+};
+
+// Pads the leading dimension of the non-constant parameters in `args` that
+// share the leading dimension of the first of them to its bucket, marks that
+// dimension dynamic, and appends a scalar int32 parameter holding its runtime
+// size. XLA's dynamic padder then masks out the padding, and the outputs of
+// the computation have their real, dynamic shapes. Returns std::nullopt, and
+// leaves `args` unchanged, if no argument can be bucketed.
+std::optional<XlaShapeBucketing> BucketXlaCompilerArguments(
+    const XlaShapeBuckets& buckets, std::vector<XlaCompiler::Argument>* args);
+
+// Builds the inputs that a computation with `bucketing` arguments takes in
+// place of `inputs`: a zero-padded copy of each padded argument and the
+// runtime size, keyed by argument index. The copies are made on the stream of
+// `ctx`, if any.
+Status BuildBucketedInputs(OpKernelContext* ctx,
+                           const XlaShapeBucketing& bucketing,
+                           absl::Span<const Tensor* const> inputs,
+                           std::map<int, Tensor>* bucketed_inputs);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
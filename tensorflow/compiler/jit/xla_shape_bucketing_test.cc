@@ -0,0 +1,114 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
+
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+XlaCompiler::Argument ParameterArg(DataType type, const TensorShape& shape) {
+  XlaCompiler::Argument arg;
+  arg.kind = XlaCompiler::Argument::kParameter;
+  arg.type = type;
+  arg.shape = shape;
+  return arg;
+}
+
+TEST(XlaShapeBucketsTest, Parse) {
+  StatusOr<XlaShapeBuckets> buckets = XlaShapeBuckets::Parse("");
+  TF_ASSERT_OK(buckets.status());
+  EXPECT_FALSE(buckets->enabled());
+
+  buckets = XlaShapeBuckets::Parse("8,32,128");
+  TF_ASSERT_OK(buckets.status());
+  EXPECT_TRUE(buckets->enabled());
+  EXPECT_EQ(buckets->BucketFor(1), 8);
+  EXPECT_EQ(buckets->BucketFor(8), 8);
+  EXPECT_EQ(buckets->BucketFor(9), 32);
+  EXPECT_EQ(buckets->BucketFor(128), 128);
+  EXPECT_EQ(buckets->BucketFor(129), std::nullopt);
+
+  buckets = XlaShapeBuckets::Parse("pow2");
+  TF_ASSERT_OK(buckets.status());
+  EXPECT_EQ(buckets->BucketFor(1), 1);
+  EXPECT_EQ(buckets->BucketFor(5), 8);
+  EXPECT_EQ(buckets->BucketFor(1024), 1024);
+}
+
+TEST(XlaShapeBucketsTest, ParseInvalid) {
+  EXPECT_FALSE(XlaShapeBuckets::Parse("8,4").ok());
+  EXPECT_FALSE(XlaShapeBuckets::Parse("8,8").ok());
+  EXPECT_FALSE(XlaShapeBuckets::Parse("0,8").ok());
+  EXPECT_FALSE(XlaShapeBuckets::Parse("8,x").ok());
+}
+
+TEST(XlaShapeBucketsTest, BucketArguments) {
+  StatusOr<XlaShapeBuckets> buckets = XlaShapeBuckets::Parse("16,64");
+  TF_ASSERT_OK(buckets.status());
+
+  std::vector<XlaCompiler::Argument> args;
+  args.push_back(ParameterArg(DT_FLOAT, TensorShape({10, 3})));
+  args.push_back(ParameterArg(DT_INT32, TensorShape({7})));
+  args.push_back(ParameterArg(DT_INT32, TensorShape({10})));
+  XlaCompiler::Argument constant_arg = ParameterArg(DT_INT32, TensorShape({}));
+  constant_arg.kind = XlaCompiler::Argument::kConstant;
+  constant_arg.constant_value = Tensor(DT_INT32, TensorShape({}));
+  args.push_back(constant_arg);
+
+  std::optional<XlaShapeBucketing> bucketing =
+      BucketXlaCompilerArguments(*buckets, &args);
+  ASSERT_TRUE(bucketing.has_value());
+  EXPECT_EQ(bucketing->size, 10);
+  EXPECT_EQ(bucketing->bucket, 16);
+  EXPECT_EQ(bucketing->padded_args, std::vector<int>({0, 2}));
+  EXPECT_EQ(bucketing->size_arg, 4);
+
+  ASSERT_EQ(args.size(), 5);
+  EXPECT_EQ(absl::get<TensorShape>(args[0].shape), TensorShape({16, 3}));
+  EXPECT_EQ(args[0].dynamic_dim_to_arg_num_map.at(0), 4);
+  EXPECT_EQ(absl::get<TensorShape>(args[1].shape), TensorShape({7}));
+  EXPECT_TRUE(args[1].dynamic_dim_to_arg_num_map.empty());
+  EXPECT_EQ(absl::get<TensorShape>(args[2].shape), TensorShape({16}));
+  EXPECT_EQ(args[3].kind, XlaCompiler::Argument::kConstant);
+  EXPECT_EQ(args[4].kind, XlaCompiler::Argument::kParameter);
+  EXPECT_EQ(args[4].type, DT_INT32);
+  EXPECT_EQ(absl::get<TensorShape>(args[4].shape), TensorShape({}));
+}
+
+TEST(XlaShapeBucketsTest, TooLargeForBuckets) {
+  StatusOr<XlaShapeBuckets> buckets = XlaShapeBuckets::Parse("16");
+  TF_ASSERT_OK(buckets.status());
+
+  std::vector<XlaCompiler::Argument> args;
+  args.push_back(ParameterArg(DT_FLOAT, TensorShape({17, 3})));
+  EXPECT_FALSE(BucketXlaCompilerArguments(*buckets, &args).has_value());
+  ASSERT_EQ(args.size(), 1);
+  EXPECT_EQ(absl::get<TensorShape>(args[0].shape), TensorShape({17, 3}));
+}
+
+TEST(XlaShapeBucketsTest, NoBucketsNoBucketing) {
+  std::vector<XlaCompiler::Argument> args;
+  args.push_back(ParameterArg(DT_FLOAT, TensorShape({17, 3})));
+  EXPECT_FALSE(
+      BucketXlaCompilerArguments(XlaShapeBuckets(), &args).has_value());
+  EXPECT_EQ(args.size(), 1);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -22,12 +22,27 @@ limitations under the License.
 
 #include "absl/strings/str_join.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tensorflow/compiler/mlir/lite/quantization/quantization_config.h"
 
 namespace mlir {
 namespace TFL {
 
+// Describes what a TFLite delegate can run, so that the conversion can target
+// it.
+struct DelegateCapabilities {
+  // Name of the delegate, used in reports.
+  std::string name = "delegate";
+  // Names of the TFLite ops the delegate supports, e.g. "tfl.add".
+  std::vector<std::string> supported_ops;
+  // Whether the delegate supports per-channel quantized tensors.
+  bool supports_per_channel_quantization = true;
+  // Whether the delegate supports hybrid ops, which compute on float inputs
+  // with quantized weights.
+  bool supports_hybrid_ops = true;
+};
+
 // A config that controls which passes get run as part TFLite converter.
 struct PassConfig {
   explicit PassConfig(quant::QuantizationSpecs specs)
@@ -88,6 +103,9 @@ struct PassConfig {
   bool enable_dynamic_update_slice;
   // Whether to preserve AssertOp during legalization.
   bool preserve_assert_op;
+  // If set, the conversion is steered towards ops the delegate supports and
+  // the predicted delegate partitioning is reported.
+  llvm::Optional<DelegateCapabilities> target_delegate;
 };
 
 inline llvm::raw_ostream& operator<<(llvm::raw_ostream& os,
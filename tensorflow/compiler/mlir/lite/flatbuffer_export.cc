@@ -75,6 +75,7 @@ limitations under the License.
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/lite/delegates/flex/allowlisted_flex_ops.h"
@@ -508,7 +509,9 @@ class Translator {
                             toco_flags.select_user_tf_ops().end()),
         metadata_(metadata),
         supported_backends_(toco_flags.supported_backends().begin(),
-                            toco_flags.supported_backends().end()) {
+                            toco_flags.supported_backends().end()),
+        deduplicate_buffers_(!toco_flags.disable_buffer_deduplication()),
+        buffer_alignment_(toco_flags.buffer_alignment()) {
     // The first buffer must be empty according to the schema definition.
     empty_buffer_ = tflite::CreateBuffer(builder_);
     buffers_.push_back(empty_buffer_);
@@ -537,6 +540,12 @@ class Translator {
   // and returns llvm::None on failure.
   Optional<BufferOffset<tflite::Buffer>> BuildBuffer(Operation* inst);
 
+  // Returns a TFLite buffer holding `size` bytes of `data`, aligned to
+  // `buffer_alignment_`. If buffer deduplication is enabled, returns an
+  // existing buffer with the same contents instead of adding a new one.
+  BufferOffset<tflite::Buffer> BuildBufferFromBytes(const uint8_t* data,
+                                                    size_t size);
+
   // Build TFLite tensor from the given type. This function is for tfl.lstm
   // intermediates, which should have UniformQuantizedType.
   Optional<BufferOffset<tflite::Tensor>> BuildTensorFromType(
@@ -653,6 +662,15 @@ class Translator {
   BufferOffset<tflite::Buffer> empty_buffer_;
 
   std::vector<BufferOffset<tflite::Buffer>> buffers_;
+  // A constant buffer and its data vector, which can be read back from
+  // `builder_` while the model is being built.
+  struct ConstantBuffer {
+    BufferOffset<tflite::Buffer> buffer;
+    VectorBufferOffset<uint8_t> data;
+  };
+  // Maps the fingerprint of the contents of constant buffers to the buffers.
+  absl::flat_hash_map<uint64_t, std::vector<ConstantBuffer>>
+      constant_buffers_;
   // Maps subgraph index and tensor name in the graph to the tensor index.
   absl::flat_hash_map<int, absl::flat_hash_map<std::string, int>>
       tensor_index_map_;
@@ -692,6 +710,10 @@ class Translator {
   const std::map<std::string, std::string> metadata_;
   // User's defined supported backends.
   const std::unordered_set<std::string> supported_backends_;
+  // Whether constant buffers with identical contents are shared.
+  const bool deduplicate_buffers_;
+  // Alignment in bytes of the data of constant buffers.
+  const int buffer_alignment_;
   // A mapping table to mlir::Operation objects for TFL subgraph and operator
   // index in a flatbuffer.
   std::vector<std::vector<Operation*>> subgraph_op_inst_map_;
@@ -758,16 +780,44 @@ Optional<BufferOffset<tflite::Buffer>> Translator::BuildBuffer(
     }
     char* tensor_buffer;
     int bytes = dynamic_buffer.WriteToBuffer(&tensor_buffer);
-    auto buffer_data =
-        builder_.CreateVector(reinterpret_cast<uint8_t*>(tensor_buffer), bytes);
+    auto buffer = BuildBufferFromBytes(
+        reinterpret_cast<const uint8_t*>(tensor_buffer), bytes);
     free(tensor_buffer);
-    return tflite::CreateBuffer(builder_, buffer_data);
+    return buffer;
   }
 
   absl::string_view tensor_data = tensor.tensor_data();
-  auto buffer_data = builder_.CreateVector(
+  return BuildBufferFromBytes(
       reinterpret_cast<const uint8_t*>(tensor_data.data()), tensor_data.size());
-  return tflite::CreateBuffer(builder_, buffer_data);
+}
+
+BufferOffset<tflite::Buffer> Translator::BuildBufferFromBytes(
+    const uint8_t* data, size_t size) {
+  uint64_t fingerprint = 0;
+  if (deduplicate_buffers_) {
+    fingerprint = tensorflow::Fingerprint64(
+        absl::string_view(reinterpret_cast<const char*>(data), size));
+    auto it = constant_buffers_.find(fingerprint);
+    if (it != constant_buffers_.end()) {
+      for (const ConstantBuffer& candidate : it->second) {
+        // Offsets count from the end of the buffer being built.
+        const auto* candidate_data =
+            reinterpret_cast<const flatbuffers::Vector<uint8_t>*>(
+                builder_.GetCurrentBufferPointer() + builder_.GetSize() -
+                candidate.data.o);
+        if (candidate_data->size() == size &&
+            std::equal(data, data + size, candidate_data->data()))
+          return candidate.buffer;
+      }
+    }
+  }
+
+  builder_.ForceVectorAlignment(size, sizeof(uint8_t), buffer_alignment_);
+  auto buffer_data = builder_.CreateVector(data, size);
+  auto buffer = tflite::CreateBuffer(builder_, buffer_data);
+  if (deduplicate_buffers_)
+    constant_buffers_[fingerprint].push_back({buffer, buffer_data});
+  return buffer;
 }
 
 Optional<BufferOffset<tflite::Tensor>> Translator::BuildTensorFromType(
@@ -1786,6 +1836,12 @@ Optional<std::string> Translator::Translate(
     op_or_arg_name_mapper = &default_op_or_arg_name_mapper;
   if (!UpdateEntryFunction(module)) return llvm::None;
   if (!IsValidTFLiteMlirModule(module)) return llvm::None;
+  const int buffer_alignment = toco_flags.buffer_alignment();
+  if (buffer_alignment <= 0 || (buffer_alignment & (buffer_alignment - 1))) {
+    module.emitError("buffer alignment must be a power of two, got ")
+        << buffer_alignment;
+    return llvm::None;
+  }
   Translator translator(module, toco_flags, tags, op_or_arg_name_mapper,
                         metadata);
   return translator.TranslateInternal();
@@ -119,6 +119,18 @@ static opt<bool, true> strip_debug_info_flag(
     "strip-debug-info", llvm::cl::desc("Strip debug info during export"),
     llvm::cl::location(strip_debug_info), llvm::cl::init(false));
 
+// NOLINTNEXTLINE
+static opt<bool> disable_buffer_deduplication_flag(
+    "disable-buffer-deduplication",
+    llvm::cl::desc("Don't share constant buffers with identical contents"),
+    llvm::cl::init(false));
+
+// NOLINTNEXTLINE
+static opt<int> buffer_alignment_flag(
+    "buffer-alignment",
+    llvm::cl::desc("Alignment in bytes of constant buffers"),
+    llvm::cl::init(16));
+
 namespace mlir {
 namespace {
 static OwningOpRef<mlir::ModuleOp> FlatBufferFileToMlirTrans(
@@ -166,6 +178,9 @@ static LogicalResult MlirToFlatBufferFileTranslateFunction(
   options.toco_flags.set_force_select_tf_ops(!emit_builtin_tflite_ops);
   options.toco_flags.set_enable_select_tf_ops(emit_select_tf_ops);
   options.toco_flags.set_allow_custom_ops(emit_custom_ops);
+  options.toco_flags.set_disable_buffer_deduplication(
+      disable_buffer_deduplication_flag);
+  options.toco_flags.set_buffer_alignment(buffer_alignment_flag);
   options.op_or_arg_name_mapper = op_or_arg_name_mapper.get();
   if (!tflite::MlirToFlatBufferTranslateFunction(module, options,
                                                  &serialized_flatbuffer))
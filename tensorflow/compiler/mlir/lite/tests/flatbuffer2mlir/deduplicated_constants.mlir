@@ -0,0 +1,17 @@
+// RUN: flatbuffer_translate -mlir-to-tflite-flatbuffer %s -o - | flatbuffer_translate --tflite-flatbuffer-to-mlir - -o - | FileCheck %s
+// Ensure constants sharing their buffer data roundtrip exactly
+
+func.func @main(%arg0: tensor<4xi32>) -> (tensor<4xi32>, tensor<2x2xi32>) {
+  // CHECK-LABEL: @main
+  // CHECK-DAG: value = dense<[1, 2, 3, 4]> : tensor<4xi32>
+  // CHECK-DAG: value = dense<[5, 6, 7, 8]> : tensor<4xi32>
+  // CHECK-DAG: value = dense<{{\[\[}}1, 2], [3, 4]]> : tensor<2x2xi32>
+  %0 = "tfl.pseudo_const"() {value = dense<[1, 2, 3, 4]> : tensor<4xi32>} : () -> tensor<4xi32>
+  %1 = "tfl.pseudo_const"() {value = dense<[5, 6, 7, 8]> : tensor<4xi32>} : () -> tensor<4xi32>
+  %2 = "tfl.pseudo_const"() {value = dense<[1, 2, 3, 4]> : tensor<4xi32>} : () -> tensor<4xi32>
+  %3 = "tfl.pseudo_const"() {value = dense<[[1, 2], [3, 4]]> : tensor<2x2xi32>} : () -> tensor<2x2xi32>
+  %4 = "tfl.add"(%arg0, %0) {fused_activation_function = "NONE"} : (tensor<4xi32>, tensor<4xi32>) -> tensor<4xi32>
+  %5 = "tfl.add"(%4, %1) {fused_activation_function = "NONE"} : (tensor<4xi32>, tensor<4xi32>) -> tensor<4xi32>
+  %6 = "tfl.add"(%5, %2) {fused_activation_function = "NONE"} : (tensor<4xi32>, tensor<4xi32>) -> tensor<4xi32>
+  func.return %6, %3 : tensor<4xi32>, tensor<2x2xi32>
+}
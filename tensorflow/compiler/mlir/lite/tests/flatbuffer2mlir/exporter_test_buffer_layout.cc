@@ -0,0 +1,115 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+using llvm::cl::opt;
+
+// RUN: flatbuffer_translate -mlir-to-tflite-flatbuffer \
+// RUN:   %p/deduplicated_constants.mlir -o - \
+// RUN:   | %p/exporter_test_buffer_layout - \
+// RUN:   | FileCheck %s
+
+// RUN: flatbuffer_translate -mlir-to-tflite-flatbuffer -buffer-alignment=64 \
+// RUN:   %p/deduplicated_constants.mlir -o - \
+// RUN:   | %p/exporter_test_buffer_layout -alignment=64 - \
+// RUN:   | FileCheck %s
+
+// RUN: flatbuffer_translate -mlir-to-tflite-flatbuffer \
+// RUN:   -disable-buffer-deduplication %p/deduplicated_constants.mlir -o - \
+// RUN:   | %p/exporter_test_buffer_layout - \
+// RUN:   | FileCheck --check-prefix=NODEDUP %s
+
+// Tests for verifying that the exporter shares the data of constants with
+// identical contents and aligns it. Prints, for each tensor with a non-empty
+// buffer, the size of its data, whether the data is aligned, and the first
+// tensor whose data it shares.
+
+// The [1, 2, 3, 4] constant is shared by the second constant with the same
+// value and by the 2x2 constant, which has the same bytes.
+// CHECK:      tensor [[A:[0-9]+]]: 16 bytes, aligned
+// CHECK-NEXT: tensor {{[0-9]+}}: 16 bytes, aligned
+// CHECK-NEXT: tensor {{[0-9]+}}: 16 bytes, aligned, shares data with tensor [[A]]
+// CHECK-NEXT: tensor {{[0-9]+}}: 16 bytes, aligned, shares data with tensor [[A]]
+// CHECK-NOT:  tensor
+
+// NODEDUP:     tensor {{[0-9]+}}: 16 bytes, aligned
+// NODEDUP-NOT: shares
+
+// NOLINTNEXTLINE
+static opt<std::string> inputFileName(llvm::cl::Positional,
+                                      llvm::cl::desc("<input file>"),
+                                      llvm::cl::init("-"));
+
+// NOLINTNEXTLINE
+static opt<int> alignment("alignment",
+                          llvm::cl::desc("Expected alignment of buffer data"),
+                          llvm::cl::init(16));
+
+namespace mlir {
+namespace {
+bool PrintBufferLayout(llvm::StringRef buffer) {
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+  if (!tflite::VerifyModelBuffer(verifier)) {
+    llvm::errs() << "Verification failed.\n";
+    return false;
+  }
+  const tflite::Model* model = tflite::GetModel(buffer.data());
+  const auto* buffers = model->buffers();
+  for (const tflite::SubGraph* subgraph : *model->subgraphs()) {
+    // Maps the offset of buffer data to the first tensor that uses it.
+    std::map<int64_t, int> tensor_by_offset;
+    for (int i = 0, e = subgraph->tensors()->size(); i < e; ++i) {
+      const auto* data = buffers->Get(subgraph->tensors()->Get(i)->buffer())
+                             ->data();
+      if (data == nullptr || data->size() == 0) continue;
+      const int64_t offset =
+          reinterpret_cast<const char*>(data->data()) - buffer.data();
+      llvm::outs() << "tensor " << i << ": " << data->size() << " bytes, "
+                   << (offset % alignment == 0 ? "aligned" : "misaligned");
+      auto inserted = tensor_by_offset.emplace(offset, i);
+      if (!inserted.second) {
+        llvm::outs() << ", shares data with tensor " << inserted.first->second;
+      }
+      llvm::outs() << "\n";
+    }
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace mlir
+
+int main(int argc, char** argv) {
+  llvm::InitLLVM y(argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+  auto file_or_err = llvm::MemoryBuffer::getFileOrSTDIN(inputFileName.c_str());
+  if (std::error_code error = file_or_err.getError()) {
+    llvm::errs() << argv[0] << ": could not open input file '" << inputFileName
+                 << "': " << error.message() << "\n";
+    return 1;
+  }
+  return mlir::PrintBufferLayout(file_or_err->get()->getBuffer()) ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+// RUN: tf-opt %s -split-input-file -verify-diagnostics -tfl-predict-delegate-partitions="delegate-name=gpu supported-ops=tfl.add,tfl.fully_connected supports-hybrid-ops=false"
+
+func.func @unsupportedOpSplitsPartitions(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+// expected-remark@-1 {{gpu is predicted to run 2 of 3 ops in 2 partitions; not delegated: tfl.exp x1}}
+  %0 = "tfl.add"(%arg0, %arg0) {fused_activation_function = "NONE"} : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  %1 = "tfl.exp"(%0) : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "tfl.add"(%1, %1) {fused_activation_function = "NONE"} : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  func.return %2 : tensor<4xf32>
+}
+
+// -----
+
+func.func @independentOpsShareAPartition(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+// expected-remark@-1 {{gpu is predicted to run 2 of 3 ops in 1 partitions; not delegated: tfl.exp x1}}
+  %0 = "tfl.add"(%arg0, %arg0) {fused_activation_function = "NONE"} : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  %1 = "tfl.exp"(%arg0) : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "tfl.add"(%0, %0) {fused_activation_function = "NONE"} : (tensor<4xf32>, tensor<4xf32>) -> tensor<4xf32>
+  func.return %2, %1 : tensor<4xf32>, tensor<4xf32>
+}
+
+// -----
+
+func.func @fullyDelegated(%arg0: tensor<1x4xf32>, %arg1: tensor<4x4xf32>) -> tensor<1x4xf32> {
+// expected-remark@-1 {{gpu is predicted to run 2 of 2 ops in 1 partitions}}
+  %cst = "tfl.no_value"() {value = unit} : () -> none
+  %0 = "tfl.fully_connected"(%arg0, %arg1, %cst) {fused_activation_function = "NONE", keep_num_dims = false, weights_format = "DEFAULT"} : (tensor<1x4xf32>, tensor<4x4xf32>, none) -> tensor<1x4xf32>
+  %1 = "tfl.add"(%0, %0) {fused_activation_function = "NONE"} : (tensor<1x4xf32>, tensor<1x4xf32>) -> tensor<1x4xf32>
+  func.return %1 : tensor<1x4xf32>
+}
+
+// -----
+
+func.func @hybridOpNotDelegated(%arg0: tensor<1x4xf32>) -> tensor<1x4xf32> {
+// expected-remark@-1 {{gpu is predicted to run 1 of 2 ops in 1 partitions; not delegated: tfl.fully_connected (hybrid) x1}}
+  %w = "tfl.pseudo_qconst"() {qtype = tensor<4x4x!quant.uniform<i8:f32, 0.1>>, value = dense<1> : tensor<4x4xi8>} : () -> tensor<4x4x!quant.uniform<i8:f32, 0.1>>
+  %cst = "tfl.no_value"() {value = unit} : () -> none
+  %0 = "tfl.fully_connected"(%arg0, %w, %cst) {fused_activation_function = "NONE", keep_num_dims = false, weights_format = "DEFAULT"} : (tensor<1x4xf32>, tensor<4x4x!quant.uniform<i8:f32, 0.1>>, none) -> tensor<1x4xf32>
+  %1 = "tfl.add"(%0, %0) {fused_activation_function = "NONE"} : (tensor<1x4xf32>, tensor<1x4xf32>) -> tensor<1x4xf32>
+  func.return %1 : tensor<1x4xf32>
+}
@@ -16,9 +16,13 @@ limitations under the License.
 #include "tensorflow/compiler/mlir/lite/tf_tfl_passes.h"
 
 #include <string>
+#include <tuple>
 
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
 #include "mlir/IR/Attributes.h"  // from @llvm-project
 #include "mlir/IR/BuiltinOps.h"  // from @llvm-project
@@ -36,6 +40,7 @@ limitations under the License.
 #include "tensorflow/compiler/mlir/tensorflow/transforms/passes.h"
 #include "tensorflow/compiler/mlir/tensorflow/transforms/tf_saved_model_passes.h"
 #include "tensorflow/compiler/mlir/tensorflow/translate/tf_mlir_translate.h"
+#include "tensorflow/core/platform/errors.h"
 
 namespace mlir {
 /// Create a pass to convert from the TFExecutor to the TF control dialect.
@@ -367,6 +372,15 @@ void AddPostVariableFreezingTFToTFLConversionPasses(
     pass_manager->addNestedPass<mlir::func::FuncOp>(
         mlir::TFL::CreateRuntimeVerifyPass());
   }
+  if (pass_config.target_delegate.hasValue()) {
+    const mlir::TFL::DelegateCapabilities& delegate =
+        pass_config.target_delegate.getValue();
+    pass_manager->addNestedPass<mlir::func::FuncOp>(
+        mlir::TFL::CreatePredictDelegatePartitionsPass(
+            delegate.name, delegate.supported_ops,
+            delegate.supports_per_channel_quantization,
+            delegate.supports_hybrid_ops));
+  }
 }
 
 void AddTFToTFLConversionPasses(llvm::StringRef saved_model_dir,
@@ -384,6 +398,65 @@ void AddTFToTFLConversionPasses(const mlir::TFL::PassConfig& pass_config,
                              pass_manager);
 }
 
+Status ParseDelegateCapabilities(
+    llvm::StringRef text, mlir::TFL::DelegateCapabilities* capabilities) {
+  llvm::SmallVector<llvm::StringRef, 8> lines;
+  text.split(lines, '\n');
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#")) continue;
+    llvm::StringRef key, value;
+    std::tie(key, value) = line.split(':');
+    if (key.size() == line.size()) {
+      return errors::InvalidArgument(
+          "Expected a `key: value` delegate capability, got ", line.str());
+    }
+    key = key.trim();
+    value = value.trim();
+    if (key == "name") {
+      capabilities->name = value.str();
+    } else if (key == "supported_ops") {
+      llvm::SmallVector<llvm::StringRef, 16> op_names;
+      value.split(op_names, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+      for (llvm::StringRef op_name : op_names)
+        capabilities->supported_ops.push_back(op_name.trim().str());
+    } else if (key == "per_channel_quantization" || key == "hybrid_ops") {
+      if (value != "true" && value != "false") {
+        return errors::InvalidArgument("Expected true or false for ",
+                                       key.str(), ", got ", value.str());
+      }
+      bool& supported = key == "hybrid_ops"
+                            ? capabilities->supports_hybrid_ops
+                            : capabilities->supports_per_channel_quantization;
+      supported = value == "true";
+    } else {
+      return errors::InvalidArgument("Unknown delegate capability: ",
+                                     key.str());
+    }
+  }
+  return OkStatus();
+}
+
+void SetTargetDelegate(const mlir::TFL::DelegateCapabilities& capabilities,
+                       mlir::TFL::PassConfig* pass_config) {
+  mlir::quant::QuantizationSpecs& quant_specs = pass_config->quant_specs;
+  if (!capabilities.supports_per_channel_quantization) {
+    quant_specs.disable_per_channel = true;
+  }
+  // Without hybrid kernels, dynamic range quantized ops would fall back to the
+  // CPU. Quantize the weights only and dequantize them at load time instead.
+  if (!capabilities.supports_hybrid_ops && quant_specs.weight_quantization &&
+      quant_specs.inference_type == tensorflow::DT_QINT8) {
+    quant_specs.enable_mlir_dynamic_range_quantizer = true;
+    quant_specs.weight_only_quantization = true;
+  }
+  // Unfold batch matmuls the delegate doesn't run into fully connected ops.
+  if (!llvm::is_contained(capabilities.supported_ops, "tfl.batch_matmul")) {
+    pass_config->unfold_batch_matmul = true;
+  }
+  pass_config->target_delegate = capabilities;
+}
+
 }  // namespace tensorflow
 
 namespace mlir {
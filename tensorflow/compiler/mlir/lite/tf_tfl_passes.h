@@ -17,10 +17,12 @@ limitations under the License.
 #define TENSORFLOW_COMPILER_MLIR_LITE_TF_TFL_PASSES_H_
 
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
 #include "mlir/IR/BuiltinOps.h"  // from @llvm-project
 #include "mlir/Pass/PassManager.h"  // from @llvm-project
 #include "tensorflow/compiler/mlir/lite/common/tfl_pass_config.h"
+#include "tensorflow/core/platform/status.h"
 #include "tensorflow/lite/toco/model_flags.pb.h"
 #include "tensorflow/lite/toco/toco_flags.pb.h"
 
@@ -65,6 +67,20 @@ void AddQuantizationPasses(const mlir::quant::QuantizationSpecs& quant_specs,
 void AddDynamicRangeQuantizationPasses(
     const mlir::quant::QuantizationSpecs& quant_specs,
     mlir::OpPassManager& pass_manager);
+
+// Parses a delegate capability description into `capabilities`. The
+// description has one `key: value` entry per line, with keys `name`,
+// `supported_ops` (comma separated TFLite op names, e.g. `tfl.add`),
+// `per_channel_quantization` and `hybrid_ops` (`true` or `false`). Empty lines
+// and lines starting with `#` are ignored.
+Status ParseDelegateCapabilities(llvm::StringRef text,
+                                 mlir::TFL::DelegateCapabilities* capabilities);
+
+// Sets `capabilities` as the target delegate of `pass_config` and adjusts the
+// legalization and quantization options so that more of the converted model
+// can be delegated.
+void SetTargetDelegate(const mlir::TFL::DelegateCapabilities& capabilities,
+                       mlir::TFL::PassConfig* pass_config);
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_COMPILER_MLIR_LITE_TF_TFL_PASSES_H_
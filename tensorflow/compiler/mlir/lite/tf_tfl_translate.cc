@@ -282,12 +282,35 @@ int main(int argc, char **argv) {
     pass_config.enable_hlo_to_tf_conversion = true;
   }
 
+  if (!delegate_capabilities_file_name.empty()) {
+    std::string error_message;
+    auto file =
+        mlir::openInputFile(delegate_capabilities_file_name, &error_message);
+    if (!file) {
+      llvm::errs() << "fail to open delegate capabilities file: "
+                   << delegate_capabilities_file_name;
+      return kTrFailure;
+    }
+    mlir::TFL::DelegateCapabilities capabilities;
+    tensorflow::Status status = tensorflow::ParseDelegateCapabilities(
+        file->getBuffer(), &capabilities);
+    if (!status.ok()) {
+      llvm::errs() << "fail to parse delegate capabilities file "
+                   << delegate_capabilities_file_name << ": "
+                   << status.error_message() << "\n";
+      return kTrFailure;
+    }
+    tensorflow::SetTargetDelegate(capabilities, &pass_config);
+  }
+
   toco::TocoFlags toco_flags;
   toco_flags.set_force_select_tf_ops(!emit_builtin_tflite_ops);
   toco_flags.set_enable_select_tf_ops(emit_select_tf_ops);
   toco_flags.set_allow_custom_ops(emit_custom_ops);
   toco_flags.set_allow_all_select_tf_ops(allow_all_select_tf_ops);
   toco_flags.set_enable_dynamic_update_slice(enable_dynamic_update_slice);
+  toco_flags.set_disable_buffer_deduplication(disable_buffer_deduplication);
+  toco_flags.set_buffer_alignment(buffer_alignment);
   // Read list of user select ops.
   llvm::SmallVector<llvm::StringRef, 2> user_ops;
   (llvm::StringRef(select_user_tf_ops))
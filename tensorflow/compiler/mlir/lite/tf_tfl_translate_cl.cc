@@ -171,3 +171,23 @@ opt<bool> preserve_assert_op(
     "preserve-assert-op",
     llvm::cl::desc("Preserve AssertOp during tfl legalization."),
     llvm::cl::init(false));
+
+// The path to a delegate capability description. If set, the conversion
+// targets the delegate and reports the predicted delegate partitioning.
+// NOLINTNEXTLINE
+opt<std::string> delegate_capabilities_file_name(
+    "delegate-capabilities", llvm::cl::desc("<delegate capabilities file>"),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+// NOLINTNEXTLINE
+opt<bool> disable_buffer_deduplication(
+    "disable-buffer-deduplication",
+    llvm::cl::desc("Don't share constant buffers with identical contents."),
+    llvm::cl::init(false));
+
+// NOLINTNEXTLINE
+opt<int> buffer_alignment(
+    "buffer-alignment",
+    llvm::cl::desc("Alignment in bytes of constant buffers. Must be a power of "
+                   "two; 64 allows aligned SIMD loads from mmapped weights."),
+    llvm::cl::init(16));
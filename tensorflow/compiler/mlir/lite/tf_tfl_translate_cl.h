@@ -46,6 +46,9 @@ extern llvm::cl::opt<bool> unfold_large_splat_constant;
 extern llvm::cl::opt<bool> guarantee_all_funcs_one_use;
 extern llvm::cl::opt<bool> enable_dynamic_update_slice;
 extern llvm::cl::opt<bool> preserve_assert_op;
+extern llvm::cl::opt<std::string> delegate_capabilities_file_name;
+extern llvm::cl::opt<bool> disable_buffer_deduplication;
+extern llvm::cl::opt<int> buffer_alignment;
 
 // Import saved model.
 extern llvm::cl::opt<bool> import_saved_model_object_graph;
@@ -212,6 +212,15 @@ std::unique_ptr<OperationPass<func::FuncOp>> CreateGetArithmeticCountPass();
 // tensors with fill op.
 std::unique_ptr<OperationPass<ModuleOp>> CreateUnfoldLargeSplatConstantPass();
 
+// Creates a pass which reports how a delegate that runs `supported_ops` would
+// partition each function.
+std::unique_ptr<OperationPass<func::FuncOp>>
+CreatePredictDelegatePartitionsPass(
+    llvm::StringRef delegate_name, llvm::ArrayRef<std::string> supported_ops,
+    bool supports_per_channel_quantization, bool supports_hybrid_ops);
+std::unique_ptr<OperationPass<func::FuncOp>>
+CreatePredictDelegatePartitionsPass();
+
 #define GEN_PASS_REGISTRATION
 #include "tensorflow/compiler/mlir/lite/transforms/passes.h.inc"
 }  // namespace TFL
@@ -0,0 +1,197 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This pass predicts how a TFLite delegate would partition a converted model,
+// so that users can tell how much of the model the delegate will run before
+// deploying it.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
+#include "mlir/Dialect/Quant/QuantTypes.h"  // from @llvm-project
+#include "mlir/IR/Operation.h"  // from @llvm-project
+#include "mlir/IR/TypeUtilities.h"  // from @llvm-project
+#include "mlir/Pass/Pass.h"  // from @llvm-project
+#include "tensorflow/compiler/mlir/lite/ir/tfl_ops.h"
+#include "tensorflow/compiler/mlir/lite/transforms/passes.h"
+
+namespace mlir {
+namespace TFL {
+namespace {
+#define GEN_PASS_CLASSES
+#include "tensorflow/compiler/mlir/lite/transforms/passes.h.inc"
+
+// Returns whether `op` becomes a node of the TFLite graph. Constants become
+// tensors and terminators become graph outputs.
+bool IsGraphNode(Operation* op) {
+  return !llvm::isa<ConstOp, QConstOp, SparseConstOp, SparseQConstOp,
+                    NoValueOp>(op) &&
+         !op->hasTrait<OpTrait::ConstantLike>() &&
+         !op->hasTrait<OpTrait::IsTerminator>();
+}
+
+bool IsQuantized(Type type) {
+  return getElementTypeOrSelf(type).isa<quant::QuantizedType>();
+}
+
+bool IsPerChannelQuantized(Type type) {
+  return getElementTypeOrSelf(type).isa<quant::UniformQuantizedPerAxisType>();
+}
+
+struct PredictDelegatePartitionsPass
+    : public PredictDelegatePartitionsPassBase<PredictDelegatePartitionsPass> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PredictDelegatePartitionsPass)
+
+  PredictDelegatePartitionsPass() = default;
+  PredictDelegatePartitionsPass(llvm::StringRef delegate_name,
+                                llvm::ArrayRef<std::string> supported_ops,
+                                bool supports_per_channel_quantization,
+                                bool supports_hybrid_ops) {
+    delegate_name_ = delegate_name.str();
+    supported_ops_ = supported_ops;
+    supports_per_channel_quantization_ = supports_per_channel_quantization;
+    supports_hybrid_ops_ = supports_hybrid_ops;
+  }
+
+  void runOnOperation() override;
+
+ private:
+  // Returns the reason `op` would not be delegated, or an empty string if it
+  // would be.
+  std::string GetUnsupportedReason(Operation* op,
+                                   const llvm::StringSet<>& supported_ops);
+};
+
+std::string PredictDelegatePartitionsPass::GetUnsupportedReason(
+    Operation* op, const llvm::StringSet<>& supported_ops) {
+  const llvm::StringRef op_name = op->getName().getStringRef();
+  if (!supported_ops.contains(op_name)) return op_name.str();
+
+  bool has_quantized_operand = false;
+  for (Value operand : op->getOperands()) {
+    if (!supports_per_channel_quantization_ &&
+        IsPerChannelQuantized(operand.getType()))
+      return (op_name + " (per-channel quantized)").str();
+    has_quantized_operand |= IsQuantized(operand.getType());
+  }
+  // Ops computing float results from quantized operands are hybrid, except for
+  // the ops converting between the two.
+  if (!supports_hybrid_ops_ && has_quantized_operand &&
+      !llvm::isa<DequantizeOp, QuantizeOp>(op)) {
+    for (Value result : op->getResults()) {
+      if (getElementTypeOrSelf(result.getType()).isa<FloatType>())
+        return (op_name + " (hybrid)").str();
+    }
+  }
+  return "";
+}
+
+void PredictDelegatePartitionsPass::runOnOperation() {
+  func::FuncOp func = getOperation();
+  if (func.isExternal()) return;
+
+  llvm::StringSet<> supported_ops;
+  for (const std::string& op_name : supported_ops_)
+    supported_ops.insert(op_name);
+
+  // Partitions the nodes like TFLite's
+  // PartitionGraphIntoIndependentNodeSubsets, which delegates use through
+  // GraphPartitionHelper. Each pass over the nodes in execution order starts
+  // a partition. The first node whose operands are all computed decides
+  // whether the partition is delegated, and every later node that is ready
+  // and of the same kind joins it. Delegated nodes on both sides of an
+  // unsupported node thus share a partition unless they depend on it.
+  struct Node {
+    Operation* op;
+    bool delegated;
+  };
+  std::vector<Node> nodes;
+  llvm::MapVector<std::string, int> unsupported;
+  for (Operation& op : func.getBody().front()) {
+    if (!IsGraphNode(&op)) continue;
+    const std::string reason = GetUnsupportedReason(&op, supported_ops);
+    if (!reason.empty()) ++unsupported[reason];
+    nodes.push_back({&op, reason.empty()});
+  }
+
+  llvm::DenseSet<Operation*> computed;
+  auto is_ready = [&](Operation* op) {
+    return llvm::all_of(op->getOperands(), [&](Value operand) {
+      Operation* producer = operand.getDefiningOp();
+      return !producer || !IsGraphNode(producer) ||
+             computed.contains(producer);
+    });
+  };
+  const int num_nodes = nodes.size();
+  int num_delegated = 0;
+  int num_partitions = 0;
+  while (computed.size() < nodes.size()) {
+    llvm::Optional<bool> partition_delegated;
+    for (const Node& node : nodes) {
+      if (computed.contains(node.op) ||
+          (partition_delegated.hasValue() &&
+           *partition_delegated != node.delegated) ||
+          !is_ready(node.op)) {
+        continue;
+      }
+      partition_delegated = node.delegated;
+      computed.insert(node.op);
+      if (node.delegated) ++num_delegated;
+    }
+    // Nodes are in execution order, so every pass assigns some.
+    if (!partition_delegated.hasValue()) break;
+    if (*partition_delegated) ++num_partitions;
+  }
+
+  std::string report;
+  llvm::raw_string_ostream os(report);
+  os << delegate_name_ << " is predicted to run " << num_delegated << " of "
+     << num_nodes << " ops in " << num_partitions << " partitions";
+  if (!unsupported.empty()) {
+    os << "; not delegated:";
+    for (const auto& op_and_count : unsupported)
+      os << " " << op_and_count.first << " x" << op_and_count.second;
+  }
+  func.emitRemark() << os.str();
+}
+
+}  // namespace
+
+std::unique_ptr<OperationPass<func::FuncOp>>
+CreatePredictDelegatePartitionsPass(llvm::StringRef delegate_name,
+                                    llvm::ArrayRef<std::string> supported_ops,
+                                    bool supports_per_channel_quantization,
+                                    bool supports_hybrid_ops) {
+  return std::make_unique<PredictDelegatePartitionsPass>(
+      delegate_name, supported_ops, supports_per_channel_quantization,
+      supports_hybrid_ops);
+}
+
+std::unique_ptr<OperationPass<func::FuncOp>>
+CreatePredictDelegatePartitionsPass() {
+  return std::make_unique<PredictDelegatePartitionsPass>();
+}
+
+}  // namespace TFL
+}  // namespace mlir
@@ -19,6 +19,7 @@ limitations under the License.
 #include <utility>
 
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Operation.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
@@ -455,6 +456,29 @@ class ExpandDimsOpClusteringPolicy
 // tf._FusedMatMul
 // -------------------------------------------------------------------------- //
 
+// Returns success if the fission pass supports the fused operations.
+static LogicalResult IsSupportedMatMulFusion(_FusedMatMulOp op) {
+  size_t n = op.fused_ops().size();
+
+  auto fusion =
+      n > 0 ? op.fused_ops()[0].dyn_cast<mlir::StringAttr>() : nullptr;
+  auto activation =
+      n > 1 ? op.fused_ops()[1].dyn_cast<mlir::StringAttr>() : nullptr;
+
+  if ((n > 0 && !fusion) || (n > 1 && !activation)) return failure();
+
+  // TODO(ezhulenev): Update fission pass to support more fusions and
+  // activations.
+
+  // We only support BiasAdd fusion ...
+  if (fusion && fusion.getValue() != "BiasAdd") return failure();
+
+  // ... with Relu activation.
+  if (activation && activation.getValue() != "Relu") return failure();
+
+  return success();
+}
+
 class FusedMatMulOpClusteringPolicy
     : public TensorflowOpClusteringPolicy<_FusedMatMulOp> {
   LogicalResult MatchAndUpdateConstraints(
@@ -466,25 +490,7 @@ class FusedMatMulOpClusteringPolicy
       return failure();
 
     // Check if we do support a set of fused operations.
-    size_t n = op.fused_ops().size();
-
-    auto fusion =
-        n > 0 ? op.fused_ops()[0].dyn_cast<mlir::StringAttr>() : nullptr;
-    auto activation =
-        n > 1 ? op.fused_ops()[1].dyn_cast<mlir::StringAttr>() : nullptr;
-
-    if ((n > 0 && !fusion) || (n > 1 && !activation)) return failure();
-
-    // TODO(ezhulenev): Update fission pass to support more fusions and
-    // activations.
-
-    // We only support BiasAdd fusion ...
-    if (fusion && fusion.getValue() != "BiasAdd") return failure();
-
-    // ... with Relu activation.
-    if (activation && activation.getValue() != "Relu") return failure();
-
-    return success();
+    return IsSupportedMatMulFusion(op);
   }
 };
 
@@ -521,6 +527,55 @@ class FillOpClusteringPolicy : public TensorflowOpClusteringPolicy<FillOp> {
 
 class MatMulOpClusteringPolicy : public OpDefaultClusteringPolicy<MatMulOp> {};
 
+// -------------------------------------------------------------------------- //
+// Small tf.MatMul and tf._FusedMatMul
+// -------------------------------------------------------------------------- //
+
+// Matmuls with larger weights are left to the Eigen contraction kernels in the
+// fallback runtime, which outperform the generated code for them.
+static constexpr int64_t kSmallMatMulMaxWeightsElements = 256 * 256;
+
+// Clusters a matmul with small static weights `b` together with the ops
+// around it, and requires the shapes of all its operands, so that the
+// compiled kernel is specialized to static shapes at runtime. JitRt caches a
+// specialized kernel for each set of operand shapes it sees.
+static LogicalResult UpdateSmallMatMulConstraints(
+    Operation* op, Value b, const ValuesConstraintSet& results,
+    ValuesConstraintSet& operands) {
+  auto b_type = b.getType().dyn_cast<mlir::RankedTensorType>();
+  if (!b_type || !b_type.hasStaticShape() ||
+      b_type.getNumElements() > kSmallMatMulMaxWeightsElements)
+    return failure();
+
+  // Value constraints can't be propagated through a matmul.
+  for (Value result : op->getResults())
+    if (results.GetConstraint(result) == ValueConstraint::kValue)
+      return failure();
+
+  for (Value operand : op->getOperands())
+    operands.Insert(operand, ValueConstraint::kShape);
+  return success();
+}
+
+class SmallMatMulOpClusteringPolicy
+    : public TensorflowOpClusteringPolicy<MatMulOp> {
+  LogicalResult MatchAndUpdateConstraints(
+      MatMulOp op, const ValuesConstraintSet& results,
+      ValuesConstraintSet& operands) const final {
+    return UpdateSmallMatMulConstraints(op, op.b(), results, operands);
+  }
+};
+
+class SmallFusedMatMulOpClusteringPolicy
+    : public TensorflowOpClusteringPolicy<_FusedMatMulOp> {
+  LogicalResult MatchAndUpdateConstraints(
+      _FusedMatMulOp op, const ValuesConstraintSet& results,
+      ValuesConstraintSet& operands) const final {
+    if (failed(IsSupportedMatMulFusion(op))) return failure();
+    return UpdateSmallMatMulConstraints(op, op.b(), results, operands);
+  }
+};
+
 // -------------------------------------------------------------------------- //
 // tf.OneHot
 // -------------------------------------------------------------------------- //
@@ -780,6 +835,13 @@ void populateTfJitRtClusteringPolicies(ClusteringPolicySet& policies,
                  SqueezeOpClusteringPolicy>();
   }
 
+  // Tier `all` clusters matmuls of any size below.
+  if (is_enabled(JitRtClusteringTier::kMatMul) &&
+      !is_enabled(JitRtClusteringTier::kAll)) {
+    policies.Add<SmallMatMulOpClusteringPolicy,  //
+                 SmallFusedMatMulOpClusteringPolicy>();
+  }
+
   if (is_enabled(JitRtClusteringTier::kAll)) {
     policies.Add<BatchMatMulV2OpClusteringPolicy,  //
                  BroadcastToOpClusteringPolicy,    //
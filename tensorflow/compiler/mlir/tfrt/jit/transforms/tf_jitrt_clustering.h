@@ -32,6 +32,7 @@ enum class JitRtClusteringTier : uint8_t {
   kTranspose = 0x2,
   kMetadata = 0x4,    // shape, reshape, ...
   kReductions = 0x8,  // all, any, min, max, mean, prod, sum
+  kMatMul = 0x10,     // matmul and fused matmul with small static weights
 
   // Only cwise operations (unary, binary, ternary).
   kTier0 = kCwise,
@@ -45,6 +46,9 @@ enum class JitRtClusteringTier : uint8_t {
   // All tier 1 operations plus reductions.
   kTier1Reductions = kTier1 | kReductions,
 
+  // All tier 1 operations plus reductions and small matmuls.
+  kTier1ReductionsMatMul = kTier1Reductions | kMatMul,
+
   // TODO(ezhulenev): Include metadata (shape, reshape) and slicing into tier 2?
   // TODO(ezhulenev): Include reductions into tier 3?
 
@@ -67,6 +67,8 @@ struct ClusteringPass : public ClusteringBase<ClusteringPass> {
         tier = JitRtClusteringTier::kTier1Metadata;
       } else if (op == "tier1reductions") {
         tier = JitRtClusteringTier::kTier1Reductions;
+      } else if (op == "tier1reductionsmatmul") {
+        tier = JitRtClusteringTier::kTier1ReductionsMatMul;
       } else if (op == "all") {
         tier = JitRtClusteringTier::kAll;
       } else {
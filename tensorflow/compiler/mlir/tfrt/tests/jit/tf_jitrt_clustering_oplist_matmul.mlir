@@ -0,0 +1,58 @@
+// RUN: tf-tfrt-opt %s                                                         \
+// RUN:   -tf-jitrt-clustering="oplist=tier1reductionsmatmul min-cluster-size=2"\
+// RUN: | FileCheck %s
+
+// CHECK-LABEL: func @cluster_small_matmul
+func.func @cluster_small_matmul(%arg0 : tensor<?x64xf32>,
+                                %arg1 : tensor<64x32xf32>,
+                                %arg2 : tensor<32xf32>) -> tensor<?x32xf32> {
+  // CHECK: %[[CLUSTER:.*]] = "tf_device.cluster"()
+  // CHECK:                 "tf.MatMul"
+  // CHECK:                 "tf.BiasAdd"
+  // CHECK:   %[[RET:.*]] = "tf.Relu"
+  // CHECK:   tf_device.return %[[RET]]
+  %0 = "tf.MatMul"(%arg0, %arg1) : (tensor<?x64xf32>, tensor<64x32xf32>)
+       -> tensor<?x32xf32>
+  %1 = "tf.BiasAdd"(%0, %arg2) : (tensor<?x32xf32>, tensor<32xf32>)
+       -> tensor<?x32xf32>
+  %2 = "tf.Relu"(%1) : (tensor<?x32xf32>) -> tensor<?x32xf32>
+  // CHECK: }) {policy = "tfrt.auto-fusion"}
+  // CHECK: return %[[CLUSTER]]
+  func.return %2 : tensor<?x32xf32>
+}
+
+// CHECK-LABEL: func @do_not_cluster_large_matmul
+func.func @do_not_cluster_large_matmul(%arg0 : tensor<?x1024xf32>,
+                                       %arg1 : tensor<1024x1024xf32>)
+    -> tensor<?x1024xf32> {
+  // CHECK: %[[MATMUL:.*]] = "tf.MatMul"
+  // CHECK: %[[CLUSTER:.*]] = "tf_device.cluster"()
+  // CHECK:                 "tf.Neg"
+  // CHECK:   %[[RET:.*]] = "tf.Relu"
+  // CHECK:   tf_device.return %[[RET]]
+  %0 = "tf.MatMul"(%arg0, %arg1) : (tensor<?x1024xf32>, tensor<1024x1024xf32>)
+       -> tensor<?x1024xf32>
+  %1 = "tf.Neg"(%0) : (tensor<?x1024xf32>) -> tensor<?x1024xf32>
+  %2 = "tf.Relu"(%1) : (tensor<?x1024xf32>) -> tensor<?x1024xf32>
+  // CHECK: }) {policy = "tfrt.auto-fusion"}
+  // CHECK: return %[[CLUSTER]]
+  func.return %2 : tensor<?x1024xf32>
+}
+
+// CHECK-LABEL: func @do_not_cluster_dynamic_weights
+func.func @do_not_cluster_dynamic_weights(%arg0 : tensor<?x?xf32>,
+                                          %arg1 : tensor<?x?xf32>)
+    -> tensor<?x?xf32> {
+  // CHECK: %[[MATMUL:.*]] = "tf.MatMul"
+  // CHECK: %[[CLUSTER:.*]] = "tf_device.cluster"()
+  // CHECK:                 "tf.Neg"
+  // CHECK:   %[[RET:.*]] = "tf.Relu"
+  // CHECK:   tf_device.return %[[RET]]
+  %0 = "tf.MatMul"(%arg0, %arg1) : (tensor<?x?xf32>, tensor<?x?xf32>)
+       -> tensor<?x?xf32>
+  %1 = "tf.Neg"(%0) : (tensor<?x?xf32>) -> tensor<?x?xf32>
+  %2 = "tf.Relu"(%1) : (tensor<?x?xf32>) -> tensor<?x?xf32>
+  // CHECK: }) {policy = "tfrt.auto-fusion"}
+  // CHECK: return %[[CLUSTER]]
+  func.return %2 : tensor<?x?xf32>
+}
@@ -14,11 +14,14 @@ limitations under the License.
 ==============================================================================*/
 #include <algorithm>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/tf2tensorrt/common/utils.h"
 #include "tensorflow/compiler/tf2tensorrt/convert/convert_nodes.h"
@@ -40,10 +43,16 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/utils.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/stream_executor.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
@@ -129,6 +138,100 @@ class AsyncHelper : public core::RefCounted {
   AsyncOpKernel::DoneCallback done_;
 };
 
+auto* profile_lookups = monitoring::Counter<2>::New(
+    "/tensorflow/core/tf_trt/profile_lookups",
+    "The number of explicit batch TRTEngineOp executions whose input shapes "
+    "matched an optimization profile of the engine (\"hit\") or matched none "
+    "and ran the native segment instead (\"miss\"), by op.",
+    "op_name", "result");
+
+auto* profile_missed_shapes = monitoring::Counter<2>::New(
+    "/tensorflow/core/tf_trt/profile_missed_shapes",
+    "The number of explicit batch TRTEngineOp executions whose input shapes "
+    "matched no optimization profile, by op and input shapes. This is the "
+    "shape distribution to create profiles for when converting again.",
+    "op_name", "input_shapes");
+
+auto* profile_rebuilds = monitoring::Counter<2>::New(
+    "/tensorflow/core/tf_trt/profile_rebuilds",
+    "The number of explicit batch TRTEngineOp engines rebuilt in the "
+    "background with optimization profiles for the input shapes that missed "
+    "the profiles of the engine in use, by op and result.",
+    "op_name", "result");
+
+// The maximum number of distinct input shapes recorded in
+// profile_missed_shapes for each op, which bounds the number of cells.
+constexpr int kMaxMissedShapesPerOp = 64;
+
+// The maximum number of missed input shapes that a rebuilt engine gets new
+// optimization profiles for, and the maximum number of rebuilds for each op.
+// Engines replaced by a rebuild stay alive as long as the engine cache, as
+// executions may still use them.
+constexpr int kMaxProposedShapesPerRebuild = 8;
+constexpr int kMaxProfileRebuilds = 4;
+
+// Returns the number of executions whose input shapes match no optimization
+// profile after which TRTEngineOp rebuilds its engine in the background with
+// profiles for those shapes, or 0 if it does not rebuild engines.
+int64 GetProfileRebuildMisses() {
+  int64 misses;
+  Status status = ReadInt64FromEnvVar("TF_TRT_PROFILE_REBUILD_MISSES",
+                                      /*default_val=*/1000, &misses);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return 0;
+  }
+  return misses;
+}
+
+// Returns the directory in which TRTEngineOp persists the engines it builds,
+// or "" if it does not persist them.
+string GetEngineCacheDir() {
+  string dir;
+  Status status = ReadStringFromEnvVar("TF_TRT_ENGINE_CACHE_DIR",
+                                       /*default_val=*/"", &dir);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return "";
+  }
+  return dir;
+}
+
+// Deserializes the engine persisted at `path` by SaveEngine. Returns nullptr if
+// there is none or if it can't be deserialized, e.g. because it is corrupt.
+TrtUniquePtrType<nvinfer1::ICudaEngine> LoadEngine(
+    const string& path, TRTBaseAllocator* allocator) {
+  string serialized_engine;
+  if (!ReadFileToString(Env::Default(), path, &serialized_engine).ok()) {
+    return nullptr;
+  }
+  TrtUniquePtrType<IRuntime> infer(nvinfer1::createInferRuntime(logger));
+  infer->setGpuAllocator(allocator);
+  // Need to initialize plugins in order to deserialize engines that contain
+  // plugins.
+  MaybeInitializeTrtPlugins(&logger);
+  return TrtUniquePtrType<nvinfer1::ICudaEngine>(infer->deserializeCudaEngine(
+      serialized_engine.data(), serialized_engine.size(), nullptr));
+}
+
+// Persists `engine` at `path`. The engine is written to a temporary file that
+// is then renamed, so that other processes sharing the directory never load a
+// partially written engine.
+Status SaveEngine(const string& path, nvinfer1::ICudaEngine* engine) {
+  TrtUniquePtrType<nvinfer1::IHostMemory> engine_data(engine->serialize());
+  if (!engine_data) {
+    return errors::Internal("Failed to serialize the TensorRT engine.");
+  }
+  Env* env = Env::Default();
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(string(io::Dirname(path))));
+  const string tmp_path = StrCat(path, ".tmp.", random::New64());
+  TF_RETURN_IF_ERROR(WriteStringToFile(
+      env, tmp_path,
+      StringPiece(static_cast<const char*>(engine_data->data()),
+                  engine_data->size())));
+  return env->RenameFile(tmp_path, path);
+}
+
 }  // end anonymous namespace
 
 //  This OP can construct TRTEngine on the fly and if construction of engine
@@ -137,6 +240,8 @@ class TRTEngineOp : public AsyncOpKernel {
  public:
   explicit TRTEngineOp(OpKernelConstruction* context);
 
+  ~TRTEngineOp() override;
+
   void ComputeAsync(OpKernelContext* context,
                     AsyncOpKernel::DoneCallback done) override;
 
@@ -193,6 +298,36 @@ class TRTEngineOp : public AsyncOpKernel {
       bool use_calibration, TRTInt8Calibrator* calibrator,
       TRTEngineCacheResource* cache_resource, OpKernelContext* ctx);
 
+  // Returns the file in which the engine built for `conversion_input_shapes`
+  // is persisted, or "" if engines are not persisted. The file name is a
+  // fingerprint of everything the engine depends on: the segment, the
+  // conversion parameters and shapes, the optimization profiles, the TensorRT
+  // version and the GPU.
+  string GetEngineCachePath(
+      const std::vector<PartialTensorShape>& conversion_input_shapes,
+      int batch_size, TRTEngineCacheResource* cache_resource,
+      OpKernelContext* ctx);
+
+  // Records in the profile lookup metrics whether `input_concrete_shapes`
+  // matched an optimization profile, i.e. whether `profile_id` is not -1.
+  void RecordProfileLookup(
+      const std::vector<TensorShape>& input_concrete_shapes, int profile_id)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(engine_mutex_);
+
+  // Starts rebuilding the engine in the background with optimization profiles
+  // for the most frequently missed input shapes, once enough executions missed
+  // the profiles of the engine in use.
+  void MaybeRebuildEngineWithProposedProfiles(
+      int batch_size, OpKernelContext* ctx, TRTEngineCacheResource* cache_res)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(engine_mutex_);
+
+  // Builds an engine with `profiles` and replaces the engine in the cache and
+  // its profiles with it. Runs on profile_rebuild_thread_ and releases a
+  // reference on `cache_res`.
+  void RebuildEngine(int batch_size, const string& device_name, int gpu_id,
+                     TRTEngineCacheResource* cache_res,
+                     std::shared_ptr<TrtShapeOptimizationProfile> profiles);
+
   // Verify that the input shapes are consistent and can be handled by this op.
   Status VerifyInputShapes(const std::vector<TensorShape>& shapes);
 
@@ -243,6 +378,16 @@ class TRTEngineOp : public AsyncOpKernel {
 
   int64 workspace_size_;
   mutex engine_mutex_;
+  // The distinct input shapes recorded in profile_missed_shapes, and how many
+  // executions missed with them since the last rebuild.
+  absl::flat_hash_map<string, std::pair<std::vector<TensorShape>, int64_t>>
+      missed_shapes_ TF_GUARDED_BY(engine_mutex_);
+  int64 misses_since_rebuild_ TF_GUARDED_BY(engine_mutex_) = 0;
+  int num_profile_rebuilds_ TF_GUARDED_BY(engine_mutex_) = 0;
+  bool rebuilding_engine_ TF_GUARDED_BY(engine_mutex_) = false;
+  std::unique_ptr<Thread> profile_rebuild_thread_ TF_GUARDED_BY(engine_mutex_);
+  // See GetProfileRebuildMisses.
+  int64 profile_rebuild_misses_;
   FunctionLibraryRuntime::Handle native_execution_func_handle_;
 
   // The finalized calibrator for inference.
@@ -505,6 +650,17 @@ TRTEngineOp::TRTEngineOp(OpKernelConstruction* context)
       [](PartialTensorShape shape) { return !shape.IsFullyDefined(); });
   VLOG(2) << "TRTEngineOp has_dynamic_shape_input_: "
           << has_dynamic_shape_input_;
+  profile_rebuild_misses_ = GetProfileRebuildMisses();
+}
+
+TRTEngineOp::~TRTEngineOp() {
+  std::unique_ptr<Thread> profile_rebuild_thread;
+  {
+    mutex_lock lock(engine_mutex_);
+    profile_rebuild_thread = std::move(profile_rebuild_thread_);
+  }
+  // Waits for a rebuild in progress, which uses this op.
+  profile_rebuild_thread.reset();
 }
 
 // Copies input tensor ctx->input(i) (which is in device memory) to the host,
@@ -811,14 +967,18 @@ void TRTEngineOp::ComputeAsync(OpKernelContext* ctx,
       VLOG(1) << "Native segment is used during collecting shapes for profiles";
       ExecuteNativeSegment(ctx, async_helper);
       return;
-    } else if (cache_res->profiles_.GetNumProfiles() == 0 && !static_engine_) {
-      // Add current shape if we did not collect any shapes so far.
-      if (!cache_res->profiles_.HasShape()) {
-        cache_res->profiles_.AddShape(input_concrete_shapes);
+    } else if (!static_engine_) {
+      // The profiles can be replaced by an engine rebuild.
+      mutex_lock lock(engine_mutex_);
+      if (cache_res->profiles_.GetNumProfiles() == 0) {
+        // Add current shape if we did not collect any shapes so far.
+        if (!cache_res->profiles_.HasShape()) {
+          cache_res->profiles_.AddShape(input_concrete_shapes);
+        }
+        // Create profiles out of collected shapes during profile generation.
+        cache_res->profiles_.InitProfiles(input_partial_shapes_,
+                                          profile_strategy_);
       }
-      // Create profiles out of collected shapes during profile generation.
-      cache_res->profiles_.InitProfiles(input_partial_shapes_,
-                                        profile_strategy_);
     }
   }
 
@@ -1016,6 +1176,27 @@ StatusOr<TrtUniquePtrType<nvinfer1::ICudaEngine>> TRTEngineOp::BuildEngine(
                                             input_concrete_shapes.end())
           : input_partial_shapes_;
 
+  // Engines built with a calibrator are not persisted, as their calibration
+  // table would have to be part of the key.
+  const string cache_path =
+      calibrator == nullptr
+          ? GetEngineCachePath(conversion_input_shapes, batch_size,
+                               cache_resource, ctx)
+          : "";
+  if (!cache_path.empty()) {
+    TrtUniquePtrType<nvinfer1::ICudaEngine> engine =
+        LoadEngine(cache_path, cache_resource->allocator_.get());
+    if (engine) {
+      if (!use_implicit_batch_) {
+        TF_RETURN_IF_ERROR(cache_resource->profiles_.RestoreProfiles(
+            engine.get(), ctx->num_inputs()));
+      }
+      VLOG(1) << "Loaded the TensorRT engine for " << name() << " from "
+              << cache_path;
+      return engine;
+    }
+  }
+
   VLOG(1) << "Building a new TensorRT engine for " << name()
           << " with input shapes: " << DebugString(conversion_input_shapes);
 
@@ -1043,9 +1224,55 @@ StatusOr<TrtUniquePtrType<nvinfer1::ICudaEngine>> TRTEngineOp::BuildEngine(
                                    absl::make_unique<EngineContext>());
     return status;
   }
+  if (!cache_path.empty()) {
+    status = SaveEngine(cache_path, engine.get());
+    if (!status.ok()) {
+      LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Failed to persist the engine for "
+                                        << name() << " at " << cache_path
+                                        << ". Reason: " << status;
+    }
+  }
   return engine;
 }
 
+string TRTEngineOp::GetEngineCachePath(
+    const std::vector<PartialTensorShape>& conversion_input_shapes,
+    int batch_size, TRTEngineCacheResource* cache_resource,
+    OpKernelContext* ctx) {
+  const string dir = GetEngineCacheDir();
+  if (dir.empty()) return "";
+  string serialized_segment;
+  if (segment_graph_def_.node().empty() ||
+      !SerializeToStringDeterministic(segment_graph_def_,
+                                      &serialized_segment)) {
+    return "";
+  }
+  const auto* device_info = ctx->device()->tensorflow_accelerator_device_info();
+  cudaDeviceProp device_properties;
+  if (device_info == nullptr ||
+      cudaGetDeviceProperties(&device_properties, device_info->gpu_id) !=
+          cudaSuccess) {
+    return "";
+  }
+  string key = StrCat(
+      "segment: ", Fingerprint64(serialized_segment),
+      ", tensorrt: ", absl::StrJoin(GetLinkedTensorRTVersion(), "."), "/",
+      absl::StrJoin(GetLoadedTensorRTVersion(), "."),
+      ", gpu: ", device_properties.name, " ", device_properties.major, ".",
+      device_properties.minor,
+      ", precision: ", static_cast<int>(precision_mode_),
+      ", explicit precision: ", use_explicit_precision_ ? 1 : 0,
+      ", implicit batch: ", use_implicit_batch_ ? 1 : 0,
+      ", batch size: ", batch_size, ", workspace: ", workspace_size_,
+      ", input shapes: ", DebugString(conversion_input_shapes));
+  if (!use_implicit_batch_) {
+    StrAppend(&key, ", ", cache_resource->profiles_.DebugString());
+  }
+  return io::JoinPath(
+      dir, StrCat("trt_engine_",
+                  absl::Hex(Fingerprint64(key), absl::kZeroPad16), ".plan"));
+}
+
 StatusOr<std::pair<EngineContext*, int>> TRTEngineOp::GetEngine(
     const std::vector<TensorShape>& input_concrete_shapes, OpKernelContext* ctx,
     TRTEngineCacheResource* cache_res) {
@@ -1073,9 +1300,11 @@ StatusOr<std::pair<EngineContext*, int>> TRTEngineOp::GetEngine(
       if (!use_implicit_batch_ ||
           AreShapesCompatible(input_concrete_shapes, cache.begin()->first)) {
         int profile_id = 0;
-        if (!use_implicit_batch_)
+        if (!use_implicit_batch_) {
           profile_id =
               cache_res->profiles_.GetProfileNumber(input_concrete_shapes);
+          RecordProfileLookup(input_concrete_shapes, profile_id);
+        }
         if (profile_id != -1) {
           return std::pair<EngineContext*, int>(cache.begin()->second.get(),
                                                 profile_id);
@@ -1107,6 +1336,7 @@ StatusOr<std::pair<EngineContext*, int>> TRTEngineOp::GetEngine(
               << ". Cache size: " << cache.size();
       // Query which profile of the new engine matches the actual input.
       profile_id = cache_res->profiles_.GetProfileNumber(input_concrete_shapes);
+      RecordProfileLookup(input_concrete_shapes, profile_id);
       if (profile_id == -1) {
         return std::pair<EngineContext*, int>(&empty_context, 0);
       }
@@ -1169,9 +1399,12 @@ StatusOr<std::pair<EngineContext*, int>> TRTEngineOp::GetEngine(
   int profile_id = -1;
   if (!use_implicit_batch_) {
     profile_id = cache_res->profiles_.GetProfileNumber(input_concrete_shapes);
+    RecordProfileLookup(input_concrete_shapes, profile_id);
     // Since all profiles are already created at this point, finding no
-    // compatible profiles results in falling back to native TF.
+    // compatible profiles results in falling back to native TF, until a
+    // rebuilt engine has a profile for these shapes.
     if (profile_id == -1) {
+      MaybeRebuildEngineWithProposedProfiles(batch_size, ctx, cache_res);
       return std::pair<EngineContext*, int>(&empty_context, 0);
     }
   }
@@ -1223,6 +1456,137 @@ StatusOr<std::pair<EngineContext*, int>> TRTEngineOp::GetEngine(
                                         use_implicit_batch_ ? 0 : profile_id);
 }
 
+void TRTEngineOp::RecordProfileLookup(
+    const std::vector<TensorShape>& input_concrete_shapes, int profile_id) {
+  if (profile_id != -1) {
+    profile_lookups->GetCell(name(), "hit")->IncrementBy(1);
+    return;
+  }
+  profile_lookups->GetCell(name(), "miss")->IncrementBy(1);
+  ++misses_since_rebuild_;
+  string shapes = TensorShapeUtils::ShapeListString(input_concrete_shapes);
+  auto it = missed_shapes_.find(shapes);
+  if (it == missed_shapes_.end()) {
+    if (missed_shapes_.size() >= kMaxMissedShapesPerOp) return;
+    it = missed_shapes_
+             .emplace(shapes, std::make_pair(input_concrete_shapes, 0))
+             .first;
+  }
+  ++it->second.second;
+  profile_missed_shapes->GetCell(name(), shapes)->IncrementBy(1);
+}
+
+void TRTEngineOp::MaybeRebuildEngineWithProposedProfiles(
+    int batch_size, OpKernelContext* ctx, TRTEngineCacheResource* cache_res) {
+  if (profile_rebuild_misses_ <= 0 ||
+      misses_since_rebuild_ < profile_rebuild_misses_ || rebuilding_engine_ ||
+      num_profile_rebuilds_ >= kMaxProfileRebuilds) {
+    return;
+  }
+  // Only engines built at runtime from the collected shapes are rebuilt. The
+  // calibrator is not reused, and the shape values that go with the missed
+  // shapes of shape tensors are not known.
+  if (static_engine_ || !allow_build_at_runtime_ ||
+      (precision_mode_ == TrtPrecisionMode::INT8 && use_calibration_) ||
+      segment_graph_def_.node().empty() || cache_res->cache_.size() != 1 ||
+      !cache_res->cache_.begin()->second->GetCudaEngine() ||
+      cache_res->profiles_.HasShapeTensor()) {
+    return;
+  }
+  const auto* device_info = ctx->device()->tensorflow_accelerator_device_info();
+  if (device_info == nullptr || device_info->gpu_id < 0) return;
+
+  std::vector<std::pair<std::vector<TensorShape>, int64_t>> shape_counts;
+  shape_counts.reserve(missed_shapes_.size());
+  for (auto& entry : missed_shapes_) {
+    shape_counts.push_back(entry.second);
+    entry.second.second = 0;
+  }
+  misses_since_rebuild_ = 0;
+  ++num_profile_rebuilds_;
+  auto profiles =
+      std::make_shared<TrtShapeOptimizationProfile>(cache_res->profiles_);
+  Status status = profiles->InitProfilesWithProposedShapes(
+      ProposeProfileShapes(std::move(shape_counts),
+                           kMaxProposedShapesPerRebuild),
+      input_partial_shapes_);
+  if (!status.ok()) {
+    VLOG(1) << "Not rebuilding the engine of " << name() << ": " << status;
+    return;
+  }
+
+  rebuilding_engine_ = true;
+  // The previous rebuild has finished, this only joins its thread.
+  profile_rebuild_thread_.reset();
+  cache_res->Ref();
+  profile_rebuild_thread_.reset(Env::Default()->StartThread(
+      ThreadOptions(), "TF_TRT_profile_rebuild",
+      [this, batch_size, device_name = ctx->device()->name(),
+       gpu_id = device_info->gpu_id, cache_res, profiles]() {
+        RebuildEngine(batch_size, device_name, gpu_id, cache_res, profiles);
+      }));
+}
+
+void TRTEngineOp::RebuildEngine(
+    int batch_size, const string& device_name, int gpu_id,
+    TRTEngineCacheResource* cache_res,
+    std::shared_ptr<TrtShapeOptimizationProfile> profiles) {
+  core::ScopedUnref unref_cache_res(cache_res);
+  VLOG(1) << "Rebuilding the TensorRT engine for " << name()
+          << " with profiles " << profiles->DebugString();
+  Status status = [&]() -> Status {
+    if (cudaSetDevice(gpu_id) != cudaSuccess) {
+      return errors::Internal("Couldn't set cuda device to ", gpu_id);
+    }
+    std::unordered_map<string, tensorflow::DeviceProperties> device_map;
+    DeviceNameUtils::ParsedName full_parsed_name;
+    DeviceNameUtils::ParseFullName(device_name, &full_parsed_name);
+    device_map.emplace(device_name, grappler::GetDeviceInfo(full_parsed_name));
+    tensorflow::grappler::VirtualCluster cluster(device_map);
+
+    // There is no OpKernelContext to convert segments that read variables
+    // with, those fail to convert and keep the engine in use.
+    TrtUniquePtrType<nvinfer1::ICudaEngine> engine;
+    TF_RETURN_IF_ERROR(convert::ConvertGraphDefToEngine(
+        segment_graph_def_, /*ctx=*/nullptr, precision_mode_, batch_size,
+        workspace_size_, input_partial_shapes_, &logger,
+        cache_res->allocator_.get(), /*calibrator=*/nullptr, &engine,
+        /*use_calibration=*/false, use_implicit_batch_,
+        /*convert_successfully=*/nullptr, profiles.get(), name(),
+        use_explicit_precision_, &cluster));
+    std::vector<ExecutionContext> exec_contexts;
+    TF_RETURN_IF_ERROR(
+        profiles->CreateExecutionContexts(engine.get(), &exec_contexts));
+    auto engine_context = absl::make_unique<EngineContext>(
+        std::move(engine), std::move(exec_contexts));
+
+    mutex_lock lock(engine_mutex_);
+    if (cache_res->cache_.size() != 1) {
+      return errors::Aborted("The engine cache changed during the rebuild.");
+    }
+    // Executions that looked up the previous engine and profile id before the
+    // swap still use them.
+    std::unique_ptr<EngineContext>& cached = cache_res->cache_.begin()->second;
+    cache_res->retired_engines_.push_back(std::move(cached));
+    cached = std::move(engine_context);
+    cache_res->profiles_.SwapProfiles(profiles.get());
+    return Status::OK();
+  }();
+
+  mutex_lock lock(engine_mutex_);
+  rebuilding_engine_ = false;
+  profile_rebuilds->GetCell(name(), status.ok() ? "success" : "failure")
+      ->IncrementBy(1);
+  if (status.ok()) {
+    VLOG(1) << "Replaced the TensorRT engine of " << name()
+            << " with the rebuilt engine.";
+  } else {
+    LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Rebuilding the engine of " << name()
+                                      << " failed, keeping the engine in use. "
+                                      << "Reason: " << status;
+  }
+}
+
 // TODO(hinsu): Move this allocation to CalibrationContext constructor, if
 // possible.
 Status TRTEngineOp::AllocateCalibrationResources(
@@ -21,6 +21,7 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/container/inlined_vector.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
@@ -47,6 +48,9 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/public/version.h"
@@ -280,6 +284,39 @@ TEST_F(TRTEngineOpTestBase, AllowBuildAtRuntime) {
   EXPECT_EQ(ectx->GetCudaEngine(), nullptr);
 }
 
+TEST_F(TRTEngineOpTestBase, PersistsEngines) {
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "PersistsEngines", "trt_engine_cache");
+  setenv("TF_TRT_ENGINE_CACHE_DIR", cache_dir.c_str(), /*overwrite=*/1);
+  TRTEngineOpTestBase::AddSimpleTrtOp(DT_FLOAT);
+  TRTEngineOpTestBase::AddSimpleInput<float>(TensorShape({2, 2}));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+
+  // The built engine is written to the cache directory.
+  std::vector<string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &files));
+  ASSERT_EQ(1, files.size());
+  EXPECT_TRUE(absl::StartsWith(files[0], "trt_engine_"));
+
+  // After the engine cache resource is gone, the engine is loaded from the
+  // directory rather than built and written again.
+  TF_ASSERT_OK(device_->resource_manager()->Cleanup(
+      std::string(kTfTrtContainerName)));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  TRTEngineCacheResource* cache_resource = nullptr;
+  TF_ASSERT_OK(device_->resource_manager()->Lookup(
+      std::string(kTfTrtContainerName), std::string(kOpName), &cache_resource));
+  core::ScopedUnref sc(cache_resource);
+  auto cache = &cache_resource->cache_;
+  EXPECT_EQ(1, cache->size());
+  ASSERT_EQ(1, cache->count({TensorShape({2, 2})}));
+  EXPECT_NE(nullptr, cache->at({TensorShape({2, 2})})->GetCudaEngine());
+  files.clear();
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &files));
+  EXPECT_EQ(1, files.size());
+  unsetenv("TF_TRT_ENGINE_CACHE_DIR");
+}
+
 TEST_P(TRTEngineOpTestWithParam, ExplicitBatch) {
   // Test inference in explicit batch mode with static input shapes. Static
   // shapes in this context means that the TensorRT knows all the input shapes
@@ -313,6 +350,10 @@ TEST_P(TRTEngineOpTestWithParam, DynamicShapes) {
   // unknown during engine creation time. When we create the network, the
   // unknow shapes are repsesented as -1. Before we run inference, these shapes
   // have to be specified by calling setBindingDimensions.
+  monitoring::testing::CellReader<int64_t> profile_lookups(
+      "/tensorflow/core/tf_trt/profile_lookups");
+  monitoring::testing::CellReader<int64_t> profile_missed_shapes(
+      "/tensorflow/core/tf_trt/profile_missed_shapes");
   TRTEngineOpTestBase::AddSimpleTrtOp(DT_FLOAT, /*max_cached_engines_count=*/1,
                                       /*shape=*/PartialTensorShape({-1, -1}),
                                       /*use_implicit_batch=*/false,
@@ -335,6 +376,8 @@ TEST_P(TRTEngineOpTestWithParam, DynamicShapes) {
   ASSERT_EQ(1, cache->count({input_shape}));
   EngineContext* ectx = cache->at({input_shape}).get();
   EXPECT_NE(ectx->GetCudaEngine(), nullptr);
+  EXPECT_EQ(1, profile_lookups.Delta(std::string(kOpName), "hit"));
+  EXPECT_EQ(0, profile_lookups.Delta(std::string(kOpName), "miss"));
 
   // Execute the op with an incompatible shape.
   ResetInputs();
@@ -344,6 +387,57 @@ TEST_P(TRTEngineOpTestWithParam, DynamicShapes) {
   // We should still have a single engine that is not compatible with the input.
   EXPECT_EQ(1, cache->size());
   EXPECT_EQ(0, cache->count({TensorShape({1, 37})}));
+  EXPECT_EQ(0, profile_lookups.Delta(std::string(kOpName), "hit"));
+  EXPECT_EQ(1, profile_lookups.Delta(std::string(kOpName), "miss"));
+  EXPECT_EQ(1, profile_missed_shapes.Delta(std::string(kOpName), "[[1,37]]"));
+}
+
+TEST_F(TRTEngineOpTestBase, RebuildsEngineForMissedShapes) {
+  setenv("TF_TRT_PROFILE_REBUILD_MISSES", "1", /*overwrite=*/1);
+  monitoring::testing::CellReader<int64_t> profile_lookups(
+      "/tensorflow/core/tf_trt/profile_lookups");
+  monitoring::testing::CellReader<int64_t> profile_rebuilds(
+      "/tensorflow/core/tf_trt/profile_rebuilds");
+  TRTEngineOpTestBase::AddSimpleTrtOp(DT_FLOAT, /*max_cached_engines_count=*/1,
+                                      /*shape=*/PartialTensorShape({-1, -1}),
+                                      /*use_implicit_batch=*/false,
+                                      /*allow_build_at_runtime=*/true,
+                                      /*static_engine=*/false);
+  unsetenv("TF_TRT_PROFILE_REBUILD_MISSES");
+
+  TRTEngineOpTestBase::AddSimpleInput<float>(TensorShape({1, 2}));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  TRTEngineCacheResource* cache_resource = nullptr;
+  TF_ASSERT_OK(device_->resource_manager()->Lookup(
+      std::string(kTfTrtContainerName), std::string(kOpName), &cache_resource));
+  core::ScopedUnref sc(cache_resource);
+  EngineContext* ectx = cache_resource->cache_.begin()->second.get();
+  EXPECT_EQ(1, profile_lookups.Delta(std::string(kOpName), "hit"));
+
+  // The miss falls back to the native segment and starts a rebuild.
+  ResetInputs();
+  TRTEngineOpTestBase::AddSimpleInput<float>(TensorShape({1, 37}));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  EXPECT_EQ(1, profile_lookups.Delta(std::string(kOpName), "miss"));
+  for (int i = 0; i < 600 && profile_rebuilds.Read(std::string(kOpName),
+                                                   "success") == 0;
+       ++i) {
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+  }
+  ASSERT_EQ(1, profile_rebuilds.Read(std::string(kOpName), "success"));
+
+  // The rebuilt engine replaces the previous one, which is kept for the
+  // executions that may still use it.
+  EXPECT_EQ(1, cache_resource->cache_.size());
+  EXPECT_NE(ectx, cache_resource->cache_.begin()->second.get());
+  ASSERT_EQ(1, cache_resource->retired_engines_.size());
+  EXPECT_EQ(ectx, cache_resource->retired_engines_[0].get());
+
+  ResetInputs();
+  TRTEngineOpTestBase::AddSimpleInput<float>(TensorShape({1, 37}));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  EXPECT_EQ(1, profile_lookups.Delta(std::string(kOpName), "hit"));
+  EXPECT_EQ(0, profile_lookups.Delta(std::string(kOpName), "miss"));
 }
 
 template <typename T>
@@ -17,8 +17,10 @@ limitations under the License.
 #define TENSORFLOW_COMPILER_TF2TENSORRT_UTILS_TRT_LRU_CACHE_H_
 
 #include <list>
+#include <memory>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/compiler/tf2tensorrt/convert/utils.h"
 #include "tensorflow/compiler/tf2tensorrt/utils/trt_allocator.h"
@@ -244,6 +246,11 @@ class TRTEngineCacheResource : public ResourceBase {
            VectorTensorShapeHasher>
       cache_;
 
+  // Engines that TRTEngineOp replaced in cache_ by engines rebuilt with more
+  // optimization profiles. They are kept, as executions that looked them up
+  // before the replacement may still use them.
+  std::vector<std::unique_ptr<EngineContext>> retired_engines_;
+
   // TODO(hinsu): Use different calibration context for the available shapes and
   // attach it to each item of the cache.
   std::unique_ptr<CalibrationContext> calib_ctx_;
@@ -17,8 +17,10 @@ limitations under the License.
 
 #include <algorithm>
 #include <functional>
+#include <utility>
 
 #include "absl/algorithm/container.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/tf2tensorrt/common/utils.h"
 #include "tensorflow/compiler/tf2tensorrt/convert/utils.h"
 #include "tensorflow/core/platform/stream_executor.h"
@@ -628,10 +630,66 @@ Status TrtShapeOptimizationProfile::RestoreProfiles(
   return Status::OK();
 }
 
+Status TrtShapeOptimizationProfile::InitProfilesWithProposedShapes(
+    const std::vector<std::vector<TensorShape>>& proposed_shapes,
+    const std::vector<PartialTensorShape>& input_partial_shapes) {
+  if (HasShapeTensor()) {
+    return errors::Unimplemented(
+        "Cannot propose profiles for a network with shape tensors.");
+  }
+  if (!HasShape()) {
+    return errors::FailedPrecondition(
+        "Cannot propose profiles without collected shapes.");
+  }
+  for (const std::vector<TensorShape>& shapes : proposed_shapes) {
+    input_shapes_.push_back(shapes);
+    // There are no shape tensors, the values only keep the layout that
+    // InitProfiles expects.
+    input_shape_values_.push_back(input_shape_values_.front());
+  }
+  clear();
+  InitProfiles(input_partial_shapes, strategy_);
+  return Status::OK();
+}
+
+void TrtShapeOptimizationProfile::SwapProfiles(
+    TrtShapeOptimizationProfile* other) {
+  input_shapes_.swap(other->input_shapes_);
+  input_shape_values_.swap(other->input_shape_values_);
+  profiles_.swap(other->profiles_);
+  std::swap(strategy_, other->strategy_);
+}
+
 int TrtShapeOptimizationProfile::GetNumProfiles() const {
   return profiles_.size();
 }
 
+string TrtShapeOptimizationProfile::DebugString() const {
+  string result = absl::StrCat("strategy: ", ProfileStrategyToName(strategy_),
+                               ", profiles: ");
+  for (const OptimizationProfileConfig& profile : profiles_) {
+    absl::StrAppend(&result, profile.DebugString());
+  }
+  return result;
+}
+
+std::vector<std::vector<TensorShape>> ProposeProfileShapes(
+    std::vector<std::pair<std::vector<TensorShape>, int64_t>> shape_counts,
+    int max_shapes) {
+  absl::c_stable_sort(shape_counts, [](const auto& a, const auto& b) {
+    return a.second > b.second;
+  });
+  std::vector<std::vector<TensorShape>> proposed_shapes;
+  for (auto& shapes_and_count : shape_counts) {
+    if (proposed_shapes.size() >= static_cast<size_t>(max_shapes) ||
+        shapes_and_count.second <= 0) {
+      break;
+    }
+    proposed_shapes.push_back(std::move(shapes_and_count.first));
+  }
+  return proposed_shapes;
+}
+
 }  // namespace tensorrt
 }  // namespace tensorflow
 #endif  // GOOGLE_CUDA && GOOGLE_TENSORRT
@@ -19,6 +19,7 @@ limitations under the License.
 #include <list>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/compiler/tf2tensorrt/common/datavec.h"
@@ -226,9 +227,27 @@ class TrtShapeOptimizationProfile {
 
   void InitCalibProfile(const std::vector<TensorShape>& shapes);
 
+  // Recreates the optimization profiles from the collected shapes and
+  // `proposed_shapes`, e.g. the input shapes that matched none of the profiles
+  // of an engine in use, with the strategy of the current profiles. Networks
+  // with shape tensors are not supported, as the shape values that go with the
+  // proposed shapes are not known.
+  Status InitProfilesWithProposedShapes(
+      const std::vector<std::vector<TensorShape>>& proposed_shapes,
+      const std::vector<PartialTensorShape>& input_partial_shapes);
+
+  // Exchanges the collected shapes and the profiles created from them with
+  // `other`. What SetInputShapeBinding reads is left alone, so this can run
+  // while engines execute, under the lock that guards GetProfileNumber.
+  void SwapProfiles(TrtShapeOptimizationProfile* other);
+
   // Returns number of created profiles.
   int GetNumProfiles() const;
 
+  // Returns a description of the created profiles and of the strategy they
+  // were created with.
+  string DebugString() const;
+
   bool HasShape() const { return !input_shapes_.empty(); }
   bool NeedProfiles() const { return need_profiles_; }
 
@@ -305,6 +324,12 @@ class TrtShapeOptimizationProfile {
       const std::vector<std::vector<nvinfer1::Dims>>& collected_shapes);
 };
 
+// Returns up to `max_shapes` of the input shapes in `shape_counts`, the most
+// frequently seen first. Shapes that were never seen are not proposed.
+std::vector<std::vector<TensorShape>> ProposeProfileShapes(
+    std::vector<std::pair<std::vector<TensorShape>, int64_t>> shape_counts,
+    int max_shapes);
+
 }  // namespace tensorrt
 }  // namespace tensorflow
 
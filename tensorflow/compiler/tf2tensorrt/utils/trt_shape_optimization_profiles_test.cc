@@ -245,6 +245,58 @@ TEST_P(TrtShapeOptimizationProfileTest, Dynamic) {
   CheckProfile(unseen_shapes, &profile, has_prof, false);
 }
 
+TEST_P(TrtShapeOptimizationProfileTest, ProposedShapes) {
+  nvinfer1::Dims3 dims(-1, -1, 10);
+  DefineNetwork(network_.get(), dims);
+
+  TrtShapeOptimizationProfile profile;
+  std::vector<std::vector<nvinfer1::Dims3>> input_profiles{
+      {nvinfer1::Dims3(2, 2, 10), nvinfer1::Dims3(2, 2, 10)},
+      {nvinfer1::Dims3(3, 3, 10), nvinfer1::Dims3(3, 3, 10)},
+  };
+  for (auto dim_vec : input_profiles) {
+    profile.AddShape(DimVecToShapeVec(dim_vec, true));
+  }
+  std::vector<PartialTensorShape> input_partial_shapes;
+  TF_CHECK_OK(GetNetworkInputShapes(network_.get(), &input_partial_shapes));
+  profile.InitProfiles(input_partial_shapes, strategy_);
+  TF_CHECK_OK(profile.ConfigureBuilder(builder_.get(), builder_config_.get(),
+                                       network_.get()));
+  profile.SetShapeTensorMask(network_.get());
+  const int n_profiles = profile.GetNumProfiles();
+
+  std::vector<nvinfer1::Dims3> missed_shapes{nvinfer1::Dims3(9, 9, 10),
+                                             nvinfer1::Dims3(9, 9, 10)};
+  TrtShapeOptimizationProfile proposed = profile;
+  TF_CHECK_OK(proposed.InitProfilesWithProposedShapes(
+      {DimVecToShapeVec(missed_shapes, true)}, input_partial_shapes));
+  profile.SwapProfiles(&proposed);
+
+  // The proposed shape gets a profile, and the collected shapes keep theirs.
+  EXPECT_GE(profile.GetProfileNumber(DimVecToShapeVec(missed_shapes)), 0);
+  for (auto dim_vec : input_profiles) {
+    EXPECT_GE(profile.GetProfileNumber(DimVecToShapeVec(dim_vec)), 0);
+  }
+  if (strategy_ == ProfileStrategy::kOptimal) {
+    EXPECT_EQ(profile.GetNumProfiles(), n_profiles + 1);
+  }
+  // The previous profiles are swapped out.
+  EXPECT_EQ(proposed.GetNumProfiles(), n_profiles);
+}
+
+TEST(ProposeProfileShapesTest, ProposesMostFrequentShapes) {
+  const std::vector<TensorShape> small{TensorShape({1, 8})};
+  const std::vector<TensorShape> medium{TensorShape({4, 8})};
+  const std::vector<TensorShape> large{TensorShape({16, 8})};
+  EXPECT_EQ(ProposeProfileShapes({{small, 2}, {medium, 5}, {large, 3}},
+                                 /*max_shapes=*/2),
+            (std::vector<std::vector<TensorShape>>{medium, large}));
+  EXPECT_EQ(ProposeProfileShapes({{small, 0}, {medium, 1}},
+                                 /*max_shapes=*/2),
+            (std::vector<std::vector<TensorShape>>{medium}));
+  EXPECT_TRUE(ProposeProfileShapes({{small, 1}}, /*max_shapes=*/0).empty());
+}
+
 }  // namespace tensorrt
 }  // namespace tensorflow
 
@@ -150,6 +150,28 @@ TEST(XlaCompiledCpuFunctionTest, MallocFreeContiguousBuffers) {
   xla::cpu_function_runtime::FreeContiguous(base);
 }
 
+TEST(XlaCompiledCpuFunctionTest, AssignContiguousBuffers) {
+  static constexpr intptr_t sizes[4] = {1, -1, 64, 2};
+  std::vector<BufferInfo> buffer_infos = SizesToBufferInfos(sizes, 4);
+  buffer_infos.push_back(
+      BufferInfo::MakeEntryParameter(/*size=*/8, /*param_number=*/0));
+  alignas(xla::cpu_function_runtime::Align()) char arena[192];
+  ASSERT_EQ(AlignedBufferBytes(buffer_infos.data(), buffer_infos.size(),
+                               /*allocate_entry_params=*/false),
+            sizeof(arena));
+  int arg = 0;
+  void* bufs[5] = {nullptr, nullptr, nullptr, nullptr, &arg};
+  xla::cpu_function_runtime::AssignContiguousBuffers(
+      buffer_infos.data(), buffer_infos.size(),
+      /*allocate_entry_params=*/false, arena, bufs);
+  EXPECT_EQ(bufs[0], add_ptr(arena, 0));
+  EXPECT_EQ(bufs[1], nullptr);
+  EXPECT_EQ(bufs[2], add_ptr(arena, 64));
+  EXPECT_EQ(bufs[3], add_ptr(arena, 128));
+  // Slots of buffers that aren't allocated are left alone.
+  EXPECT_EQ(bufs[4], &arg);
+}
+
 void CheckRoundTripIsOk(const BufferInfo& buffer_info) {
   BufferInfo round_trip(buffer_info.Encode());
   ASSERT_EQ(round_trip, buffer_info);
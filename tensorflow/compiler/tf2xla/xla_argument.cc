@@ -49,6 +49,9 @@ bool XlaArgument::operator==(const XlaArgument& other) const {
   if (is_same_data_across_replicas != other.is_same_data_across_replicas) {
     return false;
   }
+  if (dynamic_dim_to_arg_num_map != other.dynamic_dim_to_arg_num_map) {
+    return false;
+  }
   return constant_value.tensor_data() == other.constant_value.tensor_data();
 }
 
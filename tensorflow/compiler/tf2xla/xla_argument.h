@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_TF2XLA_XLA_ARGUMENT_H_
 #define TENSORFLOW_COMPILER_TF2XLA_XLA_ARGUMENT_H_
 
+#include <map>
+
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tensorflow/compiler/tf2xla/host_compute_metadata.pb.h"
@@ -109,6 +111,12 @@ struct XlaArgument {
   // Whether this argument will receive the same data across all replicas.
   bool is_same_data_across_replicas = false;
 
+  // For a parameter, maps a dimension to the index of the scalar int32
+  // parameter argument that holds its size at runtime. The argument's shape
+  // gives the upper bound of the dimension, and the computation sees the
+  // dimension as dynamic.
+  std::map<int32, int32> dynamic_dim_to_arg_num_map;
+
   bool operator==(const XlaArgument& other) const;
 
   // Returns a human-readable summary of the argument.
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "tensorflow/compiler/xla/cpu_function_runtime.h"
@@ -27,6 +28,8 @@ XlaCompiledCpuFunction::XlaCompiledCpuFunction(const StaticData& static_data,
       result_index_(static_data.result_index_),
       buffer_table_(new void*[static_data.num_buffers_]),
       buffer_infos_(static_data.buffer_infos_),
+      num_buffers_(static_data.num_buffers_),
+      owns_temp_buffers_(alloc_mode != AllocMode::PROFILES_ONLY),
       arg_index_table_(static_data.arg_index_table_),
       num_args_(static_data.num_args_),
       num_variables_(static_data.num_variables_),
@@ -37,11 +40,17 @@ XlaCompiledCpuFunction::XlaCompiledCpuFunction(const StaticData& static_data,
       hlo_profile_printer_data_(static_data.hlo_profile_printer_data_) {
   bool allocate_entry_params =
       alloc_mode == AllocMode::ARGS_VARIABLES_RESULTS_PROFILES_AND_TEMPS;
-  // Allocate arg and temp buffers.
-  alloc_buffer_table_ = xla::cpu_function_runtime::MallocContiguousBuffers(
-      static_data.buffer_infos_, static_data.num_buffers_,
-      /*allocate_entry_params=*/allocate_entry_params, buffer_table_,
-      /*annotate_initialized=*/true);
+  if (owns_temp_buffers_) {
+    // Allocate arg and temp buffers.
+    alloc_buffer_table_ = xla::cpu_function_runtime::MallocContiguousBuffers(
+        static_data.buffer_infos_, static_data.num_buffers_,
+        /*allocate_entry_params=*/allocate_entry_params, buffer_table_,
+        /*annotate_initialized=*/true);
+  } else {
+    // The arg and temp buffers are set by set_arg_data and set_temp_buffers.
+    std::fill(buffer_table_, buffer_table_ + static_data.num_buffers_,
+              nullptr);
+  }
   // If Hlo profiling is enabled the generated code expects an appropriately
   // sized buffer to be passed in as the last argument.  If Hlo profiling is
   // disabled the last function argument is still present in the function
@@ -115,6 +115,11 @@ class XlaCompiledCpuFunction {
     // Only allocate result, profile and temp buffers.
     // Use set_arg_data to set argument buffers before Run is called.
     RESULTS_PROFILES_AND_TEMPS_ONLY,
+
+    // Only allocate profile buffers.
+    // Use set_arg_data to set argument buffers and set_temp_buffers to set the
+    // memory for result and temp buffers before Run is called.
+    PROFILES_ONLY,
   };
 
   explicit XlaCompiledCpuFunction(
@@ -192,6 +197,31 @@ class XlaCompiledCpuFunction {
     buffer_table_[arg_index_table_[index]] = const_cast<void*>(data);
   }
 
+  // Returns the number of bytes of memory that set_temp_buffers needs.
+  size_t temp_buffers_size() const {
+    return xla::cpu_function_runtime::AlignedBufferBytes(
+        buffer_infos_, num_buffers_, /*allocate_entry_params=*/false);
+  }
+
+  // Sets the memory holding the result and temp buffers to `temps`. Must be
+  // called before Run in AllocMode::PROFILES_ONLY, and must not be called in
+  // other AllocModes.
+  //
+  // `temps` must be at least temp_buffers_size() bytes and be aligned to
+  // xla::cpu_function_runtime::Align(). It is owned by the caller and must not
+  // be used by any other computation while Run is called, but the same memory
+  // may be used by any number of instances that run one at a time, e.g. a
+  // per-thread arena shared by all the instances run on that thread. Results
+  // are only valid until the memory is used by another Run call.
+  void set_temp_buffers(void* temps) {
+    assert(!owns_temp_buffers_ && "Temp buffers are owned!");
+    assert((uintptr_t)temps % xla::cpu_function_runtime::Align() == 0 &&
+           "Underaligned pointer!");
+    xla::cpu_function_runtime::AssignContiguousBuffers(
+        buffer_infos_, num_buffers_, /*allocate_entry_params=*/false, temps,
+        buffer_table_);
+  }
+
   // ------------------------------
   // Result methods for managing output buffers. Buffers are in row-major order.
   // Must only be called after a successful Run call. Unlike the arg methods,
@@ -356,6 +386,13 @@ class XlaCompiledCpuFunction {
   // Describes the buffers used by the XLA computation.
   const xla::cpu_function_runtime::BufferInfo* const buffer_infos_;
 
+  // The number of buffers used by the XLA computation.
+  const size_t num_buffers_;
+
+  // Whether this instance allocated the result and temp buffers, i.e. whether
+  // the AllocMode is not PROFILES_ONLY.
+  const bool owns_temp_buffers_;
+
   // Argument i needs to be placed in buffer_table_[arg_index_to_temp_index_[i]]
   // for XLA generated code to be able to find it.
   const int32* const arg_index_table_;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
 
 #include <numeric>
+#include <set>
 #include <vector>
 
 #include "tensorflow/compiler/mlir/mlir_bridge_rollout_policy.h"
@@ -65,10 +66,29 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 
-// Checks that arguments `args` match types `types`.
+// Returns the number of trailing arguments of `args` that hold the runtime
+// size of a dynamic dimension of another argument.
+int NumTrailingDynamicSizeArgs(absl::Span<const XlaCompiler::Argument> args) {
+  std::set<int> size_args;
+  for (const XlaCompiler::Argument& arg : args) {
+    for (const auto& dim_and_arg_num : arg.dynamic_dim_to_arg_num_map) {
+      size_args.insert(dim_and_arg_num.second);
+    }
+  }
+  int num_size_args = 0;
+  while (num_size_args < args.size() &&
+         size_args.count(args.size() - 1 - num_size_args)) {
+    ++num_size_args;
+  }
+  return num_size_args;
+}
+
+// Checks that arguments `args` match types `types`. `args` may end with
+// arguments that hold the runtime sizes of dynamic dimensions, which have no
+// corresponding function parameter.
 Status CheckSignature(const DataTypeVector& types,
                       absl::Span<const XlaCompiler::Argument> args) {
-  if (args.size() != types.size()) {
+  if (args.size() - NumTrailingDynamicSizeArgs(args) != types.size()) {
     return errors::Internal("Compilation arguments have ", args.size(),
                             " elements while function has ", types.size());
   }
@@ -759,7 +779,7 @@ Status XlaCompiler::CompileFunction(
   // Set shapes for _Arg nodes. They are useful for constant folding (e.g. an
   // Xla op requires a compile-time constant input, and that input is shape of
   // an _Arg node.
-  for (int i = 0, end = args.size(); i < end; i++) {
+  for (int i = 0, end = fbody->arg_nodes.size(); i < end; i++) {
     // Skip resource variables and tensor lists.
     DataType dtype;
     TF_RETURN_IF_ERROR(GetNodeAttr(fbody->arg_nodes[i]->def(), "T", &dtype));
@@ -767,6 +787,13 @@ Status XlaCompiler::CompileFunction(
       continue;
     }
 
+    // As for dynamic xla shapes, the static shape of an argument with dynamic
+    // dimensions is only an upper bound and must not be constant folded.
+    if (!args[i].dynamic_dim_to_arg_num_map.empty()) {
+      fbody->arg_nodes[i]->ClearAttr("_output_shapes");
+      continue;
+    }
+
     if (absl::holds_alternative<xla::Shape>(args[i].shape)) {
       xla::Shape xla_shape = absl::get<xla::Shape>(args[i].shape);
       TensorShape tensor_shape;
@@ -1177,6 +1204,22 @@ Status XlaCompiler::BuildArguments(
             arg_expression.set_value_dynamism(arg.value_dynamism.value());
           }
         }
+        // Mark dynamic dimensions with their runtime sizes, so that XLA's
+        // dynamic padder masks out the padding beyond them.
+        for (const auto& dim_and_arg_num : arg.dynamic_dim_to_arg_num_map) {
+          TF_RET_CHECK(dim_and_arg_num.second >= 0 &&
+                       dim_and_arg_num.second < args.size());
+          const int size_input = arg_to_inputs[dim_and_arg_num.second];
+          TF_RET_CHECK(size_input >= 0)
+              << "Size of dynamic dimension " << dim_and_arg_num.first
+              << " of argument " << input_to_args->at(i)
+              << " is not a parameter";
+          arg_expression = XlaExpression::XlaOp(
+              xla::SetDimensionSize(arg_expression.handle(),
+                                    arg_handles[size_input],
+                                    dim_and_arg_num.first),
+              arg.type);
+        }
         break;
       case XlaCompiler::Argument::kTensorList: {
         arg_expression = XlaExpression::TensorList(arg_handles[i]);
@@ -84,6 +84,17 @@ void* MallocContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
       ABSL_ANNOTATE_MEMORY_IS_INITIALIZED(contiguous, total);
     }
   }
+  for (size_t i = 0; i < n; ++i) {
+    bufs[i] = nullptr;
+  }
+  AssignContiguousBuffers(buffer_infos, n, allocate_entry_params, contiguous,
+                          bufs);
+  return contiguous;
+}
+
+void AssignContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
+                             bool allocate_entry_params, void* contiguous,
+                             void** bufs) {
   uintptr_t pos = reinterpret_cast<uintptr_t>(contiguous);
   for (size_t i = 0; i < n; ++i) {
     bool should_allocate =
@@ -92,11 +103,8 @@ void* MallocContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
     if (should_allocate) {
       bufs[i] = reinterpret_cast<void*>(pos);
       pos += align_to(buffer_infos[i].size(), Align());
-    } else {
-      bufs[i] = nullptr;
     }
   }
-  return contiguous;
 }
 
 void FreeContiguous(void* contiguous) {
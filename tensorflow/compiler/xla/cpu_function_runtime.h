@@ -172,6 +172,16 @@ void* MallocContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
                               bool allocate_entry_params, void** bufs,
                               bool annotate_initialized);
 
+// AssignContiguousBuffers parcels out `contiguous` into `bufs` the same way
+// MallocContiguousBuffers parcels out the block it allocates, but leaves the
+// slots of `bufs` corresponding to unallocated buffers untouched.
+// `contiguous` must hold at least AlignedBufferBytes(buffer_infos, n,
+// allocate_entry_params) bytes and be aligned to Align(). It is owned by the
+// caller, which may reuse it for several functions that do not run at once.
+void AssignContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
+                             bool allocate_entry_params, void* contiguous,
+                             void** bufs);
+
 // FreeContiguous frees the contiguous block of memory allocated by
 // MallocContiguousBuffers.
 void FreeContiguous(void* contiguous);
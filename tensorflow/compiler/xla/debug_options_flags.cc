@@ -79,6 +79,11 @@ DebugOptions DefaultDebugOptionsIgnoringFlags() {
   opts.set_xla_force_host_platform_device_count(1);
   opts.set_xla_gpu_all_reduce_combine_threshold_bytes(30 * 1024 * 1024);
   opts.set_xla_gpu_enable_async_all_reduce(true);
+  opts.set_xla_gpu_enable_latency_hiding_scheduler(false);
+  opts.set_xla_gpu_enable_host_offloading(false);
+  opts.set_xla_cpu_compilation_parallelism(1);
+  opts.set_xla_cpu_enable_dot_autotuning(false);
+  opts.set_xla_gpu_fusion_autotune_max_candidates(0);
   opts.set_xla_cpu_enable_xprof_traceme(false);
   opts.set_xla_gpu_unsafe_fallback_to_driver_on_ptxas_not_found(false);
   opts.set_xla_multiheap_size_constraint_per_heap(-1);
@@ -759,6 +764,53 @@ static void AllocateFlags() {
       flag_values->xla_gpu_normalize_layouts(),
       "An experimental option to force all layouts present in the "
       "after-optimizations HLO to be descending"));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_gpu_enable_latency_hiding_scheduler",
+      bool_setter_for(
+          &DebugOptions::set_xla_gpu_enable_latency_hiding_scheduler),
+      flag_values->xla_gpu_enable_latency_hiding_scheduler(),
+      "Schedules HLO on GPU to overlap asynchronous collectives with "
+      "compute."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_gpu_enable_host_offloading",
+      bool_setter_for(&DebugOptions::set_xla_gpu_enable_host_offloading),
+      flag_values->xla_gpu_enable_host_offloading(),
+      "Offloads activations to host memory on GPU when a module does not fit "
+      "in device memory."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_cpu_compilation_parallelism",
+      int32_setter_for(&DebugOptions::set_xla_cpu_compilation_parallelism),
+      flag_values->xla_cpu_compilation_parallelism(),
+      "Maximum number of threads that compile an XLA:CPU module, which is "
+      "split into that many LLVM modules. 0 means one thread per core."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_cpu_enable_dot_autotuning",
+      bool_setter_for(&DebugOptions::set_xla_cpu_enable_dot_autotuning),
+      flag_values->xla_cpu_enable_dot_autotuning(),
+      "Measures the candidate lowerings of each XLA:CPU dot at compile time "
+      "and emits the fastest one."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_cpu_dot_autotune_results_path",
+      string_setter_for(
+          &DebugOptions::set_xla_cpu_dot_autotune_results_path),
+      flag_values->xla_cpu_dot_autotune_results_path(),
+      "File that XLA:CPU dot autotuning results are loaded from and saved "
+      "to."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_gpu_fusion_autotune_max_candidates",
+      int32_setter_for(
+          &DebugOptions::set_xla_gpu_fusion_autotune_max_candidates),
+      flag_values->xla_gpu_fusion_autotune_max_candidates(),
+      "Number of the most expensive producer-consumer pairs per module that "
+      "XLA:GPU decides to fuse or not by timing both alternatives. 0 "
+      "disables fusion autotuning."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_gpu_fusion_autotune_results_path",
+      string_setter_for(
+          &DebugOptions::set_xla_gpu_fusion_autotune_results_path),
+      flag_values->xla_gpu_fusion_autotune_results_path(),
+      "File that XLA:GPU fusion autotuning results are loaded from and saved "
+      "to."));
 
   ParseFlagsFromEnvAndDieIfUnknown("XLA_FLAGS", *flag_objects);
 }  // NOLINT(readability/fn_size)
@@ -15,12 +15,18 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/pjrt/cpu_device.h"
 
+#include <atomic>
+
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/types/span.h"
 #include "tensorflow/compiler/xla/client/executable_build_options.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
 #include "tensorflow/compiler/xla/test.h"
 #include "tensorflow/compiler/xla/tests/literal_test_util.h"
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 
 namespace xla {
 namespace {
@@ -35,5 +41,148 @@ TEST(CpuStreamDeviceTest, BlocksDeviceToHostStream) {  // b/214236179
   auto literal = *buffer->ToLiteralSync();
 }
 
+// Compiles x + 1, whose result aliases x with the given kind.
+std::unique_ptr<PjRtExecutable> CompileAddOne(
+    PjRtClient* client, HloInputOutputAliasConfig::AliasKind kind) {
+  XlaBuilder builder("add_one");
+  auto x = Parameter(&builder, 0, ShapeUtil::MakeShape(F32, {4}), "x");
+  Add(x, ConstantR0<float>(&builder, 1));
+  builder.SetUpAlias(/*output_index=*/{}, /*param_number=*/0,
+                     /*param_index=*/{}, kind);
+  return *client->Compile(*builder.Build(), CompileOptions());
+}
+
+TEST(CpuStreamDeviceTest, NonDonatableInputOutlivesExecution) {
+  const float data[] = {1, 2, 3, 4};
+  auto client = *GetCpuClient(true);
+  auto executable = CompileAddOne(
+      client.get(), HloInputOutputAliasConfig::AliasKind::kMayAlias);
+  auto buffer = *client->BufferFromHostBuffer(
+      &data, PrimitiveType::F32, {4}, std::nullopt,
+      PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, {},
+      client->devices()[0]);
+
+  ExecuteOptions options;
+  options.non_donatable_input_indices = {0};
+  auto results = *executable->Execute({{buffer.get()}}, options);
+  ASSERT_FALSE(buffer->IsDeleted());
+  LiteralTestUtil::ExpectR1Equal<float>({1, 2, 3, 4},
+                                        *buffer->ToLiteralSync());
+  LiteralTestUtil::ExpectR1Equal<float>({2, 3, 4, 5},
+                                        *results[0][0]->ToLiteralSync());
+
+  // By default the argument is donated, and its memory reused for the result.
+  results = *executable->Execute({{buffer.get()}}, ExecuteOptions());
+  EXPECT_TRUE(buffer->IsDeleted());
+  LiteralTestUtil::ExpectR1Equal<float>({2, 3, 4, 5},
+                                        *results[0][0]->ToLiteralSync());
+}
+
+TEST(CpuStreamDeviceTest, MustAliasInputCannotBeKept) {
+  const float data[] = {1, 2, 3, 4};
+  auto client = *GetCpuClient(true);
+  auto executable = CompileAddOne(
+      client.get(), HloInputOutputAliasConfig::AliasKind::kMustAlias);
+  auto buffer = *client->BufferFromHostBuffer(
+      &data, PrimitiveType::F32, {4}, std::nullopt,
+      PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, {},
+      client->devices()[0]);
+
+  ExecuteOptions options;
+  options.non_donatable_input_indices = {0};
+  auto results = executable->Execute({{buffer.get()}}, options);
+  EXPECT_EQ(results.status().code(), tensorflow::error::INVALID_ARGUMENT);
+  EXPECT_FALSE(buffer->IsDeleted());
+}
+
+TEST(CpuStreamDeviceTest, AsyncTransferManagerUploadsInPieces) {
+  const float data[] = {1, 2, 3, 4};
+  auto client = *GetCpuClient(true);
+  const Shape shapes[] = {ShapeUtil::MakeShape(F32, {4}),
+                          ShapeUtil::MakeShape(S32, {2})};
+  auto manager =
+      *client->CreateBuffersForAsyncTransfer(shapes, client->devices()[0]);
+  ASSERT_EQ(manager->buffer_count(), 2);
+  ASSERT_EQ(manager->buffer_size(0), sizeof(data));
+
+  // Upload the first buffer in two halves from raw data and the second from a
+  // literal.
+  // The callbacks run on the device's callback thread.
+  std::atomic<int> num_done{0};
+  absl::BlockingCounter done_counter(2);
+  auto on_done = [&]() {
+    ++num_done;
+    done_counter.DecrementCount();
+  };
+  TF_ASSERT_OK(manager->TransferRawDataToSubBuffer(
+      0, &data[0], 0, 2 * sizeof(float), /*is_last_transfer=*/false,
+      on_done));
+  TF_ASSERT_OK(manager->TransferRawDataToSubBuffer(
+      0, &data[2], 2 * sizeof(float), 2 * sizeof(float),
+      /*is_last_transfer=*/true, on_done));
+  Literal ints = LiteralUtil::CreateR1<int32_t>({5, 6});
+  TF_ASSERT_OK(manager->TransferLiteralToBuffer(1, ints, [&]() {}));
+
+  auto floats = manager->RetrieveBuffer(0);
+  auto ints_buffer = manager->RetrieveBuffer(1);
+  TF_ASSERT_OK(floats->GetReadyFuture().Await());
+  done_counter.Wait();
+  EXPECT_EQ(num_done, 2);
+  EXPECT_TRUE(LiteralTestUtil::Equal(LiteralUtil::CreateR1<float>({1, 2, 3, 4}),
+                                     **floats->ToLiteralSync()));
+  EXPECT_TRUE(LiteralTestUtil::Equal(ints, **ints_buffer->ToLiteralSync()));
+}
+
+TEST(CpuStreamDeviceTest, AsyncTransferManagerRejectsOutOfBoundsTransfer) {
+  const float data[] = {1, 2, 3, 4};
+  auto client = *GetCpuClient(true);
+  const Shape shapes[] = {ShapeUtil::MakeShape(F32, {2})};
+  auto manager =
+      *client->CreateBuffersForAsyncTransfer(shapes, client->devices()[0]);
+  auto status = manager->TransferRawDataToBuffer(
+      0, absl::string_view(reinterpret_cast<const char*>(data), sizeof(data)),
+      [&]() {});
+  EXPECT_EQ(status.code(), tensorflow::error::INVALID_ARGUMENT);
+  TF_ASSERT_OK(manager->TransferRawDataToBuffer(
+      0, absl::string_view(reinterpret_cast<const char*>(data), 8), [&]() {}));
+}
+
+TEST(CpuStreamDeviceTest, AsyncTransferManagerSetsTransferError) {
+  const float data[] = {1, 2};
+  auto client = *GetCpuClient(true);
+  const Shape shapes[] = {ShapeUtil::MakeShape(F32, {2}),
+                          ShapeUtil::MakeShape(F32, {2})};
+  auto manager =
+      *client->CreateBuffersForAsyncTransfer(shapes, client->devices()[0]);
+  TF_ASSERT_OK(manager->TransferRawDataToBuffer(
+      0, absl::string_view(reinterpret_cast<const char*>(data), sizeof(data)),
+      [&]() {}));
+  manager->SetTransferError(Cancelled("cancelled"));
+
+  // Only the buffer whose last transfer had not started gets the error.
+  TF_EXPECT_OK(manager->RetrieveBuffer(0)->GetReadyFuture().Await());
+  EXPECT_EQ(manager->RetrieveBuffer(1)->GetReadyFuture().Await().code(),
+            tensorflow::error::CANCELLED);
+  EXPECT_EQ(manager
+                ->TransferRawDataToBuffer(
+                    1,
+                    absl::string_view(reinterpret_cast<const char*>(data),
+                                      sizeof(data)),
+                    [&]() {})
+                .code(),
+            tensorflow::error::FAILED_PRECONDITION);
+}
+
+TEST(CpuStreamDeviceTest, AsyncTransferManagerDestructionSetsError) {
+  auto client = *GetCpuClient(true);
+  const Shape shapes[] = {ShapeUtil::MakeShape(F32, {2})};
+  auto manager =
+      *client->CreateBuffersForAsyncTransfer(shapes, client->devices()[0]);
+  auto buffer = manager->RetrieveBuffer(0);
+  manager.reset();
+  EXPECT_EQ(buffer->GetReadyFuture().Await().code(),
+            tensorflow::error::FAILED_PRECONDITION);
+}
+
 }  // namespace
 }  // namespace xla
@@ -42,13 +42,17 @@ LocalDeviceState::LocalDeviceState(se::StreamExecutor* executor,
       prng_seed_distribution_(std::numeric_limits<int>::min(),
                               std::numeric_limits<int>::max()) {
   compute_stream_ = std::make_unique<se::Stream>(executor);
-  host_to_device_stream_ = std::make_unique<se::Stream>(executor);
   compute_stream_->Init();
-  host_to_device_stream_->Init();
   if (use_callback_stream) {
     callback_stream_map_ =
         absl::flat_hash_map<se::Stream*, std::unique_ptr<se::Stream>>();
   }
+  host_to_device_streams_.reserve(kNumHostToDeviceStreams);
+  for (int i = 0; i < kNumHostToDeviceStreams; ++i) {
+    auto stream = std::make_unique<se::Stream>(executor);
+    stream->Init();
+    host_to_device_streams_.push_back(std::move(stream));
+  }
   device_to_host_streams_.reserve(kNumDeviceToHostStreams);
   for (int i = 0; i < kNumDeviceToHostStreams; ++i) {
     auto stream = std::make_unique<se::Stream>(executor);
@@ -128,6 +132,14 @@ void LocalDeviceState::ThenExecuteCallback(se::Stream* stream,
   });
 }
 
+se::Stream* LocalDeviceState::GetHostToDeviceStream() {
+  absl::MutexLock lock(&mu_);
+  int i = next_host_to_device_stream_;
+  next_host_to_device_stream_ =
+      (next_host_to_device_stream_ + 1) % host_to_device_streams_.size();
+  return host_to_device_streams_.at(i).get();
+}
+
 se::Stream* LocalDeviceState::GetDeviceToHostStream() {
   absl::MutexLock lock(&mu_);
   int i = next_device_to_host_stream_;
@@ -106,9 +106,14 @@ class LocalDeviceState {
 
   se::Stream* compute_stream() const { return compute_stream_.get(); }
   se::Stream* host_to_device_stream() const {
-    return host_to_device_stream_.get();
+    return host_to_device_streams_.front().get();
   }
 
+  // Returns a host to device stream. Allocates streams in a round-robin fashion
+  // amongst the available streams, so that concurrent transfers can overlap.
+  // The first one is host_to_device_stream().
+  se::Stream* GetHostToDeviceStream();
+
   // Returns a device to host stream. Allocates streams in a round-robin fashion
   // amongst the available streams.
   se::Stream* GetDeviceToHostStream();
@@ -174,15 +179,17 @@ class LocalDeviceState {
   se::StreamExecutor* const executor_;
   LocalClient* const client_;
   std::unique_ptr<se::Stream> compute_stream_;
-  std::unique_ptr<se::Stream> host_to_device_stream_;
+  std::vector<std::unique_ptr<se::Stream>> host_to_device_streams_;
   std::vector<std::unique_ptr<se::Stream>> device_to_host_streams_;
   std::vector<std::unique_ptr<se::Stream>> device_to_device_streams_;
 
-  // Number of device-to-host and device-to-device streams.
+  // Number of host-to-device, device-to-host and device-to-device streams.
+  static constexpr int kNumHostToDeviceStreams = 4;
   static constexpr int kNumDeviceToHostStreams = 4;
   static constexpr int kNumDeviceToDeviceStreams = 4;
 
   absl::Mutex mu_;
+  int next_host_to_device_stream_ ABSL_GUARDED_BY(mu_) = 0;
   int next_device_to_host_stream_ ABSL_GUARDED_BY(mu_) = 0;
   int next_device_to_device_stream_ ABSL_GUARDED_BY(mu_) = 0;
   std::stack<std::unique_ptr<se::Stream>> usage_stream_pool_
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "absl/base/attributes.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
@@ -1012,6 +1013,15 @@ struct ExecuteOptions {
   // These callbacks must outlive the execution.
   absl::Span<const std::vector<SendCallback>> send_callbacks;
   absl::Span<const std::vector<RecvCallback>> recv_callbacks;
+
+  // Indices of arguments that must stay valid after this execution, even
+  // though the executable aliases them to outputs, e.g. persistent buffers
+  // that later executables read as well. Such an argument is not donated: the
+  // executable writes the aliased output to a fresh buffer instead. It is an
+  // error to list an argument that the executable was compiled to must-alias.
+  // Listing no indices lets every may-alias output reuse the memory of its
+  // donated argument, so that chained executions don't copy.
+  absl::flat_hash_set<int> non_donatable_input_indices;
 };
 
 // Static device memory usage for a compiled program.
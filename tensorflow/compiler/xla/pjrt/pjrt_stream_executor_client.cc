@@ -67,6 +67,7 @@ limitations under the License.
 #include <algorithm>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -772,10 +773,11 @@ PjRtStreamExecutorClient::BufferFromHostBuffer(
     }
   }
 
+  // Concurrent uploads are spread over the host to device streams.
+  se::Stream* h2d_stream = local_device->GetHostToDeviceStream();
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<PjRtStreamExecutorBuffer> py_buffer,
-      AllocateDestinationBuffer(compact_shape, device, local_device,
-                                local_device->host_to_device_stream(),
+      AllocateDestinationBuffer(compact_shape, device, local_device, h2d_stream,
                                 /*is_uninitialized_create=*/false, this));
 
   PjRtStreamExecutorBuffer::ScopedHold device_buffer(
@@ -831,8 +833,8 @@ PjRtStreamExecutorClient::BufferFromHostBuffer(
   // TODO(misard) assess if it would be preferable to introduce a heuristic to
   // put the transfer into the calling thread for small literals.
   auto transfer_h2d =
-      [local_client = client(), transfer_manager, local_device, data, size,
-       movable_device_buffer{device_buffer.ToClosure()}, shape,
+      [local_client = client(), transfer_manager, local_device, h2d_stream,
+       data, size, movable_device_buffer{device_buffer.ToClosure()}, shape,
        py_buffer{py_buffer.get()},
        on_device_shape{py_buffer->on_device_shape()},
        staging_buffer{std::move(staging_buffer)},
@@ -867,24 +869,23 @@ PjRtStreamExecutorClient::BufferFromHostBuffer(
               static_cast<const char*>(staging_buffer.get()),
               ShapeUtil::DeviceShapeToHostShape(on_device_shape));
           TF_CHECK_OK(transfer_manager->TransferLiteralToDeviceAsync(
-              local_device->host_to_device_stream(), literal, buffer));
+              h2d_stream, literal, buffer));
         } else {
           BorrowingLiteral literal(
               reinterpret_cast<const char*>(data),
               ShapeUtil::DeviceShapeToHostShape(on_device_shape));
           // Otherwise, just transfer the literal.
           TF_CHECK_OK(transfer_manager->TransferLiteralToDeviceAsync(
-              local_device->host_to_device_stream(), literal, buffer));
+              h2d_stream, literal, buffer));
         }
 
         std::shared_ptr<BufferSequencingEvent> event =
             device_buffer->definition_events()[0];
         TF_CHECK_OK(AddDestinationBufferSynchronization(
-            local_device, std::move(device_buffer), event,
-            local_device->host_to_device_stream()));
+            local_device, std::move(device_buffer), event, h2d_stream));
 
         local_device->ThenExecuteCallback(
-            local_device->host_to_device_stream(),
+            h2d_stream,
             [staging_buffer{std::move(staging_buffer)},
              on_done_with_host_buffer{std::move(on_done_with_host_buffer)}]() {
               if (on_done_with_host_buffer) {
@@ -948,10 +949,10 @@ PjRtStreamExecutorClient::BufferFromHostLiteral(const LiteralSlice& literal,
   TF_ASSIGN_OR_RETURN(
       Shape compact_shape,
       transfer_manager->ChooseCompactLayoutForShape(literal.shape()));
+  se::Stream* h2d_stream = local_device->GetHostToDeviceStream();
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<PjRtStreamExecutorBuffer> py_buffer,
-      AllocateDestinationBuffer(compact_shape, device, local_device,
-                                local_device->host_to_device_stream(),
+      AllocateDestinationBuffer(compact_shape, device, local_device, h2d_stream,
                                 /*is_uninitialized_create=*/false, this));
 
   PjRtStreamExecutorBuffer::ScopedHold device_buffer(
@@ -965,6 +966,7 @@ PjRtStreamExecutorClient::BufferFromHostLiteral(const LiteralSlice& literal,
   // TODO(misard) assess if it would be preferable to introduce a heuristic to
   // put the transfer into the calling thread for small literals.
   auto transfer_h2d = [local_client = client(), transfer_manager, local_device,
+                       h2d_stream,
                        movable_device_buffer{device_buffer.ToClosure()},
                        literal, py_buffer{py_buffer.get()},
                        on_device_shape{py_buffer->on_device_shape()}]() {
@@ -975,7 +977,6 @@ PjRtStreamExecutorClient::BufferFromHostLiteral(const LiteralSlice& literal,
     // memory that has already been allocated, and a possible Event
     // allocation.
 
-    se::Stream* h2d_stream = local_device->host_to_device_stream();
     ShapedBuffer buffer = device_buffer->AsShapedBuffer(on_device_shape);
     TF_CHECK_OK(transfer_manager->TransferLiteralToDeviceAsync(
         h2d_stream, literal, buffer));
@@ -995,6 +996,252 @@ PjRtStreamExecutorClient::BufferFromHostLiteral(const LiteralSlice& literal,
   return std::unique_ptr<PjRtBuffer>(std::move(py_buffer));
 }
 
+namespace {
+
+// Stages large raw transfers through pinned host memory in chunks of this
+// size, so that copying a chunk into staging memory overlaps with the DMA of
+// the previous chunk, and staging memory is released as the DMAs complete.
+constexpr int64_t kTransferChunkBytes = 4 << 20;
+
+// Transfers into buffers that are allocated up front. Each buffer is assigned
+// one of the device's host to device streams in turn, so that the transfers
+// into different buffers proceed in parallel. Consumers, e.g. executions or
+// the buffers' GetReadyFuture(), wait for the last transfer into a buffer.
+// Buffers whose last transfer is not started before SetTransferError() or the
+// destruction of the manager are defined with an error instead.
+class AsyncHostToDeviceTransferManager
+    : public PjRtClient::AsyncBufferTransferManager {
+ public:
+  static StatusOr<std::unique_ptr<AsyncHostToDeviceTransferManager>> Create(
+      absl::Span<const Shape> shapes, PjRtStreamExecutorDevice* device,
+      PjRtStreamExecutorClient* client) {
+    TF_ASSIGN_OR_RETURN(LocalDeviceState * local_device,
+                        device->GetLocalDeviceState());
+    TransferManager* transfer_manager =
+        client->client()->backend().transfer_manager();
+    std::unique_ptr<AsyncHostToDeviceTransferManager> manager(
+        new AsyncHostToDeviceTransferManager(device, local_device, client));
+    absl::MutexLock lock(&manager->mu_);
+    for (const Shape& shape : shapes) {
+      TF_ASSIGN_OR_RETURN(
+          Shape compact_shape,
+          transfer_manager->ChooseCompactLayoutForShape(shape));
+      se::Stream* stream = local_device->GetHostToDeviceStream();
+      TF_ASSIGN_OR_RETURN(
+          std::unique_ptr<PjRtStreamExecutorBuffer> buffer,
+          AllocateDestinationBuffer(compact_shape, device, local_device,
+                                    stream, /*is_uninitialized_create=*/false,
+                                    client));
+      manager->holds_.push_back(buffer->GetBufferWithUsageHold());
+      CHECK(manager->holds_.back().ok());
+      manager->on_device_shapes_.push_back(buffer->on_device_shape());
+      manager->buffer_sizes_.push_back(
+          transfer_manager->GetByteSizeRequirement(buffer->on_device_shape()));
+      manager->streams_.push_back(stream);
+      manager->buffers_.push_back(std::move(buffer));
+      manager->last_transfer_started_.push_back(false);
+    }
+    return manager;
+  }
+
+  ~AsyncHostToDeviceTransferManager() override {
+    absl::MutexLock lock(&mu_);
+    for (int i = 0; i < holds_.size(); ++i) {
+      if (!last_transfer_started_[i]) {
+        SetBufferError(i, FailedPrecondition(
+                              "AsyncHostToDeviceTransferManager was destroyed "
+                              "before the last transfer into buffer %d",
+                              i));
+      }
+    }
+  }
+
+  size_t buffer_count() const override { return buffer_sizes_.size(); }
+
+  PjRtDevice* device() const override { return device_; }
+
+  std::unique_ptr<PjRtBuffer> RetrieveBuffer(int buffer_index) override {
+    absl::MutexLock lock(&mu_);
+    CHECK(buffers_.at(buffer_index) != nullptr)
+        << "RetrieveBuffer called more than once for buffer " << buffer_index;
+    return std::move(buffers_[buffer_index]);
+  }
+
+  size_t buffer_size(int buffer_index) const override {
+    return buffer_sizes_.at(buffer_index);
+  }
+
+  Status TransferLiteralToBuffer(int buffer_index, const LiteralSlice& literal,
+                                 std::function<void()> on_done) override {
+    absl::MutexLock lock(&mu_);
+    TF_RETURN_IF_ERROR(CheckCanTransfer(buffer_index));
+    TransferManager* transfer_manager =
+        client_->client()->backend().transfer_manager();
+    PjRtStreamExecutorBuffer::ScopedHold& hold = holds_[buffer_index];
+    ShapedBuffer buffer = hold->AsShapedBuffer(on_device_shapes_[buffer_index]);
+    TF_RETURN_IF_ERROR(transfer_manager->TransferLiteralToDeviceAsync(
+        streams_[buffer_index], literal, buffer));
+    return FinishTransfer(buffer_index, std::move(on_done));
+  }
+
+  Status TransferRawDataToBuffer(int buffer_index, absl::string_view data,
+                                 std::function<void()> on_done) override {
+    return TransferRawDataToSubBuffer(buffer_index, data.data(),
+                                      /*offset=*/0, data.size(),
+                                      /*is_last_transfer=*/true,
+                                      std::move(on_done));
+  }
+
+  Status TransferRawDataToSubBuffer(int buffer_index, const void* data,
+                                    int64_t offset, int64_t transfer_size,
+                                    bool is_last_transfer,
+                                    std::function<void()> on_done) override {
+    absl::MutexLock lock(&mu_);
+    TF_RETURN_IF_ERROR(CheckCanTransfer(buffer_index));
+    PjRtStreamExecutorBuffer::ScopedHold& hold = holds_[buffer_index];
+    if (hold->device_memory().size() != 1) {
+      return InvalidArgument(
+          "TransferRawDataToSubBuffer requires an array buffer, got %s",
+          on_device_shapes_[buffer_index].ToString());
+    }
+    se::DeviceMemoryBase device_memory = hold->device_memory()[0];
+    if (offset < 0 || transfer_size < 0 ||
+        offset + transfer_size > device_memory.size()) {
+      return InvalidArgument(
+          "Transfer of %d bytes at offset %d is out of bounds of buffer %d of "
+          "%d bytes",
+          transfer_size, offset, buffer_index, device_memory.size());
+    }
+
+    se::Stream* stream = streams_[buffer_index];
+    const char* src = static_cast<const char*>(data);
+    for (int64_t chunk_offset = 0; chunk_offset < transfer_size;) {
+      int64_t chunk_size = transfer_size - chunk_offset;
+      if (client_->should_stage_host_to_device_transfers()) {
+        chunk_size = std::min(chunk_size, kTransferChunkBytes);
+      }
+      se::DeviceMemoryBase chunk_memory(
+          static_cast<char*>(device_memory.opaque()) + offset + chunk_offset,
+          chunk_size);
+      if (client_->should_stage_host_to_device_transfers()) {
+        void* staging_buffer = client_->host_memory_allocator()->AllocateRaw(
+            tensorflow::Allocator::kAllocatorAlignment, chunk_size);
+        if (staging_buffer == nullptr) {
+          return ResourceExhausted(
+              "Failed to allocate %d bytes of staging memory for a transfer "
+              "into buffer %d",
+              chunk_size, buffer_index);
+        }
+        std::memcpy(staging_buffer, src + chunk_offset, chunk_size);
+        stream->ThenMemcpy(&chunk_memory, staging_buffer, chunk_size);
+        local_device_->ThenExecuteCallback(
+            stream, [staging_buffer,
+                     allocator = client_->host_memory_allocator()]() {
+              allocator->DeallocateRaw(staging_buffer);
+            });
+      } else {
+        stream->ThenMemcpy(&chunk_memory, src + chunk_offset, chunk_size);
+      }
+      chunk_offset += chunk_size;
+    }
+
+    if (is_last_transfer) {
+      return FinishTransfer(buffer_index, std::move(on_done));
+    }
+    if (on_done) {
+      local_device_->ThenExecuteCallback(stream, std::move(on_done));
+    }
+    return OkStatus();
+  }
+
+  void SetTransferError(Status error) override {
+    absl::MutexLock lock(&mu_);
+    for (int i = 0; i < holds_.size(); ++i) {
+      if (!last_transfer_started_[i]) {
+        SetBufferError(i, error);
+      }
+    }
+  }
+
+  void AddTransferMetadata(const TransferMetadata& metadata) override {}
+
+ private:
+  AsyncHostToDeviceTransferManager(PjRtStreamExecutorDevice* device,
+                                   LocalDeviceState* local_device,
+                                   PjRtStreamExecutorClient* client)
+      : device_(device), local_device_(local_device), client_(client) {}
+
+  Status CheckCanTransfer(int buffer_index) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (buffer_index < 0 || buffer_index >= holds_.size()) {
+      return InvalidArgument("Invalid buffer index %d for %d buffers",
+                             buffer_index, holds_.size());
+    }
+    if (last_transfer_started_[buffer_index]) {
+      return FailedPrecondition(
+          "The last transfer into buffer %d has already been started",
+          buffer_index);
+    }
+    return OkStatus();
+  }
+
+  // Calls `on_done` and makes buffer `buffer_index` available to consumers
+  // once the transfers enqueued into it so far are complete.
+  Status FinishTransfer(int buffer_index, std::function<void()> on_done)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    last_transfer_started_[buffer_index] = true;
+    se::Stream* stream = streams_[buffer_index];
+    if (on_done) {
+      local_device_->ThenExecuteCallback(stream, std::move(on_done));
+    }
+    std::shared_ptr<BufferSequencingEvent> event =
+        holds_[buffer_index]->definition_events()[0];
+    return AddDestinationBufferSynchronization(
+        local_device_, std::move(holds_[buffer_index]), event, stream);
+  }
+
+  // Defines buffer `buffer_index` with `error`, once the transfers enqueued
+  // into it so far are complete.
+  void SetBufferError(int buffer_index, Status error)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    holds_[buffer_index]->definition_events()[0]->SetDefinedStatus(error);
+    Status s = FinishTransfer(buffer_index, /*on_done=*/nullptr);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to set the error of buffer " << buffer_index
+                 << ": " << s;
+    }
+  }
+
+  PjRtStreamExecutorDevice* const device_;
+  LocalDeviceState* const local_device_;
+  PjRtStreamExecutorClient* const client_;
+
+  absl::Mutex mu_;
+  // Null once retrieved by RetrieveBuffer.
+  std::vector<std::unique_ptr<PjRtStreamExecutorBuffer>> buffers_
+      ABSL_GUARDED_BY(mu_);
+  // Usage holds that keep the buffers undefined until their last transfer.
+  std::vector<PjRtStreamExecutorBuffer::ScopedHold> holds_
+      ABSL_GUARDED_BY(mu_);
+  std::vector<bool> last_transfer_started_ ABSL_GUARDED_BY(mu_);
+  std::vector<Shape> on_device_shapes_;
+  std::vector<size_t> buffer_sizes_;
+  std::vector<se::Stream*> streams_;
+};
+
+}  // namespace
+
+StatusOr<std::unique_ptr<PjRtClient::AsyncBufferTransferManager>>
+PjRtStreamExecutorClient::CreateBuffersForAsyncTransfer(
+    absl::Span<const Shape> shapes, PjRtDevice* device) {
+  if (shapes.empty()) {
+    return InvalidArgument(
+        "CreateBuffersForAsyncTransfer requires at least one shape");
+  }
+  return AsyncHostToDeviceTransferManager::Create(
+      shapes, tensorflow::down_cast<PjRtStreamExecutorDevice*>(device), this);
+}
+
 StatusOr<std::vector<std::unique_ptr<PjRtBuffer>>>
 PjRtStreamExecutorClient::MakeCrossHostReceiveBuffers(
     absl::Span<const Shape> shapes, PjRtDevice* device,
@@ -1585,6 +1832,7 @@ PjRtFuture<Status> PjRtStreamExecutorBuffer::GetReadyFuture() {
   if (device_buffer) {
     LocalDeviceState* local_device_state = device_->local_device_state();
     std::unique_ptr<se::Stream> stream;
+    Status defined_status;
     for (auto& event : device_buffer->definition_events()) {
       if (!event->IsComplete()) {
         if (stream == nullptr) {
@@ -1592,6 +1840,7 @@ PjRtFuture<Status> PjRtStreamExecutorBuffer::GetReadyFuture() {
         }
         event->WaitForEventOnStream(stream.get());
       }
+      defined_status.Update(event->GetDefinedStatus());
     }
     if (stream != nullptr) {
       auto* stream_ptr = stream.release();
@@ -1599,15 +1848,16 @@ PjRtFuture<Status> PjRtStreamExecutorBuffer::GetReadyFuture() {
       // callback directly on that stream instead of bouncing through
       // local_device_state->ThenExecuteCallback. The direct callback saves
       // significant time.
-      stream_ptr->ThenDoHostCallback(
-          [definition_promise, stream_ptr, local_device_state]() mutable {
-            local_device_state->ReturnStreamToPool(
-                std::unique_ptr<se::Stream>(stream_ptr));
-            definition_promise.Set(OkStatus());
-          });
+      stream_ptr->ThenDoHostCallback([definition_promise, defined_status,
+                                      stream_ptr,
+                                      local_device_state]() mutable {
+        local_device_state->ReturnStreamToPool(
+            std::unique_ptr<se::Stream>(stream_ptr));
+        definition_promise.Set(defined_status);
+      });
     } else {
       // All events are already complete.
-      definition_promise.Set(OkStatus());
+      definition_promise.Set(defined_status);
     }
   }
 
@@ -1892,6 +2142,31 @@ PjRtStreamExecutorExecutable::MakeExecutionInputsAndWaitForEvents(
   return execution_inputs;
 }
 
+namespace {
+
+// Returns true if `executable` was compiled to alias argument `arg`, or a
+// buffer within it, to an output unconditionally, so that it must be donated.
+bool ArgumentMustAlias(Executable* executable, bool tuple_inputs, int arg) {
+  if (!executable->has_module()) {
+    return false;
+  }
+  bool must_alias = false;
+  executable->module().input_output_alias_config().ForEachAlias(
+      [&](const ShapeIndex& output_index,
+          const HloInputOutputAliasConfig::Alias& alias) {
+        int alias_arg = alias.parameter_number;
+        if (tuple_inputs) {
+          alias_arg = alias.parameter_index.empty()
+                          ? -1
+                          : alias.parameter_index.front();
+        }
+        must_alias |= alias_arg == arg && alias.must_alias();
+      });
+  return must_alias;
+}
+
+}  // namespace
+
 // Enqueues a computation onto the compute stream. Each buffer returned in
 // device_buffers has a usage hold added that must be dropped on error or
 // converted on success.
@@ -1929,6 +2204,16 @@ StatusOr<ScopedShapedBuffer> PjRtStreamExecutorExecutable::EnqueueExecution(
     bool must_donate = donate_it != donated_params.end() && *donate_it == i;
     if (must_donate) {
       ++donate_it;
+      if (options.non_donatable_input_indices.contains(i)) {
+        if (ArgumentMustAlias(executables_[executable_idx]->executable(),
+                              parameter_is_tupled_arguments_, i)) {
+          return InvalidArgument(
+              "Argument %d to %s is listed in non_donatable_input_indices, "
+              "but the executable must alias it to an output.",
+              i, name());
+        }
+        must_donate = false;
+      }
     }
     device_buffers->emplace_back(handle->GetBufferWithHold(
         must_donate ? PjRtStreamExecutorBuffer::ScopedHold::kDonation
@@ -95,6 +95,19 @@ bool BufferSequencingEvent::IsComplete() {
   return event_.event()->PollForStatus() == se::Event::Status::kComplete;
 }
 
+void BufferSequencingEvent::SetDefinedStatus(Status status) {
+  absl::MutexLock lock(&mu_);
+  CHECK(!event_.event());
+  defined_status_ = status;
+}
+
+Status BufferSequencingEvent::GetDefinedStatus() {
+  absl::MutexLock lock(&mu_);
+  mu_.Await(
+      absl::Condition(this, &BufferSequencingEvent::EventHasBeenRecorded));
+  return defined_status_;
+}
+
 /* static */ std::shared_ptr<TrackedDeviceBuffer>
 TrackedDeviceBuffer::FromScopedShapedBuffer(
     ScopedShapedBuffer* shaped_buffer,
@@ -80,6 +80,16 @@ class BufferSequencingEvent {
   // event has been recorded.
   bool IsComplete();
 
+  // Records that the operation that populates the buffer failed with
+  // 'status'. Must be called before SetSequencingEvent, which must still be
+  // called so that consumers waiting for the event are unblocked.
+  void SetDefinedStatus(Status status);
+
+  // Returns the status set by SetDefinedStatus, or OK. If RecordOnStream has
+  // not yet been called, blocks the calling thread until the event has been
+  // recorded.
+  Status GetDefinedStatus();
+
   // Compares the sequence numbers of two recorded events. It is illegal to call
   // the comparison operators unless both events have been recorded.
   inline bool operator<(const BufferSequencingEvent& rhs) const {
@@ -115,6 +125,7 @@ class BufferSequencingEvent {
   // A list of all streams for which the buffer's content is known to be defined
   // at the tail of the queue, i.e., for any newly enqueued command.
   absl::InlinedVector<se::Stream*, 2> streams_defined_on_ ABSL_GUARDED_BY(mu_);
+  Status defined_status_ ABSL_GUARDED_BY(mu_);
 };
 
 // Class that represents a tuple of device buffers. Like a ScopedShapedBuffer it
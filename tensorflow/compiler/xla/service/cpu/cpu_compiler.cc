@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#define EIGEN_USE_THREADS
+
 #include "tensorflow/compiler/xla/service/cpu/cpu_compiler.h"
 
 #include <stddef.h>
@@ -21,6 +23,7 @@ limitations under the License.
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <stack>
 #include <string>
 #include <tuple>
@@ -30,9 +33,12 @@ limitations under the License.
 // IWYU pragma: no_include "llvm/Config/Disassemblers.def.inc"
 // IWYU pragma: no_include "llvm/Config/Targets.def.inc"
 
+#include "absl/algorithm/container.h"
 #include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
@@ -86,6 +92,7 @@ limitations under the License.
 #include "mlir/Target/LLVMIR/Export.h"  // from @llvm-project
 #include "mlir/Target/LLVMIR/LLVMTranslationInterface.h"  // from @llvm-project
 #include "mlir/Transforms/Passes.h"  // from @llvm-project
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/compiler/mlir/hlo/include/mlir-hlo/Dialect/gml_st/transforms/passes.h"
 #include "tensorflow/compiler/mlir/hlo/include/mlir-hlo/Dialect/mhlo/transforms/passes.h"
 #include "tensorflow/compiler/mlir/hlo/include/mlir-hlo/Transforms/passes.h"
@@ -120,9 +127,11 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/cpu_instruction_fusion.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_layout_assignment.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
+#include "tensorflow/compiler/xla/service/cpu/dot_autotuner.h"
 #include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emitter.h"
+#include "tensorflow/compiler/xla/service/cpu/llvm_module_partitioning.h"
 #include "tensorflow/compiler/xla/service/cpu/parallel_task_assignment.h"
 #include "tensorflow/compiler/xla/service/cpu/simple_orc_jit.h"
 #include "tensorflow/compiler/xla/service/dfs_hlo_visitor_with_default.h"
@@ -188,8 +197,12 @@ limitations under the License.
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 
 namespace {
@@ -644,12 +657,15 @@ Status CpuCompiler::RunHloPassesAfterLayoutAssn(
       module->config().intra_op_parallelism_threads() > 0
           ? module->config().intra_op_parallelism_threads()
           : tensorflow::port::NumSchedulableCPUs();
-  if (!is_aot_compile) {
+  if (!is_aot_compile ||
+      options::AotParallelTaskAssignmentRequested(module->config())) {
     // Run ParallelTaskAssigner to assign parallel tasks to HLOs in module.
-    // Note this is not run for AOT because it would bring in thread pool
-    // and thread synchronization dependencies which would likely increase
-    // binary size (and most AOT applications are single-threaded).
-    // TODO(b/29630486) Support multi-threaded AOT.
+    // Note this is not run for AOT by default because it would bring in thread
+    // pool and thread synchronization dependencies which would likely increase
+    // binary size (and most AOT applications are single-threaded). AOT users
+    // that run on a thread pool may request it with the
+    // xla_cpu_aot_parallel_task_assignment backend option, and must then link
+    // in the fork-join runtime.
     pipeline.AddPass<ParallelTaskAssigner>(
         max_parallelism, ShapeSizeBytesFunction(), target_machine_features);
   }
@@ -792,6 +808,120 @@ Status CreateHloProfilingArtifacts(
 
 }  // namespace
 
+namespace {
+
+struct AlignedFreeDeleter {
+  void operator()(void* ptr) const { tensorflow::port::AlignedFree(ptr); }
+};
+
+// Returns how long `dot` takes to run on its own when lowered as `candidate`.
+// The dot is compiled into a module of its own and run a few times on
+// zero-filled buffers; the fastest run is reported, so that cold caches and
+// noise from other processes don't count.
+StatusOr<absl::Duration> MeasureDotCandidate(
+    CpuCompiler* compiler, const HloInstruction& dot,
+    const DotBackendConfig& candidate,
+    const Eigen::ThreadPoolDevice* intra_op_thread_pool) {
+  constexpr int kNumRuns = 5;
+
+  HloComputation::Builder builder("dot_autotuning");
+  HloInstruction* lhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, dot.operand(0)->shape(), "lhs"));
+  HloInstruction* rhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(1, dot.operand(1)->shape(), "rhs"));
+  HloInstruction* clone = builder.AddInstruction(
+      dot.CloneWithNewOperands(dot.shape(), {lhs, rhs}));
+  TF_RETURN_IF_ERROR(clone->set_backend_config(candidate));
+  std::unique_ptr<HloComputation> computation = builder.Build();
+
+  const HloModuleConfig& dot_module_config = dot.GetModule()->config();
+  HloModuleConfig config(computation->ComputeProgramShape(),
+                         /*ignore_layouts=*/false);
+  DebugOptions debug_options = dot_module_config.debug_options();
+  debug_options.set_xla_cpu_enable_dot_autotuning(false);
+  debug_options.set_xla_cpu_compilation_parallelism(1);
+  debug_options.clear_xla_dump_to();
+  config.set_debug_options(debug_options);
+  config.set_intra_op_parallelism_threads(
+      dot_module_config.intra_op_parallelism_threads());
+  auto module = std::make_unique<HloModule>("dot_autotuning", config);
+  module->AddEntryComputation(std::move(computation));
+
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<Executable> executable,
+                      compiler->RunBackend(std::move(module),
+                                           /*stream_exec=*/nullptr,
+                                           Compiler::CompileOptions{}));
+  auto* cpu_executable = static_cast<CpuExecutable*>(executable.get());
+
+  std::vector<std::unique_ptr<void, AlignedFreeDeleter>> storage;
+  std::vector<MaybeOwningDeviceMemory> buffers;
+  for (const BufferAllocation& allocation :
+       cpu_executable->buffer_assignment().Allocations()) {
+    if (allocation.is_constant() || allocation.is_thread_local() ||
+        allocation.size() == 0) {
+      buffers.emplace_back(se::DeviceMemoryBase{});
+      continue;
+    }
+    void* data = tensorflow::port::AlignedMalloc(
+        allocation.size(), cpu_function_runtime::MinAlign());
+    if (data == nullptr) {
+      return ResourceExhausted(
+          "Failed to allocate %d bytes to autotune dot %s", allocation.size(),
+          dot.name());
+    }
+    memset(data, 0, allocation.size());
+    storage.emplace_back(data);
+    buffers.emplace_back(se::DeviceMemoryBase(data, allocation.size()));
+  }
+
+  ExecutableRunOptions run_options;
+  run_options.set_intra_op_thread_pool(intra_op_thread_pool);
+  absl::Duration best_run_time = absl::InfiniteDuration();
+  // The first run warms up caches and is not counted.
+  for (int i = 0; i <= kNumRuns; ++i) {
+    absl::Time start = absl::Now();
+    TF_RETURN_IF_ERROR(cpu_executable->ExecuteComputeFunction(
+        &run_options, buffers, /*hlo_execution_profile=*/nullptr));
+    if (i > 0) {
+      best_run_time = std::min(best_run_time, absl::Now() - start);
+    }
+  }
+  return best_run_time;
+}
+
+// Picks the lowering of each dot in `module` by measuring its candidates on
+// the host. See DotAutotuner.
+Status AutotuneDots(CpuCompiler* compiler, HloModule* module,
+                    llvm::TargetMachine* target_machine) {
+  const HloModuleConfig& config = module->config();
+  const int num_threads = config.intra_op_parallelism_threads() > 0
+                              ? config.intra_op_parallelism_threads()
+                              : tensorflow::port::MaxParallelism();
+  tensorflow::thread::ThreadPool thread_pool(
+      tensorflow::Env::Default(), "xla_cpu_dot_autotuning", num_threads);
+  Eigen::ThreadPoolDevice intra_op_thread_pool(thread_pool.AsEigenThreadPool(),
+                                               thread_pool.NumThreads());
+
+  // Eigen's timings depend on whether and how widely it is multi-threaded, so
+  // both are part of the device, along with the CPU.
+  std::string device = absl::StrCat(
+      target_machine->getTargetTriple().str(), ":",
+      target_machine->getTargetCPU().str(), ":",
+      target_machine->getTargetFeatureString().str(), ":",
+      config.debug_options().xla_cpu_multi_thread_eigen() ? num_threads : 1);
+  LLVMTargetMachineFeatures target_machine_features(target_machine);
+  DotAutotuner autotuner(
+      std::move(device), &target_machine_features,
+      [&](const HloInstruction& dot, const DotBackendConfig& candidate) {
+        return MeasureDotCandidate(compiler, dot, candidate,
+                                   &intra_op_thread_pool);
+      },
+      config.debug_options().xla_cpu_dot_autotune_results_path());
+  return autotuner.Run(module).status();
+}
+
+}  // namespace
+
 StatusOr<std::unique_ptr<HloModule>> CpuCompiler::RunHloPasses(
     std::unique_ptr<HloModule> module, se::StreamExecutor* /*stream_exec*/,
     const CompileOptions& /*options*/) {
@@ -800,10 +930,18 @@ StatusOr<std::unique_ptr<HloModule>> CpuCompiler::RunHloPasses(
           CompilerTargetOptions(module->config()),
           CodeGenOptLevel(module->config()));
 
+  const DebugOptions& debug_options = module->config().debug_options();
   TF_RETURN_IF_ERROR(RunHloPasses(
       module.get(), /*is_aot_compile=*/false, jit_target_machine.get(),
-      /*is_mlir_compile=*/
-      module->config().debug_options().xla_cpu_enable_mlir_lowering()));
+      /*is_mlir_compile=*/debug_options.xla_cpu_enable_mlir_lowering()));
+  // Autotuning measures on the host, so it is only done for JIT compilation,
+  // whose target is the host.
+  if (debug_options.xla_cpu_enable_dot_autotuning() &&
+      !UseMlirHloLowering(debug_options.xla_cpu_enable_mlir_lowering(),
+                          module.get())) {
+    TF_RETURN_IF_ERROR(
+        AutotuneDots(this, module.get(), jit_target_machine.get()));
+  }
   return std::move(module);
 }
 
@@ -868,6 +1006,81 @@ void InitializeLLVMCommandLineOptions(const HloModuleConfig& config) {
       config.debug_options().xla_backend_extra_options());
 }
 
+// Returns the maximum number of threads to compile the LLVM module on.
+int CompilationParallelism(const HloModuleConfig& config) {
+  const int parallelism =
+      config.debug_options().xla_cpu_compilation_parallelism();
+  return parallelism > 0 ? parallelism : tensorflow::port::MaxParallelism();
+}
+
+// Returns the computations whose functions are compiled in an LLVM module
+// partition of their own: the large bodies of loops and branches of
+// conditionals, which lose little from not being inlined into their callers.
+absl::flat_hash_set<const HloComputation*> ComputationsToCompileSeparately(
+    const HloModule& module) {
+  constexpr int64_t kMinInstructionCount = 32;
+  absl::flat_hash_set<const HloComputation*> computations;
+  auto add = [&](const HloComputation* computation) {
+    if (computation->instruction_count() >= kMinInstructionCount) {
+      computations.insert(computation);
+    }
+  };
+  for (const HloComputation* computation : module.MakeNonfusionComputations()) {
+    for (const HloInstruction* instruction : computation->instructions()) {
+      if (instruction->opcode() == HloOpcode::kWhile) {
+        add(instruction->while_body());
+      } else if (instruction->opcode() == HloOpcode::kConditional) {
+        absl::c_for_each(instruction->branch_computations(), add);
+      }
+    }
+  }
+  return computations;
+}
+
+// Optimizes and compiles the partitions of a module concurrently, one thread
+// each, and adds them to `jit`.
+Status CompileModulePartitions(const ModulePartitioning& partitioning,
+                               SimpleOrcJIT& jit) {
+  XLA_SCOPED_LOGGING_TIMER("CpuCompiler - Compiling module partitions");
+  std::vector<StatusOr<std::unique_ptr<llvm::MemoryBuffer>>> object_files(
+      partitioning.num_partitions());
+  {
+    tensorflow::thread::ThreadPool thread_pool(
+        tensorflow::Env::Default(), "xla_cpu_compile",
+        partitioning.num_partitions());
+    for (int i = 0; i < partitioning.num_partitions(); ++i) {
+      thread_pool.Schedule([&partitioning, &jit, &object_files, i] {
+        // Each partition has a context of its own to compile without locks.
+        llvm::LLVMContext context;
+        StatusOr<std::unique_ptr<llvm::Module>> module =
+            partitioning.BuildPartition(i, context);
+        if (!module.ok()) {
+          object_files[i] = module.status();
+          return;
+        }
+        llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> object_file =
+            jit.CompileModule(**module);
+        if (!object_file) {
+          object_files[i] =
+              InternalError("Compiling LLVM module partition %d failed: %s", i,
+                            llvm::toString(object_file.takeError()));
+          return;
+        }
+        object_files[i] = std::move(*object_file);
+      });
+    }
+    // The destructor of the thread pool waits for the compilations.
+  }
+  for (auto& object_file : object_files) {
+    TF_RETURN_IF_ERROR(object_file.status());
+    if (llvm::Error error = jit.AddObjectFile(std::move(object_file).value())) {
+      return InternalError("Adding an LLVM module partition failed: %s",
+                           llvm::toString(std::move(error)));
+    }
+  }
+  return OkStatus();
+}
+
 Status LowerMLIRModule(mlir::ModuleOp mlir_module,
                        mlir::MLIRContext& mlir_context) {
   LoadMLIRDialects(mlir_context);
@@ -1148,6 +1361,14 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
   const bool embed_ir_in_executable =
       module->config().debug_options().xla_embed_ir_in_executable();
 
+  // The IR hooks and dumps see a single module, so the module is only split
+  // for parallel compilation when they are not needed.
+  const int compilation_parallelism =
+      CompilationParallelism(module->config());
+  const bool compile_in_parallel =
+      compilation_parallelism > 1 && !user_pre_optimization_hook_ &&
+      !user_post_optimization_hook_ && !DumpingEnabledForHloModule(*module);
+
   // Select an order for emitting the HLO instructions for each
   // computation. Using this sequence enables tighter buffer liveness analysis
   // and reduced memory usage (as compared to using DependencyHloOrdering).
@@ -1207,6 +1428,10 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
     );
 
     TF_RETURN_IF_ERROR(ir_emitter.EmitConstantGlobals());
+    if (compile_in_parallel) {
+      ir_emitter.set_externally_visible_computations(
+          ComputationsToCompileSeparately(*module));
+    }
 
     for (ComputationToEmit subcomputation :
          SubcomputationEmissionOrder(entry_computation)) {
@@ -1250,10 +1475,24 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
 
   TF_RETURN_IF_ERROR(VerifyLlvmModule(*llvm_module));
 
-  // JIT compile the LLVM IR module to in-memory machine code.
-  llvm::orc::ThreadSafeModule thread_safe_module(std::move(llvm_module),
-                                                 std::move(llvm_context));
-  cantFail((*jit)->AddModule(std::move(thread_safe_module)));
+  // JIT compile the LLVM IR module to in-memory machine code, split into
+  // partitions that are compiled in parallel if it is large enough.
+  std::optional<ModulePartitioning> partitioning;
+  if (compile_in_parallel) {
+    partitioning =
+        ModulePartitioning::Create(*llvm_module, compilation_parallelism);
+  }
+  if (partitioning.has_value() && partitioning->num_partitions() > 1) {
+    VLOG(1) << "Compiling " << module->name() << " in "
+            << partitioning->num_partitions() << " partitions";
+    llvm_module.reset();
+    llvm_context.reset();
+    TF_RETURN_IF_ERROR(CompileModulePartitions(*partitioning, **jit));
+  } else {
+    llvm::orc::ThreadSafeModule thread_safe_module(std::move(llvm_module),
+                                                   std::move(llvm_context));
+    cantFail((*jit)->AddModule(std::move(thread_safe_module)));
+  }
 
   auto cpu_executable = std::make_unique<CpuExecutable>(
       std::move(*jit), std::move(assignment), std::move(module), function_name,
@@ -0,0 +1,240 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/dot_autotuner.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_opcode.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/proto/proto_utils.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+// (device, DotAutotuneKey) pairs, ordered so that saved results are stable.
+using DotAutotuneCacheKey = std::pair<std::string, std::string>;
+
+absl::Mutex autotune_cache_lock(absl::kConstInit);
+auto& autotune_cache ABSL_GUARDED_BY(autotune_cache_lock) =
+    *new std::map<DotAutotuneCacheKey, tensorflow::AutotuneResult>();
+auto& loaded_results_paths ABSL_GUARDED_BY(autotune_cache_lock) =
+    *new absl::flat_hash_set<std::string>();
+
+// Serializes measurements, so that modules compiled concurrently don't
+// disturb each other's timings or measure the same dot twice.
+absl::Mutex measurement_lock(absl::kConstInit);
+
+tensorflow::AutotuneResult ToAutotuneResult(const DotBackendConfig& config,
+                                            absl::Duration run_time) {
+  tensorflow::AutotuneResult result;
+  result.mutable_algorithm()->set_algo_id(config.strategy());
+  auto& tuning_knobs = *result.mutable_algorithm()->mutable_tuning_knobs();
+  for (int i = 0; i < config.tile_sizes_size(); ++i) {
+    tuning_knobs[i] = config.tile_sizes(i);
+  }
+  *result.mutable_run_time() =
+      tensorflow::proto_utils::ToDurationProto(run_time);
+  return result;
+}
+
+DotBackendConfig FromAutotuneResult(const tensorflow::AutotuneResult& result) {
+  DotBackendConfig config;
+  if (DotStrategy_IsValid(result.algorithm().algo_id())) {
+    config.set_strategy(static_cast<DotStrategy>(result.algorithm().algo_id()));
+  }
+  const auto& tuning_knobs = result.algorithm().tuning_knobs();
+  for (int64_t i = 0; tuning_knobs.count(i); ++i) {
+    config.add_tile_sizes(tuning_knobs.at(i));
+  }
+  return config;
+}
+
+bool SameLowering(const DotBackendConfig& a, const DotBackendConfig& b) {
+  return a.strategy() == b.strategy() &&
+         absl::c_equal(a.tile_sizes(), b.tile_sizes());
+}
+
+// Returns the cached result for `key` if it is one of `candidates`. Results
+// loaded from a file may have been measured by a build with other candidates.
+std::optional<DotBackendConfig> LookUpCachedCandidate(
+    const DotAutotuneCacheKey& key,
+    const std::vector<DotBackendConfig>& candidates) {
+  absl::MutexLock lock(&autotune_cache_lock);
+  auto it = autotune_cache.find(key);
+  if (it == autotune_cache.end()) {
+    return std::nullopt;
+  }
+  DotBackendConfig cached = FromAutotuneResult(it->second);
+  for (const DotBackendConfig& candidate : candidates) {
+    if (SameLowering(candidate, cached)) {
+      return cached;
+    }
+  }
+  return std::nullopt;
+}
+
+Status LoadDotAutotuneResultsOnce(const std::string& path) {
+  {
+    absl::MutexLock lock(&autotune_cache_lock);
+    if (!loaded_results_paths.insert(path).second) {
+      return OkStatus();
+    }
+  }
+  if (!tensorflow::Env::Default()->FileExists(path).ok()) {
+    // Nothing was saved yet.
+    return OkStatus();
+  }
+  return LoadDotAutotuneResults(path);
+}
+
+}  // namespace
+
+std::string DotAutotuneKey(const HloInstruction& dot) {
+  return dot.ToString(HloPrintOptions::Canonical());
+}
+
+Status LoadDotAutotuneResults(const std::string& path) {
+  DotAutotuneResults results;
+  TF_RETURN_IF_ERROR(
+      tensorflow::ReadTextOrBinaryProto(tensorflow::Env::Default(), path,
+                                        &results));
+  absl::MutexLock lock(&autotune_cache_lock);
+  for (const DotAutotuneResults::Entry& entry : results.entries()) {
+    autotune_cache.emplace(DotAutotuneCacheKey(entry.device(), entry.dot()),
+                           entry.result());
+  }
+  return OkStatus();
+}
+
+Status SaveDotAutotuneResults(const std::string& path) {
+  DotAutotuneResults results;
+  {
+    absl::MutexLock lock(&autotune_cache_lock);
+    for (const auto& [key, result] : autotune_cache) {
+      DotAutotuneResults::Entry* entry = results.add_entries();
+      entry->set_device(key.first);
+      entry->set_dot(key.second);
+      *entry->mutable_result() = result;
+    }
+  }
+  return tensorflow::WriteTextProto(tensorflow::Env::Default(), path, results);
+}
+
+void ClearDotAutotuneResults() {
+  absl::MutexLock lock(&autotune_cache_lock);
+  autotune_cache.clear();
+  loaded_results_paths.clear();
+}
+
+StatusOr<std::optional<DotBackendConfig>> DotAutotuner::PickBestCandidate(
+    const HloInstruction& dot, bool* measured) {
+  std::vector<DotBackendConfig> candidates =
+      GetDotAutotuningCandidates(dot, target_machine_features_);
+  if (candidates.size() < 2) {
+    return {std::nullopt};
+  }
+
+  DotAutotuneCacheKey key(device_, DotAutotuneKey(dot));
+  if (std::optional<DotBackendConfig> cached =
+          LookUpCachedCandidate(key, candidates)) {
+    return cached;
+  }
+
+  absl::MutexLock lock(&measurement_lock);
+  // Another thread may have measured the same dot while we were waiting.
+  if (std::optional<DotBackendConfig> cached =
+          LookUpCachedCandidate(key, candidates)) {
+    return cached;
+  }
+
+  std::optional<DotBackendConfig> best;
+  absl::Duration best_run_time = absl::InfiniteDuration();
+  for (const DotBackendConfig& candidate : candidates) {
+    StatusOr<absl::Duration> run_time = measure_(dot, candidate);
+    if (!run_time.ok()) {
+      VLOG(1) << "Failed to measure " << candidate.ShortDebugString()
+              << " for " << dot.name() << ": " << run_time.status();
+      continue;
+    }
+    VLOG(2) << dot.name() << " as " << candidate.ShortDebugString()
+            << " took " << *run_time;
+    if (*run_time < best_run_time) {
+      best = candidate;
+      best_run_time = *run_time;
+    }
+  }
+  if (!best) {
+    return {std::nullopt};
+  }
+
+  VLOG(1) << "Picked " << best->ShortDebugString() << " for " << dot.name()
+          << " (" << best_run_time << ")";
+  *measured = true;
+  absl::MutexLock cache_lock(&autotune_cache_lock);
+  autotune_cache[key] = ToAutotuneResult(*best, best_run_time);
+  return best;
+}
+
+StatusOr<bool> DotAutotuner::Run(HloModule* module) {
+  if (!results_path_.empty()) {
+    Status status = LoadDotAutotuneResultsOnce(results_path_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load XLA:CPU dot autotuning results from "
+                   << results_path_ << ": " << status;
+    }
+  }
+
+  bool changed = false;
+  bool measured = false;
+  // Dots fused into matrix-vector products are lowered by the same emitter,
+  // so fusion computations are visited too.
+  for (HloComputation* computation : module->computations()) {
+    for (HloInstruction* instruction : computation->instructions()) {
+      if (instruction->opcode() != HloOpcode::kDot) {
+        continue;
+      }
+      TF_ASSIGN_OR_RETURN(std::optional<DotBackendConfig> best,
+                          PickBestCandidate(*instruction, &measured));
+      if (best) {
+        TF_RETURN_IF_ERROR(instruction->set_backend_config(*best));
+        changed = true;
+      }
+    }
+  }
+
+  if (measured && !results_path_.empty()) {
+    Status status = SaveDotAutotuneResults(results_path_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to save XLA:CPU dot autotuning results to "
+                   << results_path_ << ": " << status;
+    }
+  }
+  return changed;
+}
+
+}  // namespace cpu
+}  // namespace xla
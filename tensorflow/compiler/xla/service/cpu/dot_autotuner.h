@@ -0,0 +1,96 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_DOT_AUTOTUNER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_DOT_AUTOTUNER_H_
+
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "absl/time/time.h"
+#include "tensorflow/compiler/xla/service/cpu/cpu_autotuning.pb.h"
+#include "tensorflow/compiler/xla/service/cpu/target_machine_features.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+#include "tensorflow/compiler/xla/statusor.h"
+
+namespace xla {
+namespace cpu {
+
+// An HLO pass that picks the fastest lowering of each dot by measuring the
+// candidates returned by GetDotAutotuningCandidates, and records it as the
+// dot's DotBackendConfig for the dot emitter.
+//
+// Results are cached for the lifetime of the process and reused for dots with
+// the same shapes on the same device. If `results_path` is set, results are
+// also loaded from that file before measuring anything and written back to it
+// after new dots were measured, in the format of DotAutotuneResults.
+//
+// This pass must run after layout assignment: the candidates of a dot are
+// only interchangeable for the layouts it ends up with.
+class DotAutotuner : public HloModulePass {
+ public:
+  // Returns how long `dot` takes to run when lowered as `candidate`.
+  using MeasureFunction = std::function<StatusOr<absl::Duration>(
+      const HloInstruction& dot, const DotBackendConfig& candidate)>;
+
+  // `device` describes the host that `measure` runs on, e.g. its target
+  // triple, CPU name and features; results measured on a different device
+  // are never reused.
+  DotAutotuner(std::string device,
+               const TargetMachineFeatures* target_machine_features,
+               MeasureFunction measure, std::string results_path = "")
+      : device_(std::move(device)),
+        target_machine_features_(*target_machine_features),
+        measure_(std::move(measure)),
+        results_path_(std::move(results_path)) {}
+
+  absl::string_view name() const override { return "cpu-dot-autotuner"; }
+
+  StatusOr<bool> Run(HloModule* module) override;
+
+ private:
+  // Returns the fastest candidate for `dot`, measuring the candidates unless
+  // the result is cached. Returns std::nullopt if no candidate could be
+  // measured.
+  StatusOr<std::optional<DotBackendConfig>> PickBestCandidate(
+      const HloInstruction& dot, bool* measured);
+
+  const std::string device_;
+  const TargetMachineFeatures& target_machine_features_;
+  const MeasureFunction measure_;
+  const std::string results_path_;
+};
+
+// Returns the part of the autotuning cache key that identifies `dot`: its
+// operand and result shapes with layouts, dimension numbers and precision.
+std::string DotAutotuneKey(const HloInstruction& dot);
+
+// Merges the results in `path`, a text or binary DotAutotuneResults proto,
+// into the process-wide autotuning cache. Entries already in the cache win.
+Status LoadDotAutotuneResults(const std::string& path);
+
+// Writes the process-wide autotuning cache to `path` as a text proto.
+Status SaveDotAutotuneResults(const std::string& path);
+
+// Clears the process-wide autotuning cache, for tests.
+void ClearDotAutotuneResults();
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_DOT_AUTOTUNER_H_
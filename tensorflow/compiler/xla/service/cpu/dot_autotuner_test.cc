@@ -0,0 +1,172 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/dot_autotuner.h"
+
+#include <string>
+
+#include "tensorflow/compiler/xla/cpu_function_runtime.h"
+#include "tensorflow/compiler/xla/service/cpu/target_machine_features_fake.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+constexpr char kGemmHlo[] = R"(
+HloModule gemm
+
+ENTRY main {
+  lhs = f32[64,32]{1,0} parameter(0)
+  rhs = f32[32,48]{1,0} parameter(1)
+  ROOT dot = f32[64,48]{1,0} dot(lhs, rhs), lhs_contracting_dims={1},
+      rhs_contracting_dims={0}
+}
+)";
+
+class DotAutotunerTest : public HloTestBase {
+ protected:
+  DotAutotunerTest()
+      : target_machine_features_([](int64_t size) {
+          return cpu_function_runtime::MinAlign();
+        }) {
+    ClearDotAutotuneResults();
+  }
+
+  // Pretends that the tiled LLVM IR GEMM with 8x8x1 tiles is the fastest
+  // lowering, and counts the measurements.
+  DotAutotuner::MeasureFunction FakeMeasure() {
+    return [this](const HloInstruction& dot, const DotBackendConfig& config)
+               -> StatusOr<absl::Duration> {
+      ++num_measurements_;
+      if (config.strategy() == TILED_LLVM_IR_GEMM &&
+          config.tile_sizes(0) == 8) {
+        return absl::Microseconds(1);
+      }
+      return absl::Microseconds(10);
+    };
+  }
+
+  StatusOr<DotBackendConfig> RunAutotuner(absl::string_view hlo,
+                                          DotAutotuner::MeasureFunction measure,
+                                          const std::string& path = "") {
+    TF_ASSIGN_OR_RETURN(std::unique_ptr<HloModule> module,
+                        ParseAndReturnVerifiedModule(hlo));
+    DotAutotuner autotuner("device", &target_machine_features_,
+                           std::move(measure), path);
+    TF_ASSIGN_OR_RETURN(bool changed, autotuner.Run(module.get()));
+    if (!changed) {
+      return NotFound("No dot was autotuned");
+    }
+    return module->entry_computation()
+        ->root_instruction()
+        ->backend_config<DotBackendConfig>();
+  }
+
+  TargetMachineFeaturesWithFakeAlignmentLogic target_machine_features_;
+  int num_measurements_ = 0;
+};
+
+TEST_F(DotAutotunerTest, PicksFastestCandidate) {
+  TF_ASSERT_OK_AND_ASSIGN(DotBackendConfig config,
+                          RunAutotuner(kGemmHlo, FakeMeasure()));
+  EXPECT_EQ(config.strategy(), TILED_LLVM_IR_GEMM);
+  EXPECT_THAT(config.tile_sizes(), ::testing::ElementsAre(8, 8, 1));
+  EXPECT_GT(num_measurements_, 1);
+}
+
+TEST_F(DotAutotunerTest, ReusesResultsForSameShapes) {
+  TF_ASSERT_OK(RunAutotuner(kGemmHlo, FakeMeasure()).status());
+  int num_measurements = num_measurements_;
+  TF_ASSERT_OK_AND_ASSIGN(DotBackendConfig config,
+                          RunAutotuner(kGemmHlo, FakeMeasure()));
+  EXPECT_EQ(num_measurements_, num_measurements);
+  EXPECT_EQ(config.strategy(), TILED_LLVM_IR_GEMM);
+}
+
+TEST_F(DotAutotunerTest, SkipsFailedCandidates) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      DotBackendConfig config,
+      RunAutotuner(kGemmHlo,
+                   [](const HloInstruction&, const DotBackendConfig& config)
+                       -> StatusOr<absl::Duration> {
+                     if (config.strategy() != EIGEN) {
+                       return InternalError("Failed to compile");
+                     }
+                     return absl::Microseconds(10);
+                   }));
+  EXPECT_EQ(config.strategy(), EIGEN);
+}
+
+TEST_F(DotAutotunerTest, TunesMatrixVectorProducts) {
+  constexpr char kGemvHlo[] = R"(
+HloModule gemv
+
+ENTRY main {
+  lhs = f32[64,32]{1,0} parameter(0)
+  rhs = f32[32]{0} parameter(1)
+  ROOT dot = f32[64]{0} dot(lhs, rhs), lhs_contracting_dims={1},
+      rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(
+      DotBackendConfig config,
+      RunAutotuner(kGemvHlo,
+                   [](const HloInstruction&, const DotBackendConfig& config)
+                       -> StatusOr<absl::Duration> {
+                     return absl::Microseconds(config.tile_sizes(0) == 4 ? 1
+                                                                         : 10);
+                   }));
+  EXPECT_EQ(config.strategy(), TILED_LLVM_IR_GEMV);
+  EXPECT_THAT(config.tile_sizes(), ::testing::ElementsAre(4));
+}
+
+TEST_F(DotAutotunerTest, PersistsResults) {
+  std::string path = tensorflow::io::JoinPath(tensorflow::testing::TmpDir(),
+                                              "dot_autotune_results.pbtxt");
+  tensorflow::Env::Default()->DeleteFile(path).IgnoreError();
+  TF_ASSERT_OK(RunAutotuner(kGemmHlo, FakeMeasure(), path).status());
+
+  DotAutotuneResults results;
+  TF_ASSERT_OK(tensorflow::ReadTextProto(tensorflow::Env::Default(), path,
+                                         &results));
+  ASSERT_EQ(results.entries_size(), 1);
+  EXPECT_EQ(results.entries(0).device(), "device");
+  EXPECT_EQ(results.entries(0).result().algorithm().algo_id(),
+            TILED_LLVM_IR_GEMM);
+
+  // A new process reuses the saved results instead of measuring.
+  ClearDotAutotuneResults();
+  TF_ASSERT_OK_AND_ASSIGN(
+      DotBackendConfig config,
+      RunAutotuner(kGemmHlo,
+                   [](const HloInstruction&, const DotBackendConfig&)
+                       -> StatusOr<absl::Duration> {
+                     return InternalError("Unexpected measurement");
+                   },
+                   path));
+  EXPECT_EQ(config.strategy(), TILED_LLVM_IR_GEMM);
+  EXPECT_THAT(config.tile_sizes(), ::testing::ElementsAre(8, 8, 1));
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
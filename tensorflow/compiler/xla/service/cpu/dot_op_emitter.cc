@@ -33,6 +33,7 @@ limitations under the License.
 #include "mlir/IR/Value.h"  // from @llvm-project
 #include "mlir/Pass/Pass.h"  // from @llvm-project
 #include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/service/cpu/cpu_autotuning.pb.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_runtime.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
@@ -70,6 +71,8 @@ struct DotInfo {
   Shape rhs_shape;
   Shape result_shape;
   DotDimensionNumbers dim_nums;
+  // The lowering picked by the dot autotuner, if any.
+  DotBackendConfig backend_config;
 
   DotInfo() = default;
 
@@ -79,6 +82,13 @@ struct DotInfo {
     rhs_shape = instr.operand(1)->shape();
     result_shape = instr.shape();
     dim_nums = instr.dot_dimension_numbers();
+    if (instr.has_backend_config()) {
+      StatusOr<DotBackendConfig> config =
+          instr.backend_config<DotBackendConfig>();
+      if (config.ok()) {
+        backend_config = std::move(config).value();
+      }
+    }
   }
 };
 
@@ -189,6 +199,11 @@ class DotOpEmitter {
   // registers.
   int64_t GetGemvTilingFactor() const {
     const int64_t kDefaultTilingFactor = 8;
+    const DotBackendConfig& config = dot_info_.backend_config;
+    if (config.strategy() == TILED_LLVM_IR_GEMV &&
+        config.tile_sizes_size() == 1) {
+      return config.tile_sizes(0);
+    }
     return options::LlvmIrGemvTilingFactor(hlo_module_config_)
         .value_or(kDefaultTilingFactor);
   }
@@ -200,6 +215,12 @@ class DotOpEmitter {
     // information in one place.
     const std::tuple<int64_t, int64_t, int64_t> kDefaultTileSize =
         std::tuple<int64_t, int64_t, int64_t>(11, 9, 1);
+    const DotBackendConfig& config = dot_info_.backend_config;
+    if (config.strategy() == TILED_LLVM_IR_GEMM &&
+        config.tile_sizes_size() == 3) {
+      return std::make_tuple(config.tile_sizes(0), config.tile_sizes(1),
+                             config.tile_sizes(2));
+    }
     return options::LlvmIrGemmTileSize(hlo_module_config_)
         .value_or(kDefaultTileSize);
   }
@@ -761,6 +782,11 @@ Status DotOpEmitter::EmitCallToRuntime() {
 
   bool multi_threaded = ShouldUseMultiThreadedEigen(hlo_module_config_);
   bool use_mkl_dnn = hlo_module_config_.debug_options().xla_cpu_use_mkl_dnn();
+  if (dot_info_.backend_config.strategy() == EIGEN) {
+    use_mkl_dnn = false;
+  } else if (dot_info_.backend_config.strategy() == MKL) {
+    use_mkl_dnn = true;
+  }
   PrimitiveType type = target_array_.GetShape().element_type();
   llvm::Function* function = b_->GetInsertBlock()->getParent();
   llvm::Module* module = function->getParent();
@@ -992,6 +1018,27 @@ bool IsAlignedGemm(const DotInfo& dot_info,
                        dot_info.result_shape, target_machine_features);
 }
 
+// Returns true if the tiled LLVM IR GEMM emitter supports `dot_info`,
+// regardless of whether it is expected to be faster than Eigen.
+bool TiledLlvmIrGemmSupportsDot(const DotInfo& dot_info) {
+  bool lhs_canonical = dot_info.dim_nums.lhs_contracting_dimensions(0) == 1;
+  bool rhs_canonical = dot_info.dim_nums.rhs_contracting_dimensions(0) == 0;
+
+  if (!(lhs_canonical && rhs_canonical)) {
+    return false;
+  }
+
+  if (dot_info.result_shape.element_type() == F16 ||
+      dot_info.result_shape.element_type() == C64 ||
+      dot_info.result_shape.element_type() == C128) {
+    // TODO(sanjoy): This is probably easy to fix, but I want to keep the CL
+    // adding this comment NFC.
+    return false;
+  }
+
+  return true;
+}
+
 bool CanEmitTiledLlvmIrGemm(
     const HloModuleConfig& config, const DotInfo& dot_info,
     const TargetMachineFeatures& target_machine_features) {
@@ -1015,27 +1062,29 @@ bool CanEmitTiledLlvmIrGemm(
     }
   }
 
-  bool lhs_canonical = dot_info.dim_nums.lhs_contracting_dimensions(0) == 1;
-  bool rhs_canonical = dot_info.dim_nums.rhs_contracting_dimensions(0) == 0;
-
-  if (!(lhs_canonical && rhs_canonical)) {
-    return false;
-  }
-
-  if (dot_info.result_shape.element_type() == F16 ||
-      dot_info.result_shape.element_type() == C64 ||
-      dot_info.result_shape.element_type() == C128) {
-    // TODO(sanjoy): This is probably easy to fix, but I want to keep the CL
-    // adding this comment NFC.
-    return false;
-  }
-
-  return true;
+  return TiledLlvmIrGemmSupportsDot(dot_info);
 }
 
 DotImplementationStrategy GetDotImplementationStrategy(
     const HloModuleConfig& config, const DotInfo& dot_info,
     const TargetMachineFeatures& target_machine_features) {
+  // The autotuner only picks among lowerings that need the same layouts as
+  // the one picked below, so its choice can be honored after layout
+  // assignment.
+  switch (dot_info.backend_config.strategy()) {
+    case NAIVE_LLVM_IR:
+      return DotImplementationStrategy::kNaiveLlvmIr;
+    case TILED_LLVM_IR_GEMV:
+      return DotImplementationStrategy::kTiledLlvmIrGemv;
+    case TILED_LLVM_IR_GEMM:
+      return DotImplementationStrategy::kTiledLlvmIrGemm;
+    case EIGEN:
+    case MKL:
+      return DotImplementationStrategy::kEigen;
+    default:
+      break;
+  }
+
   PrimitiveType element_type = dot_info.result_shape.element_type();
   // Any Matrix-Vector product of floating point or integral type, or
   // a transpose-dot fusion of the same can be lowered to a tiled LLVM
@@ -1265,6 +1314,59 @@ bool DotOperandsAndResultMustHaveRowMajorLayout(
          impl_strategy == DotImplementationStrategy::kEigen;
 }
 
+std::vector<DotBackendConfig> GetDotAutotuningCandidates(
+    const HloInstruction& dot,
+    const TargetMachineFeatures& target_machine_features) {
+  std::vector<DotBackendConfig> candidates;
+  if (dot.opcode() != HloOpcode::kDot || IsBatchDot(dot)) {
+    return candidates;
+  }
+  auto add_candidate = [&](DotStrategy strategy,
+                           std::vector<int64_t> tile_sizes) {
+    DotBackendConfig& candidate = candidates.emplace_back();
+    candidate.set_strategy(strategy);
+    for (int64_t tile_size : tile_sizes) {
+      candidate.add_tile_sizes(tile_size);
+    }
+  };
+
+  DotInfo dot_info(dot);
+  dot_info.backend_config.Clear();
+  switch (GetDotImplementationStrategy(dot.GetModule()->config(), dot_info,
+                                       target_machine_features)) {
+    case DotImplementationStrategy::kTiledLlvmIrGemv:
+      for (int64_t tiling_factor : {2, 4, 8, 16}) {
+        add_candidate(TILED_LLVM_IR_GEMV, {tiling_factor});
+      }
+      break;
+
+    case DotImplementationStrategy::kTiledLlvmIrGemm:
+    case DotImplementationStrategy::kEigen: {
+      // Both lowerings need row major operands and result, so either can be
+      // used for an aligned GEMM after layout assignment.
+      add_candidate(EIGEN, {});
+#ifdef ENABLE_MKL
+      PrimitiveType type = dot_info.result_shape.element_type();
+      if (type == F32 || type == F64) {
+        add_candidate(MKL, {});
+      }
+#endif  // ENABLE_MKL
+      if (TiledLlvmIrGemmSupportsDot(dot_info)) {
+        for (std::vector<int64_t> tile_size :
+             {std::vector<int64_t>{11, 9, 1}, std::vector<int64_t>{8, 8, 1},
+              std::vector<int64_t>{4, 8, 2}, std::vector<int64_t>{16, 4, 1}}) {
+          add_candidate(TILED_LLVM_IR_GEMM, std::move(tile_size));
+        }
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+  return candidates;
+}
+
 Status EmitDotOperation(const HloInstruction& dot,
                         const llvm_ir::IrArray& target_array,
                         const llvm_ir::IrArray& lhs_array,
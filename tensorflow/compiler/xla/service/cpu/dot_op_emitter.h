@@ -16,9 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_DOT_OP_EMITTER_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_DOT_OP_EMITTER_H_
 
+#include <vector>
+
 #include "absl/strings/string_view.h"
 #include "llvm/IR/IRBuilder.h"
 #include "mlir/IR/MLIRContext.h"  // from @llvm-project
+#include "tensorflow/compiler/xla/service/cpu/cpu_autotuning.pb.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
 #include "tensorflow/compiler/xla/service/cpu/target_machine_features.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
@@ -48,6 +51,13 @@ bool DotImplementationCanHandleTranspose(
 std::optional<int64_t> ProfitableToMakeDotOperandColumnMajor(
     const HloInstruction& hlo);
 
+// Returns the lowerings of `dot` that the dot autotuner should measure, as
+// backend configs for it. Returns fewer than two candidates if there is
+// nothing to choose from, e.g. for batch dots or dots lowered as naive loops.
+std::vector<DotBackendConfig> GetDotAutotuningCandidates(
+    const HloInstruction& dot,
+    const TargetMachineFeatures& target_machine_features);
+
 // Emit LLVM IR to perform the dot operation on lhs_array and rhs_array and
 // place the result in target_array. IR is emitted at current insert point of
 // the builder. Upon completion of the method, the insert point is set to the
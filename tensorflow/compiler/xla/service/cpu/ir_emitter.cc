@@ -193,7 +193,8 @@ StatusOr<llvm::Function*> IrEmitter::EmitComputation(
         param->parameter_number();
   }
 
-  InitializeIrFunction(function_name);
+  InitializeIrFunction(function_name,
+                       externally_visible_computations_.contains(computation));
   // The rdtscp instruction is x86 specific.  We will fallback to LLVM's generic
   // readcyclecounter if it is unavailable.
   bool use_rdtscp = arch_type_ == llvm::Triple::ArchType::x86 ||
@@ -235,13 +236,15 @@ StatusOr<llvm::Function*> IrEmitter::EmitComputation(
   return ir_function;
 }
 
-void IrEmitter::InitializeIrFunction(const std::string& function_name) {
+void IrEmitter::InitializeIrFunction(const std::string& function_name,
+                                     bool externally_visible) {
   // Functions with local linkage get an inlining bonus.  Because we know
   // a-priori that embedded functions (non-entry functions) will not have its
-  // name resolved, give it local linkage.
+  // name resolved, give it local linkage, unless it is compiled separately.
   llvm::Function::LinkageTypes linkage =
-      is_top_level_computation_ ? llvm::GlobalValue::ExternalLinkage
-                                : llvm::GlobalValue::InternalLinkage;
+      is_top_level_computation_ || externally_visible
+          ? llvm::GlobalValue::ExternalLinkage
+          : llvm::GlobalValue::InternalLinkage;
   // Create and initialize new IrFunction.
   compute_function_.reset(new IrFunction(function_name, linkage,
                                          hlo_module_config_, module_, &b_,
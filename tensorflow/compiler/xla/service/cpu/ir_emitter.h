@@ -26,6 +26,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "llvm/ADT/Triple.h"
@@ -130,6 +131,14 @@ class IrEmitter : public DfsHloVisitorWithDefault,
   // Emit an LLVM global variable for every constant buffer allocation.
   Status EmitConstantGlobals();
 
+  // Gives the functions of `computations` external linkage, so that they can
+  // be compiled in a different LLVM module than their callers, at the cost of
+  // not being inlined into them.
+  void set_externally_visible_computations(
+      absl::flat_hash_set<const HloComputation*> computations) {
+    externally_visible_computations_ = std::move(computations);
+  }
+
  protected:
   //
   // The following methods implement the DfsHloVisitor interface.
@@ -198,7 +207,8 @@ class IrEmitter : public DfsHloVisitorWithDefault,
   Status HandleAllReduceMultipleReplica(HloInstruction* crs);
 
   // Private helper to initialize an IR function for the computation.
-  void InitializeIrFunction(const std::string& function_name);
+  void InitializeIrFunction(const std::string& function_name,
+                            bool externally_visible);
 
   // Emits the copying epilogue for the function,
   // where it copies the returned value to the reserved alloca.
@@ -462,6 +472,9 @@ class IrEmitter : public DfsHloVisitorWithDefault,
   // Used to produce unique names for generated functions.
   NameUniquer name_uniquer_;
 
+  // The non-top-level computations whose functions have external linkage.
+  absl::flat_hash_set<const HloComputation*> externally_visible_computations_;
+
   struct ComputationToEmit {
     const HloComputation* computation;
     bool allow_reassociation;
@@ -0,0 +1,134 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/llvm_module_partitioning.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/compiler/xla/util.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+bool IsExternalDefinition(const llvm::Function& function) {
+  return !function.isDeclaration() && !function.hasLocalLinkage();
+}
+
+// Returns the number of instructions of `function` and of the local functions
+// it transitively references, which are copied into its partition.
+int64_t InstructionCountWithLocalCallees(const llvm::Function& function) {
+  int64_t count = 0;
+  std::vector<const llvm::Function*> worklist = {&function};
+  absl::flat_hash_set<const llvm::Function*> visited = {&function};
+  while (!worklist.empty()) {
+    const llvm::Function* current = worklist.back();
+    worklist.pop_back();
+    count += current->getInstructionCount();
+    for (const llvm::BasicBlock& block : *current) {
+      for (const llvm::Instruction& instruction : block) {
+        for (const llvm::Value* operand : instruction.operands()) {
+          const auto* callee =
+              llvm::dyn_cast<llvm::Function>(operand->stripPointerCasts());
+          if (callee != nullptr && callee->hasLocalLinkage() &&
+              !callee->isDeclaration() && visited.insert(callee).second) {
+            worklist.push_back(callee);
+          }
+        }
+      }
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+/*static*/ ModulePartitioning ModulePartitioning::Create(
+    const llvm::Module& module, int max_partitions) {
+  std::vector<std::pair<int64_t, const llvm::Function*>> functions;
+  for (const llvm::Function& function : module) {
+    if (IsExternalDefinition(function)) {
+      functions.emplace_back(InstructionCountWithLocalCallees(function),
+                             &function);
+    }
+  }
+  const int num_partitions = std::max<int>(
+      1, std::min<int64_t>(max_partitions, functions.size()));
+
+  // Assign the largest functions first, each to the smallest partition.
+  std::stable_sort(
+      functions.begin(), functions.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+  ModulePartitioning partitioning;
+  partitioning.partition_functions_.resize(num_partitions);
+  std::vector<int64_t> partition_sizes(num_partitions, 0);
+  for (const auto& [size, function] : functions) {
+    const int partition = std::min_element(partition_sizes.begin(),
+                                           partition_sizes.end()) -
+                          partition_sizes.begin();
+    partition_sizes[partition] += size;
+    partitioning.partition_functions_[partition].insert(
+        function->getName().str());
+  }
+
+  if (num_partitions > 1) {
+    llvm::raw_string_ostream os(partitioning.bitcode_);
+    llvm::WriteBitcodeToFile(module, os);
+    os.flush();
+  }
+  return partitioning;
+}
+
+StatusOr<std::unique_ptr<llvm::Module>> ModulePartitioning::BuildPartition(
+    int partition, llvm::LLVMContext& context) const {
+  TF_RET_CHECK(num_partitions() > 1);
+  TF_RET_CHECK(partition >= 0 && partition < num_partitions());
+
+  const std::string name = absl::StrCat("partition_", partition);
+  llvm::Expected<std::unique_ptr<llvm::Module>> module =
+      llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode_, name), context);
+  if (!module) {
+    return InternalError("Failed to parse LLVM module partition %d: %s",
+                         partition, llvm::toString(module.takeError()));
+  }
+
+  const absl::flat_hash_set<std::string>& functions =
+      partition_functions_[partition];
+  for (llvm::Function& function : **module) {
+    if (IsExternalDefinition(function) &&
+        !functions.contains(function.getName().str())) {
+      function.deleteBody();
+    }
+  }
+
+  // Drop the local functions and globals that only the deleted bodies used.
+  llvm::legacy::PassManager passes;
+  passes.add(llvm::createGlobalDCEPass());
+  passes.run(**module);
+  return std::move(*module);
+}
+
+}  // namespace cpu
+}  // namespace xla
@@ -0,0 +1,64 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_LLVM_MODULE_PARTITIONING_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_LLVM_MODULE_PARTITIONING_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "tensorflow/compiler/xla/statusor.h"
+
+namespace xla {
+namespace cpu {
+
+// A split of an LLVM module into partitions that can be optimized and compiled
+// independently, on different threads, and then linked together by the JIT.
+//
+// Each externally visible function definition is kept in exactly one partition
+// and declared in the others. Functions and globals with local linkage are
+// copied into every partition that uses them, which is safe for the IR that
+// XLA emits: its globals are constants whose address is not significant.
+class ModulePartitioning {
+ public:
+  // Assigns the externally visible function definitions of `module` to at
+  // most `max_partitions` partitions of similar sizes, counting for each
+  // function the instructions of the local functions it calls.
+  static ModulePartitioning Create(const llvm::Module& module,
+                                   int max_partitions);
+
+  int num_partitions() const { return partition_functions_.size(); }
+
+  // Builds partition `partition` in `context`, if there is more than one
+  // partition. May be called concurrently with different contexts.
+  StatusOr<std::unique_ptr<llvm::Module>> BuildPartition(
+      int partition, llvm::LLVMContext& context) const;
+
+ private:
+  // The module, serialized to bitcode.
+  std::string bitcode_;
+
+  // The names of the externally visible functions defined in each partition.
+  std::vector<absl::flat_hash_set<std::string>> partition_functions_;
+};
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_LLVM_MODULE_PARTITIONING_H_
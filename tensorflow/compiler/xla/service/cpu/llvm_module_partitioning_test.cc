@@ -0,0 +1,121 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/llvm_module_partitioning.h"
+
+#include <memory>
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+constexpr char kModule[] = R"(
+@constant = private unnamed_addr constant [2 x i32] [i32 1, i32 2]
+
+define internal i32 @helper() {
+  %p = getelementptr [2 x i32], [2 x i32]* @constant, i32 0, i32 1
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+define i32 @big() {
+  %a = call i32 @helper()
+  %b = add i32 %a, 1
+  %c = add i32 %b, 1
+  %d = add i32 %c, 1
+  ret i32 %d
+}
+
+define i32 @small() {
+  ret i32 0
+}
+
+define i32 @entry() {
+  %a = call i32 @big()
+  %b = call i32 @small()
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+)";
+
+std::unique_ptr<llvm::Module> ParseModule(llvm::LLVMContext& context) {
+  llvm::SMDiagnostic error;
+  std::unique_ptr<llvm::Module> module =
+      llvm::parseAssemblyString(kModule, error, context);
+  CHECK(module != nullptr) << error.getMessage().str();
+  return module;
+}
+
+bool Defines(const llvm::Module& module, llvm::StringRef name) {
+  const llvm::Function* function = module.getFunction(name);
+  return function != nullptr && !function->isDeclaration();
+}
+
+TEST(ModulePartitioningTest, SplitsExternalFunctions) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module = ParseModule(context);
+  ModulePartitioning partitioning =
+      ModulePartitioning::Create(*module, /*max_partitions=*/2);
+  ASSERT_EQ(partitioning.num_partitions(), 2);
+
+  // @big and @helper are the largest, so they get a partition of their own.
+  llvm::LLVMContext big_context;
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<llvm::Module> big,
+                          partitioning.BuildPartition(0, big_context));
+  EXPECT_FALSE(llvm::verifyModule(*big, &llvm::errs()));
+  EXPECT_TRUE(Defines(*big, "big"));
+  EXPECT_TRUE(Defines(*big, "helper"));
+  EXPECT_NE(big->getGlobalVariable("constant", /*AllowInternal=*/true),
+            nullptr);
+  EXPECT_FALSE(Defines(*big, "entry"));
+  EXPECT_FALSE(Defines(*big, "small"));
+
+  llvm::LLVMContext rest_context;
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<llvm::Module> rest,
+                          partitioning.BuildPartition(1, rest_context));
+  EXPECT_FALSE(llvm::verifyModule(*rest, &llvm::errs()));
+  EXPECT_TRUE(Defines(*rest, "entry"));
+  EXPECT_TRUE(Defines(*rest, "small"));
+  ASSERT_NE(rest->getFunction("big"), nullptr);
+  EXPECT_TRUE(rest->getFunction("big")->isDeclaration());
+  // The local function and constant only used by @big are dropped.
+  EXPECT_EQ(rest->getFunction("helper"), nullptr);
+  EXPECT_EQ(rest->getGlobalVariable("constant", /*AllowInternal=*/true),
+            nullptr);
+}
+
+TEST(ModulePartitioningTest, AtMostOnePartitionPerFunction) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module = ParseModule(context);
+  EXPECT_EQ(ModulePartitioning::Create(*module, /*max_partitions=*/16)
+                .num_partitions(),
+            3);
+  EXPECT_EQ(ModulePartitioning::Create(*module, /*max_partitions=*/1)
+                .num_partitions(),
+            1);
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
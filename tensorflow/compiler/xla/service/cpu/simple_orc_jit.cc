@@ -104,7 +104,12 @@ SimpleOrcJIT::SimpleOrcJIT(
     LLVMCompiler::ModuleHook pre_optimization_hook,
     LLVMCompiler::ModuleHook post_optimization_hook,
     std::function<void(const llvm::object::ObjectFile&)> post_codegen_hook)
-    : target_machine_(InferTargetMachineForJIT(target_options, opt_level)),
+    : target_options_(target_options),
+      opt_level_(opt_level),
+      optimize_for_size_(optimize_for_size),
+      disable_expensive_passes_(disable_expensive_passes),
+      fast_math_flags_(fast_math_flags),
+      target_machine_(InferTargetMachineForJIT(target_options, opt_level)),
       target_triple_(target_machine_->getTargetTriple()),
       data_layout_(target_machine_->createDataLayout()),
       target_process_control_(std::move(target_process_control)),
@@ -234,6 +239,21 @@ llvm::Error SimpleOrcJIT::AddModule(llvm::orc::ThreadSafeModule module) {
   return compile_layer_.add(*main_jit_dylib_, std::move(module));
 }
 
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> SimpleOrcJIT::CompileModule(
+    llvm::Module& module) const {
+  std::unique_ptr<llvm::TargetMachine> target_machine =
+      InferTargetMachineForJIT(target_options_, opt_level_);
+  CompilerFunctor compiler(target_machine.get(), opt_level_,
+                           optimize_for_size_, disable_expensive_passes_,
+                           fast_math_flags_);
+  return compiler(module);
+}
+
+llvm::Error SimpleOrcJIT::AddObjectFile(
+    std::unique_ptr<llvm::MemoryBuffer> object_file) {
+  return object_layer_.add(*main_jit_dylib_, std::move(object_file));
+}
+
 void SimpleOrcJIT::DoneCompiling() {
   // The target machine takes a non-trivial amount of memory, so once we are
   // done compiling throw it away.
@@ -79,6 +79,16 @@ class SimpleOrcJIT : public llvm::JITEventListener {
 
   llvm::Error AddModule(llvm::orc::ThreadSafeModule module);
 
+  // Optimizes and compiles `module` to an object file, with a target machine of
+  // its own and without running the IR hooks, so that modules in different
+  // contexts can be compiled concurrently. Must be called before
+  // DoneCompiling.
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> CompileModule(
+      llvm::Module& module) const;
+
+  // Adds an object file produced by CompileModule.
+  llvm::Error AddObjectFile(std::unique_ptr<llvm::MemoryBuffer> object_file);
+
   // Discards objects we no longer need once we are done compiling.
   void DoneCompiling();
 
@@ -108,6 +118,14 @@ class SimpleOrcJIT : public llvm::JITEventListener {
       const llvm::RuntimeDyld::LoadedObjectInfo& object_info) override;
   void notifyFreeingObject(llvm::JITEventListener::ObjectKey key) override;
 
+  // The options of the target machine and of the compiler, kept for
+  // CompileModule.
+  const llvm::TargetOptions target_options_;
+  const llvm::CodeGenOpt::Level opt_level_;
+  const bool optimize_for_size_;
+  const bool disable_expensive_passes_;
+  const llvm::FastMathFlags fast_math_flags_;
+
   std::unique_ptr<llvm::TargetMachine> target_machine_;
   llvm::Triple target_triple_;
   const llvm::DataLayout data_layout_;
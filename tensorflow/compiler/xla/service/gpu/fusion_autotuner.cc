@@ -0,0 +1,319 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/fusion_autotuner.h"
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_autotuning.pb.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_fusible.h"
+#include "tensorflow/compiler/xla/service/hlo_clone_context.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_module_config.h"
+#include "tensorflow/compiler/xla/service/hlo_opcode.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+// (device, producer, consumer), ordered so that saved results are stable.
+using FusionAutotuneCacheKey =
+    std::tuple<std::string, std::string, std::string>;
+
+absl::Mutex autotune_cache_lock(absl::kConstInit);
+auto& autotune_cache ABSL_GUARDED_BY(autotune_cache_lock) =
+    *new std::map<FusionAutotuneCacheKey, FusionAutotuneResults::Entry>();
+auto& loaded_results_paths ABSL_GUARDED_BY(autotune_cache_lock) =
+    *new absl::flat_hash_set<std::string>();
+
+// Serializes measurements, so that modules compiled concurrently don't
+// disturb each other's timings or measure the same pair twice.
+absl::Mutex measurement_lock(absl::kConstInit);
+
+std::string FusionAutotuneKey(const HloInstruction& instruction) {
+  return instruction.ToString(HloPrintOptions::Canonical());
+}
+
+FusionAutotuneCacheKey MakeCacheKey(absl::string_view device,
+                                    const HloInstruction& producer,
+                                    const HloInstruction& consumer) {
+  return FusionAutotuneCacheKey(std::string(device),
+                                FusionAutotuneKey(producer),
+                                FusionAutotuneKey(consumer));
+}
+
+bool IsCached(const FusionAutotuneCacheKey& key) {
+  absl::MutexLock lock(&autotune_cache_lock);
+  return autotune_cache.contains(key);
+}
+
+Status LoadFusionAutotuneResultsOnce(const std::string& path) {
+  {
+    absl::MutexLock lock(&autotune_cache_lock);
+    if (!loaded_results_paths.insert(path).second) {
+      return OkStatus();
+    }
+  }
+  if (!tensorflow::Env::Default()->FileExists(path).ok()) {
+    // Nothing was saved yet.
+    return OkStatus();
+  }
+  return LoadFusionAutotuneResults(path);
+}
+
+// Returns the number of bytes `instruction` reads and writes if it runs as its
+// own kernel.
+int64_t BytesAccessed(const HloInstruction& instruction) {
+  int64_t bytes = ShapeUtil::ByteSizeOf(instruction.shape());
+  for (const HloInstruction* operand : instruction.operands()) {
+    bytes += ShapeUtil::ByteSizeOf(operand->shape());
+  }
+  return bytes;
+}
+
+}  // namespace
+
+bool FusionAutotuner::IsCandidate(const HloInstruction& consumer,
+                                  int64_t operand_index) const {
+  const HloInstruction& producer = *consumer.operand(operand_index);
+  switch (producer.opcode()) {
+    case HloOpcode::kFusion:
+    case HloOpcode::kParameter:
+    case HloOpcode::kConstant:
+      return false;
+    default:
+      break;
+  }
+  if (!producer.shape().IsArray() || !consumer.shape().IsArray()) {
+    return false;
+  }
+  return is_expensive_(producer) &&
+         consumer.ReusesOperandElements(operand_index) &&
+         IsProducerConsumerFusible(producer, consumer);
+}
+
+std::optional<bool> FindFusionAutotuneDecision(
+    absl::string_view device, const HloInstruction& producer,
+    const HloInstruction& consumer) {
+  FusionAutotuneCacheKey key = MakeCacheKey(device, producer, consumer);
+  absl::MutexLock lock(&autotune_cache_lock);
+  auto it = autotune_cache.find(key);
+  if (it == autotune_cache.end()) {
+    return std::nullopt;
+  }
+  return it->second.fuse();
+}
+
+StatusOr<std::unique_ptr<HloModule>> MakeFusionAutotuningModule(
+    const HloInstruction& producer, const HloInstruction& consumer,
+    bool fused) {
+  // The config is set once the entry computation is built.
+  auto module = std::make_unique<HloModule>("fusion_autotuning",
+                                            HloModuleConfig());
+  // Deep-clones the computations called by the two instructions, such as
+  // reduction functions, into the new module.
+  HloCloneContext context(module.get());
+  HloComputation::Builder builder("fusion_autotuning");
+  // Operands shared by the producer and the consumer become one parameter.
+  absl::flat_hash_map<const HloInstruction*, HloInstruction*> parameters;
+  auto get_parameter = [&](const HloInstruction* operand) {
+    HloInstruction*& parameter = parameters[operand];
+    if (parameter == nullptr) {
+      parameter = builder.AddInstruction(HloInstruction::CreateParameter(
+          parameters.size() - 1, operand->shape(),
+          absl::StrCat("p", parameters.size() - 1)));
+    }
+    return parameter;
+  };
+
+  std::vector<HloInstruction*> producer_operands;
+  for (const HloInstruction* operand : producer.operands()) {
+    producer_operands.push_back(get_parameter(operand));
+  }
+  HloInstruction* producer_clone =
+      builder.AddInstruction(producer.CloneWithNewOperands(
+          producer.shape(), producer_operands, &context));
+
+  std::vector<HloInstruction*> consumer_operands;
+  for (const HloInstruction* operand : consumer.operands()) {
+    consumer_operands.push_back(operand == &producer ? producer_clone
+                                                     : get_parameter(operand));
+  }
+  HloInstruction* consumer_clone =
+      builder.AddInstruction(consumer.CloneWithNewOperands(
+          consumer.shape(), consumer_operands, &context));
+  HloComputation* computation =
+      module->AddEntryComputation(builder.Build());
+
+  if (fused) {
+    computation->CreateFusionInstruction({consumer_clone, producer_clone},
+                                         ChooseFusionKind(producer, consumer));
+  } else {
+    computation->CreateFusionInstruction({consumer_clone},
+                                         ChooseFusionKind(consumer, consumer));
+    computation->CreateFusionInstruction({producer_clone},
+                                         ChooseFusionKind(producer, producer));
+  }
+
+  const HloModuleConfig& module_config = consumer.GetModule()->config();
+  HloModuleConfig config(computation->ComputeProgramShape(),
+                         /*ignore_layouts=*/false);
+  DebugOptions debug_options = module_config.debug_options();
+  debug_options.set_xla_gpu_fusion_autotune_max_candidates(0);
+  debug_options.clear_xla_dump_to();
+  config.set_debug_options(debug_options);
+  module->set_config(config);
+  return std::move(module);
+}
+
+Status LoadFusionAutotuneResults(const std::string& path) {
+  FusionAutotuneResults results;
+  TF_RETURN_IF_ERROR(
+      tensorflow::ReadTextOrBinaryProto(tensorflow::Env::Default(), path,
+                                        &results));
+  absl::MutexLock lock(&autotune_cache_lock);
+  for (const FusionAutotuneResults::Entry& entry : results.entries()) {
+    autotune_cache.emplace(FusionAutotuneCacheKey(entry.device(),
+                                                  entry.producer(),
+                                                  entry.consumer()),
+                           entry);
+  }
+  return OkStatus();
+}
+
+Status SaveFusionAutotuneResults(const std::string& path) {
+  FusionAutotuneResults results;
+  {
+    absl::MutexLock lock(&autotune_cache_lock);
+    for (const auto& [key, entry] : autotune_cache) {
+      *results.add_entries() = entry;
+    }
+  }
+  return tensorflow::WriteTextProto(tensorflow::Env::Default(), path, results);
+}
+
+void ClearFusionAutotuneResults() {
+  absl::MutexLock lock(&autotune_cache_lock);
+  autotune_cache.clear();
+  loaded_results_paths.clear();
+}
+
+Status FusionAutotuner::Autotune(const HloInstruction& producer,
+                                 const HloInstruction& consumer,
+                                 bool* measured) {
+  FusionAutotuneCacheKey key = MakeCacheKey(device_, producer, consumer);
+  if (IsCached(key)) {
+    return OkStatus();
+  }
+
+  absl::MutexLock lock(&measurement_lock);
+  // Another thread may have measured the same pair while we were waiting.
+  if (IsCached(key)) {
+    return OkStatus();
+  }
+
+  absl::Duration run_times[2];
+  for (bool fused : {false, true}) {
+    TF_ASSIGN_OR_RETURN(std::unique_ptr<HloModule> module,
+                        MakeFusionAutotuningModule(producer, consumer, fused));
+    StatusOr<absl::Duration> run_time = measure_(std::move(module));
+    if (!run_time.ok()) {
+      // Leave the pair to the static heuristic.
+      VLOG(1) << "Failed to measure " << producer.name() << " "
+              << (fused ? "fused" : "unfused") << " into " << consumer.name()
+              << ": " << run_time.status();
+      return OkStatus();
+    }
+    run_times[fused] = *run_time;
+  }
+
+  FusionAutotuneResults::Entry entry;
+  entry.set_device(std::get<0>(key));
+  entry.set_producer(std::get<1>(key));
+  entry.set_consumer(std::get<2>(key));
+  entry.set_fuse(run_times[true] < run_times[false]);
+  entry.set_fused_run_time_ns(absl::ToInt64Nanoseconds(run_times[true]));
+  entry.set_unfused_run_time_ns(absl::ToInt64Nanoseconds(run_times[false]));
+  VLOG(1) << (entry.fuse() ? "Fusing " : "Not fusing ") << producer.name()
+          << " into " << consumer.name() << " (fused " << run_times[true]
+          << ", unfused " << run_times[false] << ")";
+
+  *measured = true;
+  absl::MutexLock cache_lock(&autotune_cache_lock);
+  autotune_cache[key] = std::move(entry);
+  return OkStatus();
+}
+
+StatusOr<bool> FusionAutotuner::Run(HloModule* module) {
+  if (!results_path_.empty()) {
+    Status status = LoadFusionAutotuneResultsOnce(results_path_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load XLA:GPU fusion autotuning results from "
+                   << results_path_ << ": " << status;
+    }
+  }
+
+  std::vector<std::pair<const HloInstruction*, const HloInstruction*>>
+      candidates;
+  for (const HloComputation* computation :
+       module->MakeNonfusionComputations()) {
+    for (const HloInstruction* consumer : computation->instructions()) {
+      for (int64_t i = 0; i < consumer->operand_count(); ++i) {
+        if (IsCandidate(*consumer, i)) {
+          candidates.emplace_back(consumer->operand(i), consumer);
+        }
+      }
+    }
+  }
+  // The pairs that move the most bytes are where the decision matters most.
+  absl::c_stable_sort(candidates, [](const auto& a, const auto& b) {
+    return BytesAccessed(*a.first) + BytesAccessed(*a.second) >
+           BytesAccessed(*b.first) + BytesAccessed(*b.second);
+  });
+  if (candidates.size() > static_cast<size_t>(max_candidates_)) {
+    candidates.resize(max_candidates_);
+  }
+
+  bool measured = false;
+  for (const auto& [producer, consumer] : candidates) {
+    TF_RETURN_IF_ERROR(Autotune(*producer, *consumer, &measured));
+  }
+
+  if (measured && !results_path_.empty()) {
+    Status status = SaveFusionAutotuneResults(results_path_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to save XLA:GPU fusion autotuning results to "
+                   << results_path_ << ": " << status;
+    }
+  }
+  // Decisions are applied by GpuInstructionFusion.
+  return false;
+}
+
+}  // namespace gpu
+}  // namespace xla
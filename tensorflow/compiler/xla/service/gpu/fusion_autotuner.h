@@ -0,0 +1,121 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_FUSION_AUTOTUNER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_FUSION_AUTOTUNER_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+#include "tensorflow/compiler/xla/statusor.h"
+
+namespace xla {
+namespace gpu {
+
+// An HLO pass that measures whether fusing a producer into a consumer pays
+// off, for the pairs that GpuInstructionFusion would otherwise reject with its
+// static "the producer is expensive, and the consumer reuses inputs"
+// heuristic. Fusing such a pair recomputes the producer for every reuse, which
+// may or may not be cheaper than writing its result to memory and reading it
+// back, depending on the shapes.
+//
+// The pass does not change the module. It times up to `max_candidates` of
+// those pairs, the ones touching the most bytes first, fused into one kernel
+// and as two kernels, and records the outcome. GpuInstructionFusion created
+// with the same `device` then fuses the pairs that were measured to be faster
+// fused; see FindFusionAutotuneDecision.
+//
+// Results are cached for the lifetime of the process and reused for pairs
+// with the same instructions on the same device. If `results_path` is set,
+// results are also loaded from that file before measuring anything and
+// written back to it after new pairs were measured, in the format of
+// FusionAutotuneResults.
+//
+// This pass must run after layout assignment and before GpuInstructionFusion.
+class FusionAutotuner : public HloModulePass {
+ public:
+  // Returns how long `module`, built by MakeFusionAutotuningModule, takes to
+  // run.
+  using MeasureFunction =
+      std::function<StatusOr<absl::Duration>(std::unique_ptr<HloModule>)>;
+
+  // `device` describes the GPU that `measure` runs on; results measured on a
+  // different device are never reused. `is_expensive` must be the predicate
+  // GpuInstructionFusion uses.
+  FusionAutotuner(std::string device, int64_t max_candidates,
+                  std::function<bool(const HloInstruction&)> is_expensive,
+                  MeasureFunction measure, std::string results_path = "")
+      : device_(std::move(device)),
+        max_candidates_(max_candidates),
+        is_expensive_(std::move(is_expensive)),
+        measure_(std::move(measure)),
+        results_path_(std::move(results_path)) {}
+
+  absl::string_view name() const override { return "gpu-fusion-autotuner"; }
+
+  StatusOr<bool> Run(HloModule* module) override;
+
+ private:
+  // Returns whether GpuInstructionFusion rejects fusing the `operand_index`th
+  // operand of `consumer` only because of the flop duplication heuristic.
+  bool IsCandidate(const HloInstruction& consumer, int64_t operand_index) const;
+
+  // Measures fusing `producer` into `consumer` unless the result is cached.
+  // Sets `measured` if a new result was added to the cache.
+  Status Autotune(const HloInstruction& producer,
+                  const HloInstruction& consumer, bool* measured);
+
+  const std::string device_;
+  const int64_t max_candidates_;
+  const std::function<bool(const HloInstruction&)> is_expensive_;
+  const MeasureFunction measure_;
+  const std::string results_path_;
+};
+
+// Returns whether fusing `producer` into `consumer` was measured to be faster
+// than running them as separate kernels on `device`, or std::nullopt if the
+// pair was not measured. `consumer` is the unfused consumer instruction, or
+// the instruction that uses the producer inside a fusion computation.
+std::optional<bool> FindFusionAutotuneDecision(absl::string_view device,
+                                               const HloInstruction& producer,
+                                               const HloInstruction& consumer);
+
+// Builds a module that runs `producer` and `consumer`, with their operands as
+// parameters, either fused into a single kernel or as two kernels.
+StatusOr<std::unique_ptr<HloModule>> MakeFusionAutotuningModule(
+    const HloInstruction& producer, const HloInstruction& consumer,
+    bool fused);
+
+// Merges the results in `path`, a text or binary FusionAutotuneResults proto,
+// into the process-wide autotuning cache. Entries already in the cache win.
+Status LoadFusionAutotuneResults(const std::string& path);
+
+// Writes the process-wide autotuning cache to `path` as a text proto.
+Status SaveFusionAutotuneResults(const std::string& path);
+
+// Clears the process-wide autotuning cache, for tests.
+void ClearFusionAutotuneResults();
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_FUSION_AUTOTUNER_H_
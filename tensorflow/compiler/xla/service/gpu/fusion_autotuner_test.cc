@@ -0,0 +1,240 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/fusion_autotuner.h"
+
+#include <string>
+
+#include "absl/algorithm/container.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_autotuning.pb.h"
+#include "tensorflow/compiler/xla/service/gpu/instruction_fusion.h"
+#include "tensorflow/compiler/xla/service/hlo_matchers.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+
+namespace op = xla::testing::opcode_matchers;
+
+namespace xla {
+namespace gpu {
+namespace {
+
+// The static heuristic does not fuse the log into the broadcast, because the
+// log would be computed 256 times per element.
+constexpr char kHlo[] = R"(
+HloModule log_broadcast
+
+ENTRY main {
+  p0 = f32[512]{0} parameter(0)
+  log = f32[512]{0} log(p0)
+  ROOT broadcast = f32[512,256]{1,0} broadcast(log), dimensions={0}
+}
+)";
+
+int64_t CountFusions(const HloModule& module) {
+  return absl::c_count_if(
+      module.entry_computation()->instructions(),
+      [](const HloInstruction* instruction) {
+        return instruction->opcode() == HloOpcode::kFusion;
+      });
+}
+
+class FusionAutotunerTest : public HloTestBase {
+ protected:
+  FusionAutotunerTest() { ClearFusionAutotuneResults(); }
+
+  // Pretends that the fused kernel is faster if `fused_is_faster`, and counts
+  // the measurements.
+  FusionAutotuner::MeasureFunction FakeMeasure(bool fused_is_faster) {
+    return [this, fused_is_faster](std::unique_ptr<HloModule> module)
+               -> StatusOr<absl::Duration> {
+      ++num_measurements_;
+      bool fused = CountFusions(*module) == 1;
+      return absl::Microseconds(fused == fused_is_faster ? 1 : 10);
+    };
+  }
+
+  Status RunAutotuner(HloModule* module,
+                      FusionAutotuner::MeasureFunction measure,
+                      const std::string& path = "",
+                      int64_t max_candidates = 10) {
+    FusionAutotuner autotuner("device", max_candidates,
+                              GpuInstructionFusion::IsExpensive,
+                              std::move(measure), path);
+    TF_ASSIGN_OR_RETURN(bool changed, autotuner.Run(module));
+    EXPECT_FALSE(changed);
+    return OkStatus();
+  }
+
+  std::optional<bool> Decision(const HloModule& module) {
+    const HloInstruction* broadcast =
+        module.entry_computation()->root_instruction();
+    return FindFusionAutotuneDecision("device", *broadcast->operand(0),
+                                      *broadcast);
+  }
+
+  int num_measurements_ = 0;
+};
+
+TEST_F(FusionAutotunerTest, MeasuresFusedAndUnfused) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  const HloInstruction* broadcast =
+      module->entry_computation()->root_instruction();
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto fused,
+      MakeFusionAutotuningModule(*broadcast->operand(0), *broadcast,
+                                 /*fused=*/true));
+  EXPECT_THAT(fused->entry_computation()->root_instruction(),
+              op::Fusion(op::Parameter(0)));
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto unfused,
+      MakeFusionAutotuningModule(*broadcast->operand(0), *broadcast,
+                                 /*fused=*/false));
+  EXPECT_THAT(unfused->entry_computation()->root_instruction(),
+              op::Fusion(op::Fusion(op::Parameter(0))));
+
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(true)));
+  EXPECT_EQ(num_measurements_, 2);
+  EXPECT_EQ(Decision(*module), true);
+}
+
+TEST_F(FusionAutotunerTest, ClonesCalledComputations) {
+  constexpr char kReduceHlo[] = R"(
+HloModule reduce_broadcast
+
+add {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT add = f32[] add(a, b)
+}
+
+ENTRY main {
+  p0 = f32[512,16]{1,0} parameter(0)
+  zero = f32[] constant(0)
+  reduce = f32[512]{0} reduce(p0, zero), dimensions={1}, to_apply=add
+  ROOT broadcast = f32[512,256]{1,0} broadcast(reduce), dimensions={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kReduceHlo));
+  const HloInstruction* broadcast =
+      module->entry_computation()->root_instruction();
+  for (bool fused : {false, true}) {
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto autotuning_module,
+        MakeFusionAutotuningModule(*broadcast->operand(0), *broadcast, fused));
+    TF_ASSERT_OK(verifier().Run(autotuning_module.get()).status());
+    for (const HloComputation* computation :
+         autotuning_module->computations()) {
+      for (const HloInstruction* instruction : computation->instructions()) {
+        for (const HloComputation* called :
+             instruction->called_computations()) {
+          EXPECT_EQ(called->parent(), autotuning_module.get());
+        }
+      }
+    }
+  }
+}
+
+TEST_F(FusionAutotunerTest, RecordsSlowerFusion) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(false)));
+  EXPECT_EQ(Decision(*module), false);
+}
+
+TEST_F(FusionAutotunerTest, ReusesResultsForSameInstructions) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(true)));
+  int num_measurements = num_measurements_;
+  TF_ASSERT_OK_AND_ASSIGN(auto other, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(other.get(), FakeMeasure(true)));
+  EXPECT_EQ(num_measurements_, num_measurements);
+  EXPECT_EQ(Decision(*other), true);
+}
+
+TEST_F(FusionAutotunerTest, LeavesFailedPairsToHeuristic) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(
+      module.get(),
+      [](std::unique_ptr<HloModule>) -> StatusOr<absl::Duration> {
+        return InternalError("Failed to compile");
+      }));
+  EXPECT_EQ(Decision(*module), std::nullopt);
+}
+
+TEST_F(FusionAutotunerTest, RespectsMaxCandidates) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(true), /*path=*/"",
+                            /*max_candidates=*/0));
+  EXPECT_EQ(num_measurements_, 0);
+  EXPECT_EQ(Decision(*module), std::nullopt);
+}
+
+TEST_F(FusionAutotunerTest, InstructionFusionFollowsMeasurement) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(true)));
+
+  // Without the device the static heuristic applies.
+  EXPECT_FALSE(GpuInstructionFusion(/*may_duplicate=*/true)
+                   .Run(module.get())
+                   .ValueOrDie());
+  EXPECT_TRUE(GpuInstructionFusion(/*may_duplicate=*/true, "device")
+                  .Run(module.get())
+                  .ValueOrDie());
+  EXPECT_THAT(module->entry_computation()->root_instruction(),
+              op::Fusion(op::Parameter(0)));
+}
+
+TEST_F(FusionAutotunerTest, InstructionFusionKeepsSlowerPairsUnfused) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(false)));
+  EXPECT_FALSE(GpuInstructionFusion(/*may_duplicate=*/true, "device")
+                   .Run(module.get())
+                   .ValueOrDie());
+}
+
+TEST_F(FusionAutotunerTest, PersistsResults) {
+  std::string path = tensorflow::io::JoinPath(tensorflow::testing::TmpDir(),
+                                              "fusion_autotune_results.pbtxt");
+  tensorflow::Env::Default()->DeleteFile(path).IgnoreError();
+  TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kHlo));
+  TF_ASSERT_OK(RunAutotuner(module.get(), FakeMeasure(true), path));
+
+  FusionAutotuneResults results;
+  TF_ASSERT_OK(tensorflow::ReadTextProto(tensorflow::Env::Default(), path,
+                                         &results));
+  ASSERT_EQ(results.entries_size(), 1);
+  EXPECT_EQ(results.entries(0).device(), "device");
+  EXPECT_TRUE(results.entries(0).fuse());
+  EXPECT_LT(results.entries(0).fused_run_time_ns(),
+            results.entries(0).unfused_run_time_ns());
+
+  // A new process reuses the saved results instead of measuring.
+  ClearFusionAutotuneResults();
+  TF_ASSERT_OK(RunAutotuner(
+      module.get(),
+      [](std::unique_ptr<HloModule>) -> StatusOr<absl::Duration> {
+        return InternalError("Unexpected measurement");
+      },
+      path));
+  EXPECT_EQ(Decision(*module), true);
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
@@ -17,9 +17,11 @@ limitations under the License.
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -27,6 +29,7 @@ limitations under the License.
 
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/Bitcode/BitcodeReader.h"
@@ -85,6 +88,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gpu/alias_passthrough_params.h"
 #include "tensorflow/compiler/xla/service/gpu/all_reduce_blueconnect.h"
 #include "tensorflow/compiler/xla/service/gpu/bef_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/fusion_autotuner.h"
 #include "tensorflow/compiler/xla/service/gpu/fusion_bitcast_lift.h"
 #include "tensorflow/compiler/xla/service/gpu/fusion_merger.h"
 #include "tensorflow/compiler/xla/service/gpu/gemm_broadcast_folding_rewriter.h"
@@ -100,6 +104,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gpu/gpu_sanitize_constant_names.h"
 #include "tensorflow/compiler/xla/service/gpu/gpu_scatter_expander.h"
 #include "tensorflow/compiler/xla/service/gpu/hlo_fusion_stats.h"
+#include "tensorflow/compiler/xla/service/gpu/host_offloader.h"
 #include "tensorflow/compiler/xla/service/gpu/horizontal_input_fusion.h"
 #include "tensorflow/compiler/xla/service/gpu/horizontal_loop_fusion.h"
 #include "tensorflow/compiler/xla/service/gpu/instruction_fusion.h"
@@ -152,6 +157,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/result_caster.h"
 #include "tensorflow/compiler/xla/service/rng_bit_generator_expander.h"
 #include "tensorflow/compiler/xla/service/rng_expander.h"
+#include "tensorflow/compiler/xla/service/service_executable_run_options.h"
 #include "tensorflow/compiler/xla/service/sharding_propagation.h"
 #include "tensorflow/compiler/xla/service/sharding_remover.h"
 #include "tensorflow/compiler/xla/service/simplify_fp_conversions.h"
@@ -160,6 +166,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/sort_simplifier.h"
 #include "tensorflow/compiler/xla/service/spmd/stateful_rng_spmd_partitioner.h"
 #include "tensorflow/compiler/xla/service/stable_sort_expander.h"
+#include "tensorflow/compiler/xla/service/transfer_manager.h"
 #include "tensorflow/compiler/xla/service/transpose_folding.h"
 #include "tensorflow/compiler/xla/service/tuple_simplifier.h"
 #include "tensorflow/compiler/xla/service/while_loop_constant_sinking.h"
@@ -281,6 +288,84 @@ bool ConvIsLowerable(HloInstruction* conv) {
          std::get<0>(conv_matchers::MatchBackwardInput(conv));
 }
 
+// Returns the device FusionAutotuner results measured on `stream_exec` are
+// valid for.
+std::string FusionAutotuneDevice(se::StreamExecutor* stream_exec) {
+  const se::DeviceDescription& description =
+      stream_exec->GetDeviceDescription();
+  return absl::StrCat(description.name(), " sm_",
+                      description.cuda_compute_capability().ToString());
+}
+
+// Returns the fastest of several runs of `module`, a module built by
+// MakeFusionAutotuningModule, on `stream_exec`. Its parameters are zeroes.
+StatusOr<absl::Duration> MeasureFusionAutotuningModule(
+    Compiler* compiler, std::unique_ptr<HloModule> module,
+    se::StreamExecutor* stream_exec,
+    se::DeviceMemoryAllocator* device_allocator) {
+  constexpr int kNumRuns = 5;
+
+  std::vector<Shape> parameter_shapes;
+  for (const HloInstruction* parameter :
+       module->entry_computation()->parameter_instructions()) {
+    parameter_shapes.push_back(parameter->shape());
+  }
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<Executable> executable,
+      compiler->RunBackend(std::move(module), stream_exec,
+                           Compiler::CompileOptions{device_allocator}));
+
+  se::DeviceMemoryAllocator* allocator = device_allocator != nullptr
+                                             ? device_allocator
+                                             : stream_exec->GetAllocator();
+  const int device_ordinal = stream_exec->device_ordinal();
+  TF_ASSIGN_OR_RETURN(se::Stream * stream,
+                      allocator->GetStream(device_ordinal));
+  TF_ASSIGN_OR_RETURN(
+      TransferManager * transfer_manager,
+      TransferManager::GetForPlatform(stream_exec->platform()));
+
+  std::vector<ScopedShapedBuffer> arguments;
+  std::vector<const ShapedBuffer*> argument_ptrs;
+  for (const Shape& shape : parameter_shapes) {
+    TF_ASSIGN_OR_RETURN(ScopedShapedBuffer argument,
+                        transfer_manager->AllocateScopedShapedBuffer(
+                            shape, allocator, device_ordinal));
+    se::DeviceMemoryBase buffer = argument.root_buffer();
+    stream->ThenMemZero(&buffer, buffer.size());
+    arguments.push_back(std::move(argument));
+  }
+  for (const ScopedShapedBuffer& argument : arguments) {
+    argument_ptrs.push_back(&argument);
+  }
+  TF_RETURN_IF_ERROR(stream->BlockHostUntilDone());
+
+  ExecutableRunOptions run_options;
+  run_options.set_stream(stream);
+  run_options.set_allocator(allocator);
+  run_options.set_device_ordinal(device_ordinal);
+  ServiceExecutableRunOptions service_run_options(run_options);
+  // Times the kernels on the device, leaving out launch and host overhead.
+  se::Timer timer(stream_exec);
+  stream->InitTimer(&timer);
+  absl::Duration best_run_time = absl::InfiniteDuration();
+  // The first run loads the kernels and is not counted.
+  for (int i = 0; i <= kNumRuns; ++i) {
+    stream->ThenStartTimer(&timer);
+    TF_ASSIGN_OR_RETURN(
+        ScopedShapedBuffer result,
+        executable->ExecuteOnStream(&service_run_options, argument_ptrs,
+                                    /*hlo_execution_profile=*/nullptr));
+    stream->ThenStopTimer(&timer);
+    TF_RETURN_IF_ERROR(stream->BlockHostUntilDone());
+    if (i > 0) {
+      best_run_time =
+          std::min(best_run_time, absl::Nanoseconds(timer.Nanoseconds()));
+    }
+  }
+  return best_run_time;
+}
+
 }  // end anonymous namespace
 
 using OwnedThunkSchedule = GpuExecutable::OwnedThunkSchedule;
@@ -587,6 +672,24 @@ Status GpuCompiler::OptimizeHloModule(
   TF_RETURN_IF_ERROR(OptimizeHloPostLayoutAssignment(hlo_module, stream_exec,
                                                      device_allocator));
 
+  // Measured fusion decisions need a device to measure on, so they are not
+  // used for ahead-of-time compilation.
+  std::string fusion_autotune_device;
+  if (debug_options.xla_gpu_fusion_autotune_max_candidates() > 0 &&
+      stream_exec != nullptr) {
+    fusion_autotune_device = FusionAutotuneDevice(stream_exec);
+    FusionAutotuner autotuner(
+        fusion_autotune_device,
+        debug_options.xla_gpu_fusion_autotune_max_candidates(),
+        GpuInstructionFusion::IsExpensive,
+        [&](std::unique_ptr<HloModule> module) {
+          return MeasureFusionAutotuningModule(this, std::move(module),
+                                               stream_exec, device_allocator);
+        },
+        debug_options.xla_gpu_fusion_autotune_results_path());
+    TF_RETURN_IF_ERROR(autotuner.Run(hlo_module).status());
+  }
+
   {
     HloPassFix<HloPassPipeline> fusion("fusion");
     // We try to split variadic ops with many parameters into several such ops
@@ -596,8 +699,10 @@ Status GpuCompiler::OptimizeHloModule(
         /*layout_sensitive=*/true,
         /*allow_mixed_precision=*/false,
         LayoutAssignment::InstructionCanChangeLayout);
-    fusion.AddPass<GpuInstructionFusion>(/*may_duplicate=*/false);
-    fusion.AddPass<GpuInstructionFusion>(/*may_duplicate=*/true);
+    fusion.AddPass<GpuInstructionFusion>(/*may_duplicate=*/false,
+                                         fusion_autotune_device);
+    fusion.AddPass<GpuInstructionFusion>(/*may_duplicate=*/true,
+                                         fusion_autotune_device);
     fusion.AddPass<FusionMerger>();
     fusion.AddPass<GpuMultiOutputFusion>();
     fusion.AddPass<HloCSE>(/*is_layout_sensitive=*/true,
@@ -975,6 +1080,38 @@ struct CompileModuleResults {
   std::string module_name;
 };
 
+// Returns the memory the HLO schedule may use, leaving room for fragmentation
+// and for the allocations made outside of XLA.
+static int64_t GetSchedulerMemoryLimit(se::StreamExecutor* stream_exec) {
+  if (stream_exec == nullptr ||
+      stream_exec->GetDeviceDescription().device_memory_size() <= 0) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  return stream_exec->GetDeviceDescription().device_memory_size() / 10 * 8;
+}
+
+// Schedules `hlo_module` and offloads activations to host memory if the
+// schedule needs more than `memory_limit` bytes.
+static StatusOr<std::unique_ptr<GpuHloSchedule>> ScheduleWithHostOffloading(
+    HloModule* hlo_module, int pointer_size, int64_t memory_limit) {
+  TF_ASSIGN_OR_RETURN(HloSchedule schedule,
+                      GpuHloSchedule::ScheduleSequentially(
+                          hlo_module, pointer_size, memory_limit));
+  TF_RETURN_IF_ERROR(hlo_module->set_schedule(std::move(schedule)));
+
+  std::unique_ptr<LatencyEstimator> latency_estimator =
+      CreateGpuLatencyEstimator(*hlo_module, pointer_size);
+  HostOffloader::Options options;
+  options.shape_size_bytes = [pointer_size](const Shape& shape) {
+    return GetSizeOfShape(shape, pointer_size);
+  };
+  options.memory_limit = memory_limit;
+  TF_RETURN_IF_ERROR(HostOffloader(options, latency_estimator.get())
+                         .Run(hlo_module)
+                         .status());
+  return GpuHloSchedule::FromSequentialSchedule(hlo_module->schedule());
+}
+
 // The order of `thunk_sequence` corresponds to
 // `hlo_schedule->ThunkLaunchOrder()`.
 static Status CompileModuleToLlvmIrImpl(
@@ -993,9 +1130,22 @@ static Status CompileModuleToLlvmIrImpl(
 
   std::unique_ptr<StreamAssignment> stream_assignment =
       AssignStreams(*hlo_module);
-  TF_ASSIGN_OR_RETURN(
-      std::unique_ptr<GpuHloSchedule> hlo_schedule,
-      GpuHloSchedule::Build(hlo_module, *stream_assignment, pointer_size));
+  const int64_t memory_limit = GetSchedulerMemoryLimit(stream_exec);
+  std::unique_ptr<GpuHloSchedule> hlo_schedule;
+  // Host transfers are only implemented by thunks, and need all kernels to be
+  // launched on one stream to be ordered with them.
+  if (hlo_module->config().debug_options().xla_gpu_enable_host_offloading() &&
+      stream_assignment->StreamCount() == 1 &&
+      !IsBefExecutableEnabled(hlo_module->config()) &&
+      !IsJitRtExecutableEnabled(hlo_module->config())) {
+    TF_ASSIGN_OR_RETURN(hlo_schedule,
+                        ScheduleWithHostOffloading(hlo_module, pointer_size,
+                                                   memory_limit));
+  } else {
+    TF_ASSIGN_OR_RETURN(hlo_schedule,
+                        GpuHloSchedule::Build(hlo_module, *stream_assignment,
+                                              pointer_size, memory_limit));
+  }
 
   auto buffer_size_bytes_function =
       [pointer_size](const BufferValue& buffer_value) -> int64_t {
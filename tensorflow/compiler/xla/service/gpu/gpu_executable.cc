@@ -115,6 +115,10 @@ bool NeedsAsyncCommsStream(Thunk& thunk) {
   switch (thunk.kind()) {
     case Thunk::Kind::kNcclAllReduceStart:
     case Thunk::Kind::kNcclAllReduceDone:
+    case Thunk::Kind::kHostOffloadStart:
+    case Thunk::Kind::kHostOffloadDone:
+    case Thunk::Kind::kHostReloadStart:
+    case Thunk::Kind::kHostReloadDone:
       return true;
     default:
       return false;
@@ -20,10 +20,12 @@ limitations under the License.
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/compiler/xla/service/buffer_value.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_hlo_cost_analysis.h"
 #include "tensorflow/compiler/xla/service/hlo_instructions.h"
 #include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
 #include "tensorflow/compiler/xla/service/hlo_reachability.h"
 #include "tensorflow/compiler/xla/service/hlo_schedule.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
 #include "tensorflow/compiler/xla/types.h"
 
 namespace xla {
@@ -305,44 +307,122 @@ HloInstructionSequence PostprocessorToScheduleAsEarlyOrLateAsPossible(
   return result;
 }
 
+// Rates of the latency hiding scheduler's cost model. They are those of a
+// recent data-center GPU, with collectives over NVLink; only their ratios
+// matter for the schedule.
+constexpr float kFlopsPerSecond = 1e14;
+constexpr float kMemoryBytesPerSecond = 1e12;
+constexpr double kCollectiveBytesPerUs = 5e4;
+constexpr double kCollectiveLatencyUs = 10;
+
+// Estimates compute times with GpuHloCostAnalysis, and the latency of
+// collectives from the size of their operands.
+class GpuLatencyEstimator : public LatencyEstimator {
+ public:
+  GpuLatencyEstimator(const HloModule& module, int64_t pointer_size)
+      : approximate_(
+            [pointer_size](const Shape& shape) {
+              return ShapeUtil::ByteSizeOf(shape, pointer_size);
+            },
+            kMemoryBytesPerSecond / 1e6, kCollectiveBytesPerUs,
+            kCollectiveLatencyUs),
+        cost_analysis_(CostAnalysisOptions(pointer_size)) {
+    for (const HloComputation* computation :
+         module.MakeNonfusionComputations()) {
+      Status status = computation->Accept(&cost_analysis_);
+      if (!status.ok()) {
+        VLOG(1) << "Estimating compute times from shape sizes: " << status;
+        analyzed_ = false;
+        break;
+      }
+    }
+  }
+
+  double ComputeTime(const HloInstruction& instr) const override {
+    if (analyzed_) return cost_analysis_.optimal_seconds(instr) * 1e6;
+    return approximate_.ComputeTime(instr);
+  }
+
+  double AsyncLatency(const HloInstruction& start) const override {
+    return approximate_.AsyncLatency(start);
+  }
+
+ private:
+  static HloCostAnalysis::Options CostAnalysisOptions(int64_t pointer_size) {
+    HloCostAnalysis::Options options{[pointer_size](const Shape& shape) {
+      return ShapeUtil::ByteSizeOf(shape, pointer_size);
+    }};
+    options.set_flops_per_second(kFlopsPerSecond);
+    options.set_bytes_per_second(kMemoryBytesPerSecond);
+    return options;
+  }
+
+  ApproximateLatencyEstimator approximate_;
+  GpuHloCostAnalysis cost_analysis_;
+  bool analyzed_ = true;
+};
+
 }  // end namespace
 
 GpuHloSchedule::GpuHloSchedule() {}
 
+/* static */
+StatusOr<HloSchedule> GpuHloSchedule::ScheduleSequentially(
+    const HloModule* module, int64_t pointer_size, int64_t memory_limit) {
+  // All kernels are launched on a single stream, so there's no loss of
+  // concurrency by optimizing for minimal memory usage, except for the
+  // overlap of asynchronous collectives with compute.
+  MemorySchedulerAlgorithm algorithm = DefaultMemoryScheduler;
+  if (module->config()
+          .debug_options()
+          .xla_gpu_enable_latency_hiding_scheduler()) {
+    algorithm = LatencyHidingMemoryScheduler(
+        CreateGpuLatencyEstimator(*module, pointer_size), memory_limit);
+  }
+  return ScheduleModule(
+      module,
+      [pointer_size](const BufferValue& buffer) {
+        return ShapeUtil::ByteSizeOf(buffer.shape(), pointer_size);
+      },
+      ComputationSchedulerToModuleScheduler(
+          algorithm, PostprocessorToScheduleAsEarlyOrLateAsPossible));
+}
+
 /* static */
 StatusOr<std::unique_ptr<GpuHloSchedule>> GpuHloSchedule::Build(
     const HloModule* module, const StreamAssignment& stream_assignment,
-    int64_t pointer_size) {
-  std::unique_ptr<GpuHloSchedule> schedule(new GpuHloSchedule);
-
-  // Initialize thunk_launch_order_, the total order of thunk launches.
-  HloComputation* entry_computation = module->entry_computation();
+    int64_t pointer_size, int64_t memory_limit) {
   if (stream_assignment.StreamCount() == 1) {
-    // All kernels are launched on a single stream, so there's no loss of
-    // concurrency by optimizing for minimal memory usage.
     TF_ASSIGN_OR_RETURN(
         HloSchedule sequences,
-        ScheduleModule(
-            module,
-            [pointer_size](const BufferValue& buffer) {
-              return ShapeUtil::ByteSizeOf(buffer.shape(), pointer_size);
-            },
-            ComputationSchedulerToModuleScheduler(
-                DefaultMemoryScheduler,
-                PostprocessorToScheduleAsEarlyOrLateAsPossible)));
-    schedule->thunk_launch_order_ =
-        sequences.sequence(entry_computation).instructions();
-    schedule->hlo_ordering_ =
-        std::make_unique<SequentialHloOrdering>(sequences);
-  } else {
-    // BFS tends to increase concurrency, but also increases memory usage.
-    BFSLaunchOrder(entry_computation, &schedule->thunk_launch_order_);
-    schedule->hlo_ordering_ = std::make_unique<GpuHloOrdering>(
-        module, stream_assignment, schedule->thunk_launch_order_);
+        ScheduleSequentially(module, pointer_size, memory_limit));
+    return FromSequentialSchedule(sequences);
   }
 
+  // Initialize thunk_launch_order_, the total order of thunk launches. BFS
+  // tends to increase concurrency, but also increases memory usage.
+  std::unique_ptr<GpuHloSchedule> schedule(new GpuHloSchedule);
+  BFSLaunchOrder(module->entry_computation(), &schedule->thunk_launch_order_);
+  schedule->hlo_ordering_ = std::make_unique<GpuHloOrdering>(
+      module, stream_assignment, schedule->thunk_launch_order_);
   return std::move(schedule);
 }
 
+/* static */
+std::unique_ptr<GpuHloSchedule> GpuHloSchedule::FromSequentialSchedule(
+    const HloSchedule& sequences) {
+  std::unique_ptr<GpuHloSchedule> schedule(new GpuHloSchedule);
+  schedule->thunk_launch_order_ =
+      sequences.sequence(sequences.module()->entry_computation())
+          .instructions();
+  schedule->hlo_ordering_ = std::make_unique<SequentialHloOrdering>(sequences);
+  return schedule;
+}
+
+std::unique_ptr<LatencyEstimator> CreateGpuLatencyEstimator(
+    const HloModule& module, int64_t pointer_size) {
+  return std::make_unique<GpuLatencyEstimator>(module, pointer_size);
+}
+
 }  // namespace gpu
 }  // namespace xla
@@ -16,12 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_GPU_HLO_SCHEDULE_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_GPU_HLO_SCHEDULE_H_
 
+#include <limits>
 #include <memory>
 #include <vector>
 
 #include "tensorflow/compiler/xla/service/gpu/stream_assignment.h"
 #include "tensorflow/compiler/xla/service/hlo_module.h"
 #include "tensorflow/compiler/xla/service/hlo_ordering.h"
+#include "tensorflow/compiler/xla/service/hlo_schedule.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
 #include "tensorflow/compiler/xla/statusor.h"
 
 namespace xla {
@@ -39,10 +42,25 @@ namespace gpu {
 class GpuHloSchedule {
  public:
   // Constructs an GpuHloSchedule for the given module, based on the given
-  // stream assignment.
+  // stream assignment. With --xla_gpu_enable_latency_hiding_scheduler, the
+  // schedule overlaps asynchronous collectives with compute as long as it
+  // needs at most `memory_limit` bytes.
   static StatusOr<std::unique_ptr<GpuHloSchedule>> Build(
       const HloModule* module, const StreamAssignment& stream_assignment,
-      int64_t pointer_size);
+      int64_t pointer_size,
+      int64_t memory_limit = std::numeric_limits<int64_t>::max());
+
+  // Returns the sequential schedule that Build uses when all kernels are
+  // launched on a single stream.
+  static StatusOr<HloSchedule> ScheduleSequentially(
+      const HloModule* module, int64_t pointer_size,
+      int64_t memory_limit = std::numeric_limits<int64_t>::max());
+
+  // Constructs an GpuHloSchedule that launches all kernels on a single stream
+  // in the order of `sequences`, e.g. a schedule from ScheduleSequentially
+  // that was extended by HostOffloader.
+  static std::unique_ptr<GpuHloSchedule> FromSequentialSchedule(
+      const HloSchedule& sequences);
 
   // Returns the total order of thunk launches, represented in terms of HLO
   // instructions.
@@ -64,6 +82,11 @@ class GpuHloSchedule {
   std::unique_ptr<HloOrdering> hlo_ordering_;
 };
 
+// Returns the latency estimator of the latency hiding scheduler, which
+// estimates times in microseconds.
+std::unique_ptr<LatencyEstimator> CreateGpuLatencyEstimator(
+    const HloModule& module, int64_t pointer_size);
+
 }  // namespace gpu
 }  // namespace xla
 
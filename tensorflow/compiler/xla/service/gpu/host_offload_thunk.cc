@@ -0,0 +1,136 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/host_offload_thunk.h"
+
+#include <utility>
+
+#include "tensorflow/compiler/xla/service/gpu/buffer_allocations.h"
+#include "tensorflow/compiler/xla/util.h"
+
+namespace xla {
+namespace gpu {
+
+StatusOr<se::Event> HostTransferStartThunk::TakeDoneEvent(int device_ordinal) {
+  absl::MutexLock lock(&mu_);
+  auto it = done_events_.find(device_ordinal);
+  TF_RET_CHECK(it != done_events_.end()) << "done event not found";
+  // Take ownership of the event.
+  se::Event done_event = std::move(it->second);
+  done_events_.erase(it);
+  return done_event;
+}
+
+Status HostTransferStartThunk::RecordDoneEvent(se::Stream& stream) {
+  se::Event done_event(stream.parent());
+  TF_RET_CHECK(done_event.Init());
+  stream.ThenRecordEvent(&done_event);
+
+  absl::MutexLock lock(&mu_);
+  auto result = done_events_.emplace(stream.parent()->device_ordinal(),
+                                     std::move(done_event));
+  TF_RET_CHECK(result.second) << "done event has not been consumed";
+  return OkStatus();
+}
+
+HostOffloadStartThunk::HostOffloadStartThunk(
+    ThunkInfo thunk_info, const BufferAllocation::Slice& source_buffer,
+    uint64_t mem_size)
+    : HostTransferStartThunk(Thunk::kHostOffloadStart, thunk_info),
+      source_buffer_(source_buffer),
+      mem_size_(mem_size) {}
+
+HostOffloadStartThunk::~HostOffloadStartThunk() {
+  absl::MutexLock lock(&host_buffers_mu_);
+  for (auto& [executor, host_buffer] : host_buffers_) {
+    executor->HostMemoryDeallocate(host_buffer);
+  }
+}
+
+Status HostOffloadStartThunk::Initialize(const GpuExecutable& executable,
+                                         se::StreamExecutor* executor) {
+  absl::MutexLock lock(&host_buffers_mu_);
+  if (host_buffers_.contains(executor)) {
+    return OkStatus();
+  }
+  // Pinned memory lets the copies run asynchronously at full PCIe bandwidth.
+  void* host_buffer = executor->HostMemoryAllocate(mem_size_);
+  if (host_buffer == nullptr) {
+    return ResourceExhausted(
+        "Failed to allocate %d bytes of pinned host memory to offload a "
+        "buffer to.",
+        mem_size_);
+  }
+  host_buffers_.emplace(executor, host_buffer);
+  return OkStatus();
+}
+
+StatusOr<void*> HostOffloadStartThunk::HostBuffer(
+    se::StreamExecutor* executor) {
+  absl::MutexLock lock(&host_buffers_mu_);
+  auto it = host_buffers_.find(executor);
+  TF_RET_CHECK(it != host_buffers_.end()) << "thunk was not initialized";
+  return it->second;
+}
+
+Status HostOffloadStartThunk::ExecuteOnStream(const ExecuteParams& params) {
+  se::Stream& async_stream = *params.async_comms_stream;
+  // Wait until the source buffer is computed.
+  async_stream.ThenWaitFor(params.stream);
+
+  TF_ASSIGN_OR_RETURN(void* host_buffer, HostBuffer(async_stream.parent()));
+  se::DeviceMemoryBase source_data =
+      params.buffer_allocations->GetDeviceAddress(source_buffer_);
+  async_stream.ThenMemcpy(host_buffer, source_data, mem_size_);
+  return RecordDoneEvent(async_stream);
+}
+
+HostReloadStartThunk::HostReloadStartThunk(
+    ThunkInfo thunk_info, HostOffloadStartThunk& offload_thunk,
+    const BufferAllocation::Slice& destination_buffer)
+    : HostTransferStartThunk(Thunk::kHostReloadStart, thunk_info),
+      offload_thunk_(offload_thunk),
+      destination_buffer_(destination_buffer) {}
+
+Status HostReloadStartThunk::ExecuteOnStream(const ExecuteParams& params) {
+  se::Stream& async_stream = *params.async_comms_stream;
+  // The destination buffer may be shared with buffers that kernels enqueued
+  // on the main stream still use. The offload itself was enqueued on the
+  // async stream earlier, so it has completed before the copy starts.
+  async_stream.ThenWaitFor(params.stream);
+
+  TF_ASSIGN_OR_RETURN(void* host_buffer,
+                      offload_thunk_.HostBuffer(async_stream.parent()));
+  se::DeviceMemoryBase destination_data =
+      params.buffer_allocations->GetDeviceAddress(destination_buffer_);
+  async_stream.ThenMemcpy(&destination_data, host_buffer,
+                          offload_thunk_.mem_size());
+  return RecordDoneEvent(async_stream);
+}
+
+HostTransferDoneThunk::HostTransferDoneThunk(
+    Kind kind, ThunkInfo thunk_info, HostTransferStartThunk& start_thunk)
+    : Thunk(kind, thunk_info), start_thunk_(start_thunk) {}
+
+Status HostTransferDoneThunk::ExecuteOnStream(const ExecuteParams& params) {
+  int device_ordinal = params.stream->parent()->device_ordinal();
+  TF_ASSIGN_OR_RETURN(se::Event done_event,
+                      start_thunk_.TakeDoneEvent(device_ordinal));
+  params.stream->ThenWaitFor(&done_event);
+  return OkStatus();
+}
+
+}  // namespace gpu
+}  // namespace xla
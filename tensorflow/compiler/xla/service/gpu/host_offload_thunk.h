@@ -0,0 +1,111 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOAD_THUNK_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOAD_THUNK_H_
+
+#include <cstdint>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/service/buffer_assignment.h"
+#include "tensorflow/compiler/xla/service/gpu/thunk.h"
+#include "tensorflow/compiler/xla/statusor.h"
+#include "tensorflow/core/platform/stream_executor_no_cuda.h"
+
+namespace xla {
+namespace gpu {
+
+// Base class of the thunks that start an asynchronous transfer between device
+// and host memory on the async stream. The matching HostTransferDoneThunk
+// makes the main stream wait for the transfer.
+class HostTransferStartThunk : public Thunk {
+ public:
+  StatusOr<se::Event> TakeDoneEvent(int device_ordinal)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ protected:
+  HostTransferStartThunk(Kind kind, ThunkInfo thunk_info)
+      : Thunk(kind, thunk_info) {}
+
+  // Records an event for the completion of the work enqueued on `stream` so
+  // far, for the done thunk to wait on.
+  Status RecordDoneEvent(se::Stream& stream) ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Mutex mu_;
+  // Store done events (by device ordinal) for the done thunk to wait on.
+  absl::flat_hash_map<int, se::Event> done_events_ ABSL_GUARDED_BY(mu_);
+};
+
+// Copies a device buffer to a pinned host buffer owned by the thunk. The
+// source buffer must stay alive until the matching done thunk.
+class HostOffloadStartThunk : public HostTransferStartThunk {
+ public:
+  HostOffloadStartThunk(ThunkInfo thunk_info,
+                        const BufferAllocation::Slice& source_buffer,
+                        uint64_t mem_size);
+  ~HostOffloadStartThunk() override;
+
+  Status Initialize(const GpuExecutable& executable,
+                    se::StreamExecutor* executor) override;
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+  // Returns the host buffer holding the offloaded data for `executor`.
+  StatusOr<void*> HostBuffer(se::StreamExecutor* executor)
+      ABSL_LOCKS_EXCLUDED(host_buffers_mu_);
+
+  uint64_t mem_size() const { return mem_size_; }
+
+ private:
+  const BufferAllocation::Slice source_buffer_;
+  const uint64_t mem_size_;
+
+  absl::Mutex host_buffers_mu_;
+  absl::flat_hash_map<se::StreamExecutor*, void*> host_buffers_
+      ABSL_GUARDED_BY(host_buffers_mu_);
+};
+
+// Copies the host buffer of an offload back into a device buffer, once the
+// offload is done.
+class HostReloadStartThunk : public HostTransferStartThunk {
+ public:
+  HostReloadStartThunk(ThunkInfo thunk_info,
+                       HostOffloadStartThunk& offload_thunk,
+                       const BufferAllocation::Slice& destination_buffer);
+
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+ private:
+  HostOffloadStartThunk& offload_thunk_;
+  const BufferAllocation::Slice destination_buffer_;
+};
+
+// Makes the main stream wait for the transfer of `start_thunk`.
+class HostTransferDoneThunk : public Thunk {
+ public:
+  HostTransferDoneThunk(Kind kind, ThunkInfo thunk_info,
+                        HostTransferStartThunk& start_thunk);
+
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+ private:
+  HostTransferStartThunk& start_thunk_;
+};
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOAD_THUNK_H_
@@ -0,0 +1,283 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/host_offloader.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/compiler/xla/service/hlo_alias_analysis.h"
+#include "tensorflow/compiler/xla/service/hlo_casting_utils.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_instructions.h"
+#include "tensorflow/compiler/xla/service/hlo_live_range.h"
+#include "tensorflow/compiler/xla/service/hlo_schedule.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace xla {
+namespace gpu {
+
+const char* const kHostOffloadStartCallTarget = "__xla_gpu$hostOffloadStart";
+const char* const kHostOffloadDoneCallTarget = "__xla_gpu$hostOffloadDone";
+const char* const kHostReloadStartCallTarget = "__xla_gpu$hostReloadStart";
+const char* const kHostReloadDoneCallTarget = "__xla_gpu$hostReloadDone";
+
+namespace {
+
+// A value of the entry computation that can be kept in host memory while the
+// instructions in [offload_done, reload_start) of the schedule run.
+struct OffloadCandidate {
+  HloInstruction* instruction;
+  int64_t size;
+  // Positions in the entry computation's sequence: the last use before the
+  // gap, where the offload and reload finish and start, and the first use
+  // after the gap.
+  int64_t last_use_before;
+  int64_t offload_done;
+  int64_t reload_start;
+  int64_t first_use_after;
+  // The span of the flattened schedule in which the value is not resident.
+  int64_t offloaded_begin_time;
+  int64_t offloaded_end_time;
+};
+
+// Returns the device memory in use at each time of the flattened schedule.
+std::vector<int64_t> MemoryUsage(
+    const HloAliasAnalysis& alias_analysis, const HloLiveRange& live_range,
+    const std::function<int64_t(const Shape&)>& shape_size_bytes) {
+  std::vector<int64_t> usage(live_range.schedule_end_time() + 2, 0);
+  for (const HloBuffer& buffer : alias_analysis.buffers()) {
+    int64_t start = usage.size();
+    int64_t end = -1;
+    int64_t size = 0;
+    for (const HloValue* value : buffer.values()) {
+      auto it = live_range.buffer_live_ranges().find(value);
+      if (it == live_range.buffer_live_ranges().end()) {
+        continue;
+      }
+      start = std::min(start, it->second.start);
+      end = std::max(end, it->second.end);
+      size = std::max(size, shape_size_bytes(value->shape()));
+    }
+    if (start > end) {
+      continue;
+    }
+    usage[start] += size;
+    usage[end + 1] -= size;
+  }
+  for (int64_t t = 1; t < usage.size(); ++t) {
+    usage[t] += usage[t - 1];
+  }
+  return usage;
+}
+
+}  // namespace
+
+StatusOr<bool> HostOffloader::Run(HloModule* module) {
+  TF_RET_CHECK(module->has_schedule())
+      << "HostOffloader requires a scheduled module";
+  HloComputation* entry = module->entry_computation();
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<HloAliasAnalysis> alias_analysis,
+                      HloAliasAnalysis::Run(module));
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<HloLiveRange> live_range,
+      HloLiveRange::Run(module->schedule(), *alias_analysis, entry));
+
+  std::vector<int64_t> usage = MemoryUsage(*alias_analysis, *live_range,
+                                           options_.shape_size_bytes);
+  auto peak = [&] { return absl::c_max_element(usage) - usage.begin(); };
+  if (usage[peak()] <= options_.memory_limit) {
+    return false;
+  }
+
+  const std::vector<HloInstruction*> sequence =
+      module->schedule().sequence(entry).instructions();
+  absl::flat_hash_map<const HloInstruction*, int64_t> position;
+  // `compute_time[i]` is the time it takes to run the first `i` instructions.
+  std::vector<double> compute_time(sequence.size() + 1, 0);
+  for (int64_t i = 0; i < sequence.size(); ++i) {
+    position[sequence[i]] = i;
+    compute_time[i + 1] =
+        compute_time[i] + latency_estimator_.ComputeTime(*sequence[i]);
+  }
+  auto flattened_time = [&](int64_t i) {
+    return live_range->instruction_schedule().at(sequence[i]);
+  };
+
+  const HloDataflowAnalysis& dataflow = alias_analysis->dataflow_analysis();
+  std::vector<OffloadCandidate> candidates;
+  for (int64_t i = 0; i < sequence.size(); ++i) {
+    HloInstruction* instruction = sequence[i];
+    if (!instruction->shape().IsArray() ||
+        !instruction->shape().is_static() ||
+        instruction->opcode() == HloOpcode::kParameter ||
+        instruction->opcode() == HloOpcode::kConstant ||
+        instruction->user_count() == 0 ||
+        !dataflow.ValueIsDefinedAt(instruction)) {
+      continue;
+    }
+    const HloValue& value = dataflow.GetValueDefinedAt(instruction);
+    int64_t size = options_.shape_size_bytes(instruction->shape());
+    if (size < options_.min_offload_bytes ||
+        alias_analysis->ValueLivesOut(value)) {
+      continue;
+    }
+
+    // Find the longest stretch of compute without a use of the value.
+    std::vector<int64_t> uses = {i};
+    for (const HloInstruction* user : instruction->users()) {
+      uses.push_back(position.at(user));
+    }
+    absl::c_sort(uses);
+    int64_t before = 0;
+    int64_t after = 0;
+    double longest_gap = -1;
+    for (int64_t k = 0; k + 1 < uses.size(); ++k) {
+      double gap = compute_time[uses[k + 1]] - compute_time[uses[k] + 1];
+      if (gap > longest_gap) {
+        longest_gap = gap;
+        before = uses[k];
+        after = uses[k + 1];
+      }
+    }
+
+    // The buffer only holds this value during the gap, unless another value
+    // sharing it is defined in the gap, e.g. in a nested computation.
+    const HloBuffer& buffer = alias_analysis->GetBufferContainingValue(value);
+    bool buffer_is_shared = absl::c_any_of(
+        buffer.values(), [&](const HloValue* other) {
+          if (other == &value) return false;
+          auto it = position.find(other->defining_instruction());
+          return it == position.end() || (it->second > i && it->second < after);
+        });
+    if (buffer_is_shared) {
+      continue;
+    }
+
+    // Hide each transfer behind at least its own duration of compute.
+    double transfer_time =
+        options_.host_latency_us + size / options_.host_bytes_per_us;
+    int64_t offload_done = before + 1;
+    while (offload_done < after &&
+           compute_time[offload_done] - compute_time[before + 1] <
+               transfer_time) {
+      ++offload_done;
+    }
+    int64_t reload_start = after;
+    while (reload_start > offload_done &&
+           compute_time[after] - compute_time[reload_start] < transfer_time) {
+      --reload_start;
+    }
+    if (reload_start <= offload_done) {
+      continue;
+    }
+    candidates.push_back(OffloadCandidate{instruction, size, before,
+                                          offload_done, reload_start, after,
+                                          flattened_time(offload_done - 1) + 1,
+                                          flattened_time(reload_start - 1)});
+  }
+  VLOG(2) << candidates.size() << " candidates for host offloading";
+
+  // Offload the largest candidates not resident at the peak until the peak
+  // fits, or no offloaded candidate would lower it.
+  absl::c_stable_sort(candidates, [](const OffloadCandidate& a,
+                                     const OffloadCandidate& b) {
+    return a.size > b.size;
+  });
+  std::vector<const OffloadCandidate*> offloaded;
+  std::vector<bool> picked(candidates.size(), false);
+  while (usage[peak()] > options_.memory_limit) {
+    int64_t peak_time = peak();
+    const OffloadCandidate* next = nullptr;
+    for (int64_t k = 0; k < candidates.size() && next == nullptr; ++k) {
+      if (!picked[k] && candidates[k].offloaded_begin_time <= peak_time &&
+          peak_time <= candidates[k].offloaded_end_time) {
+        picked[k] = true;
+        next = &candidates[k];
+      }
+    }
+    if (next == nullptr) {
+      break;
+    }
+    offloaded.push_back(next);
+    for (int64_t t = next->offloaded_begin_time;
+         t <= next->offloaded_end_time; ++t) {
+      usage[t] -= next->size;
+    }
+  }
+  if (offloaded.empty()) {
+    return false;
+  }
+  VLOG(1) << "Offloading " << offloaded.size()
+          << " values to host memory; estimated peak memory is "
+          << usage[peak()] << " bytes";
+
+  // Instructions to insert before each position of the sequence.
+  std::vector<std::vector<HloInstruction*>> inserted(sequence.size() + 1);
+  const Shape handle_shape = ShapeUtil::MakeShape(S32, {});
+  for (const OffloadCandidate* candidate : offloaded) {
+    HloInstruction* instruction = candidate->instruction;
+    std::vector<HloInstruction*> later_users;
+    for (HloInstruction* user : instruction->users()) {
+      if (position.at(user) >= candidate->first_use_after) {
+        later_users.push_back(user);
+      }
+    }
+
+    HloInstruction* offload_start =
+        entry->AddInstruction(HloInstruction::CreateCustomCall(
+            handle_shape, {instruction}, kHostOffloadStartCallTarget));
+    HloInstruction* offload_done =
+        entry->AddInstruction(HloInstruction::CreateCustomCall(
+            handle_shape, {offload_start, instruction},
+            kHostOffloadDoneCallTarget));
+    HloInstruction* reload_start =
+        entry->AddInstruction(HloInstruction::CreateCustomCall(
+            instruction->shape(), {offload_done}, kHostReloadStartCallTarget));
+    HloInstruction* reload_done =
+        entry->AddInstruction(HloInstruction::CreateCustomCall(
+            instruction->shape(), {reload_start}, kHostReloadDoneCallTarget));
+    Cast<HloCustomCallInstruction>(reload_done)
+        ->set_output_to_operand_aliasing({{{}, {0, {}}}});
+    for (HloInstruction* user : later_users) {
+      TF_RETURN_IF_ERROR(instruction->ReplaceUseWith(user, reload_done));
+    }
+
+    inserted[candidate->last_use_before + 1].push_back(offload_start);
+    inserted[candidate->offload_done].push_back(offload_done);
+    inserted[candidate->reload_start].push_back(reload_start);
+    inserted[candidate->first_use_after].push_back(reload_done);
+  }
+
+  HloInstructionSequence new_sequence;
+  for (int64_t i = 0; i <= sequence.size(); ++i) {
+    for (HloInstruction* instruction : inserted[i]) {
+      new_sequence.push_back(instruction);
+    }
+    if (i < sequence.size()) {
+      new_sequence.push_back(sequence[i]);
+    }
+  }
+  module->schedule().set_sequence(entry, std::move(new_sequence));
+  TF_RETURN_IF_ERROR(module->schedule().Verify());
+  return true;
+}
+
+}  // namespace gpu
+}  // namespace xla
@@ -0,0 +1,96 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOADER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOADER_H_
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/statusor.h"
+
+namespace xla {
+namespace gpu {
+
+// Custom-call targets of the transfers inserted by HostOffloader.
+extern const char* const kHostOffloadStartCallTarget;
+extern const char* const kHostOffloadDoneCallTarget;
+extern const char* const kHostReloadStartCallTarget;
+extern const char* const kHostReloadDoneCallTarget;
+
+// Uses host memory as a second, slower memory space for activations that stay
+// live across a long stretch of the schedule without being used, e.g. between
+// the forward and the backward pass of a training step. When the scheduled
+// module needs more than `memory_limit` bytes of device memory, such a value
+// `x` is copied to pinned host memory after its last use before the gap, and
+// copied back before its first use after the gap:
+//
+//   start = s32[] custom-call(x), target=kHostOffloadStartCallTarget
+//   done = s32[] custom-call(start, x), target=kHostOffloadDoneCallTarget
+//   reload = f32[...] custom-call(done), target=kHostReloadStartCallTarget
+//   x' = f32[...] custom-call(reload), target=kHostReloadDoneCallTarget
+//
+// The later uses of `x` use `x'`, which aliases the buffer of `reload`. The
+// copies run on the async stream; the done instructions make the main stream
+// wait for them, and the done of the offload keeps `x` alive until the copy
+// to host has finished. The s32[] results only carry the dependencies.
+//
+// The latency estimator and the bandwidth of host transfers decide where the
+// transfers go: the instructions between a start and its done must take at
+// least as long as the transfer, so that it is hidden behind compute. Values
+// are offloaded greedily, largest first, until the peak memory fits.
+//
+// The pass keeps the module's schedule up to date and must be the last pass
+// to run before buffer assignment.
+class HostOffloader : public HloModulePass {
+ public:
+  struct Options {
+    // Returns the size of a buffer of the given shape, in bytes.
+    std::function<int64_t(const Shape&)> shape_size_bytes;
+
+    // The device memory that the module should fit in, in bytes.
+    int64_t memory_limit = 0;
+
+    // Smaller values are never offloaded, as they cannot save much memory.
+    int64_t min_offload_bytes = 1 << 20;
+
+    // Bandwidth and fixed latency of copies between device memory and pinned
+    // host memory, in the units of the latency estimator. The defaults are
+    // those of PCIe 3.0 x16 in microseconds.
+    double host_bytes_per_us = 1.2e4;
+    double host_latency_us = 10;
+  };
+
+  HostOffloader(Options options, const LatencyEstimator* latency_estimator)
+      : options_(std::move(options)), latency_estimator_(*latency_estimator) {}
+
+  absl::string_view name() const override { return "host-offloader"; }
+
+  StatusOr<bool> Run(HloModule* module) override;
+
+ private:
+  const Options options_;
+  const LatencyEstimator& latency_estimator_;
+};
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_HOST_OFFLOADER_H_
@@ -0,0 +1,148 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/host_offloader.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_matchers.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+namespace op = xla::testing::opcode_matchers;
+
+// Every instruction takes the same time.
+class FixedLatencyEstimator : public LatencyEstimator {
+ public:
+  explicit FixedLatencyEstimator(double compute_time_us)
+      : compute_time_us_(compute_time_us) {}
+
+  double ComputeTime(const HloInstruction& instr) const override {
+    return compute_time_us_;
+  }
+  double AsyncLatency(const HloInstruction& start) const override { return 0; }
+
+ private:
+  double compute_time_us_;
+};
+
+// `a` is used at the start and at the end of the schedule, and is live while
+// the 4 MiB temporaries `e`, `g` and `h` are.
+constexpr char kHloString[] = R"(
+HloModule m, is_scheduled=true
+
+ENTRY entry {
+  p0 = f32[1024,1024] parameter(0)
+  a = f32[1024,1024] negate(p0)
+  b = f32[1,1024] slice(a), slice={[0:1], [0:1024]}
+  c = f32[1024] reshape(b)
+  d = f32[1024] exponential(c)
+  e = f32[1024,1024] broadcast(d), dimensions={1}
+  g = f32[1024,1024] negate(e)
+  h = f32[1024,1024] exponential(g)
+  ROOT f = f32[1024,1024] add(h, a)
+})";
+
+class HostOffloaderTest : public HloTestBase {
+ protected:
+  StatusOr<bool> RunOffloader(HloModule* module, int64_t memory_limit,
+                              double compute_time_us) {
+    HostOffloader::Options options;
+    options.shape_size_bytes = [](const Shape& shape) {
+      return ShapeUtil::ByteSizeOf(shape, /*pointer_size=*/8);
+    };
+    options.memory_limit = memory_limit;
+    FixedLatencyEstimator latency_estimator(compute_time_us);
+    return HostOffloader(options, &latency_estimator).Run(module);
+  }
+
+  static int64_t Position(const HloModule& module, absl::string_view name) {
+    const std::vector<HloInstruction*>& sequence =
+        module.schedule().sequence(module.entry_computation()).instructions();
+    for (int64_t i = 0; i < sequence.size(); ++i) {
+      if (sequence[i]->name() == name) return i;
+    }
+    return -1;
+  }
+};
+
+TEST_F(HostOffloaderTest, OffloadsLongLivedActivation) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloString));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunOffloader(module.get(), /*memory_limit=*/13 << 20,
+                                       /*compute_time_us=*/1000));
+  EXPECT_TRUE(changed);
+
+  HloInstruction* a = FindInstruction(module.get(), "a");
+  HloInstruction* f = FindInstruction(module.get(), "f");
+  HloInstruction* reload_done = f->mutable_operand(1);
+  EXPECT_THAT(
+      reload_done,
+      op::CustomCall(
+          kHostReloadDoneCallTarget,
+          op::CustomCall(
+              kHostReloadStartCallTarget,
+              op::CustomCall(kHostOffloadDoneCallTarget,
+                             op::CustomCall(kHostOffloadStartCallTarget, a),
+                             a))));
+  EXPECT_EQ(a->user_count(), 3);
+
+  // Each transfer is hidden behind one instruction, and `a` is not resident
+  // while `d`, `e` and `g` run.
+  const HloInstruction* reload_start = reload_done->operand(0);
+  const HloInstruction* offload_done = reload_start->operand(0);
+  const HloInstruction* offload_start = offload_done->operand(0);
+  EXPECT_EQ(Position(*module, offload_start->name()),
+            Position(*module, "b") + 1);
+  EXPECT_EQ(Position(*module, offload_done->name()),
+            Position(*module, "c") + 1);
+  EXPECT_EQ(Position(*module, reload_start->name()) + 1,
+            Position(*module, "h"));
+  EXPECT_EQ(Position(*module, reload_done->name()) + 1,
+            Position(*module, "f"));
+  TF_EXPECT_OK(module->schedule().Verify());
+}
+
+TEST_F(HostOffloaderTest, NothingToDoIfModuleFits) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloString));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunOffloader(module.get(), /*memory_limit=*/16 << 20,
+                                       /*compute_time_us=*/1000));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(HostOffloaderTest, DoesNotOffloadIfTransfersCannotBeHidden) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloString));
+  // Copying 4 MiB over PCIe takes far longer than the gap.
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunOffloader(module.get(), /*memory_limit=*/13 << 20,
+                                       /*compute_time_us=*/10));
+  EXPECT_FALSE(changed);
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/gpu/instruction_fusion.h"
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/compiler/xla/service/fusion_node_indexing_evaluation.h"
+#include "tensorflow/compiler/xla/service/gpu/fusion_autotuner.h"
 #include "tensorflow/compiler/xla/service/gpu/gpu_fusible.h"
 #include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/hlo_opcode.h"
@@ -55,6 +57,27 @@ bool ElementIsF32OrF16(const Shape& shape) {
   return InstructionFusion::IsExpensive(instruction);
 }
 
+bool GpuInstructionFusion::MeasuredFusionIsFaster(
+    const HloInstruction* consumer, int64_t operand_index) const {
+  if (autotune_device_.empty()) {
+    return false;
+  }
+  const HloInstruction* producer = consumer->operand(operand_index);
+  if (consumer->opcode() != HloOpcode::kFusion) {
+    return FindFusionAutotuneDecision(autotune_device_, *producer, *consumer)
+        .value_or(false);
+  }
+  // The pairs were measured before fusion, so every user of the producer in
+  // the fused computation must have been measured to be faster fused.
+  const HloInstruction* parameter = consumer->fused_parameter(operand_index);
+  return !parameter->users().empty() &&
+         absl::c_all_of(parameter->users(), [&](const HloInstruction* user) {
+           return FindFusionAutotuneDecision(autotune_device_, *producer,
+                                             *user)
+               .value_or(false);
+         });
+}
+
 FusionDecision GpuInstructionFusion::ShouldFuseInexpensiveChecks(
     HloInstruction* consumer, int64_t operand_index) {
   HloInstruction* producer = consumer->mutable_operand(operand_index);
@@ -65,8 +88,10 @@ FusionDecision GpuInstructionFusion::ShouldFuseInexpensiveChecks(
   }
   // Cost condition: not fuse (simple, expensive producers) and (consumers who
   // reuse operand elements).
+  // FusionAutotuner may have measured that fusing is faster anyway.
   if (producer->opcode() != HloOpcode::kFusion && is_expensive(*producer) &&
-      ReusesOperandElements(consumer, operand_index)) {
+      ReusesOperandElements(consumer, operand_index) &&
+      !MeasuredFusionIsFaster(consumer, operand_index)) {
     return "the producer is expensive, and the consumer reuses inputs";
   }
 
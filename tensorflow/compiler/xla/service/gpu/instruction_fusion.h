@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_INSTRUCTION_FUSION_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_INSTRUCTION_FUSION_H_
 
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/compiler/xla/service/fusion_node_indexing_evaluation.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
@@ -26,8 +28,13 @@ namespace gpu {
 
 class GpuInstructionFusion : public InstructionFusion {
  public:
-  explicit GpuInstructionFusion(bool may_duplicate)
-      : InstructionFusion(GpuInstructionFusion::IsExpensive, may_duplicate) {}
+  // If `autotune_device` is set, pairs that FusionAutotuner measured on that
+  // device to be faster fused are fused even though the producer is expensive
+  // and the consumer reuses its elements.
+  explicit GpuInstructionFusion(bool may_duplicate,
+                                std::string autotune_device = "")
+      : InstructionFusion(GpuInstructionFusion::IsExpensive, may_duplicate),
+        autotune_device_(std::move(autotune_device)) {}
 
   static bool IsExpensive(const HloInstruction& instruction);
 
@@ -52,6 +59,13 @@ class GpuInstructionFusion : public InstructionFusion {
   HloInstruction* FuseInstruction(HloInstruction* fusion_instruction,
                                   HloInstruction* producer) override;
 
+  // Returns whether FusionAutotuner measured fusing the `operand_index`th
+  // operand of `consumer` to be faster than not fusing it.
+  bool MeasuredFusionIsFaster(const HloInstruction* consumer,
+                              int64_t operand_index) const;
+
+  const std::string autotune_device_;
+
   // Keep track of the number of times each instruction inside a fusion node is
   // indexed with different index vectors.
   absl::flat_hash_map<const HloInstruction*, FusionNodeIndexingEvaluation>
@@ -80,6 +80,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gpu/gpu_conv_runner.h"
 #include "tensorflow/compiler/xla/service/gpu/gpu_executable.h"
 #include "tensorflow/compiler/xla/service/gpu/hlo_to_ir_bindings.h"
+#include "tensorflow/compiler/xla/service/gpu/host_offloader.h"
 #include "tensorflow/compiler/xla/service/gpu/infeed_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/gpu/ir_emitter_context.h"
@@ -3077,6 +3078,75 @@ Status IrEmitterUnnested::EmitAllReduceDone(mlir::Operation* op) {
   return OkStatus();
 }
 
+Status IrEmitterUnnested::EmitHostOffloadStart(mlir::Operation* op) {
+  auto custom_call = mlir::cast<mlir::lmhlo::CustomCallOp>(op);
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice source,
+                      GetAllocationSlice(custom_call.getArgs().front()));
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice handle,
+                      GetAllocationSlice(custom_call.getOutput().front()));
+  auto thunk = std::make_unique<HostOffloadStartThunk>(GetThunkInfo(op),
+                                                       source, source.size());
+  TF_RET_CHECK(host_offload_start_thunks_.emplace(handle, thunk.get()).second)
+      << "handle of a host offload is still in use";
+  AddThunkToThunkSequence(std::move(thunk));
+  return OkStatus();
+}
+
+Status IrEmitterUnnested::EmitHostOffloadDone(mlir::Operation* op) {
+  auto custom_call = mlir::cast<mlir::lmhlo::CustomCallOp>(op);
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice start_handle,
+                      GetAllocationSlice(custom_call.getArgs().front()));
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice done_handle,
+                      GetAllocationSlice(custom_call.getOutput().front()));
+  auto it = host_offload_start_thunks_.find(start_handle);
+  TF_RET_CHECK(it != host_offload_start_thunks_.end())
+      << "couldn't find thunk for host-offload-start op";
+  HostOffloadStartThunk* start_thunk = it->second;
+  host_offload_start_thunks_.erase(it);
+
+  AddThunkToThunkSequence(std::make_unique<HostTransferDoneThunk>(
+      Thunk::kHostOffloadDone, GetThunkInfo(op), *start_thunk));
+  // The reload finds the host buffer through the handle of the done op.
+  TF_RET_CHECK(
+      host_offload_start_thunks_.emplace(done_handle, start_thunk).second)
+      << "handle of a host offload is still in use";
+  return OkStatus();
+}
+
+Status IrEmitterUnnested::EmitHostReloadStart(mlir::Operation* op) {
+  auto custom_call = mlir::cast<mlir::lmhlo::CustomCallOp>(op);
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice handle,
+                      GetAllocationSlice(custom_call.getArgs().front()));
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice destination,
+                      GetAllocationSlice(custom_call.getOutput().front()));
+  auto it = host_offload_start_thunks_.find(handle);
+  TF_RET_CHECK(it != host_offload_start_thunks_.end())
+      << "couldn't find thunk for the host offload of a host-reload-start op";
+  TF_RET_CHECK(it->second->mem_size() == destination.size());
+  auto thunk = std::make_unique<HostReloadStartThunk>(
+      GetThunkInfo(op), *it->second, destination);
+  host_offload_start_thunks_.erase(it);
+
+  TF_RET_CHECK(
+      host_reload_start_thunks_.emplace(destination, thunk.get()).second)
+      << "buffer of a host reload is still in use";
+  AddThunkToThunkSequence(std::move(thunk));
+  return OkStatus();
+}
+
+Status IrEmitterUnnested::EmitHostReloadDone(mlir::Operation* op) {
+  auto custom_call = mlir::cast<mlir::lmhlo::CustomCallOp>(op);
+  TF_ASSIGN_OR_RETURN(BufferAllocation::Slice buffer,
+                      GetAllocationSlice(custom_call.getArgs().front()));
+  auto it = host_reload_start_thunks_.find(buffer);
+  TF_RET_CHECK(it != host_reload_start_thunks_.end())
+      << "couldn't find thunk for host-reload-start op";
+  AddThunkToThunkSequence(std::make_unique<HostTransferDoneThunk>(
+      Thunk::kHostReloadDone, GetThunkInfo(op), *it->second));
+  host_reload_start_thunks_.erase(it);
+  return OkStatus();
+}
+
 StatusOr<std::vector<ShapedSlice>> IrEmitterUnnested::GetShapedSlices(
     mlir::Operation::operand_range operands) {
   std::vector<ShapedSlice> shaped_slices;
@@ -5557,6 +5627,18 @@ Status IrEmitterUnnested::EmitOp(mlir::Operation* op) {
     if (call.getCallTargetName() == "SliceToDynamic") {
       return EmitSliceToDynamic(op);
     }
+    if (call.getCallTargetName() == kHostOffloadStartCallTarget) {
+      return EmitHostOffloadStart(op);
+    }
+    if (call.getCallTargetName() == kHostOffloadDoneCallTarget) {
+      return EmitHostOffloadDone(op);
+    }
+    if (call.getCallTargetName() == kHostReloadStartCallTarget) {
+      return EmitHostReloadStart(op);
+    }
+    if (call.getCallTargetName() == kHostReloadDoneCallTarget) {
+      return EmitHostReloadDone(op);
+    }
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
     if (call.getCallTargetName() == kTriangularSolveCallTarget) {
       return EmitTriangularSolveCustomCall(op);
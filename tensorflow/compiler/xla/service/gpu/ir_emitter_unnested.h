@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/compiler/mlir/xla/transforms/mhlo_to_lhlo_with_xla.h"
 #include "tensorflow/compiler/xla/service/custom_call_status.h"
 #include "tensorflow/compiler/xla/service/gpu/custom_call_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/host_offload_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/gpu/ir_emitter.h"
 #include "tensorflow/compiler/xla/service/gpu/kernel_mapping_scheme.h"
@@ -203,6 +204,12 @@ class IrEmitterUnnested : public IrEmitter {
   Status EmitNcclThunk(mlir::Operation* op);
   Status EmitAllReduceDone(mlir::Operation* op);
 
+  // Emits the thunks of the host transfers inserted by HostOffloader.
+  Status EmitHostOffloadStart(mlir::Operation* op);
+  Status EmitHostOffloadDone(mlir::Operation* op);
+  Status EmitHostReloadStart(mlir::Operation* op);
+  Status EmitHostReloadDone(mlir::Operation* op);
+
   template <typename ThunkType, typename OpT>
   Status EmitReplicaOrPartitionId(mlir::Operation* op);
 
@@ -727,6 +734,15 @@ class IrEmitterUnnested : public IrEmitter {
   absl::flat_hash_map<mlir::Operation*, NcclAllReduceStartThunk*>
       all_reduce_start_thunks_;
 
+  // Maps the slice that the next op of a host offload or reload takes, i.e.
+  // the s32[] handle of the offload or the buffer being reloaded, to the start
+  // thunk of the transfer. Each slice holds a single value until that op, so
+  // the ops of a transfer can be matched without SSA values in LMHLO.
+  absl::flat_hash_map<BufferAllocation::Slice, HostOffloadStartThunk*>
+      host_offload_start_thunks_;
+  absl::flat_hash_map<BufferAllocation::Slice, HostReloadStartThunk*>
+      host_reload_start_thunks_;
+
   // Begin optional members for XLA HLO -> LMHLO:
   absl::flat_hash_map<const mlir::Region*, std::unique_ptr<HloModule>>
       scratch_nested_computations_;
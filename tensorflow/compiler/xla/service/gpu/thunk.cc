@@ -57,6 +57,14 @@ Thunk::ExecuteParams::ExecuteParams(
       return "kFft";
     case Thunk::kGemm:
       return "kGemm";
+    case Thunk::kHostOffloadStart:
+      return "kHostOffloadStart";
+    case Thunk::kHostOffloadDone:
+      return "kHostOffloadDone";
+    case Thunk::kHostReloadStart:
+      return "kHostReloadStart";
+    case Thunk::kHostReloadDone:
+      return "kHostReloadDone";
     case Thunk::kInfeed:
       return "kInfeed";
     case Thunk::kKernel:
@@ -52,6 +52,10 @@ class Thunk {
     kCustomCall,
     kFft,
     kGemm,
+    kHostOffloadStart,
+    kHostOffloadDone,
+    kHostReloadStart,
+    kHostReloadDone,
     kInfeed,
     kKernel,
     kMemset32BitValue,
@@ -0,0 +1,272 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/compiler/xla/service/heap_simulator.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace xla {
+namespace {
+
+// Returns the start instruction of the asynchronous operation finished by
+// `done`, skipping over any async-update in between.
+const HloInstruction* StartOf(const HloInstruction& done) {
+  const HloInstruction* start = done.operand(0);
+  while (start->opcode() == HloOpcode::kAsyncUpdate) {
+    start = start->operand(0);
+  }
+  return start;
+}
+
+int64_t BytesDefinedBy(const HloInstruction& instr,
+                       const TuplePointsToAnalysis& points_to_analysis,
+                       const LogicalBuffer::SizeFunction& size_function) {
+  int64_t bytes = 0;
+  for (const LogicalBuffer* buffer :
+       points_to_analysis.GetBuffersDefinedByInstruction(&instr)) {
+    bytes += size_function(*buffer);
+  }
+  return bytes;
+}
+
+// Schedules `computation` bottom-up, picking the ready instruction that comes
+// last in `sequence`, except that:
+//  - a done is scheduled as soon as all of its users are, so that it runs as
+//    late as possible;
+//  - a start is held back, so that it runs as early as possible, until the
+//    instructions scheduled since its done cover its latency, or the live
+//    memory goes above `memory_limit`, or nothing else is ready.
+StatusOr<HloInstructionSequence> ScheduleToHideLatency(
+    const HloComputation& computation, const HloInstructionSequence& sequence,
+    const TuplePointsToAnalysis& points_to_analysis,
+    const LogicalBuffer::SizeFunction& size_function,
+    const LatencyEstimator& estimator, int64_t memory_limit) {
+  absl::flat_hash_map<const HloInstruction*, int64_t> position;
+  absl::flat_hash_map<const HloInstruction*, int64_t> unscheduled_successors;
+  for (int64_t i = 0; i < sequence.size(); ++i) {
+    const HloInstruction* instr = sequence.instructions()[i];
+    position[instr] = i;
+    unscheduled_successors[instr] =
+        instr->users().size() + instr->control_successors().size();
+  }
+
+  std::priority_queue<std::pair<int64_t, HloInstruction*>> ready;
+  std::vector<HloInstruction*> ready_dones;
+  std::vector<HloInstruction*> ready_starts;
+  auto add_to_ready = [&](HloInstruction* instr) {
+    if (IsAsyncDone(*instr)) {
+      ready_dones.push_back(instr);
+    } else if (IsAsyncStart(*instr)) {
+      ready_starts.push_back(instr);
+    } else {
+      ready.emplace(position.at(instr), instr);
+    }
+  };
+  for (HloInstruction* instr : sequence.instructions()) {
+    if (unscheduled_successors.at(instr) == 0) add_to_ready(instr);
+  }
+
+  // The latency left to cover of each operation whose done is scheduled but
+  // whose start is not.
+  absl::flat_hash_map<const HloInstruction*, double> in_flight;
+  auto remaining_latency = [&](const HloInstruction* start) {
+    auto it = in_flight.find(start);
+    return it == in_flight.end() ? 0.0 : it->second;
+  };
+
+  // The buffers of the instructions that have a scheduled user but are not
+  // scheduled themselves are live.
+  absl::flat_hash_set<const HloInstruction*> live;
+  int64_t live_bytes = 0;
+
+  std::vector<HloInstruction*> reversed;
+  reversed.reserve(sequence.size());
+  while (reversed.size() < sequence.size()) {
+    HloInstruction* next = nullptr;
+    if (!ready_dones.empty()) {
+      next = ready_dones.back();
+      ready_dones.pop_back();
+    } else {
+      auto start = absl::c_find_if(ready_starts, [&](HloInstruction* s) {
+        return live_bytes > memory_limit || remaining_latency(s) <= 0;
+      });
+      if (start == ready_starts.end() && ready.empty()) {
+        // Nothing is left to overlap with.
+        start = absl::c_min_element(
+            ready_starts, [&](HloInstruction* a, HloInstruction* b) {
+              return remaining_latency(a) < remaining_latency(b);
+            });
+      }
+      if (start != ready_starts.end()) {
+        next = *start;
+        ready_starts.erase(start);
+      } else {
+        TF_RET_CHECK(!ready.empty())
+            << "Cycle in computation " << computation.name();
+        next = ready.top().second;
+        ready.pop();
+      }
+    }
+    reversed.push_back(next);
+
+    if (IsAsyncDone(*next)) {
+      const HloInstruction* start = StartOf(*next);
+      in_flight[start] = estimator.AsyncLatency(*start);
+    } else if (IsAsyncStart(*next)) {
+      in_flight.erase(next);
+    } else if (!in_flight.empty()) {
+      const double time = estimator.ComputeTime(*next);
+      for (auto& operation : in_flight) {
+        operation.second -= time;
+      }
+    }
+
+    if (live.erase(next)) {
+      live_bytes -= BytesDefinedBy(*next, points_to_analysis, size_function);
+    }
+    for (HloInstruction* operand : next->unique_operands()) {
+      if (live.insert(operand).second) {
+        live_bytes += BytesDefinedBy(*operand, points_to_analysis,
+                                     size_function);
+      }
+      if (--unscheduled_successors.at(operand) == 0) add_to_ready(operand);
+    }
+    for (HloInstruction* predecessor : next->control_predecessors()) {
+      if (--unscheduled_successors.at(predecessor) == 0) {
+        add_to_ready(predecessor);
+      }
+    }
+  }
+
+  HloInstructionSequence result;
+  for (auto it = reversed.rbegin(); it != reversed.rend(); ++it) {
+    result.push_back(*it);
+  }
+  return result;
+}
+
+}  // namespace
+
+double ApproximateLatencyEstimator::ComputeTime(
+    const HloInstruction& instr) const {
+  switch (instr.opcode()) {
+    case HloOpcode::kBitcast:
+    case HloOpcode::kConstant:
+    case HloOpcode::kGetTupleElement:
+    case HloOpcode::kParameter:
+    case HloOpcode::kTuple:
+      return 0;
+    default:
+      break;
+  }
+  int64_t bytes = shape_size_bytes_(instr.shape());
+  for (const HloInstruction* operand : instr.operands()) {
+    bytes += shape_size_bytes_(operand->shape());
+  }
+  return bytes / memory_bytes_per_us_;
+}
+
+double ApproximateLatencyEstimator::AsyncLatency(
+    const HloInstruction& start) const {
+  int64_t bytes = 0;
+  for (const HloInstruction* operand : start.operands()) {
+    bytes += shape_size_bytes_(operand->shape());
+  }
+  return async_base_latency_us_ + bytes / async_bytes_per_us_;
+}
+
+bool IsAsyncStart(const HloInstruction& instr) {
+  switch (instr.opcode()) {
+    case HloOpcode::kAllGatherStart:
+    case HloOpcode::kAllReduceStart:
+    case HloOpcode::kAsyncStart:
+    case HloOpcode::kCollectivePermuteStart:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsAsyncDone(const HloInstruction& instr) {
+  switch (instr.opcode()) {
+    case HloOpcode::kAllGatherDone:
+    case HloOpcode::kAllReduceDone:
+    case HloOpcode::kAsyncDone:
+    case HloOpcode::kCollectivePermuteDone:
+      return true;
+    default:
+      return false;
+  }
+}
+
+MemorySchedulerAlgorithm LatencyHidingMemoryScheduler(
+    std::shared_ptr<const LatencyEstimator> estimator, int64_t memory_limit) {
+  return [estimator, memory_limit](
+             HloComputation* computation,
+             const TuplePointsToAnalysis& points_to_analysis,
+             const HloAliasAnalysis& alias_analysis,
+             const LogicalBuffer::SizeFunction& size_function,
+             const absl::flat_hash_map<const HloComputation*, int64_t>&
+                 memory_by_computation,
+             const MemorySchedulerPostprocessor& postprocessor,
+             int64_t* peak_memory) -> StatusOr<HloInstructionSequence> {
+    int64_t base_memory;
+    TF_ASSIGN_OR_RETURN(
+        HloInstructionSequence base,
+        DefaultMemoryScheduler(computation, points_to_analysis, alias_analysis,
+                               size_function, memory_by_computation,
+                               postprocessor, &base_memory));
+    if (peak_memory) *peak_memory = base_memory;
+    if (absl::c_none_of(computation->instructions(),
+                        [](const HloInstruction* instr) {
+                          return IsAsyncStart(*instr);
+                        })) {
+      return base;
+    }
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstructionSequence sequence,
+        ScheduleToHideLatency(*computation, base, points_to_analysis,
+                              size_function, *estimator, memory_limit));
+    TF_ASSIGN_OR_RETURN(const int64_t memory,
+                        HeapSimulator::MinimumMemoryForComputation(
+                            *computation, sequence, alias_analysis,
+                            size_function, &memory_by_computation));
+    if (memory > memory_limit && memory > base_memory) {
+      VLOG(1) << "Latency hiding schedule of " << computation->name()
+              << " needs " << memory << " bytes, over the limit of "
+              << memory_limit << "; keeping the memory-minimizing schedule.";
+      return base;
+    }
+    VLOG(1) << "Latency hiding schedule of " << computation->name()
+            << " needs " << memory << " bytes, the memory-minimizing one "
+            << base_memory;
+    if (peak_memory) *peak_memory = memory;
+    return sequence;
+  };
+}
+
+}  // namespace xla
@@ -0,0 +1,86 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_LATENCY_HIDING_SCHEDULER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_LATENCY_HIDING_SCHEDULER_H_
+
+#include <functional>
+#include <memory>
+
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
+#include "tensorflow/compiler/xla/shape.h"
+
+namespace xla {
+
+// Estimates how long instructions take, in microseconds, so that the latency
+// hiding scheduler can decide how much compute is needed to cover an
+// asynchronous operation. Backends implement this with their own cost model.
+class LatencyEstimator {
+ public:
+  virtual ~LatencyEstimator() = default;
+
+  // Returns how long `instr` keeps the device busy.
+  virtual double ComputeTime(const HloInstruction& instr) const = 0;
+
+  // Returns how long the asynchronous operation started by `start` takes to
+  // complete, during which independent instructions can run.
+  virtual double AsyncLatency(const HloInstruction& start) const = 0;
+};
+
+// A LatencyEstimator that only looks at the sizes of shapes: compute is bound
+// by memory bandwidth, and asynchronous operations take a fixed latency plus
+// the time to move their operands at the interconnect bandwidth.
+class ApproximateLatencyEstimator : public LatencyEstimator {
+ public:
+  ApproximateLatencyEstimator(
+      std::function<int64_t(const Shape&)> shape_size_bytes,
+      double memory_bytes_per_us, double async_bytes_per_us,
+      double async_base_latency_us)
+      : shape_size_bytes_(std::move(shape_size_bytes)),
+        memory_bytes_per_us_(memory_bytes_per_us),
+        async_bytes_per_us_(async_bytes_per_us),
+        async_base_latency_us_(async_base_latency_us) {}
+
+  double ComputeTime(const HloInstruction& instr) const override;
+  double AsyncLatency(const HloInstruction& start) const override;
+
+ private:
+  std::function<int64_t(const Shape&)> shape_size_bytes_;
+  double memory_bytes_per_us_;
+  double async_bytes_per_us_;
+  double async_base_latency_us_;
+};
+
+// Returns true if `instr` starts an asynchronous operation that is finished by
+// a matching done instruction, such as all-reduce-start or async-start.
+bool IsAsyncStart(const HloInstruction& instr);
+
+// Returns true if `instr` finishes an asynchronous operation.
+bool IsAsyncDone(const HloInstruction& instr);
+
+// Returns a scheduler that first computes a memory-minimizing sequence with
+// DefaultMemoryScheduler, then moves asynchronous starts earlier and dones
+// later until `estimator` says that the instructions in between cover the
+// latency of the operation. Instructions keep their memory-minimizing relative
+// order otherwise. Starts stop being moved while the live memory is above
+// `memory_limit`, and the memory-minimizing sequence is kept if the heap
+// simulator finds that the new one exceeds `memory_limit`.
+MemorySchedulerAlgorithm LatencyHidingMemoryScheduler(
+    std::shared_ptr<const LatencyEstimator> estimator, int64_t memory_limit);
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_LATENCY_HIDING_SCHEDULER_H_
@@ -0,0 +1,151 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace xla {
+namespace {
+
+// Every instruction but a parameter takes one microsecond.
+class FixedLatencyEstimator : public LatencyEstimator {
+ public:
+  explicit FixedLatencyEstimator(double latency) : latency_(latency) {}
+
+  double ComputeTime(const HloInstruction& instr) const override {
+    return instr.opcode() == HloOpcode::kParameter ? 0 : 1;
+  }
+  double AsyncLatency(const HloInstruction& start) const override {
+    return latency_;
+  }
+
+ private:
+  double latency_;
+};
+
+class LatencyHidingSchedulerTest : public HloTestBase {
+ protected:
+  // Schedules `module` and returns the position of each instruction of the
+  // entry computation.
+  StatusOr<absl::flat_hash_map<std::string, int>> Schedule(
+      HloModule* module, double latency, int64_t memory_limit) {
+    auto size_fn = [](const BufferValue& buffer) {
+      return ShapeUtil::ByteSizeOf(buffer.shape(), /*pointer_size=*/8);
+    };
+    TF_ASSIGN_OR_RETURN(
+        HloSchedule schedule,
+        ScheduleModule(module, size_fn,
+                       ComputationSchedulerToModuleScheduler(
+                           LatencyHidingMemoryScheduler(
+                               std::make_shared<FixedLatencyEstimator>(latency),
+                               memory_limit))));
+    const HloInstructionSequence& sequence =
+        schedule.sequence(module->entry_computation());
+    EXPECT_EQ(sequence.size(),
+              module->entry_computation()->instruction_count());
+    absl::flat_hash_map<std::string, int> position;
+    for (int i = 0; i < sequence.size(); ++i) {
+      position[sequence.instructions()[i]->name()] = i;
+    }
+    return position;
+  }
+};
+
+constexpr char kAllReduceModule[] = R"(
+HloModule module
+
+add {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY entry {
+  p0 = f32[1024] parameter(0)
+  p1 = f32[1024] parameter(1)
+  start = f32[1024] all-reduce-start(p0), to_apply=add
+  done = f32[1024] all-reduce-done(start)
+  n0 = f32[1024] negate(p1)
+  n1 = f32[1024] negate(n0)
+  n2 = f32[1024] negate(n1)
+  n3 = f32[1024] negate(n2)
+  ROOT result = f32[1024] add(done, n3)
+})";
+
+TEST_F(LatencyHidingSchedulerTest, OverlapsAllTheComputeWithLongCollective) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kAllReduceModule));
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto position,
+      Schedule(module.get(), /*latency=*/100,
+               /*memory_limit=*/std::numeric_limits<int64_t>::max()));
+  EXPECT_LT(position.at("start"), position.at("n0"));
+  EXPECT_GT(position.at("done"), position.at("n3"));
+  EXPECT_EQ(position.at("done") + 1, position.at("result"));
+}
+
+TEST_F(LatencyHidingSchedulerTest, OverlapsOnlyTheComputeNeeded) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kAllReduceModule));
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto position,
+      Schedule(module.get(), /*latency=*/2,
+               /*memory_limit=*/std::numeric_limits<int64_t>::max()));
+  // n2 and n3 cover the latency, so the start does not need to run earlier
+  // and keep p0 and its output live.
+  EXPECT_GT(position.at("start"), position.at("n1"));
+  EXPECT_LT(position.at("start"), position.at("n2"));
+  EXPECT_GT(position.at("done"), position.at("n3"));
+}
+
+TEST_F(LatencyHidingSchedulerTest, DoesNotOverlapOverMemoryLimit) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kAllReduceModule));
+  TF_ASSERT_OK_AND_ASSIGN(auto position, Schedule(module.get(),
+                                                  /*latency=*/100,
+                                                  /*memory_limit=*/0));
+  EXPECT_EQ(position.at("start") + 1, position.at("done"));
+}
+
+TEST_F(LatencyHidingSchedulerTest, ApproximateLatencyEstimator) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kAllReduceModule));
+  ApproximateLatencyEstimator estimator(
+      [](const Shape& shape) { return ShapeUtil::ByteSizeOf(shape); },
+      /*memory_bytes_per_us=*/1024, /*async_bytes_per_us=*/512,
+      /*async_base_latency_us=*/10);
+  const HloComputation* entry = module->entry_computation();
+  // A negate reads and writes 4KiB.
+  EXPECT_DOUBLE_EQ(estimator.ComputeTime(*FindInstruction(module.get(), "n0")),
+                   8);
+  EXPECT_DOUBLE_EQ(
+      estimator.ComputeTime(*entry->parameter_instruction(0)), 0);
+  EXPECT_DOUBLE_EQ(
+      estimator.AsyncLatency(*FindInstruction(module.get(), "start")), 18);
+}
+
+}  // namespace
+}  // namespace xla
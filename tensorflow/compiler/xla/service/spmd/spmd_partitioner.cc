@@ -3850,11 +3850,28 @@ StatusOr<bool> SpmdPartitioningVisitor::DoPartition(
       module->AddEmbeddedComputation(b_.Build(new_root.hlo()));
   TF_RETURN_IF_ERROR(
       DoCodeMotionForWindowedDotGeneralLoops(new_computation, options));
+  // Drop the intermediates that partitioning left unused right away, so they
+  // do not pile up while the rest of the module is partitioned.
+  TF_RETURN_IF_ERROR(HloDCE::RunOnComputation(
+                         new_computation,
+                         /*remove_cross_partition_collective_ops=*/true)
+                         .status());
 
-  // Replace the original computation with the new SPMD computation.
-  absl::flat_hash_map<HloComputation*, HloComputation*> replacement;
-  replacement[computation] = new_computation;
-  module->ReplaceComputations(replacement);
+  // Replace the original computation with the new SPMD computation. Nested
+  // computations only need their call site updated; rewriting the whole module
+  // for each of them makes partitioning quadratic in the number of loops and
+  // conditionals.
+  HloInstruction* caller = partitioner_->GetUniqueCaller(computation);
+  if (caller != nullptr && !computation->IsEntryComputation()) {
+    caller->ReplaceCalledComputations([&](HloComputation* callee) {
+      return callee == computation ? new_computation : callee;
+    });
+    TF_RETURN_IF_ERROR(module->RemoveEmbeddedComputation(computation));
+  } else {
+    absl::flat_hash_map<HloComputation*, HloComputation*> replacement;
+    replacement[computation] = new_computation;
+    module->ReplaceComputations(replacement);
+  }
   return changed_;
 }
 
@@ -4115,6 +4132,17 @@ StatusOr<bool> SpmdPartitioner::PartitionComputation(
   return visitor->DoPartition(computation, root_sharding, options_);
 }
 
+HloInstruction* SpmdPartitioner::GetUniqueCaller(
+    const HloComputation* computation) const {
+  auto it = computation_callers_.find(computation);
+  if (it == computation_callers_.end() || it->second.size() != 1 ||
+      !absl::c_linear_search(it->second[0]->called_computations(),
+                             computation)) {
+    return nullptr;
+  }
+  return it->second[0];
+}
+
 std::unique_ptr<SpmdPartitioningVisitor> SpmdPartitioner::CreateVisitor(
     HloComputation* computation, int64_t num_partitions, int64_t num_replicas,
     const SPMDCollectiveOpsCreator& collective_ops_creator,
@@ -4149,6 +4177,15 @@ StatusOr<bool> SpmdPartitioner::Run(HloModule* module) {
   FlattenCallGraph flatten;
   TF_ASSIGN_OR_RETURN(auto changed, flatten.Run(module));
 
+  computation_callers_.clear();
+  for (HloComputation* computation : module->computations()) {
+    for (HloInstruction* hlo : computation->instructions()) {
+      for (HloComputation* callee : hlo->called_computations()) {
+        computation_callers_[callee].push_back(hlo);
+      }
+    }
+  }
+
   SpmdLogger logger(options_.report_instruction_count,
                     /*disabled=*/!VLOG_IS_ON(1));
   auto program_shape = module->entry_computation()->ComputeProgramShape();
@@ -4161,6 +4198,7 @@ StatusOr<bool> SpmdPartitioner::Run(HloModule* module) {
       PartitionComputation(module->entry_computation(), root_sharding,
                            &next_channel_id, &logger));
   changed |= partition_changed;
+  computation_callers_.clear();
 
   // For the entry computation, make sure that the root instruction and the
   // parameters preserve their signatures.
@@ -241,6 +241,10 @@ class SpmdPartitioner : public HloModulePass {
 
   const SpmdPartitionerOptions& options() { return options_; }
 
+  // Returns the only instruction that calls `computation` in the module being
+  // partitioned by Run(), or nullptr if there is no such unique call site.
+  HloInstruction* GetUniqueCaller(const HloComputation* computation) const;
+
  protected:
   virtual std::unique_ptr<SpmdPartitioningVisitor> CreateVisitor(
       HloComputation* computation, int64_t num_partitions, int64_t num_replicas,
@@ -281,6 +285,12 @@ class SpmdPartitioner : public HloModulePass {
   SpmdPartitionerOptions options_;
   SPMDCollectiveOpsCreator collective_ops_creator_;
   std::vector<std::vector<int64_t>> device_groups_;
+
+  // Call sites of each computation, recorded by Run() once the call graph is
+  // flattened. A partitioned nested computation then replaces the original at
+  // its call site instead of rewriting every computation in the module.
+  absl::flat_hash_map<const HloComputation*, std::vector<HloInstruction*>>
+      computation_callers_;
 };
 
 // Class describes partition state of the data represented by an HLO created
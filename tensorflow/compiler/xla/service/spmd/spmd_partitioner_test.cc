@@ -15,6 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/spmd/spmd_partitioner.h"
 
+#include "absl/algorithm/container.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "tensorflow/compiler/xla/service/hlo_casting_utils.h"
 #include "tensorflow/compiler/xla/service/hlo_instructions.h"
 #include "tensorflow/compiler/xla/service/hlo_matchers.h"
@@ -25,6 +29,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace xla {
 namespace spmd {
@@ -3691,6 +3696,83 @@ ENTRY entry {
   EXPECT_THAT(root, AllOf(op::While(zero), op::Shape("s32[]")));
 }
 
+TEST_F(SpmdPartitioningTest, WhileInsideConditional) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+LoopCond {
+  x = (s32[], f32[8,4]) parameter(0),
+    sharding={{replicated}, {devices=[2,1]0,1}}
+  i = s32[] get-tuple-element(x), index=0, sharding={replicated}
+  const = s32[] constant(5), sharding={replicated}
+  ROOT lt = pred[] compare(i, const), direction=LT, sharding={replicated}
+}
+
+Inc {
+  x = (s32[], f32[8,4]) parameter(0),
+    sharding={{replicated}, {devices=[2,1]0,1}}
+  i = s32[] get-tuple-element(x), index=0, sharding={replicated}
+  data = f32[8,4] get-tuple-element(x), index=1,
+    sharding={devices=[2,1]0,1}
+  const = s32[] constant(1), sharding={replicated}
+  inc = s32[] add(i, const), sharding={replicated}
+  negate = f32[8,4] negate(data), sharding={devices=[2,1]0,1}
+  ROOT tuple = (s32[], f32[8,4]) tuple(inc, negate),
+    sharding={{replicated}, {devices=[2,1]0,1}}
+}
+
+Loop {
+  p = f32[8,4] parameter(0), sharding={devices=[2,1]0,1}
+  zero = s32[] constant(0), sharding={replicated}
+  init = (s32[], f32[8,4]) tuple(zero, p),
+    sharding={{replicated}, {devices=[2,1]0,1}}
+  while = (s32[], f32[8,4]) while(init), body=Inc, condition=LoopCond,
+    sharding={{replicated}, {devices=[2,1]0,1}}
+  ROOT gte = f32[8,4] get-tuple-element(while), index=1,
+    sharding={devices=[2,1]0,1}
+}
+
+Identity {
+  y = f32[8,4] parameter(0), sharding={devices=[2,1]0,1}
+  ROOT copy = f32[8,4] copy(y), sharding={devices=[2,1]0,1}
+}
+
+ENTRY entry {
+  pred = pred[] parameter(0), sharding={replicated}
+  a = f32[8,4] parameter(1), sharding={devices=[2,1]0,1}
+  ROOT cond = f32[8,4] conditional(pred, a, a),
+    true_computation=Loop, false_computation=Identity,
+    sharding={devices=[2,1]0,1}
+})";
+
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          PartitionComputation(hlo_string, /*num_devices=*/2));
+  VLOG(1) << module->ToString();
+
+  const auto root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root, AllOf(op::Conditional(op::Parameter(0), op::Parameter(1),
+                                          op::Parameter(1)),
+                          op::Shape("f32[4,4]")));
+  const auto loop_root = root->branch_computation(0)->root_instruction();
+  EXPECT_THAT(loop_root, AllOf(op::GetTupleElement(op::While(op::Tuple(
+                                   op::Constant(), op::Parameter(0)))),
+                               op::Shape("f32[4,4]")));
+  const HloInstruction* while_inst = loop_root->operand(0);
+  EXPECT_THAT(while_inst->while_body()->root_instruction(),
+              op::Tuple(op::Add(), AllOf(op::Negate(), op::Shape("f32[4,4]"))));
+
+  // Every computation called after partitioning is one of the partitioned
+  // computations that replaced the originals in the module.
+  const auto computations = module->computations();
+  for (const HloComputation* called :
+       {root->branch_computation(0), root->branch_computation(1),
+        while_inst->while_body(), while_inst->while_condition()}) {
+    EXPECT_TRUE(absl::c_linear_search(computations, called))
+        << called->name();
+    EXPECT_TRUE(absl::StrContains(called->name(), "_spmd")) << called->name();
+  }
+}
+
 TEST_F(SpmdPartitioningTest, SelectAndScatter_RetinaNet) {
   absl::string_view hlo_string = R"(
 HloModule module
@@ -10454,6 +10536,89 @@ ENTRY entry {
   EXPECT_THAT(root, AllOf(op::Gather(), op::Shape("f32[16,16,6,128,128]")));
 }
 
+// Builds a module with `num_layers` transformer-style MLP blocks sharded
+// across 8 partitions. With `layers_in_loops`, every block is the body of its
+// own while loop, as in layer-wise rematerialized or pipelined models.
+std::string MakeLayeredModule(int num_layers, bool layers_in_loops) {
+  const std::string batch = "{devices=[8,1]0,1,2,3,4,5,6,7}";
+  const std::string hidden = "{devices=[1,8]0,1,2,3,4,5,6,7}";
+  const std::string state_shape =
+      "(f32[256,1024], f32[1024,4096], f32[4096,1024])";
+  const std::string state_sharding =
+      absl::StrCat("{", batch, ", ", hidden, ", ", batch, "}");
+  auto layer = [&](int i, absl::string_view x, absl::string_view w1,
+                   absl::string_view w2) {
+    return absl::StrFormat(
+        "  h_%1$d = f32[256,4096] dot(%2$s, %3$s), lhs_contracting_dims={1}, "
+        "rhs_contracting_dims={0}, sharding=%5$s\n"
+        "  t_%1$d = f32[256,4096] tanh(h_%1$d), sharding=%5$s\n"
+        "  o_%1$d = f32[256,1024] dot(t_%1$d, %4$s), lhs_contracting_dims={1}, "
+        "rhs_contracting_dims={0}, sharding=%6$s\n"
+        "  y_%1$d = f32[256,1024] add(%2$s, o_%1$d), sharding=%6$s\n",
+        i, x, w1, w2, hidden, batch);
+  };
+
+  std::string computations;
+  std::string entry = absl::StrCat(
+      "ENTRY entry {\n  x = f32[256,1024] parameter(0), sharding=", batch,
+      "\n");
+  std::string x = "x";
+  for (int i = 0; i < num_layers; ++i) {
+    absl::StrAppend(&entry, "  w1_", i, " = f32[1024,4096] parameter(",
+                    2 * i + 1, "), sharding=", hidden, "\n", "  w2_", i,
+                    " = f32[4096,1024] parameter(", 2 * i + 2,
+                    "), sharding=", batch, "\n");
+    if (!layers_in_loops) {
+      absl::StrAppend(&entry, layer(i, x, absl::StrCat("w1_", i),
+                                    absl::StrCat("w2_", i)));
+      x = absl::StrCat("y_", i);
+      continue;
+    }
+    absl::StrAppend(
+        &computations, "cond_", i, " {\n  p = ", state_shape,
+        " parameter(0), sharding=", state_sharding,
+        "\n  ROOT c = pred[] constant(false), sharding={replicated}\n}\n\n",
+        "body_", i, " {\n  p = ", state_shape, " parameter(0), sharding=",
+        state_sharding, "\n  x = f32[256,1024] get-tuple-element(p), index=0, ",
+        "sharding=", batch,
+        "\n  w1 = f32[1024,4096] get-tuple-element(p), index=1, sharding=",
+        hidden,
+        "\n  w2 = f32[4096,1024] get-tuple-element(p), index=2, sharding=",
+        batch, "\n", layer(i, "x", "w1", "w2"), "  ROOT r = ", state_shape,
+        " tuple(y_", i, ", w1, w2), sharding=", state_sharding, "\n}\n\n");
+    absl::StrAppend(&entry, "  in_", i, " = ", state_shape, " tuple(", x,
+                    ", w1_", i, ", w2_", i, "), sharding=", state_sharding,
+                    "\n  loop_", i, " = ", state_shape, " while(in_", i,
+                    "), condition=cond_", i, ", body=body_", i,
+                    ", sharding=", state_sharding, "\n  out_", i,
+                    " = f32[256,1024] get-tuple-element(loop_", i,
+                    "), index=0, sharding=", batch, "\n");
+    x = absl::StrCat("out_", i);
+  }
+  absl::StrAppend(&entry, "  ROOT root = f32[256,1024] copy(", x,
+                  "), sharding=", batch, "\n}\n");
+  return absl::StrCat("HloModule layers\n\n", computations, entry);
+}
+
+void BM_PartitionLayers(::testing::benchmark::State& state) {
+  const int num_layers = state.range(0);
+  const bool layers_in_loops = state.range(1);
+  const std::string hlo_string = MakeLayeredModule(num_layers, layers_in_loops);
+  for (auto s : state) {
+    state.PauseTiming();
+    auto module = ParseAndReturnUnverifiedModule(hlo_string).ValueOrDie();
+    SpmdPartitioner partitioner(/*num_partitions=*/8, /*num_replicas=*/1,
+                                SpmdPartitionerOptions());
+    state.ResumeTiming();
+    TF_CHECK_OK(partitioner.Run(module.get()).status());
+  }
+}
+BENCHMARK(BM_PartitionLayers)
+    ->ArgPair(100, 0)
+    ->ArgPair(100, 1)
+    ->ArgPair(400, 0)
+    ->ArgPair(400, 1);
+
 }  // namespace
 }  // namespace spmd
 }  // namespace xla
@@ -227,6 +227,29 @@ CollectiveAdapter* MakeCollectiveAdapter(Tensor* output, int num_chunks,
   }
 }
 
+BaseCollectiveExecutor::BaseCollectiveExecutor(
+    CollectiveExecutorMgrInterface* cem, CollectiveRemoteAccess* remote_access,
+    int64_t step_id, const DeviceMgr* dev_mgr,
+    std::shared_ptr<UnboundedWorkQueue> work_queue)
+    : CollectiveExecutor(cem),
+      step_id_(step_id),
+      dev_mgr_(dev_mgr),
+      remote_access_(remote_access),
+      work_queue_(std::move(work_queue)) {
+  const CollectiveFusionBuffer::Options& fusion_options =
+      CollectiveFusionBuffer::DefaultOptions();
+  if (fusion_options.threshold_bytes > 0) {
+    fusion_buffer_ = std::make_unique<CollectiveFusionBuffer>(
+        fusion_options, this, dev_mgr_,
+        [this](OpKernelContext* ctx, const CollectiveParams* col_params,
+               const string& exec_key, const Tensor* input, Tensor* output,
+               StatusCallback done) {
+          LaunchCollective(ctx, col_params, exec_key, input, output,
+                           std::move(done));
+        });
+  }
+}
+
 BaseCollectiveExecutor::~BaseCollectiveExecutor() {}
 
 void BaseCollectiveExecutor::StartAbort(const Status& s) {
@@ -252,6 +275,9 @@ void BaseCollectiveExecutor::StartAbort(const Status& s) {
   if (cem_->GetNcclCommunicator() != nullptr) {
     cem_->GetNcclCommunicator()->StartAbort(status);
   }
+  if (fusion_buffer_ != nullptr) {
+    fusion_buffer_->StartAbort(status);
+  }
 }
 
 Status BaseCollectiveExecutor::GetStatus(const Status& s) {
@@ -311,10 +337,24 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
                           col_params->is_source))
                             ? &ctx->input(0)
                             : nullptr;
+  if (fusion_buffer_ != nullptr && input != nullptr &&
+      fusion_buffer_->CanFuse(*col_params, *input)) {
+    fusion_buffer_->Enqueue(ctx, col_params, exec_key, input, output,
+                            std::move(done_safe));
+    return;
+  }
+  LaunchCollective(ctx, col_params, exec_key, input, output,
+                   std::move(done_safe));
+}
+
+void BaseCollectiveExecutor::LaunchCollective(
+    OpKernelContext* ctx, const CollectiveParams* col_params,
+    const string& exec_key, const Tensor* input, Tensor* output,
+    StatusCallback done) {
   CollectiveImplementationInterface* col_impl = nullptr;
   Status status = CreateCollective(*col_params, &col_impl);
   if (!status.ok()) {
-    done_safe(status);
+    done(status);
     DCHECK_EQ(nullptr, col_impl);
     return;
   }
@@ -324,14 +364,14 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
       col_params, exec_key, step_id_, input, output);
   status = col_impl->InitializeCollectiveContext(col_ctx);
   if (!status.ok()) {
-    done_safe(status);
+    done(status);
     return;
   }
   // Run on an unbounded work queue that can handle blocking work so as to not
   // starve executor threads.
   col_impl->Ref();
   profiler::TraceMeProducer producer("BaseCollectiveExecutor::ExecuteAsync");
-  RunClosure([col_impl, col_ctx, done_safe, ctx,
+  RunClosure([col_impl, col_ctx, done, ctx,
               context_id = producer.GetContextId()]() {
     core::ScopedUnref unref(col_impl);
     profiler::TraceMeConsumer consumer(
@@ -343,9 +383,9 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
         },
         context_id);
     col_impl->Ref();
-    col_impl->Run([col_impl, col_ctx, done_safe](const Status& s) {
+    col_impl->Run([col_impl, col_ctx, done](const Status& s) {
       core::ScopedUnref unref(col_impl);
-      done_safe(s);
+      done(s);
     });
   });
 }
@@ -19,6 +19,7 @@ limitations under the License.
 #include <string>
 
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
+#include "tensorflow/core/common_runtime/collective_fusion_buffer.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
@@ -98,12 +99,7 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
   BaseCollectiveExecutor(CollectiveExecutorMgrInterface* cem,
                          CollectiveRemoteAccess* remote_access, int64_t step_id,
                          const DeviceMgr* dev_mgr,
-                         std::shared_ptr<UnboundedWorkQueue> work_queue)
-      : CollectiveExecutor(cem),
-        step_id_(step_id),
-        dev_mgr_(dev_mgr),
-        remote_access_(remote_access),
-        work_queue_(std::move(work_queue)) {}
+                         std::shared_ptr<UnboundedWorkQueue> work_queue);
 
   ~BaseCollectiveExecutor() override;
 
@@ -152,12 +148,21 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
  private:
   Status CreateCollective(const CollectiveParams& col_params,
                           CollectiveImplementationInterface** col_impl);
+  // Creates the implementation for `col_params` and runs it on the work
+  // queue. Shared by ExecuteAsync() and fused collectives.
+  void LaunchCollective(OpKernelContext* ctx,
+                        const CollectiveParams* col_params,
+                        const string& exec_key, const Tensor* input,
+                        Tensor* output, StatusCallback done);
   // Check if all ops on which this collective depends on have launched.
   bool CheckDependencies(const CollectiveParams& col_params)
       TF_EXCLUSIVE_LOCKS_REQUIRED(launch_mu_);
   // Tries to return the status that is the original error. It returns the
   // aborted status if the collective executor is aborted.
   Status GetStatus(const Status& s) TF_LOCKS_EXCLUDED(status_mu_);
+
+  // Null unless collective fusion is enabled.
+  std::unique_ptr<CollectiveFusionBuffer> fusion_buffer_;
 };
 
 }  // namespace tensorflow
@@ -17,14 +17,18 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <tuple>
 #include <utility>
 
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/allocator_retry.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -32,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/platform/stacktrace.h"
 #endif
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/allocation_sampler.h"
 #include "tensorflow/core/profiler/lib/scoped_memory_debug_annotation.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/protobuf/bfc_memory_map.pb.h"
@@ -40,6 +45,22 @@ namespace tensorflow {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 
+namespace {
+
+// The number of deallocations between exports of the fragmentation metrics.
+constexpr int64_t kFragmentationExportInterval = 1024;
+
+// Returns a small integer that is different for each thread, used to pick
+// the thread cache shard of the calling thread.
+int ThreadCacheShardIndex() {
+  static std::atomic<int> next_index{0};
+  static thread_local const int index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+}  // namespace
+
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
                            const Options& opts)
@@ -80,6 +101,21 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (opts.thread_cache_max_chunk_size > 0) {
+    const int num_shards = port::MaxParallelism();
+    const size_t num_sizes =
+        RoundedBytes(opts.thread_cache_max_chunk_size) / kMinAllocationSize;
+    VLOG(1) << "Creating " << num_shards << " thread caches for chunks of up "
+            << "to " << strings::HumanReadableNumBytes(num_sizes *
+                                                       kMinAllocationSize);
+    for (int i = 0; i < num_shards; ++i) {
+      thread_cache_shards_.push_back(std::make_unique<ThreadCacheShard>());
+      thread_cache_shards_.back()->free_chunks.resize(num_sizes);
+      cacheable_chunk_shards_.push_back(
+          std::make_unique<CacheableChunkShard>());
+    }
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -242,6 +278,10 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
     return r;
   } else {
     static const int64_t kMaxMillisToWait = 10000;  // 10 seconds
+    num_waiting_allocations_.fetch_add(1, std::memory_order_relaxed);
+    auto waiting_cleanup = gtl::MakeCleanup([this] {
+      num_waiting_allocations_.fetch_sub(1, std::memory_order_relaxed);
+    });
     r = retry_helper_.AllocateRaw(
         [this, &allocation_attr](size_t a, size_t nb, bool v) {
           uint64 freed_by_count = 0;
@@ -258,6 +298,16 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (num_bytes > 0 && UseThreadCache(RoundedBytes(num_bytes))) {
+    void* result = AllocateFromThreadCache(RoundedBytes(num_bytes));
+    if (result != nullptr) {
+      VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " " << result
+              << " from thread cache";
+      profiler::AllocationSampler::Global()->RecordAllocation(name_, result,
+                                                              num_bytes);
+      return result;
+    }
+  }
   void* result = [&] {
     if (!opts_.allow_retry_on_failure || !allocation_attr.retry_on_failure) {
       // If we have globally disabled retry-on-failure and fail to allocate an
@@ -305,6 +355,8 @@ void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
     }
   }();
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " " << result;
+  profiler::AllocationSampler::Global()->RecordAllocation(name_, result,
+                                                          num_bytes);
   return result;
 }
 
@@ -324,28 +376,9 @@ bool BFCAllocator::DeallocateFreeRegions(size_t rounded_bytes)
     return false;
   }
 
-  // Searching for free regions.
-  absl::flat_hash_set<void*> free_region_ptrs;
   size_t total_free_bytes = 0;
-  for (const AllocationRegion& region : region_manager_.regions()) {
-    ChunkHandle h = region_manager_.get_handle(region.ptr());
-    bool any_use = false;
-    while (h != kInvalidChunkHandle) {
-      const Chunk* c = ChunkFromHandle(h);
-      if (c->in_use()) {
-        any_use = true;
-        break;
-      }
-      h = c->next;
-    }
-
-    if (!any_use) {
-      VLOG(2) << "Found free region with ptr = " << region.ptr();
-      free_region_ptrs.insert(region.ptr());
-      total_free_bytes += region.memory_size();
-    }
-  }
-
+  absl::flat_hash_set<void*> free_region_ptrs =
+      FindFreeRegions(&total_free_bytes);
   if (total_free_bytes == 0) {
     return false;
   }
@@ -373,14 +406,35 @@ bool BFCAllocator::DeallocateFreeRegions(size_t rounded_bytes)
   return true;
 }
 
+absl::flat_hash_set<void*> BFCAllocator::FindFreeRegions(
+    size_t* total_free_bytes) {
+  absl::flat_hash_set<void*> free_region_ptrs;
+  *total_free_bytes = 0;
+  for (const AllocationRegion& region : region_manager_.regions()) {
+    ChunkHandle h = region_manager_.get_handle(region.ptr());
+    bool any_use = false;
+    while (h != kInvalidChunkHandle) {
+      const Chunk* c = ChunkFromHandle(h);
+      if (c->in_use()) {
+        any_use = true;
+        break;
+      }
+      h = c->next;
+    }
+
+    if (!any_use) {
+      VLOG(2) << "Found free region with ptr = " << region.ptr();
+      free_region_ptrs.insert(region.ptr());
+      *total_free_bytes += region.memory_size();
+    }
+  }
+  return free_region_ptrs;
+}
+
 void BFCAllocator::DeallocateRegions(
     const absl::flat_hash_set<void*>& region_ptrs)
     TF_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
-  // Explicitly remove the const qualifier as some compilers disallow passing
-  // const_iterator to std::vector::erase(), which is used in
-  // RemoveAllocationRegion().
-  auto regions =
-      const_cast<std::vector<AllocationRegion>*>(&region_manager_.regions());
+  std::vector<AllocationRegion>* regions = region_manager_.mutable_regions();
   auto it = regions->begin();
   while (it != regions->end()) {
     if (!region_ptrs.contains(it->ptr())) {
@@ -408,6 +462,104 @@ void BFCAllocator::DeallocateRegions(
   }
 }
 
+size_t BFCAllocator::ReleaseFreeTail(AllocationRegion* region) {
+  // Find the last chunk of the region.
+  ChunkHandle h = region_manager_.get_handle(region->ptr());
+  while (ChunkFromHandle(h)->next != kInvalidChunkHandle) {
+    h = ChunkFromHandle(h)->next;
+  }
+
+  size_t released_bytes = 0;
+  while (region->extent_sizes().size() > 1) {
+    Chunk* c = ChunkFromHandle(h);
+    const size_t extent_size = region->extent_sizes().back();
+    if (c->in_use() || c->size < extent_size) break;
+
+    ChunkHandle prev = c->prev;
+    RemoveFreeChunkFromBin(h);
+    if (c->size == extent_size) {
+      // The chunk is exactly the last sub-allocation. Free chunks are
+      // coalesced eagerly, so the previous chunk is in use.
+      ChunkFromHandle(prev)->next = kInvalidChunkHandle;
+      DeleteChunk(h);
+      h = prev;
+    } else {
+      c->size -= extent_size;
+      InsertFreeChunkIntoBin(h);
+    }
+
+    char* extent_ptr = static_cast<char*>(region->end_ptr()) - extent_size;
+    VLOG(2) << "Releasing the free tail at " << static_cast<void*>(extent_ptr)
+            << " of the region at " << region->ptr();
+    sub_allocator_->Free(extent_ptr, extent_size);
+    total_region_allocated_bytes_ -= extent_size;
+    region->shrink();
+    released_bytes += extent_size;
+  }
+  return released_bytes;
+}
+
+void BFCAllocator::OnStepBoundary() {
+  if (opts_.compaction_fragmentation_threshold <= 0) {
+    return;
+  }
+  // Kernels of the step may still be running, and a coalescing sub-allocator
+  // (the GpuVirtualMemAllocator) unmaps memory as soon as it is freed.
+  if (coalesce_regions_ && !opts_.synchronize_before_compaction) {
+    return;
+  }
+  bool compacted = false;
+  {
+    mutex_lock l(lock_);
+    if (GetFragmentation() >= opts_.compaction_fragmentation_threshold) {
+      compacted = CompactLocked() > 0;
+    }
+  }
+  if (compacted) {
+    retry_helper_.NotifyDealloc();
+  }
+}
+
+size_t BFCAllocator::Compact() {
+  size_t released_bytes;
+  {
+    mutex_lock l(lock_);
+    released_bytes = CompactLocked();
+  }
+  if (released_bytes > 0) {
+    retry_helper_.NotifyDealloc();
+  }
+  return released_bytes;
+}
+
+size_t BFCAllocator::CompactLocked() {
+  // Chunks held in thread caches would keep their regions alive.
+  FlushThreadCachesLocked();
+
+  if (opts_.synchronize_before_compaction &&
+      !opts_.synchronize_before_compaction()) {
+    LOG(WARNING) << "Skipping compaction of " << Name()
+                 << ": failed to synchronize pending work";
+    return 0;
+  }
+
+  size_t released_bytes = 0;
+  DeallocateRegions(FindFreeRegions(&released_bytes));
+  // Timestamped chunks are not coalesced, so the tail of a region may consist
+  // of several free chunks that are still referenced by
+  // `timestamped_chunks_`.
+  if (coalesce_regions_ && timing_counter_ == nullptr) {
+    for (AllocationRegion& region : *region_manager_.mutable_regions()) {
+      released_bytes += ReleaseFreeTail(&region);
+    }
+  }
+
+  VLOG(1) << "Compaction of " << Name() << " released "
+          << strings::HumanReadableNumBytes(released_bytes);
+  ExportFragmentationMetrics();
+  return released_bytes;
+}
+
 void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
                                         size_t num_bytes,
                                         bool dump_log_on_failure,
@@ -458,6 +610,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Chunks held in thread caches may be merged into a large enough chunk.
+  if (FlushThreadCachesLocked()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   // Reaching this point means that no chunks can satisfy the request. Also,
   // the unallocated bytes cannot satisfy the request. Before giving up, let's
   // try deallocating free regions so that suballocator can combine them with
@@ -475,6 +636,7 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   // couldn't find one.  This means we must have run out of memory,
   // Dump the memory log for analysis.
   MaybeWriteMemoryMap();
+  ExportFragmentationMetrics();
   if (dump_log_on_failure) {
     LOG(WARNING)
         << "Allocator (" << Name() << ") ran out of memory trying "
@@ -502,9 +664,18 @@ int64_t BFCAllocator::LargestFreeChunk() {
   return 0;
 }
 
+void BFCAllocator::ExportFragmentationMetrics() {
+  num_deallocs_since_export_ = 0;
+  metrics::UpdateBfcAllocatorFreeBytes(
+      name_, total_region_allocated_bytes_ - stats_.bytes_in_use,
+      LargestFreeChunk());
+}
+
 double BFCAllocator::GetFragmentation() {
   int64_t bytes_available = total_region_allocated_bytes_ - stats_.bytes_in_use;
-  DCHECK_GT(bytes_available, 0);
+  if (bytes_available <= 0) {
+    return 0;
+  }
   return static_cast<double>(bytes_available - LargestFreeChunk()) /
          bytes_available;
 }
@@ -591,6 +762,12 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         // Assign a unique id and increment the id counter, marking the
         // chunk as being in use.
         chunk->allocation_id = next_allocation_id_++;
+        if (UseThreadCache(rounded_bytes)) {
+          // The chunk may serve any allocation of `rounded_bytes` from a
+          // thread cache later.
+          chunk->requested_size = rounded_bytes;
+          RegisterCacheableChunk(chunk->ptr, rounded_bytes, chunk->size);
+        }
 
         // Update stats.
         ++stats_.num_allocs;
@@ -678,6 +855,12 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(3) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  profiler::AllocationSampler::Global()->RecordDeallocation(ptr);
+  if (ptr != nullptr && !thread_cache_shards_.empty() &&
+      num_waiting_allocations_.load(std::memory_order_relaxed) == 0 &&
+      DeallocateToThreadCache(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -687,8 +870,14 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     VLOG(2) << "tried to deallocate nullptr";
     return;
   }
+  if (!thread_cache_shards_.empty()) {
+    UnregisterCacheableChunk(ptr);
+  }
   mutex_lock l(lock_);
+  DeallocateRawLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -712,11 +901,124 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   // correct aggregation stats (bytes_in_use, fragmentation).
   AddTraceMe("MemoryDeallocation", chunk_ptr, req_bytes, alloc_bytes);
 
+  if (++num_deallocs_since_export_ >= kFragmentationExportInterval) {
+    ExportFragmentationMetrics();
+  }
+
   if (VLOG_IS_ON(4)) {
     LOG(INFO) << "F: " << RenderOccupancy();
   }
 }
 
+void* BFCAllocator::AllocateFromThreadCache(size_t rounded_bytes) {
+  ThreadCacheShard* shard =
+      thread_cache_shards_[ThreadCacheShardIndex() %
+                           thread_cache_shards_.size()]
+          .get();
+  ThreadCacheShard::CachedChunk chunk;
+  {
+    mutex_lock l(shard->mu);
+    auto& free_chunks =
+        shard->free_chunks[rounded_bytes / kMinAllocationSize - 1];
+    if (free_chunks.empty()) {
+      return nullptr;
+    }
+    chunk = free_chunks.back();
+    free_chunks.pop_back();
+    shard->bytes -= chunk.chunk_bytes;
+  }
+  thread_cache_bytes_.fetch_sub(chunk.chunk_bytes, std::memory_order_relaxed);
+  thread_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+  return chunk.ptr;
+}
+
+bool BFCAllocator::DeallocateToThreadCache(void* ptr) {
+  CacheableChunkShard* chunk_shard = CacheableChunkShardFor(ptr);
+  size_t rounded_bytes;
+  size_t chunk_bytes;
+  {
+    mutex_lock l(chunk_shard->mu);
+    auto it = chunk_shard->sizes.find(ptr);
+    if (it == chunk_shard->sizes.end()) {
+      return false;
+    }
+    std::tie(rounded_bytes, chunk_bytes) = it->second;
+  }
+  if (!UseThreadCache(rounded_bytes)) {
+    return false;
+  }
+  ThreadCacheShard* shard =
+      thread_cache_shards_[ThreadCacheShardIndex() %
+                           thread_cache_shards_.size()]
+          .get();
+  mutex_lock l(shard->mu);
+  if (shard->bytes + chunk_bytes > opts_.thread_cache_capacity) {
+    return false;
+  }
+  shard->free_chunks[rounded_bytes / kMinAllocationSize - 1].push_back(
+      {ptr, chunk_bytes});
+  shard->bytes += chunk_bytes;
+  thread_cache_bytes_.fetch_add(chunk_bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void BFCAllocator::RegisterCacheableChunk(const void* ptr,
+                                          size_t rounded_bytes,
+                                          size_t chunk_bytes) {
+  CacheableChunkShard* chunk_shard = CacheableChunkShardFor(ptr);
+  mutex_lock l(chunk_shard->mu);
+  chunk_shard->sizes[ptr] = {rounded_bytes, chunk_bytes};
+}
+
+void BFCAllocator::UnregisterCacheableChunk(const void* ptr) {
+  CacheableChunkShard* chunk_shard = CacheableChunkShardFor(ptr);
+  mutex_lock l(chunk_shard->mu);
+  chunk_shard->sizes.erase(ptr);
+}
+
+BFCAllocator::CacheableChunkShard* BFCAllocator::CacheableChunkShardFor(
+    const void* ptr) {
+  // Chunks are kMinAllocationSize aligned, so the low bits carry no
+  // information.
+  const uintptr_t index =
+      reinterpret_cast<uintptr_t>(ptr) >> kMinAllocationBits;
+  return cacheable_chunk_shards_[index % cacheable_chunk_shards_.size()].get();
+}
+
+bool BFCAllocator::FlushThreadCachesLocked() {
+  bool flushed = false;
+  for (const auto& shard : thread_cache_shards_) {
+    std::vector<std::vector<ThreadCacheShard::CachedChunk>> free_chunks(
+        shard->free_chunks.size());
+    {
+      mutex_lock l(shard->mu);
+      if (shard->bytes == 0) continue;
+      thread_cache_bytes_.fetch_sub(shard->bytes, std::memory_order_relaxed);
+      shard->bytes = 0;
+      free_chunks.swap(shard->free_chunks);
+    }
+    for (const auto& chunks : free_chunks) {
+      for (const ThreadCacheShard::CachedChunk& chunk : chunks) {
+        UnregisterCacheableChunk(chunk.ptr);
+        DeallocateRawLocked(chunk.ptr);
+        flushed = true;
+      }
+    }
+  }
+  return flushed;
+}
+
+void BFCAllocator::FlushThreadCaches() {
+  bool flushed;
+  {
+    mutex_lock l(lock_);
+    flushed = FlushThreadCachesLocked();
+  }
+  if (flushed) {
+    retry_helper_.NotifyDealloc();
+  }
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -1106,6 +1408,9 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
             << (memory_limit_ - total_region_allocated_bytes_)
             << " curr_region_allocation_bytes_: "
             << curr_region_allocation_bytes_;
+  LOG(INFO) << "Largest free chunk: "
+            << strings::HumanReadableNumBytes(LargestFreeChunk())
+            << " fragmentation: " << GetFragmentation();
   LOG(INFO) << "Stats: \n" << stats_.DebugString();
 }
 
@@ -1158,6 +1463,10 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
     bs->set_total_bytes_in_bin(bin_info.total_bytes_in_bin);
     bs->set_total_chunks_in_use(bin_info.total_chunks_in_use);
     bs->set_total_chunks_in_bin(bin_info.total_chunks_in_bin);
+    if (!b->free_chunks.empty()) {
+      bs->set_largest_free_chunk_bytes(
+          ChunkFromHandle(*b->free_chunks.rbegin())->size);
+    }
   }
 
   // Record state of every defined Chunk.
@@ -1202,11 +1511,22 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  stats.largest_free_block_bytes = LargestFreeChunk();
+  if (!thread_cache_shards_.empty()) {
+    // Chunks in thread caches are in use for the rest of the allocator, but
+    // not for the user.
+    stats.bytes_in_thread_caches =
+        thread_cache_bytes_.load(std::memory_order_relaxed);
+    stats.bytes_in_use -= stats.bytes_in_thread_caches;
+    stats.num_allocs += thread_cache_hits_.load(std::memory_order_relaxed);
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
+  thread_cache_hits_.store(0, std::memory_order_relaxed);
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
@@ -18,11 +18,13 @@ limitations under the License.
 
 #include <array>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/common_runtime/shared_counter.h"
@@ -66,6 +68,30 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If positive, chunks for allocations of up to this many bytes are kept in
+    // per-thread caches when freed, and handed out again to allocations of the
+    // same rounded size without taking the allocator lock. Such chunks report
+    // their rounded size as the requested size. The caches are returned to the
+    // allocator when an allocation would otherwise fail, and are not used
+    // once a timing counter is set.
+    size_t thread_cache_max_chunk_size = 0;
+
+    // The maximum number of bytes of free chunks held by each thread cache.
+    size_t thread_cache_capacity = 4 << 20;
+
+    // If positive, OnStepBoundary() calls Compact() whenever the
+    // fragmentation of the free memory (see GetFragmentation()) is at least
+    // this value. Sub-allocators that support coalescing may unmap memory
+    // right away when it is freed, so for them this requires
+    // `synchronize_before_compaction` to be set.
+    double compaction_fragmentation_threshold = 0;
+
+    // If set, compaction calls this before returning memory to the
+    // sub-allocator, to wait for all work that may still access free chunks,
+    // e.g. kernels enqueued on device streams. It is called with the
+    // allocator lock held. If it returns false, nothing is released.
+    std::function<bool()> synchronize_before_compaction;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -105,9 +131,76 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Returns the free chunks held in thread caches to the allocator.
+  void FlushThreadCaches();
+
+  void OnStepBoundary() override;
+
+  // Returns memory without live allocations to the sub-allocator: every
+  // region without chunks in use and, for sub-allocators that support
+  // coalescing, the free tail of each region in units of the sub-allocations
+  // it was extended by. Later allocations extend into fresh regions, so
+  // long-lived chunks no longer pin the free space around them. Unless
+  // Options::synchronize_before_compaction is set, the caller must ensure
+  // that no pending work accesses free chunks. Returns the number of bytes
+  // released.
+  size_t Compact();
+
  private:
   struct Bin;
 
+  // Free chunks kept for reuse without taking `lock_`. For the rest of the
+  // allocator these chunks are still in use. Each thread always uses the same
+  // shard.
+  struct ThreadCacheShard {
+    struct CachedChunk {
+      void* ptr;
+      size_t chunk_bytes;
+    };
+
+    mutex mu;
+    // `free_chunks[i]` holds chunks for allocations of
+    // `(i + 1) * kMinAllocationSize` bytes.
+    std::vector<std::vector<CachedChunk>> free_chunks TF_GUARDED_BY(mu);
+    // The total size of the chunks in `free_chunks`.
+    size_t bytes TF_GUARDED_BY(mu) = 0;
+  };
+
+  // The rounded allocation size and chunk size of every chunk that may enter
+  // a thread cache. Sharded by address, so that a free from any thread can
+  // tell whether the chunk is cacheable.
+  struct CacheableChunkShard {
+    mutex mu;
+    absl::flat_hash_map<const void*, std::pair<size_t, size_t>> sizes
+        TF_GUARDED_BY(mu);
+  };
+
+  // Returns true if allocations of `rounded_bytes` go through the thread
+  // caches.
+  bool UseThreadCache(size_t rounded_bytes) const {
+    return !thread_cache_shards_.empty() && timing_counter_ == nullptr &&
+           rounded_bytes <= opts_.thread_cache_max_chunk_size;
+  }
+
+  // Returns a chunk for an allocation of `rounded_bytes` from the calling
+  // thread's cache, or nullptr if it has none.
+  void* AllocateFromThreadCache(size_t rounded_bytes);
+
+  // Moves `ptr` into the calling thread's cache. Returns false if `ptr` must
+  // be freed to the allocator instead.
+  bool DeallocateToThreadCache(void* ptr);
+
+  void RegisterCacheableChunk(const void* ptr, size_t rounded_bytes,
+                              size_t chunk_bytes);
+
+  void UnregisterCacheableChunk(const void* ptr);
+
+  CacheableChunkShard* CacheableChunkShardFor(const void* ptr);
+
+  // Returns the chunks of all thread caches to the bins. Returns true if any
+  // chunk was returned.
+  bool FlushThreadCachesLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
                             bool dump_log_on_failure,
                             uint64 freed_before_count);
@@ -118,6 +211,8 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  void DeallocateRawLocked(void* ptr) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -139,6 +234,9 @@ class BFCAllocator : public Allocator {
   // The free chunks are sorted by size (and then address) in a bin.
   int64_t LargestFreeChunk() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Exports the free and largest free chunk bytes to the monitoring gauges.
+  void ExportFragmentationMetrics() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Add TraceMe (in memory allocation and deallocation) for memory stats
   // profiling. The chunk_ptr is passed to get information such as address,
   // chunk size and requested_size.
@@ -297,6 +395,7 @@ class BFCAllocator : public Allocator {
       const size_t n_handles =
           (memory_size + kMinAllocationSize - 1) / kMinAllocationSize;
       handles_.resize(n_handles, kInvalidChunkHandle);
+      extent_sizes_.push_back(memory_size);
     }
 
     AllocationRegion() = default;
@@ -317,6 +416,20 @@ class BFCAllocator : public Allocator {
       const size_t n_handles =
           (memory_size_ + kMinAllocationSize - 1) / kMinAllocationSize;
       handles_.resize(n_handles, kInvalidChunkHandle);
+      extent_sizes_.push_back(size);
+    }
+    // The sizes of the sub-allocations this region consists of, in address
+    // order.
+    const std::vector<size_t>& extent_sizes() const { return extent_sizes_; }
+    // Removes the last sub-allocation from the region. It must not hold any
+    // chunks.
+    void shrink() {
+      DCHECK_GT(extent_sizes_.size(), 1);
+      const size_t size = extent_sizes_.back();
+      extent_sizes_.pop_back();
+      memory_size_ -= size;
+      end_ptr_ = static_cast<void*>(static_cast<char*>(end_ptr_) - size);
+      handles_.resize(memory_size_ / kMinAllocationSize);
     }
     ChunkHandle get_handle(const void* p) const {
       return handles_[IndexFor(p)];
@@ -330,6 +443,7 @@ class BFCAllocator : public Allocator {
       std::swap(memory_size_, other->memory_size_);
       std::swap(end_ptr_, other->end_ptr_);
       std::swap(handles_, other->handles_);
+      std::swap(extent_sizes_, other->extent_sizes_);
     }
 
     size_t IndexFor(const void* p) const {
@@ -350,6 +464,8 @@ class BFCAllocator : public Allocator {
     // for the memory allocation represented by "p"
     std::vector<ChunkHandle> handles_;
 
+    std::vector<size_t> extent_sizes_;
+
     TF_DISALLOW_COPY_AND_ASSIGN(AllocationRegion);
   };
 
@@ -416,6 +532,7 @@ class BFCAllocator : public Allocator {
     void erase(const void* p) { return MutableRegionFor(p)->erase(p); }
 
     const std::vector<AllocationRegion>& regions() const { return regions_; }
+    std::vector<AllocationRegion>* mutable_regions() { return &regions_; }
 
    private:
     static bool Comparator(const void* ptr, const AllocationRegion& other) {
@@ -459,6 +576,18 @@ class BFCAllocator : public Allocator {
   // found and freed; false otherwise.
   bool DeallocateFreeRegions(size_t rounded_bytes);
 
+  // Returns the regions without chunks in use, and their total size in
+  // `total_free_bytes`.
+  absl::flat_hash_set<void*> FindFreeRegions(size_t* total_free_bytes)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Releases the free sub-allocations at the end of `region`. Returns the
+  // number of bytes released.
+  size_t ReleaseFreeTail(AllocationRegion* region)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  size_t CompactLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Helper function to deallocate regions.
   void DeallocateRegions(const absl::flat_hash_set<void*>& region_ptrs)
       TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
@@ -596,8 +725,20 @@ class BFCAllocator : public Allocator {
 
   std::atomic<uint64> safe_frontier_ = {0};
 
+  // Empty if thread caches are disabled. Shards are locked after `lock_`.
+  std::vector<std::unique_ptr<ThreadCacheShard>> thread_cache_shards_;
+  std::vector<std::unique_ptr<CacheableChunkShard>> cacheable_chunk_shards_;
+  // The total size of the chunks held in thread caches.
+  std::atomic<int64_t> thread_cache_bytes_{0};
+  // The number of allocations served from thread caches since the last
+  // ClearStats().
+  std::atomic<int64_t> thread_cache_hits_{0};
+  // The number of allocations waiting for memory to be freed. Frees bypass
+  // the thread caches while this is positive, so the waiters are notified.
+  std::atomic<int> num_waiting_allocations_{0};
+
   // Structures mutable after construction
-  mutable mutex lock_;
+  mutable profiled_mutex lock_{"BFCAllocator"};
   RegionManager region_manager_ TF_GUARDED_BY(lock_);
 
   std::vector<Chunk> chunks_ TF_GUARDED_BY(lock_);
@@ -611,6 +752,9 @@ class BFCAllocator : public Allocator {
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+  // The number of deallocations since the fragmentation metrics were last
+  // exported.
+  int64_t num_deallocs_since_export_ TF_GUARDED_BY(lock_) = 0;
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ = 0 TF_GUARDED_BY(lock_);
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
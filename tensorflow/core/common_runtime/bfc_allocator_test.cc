@@ -0,0 +1,326 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/bfc_memory_map.pb.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<BFCAllocator> CreateAllocator(
+    size_t total_memory, const BFCAllocator::Options& opts) {
+  return std::make_unique<BFCAllocator>(
+      std::make_unique<BasicCPUAllocator>(port::kNUMANoAffinity,
+                                          std::vector<SubAllocator::Visitor>(),
+                                          std::vector<SubAllocator::Visitor>()),
+      total_memory, "test_bfc", opts);
+}
+
+BFCAllocator::Options ThreadCacheOptions() {
+  BFCAllocator::Options opts;
+  opts.allow_growth = false;
+  opts.thread_cache_max_chunk_size = 4096;
+  return opts;
+}
+
+TEST(BFCAllocatorTest, ThreadCacheReusesChunks) {
+  auto a = CreateAllocator(1 << 20, ThreadCacheOptions());
+  void* p = a->AllocateRaw(1, 1000);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(a->RequestedSize(p), 1024);
+  a->DeallocateRaw(p);
+
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->bytes_in_thread_caches, 1024);
+
+  // Any allocation of the same rounded size reuses the cached chunk.
+  EXPECT_EQ(a->AllocateRaw(1, 900), p);
+  stats = a->GetStats();
+  EXPECT_EQ(stats->num_allocs, 2);
+  EXPECT_EQ(stats->bytes_in_use, 1024);
+  EXPECT_EQ(stats->bytes_in_thread_caches, 0);
+
+  // Other sizes do not.
+  void* q = a->AllocateRaw(1, 2000);
+  EXPECT_NE(q, p);
+  a->DeallocateRaw(p);
+  a->DeallocateRaw(q);
+  a->FlushThreadCaches();
+  stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->bytes_in_thread_caches, 0);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheLimits) {
+  BFCAllocator::Options opts = ThreadCacheOptions();
+  opts.thread_cache_capacity = 4096;
+  auto a = CreateAllocator(1 << 20, opts);
+
+  // Allocations above thread_cache_max_chunk_size are never cached.
+  void* large = a->AllocateRaw(1, 8192);
+  EXPECT_EQ(a->RequestedSize(large), 8192);
+  a->DeallocateRaw(large);
+  EXPECT_EQ(a->GetStats()->bytes_in_thread_caches, 0);
+
+  // The second chunk does not fit into the thread cache.
+  void* p = a->AllocateRaw(1, 4096);
+  void* q = a->AllocateRaw(1, 4096);
+  a->DeallocateRaw(p);
+  a->DeallocateRaw(q);
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_thread_caches, 4096);
+  EXPECT_EQ(stats->bytes_in_use, 0);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheFlushedWhenOutOfMemory) {
+  constexpr size_t kTotalMemory = 1 << 20;
+  BFCAllocator::Options opts = ThreadCacheOptions();
+  opts.thread_cache_capacity = kTotalMemory;
+  auto a = CreateAllocator(kTotalMemory, opts);
+
+  // Fill the whole region with small chunks and free them into the cache.
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < kTotalMemory / 4096; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 4096));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  EXPECT_EQ(a->GetStats()->bytes_in_thread_caches, kTotalMemory);
+
+  // A large allocation only fits once the cached chunks are merged again.
+  AllocationAttributes attrs;
+  attrs.retry_on_failure = false;
+  void* large = a->AllocateRaw(1, kTotalMemory / 2, attrs);
+  EXPECT_NE(large, nullptr);
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_thread_caches, 0);
+  EXPECT_EQ(stats->bytes_in_use, kTotalMemory / 2);
+  a->DeallocateRaw(large);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheConcurrentAllocations) {
+  auto a = CreateAllocator(64 << 20, ThreadCacheOptions());
+  {
+    thread::ThreadPool pool(Env::Default(), "bfc_thread_cache", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&a, t]() {
+        random::PhiloxRandom philox(t, 17);
+        random::SimplePhilox rand(&philox);
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 1000; ++i) {
+          if (ptrs.empty() || rand.Uniform(3) != 0) {
+            const size_t size = 1 + rand.Uniform(8192);
+            char* p = static_cast<char*>(a->AllocateRaw(1, size));
+            CHECK(p != nullptr);
+            p[0] = p[size - 1] = static_cast<char>(i);
+            ptrs.push_back(p);
+          } else {
+            const int index = rand.Uniform(ptrs.size());
+            a->DeallocateRaw(ptrs[index]);
+            ptrs[index] = ptrs.back();
+            ptrs.pop_back();
+          }
+        }
+        for (void* p : ptrs) {
+          a->DeallocateRaw(p);
+        }
+      });
+    }
+  }
+  a->FlushThreadCaches();
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->bytes_in_thread_caches, 0);
+}
+
+// Hands out consecutive memory from a fixed buffer, and only takes back
+// memory at its end, like the GpuVirtualMemAllocator.
+class ContiguousSubAllocator : public SubAllocator {
+ public:
+  explicit ContiguousSubAllocator(size_t capacity)
+      : SubAllocator({}, {}),
+        base_(static_cast<char*>(port::AlignedMalloc(capacity, 256))),
+        capacity_(capacity) {}
+  ~ContiguousSubAllocator() override { port::AlignedFree(base_); }
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    if (offset_ + num_bytes > capacity_) return nullptr;
+    void* ptr = base_ + offset_;
+    offset_ += num_bytes;
+    *bytes_received = num_bytes;
+    return ptr;
+  }
+
+  void Free(void* ptr, size_t num_bytes) override {
+    CHECK_EQ(static_cast<char*>(ptr) + num_bytes, base_ + offset_);
+    offset_ -= num_bytes;
+  }
+
+  bool SupportsCoalescing() const override { return true; }
+
+  size_t bytes_allocated() const { return offset_; }
+
+ private:
+  char* const base_;
+  const size_t capacity_;
+  size_t offset_ = 0;
+};
+
+// Allocates 1MiB in the initial 2MiB region, and then 1.5MiB that only fits
+// into a second 4MiB region.
+void AllocateIntoTwoRegions(Allocator* a, void** small, void** large) {
+  *small = a->AllocateRaw(1, 1 << 20);
+  ASSERT_NE(*small, nullptr);
+  *large = a->AllocateRaw(1, 3 << 19);
+  ASSERT_NE(*large, nullptr);
+}
+
+TEST(BFCAllocatorTest, FragmentationStats) {
+  auto a = CreateAllocator(32 << 20, BFCAllocator::Options());
+  void* small;
+  void* large;
+  AllocateIntoTwoRegions(a.get(), &small, &large);
+  a->DeallocateRaw(large);
+
+  EXPECT_EQ(a->GetStats()->largest_free_block_bytes, 4 << 20);
+  const MemoryDump dump = a->RecordMemoryMap();
+  int64_t largest_free_chunk_bytes = 0;
+  for (const BinSummary& bin : dump.bin_summary()) {
+    EXPECT_LE(bin.largest_free_chunk_bytes(),
+              bin.total_bytes_in_bin() - bin.total_bytes_in_use());
+    largest_free_chunk_bytes =
+        std::max(largest_free_chunk_bytes, bin.largest_free_chunk_bytes());
+  }
+  EXPECT_EQ(largest_free_chunk_bytes, 4 << 20);
+  a->DeallocateRaw(small);
+}
+
+TEST(BFCAllocatorTest, CompactReleasesFreeRegions) {
+  auto a = CreateAllocator(32 << 20, BFCAllocator::Options());
+  void* small;
+  void* large;
+  AllocateIntoTwoRegions(a.get(), &small, &large);
+  a->DeallocateRaw(large);
+
+  // Only the second region is empty.
+  EXPECT_EQ(a->Compact(), 4 << 20);
+  EXPECT_EQ(a->GetStats()->largest_free_block_bytes, 1 << 20);
+  EXPECT_EQ(a->Compact(), 0);
+
+  // Later allocations extend into a fresh region.
+  large = a->AllocateRaw(1, 3 << 19);
+  EXPECT_NE(large, nullptr);
+  a->DeallocateRaw(large);
+  a->DeallocateRaw(small);
+  EXPECT_GT(a->Compact(), 0);
+  EXPECT_EQ(a->GetStats()->largest_free_block_bytes, 0);
+}
+
+TEST(BFCAllocatorTest, CompactReleasesFreeTailOfCoalescedRegion) {
+  auto owned_sub_allocator =
+      std::make_unique<ContiguousSubAllocator>(32 << 20);
+  ContiguousSubAllocator* sub_allocator = owned_sub_allocator.get();
+  BFCAllocator a(std::move(owned_sub_allocator), 32 << 20, "test_bfc",
+                 BFCAllocator::Options());
+  void* small;
+  void* large;
+  AllocateIntoTwoRegions(&a, &small, &large);
+  EXPECT_EQ(sub_allocator->bytes_allocated(), 6 << 20);
+  a.DeallocateRaw(large);
+
+  // Both sub-allocations form one region, whose second half is released.
+  EXPECT_EQ(a.Compact(), 4 << 20);
+  EXPECT_EQ(sub_allocator->bytes_allocated(), 2 << 20);
+  EXPECT_EQ(a.Compact(), 0);
+
+  large = a.AllocateRaw(1, 3 << 19);
+  EXPECT_NE(large, nullptr);
+  a.DeallocateRaw(large);
+  a.DeallocateRaw(small);
+  a.Compact();
+  EXPECT_EQ(sub_allocator->bytes_allocated(), 0);
+}
+
+TEST(BFCAllocatorTest, CompactOnStepBoundary) {
+  // After freeing the second region, its 4MiB are the largest free chunk of
+  // the 5MiB free, so the fragmentation is 0.2.
+  for (double threshold : {0.0, 0.5, 0.1}) {
+    BFCAllocator::Options opts;
+    opts.compaction_fragmentation_threshold = threshold;
+    auto a = CreateAllocator(32 << 20, opts);
+    void* small;
+    void* large;
+    AllocateIntoTwoRegions(a.get(), &small, &large);
+    a->DeallocateRaw(large);
+    a->OnStepBoundary();
+    EXPECT_EQ(a->Compact(), threshold == 0.1 ? 0 : 4 << 20) << threshold;
+    a->DeallocateRaw(small);
+  }
+}
+
+TEST(BFCAllocatorTest, CompactOnStepBoundarySynchronizesCoalescedRegions) {
+  for (bool set_sync : {false, true}) {
+    for (bool sync_ok : {false, true}) {
+      auto owned_sub_allocator =
+          std::make_unique<ContiguousSubAllocator>(32 << 20);
+      ContiguousSubAllocator* sub_allocator = owned_sub_allocator.get();
+      BFCAllocator::Options opts;
+      opts.compaction_fragmentation_threshold = 0.1;
+      int num_syncs = 0;
+      if (set_sync) {
+        opts.synchronize_before_compaction = [&num_syncs, sync_ok]() {
+          ++num_syncs;
+          return sync_ok;
+        };
+      }
+      BFCAllocator a(std::move(owned_sub_allocator), 32 << 20, "test_bfc",
+                     opts);
+      void* small;
+      void* large;
+      AllocateIntoTwoRegions(&a, &small, &large);
+      a.DeallocateRaw(large);
+      a.OnStepBoundary();
+
+      // Without synchronization the step's kernels could still use the free
+      // tail, so it is only released after a successful synchronization.
+      const bool released = set_sync && sync_ok;
+      EXPECT_EQ(num_syncs, set_sync ? 1 : 0);
+      EXPECT_EQ(sub_allocator->bytes_allocated(),
+                released ? 2 << 20 : 6 << 20)
+          << set_sync << " " << sync_ok;
+      a.DeallocateRaw(small);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
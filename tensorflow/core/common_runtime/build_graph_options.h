@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <vector>
 
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/graph/collective_order.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -40,6 +41,12 @@ struct BuildGraphOptions {
   // edges, if `kAttrs` encode as attribute on collective op.
   GraphCollectiveOrder collective_order = GraphCollectiveOrder::kNone;
 
+  // If not empty, the shapes of the tensors fed to
+  // `callable_options.feed()`, in the same order. The fed placeholders are
+  // optimized as if they had these static shapes, so the resulting graph may
+  // only be run with feeds of exactly these shapes.
+  std::vector<TensorShape> feed_shapes;
+
   string DebugString() const;
 };
 
@@ -0,0 +1,510 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/collective_fusion_buffer.h"
+
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+// Upper bound on the number of requests fused into one collective. It also
+// fixes the size of the decision the leader posts to the other members.
+constexpr int kMaxFusedRequests = 128;
+
+string LaneName(const CollectiveParams& cp) {
+  return strings::StrCat(
+      cp.group.group_key, ":", DataTypeString(cp.instance.data_type), ":",
+      cp.merge_op->type_string(), ":",
+      cp.final_op == nullptr ? "" : cp.final_op->type_string(), ":",
+      cp.instance.impl_details.collective_name);
+}
+
+string DecisionKey(const string& lane_name, int64_t seq, int rank) {
+  return strings::StrCat("CollectiveFusionDecision:", lane_name, ":", seq, ":",
+                         rank);
+}
+
+string FusedExecKey(const string& lane_name, int64_t seq) {
+  return strings::StrCat("CollectiveFusion:", lane_name, ":", seq);
+}
+
+Device* LookupDevice(const DeviceMgr* dev_mgr, const CollectiveParams& cp,
+                     Status* s) {
+  Device* device = nullptr;
+  *s = dev_mgr->LookupDevice(cp.group.members[cp.default_rank].device.name(),
+                             &device);
+  return device;
+}
+
+AllocatorAttributes HostAttributes() {
+  AllocatorAttributes attr;
+  attr.set_on_host(true);
+  return attr;
+}
+
+}  // namespace
+
+/*static*/
+const CollectiveFusionBuffer::Options&
+CollectiveFusionBuffer::DefaultOptions() {
+  static const Options* options = [] {
+    Options* options = new Options;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_COLLECTIVE_FUSION_THRESHOLD_BYTES",
+                                    options->threshold_bytes,
+                                    &options->threshold_bytes));
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_COLLECTIVE_FUSION_WINDOW_MICROS",
+                                    options->window_micros,
+                                    &options->window_micros));
+    return options;
+  }();
+  return *options;
+}
+
+CollectiveFusionBuffer::CollectiveFusionBuffer(const Options& options,
+                                               CollectiveExecutor* col_exec,
+                                               const DeviceMgr* dev_mgr,
+                                               LaunchFn launch)
+    : options_(options),
+      col_exec_(col_exec),
+      dev_mgr_(dev_mgr),
+      launch_(std::move(launch)) {}
+
+bool CollectiveFusionBuffer::CanFuse(const CollectiveParams& col_params,
+                                     const Tensor& input) const {
+  return options_.threshold_bytes > 0 &&
+         col_params.instance.type == REDUCTION_COLLECTIVE &&
+         col_params.group.group_size > 1 && col_params.merge_op != nullptr &&
+         col_params.instance.impl_details.dependencies.empty() &&
+         input.NumElements() > 0 &&
+         input.TotalBytes() < options_.threshold_bytes;
+}
+
+void CollectiveFusionBuffer::Enqueue(OpKernelContext* ctx,
+                                     const CollectiveParams* col_params,
+                                     const string& exec_key,
+                                     const Tensor* input, Tensor* output,
+                                     StatusCallback done) {
+  const string lane_name = LaneName(*col_params);
+  std::shared_ptr<Lane> lane;
+  Status status;
+  {
+    mutex_lock l(mu_);
+    status = status_;
+    if (status.ok()) {
+      std::shared_ptr<Lane>& slot = lanes_[strings::StrCat(
+          col_params->default_rank, "/", lane_name)];
+      if (slot == nullptr) slot = std::make_shared<Lane>(lane_name);
+      lane = slot;
+    }
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  Request request{ctx,    col_params, exec_key, Hash64(exec_key),
+                  input,  output,     std::move(done)};
+  if (col_params->default_rank == 0) {
+    EnqueueOnLeader(std::move(lane), std::move(request));
+  } else {
+    EnqueueOnMember(std::move(lane), std::move(request));
+  }
+}
+
+void CollectiveFusionBuffer::StartAbort(const Status& s) {
+  std::vector<std::shared_ptr<Lane>> lanes;
+  {
+    mutex_lock l(mu_);
+    if (!status_.ok()) return;
+    status_ = s;
+    for (auto& it : lanes_) lanes.push_back(it.second);
+  }
+  for (const std::shared_ptr<Lane>& lane : lanes) {
+    std::vector<Request> failed;
+    {
+      mutex_lock l(lane->mu);
+      failed.swap(lane->pending);
+      lane->pending_bytes = 0;
+      ++lane->generation;
+      lane->has_decision = false;
+      lane->decision.clear();
+    }
+    FailRequests(std::move(failed), s);
+  }
+}
+
+void CollectiveFusionBuffer::EnqueueOnLeader(std::shared_ptr<Lane> lane,
+                                             Request request) {
+  std::vector<Request> batch;
+  int64_t seq = -1;
+  bool start_window = false;
+  uint64 generation = 0;
+  {
+    mutex_lock l(lane->mu);
+    lane->pending_bytes += request.input->TotalBytes();
+    lane->pending.push_back(std::move(request));
+    if (lane->pending_bytes >= options_.threshold_bytes ||
+        lane->pending.size() >= kMaxFusedRequests) {
+      TakePendingLocked(lane.get(), &batch, &seq);
+    } else if (lane->pending.size() == 1) {
+      start_window = true;
+      generation = lane->generation;
+    }
+  }
+  if (start_window) {
+    // The timer only holds a weak reference: once the lane has been flushed
+    // the step, and with it this buffer, may already be gone.
+    std::weak_ptr<Lane> weak_lane = lane;
+    SchedNonBlockingClosureAfter(
+        options_.window_micros, [this, weak_lane, generation]() {
+          std::shared_ptr<Lane> lane = weak_lane.lock();
+          if (lane != nullptr) FlushOnTimer(std::move(lane), generation);
+        });
+  }
+  if (!batch.empty()) {
+    Status s = PostDecision(*lane, seq, batch);
+    if (!s.ok()) {
+      FailRequests(std::move(batch), s);
+      return;
+    }
+    Launch(lane->name, seq, std::move(batch));
+  }
+}
+
+void CollectiveFusionBuffer::FlushOnTimer(std::shared_ptr<Lane> lane,
+                                          uint64 generation) {
+  std::vector<Request> batch;
+  int64_t seq = -1;
+  {
+    mutex_lock l(lane->mu);
+    if (lane->generation != generation || lane->pending.empty()) return;
+    TakePendingLocked(lane.get(), &batch, &seq);
+  }
+  // Requests are pending, so the step and this buffer are still alive.
+  Status s = PostDecision(*lane, seq, batch);
+  if (!s.ok()) {
+    FailRequests(std::move(batch), s);
+    return;
+  }
+  Launch(lane->name, seq, std::move(batch));
+}
+
+void CollectiveFusionBuffer::TakePendingLocked(Lane* lane,
+                                               std::vector<Request>* batch,
+                                               int64_t* seq) {
+  batch->swap(lane->pending);
+  lane->pending_bytes = 0;
+  ++lane->generation;
+  *seq = lane->next_seq++;
+}
+
+Status CollectiveFusionBuffer::PostDecision(const Lane& lane, int64_t seq,
+                                            const std::vector<Request>& batch) {
+  const Request& first = batch.front();
+  const CollectiveParams& cp = *first.col_params;
+  Status s;
+  Device* device = LookupDevice(dev_mgr_, cp, &s);
+  TF_RETURN_IF_ERROR(s);
+  // Shared by all posts; each keeps it alive until its peer has consumed it.
+  auto decision = std::make_shared<Tensor>(
+      DT_INT64, TensorShape({kMaxFusedRequests + 1}));
+  auto flat = decision->flat<int64_t>();
+  flat.setZero();
+  flat(0) = batch.size();
+  for (int i = 0; i < batch.size(); ++i) {
+    flat(i + 1) = static_cast<int64_t>(batch[i].fingerprint);
+  }
+  for (int rank = 1; rank < cp.group.group_size; ++rank) {
+    const CollGroupMember& member = cp.group.members[rank];
+    col_exec_->remote_access()->PostToPeer(
+        member.device.name(), member.task, DecisionKey(lane.name, seq, rank),
+        device, first.ctx->op_device_context(), HostAttributes(),
+        decision.get(), device->attributes().locality(),
+        first.ctx->cancellation_manager(), [decision](const Status& s) {
+          // The receiving member reports its own failure; this buffer may
+          // be gone by the time the post is released.
+          if (!s.ok()) VLOG(1) << "Posting fusion decision failed: " << s;
+        });
+  }
+  return OkStatus();
+}
+
+void CollectiveFusionBuffer::EnqueueOnMember(std::shared_ptr<Lane> lane,
+                                             Request request) {
+  std::vector<Request> batch;
+  int64_t batch_seq = -1;
+  int64_t recv_seq = -1;
+  Request recv_request;
+  bool receive = false;
+  {
+    mutex_lock l(lane->mu);
+    lane->pending.push_back(std::move(request));
+    if (lane->has_decision) {
+      MatchDecisionLocked(lane.get(), &batch, &batch_seq);
+    }
+    receive = NeedsDecisionLocked(lane.get(), &recv_seq, &recv_request);
+  }
+  if (receive) ReceiveDecision(lane, recv_seq, recv_request);
+  if (!batch.empty()) Launch(lane->name, batch_seq, std::move(batch));
+}
+
+bool CollectiveFusionBuffer::NeedsDecisionLocked(Lane* lane, int64_t* seq,
+                                                 Request* request) {
+  if (lane->receiving || lane->has_decision || lane->pending.empty()) {
+    return false;
+  }
+  lane->receiving = true;
+  *seq = lane->next_seq;
+  // The context and params stay valid: the front request remains pending
+  // until the decision being received has been matched.
+  request->ctx = lane->pending.front().ctx;
+  request->col_params = lane->pending.front().col_params;
+  return true;
+}
+
+bool CollectiveFusionBuffer::MatchDecisionLocked(Lane* lane,
+                                                 std::vector<Request>* batch,
+                                                 int64_t* seq) {
+  std::vector<int> indices;
+  indices.reserve(lane->decision.size());
+  std::vector<bool> taken(lane->pending.size(), false);
+  for (uint64 fingerprint : lane->decision) {
+    int index = -1;
+    for (int i = 0; i < lane->pending.size(); ++i) {
+      if (!taken[i] && lane->pending[i].fingerprint == fingerprint) {
+        index = i;
+        break;
+      }
+    }
+    // The leader has flushed requests this member has not issued yet.
+    if (index < 0) return false;
+    taken[index] = true;
+    indices.push_back(index);
+  }
+  batch->reserve(indices.size());
+  for (int index : indices) {
+    batch->push_back(std::move(lane->pending[index]));
+  }
+  std::vector<Request> remaining;
+  for (int i = 0; i < lane->pending.size(); ++i) {
+    if (!taken[i]) remaining.push_back(std::move(lane->pending[i]));
+  }
+  lane->pending.swap(remaining);
+  lane->has_decision = false;
+  lane->decision.clear();
+  *seq = lane->next_seq++;
+  return true;
+}
+
+void CollectiveFusionBuffer::ReceiveDecision(std::shared_ptr<Lane> lane,
+                                             int64_t seq,
+                                             const Request& request) {
+  const CollectiveParams& cp = *request.col_params;
+  Status s;
+  Device* device = LookupDevice(dev_mgr_, cp, &s);
+  auto decision = std::make_shared<Tensor>(
+      DT_INT64, TensorShape({kMaxFusedRequests + 1}));
+  if (!s.ok()) {
+    OnDecision(std::move(lane), s, *decision);
+    return;
+  }
+  const CollGroupMember& leader = cp.group.members[0];
+  col_exec_->remote_access()->RecvFromPeer(
+      leader.device.name(), leader.task, leader.is_local,
+      DecisionKey(lane->name, seq, cp.default_rank), device,
+      request.ctx->op_device_context(), HostAttributes(), decision.get(),
+      device->attributes().locality(), 0 /*dev_to_dev_stream_index*/,
+      request.ctx->cancellation_manager(),
+      [this, lane, decision](const Status& s) {
+        OnDecision(lane, s, *decision);
+      });
+}
+
+void CollectiveFusionBuffer::OnDecision(std::shared_ptr<Lane> lane,
+                                        const Status& s,
+                                        const Tensor& decision) {
+  std::vector<Request> batch;
+  std::vector<Request> failed;
+  Status status = s;
+  int64_t batch_seq = -1;
+  int64_t recv_seq = -1;
+  Request recv_request;
+  bool receive = false;
+  {
+    mutex_lock l(lane->mu);
+    lane->receiving = false;
+    const auto flat = decision.flat<int64_t>();
+    if (status.ok() && (flat(0) <= 0 || flat(0) > kMaxFusedRequests)) {
+      status = errors::Internal("Received a fusion decision for ", flat(0),
+                                " collectives on lane ", lane->name);
+    }
+    if (!status.ok()) {
+      failed.swap(lane->pending);
+    } else {
+      lane->has_decision = true;
+      lane->decision.clear();
+      for (int i = 1; i <= flat(0); ++i) {
+        lane->decision.push_back(static_cast<uint64>(flat(i)));
+      }
+      MatchDecisionLocked(lane.get(), &batch, &batch_seq);
+      receive = NeedsDecisionLocked(lane.get(), &recv_seq, &recv_request);
+    }
+  }
+  // Only touch this buffer while requests are outstanding: with none left the
+  // step may already have been torn down.
+  if (!failed.empty()) {
+    FailRequests(std::move(failed), status);
+    return;
+  }
+  if (receive) ReceiveDecision(lane, recv_seq, recv_request);
+  if (!batch.empty()) Launch(lane->name, batch_seq, std::move(batch));
+}
+
+void CollectiveFusionBuffer::Launch(const string& lane_name, int64_t seq,
+                                    std::vector<Request> requests) {
+  VLOG(2) << "Fusing " << requests.size() << " collectives on lane "
+          << lane_name << " as batch " << seq;
+  auto batch = std::make_shared<Batch>();
+  batch->requests = std::move(requests);
+  // Copies in and out of the fused buffer may block.
+  col_exec_->RunClosure(
+      [this, lane_name, seq, batch]() { RunBatch(lane_name, seq, batch); });
+}
+
+void CollectiveFusionBuffer::RunBatch(const string& lane_name, int64_t seq,
+                                      std::shared_ptr<Batch> batch) {
+  const Request& first = batch->requests.front();
+  const CollectiveParams& cp = *first.col_params;
+  // Collectives ordered after a fused request only wait for it to launch.
+  for (int i = 1; i < batch->requests.size(); ++i) {
+    col_exec_->UnblockDependencies(*batch->requests[i].col_params);
+  }
+  int64_t num_elements = 0;
+  for (const Request& request : batch->requests) {
+    num_elements += request.input->NumElements();
+  }
+  Status s = first.ctx->allocate_temp(cp.instance.data_type,
+                                      TensorShape({num_elements}),
+                                      &batch->fused,
+                                      first.ctx->output_alloc_attr(0));
+  if (s.ok()) s = CopyBatch(*batch, /*into_fused=*/true);
+
+  core::RefCountPtr<CollectiveParams> fused(new CollectiveParams());
+  fused->name = strings::StrCat(cp.name, "/fused");
+  fused->group = cp.group;
+  fused->instance = cp.instance;
+  fused->instance.shape = TensorShape({num_elements});
+  fused->instance.impl_details.subdiv_permutations.clear();
+  fused->instance.impl_details.subdiv_source_rank.clear();
+  fused->instance.impl_details.dependencies.clear();
+  fused->default_rank = cp.default_rank;
+  fused->merge_op = cp.merge_op;
+  fused->final_op = cp.final_op;
+  fused->run_group_initialization = cp.run_group_initialization;
+  if (s.ok()) {
+    CollectiveImplementationInterface* col_impl = nullptr;
+    s = CollectiveRegistry::Lookup(
+        fused->instance.impl_details.collective_name, &col_impl);
+    if (s.ok()) {
+      s = col_impl->InitializeCollectiveParams(fused.get());
+      col_impl->Unref();
+    }
+  }
+  if (!s.ok()) {
+    FailRequests(std::move(batch->requests), s);
+    return;
+  }
+  launch_(first.ctx, fused.get(), FusedExecKey(lane_name, seq), &batch->fused,
+          &batch->fused, [this, batch](const Status& s) {
+            if (!s.ok()) {
+              FailRequests(std::move(batch->requests), s);
+              return;
+            }
+            col_exec_->RunClosure([this, batch]() {
+              Status s = CopyBatch(*batch, /*into_fused=*/false);
+              std::vector<Request> requests = std::move(batch->requests);
+              for (Request& request : requests) request.done(s);
+            });
+          });
+}
+
+Status CollectiveFusionBuffer::CopyBatch(const Batch& batch, bool into_fused) {
+  mutex mu;
+  Status status;
+  BlockingCounter pending(batch.requests.size());
+  auto done = [&mu, &status, &pending](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  // Views of each request's slice of the fused buffer; they must outlive the
+  // asynchronous copies.
+  std::vector<Tensor> views(batch.requests.size());
+  int64_t offset = 0;
+  for (int i = 0; i < batch.requests.size(); ++i) {
+    const Request& request = batch.requests[i];
+    const int64_t n = request.input->NumElements();
+    Tensor* view = &views[i];
+    CHECK(view->CopyFrom(batch.fused.Slice(offset, offset + n),
+                         request.input->shape()));
+    offset += n;
+    Status s;
+    Device* device = LookupDevice(dev_mgr_, *request.col_params, &s);
+    if (!s.ok()) {
+      done(s);
+      continue;
+    }
+    DeviceContext* dev_ctx = request.ctx->op_device_context();
+    if (into_fused) {
+      CollectiveRemoteAccessLocal::MemCpyAsync(
+          dev_ctx, dev_ctx, device, device, request.ctx->input_alloc_attr(0),
+          request.ctx->output_alloc_attr(0), request.input, view,
+          0 /*dev_to_dev_stream_index*/, done);
+    } else {
+      CollectiveRemoteAccessLocal::MemCpyAsync(
+          dev_ctx, dev_ctx, device, device, request.ctx->output_alloc_attr(0),
+          request.ctx->output_alloc_attr(0), view, request.output,
+          0 /*dev_to_dev_stream_index*/, done);
+    }
+  }
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+/*static*/
+void CollectiveFusionBuffer::FailRequests(std::vector<Request> requests,
+                                          const Status& s) {
+  for (Request& request : requests) request.done(s);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,160 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_BUFFER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_BUFFER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+class DeviceMgr;
+
+// Accumulates small all-reduces issued during one step and launches each
+// accumulated batch as a single collective over a concatenated buffer, so
+// that models with many small variables pay the per-collective latency once
+// per batch instead of once per tensor.
+//
+// Requests are grouped into lanes by group, data type, merge/final op and
+// implementation. Every member of a group has to fuse exactly the same
+// requests in the same order, so the member of rank 0 decides: it flushes
+// its lane once the pending bytes reach the threshold or the oldest pending
+// request has waited for the window, and posts the fingerprints of the
+// flushed requests to every other member. The other members hold their
+// requests until the decision naming them arrives, then launch the same
+// fused collective.
+class CollectiveFusionBuffer {
+ public:
+  struct Options {
+    // Reductions whose input is smaller than this many bytes are fused, and
+    // a lane is flushed once it holds this many bytes. Zero disables fusion.
+    int64_t threshold_bytes = 0;
+    // Longest time a fusable request waits on the leader before its lane is
+    // flushed.
+    int64_t window_micros = 500;
+  };
+
+  // Options read once from TF_COLLECTIVE_FUSION_THRESHOLD_BYTES and
+  // TF_COLLECTIVE_FUSION_WINDOW_MICROS.
+  static const Options& DefaultOptions();
+
+  // Launches `col_params` over `input` and `output` exactly like an unfused
+  // collective. Provided by the owning CollectiveExecutor.
+  using LaunchFn = std::function<void(
+      OpKernelContext* ctx, const CollectiveParams* col_params,
+      const string& exec_key, const Tensor* input, Tensor* output,
+      StatusCallback done)>;
+
+  CollectiveFusionBuffer(const Options& options, CollectiveExecutor* col_exec,
+                         const DeviceMgr* dev_mgr, LaunchFn launch);
+
+  // Returns true if the collective described by `col_params` may be passed to
+  // Enqueue(). The answer only depends on state that is identical on every
+  // member of the group.
+  bool CanFuse(const CollectiveParams& col_params, const Tensor& input) const;
+
+  // Queues a reduction of `input` into `output`. `done` is called once the
+  // fused collective containing it has completed, or with an error.
+  void Enqueue(OpKernelContext* ctx, const CollectiveParams* col_params,
+               const string& exec_key, const Tensor* input, Tensor* output,
+               StatusCallback done);
+
+  // Fails all queued requests with `s` and every later Enqueue() call.
+  void StartAbort(const Status& s) TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Request {
+    OpKernelContext* ctx = nullptr;
+    const CollectiveParams* col_params = nullptr;
+    string exec_key;
+    uint64 fingerprint = 0;
+    const Tensor* input = nullptr;
+    Tensor* output = nullptr;
+    StatusCallback done;
+  };
+
+  struct Lane {
+    explicit Lane(const string& name) : name(name) {}
+
+    // Identical on every member of the group.
+    const string name;
+    mutex mu;
+    std::vector<Request> pending TF_GUARDED_BY(mu);
+    int64_t pending_bytes TF_GUARDED_BY(mu) = 0;
+    // Bumped on every flush so that stale window timers do nothing.
+    uint64 generation TF_GUARDED_BY(mu) = 0;
+    // Sequence number of the next batch launched from this lane.
+    int64_t next_seq TF_GUARDED_BY(mu) = 0;
+    // Non-leaders only: whether a decision is being received, and the
+    // received decision that has not been matched yet.
+    bool receiving TF_GUARDED_BY(mu) = false;
+    bool has_decision TF_GUARDED_BY(mu) = false;
+    std::vector<uint64> decision TF_GUARDED_BY(mu);
+  };
+
+  struct Batch {
+    std::vector<Request> requests;
+    Tensor fused;
+  };
+
+  void EnqueueOnLeader(std::shared_ptr<Lane> lane, Request request);
+  void EnqueueOnMember(std::shared_ptr<Lane> lane, Request request);
+  void FlushOnTimer(std::shared_ptr<Lane> lane, uint64 generation);
+  void TakePendingLocked(Lane* lane, std::vector<Request>* batch,
+                         int64_t* seq) TF_EXCLUSIVE_LOCKS_REQUIRED(lane->mu);
+  bool MatchDecisionLocked(Lane* lane, std::vector<Request>* batch,
+                           int64_t* seq) TF_EXCLUSIVE_LOCKS_REQUIRED(lane->mu);
+  // Returns true if the caller must call ReceiveDecision() for `*seq`, using
+  // the context and params filled into `*request`.
+  bool NeedsDecisionLocked(Lane* lane, int64_t* seq, Request* request)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lane->mu);
+
+  Status PostDecision(const Lane& lane, int64_t seq,
+                      const std::vector<Request>& batch);
+  void ReceiveDecision(std::shared_ptr<Lane> lane, int64_t seq,
+                       const Request& request);
+  void OnDecision(std::shared_ptr<Lane> lane, const Status& s,
+                  const Tensor& decision);
+
+  void Launch(const string& lane_name, int64_t seq,
+              std::vector<Request> requests);
+  void RunBatch(const string& lane_name, int64_t seq,
+                std::shared_ptr<Batch> batch);
+  Status CopyBatch(const Batch& batch, bool into_fused);
+  static void FailRequests(std::vector<Request> requests, const Status& s);
+
+  const Options options_;
+  CollectiveExecutor* const col_exec_;  // Not owned.
+  const DeviceMgr* const dev_mgr_;      // Not owned.
+  const LaunchFn launch_;
+
+  mutex mu_;
+  Status status_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<string, std::shared_ptr<Lane>> lanes_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_BUFFER_H_
@@ -0,0 +1,273 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/collective_fusion_buffer.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_test_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("bin_op", op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+class CollectiveFusionBufferTest : public ::testing::Test {
+ protected:
+  // One all-reduce issued by one device.
+  struct Request {
+    Request(CollectiveTestEnv* test_env, int rank, int instance_key, int len)
+        : tensor(DT_FLOAT, TensorShape({len})) {
+      col_params = CreateCollectiveParams(*test_env, rank, "RingReduce",
+                                          REDUCTION_COLLECTIVE, DT_FLOAT,
+                                          TensorShape({len}));
+      col_params->instance.instance_key = instance_key;
+      exec_key = strings::StrCat(instance_key, ":0:0");
+      const string& dev_name = col_params->group.members[rank].device.name();
+      TF_CHECK_OK(test_env->device_mgr->LookupDevice(dev_name, &device));
+      merge_op = GetBinOp("Add", DT_FLOAT, device);
+      final_op = GetBinOp("Div", DT_FLOAT, device);
+      col_params->merge_op = merge_op.get();
+      col_params->final_op = final_op.get();
+      for (int i = 0; i < len; ++i) {
+        tensor.flat<float>()(i) = rank + 1 + i;
+      }
+
+      dev_ctx = new DeviceContext;
+      op_params.step_id = 0;
+      op_params.device = device;
+      op_params.cancellation_manager = &cancellation_manager;
+      inputs.push_back(TensorValue(&tensor));
+      op_params.inputs = &inputs;
+      input_alloc_attrs.push_back(AllocatorAttributes());
+      op_params.input_alloc_attrs = &input_alloc_attrs;
+      op_params.op_device_context = dev_ctx;
+      op_params.forward_from_array = &forward_from;
+      op_params.output_attr_array = &output_alloc_attr;
+      op_params.resource_manager = device->resource_manager();
+      ctx = std::make_unique<OpKernelContext>(&op_params, 1);
+    }
+
+    ~Request() { dev_ctx->Unref(); }
+
+    Tensor tensor;
+    core::RefCountPtr<CollectiveParams> col_params;
+    string exec_key;
+    Device* device = nullptr;
+    std::unique_ptr<OpKernel> merge_op;
+    std::unique_ptr<OpKernel> final_op;
+    DeviceContext* dev_ctx = nullptr;
+    CancellationManager cancellation_manager;
+    OpKernelContext::Params op_params;
+    gtl::InlinedVector<TensorValue, 4> inputs;
+    gtl::InlinedVector<AllocatorAttributes, 4> input_alloc_attrs;
+    int forward_from = 0;
+    AllocatorAttributes output_alloc_attr;
+    std::unique_ptr<OpKernelContext> ctx;
+    Notification done;
+    Status status;
+  };
+
+  void Init(int num_devices, const CollectiveFusionBuffer::Options& options) {
+    test_env_ = CreateCollectiveTestEnv(/*num_workers=*/1, num_devices,
+                                        DEVICE_CPU);
+    buffer_ = std::make_unique<CollectiveFusionBuffer>(
+        options, test_env_->col_exec.get(), test_env_->device_mgr.get(),
+        [this](OpKernelContext* ctx, const CollectiveParams* col_params,
+               const string& exec_key, const Tensor* input, Tensor* output,
+               StatusCallback done) {
+          Launch(ctx, col_params, exec_key, input, output, std::move(done));
+        });
+  }
+
+  // Mirrors BaseCollectiveExecutor::LaunchCollective.
+  void Launch(OpKernelContext* ctx, const CollectiveParams* col_params,
+              const string& exec_key, const Tensor* input, Tensor* output,
+              StatusCallback done) {
+    {
+      mutex_lock l(mu_);
+      ++num_launches_;
+    }
+    CollectiveImplementationInterface* col_impl = nullptr;
+    Status s = CollectiveRegistry::Lookup(
+        col_params->instance.impl_details.collective_name, &col_impl);
+    if (!s.ok()) {
+      done(s);
+      return;
+    }
+    auto col_ctx = std::make_shared<CollectiveContext>(
+        test_env_->col_exec.get(), /*nccl_communicator*/ nullptr,
+        test_env_->device_mgr.get(), ctx, OpParams(ctx), col_params, exec_key,
+        ctx->step_id(), input, output);
+    s = col_impl->InitializeCollectiveContext(col_ctx);
+    if (!s.ok()) {
+      col_impl->Unref();
+      done(s);
+      return;
+    }
+    test_env_->col_exec->RunClosure([col_impl, col_ctx, done]() {
+      col_impl->Run([col_impl, col_ctx, done](const Status& s) {
+        done(s);
+        col_impl->Unref();
+      });
+    });
+  }
+
+  OpKernelContext::Params* OpParams(OpKernelContext* ctx) {
+    for (const auto& request : requests_) {
+      if (request->ctx.get() == ctx) return &request->op_params;
+    }
+    LOG(FATAL) << "Unknown OpKernelContext";
+  }
+
+  Request* AddRequest(int rank, int instance_key, int len) {
+    requests_.push_back(
+        std::make_unique<Request>(test_env_.get(), rank, instance_key, len));
+    return requests_.back().get();
+  }
+
+  void Enqueue(Request* request) {
+    ASSERT_TRUE(buffer_->CanFuse(*request->col_params, request->tensor));
+    buffer_->Enqueue(request->ctx.get(), request->col_params.get(),
+                     request->exec_key, &request->tensor, &request->tensor,
+                     [request](const Status& s) {
+                       request->status = s;
+                       request->done.Notify();
+                     });
+  }
+
+  // Every device issues the same `lens.size()` reductions, each in its own
+  // rotated order, and expects the mean over all devices.
+  void RunTest(int num_devices, const std::vector<int>& lens) {
+    std::vector<std::vector<Request*>> per_rank(num_devices);
+    for (int rank = 0; rank < num_devices; ++rank) {
+      for (int i = 0; i < lens.size(); ++i) {
+        per_rank[rank].push_back(AddRequest(rank, 100 + i, lens[i]));
+      }
+    }
+    for (int pos = 0; pos < lens.size(); ++pos) {
+      for (int rank = 0; rank < num_devices; ++rank) {
+        Enqueue(per_rank[rank][(pos + rank) % lens.size()]);
+      }
+    }
+    const float mean_rank = (num_devices + 1) / 2.0f;
+    for (int rank = 0; rank < num_devices; ++rank) {
+      for (int i = 0; i < lens.size(); ++i) {
+        Request* request = per_rank[rank][i];
+        request->done.WaitForNotification();
+        TF_ASSERT_OK(request->status);
+        for (int j = 0; j < lens[i]; ++j) {
+          EXPECT_FLOAT_EQ(mean_rank + j, request->tensor.flat<float>()(j))
+              << "rank " << rank << " request " << i << " element " << j;
+        }
+      }
+    }
+  }
+
+  int num_launches() {
+    mutex_lock l(mu_);
+    return num_launches_;
+  }
+
+  std::unique_ptr<CollectiveTestEnv> test_env_;
+  std::unique_ptr<CollectiveFusionBuffer> buffer_;
+  std::vector<std::unique_ptr<Request>> requests_;
+  mutex mu_;
+  int num_launches_ TF_GUARDED_BY(mu_) = 0;
+};
+
+TEST_F(CollectiveFusionBufferTest, CanFuse) {
+  CollectiveFusionBuffer::Options options;
+  options.threshold_bytes = 64;
+  Init(/*num_devices=*/2, options);
+  Request* small = AddRequest(/*rank=*/0, /*instance_key=*/1, /*len=*/4);
+  EXPECT_TRUE(buffer_->CanFuse(*small->col_params, small->tensor));
+  Request* large = AddRequest(/*rank=*/0, /*instance_key=*/2, /*len=*/16);
+  EXPECT_FALSE(buffer_->CanFuse(*large->col_params, large->tensor));
+  small->col_params->instance.impl_details.dependencies.push_back(2);
+  EXPECT_FALSE(buffer_->CanFuse(*small->col_params, small->tensor));
+}
+
+TEST_F(CollectiveFusionBufferTest, FusesOnWindow) {
+  CollectiveFusionBuffer::Options options;
+  options.threshold_bytes = 1 << 20;
+  options.window_micros = 1000;
+  Init(/*num_devices=*/4, options);
+  RunTest(/*num_devices=*/4, {1, 7, 16, 3, 33, 2});
+  // The leader flushes everything it holds when the window closes, so each
+  // device launches far fewer collectives than it issued.
+  EXPECT_LT(num_launches(), 4 * 6);
+}
+
+TEST_F(CollectiveFusionBufferTest, FusesOnThreshold) {
+  CollectiveFusionBuffer::Options options;
+  // Four 16-float reductions fill a batch.
+  options.threshold_bytes = 4 * 16 * sizeof(float);
+  options.window_micros = 1000;
+  Init(/*num_devices=*/3, options);
+  RunTest(/*num_devices=*/3, std::vector<int>(10, 16));
+}
+
+TEST_F(CollectiveFusionBufferTest, AbortFailsPendingRequests) {
+  CollectiveFusionBuffer::Options options;
+  options.threshold_bytes = 1 << 20;
+  options.window_micros = 10 * 1000 * 1000;
+  Init(/*num_devices=*/2, options);
+  Request* request = AddRequest(/*rank=*/1, /*instance_key=*/1, /*len=*/4);
+  Enqueue(request);
+  const Status aborted = errors::Aborted("test abort");
+  test_env_->remote_access->StartAbort(aborted);
+  buffer_->StartAbort(aborted);
+  request->done.WaitForNotification();
+  EXPECT_EQ(error::ABORTED, request->status.code());
+
+  Request* late = AddRequest(/*rank=*/0, /*instance_key=*/2, /*len=*/4);
+  Enqueue(late);
+  late->done.WaitForNotification();
+  EXPECT_EQ(error::ABORTED, late->status.code());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -693,6 +693,19 @@ void CollectiveParamResolverLocal::AssignCollectiveType(CollectiveParams* cp) {
       CollectiveRegistry::LookupParamResolverInstance("NcclReduce", &col_impl)
           .ok();
   cp->instance.impl_details.collective_name = GetCollectiveName(cp, use_nccl);
+  // The topology-aware and pipelined all-reduces are opt-in through the
+  // communication hint.
+  if (cp->instance.type == REDUCTION_COLLECTIVE &&
+      cp->group.device_type == DEVICE_CPU) {
+    const string& hint = cp->instance.impl_details.communication_hint;
+    const char* name = hint == "hierarchical" ? "HierarchicalReduce"
+                       : hint == "pipelined"  ? "PipelinedRingReduce"
+                                              : nullptr;
+    if (name != nullptr &&
+        CollectiveRegistry::LookupParamResolverInstance(name, &col_impl).ok()) {
+      cp->instance.impl_details.collective_name = name;
+    }
+  }
   VLOG(1) << "AssignCollectiveType "
           << cp->instance.impl_details.collective_name;
 }
@@ -37,6 +37,19 @@ inline constexpr char kTpuNoSmearCostName[] = "tpu_no_smear";
 inline constexpr char kGcuWithSmearCostName[] = "gcu_with_smear";
 inline constexpr char kGcuNoSmearCostName[] = "gcu_no_smear";
 
+// Per-request costs recorded by the executor for the steps it runs:
+// - the CPU time of the executor threads running the request's kernels, not
+//   including work they hand off to intra-op threads;
+// - the time Recv kernels waited on the rendezvous;
+// - the wall time of steps on non-CPU devices, including the final sync.
+inline constexpr char kExecutorCpuTimeCostName[] = "executor_cpu_time";
+inline constexpr char kRendezvousWaitCostName[] = "rendezvous_wait";
+inline constexpr char kDeviceTimeCostName[] = "device_time";
+
+// Per-request metrics recorded by the executor: the bytes of the tensors
+// output by the request's kernels.
+inline constexpr char kOutputBytesMetricName[] = "output_bytes";
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COST_CONSTANTS_H_
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
 #include "tensorflow/core/common_runtime/collective_param_resolver_local.h"
 #include "tensorflow/core/common_runtime/constant_folding.h"
+#include "tensorflow/core/common_runtime/cost_util.h"
 #include "tensorflow/core/common_runtime/debugger_state_interface.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/device_resolver_local.h"
@@ -35,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/graph_optimizer.h"
 #include "tensorflow/core/common_runtime/local_session_selection.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/process_util.h"
@@ -71,6 +73,7 @@ limitations under the License.
 #include "tensorflow/core/nccl/collective_communicator.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/hash.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -90,6 +93,20 @@ auto* direct_session_runs = monitoring::Counter<0>::New(
     "/tensorflow/core/direct_session_runs",
     "The number of times DirectSession::Run() has been called.");
 
+auto* direct_session_replayed_runs = monitoring::Counter<0>::New(
+    "/tensorflow/core/direct_session_replayed_runs",
+    "The number of DirectSession::Run() calls that replayed a run plan.");
+
+auto* direct_session_shape_specialized_runs = monitoring::Counter<0>::New(
+    "/tensorflow/core/direct_session_shape_specialized_runs",
+    "The number of DirectSession::Run() calls that ran executors specialized "
+    "to the shapes of their feeds.");
+
+// The maximum number of shape specialized variants of the executors for one
+// Run() signature, and of feed shape combinations counted towards new ones.
+constexpr size_t kMaxShapeSpecializations = 4;
+constexpr size_t kMaxShapeSignatureCounts = 1024;
+
 Status NewThreadPoolFromThreadPoolOptions(
     const SessionOptions& options,
     const ThreadPoolOptionProto& thread_pool_options, int pool_number,
@@ -156,6 +173,26 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Returns a fingerprint of the feed, fetch and target names of a Run() call.
+// Unlike the executor cache key, this does not allocate.
+uint64 RunSignatureFingerprint(
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes) {
+  uint64 fingerprint = Hash64Combine(inputs.size(), output_names.size());
+  fingerprint = Hash64Combine(fingerprint, target_nodes.size());
+  for (const auto& input : inputs) {
+    fingerprint = Hash64Combine(fingerprint, Hash64(input.first));
+  }
+  for (const string& output_name : output_names) {
+    fingerprint = Hash64Combine(fingerprint, Hash64(output_name));
+  }
+  for (const string& target_node : target_nodes) {
+    fingerprint = Hash64Combine(fingerprint, Hash64(target_node));
+  }
+  return fingerprint;
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -322,7 +359,12 @@ DirectSession::DirectSession(const SessionOptions& options,
       device_mgr_(device_mgr),
       factory_(factory),
       cancellation_manager_(new CancellationManager()),
-      operation_timeout_in_ms_(options_.config.operation_timeout_in_ms()) {
+      operation_timeout_in_ms_(options_.config.operation_timeout_in_ms()),
+      run_plan_after_steps_(
+          options_.config.experimental().run_plan_after_steps()),
+      shape_specialization_after_steps_(
+          options_.config.experimental().shape_specialization_after_steps()),
+      request_cost_accessor_(CreateRequestCostAccessor()) {
   const int thread_pool_size =
       options_.config.session_inter_op_thread_pool_size();
   if (thread_pool_size > 0) {
@@ -357,6 +399,10 @@ DirectSession::DirectSession(const SessionOptions& options,
   }
   session_handle_ =
       strings::StrCat("direct", strings::FpToString(random::New64()));
+  if (!options_.config.experimental().graph_cache_directory().empty()) {
+    graph_cache_ = std::make_unique<PartitionedGraphCache>(
+        options_.env, options_.config.experimental().graph_cache_directory());
+  }
   int devices_added = 0;
   if (options.config.log_device_placement()) {
     const string mapping_str = device_mgr_->DeviceMappingString();
@@ -389,6 +435,7 @@ DirectSession::~DirectSession() {
   for (auto& it : partial_runs_) {
     it.second.reset(nullptr);
   }
+  run_plans_.clear();
   for (auto& it : executors_) {
     it.second.reset();
   }
@@ -669,6 +716,9 @@ Status DirectSession::RunInternal(
   args.run_all_kernels_inline = pool == nullptr;
   args.start_time_usecs = start_time_usecs;
   args.deadline = deadline;
+  if (request_cost_accessor_ != nullptr) {
+    args.request_cost = request_cost_accessor_->GetRequestCost();
+  }
 
   const bool do_trace = (run_options.trace_level() > RunOptions::NO_TRACE);
 
@@ -870,9 +920,29 @@ Status DirectSession::Run(const RunOptions& run_options,
   run_state_args.collective_graph_key =
       run_options.experimental().collective_graph_key();
 
-  TF_RETURN_IF_ERROR(GetOrCreateExecutors(input_tensor_names, output_names,
-                                          target_nodes, &executors_and_keys,
-                                          &run_state_args));
+  // Replaying a run plan skips GetOrCreateExecutors(), which also computes the
+  // step handle for memory logging and the debug watches key.
+  const bool use_run_plan =
+      run_plan_after_steps_ > 0 && !LogMemory::IsEnabled() &&
+      run_options.debug_options().debug_tensor_watch_opts().empty();
+  const RunPlan* run_plan =
+      use_run_plan ? FindRunPlan(inputs, output_names, target_nodes) : nullptr;
+  if (run_plan != nullptr) {
+    direct_session_replayed_runs->GetCell()->IncrementBy(1);
+    executors_and_keys = run_plan->executors_and_keys.get();
+  } else {
+    TF_RETURN_IF_ERROR(GetOrCreateExecutors(input_tensor_names, output_names,
+                                            target_nodes, &executors_and_keys,
+                                            &run_state_args));
+    if (use_run_plan) {
+      MaybeCreateRunPlan(inputs, output_names, target_nodes,
+                         executors_and_keys);
+    }
+  }
+  if (shape_specialization_after_steps_ > 0) {
+    executors_and_keys =
+        GetShapeSpecializedExecutors(inputs, executors_and_keys);
+  }
   {
     mutex_lock l(collective_graph_key_lock_);
     collective_graph_key_ = executors_and_keys->collective_graph_key;
@@ -883,15 +953,19 @@ Status DirectSession::Run(const RunOptions& run_options,
   FunctionCallFrame call_frame(executors_and_keys->input_types,
                                executors_and_keys->output_types);
   gtl::InlinedVector<Tensor, 4> feed_args(inputs.size());
-  for (const auto& it : inputs) {
+  for (int i = 0; i < inputs.size(); ++i) {
+    const auto& it = inputs[i];
+    const size_t index =
+        run_plan != nullptr
+            ? run_plan->feed_indices[i]
+            : executors_and_keys->input_name_to_index[it.first];
     if (it.second.dtype() == DT_RESOURCE) {
       Tensor tensor_from_handle;
       TF_RETURN_IF_ERROR(
           ResourceHandleToInputTensor(it.second, &tensor_from_handle));
-      feed_args[executors_and_keys->input_name_to_index[it.first]] =
-          tensor_from_handle;
+      feed_args[index] = tensor_from_handle;
     } else {
-      feed_args[executors_and_keys->input_name_to_index[it.first]] = it.second;
+      feed_args[index] = it.second;
     }
   }
   const Status s = call_frame.SetArgs(feed_args);
@@ -925,11 +999,14 @@ Status DirectSession::Run(const RunOptions& run_options,
         output_names.size() == executors_and_keys->output_name_to_index.size();
     // first_indices[i] = j implies that j is the smallest value for which
     // output_names[i] == output_names[j].
-    std::vector<int> first_indices;
-    if (!unique_outputs) {
-      first_indices.reserve(output_names.size());
+    std::vector<int> computed_first_indices;
+    const std::vector<int>& first_indices =
+        run_plan != nullptr ? run_plan->first_fetch_indices
+                            : computed_first_indices;
+    if (run_plan == nullptr && !unique_outputs) {
+      computed_first_indices.reserve(output_names.size());
       for (const auto& name : output_names) {
-        first_indices.push_back(
+        computed_first_indices.push_back(
             std::find(output_names.begin(), output_names.end(), name) -
             output_names.begin());
       }
@@ -940,9 +1017,11 @@ Status DirectSession::Run(const RunOptions& run_options,
     for (int i = 0; i < output_names.size(); ++i) {
       const string& output_name = output_names[i];
       if (first_indices.empty() || first_indices[i] == i) {
-        outputs->emplace_back(
-            std::move(sorted_outputs[executors_and_keys
-                                         ->output_name_to_index[output_name]]));
+        const size_t index =
+            run_plan != nullptr
+                ? run_plan->fetch_indices[i]
+                : executors_and_keys->output_name_to_index[output_name];
+        outputs->emplace_back(std::move(sorted_outputs[index]));
       } else {
         outputs->push_back((*outputs)[first_indices[i]]);
       }
@@ -1315,6 +1394,7 @@ Status DirectSession::CreateExecutors(
   options.use_function_convention = !run_state_args->is_partial_run;
   options.collective_graph_key =
       callable_options.run_options().experimental().collective_graph_key();
+  options.feed_shapes = run_state_args->feed_shapes;
   if (options_.config.experimental()
           .collective_deterministic_sequential_execution()) {
     options.collective_order = GraphCollectiveOrder::kEdges;
@@ -1369,6 +1449,19 @@ Status DirectSession::CreateExecutors(
             return OkStatus();
           }}));
 
+  const bool plan_memory =
+      options_.config.experimental().enable_static_memory_planning();
+  std::vector<PartialTensorShape> feed_shapes;
+  if (plan_memory && !run_state_args->is_partial_run) {
+    if (run_state_args->feed_shapes.empty()) {
+      GetFeedShapes(callable_options, &feed_shapes);
+    } else {
+      for (const TensorShape& shape : run_state_args->feed_shapes) {
+        feed_shapes.emplace_back(shape.dim_sizes());
+      }
+    }
+  }
+
   GraphOptimizer optimizer(optimizer_opts);
   for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
     const string& partition_name = iter->first;
@@ -1429,6 +1522,17 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    if (plan_memory && device->device_type() == DEVICE_CPU) {
+      std::unique_ptr<MemoryPlan> memory_plan;
+      Status s = PlanMemory(*partition_graph, feed_shapes, &memory_plan);
+      if (s.ok()) {
+        params.memory_plan = std::move(memory_plan);
+      } else {
+        LOG(WARNING) << "Not planning memory on " << device->name() << ": "
+                     << s;
+      }
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1592,6 +1696,195 @@ Status DirectSession::GetOrCreateExecutors(
   return OkStatus();
 }
 
+bool DirectSession::RunPlan::Matches(
+    const NamedTensorList& inputs, const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes) const {
+  if (inputs.size() != feeds.size() || output_names != fetches ||
+      target_nodes != targets) {
+    return false;
+  }
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (inputs[i].first != feeds[i]) return false;
+  }
+  return true;
+}
+
+const DirectSession::RunPlan* DirectSession::FindRunPlan(
+    const NamedTensorList& inputs, const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes) {
+  const uint64 fingerprint =
+      RunSignatureFingerprint(inputs, output_names, target_nodes);
+  tf_shared_lock l(run_plans_lock_);
+  auto it = run_plans_.find(fingerprint);
+  if (it == run_plans_.end() ||
+      !it->second->Matches(inputs, output_names, target_nodes)) {
+    return nullptr;
+  }
+  // Plans are only removed when the session is destroyed, so the pointer
+  // outlives the lock.
+  return it->second.get();
+}
+
+void DirectSession::MaybeCreateRunPlan(
+    const NamedTensorList& inputs, const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes,
+    ExecutorsAndKeys* executors_and_keys) {
+  // `step_count` does not include the run that is about to start.
+  if (executors_and_keys->step_count.load() + 1 < run_plan_after_steps_) {
+    return;
+  }
+  const uint64 fingerprint =
+      RunSignatureFingerprint(inputs, output_names, target_nodes);
+  {
+    tf_shared_lock l(run_plans_lock_);
+    if (run_plans_.contains(fingerprint)) return;
+  }
+
+  auto run_plan = std::make_unique<RunPlan>();
+  {
+    mutex_lock l(executor_lock_);
+    for (const auto& it : executors_) {
+      if (it.second.get() == executors_and_keys) {
+        run_plan->executors_and_keys = it.second;
+        break;
+      }
+    }
+  }
+  if (run_plan->executors_and_keys == nullptr) return;
+
+  run_plan->feeds.reserve(inputs.size());
+  run_plan->feed_indices.reserve(inputs.size());
+  for (const auto& it : inputs) {
+    run_plan->feeds.push_back(it.first);
+    run_plan->feed_indices.push_back(
+        executors_and_keys->input_name_to_index.at(it.first));
+  }
+  run_plan->fetches = output_names;
+  run_plan->fetch_indices.reserve(output_names.size());
+  for (const string& output_name : output_names) {
+    run_plan->fetch_indices.push_back(
+        executors_and_keys->output_name_to_index.at(output_name));
+  }
+  if (output_names.size() != executors_and_keys->output_name_to_index.size()) {
+    run_plan->first_fetch_indices.reserve(output_names.size());
+    for (const string& output_name : output_names) {
+      run_plan->first_fetch_indices.push_back(
+          std::find(output_names.begin(), output_names.end(), output_name) -
+          output_names.begin());
+    }
+  }
+  run_plan->targets = target_nodes;
+
+  VLOG(1) << "Replaying a run plan for " << absl::StrJoin(output_names, ",")
+          << " after " << run_plan_after_steps_ << " runs.";
+  mutex_lock l(run_plans_lock_);
+  // On a fingerprint collision the first plan is kept, and the other
+  // signature keeps using the regular path.
+  run_plans_.emplace(fingerprint, std::move(run_plan));
+}
+
+DirectSession::ExecutorsAndKeys* DirectSession::GetShapeSpecializedExecutors(
+    const NamedTensorList& inputs, ExecutorsAndKeys* executors_and_keys) {
+  if (inputs.empty()) return executors_and_keys;
+  // Order the feeds like the callable, so that the signature does not depend
+  // on the order in which the caller names them.
+  std::vector<const Tensor*> feeds(inputs.size(), nullptr);
+  for (const auto& it : inputs) {
+    auto index_it = executors_and_keys->input_name_to_index.find(it.first);
+    if (index_it == executors_and_keys->input_name_to_index.end() ||
+        index_it->second >= feeds.size()) {
+      return executors_and_keys;
+    }
+    feeds[index_it->second] = &it.second;
+  }
+  string signature;
+  for (const Tensor* feed : feeds) {
+    // Resource handles are fed as the tensors they refer to.
+    if (feed == nullptr || feed->dtype() == DT_RESOURCE) {
+      return executors_and_keys;
+    }
+    strings::StrAppend(&signature, feed->shape().DebugString(), ";");
+  }
+
+  {
+    mutex_lock l(executors_and_keys->shape_specializations_mu);
+    auto it = executors_and_keys->shape_specializations.find(signature);
+    if (it != executors_and_keys->shape_specializations.end()) {
+      direct_session_shape_specialized_runs->GetCell()->IncrementBy(1);
+      // The run still counts towards creating a run plan for the signature.
+      executors_and_keys->step_count.fetch_add(1);
+      return it->second.get();
+    }
+    if (executors_and_keys->shape_specializations.size() >=
+        kMaxShapeSpecializations) {
+      return executors_and_keys;
+    }
+    auto& counts = executors_and_keys->shape_signature_counts;
+    if (counts.size() >= kMaxShapeSignatureCounts &&
+        counts.find(signature) == counts.end()) {
+      counts.clear();
+    }
+    // Only the run that reaches the threshold creates the variant. Concurrent
+    // runs with the same shapes use the generic executors meanwhile.
+    if (++counts[signature] != shape_specialization_after_steps_) {
+      return executors_and_keys;
+    }
+  }
+
+  const CallableOptions& callable_options =
+      executors_and_keys->callable_options;
+  RunStateArgs run_state_args(callable_options.run_options().debug_options());
+  run_state_args.collective_graph_key =
+      callable_options.run_options().experimental().collective_graph_key();
+  run_state_args.feed_shapes.reserve(feeds.size());
+  for (const Tensor* feed : feeds) {
+    run_state_args.feed_shapes.push_back(feed->shape());
+  }
+  std::unique_ptr<ExecutorsAndKeys> ek;
+  std::unique_ptr<FunctionInfo> func_info;
+  Status s =
+      CreateExecutors(callable_options, &ek, &func_info, &run_state_args);
+  if (!s.ok()) {
+    LOG(WARNING) << "Not specializing executors to feed shapes " << signature
+                 << ": " << s;
+    return executors_and_keys;
+  }
+  VLOG(1) << "Specialized executors to feed shapes " << signature << " after "
+          << shape_specialization_after_steps_ << " runs.";
+  {
+    mutex_lock l(executor_lock_);
+    functions_.push_back(std::move(func_info));
+  }
+  mutex_lock l(executors_and_keys->shape_specializations_mu);
+  auto insert_result = executors_and_keys->shape_specializations.emplace(
+      signature, std::move(ek));
+  direct_session_shape_specialized_runs->GetCell()->IncrementBy(1);
+  executors_and_keys->step_count.fetch_add(1);
+  return insert_result.first->second.get();
+}
+
+void DirectSession::GetFeedShapes(const CallableOptions& callable_options,
+                                  std::vector<PartialTensorShape>* shapes) {
+  shapes->assign(callable_options.feed_size(), PartialTensorShape());
+  mutex_lock l(graph_state_lock_);
+  if (execution_state_ == nullptr) return;
+  std::unordered_map<StringPiece, const Node*, StringPieceHasher> name_to_node;
+  for (const Node* n : execution_state_->full_graph()->op_nodes()) {
+    name_to_node[n->name()] = n;
+  }
+  for (int i = 0; i < callable_options.feed_size(); ++i) {
+    const TensorId id = ParseTensorName(callable_options.feed(i));
+    auto it = name_to_node.find(id.first);
+    if (it == name_to_node.end() || id.second != 0) continue;
+    const Node* n = it->second;
+    if (n->type_string() == "Placeholder" ||
+        n->type_string() == "PlaceholderV2" ||
+        n->type_string() == "PlaceholderWithDefault") {
+      GetNodeAttr(n->attrs(), "shape", &(*shapes)[i]).IgnoreError();
+    }
+  }
+}
+
 Status DirectSession::CreateGraphs(
     const BuildGraphOptions& subgraph_options,
     std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
@@ -1603,6 +1896,32 @@ Status DirectSession::CreateGraphs(
     return errors::FailedPrecondition("Session has been finalized.");
   }
 
+  // Partial runs need the full graph, and shape specialized graphs are only
+  // valid for some feeds, so neither is cached.
+  string cache_key;
+  if (graph_cache_ != nullptr && !run_state_args->is_partial_run &&
+      subgraph_options.feed_shapes.empty()) {
+    cache_key = PartitionedGraphCache::ComputeKey(
+        *execution_state_->original_graph_def(), options_.config, devices_,
+        stateful_placements_, subgraph_options.callable_options,
+        subgraph_options.use_function_convention);
+    PartitionedGraphCacheEntry entry;
+    Status s = graph_cache_->Lookup(cache_key, &entry);
+    if (s.ok()) {
+      s = CreateGraphsFromCache(entry, outputs, flib_def, input_types,
+                                output_types, collective_graph_key);
+      if (s.ok()) {
+        VLOG(1) << "Read the partition graphs from cache entry " << cache_key;
+        return RewritePartitionGraphs(outputs);
+      }
+      outputs->clear();
+    }
+    if (!errors::IsNotFound(s)) {
+      LOG(WARNING) << "Ignoring partitioned graph cache entry " << cache_key
+                   << ": " << s;
+    }
+  }
+
   std::unique_ptr<ClientGraph> client_graph;
 
   std::unique_ptr<GraphExecutionState> temp_exec_state_holder;
@@ -1729,8 +2048,90 @@ Status DirectSession::CreateGraphs(
   TF_RETURN_IF_ERROR(OptimizationPassRegistry::Global()->RunGrouping(
       OptimizationPassRegistry::POST_PARTITIONING, optimization_options));
 
-  Status s;
-  for (auto& partition : *outputs) {
+  if (!cache_key.empty()) {
+    PartitionedGraphCacheEntry entry;
+    for (const auto& partition : *outputs) {
+      GraphDef* graph_def =
+          &(*entry.mutable_partition_graphs())[partition.first];
+      partition.second->ToGraphDef(graph_def);
+      graph_def->clear_library();
+    }
+    *entry.mutable_library() = client_graph->flib_def->ToProto();
+    for (DataType type : client_graph->feed_types) {
+      entry.add_feed_types(type);
+    }
+    for (DataType type : client_graph->fetch_types) {
+      entry.add_fetch_types(type);
+    }
+    entry.set_collective_graph_key(client_graph->collective_graph_key);
+    entry.mutable_stateful_placements()->insert(stateful_placements_.begin(),
+                                                stateful_placements_.end());
+    Status s = graph_cache_->Insert(cache_key, entry);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to write partitioned graph cache entry "
+                   << cache_key << ": " << s;
+    }
+  }
+
+  Status s = RewritePartitionGraphs(outputs);
+  *flib_def = std::move(client_graph->flib_def);
+  std::swap(*input_types, client_graph->feed_types);
+  std::swap(*output_types, client_graph->fetch_types);
+  return s;
+}
+
+Status DirectSession::CreateGraphsFromCache(
+    const PartitionedGraphCacheEntry& entry,
+    std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+    std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+    DataTypeVector* input_types, DataTypeVector* output_types,
+    int64_t* collective_graph_key) {
+  for (const auto& placement : entry.stateful_placements()) {
+    auto iter = stateful_placements_.find(placement.first);
+    if (iter != stateful_placements_.end() &&
+        iter->second != placement.second) {
+      return errors::Internal(
+          "Stateful placement mismatch. Current assignment of ",
+          placement.first, " to ", iter->second, " does not match ",
+          placement.second);
+    }
+  }
+
+  auto cached_flib_def = std::make_unique<FunctionLibraryDefinition>(
+      OpRegistry::Global(), entry.library());
+  for (const auto& partition : entry.partition_graphs()) {
+    // Fails if the partition is not for a device of this session.
+    Device* d;
+    TF_RETURN_IF_ERROR(device_mgr_->LookupDevice(partition.first, &d));
+    auto device_graph = std::make_unique<Graph>(cached_flib_def.get());
+    device_graph->SetConstructionContext(ConstructionContext::kDirectSession);
+    GraphConstructorOptions device_opts;
+    device_opts.allow_internal_ops = true;
+    device_opts.expect_device_spec = true;
+    TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(device_opts, partition.second,
+                                              device_graph.get()));
+    outputs->emplace(partition.first, std::move(device_graph));
+  }
+
+  for (const auto& placement : entry.stateful_placements()) {
+    stateful_placements_.insert({placement.first, placement.second});
+  }
+  *flib_def = std::move(cached_flib_def);
+  input_types->clear();
+  for (int type : entry.feed_types()) {
+    input_types->push_back(static_cast<DataType>(type));
+  }
+  output_types->clear();
+  for (int type : entry.fetch_types()) {
+    output_types->push_back(static_cast<DataType>(type));
+  }
+  *collective_graph_key = entry.collective_graph_key();
+  return OkStatus();
+}
+
+Status DirectSession::RewritePartitionGraphs(
+    std::unordered_map<string, std::unique_ptr<Graph>>* graphs) {
+  for (auto& partition : *graphs) {
     const string& partition_name = partition.first;
     std::unique_ptr<Graph>* graph = &partition.second;
 
@@ -1739,17 +2140,10 @@ Status DirectSession::CreateGraphs(
 
     // Give the device an opportunity to rewrite its subgraph.
     Device* d;
-    s = device_mgr_->LookupDevice(partition_name, &d);
-    if (!s.ok()) break;
-    s = d->MaybeRewriteGraph(graph);
-    if (!s.ok()) {
-      break;
-    }
+    TF_RETURN_IF_ERROR(device_mgr_->LookupDevice(partition_name, &d));
+    TF_RETURN_IF_ERROR(d->MaybeRewriteGraph(graph));
   }
-  *flib_def = std::move(client_graph->flib_def);
-  std::swap(*input_types, client_graph->feed_types);
-  std::swap(*output_types, client_graph->fetch_types);
-  return s;
+  return OkStatus();
 }
 
 ::tensorflow::Status DirectSession::ListDevices(
@@ -23,14 +23,17 @@ limitations under the License.
 #include <unordered_set>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/common_runtime/debugger_state_interface.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/common_runtime/executor.h"
 #include "tensorflow/core/common_runtime/graph_execution_state.h"
+#include "tensorflow/core/common_runtime/partitioned_graph_cache.h"
 #include "tensorflow/core/common_runtime/process_function_library_runtime.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+#include "tensorflow/core/common_runtime/request_cost_accessor.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -176,6 +179,15 @@ class DirectSession : public Session {
     CallableOptions callable_options;
 
     int64_t collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // The variants of these executors that are specialized to the shapes of
+    // their feeds, keyed by the feed shapes, and the number of runs seen for
+    // each combination of feed shapes that has no variant yet.
+    mutex shape_specializations_mu;
+    std::unordered_map<string, std::unique_ptr<ExecutorsAndKeys>>
+        shape_specializations TF_GUARDED_BY(shape_specializations_mu);
+    std::unordered_map<string, int64_t> shape_signature_counts
+        TF_GUARDED_BY(shape_specializations_mu);
   };
 
   // A FunctionInfo object is created for every unique set of feeds/fetches.
@@ -194,6 +206,33 @@ class DirectSession : public Session {
     std::unique_ptr<ProcessFunctionLibraryRuntime> proc_flr;
   };
 
+  // A RunPlan is created for a Run() signature once it has been run
+  // `run_plan_after_steps_` times. `feed_indices[i]` and `fetch_indices[i]`
+  // are the call frame indices of the i-th feed and fetch, in the order the
+  // caller names them. `first_fetch_indices[i] = j` implies that j is the
+  // smallest index for which `fetches[i] == fetches[j]`; it is empty when
+  // the fetches are unique. The names are kept to detect fingerprint
+  // collisions.
+  //
+  // A plan only covers what DirectSession does for each step. It does not
+  // fix a node schedule or preallocate executor state or buffers: the
+  // executors are shared with the regular path and with concurrent runs of
+  // the same signature, and they keep scheduling and allocating dynamically.
+  struct RunPlan {
+    std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
+    std::vector<string> feeds;
+    std::vector<string> fetches;
+    std::vector<string> targets;
+    std::vector<size_t> feed_indices;
+    std::vector<size_t> fetch_indices;
+    std::vector<int> first_fetch_indices;
+
+    // Returns true if this plan was built for the given signature.
+    bool Matches(const NamedTensorList& inputs,
+                 const std::vector<string>& output_names,
+                 const std::vector<string>& target_nodes) const;
+  };
+
   // For each live Run() call, the session maintains a RunState.
   // 'status' is the current status of the execution.
   struct RunState {
@@ -236,6 +275,9 @@ class DirectSession : public Session {
     std::unique_ptr<Graph> graph;
     const DebugOptions& debug_options;
     int64_t collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+    // If not empty, the static shapes that the graph is specialized to,
+    // indexed like the feeds of the callable.
+    std::vector<TensorShape> feed_shapes;
   };
 
   // Retrieves an already existing set of executors to run 'inputs' and
@@ -245,6 +287,26 @@ class DirectSession : public Session {
       gtl::ArraySlice<string> target_nodes,
       ExecutorsAndKeys** executors_and_keys, RunStateArgs* run_state_args);
 
+  // Returns the run plan for the given signature, or nullptr if the signature
+  // has not been run often enough yet.
+  const RunPlan* FindRunPlan(const NamedTensorList& inputs,
+                             const std::vector<string>& output_names,
+                             const std::vector<string>& target_nodes);
+
+  // Creates a run plan for the given signature once `executors_and_keys` has
+  // been run `run_plan_after_steps_` times.
+  void MaybeCreateRunPlan(const NamedTensorList& inputs,
+                          const std::vector<string>& output_names,
+                          const std::vector<string>& target_nodes,
+                          ExecutorsAndKeys* executors_and_keys);
+
+  // Returns the variant of `executors_and_keys` that is specialized to the
+  // shapes of `inputs`. The variant is created once these shapes have been
+  // fed `shape_specialization_after_steps_` times. Returns
+  // `executors_and_keys` itself if there is no such variant.
+  ExecutorsAndKeys* GetShapeSpecializedExecutors(
+      const NamedTensorList& inputs, ExecutorsAndKeys* executors_and_keys);
+
   // Creates a set of executors to run the subgraph defined by
   // `callable_options`.
   ::tensorflow::Status CreateExecutors(
@@ -263,6 +325,25 @@ class DirectSession : public Session {
       RunStateArgs* run_state_args, DataTypeVector* input_types,
       DataTypeVector* output_types, int64_t* collective_graph_key);
 
+  // Like `CreateGraphs`, but reads the graphs from `entry` of the
+  // partitioned graph cache.
+  ::tensorflow::Status CreateGraphsFromCache(
+      const PartitionedGraphCacheEntry& entry,
+      std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+      std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+      DataTypeVector* input_types, DataTypeVector* output_types,
+      int64_t* collective_graph_key)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
+  // Gives each device an opportunity to rewrite its graph in `graphs`.
+  ::tensorflow::Status RewritePartitionGraphs(
+      std::unordered_map<string, std::unique_ptr<Graph>>* graphs);
+
+  // Sets `shapes` to the static shapes of the placeholders fed by
+  // `callable_options`, indexed like its feeds. Other feeds get unknown shapes.
+  void GetFeedShapes(const CallableOptions& callable_options,
+                     std::vector<PartialTensorShape>* shapes);
+
   ::tensorflow::Status RunInternal(
       int64_t step_id, const RunOptions& run_options,
       CallFrameInterface* call_frame, ExecutorsAndKeys* executors_and_keys,
@@ -367,6 +448,12 @@ class DirectSession : public Session {
   std::unordered_map<string, std::shared_ptr<ExecutorsAndKeys>> executors_
       TF_GUARDED_BY(executor_lock_);
 
+  mutex run_plans_lock_;
+  // Maps a fingerprint of the feed, fetch and target names of a Run() call to
+  // the plan for replaying it.
+  absl::flat_hash_map<uint64, std::unique_ptr<RunPlan>> run_plans_
+      TF_GUARDED_BY(run_plans_lock_);
+
   class RunCallableCallFrame;
   struct Callable {
     std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
@@ -400,6 +487,9 @@ class DirectSession : public Session {
   std::unique_ptr<GraphExecutionState> execution_state_
       TF_GUARDED_BY(graph_state_lock_);
 
+  // Not null if the partitioned graphs of callables are cached on disk.
+  std::unique_ptr<PartitionedGraphCache> graph_cache_;
+
   // The function library, before any rewrites or optimizations have been
   // performed. In particular, CreateGraphs() may need to modify the function
   // library; it copies and modifies the function library.
@@ -419,9 +509,22 @@ class DirectSession : public Session {
   // Global timeout for all blocking operations in this session.
   const int64_t operation_timeout_in_ms_ = 0;
 
+  // The number of runs of a signature after which Run() replays a RunPlan,
+  // or 0 if run plans are disabled.
+  const int32 run_plan_after_steps_ = 0;
+
+  // The number of runs with the same feed shapes after which Run() uses
+  // executors specialized to these shapes, or 0 if specialization is
+  // disabled.
+  const int32 shape_specialization_after_steps_ = 0;
+
   // Manages all the cost models for the graphs executed in this session.
   CostModelManager cost_model_manager_;
 
+  // If not null, provides the RequestCost of the request on whose behalf a
+  // step runs, to which the executors add the step's costs.
+  const std::unique_ptr<RequestCostAccessor> request_cost_accessor_;
+
   // For testing collective graph key generation.
   mutex collective_graph_key_lock_;
   int64_t collective_graph_key_ TF_GUARDED_BY(collective_graph_key_lock_) = -1;
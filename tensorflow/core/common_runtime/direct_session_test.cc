@@ -43,12 +43,16 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/stacktrace.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
+#include "tensorflow/core/protobuf/graph_cache.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
@@ -518,6 +522,194 @@ TEST_F(DirectSessionMinusAXTest, TestFeed) {
   EXPECT_FLOAT_EQ(39.0, mat(1, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, TestFeed_RunPlan) {
+  Initialize({1, 2, 3, 4});
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_run_plan_after_steps(2);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  monitoring::testing::CellReader<int64_t> replayed_runs(
+      "/tensorflow/core/direct_session_replayed_runs");
+
+  // Fetch `y` twice to exercise the duplicate fetch mapping of the plan.
+  const std::vector<string> output_names = {y_ + ":0", y_neg_ + ":0",
+                                            y_ + ":0"};
+  for (int i = 0; i < 5; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    t.matrix<float>()(0, 0) = i;
+    t.matrix<float>()(1, 0) = 1;
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{x_, t}}, output_names, {}, &outputs));
+
+    // The plan is created by the second run and replayed afterwards.
+    EXPECT_EQ(replayed_runs.Delta(), i < 2 ? 0 : 1);
+    ASSERT_EQ(3, outputs.size());
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({i + 2.0f, 3 * i + 4.0f}, {2, 1}));
+    test::ExpectTensorEqual<float>(
+        outputs[1],
+        test::AsTensor<float>({-(i + 2.0f), -(3 * i + 4.0f)}, {2, 1}));
+    test::ExpectTensorEqual<float>(outputs[0], outputs[2]);
+  }
+
+  // Reordering the fetches reuses the executors, which have already run often
+  // enough, so the new signature is replayed from its second run.
+  const std::vector<string> reordered_names = {y_neg_ + ":0", y_ + ":0"};
+  Tensor t = test::AsTensor<float>({5, 6}, {2, 1});
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{x_, t}}, reordered_names, {}, &outputs));
+    EXPECT_EQ(replayed_runs.Delta(), i);
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(outputs[0],
+                                   test::AsTensor<float>({-17, -39}, {2, 1}));
+    test::ExpectTensorEqual<float>(outputs[1],
+                                   test::AsTensor<float>({17, 39}, {2, 1}));
+  }
+
+  // Feeding an unknown tensor still fails once a plan exists for another
+  // signature.
+  std::vector<Tensor> outputs;
+  EXPECT_FALSE(session->Run({{"unknown:0", t}}, output_names, {}, &outputs)
+                   .ok());
+  EXPECT_EQ(replayed_runs.Delta(), 0);
+}
+
+TEST_F(DirectSessionMinusAXTest, GraphCache) {
+  Initialize({1, 2, 3, 4});
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "direct_session_graph_cache");
+  Env* env = Env::Default();
+  if (env->FileExists(cache_dir).ok()) {
+    int64_t undeleted_files, undeleted_dirs;
+    TF_ASSERT_OK(
+        env->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs));
+  }
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_graph_cache_directory(cache_dir);
+  Tensor x = test::AsTensor<float>({1, 1}, {2, 1});
+
+  {
+    std::unique_ptr<Session> session(NewSession(options));
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{x_, x}}, {y_ + ":0"}, {}, &outputs));
+    test::ExpectTensorEqual<float>(outputs[0],
+                                   test::AsTensor<float>({3, 7}, {2, 1}));
+  }
+
+  // The first session cached its partition graphs. Change the cached value of
+  // `a` to check that a new session reads them instead of building its own.
+  std::vector<string> entries;
+  TF_ASSERT_OK(env->GetChildren(cache_dir, &entries));
+  ASSERT_EQ(entries.size(), 1);
+  const string entry_path = io::JoinPath(cache_dir, entries[0]);
+  PartitionedGraphCacheEntry entry;
+  TF_ASSERT_OK(ReadBinaryProto(env, entry_path, &entry));
+  int num_changed = 0;
+  for (auto& partition : *entry.mutable_partition_graphs()) {
+    for (NodeDef& node : *partition.second.mutable_node()) {
+      if (node.name() == a_) {
+        test::AsTensor<float>({2, 0, 0, 2}, {2, 2})
+            .AsProtoTensorContent(
+                (*node.mutable_attr())["value"].mutable_tensor());
+        ++num_changed;
+      }
+    }
+  }
+  ASSERT_EQ(num_changed, 1);
+  TF_ASSERT_OK(WriteBinaryProto(env, entry_path, entry));
+
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({{x_, x}}, {y_ + ":0"}, {}, &outputs));
+  test::ExpectTensorEqual<float>(outputs[0],
+                                 test::AsTensor<float>({2, 2}, {2, 1}));
+
+  // A different callable is not in the cache.
+  TF_ASSERT_OK(session->Run({{x_, x}}, {y_neg_ + ":0"}, {}, &outputs));
+  test::ExpectTensorEqual<float>(outputs[0],
+                                 test::AsTensor<float>({-3, -7}, {2, 1}));
+  TF_ASSERT_OK(env->GetChildren(cache_dir, &entries));
+  EXPECT_EQ(entries.size(), 2);
+}
+
+TEST(DirectSessionTest, ShapeSpecialization) {
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("shape", PartialTensorShape({-1}))
+                   .Attr("dtype", DT_FLOAT)
+                   .Finalize(&g, &x));
+  // y = x * size(x), so that the result depends on the shape of `x`.
+  Node* size;
+  TF_ASSERT_OK(NodeBuilder("size", "Size")
+                   .Input(x)
+                   .Attr("T", DT_FLOAT)
+                   .Attr("out_type", DT_INT32)
+                   .Finalize(&g, &size));
+  Node* y =
+      test::graph::Binary(&g, "Mul", x, test::graph::Cast(&g, size, DT_FLOAT));
+  GraphDef def;
+  g.ToGraphDef(&def);
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_shape_specialization_after_steps(
+      2);
+  // Optimize the graph although it is small.
+  options.config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_min_graph_nodes(-1);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+  monitoring::testing::CellReader<int64_t> specialized_runs(
+      "/tensorflow/core/direct_session_shape_specialized_runs");
+
+  RunOptions run_options;
+  run_options.set_output_partition_graphs(true);
+  auto run = [&](int64_t n, bool* has_size) {
+    Tensor t(DT_FLOAT, TensorShape({n}));
+    test::FillFn<float>(&t, [](int i) { return i; });
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(run_options, {{x->name(), t}},
+                              {y->name() + ":0"}, {}, &outputs,
+                              &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    Tensor expected(DT_FLOAT, TensorShape({n}));
+    test::FillFn<float>(&expected, [n](int i) { return i * n; });
+    test::ExpectTensorEqual<float>(outputs[0], expected);
+    *has_size = false;
+    for (const GraphDef& partition : run_metadata.partition_graphs()) {
+      for (const NodeDef& node : partition.node()) {
+        if (node.op() == "Size") *has_size = true;
+      }
+    }
+  };
+
+  // The variants for each shape are created by their second run, and fold
+  // the size of `x` into a constant.
+  for (int i = 0; i < 3; ++i) {
+    for (int64_t n : {2, 3}) {
+      bool has_size;
+      run(n, &has_size);
+      EXPECT_EQ(specialized_runs.Delta(), i < 1 ? 0 : 1);
+      EXPECT_EQ(has_size, i < 1);
+    }
+  }
+
+  // Other shapes run the generic graph.
+  bool has_size;
+  run(5, &has_size);
+  EXPECT_EQ(specialized_runs.Delta(), 0);
+  EXPECT_TRUE(has_size);
+}
+
 TEST_F(DirectSessionMinusAXTest, TestFeed_Callable) {
   Initialize({1, 2, 3, 4});
   auto session = CreateSession();
@@ -2622,7 +2814,8 @@ TEST(DirectSessionTest,
 // with varying numbers of feeds/fetches.
 void FeedFetchBenchmarkHelper(::testing::benchmark::State& state, int num_feeds,
                               bool use_make_callable, int inter_op_threads,
-                              bool use_single_threaded_executor) {
+                              bool use_single_threaded_executor,
+                              int run_plan_after_steps = 0) {
   Tensor value(DT_FLOAT, TensorShape());
   value.flat<float>()(0) = 37.0;
 
@@ -2659,6 +2852,8 @@ void FeedFetchBenchmarkHelper(::testing::benchmark::State& state, int num_feeds,
     opts.config.mutable_experimental()->set_executor_type(
         "SINGLE_THREADED_EXECUTOR");
   }
+  opts.config.mutable_experimental()->set_run_plan_after_steps(
+      run_plan_after_steps);
   std::unique_ptr<Session> session(NewSession(opts));
   TF_CHECK_OK(session->Create(gd));
   if (use_make_callable) {
@@ -2705,6 +2900,15 @@ void BM_FeedFetch(::testing::benchmark::State& state) {
                            /* inter_op_threads */ 0,
                            /* use_single_threaded_executor */ false);
 }
+void BM_FeedFetchRunPlan(::testing::benchmark::State& state) {
+  const int num_feeds = state.range(0);
+
+  // The first run is not measured, so every measured run replays the plan.
+  FeedFetchBenchmarkHelper(state, num_feeds, /* use_make_callable */ false,
+                           /* inter_op_threads */ 0,
+                           /* use_single_threaded_executor */ false,
+                           /* run_plan_after_steps */ 1);
+}
 void BM_FeedFetchCallable(::testing::benchmark::State& state) {
   const int num_feeds = state.range(0);
 
@@ -2729,6 +2933,7 @@ void BM_FeedFetchCallableSingleThreadExecutor(
 }
 
 BENCHMARK(BM_FeedFetch)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+BENCHMARK(BM_FeedFetchRunPlan)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallable)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallableSingleThread)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallableSingleThreadExecutor)
@@ -235,7 +235,11 @@ void AttrBuilder::FillAttrValueMapWithoutDefaults(AttrValueMap* m) const {
 
 void AttrBuilder::AddAttrIfNotPresent(StringPiece attr_name,
                                       const AttrValue& value) {
-  encoded_attrs_.emplace(string(attr_name), value.SerializeAsString());
+  auto result =
+      encoded_attrs_.emplace(string(attr_name), value.SerializeAsString());
+  if (result.second) {
+    AddToAttrsFingerprint(result.first->first, result.first->second);
+  }
 }
 
 const NodeDef& AttrBuilder::BuildNodeDef() {
@@ -252,8 +256,11 @@ const NodeDef& AttrBuilder::BuildNodeDef() {
 }
 
 void AttrBuilder::CopyAttributes(const AttrBuilder& other) {
-  encoded_attrs_.insert(other.encoded_attrs_.begin(),
-                        other.encoded_attrs_.end());
+  for (const auto& p : other.encoded_attrs_) {
+    if (encoded_attrs_.insert(p).second) {
+      AddToAttrsFingerprint(p.first, p.second);
+    }
+  }
 }
 
 Status AttrTypeByName(const AttrTypeMap& m, const string& attr_name,
@@ -298,23 +305,26 @@ inline tensorflow::Fprint128 CacheKeyHelper(StringPiece s, uint64 b) {
 }  // namespace
 
 tensorflow::Fprint128 AttrBuilder::CacheKey(const StringPiece device) {
-  if (!cached_cache_key_ || device != device_for_cached_cache_key_) {
-    cached_cache_key_ = BuildCacheKeyForDevice(device);
+  if (device != device_for_cached_cache_key_) {
     device_for_cached_cache_key_ = string(device);
+    device_fingerprint_ = tensorflow::Fingerprint128(device);
+    cached_cache_key_ = absl::nullopt;
+  }
+  if (!cached_cache_key_) {
+    tensorflow::Fprint128 f =
+        tensorflow::FingerprintCat128(op_fingerprint_, device_fingerprint_);
+    CombineUnordered(attrs_fingerprint_, &f);
+    cached_cache_key_ = f;
   }
-
   return *cached_cache_key_;
 }
 
-tensorflow::Fprint128 AttrBuilder::BuildCacheKeyForDevice(
-    const StringPiece device) const {
-  tensorflow::Fprint128 f = tensorflow::Fingerprint128(op_name());
-  f = tensorflow::FingerprintCat128(f, tensorflow::Fingerprint128(device));
-  for (const auto& p : encoded_attrs_) {
-    CombineUnordered(
-        CacheKeyHelper(p.first, tensorflow::Fingerprint128(p.second)), &f);
-  }
-  return f;
+void AttrBuilder::AddToAttrsFingerprint(StringPiece attr_name,
+                                        StringPiece encoded_value) {
+  CombineUnordered(
+      CacheKeyHelper(attr_name, tensorflow::Fingerprint128(encoded_value)),
+      &attrs_fingerprint_);
+  cached_cache_key_ = absl::nullopt;
 }
 
 void AttrBuilder::InitializeNodeDef() {
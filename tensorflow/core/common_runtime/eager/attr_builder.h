@@ -102,12 +102,15 @@ class AttrBuilder : public AbstractOpAttrs {
 
   void Reset(const char* op) {
     op_name_ = op;
+    op_fingerprint_ = tensorflow::Fingerprint128(op_name_);
     num_inputs_ = 0;
     encoded_attrs_.clear();
+    attrs_fingerprint_ = {0, 0};
     node_def_initialized_ = false;
     node_def_finalized_ = false;
     cached_cache_key_ = absl::nullopt;
     device_for_cached_cache_key_.clear();
+    device_fingerprint_ = tensorflow::Fingerprint128("");
   }
 
   const string& op_name() const { return op_name_; }
@@ -119,7 +122,6 @@ class AttrBuilder : public AbstractOpAttrs {
   AttrBuilder& Set(StringPiece attr_name, T&& value) {
     SetAttrValue(value, &attr_tmp_);
     AddAttrIfNotPresent(attr_name, attr_tmp_);
-    cached_cache_key_ = absl::nullopt;
     return *this;
   }
 
@@ -127,7 +129,6 @@ class AttrBuilder : public AbstractOpAttrs {
 
   AttrBuilder& Set(StringPiece attr_name, const AttrValue& value) {
     AddAttrIfNotPresent(attr_name, value);
-    cached_cache_key_ = absl::nullopt;
     return *this;
   }
 
@@ -180,7 +181,9 @@ class AttrBuilder : public AbstractOpAttrs {
       absl::InlinedVector<DataType, 4>* type_list) const override;
 
  private:
-  tensorflow::Fprint128 BuildCacheKeyForDevice(const StringPiece device) const;
+  // Adds a newly set attribute to `attrs_fingerprint_` and invalidates the
+  // cached cache key.
+  void AddToAttrsFingerprint(StringPiece attr_name, StringPiece encoded_value);
 
   // Initialize the node_def_ object.
   // REQUIRES: node_def_initialized_ = false
@@ -198,16 +201,24 @@ class AttrBuilder : public AbstractOpAttrs {
   void AddAttrIfNotPresent(StringPiece attr_name, const AttrValue& value);
 
   gtl::FlatMap<string, string> encoded_attrs_;
+  // The order-independent combination of the fingerprints of all attributes
+  // in `encoded_attrs_`. It is updated as attributes are set, so that cache
+  // keys do not need to fingerprint every attribute again.
+  tensorflow::Fprint128 attrs_fingerprint_ = {0, 0};
   mutable AttrValue attr_tmp_;  // For encoding
 
   string op_name_;  // Conceptually const, but can't be because of Reset(...)
+  tensorflow::Fprint128 op_fingerprint_ = tensorflow::Fingerprint128("");
   int num_inputs_;
   NodeDef node_def_;
   bool node_def_initialized_;
   bool node_def_finalized_;
 
+  // The cache key for `device_for_cached_cache_key_`. It is invalidated when
+  // an attribute is added, while the fingerprint of the device is kept.
   absl::optional<tensorflow::Fprint128> cached_cache_key_;
   string device_for_cached_cache_key_;
+  tensorflow::Fprint128 device_fingerprint_ = tensorflow::Fingerprint128("");
 };
 
 template <>
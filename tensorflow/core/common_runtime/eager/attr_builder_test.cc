@@ -85,6 +85,57 @@ TEST(AttrTypeMap, CacheKey) {
   ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
 }
 
+TEST(AttrBuilder, CacheKeyIndependentOfAttrOrder) {
+  AttrBuilder a("op_name");
+  a.Set("T", DT_FLOAT);
+  a.Set("N", 2);
+  AttrBuilder b("op_name");
+  b.Set("N", 2);
+  b.Set("T", DT_FLOAT);
+  // Setting an attribute again keeps its first value.
+  b.Set("T", DT_INT32);
+  EXPECT_TRUE(a.CacheKey("cpu:0") == b.CacheKey("cpu:0"));
+
+  AttrBuilder c("op_name");
+  c.Set("N", 2);
+  const tensorflow::Fprint128 partial_key = c.CacheKey("cpu:0");
+  AttrBuilder d("op_name");
+  d.Set("T", DT_FLOAT);
+  c.CopyAttributes(d);
+  EXPECT_FALSE(partial_key == c.CacheKey("cpu:0"));
+  EXPECT_TRUE(a.CacheKey("cpu:0") == c.CacheKey("cpu:0"));
+
+  a.Reset("op_name");
+  EXPECT_TRUE(a.CacheKey("cpu:0") == AttrBuilder("op_name").CacheKey("cpu:0"));
+}
+
+TEST(AttrBuilder, CachedCacheKeyFollowsDeviceAndAttrs) {
+  AttrBuilder a("op_name");
+  a.Set("T", DT_FLOAT);
+  const tensorflow::Fprint128 cpu_key = a.CacheKey("cpu:0");
+  const tensorflow::Fprint128 gpu_key = a.CacheKey("gpu:0");
+  EXPECT_FALSE(cpu_key == gpu_key);
+  EXPECT_TRUE(a.CacheKey("cpu:0") == cpu_key);
+
+  // Setting an attribute that is already present changes nothing.
+  a.Set("T", DT_INT32);
+  EXPECT_TRUE(a.CacheKey("cpu:0") == cpu_key);
+
+  // A new attribute changes the key for the device it was cached for.
+  a.Set("N", 2);
+  EXPECT_FALSE(a.CacheKey("cpu:0") == cpu_key);
+  AttrBuilder b("op_name");
+  b.Set("N", 2);
+  b.Set("T", DT_FLOAT);
+  EXPECT_TRUE(a.CacheKey("cpu:0") == b.CacheKey("cpu:0"));
+
+  // The empty device name is fingerprinted like any other.
+  AttrBuilder c("op_name");
+  c.Set("T", DT_FLOAT);
+  EXPECT_FALSE(c.CacheKey("") == cpu_key);
+  EXPECT_TRUE(c.CacheKey("cpu:0") == cpu_key);
+}
+
 string ToString(const AttrValueMap& m) {
   std::vector<string> strs;
   for (const auto& e : m) {
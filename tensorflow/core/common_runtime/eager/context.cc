@@ -485,7 +485,10 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
   // as well.
   mutex_lock ml(cache_mu_);
   default_executor_.WaitForAllPendingNodes().IgnoreError();
-  kernel_cache_.clear();
+  for (KernelCacheShard& shard : kernel_cache_shards_) {
+    mutex_lock l(shard.mu);
+    shard.kernels.clear();
+  }
   for (auto& entry : registered_functions_) {
     entry.second->cached_kernel_keys->clear();
   }
@@ -991,7 +994,9 @@ Status EagerContext::RemoveFunction(const string& func) {
   bool is_last_ref = registered_function->RefCountIsOne();
   if (is_last_ref) {
     for (auto& key : *registered_function->cached_kernel_keys) {
-      kernel_cache_.erase(key);
+      KernelCacheShard& shard = KernelCacheShardFor(key);
+      mutex_lock l(shard.mu);
+      shard.kernels.erase(key);
     }
     registered_functions_.erase(func);
   }
@@ -1059,9 +1064,10 @@ Status EagerContext::SyncExecutors() {
 
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
-  tf_shared_lock l(cache_mu_);
-  auto iter = kernel_cache_.find(cache_key);
-  if (iter == kernel_cache_.end()) {
+  KernelCacheShard& shard = KernelCacheShardFor(cache_key);
+  tf_shared_lock l(shard.mu);
+  auto iter = shard.kernels.find(cache_key);
+  if (iter == shard.kernels.end()) {
     return nullptr;
   }
   core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
@@ -1081,7 +1087,11 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   mutex_lock ml(cache_mu_);
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  {
+    KernelCacheShard& shard = KernelCacheShardFor(cache_key);
+    mutex_lock l(shard.mu);
+    shard.kernels[cache_key] = std::move(new_ref);
+  }
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
@@ -1568,6 +1578,8 @@ Status EagerContext::SetMasterContextState(
 
   use_send_tensor_rpc_ =
       ReadBoolFromEnvVar("TF_EAGER_REMOTE_USE_SEND_TENSOR_RPC", true);
+  cache_remote_op_attrs_ =
+      ReadBoolFromEnvVar("TF_EAGER_REMOTE_CACHE_OP_ATTRS", false);
 
   if (local_device_mgr != local_device_manager_.Get()) {
     if (local_device_manager_.Owned()) {
@@ -490,6 +490,10 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   // used instead (which in-turn use WorkerService.RecvTensor RPCs).
   bool UseSendTensorRPC() { return use_send_tensor_rpc_; }
 
+  // If true, remote ops only send their attributes to a remote context once;
+  // later ops with the same attributes refer to them by id.
+  bool CacheRemoteOpAttrs() { return cache_remote_op_attrs_; }
+
   tensorflow::ServerInterface* GetServer() { return server_.get(); }
 
   // For LLVM style RTTI.
@@ -714,9 +718,22 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
     std::unique_ptr<std::vector<Fprint128>> cached_kernel_keys;
   };
-  std::unordered_map<Fprint128, core::RefCountPtr<KernelAndDevice>,
-                     Fprint128Hasher>
-      kernel_cache_ TF_GUARDED_BY(cache_mu_);
+  // The kernel cache is split into shards with separate locks, so that
+  // concurrent lookups of different kernels do not contend on one lock. The
+  // shard locks are taken after `cache_mu_`.
+  static constexpr int kNumKernelCacheShards = 16;
+  struct alignas(64) KernelCacheShard {
+    mutex mu;
+    std::unordered_map<Fprint128, core::RefCountPtr<KernelAndDevice>,
+                       Fprint128Hasher>
+        kernels TF_GUARDED_BY(mu);
+  };
+  KernelCacheShard& KernelCacheShardFor(const Fprint128& cache_key) {
+    // Fprint128Hasher uses the low bits, so the shard is picked by the high
+    // bits.
+    return kernel_cache_shards_[cache_key.high64 % kNumKernelCacheShards];
+  }
+  KernelCacheShard kernel_cache_shards_[kNumKernelCacheShards];
   std::unordered_map<string, RegisteredFunction*> registered_functions_
       TF_GUARDED_BY(cache_mu_);
   absl::flat_hash_map<Fprint128, Device*, Fprint128Hasher> device_cache_
@@ -826,6 +843,7 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   // redundant copies.
   bool lazy_copy_function_remote_inputs_ = false;
   bool use_send_tensor_rpc_;
+  bool cache_remote_op_attrs_ = false;
   const bool pin_small_ops_to_cpu_;
 
   // Function that will be invoked in destructor to deallocate resources related
@@ -150,7 +150,7 @@ Status EagerExecutor::AddOrExecute(std::unique_ptr<EagerNode> node) {
     } else {
       status = status_;
       if (status.ok()) {
-        node_queue_.push(std::move(item));
+        node_queue_.push_back(std::move(item));
         // If there were no previous nodes pending, wake the run thread to
         // start processing requests again.
         if (node_queue_.size() == 1) {
@@ -231,7 +231,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
     if (from_queue) {
       // Since this was from the async queue, pop it from the front of the queue
       DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-      node_queue_.pop();
+      node_queue_.pop_front();
     } else if (async) {
       // If it is an Async node then we will find the node in the unfinished
       // nodes list. However we only notify if we are at the front of the list
@@ -263,9 +263,17 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
                                 "EagerExecutor. This error cancels all future "
                                 "operations and poisons their output tensors.");
       }
+      if (num_batch_nodes_in_queue_ > 0) {
+        // RunBatch() holds references to these and aborts the ones it has not
+        // run yet.
+        for (; num_batch_nodes_in_queue_ > 0; --num_batch_nodes_in_queue_) {
+          node_queue_.pop_front();
+        }
+        batch_cancelled_status_ = status_;
+      }
       while (!node_queue_.empty()) {
         items_to_destroy.push_front(std::move(node_queue_.front()));
-        node_queue_.pop();
+        node_queue_.pop_front();
       }
       for (auto& it : unfinished_nodes_) {
         items_to_destroy.push_front(std::move(it.second));
@@ -320,29 +328,104 @@ void EagerExecutor::NotifyWaiters(uint64 id) {
 void EagerExecutor::Run() {
   auto thread_exited_notifier =
       gtl::MakeCleanup([this] { thread_exited_notification_.Notify(); });
+  std::vector<core::RefCountPtr<NodeItem>> batch;
   while (true) {
-    core::RefCountPtr<NodeItem> curr_item;
     {
       tensorflow::mutex_lock l(node_queue_mutex_);
       while (node_queue_.empty() || !status_.ok()) {
         if (state_ == ExecutorState::kShutDown) return;
         nodes_pending_.wait(l);
       }
-      // Obtain raw pointer since we don't want to remove from the queue until
-      // the node has been run. Otherwise, WaitForAllPendingNodes can return
+      // Obtain raw pointers since we don't want to remove from the queue until
+      // the nodes have been run. Otherwise, WaitForAllPendingNodes can return
       // too early.
       // Note, we don't std::move from the here because the front of the queue
       // will then contain a nullptr. This can be a problem in
       // WaitForAllPendingNodes where we get the top EagerNode pointer
       // and register a notification for its completion.
-      curr_item.reset(node_queue_.front().get());
-      curr_item->Ref();
+      //
+      // Consecutive synchronous nodes are taken together, so that the queue
+      // lock is taken once per batch rather than twice per node.
+      for (const auto& item : node_queue_) {
+        if (batch.size() == kMaxBatchSize ||
+            (!batch.empty() && item->node->AsAsync() != nullptr)) {
+          break;
+        }
+        batch.emplace_back(item.get());
+        item->Ref();
+        if (item->node->AsAsync() != nullptr) break;
+      }
+      if (batch.front()->node->AsAsync() == nullptr) {
+        num_batch_nodes_in_queue_ = batch.size();
+      }
+    }
+    Status status;
+    if (batch.front()->node->AsAsync() != nullptr) {
+      status = RunItem(std::move(batch.front()), /*from_queue=*/true);
+    } else {
+      status = RunBatch(batch);
     }
-    Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
     if (!status.ok()) {
       VLOG(1) << "Failed to run item: " << status;
     }
+    // The nodes are destroyed here, while not holding node_queue_mutex_.
+    batch.clear();
+  }
+}
+
+Status EagerExecutor::RunBatch(
+    const std::vector<core::RefCountPtr<NodeItem>>& batch) {
+  for (int i = 0; i < batch.size(); ++i) {
+    const core::RefCountPtr<NodeItem>& item = batch[i];
+    // A failure of another node cancels the rest of this batch.
+    if (!ok()) {
+      BatchDone(batch, i);
+      return status();
+    }
+    DVLOG(3) << "Running Node: [id " << item->id << "] "
+             << item->node->DebugString();
+    Status status = item->node->Run();
+    if (!status.ok()) {
+      // The remaining nodes of the batch stay in the queue, unless the
+      // failure aborts them.
+      if (BatchDone(batch, i)) {
+        NodeDone(item, status, /*from_queue=*/true);
+      }
+      return status;
+    }
+  }
+  BatchDone(batch, batch.size());
+  return OkStatus();
+}
+
+bool EagerExecutor::BatchDone(
+    const std::vector<core::RefCountPtr<NodeItem>>& batch, int num_done) {
+  Status cancelled_status;
+  {
+    mutex_lock l(node_queue_mutex_);
+    for (int i = 0; i < num_done; ++i) {
+      batch[i]->state = NodeState::kDONE;
+    }
+    if (batch_cancelled_status_.ok()) {
+      for (int i = 0; i < num_done; ++i) {
+        DCHECK(!node_queue_.empty() &&
+               batch[i].get() == node_queue_.front().get());
+        node_queue_.pop_front();
+      }
+      num_batch_nodes_in_queue_ = 0;
+      if (num_done > 0) {
+        NotifyWaiters(batch.front()->id);
+      }
+      return true;
+    }
+    DCHECK_EQ(num_batch_nodes_in_queue_, 0);
+    cancelled_status = batch_cancelled_status_;
+    batch_cancelled_status_ = OkStatus();
+  }
+  for (int i = num_done; i < batch.size(); ++i) {
+    batch[i]->node->Abort(cancelled_status);
   }
+  return false;
 }
 
 Status EagerExecutor::RunItem(core::RefCountPtr<NodeItem> item,
@@ -407,7 +490,7 @@ Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
 
   if (from_queue) {
     DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-    node_queue_.pop();
+    node_queue_.pop_front();
   }
 
   DVLOG(3) << "Add Node: [id " << item->id << "] to unfinished map.";
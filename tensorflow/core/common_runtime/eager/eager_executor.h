@@ -17,9 +17,9 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstddef>
+#include <deque>
 #include <map>
 #include <memory>
-#include <queue>
 #include <string>
 #include <vector>
 
@@ -178,6 +178,10 @@ class EagerExecutor {
     kShutDown,
   };
 
+  // The maximum number of synchronous nodes the executor thread takes from
+  // the queue at once.
+  static constexpr int kMaxBatchSize = 64;
+
   enum class NodeState {
     kPENDING,
     kSCHEDULED,
@@ -206,6 +210,15 @@ class EagerExecutor {
   void Run();
 
   Status RunItem(core::RefCountPtr<NodeItem> item, bool from_queue);
+
+  // Runs consecutive synchronous nodes from the front of the queue, and
+  // removes them from the queue together.
+  Status RunBatch(const std::vector<core::RefCountPtr<NodeItem>>& batch);
+  // Marks the first `num_done` nodes of `batch` as successfully run. If an
+  // error cancelled the batch meanwhile, aborts the other nodes and returns
+  // false.
+  bool BatchDone(const std::vector<core::RefCountPtr<NodeItem>>& batch,
+                 int num_done);
   Status MoveToUnfinished(core::RefCountPtr<NodeItem> item, bool from_queue);
 
   // The impl of WaitForAllPendingNodes
@@ -223,13 +236,20 @@ class EagerExecutor {
   condition_variable nodes_pending_ TF_GUARDED_BY(node_queue_mutex_);
 
   // Queue of pending NodeItems. Ordered by NodeItem::id.
-  std::queue<core::RefCountPtr<NodeItem>> node_queue_
+  std::deque<core::RefCountPtr<NodeItem>> node_queue_
       TF_GUARDED_BY(node_queue_mutex_);
 
   // Ordered by NodeItem::id.
   std::map<uint64, core::RefCountPtr<NodeItem>, std::less<uint64>>
       unfinished_nodes_ TF_GUARDED_BY(node_queue_mutex_);
 
+  // The number of nodes at the front of `node_queue_` that RunBatch() is
+  // running. An error removes them from the queue without aborting them, and
+  // sets `batch_cancelled_status_`; RunBatch() then aborts the nodes it has
+  // not run, so that the ones it has run keep their outputs.
+  int num_batch_nodes_in_queue_ TF_GUARDED_BY(node_queue_mutex_) = 0;
+  Status batch_cancelled_status_ TF_GUARDED_BY(node_queue_mutex_);
+
   // `status_` is set based on any errors raised during execution of a
   // EagerNode.  It remains set until ClearError is called.
   Status status_ TF_GUARDED_BY(node_queue_mutex_);
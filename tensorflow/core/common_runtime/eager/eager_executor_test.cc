@@ -0,0 +1,208 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/eager/eager_executor.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Records the order in which nodes run or are aborted.
+struct NodeLog {
+  mutex mu;
+  std::vector<int> ran TF_GUARDED_BY(mu);
+  std::vector<int> aborted TF_GUARDED_BY(mu);
+};
+
+class TestNode : public EagerNode {
+ public:
+  TestNode(int id, NodeLog* log, Status status = OkStatus(),
+           bool fatal = true)
+      : id_(id), log_(log), status_(status), fatal_(fatal) {}
+
+  Status Run() override {
+    mutex_lock l(log_->mu);
+    log_->ran.push_back(id_);
+    return status_;
+  }
+
+  void Abort(Status status) override {
+    mutex_lock l(log_->mu);
+    log_->aborted.push_back(id_);
+  }
+
+  string DebugString() const override { return "[TestNode]"; }
+
+  bool Fatal() const override { return fatal_; }
+
+ private:
+  const int id_;
+  NodeLog* const log_;
+  const Status status_;
+  const bool fatal_;
+};
+
+class TestAsyncNode : public AsyncEagerNode {
+ public:
+  TestAsyncNode(int id, NodeLog* log) : id_(id), log_(log) {}
+
+  void RunAsync(StatusCallback done) override {
+    {
+      mutex_lock l(log_->mu);
+      log_->ran.push_back(id_);
+    }
+    done(OkStatus());
+  }
+
+  void Abort(Status status) override {
+    mutex_lock l(log_->mu);
+    log_->aborted.push_back(id_);
+  }
+
+  string DebugString() const override { return "[TestAsyncNode]"; }
+
+ private:
+  const int id_;
+  NodeLog* const log_;
+};
+
+// An asynchronous node that completes only when Fail() is called.
+class PendingAsyncNode : public AsyncEagerNode {
+ public:
+  PendingAsyncNode(int id, NodeLog* log) : id_(id), log_(log) {}
+
+  void RunAsync(StatusCallback done) override {
+    mutex_lock l(log_->mu);
+    log_->ran.push_back(id_);
+    done_ = std::move(done);
+  }
+
+  void Abort(Status status) override {
+    mutex_lock l(log_->mu);
+    log_->aborted.push_back(id_);
+  }
+
+  string DebugString() const override { return "[PendingAsyncNode]"; }
+
+  // Completing the node may destroy it.
+  void Fail(Status status) {
+    StatusCallback done = std::move(done_);
+    done(status);
+  }
+
+ private:
+  const int id_;
+  NodeLog* const log_;
+  StatusCallback done_;
+};
+
+// A node that fails a pending asynchronous node when it runs.
+class FailPendingNode : public TestNode {
+ public:
+  FailPendingNode(int id, NodeLog* log, PendingAsyncNode* pending)
+      : TestNode(id, log), pending_(pending) {}
+
+  Status Run() override {
+    pending_->Fail(errors::Internal("failed"));
+    return TestNode::Run();
+  }
+
+ private:
+  PendingAsyncNode* const pending_;
+};
+
+TEST(EagerExecutorTest, RunsQueuedNodesInOrder) {
+  EagerExecutor executor(/*async=*/true);
+  NodeLog log;
+  std::vector<int> expected;
+  for (int i = 0; i < 200; ++i) {
+    if (i % 50 == 7) {
+      TF_ASSERT_OK(
+          executor.AddOrExecute(std::make_unique<TestAsyncNode>(i, &log)));
+    } else {
+      TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(i, &log)));
+    }
+    expected.push_back(i);
+  }
+  TF_ASSERT_OK(executor.WaitForAllPendingNodes());
+  mutex_lock l(log.mu);
+  EXPECT_EQ(log.ran, expected);
+  EXPECT_TRUE(log.aborted.empty());
+}
+
+TEST(EagerExecutorTest, FatalErrorAbortsQueuedNodes) {
+  EagerExecutor executor(/*async=*/true);
+  NodeLog log;
+  {
+    // Hold the log so that all nodes are queued before the first one runs.
+    mutex_lock l(log.mu);
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(0, &log)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(
+        1, &log, errors::Internal("failed"))));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(2, &log)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(3, &log)));
+  }
+  EXPECT_TRUE(errors::IsInternal(executor.WaitForAllPendingNodes()));
+  mutex_lock l(log.mu);
+  EXPECT_EQ(log.ran, std::vector<int>({0, 1}));
+  EXPECT_EQ(log.aborted, std::vector<int>({3, 2}));
+}
+
+TEST(EagerExecutorTest, ErrorDuringBatchOnlyAbortsNodesNotRun) {
+  EagerExecutor executor(/*async=*/true);
+  NodeLog log;
+  {
+    // Hold the log so that nodes 1 to 3 are run as one batch.
+    mutex_lock l(log.mu);
+    auto pending = std::make_unique<PendingAsyncNode>(0, &log);
+    PendingAsyncNode* pending_ptr = pending.get();
+    TF_ASSERT_OK(executor.AddOrExecute(std::move(pending)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(1, &log)));
+    TF_ASSERT_OK(executor.AddOrExecute(
+        std::make_unique<FailPendingNode>(2, &log, pending_ptr)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(3, &log)));
+  }
+  // Waits for the executor thread to finish the batch.
+  EXPECT_TRUE(errors::IsInternal(executor.ShutDown()));
+  mutex_lock l(log.mu);
+  EXPECT_EQ(log.ran, std::vector<int>({0, 1, 2}));
+  EXPECT_EQ(log.aborted, std::vector<int>({3}));
+}
+
+TEST(EagerExecutorTest, NonFatalErrorContinuesWithNextNode) {
+  EagerExecutor executor(/*async=*/true);
+  NodeLog log;
+  {
+    mutex_lock l(log.mu);
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(0, &log)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(
+        1, &log, errors::Internal("failed"), /*fatal=*/false)));
+    TF_ASSERT_OK(executor.AddOrExecute(std::make_unique<TestNode>(2, &log)));
+  }
+  TF_ASSERT_OK(executor.WaitForAllPendingNodes());
+  mutex_lock l(log.mu);
+  EXPECT_EQ(log.ran, std::vector<int>({0, 1, 2}));
+  EXPECT_TRUE(log.aborted.empty());
+}
+
+}  // namespace
+}  // namespace tensorflow
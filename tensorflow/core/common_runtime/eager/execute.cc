@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/platform.h"
 #include "tensorflow/core/platform/protobuf.h"
 
@@ -1633,6 +1634,25 @@ Status EagerRemoteExecute(EagerOperation* op, TensorHandle** retvals,
   TF_RETURN_IF_ERROR(
       StoreResourceDtypesAndShapes(*remote_op, output_dtypes, retvals));
 
+  // Once the remote context holds this op's attributes, only send their id.
+  const uint64 context_view_id = ctx.GetContextViewId();
+  uint64 attrs_id_to_register = 0;
+  if (ctx.CacheRemoteOpAttrs() && !remote_op->attrs().empty()) {
+    const Fprint128 attrs_key = op->MutableAttrs()->CacheKey(op->DeviceName());
+    // Zero means "no id", so never hand it out.
+    const uint64 attrs_id = std::max<uint64>(
+        1, FingerprintCat64(attrs_key.low64, attrs_key.high64));
+    eager::RemoteMgr* remote_mgr = ctx.RemoteMgr().get();
+    if (remote_mgr->HasRemoteOpAttrs(remote_task, context_view_id, attrs_id)) {
+      remote_op->set_attrs_id(attrs_id);
+      remote_op->clear_attrs();
+    } else if (remote_mgr->CanCacheRemoteOpAttrs(remote_task,
+                                                 context_view_id)) {
+      remote_op->set_attrs_id(attrs_id);
+      attrs_id_to_register = attrs_id;
+    }
+  }
+
   auto& executor = op->Executor();
   VLOG(4) << "Execute remote eager op: " << op->Name()
           << " (is async?: " << executor.Async() << ").";
@@ -1640,11 +1660,20 @@ Status EagerRemoteExecute(EagerOperation* op, TensorHandle** retvals,
   const absl::InlinedVector<TensorHandle*, 4>* inputs;
   TF_RETURN_IF_ERROR(op->TensorHandleInputs(&inputs));
 
-  std::unique_ptr<EagerNode> node(new eager::RemoteExecuteNode(
-      &op->EagerContext(), std::move(request), op_device,
-      ctx.GetContextViewId(), eager_client.get(), op->GetCancellationManager(),
+  auto remote_node = std::make_unique<eager::RemoteExecuteNode>(
+      &op->EagerContext(), std::move(request), op_device, context_view_id,
+      eager_client.get(), op->GetCancellationManager(),
       op->MutableAttrs()->BuildNodeDef(), op->EagerContext().FuncLibDef(),
-      *inputs, {retvals, num_outputs}));
+      *inputs, absl::Span<TensorHandle*>(retvals, num_outputs));
+  if (attrs_id_to_register != 0) {
+    remote_node->AddSuccessCallback(
+        [remote_mgr = ctx.RemoteMgr().get(), remote_task, context_view_id,
+         attrs_id_to_register]() {
+          remote_mgr->AddRemoteOpAttrs(remote_task, context_view_id,
+                                       attrs_id_to_register);
+        });
+  }
+  std::unique_ptr<EagerNode> node(std::move(remote_node));
 
   if (op->EagerContext().LogDevicePlacement() || VLOG_IS_ON(1)) {
     string msg = strings::StrCat(
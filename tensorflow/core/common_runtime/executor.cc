@@ -15,21 +15,28 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <time.h>
+
+#include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "tensorflow/core/common_runtime/cost_constants.h"
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/planned_memory.h"
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/request_cost.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -58,6 +65,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -125,6 +133,19 @@ void SetMemory(NodeExecStatsInterface* stats, OpKernelContext* ctx) {
 
 }  // namespace nodestats
 
+// Returns the CPU time consumed so far by the calling thread, or 0 where it
+// is not available.
+int64_t ThreadCpuNanos() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return static_cast<int64_t>(ts.tv_sec) * EnvTime::kSecondsToNanos +
+           ts.tv_nsec;
+  }
+#endif
+  return 0;
+}
+
 // Time the execution of kernels (in CPU cycles).  Used to dynamically identify
 // inexpensive kernels which can be dispatched inline.
 struct KernelTimer {
@@ -139,13 +160,37 @@ struct KernelTimer {
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
+// The priority of each node of a graph, indexed by node id. The priority of a
+// node is the estimated cost, in CPU cycles, of the longest path from the node
+// to the end of the graph.
+typedef std::vector<uint64> NodePriorities;
+
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  // If `use_work_stealing` is true, ready nodes which are not run inline are
+  // shared by a bounded number of workers per step. See
+  // `ExecutorState::SharedReadyQueue`. If `use_critical_path_priorities` is
+  // also true, the workers take the nodes on the longest remaining path first.
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool use_work_stealing = false,
+                        bool use_critical_path_priorities = false)
+      : immutable_state_(p),
+        use_work_stealing_(use_work_stealing),
+        use_critical_path_priorities_(use_work_stealing &&
+                                      use_critical_path_priorities) {
+    if (p.memory_plan != nullptr && !p.memory_plan->buffers.empty()) {
+      planned_memory_pool_ = std::make_unique<PlannedMemoryPool>(
+          p.memory_plan, p.device->GetAllocator(AllocatorAttributes()));
+    }
+  }
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    if (use_critical_path_priorities_) {
+      mutex_lock l(priorities_mu_);
+      priorities_ = ComputeCriticalPathPriorities();
+    }
     return OkStatus();
   }
 
@@ -187,6 +232,13 @@ class ExecutorImpl : public Executor {
       return is_expensive_[node.node_id];
     }
 
+    // Returns the estimated cost of the given node, in CPU cycles.
+    uint64 CostEstimate(const NodeItem& node) const {
+      if (node.kernel == nullptr) return 0;
+      if (!is_expensive_[node.node_id]) return kInexpensiveCostEstimateCycles;
+      return cost_estimates_[node.node_id].load(std::memory_order_relaxed);
+    }
+
     // Updates the dynamic cost estimate, which is used to determine whether the
     // given node is expensive. The new cost estimate is a weighted average of
     // the old cost estimate and the latest cost. We only update cost estimates
@@ -211,14 +263,39 @@ class ExecutorImpl : public Executor {
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
     static constexpr uint64 kCostDecay = 10;
+    // The cost assumed for kernels whose IsExpensive() returns false, which
+    // are not timed.
+    static constexpr uint64 kInexpensiveCostEstimateCycles = 1000;
 
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
   };
 
+  // The critical path priorities are recomputed from the cost estimates of
+  // `kernel_stats_` every `kPriorityRefreshSteps` steps.
+  static constexpr int64_t kPriorityRefreshSteps = 64;
+
+  // Returns the priorities of the nodes, estimated from the current cost
+  // estimates of the kernels.
+  std::shared_ptr<const NodePriorities> ComputeCriticalPathPriorities() const;
+
+  // Returns the priorities to schedule the next step with, or nullptr if the
+  // nodes are not prioritized.
+  std::shared_ptr<const NodePriorities> GetPrioritiesForStep()
+      TF_LOCKS_EXCLUDED(priorities_mu_);
+
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  const bool use_work_stealing_;
+  const bool use_critical_path_priorities_;
+  // Not null if the params have a memory plan.
+  std::unique_ptr<PlannedMemoryPool> planned_memory_pool_;
+
+  std::atomic<int64_t> num_steps_{0};
+  mutex priorities_mu_;
+  std::shared_ptr<const NodePriorities> priorities_
+      TF_GUARDED_BY(priorities_mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
@@ -277,7 +354,10 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                PlannedMemoryPool* planned_memory_pool,
+                bool use_work_stealing = false,
+                std::shared_ptr<const NodePriorities> priorities = nullptr);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -291,6 +371,93 @@ class ExecutorState {
 
   struct AsyncState;
 
+  // The ready nodes of a step which may be run by any of its workers, for the
+  // work-stealing executor.
+  //
+  // Instead of dispatching each ready expensive node in a closure of its own,
+  // nodes which are not run inline are queued here, and a worker is only
+  // started when there are fewer workers than expensive nodes to run. A worker
+  // runs its inline nodes and then takes nodes from this queue until it is
+  // empty. Cheap nodes made ready outside of a worker, e.g. by an asynchronous
+  // kernel, are run by the existing workers where possible, so that a batch of
+  // them costs a single closure.
+  //
+  // Each worker counts as an outstanding op, so that the step does not finish
+  // while a worker may still access the queue.
+  //
+  // If `priorities` is not null, nodes are popped in decreasing order of
+  // priority instead of in FIFO order.
+  class SharedReadyQueue {
+   public:
+    SharedReadyQueue(int max_workers, const NodePriorities* priorities)
+        : max_workers_(std::max(max_workers, 1)), priorities_(priorities) {}
+
+    bool is_prioritized() const { return priorities_ != nullptr; }
+
+    // Returns true if `a` has a lower priority than `b`.
+    //
+    // REQUIRES: `is_prioritized()`.
+    bool HasLowerPriority(const TaggedNode& a, const TaggedNode& b) const {
+      return (*priorities_)[a.node_item->node_id] <
+             (*priorities_)[b.node_item->node_id];
+    }
+
+    // Queues `nodes`, and returns the number of workers that the caller must
+    // start. This is at most `num_workers_wanted`, except that there is always
+    // a worker while the queue is not empty.
+    int Push(const TaggedNodeSeq& nodes, int num_workers_wanted)
+        TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(mu_);
+      for (const TaggedNode& node : nodes) {
+        nodes_.push_back(node);
+        if (is_prioritized()) {
+          std::push_heap(nodes_.begin(), nodes_.end(), LowerPriority());
+        }
+      }
+      int num_workers =
+          std::min(num_workers_wanted, max_workers_ - num_workers_);
+      if (num_workers_ == 0) {
+        num_workers = std::max(num_workers, 1);
+      }
+      num_workers = std::max(num_workers, 0);
+      num_workers_ += num_workers;
+      return num_workers;
+    }
+
+    // Pops the next node. Returns nullopt, and retires the calling worker, if
+    // the queue is empty.
+    absl::optional<TaggedNode> PopOrRetire() TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(mu_);
+      if (nodes_.empty()) {
+        --num_workers_;
+        return absl::nullopt;
+      }
+      if (is_prioritized()) {
+        std::pop_heap(nodes_.begin(), nodes_.end(), LowerPriority());
+        TaggedNode node = nodes_.back();
+        nodes_.pop_back();
+        return node;
+      }
+      TaggedNode node = nodes_.front();
+      nodes_.pop_front();
+      return node;
+    }
+
+   private:
+    auto LowerPriority() const {
+      return [this](const TaggedNode& a, const TaggedNode& b) {
+        return HasLowerPriority(a, b);
+      };
+    }
+
+    const int max_workers_;
+    const NodePriorities* const priorities_;  // Not owned.
+    mutex mu_;
+    // A max-heap of the nodes if `priorities_` is not null.
+    std::deque<TaggedNode> nodes_ TF_GUARDED_BY(mu_);
+    int num_workers_ TF_GUARDED_BY(mu_) = 0;
+  };
+
   // Process a ready node in current thread.
   void Process(TaggedNode node, int64_t scheduled_nsec);
 
@@ -329,12 +496,33 @@ class ExecutorState {
   // REQUIRES: `!ready->empty()`.
   void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
 
+  // Implements `ScheduleReady` for the work-stealing executor.
+  void ScheduleReadyWithWorkStealing(TaggedNodeSeq* ready,
+                                     TaggedNodeReadyQueue* inline_ready,
+                                     int64_t scheduled_nsec);
+
+  // Runs the nodes of `ready_queue_` on a worker started by
+  // `ScheduleReadyWithWorkStealing`.
+  void RunWorker(int64_t scheduled_nsec);
+
+  // For the work-stealing executor, moves the next node of `ready_queue_` into
+  // `*inline_ready`. Returns false, retiring the calling worker, if there is
+  // none. Always returns false for the default executor.
+  bool StealReadyNode(TaggedNodeReadyQueue* inline_ready);
+
   // A wrapper for runner_ to keep track of the pending queue length. Op
   // execution should dispatch work using this function instead of using runner_
   // directly.
   template <typename Closure>
   void RunTask(Closure&& c);
 
+  // Adds the CPU time of the calling thread since `*cpu_start_nanos` to the
+  // step, and restarts the measurement.
+  void AccountCpuTime(int64_t* cpu_start_nanos);
+
+  // Adds the costs of this step to `request_cost_`.
+  void RecordRequestCost();
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -377,9 +565,27 @@ class ExecutorState {
   absl::optional<ManagedStackTrace> stack_trace_ = absl::nullopt;
   // If not null, use this device to schedule intra-op operation
   std::unique_ptr<DeviceBase> user_device_;
+  // If not null, serves the temporary allocations of this step. Acquired from
+  // and released to the device.
+  Allocator* step_temp_allocator_ = nullptr;
+  // If not null, serves the planned outputs of this step.
+  PlannedMemoryPool* const planned_memory_pool_;
+  PlannedMemory* planned_memory_ = nullptr;
+  // Not owned. If not null, the costs of this step accumulated below are
+  // added to it before the step is done.
+  RequestCost* const request_cost_;
+  int64_t run_start_nanos_ = 0;
+  std::atomic<int64_t> cpu_nanos_{0};
+  std::atomic<int64_t> rendezvous_wait_nanos_{0};
+  std::atomic<int64_t> output_bytes_{0};
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
+  // True if nodes are scheduled through `ready_queue_`.
+  const bool use_work_stealing_;
+  // If not null, the priorities of the nodes in `ready_queue_`.
+  const std::shared_ptr<const NodePriorities> priorities_;
+  SharedReadyQueue ready_queue_;
 
   PropagatorStateType propagator_;
 
@@ -401,7 +607,9 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats,
+    PlannedMemoryPool* planned_memory_pool, bool use_work_stealing,
+    std::shared_ptr<const NodePriorities> priorities)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -425,9 +633,15 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       cancellation_manager_(args.cancellation_manager),
       coordination_service_agent_(args.coordination_service_agent),
       stack_trace_(args.stack_trace),
+      planned_memory_pool_(planned_memory_pool),
+      request_cost_(args.request_cost),
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
+      use_work_stealing_(use_work_stealing && !run_all_kernels_inline_),
+      priorities_(std::move(priorities)),
+      ready_queue_(port::MaxParallelism(),
+                   use_work_stealing_ ? priorities_.get() : nullptr),
       propagator_(immutable_state, step_id_, vlog_),
       num_outstanding_ops_(0) {
   if (args.user_intra_op_threadpool != nullptr) {
@@ -435,6 +649,11 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  step_temp_allocator_ =
+      immutable_state_.params().device->AcquireStepTempAllocator();
+  if (planned_memory_pool_) {
+    planned_memory_ = planned_memory_pool_->Acquire();
+  }
 }
 
 template <class PropagatorStateType>
@@ -442,7 +661,17 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
+  if (step_temp_allocator_) {
+    immutable_state_.params().device->ReleaseStepTempAllocator(
+        step_temp_allocator_);
+  }
+  if (planned_memory_) {
+    planned_memory_pool_->Release(planned_memory_);
+  }
   delete slice_reader_cache_;
+  immutable_state_.params()
+      .device->GetAllocator(AllocatorAttributes())
+      ->OnStepBoundary();
 }
 
 template <class PropagatorStateType>
@@ -472,6 +701,7 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c) {
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   TaggedNodeSeq ready;
+  if (request_cost_ != nullptr) run_start_nanos_ = EnvTime::NowNanos();
 
   // Ask the device to fill in the device context map.
   Device* device = immutable_state_.params().device;
@@ -612,13 +842,21 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
   DCHECK(async_kernel != nullptr);
   AsyncState* state =
       new AsyncState(params, tagged_node, &item, first_input, stats);
+  // Asynchronous transfer nodes are Recvs, which wait on the rendezvous.
+  const int64_t recv_start_nanos =
+      request_cost_ != nullptr && item.is_transfer_node ? EnvTime::NowNanos()
+                                                        : 0;
 
-  auto done = [this, state]() {
+  auto done = [this, state, recv_start_nanos]() {
     Device* device = immutable_state_.params().device;
     NodeExecStatsInterface* stats = state->stats;  // Shorthand
     Entry* first_input = state->first_input;       // Shorthand
 
     nodestats::SetOpEnd(stats);
+    if (recv_start_nanos != 0) {
+      rendezvous_wait_nanos_.fetch_add(EnvTime::NowNanos() - recv_start_nanos,
+                                       std::memory_order_relaxed);
+    }
     EntryVector outputs(state->item->num_outputs);
     Status s = ProcessOutputs(*state->item, &state->ctx, outputs.data(), stats);
     nodestats::SetMemory(stats, &state->ctx);
@@ -712,6 +950,7 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
   params.start_time_usecs = start_time_usecs_;
   params.deadline = deadline_;
   params.log_memory = log_memory_;
+  params.step_temp_allocator = step_temp_allocator_;
   params.rendezvous = rendezvous_;
   params.collective_executor = collective_executor_;
   params.session_state = session_state_;
@@ -759,8 +998,9 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
   EntryVector outputs(1);
 
   bool completed = false;
+  int64_t cpu_start_nanos = request_cost_ != nullptr ? ThreadCpuNanos() : 0;
   inline_ready.push_back(tagged_node);
-  while (!inline_ready.empty()) {
+  while (!inline_ready.empty() || StealReadyNode(&inline_ready)) {
     tagged_node = inline_ready.front();
     inline_ready.pop_front();
     const NodeItem& item = tagged_node.get_node_item();
@@ -810,6 +1050,8 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
           (first_input + i)->ClearVal();
         }
         propagator_.MaybeMarkCompleted(tagged_node);
+        // The step may be done, and `this` deleted, once the last node is.
+        if (request_cost_ != nullptr) AccountCpuTime(&cpu_start_nanos);
         // Continue to process the nodes in 'inline_ready'.
         completed = NodeDone(s, &ready, stats, &inline_ready);
         continue;
@@ -822,8 +1064,12 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
       params.output_attr_array = item.output_attrs();
       params.forward_from_array = item.forward_from();
       params.outputs_required_array = item.outputs_required.get();
+      params.planned_output_allocators =
+          planned_memory_ ? planned_memory_->output_allocators(id) : nullptr;
 
       if (item.kernel_is_async) {
+        // The step may be done, and `this` deleted, as soon as the kernel is.
+        if (request_cost_ != nullptr) AccountCpuTime(&cpu_start_nanos);
         ProcessAsync(item, params, tagged_node, first_input, stats);
         launched_asynchronously = true;
       } else {
@@ -859,15 +1105,41 @@ void ExecutorState<PropagatorStateType>::Process(TaggedNode tagged_node,
       if (stats) {
         scheduled_nsec = nodestats::NowInNsec();
       }
+      if (request_cost_ != nullptr) AccountCpuTime(&cpu_start_nanos);
       // Postprocess.
       completed = NodeDone(s, &ready, stats, &inline_ready);
     }
   }  // while !inline_ready.empty()
 
+  if (use_work_stealing_) {
+    // The worker has retired, so its outstanding op is done.
+    completed = num_outstanding_ops_.fetch_sub(1) == 1;
+  }
   // This thread of computation is done if completed = true.
   if (completed) ScheduleFinish();
 }
 
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::StealReadyNode(
+    TaggedNodeReadyQueue* inline_ready) {
+  if (!use_work_stealing_) return false;
+  absl::optional<TaggedNode> tagged_node = ready_queue_.PopOrRetire();
+  if (!tagged_node.has_value()) return false;
+  inline_ready->push_back(*tagged_node);
+  return true;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(int64_t scheduled_nsec) {
+  absl::optional<TaggedNode> tagged_node = ready_queue_.PopOrRetire();
+  if (tagged_node.has_value()) {
+    Process(*tagged_node, scheduled_nsec);
+    return;
+  }
+  // Other workers have already taken the queued nodes.
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
 template <class PropagatorStateType>
 Status ExecutorState<PropagatorStateType>::PrepareInputs(
     const NodeItem& item, Entry* first_input, TensorValueVec* inputs,
@@ -1019,7 +1291,8 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
   }
 
   for (int i = 0; i < item.num_outputs; ++i) {
-    const TensorValue val = ctx->release_output(i);
+    // The context keeps owning a non-ref output, which is moved from below.
+    const TensorValue val = ctx->borrow_output(i);
     Entry* out = &outputs[i];
     DCHECK(out->state == Entry::State::NO_VALUE);
 
@@ -1057,6 +1330,10 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
                                           ctx->step_id(), i, to_log);
           }
         } else {
+          if (request_cost_ != nullptr && val.tensor->IsInitialized()) {
+            output_bytes_.fetch_add(val.tensor->TotalBytes(),
+                                    std::memory_order_relaxed);
+          }
           // NOTE that std::move is used here, so val.tensor goes to
           // uninitialized state (val.tensor->IsInitialized return false).
           out->state = Entry::State::HAS_VALUE;
@@ -1074,11 +1351,6 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
                              FormatNodeDefForError(item.kernel->def())));
       }
     }
-    if (!val.is_ref()) {
-      // If OpKernelContext returns outputs via pass-by-value, we
-      // don't need this trouble.
-      delete val.tensor;
-    }
   }
   return s;
 }
@@ -1173,7 +1445,9 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     scheduled_nsec = nodestats::NowInNsec();
   }
 
-  if (run_all_kernels_inline_) {
+  if (use_work_stealing_) {
+    ScheduleReadyWithWorkStealing(ready, inline_ready, scheduled_nsec);
+  } else if (run_all_kernels_inline_) {
     if (inline_ready == nullptr) {
       // Schedule all ready kernels from a single closure. This ensure that,
       // regardless of the `runner_` implementation, all kernels will run
@@ -1227,6 +1501,53 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleReadyWithWorkStealing(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready,
+    int64_t scheduled_nsec) {
+  TaggedNodeSeq queued;
+  int num_expensive = 0;
+  for (auto& tagged_node : *ready) {
+    const NodeItem& item = *tagged_node.node_item;
+    const bool is_expensive =
+        !tagged_node.get_is_dead() && kernel_stats_->IsExpensive(item);
+    if (inline_ready != nullptr && !is_expensive) {
+      // Inline this inexpensive node.
+      inline_ready->push_back(tagged_node);
+      continue;
+    }
+    num_expensive += is_expensive;
+    queued.push_back(tagged_node);
+  }
+  if (inline_ready != nullptr && inline_ready->empty() && !queued.empty()) {
+    // Run one expensive node in this thread, which has nothing else to do. If
+    // the nodes are prioritized, this is the most critical one.
+    auto next = queued.end() - 1;
+    if (ready_queue_.is_prioritized()) {
+      next = std::max_element(
+          queued.begin(), queued.end(),
+          [this](const TaggedNode& a, const TaggedNode& b) {
+            return ready_queue_.HasLowerPriority(a, b);
+          });
+    }
+    inline_ready->push_back(*next);
+    queued.erase(next);
+    --num_expensive;
+  }
+  if (queued.empty()) return;
+  // Each expensive node may get a worker of its own, while the cheap nodes
+  // share one.
+  const bool has_cheap_nodes = queued.size() > num_expensive;
+  const int num_workers =
+      ready_queue_.Push(queued, num_expensive + has_cheap_nodes);
+  if (num_workers == 0) return;
+  // The new workers are outstanding ops until they retire.
+  num_outstanding_ops_.fetch_add(num_workers, std::memory_order_relaxed);
+  for (int i = 0; i < num_workers; ++i) {
+    RunTask([this, scheduled_nsec]() { RunWorker(scheduled_nsec); });
+  }
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1247,6 +1568,36 @@ void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   Finish();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::AccountCpuTime(
+    int64_t* cpu_start_nanos) {
+  const int64_t now = ThreadCpuNanos();
+  cpu_nanos_.fetch_add(now - *cpu_start_nanos, std::memory_order_relaxed);
+  *cpu_start_nanos = now;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RecordRequestCost() {
+  if (request_cost_ == nullptr) return;
+  std::vector<std::pair<absl::string_view, absl::Duration>> costs = {
+      {kExecutorCpuTimeCostName,
+       absl::Nanoseconds(cpu_nanos_.load(std::memory_order_relaxed))},
+      {kRendezvousWaitCostName,
+       absl::Nanoseconds(
+           rendezvous_wait_nanos_.load(std::memory_order_relaxed))}};
+  // Kernels on other devices keep running after their Compute returns, so
+  // the step's wall time stands in for their device time.
+  if (immutable_state_.params().device->device_type() != DEVICE_CPU) {
+    costs.push_back(
+        {kDeviceTimeCostName,
+         absl::Nanoseconds(EnvTime::NowNanos() - run_start_nanos_)});
+  }
+  request_cost_->RecordCost(costs);
+  request_cost_->RecordMetrics(
+      {{kOutputBytesMetricName,
+        static_cast<double>(output_bytes_.load(std::memory_order_relaxed))}});
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::Finish() {
   mu_.lock();
@@ -1308,6 +1659,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
         collective_executor_->StartAbort(status);
       }
     }
+    RecordRequestCost();
     delete this;
     runner([step_id, status, done_cb = std::move(done_cb)]() {
       profiler::TraceMeConsumer activity(
@@ -1331,6 +1683,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
     // the user until the step (and its side-effects) has actually completed.
     device->Sync([this, step_id, runner = std::move(runner),
                   done_cb = std::move(done_cb)](const Status& status) mutable {
+      RecordRequestCost();
       delete this;
       runner([step_id, status, done_cb = std::move(done_cb)]() {
         profiler::TraceMeConsumer activity(
@@ -1346,6 +1699,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
       });
     });
   } else {
+    RecordRequestCost();
     delete this;
     runner([step_id, status, done_cb = std::move(done_cb)]() {
       profiler::TraceMeConsumer activity(
@@ -1364,19 +1718,78 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, planned_memory_pool_.get()))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(
+         args, immutable_state_, &kernel_stats_, planned_memory_pool_.get(),
+         use_work_stealing_, GetPrioritiesForStep()))
         ->RunAsync(std::move(done));
   } else {
-    (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+    (new ExecutorState<SimplePropagatorState>(
+         args, immutable_state_, &kernel_stats_, planned_memory_pool_.get(),
+         use_work_stealing_, GetPrioritiesForStep()))
         ->RunAsync(std::move(done));
   }
 }
 
+std::shared_ptr<const NodePriorities>
+ExecutorImpl::ComputeCriticalPathPriorities() const {
+  const GraphView& gview = immutable_state_.graph_view();
+  const int32_t num_nodes = gview.num_nodes();
+  // Calls `fn` with the id of each successor of `item`, ignoring the back
+  // edges of loops.
+  auto for_each_successor = [](const NodeItem& item, const auto& fn) {
+    if (item.is_next_iteration) return;
+    for (const EdgeInfo& e : item.output_edges()) fn(e.dst_id);
+    for (const ControlEdgeInfo& e : item.output_control_edges()) fn(e.dst_id);
+  };
+
+  // Orders the nodes topologically.
+  std::vector<int32_t> num_pending(num_nodes, 0);
+  for (int32_t i = 0; i < num_nodes; ++i) {
+    if (const NodeItem* item = gview.node(i)) {
+      for_each_successor(*item, [&](int dst_id) { ++num_pending[dst_id]; });
+    }
+  }
+  std::vector<int32_t> order;
+  order.reserve(num_nodes);
+  for (int32_t i = 0; i < num_nodes; ++i) {
+    if (gview.node(i) != nullptr && num_pending[i] == 0) order.push_back(i);
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    for_each_successor(*gview.node(order[i]), [&](int dst_id) {
+      if (--num_pending[dst_id] == 0) order.push_back(dst_id);
+    });
+  }
+
+  auto priorities = std::make_shared<NodePriorities>(num_nodes, 0);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    const NodeItem& item = *gview.node(*it);
+    uint64 successor_priority = 0;
+    for_each_successor(item, [&](int dst_id) {
+      successor_priority = std::max(successor_priority, (*priorities)[dst_id]);
+    });
+    (*priorities)[*it] = kernel_stats_.CostEstimate(item) + successor_priority;
+  }
+  return priorities;
+}
+
+std::shared_ptr<const NodePriorities> ExecutorImpl::GetPrioritiesForStep() {
+  if (!use_critical_path_priorities_) return nullptr;
+  const int64_t step = num_steps_.fetch_add(1, std::memory_order_relaxed);
+  if (step > 0 && step % kPriorityRefreshSteps == 0) {
+    std::shared_ptr<const NodePriorities> priorities =
+        ComputeCriticalPathPriorities();
+    mutex_lock l(priorities_mu_);
+    priorities_ = priorities;
+    return priorities;
+  }
+  tf_shared_lock l(priorities_mu_);
+  return priorities_;
+}
+
 }  // namespace
 
 Status NewLocalExecutor(const LocalExecutorParams& params, const Graph& graph,
@@ -1426,6 +1839,59 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor, which differs from the default
+// executor only in how it dispatches ready nodes: each step runs at most
+// `port::MaxParallelism()` workers, which share the nodes that are not run
+// inline (see `ExecutorState::SharedReadyQueue`). This saves a closure and a
+// thread pool handoff per node in graphs with many cheap kernels, at the risk
+// of delaying other nodes of a step while all its workers run kernels that
+// block.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl =
+          std::make_unique<ExecutorImpl>(params, /*use_work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return OkStatus();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
+// Registers the "CRITICAL_PATH" executor, a "WORK_STEALING" executor whose
+// workers take the ready nodes on the longest remaining path through the graph
+// first, so that a critical chain of kernels does not wait behind kernels off
+// the critical path. Path lengths are estimated from the kernel cost estimates
+// of the executor, and are periodically updated as they are refined.
+class CriticalPathExecutorRegistrar {
+ public:
+  CriticalPathExecutorRegistrar() {
+    ExecutorFactory::Register("CRITICAL_PATH", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl = std::make_unique<ExecutorImpl>(
+          params, /*use_work_stealing=*/true,
+          /*use_critical_path_priorities=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return OkStatus();
+    }
+  };
+};
+static CriticalPathExecutorRegistrar critical_path_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
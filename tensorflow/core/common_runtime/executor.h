@@ -34,6 +34,7 @@ limitations under the License.
 
 namespace tensorflow {
 
+class RequestCost;
 class StepStatsCollector;
 
 // Executor runs a graph computation.
@@ -107,6 +108,9 @@ class Executor {
     // The deadline for the kernel to complete by. Empty if unspecified.
     absl::optional<absl::Time> deadline;
     absl::optional<ManagedStackTrace> stack_trace = absl::nullopt;
+    // If not null, the costs of the step are added to it when it is done. See
+    // cost_constants.h for the cost types.
+    RequestCost* request_cost = nullptr;
 
     // If true, calls Sync() on the device.
     bool sync_on_finish = false;
@@ -23,12 +23,15 @@ limitations under the License.
 #include "tensorflow/cc/ops/control_flow_ops_internal.h"
 #include "tensorflow/cc/ops/function_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/common_runtime/cost_constants.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/request_cost.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/op.h"
@@ -82,18 +85,23 @@ class ExecutorTest : public ::testing::Test {
     };
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    std::unique_ptr<Executor> executor;
+    TF_CHECK_OK(NewExecutor(executor_type_, params, *graph, &executor));
+    exec_ = executor.release();
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
-  Status Run(Rendezvous* rendez) {
+  Status Run(Rendezvous* rendez, RequestCost* request_cost = nullptr) {
     Executor::Args args;
     args.rendezvous = rendez;
     args.stats_collector = &step_stats_collector_;
     args.runner = runner_;
+    args.request_cost = request_cost;
     return exec_->Run(args);
   }
 
+  // The type of executor created by `Create`.
+  string executor_type_;
   thread::ThreadPool* thread_pool_ = nullptr;
   std::unique_ptr<Device> device_;
   Executor* exec_ = nullptr;
@@ -175,6 +183,35 @@ TEST_F(ExecutorTest, SimpleAdd) {
   EXPECT_EQ(2.0, V(out));  // out = 1.0 + 1.0 = 2.0
 }
 
+TEST_F(ExecutorTest, RecordsRequestCost) {
+  // c = a + b
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Recv(g.get(), "b", "float", ALICE, 1, BOB);
+  auto tmp = test::graph::Add(g.get(), in0, in1);
+  test::graph::Send(g.get(), tmp, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "b"), args, V(1.0),
+                             false));
+  RequestCost request_cost;
+  TF_ASSERT_OK(Run(rendez_, &request_cost));
+
+  const auto costs = request_cost.GetCosts();
+  ASSERT_TRUE(costs.contains(kExecutorCpuTimeCostName));
+  EXPECT_GE(costs.at(kExecutorCpuTimeCostName), absl::ZeroDuration());
+  ASSERT_TRUE(costs.contains(kRendezvousWaitCostName));
+  EXPECT_GE(costs.at(kRendezvousWaitCostName), absl::ZeroDuration());
+  // The device is a CPU.
+  EXPECT_FALSE(costs.contains(kDeviceTimeCostName));
+  // Two Recvs and an Add, each outputting a float.
+  const auto metrics = request_cost.GetMetrics();
+  ASSERT_TRUE(metrics.contains(kOutputBytesMetricName));
+  EXPECT_EQ(metrics.at(kOutputBytesMetricName), 3 * sizeof(float));
+}
+
 TEST_F(ExecutorTest, SelfAdd) {
   // v0 <- a
   // v1 = v0 + v0
@@ -430,10 +467,193 @@ TEST_F(ExecutorTest, NoInputTensors) {
   TF_ASSERT_OK(Run(rendez_));
 }
 
+class WorkStealingExecutorTest : public ExecutorTest {
+ protected:
+  WorkStealingExecutorTest() { executor_type_ = "WORK_STEALING"; }
+};
+
+TEST_F(WorkStealingExecutorTest, SelfAdd) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto v = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  for (int i = 1; i <= 10; ++i) {
+    v = test::graph::Add(g.get(), v, v);
+  }
+  test::graph::Send(g.get(), v, "b", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(1024.0, V(out));
+}
+
+TEST_F(WorkStealingExecutorTest, RandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    // As the cost estimates of the kernels get updated, later runs inline
+    // more of them.
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(
+        rendez->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+    TF_ASSERT_OK(Run(rendez));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(
+        rendez->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+    rendez->Unref();
+  }
+}
+
+#ifndef THREAD_SANITIZER
+TEST_F(WorkStealingExecutorTest, ConcurrentAddAssign) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildConcurrentAddAssign(g.get());
+  Create(std::move(g));
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
+#endif
+
+TEST_F(WorkStealingExecutorTest, SimpleSwitchDead) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g.get(), VB(true));
+  auto tmp = test::graph::Switch(g.get(), in0, in1);
+  test::graph::Send(g.get(), tmp, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
+TEST_F(WorkStealingExecutorTest, RecvInvalidDtype) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  // An input vector of type float of size 1.
+  auto one = test::graph::Recv(g.get(), "one", "float", ALICE, 1, BOB);
+  // A floating point variable vector of size 1.
+  auto var = test::graph::Var(g.get(), DT_FLOAT, TensorShape({1}));
+  // Initialize the variable with input.
+  auto init = test::graph::Assign(g.get(), var, one);
+  // Output
+  auto* two = test::graph::Send(g.get(), var, "two", BOB, 1, ALICE);
+  g->AddControlEdge(init, two);  // Ensures run after init.
+  Create(std::move(g));
+  Rendezvous* rendez = NewLocalRendezvous();
+  // Send a double instead of float.
+  TF_ASSERT_OK(rendez->Send(Key(ALICE, 1, BOB, "one"), Rendezvous::Args(),
+                            VD(1.0), false));
+  // Fails due to invalid dtype.
+  EXPECT_TRUE(errors::IsInternal(Run(rendez)));
+  rendez->Unref();
+}
+
+TEST_F(WorkStealingExecutorTest, NoInputTensors) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  test::graph::Constant(g.get(), V(1.0));
+  Create(std::move(g));
+  TF_ASSERT_OK(Run(rendez_));
+}
+
+class CriticalPathExecutorTest : public ExecutorTest {
+ protected:
+  CriticalPathExecutorTest() { executor_type_ = "CRITICAL_PATH"; }
+};
+
+TEST_F(CriticalPathExecutorTest, FanOutWithLongChain) {
+  // One long chain of kernels next to many short branches, run for enough
+  // steps to refresh the priorities from the measured kernel costs.
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto chain = in;
+  for (int i = 0; i < 32; ++i) {
+    chain = test::graph::Add(g.get(), chain, in);
+  }
+  auto sum = chain;
+  for (int i = 0; i < 64; ++i) {
+    sum = test::graph::Add(g.get(), sum, test::graph::Add(g.get(), in, in));
+  }
+  test::graph::Send(g.get(), sum, "b", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 200; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(
+        rendez->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+    TF_ASSERT_OK(Run(rendez));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(
+        rendez->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+    EXPECT_EQ(33.0 + 64 * 2.0, V(out));
+    rendez->Unref();
+  }
+}
+
+TEST_F(CriticalPathExecutorTest, RandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(
+        rendez->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+    TF_ASSERT_OK(Run(rendez));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(
+        rendez->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+    rendez->Unref();
+  }
+}
+
+TEST_F(CriticalPathExecutorTest, SimpleSwitchDead) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g.get(), VB(true));
+  auto tmp = test::graph::Switch(g.get(), in0, in1);
+  test::graph::Send(g.get(), tmp, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(::testing::benchmark::State& state) {
+static void BenchmarkExecutor(::testing::benchmark::State& state,
+                              const char* executor_type) {
   const int width = state.range(0);
   const int depth = state.range(1);
 
@@ -467,22 +687,44 @@ static void BM_executor(::testing::benchmark::State& state) {
   }
 
   FixupSourceAndSinkEdges(g);
-  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
 
   state.SetLabel(strings::StrCat("Nodes = ", cur));
   state.SetItemsProcessed(cur * static_cast<int64_t>(state.iterations()));
 }
 
+static void BM_executor(::testing::benchmark::State& state) {
+  BenchmarkExecutor(state, /*executor_type=*/"");
+}
+
+static void BM_work_stealing_executor(::testing::benchmark::State& state) {
+  BenchmarkExecutor(state, /*executor_type=*/"WORK_STEALING");
+}
+
+static void BM_critical_path_executor(::testing::benchmark::State& state) {
+  BenchmarkExecutor(state, /*executor_type=*/"CRITICAL_PATH");
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(32, 8192);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(16, 1024);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(32, 8192);
 
 // Short fat graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 16);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_critical_path_executor)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_critical_path_executor)->UseRealTime()->ArgPair(8192, 32);
 
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(1024, 1024);
 
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
@@ -402,7 +402,7 @@ class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
                        OpKernel**)>
       create_kernel_;
 
-  mutable mutex mu_;
+  mutable profiled_mutex mu_{"FunctionLibraryRuntime"};
 
   int next_handle_ TF_GUARDED_BY(mu_);
 
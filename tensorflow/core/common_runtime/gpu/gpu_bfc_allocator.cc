@@ -18,6 +18,7 @@ limitations under the License.
 #include <utility>
 
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -75,6 +76,16 @@ bool GetGarbageCollectionValue() {
       << " Using the default value \"true\".";
   return true;
 }
+
+double GetCompactionThresholdValue(double orig_value) {
+  float threshold;
+  Status s = ReadFloatFromEnvVar("TF_GPU_BFC_COMPACTION_THRESHOLD",
+                                 static_cast<float>(orig_value), &threshold);
+  if (!s.ok()) {
+    LOG(ERROR) << s.error_message();
+  }
+  return threshold;
+}
 }  // anonymous namespace
 
 GPUBFCAllocator::GPUBFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
@@ -90,6 +101,9 @@ GPUBFCAllocator::GPUBFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
           o.garbage_collection = GetGarbageCollectionValue();
         }
         o.fragmentation_fraction = opts.fragmentation_fraction;
+        o.compaction_fragmentation_threshold = GetCompactionThresholdValue(
+            opts.compaction_fragmentation_threshold);
+        o.synchronize_before_compaction = opts.synchronize_before_compaction;
         return o;
       }()) {}
 
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_BFC_ALLOCATOR_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_BFC_ALLOCATOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -50,6 +51,16 @@ class GPUBFCAllocator : public BFCAllocator {
 
     double fragmentation_fraction = 0;
     bool allow_retry_on_failure = true;
+
+    // Overridden by TF_GPU_BFC_COMPACTION_THRESHOLD if that envvar is set.
+    // With the GpuVirtualMemAllocator as the sub-allocator, compaction unmaps
+    // the free tail of the virtual address range, and later allocations map
+    // fresh physical memory behind it.
+    double compaction_fragmentation_threshold = 0;
+
+    // Waits for all work enqueued on the device, see
+    // BFCAllocator::Options::synchronize_before_compaction.
+    std::function<bool()> synchronize_before_compaction;
   };
 
   GPUBFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
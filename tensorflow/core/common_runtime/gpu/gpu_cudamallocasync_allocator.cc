@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+
 #include "absl/types/optional.h"
 #ifdef GOOGLE_CUDA
 #include "third_party/gpus/cuda/include/cuda.h"
@@ -30,6 +32,10 @@ limitations under the License.
 
 namespace tensorflow {
 
+// Number of deallocations between two checks of the free device memory when
+// TF_CUDA_MALLOC_ASYNC_TRIM_FREE_FRACTION is set.
+static constexpr int64_t kTrimCheckInterval = 256;
+
 #if GOOGLE_CUDA
 static std::string GetCudaErrorMessage(CUresult result) {
   const char* error;
@@ -107,6 +113,7 @@ GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
   // Stop clang from complaining about unused private fields when
   // TF_CUDA_MALLOC_ASYNC_SUPPORTED is not defined.
   (void)reserve_memory_;
+  (void)trim_free_fraction_;
 
 #if TF_CUDA_MALLOC_ASYNC_SUPPORTED
   stream_exec_ = DeviceIdUtil::ExecutorForPlatformDeviceId(GPUMachineManager(),
@@ -183,6 +190,9 @@ GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
     stats_->bytes_limit = static_cast<int64_t>(pool_size);
   }  // If not set, it means we do not compute stats.
 
+  TF_CHECK_OK(ReadFloatFromEnvVar("TF_CUDA_MALLOC_ASYNC_TRIM_FREE_FRACTION",
+                                  /*default_val=*/0, &trim_free_fraction_));
+
   // If in TF_DETERMINISTIC_ALLOCATOR is set, then make the allocator behave
   // determistically.
   bool deterministic = false;
@@ -321,6 +331,37 @@ void* GpuCudaMallocAsyncAllocator::AllocateRaw(size_t alignment,
 void GpuCudaMallocAsyncAllocator::DeallocateRaw(void* ptr) {
 #if TF_CUDA_MALLOC_ASYNC_SUPPORTED
   if (ptr == nullptr) return;
+  absl::InlinedVector<CUstream, 2> stream_uses;
+  {
+    mutex_lock lock(lock_);
+    auto it = stream_uses_.find(ptr);
+    if (it != stream_uses_.end()) {
+      stream_uses = std::move(it->second);
+      stream_uses_.erase(it);
+    }
+  }
+  if (!stream_uses.empty()) {
+    // Order the free after the work already enqueued on the other streams.
+    se::cuda::ScopedActivateExecutorContext scoped_activation{stream_exec_};
+    for (CUstream stream : stream_uses) {
+      CUevent event;
+      CUresult result = cuEventCreate(&event, CU_EVENT_DISABLE_TIMING);
+      if (result == CUDA_SUCCESS) {
+        result = cuEventRecord(event, stream);
+        if (result == CUDA_SUCCESS) {
+          result = cuStreamWaitEvent(cuda_stream_, event, 0);
+        }
+        cuEventDestroy(event);
+      }
+      if (result != CUDA_SUCCESS) {
+        LOG(ERROR) << Name() << " failed to order the free of " << ptr
+                   << " after its uses on stream " << stream << ": "
+                   << GetCudaErrorMessage(result)
+                   << ". Synchronizing the stream instead.";
+        cuStreamSynchronize(stream);
+      }
+    }
+  }
   if (auto result = cuMemFreeAsync(reinterpret_cast<const CUdeviceptr&>(ptr),
                                    cuda_stream_)) {
     if (result == CUDA_ERROR_DEINITIALIZED) {
@@ -350,9 +391,56 @@ void GpuCudaMallocAsyncAllocator::DeallocateRaw(void* ptr) {
   }
 
   VLOG(10) << Name() << " Freed ptr: " << ptr;
+
+  if (trim_free_fraction_ > 0 &&
+      ++deallocs_since_trim_check_ % kTrimCheckInterval == 0) {
+    MaybeTrimPool();
+  }
+#endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
+}
+
+void GpuCudaMallocAsyncAllocator::RecordStreamUse(void* ptr, void* stream) {
+#if TF_CUDA_MALLOC_ASYNC_SUPPORTED
+  if (ptr == nullptr || stream == nullptr) return;
+  CUstream cu_stream = *(reinterpret_cast<CUstream*>(stream));
+  if (cu_stream == cuda_stream_) return;
+  mutex_lock lock(lock_);
+  auto& streams = stream_uses_[ptr];
+  if (std::find(streams.begin(), streams.end(), cu_stream) == streams.end()) {
+    streams.push_back(cu_stream);
+  }
 #endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
 }
 
+#if TF_CUDA_MALLOC_ASYNC_SUPPORTED
+void GpuCudaMallocAsyncAllocator::MaybeTrimPool() {
+  se::cuda::ScopedActivateExecutorContext scoped_activation{stream_exec_};
+  size_t free, total;
+  if (auto result = cuMemGetInfo(&free, &total)) {
+    VLOG(1) << Name()
+            << " cuMemGetInfo failed: " << GetCudaErrorMessage(result);
+    return;
+  }
+  if (free >= trim_free_fraction_ * total) return;
+
+  size_t keep = 0;
+#if CUDA_VERSION >= 11030
+  cuuint64_t mem_used_current = 0;
+  if (cuMemPoolGetAttribute(pool_, CU_MEMPOOL_ATTR_USED_MEM_CURRENT,
+                            &mem_used_current) == CUDA_SUCCESS) {
+    keep = mem_used_current;
+  }
+#endif
+  if (auto result = cuMemPoolTrimTo(pool_, keep)) {
+    LOG(ERROR) << Name() << " cuMemPoolTrimTo failed: "
+               << GetCudaErrorMessage(result);
+    return;
+  }
+  VLOG(1) << Name() << " trimmed the pool to " << keep << " bytes as only "
+          << free << " of " << total << " bytes of device memory were free";
+}
+#endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
+
 bool GpuCudaMallocAsyncAllocator::TracksAllocationSizes() const {
   return static_cast<bool>(stats_);
 }
@@ -372,7 +460,20 @@ size_t GpuCudaMallocAsyncAllocator::AllocatedSize(const void* ptr) const {
 absl::optional<AllocatorStats> GpuCudaMallocAsyncAllocator::GetStats() {
   if (!stats_) return absl::nullopt;
   mutex_lock l(lock_);
-  return *stats_;
+  AllocatorStats stats = *stats_;
+#if TF_CUDA_MALLOC_ASYNC_SUPPORTED && CUDA_VERSION >= 11030
+  cuuint64_t mem_reserved_current;
+  if (cuMemPoolGetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_CURRENT,
+                            &mem_reserved_current) == CUDA_SUCCESS) {
+    stats.bytes_reserved = static_cast<int64_t>(mem_reserved_current);
+  }
+  cuuint64_t mem_reserved_high;
+  if (cuMemPoolGetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH,
+                            &mem_reserved_high) == CUDA_SUCCESS) {
+    stats.peak_bytes_reserved = static_cast<int64_t>(mem_reserved_high);
+  }
+#endif
+  return stats;
 }
 
 bool GpuCudaMallocAsyncAllocator::ClearStats() {
@@ -381,6 +482,11 @@ bool GpuCudaMallocAsyncAllocator::ClearStats() {
   stats_->num_allocs = 0;
   stats_->peak_bytes_in_use = stats_->bytes_in_use;
   stats_->largest_alloc_size = 0;
+#if TF_CUDA_MALLOC_ASYNC_SUPPORTED && CUDA_VERSION >= 11030
+  cuuint64_t zero = 0;
+  cuMemPoolSetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH, &zero);
+  cuMemPoolSetAttribute(pool_, CU_MEMPOOL_ATTR_USED_MEM_HIGH, &zero);
+#endif
   return true;
 }
 
@@ -23,6 +23,7 @@ limitations under the License.
 #endif  // GOOGLE_CUDA
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_id.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/platform/macros.h"
@@ -62,6 +63,15 @@ namespace tensorflow {
 // Here, the pool_size isn't the absolute max as for [Gpu]BFCAllocator.
 // The pool can grow above that up to the total GPU memory.  But the
 // driver can return the excess memory to other processes.
+//
+// Memory kept in the pool below pool_size can also be given back when the
+// GPU runs low: set `TF_CUDA_MALLOC_ASYNC_TRIM_FREE_FRACTION=f` and, every
+// few hundred deallocations, the pool is trimmed down to the bytes in use
+// if less than `f` of the device memory is free.
+//
+// GetStats() reports the pool's reserved bytes in `bytes_reserved` and
+// `peak_bytes_reserved` (CUDA 11.3+); `bytes_reserved - bytes_in_use` is
+// memory cached in the pool but not handed out.
 class GpuCudaMallocAsyncAllocator : public Allocator {
  public:
   explicit GpuCudaMallocAsyncAllocator(PlatformDeviceId platform_device_id,
@@ -85,6 +95,13 @@ class GpuCudaMallocAsyncAllocator : public Allocator {
 
   void SetStreamAndPreallocateMemory(void* stream) override;
 
+  // Records that `ptr`, allocated by this allocator, is used by work enqueued
+  // on `stream` (a CUstream*, as for SetStreamAndPreallocateMemory) other than
+  // the compute stream.  When `ptr` is deallocated, its stream-ordered free
+  // is made to wait for the work enqueued on `stream` up to that point, so the
+  // memory isn't handed out again while that work may still access it.
+  void RecordStreamUse(void* ptr, void* stream);
+
   // With the right VLOG set, it prints:
   // - the number of ptr currently allocated per size (histogram).
   // - each ptr value and its size.
@@ -112,8 +129,22 @@ class GpuCudaMallocAsyncAllocator : public Allocator {
   // If null, then the instanciation failed and the first allocation
   // will return an error.
   CUmemoryPool pool_;
+
+  // Trims the pool down to the memory in use if less than
+  // `trim_free_fraction_` of the device memory is free.
+  void MaybeTrimPool();
+
+  // Streams other than `cuda_stream_` recorded by RecordStreamUse for live
+  // allocations.
+  absl::flat_hash_map<const void*, absl::InlinedVector<CUstream, 2>>
+      stream_uses_ TF_GUARDED_BY(lock_);
 #endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
 
+  // Fraction of free device memory below which the pool is trimmed.  0
+  // disables trimming.
+  float trim_free_fraction_ = 0;
+  std::atomic<int64_t> deallocs_since_trim_check_{0};
+
   // Just a counter for the number of time this class is instantiated.
   // Only useful for tests.
   static std::atomic<int> number_instantiated_;
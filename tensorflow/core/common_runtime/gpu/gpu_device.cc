@@ -451,6 +451,16 @@ Status BaseGPUDevice::Init(const SessionOptions& options) {
   attr.set_on_host(true);
   attr.set_gpu_compatible(true);
   Allocator* host_memory_allocator = GetAllocator(attr);
+  if (host_memory_allocator != nullptr) {
+    int64_t staging_pool_bytes;
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_GPU_HOST_STAGING_POOL_BYTES",
+                                           int64_t{256} << 20,
+                                           &staging_pool_bytes));
+    if (staging_pool_bytes > 0) {
+      staging_pool_ = std::make_unique<PinnedStagingPool>(
+          host_memory_allocator, staging_pool_bytes);
+    }
+  }
 
   device_context_ =
       new GPUDeviceContext(0, stream_->compute,
@@ -458,7 +468,8 @@ Status BaseGPUDevice::Init(const SessionOptions& options) {
                            stream_->nccl,
 #endif
                            stream_->host_to_device, stream_->device_to_host,
-                           stream_->device_to_device, host_memory_allocator);
+                           stream_->device_to_device, host_memory_allocator,
+                           staging_pool_.get());
 
   em_ = EventMgrFactory::Singleton()->GetEventMgr(executor_,
                                                   options.config.gpu_options());
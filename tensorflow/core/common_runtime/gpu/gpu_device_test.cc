@@ -21,7 +21,10 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/gpu/gpu_cudamallocasync_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_init.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
+#include "tensorflow/core/common_runtime/gpu/gpu_util.h"
+#include "tensorflow/core/common_runtime/gpu_device_context.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/random.h"
@@ -58,6 +61,16 @@ void ExpectErrorMessageSubstr(const Status& s, StringPiece substr) {
       << s << ", expected substring " << substr;
 }
 
+// A host memory allocator whose allocations always fail.
+class FailingAllocator : public Allocator {
+ public:
+  string Name() override { return "failing"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return nullptr;
+  }
+  void DeallocateRaw(void* ptr) override {}
+};
+
 }  // namespace
 
 class GPUDeviceTest : public ::testing::Test {
@@ -202,6 +215,37 @@ TEST_F(GPUDeviceTest, DISABLED_ON_GPU_ROCM(CudaMallocAsyncPreallocate)) {
   EXPECT_EQ(status.code(), error::OK);
 }
 
+TEST_F(GPUDeviceTest, DISABLED_ON_GPU_ROCM(CudaMallocAsyncRecordStreamUse)) {
+  SessionOptions opts = MakeSessionOptions("0", 0, 1, {}, {}, {},
+                                           /*use_cuda_malloc_async=*/true);
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory("GPU")->CreateDevices(
+      opts, kDeviceNamePrefix, &devices));
+  EXPECT_THAT(devices, SizeIs(1));
+  auto* device_info = devices[0]->tensorflow_accelerator_device_info();
+  ASSERT_NE(device_info, nullptr);
+
+  AllocatorAttributes allocator_attributes = AllocatorAttributes();
+  allocator_attributes.set_gpu_compatible(true);
+  auto* allocator = dynamic_cast<GpuCudaMallocAsyncAllocator*>(
+      devices[0]->GetAllocator(allocator_attributes));
+  ASSERT_NE(allocator, nullptr);
+
+  se::Stream other_stream(device_info->stream->parent());
+  other_stream.Init();
+  void* ptr = allocator->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+  ASSERT_NE(ptr, nullptr);
+  allocator->RecordStreamUse(
+      ptr, other_stream.implementation()->GpuStreamMemberHack());
+  allocator->DeallocateRaw(ptr);
+  TF_ASSERT_OK(device_info->stream->BlockHostUntilDone());
+
+  absl::optional<AllocatorStats> stats = allocator->GetStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_GE(stats->peak_bytes_reserved, stats->bytes_reserved);
+}
+
 TEST_F(GPUDeviceTest, FailedToParseVisibleDeviceList) {
   SessionOptions opts = MakeSessionOptions("0,abc");
   std::vector<std::unique_ptr<Device>> devices;
@@ -555,6 +599,85 @@ TEST_F(GPUDeviceTest, CopyTensorInSameDevice) {
   }
 }
 
+// Copies of pageable host memory larger than 4MiB are staged in chunks.
+TEST_F(GPUDeviceTest, ChunkedStagingCopy) {
+  SessionOptions opts = MakeSessionOptions("0");
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory("GPU")->CreateDevices(
+      opts, kDeviceNamePrefix, &devices));
+  Device* device = devices[0].get();
+  DeviceContext* device_context =
+      device->tensorflow_accelerator_device_info()->default_context;
+  Allocator* allocator = device->GetAllocator(AllocatorAttributes());
+
+  // Three chunks, the last of which is not a multiple of the chunk size.
+  constexpr int kNumElements = (10 << 20) / sizeof(float) + 3;
+  Tensor cpu_tensor(cpu_allocator(), DT_FLOAT, TensorShape({kNumElements}));
+  auto input = cpu_tensor.tensor<float, 1>();
+  for (int i = 0; i < kNumElements; ++i) {
+    input(i) = i;
+  }
+  Tensor gpu_tensor(allocator, DT_FLOAT, TensorShape({kNumElements}));
+  CopyCPUToGPU(&cpu_tensor, &gpu_tensor, device, device_context);
+
+  Tensor output_cpu_tensor(cpu_allocator(), DT_FLOAT,
+                           TensorShape({kNumElements}));
+  InitCPUTensor(&output_cpu_tensor, kNumElements, -1);
+  CopyGPUToCPU(&gpu_tensor, &output_cpu_tensor, device, device_context);
+  auto output = output_cpu_tensor.tensor<float, 1>();
+  for (int i = 0; i < kNumElements; ++i) {
+    ASSERT_EQ(input(i), output(i)) << " for index " << i;
+  }
+}
+
+TEST_F(GPUDeviceTest, ChunkedStagingCopyFailsWithoutStagingBuffers) {
+  SessionOptions opts = MakeSessionOptions("0");
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory("GPU")->CreateDevices(
+      opts, kDeviceNamePrefix, &devices));
+  Device* device = devices[0].get();
+  auto* default_context = static_cast<GPUDeviceContext*>(
+      device->tensorflow_accelerator_device_info()->default_context);
+  FailingAllocator failing_allocator;
+  auto* device_context = new GPUDeviceContext(
+      0, default_context->stream(),
+#if TENSORFLOW_USE_ROCM
+      default_context->nccl_stream(),
+#endif
+      default_context->host_to_device_stream(),
+      default_context->device_to_host_stream(),
+      {default_context->device_to_device_stream(0)}, &failing_allocator);
+  core::ScopedUnref unref(device_context);
+  Allocator* allocator = device->GetAllocator(AllocatorAttributes());
+
+  constexpr int kNumElements = (10 << 20) / sizeof(float);
+  Tensor cpu_tensor(cpu_allocator(), DT_FLOAT, TensorShape({kNumElements}));
+  InitCPUTensor(&cpu_tensor, kNumElements, 1);
+  Tensor gpu_tensor(allocator, DT_FLOAT, TensorShape({kNumElements}));
+
+  Notification to_device_done;
+  Status to_device_status;
+  GPUUtil::CopyCPUTensorToGPU(
+      &cpu_tensor, device_context, device, &gpu_tensor,
+      [&](const Status& s) {
+        to_device_status = s;
+        to_device_done.Notify();
+      },
+      /*sync_dst_compute=*/true);
+  to_device_done.WaitForNotification();
+  EXPECT_EQ(to_device_status.code(), error::RESOURCE_EXHAUSTED);
+
+  Notification to_host_done;
+  Status to_host_status;
+  GPUUtil::CopyGPUTensorToCPU(device, device_context, &gpu_tensor,
+                              &cpu_tensor, [&](const Status& s) {
+                                to_host_status = s;
+                                to_host_done.Notify();
+                              });
+  to_host_done.WaitForNotification();
+  EXPECT_EQ(to_host_status.code(), error::RESOURCE_EXHAUSTED);
+}
+
 TEST_F(GPUDeviceTest, DeviceDetails) {
   DeviceFactory* factory = DeviceFactory::GetFactory("GPU");
   std::vector<string> devices;
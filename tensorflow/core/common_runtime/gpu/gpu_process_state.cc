@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -183,6 +184,10 @@ Allocator* GPUProcessState::GetGPUAllocator(
         CreateSubAllocator(options, platform_device_id, gpu_visitors_[bus_id],
                            total_bytes, peer_gpu_ids);
     SubAllocator* sub_allocator_ptr = sub_allocator.get();
+    se::StreamExecutor* executor =
+        DeviceIdUtil::ExecutorForPlatformDeviceId(GPUMachineManager(),
+                                                  platform_device_id)
+            .ValueOrDie();
 
     auto gpu_bfc_allocator = absl::make_unique<GPUBFCAllocator>(
         std::move(sub_allocator), total_bytes,
@@ -193,6 +198,9 @@ Allocator* GPUProcessState::GetGPUAllocator(
               !options.experimental().disallow_retry_on_allocation_failure();
           o.fragmentation_fraction =
               options.experimental().internal_fragmentation_fraction();
+          o.synchronize_before_compaction = [executor]() {
+            return executor->SynchronizeAllActivity();
+          };
           return o;
         }());
     Allocator* gpu_allocator = gpu_bfc_allocator.get();
@@ -356,6 +364,14 @@ Allocator* GPUProcessState::GetGpuHostAllocator(int numa_node) {
 
     BFCAllocator::Options allocator_opts;
     allocator_opts.allow_growth = true;
+    int64_t thread_cache_max_chunk_size = 0;
+    status = ReadInt64FromEnvVar("TF_GPU_HOST_BFC_THREAD_CACHE_MAX_CHUNK_SIZE",
+                                 0, &thread_cache_max_chunk_size);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetGpuHostAllocator: " << status.error_message();
+    }
+    allocator_opts.thread_cache_max_chunk_size =
+        std::max<int64_t>(thread_cache_max_chunk_size, 0);
     Allocator* allocator =
         new BFCAllocator(absl::WrapUnique(sub_allocator), gpu_host_mem_limit,
                          /*name=*/"gpu_host_bfc", allocator_opts);
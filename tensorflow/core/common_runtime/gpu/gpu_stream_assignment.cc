@@ -0,0 +1,123 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/gpu_stream_assignment.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+Status AssignGpuStreams(const Graph& graph,
+                        const GpuStreamAssignmentOptions& options,
+                        GpuStreamAssignment* assignment) {
+  if (options.num_streams < 1) {
+    return errors::InvalidArgument("num_streams must be at least 1, got ",
+                                   options.num_streams);
+  }
+  if (options.cross_stream_cost < 0) {
+    return errors::InvalidArgument("cross_stream_cost must be non-negative, ",
+                                   "got ", options.cross_stream_cost);
+  }
+  const int num_streams = options.num_streams;
+  std::vector<int>& node_to_stream = assignment->node_to_stream;
+  node_to_stream.assign(graph.num_node_ids(), -1);
+  assignment->cross_stream_edges.clear();
+
+  // The estimated finish time of each assigned node.
+  std::vector<int64_t> finish(graph.num_node_ids(), 0);
+  // The time at which each stream finishes the nodes assigned to it so far,
+  // and the total cost of those nodes.
+  std::vector<int64_t> stream_free(num_streams, 0);
+  std::vector<int64_t> stream_busy(num_streams, 0);
+  int64_t makespan = 0;
+
+  // Sorting by name makes the order, and therefore the assignment,
+  // deterministic.
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order, NodeComparatorName());
+  std::vector<int> candidates;
+  for (const Node* node : order) {
+    if (!node->IsOp()) continue;
+    // The earliest time at which `node` can start on `stream`. Inputs that
+    // are not assigned yet, i.e. the source node and the back edges of
+    // loops, do not delay it.
+    auto start_on = [&](int stream) {
+      int64_t start = stream_free[stream];
+      for (const Edge* edge : node->in_edges()) {
+        const int src_stream = node_to_stream[edge->src()->id()];
+        if (src_stream < 0) continue;
+        start = std::max(start, finish[edge->src()->id()] +
+                                    (src_stream == stream
+                                         ? 0
+                                         : options.cross_stream_cost));
+      }
+      return start;
+    };
+    // Try the streams of the inputs first, so that they win ties.
+    candidates.clear();
+    for (const Edge* edge : node->in_edges()) {
+      const int src_stream = node_to_stream[edge->src()->id()];
+      if (src_stream >= 0) candidates.push_back(src_stream);
+    }
+    for (int stream = 0; stream < num_streams; ++stream) {
+      candidates.push_back(stream);
+    }
+    int best_stream = candidates.front();
+    int64_t best_start = start_on(best_stream);
+    for (int stream : candidates) {
+      const int64_t start = start_on(stream);
+      if (start < best_start) {
+        best_stream = stream;
+        best_start = start;
+      }
+    }
+
+    const int64_t cost =
+        options.cost_fn ? std::max<int64_t>(0, options.cost_fn(node)) : 1;
+    node_to_stream[node->id()] = best_stream;
+    finish[node->id()] = best_start + cost;
+    stream_free[best_stream] = best_start + cost;
+    stream_busy[best_stream] += cost;
+    makespan = std::max(makespan, best_start + cost);
+  }
+
+  for (const Edge* edge : graph.edges()) {
+    const int src_stream = node_to_stream[edge->src()->id()];
+    const int dst_stream = node_to_stream[edge->dst()->id()];
+    if (src_stream >= 0 && dst_stream >= 0 && src_stream != dst_stream) {
+      assignment->cross_stream_edges.push_back(edge);
+    }
+  }
+
+  assignment->stream_utilization.assign(num_streams, 0.0);
+  for (int stream = 0; stream < num_streams; ++stream) {
+    if (makespan > 0) {
+      assignment->stream_utilization[stream] =
+          static_cast<double>(stream_busy[stream]) / makespan;
+    }
+    VLOG(1) << "GPU stream " << stream << ": estimated utilization "
+            << assignment->stream_utilization[stream];
+  }
+  VLOG(1) << "Assigned " << graph.num_op_nodes() << " nodes to "
+          << num_streams << " GPU streams with "
+          << assignment->cross_stream_edges.size() << " cross-stream edges";
+  return OkStatus();
+}
+
+}  // namespace tensorflow
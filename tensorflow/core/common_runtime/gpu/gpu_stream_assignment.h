@@ -0,0 +1,74 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_STREAM_ASSIGNMENT_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_STREAM_ASSIGNMENT_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+
+struct GpuStreamAssignmentOptions {
+  // The size of the pool of compute streams to assign nodes to.
+  int num_streams = 1;
+
+  // Returns the estimated cost of running a node, in any unit shared by all
+  // nodes, e.g. CostModel::TimeEstimate. When unset, every node costs 1.
+  std::function<int64_t(const Node*)> cost_fn;
+
+  // The estimated cost of making a stream wait for an event recorded on
+  // another stream, in the unit of `cost_fn`. Chains of dependent nodes stay
+  // on one stream unless another stream can start them earlier than that.
+  int64_t cross_stream_cost = 0;
+};
+
+struct GpuStreamAssignment {
+  // The stream of each op node, indexed by Node::id(). The source and sink
+  // nodes, ids of removed nodes and nodes not reachable from the source node
+  // get -1.
+  std::vector<int> node_to_stream;
+
+  // The data and control edges whose source and destination run on different
+  // streams. Before running the destination, its stream must wait for an
+  // event recorded on the source's stream after the source; no other
+  // synchronization between the streams is needed.
+  std::vector<const Edge*> cross_stream_edges;
+
+  // The estimated fraction of the schedule's length during which each stream
+  // is busy.
+  std::vector<double> stream_utilization;
+};
+
+// Assigns the op nodes of `graph` to a pool of compute streams, so that
+// independent branches of the graph can run concurrently while the nodes
+// along each dependency chain stay on the same stream.
+//
+// The assignment simulates a list schedule of the graph: nodes are visited in
+// topological order, and each one goes to the stream on which it would start
+// the earliest given the estimated finish times of its inputs. Ties go to the
+// stream of one of its inputs, which avoids a cross-stream event. The result
+// depends only on the graph and the options.
+Status AssignGpuStreams(const Graph& graph,
+                        const GpuStreamAssignmentOptions& options,
+                        GpuStreamAssignment* assignment);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_STREAM_ASSIGNMENT_H_
@@ -0,0 +1,128 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/gpu_stream_assignment.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class GpuStreamAssignmentTest : public ::testing::Test {
+ protected:
+  GpuStreamAssignmentTest() : graph_(OpRegistry::Global()) {}
+
+  // Adds a NoOp that runs after `inputs`.
+  Node* AddNode(const string& name, const std::vector<Node*>& inputs = {}) {
+    Node* node;
+    TF_CHECK_OK(NodeBuilder(name, "NoOp").Finalize(&graph_, &node));
+    for (Node* input : inputs) graph_.AddControlEdge(input, node);
+    return node;
+  }
+
+  int StreamOf(const Node* node) const {
+    return assignment_.node_to_stream[node->id()];
+  }
+
+  Status Assign(int num_streams, int64_t cross_stream_cost = 0) {
+    GpuStreamAssignmentOptions options;
+    options.num_streams = num_streams;
+    options.cross_stream_cost = cross_stream_cost;
+    FixupSourceAndSinkEdges(&graph_);
+    return AssignGpuStreams(graph_, options, &assignment_);
+  }
+
+  Graph graph_;
+  GpuStreamAssignment assignment_;
+};
+
+TEST_F(GpuStreamAssignmentTest, IndependentChainsRunOnSeparateStreams) {
+  Node* a1 = AddNode("a1");
+  Node* a2 = AddNode("a2", {a1});
+  Node* a3 = AddNode("a3", {a2});
+  Node* b1 = AddNode("b1");
+  Node* b2 = AddNode("b2", {b1});
+  Node* b3 = AddNode("b3", {b2});
+  TF_ASSERT_OK(Assign(2));
+
+  EXPECT_EQ(StreamOf(a1), StreamOf(a2));
+  EXPECT_EQ(StreamOf(a2), StreamOf(a3));
+  EXPECT_EQ(StreamOf(b1), StreamOf(b2));
+  EXPECT_EQ(StreamOf(b2), StreamOf(b3));
+  EXPECT_NE(StreamOf(a1), StreamOf(b1));
+  EXPECT_TRUE(assignment_.cross_stream_edges.empty());
+  EXPECT_EQ(assignment_.stream_utilization, std::vector<double>({1.0, 1.0}));
+  EXPECT_EQ(assignment_.node_to_stream[graph_.source_node()->id()], -1);
+  EXPECT_EQ(assignment_.node_to_stream[graph_.sink_node()->id()], -1);
+}
+
+TEST_F(GpuStreamAssignmentTest, DiamondBranchesRunConcurrently) {
+  Node* a = AddNode("a");
+  Node* b = AddNode("b", {a});
+  Node* c = AddNode("c", {a});
+  Node* d = AddNode("d", {b, c});
+  TF_ASSERT_OK(Assign(2));
+
+  EXPECT_NE(StreamOf(b), StreamOf(c));
+  // One branch leaves the stream of `a`, and one joins the stream of `d`.
+  ASSERT_EQ(assignment_.cross_stream_edges.size(), 2);
+  for (const Edge* edge : assignment_.cross_stream_edges) {
+    EXPECT_NE(StreamOf(edge->src()), StreamOf(edge->dst()));
+  }
+  // The four nodes finish in three steps instead of four.
+  ASSERT_EQ(assignment_.stream_utilization.size(), 2);
+  EXPECT_DOUBLE_EQ(assignment_.stream_utilization[0] +
+                       assignment_.stream_utilization[1],
+                   4.0 / 3);
+}
+
+TEST_F(GpuStreamAssignmentTest, ExpensiveEventsKeepBranchesOnOneStream) {
+  Node* a = AddNode("a");
+  Node* b = AddNode("b", {a});
+  Node* c = AddNode("c", {a});
+  AddNode("d", {b, c});
+  TF_ASSERT_OK(Assign(2, /*cross_stream_cost=*/2));
+
+  EXPECT_EQ(StreamOf(b), StreamOf(c));
+  EXPECT_TRUE(assignment_.cross_stream_edges.empty());
+}
+
+TEST_F(GpuStreamAssignmentTest, SingleStream) {
+  Node* a = AddNode("a");
+  Node* b = AddNode("b", {a});
+  Node* c = AddNode("c", {a});
+  Node* d = AddNode("d", {b, c});
+  TF_ASSERT_OK(Assign(1));
+
+  for (const Node* node : {a, b, c, d}) EXPECT_EQ(StreamOf(node), 0);
+  EXPECT_TRUE(assignment_.cross_stream_edges.empty());
+}
+
+TEST_F(GpuStreamAssignmentTest, InvalidOptions) {
+  AddNode("a");
+  EXPECT_EQ(Assign(0).code(), error::INVALID_ARGUMENT);
+  EXPECT_EQ(Assign(2, /*cross_stream_cost=*/-1).code(),
+            error::INVALID_ARGUMENT);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,7 +20,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device/device_event_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
+#include "tensorflow/core/common_runtime/gpu/pinned_staging_pool.h"
 #include "tensorflow/core/common_runtime/gpu_device_context.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -30,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/stream_executor.h"
 #include "tensorflow/core/platform/tensor_coding.h"
@@ -260,6 +263,185 @@ bool NeedStaging(const Tensor* tensor) {
   return tensor->GetMemoryType() == AllocatorMemoryType::kHostPageable;
 }
 
+// Returns a pinned buffer of `num_bytes` bytes for staging a copy, taken from
+// the staging pool of `device_context` if it has one.
+void* GetStagingBuffer(const GPUDeviceContext* device_context,
+                       size_t num_bytes) {
+  if (device_context->staging_pool() != nullptr) {
+    return device_context->staging_pool()->Get(num_bytes);
+  }
+  return device_context->host_memory_allocator()->AllocateRaw(
+      Allocator::kAllocatorAlignment, num_bytes);
+}
+
+// Releases a buffer obtained from `GetStagingBuffer`. Must only be called
+// once the copy using the buffer has completed.
+void ReleaseStagingBuffer(const GPUDeviceContext* device_context,
+                          void* buffer, size_t num_bytes) {
+  if (device_context->staging_pool() != nullptr) {
+    device_context->staging_pool()->Put(buffer, num_bytes);
+  } else {
+    device_context->host_memory_allocator()->DeallocateRaw(buffer);
+  }
+}
+
+// Pageable copies larger than this are staged in chunks of this size, so that
+// staging a chunk on the host overlaps with the DMA of another one.
+constexpr int64_t kStagingChunkBytes = 4 << 20;
+// The number of pinned buffers that a chunked copy cycles through.
+constexpr int kNumStagingBuffers = 2;
+
+constexpr char kHostToDevice[] = "host_to_device";
+constexpr char kDeviceToHost[] = "device_to_host";
+
+// Copies between pageable host memory and a GPU in chunks of
+// `kStagingChunkBytes`, through `kNumStagingBuffers` pinned buffers. A
+// host-to-device chunk is staged into its buffer before its DMA is issued,
+// and a device-to-host chunk is copied out of its buffer once its DMA has
+// completed. The event manager callback of each chunk then issues the next
+// unclaimed chunk through the same buffer, while the other buffers are in
+// flight. If a chunk fails, no further chunks are issued, and `done` is called
+// with the error once the chunks in flight have completed.
+//
+// The object deletes itself after calling `done`.
+class ChunkedStagingCopy {
+ public:
+  // Starts copying `total_bytes` bytes between `host_ptr` and `device_ptr` on
+  // `stream`. `input_ref` is released once the copy has completed.
+  static void Run(bool host_to_device, const GPUDeviceContext* device_context,
+                  EventMgr* event_mgr, se::Stream* stream, char* host_ptr,
+                  char* device_ptr, int64_t total_bytes,
+                  TensorReference input_ref, StatusCallback done) {
+    auto* copy = new ChunkedStagingCopy(
+        host_to_device, device_context, event_mgr, stream, host_ptr,
+        device_ptr, total_bytes, input_ref, std::move(done));
+    for (void*& buffer : copy->buffers_) {
+      buffer = GetStagingBuffer(device_context, kStagingChunkBytes);
+      if (buffer == nullptr) {
+        copy->Finish(errors::ResourceExhausted(
+            "Failed to allocate a pinned staging buffer of ",
+            kStagingChunkBytes, " bytes."));
+        return;
+      }
+    }
+    // Claim the first chunks before issuing any of them, as the copy may
+    // complete, and delete itself, as soon as the last claimed chunk is
+    // issued.
+    int64_t offsets[kNumStagingBuffers];
+    int64_t sizes[kNumStagingBuffers];
+    int num_claimed = 0;
+    while (num_claimed < kNumStagingBuffers &&
+           copy->ClaimChunk(&offsets[num_claimed], &sizes[num_claimed])) {
+      ++num_claimed;
+    }
+    for (int i = 0; i < num_claimed; ++i) {
+      copy->IssueChunk(i, offsets[i], sizes[i]);
+    }
+  }
+
+ private:
+  ChunkedStagingCopy(bool host_to_device,
+                     const GPUDeviceContext* device_context,
+                     EventMgr* event_mgr, se::Stream* stream, char* host_ptr,
+                     char* device_ptr, int64_t total_bytes,
+                     TensorReference input_ref, StatusCallback done)
+      : host_to_device_(host_to_device),
+        device_context_(device_context),
+        event_mgr_(event_mgr),
+        stream_(stream),
+        host_ptr_(host_ptr),
+        device_ptr_(device_ptr),
+        total_bytes_(total_bytes),
+        input_ref_(input_ref),
+        done_(std::move(done)),
+        start_micros_(Env::Default()->NowMicros()) {}
+
+  // Claims the next chunk of the copy, if any is left and no chunk failed.
+  bool ClaimChunk(int64_t* offset, int64_t* num_bytes) {
+    mutex_lock l(mu_);
+    if (next_offset_ == total_bytes_ || !status_.ok()) return false;
+    *offset = next_offset_;
+    *num_bytes = std::min(kStagingChunkBytes, total_bytes_ - next_offset_);
+    next_offset_ += *num_bytes;
+    ++num_in_flight_;
+    return true;
+  }
+
+  // Copies a claimed chunk through `buffers_[buffer]`. Members must not be
+  // accessed once the chunk is issued, as the copy may have completed.
+  void IssueChunk(int buffer, int64_t offset, int64_t num_bytes) {
+    void* staging_buffer = buffers_[buffer];
+    DeviceMemoryBase device_chunk(device_ptr_ + offset, num_bytes);
+    if (host_to_device_) {
+      std::memcpy(staging_buffer, host_ptr_ + offset, num_bytes);
+      stream_->ThenMemcpy(&device_chunk, staging_buffer, num_bytes);
+    } else {
+      stream_->ThenMemcpy(staging_buffer, device_chunk, num_bytes);
+    }
+    event_mgr_->ThenExecute(stream_, [this, buffer, offset, num_bytes]() {
+      ChunkDone(buffer, offset, num_bytes);
+    });
+  }
+
+  void ChunkDone(int buffer, int64_t offset, int64_t num_bytes) {
+    if (!stream_->ok()) {
+      mutex_lock l(mu_);
+      status_.Update(errors::Internal(
+          host_to_device_ ? "CPU->GPU" : "GPU->CPU", " Memcpy failed"));
+    } else if (!host_to_device_) {
+      std::memcpy(host_ptr_ + offset, buffers_[buffer], num_bytes);
+    }
+    int64_t next_offset;
+    int64_t next_num_bytes;
+    const bool claimed = ClaimChunk(&next_offset, &next_num_bytes);
+    bool finished;
+    Status status;
+    {
+      mutex_lock l(mu_);
+      finished = --num_in_flight_ == 0;
+      status = status_;
+    }
+    if (claimed) {
+      IssueChunk(buffer, next_offset, next_num_bytes);
+    } else if (finished) {
+      Finish(status);
+    }
+  }
+
+  void Finish(const Status& status) {
+    for (void* buffer : buffers_) {
+      if (buffer != nullptr) {
+        ReleaseStagingBuffer(device_context_, buffer, kStagingChunkBytes);
+      }
+    }
+    input_ref_.Unref();
+    if (status.ok()) {
+      metrics::RecordGpuCopy(host_to_device_ ? kHostToDevice : kDeviceToHost,
+                             total_bytes_,
+                             Env::Default()->NowMicros() - start_micros_);
+    }
+    done_(status);
+    delete this;
+  }
+
+  const bool host_to_device_;
+  const GPUDeviceContext* const device_context_;
+  EventMgr* const event_mgr_;
+  se::Stream* const stream_;
+  char* const host_ptr_;
+  char* const device_ptr_;
+  const int64_t total_bytes_;
+  TensorReference input_ref_;
+  StatusCallback done_;
+  const uint64 start_micros_;
+  void* buffers_[kNumStagingBuffers] = {};
+
+  mutex mu_;
+  int64_t next_offset_ TF_GUARDED_BY(mu_) = 0;
+  int num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  Status status_ TF_GUARDED_BY(mu_);
+};
+
 }  // namespace
 
 // static
@@ -277,9 +459,9 @@ void GPUUtil::CopyGPUTensorToCPU(Device* gpu_device,
     return;
   }
 
-  auto send_device_to_host_stream =
-      static_cast<const GPUDeviceContext*>(device_context)
-          ->device_to_host_stream();
+  auto* gpu_device_context =
+      static_cast<const GPUDeviceContext*>(device_context);
+  auto send_device_to_host_stream = gpu_device_context->device_to_host_stream();
   if (send_device_to_host_stream == nullptr) {
     done(errors::Internal("No send gpu copy-out-stream is available."));
     return;
@@ -288,21 +470,50 @@ void GPUUtil::CopyGPUTensorToCPU(Device* gpu_device,
   send_device_to_host_stream->ThenWaitFor(send_stream);
 
   const int64_t total_bytes = gpu_tensor->TotalBytes();
+  const uint64 start_micros = Env::Default()->NowMicros();
+  void* dst_ptr = nullptr;
+  void* staging_buffer = nullptr;
   if (total_bytes > 0) {
     void* src_ptr = GetBase(gpu_tensor);
     DeviceMemoryBase gpu_src_ptr(src_ptr, total_bytes);
-    void* dst_ptr = GetBase(cpu_tensor);
-    send_device_to_host_stream->ThenMemcpy(dst_ptr, gpu_src_ptr, total_bytes);
+    dst_ptr = GetBase(cpu_tensor);
+    // Copying into pageable memory makes the driver stage the data through a
+    // pinned buffer of its own, so stage through a pooled buffer instead.
+    if (NeedStaging(cpu_tensor) &&
+        gpu_device_context->host_memory_allocator() != nullptr) {
+      if (total_bytes > kStagingChunkBytes) {
+        ChunkedStagingCopy::Run(
+            /*host_to_device=*/false, gpu_device_context, dev_info->event_mgr,
+            send_device_to_host_stream, static_cast<char*>(dst_ptr),
+            static_cast<char*>(src_ptr), total_bytes,
+            TensorReference(*gpu_tensor), std::move(done));
+        return;
+      }
+      staging_buffer = GetStagingBuffer(gpu_device_context, total_bytes);
+    }
+    send_device_to_host_stream->ThenMemcpy(
+        staging_buffer != nullptr ? staging_buffer : dst_ptr, gpu_src_ptr,
+        total_bytes);
   }
   // Use of the input may outlive stack scope, so keep a ref.
   TensorReference input_ref(*gpu_tensor);
   dev_info->event_mgr->ThenExecute(
       send_device_to_host_stream,
-      [send_device_to_host_stream, done, input_ref]() {
+      [send_device_to_host_stream, done, input_ref, gpu_device_context,
+       staging_buffer, dst_ptr, total_bytes, start_micros]() {
         if (!send_device_to_host_stream->ok()) {
           LOG(FATAL) << "GPU->CPU Memcpy failed";
         }
         input_ref.Unref();
+        if (staging_buffer != nullptr) {
+          std::memcpy(dst_ptr, staging_buffer, total_bytes);
+          ReleaseStagingBuffer(gpu_device_context, staging_buffer,
+                               total_bytes);
+        }
+        if (total_bytes > 0) {
+          metrics::RecordGpuCopy(kDeviceToHost, total_bytes,
+                                 Env::Default()->NowMicros() - start_micros);
+        }
         done(OkStatus());
       });
 }
@@ -322,9 +533,9 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
     return;
   }
 
-  auto recv_host_to_device_stream =
-      static_cast<const GPUDeviceContext*>(device_context)
-          ->host_to_device_stream();
+  auto* gpu_device_context =
+      static_cast<const GPUDeviceContext*>(device_context);
+  auto recv_host_to_device_stream = gpu_device_context->host_to_device_stream();
   if (recv_host_to_device_stream == nullptr) {
     done(errors::Internal("No send gpu copy-out-stream is available."));
     return;
@@ -335,6 +546,7 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
   }
 
   const int64_t total_bytes = cpu_tensor->TotalBytes();
+  const uint64 start_micros = Env::Default()->NowMicros();
 
   bool do_staging = false;
   void* staging_buffer = nullptr;
@@ -359,9 +571,16 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
       }
     }
 
+    if (do_staging && total_bytes > kStagingChunkBytes) {
+      ChunkedStagingCopy::Run(
+          /*host_to_device=*/true, gpu_device_context, dev_info->event_mgr,
+          recv_host_to_device_stream, static_cast<char*>(src_ptr),
+          static_cast<char*>(dst_ptr), total_bytes, input_ref,
+          std::move(done));
+      return;
+    }
     if (do_staging) {
-      staging_buffer = host_memory_allocator->AllocateRaw(
-          tensorflow::Allocator::kAllocatorAlignment, total_bytes);
+      staging_buffer = GetStagingBuffer(gpu_device_context, total_bytes);
       std::memcpy(staging_buffer, src_ptr, total_bytes);
       input_ref.Unref();
 
@@ -376,15 +595,20 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
   dev_info->event_mgr->ThenExecute(
       recv_host_to_device_stream,
       [recv_host_to_device_stream, done, input_ref, do_staging, staging_buffer,
-       host_memory_allocator]() {
+       gpu_device_context, total_bytes, start_micros]() {
         if (do_staging) {
-          host_memory_allocator->DeallocateRaw(staging_buffer);
+          ReleaseStagingBuffer(gpu_device_context, staging_buffer,
+                               total_bytes);
         } else {
           input_ref.Unref();
         }
         if (!recv_host_to_device_stream->ok()) {
           LOG(FATAL) << "CPU->GPU Memcpy failed";
         }
+        if (total_bytes > 0) {
+          metrics::RecordGpuCopy(kHostToDevice, total_bytes,
+                                 Env::Default()->NowMicros() - start_micros);
+        }
         done(OkStatus());
       });
 }
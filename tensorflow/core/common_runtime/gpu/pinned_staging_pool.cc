@@ -0,0 +1,92 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/pinned_staging_pool.h"
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+const int kMinBufferBits = Log2Ceiling64(PinnedStagingPool::kMinBufferBytes);
+const int kMaxBufferBits = Log2Ceiling64(PinnedStagingPool::kMaxBufferBytes);
+
+}  // namespace
+
+PinnedStagingPool::PinnedStagingPool(Allocator* allocator,
+                                     size_t max_cached_bytes)
+    : allocator_(allocator),
+      max_cached_bytes_(max_cached_bytes),
+      free_buffers_(kMaxBufferBits - kMinBufferBits + 1) {}
+
+PinnedStagingPool::~PinnedStagingPool() {
+  mutex_lock l(mu_);
+  for (const std::vector<void*>& buffers : free_buffers_) {
+    for (void* buffer : buffers) {
+      allocator_->DeallocateRaw(buffer);
+    }
+  }
+}
+
+int PinnedStagingPool::BucketFor(size_t num_bytes) {
+  if (num_bytes > kMaxBufferBytes) return -1;
+  if (num_bytes <= kMinBufferBytes) return 0;
+  return Log2Ceiling64(num_bytes) - kMinBufferBits;
+}
+
+size_t PinnedStagingPool::BucketBytes(int bucket) {
+  return size_t{1} << (bucket + kMinBufferBits);
+}
+
+void* PinnedStagingPool::Get(size_t num_bytes) {
+  const int bucket = BucketFor(num_bytes);
+  if (bucket < 0) {
+    return allocator_->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+  }
+  {
+    mutex_lock l(mu_);
+    std::vector<void*>& buffers = free_buffers_[bucket];
+    if (!buffers.empty()) {
+      void* buffer = buffers.back();
+      buffers.pop_back();
+      cached_bytes_ -= BucketBytes(bucket);
+      return buffer;
+    }
+  }
+  return allocator_->AllocateRaw(Allocator::kAllocatorAlignment,
+                                 BucketBytes(bucket));
+}
+
+void PinnedStagingPool::Put(void* buffer, size_t num_bytes) {
+  const int bucket = BucketFor(num_bytes);
+  if (bucket >= 0) {
+    mutex_lock l(mu_);
+    if (cached_bytes_ + BucketBytes(bucket) <= max_cached_bytes_) {
+      free_buffers_[bucket].push_back(buffer);
+      cached_bytes_ += BucketBytes(bucket);
+      return;
+    }
+  }
+  VLOG(3) << "Releasing a staging buffer of " << num_bytes << " bytes";
+  allocator_->DeallocateRaw(buffer);
+}
+
+size_t PinnedStagingPool::cached_bytes() const {
+  mutex_lock l(mu_);
+  return cached_bytes_;
+}
+
+}  // namespace tensorflow
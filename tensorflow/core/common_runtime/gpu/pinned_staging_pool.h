@@ -0,0 +1,75 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GPU_PINNED_STAGING_POOL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_GPU_PINNED_STAGING_POOL_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A pool of pinned host buffers used to stage copies between pageable host
+// memory and a GPU. Buffers are bucketed by power-of-two sizes, and are
+// returned to the pool once the transfer using them has completed, so that
+// repeated copies of similar sizes do not go through the pinned memory
+// allocator.
+//
+// This class is thread-safe.
+class PinnedStagingPool {
+ public:
+  // The smallest and largest buffers kept in the pool. Larger requests are
+  // served by the allocator directly.
+  static constexpr size_t kMinBufferBytes = 4 << 10;
+  static constexpr size_t kMaxBufferBytes = 64 << 20;
+
+  // `allocator` allocates pinned host memory and must outlive the pool. At
+  // most `max_cached_bytes` of free buffers are kept.
+  PinnedStagingPool(Allocator* allocator, size_t max_cached_bytes);
+  ~PinnedStagingPool();
+
+  // Returns a buffer of at least `num_bytes` bytes, or nullptr if the
+  // allocation fails.
+  void* Get(size_t num_bytes);
+
+  // Returns `buffer`, obtained from `Get(num_bytes)`, to the pool.
+  void Put(void* buffer, size_t num_bytes);
+
+  // Returns the total size of the free buffers in the pool.
+  size_t cached_bytes() const;
+
+ private:
+  // Returns the bucket for `num_bytes`, or -1 if such buffers are not pooled.
+  static int BucketFor(size_t num_bytes);
+  static size_t BucketBytes(int bucket);
+
+  Allocator* const allocator_;  // Not owned.
+  const size_t max_cached_bytes_;
+
+  mutable mutex mu_;
+  // `free_buffers_[i]` holds free buffers of `BucketBytes(i)` bytes.
+  std::vector<std::vector<void*>> free_buffers_ TF_GUARDED_BY(mu_);
+  size_t cached_bytes_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PinnedStagingPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_GPU_PINNED_STAGING_POOL_H_
@@ -0,0 +1,64 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/pinned_staging_pool.h"
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(PinnedStagingPoolTest, ReusesBuffersOfTheSameBucket) {
+  PinnedStagingPool pool(cpu_allocator(), 1 << 20);
+  void* buffer = pool.Get(5000);
+  ASSERT_NE(buffer, nullptr);
+  pool.Put(buffer, 5000);
+  EXPECT_EQ(pool.cached_bytes(), 8 << 10);
+
+  // Any size in the same power-of-two bucket gets the cached buffer back.
+  void* reused = pool.Get(8 << 10);
+  EXPECT_EQ(reused, buffer);
+  EXPECT_EQ(pool.cached_bytes(), 0);
+
+  void* other = pool.Get(100);
+  EXPECT_NE(other, buffer);
+  pool.Put(other, 100);
+  pool.Put(reused, 8 << 10);
+  EXPECT_EQ(pool.cached_bytes(), 12 << 10);
+}
+
+TEST(PinnedStagingPoolTest, DoesNotCacheBeyondCapacity) {
+  PinnedStagingPool pool(cpu_allocator(), 16 << 10);
+  void* first = pool.Get(16 << 10);
+  void* second = pool.Get(16 << 10);
+  pool.Put(first, 16 << 10);
+  pool.Put(second, 16 << 10);
+  EXPECT_EQ(pool.cached_bytes(), 16 << 10);
+  EXPECT_EQ(pool.Get(16 << 10), first);
+  pool.Put(first, 16 << 10);
+}
+
+TEST(PinnedStagingPoolTest, DoesNotCacheLargeBuffers) {
+  constexpr size_t kNumBytes = PinnedStagingPool::kMaxBufferBytes + 1;
+  PinnedStagingPool pool(cpu_allocator(), 4 * kNumBytes);
+  void* buffer = pool.Get(kNumBytes);
+  ASSERT_NE(buffer, nullptr);
+  pool.Put(buffer, kNumBytes);
+  EXPECT_EQ(pool.cached_bytes(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
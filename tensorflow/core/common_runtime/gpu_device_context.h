@@ -26,9 +26,11 @@ class Stream;
 
 namespace tensorflow {
 
+class PinnedStagingPool;
+
 class GPUDeviceContext : public DeviceContext {
  public:
-  // Does not take ownership of streams.
+  // Does not take ownership of streams or of `staging_pool`.
   GPUDeviceContext(int stream_id, se::Stream* stream,
 #if TENSORFLOW_USE_ROCM
                    se::Stream* nccl_stream,
@@ -36,7 +38,8 @@ class GPUDeviceContext : public DeviceContext {
                    se::Stream* host_to_device_stream,
                    se::Stream* device_to_host_stream,
                    gtl::InlinedVector<se::Stream*, 4> device_to_device_stream,
-                   Allocator* host_memory_allocator)
+                   Allocator* host_memory_allocator,
+                   PinnedStagingPool* staging_pool = nullptr)
       : stream_id_(stream_id),
         stream_(stream),
 #if TENSORFLOW_USE_ROCM
@@ -45,8 +48,8 @@ class GPUDeviceContext : public DeviceContext {
         host_to_device_stream_(host_to_device_stream),
         device_to_host_stream_(device_to_host_stream),
         device_to_device_stream_(device_to_device_stream),
-        host_memory_allocator_(host_memory_allocator) {
-  }
+        host_memory_allocator_(host_memory_allocator),
+        staging_pool_(staging_pool) {}
 
   ~GPUDeviceContext() override {}
 
@@ -63,6 +66,7 @@ class GPUDeviceContext : public DeviceContext {
   Allocator* host_memory_allocator() const override {
     return host_memory_allocator_;
   }
+  PinnedStagingPool* staging_pool() const { return staging_pool_; }
 
   void CopyCPUTensorToDevice(const Tensor* cpu_tensor, Device* device,
                              Tensor* device_tensor, StatusCallback done,
@@ -100,6 +104,9 @@ class GPUDeviceContext : public DeviceContext {
   // The allocator to use for allocating pinned host memory.
   // Not owned.
   Allocator* host_memory_allocator_;
+  // Pool of pinned buffers used to stage copies of pageable host memory, or
+  // nullptr. Not owned.
+  PinnedStagingPool* staging_pool_;
 };
 
 }  // namespace tensorflow
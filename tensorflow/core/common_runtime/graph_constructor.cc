@@ -40,11 +40,14 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/tensor_id.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/scanner.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
@@ -54,6 +57,14 @@ namespace tensorflow {
 
 namespace {
 
+// Graphs with at least this many nodes have their NodeDefs prepared in
+// parallel when possible; see GraphConstructor::PrepareNodeDefs().
+constexpr int kMinNodesForParallelPrepare = 1 << 14;
+
+// Estimated cost, in cycles, of looking up, defaulting and validating one
+// NodeDef.
+constexpr int64_t kPrepareNodeDefCost = 10000;
+
 // We remove duplicate control inputs before adding edges to the Graph, so we
 // can skip expensive duplicates check in 'AddControlEdge'.
 static constexpr const bool kDoNotCheckDuplicates = true;
@@ -232,6 +243,11 @@ class GraphConstructor {
   Status MakeEdge(Node* src, int output_index, Node* dst, int input_index);
   Status ValidateShape(Node* node);
   Status ModifyNodeDefForImport(NodeDef* node_def);
+  // Adds default attrs to and validates `node_def`, when not importing.
+  Status PrepareNodeDef(NodeDef* node_def) const;
+  // Prepares every NodeDef of a large graph in parallel if they can be
+  // modified in place, recording the results in prepare_status_.
+  void PrepareNodeDefs();
   // Modifies node_def's inputs according to opts_.input_map.
   // input_already_exists is a pre-initialized vector of length
   // node_def->input_size(). This function will mark inputs that are remapped to
@@ -285,6 +301,10 @@ class GraphConstructor {
   // possible. After calling this method, the result of get_node_def(i) is
   // undefined.
   virtual NodeDef consume_node_def(int i) = 0;
+  // Returns the i^th node in the graph for modification in place, or nullptr
+  // if the graph does not own its nodes. Must not be called after
+  // consume_node_def(i).
+  virtual NodeDef* mutable_node_def(int i) { return nullptr; }
   // Returns the version information for the graph, or nullptr if none is
   // available.
   virtual const VersionDef* versions() const = 0;
@@ -387,6 +407,10 @@ class GraphConstructor {
   };
   std::vector<EdgeInfo> back_edges_;
 
+  // The result of PrepareNodeDef() for each NodeDef, if PrepareNodeDefs()
+  // prepared them ahead of Convert(). Empty otherwise.
+  std::vector<Status> prepare_status_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(GraphConstructor);
 };
 
@@ -447,6 +471,11 @@ class NodeDefMovingGraphConstructor : public GraphConstructor {
     is_consumed_[i] = true;
     return std::move(*graph_def_.mutable_node(i));
   }
+  NodeDef* mutable_node_def(int i) override {
+    CHECK(!is_consumed_[i])
+        << "NodeDef " << i << " accessed after it was consumed.";
+    return graph_def_.mutable_node(i);
+  }
   const VersionDef* versions() const override { return &graph_def_.versions(); }
   const FunctionDefLibrary* library() const override {
     return &graph_def_.library();
@@ -1114,6 +1143,42 @@ void GraphConstructor::PrintCycles() {
   }
 }
 
+Status GraphConstructor::PrepareNodeDef(NodeDef* node_def) const {
+  const OpDef* op_def;
+  TF_RETURN_IF_ERROR(g_->op_registry()->LookUpOpDef(node_def->op(), &op_def));
+  if (opts_.add_default_attributes) {
+    AddDefaultsToNodeDef(*op_def, node_def);
+  }
+  if (opts_.validate_nodes) {
+    TF_RETURN_IF_ERROR(ValidateNodeDef(*node_def, *op_def));
+  }
+  return OkStatus();
+}
+
+void GraphConstructor::PrepareNodeDefs() {
+  // When importing, the NodeDefs are rewritten as they are converted, so they
+  // can only be validated then.
+  const int64_t num_nodes = node_def_count();
+  if (opts_.importing || num_nodes < kMinNodesForParallelPrepare ||
+      mutable_node_def(0) == nullptr) {
+    return;
+  }
+  const int num_threads = port::MaxParallelism();
+  if (num_threads <= 1) return;
+
+  // Each node is prepared independently of the others. Convert() returns the
+  // error of a node when it reaches it, so the errors are reported in the same
+  // order as when the nodes are prepared one at a time.
+  prepare_status_.resize(num_nodes);
+  thread::ThreadPool pool(Env::Default(), "graph_constructor", num_threads);
+  pool.ParallelFor(num_nodes, kPrepareNodeDefCost,
+                   [this](int64_t start, int64_t limit) {
+                     for (int64_t i = start; i < limit; ++i) {
+                       prepare_status_[i] = PrepareNodeDef(mutable_node_def(i));
+                     }
+                   });
+}
+
 Status GraphConstructor::Convert() {
   // Import functions before adding nodes, since imported nodes may refer to
   // functions
@@ -1122,6 +1187,7 @@ Status GraphConstructor::Convert() {
     // avoid unnecessarily copying `*library()` here.
     TF_RETURN_IF_ERROR(g_->AddFunctionLibrary(*library()));
   }
+  PrepareNodeDefs();
 
   std::vector<InputInfo> inputs;
   int processed = 0;
@@ -1235,16 +1301,10 @@ Status GraphConstructor::Convert() {
 
     if (opts_.importing) {
       TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&node_def));
+    } else if (!prepare_status_.empty()) {
+      TF_RETURN_IF_ERROR(prepare_status_[o]);
     } else {
-      const OpDef* op_def;
-      TF_RETURN_IF_ERROR(
-          g_->op_registry()->LookUpOpDef(node_def.op(), &op_def));
-      if (opts_.add_default_attributes) {
-        AddDefaultsToNodeDef(*op_def, &node_def);
-      }
-      if (opts_.validate_nodes) {
-        TF_RETURN_IF_ERROR(ValidateNodeDef(node_def, *op_def));
-      }
+      TF_RETURN_IF_ERROR(PrepareNodeDef(&node_def));
     }
 
     TF_RETURN_IF_ERROR(MakeNode(std::move(node_def), &node));
@@ -17,10 +17,12 @@ limitations under the License.
 
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/shape_refiner.h"
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/graph.h"
@@ -1033,6 +1035,35 @@ TEST_F(GraphConstructorTest, ImportGraphDef_DefaultAttrs) {
   EXPECT_EQ(31415, value);
 }
 
+TEST_F(GraphConstructorTest, ConvertLargeGraphDef) {
+  // Large enough for the NodeDefs to be prepared in parallel.
+  constexpr int kNumNodes = 1 << 14;
+  GraphDef def;
+  for (int i = 0; i < kNumNodes; ++i) {
+    NodeDef* node = def.add_node();
+    node->set_name(strings::StrCat("n", i));
+    node->set_op("TestDefaultAttr");
+  }
+
+  GraphConstructorOptions opts;
+  TF_ASSERT_OK(ConvertGraphDefToGraph(opts, GraphDef(def), &graph_));
+  EXPECT_EQ(graph_.num_op_nodes(), kNumNodes);
+  for (const Node* n : graph_.op_nodes()) {
+    int value = 0;
+    TF_ASSERT_OK(GetNodeAttr(n->attrs(), "default_int", &value));
+    EXPECT_EQ(31415, value);
+  }
+
+  // The first invalid node in conversion order is reported.
+  AddNodeAttr("unknown_attr", 1, def.mutable_node(kNumNodes - 1));
+  AddNodeAttr("unknown_attr", 1, def.mutable_node(100));
+  Graph graph(OpRegistry::Global());
+  Status s = ConvertGraphDefToGraph(opts, std::move(def), &graph);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "n100")) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "unknown_attr")) << s;
+}
+
 TEST_F(GraphConstructorTest, ImportGraphDef_Versioning) {
   GraphDef def;
   const ImportGraphDefOptions opts;
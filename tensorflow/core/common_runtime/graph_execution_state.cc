@@ -22,6 +22,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_join.h"
@@ -683,6 +684,8 @@ Status GraphExecutionState::OptimizeGraph(
 
     // Add feeds to the GrapplerItem if we know them.
     absl::flat_hash_set<absl::string_view> node_names;
+    absl::flat_hash_map<string, TensorShape> specialized_shapes;
+    size_t num_feeds = 0;
     if (!(options.callable_options.feed().empty() &&
           options.callable_options.tensor_connection().empty())) {
       std::vector<SafeTensorId> feeds;
@@ -699,6 +702,16 @@ Status GraphExecutionState::OptimizeGraph(
       // the graph to infer feed data type and shape.
       absl::flat_hash_set<absl::string_view> feed_nodes;
 
+      num_feeds = feeds.size();
+
+      // Feeds with tensor index 0 for which the caller specialized the graph
+      // to a static shape.
+      for (size_t i = 0; i < options.feed_shapes.size(); ++i) {
+        if (feeds[i].index() == 0) {
+          specialized_shapes.emplace(feeds[i].node(), options.feed_shapes[i]);
+        }
+      }
+
       // For feeds with tensor index larger than 0, we can't infer data type or
       // shape from the graph. Currently we only support type and shape
       // inference from a small set of node types: Placeholder, Const, etc...
@@ -741,7 +754,18 @@ Status GraphExecutionState::OptimizeGraph(
         // choose 0 to minimize the memory impact. Note that this only matters
         // if an optimizer chooses to run the graph.
         TensorShape shape;
-        if (partial_shape.unknown_rank()) {
+        auto specialized_it = specialized_shapes.find(node->name());
+        if (specialized_it != specialized_shapes.end() &&
+            !partial_shape.IsCompatibleWith(specialized_it->second)) {
+          VLOG(1) << "Not specializing feed " << node->name() << " of shape "
+                  << partial_shape << " to "
+                  << specialized_it->second.DebugString();
+          specialized_shapes.erase(specialized_it);
+          specialized_it = specialized_shapes.end();
+        }
+        if (specialized_it != specialized_shapes.end()) {
+          shape = specialized_it->second;
+        } else if (partial_shape.unknown_rank()) {
           shape = TensorShape({0});
         } else {
           for (int i = 0; i < partial_shape.dims(); ++i) {
@@ -788,6 +812,23 @@ Status GraphExecutionState::OptimizeGraph(
 
     // Convert Graph to GraphDef and add it to the GrapplerItem.
     graph.ToGraphDef(&item.graph);
+    // Give the specialized placeholders their static shapes, so that shape
+    // inference and constant folding see them. If all feeds are specialized,
+    // the optimizers may also rely on the fed tensors having these shapes.
+    if (!specialized_shapes.empty()) {
+      size_t num_specialized_feeds = 0;
+      for (NodeDef& node : *item.graph.mutable_node()) {
+        auto it = specialized_shapes.find(node.name());
+        if (it != specialized_shapes.end() &&
+            (node.op() == "Placeholder" || node.op() == "PlaceholderV2" ||
+             node.op() == "PlaceholderWithDefault")) {
+          it->second.AsProto((*node.mutable_attr())["shape"].mutable_shape());
+          ++num_specialized_feeds;
+        }
+      }
+      item.optimization_options().assume_valid_feeds =
+          num_specialized_feeds == num_feeds;
+    }
     // TODO(b/114748242): Add a unit test to test this bug fix.
     if (flib_def) {
       *item.graph.mutable_library() = flib_def->ToProto();
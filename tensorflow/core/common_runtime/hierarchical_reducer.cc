@@ -0,0 +1,385 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/hierarchical_reducer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+struct LoadedTopology {
+  Status status;
+  CollectiveTopology topology;
+};
+
+// Returns the topology read from the file named by
+// TF_COLLECTIVE_TOPOLOGY_FILE, which is loaded once per process.
+const LoadedTopology& DefaultTopology() {
+  static const LoadedTopology* loaded = [] {
+    auto* loaded = new LoadedTopology;
+    string path;
+    loaded->status =
+        ReadStringFromEnvVar("TF_COLLECTIVE_TOPOLOGY_FILE", "", &path);
+    if (loaded->status.ok() && !path.empty()) {
+      string text;
+      loaded->status = ReadFileToString(Env::Default(), path, &text);
+      if (loaded->status.ok()) {
+        loaded->status = CollectiveTopology::Parse(text, &loaded->topology);
+      }
+    }
+    return loaded;
+  }();
+  return *loaded;
+}
+
+}  // namespace
+
+Status CollectiveTopology::Parse(StringPiece text,
+                                 CollectiveTopology* topology) {
+  topology->locations.clear();
+  for (StringPiece line : absl::StrSplit(text, '\n')) {
+    line = line.substr(0, line.find('#'));
+    std::vector<StringPiece> fields =
+        absl::StrSplit(line, absl::ByAnyChar(" \t\r"), absl::SkipEmpty());
+    if (fields.empty()) continue;
+    if (fields.size() > 3 || fields.size() < 2) {
+      return errors::InvalidArgument("Invalid collective topology line \"",
+                                     line,
+                                     "\", expected \"<task> <host> [<rack>]\"");
+    }
+    Location& location = topology->locations[fields[0]];
+    location.host = string(fields[1]);
+    location.rack = fields.size() == 3 ? string(fields[2]) : "";
+  }
+  return OkStatus();
+}
+
+CollectiveTopology::Location CollectiveTopology::Find(
+    const string& task) const {
+  auto it = locations.find(task);
+  if (it == locations.end()) return {task, ""};
+  return it->second;
+}
+
+HierarchicalReducer::HierarchicalReducer()
+    : col_ctx_(nullptr), col_params_(nullptr) {}
+
+Status HierarchicalReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  if (col_params->instance.type != REDUCTION_COLLECTIVE) {
+    return errors::InvalidArgument(
+        "HierarchicalReduce only implements reductions");
+  }
+  if (col_params->group.device_type != DEVICE_CPU) {
+    return errors::InvalidArgument(
+        "HierarchicalReduce only supports CPU devices, got ",
+        col_params->group.device_type.type_string());
+  }
+  const LoadedTopology& loaded = DefaultTopology();
+  TF_RETURN_IF_ERROR(loaded.status);
+  return InitializeSubdivs(loaded.topology, col_params);
+}
+
+Status HierarchicalReducer::InitializeSubdivs(
+    const CollectiveTopology& topology, CollectiveParams* col_params) {
+  struct Host {
+    string rack;
+    std::vector<int> ranks;
+  };
+  std::vector<Host> hosts;
+  absl::flat_hash_map<string, int> host_index;
+  const std::vector<CollGroupMember>& members = col_params->group.members;
+  for (int rank = 0; rank < members.size(); ++rank) {
+    const CollectiveTopology::Location location =
+        topology.Find(members[rank].task);
+    auto it = host_index.emplace(location.host, hosts.size());
+    if (it.second) {
+      hosts.push_back({location.rack, {}});
+    } else if (hosts[it.first->second].rack != location.rack) {
+      return errors::InvalidArgument("Host ", location.host, " is in rack ",
+                                     hosts[it.first->second].rack, " and ",
+                                     location.rack);
+    }
+    hosts[it.first->second].ranks.push_back(rank);
+  }
+  // Keeping the hosts of a rack adjacent means the ring crosses between
+  // racks only once per rack.
+  std::stable_sort(
+      hosts.begin(), hosts.end(),
+      [](const Host& a, const Host& b) { return a.rack < b.rack; });
+
+  const int num_hosts = hosts.size();
+  auto& perms = col_params->instance.impl_details.subdiv_permutations;
+  perms.assign(num_hosts + 1, {});
+  col_params->subdiv_rank.assign(num_hosts + 1, -1);
+  for (int hi = 0; hi < num_hosts; ++hi) {
+    const std::vector<int>& ranks = hosts[hi].ranks;
+    perms[0].push_back(ranks[0]);
+    if (ranks[0] == col_params->default_rank) col_params->subdiv_rank[0] = hi;
+    perms[hi + 1] = ranks;
+    for (int i = 0; i < ranks.size(); ++i) {
+      if (ranks[i] == col_params->default_rank) {
+        col_params->subdiv_rank[hi + 1] = i;
+      }
+    }
+  }
+  VLOG(2) << collective_util::SubdivPermDebugString(*col_params);
+  return OkStatus();
+}
+
+Status HierarchicalReducer::InitializeCollectiveContext(
+    std::shared_ptr<CollectiveContext> col_ctx) {
+  DCHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = col_ctx->col_params.get();
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void HierarchicalReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Like `RingReducer`, this does not require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+  Status s = RunHierarchy();
+  if (!s.ok()) {
+    // Peers may be waiting on this device, so abort them unless a
+    // cancellation is already reaching them.
+    CancellationManager* cancel_mgr = col_ctx_->op_ctx->cancellation_manager();
+    if (cancel_mgr == nullptr ||
+        (!cancel_mgr->IsCancelled() && !cancel_mgr->IsCancelling())) {
+      col_ctx_->col_exec->StartAbort(s);
+    }
+  }
+  done(s);
+}
+
+Status HierarchicalReducer::RunHierarchy() {
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    Notification note;
+    Status status;
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  const auto& subdivs = col_params_->instance.impl_details.subdiv_permutations;
+  const std::vector<int>* host = nullptr;
+  for (int sdi = 1; sdi < subdivs.size(); ++sdi) {
+    if (col_params_->subdiv_rank[sdi] >= 0) host = &subdivs[sdi];
+  }
+  if (host == nullptr) {
+    return errors::Internal("Device ", col_ctx_->device_name,
+                            " is not on any host of the collective");
+  }
+  TF_RETURN_IF_ERROR(ReduceWithinHost(*host));
+  if (col_params_->subdiv_rank[0] >= 0) {
+    TF_RETURN_IF_ERROR(
+        AllReduceAcrossHosts(subdivs[0], col_params_->subdiv_rank[0]));
+  }
+  return BroadcastWithinHost(*host);
+}
+
+Status HierarchicalReducer::ReduceWithinHost(const std::vector<int>& host) {
+  const int rank = col_params_->default_rank;
+  const int leader = host[0];
+  if (host.size() == 1) return OkStatus();
+  if (rank != leader) {
+    return Exchange(
+        {{true, leader, BufKey("reduce", 0, rank, leader), col_ctx_->output}});
+  }
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+  std::vector<Tensor> received;
+  received.reserve(host.size() - 1);
+  std::vector<Transfer> transfers;
+  for (int i = 1; i < host.size(); ++i) {
+    received.emplace_back(allocator, col_ctx_->output->dtype(),
+                          col_ctx_->output->shape());
+    transfers.push_back({false, host[i], BufKey("reduce", 0, host[i], leader),
+                         &received.back()});
+  }
+  TF_RETURN_IF_ERROR(Exchange(transfers));
+  for (Tensor& t : received) {
+    TF_RETURN_IF_ERROR(Merge(col_ctx_->output, &t));
+  }
+  return OkStatus();
+}
+
+Status HierarchicalReducer::AllReduceAcrossHosts(
+    const std::vector<int>& leaders, int position) {
+  const int num_leaders = leaders.size();
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+  std::unique_ptr<CollectiveAdapter> ca(
+      MakeCollectiveAdapter(col_ctx_->output, num_leaders, allocator));
+  Tensor group_size = ca->Scalar(col_params_->group.group_size);
+  if (num_leaders > 1) {
+    const int rank = col_params_->default_rank;
+    const int next = leaders[(position + 1) % num_leaders];
+    const int prev = leaders[(position + num_leaders - 1) % num_leaders];
+    // Reduce-scatter: at each step a leader passes on the partial sum of one
+    // chunk and adds the partial sum of the previous chunk to its own. At the
+    // end it holds the complete sum of chunk position + 1.
+    for (int step = 0; step + 1 < num_leaders; ++step) {
+      const int send_chunk = (position - step + num_leaders) % num_leaders;
+      const int recv_chunk = (position - step - 1 + num_leaders) % num_leaders;
+      Tensor send = ca->ChunkAlias(send_chunk);
+      Tensor recv = ca->TempChunk(recv_chunk);
+      std::vector<Transfer> transfers;
+      // Chunks are the same size on every leader, so empty tail chunks are
+      // skipped consistently.
+      if (ca->ChunkBytes(send_chunk) > 0) {
+        transfers.push_back(
+            {true, next, BufKey("scatter", step, rank, next), &send});
+      }
+      if (ca->ChunkBytes(recv_chunk) > 0) {
+        transfers.push_back(
+            {false, prev, BufKey("scatter", step, prev, rank), &recv});
+      }
+      TF_RETURN_IF_ERROR(Exchange(transfers));
+      if (ca->ChunkBytes(recv_chunk) > 0) {
+        Tensor dst = ca->ChunkAlias(recv_chunk);
+        TF_RETURN_IF_ERROR(Merge(&dst, &recv));
+      }
+    }
+    // All-gather: pass the complete chunks around the ring.
+    for (int step = 0; step + 1 < num_leaders; ++step) {
+      const int send_chunk = (position + 1 - step + num_leaders) % num_leaders;
+      const int recv_chunk = (position - step + num_leaders) % num_leaders;
+      Tensor send = ca->ChunkAlias(send_chunk);
+      Tensor recv = ca->ChunkAlias(recv_chunk);
+      std::vector<Transfer> transfers;
+      if (ca->ChunkBytes(send_chunk) > 0) {
+        transfers.push_back(
+            {true, next, BufKey("gather", step, rank, next), &send});
+      }
+      if (ca->ChunkBytes(recv_chunk) > 0) {
+        transfers.push_back(
+            {false, prev, BufKey("gather", step, prev, rank), &recv});
+      }
+      TF_RETURN_IF_ERROR(Exchange(transfers));
+    }
+  }
+  ca->ConsumeFinalValue(col_ctx_->output);
+  if (col_params_->final_op == nullptr) return OkStatus();
+  return collective_util::ComputeBinOp(
+      col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+      col_params_->final_op, col_ctx_->output, &group_size);
+}
+
+Status HierarchicalReducer::BroadcastWithinHost(const std::vector<int>& host) {
+  const int rank = col_params_->default_rank;
+  const int leader = host[0];
+  if (host.size() == 1) return OkStatus();
+  if (rank != leader) {
+    return Exchange({{false, leader, BufKey("broadcast", 0, leader, rank),
+                      col_ctx_->output}});
+  }
+  std::vector<Transfer> transfers;
+  for (int i = 1; i < host.size(); ++i) {
+    transfers.push_back({true, host[i],
+                         BufKey("broadcast", 0, leader, host[i]),
+                         col_ctx_->output});
+  }
+  return Exchange(transfers);
+}
+
+Status HierarchicalReducer::Exchange(const std::vector<Transfer>& transfers) {
+  if (transfers.empty()) return OkStatus();
+  BlockingCounter pending(transfers.size());
+  mutex mu;
+  Status status;
+  auto done = [&pending, &mu, &status](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  CollectiveRemoteAccess* rma = col_ctx_->col_exec->remote_access();
+  for (const Transfer& t : transfers) {
+    const CollGroupMember& peer = col_params_->group.members[t.peer_rank];
+    VLOG(3) << (t.send ? "Send " : "Recv ") << t.key
+            << (t.send ? " to " : " from ") << peer.device.name();
+    if (t.send) {
+      rma->PostToPeer(peer.device.name(), peer.task, t.key, col_ctx_->device,
+                      col_ctx_->op_ctx->op_device_context(),
+                      col_ctx_->op_ctx->output_alloc_attr(0), t.tensor,
+                      col_ctx_->device_locality,
+                      col_ctx_->op_ctx->cancellation_manager(), done);
+    } else {
+      rma->RecvFromPeer(peer.device.name(), peer.task, peer.is_local, t.key,
+                        col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+                        col_ctx_->op_ctx->output_alloc_attr(0), t.tensor,
+                        col_ctx_->device_locality,
+                        0 /*dev_to_dev_stream_index*/,
+                        col_ctx_->op_ctx->cancellation_manager(), done);
+    }
+  }
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+Status HierarchicalReducer::Merge(Tensor* dst, Tensor* src) {
+  return collective_util::ComputeBinOp(col_ctx_->op_ctx, col_ctx_->op_params,
+                                       col_ctx_->device, col_params_->merge_op,
+                                       dst, src);
+}
+
+string HierarchicalReducer::BufKey(StringPiece phase, int step, int from_rank,
+                                   int to_rank) const {
+  return strings::StrCat("HierarchicalReduce:", col_ctx_->exec_key, ":", phase,
+                         ":", step, ":", from_rank, ":", to_rank);
+}
+
+namespace {
+REGISTER_COLLECTIVE(HierarchicalReduce, HierarchicalReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,112 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+
+namespace tensorflow {
+class Device;
+
+// Host and rack of the tasks of a cluster.  A task that is not listed is
+// treated as its own host, in no rack.
+struct CollectiveTopology {
+  struct Location {
+    string host;
+    string rack;
+  };
+
+  // Parses one "<task> <host> [<rack>]" entry per line, e.g.
+  //   /job:worker/replica:0/task:0 host0 rack0
+  // Empty lines and everything after a '#' are ignored.
+  static Status Parse(StringPiece text, CollectiveTopology* topology);
+
+  Location Find(const string& task) const;
+
+  absl::flat_hash_map<string, Location> locations;
+};
+
+// Topology-aware all-reduce for CPU devices, selected with the communication
+// hint "hierarchical".  Devices are grouped by host: the devices of each host
+// first reduce onto the lowest-ranked of them, these host leaders then run a
+// ring all-reduce ordered so that hosts in the same rack are adjacent, and
+// each leader finally broadcasts the result to the other devices on its host.
+class HierarchicalReducer : public CollectiveImplementationInterface {
+ public:
+  HierarchicalReducer();
+  ~HierarchicalReducer() override = default;
+
+  // Establishes the subdivs of the hierarchy for the topology read from the
+  // file named by TF_COLLECTIVE_TOPOLOGY_FILE, if set.  Every member of the
+  // group must see the same topology.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Subdiv 0 lists the host leaders in ring order and subdiv i+1 lists the
+  // devices on the i-th host of that ring, its leader first.  subdiv_rank is
+  // the position of this device in each subdiv, or -1.
+  static Status InitializeSubdivs(const CollectiveTopology& topology,
+                                  CollectiveParams* col_params);
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(
+      std::shared_ptr<CollectiveContext> col_ctx) override;
+
+  // Runs the all-reduce.  Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ private:
+  // A send to or receive from the device at `peer_rank`.
+  struct Transfer {
+    bool send;
+    int peer_rank;
+    string key;
+    Tensor* tensor;
+  };
+
+  Status RunHierarchy();
+
+  // Reduces the output tensors of the devices in `host` onto its leader.
+  Status ReduceWithinHost(const std::vector<int>& host);
+
+  // Ring all-reduce of the output tensor among the host `leaders`, where
+  // this device is at `position`.  Also applies the final op.
+  Status AllReduceAcrossHosts(const std::vector<int>& leaders, int position);
+
+  // Copies the output tensor of the leader of `host` to its other devices.
+  Status BroadcastWithinHost(const std::vector<int>& host);
+
+  // Starts all of `transfers` and waits for them to complete.
+  Status Exchange(const std::vector<Transfer>& transfers);
+
+  // Merges `src` into `dst` with the merge op.
+  Status Merge(Tensor* dst, Tensor* src);
+
+  string BufKey(StringPiece phase, int step, int from_rank, int to_rank) const;
+
+  std::shared_ptr<CollectiveContext> col_ctx_;
+  const CollectiveParams* col_params_;  // Not owned
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
@@ -0,0 +1,181 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/hierarchical_reducer.h"
+
+#include <atomic>
+#include <memory>
+
+#include "tensorflow/core/common_runtime/collective_test_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("bin_op", op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+TEST(CollectiveTopologyTest, Parse) {
+  CollectiveTopology topology;
+  TF_ASSERT_OK(CollectiveTopology::Parse(
+      "# task host rack\n"
+      "/job:worker/replica:0/task:0 host0 rack0\n"
+      "\n"
+      "/job:worker/replica:0/task:1\thost1  # no rack\n",
+      &topology));
+  EXPECT_EQ(topology.locations.size(), 2);
+  EXPECT_EQ(topology.Find("/job:worker/replica:0/task:0").host, "host0");
+  EXPECT_EQ(topology.Find("/job:worker/replica:0/task:0").rack, "rack0");
+  EXPECT_EQ(topology.Find("/job:worker/replica:0/task:1").host, "host1");
+  EXPECT_EQ(topology.Find("/job:worker/replica:0/task:1").rack, "");
+  // Unlisted tasks are their own host.
+  EXPECT_EQ(topology.Find("/job:ps/replica:0/task:0").host,
+            "/job:ps/replica:0/task:0");
+
+  EXPECT_FALSE(CollectiveTopology::Parse("/job:worker/task:0\n", &topology)
+                   .ok());
+  EXPECT_FALSE(
+      CollectiveTopology::Parse("/job:worker/task:0 a b c\n", &topology).ok());
+}
+
+TEST(HierarchicalReducerInitParamsTest, GroupsHostsByRack) {
+  auto test_env = CreateCollectiveTestEnv(/*num_workers=*/4,
+                                          /*num_devices_per_worker=*/2,
+                                          DEVICE_CPU);
+  auto cp = CreateCollectiveParams(*test_env, /*rank=*/1, "HierarchicalReduce",
+                                   REDUCTION_COLLECTIVE, DT_FLOAT,
+                                   TensorShape({8}));
+  CollectiveTopology topology;
+  TF_ASSERT_OK(CollectiveTopology::Parse(
+      "/job:worker/replica:0/task:0 hostA rack1\n"
+      "/job:worker/replica:0/task:1 hostA rack1\n"
+      "/job:worker/replica:0/task:2 hostB rack0\n"
+      "/job:worker/replica:0/task:3 hostC rack1\n",
+      &topology));
+  TF_ASSERT_OK(HierarchicalReducer::InitializeSubdivs(topology, cp.get()));
+  const std::vector<std::vector<int>> expected_perms = {
+      {4, 0, 6}, {4, 5}, {0, 1, 2, 3}, {6, 7}};
+  EXPECT_EQ(cp->instance.impl_details.subdiv_permutations, expected_perms);
+  EXPECT_EQ(cp->subdiv_rank, std::vector<int>({-1, -1, 1, -1}));
+
+  CollectiveTopology split;
+  TF_ASSERT_OK(CollectiveTopology::Parse(
+      "/job:worker/replica:0/task:0 hostA rack0\n"
+      "/job:worker/replica:0/task:1 hostA rack1\n",
+      &split));
+  EXPECT_FALSE(HierarchicalReducer::InitializeSubdivs(split, cp.get()).ok());
+}
+
+class HierarchicalReducerTest : public ::testing::Test {
+ protected:
+  void RunTest(int num_workers, int num_devices, int tensor_len) {
+    auto test_env = CreateCollectiveTestEnv(num_workers, num_devices,
+                                            DEVICE_CPU);
+    const int group_size = num_workers * num_devices;
+    std::vector<std::unique_ptr<DeviceInstance>> instances;
+    std::vector<float> expected(tensor_len, 0.0f);
+    for (int rank = 0; rank < group_size; ++rank) {
+      instances.push_back(std::make_unique<DeviceInstance>(
+          rank, tensor_len, test_env.get()));
+      auto flat = instances.back()->tensor_.flat<float>();
+      for (int i = 0; i < tensor_len; ++i) {
+        flat(i) = rank * 10 + i;
+        expected[i] += flat(i);
+      }
+    }
+    for (float& e : expected) e /= group_size;
+
+    std::atomic<int> done(0);
+    for (auto& instance : instances) {
+      SchedClosure([&instance, &done] {
+        instance->DoReduce();
+        ++done;
+      });
+    }
+    while (done < group_size) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+    for (auto& instance : instances) {
+      TF_EXPECT_OK(instance->status_);
+      test::ExpectTensorNear<float>(test::AsTensor<float>(expected),
+                                    instance->tensor_, 1e-5);
+    }
+  }
+
+  struct DeviceInstance {
+    DeviceInstance(int rank, int tensor_len, CollectiveTestEnv* test_env)
+        : test_env_(test_env), tensor_(DT_FLOAT, TensorShape({tensor_len})) {
+      col_params_ = CreateCollectiveParams(
+          *test_env_, rank, "HierarchicalReduce", REDUCTION_COLLECTIVE,
+          DT_FLOAT, TensorShape({tensor_len}));
+      const string& dev_name = col_params_->group.members[rank].device.name();
+      TF_CHECK_OK(test_env_->device_mgr->LookupDevice(dev_name, &device_));
+      merge_op_ = GetBinOp("Add", DT_FLOAT, device_);
+      final_op_ = GetBinOp("Div", DT_FLOAT, device_);
+      col_params_->merge_op = merge_op_.get();
+      col_params_->final_op = final_op_.get();
+    }
+
+    void DoReduce() {
+      status_ = RunCollective(test_env_, col_params_.get(), device_, &tensor_,
+                              &tensor_);
+    }
+
+    CollectiveTestEnv* test_env_;
+    Tensor tensor_;
+    Device* device_;
+    core::RefCountPtr<CollectiveParams> col_params_;
+    std::unique_ptr<OpKernel> merge_op_;
+    std::unique_ptr<OpKernel> final_op_;
+    Status status_;
+  };
+};
+
+TEST_F(HierarchicalReducerTest, SingleHost) { RunTest(1, 3, 17); }
+
+TEST_F(HierarchicalReducerTest, OneDevicePerHost) { RunTest(3, 1, 1001); }
+
+TEST_F(HierarchicalReducerTest, SeveralDevicesPerHost) { RunTest(3, 2, 128); }
+
+TEST_F(HierarchicalReducerTest, FewerElementsThanHosts) { RunTest(4, 2, 2); }
+
+}  // namespace
+}  // namespace tensorflow
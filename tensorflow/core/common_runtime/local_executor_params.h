@@ -22,6 +22,7 @@ limitations under the License.
 namespace tensorflow {
 
 class Device;
+struct MemoryPlan;
 class StepStatsCollector;
 class SessionMetadata;
 class FunctionLibraryRuntime;
@@ -50,6 +51,9 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // If not null, the outputs of the graph's nodes are allocated as planned.
+  std::shared_ptr<const MemoryPlan> memory_plan;
 };
 
 }  // end namespace tensorflow
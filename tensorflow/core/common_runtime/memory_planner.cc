@@ -0,0 +1,217 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+struct OutputInfo {
+  // The size of the output, or -1 if it is not known statically.
+  int64_t num_bytes = -1;
+  // The first and last positions in the topological order at which the
+  // output's buffer is live.
+  int start = -1;
+  int end = -1;
+  bool escapes = false;
+};
+
+// Returns the size in bytes of output `output` of `node`, or -1 if it is not
+// known statically or the output's buffer cannot be planned.
+int64_t StaticOutputBytes(const ShapeRefiner& refiner, const Node* node,
+                          int output) {
+  const DataType dtype = node->output_type(output);
+  if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype)) return -1;
+  shape_inference::InferenceContext* c = refiner.GetContext(node);
+  if (c == nullptr) return -1;
+  shape_inference::ShapeHandle shape = c->output(output);
+  if (!c->FullyDefined(shape)) return -1;
+  return c->Value(c->NumElements(shape)) * DataTypeSize(dtype);
+}
+
+Status InferOutputSizes(const Graph& graph, const std::vector<Node*>& order,
+                        const std::vector<PartialTensorShape>& arg_shapes,
+                        std::vector<std::vector<OutputInfo>>* outputs) {
+  ShapeRefiner refiner(graph.versions(), graph.op_registry());
+  refiner.set_require_shape_inference_fns(false);
+  for (const Node* node : order) {
+    if (!node->IsOp()) continue;
+    Status s = refiner.AddNode(node);
+    if (!s.ok()) {
+      // The outputs of this node and of the nodes consuming them stay
+      // unplanned.
+      VLOG(2) << "Shape inference failed for " << node->name() << ": " << s;
+      continue;
+    }
+    int index;
+    if (node->IsArg() && GetNodeAttr(node->attrs(), "index", &index).ok() &&
+        index < arg_shapes.size()) {
+      shape_inference::InferenceContext* c = refiner.GetContext(node);
+      shape_inference::ShapeHandle shape;
+      TF_RETURN_IF_ERROR(
+          c->MakeShapeFromPartialTensorShape(arg_shapes[index], &shape));
+      TF_RETURN_IF_ERROR(refiner.SetShape(node, 0, shape));
+    }
+    std::vector<OutputInfo>& node_outputs = (*outputs)[node->id()];
+    for (int i = 0; i < node->num_outputs(); ++i) {
+      node_outputs[i].num_bytes = StaticOutputBytes(refiner, node, i);
+    }
+  }
+  return OkStatus();
+}
+
+// Returns true if a buffer consumed by `node` may outlive the step.
+bool MayRetainInputs(const Node* node) {
+  return !node->IsOp() || node->IsRetval() || node->IsSend() ||
+         node->op_def().is_stateful();
+}
+
+}  // namespace
+
+Status PlanMemory(const Graph& graph,
+                  const std::vector<PartialTensorShape>& arg_shapes,
+                  std::unique_ptr<MemoryPlan>* plan) {
+  *plan = std::make_unique<MemoryPlan>();
+  for (const Node* node : graph.op_nodes()) {
+    if (node->IsControlFlow()) {
+      VLOG(1) << "Not planning memory for a graph with control flow.";
+      return OkStatus();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  std::vector<int> position(graph.num_node_ids());
+  std::vector<std::vector<OutputInfo>> outputs(graph.num_node_ids());
+  for (int i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+    outputs[order[i]->id()].resize(order[i]->num_outputs());
+    for (OutputInfo& output : outputs[order[i]->id()]) {
+      output.start = output.end = i;
+    }
+  }
+  TF_RETURN_IF_ERROR(InferOutputSizes(graph, order, arg_shapes, &outputs));
+
+  // Computes the lifetimes in reverse order, so that the lifetimes of the
+  // consumers' outputs are known. Kernels may forward an input buffer to an
+  // output of the same size, which extends the input buffer's lifetime to the
+  // output's.
+  for (int i = order.size() - 1; i >= 0; --i) {
+    const Node* node = order[i];
+    for (const Edge* edge : node->out_edges()) {
+      if (edge->IsControlEdge()) continue;
+      const Node* dst = edge->dst();
+      OutputInfo& info = outputs[node->id()][edge->src_output()];
+      if (MayRetainInputs(dst)) {
+        info.escapes = true;
+        continue;
+      }
+      info.end = std::max(info.end, position[dst->id()]);
+      for (const OutputInfo& dst_output : outputs[dst->id()]) {
+        if (dst_output.num_bytes == -1 ||
+            dst_output.num_bytes == info.num_bytes) {
+          info.end = std::max(info.end, dst_output.end);
+        }
+      }
+    }
+  }
+
+  struct Candidate {
+    int node_id;
+    int output;
+    OutputInfo info;
+  };
+  std::vector<Candidate> candidates;
+  for (const Node* node : order) {
+    if (!node->IsOp() || node->IsConstant() || node->op_def().is_stateful()) {
+      continue;
+    }
+    for (int i = 0; i < node->num_outputs(); ++i) {
+      const OutputInfo& info = outputs[node->id()][i];
+      if (info.num_bytes > 0 && !info.escapes) {
+        candidates.push_back({node->id(), i, info});
+      }
+    }
+  }
+  // Places the largest buffers first, at the lowest offset that does not
+  // overlap with a placed buffer whose lifetime overlaps.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.info.num_bytes > b.info.num_bytes;
+                   });
+  auto rounded_bytes = [](size_t num_bytes) {
+    return (num_bytes + Allocator::kAllocatorAlignment - 1) &
+           ~(Allocator::kAllocatorAlignment - 1);
+  };
+  std::vector<MemoryPlan::Buffer>& buffers = (*plan)->buffers;
+  buffers.reserve(candidates.size());
+  std::vector<std::pair<size_t, size_t>> live_ranges;
+  size_t unplanned_bytes = 0;
+  for (int i = 0; i < candidates.size(); ++i) {
+    const Candidate& candidate = candidates[i];
+    const size_t num_bytes = rounded_bytes(candidate.info.num_bytes);
+    live_ranges.clear();
+    for (int j = 0; j < i; ++j) {
+      if (candidates[j].info.start <= candidate.info.end &&
+          candidate.info.start <= candidates[j].info.end) {
+        live_ranges.emplace_back(
+            buffers[j].offset,
+            buffers[j].offset + rounded_bytes(buffers[j].num_bytes));
+      }
+    }
+    std::sort(live_ranges.begin(), live_ranges.end());
+    size_t offset = 0;
+    for (const auto& range : live_ranges) {
+      if (offset + num_bytes <= range.first) break;
+      offset = std::max(offset, range.second);
+    }
+    buffers.push_back({candidate.node_id, candidate.output, offset,
+                       static_cast<size_t>(candidate.info.num_bytes)});
+    (*plan)->total_bytes =
+        std::max((*plan)->total_bytes, offset + num_bytes);
+    unplanned_bytes += num_bytes;
+  }
+  for (int i = 0; i < buffers.size(); ++i) {
+    for (int j = i + 1; j < buffers.size(); ++j) {
+      if (buffers[i].offset < buffers[j].offset + buffers[j].num_bytes &&
+          buffers[j].offset < buffers[i].offset + buffers[i].num_bytes) {
+        buffers[i].overlapping.push_back(j);
+        buffers[j].overlapping.push_back(i);
+      }
+    }
+  }
+
+  (*plan)->num_outputs.assign(graph.num_node_ids(), 0);
+  for (const MemoryPlan::Buffer& buffer : buffers) {
+    (*plan)->num_outputs[buffer.node_id] =
+        graph.FindNodeId(buffer.node_id)->num_outputs();
+  }
+  VLOG(1) << "Planned " << buffers.size() << " buffers of "
+          << unplanned_bytes << " bytes into " << (*plan)->total_bytes
+          << " bytes.";
+  return OkStatus();
+}
+
+}  // namespace tensorflow
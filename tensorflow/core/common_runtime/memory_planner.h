@@ -0,0 +1,44 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/planned_memory.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+
+// Plans the outputs of the nodes in `graph` whose sizes are known statically
+// into one region, similarly to TFLite's ArenaPlanner. Outputs whose lifetimes
+// do not overlap in a topological order of the graph share memory.
+//
+// Sizes come from shape inference. `arg_shapes` optionally gives the shapes of
+// the graph's `_Arg` nodes, indexed by the `index` attr. The outputs of
+// stateful nodes and constants, and outputs consumed by stateful nodes,
+// `_Retval` or `_Send` nodes, are not planned, because they may outlive the
+// step. Graphs with control flow are not planned at all.
+Status PlanMemory(const Graph& graph,
+                  const std::vector<PartialTensorShape>& arg_shapes,
+                  std::unique_ptr<MemoryPlan>* plan);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
@@ -0,0 +1,188 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/planned_memory.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Builds `Neg(Fill([16, 16], Sum(Sum(Neg(x), 1), 0)))` with `x` a 16x16 arg,
+// so that the first `Neg` is dead by the time `Fill` runs.
+std::unique_ptr<Graph> MakeGraph(std::vector<Node*>* planned_nodes) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* x = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  Node* b = test::graph::Unary(g.get(), "Neg", x);
+  Node* c = test::graph::Reduce(
+      g.get(), "Sum", b, test::graph::Constant(g.get(), test::AsScalar(1)));
+  Node* s = test::graph::Reduce(
+      g.get(), "Sum", c, test::graph::Constant(g.get(), test::AsScalar(0)));
+  Node* d;
+  TF_CHECK_OK(NodeBuilder("fill", "Fill")
+                  .Input(test::graph::Constant(
+                      g.get(), test::AsTensor<int32>({16, 16})))
+                  .Input(s)
+                  .Finalize(g.get(), &d));
+  Node* e = test::graph::Unary(g.get(), "Neg", d);
+  test::graph::Retval(g.get(), 0, e);
+  *planned_nodes = {b, c, s, d};
+  return g;
+}
+
+const MemoryPlan::Buffer* FindBuffer(const MemoryPlan& plan,
+                                     const Node* node) {
+  for (const MemoryPlan::Buffer& buffer : plan.buffers) {
+    if (buffer.node_id == node->id()) return &buffer;
+  }
+  return nullptr;
+}
+
+TEST(MemoryPlannerTest, SharesBuffersWithDisjointLifetimes) {
+  std::vector<Node*> nodes;
+  std::unique_ptr<Graph> g = MakeGraph(&nodes);
+  std::unique_ptr<MemoryPlan> plan;
+  TF_ASSERT_OK(PlanMemory(*g, {PartialTensorShape({16, 16})}, &plan));
+
+  // The output of the last `Neg` is returned, so it is not planned.
+  ASSERT_EQ(plan->buffers.size(), 4);
+  const MemoryPlan::Buffer* neg = FindBuffer(*plan, nodes[0]);
+  const MemoryPlan::Buffer* sum = FindBuffer(*plan, nodes[1]);
+  const MemoryPlan::Buffer* scalar_sum = FindBuffer(*plan, nodes[2]);
+  const MemoryPlan::Buffer* fill = FindBuffer(*plan, nodes[3]);
+  ASSERT_TRUE(neg && sum && scalar_sum && fill);
+  EXPECT_EQ(neg->num_bytes, 1024);
+  EXPECT_EQ(sum->num_bytes, 64);
+  EXPECT_EQ(scalar_sum->num_bytes, 4);
+  EXPECT_EQ(fill->num_bytes, 1024);
+
+  EXPECT_EQ(neg->offset, 0);
+  EXPECT_EQ(fill->offset, 0);
+  EXPECT_EQ(sum->offset, 1024);
+  EXPECT_EQ(scalar_sum->offset, 1088);
+  EXPECT_EQ(plan->total_bytes, 1152);
+  EXPECT_EQ(neg->overlapping.size(), 1);
+  EXPECT_EQ(plan->num_outputs[nodes[3]->id()], 1);
+}
+
+TEST(MemoryPlannerTest, OnlyStaticSizesArePlanned) {
+  std::vector<Node*> nodes;
+  std::unique_ptr<Graph> g = MakeGraph(&nodes);
+  std::unique_ptr<MemoryPlan> plan;
+  TF_ASSERT_OK(PlanMemory(*g, {}, &plan));
+  // Only the shape of `Fill` does not depend on the arg.
+  ASSERT_EQ(plan->buffers.size(), 1);
+  EXPECT_EQ(plan->buffers[0].node_id, nodes[3]->id());
+}
+
+// Forwards to aligned malloc and counts the live buffers.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_live_;
+    return port::AlignedMalloc(num_bytes, alignment);
+  }
+  void DeallocateRaw(void* ptr) override {
+    --num_live_;
+    port::AlignedFree(ptr);
+  }
+  int num_live() const { return num_live_; }
+
+ private:
+  std::atomic<int> num_live_{0};
+};
+
+// Two single-output nodes, 0 and 1, whose buffers share memory.
+std::shared_ptr<const MemoryPlan> MakeSharedPlan() {
+  auto plan = std::make_shared<MemoryPlan>();
+  plan->buffers = {{0, 0, 0, 64, {1}}, {1, 0, 0, 64, {0}}};
+  plan->num_outputs = {1, 1};
+  plan->total_bytes = 64;
+  return plan;
+}
+
+TEST(PlannedMemoryTest, OverlappingBuffersAreNotSharedWhileInUse) {
+  CountingAllocator base;
+  PlannedMemoryPool pool(MakeSharedPlan(), &base);
+  PlannedMemory* memory = pool.Acquire();
+  Allocator* first = memory->output_allocators(0)[0];
+  Allocator* second = memory->output_allocators(1)[0];
+  EXPECT_EQ(memory->output_allocators(2), nullptr);
+
+  void* p = first->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+  EXPECT_EQ(base.num_live(), 1);
+  // The overlapping buffer is in use, so the second allocator falls back.
+  void* q = second->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+  EXPECT_NE(p, q);
+  EXPECT_EQ(base.num_live(), 2);
+  second->DeallocateRaw(q);
+  first->DeallocateRaw(p);
+  EXPECT_EQ(second->AllocateRaw(Allocator::kAllocatorAlignment, 64), p);
+  second->DeallocateRaw(p);
+
+  // So does a request of a different size than planned.
+  q = first->AllocateRaw(Allocator::kAllocatorAlignment, 32);
+  EXPECT_NE(p, q);
+  first->DeallocateRaw(q);
+  pool.Release(memory);
+
+  // The next step reuses the region.
+  PlannedMemory* next = pool.Acquire();
+  EXPECT_EQ(next, memory);
+  {
+    Tensor t(next->output_allocators(0)[0], DT_FLOAT, TensorShape({16}));
+    EXPECT_EQ(t.tensor_data().data(), p);
+  }
+  pool.Release(next);
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+TEST(PlannedMemoryTest, BufferOutlivingStepIsNoLongerPlanned) {
+  CountingAllocator base;
+  PlannedMemoryPool pool(MakeSharedPlan(), &base);
+  PlannedMemory* memory = pool.Acquire();
+  Allocator* allocator = memory->output_allocators(0)[0];
+  void* p = allocator->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+  pool.Release(memory);
+
+  // The escaped buffer keeps its region alive, and it is not handed out by
+  // later steps.
+  PlannedMemory* next = pool.Acquire();
+  EXPECT_NE(next, memory);
+  EXPECT_EQ(base.num_live(), 2);
+  Allocator* next_allocator = next->output_allocators(0)[0];
+  void* q = next_allocator->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+  EXPECT_EQ(base.num_live(), 3);
+  next_allocator->DeallocateRaw(q);
+  pool.Release(next);
+
+  allocator->DeallocateRaw(p);
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,108 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/partitioned_graph_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+// Appends the deterministic serialization of `proto` to `*out`, prefixed by
+// its length so that the fields of the key cannot run into each other.
+void AppendProto(const protobuf::MessageLite& proto, std::string* out) {
+  std::string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  strings::StrAppend(out, serialized.size(), ":", serialized);
+}
+
+void AppendString(const std::string& s, std::string* out) {
+  strings::StrAppend(out, s.size(), ":", s);
+}
+
+}  // namespace
+
+PartitionedGraphCache::PartitionedGraphCache(Env* env,
+                                             const std::string& directory)
+    : env_(env), directory_(directory) {}
+
+std::string PartitionedGraphCache::ComputeKey(
+    const GraphDef& graph, const ConfigProto& config,
+    const std::vector<Device*>& devices,
+    const std::unordered_map<std::string, std::string>& stateful_placements,
+    const CallableOptions& callable_options, bool use_function_convention) {
+  std::string data;
+  AppendString(TF_VERSION_STRING, &data);
+  strings::StrAppend(&data, TF_GRAPH_DEF_VERSION, ";");
+  AppendProto(graph, &data);
+  AppendProto(config, &data);
+  for (const Device* device : devices) {
+    AppendString(device->name(), &data);
+    AppendString(device->device_type(), &data);
+  }
+  std::vector<std::pair<std::string, std::string>> placements(
+      stateful_placements.begin(), stateful_placements.end());
+  std::sort(placements.begin(), placements.end());
+  for (const auto& placement : placements) {
+    AppendString(placement.first, &data);
+    AppendString(placement.second, &data);
+  }
+  AppendProto(callable_options, &data);
+  strings::StrAppend(&data, use_function_convention);
+
+  const Fprint128 fingerprint = Fingerprint128(data);
+  return strings::StrCat(strings::Hex(fingerprint.high64, strings::kZeroPad16),
+                         strings::Hex(fingerprint.low64, strings::kZeroPad16));
+}
+
+Status PartitionedGraphCache::Lookup(const std::string& key,
+                                     PartitionedGraphCacheEntry* entry) const {
+  const std::string path = EntryPath(key);
+  TF_RETURN_IF_ERROR(env_->FileExists(path));
+  return ReadBinaryProto(env_, path, entry);
+}
+
+Status PartitionedGraphCache::Insert(
+    const std::string& key, const PartitionedGraphCacheEntry& entry) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+  // Write to a temporary file first, so that readers never see a partially
+  // written entry.
+  const std::string path = EntryPath(key);
+  const std::string temp_path =
+      strings::StrCat(path, ".tmp", strings::Hex(random::New64()));
+  Status s = WriteBinaryProto(env_, temp_path, entry);
+  if (s.ok()) {
+    s = env_->RenameFile(temp_path, path);
+  }
+  if (!s.ok()) {
+    env_->DeleteFile(temp_path).IgnoreError();
+  }
+  return s;
+}
+
+std::string PartitionedGraphCache::EntryPath(const std::string& key) const {
+  return io::JoinPath(directory_, strings::StrCat(key, ".pb"));
+}
+
+}  // namespace tensorflow
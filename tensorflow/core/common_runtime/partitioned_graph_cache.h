@@ -0,0 +1,75 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PARTITIONED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_PARTITIONED_GRAPH_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/graph_cache.pb.h"
+
+namespace tensorflow {
+
+// An on-disk cache of the partitioned graphs of DirectSession callables.
+//
+// Building the executors of a callable prunes, places, optimizes and
+// partitions the session graph, which can take a long time for large graphs.
+// A session created later for the same graph, config, devices and callable,
+// e.g. after reloading a model, reads the resulting partition graphs from the
+// cache instead and goes straight to creating the executors.
+//
+// Entries are files named after the key, and are written atomically, so a
+// directory may be shared by concurrent sessions and processes.
+class PartitionedGraphCache {
+ public:
+  PartitionedGraphCache(Env* env, const std::string& directory);
+
+  // Returns the key of the partition graphs built for `callable_options` from
+  // `graph` in a session with the given `config` and `devices`, where the
+  // stateful nodes already placed are in `stateful_placements`.
+  static std::string ComputeKey(
+      const GraphDef& graph, const ConfigProto& config,
+      const std::vector<Device*>& devices,
+      const std::unordered_map<std::string, std::string>& stateful_placements,
+      const CallableOptions& callable_options, bool use_function_convention);
+
+  // Reads the entry for `key` into `*entry`. Returns a NotFound error if there
+  // is none.
+  Status Lookup(const std::string& key,
+                PartitionedGraphCacheEntry* entry) const;
+
+  // Writes `entry` for `key`, replacing any existing entry.
+  Status Insert(const std::string& key,
+                const PartitionedGraphCacheEntry& entry) const;
+
+ private:
+  std::string EntryPath(const std::string& key) const;
+
+  Env* const env_;
+  const std::string directory_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PartitionedGraphCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_PARTITIONED_GRAPH_CACHE_H_
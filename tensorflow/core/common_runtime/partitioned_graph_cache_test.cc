@@ -0,0 +1,72 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/partitioned_graph_cache.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(PartitionedGraphCacheTest, InsertAndLookup) {
+  PartitionedGraphCache cache(
+      Env::Default(),
+      io::JoinPath(testing::TmpDir(), "partitioned_graph_cache_test"));
+  PartitionedGraphCacheEntry entry;
+  EXPECT_TRUE(errors::IsNotFound(cache.Lookup("missing", &entry)));
+
+  (*entry.mutable_partition_graphs())["/device:CPU:0"].add_node()->set_name(
+      "a");
+  entry.add_feed_types(DT_FLOAT);
+  entry.set_collective_graph_key(7);
+  TF_ASSERT_OK(cache.Insert("key", entry));
+
+  PartitionedGraphCacheEntry read_entry;
+  TF_ASSERT_OK(cache.Lookup("key", &read_entry));
+  EXPECT_EQ(read_entry.DebugString(), entry.DebugString());
+
+  // Inserting again replaces the entry.
+  entry.set_collective_graph_key(8);
+  TF_ASSERT_OK(cache.Insert("key", entry));
+  TF_ASSERT_OK(cache.Lookup("key", &read_entry));
+  EXPECT_EQ(read_entry.collective_graph_key(), 8);
+}
+
+TEST(PartitionedGraphCacheTest, KeyDependsOnCallable) {
+  GraphDef graph;
+  graph.add_node()->set_name("a");
+  ConfigProto config;
+  CallableOptions callable_options;
+  callable_options.add_fetch("a:0");
+  const string key = PartitionedGraphCache::ComputeKey(
+      graph, config, {}, {}, callable_options, true);
+  EXPECT_EQ(key, PartitionedGraphCache::ComputeKey(graph, config, {}, {},
+                                                   callable_options, true));
+  EXPECT_NE(key, PartitionedGraphCache::ComputeKey(graph, config, {}, {},
+                                                   callable_options, false));
+  EXPECT_NE(key, PartitionedGraphCache::ComputeKey(
+                     graph, config, {}, {{"a", "/device:CPU:0"}},
+                     callable_options, true));
+
+  callable_options.add_feed("b:0");
+  EXPECT_NE(key, PartitionedGraphCache::ComputeKey(graph, config, {}, {},
+                                                   callable_options, true));
+}
+
+}  // namespace
+}  // namespace tensorflow
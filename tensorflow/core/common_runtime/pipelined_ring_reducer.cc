@@ -0,0 +1,307 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/pipelined_ring_reducer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+std::atomic<int64_t> segment_bytes_for_testing(0);
+
+}  // namespace
+
+PipelinedRingReducer::PipelinedRingReducer()
+    : col_ctx_(nullptr), col_params_(nullptr) {}
+
+/*static*/
+int64_t PipelinedRingReducer::SegmentElements(DataType dtype) {
+  static const int64_t segment_bytes = [] {
+    int64_t bytes;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_COLLECTIVE_PIPELINE_SEGMENT_BYTES",
+                                    256 << 10, &bytes));
+    return bytes;
+  }();
+  const int64_t override_bytes = segment_bytes_for_testing.load();
+  return std::max<int64_t>(
+      1, (override_bytes > 0 ? override_bytes : segment_bytes) /
+             DataTypeSize(dtype));
+}
+
+/*static*/
+void PipelinedRingReducer::SetSegmentBytesForTesting(int64_t bytes) {
+  segment_bytes_for_testing.store(bytes);
+}
+
+Status PipelinedRingReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  if (col_params->instance.type != REDUCTION_COLLECTIVE) {
+    return errors::InvalidArgument(
+        "PipelinedRingReduce only implements reductions");
+  }
+  if (col_params->group.device_type != DEVICE_CPU) {
+    return errors::InvalidArgument(
+        "PipelinedRingReduce only supports CPU devices, got ",
+        col_params->group.device_type.type_string());
+  }
+  std::vector<int> ring(col_params->group.group_size);
+  for (int rank = 0; rank < ring.size(); ++rank) ring[rank] = rank;
+  col_params->instance.impl_details.subdiv_permutations = {ring};
+  col_params->subdiv_rank = {col_params->default_rank};
+  return OkStatus();
+}
+
+Status PipelinedRingReducer::InitializeCollectiveContext(
+    std::shared_ptr<CollectiveContext> col_ctx) {
+  DCHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = col_ctx->col_params.get();
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void PipelinedRingReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Like `RingReducer`, this does not require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    Notification note;
+    Status status;
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    if (!status.ok()) {
+      done(status);
+      return;
+    }
+  }
+
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+  std::unique_ptr<CollectiveAdapter> ca(MakeCollectiveAdapter(
+      col_ctx_->output, col_params_->group.group_size, allocator));
+  Status s = RunPipeline(ca.get());
+  if (!s.ok()) {
+    // Peers may be waiting on this device, and transfers of this device may
+    // be waiting on them, so abort unless a cancellation is already
+    // reaching everyone.
+    CancellationManager* cancel_mgr = col_ctx_->op_ctx->cancellation_manager();
+    if (cancel_mgr == nullptr ||
+        (!cancel_mgr->IsCancelled() && !cancel_mgr->IsCancelling())) {
+      col_ctx_->col_exec->StartAbort(s);
+    }
+  }
+  s.Update(Drain());
+  ca->ConsumeFinalValue(col_ctx_->output);
+  if (s.ok() && col_params_->group.group_size == 1 && col_params_->final_op) {
+    Tensor group_size = ca->Scalar(1);
+    s = collective_util::ComputeBinOp(
+        col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+        col_params_->final_op, col_ctx_->output, &group_size);
+  }
+  done(s);
+}
+
+Status PipelinedRingReducer::RunPipeline(CollectiveAdapter* ca) {
+  const int group_size = col_params_->group.group_size;
+  if (group_size == 1) return OkStatus();
+  const int rank = col_params_->default_rank;
+  const int next = (rank + 1) % group_size;
+  const int prev = (rank + group_size - 1) % group_size;
+
+  // Chunks are the same size on every device, so every device agrees on the
+  // segments of each chunk.
+  const int64_t segment_elements =
+      SegmentElements(col_params_->instance.data_type);
+  int64_t max_segment = 0;
+  segments_.assign(group_size, {});
+  for (int c = 0; c < group_size; ++c) {
+    Tensor chunk = ca->ChunkAlias(c);
+    const int64_t len = chunk.NumElements();
+    for (int64_t start = 0; start < len; start += segment_elements) {
+      const int64_t end = std::min(len, start + segment_elements);
+      segments_[c].push_back(chunk.Slice(start, end));
+      max_segment = std::max(max_segment, end - start);
+    }
+  }
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+  for (Tensor& staging : staging_) {
+    staging = Tensor(allocator, col_params_->instance.data_type,
+                     TensorShape({max_segment}));
+  }
+  Tensor group_size_tensor = ca->Scalar(group_size);
+
+  // The first reduce-scatter step sends this device's own chunk.
+  for (int i = 0; i < segments_[rank].size(); ++i) {
+    Send("scatter", 0, i, next, &segments_[rank][i]);
+  }
+  TF_RETURN_IF_ERROR(RunPhase(/*scatter=*/true, prev, next, group_size_tensor));
+  return RunPhase(/*scatter=*/false, prev, next, group_size_tensor);
+}
+
+Status PipelinedRingReducer::RunPhase(bool scatter, int prev, int next,
+                                      const Tensor& group_size_tensor) {
+  const int group_size = col_params_->group.group_size;
+  const int rank = col_params_->default_rank;
+  const int last_step = group_size - 2;
+  const StringPiece phase = scatter ? "scatter" : "gather";
+  // At reduce-scatter step s this device receives the partial sum of chunk
+  // rank - s - 1 and at all-gather step s the complete chunk rank - s. Each
+  // received segment is what the next step sends on.
+  auto recv_chunk = [=](int step) {
+    return (rank - step - (scatter ? 1 : 0) + 2 * group_size) % group_size;
+  };
+  struct Op {
+    int step;
+    int segment;
+  };
+  std::vector<Op> ops;
+  for (int step = 0; step <= last_step; ++step) {
+    for (int i = 0; i < segments_[recv_chunk(step)].size(); ++i) {
+      ops.push_back({step, i});
+    }
+  }
+  auto start_recv = [&](int j) {
+    const Tensor& segment = segments_[recv_chunk(ops[j].step)][ops[j].segment];
+    // Reduce-scatter segments are staged and merged, all-gather segments are
+    // received in place.
+    Tensor target =
+        scatter ? staging_[j % 2].Slice(0, segment.NumElements()) : segment;
+    return Recv(phase, ops[j].step, ops[j].segment, prev, target);
+  };
+
+  InFlight* current = ops.empty() ? nullptr : start_recv(0);
+  for (int j = 0; j < ops.size(); ++j) {
+    // Keep the next receive in flight, into the other staging buffer, while
+    // this segment is reduced.
+    InFlight* upcoming = j + 1 < ops.size() ? start_recv(j + 1) : nullptr;
+    current->done.WaitForNotification();
+    TF_RETURN_IF_ERROR(current->status);
+    const int step = ops[j].step;
+    const int i = ops[j].segment;
+    Tensor* segment = &segments_[recv_chunk(step)][i];
+    if (scatter) {
+      TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+          col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+          col_params_->merge_op, segment, &current->target));
+      if (step < last_step) {
+        Send("scatter", step + 1, i, next, segment);
+      } else {
+        // This segment now holds its complete sum. Finalize it before it
+        // starts the all-gather.
+        if (col_params_->final_op) {
+          Tensor group_size = group_size_tensor;
+          TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+              col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+              col_params_->final_op, segment, &group_size));
+        }
+        Send("gather", 0, i, next, segment);
+      }
+    } else if (step < last_step) {
+      Send("gather", step + 1, i, next, segment);
+    }
+    current = upcoming;
+  }
+  return OkStatus();
+}
+
+void PipelinedRingReducer::Send(StringPiece phase, int step, int segment,
+                                int to_rank, const Tensor* tensor) {
+  in_flight_.push_back(std::make_unique<InFlight>());
+  InFlight* transfer = in_flight_.back().get();
+  const CollGroupMember& peer = col_params_->group.members[to_rank];
+  col_ctx_->col_exec->remote_access()->PostToPeer(
+      peer.device.name(), peer.task,
+      BufKey(phase, step, segment, col_params_->default_rank, to_rank),
+      col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), tensor,
+      col_ctx_->device_locality, col_ctx_->op_ctx->cancellation_manager(),
+      [transfer](const Status& s) {
+        transfer->status = s;
+        transfer->done.Notify();
+      });
+}
+
+PipelinedRingReducer::InFlight* PipelinedRingReducer::Recv(
+    StringPiece phase, int step, int segment, int from_rank,
+    const Tensor& target) {
+  in_flight_.push_back(std::make_unique<InFlight>());
+  InFlight* transfer = in_flight_.back().get();
+  transfer->target = target;
+  const CollGroupMember& peer = col_params_->group.members[from_rank];
+  col_ctx_->col_exec->remote_access()->RecvFromPeer(
+      peer.device.name(), peer.task, peer.is_local,
+      BufKey(phase, step, segment, from_rank, col_params_->default_rank),
+      col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), &transfer->target,
+      col_ctx_->device_locality, 0 /*dev_to_dev_stream_index*/,
+      col_ctx_->op_ctx->cancellation_manager(), [transfer](const Status& s) {
+        transfer->status = s;
+        transfer->done.Notify();
+      });
+  return transfer;
+}
+
+Status PipelinedRingReducer::Drain() {
+  Status status;
+  for (const std::unique_ptr<InFlight>& transfer : in_flight_) {
+    transfer->done.WaitForNotification();
+    status.Update(transfer->status);
+  }
+  in_flight_.clear();
+  return status;
+}
+
+string PipelinedRingReducer::BufKey(StringPiece phase, int step, int segment,
+                                    int from_rank, int to_rank) const {
+  return strings::StrCat("PipelinedRingReduce:", col_ctx_->exec_key, ":",
+                         phase, ":", step, ":", segment, ":", from_rank, ":",
+                         to_rank);
+}
+
+namespace {
+REGISTER_COLLECTIVE(PipelinedRingReduce, PipelinedRingReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,102 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PIPELINED_RING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_PIPELINED_RING_REDUCER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/lib/core/notification.h"
+
+namespace tensorflow {
+
+// Ring all-reduce for CPU devices that streams each chunk around the ring in
+// fixed-size segments, selected with the communication hint "pipelined".
+//
+// RingReducer moves a whole chunk per ring step and only starts reducing it
+// once it has fully arrived. Here the receive of segment i + 1 is in flight,
+// into the second of two staging buffers, while segment i is reduced, and
+// each reduced segment is passed on to the next device immediately, so
+// consecutive ring steps overlap as well. The segment size is read once from
+// TF_COLLECTIVE_PIPELINE_SEGMENT_BYTES and must be the same on every worker.
+class PipelinedRingReducer : public CollectiveImplementationInterface {
+ public:
+  PipelinedRingReducer();
+  ~PipelinedRingReducer() override = default;
+
+  // Establishes a single ring in default rank order.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(
+      std::shared_ptr<CollectiveContext> col_ctx) override;
+
+  // Runs the all-reduce.  Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+  // Number of elements of `dtype` per segment.
+  static int64_t SegmentElements(DataType dtype);
+
+  // Overrides TF_COLLECTIVE_PIPELINE_SEGMENT_BYTES for this process while
+  // `bytes` is positive.
+  static void SetSegmentBytesForTesting(int64_t bytes);
+
+ private:
+  // A send or receive that has been started and not yet waited for.
+  struct InFlight {
+    Notification done;
+    Status status;
+    // Receive target; a view of a staging buffer or of the output.
+    Tensor target;
+  };
+
+  Status RunPipeline(CollectiveAdapter* ca);
+
+  // Reduce-scatter if `scatter`, else all-gather, with this device receiving
+  // from `prev` and sending to `next`.
+  Status RunPhase(bool scatter, int prev, int next,
+                  const Tensor& group_size_tensor);
+
+  // Starts sending `tensor`, which must stay valid until Drain().
+  void Send(StringPiece phase, int step, int segment, int to_rank,
+            const Tensor* tensor);
+  // Starts receiving into `target`, which must alias memory that stays valid
+  // until the returned transfer is done.
+  InFlight* Recv(StringPiece phase, int step, int segment, int from_rank,
+                 const Tensor& target);
+
+  // Waits for every transfer that is still in flight.
+  Status Drain();
+
+  string BufKey(StringPiece phase, int step, int segment, int from_rank,
+                int to_rank) const;
+
+  std::shared_ptr<CollectiveContext> col_ctx_;
+  const CollectiveParams* col_params_;  // Not owned
+  // segments_[c][i] aliases segment i of chunk c of the output.
+  std::vector<std::vector<Tensor>> segments_;
+  // Double buffer for segments received during the reduce-scatter.
+  Tensor staging_[2];
+  std::vector<std::unique_ptr<InFlight>> in_flight_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_PIPELINED_RING_REDUCER_H_
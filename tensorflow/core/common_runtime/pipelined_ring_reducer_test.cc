@@ -0,0 +1,235 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/pipelined_ring_reducer.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_test_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("bin_op", op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+struct DeviceInstance {
+  DeviceInstance(int rank, int tensor_len, const string& collective_name,
+                 CollectiveTestEnv* test_env)
+      : test_env_(test_env), tensor_(DT_FLOAT, TensorShape({tensor_len})) {
+    col_params_ = CreateCollectiveParams(*test_env_, rank, collective_name,
+                                         REDUCTION_COLLECTIVE, DT_FLOAT,
+                                         TensorShape({tensor_len}));
+    const string& dev_name = col_params_->group.members[rank].device.name();
+    TF_CHECK_OK(test_env_->device_mgr->LookupDevice(dev_name, &device_));
+    merge_op_ = GetBinOp("Add", DT_FLOAT, device_);
+    final_op_ = GetBinOp("Div", DT_FLOAT, device_);
+    col_params_->merge_op = merge_op_.get();
+    col_params_->final_op = final_op_.get();
+  }
+
+  void DoReduce() {
+    status_ = RunCollective(test_env_, col_params_.get(), device_, &tensor_,
+                            &tensor_);
+  }
+
+  CollectiveTestEnv* test_env_;
+  Tensor tensor_;
+  Device* device_;
+  core::RefCountPtr<CollectiveParams> col_params_;
+  std::unique_ptr<OpKernel> merge_op_;
+  std::unique_ptr<OpKernel> final_op_;
+  Status status_;
+};
+
+// Runs one all-reduce on every device of `test_env` concurrently.
+void RunAllReduce(
+    const std::vector<std::unique_ptr<DeviceInstance>>& instances) {
+  BlockingCounter done(instances.size());
+  for (auto& instance : instances) {
+    SchedClosure([&instance, &done] {
+      instance->DoReduce();
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+}
+
+class PipelinedRingReducerTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    PipelinedRingReducer::SetSegmentBytesForTesting(0);
+  }
+
+  void RunTest(int num_workers, int num_devices, int tensor_len,
+               int segment_bytes) {
+    PipelinedRingReducer::SetSegmentBytesForTesting(segment_bytes);
+    auto test_env = CreateCollectiveTestEnv(num_workers, num_devices,
+                                            DEVICE_CPU);
+    const int group_size = num_workers * num_devices;
+    std::vector<std::unique_ptr<DeviceInstance>> instances;
+    std::vector<float> expected(tensor_len, 0.0f);
+    for (int rank = 0; rank < group_size; ++rank) {
+      instances.push_back(std::make_unique<DeviceInstance>(
+          rank, tensor_len, "PipelinedRingReduce", test_env.get()));
+      auto flat = instances.back()->tensor_.flat<float>();
+      for (int i = 0; i < tensor_len; ++i) {
+        flat(i) = rank * 10 + i;
+        expected[i] += flat(i);
+      }
+    }
+    for (float& e : expected) e /= group_size;
+
+    RunAllReduce(instances);
+    for (auto& instance : instances) {
+      TF_EXPECT_OK(instance->status_);
+      test::ExpectTensorNear<float>(test::AsTensor<float>(expected),
+                                    instance->tensor_, 1e-5);
+    }
+  }
+};
+
+TEST(PipelinedRingReducerParamsTest, SingleRing) {
+  auto test_env = CreateCollectiveTestEnv(/*num_workers=*/2,
+                                          /*num_devices_per_worker=*/2,
+                                          DEVICE_CPU);
+  auto cp = CreateCollectiveParams(*test_env, /*rank=*/2,
+                                   "PipelinedRingReduce", REDUCTION_COLLECTIVE,
+                                   DT_FLOAT, TensorShape({8}));
+  PipelinedRingReducer reducer;
+  TF_ASSERT_OK(reducer.InitializeCollectiveParams(cp.get()));
+  EXPECT_EQ(cp->instance.impl_details.subdiv_permutations,
+            std::vector<std::vector<int>>({{0, 1, 2, 3}}));
+  EXPECT_EQ(cp->subdiv_rank, std::vector<int>({2}));
+}
+
+TEST(PipelinedRingReducerParamsTest, SegmentElements) {
+  PipelinedRingReducer::SetSegmentBytesForTesting(64);
+  EXPECT_EQ(16, PipelinedRingReducer::SegmentElements(DT_FLOAT));
+  EXPECT_EQ(8, PipelinedRingReducer::SegmentElements(DT_DOUBLE));
+  PipelinedRingReducer::SetSegmentBytesForTesting(2);
+  EXPECT_EQ(1, PipelinedRingReducer::SegmentElements(DT_DOUBLE));
+  PipelinedRingReducer::SetSegmentBytesForTesting(0);
+}
+
+TEST_F(PipelinedRingReducerTest, SingleDevice) { RunTest(1, 1, 9, 16); }
+
+TEST_F(PipelinedRingReducerTest, OneSegmentPerChunk) {
+  RunTest(1, 4, 16, 1 << 20);
+}
+
+TEST_F(PipelinedRingReducerTest, ManySegmentsPerChunk) {
+  RunTest(1, 3, 1001, 64);
+}
+
+TEST_F(PipelinedRingReducerTest, MultiWorker) { RunTest(2, 2, 517, 32); }
+
+TEST_F(PipelinedRingReducerTest, FewerElementsThanDevices) {
+  RunTest(2, 3, 4, 4);
+}
+
+// Benchmarks a ring all-reduce over (group size, tensor elements), e.g. with
+//   --benchmark_filter=BM_.*RingReduce
+void BM_AllReduce(::testing::benchmark::State& state,
+                  const string& collective_name) {
+  const int group_size = state.range(0);
+  const int tensor_len = state.range(1);
+  auto test_env = CreateCollectiveTestEnv(/*num_workers=*/1, group_size,
+                                          DEVICE_CPU);
+  for (auto s : state) {
+    state.PauseTiming();
+    std::vector<std::unique_ptr<DeviceInstance>> instances;
+    for (int rank = 0; rank < group_size; ++rank) {
+      instances.push_back(std::make_unique<DeviceInstance>(
+          rank, tensor_len, collective_name, test_env.get()));
+      instances.back()->tensor_.flat<float>().setConstant(rank);
+    }
+    state.ResumeTiming();
+    RunAllReduce(instances);
+    for (auto& instance : instances) TF_CHECK_OK(instance->status_);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          tensor_len * sizeof(float));
+}
+
+void BM_RingReduce(::testing::benchmark::State& state) {
+  BM_AllReduce(state, "RingReduce");
+}
+
+void BM_PipelinedRingReduce(::testing::benchmark::State& state) {
+  BM_AllReduce(state, "PipelinedRingReduce");
+}
+
+BENCHMARK(BM_RingReduce)
+    ->UseRealTime()
+    ->ArgPair(2, 1 << 10)
+    ->ArgPair(2, 1 << 16)
+    ->ArgPair(2, 1 << 20)
+    ->ArgPair(2, 1 << 22)
+    ->ArgPair(4, 1 << 10)
+    ->ArgPair(4, 1 << 16)
+    ->ArgPair(4, 1 << 20)
+    ->ArgPair(4, 1 << 22)
+    ->ArgPair(8, 1 << 10)
+    ->ArgPair(8, 1 << 16)
+    ->ArgPair(8, 1 << 20)
+    ->ArgPair(8, 1 << 22);
+
+BENCHMARK(BM_PipelinedRingReduce)
+    ->UseRealTime()
+    ->ArgPair(2, 1 << 10)
+    ->ArgPair(2, 1 << 16)
+    ->ArgPair(2, 1 << 20)
+    ->ArgPair(2, 1 << 22)
+    ->ArgPair(4, 1 << 10)
+    ->ArgPair(4, 1 << 16)
+    ->ArgPair(4, 1 << 20)
+    ->ArgPair(4, 1 << 22)
+    ->ArgPair(8, 1 << 10)
+    ->ArgPair(8, 1 << 16)
+    ->ArgPair(8, 1 << 20)
+    ->ArgPair(8, 1 << 22);
+
+}  // namespace
+}  // namespace tensorflow
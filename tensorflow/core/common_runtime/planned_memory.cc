@@ -0,0 +1,191 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/planned_memory.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// Serves the planned buffer at index `index` of the plan.
+class PlannedMemory::BufferAllocator : public Allocator {
+ public:
+  BufferAllocator(PlannedMemory* memory, int index)
+      : memory_(memory),
+        index_(index),
+        buffer_(memory->plan_->buffers[index]),
+        ptr_(memory->region_ + buffer_.offset) {}
+
+  std::string Name() override { return "planned_memory"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    memory_->refs_.fetch_add(1, std::memory_order_relaxed);
+    if (num_bytes == buffer_.num_bytes &&
+        alignment <= Allocator::kAllocatorAlignment &&
+        memory_->TryAcquire(index_)) {
+      return ptr_;
+    }
+    void* ptr = memory_->base_allocator_->AllocateRaw(alignment, num_bytes);
+    if (ptr == nullptr) {
+      memory_->Unref();
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (ptr == ptr_) {
+      memory_->ReleaseBuffer(index_);
+    } else {
+      memory_->base_allocator_->DeallocateRaw(ptr);
+    }
+    memory_->Unref();
+  }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return memory_->base_allocator_->GetMemoryType();
+  }
+
+ private:
+  PlannedMemory* const memory_;
+  const int index_;
+  const MemoryPlan::Buffer& buffer_;
+  void* const ptr_;
+};
+
+PlannedMemory::PlannedMemory(std::shared_ptr<const MemoryPlan> plan,
+                             const std::atomic<bool>* escaped_buffers,
+                             Allocator* base_allocator)
+    : plan_(std::move(plan)),
+      escaped_buffers_(escaped_buffers),
+      base_allocator_(base_allocator),
+      region_(static_cast<char*>(base_allocator->AllocateRaw(
+          Allocator::kAllocatorAlignment, plan_->total_bytes))),
+      in_use_(new std::atomic<bool>[plan_->buffers.size()]) {
+  CHECK(region_ != nullptr) << "Failed to allocate " << plan_->total_bytes
+                            << " bytes of planned memory";
+  const int num_buffers = plan_->buffers.size();
+  buffer_allocators_.reserve(num_buffers);
+  for (int i = 0; i < num_buffers; ++i) {
+    in_use_[i] = false;
+    buffer_allocators_.push_back(std::make_unique<BufferAllocator>(this, i));
+  }
+
+  first_output_allocator_.assign(plan_->num_outputs.size(), -1);
+  for (int node_id = 0; node_id < plan_->num_outputs.size(); ++node_id) {
+    if (plan_->num_outputs[node_id] > 0) {
+      first_output_allocator_[node_id] = output_allocators_.size();
+      output_allocators_.resize(output_allocators_.size() +
+                                plan_->num_outputs[node_id]);
+    }
+  }
+  for (int i = 0; i < num_buffers; ++i) {
+    const MemoryPlan::Buffer& buffer = plan_->buffers[i];
+    DCHECK_GE(first_output_allocator_[buffer.node_id], 0);
+    output_allocators_[first_output_allocator_[buffer.node_id] +
+                       buffer.output] = buffer_allocators_[i].get();
+  }
+}
+
+PlannedMemory::~PlannedMemory() {
+  DCHECK_EQ(refs_.load(std::memory_order_relaxed), 0);
+  base_allocator_->DeallocateRaw(region_);
+}
+
+void PlannedMemory::StartStep() {
+  DCHECK_EQ(refs_.load(std::memory_order_relaxed), 0);
+  refs_.store(1, std::memory_order_release);
+}
+
+bool PlannedMemory::FinishStep(
+    const std::function<void(int)>& escaped_buffers) {
+  for (int i = 0; i < plan_->buffers.size(); ++i) {
+    if (in_use_[i].load(std::memory_order_relaxed)) {
+      escaped_buffers(i);
+    }
+  }
+  return refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+bool PlannedMemory::TryAcquire(int index) {
+  if (escaped_buffers_[index].load(std::memory_order_relaxed) ||
+      in_use_[index].exchange(true)) {
+    return false;
+  }
+  // Both this check and the `exchange()` above are sequentially consistent, so
+  // of two threads acquiring overlapping buffers at least one sees the other.
+  for (int other : plan_->buffers[index].overlapping) {
+    if (in_use_[other].load()) {
+      in_use_[index].store(false);
+      return false;
+    }
+  }
+  return true;
+}
+
+void PlannedMemory::ReleaseBuffer(int index) { in_use_[index].store(false); }
+
+void PlannedMemory::Unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // The step has finished and this was its last live buffer.
+    delete this;
+  }
+}
+
+PlannedMemoryPool::PlannedMemoryPool(std::shared_ptr<const MemoryPlan> plan,
+                                     Allocator* base_allocator)
+    : plan_(std::move(plan)),
+      base_allocator_(base_allocator),
+      escaped_buffers_(new std::atomic<bool>[plan_->buffers.size()]) {
+  for (int i = 0; i < plan_->buffers.size(); ++i) {
+    escaped_buffers_[i] = false;
+  }
+}
+
+PlannedMemoryPool::~PlannedMemoryPool() {
+  for (PlannedMemory* memory : free_memories_) {
+    delete memory;
+  }
+}
+
+PlannedMemory* PlannedMemoryPool::Acquire() {
+  PlannedMemory* memory = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!free_memories_.empty()) {
+      memory = free_memories_.back();
+      free_memories_.pop_back();
+    }
+  }
+  if (memory == nullptr) {
+    memory = new PlannedMemory(plan_, escaped_buffers_.get(), base_allocator_);
+  }
+  memory->StartStep();
+  return memory;
+}
+
+void PlannedMemoryPool::Release(PlannedMemory* memory) {
+  const bool reusable = memory->FinishStep([this](int index) {
+    VLOG(1) << "Planned buffer for output " << plan_->buffers[index].output
+            << " of node " << plan_->buffers[index].node_id
+            << " outlived its step and will no longer be used.";
+    escaped_buffers_[index].store(true, std::memory_order_relaxed);
+  });
+  if (reusable) {
+    mutex_lock l(mu_);
+    free_memories_.push_back(memory);
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,142 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A static assignment of node outputs to offsets in one region of memory, as
+// computed by `PlanMemory()`.
+struct MemoryPlan {
+  struct Buffer {
+    int node_id;
+    int output;
+    size_t offset;
+    size_t num_bytes;
+    // Indices of the buffers whose memory overlaps with this one. Their planned
+    // lifetimes are disjoint, but they may still overlap at run time.
+    std::vector<int> overlapping;
+  };
+
+  std::vector<Buffer> buffers;
+  // The number of outputs of every node with a planned buffer, indexed by node
+  // id. Zero for the other nodes.
+  std::vector<int> num_outputs;
+  size_t total_bytes = 0;
+};
+
+// The memory of one step executing a graph with a `MemoryPlan`. Each planned
+// output gets its own allocator, which returns the output's planned buffer if
+// the requested size matches the plan and no overlapping buffer is in use.
+// Other requests are forwarded to the base allocator, so the plan only needs
+// to be a good guess: buffers are never shared while in use, even when a
+// kernel forwards its input or the step runs nodes in a different order than
+// the plan assumed.
+class PlannedMemory {
+ public:
+  // `base_allocator` must outlive all buffers allocated from this object.
+  PlannedMemory(std::shared_ptr<const MemoryPlan> plan,
+                const std::atomic<bool>* escaped_buffers,
+                Allocator* base_allocator);
+  ~PlannedMemory();
+
+  // Returns the allocators for the outputs of node `node_id`, indexed by
+  // output, with null entries for the outputs that are not planned. Returns
+  // null if no output of the node is planned.
+  Allocator* const* output_allocators(int node_id) const {
+    if (node_id >= first_output_allocator_.size() ||
+        first_output_allocator_[node_id] < 0) {
+      return nullptr;
+    }
+    return &output_allocators_[first_output_allocator_[node_id]];
+  }
+
+  // Starts a new step. All buffers of the previous step must have been
+  // deallocated.
+  void StartStep();
+
+  // Finishes the current step. Returns true if all buffers of the step have
+  // been deallocated, in which case the caller may start another step.
+  // Otherwise the caller must not use this object again, and it deletes itself
+  // when its last live buffer is deallocated. `escaped_buffers` is called on
+  // the indices of the planned buffers that are still in use.
+  bool FinishStep(const std::function<void(int)>& escaped_buffers);
+
+ private:
+  class BufferAllocator;
+
+  // Marks buffer `index` as in use if neither it nor an overlapping buffer is.
+  bool TryAcquire(int index);
+  void ReleaseBuffer(int index);
+  void Unref();
+
+  const std::shared_ptr<const MemoryPlan> plan_;
+  // Buffers that outlived an earlier step, and which are not handed out again.
+  // Owned by the pool, and only read while a step is running.
+  const std::atomic<bool>* const escaped_buffers_;
+  Allocator* const base_allocator_;  // Not owned.
+  char* const region_;
+  std::unique_ptr<std::atomic<bool>[]> in_use_;
+  std::vector<std::unique_ptr<BufferAllocator>> buffer_allocators_;
+  // Indexed by node id: the index in `output_allocators_` of the allocator
+  // for the node's first output, or -1.
+  std::vector<int> first_output_allocator_;
+  std::vector<Allocator*> output_allocators_;
+  // Number of live buffers (including those forwarded to `base_allocator_`),
+  // plus one while a step is running.
+  std::atomic<int64_t> refs_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedMemory);
+};
+
+// A pool of `PlannedMemory` objects for one plan, so that concurrent steps
+// each get their own region and sequential steps reuse the same regions.
+class PlannedMemoryPool {
+ public:
+  PlannedMemoryPool(std::shared_ptr<const MemoryPlan> plan,
+                    Allocator* base_allocator);
+  ~PlannedMemoryPool();
+
+  // Returns memory with a started step, which must be passed back to
+  // `Release()` when the step is done.
+  PlannedMemory* Acquire();
+  void Release(PlannedMemory* memory);
+
+ private:
+  const std::shared_ptr<const MemoryPlan> plan_;
+  Allocator* const base_allocator_;  // Not owned.
+  // Indexed by buffer. A planned buffer that is still in use when its step
+  // finishes, typically because it was forwarded to a fetched output, is not
+  // handed out again, so that later regions can be reused.
+  std::unique_ptr<std::atomic<bool>[]> escaped_buffers_;
+  mutex mu_;
+  std::vector<PlannedMemory*> free_memories_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedMemoryPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_PLANNED_MEMORY_H_
@@ -453,6 +453,27 @@ Status FunctionRetsToTensors(const std::vector<FunctionRet>* function_rets,
   return OkStatus();
 }
 
+// Returns true if `graph` sends or receives tensors through a rendezvous.
+bool HasSendOrRecv(const Graph& graph) {
+  for (const Node* node : graph.op_nodes()) {
+    if (node->IsSend() || node->IsHostSend() || node->IsRecv() ||
+        node->IsHostRecv()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Prefixes the error of a component function with the name of the
+// multi-device function it belongs to.
+Status AddFunctionNameToError(const string& function_name,
+                              const Status& status) {
+  if (status.ok()) return status;
+  return errors::CreateWithUpdatedMessage(
+      status, strings::StrCat(errors::FormatFunctionForError(function_name),
+                              " ", status.error_message()));
+}
+
 }  // anonymous namespace
 
 Status ProcessFunctionLibraryRuntime::PinArgsAndRets(
@@ -1150,6 +1171,27 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
   }
   TF_RETURN_IF_ERROR(group.as_summary_status());
 
+  if (subgraphs.size() == 1 && !data->is_cross_process_) {
+    const string& target = subgraphs.begin()->first;
+    const ComponentFunctionData* comp_data = &data->glue_[target];
+    FunctionLibraryRuntime* flr = GetFLR(target);
+    bool in_order =
+        static_cast<int>(comp_data->ret_indices.size()) == data->num_outputs_;
+    for (int j = 0; in_order && j < comp_data->arg_indices.size(); ++j) {
+      in_order = comp_data->arg_indices[j].index == j &&
+                 comp_data->arg_indices[j].sub_index < 0;
+    }
+    for (int j = 0; in_order && j < comp_data->ret_indices.size(); ++j) {
+      in_order = comp_data->ret_indices[j] == j;
+    }
+    if (flr != nullptr && in_order &&
+        !HasSendOrRecv(*subgraphs.begin()->second)) {
+      data->local_component = LocalComponentFunction{
+          flr, comp_data,
+          flr->device()->tensorflow_device_thread_pool() != nullptr};
+    }
+  }
+
   *handle = AddMultiDeviceHandle(std::move(data), function_key);
   VLOG(2) << "Instantiated MultiDevice function \"" << function_name
           << "\" with handle " << *handle;
@@ -1235,6 +1277,32 @@ Status ProcessFunctionLibraryRuntime::PrepareRunMultiDevice(
   return OkStatus();
 }
 
+const ProcessFunctionLibraryRuntime::MultiDeviceFunctionData*
+ProcessFunctionLibraryRuntime::PrepareRunLocalComponent(
+    const FunctionLibraryRuntime::Options& opts,
+    FunctionLibraryRuntime::Handle handle, int num_args,
+    FunctionLibraryRuntime::Options* comp_opts) const {
+  // Let PrepareRunMultiDevice() report the error.
+  if (opts.create_rendezvous) return nullptr;
+  const MultiDeviceFunctionData* data = IsMultiDevice(handle);
+  if (data == nullptr || !data->local_component.has_value()) return nullptr;
+  const LocalComponentFunction& component = *data->local_component;
+  if (num_args != static_cast<int>(component.comp_data->arg_indices.size())) {
+    return nullptr;
+  }
+
+  *comp_opts = opts;
+  comp_opts->args_alloc_attrs = component.comp_data->arg_alloc_attrs;
+  comp_opts->rets_alloc_attrs = component.comp_data->ret_alloc_attrs;
+  comp_opts->remote_execution = false;
+  if (component.use_device_runner) {
+    comp_opts->runner = component.flr->runner();
+  }
+  VLOG(1) << "Running local component function of " << data->function_name_
+          << " with handle " << component.comp_data->handle;
+  return data;
+}
+
 std::vector<string> ProcessFunctionLibraryRuntime::GetOrderedSubgraphs(
     const MultiDeviceFunctionData* data) const {
   std::vector<string> subgraph_keys;
@@ -1720,6 +1788,17 @@ void ProcessFunctionLibraryRuntime::Run(
     FunctionLibraryRuntime::Handle handle, gtl::ArraySlice<Tensor> args,
     std::vector<Tensor>* rets,
     FunctionLibraryRuntime::DoneCallback done) const {
+  FunctionLibraryRuntime::Options comp_opts;
+  if (const MultiDeviceFunctionData* data =
+          PrepareRunLocalComponent(opts, handle, args.size(), &comp_opts)) {
+    const LocalComponentFunction& component = *data->local_component;
+    component.flr->Run(comp_opts, component.comp_data->handle, args, rets,
+                       [data, done = std::move(done)](const Status& s) {
+                         done(AddFunctionNameToError(data->function_name_, s));
+                       });
+    return;
+  }
+
   FunctionLibraryRuntime::Options new_opts = opts;
   Rendezvous* created_rendezvous = nullptr;
   if (!opts.rendezvous) {
@@ -1858,6 +1937,19 @@ void ProcessFunctionLibraryRuntime::Run(
     const FunctionLibraryRuntime::Options& opts,
     FunctionLibraryRuntime::Handle handle, CallFrameInterface* frame,
     FunctionLibraryRuntime::DoneCallback done) const {
+  FunctionLibraryRuntime::Options comp_opts;
+  if (const MultiDeviceFunctionData* data = PrepareRunLocalComponent(
+          opts, handle, frame->num_args(), &comp_opts)) {
+    // The component takes the arguments and returns the return values of the
+    // function in order, so it can use `frame` as its own.
+    const LocalComponentFunction& component = *data->local_component;
+    component.flr->Run(comp_opts, component.comp_data->handle, frame,
+                       [data, done = std::move(done)](const Status& s) {
+                         done(AddFunctionNameToError(data->function_name_, s));
+                       });
+    return;
+  }
+
   std::vector<Tensor> args;
   args.reserve(frame->num_args());
   for (size_t i = 0; i < frame->num_args(); ++i) {
@@ -1907,6 +1999,16 @@ Status ProcessFunctionLibraryRuntime::RunSync(
   MultiDeviceFunctionData* multi_device_data = IsMultiDevice(handle);
   if (multi_device_data && multi_device_data->enable_sync_execution) {
     metrics::IncrementTestCounter("pflr_runsync", "sync");
+    FunctionLibraryRuntime::Options comp_opts;
+    if (PrepareRunLocalComponent(orig_opts, handle, args.size(), &comp_opts)) {
+      const LocalComponentFunction& component =
+          *multi_device_data->local_component;
+      return AddFunctionNameToError(
+          multi_device_data->function_name_,
+          component.flr->RunSync(comp_opts, component.comp_data->handle, args,
+                                 rets));
+    }
+
     FunctionLibraryRuntime::Options new_opts = orig_opts;
     Rendezvous* created_rendezvous = nullptr;
     if (!new_opts.rendezvous) {
@@ -291,6 +291,16 @@ class ProcessFunctionLibraryRuntime {
     AsyncAttributes async_attributes;
   };
 
+  // A component function that can run in place of the multi-device function
+  // it belongs to: see MultiDeviceFunctionData::local_component.
+  struct LocalComponentFunction {
+    FunctionLibraryRuntime* flr;
+    const ComponentFunctionData* comp_data;
+    // Whether to run on the runner of the device, which has a private thread
+    // pool, rather than on the caller's.
+    bool use_device_runner;
+  };
+
   // Data structure holding information for a single instantiated multi-device
   // function.
   // The fields are filled in during instantiation. Once the object is
@@ -330,6 +340,13 @@ class ProcessFunctionLibraryRuntime {
     // Maps the device name to the information about the component function
     // be run on this device.
     std::unordered_map<string, ComponentFunctionData> glue_;
+
+    // Set if the function has a single component function, on a local device,
+    // that takes the function's arguments and returns its return values in
+    // order and has no Send or Recv ops. The component is then run directly,
+    // without a rendezvous, a cancellation manager or any repacking of the
+    // arguments and return values.
+    absl::optional<LocalComponentFunction> local_component;
   };
 
   struct CleanUpItem {
@@ -438,6 +455,14 @@ class ProcessFunctionLibraryRuntime {
                                FunctionLibraryRuntime::Handle handle,
                                const MultiDeviceFunctionData** data) const;
 
+  // If `handle` is a multi-device function with a local component function
+  // that takes `num_args` arguments, returns its data and sets `*comp_opts` to
+  // the options to run the component with. Returns nullptr otherwise.
+  const MultiDeviceFunctionData* PrepareRunLocalComponent(
+      const FunctionLibraryRuntime::Options& opts,
+      FunctionLibraryRuntime::Handle handle, int num_args,
+      FunctionLibraryRuntime::Options* comp_opts) const;
+
   Status RunMultiDeviceSync(
       const FunctionLibraryRuntime::Options& opts,
       FunctionLibraryRuntime::Handle handle, std::vector<FunctionRet>* rets,
@@ -498,7 +523,7 @@ class ProcessFunctionLibraryRuntime {
     Notification init_done_;
   };
 
-  mutable mutex mu_;
+  mutable profiled_mutex mu_{"ProcessFunctionLibraryRuntime"};
 
   Env* const env_;
   const absl::optional<const ConfigProto> config_;
@@ -1326,5 +1326,39 @@ TEST_F(ProcessFunctionLibraryRuntimeTest, PartitionedGraphRequiresAsync) {
   EXPECT_GT(async_recv_only.Get(), 0);
 }
 
+TEST_F(ProcessFunctionLibraryRuntimeTest, MultiDevice_SingleLocalDevice) {
+  Init({test::function::XTimesTwo()});
+  FunctionLibraryRuntime::InstantiateOptions inst_opts =
+      MakeOptions("CPU:0", {"CPU:0"}, {"CPU:0"});
+  FunctionLibraryRuntime::Handle handle;
+  TF_ASSERT_OK(
+      Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, inst_opts, &handle));
+  auto x = test::AsTensor<float>({1, 2, 3, 4});
+  auto expected = test::AsTensor<float>({2, 4, 6, 8});
+
+  Tensor y;
+  TF_ASSERT_OK(RunInstantiated(handle, {}, {x}, {&y}));
+  test::ExpectTensorEqual<float>(y, expected);
+
+  // The caller's call frame is passed straight to the component function.
+  std::function<void(std::function<void()>)> runner =
+      [](std::function<void()> fn) {
+        test::function::FunctionTestSchedClosure(fn);
+      };
+  FunctionLibraryRuntime::Options opts;
+  opts.runner = &runner;
+  FunctionCallFrame frame({DT_FLOAT}, {DT_FLOAT});
+  TF_ASSERT_OK(frame.SetArgs({x}));
+  TF_ASSERT_OK(proc_flr_->RunSync(opts, handle, &frame));
+  std::vector<Tensor> rets;
+  TF_ASSERT_OK(frame.ConsumeRetvals(&rets, /*allow_dead_tensors=*/false));
+  ASSERT_EQ(rets.size(), 1);
+  test::ExpectTensorEqual<float>(rets[0], expected);
+
+  TF_ASSERT_OK(proc_flr_->ReleaseHandle(handle));
+  Status status = RunInstantiated(handle, {}, {x}, {&y});
+  EXPECT_TRUE(errors::IsNotFound(status)) << status;
+}
+
 }  // anonymous namespace
 }  // namespace tensorflow
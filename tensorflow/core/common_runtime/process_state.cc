@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/process_state.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <vector>
@@ -103,6 +104,14 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
 
       BFCAllocator::Options allocator_opts;
       allocator_opts.allow_growth = true;
+      int64_t thread_cache_max_chunk_size = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_THREAD_CACHE_MAX_CHUNK_SIZE",
+                                   0, &thread_cache_max_chunk_size);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
+      allocator_opts.thread_cache_max_chunk_size =
+          std::max<int64_t>(thread_cache_max_chunk_size, 0);
       allocator = new BFCAllocator(
           absl::WrapUnique(sub_allocator), cpu_mem_limit,
           /*name=*/"bfc_cpu_allocator_for_gpu", allocator_opts);
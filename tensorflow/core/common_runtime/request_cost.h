@@ -16,12 +16,14 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_REQUEST_COST_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_REQUEST_COST_H_
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 namespace tensorflow {
@@ -39,11 +41,44 @@ class RequestCost {
   // rpc request, when all the costs have been collected.
   absl::flat_hash_map<std::string, absl::Duration> GetCosts() const;
 
+  // Records metrics that are not durations, e.g. bytes. The inputs should be
+  // pairs of metric name and value, which are accumulated like costs.
+  // It's thread-safe, and can be called from different threads.
+  void RecordMetrics(
+      const std::vector<std::pair<absl::string_view, double>>& metrics);
+
+  // Gets all types of metrics for processing an rpc request.
+  // It's thread-safe.
+  absl::flat_hash_map<std::string, double> GetMetrics() const;
+
+  // How one batch that included (part of) this request was processed, for
+  // amortizing the cost of the batch across the requests that shared it.
+  struct BatchMetrics {
+    // Size of the batch as processed, including padding.
+    int64_t processed_size = 0;
+    // This request's share of the batch, excluding padding.
+    int64_t input_size = 0;
+    // Padding added to the batch.
+    int64_t padding_size = 0;
+    // The cost of the whole batch, by cost type.
+    absl::flat_hash_map<std::string, absl::Duration> batch_costs;
+  };
+
+  // Records the metrics of one batch. It's thread-safe.
+  void RecordBatchMetrics(const BatchMetrics& batch_metrics);
+
+  // Gets the metrics of all batches that processed this request, in the order
+  // they were recorded. It's thread-safe.
+  std::vector<BatchMetrics> GetBatchMetrics() const;
+
  private:
   mutable absl::Mutex mutex_;
   // Map from cost type to cost.
   absl::flat_hash_map<std::string, absl::Duration> cost_map_
       ABSL_GUARDED_BY(mutex_);
+  // Map from metric name to value.
+  absl::flat_hash_map<std::string, double> metric_map_ ABSL_GUARDED_BY(mutex_);
+  std::vector<BatchMetrics> batch_metrics_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace tensorflow
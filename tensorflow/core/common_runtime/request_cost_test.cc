@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/request_cost.h"
 
+#include <vector>
+
 #include "absl/time/time.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -48,5 +50,41 @@ TEST(RequestCostTest, Basic) {
                                    Pair("cpu_v2", absl::Milliseconds(44))));
 }
 
+TEST(RequestCostTest, RecordMetrics) {
+  RequestCost request_cost;
+
+  request_cost.RecordMetrics({{"output_bytes", 100}, {"flops", 6}});
+  request_cost.RecordMetrics({{"output_bytes", 50}});
+  EXPECT_THAT(request_cost.GetMetrics(),
+              UnorderedElementsAre(Pair("output_bytes", 150), Pair("flops", 6)));
+}
+
+TEST(RequestCostTest, RecordBatchMetrics) {
+  RequestCost request_cost;
+
+  RequestCost::BatchMetrics batch_metrics;
+  batch_metrics.processed_size = 16;
+  batch_metrics.input_size = 3;
+  batch_metrics.padding_size = 4;
+  batch_metrics.batch_costs["gcu"] = absl::Milliseconds(8);
+  request_cost.RecordBatchMetrics(batch_metrics);
+  batch_metrics.processed_size = 8;
+  batch_metrics.input_size = 8;
+  batch_metrics.padding_size = 0;
+  request_cost.RecordBatchMetrics(batch_metrics);
+
+  std::vector<RequestCost::BatchMetrics> recorded =
+      request_cost.GetBatchMetrics();
+  ASSERT_EQ(recorded.size(), 2);
+  EXPECT_EQ(recorded[0].processed_size, 16);
+  EXPECT_EQ(recorded[0].input_size, 3);
+  EXPECT_EQ(recorded[0].padding_size, 4);
+  EXPECT_THAT(recorded[0].batch_costs,
+              UnorderedElementsAre(Pair("gcu", absl::Milliseconds(8))));
+  EXPECT_EQ(recorded[1].processed_size, 8);
+  EXPECT_EQ(recorded[1].input_size, 8);
+  EXPECT_EQ(recorded[1].padding_size, 0);
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -22,6 +22,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/eval_const_tensor.h"
 #include "tensorflow/core/common_runtime/function_utils.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/node_def.pb.h"
@@ -31,6 +34,9 @@ limitations under the License.
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/hash.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -39,11 +45,86 @@ using shape_inference::InferenceContext;
 using shape_inference::ShapeAndType;
 using shape_inference::ShapeHandle;
 
+namespace {
+
+bool UseShapeFunctionCacheFromEnv() {
+  static const bool use_shape_function_cache = [] {
+    bool use;
+    Status s = ReadBoolFromEnvVar("TF_SHAPE_FUNCTION_CACHE",
+                                  /*default_val=*/false, &use);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return use;
+  }();
+  return use_shape_function_cache;
+}
+
+// Memoizes the output shapes of shape functions for every ShapeRefiner in the
+// process. Keys are built by ShapeFunctionCacheKey(). The cache is cleared
+// when it reaches kMaxEntries, which bounds its memory.
+class ShapeFunctionCache {
+ public:
+  static ShapeFunctionCache* Global() {
+    static ShapeFunctionCache* cache = new ShapeFunctionCache();
+    return cache;
+  }
+
+  bool Lookup(const string& key, std::vector<TensorShapeProto>* outputs) {
+    tf_shared_lock l(mu_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return false;
+    *outputs = it->second;
+    return true;
+  }
+
+  void Insert(const string& key, std::vector<TensorShapeProto> outputs) {
+    mutex_lock l(mu_);
+    if (entries_.size() >= kMaxEntries) entries_.clear();
+    entries_.emplace(key, std::move(outputs));
+  }
+
+ private:
+  static constexpr int kMaxEntries = 1 << 16;
+
+  mutex mu_;
+  absl::flat_hash_map<string, std::vector<TensorShapeProto>> entries_
+      TF_GUARDED_BY(mu_);
+};
+
+// Sets `*key` to identify the result of `node`'s shape function, given the
+// inputs of `c`. Returns false if the result may depend on more than the op,
+// its attrs and the input shapes, or if the input shapes are not fully
+// defined: an unknown dimension may be shared with the outputs, which the
+// cached shapes can't express.
+bool ShapeFunctionCacheKey(const Node* node, int graph_def_version,
+                           InferenceContext* c, string* key) {
+  uint64 attrs_hash = 0;
+  for (const auto& attr : node->attrs()) {
+    // Combined by addition, as the iteration order of the attrs is not fixed.
+    attrs_hash += Hash64Combine(Hash64(attr.first), AttrValueHash(attr.second));
+  }
+  *key = absl::StrCat(node->type_string(), ";", graph_def_version, ";",
+                      attrs_hash);
+  for (int i = 0; i < c->num_inputs(); ++i) {
+    if (!c->FullyDefined(c->input(i)) ||
+        c->input_handle_shapes_and_types(i) != nullptr) {
+      return false;
+    }
+    absl::StrAppend(key, ";", c->DebugString(c->input(i)));
+  }
+  return true;
+}
+
+}  // namespace
+
 ShapeRefiner::ShapeRefiner(int graph_def_version,
                            const OpRegistryInterface* ops)
     : graph_def_version_(graph_def_version),
       ops_registry_(ops),
-      graph_runner_(Env::Default()) {}
+      graph_runner_(Env::Default()),
+      use_shape_function_cache_(UseShapeFunctionCacheFromEnv()) {}
 
 ShapeRefiner::ShapeRefiner(const VersionDef& versions,
                            const OpRegistryInterface* ops)
@@ -682,6 +763,24 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
   c->set_input_tensors(input_tensors);
   c->set_input_tensors_as_shapes(input_tensors_as_shapes);
 
+  // Function calls are inferred from their bodies, not by a shape function.
+  string cache_key;
+  const bool use_cache =
+      use_shape_function_cache_ &&
+      !(function_library_ && IsFunctionCall(*function_library_, *node)) &&
+      ShapeFunctionCacheKey(node, graph_def_version_, c, &cache_key);
+  if (use_cache) {
+    std::vector<TensorShapeProto> outputs;
+    if (ShapeFunctionCache::Global()->Lookup(cache_key, &outputs)) {
+      for (int i = 0; i < c->num_outputs(); ++i) {
+        ShapeHandle output;
+        TF_RETURN_IF_ERROR(c->MakeShapeFromShapeProto(outputs[i], &output));
+        c->set_output(i, output);
+      }
+      return OkStatus();
+    }
+  }
+
   // Run the shape inference function, and return if there was an error.
   // Capture as lambda, because we might need to re-run inference later on.
   auto run_inference_lambda = [&]() {
@@ -783,6 +882,23 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
     }
   } while (rerun_shape_fn);
 
+  if (use_cache) {
+    // Results that depend on input values, or that carry resource handle data,
+    // are not cached.
+    for (int i = 0; i < c->num_inputs(); ++i) {
+      if (c->requested_input_tensor(i) ||
+          c->requested_input_tensor_as_partial_shape(i)) {
+        return OkStatus();
+      }
+    }
+    std::vector<TensorShapeProto> outputs(c->num_outputs());
+    for (int i = 0; i < c->num_outputs(); ++i) {
+      if (c->output_handle_shapes_and_types(i) != nullptr) return OkStatus();
+      c->ShapeHandleToProto(c->output(i), &outputs[i]);
+    }
+    ShapeFunctionCache::Global()->Insert(cache_key, std::move(outputs));
+  }
+
   return OkStatus();
 }
 
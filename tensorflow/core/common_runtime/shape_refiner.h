@@ -138,6 +138,14 @@ class ShapeRefiner {
     disable_constant_propagation_ = disable;
   }
 
+  // If true, the output shapes of shape functions that depend only on the
+  // op, its attrs and fully defined input shapes are memoized in a cache
+  // shared by every ShapeRefiner in the process, and reused for identical
+  // nodes. Defaults to the value of TF_SHAPE_FUNCTION_CACHE (false if unset).
+  void set_use_shape_function_cache(bool use_shape_function_cache) {
+    use_shape_function_cache_ = use_shape_function_cache;
+  }
+
   // Set function library to enable function shape inference.
   // Without function library, function inference always yields unknown shapes.
   // With this enabled, shape inference can take more time since it descends
@@ -315,6 +323,7 @@ class ShapeRefiner {
 
   bool require_shape_inference_fns_ = true;
   bool disable_constant_propagation_ = false;
+  bool use_shape_function_cache_;
 
   // Function library is optional, but has to be set to enable function
   // shape inference.
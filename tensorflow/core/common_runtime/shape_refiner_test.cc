@@ -366,6 +366,96 @@ TEST_F(ShapeRefinerTest, InputTensorDependencies) {
 
 namespace {
 
+int num_counted_shape_fn_calls = 0;
+
+// An op whose shape function counts how often it runs.
+REGISTER_OP("CountedShapeFn")
+    .Input("a: float")
+    .Output("o: float")
+    .Attr("rows: int")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      ++num_counted_shape_fn_calls;
+      int64_t rows;
+      TF_RETURN_IF_ERROR(c->GetAttr("rows", &rows));
+      c->set_output(0, c->Matrix(rows, c->Dim(c->input(0), 0)));
+      return OkStatus();
+    });
+
+}  // namespace
+
+TEST_F(ShapeRefinerTest, ShapeFunctionCache) {
+  auto add_counted_node = [](int64_t rows, bool use_cache, string* shape) {
+    Graph graph(OpRegistry::Global());
+    Node* input = test::graph::Constant(&graph, Tensor(DT_FLOAT, {3}));
+    Node* node;
+    TF_CHECK_OK(NodeBuilder("Counted", "CountedShapeFn")
+                    .Input(input)
+                    .Attr("rows", rows)
+                    .Finalize(&graph, &node));
+    ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+    m.set_use_shape_function_cache(use_cache);
+    TF_CHECK_OK(m.AddNode(input));
+    TF_CHECK_OK(m.AddNode(node));
+    shape_inference::InferenceContext* ctx = m.GetContext(node);
+    *shape = ctx->DebugString(ctx->output(0));
+  };
+
+  num_counted_shape_fn_calls = 0;
+  string shape;
+  add_counted_node(/*rows=*/2, /*use_cache=*/true, &shape);
+  EXPECT_EQ("[2,3]", shape);
+  EXPECT_EQ(num_counted_shape_fn_calls, 1);
+
+  // An identical node in another graph reuses the result.
+  add_counted_node(/*rows=*/2, /*use_cache=*/true, &shape);
+  EXPECT_EQ("[2,3]", shape);
+  EXPECT_EQ(num_counted_shape_fn_calls, 1);
+
+  // Different attrs, or a refiner that doesn't use the cache, run the shape
+  // function.
+  add_counted_node(/*rows=*/4, /*use_cache=*/true, &shape);
+  EXPECT_EQ("[4,3]", shape);
+  EXPECT_EQ(num_counted_shape_fn_calls, 2);
+  add_counted_node(/*rows=*/2, /*use_cache=*/false, &shape);
+  EXPECT_EQ("[2,3]", shape);
+  EXPECT_EQ(num_counted_shape_fn_calls, 3);
+}
+
+TEST_F(ShapeRefinerTest, ShapeFunctionCacheSkipsInputTensorDependencies) {
+  // Both nodes have the same op, attrs and input shapes, but only the first
+  // has a constant first input.
+  for (bool constant_input : {true, false}) {
+    ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+    m.set_use_shape_function_cache(true);
+    Graph graph(OpRegistry::Global());
+    Tensor a(DT_FLOAT, TensorShape({}));
+    a.scalar<float>()() = 1.0;
+    Node* input_a;
+    if (constant_input) {
+      input_a = test::graph::Constant(&graph, a);
+    } else {
+      TF_ASSERT_OK(NodeBuilder("a", "Placeholder")
+                       .Attr("dtype", DT_FLOAT)
+                       .Attr("shape", TensorShape({}))
+                       .Finalize(&graph, &input_a));
+    }
+    Node* input_b = test::graph::Constant(&graph, a);
+    Node* node;
+    TF_ASSERT_OK(NodeBuilder("Test", "TestOp")
+                     .Input(input_a)
+                     .Input(input_b)
+                     .Finalize(&graph, &node));
+    TF_ASSERT_OK(m.AddNode(input_a));
+    TF_ASSERT_OK(m.AddNode(input_b));
+    TF_ASSERT_OK(m.AddNode(node));
+    shape_inference::InferenceContext* ctx = m.GetContext(node);
+    EXPECT_EQ(constant_input ? "[10,10]" : "?",
+              ctx->DebugString(ctx->output(0)));
+  }
+}
+
+namespace {
+
 // An op with a shape function that looks at its input tensor
 // data and makes a Shape out of it.
 REGISTER_OP("ShapeData")
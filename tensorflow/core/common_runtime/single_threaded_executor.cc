@@ -452,7 +452,7 @@ class SingleThreadedExecutorImpl : public Executor {
 
       // Forward the outputs of the kernel to the inputs of subsequent kernels.
       for (size_t j = 0; j < num_outputs; ++j) {
-        TensorValue val = ctx.release_output(j);
+        TensorValue val = ctx.borrow_output(j);
         const size_t num_destinations = kernel_state.output_locations[j].size();
         if (num_destinations > 0) {
           // TODO(mrry): Consider flattening the `output_locations` vector
@@ -478,7 +478,6 @@ class SingleThreadedExecutorImpl : public Executor {
             input.val.Init(Tensor(kernel_state.kernel->output_type(j)));
           }
         }
-        delete val.tensor;
       }
     }
     return OkStatus();
@@ -0,0 +1,119 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StepArenaAllocator::StepArenaAllocator(Allocator* base_allocator,
+                                       size_t capacity)
+    : base_allocator_(base_allocator),
+      capacity_(capacity),
+      region_(static_cast<char*>(
+          base_allocator->AllocateRaw(Allocator::kAllocatorAlignment,
+                                      capacity))) {
+  CHECK(region_ != nullptr) << "Failed to allocate a step arena of "
+                            << capacity << " bytes";
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  DCHECK_EQ(refs_.load(std::memory_order_relaxed), 0);
+  base_allocator_->DeallocateRaw(region_);
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  refs_.fetch_add(1, std::memory_order_relaxed);
+  if (num_bytes > 0 && alignment <= Allocator::kAllocatorAlignment) {
+    // Every buffer starts at a multiple of kAllocatorAlignment, which keeps
+    // unrelated buffers off each other's cache lines.
+    const size_t rounded_bytes =
+        (num_bytes + Allocator::kAllocatorAlignment - 1) &
+        ~(Allocator::kAllocatorAlignment - 1);
+    if (rounded_bytes <= capacity_) {
+      size_t offset = offset_.fetch_add(rounded_bytes,
+                                        std::memory_order_relaxed);
+      if (offset <= capacity_ - rounded_bytes) {
+        return region_ + offset;
+      }
+    }
+  }
+  void* ptr = base_allocator_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    Unref();
+  }
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (!Owns(ptr)) {
+    base_allocator_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+void StepArenaAllocator::StartStep() {
+  DCHECK_EQ(refs_.load(std::memory_order_relaxed), 0);
+  offset_.store(0, std::memory_order_relaxed);
+  refs_.store(1, std::memory_order_release);
+}
+
+bool StepArenaAllocator::FinishStep() {
+  return refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+void StepArenaAllocator::Unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // The step has finished and this was its last live buffer.
+    delete this;
+  }
+}
+
+StepArenaPool::StepArenaPool(Allocator* base_allocator, size_t arena_capacity)
+    : base_allocator_(base_allocator), arena_capacity_(arena_capacity) {}
+
+StepArenaPool::~StepArenaPool() {
+  for (StepArenaAllocator* arena : free_arenas_) {
+    delete arena;
+  }
+}
+
+StepArenaAllocator* StepArenaPool::Acquire() {
+  StepArenaAllocator* arena = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!free_arenas_.empty()) {
+      arena = free_arenas_.back();
+      free_arenas_.pop_back();
+    }
+  }
+  if (arena == nullptr) {
+    arena = new StepArenaAllocator(base_allocator_, arena_capacity_);
+  }
+  arena->StartStep();
+  return arena;
+}
+
+void StepArenaPool::Release(StepArenaAllocator* arena) {
+  if (!arena->FinishStep()) {
+    VLOG(1) << "A buffer outlived its step; abandoning its step arena.";
+    return;
+  }
+  mutex_lock l(mu_);
+  free_arenas_.push_back(arena);
+}
+
+}  // namespace tensorflow
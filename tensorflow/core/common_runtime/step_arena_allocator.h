@@ -0,0 +1,105 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// An allocator for the temporary buffers of a single step. Buffers are carved
+// out of one contiguous region by bumping an offset, and the region is reused
+// wholesale by the next step instead of being freed buffer by buffer.
+// Requests that do not fit in the region are forwarded to the base allocator.
+//
+// `OpKernelContext` only routes temporaries that their kernel declares
+// `AllocationAttributes::step_local` here. Deallocation is still tracked per
+// buffer, so a buffer that outlives its step anyway stays valid: an arena that
+// has live buffers when its step finishes is not reused, and deletes itself
+// once the last of them is deallocated.
+class StepArenaAllocator : public Allocator {
+ public:
+  // Allocates a region of `capacity` bytes from `base_allocator`, which must
+  // outlive this allocator.
+  StepArenaAllocator(Allocator* base_allocator, size_t capacity);
+  ~StepArenaAllocator() override;
+
+  std::string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  AllocatorMemoryType GetMemoryType() const override {
+    return base_allocator_->GetMemoryType();
+  }
+
+  // Starts a new step. All buffers of the previous step must have been
+  // deallocated.
+  void StartStep();
+
+  // Finishes the current step. Returns true if all buffers of the step have
+  // been deallocated, in which case the caller may start another step.
+  // Otherwise the arena is abandoned: the caller must not use it again, and it
+  // deletes itself when its last live buffer is deallocated.
+  bool FinishStep();
+
+  // Returns true if `ptr` points into the arena's region.
+  bool Owns(const void* ptr) const {
+    return ptr >= region_ && ptr < region_ + capacity_;
+  }
+
+ private:
+  void Unref();
+
+  Allocator* const base_allocator_;  // Not owned.
+  const size_t capacity_;
+  char* const region_;
+  // Offset of the first free byte in `region_`.
+  std::atomic<size_t> offset_{0};
+  // Number of live buffers (including those forwarded to `base_allocator_`),
+  // plus one while a step is running.
+  std::atomic<int64_t> refs_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+// A pool of `StepArenaAllocator`s, so that concurrent steps each get their own
+// arena and sequential steps reuse the same regions.
+class StepArenaPool {
+ public:
+  StepArenaPool(Allocator* base_allocator, size_t arena_capacity);
+  ~StepArenaPool();
+
+  // Returns an arena with a started step. The arena must be passed back to
+  // `Release()` when the step is done.
+  StepArenaAllocator* Acquire();
+  void Release(StepArenaAllocator* arena);
+
+ private:
+  Allocator* const base_allocator_;  // Not owned.
+  const size_t arena_capacity_;
+  mutex mu_;
+  std::vector<StepArenaAllocator*> free_arenas_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,145 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Forwards to aligned malloc and counts the live buffers.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_live_;
+    return port::AlignedMalloc(num_bytes, alignment);
+  }
+  void DeallocateRaw(void* ptr) override {
+    --num_live_;
+    port::AlignedFree(ptr);
+  }
+  int num_live() const { return num_live_; }
+
+ private:
+  std::atomic<int> num_live_{0};
+};
+
+TEST(StepArenaAllocatorTest, ReusesRegionAcrossSteps) {
+  CountingAllocator base;
+  {
+    StepArenaPool pool(&base, 1024);
+    StepArenaAllocator* arena = pool.Acquire();
+    EXPECT_EQ(base.num_live(), 1);
+    void* p = arena->AllocateRaw(Allocator::kAllocatorAlignment, 10);
+    void* q = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    EXPECT_TRUE(arena->Owns(p));
+    EXPECT_TRUE(arena->Owns(q));
+    EXPECT_EQ(static_cast<char*>(q) - static_cast<char*>(p),
+              Allocator::kAllocatorAlignment);
+    arena->DeallocateRaw(p);
+    arena->DeallocateRaw(q);
+    pool.Release(arena);
+
+    // The next step starts again at the beginning of the same region.
+    StepArenaAllocator* next = pool.Acquire();
+    EXPECT_EQ(next, arena);
+    EXPECT_EQ(next->AllocateRaw(Allocator::kAllocatorAlignment, 10), p);
+    next->DeallocateRaw(p);
+    pool.Release(next);
+    EXPECT_EQ(base.num_live(), 1);
+  }
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+TEST(StepArenaAllocatorTest, ForwardsAllocationsThatDoNotFit) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 1024);
+  StepArenaAllocator* arena = pool.Acquire();
+  void* large = arena->AllocateRaw(Allocator::kAllocatorAlignment, 2048);
+  EXPECT_FALSE(arena->Owns(large));
+  void* fits = arena->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_TRUE(arena->Owns(fits));
+  void* overflow = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  EXPECT_FALSE(arena->Owns(overflow));
+  EXPECT_EQ(base.num_live(), 3);
+
+  arena->DeallocateRaw(large);
+  arena->DeallocateRaw(fits);
+  arena->DeallocateRaw(overflow);
+  EXPECT_EQ(base.num_live(), 1);
+  pool.Release(arena);
+}
+
+TEST(StepArenaAllocatorTest, BufferOutlivingStepAbandonsArena) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 1024);
+  StepArenaAllocator* arena = pool.Acquire();
+  void* p = arena->AllocateRaw(Allocator::kAllocatorAlignment, 10);
+  pool.Release(arena);
+
+  // The escaped buffer keeps the abandoned region alive, so the next step gets
+  // a new arena.
+  StepArenaAllocator* next = pool.Acquire();
+  EXPECT_NE(next, arena);
+  EXPECT_EQ(base.num_live(), 2);
+  memset(p, 0, 10);
+  arena->DeallocateRaw(p);
+  EXPECT_EQ(base.num_live(), 1);
+  pool.Release(next);
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocations = 100;
+  CountingAllocator base;
+  StepArenaPool pool(&base, kNumThreads * kNumAllocations * 64 / 2);
+  StepArenaAllocator* arena = pool.Acquire();
+  std::vector<std::vector<char*>> buffers(kNumThreads);
+  {
+    thread::ThreadPool threads(Env::Default(), "step_arena", kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.Schedule([arena, &buffers, i]() {
+        for (int j = 0; j < kNumAllocations; ++j) {
+          char* p = static_cast<char*>(
+              arena->AllocateRaw(Allocator::kAllocatorAlignment, 64));
+          memset(p, i, 64);
+          buffers[i].push_back(p);
+        }
+      });
+    }
+  }
+  // Buffers do not overlap, whether or not they came from the region.
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (char* p : buffers[i]) {
+      for (int k = 0; k < 64; ++k) {
+        ASSERT_EQ(p[k], static_cast<char>(i));
+      }
+      arena->DeallocateRaw(p);
+    }
+  }
+  EXPECT_EQ(base.num_live(), 1);
+  pool.Release(arena);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -31,6 +31,7 @@ info. It does not have any negative impact on performance. */
 #include "tensorflow/core/common_runtime/local_device.h"
 #include "tensorflow/core/common_runtime/scoped_allocator.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/allocator_registry.h"
@@ -44,6 +45,7 @@ info. It does not have any negative impact on performance. */
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/util.h"
 
 #ifdef INTEL_MKL
@@ -72,6 +74,16 @@ ThreadPoolDevice::ThreadPoolDevice(const SessionOptions& options,
     }
   }
 
+  int64_t step_arena_bytes = 0;
+  Status arena_status =
+      ReadInt64FromEnvVar("TF_CPU_STEP_ARENA_BYTES", 0, &step_arena_bytes);
+  if (!arena_status.ok()) {
+    LOG(ERROR) << arena_status;
+  } else if (step_arena_bytes > 0) {
+    step_arena_pool_ =
+        std::make_unique<StepArenaPool>(allocator_, step_arena_bytes);
+  }
+
 #if defined(ENABLE_ONEDNN_OPENMP) && defined(INTEL_MKL)
   // Early return when MKL is disabled
   if (!IsMKLEnabled()) return;
@@ -107,6 +119,14 @@ Allocator* ThreadPoolDevice::GetAllocator(AllocatorAttributes attr) {
   return allocator_;
 }
 
+Allocator* ThreadPoolDevice::AcquireStepTempAllocator() {
+  return step_arena_pool_ ? step_arena_pool_->Acquire() : nullptr;
+}
+
+void ThreadPoolDevice::ReleaseStepTempAllocator(Allocator* allocator) {
+  step_arena_pool_->Release(static_cast<StepArenaAllocator*>(allocator));
+}
+
 Allocator* ThreadPoolDevice::GetScopedAllocator(AllocatorAttributes attr,
                                                 int64_t step_id) {
   if (attr.scope_id > 0) {
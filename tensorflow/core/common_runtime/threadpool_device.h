@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/local_device.h"
 #include "tensorflow/core/common_runtime/node_file_writer.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 
 namespace tensorflow {
 
@@ -36,6 +37,8 @@ class ThreadPoolDevice : public LocalDevice {
   ScopedAllocatorMgr* GetScopedAllocatorMgr() const override {
     return scoped_allocator_mgr_.get();
   }
+  Allocator* AcquireStepTempAllocator() override;
+  void ReleaseStepTempAllocator(Allocator* allocator) override;
   Status MakeTensorFromProto(const TensorProto& tensor_proto,
                              const AllocatorAttributes alloc_attrs,
                              Tensor* tensor) override;
@@ -55,6 +58,8 @@ class ThreadPoolDevice : public LocalDevice {
 
   Allocator* allocator_;  // Not owned
   std::unique_ptr<ScopedAllocatorMgr> scoped_allocator_mgr_;
+  // Serves per-step temporary allocations if TF_CPU_STEP_ARENA_BYTES is set.
+  std::unique_ptr<StepArenaPool> step_arena_pool_;
   NodeFileWriter* node_file_writer_ = nullptr;  // not owned
 };
 
@@ -14,18 +14,176 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/compression_utils.h"
 
+#include <zlib.h>
+
 #include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 namespace data {
+namespace {
 
-Status CompressElement(const std::vector<Tensor>& element,
-                       CompressedElement* out) {
+// Components smaller than this are compressed on the calling thread even if a
+// runner is available, as scheduling them would cost more than it saves.
+constexpr size_t kParallelCompressionThresholdBytes = 1 << 20;  // 1MB
+
+class SnappyCodec : public CompressionCodec {
+ public:
+  Status Compress(StringPiece input, std::string* output) const override {
+    if (input.size() > kuint32max) {
+      return errors::OutOfRange(
+          "Encountered dataset element component of size ", input.size(),
+          ", exceeding the 4GB Snappy limit.");
+    }
+    if (!port::Snappy_Compress(input.data(), input.size(), output)) {
+      return errors::Internal("Failed to compress using snappy.");
+    }
+    return OkStatus();
+  }
+
+  Status Uncompress(StringPiece input, char* output,
+                    size_t output_size) const override {
+    size_t uncompressed_size;
+    if (!port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                            &uncompressed_size)) {
+      return errors::Internal(
+          "Could not get snappy uncompressed length. Compressed data size: ",
+          input.size());
+    }
+    if (uncompressed_size != output_size) {
+      return errors::Internal("Uncompressed size mismatch. Snappy expects ",
+                              uncompressed_size,
+                              " whereas the tensor metadata suggests ",
+                              output_size);
+    }
+    if (!port::Snappy_Uncompress(input.data(), input.size(), output)) {
+      return errors::Internal("Failed to perform snappy decompression.");
+    }
+    return OkStatus();
+  }
+};
+
+class ZlibCodec : public CompressionCodec {
+ public:
+  Status Compress(StringPiece input, std::string* output) const override {
+    if (input.size() > std::numeric_limits<uLong>::max()) {
+      return errors::OutOfRange(
+          "Encountered dataset element component of size ", input.size(),
+          ", exceeding the zlib limit.");
+    }
+    uLongf compressed_size = compressBound(input.size());
+    output->resize(compressed_size);
+    const int result = compress2(
+        reinterpret_cast<Bytef*>(&(*output)[0]), &compressed_size,
+        reinterpret_cast<const Bytef*>(input.data()), input.size(),
+        Z_DEFAULT_COMPRESSION);
+    if (result != Z_OK) {
+      return errors::Internal("Failed to compress using zlib: error ", result);
+    }
+    output->resize(compressed_size);
+    return OkStatus();
+  }
+
+  Status Uncompress(StringPiece input, char* output,
+                    size_t output_size) const override {
+    uLongf uncompressed_size = output_size;
+    const int result =
+        uncompress(reinterpret_cast<Bytef*>(output), &uncompressed_size,
+                   reinterpret_cast<const Bytef*>(input.data()), input.size());
+    if (result != Z_OK) {
+      return errors::Internal("Failed to perform zlib decompression: error ",
+                              result);
+    }
+    if (uncompressed_size != output_size) {
+      return errors::Internal("Uncompressed size mismatch. Zlib produced ",
+                              uncompressed_size,
+                              " bytes whereas the tensor metadata suggests ",
+                              output_size);
+    }
+    return OkStatus();
+  }
+};
+
+// Stores components as they are, e.g. for data that is already compressed.
+class NoneCodec : public CompressionCodec {
+ public:
+  Status Compress(StringPiece input, std::string* output) const override {
+    output->assign(input.data(), input.size());
+    return OkStatus();
+  }
+
+  Status Uncompress(StringPiece input, char* output,
+                    size_t output_size) const override {
+    if (input.size() != output_size) {
+      return errors::Internal("Uncompressed size mismatch. Got ", input.size(),
+                              " bytes whereas the tensor metadata suggests ",
+                              output_size);
+    }
+    memcpy(output, input.data(), output_size);
+    return OkStatus();
+  }
+};
+
+mutex* get_compression_codec_registry_lock() {
+  static mutex compression_codec_registry_lock(LINKER_INITIALIZED);
+  return &compression_codec_registry_lock;
+}
+
+absl::flat_hash_map<string, std::unique_ptr<CompressionCodec>>*
+get_compression_codecs() {
+  static auto* codecs =
+      new absl::flat_hash_map<string, std::unique_ptr<CompressionCodec>>;
+  return codecs;
+}
+
+// Calls `fn(i)` for every component `i`, where `sizes[i]` is the size of the
+// component. Large components are processed in parallel on `runner` if it is
+// not null.
+void ForEachComponent(const std::vector<size_t>& sizes,
+                      const CompressionRunner* runner,
+                      const std::function<void(size_t)>& fn) {
+  std::vector<size_t> inline_components;
+  std::vector<size_t> parallel_components;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    if (runner != nullptr && sizes[i] >= kParallelCompressionThresholdBytes) {
+      parallel_components.push_back(i);
+    } else {
+      inline_components.push_back(i);
+    }
+  }
+  // Keep the calling thread busy rather than only waiting for the runner.
+  if (inline_components.empty() && !parallel_components.empty()) {
+    inline_components.push_back(parallel_components.back());
+    parallel_components.pop_back();
+  }
+  BlockingCounter counter(parallel_components.size());
+  for (size_t i : parallel_components) {
+    (*runner)([&fn, &counter, i]() {
+      fn(i);
+      counter.DecrementCount();
+    });
+  }
+  for (size_t i : inline_components) {
+    fn(i);
+  }
+  counter.Wait();
+}
+
+// Compresses an element in the legacy format, where all components are
+// Snappy-compressed together and `codec` is left empty.
+Status CompressLegacyElement(const std::vector<Tensor>& element,
+                             CompressedElement* out) {
   // Step 1: Determine the total uncompressed size. This requires serializing
   // non-memcopyable tensors, which we save to use again later.
   std::vector<TensorProto> non_memcpy_components;
@@ -83,8 +241,10 @@ Status CompressElement(const std::vector<Tensor>& element,
   return OkStatus();
 }
 
-Status UncompressElement(const CompressedElement& compressed,
-                         std::vector<Tensor>* out) {
+// Uncompresses an element in the legacy format, where all components are
+// Snappy-compressed together.
+Status UncompressLegacyElement(const CompressedElement& compressed,
+                               std::vector<Tensor>* out) {
   int num_components = compressed.component_metadata_size();
   out->clear();
   out->reserve(num_components);
@@ -161,5 +321,195 @@ Status UncompressElement(const CompressedElement& compressed,
   return OkStatus();
 }
 
+}  // namespace
+
+// static
+void CompressionCodecRegistry::Register(const string& name,
+                                        CompressionCodec* codec) {
+  mutex_lock l(*get_compression_codec_registry_lock());
+  auto result = get_compression_codecs()->emplace(
+      name, std::unique_ptr<CompressionCodec>(codec));
+  if (!result.second) {
+    LOG(ERROR) << "Compression codec " << name << " is already registered.";
+    delete codec;
+  }
+}
+
+// static
+StatusOr<const CompressionCodec*> CompressionCodecRegistry::Get(
+    const string& name) {
+  mutex_lock l(*get_compression_codec_registry_lock());
+  auto it = get_compression_codecs()->find(name);
+  if (it == get_compression_codecs()->end()) {
+    return errors::NotFound("Compression codec ", name,
+                            " is not registered.");
+  }
+  return it->second.get();
+}
+
+Status CompressElement(const std::vector<Tensor>& element, const string& codec,
+                       const CompressionRunner* runner,
+                       CompressedElement* out) {
+  if (codec.empty()) {
+    return CompressLegacyElement(element, out);
+  }
+  StatusOr<const CompressionCodec*> compression_codec =
+      CompressionCodecRegistry::Get(codec);
+  TF_RETURN_IF_ERROR(compression_codec.status());
+
+  // Step 1: Find the uncompressed bytes of every component. Memcopyable
+  // components are compressed directly from their buffers, other components
+  // are serialized as TensorProtos.
+  const size_t num_components = element.size();
+  std::vector<std::string> serialized_components(num_components);
+  std::vector<StringPiece> uncompressed(num_components);
+  std::vector<size_t> sizes(num_components);
+  size_t total_size = 0;
+  for (size_t i = 0; i < num_components; ++i) {
+    const Tensor& component = element[i];
+    CompressedComponentMetadata* metadata =
+        out->mutable_component_metadata()->Add();
+    metadata->set_dtype(component.dtype());
+    component.shape().AsProto(metadata->mutable_tensor_shape());
+    if (DataTypeCanUseMemcpy(component.dtype())) {
+      const TensorBuffer* buffer = DMAHelper::buffer(&component);
+      if (buffer) {
+        uncompressed[i] = StringPiece(static_cast<const char*>(buffer->data()),
+                                      buffer->size());
+      }
+    } else {
+      TensorProto proto;
+      component.AsProtoTensorContent(&proto);
+      proto.SerializeToString(&serialized_components[i]);
+      uncompressed[i] = serialized_components[i];
+    }
+    metadata->set_tensor_size_bytes(uncompressed[i].size());
+    sizes[i] = uncompressed[i].size();
+    total_size += sizes[i];
+  }
+
+  // Step 2: Compress the components and concatenate the compressed bytes.
+  std::vector<std::string> compressed(num_components);
+  std::vector<Status> statuses(num_components);
+  ForEachComponent(sizes, runner, [&](size_t i) {
+    statuses[i] = (*compression_codec)->Compress(uncompressed[i],
+                                                 &compressed[i]);
+  });
+  size_t total_compressed_size = 0;
+  for (size_t i = 0; i < num_components; ++i) {
+    TF_RETURN_IF_ERROR(statuses[i]);
+    total_compressed_size += compressed[i].size();
+  }
+  std::string* data = out->mutable_data();
+  data->reserve(total_compressed_size);
+  for (size_t i = 0; i < num_components; ++i) {
+    out->mutable_component_metadata(i)->set_compressed_size_bytes(
+        compressed[i].size());
+    data->append(compressed[i]);
+  }
+  out->set_codec(codec);
+  VLOG(3) << "Compressed element with " << codec << " from " << total_size
+          << " bytes to " << total_compressed_size << " bytes";
+  return OkStatus();
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       CompressedElement* out) {
+  return CompressLegacyElement(element, out);
+}
+
+Status UncompressElement(const CompressedElement& compressed,
+                         const CompressionRunner* runner,
+                         std::vector<Tensor>* out) {
+  if (compressed.codec().empty()) {
+    return UncompressLegacyElement(compressed, out);
+  }
+  StatusOr<const CompressionCodec*> codec =
+      CompressionCodecRegistry::Get(compressed.codec());
+  TF_RETURN_IF_ERROR(codec.status());
+
+  // Step 1: Prepare the memory that we will uncompress into. Memcopyable
+  // components are uncompressed directly into their tensor buffers.
+  const size_t num_components = compressed.component_metadata_size();
+  out->clear();
+  out->reserve(num_components);
+  const std::string& data = compressed.data();
+  // We use tstring for access to resize_uninitialized.
+  std::vector<tstring> tensor_proto_strs(num_components);
+  std::vector<char*> destinations(num_components, nullptr);
+  std::vector<size_t> sizes(num_components);
+  std::vector<StringPiece> compressed_components(num_components);
+  size_t offset = 0;
+  for (size_t i = 0; i < num_components; ++i) {
+    const CompressedComponentMetadata& metadata =
+        compressed.component_metadata(i);
+    if (metadata.compressed_size_bytes() > data.size() - offset) {
+      return errors::Internal("Compressed component ", i, " of size ",
+                              metadata.compressed_size_bytes(),
+                              " exceeds the compressed data of size ",
+                              data.size());
+    }
+    compressed_components[i] =
+        StringPiece(data.data() + offset, metadata.compressed_size_bytes());
+    offset += metadata.compressed_size_bytes();
+    if (DataTypeCanUseMemcpy(metadata.dtype())) {
+      out->emplace_back(metadata.dtype(), metadata.tensor_shape());
+      TensorBuffer* buffer = DMAHelper::buffer(&out->back());
+      if (buffer) {
+        destinations[i] = static_cast<char*>(buffer->data());
+        sizes[i] = buffer->size();
+      }
+      if (sizes[i] != metadata.tensor_size_bytes()) {
+        return errors::Internal("Tensor buffer size mismatch. The buffer has ",
+                                sizes[i], " bytes whereas the tensor metadata "
+                                "suggests ", metadata.tensor_size_bytes());
+      }
+    } else {
+      // Allocate an empty Tensor. We will fill it out later after
+      // uncompressing into the tensor_proto_str.
+      out->emplace_back();
+      tensor_proto_strs[i].resize_uninitialized(metadata.tensor_size_bytes());
+      destinations[i] = tensor_proto_strs[i].mdata();
+      sizes[i] = tensor_proto_strs[i].size();
+    }
+  }
+
+  // Step 2: Uncompress the components.
+  std::vector<Status> statuses(num_components);
+  ForEachComponent(sizes, runner, [&](size_t i) {
+    if (sizes[i] > 0) {
+      statuses[i] = (*codec)->Uncompress(compressed_components[i],
+                                         destinations[i], sizes[i]);
+    }
+  });
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Step 3: Deserialize tensor proto strings to tensors.
+  for (size_t i = 0; i < num_components; ++i) {
+    if (DataTypeCanUseMemcpy(compressed.component_metadata(i).dtype())) {
+      continue;
+    }
+    TensorProto tp;
+    if (!tp.ParseFromString(tensor_proto_strs[i])) {
+      return errors::Internal("Could not parse TensorProto");
+    }
+    if (!out->at(i).FromProto(tp)) {
+      return errors::Internal("Could not parse Tensor");
+    }
+  }
+  return OkStatus();
+}
+
+Status UncompressElement(const CompressedElement& compressed,
+                         std::vector<Tensor>* out) {
+  return UncompressElement(compressed, /*runner=*/nullptr, out);
+}
+
+REGISTER_COMPRESSION_CODEC("none", NoneCodec);
+REGISTER_COMPRESSION_CODEC("snappy", SnappyCodec);
+REGISTER_COMPRESSION_CODEC("zlib", ZlibCodec);
+
 }  // namespace data
 }  // namespace tensorflow
@@ -15,22 +15,105 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_COMPRESSION_UTILS_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_COMPRESSION_UTILS_H_
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/stringpiece.h"
 
 namespace tensorflow {
 namespace data {
 
+// The codec name selecting the legacy element format, in which all components
+// are Snappy-compressed together. It is the default, since binaries older than
+// the per-component format can read only this one.
+constexpr char kLegacyCompressionCodec[] = "";
+
+// A codec for compressing the components of dataset elements.
+// Implementations must be thread-safe.
+class CompressionCodec {
+ public:
+  virtual ~CompressionCodec() = default;
+
+  // Compresses `input` into `output`, replacing its contents.
+  virtual Status Compress(StringPiece input, std::string* output) const = 0;
+
+  // Uncompresses `input` into the `output_size` bytes pointed to by `output`.
+  // Returns an error unless `input` uncompresses to exactly `output_size`
+  // bytes.
+  virtual Status Uncompress(StringPiece input, char* output,
+                            size_t output_size) const = 0;
+};
+
+// Registry of the codecs available to `CompressElement`. The "snappy", "zlib"
+// and "none" codecs are always registered; additional codecs can be linked in
+// with `REGISTER_COMPRESSION_CODEC`.
+class CompressionCodecRegistry {
+ public:
+  // Registers `codec` under `name`, taking ownership of it.
+  static void Register(const string& name, CompressionCodec* codec);
+
+  // Returns the codec registered under `name`, or a `NotFound` error.
+  static StatusOr<const CompressionCodec*> Get(const string& name);
+};
+
+// Helper class to register a compression codec.
+class CompressionCodecRegistrar {
+ public:
+  CompressionCodecRegistrar(const string& name, CompressionCodec* codec) {
+    CompressionCodecRegistry::Register(name, codec);
+  }
+};
+
+// Macro that can be used to register a compression codec, e.g.
+// `REGISTER_COMPRESSION_CODEC("snappy", SnappyCodec)`.
+#define REGISTER_COMPRESSION_CODEC(name, codec) \
+  REGISTER_COMPRESSION_CODEC_UNIQ_HELPER(__COUNTER__, name, codec)
+
+#define REGISTER_COMPRESSION_CODEC_UNIQ_HELPER(ctr, name, codec) \
+  REGISTER_COMPRESSION_CODEC_UNIQ(ctr, name, codec)
+
+#define REGISTER_COMPRESSION_CODEC_UNIQ(ctr, name, codec)   \
+  static ::tensorflow::data::CompressionCodecRegistrar      \
+      compression_codec_registrar__body__##ctr##__object(name, new codec)
+
+// Runs closures, e.g. on a threadpool. Matches `OpKernelContext::runner()`.
+using CompressionRunner = std::function<void(std::function<void()>)>;
+
 // Compresses the components of `element` into the `CompressedElement` proto.
 //
+// If `codec` is `kLegacyCompressionCodec`, the element is written in the
+// legacy format. Otherwise each component is compressed separately with the
+// codec registered as `codec`, directly from its tensor buffer, and `runner`,
+// if not null, compresses large components in parallel. Only readers that
+// know the per-component format can uncompress such elements, so callers must
+// opt into it explicitly.
+//
 // In addition to writing the actual compressed bytes, `Compress` fills
 // out the per-component metadata for the `CompressedElement`.
 //
-// Returns an error if the uncompressed size of the element exceeds 4GB.
+// Returns an error if the codec is not registered, or if it cannot compress a
+// component, e.g. because a component exceeds the 4GB Snappy limit.
+Status CompressElement(const std::vector<Tensor>& element, const string& codec,
+                       const CompressionRunner* runner, CompressedElement* out);
+
+// Compresses the components of `element` in the legacy format.
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out);
 
+// Uncompresses a `CompressedElement` into a vector of tensor components.
+//
+// Memcopyable components are uncompressed directly into the buffers of the
+// output tensors. If `runner` is not null, large components are uncompressed
+// in parallel on it.
+Status UncompressElement(const CompressedElement& compressed,
+                         const CompressionRunner* runner,
+                         std::vector<Tensor>* out);
+
 // Uncompresses a `CompressedElement` into a vector of tensor components.
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
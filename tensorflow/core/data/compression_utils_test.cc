@@ -16,8 +16,10 @@ limitations under the License.
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
@@ -36,6 +38,68 @@ TEST(CompressionUtilsTest, Exceeds4GB) {
                        HasSubstr("exceeding the 4GB Snappy limit")));
 }
 
+TEST(CompressionUtilsTest, UnknownCodec) {
+  CompressedElement compressed;
+  EXPECT_THAT(CompressElement({CreateTensor<int64_t>(TensorShape{1}, {1})},
+                              "unknown", /*runner=*/nullptr, &compressed),
+              StatusIs(error::NOT_FOUND, HasSubstr("not registered")));
+}
+
+TEST(CompressionUtilsTest, UncompressLegacyElement) {
+  // Elements compressed before codecs were introduced Snappy-compress the
+  // concatenation of all components.
+  Tensor component = CreateTensor<int64_t>(TensorShape{3}, {1, 2, 3});
+  CompressedElement compressed;
+  CompressedComponentMetadata* metadata = compressed.add_component_metadata();
+  metadata->set_dtype(component.dtype());
+  component.shape().AsProto(metadata->mutable_tensor_shape());
+  metadata->set_tensor_size_bytes(component.TotalBytes());
+  ASSERT_TRUE(port::Snappy_Compress(component.tensor_data().data(),
+                                    component.TotalBytes(),
+                                    compressed.mutable_data()));
+  std::vector<Tensor> uncompressed;
+  TF_ASSERT_OK(UncompressElement(compressed, &uncompressed));
+  TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual({component}, uncompressed,
+                                               /*compare_order=*/true));
+}
+
+TEST(CompressionUtilsTest, DefaultsToLegacyFormat) {
+  // Older readers only understand whole-element Snappy compression, so the
+  // per-component format must be requested with a codec.
+  Tensor component = CreateTensor<int64_t>(TensorShape{3}, {1, 2, 3});
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement({component}, &compressed));
+  EXPECT_TRUE(compressed.codec().empty());
+  EXPECT_EQ(compressed.component_metadata(0).compressed_size_bytes(), 0);
+  std::string uncompressed(component.TotalBytes(), '\0');
+  ASSERT_TRUE(port::Snappy_Uncompress(compressed.data().data(),
+                                      compressed.data().size(),
+                                      &uncompressed[0]));
+  EXPECT_EQ(uncompressed, component.tensor_data());
+}
+
+TEST(CompressionUtilsTest, ParallelRoundTrip) {
+  // Components of at least 1MB are compressed on the runner.
+  std::vector<Tensor> element;
+  for (int i = 0; i < 4; ++i) {
+    Tensor component(DT_INT64, TensorShape{256 * 1024});
+    component.flat<int64_t>().setConstant(i);
+    element.push_back(component);
+  }
+  element.push_back(CreateTensor<tstring>(TensorShape{1}, {"a"}));
+  thread::ThreadPool pool(Env::Default(), "compression", 4);
+  CompressionRunner runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, "zlib", &runner, &compressed));
+  EXPECT_LT(compressed.data().size(), 1024 * 1024);
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(compressed, &runner, &round_trip_element));
+  TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual(element, round_trip_element,
+                                               /*compare_order=*/true));
+}
+
 class ParameterizedCompressionUtilsTest
     : public DatasetOpsTestBase,
       public ::testing::WithParamInterface<std::vector<Tensor>> {};
@@ -64,5 +128,28 @@ std::vector<std::vector<Tensor>> TestCases() {
 INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedCompressionUtilsTest,
                          ::testing::ValuesIn(TestCases()));
 
+class ParameterizedCodecTest
+    : public DatasetOpsTestBase,
+      public ::testing::WithParamInterface<
+          std::tuple<std::vector<Tensor>, std::string>> {};
+
+TEST_P(ParameterizedCodecTest, RoundTrip) {
+  std::vector<Tensor> element = std::get<0>(GetParam());
+  const std::string& codec = std::get<1>(GetParam());
+  CompressedElement compressed;
+  TF_ASSERT_OK(
+      CompressElement(element, codec, /*runner=*/nullptr, &compressed));
+  EXPECT_EQ(compressed.codec(), codec);
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+  TF_EXPECT_OK(
+      ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+}
+
+INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedCodecTest,
+                         ::testing::Combine(::testing::ValuesIn(TestCases()),
+                                            ::testing::Values("snappy", "zlib",
+                                                              "none")));
+
 }  // namespace data
 }  // namespace tensorflow
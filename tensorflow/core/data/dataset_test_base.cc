@@ -155,6 +155,7 @@ Status WriteDataToTFRecordFile(const string& filename,
   auto options = io::RecordWriterOptions::CreateRecordWriterOptions(
       ToString(params.compression_type));
   options.zlib_options.input_buffer_size = params.input_buffer_size;
+  options.zlib_options.gzip_member_size = params.gzip_member_size;
   io::RecordWriter record_writer(file_writer.get(), options);
   for (const auto& record : records) {
     TF_RETURN_IF_ERROR(record_writer.WriteRecord(record));
@@ -111,6 +111,7 @@ struct CompressionParams {
   CompressionType compression_type = CompressionType::UNCOMPRESSED;
   int32 input_buffer_size = 0;
   int32 output_buffer_size = 0;
+  int64_t gzip_member_size = 0;
 };
 
 // Writes the input data into the file without compression.
@@ -43,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/regexp.h"
+#include "tensorflow/core/util/batch_util.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/work_sharder.h"
 
@@ -735,7 +736,7 @@ Status ProcessBatch(int64_t batch_size, int64_t num_elements,
 }
 
 Status CopyBatch(CopyBatchParams params,
-                 const std::vector<std::vector<Tensor>>& batch_elements,
+                 std::vector<std::vector<Tensor>>&& batch_elements,
                  bool parallel_copy,
                  std::function<Status()> allocation_callback,
                  std::vector<Tensor>* out_tensors) {
@@ -764,9 +765,10 @@ Status CopyBatch(CopyBatchParams params,
     Tensor& batch_component = out_tensors->at(component_index);
     const Tensor& first_element = batch_elements.at(0)[component_index];
     TensorShape first_element_shape(first_element.shape());
+    const batch_util::ElementCopier copier(&batch_component);
     // Build the output tuple component by copying one slice from each input
     // element in the batch.
-    auto copy_element_fn = [component_index, &batch_elements, &batch_component,
+    auto copy_element_fn = [component_index, &batch_elements, &copier,
                             &first_element_shape](int index) {
       if (batch_elements.at(index)[component_index].shape() !=
           first_element_shape) {
@@ -778,9 +780,8 @@ Status CopyBatch(CopyBatchParams params,
             batch_elements.at(index)[component_index].shape().DebugString(),
             ".");
       }
-      return batch_util::CopyElementToSlice(
-          std::move(batch_elements.at(index)[component_index]),
-          &batch_component, index);
+      return copier.CopyElementToSlice(
+          std::move(batch_elements.at(index)[component_index]), index);
     };
     if (parallel_copy && first_element.AllocatedBytes() > (1 << 15)) {
       Status status;
@@ -865,6 +866,11 @@ bool ShouldUsePrivateThreadPool(const Options& options) {
          ThreadingOptions::kPrivateThreadpoolSize;
 }
 
+bool ShouldPinToNUMANode(const Options& options) {
+  return options.threading_options().optional_numa_node_case() ==
+         ThreadingOptions::kNumaNode;
+}
+
 bool ShouldUseAutotuning(const Options& options) {
   return options.autotune_options().optional_enabled_case() !=
              AutotuneOptions::kEnabled ||
@@ -902,9 +908,12 @@ absl::flat_hash_map<string, int64_t> DatasetExperimentRegistry::Experiments() {
 namespace {
 
 REGISTER_DATASET_EXPERIMENT("allow_small_function_optimizations", 0);
+REGISTER_DATASET_EXPERIMENT("async_file_reads", 0);
+REGISTER_DATASET_EXPERIMENT("decode_crop_and_resize_fusion", 0);
 REGISTER_DATASET_EXPERIMENT(kFilterParallelizationOpt, 50);
 REGISTER_DATASET_EXPERIMENT("inject_prefetch", 100);
 REGISTER_DATASET_EXPERIMENT("min_outer_interleave_parallelism", 0);
+REGISTER_DATASET_EXPERIMENT("mmap_tfrecord_reader", 0);
 REGISTER_DATASET_EXPERIMENT("reduce_interleave_prefetch", 0);
 }  // namespace
 }  // namespace data
@@ -295,18 +295,33 @@ struct CopyBatchParams {
     runner = ctx->runner();
     runner_threadpool_size = GetRunnerThreadpoolSizeFromOpKernelContext(ctx);
   }
+
+  explicit CopyBatchParams(AnyContext ctx) {
+    allocator = ctx.allocator;
+    runner = ctx.runner;
+    runner_threadpool_size = ctx.runner_threadpool_size;
+  }
+
+  CopyBatchParams(Allocator* allocator,
+                  std::function<void(std::function<void()>)>* runner,
+                  int64 runner_threadpool_size)
+      : allocator(allocator),
+        runner(runner),
+        runner_threadpool_size(runner_threadpool_size) {}
 };
 
 // Copies the input elements to a batch.
 //
 // The `batch_elements` argument contains the individual elements to copy into a
-// batch. The `parallel_copy` argument indicates whether to parallelize the
-// copy. The `allocation_callback` argument can be used to pass a callback to
-// invoke upon successful allocation of the memory for the batch. The
-// `out_tensors` argument will be used to store the resulting batch (one for
-// each component of the input).
+// batch. The elements are moved into the batch, so that the values of elements
+// that are not shared with other tensors (e.g. the outputs of a map function)
+// can be moved instead of copied. The `parallel_copy` argument indicates
+// whether to parallelize the copy. The `allocation_callback` argument can be
+// used to pass a callback to invoke upon successful allocation of the memory
+// for the batch. The `out_tensors` argument will be used to store the
+// resulting batch (one for each component of the input).
 Status CopyBatch(CopyBatchParams params,
-                 const std::vector<std::vector<Tensor>>& batch_elements,
+                 std::vector<std::vector<Tensor>>&& batch_elements,
                  bool parallel_copy,
                  std::function<Status()> allocation_callback,
                  std::vector<Tensor>* out_tensors);
@@ -342,6 +357,9 @@ bool ShouldConfigureMaxIntraOpParallelism(const Options& options);
 // Determines whether private threadpool should be used.
 bool ShouldUsePrivateThreadPool(const Options& options);
 
+// Determines whether the dataset threads should be bound to a NUMA node.
+bool ShouldPinToNUMANode(const Options& options);
+
 // Determines whether autotuning should be used.
 bool ShouldUseAutotuning(const Options& options);
 
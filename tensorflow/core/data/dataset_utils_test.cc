@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -576,6 +577,70 @@ TEST(DeterministicOpsTest, GetOptimizations) {
   EXPECT_EQ(actual_disabled.size(), 0);
 }
 
+// Copies `batch_elements` into a batch, using the calling thread to run all
+// work.
+Status CopyBatchInline(std::vector<std::vector<Tensor>>&& batch_elements,
+                       std::vector<Tensor>* out_tensors) {
+  std::function<void(std::function<void()>)> runner =
+      [](std::function<void()> fn) { fn(); };
+  return CopyBatch(CopyBatchParams(cpu_allocator(), &runner,
+                                   /*runner_threadpool_size=*/1),
+                   std::move(batch_elements),
+                   /*parallel_copy=*/false, /*allocation_callback=*/nullptr,
+                   out_tensors);
+}
+
+TEST(DatasetUtilsTest, CopyBatch) {
+  std::vector<std::vector<Tensor>> batch_elements;
+  for (int64_t i = 0; i < 4; ++i) {
+    batch_elements.push_back(
+        {test::AsScalar<int64_t>(i), test::AsTensor<float>({i * 1.0f, -1.0f}),
+         test::AsScalar<tstring>(absl::StrCat("element_", i))});
+  }
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(CopyBatchInline(std::move(batch_elements), &out_tensors));
+  ASSERT_EQ(out_tensors.size(), 3);
+  test::ExpectEqual(out_tensors[0], test::AsTensor<int64_t>({0, 1, 2, 3}));
+  test::ExpectEqual(out_tensors[1],
+                    test::AsTensor<float>({0.0f, -1.0f, 1.0f, -1.0f, 2.0f,
+                                           -1.0f, 3.0f, -1.0f},
+                                          TensorShape({4, 2})));
+  test::ExpectEqual(out_tensors[2],
+                    test::AsTensor<tstring>({"element_0", "element_1",
+                                             "element_2", "element_3"}));
+}
+
+TEST(DatasetUtilsTest, CopyBatchMovesStrings) {
+  // The string is too long to be stored inline, so moving it keeps its data.
+  Tensor element = test::AsScalar<tstring>(string(100, 'a'));
+  const char* data = element.scalar<tstring>()().data();
+  std::vector<std::vector<Tensor>> batch_elements;
+  batch_elements.push_back({std::move(element)});
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(CopyBatchInline(std::move(batch_elements), &out_tensors));
+  ASSERT_EQ(out_tensors.size(), 1);
+  EXPECT_EQ(out_tensors[0].vec<tstring>()(0), string(100, 'a'));
+  EXPECT_EQ(out_tensors[0].vec<tstring>()(0).data(), data);
+
+  // Strings shared with other tensors are copied.
+  Tensor shared = test::AsScalar<tstring>(string(100, 'b'));
+  batch_elements.clear();
+  batch_elements.push_back({shared});
+  out_tensors.clear();
+  TF_ASSERT_OK(CopyBatchInline(std::move(batch_elements), &out_tensors));
+  EXPECT_EQ(out_tensors[0].vec<tstring>()(0), string(100, 'b'));
+  EXPECT_EQ(shared.scalar<tstring>()(), string(100, 'b'));
+}
+
+TEST(DatasetUtilsTest, CopyBatchDifferentShapes) {
+  std::vector<std::vector<Tensor>> batch_elements;
+  batch_elements.push_back({test::AsTensor<int64_t>({1, 2})});
+  batch_elements.push_back({test::AsTensor<int64_t>({1, 2, 3})});
+  std::vector<Tensor> out_tensors;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      CopyBatchInline(std::move(batch_elements), &out_tensors)));
+}
+
 REGISTER_DATASET_EXPERIMENT("test_only_experiment", 42);
 
 TEST(DatasetUtilsTest, DatasetExperimentRegistry) {
@@ -0,0 +1,289 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/incremental_checkpoint.h"
+
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/numbers.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/str_util.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Must match the delimiter used by `VariantTensorDataWriter`.
+constexpr char kDelimiter[] = "@@";
+constexpr char kBundlePrefix[] = "checkpoint-";
+constexpr char kLatestCheckpointFile[] = "checkpoint";
+// Iterator names are never empty, so these cannot clash with tensor keys.
+constexpr char kMetadataKey[] = "@@metadata";
+constexpr char kSourcesKey[] = "@@sources";
+constexpr char kFingerprintsKey[] = "@@fingerprints";
+// Marks tensors whose contents cannot be fingerprinted, which are never reused.
+constexpr uint64 kNoFingerprint = 0;
+
+std::string BundlePrefix(const std::string& directory, int64_t checkpoint_id) {
+  return io::JoinPath(directory, absl::StrCat(kBundlePrefix, checkpoint_id));
+}
+
+uint64 FingerprintTensor(const Tensor& tensor) {
+  uint64 fingerprint = FingerprintCat64(tensor.dtype(), tensor.dims());
+  for (int64_t dim : tensor.shape().dim_sizes()) {
+    fingerprint = FingerprintCat64(fingerprint, dim);
+  }
+  if (tensor.dtype() == DT_STRING) {
+    const auto values = tensor.flat<tstring>();
+    for (int64_t i = 0; i < values.size(); ++i) {
+      fingerprint = FingerprintCat64(fingerprint, Fingerprint64(values(i)));
+    }
+  } else if (DataTypeCanUseMemcpy(tensor.dtype())) {
+    fingerprint =
+        FingerprintCat64(fingerprint, Fingerprint64(tensor.tensor_data()));
+  } else {
+    return kNoFingerprint;
+  }
+  return fingerprint == kNoFingerprint ? kNoFingerprint + 1 : fingerprint;
+}
+
+// Appends the bundle keys of the tensors described by `metadata`, in order.
+void AppendTensorKeys(const std::string& metadata,
+                      std::vector<std::string>* keys) {
+  std::vector<std::string> names =
+      str_util::Split(metadata, kDelimiter, str_util::SkipEmpty());
+  for (int64_t i = 1; i < names.size(); ++i) {
+    keys->push_back(absl::StrCat(names[0], kDelimiter, names[i]));
+  }
+}
+
+// The contents of the latest bundle of a checkpoint besides the new tensors.
+struct Manifest {
+  std::vector<std::string> metadata;
+  std::vector<int64_t> num_tensors;
+  std::vector<std::string> keys;
+  std::vector<int64_t> sources;
+  std::vector<uint64> fingerprints;
+};
+
+Status ReadManifest(BundleReader* reader, Manifest* manifest) {
+  Tensor metadata, sources, fingerprints;
+  TF_RETURN_IF_ERROR(reader->Lookup(kMetadataKey, &metadata));
+  TF_RETURN_IF_ERROR(reader->Lookup(kSourcesKey, &sources));
+  TF_RETURN_IF_ERROR(reader->Lookup(kFingerprintsKey, &fingerprints));
+  if (sources.NumElements() != fingerprints.NumElements()) {
+    return errors::DataLoss("Malformed iterator checkpoint manifest: found ",
+                            sources.NumElements(), " sources and ",
+                            fingerprints.NumElements(), " fingerprints");
+  }
+  for (int64_t i = 0; i < metadata.NumElements(); ++i) {
+    const std::string data_metadata = metadata.flat<tstring>()(i);
+    manifest->metadata.push_back(data_metadata);
+    const int64_t num_keys = manifest->keys.size();
+    AppendTensorKeys(data_metadata, &manifest->keys);
+    manifest->num_tensors.push_back(manifest->keys.size() - num_keys);
+  }
+  if (manifest->keys.size() != sources.NumElements()) {
+    return errors::DataLoss("Malformed iterator checkpoint manifest: found ",
+                            manifest->keys.size(), " keys and ",
+                            sources.NumElements(), " sources");
+  }
+  for (int64_t i = 0; i < sources.NumElements(); ++i) {
+    manifest->sources.push_back(sources.flat<int64_t>()(i));
+    manifest->fingerprints.push_back(
+        static_cast<uint64>(fingerprints.flat<int64_t>()(i)));
+  }
+  return OkStatus();
+}
+
+// Reads the ID of the latest checkpoint of `directory`, or `-1` if the
+// directory has no checkpoint.
+Status ReadLatestCheckpointId(Env* env, const std::string& directory,
+                              int64_t* checkpoint_id) {
+  const std::string filename = io::JoinPath(directory, kLatestCheckpointFile);
+  if (!env->FileExists(filename).ok()) {
+    *checkpoint_id = -1;
+    return OkStatus();
+  }
+  std::string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, filename, &contents));
+  if (!strings::safe_strto64(contents, checkpoint_id)) {
+    return errors::DataLoss("Malformed iterator checkpoint file ", filename,
+                            ": ", contents);
+  }
+  return OkStatus();
+}
+
+// Atomically makes `checkpoint_id` the latest checkpoint of `directory`.
+Status WriteLatestCheckpointId(Env* env, const std::string& directory,
+                               int64_t checkpoint_id) {
+  const std::string filename = io::JoinPath(directory, kLatestCheckpointFile);
+  const std::string temp_filename = absl::StrCat(filename, ".tmp");
+  TF_RETURN_IF_ERROR(
+      WriteStringToFile(env, temp_filename, absl::StrCat(checkpoint_id)));
+  return env->RenameFile(temp_filename, filename);
+}
+
+}  // namespace
+
+IncrementalCheckpointWriter::IncrementalCheckpointWriter(
+    Env* env, const std::string& directory)
+    : env_(env), directory_(directory) {}
+
+Status IncrementalCheckpointWriter::Write(
+    const std::vector<const VariantTensorData*>& data) {
+  TF_RETURN_IF_ERROR(MaybeInitialize());
+  const int64_t checkpoint_id = checkpoint_id_ + 1;
+  BundleWriter writer(env_, BundlePrefix(directory_, checkpoint_id));
+  TF_RETURN_IF_ERROR(writer.status());
+
+  absl::flat_hash_map<std::string, TensorSource> sources;
+  Tensor metadata(DT_STRING, TensorShape({static_cast<int64_t>(data.size())}));
+  std::vector<int64_t> source_ids;
+  std::vector<int64_t> fingerprints;
+  num_tensors_written_ = 0;
+  num_tensors_reused_ = 0;
+  for (int64_t i = 0; i < data.size(); ++i) {
+    std::string data_metadata;
+    data[i]->get_metadata(&data_metadata);
+    std::vector<std::string> keys;
+    AppendTensorKeys(data_metadata, &keys);
+    if (keys.size() != data[i]->tensors_size()) {
+      return errors::InvalidArgument(
+          "Malformed iterator state: expected ", data[i]->tensors_size(),
+          " keys but found ", keys.size(), " in ", data_metadata);
+    }
+    metadata.vec<tstring>()(i) = data_metadata;
+    for (int64_t j = 0; j < keys.size(); ++j) {
+      const Tensor& tensor = data[i]->tensors(j);
+      TensorSource source{checkpoint_id, FingerprintTensor(tensor)};
+      auto it = sources_.find(keys[j]);
+      // The 64-bit fingerprint makes it vanishingly unlikely that a changed
+      // tensor is mistaken for an unchanged one.
+      if (source.fingerprint != kNoFingerprint && it != sources_.end() &&
+          it->second.fingerprint == source.fingerprint) {
+        source.checkpoint_id = it->second.checkpoint_id;
+        ++num_tensors_reused_;
+      } else {
+        TF_RETURN_IF_ERROR(writer.Add(keys[j], tensor));
+        ++num_tensors_written_;
+      }
+      source_ids.push_back(source.checkpoint_id);
+      fingerprints.push_back(static_cast<int64_t>(source.fingerprint));
+      sources[keys[j]] = source;
+    }
+  }
+  Tensor sources_t(DT_INT64,
+                   TensorShape({static_cast<int64_t>(source_ids.size())}));
+  Tensor fingerprints_t(DT_INT64, sources_t.shape());
+  std::copy(source_ids.begin(), source_ids.end(),
+            sources_t.flat<int64_t>().data());
+  std::copy(fingerprints.begin(), fingerprints.end(),
+            fingerprints_t.flat<int64_t>().data());
+  TF_RETURN_IF_ERROR(writer.Add(kMetadataKey, metadata));
+  TF_RETURN_IF_ERROR(writer.Add(kSourcesKey, sources_t));
+  TF_RETURN_IF_ERROR(writer.Add(kFingerprintsKey, fingerprints_t));
+  TF_RETURN_IF_ERROR(writer.Finish());
+  TF_RETURN_IF_ERROR(WriteLatestCheckpointId(env_, directory_, checkpoint_id));
+
+  checkpoint_id_ = checkpoint_id;
+  sources_ = std::move(sources);
+  return DeleteUnreferencedBundles();
+}
+
+Status IncrementalCheckpointWriter::MaybeInitialize() {
+  if (initialized_) {
+    return OkStatus();
+  }
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+  TF_RETURN_IF_ERROR(ReadLatestCheckpointId(env_, directory_, &checkpoint_id_));
+  if (checkpoint_id_ >= 0) {
+    BundleReader reader(env_, BundlePrefix(directory_, checkpoint_id_));
+    TF_RETURN_IF_ERROR(reader.status());
+    Manifest manifest;
+    TF_RETURN_IF_ERROR(ReadManifest(&reader, &manifest));
+    for (int64_t i = 0; i < manifest.keys.size(); ++i) {
+      sources_[manifest.keys[i]] =
+          TensorSource{manifest.sources[i], manifest.fingerprints[i]};
+    }
+  }
+  initialized_ = true;
+  return OkStatus();
+}
+
+Status IncrementalCheckpointWriter::DeleteUnreferencedBundles() {
+  absl::flat_hash_set<int64_t> referenced = {checkpoint_id_};
+  for (const auto& it : sources_) {
+    referenced.insert(it.second.checkpoint_id);
+  }
+  std::vector<std::string> children;
+  TF_RETURN_IF_ERROR(env_->GetChildren(directory_, &children));
+  for (const std::string& child : children) {
+    StringPiece name(child);
+    int64_t checkpoint_id;
+    if (!str_util::ConsumePrefix(&name, kBundlePrefix) ||
+        !strings::safe_strto64(name.substr(0, name.find('.')),
+                               &checkpoint_id) ||
+        referenced.contains(checkpoint_id)) {
+      continue;
+    }
+    TF_RETURN_IF_ERROR(env_->DeleteFile(io::JoinPath(directory_, child)));
+  }
+  return OkStatus();
+}
+
+Status ReadIncrementalCheckpoint(
+    Env* env, const std::string& directory,
+    std::vector<std::unique_ptr<VariantTensorData>>* data) {
+  int64_t checkpoint_id;
+  TF_RETURN_IF_ERROR(ReadLatestCheckpointId(env, directory, &checkpoint_id));
+  if (checkpoint_id < 0) {
+    return errors::NotFound("No iterator checkpoint found in ", directory);
+  }
+  absl::flat_hash_map<int64_t, std::unique_ptr<BundleReader>> readers;
+  readers[checkpoint_id] = std::make_unique<BundleReader>(
+      env, BundlePrefix(directory, checkpoint_id));
+  TF_RETURN_IF_ERROR(readers[checkpoint_id]->status());
+  Manifest manifest;
+  TF_RETURN_IF_ERROR(ReadManifest(readers[checkpoint_id].get(), &manifest));
+
+  int64_t tensor_index = 0;
+  for (int64_t i = 0; i < manifest.metadata.size(); ++i) {
+    auto variant_data = std::make_unique<VariantTensorData>();
+    variant_data->set_type_name("tensorflow::Iterator");
+    variant_data->set_metadata(manifest.metadata[i]);
+    for (int64_t j = 0; j < manifest.num_tensors[i]; ++j, ++tensor_index) {
+      const int64_t source = manifest.sources[tensor_index];
+      std::unique_ptr<BundleReader>& reader = readers[source];
+      if (!reader) {
+        reader = std::make_unique<BundleReader>(
+            env, BundlePrefix(directory, source));
+        TF_RETURN_IF_ERROR(reader->status());
+      }
+      TF_RETURN_IF_ERROR(reader->Lookup(manifest.keys[tensor_index],
+                                        variant_data->add_tensors()));
+    }
+    data->push_back(std::move(variant_data));
+  }
+  return OkStatus();
+}
+
+}  // namespace data
+}  // namespace tensorflow
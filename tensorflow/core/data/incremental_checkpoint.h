@@ -0,0 +1,88 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_INCREMENTAL_CHECKPOINT_H_
+#define TENSORFLOW_CORE_DATA_INCREMENTAL_CHECKPOINT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Writes iterator checkpoints to a directory, one tensor bundle per checkpoint.
+//
+// `Write` streams the tensors of the given iterator state (as built by
+// `VariantTensorDataWriter`) directly into the bundle, without serializing the
+// state into a variant first. A tensor whose contents are unchanged since the
+// previous checkpoint of the directory is not written again: the new bundle
+// records which earlier bundle holds it instead. For a shuffle buffer or an
+// in-memory cache, this makes each checkpoint proportional to the number of
+// elements that changed since the previous one. Bundles that the latest
+// checkpoint no longer refers to are deleted.
+//
+// This class is not thread-safe.
+class IncrementalCheckpointWriter {
+ public:
+  IncrementalCheckpointWriter(Env* env, const std::string& directory);
+
+  // Writes `data` as the latest checkpoint of the directory.
+  Status Write(const std::vector<const VariantTensorData*>& data);
+
+  const std::string& directory() const { return directory_; }
+
+  // Returns the number of tensors written and reused by the last `Write`.
+  int64_t num_tensors_written() const { return num_tensors_written_; }
+  int64_t num_tensors_reused() const { return num_tensors_reused_; }
+
+ private:
+  // Where the contents of a tensor are stored.
+  struct TensorSource {
+    int64_t checkpoint_id;
+    uint64 fingerprint;
+  };
+
+  // Loads the sources of the latest checkpoint in the directory, if any.
+  Status MaybeInitialize();
+
+  // Deletes the bundles of the directory not referenced by `sources_`.
+  Status DeleteUnreferencedBundles();
+
+  Env* const env_;
+  const std::string directory_;
+  bool initialized_ = false;
+  int64_t checkpoint_id_ = -1;
+  // Maps the keys of the latest checkpoint to where their tensors are stored.
+  absl::flat_hash_map<std::string, TensorSource> sources_;
+  int64_t num_tensors_written_ = 0;
+  int64_t num_tensors_reused_ = 0;
+};
+
+// Reads the latest checkpoint written to `directory` by
+// `IncrementalCheckpointWriter`. The result can be read through
+// `VariantTensorDataReader`.
+Status ReadIncrementalCheckpoint(
+    Env* env, const std::string& directory,
+    std::vector<std::unique_ptr<VariantTensorData>>* data);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_INCREMENTAL_CHECKPOINT_H_
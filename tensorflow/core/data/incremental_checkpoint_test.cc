@@ -0,0 +1,149 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/incremental_checkpoint.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kIteratorName[] = "Iterator::Root::Shuffle";
+
+std::string TestDirectory(const std::string& name) {
+  return io::JoinPath(testing::TmpDir(), name);
+}
+
+// Writes `buffer` and `num_consumed` as the state of an iterator.
+Status WriteState(const std::vector<Tensor>& buffer, int64_t num_consumed,
+                  IncrementalCheckpointWriter* checkpoint_writer) {
+  VariantTensorDataWriter writer;
+  TF_RETURN_IF_ERROR(
+      writer.WriteScalar(kIteratorName, "num_consumed", num_consumed));
+  for (int64_t i = 0; i < buffer.size(); ++i) {
+    TF_RETURN_IF_ERROR(
+        writer.WriteTensor(kIteratorName, absl::StrCat("buffer", i),
+                           buffer[i]));
+  }
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  return checkpoint_writer->Write(data);
+}
+
+void ExpectState(const std::string& directory,
+                 const std::vector<Tensor>& buffer, int64_t num_consumed) {
+  std::vector<std::unique_ptr<VariantTensorData>> data;
+  TF_ASSERT_OK(ReadIncrementalCheckpoint(Env::Default(), directory, &data));
+  std::vector<const VariantTensorData*> data_ptrs;
+  for (const auto& d : data) {
+    data_ptrs.push_back(d.get());
+  }
+  VariantTensorDataReader reader(data_ptrs);
+  int64_t read_num_consumed;
+  TF_ASSERT_OK(
+      reader.ReadScalar(kIteratorName, "num_consumed", &read_num_consumed));
+  EXPECT_EQ(read_num_consumed, num_consumed);
+  for (int64_t i = 0; i < buffer.size(); ++i) {
+    Tensor tensor;
+    TF_ASSERT_OK(
+        reader.ReadTensor(kIteratorName, absl::StrCat("buffer", i), &tensor));
+    test::ExpectEqual(tensor, buffer[i]);
+  }
+}
+
+std::vector<Tensor> MakeBuffer(int64_t size) {
+  std::vector<Tensor> buffer;
+  for (int64_t i = 0; i < size; ++i) {
+    buffer.push_back(test::AsTensor<int64_t>({i, 2 * i, 3 * i}));
+  }
+  return buffer;
+}
+
+TEST(IncrementalCheckpointTest, WritesOnlyChangedTensors) {
+  const std::string directory = TestDirectory("changed_tensors");
+  IncrementalCheckpointWriter writer(Env::Default(), directory);
+  std::vector<Tensor> buffer = MakeBuffer(10);
+  TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/0, &writer));
+  EXPECT_EQ(writer.num_tensors_written(), 11);
+  EXPECT_EQ(writer.num_tensors_reused(), 0);
+  ExpectState(directory, buffer, 0);
+
+  buffer[3] = test::AsTensor<tstring>({"a", "b"});
+  buffer[7] = test::AsTensor<int64_t>({-1});
+  TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/2, &writer));
+  EXPECT_EQ(writer.num_tensors_written(), 3);
+  EXPECT_EQ(writer.num_tensors_reused(), 8);
+  ExpectState(directory, buffer, 2);
+
+  TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/2, &writer));
+  EXPECT_EQ(writer.num_tensors_written(), 0);
+  EXPECT_EQ(writer.num_tensors_reused(), 11);
+  ExpectState(directory, buffer, 2);
+}
+
+TEST(IncrementalCheckpointTest, DeletesUnreferencedBundles) {
+  const std::string directory = TestDirectory("unreferenced_bundles");
+  IncrementalCheckpointWriter writer(Env::Default(), directory);
+  TF_ASSERT_OK(WriteState(MakeBuffer(5), /*num_consumed=*/0, &writer));
+  std::vector<Tensor> buffer;
+  for (int64_t i = 0; i < 5; ++i) {
+    buffer.push_back(test::AsScalar<int64_t>(i));
+  }
+  TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/5, &writer));
+  ExpectState(directory, buffer, 5);
+
+  std::vector<std::string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &children));
+  for (const std::string& child : children) {
+    EXPECT_FALSE(absl::StartsWith(child, "checkpoint-0")) << child;
+  }
+}
+
+TEST(IncrementalCheckpointTest, ResumesFromExistingCheckpoint) {
+  const std::string directory = TestDirectory("existing_checkpoint");
+  std::vector<Tensor> buffer = MakeBuffer(4);
+  {
+    IncrementalCheckpointWriter writer(Env::Default(), directory);
+    TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/0, &writer));
+  }
+  IncrementalCheckpointWriter writer(Env::Default(), directory);
+  buffer[0] = test::AsTensor<int64_t>({42});
+  TF_ASSERT_OK(WriteState(buffer, /*num_consumed=*/1, &writer));
+  EXPECT_EQ(writer.num_tensors_written(), 2);
+  EXPECT_EQ(writer.num_tensors_reused(), 3);
+  ExpectState(directory, buffer, 1);
+}
+
+TEST(IncrementalCheckpointTest, NoCheckpoint) {
+  std::vector<std::unique_ptr<VariantTensorData>> data;
+  EXPECT_TRUE(errors::IsNotFound(ReadIncrementalCheckpoint(
+      Env::Default(), TestDirectory("no_checkpoint"), &data)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
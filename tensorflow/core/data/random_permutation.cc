@@ -0,0 +1,82 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/random_permutation.h"
+
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// The finalizer of MurmurHash3, which mixes all bits of `value`.
+uint64 Mix(uint64 value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+}  // namespace
+
+RandomPermutation::RandomPermutation(int64_t size, int64_t seed,
+                                     int64_t seed2)
+    : size_(size) {
+  DCHECK_GE(size, 0);
+  // Any `size` fits in 64 bits, so the domain never needs more than 32 bits
+  // per half. Stopping there also keeps the shift below 64.
+  while (half_bits_ < 32 &&
+         (uint64{1} << (2 * half_bits_)) < static_cast<uint64>(size)) {
+    ++half_bits_;
+  }
+  half_mask_ = (uint64{1} << half_bits_) - 1;
+  random::PhiloxRandom parent_generator(seed, seed2);
+  random::SingleSampleAdapter<random::PhiloxRandom> generator(
+      &parent_generator);
+  for (uint64& round_key : round_keys_) {
+    round_key = (static_cast<uint64>(generator()) << 32) | generator();
+  }
+}
+
+int64_t RandomPermutation::Map(int64_t index) const {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, size_);
+  // The network permutes the domain, so starting from an index in
+  // `[0, size_)` and applying it until the result is back in `[0, size_)`
+  // permutes `[0, size_)`. The domain is less than four times larger than
+  // `[0, size_)`, so this takes fewer than four applications on average.
+  uint64 value = index;
+  do {
+    value = Encrypt(value);
+  } while (value >= static_cast<uint64>(size_));
+  return value;
+}
+
+uint64 RandomPermutation::Encrypt(uint64 value) const {
+  uint64 left = value >> half_bits_;
+  uint64 right = value & half_mask_;
+  for (uint64 round_key : round_keys_) {
+    const uint64 next_right = left ^ (Mix(right ^ round_key) & half_mask_);
+    left = right;
+    right = next_right;
+  }
+  return (left << half_bits_) | right;
+}
+
+}  // namespace data
+}  // namespace tensorflow
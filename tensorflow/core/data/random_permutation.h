@@ -0,0 +1,60 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_RANDOM_PERMUTATION_H_
+#define TENSORFLOW_CORE_DATA_RANDOM_PERMUTATION_H_
+
+#include <array>
+#include <cstdint>
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A pseudorandom permutation of `[0, size)` that is computed on the fly.
+//
+// Unlike shuffling a vector of indices, mapping an index takes O(1) memory and
+// O(1) expected time, so datasets with random access can be shuffled globally
+// regardless of their size. The permutation is a Feistel network over the
+// smallest domain of `2^(2k)` indices that contains `[0, size)`, restricted to
+// `[0, size)` by cycle walking. It is determined by the seeds, but is not a
+// cryptographically secure permutation.
+class RandomPermutation {
+ public:
+  RandomPermutation(int64_t size, int64_t seed, int64_t seed2);
+
+  // Returns the index that the `index`^th element is permuted to. Requires
+  // `0 <= index < size()`.
+  int64_t Map(int64_t index) const;
+
+  int64_t size() const { return size_; }
+
+ private:
+  static constexpr int kNumRounds = 6;
+
+  // Applies the Feistel network to `value`, which must be in the domain.
+  uint64 Encrypt(uint64 value) const;
+
+  const int64_t size_;
+  // The number of bits of each half of an index in the domain.
+  int half_bits_ = 1;
+  uint64 half_mask_ = 1;
+  std::array<uint64, kNumRounds> round_keys_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_RANDOM_PERMUTATION_H_
@@ -0,0 +1,82 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/random_permutation.h"
+
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::vector<int64_t> Permute(const RandomPermutation& permutation) {
+  std::vector<int64_t> indices;
+  for (int64_t i = 0; i < permutation.size(); ++i) {
+    indices.push_back(permutation.Map(i));
+  }
+  return indices;
+}
+
+class RandomPermutationTest : public ::testing::TestWithParam<int64_t> {};
+
+TEST_P(RandomPermutationTest, IsPermutation) {
+  const int64_t size = GetParam();
+  std::vector<int64_t> indices = Permute(RandomPermutation(size, 1, 2));
+  std::vector<bool> seen(size, false);
+  for (int64_t index : indices) {
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, size);
+    EXPECT_FALSE(seen[index]) << index;
+    seen[index] = true;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Sizes, RandomPermutationTest,
+                         ::testing::Values(1, 2, 3, 4, 5, 17, 100, 1000, 4097));
+
+TEST(RandomPermutationTest, DeterminedBySeeds) {
+  EXPECT_EQ(Permute(RandomPermutation(1000, 1, 2)),
+            Permute(RandomPermutation(1000, 1, 2)));
+  EXPECT_NE(Permute(RandomPermutation(1000, 1, 2)),
+            Permute(RandomPermutation(1000, 1, 3)));
+}
+
+TEST(RandomPermutationTest, Shuffles) {
+  std::vector<int64_t> indices = Permute(RandomPermutation(1000, 1, 2));
+  int64_t num_fixed_points = 0;
+  for (int64_t i = 0; i < indices.size(); ++i) {
+    num_fixed_points += indices[i] == i;
+  }
+  // A uniformly random permutation has one fixed point on average.
+  EXPECT_LT(num_fixed_points, 10);
+}
+
+TEST(RandomPermutationTest, LargeSizes) {
+  for (int64_t size : {(int64_t{1} << 62) + 1,
+                       std::numeric_limits<int64_t>::max()}) {
+    RandomPermutation permutation(size, 1, 2);
+    for (int64_t index : {int64_t{0}, size / 2, size - 1}) {
+      const int64_t mapped = permutation.Map(index);
+      EXPECT_GE(mapped, 0);
+      EXPECT_LT(mapped, size);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,147 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/read_ahead_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/platform/errors.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kAsyncFileReadsExperiment[] = "async_file_reads";
+constexpr size_t kDefaultBlockSize = 256 * 1024;  // 256KB
+
+}  // namespace
+
+ReadAheadFile::ReadAheadFile(std::unique_ptr<RandomAccessFile> file,
+                             size_t block_size, int queue_depth)
+    : file_(std::move(file)),
+      block_size_(block_size > 0 ? block_size : kDefaultBlockSize),
+      queue_depth_(std::max(queue_depth, 1)) {}
+
+ReadAheadFile::~ReadAheadFile() {
+  mutex_lock l(completion_mu_);
+  while (num_in_flight_ > 0) {
+    block_done_.wait(l);
+  }
+}
+
+Status ReadAheadFile::Name(StringPiece* result) const {
+  return file_->Name(result);
+}
+
+Status ReadAheadFile::Read(uint64 offset, size_t n, StringPiece* result,
+                           char* scratch) const {
+  mutex_lock l(mu_);
+  if (blocks_.empty() || offset < blocks_.front()->offset ||
+      offset >= next_offset_) {
+    ResetLocked(offset);
+  }
+  char* dst = scratch;
+  Status s;
+  while (n > 0) {
+    // Blocks before the one containing `offset` are skipped.
+    ReadAheadLocked();
+    if (blocks_.empty()) {
+      s = errors::OutOfRange("Read less bytes than requested");
+      break;
+    }
+    const Block& block = *blocks_.front();
+    WaitForBlock(block);
+    if (!block.status.ok() || block.size < block_size_) {
+      reached_end_ = true;
+    }
+    const uint64 block_end = block.offset + block.size;
+    if (offset < block_end) {
+      const size_t bytes_to_copy = std::min<uint64>(n, block_end - offset);
+      memcpy(dst, block.data.get() + (offset - block.offset), bytes_to_copy);
+      dst += bytes_to_copy;
+      offset += bytes_to_copy;
+      n -= bytes_to_copy;
+    }
+    if (offset >= block_end) {
+      // Keep a block ending early, so that reads after it fail the same way.
+      if (!block.status.ok()) {
+        s = block.status;
+        break;
+      }
+      if (block.size < block_size_) {
+        s = errors::OutOfRange("Read less bytes than requested");
+        break;
+      }
+      blocks_.pop_front();
+    }
+  }
+  *result = StringPiece(scratch, dst - scratch);
+  return s;
+}
+
+void ReadAheadFile::ReadAheadLocked() const {
+  while (!reached_end_ && blocks_.size() < static_cast<size_t>(queue_depth_)) {
+    blocks_.push_back(std::make_unique<Block>(next_offset_, block_size_));
+    Block* block = blocks_.back().get();
+    next_offset_ += block_size_;
+    {
+      mutex_lock l(completion_mu_);
+      ++num_in_flight_;
+    }
+    file_->ReadAsync(block->offset, block_size_, block->data.get(),
+                     [this, block](const Status& status, StringPiece result) {
+                       mutex_lock l(completion_mu_);
+                       block->status = status;
+                       block->size = result.size();
+                       block->done = true;
+                       --num_in_flight_;
+                       block_done_.notify_all();
+                     });
+  }
+}
+
+void ReadAheadFile::ResetLocked(uint64 offset) const {
+  {
+    mutex_lock l(completion_mu_);
+    while (num_in_flight_ > 0) {
+      block_done_.wait(l);
+    }
+  }
+  blocks_.clear();
+  next_offset_ = offset;
+  reached_end_ = false;
+}
+
+void ReadAheadFile::WaitForBlock(const Block& block) const {
+  mutex_lock l(completion_mu_);
+  while (!block.done) {
+    block_done_.wait(l);
+  }
+}
+
+std::unique_ptr<RandomAccessFile> MaybeReadAhead(
+    std::unique_ptr<RandomAccessFile> file, size_t block_size) {
+  if (!file->SupportsAsyncRead() ||
+      !GetExperiments().contains(kAsyncFileReadsExperiment)) {
+    return file;
+  }
+  return std::make_unique<ReadAheadFile>(std::move(file), block_size);
+}
+
+}  // namespace data
+}  // namespace tensorflow
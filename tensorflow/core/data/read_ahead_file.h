@@ -0,0 +1,109 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
+#define TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A `RandomAccessFile` which reads ahead of sequential reads, keeping up to
+// `queue_depth` asynchronous reads of `block_size` bytes of the underlying file
+// in flight. With a file that supports asynchronous reads, a single reader
+// thread can then keep a deep queue of reads going to the storage device.
+//
+// A read which does not continue from the blocks read ahead discards them and
+// starts reading ahead from its offset.
+class ReadAheadFile : public RandomAccessFile {
+ public:
+  static constexpr int kDefaultQueueDepth = 8;
+
+  // A `block_size` of 0 selects a default block size.
+  ReadAheadFile(std::unique_ptr<RandomAccessFile> file, size_t block_size,
+                int queue_depth = kDefaultQueueDepth);
+
+  // Waits for the reads in flight.
+  ~ReadAheadFile() override;
+
+  Status Name(StringPiece* result) const override;
+
+  // Concurrent reads are serialized.
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override;
+
+ private:
+  struct Block {
+    explicit Block(uint64 offset, size_t block_size)
+        : offset(offset), data(new char[block_size]) {}
+
+    const uint64 offset;
+    const std::unique_ptr<char[]> data;
+    // Set when the read of the block completes.
+    bool done = false;
+    size_t size = 0;
+    Status status;
+  };
+
+  // Starts reads of the blocks following the last one, up to `queue_depth_`
+  // blocks.
+  void ReadAheadLocked() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Waits for the blocks in flight, discards all blocks and continues reading
+  // ahead from `offset`.
+  void ResetLocked(uint64 offset) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Waits until the read of `block` completes.
+  void WaitForBlock(const Block& block) const TF_LOCKS_EXCLUDED(completion_mu_);
+
+  const std::unique_ptr<RandomAccessFile> file_;
+  const size_t block_size_;
+  const int queue_depth_;
+
+  mutable mutex mu_;
+  // The blocks read ahead, in file order.
+  mutable std::deque<std::unique_ptr<Block>> blocks_ TF_GUARDED_BY(mu_);
+  // The offset of the block following the last one in `blocks_`.
+  mutable uint64 next_offset_ TF_GUARDED_BY(mu_) = 0;
+  // Whether a block read has hit the end of the file or an error, in which
+  // case reading further ahead is pointless.
+  mutable bool reached_end_ TF_GUARDED_BY(mu_) = false;
+
+  // Guards the completion of block reads. It is separate from `mu_` because
+  // reads may complete synchronously, while `mu_` is held.
+  mutable mutex completion_mu_;
+  mutable condition_variable block_done_;
+  mutable int num_in_flight_ TF_GUARDED_BY(completion_mu_) = 0;
+};
+
+// Returns `file`, wrapped in a `ReadAheadFile` of `block_size` blocks if it
+// supports asynchronous reads and the "async_file_reads" experiment is
+// enabled. Intended for files which are mostly read sequentially.
+std::unique_ptr<RandomAccessFile> MaybeReadAhead(
+    std::unique_ptr<RandomAccessFile> file, size_t block_size);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
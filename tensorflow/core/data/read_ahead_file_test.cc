@@ -0,0 +1,185 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/read_ahead_file.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::testing::StatusIs;
+
+std::string MakeContents(size_t size) {
+  std::string contents(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    contents[i] = static_cast<char>(i % 251);
+  }
+  return contents;
+}
+
+// An in-memory file whose asynchronous reads complete on other threads.
+class AsyncStringFile : public RandomAccessFile {
+ public:
+  explicit AsyncStringFile(std::string contents, size_t error_offset = -1)
+      : contents_(std::move(contents)), error_offset_(error_offset) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    if (offset + n > error_offset_) {
+      *result = StringPiece(scratch, 0);
+      return errors::DataLoss("Corrupted file");
+    }
+    const size_t available =
+        offset < contents_.size() ? contents_.size() - offset : 0;
+    const size_t size = std::min(n, available);
+    memcpy(scratch, contents_.data() + offset, size);
+    *result = StringPiece(scratch, size);
+    if (size < n) {
+      return errors::OutOfRange("Read less bytes than requested");
+    }
+    return OkStatus();
+  }
+
+  void ReadAsync(uint64 offset, size_t n, char* scratch,
+                 ReadDoneCallback done) const override {
+    {
+      mutex_lock l(mu_);
+      ++num_in_flight_;
+      max_in_flight_ = std::max(max_in_flight_, num_in_flight_);
+    }
+    Env::Default()->SchedClosure([this, offset, n, scratch, done]() {
+      StringPiece result;
+      Status s = Read(offset, n, &result, scratch);
+      {
+        mutex_lock l(mu_);
+        --num_in_flight_;
+      }
+      done(s, result);
+    });
+  }
+
+  bool SupportsAsyncRead() const override { return true; }
+
+  int max_in_flight() const {
+    mutex_lock l(mu_);
+    return max_in_flight_;
+  }
+
+ private:
+  const std::string contents_;
+  const size_t error_offset_;
+  mutable mutex mu_;
+  mutable int num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  mutable int max_in_flight_ TF_GUARDED_BY(mu_) = 0;
+};
+
+// Reads `file` sequentially in reads of `read_size` bytes.
+std::string ReadAll(const RandomAccessFile& file, size_t read_size) {
+  std::string result;
+  std::string scratch(read_size, '\0');
+  uint64 offset = 0;
+  while (true) {
+    StringPiece data;
+    Status s = file.Read(offset, read_size, &data, &scratch[0]);
+    result.append(data.data(), data.size());
+    offset += data.size();
+    if (!s.ok()) {
+      EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+      return result;
+    }
+  }
+}
+
+TEST(ReadAheadFileTest, SequentialReads) {
+  const std::string contents = MakeContents(1000);
+  for (size_t read_size : {1, 7, 16, 100, 2000}) {
+    ReadAheadFile file(std::make_unique<AsyncStringFile>(contents),
+                       /*block_size=*/16, /*queue_depth=*/4);
+    EXPECT_EQ(ReadAll(file, read_size), contents) << read_size;
+  }
+}
+
+TEST(ReadAheadFileTest, KeepsQueueFull) {
+  auto async_file = std::make_unique<AsyncStringFile>(MakeContents(10000));
+  const AsyncStringFile* async_file_ptr = async_file.get();
+  ReadAheadFile file(std::move(async_file), /*block_size=*/16,
+                     /*queue_depth=*/4);
+  ReadAll(file, /*read_size=*/8);
+  EXPECT_GT(async_file_ptr->max_in_flight(), 1);
+  EXPECT_LE(async_file_ptr->max_in_flight(), 4);
+}
+
+TEST(ReadAheadFileTest, RandomReads) {
+  const std::string contents = MakeContents(1000);
+  ReadAheadFile file(std::make_unique<AsyncStringFile>(contents),
+                     /*block_size=*/16, /*queue_depth=*/4);
+  char scratch[50];
+  for (uint64 offset : {500, 10, 30, 900, 0, 63, 64, 980}) {
+    StringPiece data;
+    Status s = file.Read(offset, sizeof(scratch), &data, scratch);
+    const size_t expected_size =
+        std::min<size_t>(sizeof(scratch), contents.size() - offset);
+    EXPECT_EQ(data, StringPiece(contents).substr(offset, expected_size));
+    EXPECT_EQ(s.ok(), expected_size == sizeof(scratch)) << s;
+  }
+}
+
+TEST(ReadAheadFileTest, ReadError) {
+  ReadAheadFile file(std::make_unique<AsyncStringFile>(MakeContents(1000),
+                                                       /*error_offset=*/100),
+                     /*block_size=*/16, /*queue_depth=*/4);
+  char scratch[64];
+  StringPiece data;
+  TF_EXPECT_OK(file.Read(0, sizeof(scratch), &data, scratch));
+  EXPECT_THAT(file.Read(64, sizeof(scratch), &data, scratch),
+              StatusIs(error::DATA_LOSS));
+  EXPECT_EQ(data.size(), 32);
+  // The error does not affect reads before it.
+  TF_EXPECT_OK(file.Read(0, sizeof(scratch), &data, scratch));
+}
+
+TEST(ReadAheadFileTest, LocalFile) {
+  const std::string filename =
+      io::JoinPath(::testing::TempDir(), "read_ahead_file_test");
+  const std::string contents = MakeContents(1 << 20);
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, contents));
+  std::unique_ptr<RandomAccessFile> local_file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(filename, &local_file));
+  ReadAheadFile file(std::move(local_file), /*block_size=*/4096);
+  EXPECT_EQ(ReadAll(file, /*read_size=*/1000), contents);
+}
+
+TEST(ReadAheadFileTest, DisabledByDefault) {
+  auto async_file = std::make_unique<AsyncStringFile>(MakeContents(10));
+  RandomAccessFile* const async_file_ptr = async_file.get();
+  EXPECT_EQ(MaybeReadAhead(std::move(async_file), /*block_size=*/16).get(),
+            async_file_ptr);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
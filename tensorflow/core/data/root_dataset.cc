@@ -40,6 +40,7 @@ constexpr char kExperiments[] = "experiments";
 constexpr char kInjectPrefetchEligibleOpt[] = "inject_prefetch_eligible";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
+constexpr char kNUMANode[] = "numa_node";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kRamBudget[] = "ram_budget_megabytes";
 constexpr char kRamUsage[] = "ram_usage_megabytes";
@@ -59,6 +60,16 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  if (ShouldPinToNUMANode(options)) {
+    const int numa_node = options.threading_options().numa_node();
+    if (port::NUMAEnabled() && numa_node >= 0 &&
+        numa_node < port::NUMANumNodes()) {
+      params->numa_node = numa_node;
+    } else {
+      LOG(WARNING) << "Ignoring tf.data NUMA node " << numa_node
+                   << ": NUMA is unavailable or the node does not exist.";
+    }
+  }
   params->autotune = ShouldUseAutotuning(options);
   if (params->autotune) {
     params->autotune_algorithm =
@@ -66,8 +77,13 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
                 AutotuneOptions::kAutotuneAlgorithm
             ? options.autotune_options().autotune_algorithm()
             : model::AutotuneAlgorithm::DEFAULT;
+    // A pipeline bound to a NUMA node only runs on the cores of that node, so
+    // the autotuner accounts its parallelism against them.
     params->autotune_cpu_budget = value_or_default(
-        options.autotune_options().cpu_budget(), 0, GetCpuBudget());
+        options.autotune_options().cpu_budget(), 0,
+        params->numa_node != port::kNUMANoAffinity
+            ? port::MaxParallelism(params->numa_node)
+            : GetCpuBudget());
     params->autotune_ram_budget =
         value_or_default(options.autotune_options().ram_budget(), 0,
                          model::kRamBudgetShare * port::AvailableRam());
@@ -92,14 +108,19 @@ void AddTraceMetadata(const RootDataset::Params& params,
         kIntraOpParallelism,
         strings::Printf("%lld", static_cast<long long>(value_or_default(
                                     params.max_intra_op_parallelism, 0,
-                                    port::MaxParallelism())))));
+                                    port::MaxParallelism(params.numa_node))))));
   }
   if (params.private_threadpool_size >= 0) {
     trace_metadata->push_back(std::make_pair(
         kPrivateThreadpoolSize,
         strings::Printf("%lld", static_cast<long long>(value_or_default(
                                     params.private_threadpool_size, 0,
-                                    port::MaxParallelism())))));
+                                    port::MaxParallelism(params.numa_node))))));
+  }
+  if (params.numa_node != port::kNUMANoAffinity) {
+    trace_metadata->push_back(std::make_pair(
+        kNUMANode,
+        strings::Printf("%lld", static_cast<long long>(params.numa_node))));
   }
   auto experiments = GetExperiments();
   if (!experiments.empty()) {
@@ -107,6 +128,30 @@ void AddTraceMetadata(const RootDataset::Params& params,
         std::make_pair(kExperiments, absl::StrJoin(experiments, " ")));
   }
 }
+// Starts threads bound to a NUMA node, delegating the thread creation to
+// `base` if set.
+class NUMAThreadFactory : public ThreadFactory {
+ public:
+  NUMAThreadFactory(int numa_node, std::shared_ptr<ThreadFactory> base)
+      : numa_node_(numa_node), base_(std::move(base)) {}
+
+  std::unique_ptr<Thread> StartThread(const string& name,
+                                      std::function<void()> fn) override {
+    auto pinned_fn = [numa_node = numa_node_, fn = std::move(fn)]() {
+      port::NUMASetThreadNodeAffinity(numa_node);
+      fn();
+    };
+    if (base_) {
+      return base_->StartThread(name, std::move(pinned_fn));
+    }
+    return absl::WrapUnique(
+        Env::Default()->StartThread({}, name, std::move(pinned_fn)));
+  }
+
+ private:
+  const int numa_node_;
+  const std::shared_ptr<ThreadFactory> base_;
+};
 }  // namespace
 
 // static
@@ -132,20 +177,26 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
  public:
   explicit Iterator(const Params& params)
       : DatasetIterator<RootDataset>(params) {
-    if (dataset()->params_.autotune) {
-      model_ = std::make_shared<model::Model>();
-    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       max_intra_op_parallelism_ =
           value_or_default(dataset()->params_.max_intra_op_parallelism, 0,
-                           port::MaxParallelism());
+                           port::MaxParallelism(dataset()->params_.numa_node));
     }
-    if (dataset()->params_.private_threadpool_size >= 0) {
+    const int64_t numa_node = dataset()->params_.numa_node;
+    if (dataset()->params_.private_threadpool_size >= 0 ||
+        numa_node != port::kNUMANoAffinity) {
+      // Binding to a NUMA node requires a private threadpool, which by default
+      // uses all the cores of the node.
       threadpool_size_ =
           value_or_default(dataset()->params_.private_threadpool_size, 0,
-                           port::MaxParallelism());
+                           port::MaxParallelism(numa_node));
+      if (threadpool_size_ < 0) {
+        threadpool_size_ = port::MaxParallelism(numa_node);
+      }
+      ThreadOptions thread_options;
+      thread_options.numa_node = numa_node;
       thread_pool_ = absl::make_unique<thread::ThreadPool>(
-          Env::Default(), ThreadOptions{}, "data_private_threadpool",
+          Env::Default(), thread_options, "data_private_threadpool",
           threadpool_size_);
     }
     cancellation_manager_ = absl::make_unique<CancellationManager>();
@@ -154,6 +205,19 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   ~Iterator() override { cancellation_manager_->StartCancel(); }
 
   Status Initialize(IteratorContext* ctx) override {
+    if (dataset()->params_.autotune) {
+      // Reuse the model provided by the caller, if any, so that the caller can
+      // inspect the pipeline, e.g. through the model's flight recorder.
+      model_ = ctx->model() != nullptr ? ctx->model()
+                                       : std::make_shared<model::Model>();
+    }
+    if (dataset()->params_.numa_node != port::kNUMANoAffinity) {
+      // Threads started by the input pipeline iterators, e.g. the runner
+      // threads of parallel map and interleave, are bound to the same node as
+      // the threadpool.
+      numa_thread_factory_ = std::make_shared<NUMAThreadFactory>(
+          dataset()->params_.numa_node, ctx->thread_factory());
+    }
     return dataset()->input_->MakeIterator(IteratorContext(CreateParams(ctx)),
                                            this, prefix(), &input_impl_);
   }
@@ -162,6 +226,11 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
                          bool* end_of_sequence) override {
     if (dataset()->params_.autotune) {
       TF_RETURN_IF_ERROR(EnsureModelThreadStarted(ctx));
+      const int64_t start_nsec = EnvTime::NowNanos();
+      Status s = input_impl_->GetNext(IteratorContext(CreateParams(ctx)),
+                                      out_tensors, end_of_sequence);
+      model_->RecordGetNext(EnvTime::NowNanos() - start_nsec);
+      return s;
     }
     return input_impl_->GetNext(IteratorContext(CreateParams(ctx)), out_tensors,
                                 end_of_sequence);
@@ -217,15 +286,18 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
  private:
   IteratorContext::Params CreateParams(IteratorContext* ctx) {
     IteratorContext::Params params(ctx);
-    if (dataset()->params_.autotune) {
-      params.model = model_;
-    }
-    if (dataset()->params_.private_threadpool_size >= 0) {
+    // Without autotuning, `model_` is null which also prevents the input
+    // pipeline from recording into a model provided by the caller.
+    params.model = model_;
+    if (thread_pool_) {
       params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
         pool->Schedule(std::move(c));
       };
       params.runner_threadpool_size = threadpool_size_;
     }
+    if (numa_thread_factory_) {
+      params.thread_factory = numa_thread_factory_;
+    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
@@ -260,6 +332,7 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
+  std::shared_ptr<ThreadFactory> numa_thread_factory_;
 
   // Must be ordered last as its execution may depend on other members.
   std::unique_ptr<IteratorBase> input_impl_;
@@ -311,7 +384,7 @@ int64_t RootDataset::CardinalityInternal(CardinalityOptions options) const {
   return input_->Cardinality(options);
 }
 
-Status RootDataset::Get(OpKernelContext* ctx, int64 index,
+Status RootDataset::Get(AnyContext ctx, int64 index,
                         std::vector<Tensor>* out_tensors) const {
   std::vector<const DatasetBase*> inputs;
   TF_RETURN_IF_ERROR(this->InputDatasets(&inputs));
@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/refcount.h"
 
 namespace tensorflow {
@@ -34,6 +35,7 @@ class RootDataset : public DatasetBase {
     int64_t autotune_ram_budget = 0;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
+    int64_t numa_node = port::kNUMANoAffinity;
   };
 
   static Status FromOptions(const DatasetBase* input, DatasetBase** output);
@@ -47,7 +49,7 @@ class RootDataset : public DatasetBase {
 
   int64_t CardinalityInternal() const override;
   int64_t CardinalityInternal(CardinalityOptions options) const override;
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext ctx, int64 index,
              std::vector<Tensor>* out_tensors) const override;
   Status CheckExternalState() const override;
   string DebugString() const override;
@@ -0,0 +1,114 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/auto_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Tolerance for rounding errors when rounding worker counts up.
+constexpr double kEpsilon = 1e-9;
+
+int64_t CeilWorkerCount(double worker_count) {
+  return static_cast<int64_t>(std::ceil(worker_count - kEpsilon));
+}
+
+}  // namespace
+
+AutoScaler::AutoScaler(const Options& options) : options_(options) {}
+
+Status AutoScaler::ReportCpuUtilization(const std::string& worker_address,
+                                        double cpu_utilization) {
+  if (!(cpu_utilization >= 0.0)) {
+    return errors::InvalidArgument("Invalid CPU utilization ", cpu_utilization,
+                                   " reported by worker ", worker_address,
+                                   ". CPU utilization must be non-negative.");
+  }
+  mutex_lock l(mu_);
+  worker_cpu_utilization_[worker_address] = std::min(cpu_utilization, 1.0);
+  return OkStatus();
+}
+
+Status AutoScaler::ReportClientWaitFraction(int64_t iteration_client_id,
+                                            double wait_fraction) {
+  if (!(wait_fraction >= 0.0 && wait_fraction <= 1.0)) {
+    return errors::InvalidArgument(
+        "Invalid wait time fraction ", wait_fraction, " reported by client ",
+        iteration_client_id, ". The fraction must be in [0, 1].");
+  }
+  mutex_lock l(mu_);
+  client_wait_fraction_[iteration_client_id] = wait_fraction;
+  return OkStatus();
+}
+
+void AutoScaler::AddWorker(const std::string& worker_address) {
+  mutex_lock l(mu_);
+  worker_cpu_utilization_.erase(worker_address);
+  client_wait_fraction_.clear();
+}
+
+void AutoScaler::RemoveClient(int64_t iteration_client_id) {
+  mutex_lock l(mu_);
+  client_wait_fraction_.erase(iteration_client_id);
+}
+
+int64_t AutoScaler::GetTargetWorkerCount(int64_t current_worker_count) const {
+  mutex_lock l(mu_);
+  if (current_worker_count <= 0) {
+    return client_wait_fraction_.empty() ? 0 : 1;
+  }
+
+  double max_wait_fraction = 0.0;
+  for (const auto& it : client_wait_fraction_) {
+    max_wait_fraction = std::max(max_wait_fraction, it.second);
+  }
+  if (max_wait_fraction > options_.max_client_wait_fraction) {
+    // A client which waits for a fraction `w` of the time reads at `1 - w` of
+    // the rate it could, so the workers need to be `1 / (1 - w)` times faster.
+    const double scale_up_factor =
+        1.0 / std::max(1.0 - max_wait_fraction,
+                       1.0 / options_.max_scale_up_factor);
+    return std::max(current_worker_count + 1,
+                    CeilWorkerCount(current_worker_count * scale_up_factor));
+  }
+
+  if (worker_cpu_utilization_.empty()) {
+    return current_worker_count;
+  }
+  double total_cpu_utilization = 0.0;
+  for (const auto& it : worker_cpu_utilization_) {
+    total_cpu_utilization += it.second;
+  }
+  // Workers that have not reported yet are assumed to be as busy as the
+  // average reporting worker.
+  const double average_cpu_utilization =
+      total_cpu_utilization / worker_cpu_utilization_.size();
+  const int64_t target_worker_count =
+      CeilWorkerCount(average_cpu_utilization * current_worker_count /
+                      options_.target_cpu_utilization);
+  return std::clamp<int64_t>(target_worker_count, 1, current_worker_count);
+}
+
+}  // namespace data
+}  // namespace tensorflow
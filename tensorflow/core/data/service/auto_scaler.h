@@ -0,0 +1,92 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// An `AutoScaler` recommends how many workers a tf.data service cluster needs,
+// based on how busy the workers are and how long clients wait for data.
+//
+// Workers report the fraction of their CPU capacity they used since their
+// previous heartbeat. Clients report the fraction of time they spent waiting
+// for elements since their previous heartbeat. When any client waits for more
+// than `max_client_wait_fraction` of the time, the workers are not keeping up,
+// and the recommendation grows until they produce data as fast as the slowest
+// client reads it. Otherwise, the recommendation shrinks the cluster until the
+// workers run at `target_cpu_utilization`.
+//
+// This class is thread-safe.
+class AutoScaler {
+ public:
+  struct Options {
+    // The fraction of worker CPU capacity to aim for when the clients are not
+    // waiting for data. Must be in (0, 1].
+    double target_cpu_utilization = 0.8;
+    // The fraction of time clients may spend waiting for data before more
+    // workers are recommended.
+    double max_client_wait_fraction = 0.05;
+    // The maximum factor by which a single recommendation may grow the
+    // cluster.
+    double max_scale_up_factor = 2.0;
+  };
+
+  AutoScaler() : AutoScaler(Options()) {}
+  explicit AutoScaler(const Options& options);
+
+  // Reports the fraction of its CPU capacity that worker `worker_address` used
+  // since its previous report. Values above 1 are treated as 1.
+  Status ReportCpuUtilization(const std::string& worker_address,
+                              double cpu_utilization);
+  // Reports the fraction of time in [0, 1] that client `iteration_client_id`
+  // spent waiting for elements since its previous report.
+  Status ReportClientWaitFraction(int64_t iteration_client_id,
+                                  double wait_fraction);
+  // Records that a worker joined the cluster. Client wait times reported
+  // before the worker joined do not reflect its capacity, so they are
+  // discarded until the clients report again.
+  void AddWorker(const std::string& worker_address);
+  // Stops considering a released client.
+  void RemoveClient(int64_t iteration_client_id);
+
+  // Returns the recommended number of workers for a cluster which currently
+  // has `current_worker_count` workers.
+  int64_t GetTargetWorkerCount(int64_t current_worker_count) const;
+
+ private:
+  const Options options_;
+
+  mutable mutex mu_;
+  // Latest CPU utilization reported by each worker.
+  absl::flat_hash_map<std::string, double> worker_cpu_utilization_
+      TF_GUARDED_BY(mu_);
+  // Latest wait time fraction reported by each client.
+  absl::flat_hash_map<int64_t, double> client_wait_fraction_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_H_
@@ -0,0 +1,101 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/auto_scaler.h"
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(AutoScalerTest, NoReports) {
+  AutoScaler auto_scaler;
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/0), 0);
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/5), 5);
+}
+
+TEST(AutoScalerTest, ScaleDownIdleWorkers) {
+  AutoScaler auto_scaler;
+  for (int i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(
+        auto_scaler.ReportCpuUtilization(absl::StrCat("worker_", i), 0.4));
+  }
+  TF_ASSERT_OK(auto_scaler.ReportClientWaitFraction(/*iteration_client_id=*/0,
+                                                    /*wait_fraction=*/0.0));
+  // 10 workers at 40% CPU utilization fit in 5 workers at 80%.
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/10), 5);
+}
+
+TEST(AutoScalerTest, KeepBusyWorkers) {
+  AutoScaler auto_scaler;
+  for (int i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(
+        auto_scaler.ReportCpuUtilization(absl::StrCat("worker_", i), 1.5));
+  }
+  // High CPU utilization alone does not add workers unless clients wait.
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/10), 10);
+}
+
+TEST(AutoScalerTest, ScaleUpWhenClientsWait) {
+  AutoScaler auto_scaler;
+  TF_ASSERT_OK(auto_scaler.ReportCpuUtilization("worker_0", 0.2));
+  TF_ASSERT_OK(auto_scaler.ReportClientWaitFraction(/*iteration_client_id=*/0,
+                                                    /*wait_fraction=*/0.01));
+  TF_ASSERT_OK(auto_scaler.ReportClientWaitFraction(/*iteration_client_id=*/1,
+                                                    /*wait_fraction=*/0.2));
+  // The slowest client reads at 80% of its rate, so it needs 10 / 0.8 = 12.5
+  // workers.
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/10), 13);
+  // Small clusters grow by at least one worker.
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/1), 2);
+
+  auto_scaler.RemoveClient(/*iteration_client_id=*/1);
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/10), 3);
+}
+
+TEST(AutoScalerTest, ScaleUpIsBounded) {
+  AutoScaler::Options options;
+  options.max_scale_up_factor = 1.5;
+  AutoScaler auto_scaler(options);
+  TF_ASSERT_OK(auto_scaler.ReportClientWaitFraction(/*iteration_client_id=*/0,
+                                                    /*wait_fraction=*/1.0));
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/10), 15);
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/0), 1);
+}
+
+TEST(AutoScalerTest, AddWorkerDiscardsWaitTimes) {
+  AutoScaler auto_scaler;
+  TF_ASSERT_OK(auto_scaler.ReportCpuUtilization("worker_0", 0.8));
+  TF_ASSERT_OK(auto_scaler.ReportClientWaitFraction(/*iteration_client_id=*/0,
+                                                    /*wait_fraction=*/0.5));
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/1), 2);
+  auto_scaler.AddWorker("worker_1");
+  EXPECT_EQ(auto_scaler.GetTargetWorkerCount(/*current_worker_count=*/2), 2);
+}
+
+TEST(AutoScalerTest, InvalidReports) {
+  AutoScaler auto_scaler;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      auto_scaler.ReportCpuUtilization("worker_0", -0.1)));
+  EXPECT_TRUE(errors::IsInvalidArgument(auto_scaler.ReportClientWaitFraction(
+      /*iteration_client_id=*/0, /*wait_fraction=*/1.1)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <functional>
@@ -22,12 +23,19 @@ limitations under the License.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/logging_utils.h"
 #include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/thread_annotations.h"
@@ -78,7 +86,8 @@ namespace data {
 // To use the cache, the user needs to define a `CachableSequence` to generate
 // an infinite sequence of data. It should implement a `GetNext` method to
 // produce elements, and a `GetElementSizeBytes` method to estimate the element
-// size in bytes.
+// size in bytes. To spill elements to disk, it should also implement
+// `SerializeElement` and `DeserializeElement`.
 template <class ElementType>
 class CachableSequence {
  public:
@@ -89,6 +98,75 @@ class CachableSequence {
 
   // Returns the estimated size of the element in bytes.
   virtual size_t GetElementSizeBytes(const ElementType&) const = 0;
+
+  // Serializes an element to spill it to disk.
+  virtual StatusOr<std::string> SerializeElement(const ElementType&) const {
+    return errors::Unimplemented(
+        "This tf.data service cross-trainer cache does not support spilling "
+        "elements to disk.");
+  }
+
+  // Deserializes an element serialized by `SerializeElement`.
+  virtual StatusOr<ElementType> DeserializeElement(
+      const std::string& serialized) const {
+    return errors::Unimplemented(
+        "This tf.data service cross-trainer cache does not support spilling "
+        "elements to disk.");
+  }
+};
+
+// How `CrossTrainerCache` makes room for new elements when it is full.
+enum class CrossTrainerCacheEvictionPolicy {
+  // Evicts the oldest element. Trainers that fall behind the sliding window
+  // skip the elements evicted before they read them, so a slow trainer does
+  // not see every element.
+  kFifo,
+  // Evicts the oldest element only after every active trainer has read it. A
+  // trainer which needs to extend a full cache waits for the slowest active
+  // trainer instead, so trainers running at different speeds share every
+  // element without recomputing it. Trainers that have not read from the cache
+  // for `consumer_timeout` are not waited for.
+  kSlowestConsumer,
+};
+
+// Configures a `CrossTrainerCache`.
+struct CrossTrainerCacheConfig {
+  // Maximum size in bytes of the elements held in memory.
+  size_t max_cache_size_bytes = 0;
+  CrossTrainerCacheEvictionPolicy eviction_policy =
+      CrossTrainerCacheEvictionPolicy::kFifo;
+  // How long a trainer may go without reading before the `kSlowestConsumer`
+  // policy stops waiting for it.
+  absl::Duration consumer_timeout = absl::Minutes(1);
+  // If non-empty, elements which do not fit in memory are spilled to files in
+  // this directory, for example on a local SSD, and are only evicted once the
+  // spilled elements exceed `max_disk_size_bytes`.
+  std::string spill_directory;
+  // Maximum size in bytes of the elements spilled to disk.
+  size_t max_disk_size_bytes = 0;
+};
+
+// A cached element spilled to a file. The file is deleted with this object.
+class SpilledCacheElement {
+ public:
+  SpilledCacheElement(std::string filename, size_t size_bytes)
+      : filename_(std::move(filename)), size_bytes_(size_bytes) {}
+  ~SpilledCacheElement() {
+    Status s = Env::Default()->DeleteFile(filename_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete spilled tf.data service cross-trainer "
+                   << "cache element " << filename_ << ": " << s;
+    }
+  }
+  SpilledCacheElement(const SpilledCacheElement&) = delete;
+  SpilledCacheElement& operator=(const SpilledCacheElement&) = delete;
+
+  const std::string& filename() const { return filename_; }
+  size_t size_bytes() const { return size_bytes_; }
+
+ private:
+  const std::string filename_;
+  const size_t size_bytes_;
 };
 
 // Sliding-window cache shared across concurrent trainers.
@@ -101,7 +179,13 @@ class CrossTrainerCache {
   explicit CrossTrainerCache(
       size_t max_cache_size_bytes,
       std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
-  virtual ~CrossTrainerCache() = default;
+
+  // Creates a `CrossTrainerCache` configured by `config`.
+  // REQUIRES: `config.max_cache_size_bytes >= max(GetElementSizeBytes(*))`
+  CrossTrainerCache(
+      const CrossTrainerCacheConfig& config,
+      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
+  virtual ~CrossTrainerCache();
   CrossTrainerCache(const CrossTrainerCache&) = delete;
   CrossTrainerCache& operator=(const CrossTrainerCache&) = delete;
 
@@ -121,9 +205,20 @@ class CrossTrainerCache {
   bool IsCancelled() const;
 
  private:
+  // A cached element, held either in memory or in a spill file.
+  struct CacheEntry {
+    std::shared_ptr<const ElementType> element;
+    std::shared_ptr<const SpilledCacheElement> spilled_element;
+    size_t size_bytes = 0;
+  };
+
   struct CacheQueryResult {
     std::shared_ptr<const ElementType> element;
     bool cache_hit;
+    // Number of cached elements newer than `element`.
+    size_t lag;
+    // Number of elements evicted before the trainer could read them.
+    size_t num_skipped;
   };
 
   // Returns the next element and metrics about this query.
@@ -138,23 +233,43 @@ class CrossTrainerCache {
   // the cached elements).
   size_t GetElementIndex(const std::string& trainer_id);
 
-  // Returns the next element for `trainer_id`.
-  StatusOr<std::shared_ptr<const ElementType>> GetElement(
-      const std::string& trainer_id);
+  // Returns the next entry for `trainer_id`, and fills in the metrics of
+  // `result`.
+  StatusOr<CacheEntry> GetElement(const std::string& trainer_id,
+                                  CacheQueryResult& result);
+
+  // Reads a spilled element back into memory.
+  StatusOr<std::shared_ptr<const ElementType>> ReadSpilledElement(
+      const SpilledCacheElement& spilled_element);
 
   // Reads a new element and writes it into the cache.
   Status ExtendCache();
 
+  // Spills the oldest in-memory elements to disk until there is room in memory
+  // for an element of `new_element_size_bytes`. The files are written without
+  // holding `mu_`.
+  Status SpillElements(size_t new_element_size_bytes);
+
   // Frees old elements to keep the cache size below `max_cache_size_bytes_`.
   // `new_element_size_bytes` is the size of the new element being inserted.
-  void FreeSpace(size_t new_element_size_bytes);
+  Status FreeSpace(size_t new_element_size_bytes, mutex_lock& l);
 
-  // Records the cache hit rate and cache size.
-  void RecordMetrics(const CacheQueryResult& result);
+  // Blocks until every active trainer has read the oldest cached element.
+  Status WaitForSlowestConsumer(mutex_lock& l);
+
+  // Records the cache hit rate, cache size, and the lag of `trainer_id`.
+  void RecordMetrics(const std::string& trainer_id,
+                     const CacheQueryResult& result);
+
+  const CrossTrainerCacheConfig config_;
 
   // Maximum cache size in bytes.
   const size_t max_cache_size_bytes_;
 
+  // Directory of the spill files of this cache, or empty if elements are not
+  // spilled.
+  const std::string spill_directory_;
+
   // The element sequence over which the sliding window cache operates.
   std::unique_ptr<CachableSequence<ElementType>> cachable_sequence_;
 
@@ -165,10 +280,13 @@ class CrossTrainerCache {
   // return this status.
   Status status_ TF_GUARDED_BY(mu_) = OkStatus();
 
-  // `cache_` stores the cached elements.
-  std::deque<std::shared_ptr<const ElementType>> cache_ TF_GUARDED_BY(mu_);
+  // `cache_` stores the cached elements. The elements before
+  // `memory_start_index_` are spilled to disk, and the rest are in memory.
+  std::deque<CacheEntry> cache_ TF_GUARDED_BY(mu_);
   size_t cache_size_bytes_ TF_GUARDED_BY(mu_) = 0;
+  size_t disk_size_bytes_ TF_GUARDED_BY(mu_) = 0;
   size_t cache_start_index_ TF_GUARDED_BY(mu_) = 0;
+  size_t memory_start_index_ TF_GUARDED_BY(mu_) = 0;
 
   // True if one thread is extending the cache.
   bool extending_cache_ TF_GUARDED_BY(mu_) = false;
@@ -178,18 +296,59 @@ class CrossTrainerCache {
   // `trainer_to_element_index_map_[trainer_id] - cache_start_index_`.
   absl::flat_hash_map<std::string, size_t> trainer_to_element_index_map_
       TF_GUARDED_BY(mu_);
+
+  // Maps trainer IDs to the last time they read an element.
+  absl::flat_hash_map<std::string, absl::Time> trainer_to_last_read_time_map_
+      TF_GUARDED_BY(mu_);
 };
 
 template <class ElementType>
 CrossTrainerCache<ElementType>::CrossTrainerCache(
     size_t max_cache_size_bytes,
     std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
-    : max_cache_size_bytes_(max_cache_size_bytes),
+    : CrossTrainerCache(CrossTrainerCacheConfig{max_cache_size_bytes},
+                        std::move(cachable_sequence)) {}
+
+template <class ElementType>
+CrossTrainerCache<ElementType>::CrossTrainerCache(
+    const CrossTrainerCacheConfig& config,
+    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
+    : config_(config),
+      max_cache_size_bytes_(config.max_cache_size_bytes),
+      spill_directory_(
+          config.spill_directory.empty()
+              ? ""
+              : io::JoinPath(config.spill_directory,
+                             absl::StrCat("cross_trainer_cache_",
+                                          absl::Hex(random::New64())))),
       cachable_sequence_(std::move(cachable_sequence)) {
-  DCHECK_GT(max_cache_size_bytes, 0)
+  DCHECK_GT(max_cache_size_bytes_, 0)
       << "CrossTrainerCache size must be greater than 0.";
   VLOG(2) << "Initialized tf.data service cross-trainer cache with "
-          << FormatBytes(max_cache_size_bytes) << " of memory.";
+          << FormatBytes(max_cache_size_bytes_) << " of memory.";
+  if (!spill_directory_.empty()) {
+    VLOG(2) << "The tf.data service cross-trainer cache spills up to "
+            << FormatBytes(config_.max_disk_size_bytes) << " of elements to "
+            << spill_directory_ << ".";
+  }
+}
+
+template <class ElementType>
+CrossTrainerCache<ElementType>::~CrossTrainerCache() {
+  if (spill_directory_.empty()) {
+    return;
+  }
+  {
+    mutex_lock l(mu_);
+    cache_.clear();
+  }
+  if (Env::Default()->FileExists(spill_directory_).ok()) {
+    Status s = Env::Default()->DeleteDir(spill_directory_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete tf.data service cross-trainer cache "
+                   << "spill directory " << spill_directory_ << ": " << s;
+    }
+  }
 }
 
 template <class ElementType>
@@ -202,7 +361,7 @@ CrossTrainerCache<ElementType>::Get(const std::string& trainer_id)
   }
 
   TF_ASSIGN_OR_RETURN(CacheQueryResult result, GetCacheQueryResult(trainer_id));
-  RecordMetrics(result);
+  RecordMetrics(trainer_id, result);
   return result.element;
 }
 
@@ -212,28 +371,36 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
     const std::string& trainer_id) {
   bool should_extend_cache = false;
   while (true) {
+    CacheQueryResult result;
+    CacheEntry entry;
     {
       mutex_lock l(mu_);
       TF_RETURN_IF_ERROR(status_);
       if (IsElementReady(trainer_id)) {
-        TF_ASSIGN_OR_RETURN(std::shared_ptr<const ElementType> element,
-                            GetElement(trainer_id));
-        return CacheQueryResult{element,
-                                /*is_cache_hit=*/!should_extend_cache};
-      }
-
-      // Extends the cache or waits for another thread to extend the cache. When
-      // concurrent trainers wait for the next element, only one of them should
-      // extend the cache.
-      if (extending_cache_) {
+        TF_ASSIGN_OR_RETURN(entry, GetElement(trainer_id, result));
+      } else if (extending_cache_) {
+        // Extends the cache or waits for another thread to extend the cache.
+        // When concurrent trainers wait for the next element, only one of them
+        // should extend the cache.
         should_extend_cache = false;
         cv_.wait(l);
+        continue;
       } else {
         should_extend_cache = true;
         extending_cache_ = true;
       }
     }
 
+    if (entry.element || entry.spilled_element) {
+      result.element = entry.element;
+      if (!result.element) {
+        TF_ASSIGN_OR_RETURN(result.element,
+                            ReadSpilledElement(*entry.spilled_element));
+      }
+      result.cache_hit = !should_extend_cache;
+      return result;
+    }
+
     if (should_extend_cache) {
       Status s = ExtendCache();
       mutex_lock l(mu_);
@@ -251,8 +418,9 @@ bool CrossTrainerCache<ElementType>::IsElementReady(
 }
 
 template <class ElementType>
-StatusOr<std::shared_ptr<const ElementType>>
-CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id)
+StatusOr<typename CrossTrainerCache<ElementType>::CacheEntry>
+CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id,
+                                           CacheQueryResult& result)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   size_t element_index = GetElementIndex(trainer_id);
   if (element_index >= std::numeric_limits<size_t>::max()) {
@@ -261,10 +429,23 @@ CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id)
         element_index);
   }
 
-  std::shared_ptr<const ElementType> result =
-      cache_[element_index - cache_start_index_];
+  // New trainers start at the oldest cached element without skipping any.
+  result.num_skipped = 0;
+  if (trainer_to_last_read_time_map_.contains(trainer_id)) {
+    result.num_skipped =
+        element_index - trainer_to_element_index_map_[trainer_id];
+  }
+  result.lag = cache_start_index_ + cache_.size() - element_index - 1;
+
+  CacheEntry entry = cache_[element_index - cache_start_index_];
   trainer_to_element_index_map_[trainer_id] = element_index + 1;
-  return result;
+  trainer_to_last_read_time_map_[trainer_id] = absl::Now();
+  if (config_.eviction_policy ==
+      CrossTrainerCacheEvictionPolicy::kSlowestConsumer) {
+    // Wakes up a trainer waiting for the slowest trainer to read.
+    cv_.notify_all();
+  }
+  return entry;
 }
 
 template <class ElementType>
@@ -277,6 +458,18 @@ size_t CrossTrainerCache<ElementType>::GetElementIndex(
   return element_index;
 }
 
+template <class ElementType>
+StatusOr<std::shared_ptr<const ElementType>>
+CrossTrainerCache<ElementType>::ReadSpilledElement(
+    const SpilledCacheElement& spilled_element) TF_LOCKS_EXCLUDED(mu_) {
+  std::string serialized;
+  TF_RETURN_IF_ERROR(ReadFileToString(
+      Env::Default(), spilled_element.filename(), &serialized));
+  TF_ASSIGN_OR_RETURN(ElementType element,
+                      cachable_sequence_->DeserializeElement(serialized));
+  return std::make_shared<const ElementType>(std::move(element));
+}
+
 template <class ElementType>
 Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
   TF_ASSIGN_OR_RETURN(ElementType element, cachable_sequence_->GetNext());
@@ -289,31 +482,121 @@ Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
         " and cache size: ", max_cache_size_bytes_);
   }
 
+  if (!spill_directory_.empty()) {
+    TF_RETURN_IF_ERROR(SpillElements(new_element_size_bytes));
+  }
   mutex_lock l(mu_);
   TF_RETURN_IF_ERROR(status_);
-  FreeSpace(new_element_size_bytes);
-  cache_.push_back(std::make_shared<ElementType>(std::move(element)));
+  TF_RETURN_IF_ERROR(FreeSpace(new_element_size_bytes, l));
+  cache_.push_back(CacheEntry{
+      std::make_shared<ElementType>(std::move(element)),
+      /*spilled_element=*/nullptr, new_element_size_bytes});
   cache_size_bytes_ += new_element_size_bytes;
   return OkStatus();
 }
 
 template <class ElementType>
-void CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
+Status CrossTrainerCache<ElementType>::SpillElements(
+    size_t new_element_size_bytes) TF_LOCKS_EXCLUDED(mu_) {
+  // Only the thread extending the cache adds, spills, or evicts elements, so
+  // the in-memory elements do not change while the files are written.
+  std::vector<std::shared_ptr<const ElementType>> elements;
+  size_t spill_start_index;
+  {
+    mutex_lock l(mu_);
+    spill_start_index = memory_start_index_;
+    size_t cache_size_bytes = cache_size_bytes_;
+    for (size_t i = memory_start_index_;
+         i < cache_start_index_ + cache_.size() &&
+         cache_size_bytes + new_element_size_bytes > max_cache_size_bytes_;
+         ++i) {
+      const CacheEntry& entry = cache_[i - cache_start_index_];
+      elements.push_back(entry.element);
+      cache_size_bytes -= entry.size_bytes;
+    }
+  }
+  if (elements.empty()) {
+    return OkStatus();
+  }
+
+  TF_RETURN_IF_ERROR(Env::Default()->RecursivelyCreateDir(spill_directory_));
+  std::vector<std::shared_ptr<const SpilledCacheElement>> spilled_elements;
+  for (size_t i = 0; i < elements.size(); ++i) {
+    TF_ASSIGN_OR_RETURN(std::string serialized,
+                        cachable_sequence_->SerializeElement(*elements[i]));
+    std::string filename = io::JoinPath(
+        spill_directory_, absl::StrCat("element_", spill_start_index + i));
+    TF_RETURN_IF_ERROR(
+        WriteStringToFile(Env::Default(), filename, serialized));
+    spilled_elements.push_back(std::make_shared<const SpilledCacheElement>(
+        std::move(filename), serialized.size()));
+  }
+
+  mutex_lock l(mu_);
+  for (size_t i = 0; i < spilled_elements.size(); ++i) {
+    CacheEntry& entry = cache_[spill_start_index + i - cache_start_index_];
+    entry.element = nullptr;
+    entry.spilled_element = std::move(spilled_elements[i]);
+    cache_size_bytes_ -= entry.size_bytes;
+    disk_size_bytes_ += entry.spilled_element->size_bytes();
+  }
+  memory_start_index_ = spill_start_index + spilled_elements.size();
+  VLOG(3) << "Spilled " << spilled_elements.size() << " element(s) from "
+          << "tf.data service cross-trainer cache to disk. Disk usage: "
+          << FormatBytes(disk_size_bytes_) << ".";
+  return OkStatus();
+}
+
+template <class ElementType>
+Status CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes,
+                                                 mutex_lock& l)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   size_t num_elements_discarded = 0;
   while (!cache_.empty() &&
-         cache_size_bytes_ + new_element_size_bytes > max_cache_size_bytes_) {
-    size_t free_bytes =
-        cachable_sequence_->GetElementSizeBytes(*cache_.front());
+         (cache_size_bytes_ + new_element_size_bytes > max_cache_size_bytes_ ||
+          disk_size_bytes_ > config_.max_disk_size_bytes)) {
+    if (config_.eviction_policy ==
+        CrossTrainerCacheEvictionPolicy::kSlowestConsumer) {
+      TF_RETURN_IF_ERROR(WaitForSlowestConsumer(l));
+    }
+    const CacheEntry& entry = cache_.front();
+    if (entry.element) {
+      cache_size_bytes_ -= entry.size_bytes;
+    } else {
+      disk_size_bytes_ -= entry.spilled_element->size_bytes();
+    }
     cache_.pop_front();
-    cache_size_bytes_ -= free_bytes;
     ++cache_start_index_;
+    memory_start_index_ = std::max(memory_start_index_, cache_start_index_);
     ++num_elements_discarded;
   }
 
   VLOG(3) << "Freed " << num_elements_discarded << " element(s) from "
           << "tf.data service cross-trainer cache. Memory usage: "
           << FormatBytes(cache_size_bytes_) << ".";
+  return OkStatus();
+}
+
+template <class ElementType>
+Status CrossTrainerCache<ElementType>::WaitForSlowestConsumer(mutex_lock& l)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  while (status_.ok()) {
+    const absl::Time now = absl::Now();
+    absl::Time wait_until = absl::InfiniteFuture();
+    for (const auto& [trainer_id, last_read_time] :
+         trainer_to_last_read_time_map_) {
+      const absl::Time timeout = last_read_time + config_.consumer_timeout;
+      if (trainer_to_element_index_map_[trainer_id] <= cache_start_index_ &&
+          timeout > now) {
+        wait_until = std::min(wait_until, timeout);
+      }
+    }
+    if (wait_until == absl::InfiniteFuture()) {
+      return OkStatus();
+    }
+    cv_.wait_for(l, absl::ToChronoMicroseconds(wait_until - now));
+  }
+  return status_;
 }
 
 template <class ElementType>
@@ -338,14 +621,26 @@ bool CrossTrainerCache<ElementType>::IsCancelled() const
 
 template <class ElementType>
 void CrossTrainerCache<ElementType>::RecordMetrics(
-    const CacheQueryResult& result) {
+    const std::string& trainer_id, const CacheQueryResult& result) {
   metrics::RecordTFDataServiceCrossTrainerCacheQuery(result.cache_hit);
+  metrics::RecordTFDataServiceCrossTrainerCacheConsumerLag(trainer_id,
+                                                           result.lag);
+  if (result.num_skipped > 0) {
+    metrics::RecordTFDataServiceCrossTrainerCacheSkippedElements(
+        trainer_id, result.num_skipped);
+  }
   size_t cache_size_bytes = 0;
+  size_t disk_size_bytes = 0;
   {
     mutex_lock l(mu_);
     cache_size_bytes = cache_size_bytes_;
+    disk_size_bytes = disk_size_bytes_;
   }
   metrics::RecordTFDataServiceCrossTrainerCacheSizeBytes(cache_size_bytes);
+  if (!spill_directory_.empty()) {
+    metrics::RecordTFDataServiceCrossTrainerCacheDiskSizeBytes(
+        disk_size_bytes);
+  }
 }
 
 }  // namespace data
@@ -22,14 +22,17 @@ limitations under the License.
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/status_matchers.h"
@@ -61,6 +64,22 @@ class InfiniteRange : public CachableSequence<int64_t> {
   int64_t next_ = 0;
 };
 
+class SpillableRange : public InfiniteRange {
+ public:
+  StatusOr<std::string> SerializeElement(
+      const int64_t& element) const override {
+    return absl::StrCat(element);
+  }
+  StatusOr<int64_t> DeserializeElement(
+      const std::string& serialized) const override {
+    int64_t element;
+    if (!absl::SimpleAtoi(serialized, &element)) {
+      return errors::DataLoss("Invalid element ", serialized);
+    }
+    return element;
+  }
+};
+
 class TensorDataset : public CachableSequence<Tensor> {
  public:
   StatusOr<Tensor> GetNext() override { return Tensor("Test Tensor"); }
@@ -443,6 +462,141 @@ TEST(CrossTrainerCacheTest, TrainerIDMustBeNonEmpty) {
                                       "requires a non-empty trainer ID."));
 }
 
+TEST(CrossTrainerCacheTest, SlowestConsumerDoesNotSkipData) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 5 * sizeof(int64_t);
+  config.eviction_policy = CrossTrainerCacheEvictionPolicy::kSlowestConsumer;
+  config.consumer_timeout = absl::Hours(1);
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  // The fast trainer waits for the slow trainer when the cache is full.
+  std::unique_ptr<Thread> fast_trainer(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"fast_trainer", [&cache]() {
+        for (int64_t i = 0; i < 50; ++i) {
+          EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+        }
+      }));
+  for (int64_t i = 1; i < 50; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+}
+
+TEST(CrossTrainerCacheTest, SlowestConsumerIgnoresInactiveTrainers) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 5 * sizeof(int64_t);
+  config.eviction_policy = CrossTrainerCacheEvictionPolicy::kSlowestConsumer;
+  config.consumer_timeout = absl::Milliseconds(10);
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Inactive trainer"), IsOkAndHolds(Pointee(0)));
+  for (int64_t i = 0; i < 50; ++i) {
+    EXPECT_THAT(cache.Get("Active trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Inactive trainer"), IsOkAndHolds(Pointee(Gt(44))));
+}
+
+TEST(CrossTrainerCacheTest, SlowestConsumerCancel) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = sizeof(int64_t);
+  config.eviction_policy = CrossTrainerCacheEvictionPolicy::kSlowestConsumer;
+  config.consumer_timeout = absl::Hours(1);
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  std::unique_ptr<Thread> fast_trainer(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"fast_trainer", [&cache]() {
+        EXPECT_THAT(cache.Get("Fast trainer"),
+                    StatusIs(error::CANCELLED, "Cancelled"));
+      }));
+  Env::Default()->SleepForMicroseconds(10 * 1000);
+  cache.Cancel(errors::Cancelled("Cancelled"));
+}
+
+TEST(CrossTrainerCacheTest, ConsumerLagMetrics) {
+  CellReader<int64_t> lag(
+      "/tensorflow/data/service/cross_trainer_cache_consumer_lag");
+  CellReader<int64_t> skipped(
+      "/tensorflow/data/service/cross_trainer_cache_skipped_elements");
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Lag trainer 1"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Lag trainer 2"), IsOkAndHolds(Pointee(0)));
+  for (int64_t i = 1; i < 4; ++i) {
+    EXPECT_THAT(cache.Get("Lag trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_EQ(lag.Read("Lag trainer 1"), 0);
+  EXPECT_THAT(cache.Get("Lag trainer 2"), IsOkAndHolds(Pointee(1)));
+  EXPECT_EQ(lag.Read("Lag trainer 2"), 2);
+  EXPECT_EQ(skipped.Delta("Lag trainer 2"), 0);
+
+  for (int64_t i = 4; i < 20; ++i) {
+    EXPECT_THAT(cache.Get("Lag trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  // Elements 2 to 14 have been evicted.
+  EXPECT_THAT(cache.Get("Lag trainer 2"), IsOkAndHolds(Pointee(15)));
+  EXPECT_EQ(lag.Read("Lag trainer 2"), 4);
+  EXPECT_EQ(skipped.Delta("Lag trainer 2"), 13);
+  EXPECT_EQ(skipped.Delta("Lag trainer 1"), 0);
+}
+
+TEST(CrossTrainerCacheTest, SpillToDisk) {
+  CellReader<int64_t> disk_size(
+      "/tensorflow/data/service/cross_trainer_cache_disk_size_bytes");
+  const std::string spill_directory =
+      io::JoinPath(testing::TmpDir(), "cross_trainer_cache_spill");
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 2 * sizeof(int64_t);
+  config.spill_directory = spill_directory;
+  config.max_disk_size_bytes = 1024;
+  {
+    CrossTrainerCache<int64_t> cache(config,
+                                     std::make_unique<SpillableRange>());
+    for (int64_t i = 0; i < 50; ++i) {
+      EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+    }
+    EXPECT_GT(disk_size.Read(), 0);
+    // The slow trainer reads the spilled elements back from disk.
+    for (int64_t i = 0; i < 50; ++i) {
+      EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+    }
+  }
+  // The spill files are deleted with the cache.
+  std::vector<std::string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(spill_directory, &children));
+  EXPECT_TRUE(children.empty());
+}
+
+TEST(CrossTrainerCacheTest, SpillToDiskEvictsWhenDiskIsFull) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 2 * sizeof(int64_t);
+  config.spill_directory =
+      io::JoinPath(testing::TmpDir(), "cross_trainer_cache_full_disk");
+  // Each spilled element takes 1 or 2 bytes.
+  config.max_disk_size_bytes = 10;
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<SpillableRange>());
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+  for (int64_t i = 0; i < 50; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  // At most 5 two-digit elements are spilled, besides 2 in memory.
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(Gt(42))));
+}
+
+TEST(CrossTrainerCacheTest, SpillToDiskUnsupported) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = sizeof(int64_t);
+  config.spill_directory =
+      io::JoinPath(testing::TmpDir(), "cross_trainer_cache_unsupported");
+  config.max_disk_size_bytes = 1024;
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Trainer ID"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Trainer ID"),
+              StatusIs(error::UNIMPLEMENTED,
+                       HasSubstr("does not support spilling elements")));
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
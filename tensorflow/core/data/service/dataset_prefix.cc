@@ -0,0 +1,129 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/dataset_prefix.h"
+
+#include <optional>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/hash_utils.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kRetvalOp[] = "_Retval";
+
+// Transformations which may follow a shared prefix. They must create a single
+// iterator of their input, since the shared prefix is only produced once.
+const absl::flat_hash_set<absl::string_view>& SuffixOps() {
+  static const auto* const kSuffixOps = new absl::flat_hash_set<
+      absl::string_view>({"BatchDataset",
+                          "BatchDatasetV2",
+                          "ExperimentalMaxIntraOpParallelismDataset",
+                          "ExperimentalPrivateThreadPoolDataset",
+                          "MaxIntraOpParallelismDataset",
+                          "ModelDataset",
+                          "OptionsDataset",
+                          "PaddedBatchDataset",
+                          "PaddedBatchDatasetV2",
+                          "ParallelBatchDataset",
+                          "PrefetchDataset",
+                          "PrivateThreadPoolDataset",
+                          "ShuffleDataset",
+                          "ShuffleDatasetV2",
+                          "ShuffleDatasetV3",
+                          "TakeDataset"});
+  return *kSuffixOps;
+}
+
+// Returns the name of the node producing the tensor named `input`.
+absl::string_view InputNodeName(absl::string_view input) {
+  absl::ConsumePrefix(&input, "^");
+  return input.substr(0, input.find(':'));
+}
+
+bool IsDatasetOp(const NodeDef* node) {
+  return node != nullptr && absl::StrContains(node->op(), "Dataset");
+}
+
+}  // namespace
+
+StatusOr<std::optional<DatasetPrefix>> FindShareablePrefix(
+    const GraphDef& graph) {
+  absl::flat_hash_map<absl::string_view, const NodeDef*> nodes;
+  const NodeDef* node = nullptr;
+  for (const NodeDef& n : graph.node()) {
+    nodes[n.name()] = &n;
+    if (n.op() == kRetvalOp) {
+      node = &n;
+    }
+  }
+  if (node == nullptr || node->input_size() == 0) {
+    return errors::InvalidArgument(
+        "Failed to find the output of the dataset graph.");
+  }
+  auto input_node = [&nodes](const NodeDef* n) -> const NodeDef* {
+    if (n->input_size() == 0) {
+      return nullptr;
+    }
+    auto it = nodes.find(InputNodeName(n->input(0)));
+    return it == nodes.end() ? nullptr : it->second;
+  };
+
+  node = input_node(node);
+  bool has_suffix = false;
+  while (node != nullptr && SuffixOps().contains(node->op())) {
+    node = input_node(node);
+    has_suffix = true;
+  }
+  if (!has_suffix || !IsDatasetOp(node) || !IsDatasetOp(input_node(node))) {
+    return std::optional<DatasetPrefix>();
+  }
+
+  DatasetPrefix prefix;
+  prefix.node_name = node->name();
+  TF_RETURN_IF_ERROR(HashNode(graph, *node, &prefix.fingerprint));
+  return std::optional<DatasetPrefix>(std::move(prefix));
+}
+
+StatusOr<GraphDef> MakePrefixGraph(const GraphDef& graph,
+                                   const std::string& prefix_node) {
+  GraphDef prefix_graph = graph;
+  bool found_prefix_node = false;
+  NodeDef* retval = nullptr;
+  for (NodeDef& node : *prefix_graph.mutable_node()) {
+    found_prefix_node |= node.name() == prefix_node;
+    if (node.op() == kRetvalOp) {
+      retval = &node;
+    }
+  }
+  if (!found_prefix_node || retval == nullptr || retval->input_size() == 0) {
+    return errors::InvalidArgument("Failed to find dataset prefix node ",
+                                   prefix_node, " in the dataset graph.");
+  }
+  retval->set_input(0, prefix_node);
+  return prefix_graph;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,57 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_DATASET_PREFIX_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_DATASET_PREFIX_H_
+
+#include <optional>
+#include <string>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A prefix of a dataset graph that other datasets may share, e.g. the
+// `read -> parse -> augment` part of datasets which only differ in how they
+// batch or shuffle the result.
+struct DatasetPrefix {
+  // The name of the node producing the prefix dataset.
+  std::string node_name;
+  // Fingerprint of the subgraph rooted at `node_name`. It does not depend on
+  // node names, so equal prefixes of different datasets have equal
+  // fingerprints.
+  uint64 fingerprint = 0;
+};
+
+// Finds the prefix of the dataset graph `graph` that may be shared with other
+// datasets: the input of the trailing transformations which are cheap and
+// commonly varied between otherwise identical datasets (batching, shuffling,
+// prefetching, ...). Returns nullopt if the dataset does not end with such a
+// transformation, or if the remaining prefix is only a source dataset, which
+// is not worth sharing.
+StatusOr<std::optional<DatasetPrefix>> FindShareablePrefix(
+    const GraphDef& graph);
+
+// Returns a copy of the dataset graph `graph` which produces the dataset of
+// node `prefix_node` instead of the full dataset.
+StatusOr<GraphDef> MakePrefixGraph(const GraphDef& graph,
+                                   const std::string& prefix_node);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_DATASET_PREFIX_H_
@@ -0,0 +1,161 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/dataset_prefix.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::test::AsScalar;
+using ::tensorflow::test::function::GDef;
+using ::tensorflow::test::function::NDef;
+using ::tensorflow::testing::StatusIs;
+using ::testing::HasSubstr;
+
+NodeDef ConstNode(const std::string& name, int64_t value) {
+  return NDef(name, "Const", /*inputs=*/{},
+              {{"value", AsScalar<int64_t>(value)}, {"dtype", DT_INT64}});
+}
+
+NodeDef DatasetNode(const std::string& name, const std::string& op,
+                    const std::vector<std::string>& inputs) {
+  return NDef(name, op, inputs,
+              {{"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape()}},
+               {"output_types", gtl::ArraySlice<DataType>{DT_INT64}}});
+}
+
+// Returns the graph of
+// `range(stop).skip(1).<suffix_op>(suffix_arg)`, with the node names
+// prefixed by `name_prefix`.
+GraphDef MakeGraph(const std::string& name_prefix, int64_t stop,
+                   const std::string& suffix_op, int64_t suffix_arg) {
+  const std::string p = name_prefix;
+  std::vector<NodeDef> nodes = {
+      ConstNode(p + "start", 0), ConstNode(p + "stop", stop),
+      ConstNode(p + "step", 1),
+      DatasetNode(p + "range", "RangeDataset",
+                  {p + "start", p + "stop", p + "step"}),
+      ConstNode(p + "skip_count", 1),
+      DatasetNode(p + "skip", "SkipDataset", {p + "range", p + "skip_count"})};
+  std::string output = p + "skip";
+  if (!suffix_op.empty()) {
+    nodes.push_back(ConstNode(p + "suffix_arg", suffix_arg));
+    nodes.push_back(
+        DatasetNode(p + "suffix", suffix_op, {output, p + "suffix_arg"}));
+    output = p + "suffix";
+  }
+  nodes.push_back(
+      NDef(p + "dataset", "_Retval", {output},
+           {{"T", DT_VARIANT}, {"index", 0}}));
+  return GDef(nodes, {});
+}
+
+std::optional<DatasetPrefix> FindPrefix(const GraphDef& graph) {
+  StatusOr<std::optional<DatasetPrefix>> prefix = FindShareablePrefix(graph);
+  TF_CHECK_OK(prefix.status());
+  return *prefix;
+}
+
+TEST(DatasetPrefixTest, FindPrefixBeforeTake) {
+  std::optional<DatasetPrefix> prefix =
+      FindPrefix(MakeGraph("", /*stop=*/10, "TakeDataset", 5));
+  ASSERT_TRUE(prefix.has_value());
+  EXPECT_EQ(prefix->node_name, "skip");
+}
+
+TEST(DatasetPrefixTest, FindPrefixBeforeSeveralSuffixOps) {
+  GraphDef graph = MakeGraph("", /*stop=*/10, "BatchDataset", 2);
+  *graph.add_node() = ConstNode("buffer_size", 2);
+  *graph.add_node() =
+      DatasetNode("prefetch", "PrefetchDataset", {"suffix", "buffer_size"});
+  for (NodeDef& node : *graph.mutable_node()) {
+    if (node.op() == "_Retval") {
+      node.set_input(0, "prefetch");
+    }
+  }
+  std::optional<DatasetPrefix> prefix = FindPrefix(graph);
+  ASSERT_TRUE(prefix.has_value());
+  EXPECT_EQ(prefix->node_name, "skip");
+}
+
+TEST(DatasetPrefixTest, EqualPrefixesHaveEqualFingerprints) {
+  std::optional<DatasetPrefix> take =
+      FindPrefix(MakeGraph("a_", /*stop=*/10, "TakeDataset", 5));
+  std::optional<DatasetPrefix> batch =
+      FindPrefix(MakeGraph("b_", /*stop=*/10, "BatchDataset", 3));
+  std::optional<DatasetPrefix> other_range =
+      FindPrefix(MakeGraph("a_", /*stop=*/20, "TakeDataset", 5));
+  ASSERT_TRUE(take.has_value());
+  ASSERT_TRUE(batch.has_value());
+  ASSERT_TRUE(other_range.has_value());
+  EXPECT_EQ(take->node_name, "a_skip");
+  EXPECT_EQ(batch->node_name, "b_skip");
+  EXPECT_EQ(take->fingerprint, batch->fingerprint);
+  EXPECT_NE(take->fingerprint, other_range->fingerprint);
+}
+
+TEST(DatasetPrefixTest, NoSuffix) {
+  EXPECT_FALSE(FindPrefix(MakeGraph("", /*stop=*/10, "", 0)).has_value());
+}
+
+TEST(DatasetPrefixTest, SourceDatasetPrefix) {
+  GraphDef graph = GDef(
+      {ConstNode("start", 0), ConstNode("stop", 10), ConstNode("step", 1),
+       DatasetNode("range", "RangeDataset", {"start", "stop", "step"}),
+       ConstNode("count", 5),
+       DatasetNode("take", "TakeDataset", {"range", "count"}),
+       NDef("dataset", "_Retval", {"take"},
+            {{"T", DT_VARIANT}, {"index", 0}})},
+      {});
+  EXPECT_FALSE(FindPrefix(graph).has_value());
+}
+
+TEST(DatasetPrefixTest, MakePrefixGraph) {
+  const GraphDef graph = MakeGraph("", /*stop=*/10, "TakeDataset", 5);
+  TF_ASSERT_OK_AND_ASSIGN(GraphDef prefix_graph,
+                          MakePrefixGraph(graph, "skip"));
+  ASSERT_EQ(prefix_graph.node_size(), graph.node_size());
+  for (const NodeDef& node : prefix_graph.node()) {
+    if (node.op() == "_Retval") {
+      EXPECT_EQ(node.input(0), "skip");
+    }
+  }
+}
+
+TEST(DatasetPrefixTest, MakePrefixGraphUnknownNode) {
+  EXPECT_THAT(
+      MakePrefixGraph(MakeGraph("", /*stop=*/10, "TakeDataset", 5), "unknown"),
+      StatusIs(error::INVALID_ARGUMENT, HasSubstr("unknown")));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -245,6 +245,38 @@ Status DataServiceDispatcherClient::GetWorkers(
   return OkStatus();
 }
 
+Status DataServiceDispatcherClient::GetTargetWorkerCount(
+    int64_t& target_worker_count, int64_t& current_worker_count) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  GetTargetWorkerCountRequest req;
+  GetTargetWorkerCountResponse resp;
+  grpc::ClientContext ctx;
+  grpc::Status s = stub_->GetTargetWorkerCount(&ctx, req, &resp);
+  if (!s.ok()) {
+    return grpc_util::WrapError("Failed to get target worker count", s);
+  }
+  target_worker_count = resp.target_worker_count();
+  current_worker_count = resp.current_worker_count();
+  return OkStatus();
+}
+
+Status DataServiceDispatcherClient::Snapshot(int64_t dataset_id,
+                                             const std::string& path,
+                                             int64_t num_chunks) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  SnapshotRequest req;
+  req.set_dataset_id(dataset_id);
+  req.set_path(path);
+  req.set_num_chunks(num_chunks);
+  SnapshotResponse resp;
+  grpc::ClientContext ctx;
+  grpc::Status s = stub_->Snapshot(&ctx, req, &resp);
+  if (!s.ok()) {
+    return grpc_util::WrapError("Failed to start snapshot", s);
+  }
+  return OkStatus();
+}
+
 Status DataServiceDispatcherClient::GetDataServiceMetadata(
     int64_t dataset_id, DataServiceMetadata& metadata) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
@@ -108,6 +108,17 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
   // stored in `workers`.
   Status GetWorkers(std::vector<WorkerInfo>& workers);
 
+  // Gets the number of workers the dispatcher recommends for the cluster,
+  // along with the number of workers currently registered.
+  Status GetTargetWorkerCount(int64_t& target_worker_count,
+                              int64_t& current_worker_count);
+
+  // Starts writing a snapshot of dataset `dataset_id` to `path` in
+  // `num_chunks` chunks. If `num_chunks` is 0, the dispatcher writes one chunk
+  // per registered worker.
+  Status Snapshot(int64_t dataset_id, const std::string& path,
+                  int64_t num_chunks);
+
   // Returns data service metadata for the registered dataset.
   Status GetDataServiceMetadata(int64_t dataset_id,
                                 DataServiceMetadata& metadata);
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,7 +44,9 @@ limitations under the License.
 #include "tensorflow/core/data/service/export.pb.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/journal.h"
+#include "tensorflow/core/data/service/snapshot_chunk_writer.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
+#include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -61,6 +64,7 @@ limitations under the License.
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
 #include "tensorflow/core/protobuf/service_config.pb.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -78,6 +82,8 @@ constexpr int64_t kDefaultIterationGcCheckIntervalMs =
     10 * 60 * 1000;                                              // 10 minutes.
 constexpr int64_t kDefaultIterationGcTimeoutMs = 5 * 60 * 1000;  // 5 minutes.
 constexpr int64_t kDefaultClientTimeoutMs = 2 * 60 * 1000;       // 2 minutes.
+constexpr int64_t kDefaultWorkerTimeoutMs = 2 * 60 * 1000;       // 2 minutes.
+constexpr double kDefaultAutoscalingTargetCpuUtilization = 0.8;
 
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
@@ -150,15 +156,36 @@ DispatcherConfig ApplyConfigDefaults(const DispatcherConfig& config) {
   if (new_config.client_timeout_ms() == 0) {
     new_config.set_client_timeout_ms(kDefaultClientTimeoutMs);
   }
+  if (new_config.worker_timeout_ms() == 0) {
+    new_config.set_worker_timeout_ms(kDefaultWorkerTimeoutMs);
+  }
+  if (new_config.autoscaling_target_cpu_utilization() == 0) {
+    new_config.set_autoscaling_target_cpu_utilization(
+        kDefaultAutoscalingTargetCpuUtilization);
+  }
   return new_config;
 }
 
+AutoScaler::Options MakeAutoScalerOptions(const DispatcherConfig& config) {
+  AutoScaler::Options options;
+  options.target_cpu_utilization = config.autoscaling_target_cpu_utilization();
+  return options;
+}
+
+// Returns the fraction of time a client spent blocked waiting for elements,
+// based on the wait time in its heartbeat.
+double ClientWaitFraction(const ClientHeartbeatRequest& request) {
+  return std::min(1.0, static_cast<double>(request.wait_time_us()) /
+                           static_cast<double>(request.wait_time_window_us()));
+}
+
 }  // namespace
 
 DataServiceDispatcherImpl::DataServiceDispatcherImpl(
     const DispatcherConfig& config)
     : config_(ApplyConfigDefaults(config)),
       env_(Env::Default()),
+      auto_scaler_(MakeAutoScalerOptions(config_)),
       state_(config_) {
   if (config_.work_dir().empty()) {
     dataset_store_ = std::make_unique<MemoryDatasetStore>();
@@ -228,6 +255,12 @@ Status DataServiceDispatcherImpl::Start() {
     latest_client_heartbeats_time_[client_id] =
         absl::FromUnixMicros(env_->NowMicros());
   }
+  for (const auto& worker : state_.ListWorkers()) {
+    // Likewise for workers, so that we don't reassign their snapshot chunks
+    // before they had a chance to heartbeat.
+    latest_worker_heartbeats_time_[worker->address] =
+        absl::FromUnixMicros(env_->NowMicros());
+  }
   // Initialize the journal writer in `Start` so that we fail fast in case it
   // can't be initialized.
   TF_RETURN_IF_ERROR(journal_writer_.value()->EnsureInitialized());
@@ -324,41 +357,234 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
   TF_RETURN_IF_ERROR(CheckStarted());
   VLOG(4) << "Received worker heartbeat request from worker "
           << request->worker_address();
-  mutex_lock l(mu_);
-  const std::string& worker_address = request->worker_address();
-  // Assigned tasks from the perspective of the dispatcher.
-  std::vector<std::shared_ptr<const Task>> assigned_tasks;
-  Status s = state_.TasksForWorker(worker_address, assigned_tasks);
-  if (!s.ok()) {
-    if (!errors::IsNotFound(s)) {
-      return s;
+  std::vector<std::shared_ptr<const DispatcherState::Snapshot>>
+      snapshots_to_finalize;
+  Status snapshot_status;
+  {
+    mutex_lock l(mu_);
+    const std::string& worker_address = request->worker_address();
+    latest_worker_heartbeats_time_[worker_address] =
+        absl::FromUnixMicros(env_->NowMicros());
+    // Assigned tasks from the perspective of the dispatcher.
+    std::vector<std::shared_ptr<const Task>> assigned_tasks;
+    Status s = state_.TasksForWorker(worker_address, assigned_tasks);
+    if (!s.ok()) {
+      if (!errors::IsNotFound(s)) {
+        return s;
+      }
+      VLOG(1) << "Registering new worker at address " << worker_address;
+      TF_RETURN_IF_ERROR(state_.ValidateWorker(worker_address));
+      Update update;
+      update.mutable_register_worker()->set_worker_address(worker_address);
+      update.mutable_register_worker()->set_transfer_address(
+          request->transfer_address());
+      *update.mutable_register_worker()->mutable_worker_tags() =
+          request->worker_tags();
+      update.mutable_register_worker()->set_worker_uid(request->worker_uid());
+      TF_RETURN_IF_ERROR(Apply(update));
+      TF_RETURN_IF_ERROR(CreateTasksForWorker(worker_address));
+      TF_RETURN_IF_ERROR(state_.TasksForWorker(worker_address, assigned_tasks));
+      auto_scaler_.AddWorker(worker_address);
     }
-    VLOG(1) << "Registering new worker at address " << worker_address;
-    TF_RETURN_IF_ERROR(state_.ValidateWorker(worker_address));
-    Update update;
-    update.mutable_register_worker()->set_worker_address(worker_address);
-    update.mutable_register_worker()->set_transfer_address(
-        request->transfer_address());
-    *update.mutable_register_worker()->mutable_worker_tags() =
-        request->worker_tags();
-    update.mutable_register_worker()->set_worker_uid(request->worker_uid());
-    TF_RETURN_IF_ERROR(Apply(update));
-    TF_RETURN_IF_ERROR(CreateTasksForWorker(worker_address));
-    TF_RETURN_IF_ERROR(state_.TasksForWorker(worker_address, assigned_tasks));
+    if (request->optional_cpu_utilization_case() ==
+        WorkerHeartbeatRequest::kCpuUtilization) {
+      TF_RETURN_IF_ERROR(auto_scaler_.ReportCpuUtilization(
+          worker_address, request->cpu_utilization()));
+    }
+    absl::flat_hash_set<int64_t> current_tasks;
+    current_tasks.insert(request->current_tasks().cbegin(),
+                         request->current_tasks().cend());
+    TF_RETURN_IF_ERROR(
+        FindTasksToDelete(current_tasks, assigned_tasks, response));
+    TF_RETURN_IF_ERROR(
+        FindNewTasks(worker_address, current_tasks, assigned_tasks, response));
+    snapshot_status =
+        UpdateSnapshotChunks(*request, response, snapshots_to_finalize);
   }
-  absl::flat_hash_set<int64_t> current_tasks;
-  current_tasks.insert(request->current_tasks().cbegin(),
-                       request->current_tasks().cend());
-  TF_RETURN_IF_ERROR(
-      FindTasksToDelete(current_tasks, assigned_tasks, response));
-  TF_RETURN_IF_ERROR(
-      FindNewTasks(worker_address, current_tasks, assigned_tasks, response));
+  // Finalizing moves files and writes the snapshot metadata, so it must not
+  // block other RPCs.
+  FinalizeSnapshots(snapshots_to_finalize);
+  TF_RETURN_IF_ERROR(snapshot_status);
 
   VLOG(4) << "Finished worker heartbeat for worker at address "
           << request->worker_address();
   return OkStatus();
 }
 
+Status DataServiceDispatcherImpl::UpdateSnapshotChunks(
+    const WorkerHeartbeatRequest& request, WorkerHeartbeatResponse* response,
+    std::vector<std::shared_ptr<const DispatcherState::Snapshot>>&
+        snapshots_to_finalize) {
+  const std::string& worker_address = request.worker_address();
+  for (const SnapshotChunkProgress& progress :
+       request.completed_snapshot_chunks()) {
+    std::shared_ptr<const DispatcherState::Snapshot> snapshot;
+    TF_RETURN_IF_ERROR(state_.SnapshotFromPath(progress.path(), snapshot));
+    const int64_t chunk_index = progress.chunk_index();
+    if (chunk_index < 0 || chunk_index >= snapshot->num_chunks) {
+      return errors::InvalidArgument("Worker ", worker_address,
+                                     " reported completing chunk ", chunk_index,
+                                     " of snapshot ", snapshot->path,
+                                     ", which only has ", snapshot->num_chunks,
+                                     " chunks");
+    }
+    if (progress.attempt() < 0 ||
+        progress.attempt() >= snapshot->chunk_attempts[chunk_index]) {
+      return errors::InvalidArgument(
+          "Worker ", worker_address, " reported completing attempt ",
+          progress.attempt(), " of chunk ", chunk_index, " of snapshot ",
+          snapshot->path, ", which was never assigned");
+    }
+    // A chunk may have been reassigned while its first worker was still
+    // writing it. Each attempt has its own file, so whichever finishes first
+    // is committed along with its own number of elements.
+    if (snapshot->IsCommitted(chunk_index)) {
+      continue;
+    }
+    Update update;
+    CommitSnapshotChunkUpdate* commit_snapshot_chunk =
+        update.mutable_commit_snapshot_chunk();
+    commit_snapshot_chunk->set_path(snapshot->path);
+    commit_snapshot_chunk->set_chunk_index(chunk_index);
+    commit_snapshot_chunk->set_attempt(progress.attempt());
+    commit_snapshot_chunk->set_num_elements(progress.num_elements());
+    *commit_snapshot_chunk->mutable_dtypes() = progress.dtypes();
+    TF_RETURN_IF_ERROR(Apply(update));
+    VLOG(1) << "Committed attempt " << progress.attempt() << " of chunk "
+            << chunk_index << " of snapshot " << snapshot->path
+            << " written by worker " << worker_address;
+  }
+
+  const std::vector<std::shared_ptr<const DispatcherState::Snapshot>>
+      snapshots = state_.ListSnapshots();
+  // Finished snapshots are no longer updated, so they can be finalized without
+  // holding `mu_`. This is retried by later heartbeats until it succeeds.
+  for (const auto& snapshot : snapshots) {
+    if (snapshot->finished() && !finalized_snapshots_.contains(snapshot->path) &&
+        finalizing_snapshots_.insert(snapshot->path).second) {
+      snapshots_to_finalize.push_back(snapshot);
+    }
+  }
+
+  auto add_chunk = [response](const DispatcherState::Snapshot& snapshot,
+                              int64_t chunk_index) {
+    SnapshotChunkDef* chunk_def = response->add_snapshot_chunks();
+    chunk_def->set_path(snapshot.path);
+    chunk_def->set_dataset_id(snapshot.dataset_id);
+    chunk_def->set_chunk_index(chunk_index);
+    chunk_def->set_num_chunks(snapshot.num_chunks);
+    chunk_def->set_attempt(snapshot.chunk_attempts[chunk_index] - 1);
+  };
+  for (const auto& snapshot : snapshots) {
+    for (int64_t i = 0; i < snapshot->num_chunks; ++i) {
+      if (!snapshot->IsCommitted(i) &&
+          snapshot->chunk_workers[i] == worker_address) {
+        add_chunk(*snapshot, i);
+      }
+    }
+  }
+  if (response->snapshot_chunks_size() > 0) {
+    return OkStatus();
+  }
+  // Workers write one chunk at a time, so that idle workers can pick up the
+  // remaining chunks.
+  for (const auto& snapshot : snapshots) {
+    for (int64_t i = 0; i < snapshot->num_chunks; ++i) {
+      if (snapshot->IsCommitted(i)) {
+        continue;
+      }
+      const std::string& chunk_worker = snapshot->chunk_workers[i];
+      if (!chunk_worker.empty() && !WorkerTimedOut(chunk_worker)) {
+        continue;
+      }
+      if (!chunk_worker.empty()) {
+        LOG(INFO) << "Reassigning chunk " << i << " of snapshot "
+                  << snapshot->path << " from timed out worker "
+                  << chunk_worker << " to worker " << worker_address;
+      }
+      Update update;
+      AssignSnapshotChunkUpdate* assign_snapshot_chunk =
+          update.mutable_assign_snapshot_chunk();
+      assign_snapshot_chunk->set_path(snapshot->path);
+      assign_snapshot_chunk->set_chunk_index(i);
+      assign_snapshot_chunk->set_worker_address(worker_address);
+      TF_RETURN_IF_ERROR(Apply(update));
+      add_chunk(*snapshot, i);
+      return OkStatus();
+    }
+  }
+  return OkStatus();
+}
+
+bool DataServiceDispatcherImpl::WorkerTimedOut(
+    const std::string& worker_address) const {
+  auto it = latest_worker_heartbeats_time_.find(worker_address);
+  if (it == latest_worker_heartbeats_time_.end()) {
+    return true;
+  }
+  return absl::FromUnixMicros(env_->NowMicros()) >
+         it->second + absl::Milliseconds(config_.worker_timeout_ms());
+}
+
+void DataServiceDispatcherImpl::FinalizeSnapshots(
+    const std::vector<std::shared_ptr<const DispatcherState::Snapshot>>&
+        snapshots) {
+  for (const auto& snapshot : snapshots) {
+    Status s = FinalizeSnapshot(*snapshot);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to finalize snapshot " << snapshot->path
+                   << "; will retry on a later heartbeat: " << s;
+    }
+    mutex_lock l(mu_);
+    finalizing_snapshots_.erase(snapshot->path);
+    if (s.ok()) {
+      finalized_snapshots_.insert(snapshot->path);
+    }
+  }
+}
+
+Status DataServiceDispatcherImpl::FinalizeSnapshot(
+    const DispatcherState::Snapshot& snapshot) {
+  experimental::SnapshotMetadataRecord metadata;
+  bool metadata_exists;
+  TF_RETURN_IF_ERROR(snapshot_util::ReadMetadataFile(env_, snapshot.path,
+                                                     &metadata,
+                                                     &metadata_exists));
+  if (metadata_exists) {
+    // Finalized before the dispatcher restarted.
+    return OkStatus();
+  }
+  int64_t num_elements = 0;
+  for (int64_t i = 0; i < snapshot.num_chunks; ++i) {
+    TF_RETURN_IF_ERROR(CommitSnapshotChunkFile(
+        env_, snapshot.path, snapshot.run_id, i,
+        snapshot.committed_attempts[i]));
+    num_elements += snapshot.chunk_num_elements[i];
+  }
+  // Readers find the chunks through the metadata, in the format of
+  // `Dataset.save`, so it is written last.
+  metadata.set_creation_timestamp(EnvTime::NowMicros());
+  metadata.set_run_id(strings::Printf(
+      "%llu", static_cast<unsigned long long>(snapshot.run_id)));
+  metadata.set_version(kSnapshotChunkFileFormatVersion);
+  for (DataType dtype : snapshot.dtypes) {
+    metadata.add_dtype(dtype);
+  }
+  metadata.set_num_elements(num_elements);
+  metadata.set_finalized(true);
+  TF_RETURN_IF_ERROR(
+      snapshot_util::WriteMetadataFile(env_, snapshot.path, &metadata));
+  // Attempts which weren't committed are no longer needed.
+  int64_t undeleted_files, undeleted_dirs;
+  env_->DeleteRecursively(SnapshotAttemptsDirectory(snapshot.path),
+                          &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  LOG(INFO) << "Finished writing snapshot " << snapshot.path << " with "
+            << num_elements << " elements in " << snapshot.num_chunks
+            << " chunks";
+  return OkStatus();
+}
+
 Status DataServiceDispatcherImpl::WorkerUpdate(
     const WorkerUpdateRequest* request, WorkerUpdateResponse* response) {
   TF_RETURN_IF_ERROR(CheckStarted());
@@ -472,6 +698,17 @@ Status DataServiceDispatcherImpl::GetOrRegisterDataset(
   GraphDef* graph = dataset_def.mutable_graph();
   PrepareGraph(graph);
   TF_RETURN_IF_ERROR(HashGraph(*graph, &fingerprint));
+  std::optional<DatasetPrefix> prefix;
+  if (config_.share_dataset_prefixes()) {
+    StatusOr<std::optional<DatasetPrefix>> shareable_prefix =
+        FindShareablePrefix(*graph);
+    if (shareable_prefix.ok()) {
+      prefix = std::move(shareable_prefix).value();
+    } else {
+      VLOG(1) << "Failed to find a shareable dataset prefix: "
+              << shareable_prefix.status();
+    }
+  }
 
   mutex_lock l(mu_);
 #if defined(PLATFORM_GOOGLE)
@@ -486,6 +723,9 @@ Status DataServiceDispatcherImpl::GetOrRegisterDataset(
     int64_t id = dataset->dataset_id;
     VLOG(3) << "Received duplicate RegisterDataset request with fingerprint "
             << fingerprint << ". Returning id " << id;
+    if (prefix.has_value()) {
+      RecordDatasetPrefix(id, *prefix);
+    }
     response->set_dataset_id(id);
     return OkStatus();
   } else if (!errors::IsNotFound(s)) {
@@ -495,6 +735,9 @@ Status DataServiceDispatcherImpl::GetOrRegisterDataset(
   int64_t id;
   TF_RETURN_IF_ERROR(
       RegisterDataset(fingerprint, dataset_def, request->metadata(), id));
+  if (prefix.has_value()) {
+    RecordDatasetPrefix(id, *prefix);
+  }
 
   response->set_dataset_id(id);
   VLOG(3) << "Registered new dataset with id " << id;
@@ -516,6 +759,22 @@ Status DataServiceDispatcherImpl::RegisterDataset(
   return Apply(update);
 }
 
+void DataServiceDispatcherImpl::RecordDatasetPrefix(
+    int64_t dataset_id, const DatasetPrefix& prefix)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (!dataset_prefixes_.emplace(dataset_id, prefix).second) {
+    return;
+  }
+  absl::flat_hash_set<int64_t>& dataset_ids =
+      prefix_dataset_ids_[prefix.fingerprint];
+  dataset_ids.insert(dataset_id);
+  if (dataset_ids.size() > 1) {
+    LOG(INFO) << "Dataset " << dataset_id << " shares the prefix ending at "
+              << prefix.node_name << " with " << dataset_ids.size() - 1
+              << " other datasets. Workers will compute the prefix once.";
+  }
+}
+
 Status DataServiceDispatcherImpl::GetDataServiceMetadata(
     const GetDataServiceMetadataRequest* request,
     GetDataServiceMetadataResponse* response) {
@@ -657,6 +916,7 @@ Status DataServiceDispatcherImpl::ReleaseIterationClient(
   release_iteration_client->set_iteration_client_id(iteration_client_id);
   release_iteration_client->set_time_micros(env_->NowMicros());
   TF_RETURN_IF_ERROR(Apply(update));
+  auto_scaler_.RemoveClient(iteration_client_id);
   return OkStatus();
 }
 
@@ -922,6 +1182,10 @@ Status DataServiceDispatcherImpl::ClientHeartbeat(
         "Consider configuring the dispatcher with a higher "
         "`iteration_gc_timeout_ms`.");
   }
+  if (request->wait_time_window_us() > 0) {
+    TF_RETURN_IF_ERROR(auto_scaler_.ReportClientWaitFraction(
+        request->iteration_client_id(), ClientWaitFraction(*request)));
+  }
   if (request->optional_current_round_case() ==
       ClientHeartbeatRequest::kCurrentRound) {
     round_robin_rounds_[request->iteration_client_id()] =
@@ -1006,6 +1270,60 @@ Status DataServiceDispatcherImpl::GetWorkers(const GetWorkersRequest* request,
   return OkStatus();
 }
 
+Status DataServiceDispatcherImpl::GetTargetWorkerCount(
+    const GetTargetWorkerCountRequest* request,
+    GetTargetWorkerCountResponse* response) {
+  TF_RETURN_IF_ERROR(CheckStarted());
+  mutex_lock l(mu_);
+  const int64_t current_worker_count = state_.ListWorkers().size();
+  response->set_current_worker_count(current_worker_count);
+  response->set_target_worker_count(
+      auto_scaler_.GetTargetWorkerCount(current_worker_count));
+  VLOG(3) << "Recommending " << response->target_worker_count()
+          << " workers for a cluster of " << current_worker_count
+          << " workers";
+  return OkStatus();
+}
+
+Status DataServiceDispatcherImpl::Snapshot(const SnapshotRequest* request,
+                                           SnapshotResponse* response) {
+  TF_RETURN_IF_ERROR(CheckStarted());
+  mutex_lock l(mu_);
+  if (request->path().empty()) {
+    return errors::InvalidArgument("Snapshot path must not be empty");
+  }
+  if (request->num_chunks() < 0) {
+    return errors::InvalidArgument(
+        "The number of snapshot chunks must be non-negative, but got ",
+        request->num_chunks());
+  }
+  std::shared_ptr<const Dataset> dataset;
+  TF_RETURN_IF_ERROR(state_.DatasetFromId(request->dataset_id(), dataset));
+  std::shared_ptr<const DispatcherState::Snapshot> snapshot;
+  Status s = state_.SnapshotFromPath(request->path(), snapshot);
+  if (s.ok()) {
+    return errors::AlreadyExists("A snapshot is already being written to ",
+                                 request->path());
+  }
+  if (!errors::IsNotFound(s)) {
+    return s;
+  }
+  int64_t num_chunks = request->num_chunks();
+  if (num_chunks == 0) {
+    num_chunks = std::max<int64_t>(1, state_.ListWorkers().size());
+  }
+  Update update;
+  SnapshotUpdate* snapshot_update = update.mutable_snapshot();
+  snapshot_update->set_path(request->path());
+  snapshot_update->set_dataset_id(request->dataset_id());
+  snapshot_update->set_num_chunks(num_chunks);
+  snapshot_update->set_run_id(random::New64());
+  TF_RETURN_IF_ERROR(Apply(update));
+  LOG(INFO) << "Started writing snapshot of dataset " << request->dataset_id()
+            << " to " << request->path() << " in " << num_chunks << " chunks";
+  return OkStatus();
+}
+
 Status DataServiceDispatcherImpl::PopulateTaskDef(
     std::shared_ptr<const Task> task, TaskDef* task_def) const
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -1030,6 +1348,12 @@ Status DataServiceDispatcherImpl::PopulateTaskDef(
   }
   task_def->set_use_cross_trainer_cache(
       task->iteration->job->use_cross_trainer_cache);
+  auto prefix_it = dataset_prefixes_.find(task->iteration->job->dataset_id);
+  if (prefix_it != dataset_prefixes_.end() &&
+      IsNoShard(task->iteration->job->processing_mode)) {
+    task_def->set_shared_prefix_node(prefix_it->second.node_name);
+    task_def->set_shared_prefix_fingerprint(prefix_it->second.fingerprint);
+  }
   std::shared_ptr<const Dataset> dataset;
   TF_RETURN_IF_ERROR(
       state_.DatasetFromId(task->iteration->job->dataset_id, dataset));
@@ -1124,6 +1448,7 @@ Status DataServiceDispatcherImpl::ReleaseMissingClients()
       release_client->set_iteration_client_id(client_id);
       release_client->set_time_micros(now);
       TF_RETURN_IF_ERROR(Apply(update));
+      auto_scaler_.RemoveClient(client_id);
     }
   }
   return OkStatus();
@@ -24,8 +24,10 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "tensorflow/core/data/service/auto_scaler.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/common.pb.h"
+#include "tensorflow/core/data/service/dataset_prefix.h"
 #include "tensorflow/core/data/service/dataset_store.h"
 #include "tensorflow/core/data/service/dispatcher.pb.h"
 #include "tensorflow/core/data/service/dispatcher_state.h"
@@ -174,6 +176,9 @@ class DataServiceDispatcherImpl {
                          ClientHeartbeatResponse* response);
   Status GetWorkers(const GetWorkersRequest* request,
                     GetWorkersResponse* response);
+  Status GetTargetWorkerCount(const GetTargetWorkerCountRequest* request,
+                              GetTargetWorkerCountResponse* response);
+  Status Snapshot(const SnapshotRequest* request, SnapshotResponse* response);
 
   // Exports the dispatcher state for debugging.
   DispatcherStateExport ExportState() const;
@@ -196,6 +201,10 @@ class DataServiceDispatcherImpl {
   Status RegisterDataset(uint64 fingerprint, const DatasetDef& dataset,
                          const DataServiceMetadata& metadata,
                          int64_t& dataset_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Records the shareable prefix of dataset `dataset_id`, logging the other
+  // datasets that share it.
+  void RecordDatasetPrefix(int64_t dataset_id, const DatasetPrefix& prefix)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Gets a worker's stub from `worker_stubs_`, or if none exists, creates a
   // stub and stores it in `worker_stubs_`. A borrowed pointer to the stub is
   // stored in `out_stub`.
@@ -231,6 +240,26 @@ class DataServiceDispatcherImpl {
       const absl::flat_hash_set<int64_t>& current_tasks,
       std::vector<std::shared_ptr<const DispatcherState::Task>>& assigned_tasks,
       WorkerHeartbeatResponse* response);
+  // Commits the snapshot chunks completed by a worker and assigns it the
+  // snapshot chunks it should be writing, updating the heartbeat response.
+  // Finished snapshots which should be finalized are added to
+  // `snapshots_to_finalize`.
+  Status UpdateSnapshotChunks(
+      const WorkerHeartbeatRequest& request, WorkerHeartbeatResponse* response,
+      std::vector<std::shared_ptr<const DispatcherState::Snapshot>>&
+          snapshots_to_finalize) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns true if `worker_address` hasn't heartbeated within
+  // `config_.worker_timeout_ms()`.
+  bool WorkerTimedOut(const std::string& worker_address) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Finalizes `snapshots`, which were claimed by `UpdateSnapshotChunks`.
+  void FinalizeSnapshots(
+      const std::vector<std::shared_ptr<const DispatcherState::Snapshot>>&
+          snapshots) TF_LOCKS_EXCLUDED(mu_);
+  // Moves the committed chunks of `snapshot` into place and writes its
+  // metadata, after which `Dataset.load` can read it.
+  Status FinalizeSnapshot(const DispatcherState::Snapshot& snapshot)
+      TF_LOCKS_EXCLUDED(mu_);
   // Acquires an iteration client id to read from the given iteration and sets
   // `iteration_client_id`.
   Status AcquireIterationClientId(
@@ -310,6 +339,8 @@ class DataServiceDispatcherImpl {
 
   const experimental::DispatcherConfig config_;
   Env* env_;
+  // Recommends worker counts based on worker and client heartbeats.
+  AutoScaler auto_scaler_;
 
   mutable mutex mu_;
   bool started_ TF_GUARDED_BY(mu_) = false;
@@ -330,9 +361,23 @@ class DataServiceDispatcherImpl {
   // Map from task id to a TaskRemover which determines when to remove the task.
   absl::flat_hash_map<int64_t, std::shared_ptr<TaskRemover>>
       remove_task_requests_ TF_GUARDED_BY(mu_);
+  // Shareable prefixes of registered datasets, keyed by dataset id. Only
+  // populated if `config_.share_dataset_prefixes()` is true.
+  absl::flat_hash_map<int64_t, DatasetPrefix> dataset_prefixes_
+      TF_GUARDED_BY(mu_);
+  // Ids of the datasets with each prefix, keyed by prefix fingerprint.
+  absl::flat_hash_map<uint64, absl::flat_hash_set<int64_t>>
+      prefix_dataset_ids_ TF_GUARDED_BY(mu_);
   // Map from client id to the time of the client's last heartbeat.
   absl::flat_hash_map<int64_t, absl::Time> latest_client_heartbeats_time_
       TF_GUARDED_BY(mu_);
+  // Map from worker address to the time of the worker's last heartbeat.
+  absl::flat_hash_map<std::string, absl::Time> latest_worker_heartbeats_time_
+      TF_GUARDED_BY(mu_);
+  // Paths of the snapshots which have been finalized, and of those being
+  // finalized outside of `mu_`.
+  absl::flat_hash_set<std::string> finalized_snapshots_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_set<std::string> finalizing_snapshots_ TF_GUARDED_BY(mu_);
 
   absl::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
@@ -82,6 +82,15 @@ Status DispatcherState::Apply(const Update& update) {
     case Update::kFinishTask:
       FinishTask(update.finish_task());
       break;
+    case Update::kSnapshot:
+      CreateSnapshot(update.snapshot());
+      break;
+    case Update::kAssignSnapshotChunk:
+      AssignSnapshotChunk(update.assign_snapshot_chunk());
+      break;
+    case Update::kCommitSnapshotChunk:
+      CommitSnapshotChunk(update.commit_snapshot_chunk());
+      break;
     case Update::UPDATE_TYPE_NOT_SET:
       return errors::Internal("Update type not set.");
   }
@@ -309,6 +318,39 @@ void DispatcherState::FinishTask(const FinishTaskUpdate& finish_task) {
   iterations_[task->iteration->iteration_id]->finished = all_finished;
 }
 
+void DispatcherState::CreateSnapshot(const SnapshotUpdate& snapshot) {
+  DCHECK(!snapshots_.contains(snapshot.path()));
+  snapshots_[snapshot.path()] = std::make_shared<Snapshot>(snapshot);
+}
+
+void DispatcherState::AssignSnapshotChunk(
+    const AssignSnapshotChunkUpdate& assign_snapshot_chunk) {
+  std::shared_ptr<Snapshot>& snapshot =
+      snapshots_[assign_snapshot_chunk.path()];
+  DCHECK(snapshot);
+  snapshot->chunk_workers[assign_snapshot_chunk.chunk_index()] =
+      assign_snapshot_chunk.worker_address();
+  ++snapshot->chunk_attempts[assign_snapshot_chunk.chunk_index()];
+}
+
+void DispatcherState::CommitSnapshotChunk(
+    const CommitSnapshotChunkUpdate& commit_snapshot_chunk) {
+  std::shared_ptr<Snapshot>& snapshot =
+      snapshots_[commit_snapshot_chunk.path()];
+  DCHECK(snapshot);
+  const int64_t chunk_index = commit_snapshot_chunk.chunk_index();
+  DCHECK(!snapshot->IsCommitted(chunk_index));
+  snapshot->committed_attempts[chunk_index] = commit_snapshot_chunk.attempt();
+  snapshot->chunk_num_elements[chunk_index] =
+      commit_snapshot_chunk.num_elements();
+  ++snapshot->num_committed_chunks;
+  if (snapshot->dtypes.empty()) {
+    for (int dtype : commit_snapshot_chunk.dtypes()) {
+      snapshot->dtypes.push_back(static_cast<DataType>(dtype));
+    }
+  }
+}
+
 int64_t DispatcherState::NextAvailableDatasetId() const {
   return next_available_dataset_id_;
 }
@@ -463,6 +505,26 @@ int64_t DispatcherState::NextAvailableTaskId() const {
   return next_available_task_id_;
 }
 
+Status DispatcherState::SnapshotFromPath(
+    const std::string& path, std::shared_ptr<const Snapshot>& snapshot) const {
+  auto it = snapshots_.find(path);
+  if (it == snapshots_.end()) {
+    return errors::NotFound("Snapshot at ", path, " not found");
+  }
+  snapshot = it->second;
+  return OkStatus();
+}
+
+std::vector<std::shared_ptr<const DispatcherState::Snapshot>>
+DispatcherState::ListSnapshots() const {
+  std::vector<std::shared_ptr<const Snapshot>> snapshots;
+  snapshots.reserve(snapshots_.size());
+  for (const auto& it : snapshots_) {
+    snapshots.push_back(it.second);
+  }
+  return snapshots;
+}
+
 Status DispatcherState::ValidateWorker(absl::string_view worker_address) const {
   return worker_index_resolver_.ValidateWorker(worker_address);
 }
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/journal.h"
 #include "tensorflow/core/data/service/journal.pb.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
 #include "tensorflow/core/protobuf/service_config.pb.h"
@@ -226,6 +227,44 @@ class DispatcherState {
 
   using TasksById = absl::flat_hash_map<int64_t, std::shared_ptr<Task>>;
 
+  // A snapshot of a dataset, written by the workers in disjoint chunks.
+  struct Snapshot {
+    explicit Snapshot(const SnapshotUpdate& snapshot)
+        : path(snapshot.path()),
+          dataset_id(snapshot.dataset_id()),
+          num_chunks(snapshot.num_chunks()),
+          run_id(snapshot.run_id()),
+          chunk_workers(snapshot.num_chunks()),
+          chunk_attempts(snapshot.num_chunks()),
+          committed_attempts(snapshot.num_chunks(), -1),
+          chunk_num_elements(snapshot.num_chunks(), -1) {}
+
+    bool IsCommitted(int64_t chunk_index) const {
+      return chunk_num_elements[chunk_index] >= 0;
+    }
+    bool finished() const { return num_committed_chunks == num_chunks; }
+
+    const std::string path;
+    const int64_t dataset_id;
+    const int64_t num_chunks;
+    const uint64 run_id;
+    // The worker writing each chunk, or the empty string if the chunk hasn't
+    // been assigned yet.
+    std::vector<std::string> chunk_workers;
+    // The number of times each chunk has been assigned. The latest assignment
+    // is attempt `chunk_attempts[i] - 1`.
+    std::vector<int64_t> chunk_attempts;
+    // The attempt committed for each chunk, or -1 if the chunk isn't committed
+    // yet.
+    std::vector<int64_t> committed_attempts;
+    // The number of elements in each committed chunk, or -1 if the chunk isn't
+    // committed yet.
+    std::vector<int64_t> chunk_num_elements;
+    int64_t num_committed_chunks = 0;
+    // The types of the components of the elements, set by the first commit.
+    DataTypeVector dtypes;
+  };
+
   // Returns the next available dataset id.
   int64_t NextAvailableDatasetId() const;
   // Gets a dataset by id. Returns NOT_FOUND if there is no such dataset.
@@ -285,6 +324,12 @@ class DispatcherState {
   Status TasksForWorker(const absl::string_view worker_address,
                         std::vector<std::shared_ptr<const Task>>& tasks) const;
 
+  // Gets a snapshot by path. Returns NOT_FOUND if there is no such snapshot.
+  Status SnapshotFromPath(const std::string& path,
+                          std::shared_ptr<const Snapshot>& snapshot) const;
+  // Returns a list of all snapshots.
+  std::vector<std::shared_ptr<const Snapshot>> ListSnapshots() const;
+
   // If the dispatcher config explicitly specifies a list of workers, validates
   // `worker_address` is in the list.
   Status ValidateWorker(absl::string_view worker_address) const;
@@ -311,6 +356,11 @@ class DispatcherState {
   void ClientHeartbeat(const ClientHeartbeatUpdate& client_heartbeat);
   void CreateTask(const CreateTaskUpdate& create_task);
   void FinishTask(const FinishTaskUpdate& finish_task);
+  void CreateSnapshot(const SnapshotUpdate& snapshot);
+  void AssignSnapshotChunk(
+      const AssignSnapshotChunkUpdate& assign_snapshot_chunk);
+  void CommitSnapshotChunk(
+      const CommitSnapshotChunkUpdate& commit_snapshot_chunk);
 
   int64_t next_available_dataset_id_ = 1000;
   // Registered datasets, keyed by dataset ids.
@@ -353,6 +403,8 @@ class DispatcherState {
   // Tasks, keyed by worker addresses. The values are a map from task id to
   // task.
   absl::flat_hash_map<std::string, TasksById> tasks_by_worker_;
+  // Snapshots, keyed by their paths.
+  absl::flat_hash_map<std::string, std::shared_ptr<Snapshot>> snapshots_;
 };
 
 }  // namespace data
@@ -41,6 +41,7 @@ using Job = DispatcherState::Job;
 using Iteration = DispatcherState::Iteration;
 using Task = DispatcherState::Task;
 using ::tensorflow::testing::StatusIs;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::IsEmpty;
 using ::testing::SizeIs;
@@ -139,6 +140,44 @@ Status FinishTask(int64_t task_id, DispatcherState& state) {
   TF_RETURN_IF_ERROR(state.Apply(update));
   return OkStatus();
 }
+
+Status CreateSnapshot(const std::string& path, int64_t dataset_id,
+                      int64_t num_chunks, DispatcherState& state) {
+  Update update;
+  SnapshotUpdate* snapshot = update.mutable_snapshot();
+  snapshot->set_path(path);
+  snapshot->set_dataset_id(dataset_id);
+  snapshot->set_num_chunks(num_chunks);
+  snapshot->set_run_id(7);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return OkStatus();
+}
+
+Status AssignSnapshotChunk(const std::string& path, int64_t chunk_index,
+                           const std::string& worker_address,
+                           DispatcherState& state) {
+  Update update;
+  AssignSnapshotChunkUpdate* assign = update.mutable_assign_snapshot_chunk();
+  assign->set_path(path);
+  assign->set_chunk_index(chunk_index);
+  assign->set_worker_address(worker_address);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return OkStatus();
+}
+
+Status CommitSnapshotChunk(const std::string& path, int64_t chunk_index,
+                           int64_t attempt, int64_t num_elements,
+                           DispatcherState& state) {
+  Update update;
+  CommitSnapshotChunkUpdate* commit = update.mutable_commit_snapshot_chunk();
+  commit->set_path(path);
+  commit->set_chunk_index(chunk_index);
+  commit->set_attempt(attempt);
+  commit->set_num_elements(num_elements);
+  commit->add_dtypes(DT_INT64);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return OkStatus();
+}
 }  // namespace
 
 TEST(DispatcherState, RegisterDataset) {
@@ -632,5 +671,48 @@ TEST(DispatcherState, ListActiveClients) {
   EXPECT_THAT(state.ListActiveClientIds(), UnorderedElementsAre(6, 8));
 }
 
+TEST(DispatcherState, Snapshot) {
+  const std::string path = "/snapshot";
+  DispatcherState state;
+  TF_EXPECT_OK(RegisterDataset(/*id=*/10, state));
+  TF_EXPECT_OK(CreateSnapshot(path, /*dataset_id=*/10, /*num_chunks=*/2,
+                              state));
+  std::shared_ptr<const DispatcherState::Snapshot> snapshot;
+  TF_EXPECT_OK(state.SnapshotFromPath(path, snapshot));
+  EXPECT_EQ(snapshot->dataset_id, 10);
+  EXPECT_EQ(snapshot->run_id, 7);
+  EXPECT_THAT(snapshot->chunk_workers, ElementsAre("", ""));
+  EXPECT_FALSE(snapshot->finished());
+  EXPECT_THAT(state.ListSnapshots(), SizeIs(1));
+
+  // Chunk 0 is reassigned after its first worker fails.
+  TF_EXPECT_OK(AssignSnapshotChunk(path, 0, "worker_a", state));
+  TF_EXPECT_OK(AssignSnapshotChunk(path, 1, "worker_b", state));
+  TF_EXPECT_OK(AssignSnapshotChunk(path, 0, "worker_c", state));
+  EXPECT_THAT(snapshot->chunk_workers, ElementsAre("worker_c", "worker_b"));
+  EXPECT_THAT(snapshot->chunk_attempts, ElementsAre(2, 1));
+
+  TF_EXPECT_OK(CommitSnapshotChunk(path, 1, /*attempt=*/0, /*num_elements=*/5,
+                                   state));
+  EXPECT_TRUE(snapshot->IsCommitted(1));
+  EXPECT_FALSE(snapshot->IsCommitted(0));
+  EXPECT_FALSE(snapshot->finished());
+  // The first attempt of chunk 0 finished before the second one.
+  TF_EXPECT_OK(CommitSnapshotChunk(path, 0, /*attempt=*/0, /*num_elements=*/6,
+                                   state));
+  EXPECT_TRUE(snapshot->finished());
+  EXPECT_THAT(snapshot->committed_attempts, ElementsAre(0, 0));
+  EXPECT_THAT(snapshot->chunk_num_elements, ElementsAre(6, 5));
+  EXPECT_THAT(snapshot->dtypes, ElementsAre(DT_INT64));
+}
+
+TEST(DispatcherState, MissingSnapshot) {
+  DispatcherState state;
+  std::shared_ptr<const DispatcherState::Snapshot> snapshot;
+  EXPECT_THAT(state.SnapshotFromPath("/snapshot", snapshot),
+              StatusIs(error::NOT_FOUND));
+  EXPECT_THAT(state.ListSnapshots(), IsEmpty());
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -61,6 +61,8 @@ HANDLER(GetOrCreateJob);
 HANDLER(GetOrCreateIteration);
 HANDLER(ClientHeartbeat);
 HANDLER(GetWorkers);
+HANDLER(GetTargetWorkerCount);
+HANDLER(Snapshot);
 HANDLER(GetDataServiceMetadata);
 HANDLER(GetDataServiceConfig);
 #undef HANDLER
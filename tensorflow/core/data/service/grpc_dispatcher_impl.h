@@ -56,6 +56,8 @@ class GrpcDispatcherImpl : public DispatcherService::Service {
   HANDLER(GetOrCreateIteration);
   HANDLER(ClientHeartbeat);
   HANDLER(GetWorkers);
+  HANDLER(GetTargetWorkerCount);
+  HANDLER(Snapshot);
   HANDLER(GetDataServiceMetadata);
   HANDLER(GetDataServiceConfig);
 #undef HANDLER
@@ -66,6 +66,7 @@ WorkerStateExport GrpcWorkerImpl::ExportState() const {
 HANDLER(ProcessTask);
 HANDLER(GetElement);
 HANDLER(GetWorkerTasks);
+HANDLER(GetPipelineDiagnostics);
 #undef HANDLER
 
 }  // namespace data
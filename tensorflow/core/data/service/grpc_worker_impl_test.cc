@@ -114,6 +114,15 @@ TEST_F(GrpcWorkerImplTest, GetWorkerTasks) {
   EXPECT_EQ(resp.tasks_size(), 0);
 }
 
+TEST_F(GrpcWorkerImplTest, GetPipelineDiagnosticsOfUnknownTask) {
+  ClientContext ctx;
+  GetPipelineDiagnosticsRequest req;
+  req.set_task_id(1);
+  GetPipelineDiagnosticsResponse resp;
+  EXPECT_TRUE(errors::IsNotFound(FromGrpcStatus(
+      worker_client_stub_->GetPipelineDiagnostics(&ctx, req, &resp))));
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
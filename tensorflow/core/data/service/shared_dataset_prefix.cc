@@ -0,0 +1,217 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shared_dataset_prefix.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/cross_trainer_cache.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/dataset_prefix.h"
+#include "tensorflow/core/data/service/task_runner.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kReaderDatasetType[] = "SharedDatasetPrefixReader";
+
+// A dataset reading the elements of a `SharedDatasetPrefix`.
+class ReaderDataset : public DatasetBase {
+ public:
+  explicit ReaderDataset(std::shared_ptr<SharedDatasetPrefix> prefix)
+      : DatasetBase(DatasetContext({kReaderDatasetType, kReaderDatasetType})),
+        prefix_(std::move(prefix)) {}
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, absl::StrCat(prefix, "::", kReaderDatasetType)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return prefix_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return prefix_->output_shapes();
+  }
+
+  string DebugString() const override { return kReaderDatasetType; }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->clear();
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return errors::FailedPrecondition(
+        DebugString(), " reads from a dataset prefix shared between tasks.");
+  }
+
+ protected:
+  // Graph rewrites serialize the dataset as a placeholder.
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    return errors::Unimplemented(DebugString(), " does not support ",
+                                 "serialization.");
+  }
+
+ private:
+  class Iterator : public DatasetIterator<ReaderDataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<ReaderDataset>(params),
+          consumer_id_(absl::StrCat("consumer_", random::New64())) {}
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      return dataset()->prefix_->GetNext(consumer_id_, *out_tensors,
+                                         *end_of_sequence);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      return errors::Unimplemented(dataset()->DebugString(),
+                                   " does not support checkpointing.");
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      return errors::Unimplemented(dataset()->DebugString(),
+                                   " does not support checkpointing.");
+    }
+
+   private:
+    const std::string consumer_id_;
+  };
+
+  const std::shared_ptr<SharedDatasetPrefix> prefix_;
+};
+
+}  // namespace
+
+StatusOr<std::shared_ptr<SharedDatasetPrefix>> SharedDatasetPrefix::Create(
+    const experimental::WorkerConfig& worker_config,
+    const GraphDef& prefix_graph) {
+  std::unique_ptr<standalone::Dataset> dataset;
+  TF_RETURN_IF_ERROR(standalone::Dataset::FromGraph(
+      standalone::Dataset::Params(), prefix_graph, &dataset));
+  // The cache neither tracks the end of its input nor replays evicted
+  // elements, so a finite prefix could end before, or in the middle of, a
+  // consumer's epoch.
+  const int64_t cardinality = dataset->Get()->Cardinality();
+  if (cardinality != kInfiniteCardinality) {
+    return errors::FailedPrecondition(
+        "Only infinite dataset prefixes can be shared between tasks; got a "
+        "prefix with cardinality ",
+        cardinality, ".");
+  }
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+  const DataTypeVector output_dtypes = dataset->Get()->output_dtypes();
+  const std::vector<PartialTensorShape> output_shapes =
+      dataset->Get()->output_shapes();
+
+  CrossTrainerCacheConfig cache_config =
+      GetCrossTrainerCacheConfig(worker_config);
+  cache_config.eviction_policy =
+      CrossTrainerCacheEvictionPolicy::kSlowestConsumer;
+  auto task_runner = std::make_unique<CachingTaskRunner>(
+      std::make_unique<StandaloneTaskIterator>(std::move(dataset),
+                                               std::move(iterator)),
+      cache_config);
+  return std::shared_ptr<SharedDatasetPrefix>(new SharedDatasetPrefix(
+      output_dtypes, output_shapes, std::move(task_runner)));
+}
+
+StatusOr<Tensor> SharedDatasetPrefix::MakeReaderDataset(
+    std::shared_ptr<SharedDatasetPrefix> prefix) {
+  Tensor dataset(DT_VARIANT, TensorShape({}));
+  TF_RETURN_IF_ERROR(StoreDatasetInVariantTensor(
+      new ReaderDataset(std::move(prefix)), &dataset));
+  return dataset;
+}
+
+SharedDatasetPrefix::SharedDatasetPrefix(
+    const DataTypeVector& output_dtypes,
+    const std::vector<PartialTensorShape>& output_shapes,
+    std::unique_ptr<CachingTaskRunner> task_runner)
+    : output_dtypes_(output_dtypes),
+      output_shapes_(output_shapes),
+      task_runner_(std::move(task_runner)) {}
+
+Status SharedDatasetPrefix::GetNext(const std::string& consumer_id,
+                                    std::vector<Tensor>& element,
+                                    bool& end_of_sequence) {
+  GetElementRequest request;
+  request.set_trainer_id(consumer_id);
+  GetElementResult result;
+  TF_RETURN_IF_ERROR(task_runner_->GetNext(request, result));
+  element = std::move(result.components);
+  end_of_sequence = result.end_of_sequence;
+  return OkStatus();
+}
+
+SharedDatasetPrefixRegistry::SharedDatasetPrefixRegistry(
+    const experimental::WorkerConfig& worker_config)
+    : worker_config_(worker_config) {}
+
+StatusOr<std::shared_ptr<SharedDatasetPrefix>>
+SharedDatasetPrefixRegistry::GetOrCreate(uint64 fingerprint,
+                                         const GraphDef& graph,
+                                         const std::string& prefix_node) {
+  mutex_lock l(mu_);
+  for (auto it = prefixes_.begin(); it != prefixes_.end();) {
+    if (it->second.expired()) {
+      prefixes_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  std::shared_ptr<SharedDatasetPrefix> prefix = prefixes_[fingerprint].lock();
+  if (prefix != nullptr) {
+    return prefix;
+  }
+  TF_ASSIGN_OR_RETURN(GraphDef prefix_graph,
+                      MakePrefixGraph(graph, prefix_node));
+  TF_ASSIGN_OR_RETURN(
+      prefix, SharedDatasetPrefix::Create(worker_config_, prefix_graph));
+  prefixes_[fingerprint] = prefix;
+  return prefix;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,106 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHARED_DATASET_PREFIX_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHARED_DATASET_PREFIX_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/service/task_runner.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+
+// A dataset prefix produced once on a worker and shared by the tasks of all
+// datasets which start with it.
+//
+// Each consumer reads every element produced after it starts reading, or that
+// is still cached when it starts. Elements are cached in a `CrossTrainerCache`
+// with the slowest-consumer eviction policy, so fast consumers do not evict
+// elements that slower consumers have yet to read. A consumer which stops
+// reading for longer than the cache's consumer timeout no longer holds back
+// the others. Only infinite prefixes (e.g. ending in `repeat()`) can be
+// shared.
+class SharedDatasetPrefix {
+ public:
+  // Creates a shared prefix producing the dataset of `prefix_graph`, with the
+  // cache configured by `worker_config`. Returns FailedPrecondition if the
+  // dataset is not infinite.
+  static StatusOr<std::shared_ptr<SharedDatasetPrefix>> Create(
+      const experimental::WorkerConfig& worker_config,
+      const GraphDef& prefix_graph);
+
+  // Makes a DT_VARIANT scalar holding a dataset that reads from `prefix`.
+  // Every iterator of the dataset is a separate consumer of the prefix.
+  static StatusOr<Tensor> MakeReaderDataset(
+      std::shared_ptr<SharedDatasetPrefix> prefix);
+
+  // Gets the next element for consumer `consumer_id`, blocking until the
+  // element is available.
+  Status GetNext(const std::string& consumer_id, std::vector<Tensor>& element,
+                 bool& end_of_sequence);
+
+  const DataTypeVector& output_dtypes() const { return output_dtypes_; }
+  const std::vector<PartialTensorShape>& output_shapes() const {
+    return output_shapes_;
+  }
+
+ private:
+  SharedDatasetPrefix(const DataTypeVector& output_dtypes,
+                      const std::vector<PartialTensorShape>& output_shapes,
+                      std::unique_ptr<CachingTaskRunner> task_runner);
+
+  const DataTypeVector output_dtypes_;
+  const std::vector<PartialTensorShape> output_shapes_;
+  const std::unique_ptr<CachingTaskRunner> task_runner_;
+};
+
+// The shared dataset prefixes of a worker, keyed by prefix fingerprint. A
+// prefix is deleted once no task reads from it.
+class SharedDatasetPrefixRegistry {
+ public:
+  explicit SharedDatasetPrefixRegistry(
+      const experimental::WorkerConfig& worker_config);
+
+  // Returns the shared prefix with fingerprint `fingerprint`. If no task
+  // currently reads from it, creates it from the subgraph of `graph` rooted at
+  // `prefix_node`.
+  StatusOr<std::shared_ptr<SharedDatasetPrefix>> GetOrCreate(
+      uint64 fingerprint, const GraphDef& graph,
+      const std::string& prefix_node);
+
+ private:
+  const experimental::WorkerConfig worker_config_;
+
+  mutex mu_;
+  absl::flat_hash_map<uint64, std::weak_ptr<SharedDatasetPrefix>> prefixes_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHARED_DATASET_PREFIX_H_
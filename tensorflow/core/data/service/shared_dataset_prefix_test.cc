@@ -0,0 +1,161 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shared_dataset_prefix.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/data/service/test_util.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::data::testing::RangeSquareDataset;
+using ::tensorflow::test::AsScalar;
+using ::tensorflow::test::function::NDef;
+using ::tensorflow::testing::IsOkAndHolds;
+using ::tensorflow::testing::StatusIs;
+using ::testing::ElementsAre;
+
+// Returns the graph of
+// `range(range).map(lambda x: x*x).repeat(repeat_count).take(count)`. The
+// shareable prefix is the "repeat" node.
+GraphDef RangeSquareTakeGraph(int64_t range, int64_t count,
+                              int64_t repeat_count = -1) {
+  GraphDef graph = RangeSquareDataset(range).graph();
+  *graph.add_node() = NDef(
+      "repeat_count", "Const", /*inputs=*/{},
+      {{"value", AsScalar<int64_t>(repeat_count)}, {"dtype", DT_INT64}});
+  *graph.add_node() =
+      NDef("repeat", "RepeatDataset", /*inputs=*/{"map", "repeat_count"},
+           {{"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape()}},
+            {"output_types", gtl::ArraySlice<DataType>{DT_INT64}}});
+  *graph.add_node() =
+      NDef("count", "Const", /*inputs=*/{},
+           {{"value", AsScalar<int64_t>(count)}, {"dtype", DT_INT64}});
+  *graph.add_node() =
+      NDef("take", "TakeDataset", /*inputs=*/{"repeat", "count"},
+           {{"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape()}},
+            {"output_types", gtl::ArraySlice<DataType>{DT_INT64}}});
+  for (NodeDef& node : *graph.mutable_node()) {
+    if (node.op() == "_Retval") {
+      node.set_input(0, "take");
+    }
+  }
+  return graph;
+}
+
+// Reads the dataset of `graph` with its "repeat" prefix read from `prefix`.
+StatusOr<std::vector<int64_t>> ReadWithPrefix(
+    const GraphDef& graph, std::shared_ptr<SharedDatasetPrefix> prefix) {
+  TF_ASSIGN_OR_RETURN(Tensor reader,
+                      SharedDatasetPrefix::MakeReaderDataset(prefix));
+  std::unique_ptr<standalone::Dataset> dataset;
+  TF_RETURN_IF_ERROR(standalone::Dataset::FromGraph(
+      standalone::Dataset::Params(), graph, {{"repeat:0", reader}}, &dataset));
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+  std::vector<int64_t> result;
+  while (true) {
+    std::vector<Tensor> element;
+    bool end_of_sequence = false;
+    TF_RETURN_IF_ERROR(iterator->GetNext(&element, &end_of_sequence));
+    if (end_of_sequence) {
+      return result;
+    }
+    result.push_back(element[0].scalar<int64_t>()());
+  }
+}
+
+TEST(SharedDatasetPrefixTest, SuffixesReadSharedPrefix) {
+  const GraphDef take3 = RangeSquareTakeGraph(/*range=*/10, /*count=*/3);
+  const GraphDef take5 = RangeSquareTakeGraph(/*range=*/10, /*count=*/5);
+  SharedDatasetPrefixRegistry registry{experimental::WorkerConfig()};
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<SharedDatasetPrefix> prefix,
+                          registry.GetOrCreate(/*fingerprint=*/1, take3,
+                                               "repeat"));
+  EXPECT_EQ(prefix->output_dtypes(), DataTypeVector{DT_INT64});
+
+  // Elements read by the first suffix are still cached for the second one.
+  EXPECT_THAT(ReadWithPrefix(take3, prefix),
+              IsOkAndHolds(ElementsAre(0, 1, 4)));
+  EXPECT_THAT(ReadWithPrefix(take5, prefix),
+              IsOkAndHolds(ElementsAre(0, 1, 4, 9, 16)));
+}
+
+TEST(SharedDatasetPrefixTest, RegistrySharesPrefixesByFingerprint) {
+  const GraphDef graph = RangeSquareTakeGraph(/*range=*/10, /*count=*/3);
+  SharedDatasetPrefixRegistry registry{experimental::WorkerConfig()};
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<SharedDatasetPrefix> first,
+                          registry.GetOrCreate(/*fingerprint=*/1, graph,
+                                               "repeat"));
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<SharedDatasetPrefix> same,
+                          registry.GetOrCreate(/*fingerprint=*/1, graph,
+                                               "repeat"));
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<SharedDatasetPrefix> other,
+                          registry.GetOrCreate(/*fingerprint=*/2, graph,
+                                               "repeat"));
+  EXPECT_EQ(first, same);
+  EXPECT_NE(first, other);
+
+  // Once no task reads from a prefix, it is created anew.
+  other.reset();
+  TF_ASSERT_OK_AND_ASSIGN(other,
+                          registry.GetOrCreate(/*fingerprint=*/2, graph,
+                                               "repeat"));
+  EXPECT_NE(other, nullptr);
+}
+
+TEST(SharedDatasetPrefixTest, FinitePrefixIsNotShared) {
+  SharedDatasetPrefixRegistry registry{experimental::WorkerConfig()};
+  EXPECT_THAT(registry.GetOrCreate(
+                  /*fingerprint=*/1,
+                  RangeSquareTakeGraph(/*range=*/10, /*count=*/3,
+                                       /*repeat_count=*/2),
+                  "repeat"),
+              StatusIs(error::FAILED_PRECONDITION));
+  EXPECT_THAT(registry.GetOrCreate(/*fingerprint=*/2,
+                                   RangeSquareTakeGraph(/*range=*/10, 3),
+                                   "map"),
+              StatusIs(error::FAILED_PRECONDITION));
+}
+
+TEST(SharedDatasetPrefixTest, UnknownPrefixNode) {
+  SharedDatasetPrefixRegistry registry{experimental::WorkerConfig()};
+  EXPECT_FALSE(registry
+                   .GetOrCreate(/*fingerprint=*/1,
+                                RangeSquareTakeGraph(/*range=*/10, 3),
+                                "unknown")
+                   .ok());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,280 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shared_memory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/url.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/platform.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/types.h"
+
+#if defined(PLATFORM_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif  // PLATFORM_POSIX
+
+namespace tensorflow {
+namespace data {
+
+#if defined(PLATFORM_POSIX)
+
+namespace {
+
+Status ErrnoError(absl::string_view what, absl::string_view name) {
+  return errors::Internal(what, " shared memory segment ", name,
+                          " failed: ", strerror(errno));
+}
+
+StatusOr<char*> Map(int fd, absl::string_view name, size_t size) {
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    return ErrnoError("Mapping", name);
+  }
+  return static_cast<char*>(data);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Create(
+    size_t size) {
+  if (size == 0) {
+    return errors::InvalidArgument(
+        "Shared memory segments must not be empty.");
+  }
+  const std::string name =
+      absl::StrCat("/tf_data_", getpid(), "_", random::New64());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return ErrnoError("Creating", name);
+  }
+  if (ftruncate(fd, size) != 0) {
+    Status s = ErrnoError("Resizing", name);
+    close(fd);
+    shm_unlink(name.c_str());
+    return s;
+  }
+  StatusOr<char*> data = Map(fd, name, size);
+  close(fd);
+  if (!data.ok()) {
+    shm_unlink(name.c_str());
+    return data.status();
+  }
+  return absl::WrapUnique(
+      new SharedMemorySegment(name, *data, size, /*owner=*/true));
+}
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Open(
+    absl::string_view name, size_t size) {
+  const std::string name_str(name);
+  int fd = shm_open(name_str.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return ErrnoError("Opening", name);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    Status s = ErrnoError("Inspecting", name);
+    close(fd);
+    return s;
+  }
+  if (static_cast<size_t>(st.st_size) < size) {
+    close(fd);
+    return errors::FailedPrecondition("Shared memory segment ", name, " has ",
+                                      st.st_size, " bytes, expected at least ",
+                                      size);
+  }
+  StatusOr<char*> data = Map(fd, name, size);
+  close(fd);
+  TF_RETURN_IF_ERROR(data.status());
+  return absl::WrapUnique(
+      new SharedMemorySegment(name_str, *data, size, /*owner=*/false));
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+  munmap(data_, size_);
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+#else  // PLATFORM_POSIX
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Create(
+    size_t size) {
+  return errors::Unimplemented(
+      "Shared memory segments are only supported on POSIX platforms.");
+}
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Open(
+    absl::string_view name, size_t size) {
+  return errors::Unimplemented(
+      "Shared memory segments are only supported on POSIX platforms.");
+}
+
+SharedMemorySegment::~SharedMemorySegment() {}
+
+#endif  // PLATFORM_POSIX
+
+namespace {
+
+// Segments are at least this large, and sized in powers of two, so that they
+// can be reused for elements of similar sizes.
+constexpr size_t kMinSegmentBytes = 1 << 20;  // 1MB.
+
+size_t SegmentSize(size_t size) {
+  size_t segment_size = kMinSegmentBytes;
+  while (segment_size < size) {
+    segment_size *= 2;
+  }
+  return segment_size;
+}
+
+}  // namespace
+
+SharedMemoryPool::SharedMemoryPool(size_t max_bytes,
+                                   int64_t abandon_after_micros)
+    : max_bytes_(max_bytes), abandon_after_micros_(abandon_after_micros) {}
+
+template <typename Predicate>
+SharedMemoryPool::Entry* SharedMemoryPool::FindSmallest(size_t size,
+                                                        Predicate available) {
+  Entry* smallest = nullptr;
+  for (auto& [name, entry] : segments_) {
+    if (entry.segment->size() >= size && available(entry) &&
+        (smallest == nullptr ||
+         entry.segment->size() < smallest->segment->size())) {
+      smallest = &entry;
+    }
+  }
+  return smallest;
+}
+
+bool SharedMemoryPool::MakeRoom(size_t size) {
+  if (size > max_bytes_) {
+    return false;
+  }
+  size_t free_bytes = 0;
+  for (const auto& [name, entry] : segments_) {
+    if (!entry.in_use && entry.segment->size() < size) {
+      free_bytes += entry.segment->size();
+    }
+  }
+  if (total_bytes_ - free_bytes + size > max_bytes_) {
+    return false;
+  }
+  for (auto it = segments_.begin(); it != segments_.end();) {
+    if (total_bytes_ + size <= max_bytes_) {
+      break;
+    }
+    if (!it->second.in_use && it->second.segment->size() < size) {
+      total_bytes_ -= it->second.segment->size();
+      segments_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return true;
+}
+
+StatusOr<SharedMemorySegment*> SharedMemoryPool::Acquire(size_t size) {
+  const int64_t now_micros = Env::Default()->NowMicros();
+  mutex_lock l(mu_);
+  Entry* entry = FindSmallest(
+      size, [](const Entry& entry) { return !entry.in_use; });
+  if (entry == nullptr) {
+    const size_t segment_size = SegmentSize(size);
+    if (MakeRoom(segment_size)) {
+      TF_ASSIGN_OR_RETURN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(segment_size));
+      total_bytes_ += segment_size;
+      std::string name = segment->name();
+      entry = &segments_[name];
+      entry->segment = std::move(segment);
+    }
+  }
+  if (entry == nullptr) {
+    entry = FindSmallest(size, [&](const Entry& entry) {
+      return now_micros - entry.acquired_micros > abandon_after_micros_;
+    });
+    if (entry != nullptr) {
+      VLOG(1) << "Reusing shared memory segment " << entry->segment->name()
+              << ", which was not released in "
+              << abandon_after_micros_ / 1000000 << " seconds.";
+    }
+  }
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  entry->in_use = true;
+  entry->acquired_micros = now_micros;
+  return entry->segment.get();
+}
+
+void SharedMemoryPool::Release(absl::string_view name) {
+  mutex_lock l(mu_);
+  auto it = segments_.find(name);
+  if (it != segments_.end()) {
+    it->second.in_use = false;
+  }
+}
+
+Status SharedMemoryPool::ReadAndRelease(absl::string_view name, size_t size,
+                                        std::string& out) {
+  mutex_lock l(mu_);
+  auto it = segments_.find(name);
+  if (it == segments_.end() || !it->second.in_use) {
+    return errors::NotFound("Shared memory segment ", name,
+                            " is not in use.");
+  }
+  const SharedMemorySegment& segment = *it->second.segment;
+  if (size > segment.size()) {
+    return errors::InvalidArgument("Shared memory segment ", name, " has ",
+                                   segment.size(), " bytes, but ", size,
+                                   " bytes were requested.");
+  }
+  out.assign(segment.data(), size);
+  it->second.in_use = false;
+  return OkStatus();
+}
+
+size_t SharedMemoryPool::TotalBytes() const {
+  mutex_lock l(mu_);
+  return total_bytes_;
+}
+
+bool IsLocalAddress(absl::string_view address) {
+  URL url(address);
+  return url.host() == "localhost" || url.host() == "127.0.0.1" ||
+         url.host() == "[::1]" || url.host() == port::Hostname();
+}
+
+}  // namespace data
+}  // namespace tensorflow
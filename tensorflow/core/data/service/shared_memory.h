@@ -0,0 +1,139 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// A named POSIX shared memory segment mapped into this process.
+//
+// tf.data service workers create segments and write elements into them for
+// clients on the same host, which open them by name. The element bytes then
+// never go through the RPC channel.
+//
+// The process that creates a segment owns it: the name is unlinked when the
+// owning `SharedMemorySegment` is destroyed. Segments opened by name only unmap
+// their view of it.
+class SharedMemorySegment {
+ public:
+  // Creates a new segment of `size` bytes with a unique name.
+  static StatusOr<std::unique_ptr<SharedMemorySegment>> Create(size_t size);
+
+  // Opens the existing segment called `name`, which must hold at least `size`
+  // bytes.
+  static StatusOr<std::unique_ptr<SharedMemorySegment>> Open(
+      absl::string_view name, size_t size);
+
+  ~SharedMemorySegment();
+  SharedMemorySegment(const SharedMemorySegment&) = delete;
+  SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+
+  const std::string& name() const { return name_; }
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  SharedMemorySegment(std::string name, char* data, size_t size, bool owner)
+      : name_(std::move(name)), data_(data), size_(size), owner_(owner) {}
+
+  const std::string name_;
+  char* const data_;
+  const size_t size_;
+  const bool owner_;
+};
+
+// The shared memory segments of a tf.data service worker.
+//
+// The worker acquires a segment for each element it sends through shared
+// memory and sends the segment's name to the client. The segment stays in use
+// until the client releases it in a later request, after which it is reused
+// for other elements. Only the worker creates segments, so clients cannot make
+// it open segments of their choosing.
+//
+// Thread-safe.
+class SharedMemoryPool {
+ public:
+  // `max_bytes` bounds the total size of the segments. Segments that are not
+  // released within `abandon_after_micros` are assumed to belong to clients
+  // that went away, and are reused when the pool is full.
+  SharedMemoryPool(size_t max_bytes, int64_t abandon_after_micros);
+  SharedMemoryPool(const SharedMemoryPool&) = delete;
+  SharedMemoryPool& operator=(const SharedMemoryPool&) = delete;
+
+  // Returns a segment of at least `size` bytes, which is in use until it is
+  // released. Returns nullptr if the pool is full.
+  StatusOr<SharedMemorySegment*> Acquire(size_t size) TF_LOCKS_EXCLUDED(mu_);
+
+  // Releases the segment called `name`. Names that do not refer to a segment
+  // in use are ignored, so that clients may release a segment more than once.
+  void Release(absl::string_view name) TF_LOCKS_EXCLUDED(mu_);
+
+  // Copies the first `size` bytes of the segment called `name` into `out` and
+  // releases the segment. Used for clients that cannot open the segment.
+  Status ReadAndRelease(absl::string_view name, size_t size, std::string& out)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the total size of the segments.
+  size_t TotalBytes() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Entry {
+    std::unique_ptr<SharedMemorySegment> segment;
+    bool in_use = false;
+    // When the segment was last acquired.
+    int64_t acquired_micros = 0;
+  };
+
+  // Returns the smallest segment of at least `size` bytes for which
+  // `available` returns true, or nullptr if there is none.
+  template <typename Predicate>
+  Entry* FindSmallest(size_t size, Predicate available)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Destroys free segments that are smaller than `size` bytes until a new
+  // segment of `size` bytes fits in `max_bytes_`. Returns false if it does
+  // not fit even then.
+  bool MakeRoom(size_t size) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t max_bytes_;
+  const int64_t abandon_after_micros_;
+
+  mutable mutex mu_;
+  // Segments, keyed by name.
+  absl::flat_hash_map<std::string, Entry> segments_ TF_GUARDED_BY(mu_);
+  size_t total_bytes_ TF_GUARDED_BY(mu_) = 0;
+};
+
+// Returns true if `address` refers to a server on the local host, in which
+// case the tf.data service can pass elements through shared memory.
+bool IsLocalAddress(absl::string_view address);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHARED_MEMORY_H_
@@ -0,0 +1,182 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shared_memory.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(SharedMemorySegmentTest, WriteAndRead) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(1024));
+  EXPECT_EQ(segment->size(), 1024);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> opened,
+                          SharedMemorySegment::Open(segment->name(), 512));
+  EXPECT_EQ(opened->size(), 512);
+
+  const std::string data = "element";
+  memcpy(opened->data(), data.data(), data.size());
+  EXPECT_EQ(std::string(segment->data(), data.size()), data);
+}
+
+TEST(SharedMemorySegmentTest, UniqueNames) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment1,
+                          SharedMemorySegment::Create(16));
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment2,
+                          SharedMemorySegment::Create(16));
+  EXPECT_NE(segment1->name(), segment2->name());
+}
+
+TEST(SharedMemorySegmentTest, OpenTooLarge) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(16));
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      SharedMemorySegment::Open(segment->name(), 17).status()));
+}
+
+TEST(SharedMemorySegmentTest, UnlinkedWhenOwnerIsDestroyed) {
+  std::string name;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                            SharedMemorySegment::Create(16));
+    name = segment->name();
+  }
+  EXPECT_FALSE(SharedMemorySegment::Open(name, 16).ok());
+}
+
+TEST(SharedMemorySegmentTest, EmptySegment) {
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(SharedMemorySegment::Create(0).status()));
+}
+
+constexpr size_t kMB = 1 << 20;
+
+TEST(SharedMemoryPoolTest, ReusesReleasedSegments) {
+  SharedMemoryPool pool(/*max_bytes=*/16 * kMB,
+                        /*abandon_after_micros=*/60 * 1000 * 1000);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment, pool.Acquire(100));
+  ASSERT_NE(segment, nullptr);
+  EXPECT_EQ(segment->size(), kMB);
+  const std::string name = segment->name();
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * other, pool.Acquire(100));
+  ASSERT_NE(other, nullptr);
+  EXPECT_NE(other->name(), name);
+
+  pool.Release(name);
+  // Releasing twice, or releasing an unknown name, is a no-op.
+  pool.Release(name);
+  pool.Release("/unknown");
+  TF_ASSERT_OK_AND_ASSIGN(segment, pool.Acquire(kMB));
+  ASSERT_NE(segment, nullptr);
+  EXPECT_EQ(segment->name(), name);
+  EXPECT_EQ(pool.TotalBytes(), 2 * kMB);
+}
+
+TEST(SharedMemoryPoolTest, SegmentsOpenByName) {
+  SharedMemoryPool pool(/*max_bytes=*/16 * kMB,
+                        /*abandon_after_micros=*/60 * 1000 * 1000);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment,
+                          pool.Acquire(3 * kMB));
+  ASSERT_NE(segment, nullptr);
+  EXPECT_EQ(segment->size(), 4 * kMB);
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SharedMemorySegment> opened,
+      SharedMemorySegment::Open(segment->name(), segment->size()));
+  const std::string data = "element";
+  memcpy(segment->data(), data.data(), data.size());
+  EXPECT_EQ(std::string(opened->data(), data.size()), data);
+}
+
+TEST(SharedMemoryPoolTest, ReturnsNullptrWhenFull) {
+  SharedMemoryPool pool(/*max_bytes=*/2 * kMB,
+                        /*abandon_after_micros=*/60 * 1000 * 1000);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment, pool.Acquire(kMB));
+  ASSERT_NE(segment, nullptr);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * other, pool.Acquire(kMB));
+  ASSERT_NE(other, nullptr);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * full, pool.Acquire(kMB));
+  EXPECT_EQ(full, nullptr);
+  TF_ASSERT_OK_AND_ASSIGN(full, pool.Acquire(4 * kMB));
+  EXPECT_EQ(full, nullptr);
+}
+
+TEST(SharedMemoryPoolTest, ReplacesSmallFreeSegments) {
+  SharedMemoryPool pool(/*max_bytes=*/2 * kMB,
+                        /*abandon_after_micros=*/60 * 1000 * 1000);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment, pool.Acquire(kMB));
+  ASSERT_NE(segment, nullptr);
+  pool.Release(segment->name());
+  TF_ASSERT_OK_AND_ASSIGN(segment, pool.Acquire(2 * kMB));
+  ASSERT_NE(segment, nullptr);
+  EXPECT_EQ(segment->size(), 2 * kMB);
+  EXPECT_EQ(pool.TotalBytes(), 2 * kMB);
+}
+
+TEST(SharedMemoryPoolTest, ReusesAbandonedSegments) {
+  SharedMemoryPool pool(/*max_bytes=*/kMB, /*abandon_after_micros=*/0);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment, pool.Acquire(kMB));
+  ASSERT_NE(segment, nullptr);
+  const std::string name = segment->name();
+  Env::Default()->SleepForMicroseconds(1000);
+  TF_ASSERT_OK_AND_ASSIGN(segment, pool.Acquire(kMB));
+  ASSERT_NE(segment, nullptr);
+  EXPECT_EQ(segment->name(), name);
+}
+
+TEST(SharedMemoryPoolTest, ReadAndRelease) {
+  SharedMemoryPool pool(/*max_bytes=*/kMB,
+                        /*abandon_after_micros=*/60 * 1000 * 1000);
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * segment, pool.Acquire(16));
+  ASSERT_NE(segment, nullptr);
+  const std::string data = "element";
+  memcpy(segment->data(), data.data(), data.size());
+  std::string read;
+  TF_ASSERT_OK(pool.ReadAndRelease(segment->name(), data.size(), read));
+  EXPECT_EQ(read, data);
+  // The segment is free again.
+  EXPECT_TRUE(errors::IsNotFound(
+      pool.ReadAndRelease(segment->name(), data.size(), read)));
+  TF_ASSERT_OK_AND_ASSIGN(SharedMemorySegment * reused, pool.Acquire(16));
+  EXPECT_EQ(reused, segment);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      pool.ReadAndRelease(segment->name(), 2 * kMB, read)));
+}
+
+TEST(IsLocalAddressTest, LocalAddresses) {
+  EXPECT_TRUE(IsLocalAddress("localhost:5000"));
+  EXPECT_TRUE(IsLocalAddress("127.0.0.1:5000"));
+  EXPECT_TRUE(IsLocalAddress(absl::StrCat(port::Hostname(), ":5000")));
+}
+
+TEST(IsLocalAddressTest, RemoteAddresses) {
+  EXPECT_FALSE(IsLocalAddress("10.0.0.1:5000"));
+  EXPECT_FALSE(IsLocalAddress("/worker/task/0:worker"));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
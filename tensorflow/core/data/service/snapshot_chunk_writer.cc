@@ -0,0 +1,116 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot_chunk_writer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/io/compression.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kAttemptsDir[] = "attempts";
+
+}  // namespace
+
+std::string SnapshotChunkPath(absl::string_view snapshot_path, uint64 run_id,
+                              int64_t chunk_index) {
+  return snapshot_util::GetCheckpointFileName(
+      snapshot_util::ShardDirectory(
+          snapshot_util::RunDirectory(std::string(snapshot_path), run_id),
+          chunk_index),
+      /*checkpoint_id=*/0);
+}
+
+std::string SnapshotAttemptsDirectory(absl::string_view snapshot_path) {
+  return io::JoinPath(snapshot_path, kAttemptsDir);
+}
+
+std::string SnapshotChunkAttemptPath(absl::string_view snapshot_path,
+                                     int64_t chunk_index, int64_t attempt) {
+  return io::JoinPath(SnapshotAttemptsDirectory(snapshot_path),
+                      absl::StrCat("chunk_", chunk_index, "_", attempt));
+}
+
+Status CommitSnapshotChunkFile(Env* env, absl::string_view snapshot_path,
+                               uint64 run_id, int64_t chunk_index,
+                               int64_t attempt) {
+  const std::string attempt_path =
+      SnapshotChunkAttemptPath(snapshot_path, chunk_index, attempt);
+  const std::string chunk_path =
+      SnapshotChunkPath(snapshot_path, run_id, chunk_index);
+  if (!env->FileExists(attempt_path).ok()) {
+    if (env->FileExists(chunk_path).ok()) {
+      return OkStatus();
+    }
+    return errors::DataLoss("Committed attempt ", attempt, " of chunk ",
+                            chunk_index, " of snapshot ", snapshot_path,
+                            " is missing");
+  }
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(io::Dirname(chunk_path)));
+  return env->RenameFile(attempt_path, chunk_path);
+}
+
+SnapshotChunkWriter::SnapshotChunkWriter(Env* env,
+                                         const SnapshotChunkDef& chunk_def)
+    : env_(env), chunk_def_(chunk_def) {}
+
+StatusOr<int64_t> SnapshotChunkWriter::Run(standalone::Iterator& iterator) {
+  const std::string attempt_path = SnapshotChunkAttemptPath(
+      chunk_def_.path(), chunk_def_.chunk_index(), chunk_def_.attempt());
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(io::Dirname(attempt_path)));
+  std::unique_ptr<snapshot_util::Writer> writer;
+  TF_RETURN_IF_ERROR(snapshot_util::Writer::Create(
+      env_, attempt_path, io::compression::kNone,
+      kSnapshotChunkFileFormatVersion, /*dtypes=*/{}, &writer));
+
+  int64_t num_elements = 0;
+  Status status;
+  while (status.ok()) {
+    if (cancelled_) {
+      status = errors::Cancelled("Writing chunk ", chunk_def_.chunk_index(),
+                                 " of snapshot ", chunk_def_.path(),
+                                 " was cancelled");
+      break;
+    }
+    std::vector<Tensor> element;
+    bool end_of_sequence = false;
+    status = iterator.GetNext(&element, &end_of_sequence);
+    if (!status.ok() || end_of_sequence) {
+      break;
+    }
+    status = writer->WriteTensors(element);
+    ++num_elements;
+  }
+  if (status.ok()) {
+    status = writer->Close();
+  }
+  if (!status.ok()) {
+    env_->DeleteFile(attempt_path).IgnoreError();
+    return status;
+  }
+  return num_elements;
+}
+
+}  // namespace data
+}  // namespace tensorflow
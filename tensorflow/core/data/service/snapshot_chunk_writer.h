@@ -0,0 +1,85 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_CHUNK_WRITER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_CHUNK_WRITER_H_
+
+#include <atomic>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// The snapshot file format version of the chunks of distributed snapshots.
+constexpr int kSnapshotChunkFileFormatVersion = 2;
+
+// Returns the path of chunk `chunk_index` of the snapshot in `snapshot_path`,
+// once the snapshot is finalized. Finalized snapshots have the layout of
+// `Dataset.save`, with one shard per chunk, so `Dataset.load` reads them.
+std::string SnapshotChunkPath(absl::string_view snapshot_path, uint64 run_id,
+                              int64_t chunk_index);
+
+// Returns the directory of the chunk attempts of the snapshot in
+// `snapshot_path`.
+std::string SnapshotAttemptsDirectory(absl::string_view snapshot_path);
+
+// Returns the path written by attempt `attempt` of chunk `chunk_index` of the
+// snapshot in `snapshot_path`.
+std::string SnapshotChunkAttemptPath(absl::string_view snapshot_path,
+                                     int64_t chunk_index, int64_t attempt);
+
+// Moves the committed attempt `attempt` of chunk `chunk_index` to its path in
+// the finalized snapshot. Succeeds if it was already moved.
+Status CommitSnapshotChunkFile(Env* env, absl::string_view snapshot_path,
+                               uint64 run_id, int64_t chunk_index,
+                               int64_t attempt);
+
+// Writes one chunk of a distributed snapshot on a tf.data service worker.
+//
+// Each attempt at a chunk writes its own file, so that a chunk reassigned away
+// from a slow or failed worker is never written by two workers at once. The
+// dispatcher commits the first complete attempt, and moves it into place when
+// the snapshot is finalized.
+class SnapshotChunkWriter {
+ public:
+  SnapshotChunkWriter(Env* env, const SnapshotChunkDef& chunk_def);
+
+  // Writes all the elements of `iterator` to the attempt file. Returns the
+  // number of elements written.
+  StatusOr<int64_t> Run(standalone::Iterator& iterator);
+
+  // Makes `Run` stop at the next element and return a CANCELLED error. May be
+  // called before `Run`, or concurrently with it.
+  void Cancel() { cancelled_ = true; }
+
+  const SnapshotChunkDef& chunk_def() const { return chunk_def_; }
+
+ private:
+  Env* const env_;
+  const SnapshotChunkDef chunk_def_;
+  std::atomic<bool> cancelled_ = false;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_CHUNK_WRITER_H_
@@ -0,0 +1,125 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot_chunk_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/data/service/test_util.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/compression.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::data::testing::RangeDataset;
+using ::tensorflow::testing::IsOkAndHolds;
+using ::testing::ElementsAre;
+
+StatusOr<std::unique_ptr<standalone::Iterator>> RangeIterator(int64_t range) {
+  std::unique_ptr<standalone::Dataset> dataset;
+  TF_RETURN_IF_ERROR(standalone::Dataset::FromGraph(
+      standalone::Dataset::Params(), RangeDataset(range).graph(), &dataset));
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+  return iterator;
+}
+
+StatusOr<std::vector<int64_t>> ReadChunk(const std::string& chunk_path) {
+  std::unique_ptr<snapshot_util::Reader> reader;
+  TF_RETURN_IF_ERROR(snapshot_util::Reader::Create(
+      Env::Default(), chunk_path, io::compression::kNone,
+      kSnapshotChunkFileFormatVersion, {DT_INT64}, &reader));
+  std::vector<int64_t> result;
+  while (true) {
+    std::vector<Tensor> element;
+    Status status = reader->ReadTensors(&element);
+    if (errors::IsOutOfRange(status)) {
+      return result;
+    }
+    TF_RETURN_IF_ERROR(status);
+    result.push_back(element[0].scalar<int64_t>()());
+  }
+}
+
+SnapshotChunkDef ChunkDef(const std::string& path, int64_t chunk_index,
+                          int64_t attempt = 0) {
+  SnapshotChunkDef chunk_def;
+  chunk_def.set_path(path);
+  chunk_def.set_dataset_id(1);
+  chunk_def.set_chunk_index(chunk_index);
+  chunk_def.set_num_chunks(2);
+  chunk_def.set_attempt(attempt);
+  return chunk_def;
+}
+
+TEST(SnapshotChunkWriterTest, WriteChunk) {
+  const std::string path = io::JoinPath(::testing::TempDir(), "write_chunk");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<standalone::Iterator> iterator,
+                          RangeIterator(5));
+  SnapshotChunkWriter writer(Env::Default(), ChunkDef(path, 1, 3));
+  EXPECT_THAT(writer.Run(*iterator), IsOkAndHolds(5));
+  EXPECT_EQ(SnapshotChunkAttemptPath(path, 1, 3),
+            io::JoinPath(path, "attempts/chunk_1_3"));
+  EXPECT_THAT(ReadChunk(SnapshotChunkAttemptPath(path, 1, 3)),
+              IsOkAndHolds(ElementsAre(0, 1, 2, 3, 4)));
+}
+
+TEST(SnapshotChunkWriterTest, CommitChunk) {
+  const std::string path = io::JoinPath(::testing::TempDir(), "commit_chunk");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<standalone::Iterator> iterator,
+                          RangeIterator(5));
+  SnapshotChunkWriter writer(Env::Default(), ChunkDef(path, 1, 3));
+  EXPECT_THAT(writer.Run(*iterator), IsOkAndHolds(5));
+  TF_ASSERT_OK(CommitSnapshotChunkFile(Env::Default(), path, /*run_id=*/7,
+                                       /*chunk_index=*/1, /*attempt=*/3));
+  // The layout of `Dataset.save`.
+  EXPECT_EQ(SnapshotChunkPath(path, 7, 1),
+            io::JoinPath(path, "7/00000001.shard/00000000.snapshot"));
+  EXPECT_THAT(ReadChunk(SnapshotChunkPath(path, 7, 1)),
+              IsOkAndHolds(ElementsAre(0, 1, 2, 3, 4)));
+  // Committing is idempotent, but other attempts are missing.
+  TF_EXPECT_OK(CommitSnapshotChunkFile(Env::Default(), path, 7, 1, 3));
+  EXPECT_TRUE(errors::IsDataLoss(
+      CommitSnapshotChunkFile(Env::Default(), path, 7, 0, 0)));
+}
+
+TEST(SnapshotChunkWriterTest, CancelledWriterDeletesAttempt) {
+  const std::string path = io::JoinPath(::testing::TempDir(), "cancelled");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<standalone::Iterator> iterator,
+                          RangeIterator(5));
+  SnapshotChunkWriter writer(Env::Default(), ChunkDef(path, 0));
+  writer.Cancel();
+  EXPECT_TRUE(errors::IsCancelled(writer.Run(*iterator).status()));
+  EXPECT_TRUE(errors::IsNotFound(
+      Env::Default()->FileExists(SnapshotChunkAttemptPath(path, 0, 0))));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -16,9 +16,12 @@ limitations under the License.
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/time/time.h"
+#include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
 #include "tensorflow/core/data/service/data_transfer.h"
@@ -62,6 +65,33 @@ int64_t StandaloneTaskIterator::Cardinality() const {
   return dataset_->Get()->Cardinality();
 }
 
+std::shared_ptr<model::Model> StandaloneTaskIterator::model() const {
+  return iterator_->model();
+}
+
+CrossTrainerCacheConfig GetCrossTrainerCacheConfig(
+    const experimental::WorkerConfig& worker_config) {
+  CrossTrainerCacheConfig cache_config;
+  cache_config.max_cache_size_bytes =
+      worker_config.cross_trainer_cache_size_bytes() > 0
+          ? worker_config.cross_trainer_cache_size_bytes()
+          : kDefaultCrossTrainerCacheSizeBytes;
+  if (worker_config.cross_trainer_cache_eviction_policy() ==
+      experimental::WorkerConfig::SLOWEST_CONSUMER) {
+    cache_config.eviction_policy =
+        CrossTrainerCacheEvictionPolicy::kSlowestConsumer;
+  }
+  if (worker_config.cross_trainer_cache_consumer_timeout_ms() > 0) {
+    cache_config.consumer_timeout = absl::Milliseconds(
+        worker_config.cross_trainer_cache_consumer_timeout_ms());
+  }
+  cache_config.spill_directory =
+      worker_config.cross_trainer_cache_spill_directory();
+  cache_config.max_disk_size_bytes =
+      worker_config.cross_trainer_cache_disk_size_bytes();
+  return cache_config;
+}
+
 Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
                           const TaskDef& task_def,
                           std::unique_ptr<TaskIterator> iterator,
@@ -80,12 +110,8 @@ Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
                                                  task_def.num_consumers(),
                                                  task_def.worker_address());
   } else if (task_def.use_cross_trainer_cache()) {
-    const size_t max_cache_size_bytes =
-        worker_config.cross_trainer_cache_size_bytes() > 0
-            ? worker_config.cross_trainer_cache_size_bytes()
-            : kDefaultCrossTrainerCacheSizeBytes;
-    out = std::make_unique<CachingTaskRunner>(std::move(iterator),
-                                              max_cache_size_bytes);
+    out = std::make_unique<CachingTaskRunner>(
+        std::move(iterator), GetCrossTrainerCacheConfig(worker_config));
   } else {
     out = std::make_unique<FirstComeFirstServedTaskRunner>(std::move(iterator));
   }
@@ -94,7 +120,9 @@ Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
 
 FirstComeFirstServedTaskRunner::FirstComeFirstServedTaskRunner(
     std::unique_ptr<TaskIterator> iterator)
-    : iterator_(std::move(iterator)), buffer_(/*buffer_size=*/1) {
+    : model_(iterator->model()),
+      iterator_(std::move(iterator)),
+      buffer_(/*buffer_size=*/1) {
   RunPrefetchThread();
 }
 
@@ -155,11 +183,17 @@ void FirstComeFirstServedTaskRunner::Cancel() {
 
 CachingTaskRunner::CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
                                      size_t max_cache_size_bytes)
+    : CachingTaskRunner(std::move(iterator),
+                        CrossTrainerCacheConfig{max_cache_size_bytes}) {}
+
+CachingTaskRunner::CachingTaskRunner(
+    std::unique_ptr<TaskIterator> iterator,
+    const CrossTrainerCacheConfig& cache_config)
     : fcfs_task_runner_(std::move(iterator)),
-      cache_(max_cache_size_bytes,
+      cache_(cache_config,
              std::make_unique<GetElementResultSequence>(fcfs_task_runner_)) {
   LOG(INFO) << "Initialized tf.data service cross-trainer cache with "
-            << FormatBytes(max_cache_size_bytes) << " of memory.";
+            << FormatBytes(cache_config.max_cache_size_bytes) << " of memory.";
 }
 
 CachingTaskRunner::~CachingTaskRunner() { Cancel(); }
@@ -188,6 +222,62 @@ size_t CachingTaskRunner::GetElementResultSequence::GetElementSizeBytes(
   return element.EstimatedMemoryUsageBytes();
 }
 
+StatusOr<std::string>
+CachingTaskRunner::GetElementResultSequence::SerializeElement(
+    const GetElementResult& element) const {
+  GetElementResponse response;
+  response.set_element_index(element.element_index);
+  response.set_end_of_sequence(element.end_of_sequence);
+  response.set_skip_task(element.skip);
+  const CompressedElement* compressed = nullptr;
+  if (element.components.size() == 1 &&
+      element.components[0].dtype() == DT_VARIANT &&
+      TensorShapeUtils::IsScalar(element.components[0].shape())) {
+    compressed =
+        element.components[0].scalar<Variant>()().get<CompressedElement>();
+  }
+  if (compressed != nullptr) {
+    *response.mutable_compressed() = *compressed;
+  } else {
+    for (const Tensor& component : element.components) {
+      component.AsProtoTensorContent(
+          response.mutable_uncompressed()->add_components());
+    }
+  }
+  return response.SerializeAsString();
+}
+
+StatusOr<GetElementResult>
+CachingTaskRunner::GetElementResultSequence::DeserializeElement(
+    const std::string& serialized) const {
+  GetElementResponse response;
+  if (!response.ParseFromString(serialized)) {
+    return errors::DataLoss(
+        "Failed to parse a spilled tf.data service cross-trainer cache "
+        "element.");
+  }
+  GetElementResult result;
+  result.element_index = response.element_index();
+  result.end_of_sequence = response.end_of_sequence();
+  result.skip = response.skip_task();
+  if (response.has_compressed()) {
+    Tensor tensor(DT_VARIANT, TensorShape({}));
+    tensor.scalar<Variant>()() = std::move(*response.mutable_compressed());
+    result.components.push_back(std::move(tensor));
+  } else {
+    for (const TensorProto& proto : response.uncompressed().components()) {
+      Tensor tensor;
+      if (!tensor.FromProto(proto)) {
+        return errors::DataLoss(
+            "Failed to parse a component of a spilled tf.data service "
+            "cross-trainer cache element.");
+      }
+      result.components.push_back(std::move(tensor));
+    }
+  }
+  return result;
+}
+
 void CachingTaskRunner::Cancel() {
   VLOG(2) << "Cancelling tf.data service cross-trainer cache task.";
   if (!cache_.IsCancelled()) {
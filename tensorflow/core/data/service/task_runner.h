@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/thread_safe_buffer.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
@@ -45,6 +46,9 @@ class TaskIterator {
                          bool& end_of_sequence) = 0;
   // Reports the cardinality of the dataset that created this iterator.
   virtual int64_t Cardinality() const = 0;
+  // Returns the performance model of the iterator, or nullptr if the iterator
+  // does not have one.
+  virtual std::shared_ptr<model::Model> model() const { return nullptr; }
 };
 
 // Implementation of TaskIterator wrapping a standalone iterator.
@@ -57,12 +61,17 @@ class StandaloneTaskIterator : public TaskIterator {
                          std::unique_ptr<standalone::Iterator> iterator);
   Status GetNext(std::vector<Tensor>& element, bool& end_of_sequence) override;
   int64_t Cardinality() const override;
+  std::shared_ptr<model::Model> model() const override;
 
  private:
   std::unique_ptr<standalone::Dataset> dataset_;
   std::unique_ptr<standalone::Iterator> iterator_;
 };
 
+// Returns the cross-trainer cache configuration specified by `worker_config`.
+CrossTrainerCacheConfig GetCrossTrainerCacheConfig(
+    const experimental::WorkerConfig& worker_config);
+
 // Interface for providing elements to task consumers.
 class TaskRunner {
  public:
@@ -77,6 +86,9 @@ class TaskRunner {
                          GetElementResult& result) = 0;
   // Cancels in-progress `GetNext` requests.
   virtual void Cancel() = 0;
+  // Returns the performance model of the task's iterator, or nullptr if the
+  // iterator does not have one.
+  virtual std::shared_ptr<model::Model> model() const = 0;
 };
 
 // A task runner which provides elements on a first-come first-served basis.
@@ -94,6 +106,8 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
 
   void Cancel() override;
 
+  std::shared_ptr<model::Model> model() const override { return model_; }
+
  private:
   // Function to continually prefetch the next element. Returns an error if the
   // task has been cancelled.
@@ -105,6 +119,9 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
   // Gets the next element from the input iterator.
   StatusOr<GetElementResult> GetNextFromInputIterator() TF_LOCKS_EXCLUDED(mu_);
 
+  // Held separately from `iterator_` so that it can be accessed while
+  // `iterator_` is busy producing an element.
+  const std::shared_ptr<model::Model> model_;
   mutex mu_;
   std::unique_ptr<TaskIterator> iterator_ TF_GUARDED_BY(mu_);
   int64_t element_index_ TF_GUARDED_BY(mu_) = 0;
@@ -124,6 +141,8 @@ class CachingTaskRunner : public TaskRunner {
  public:
   explicit CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
                              size_t max_cache_size_bytes);
+  CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
+                    const CrossTrainerCacheConfig& cache_config);
   ~CachingTaskRunner() override;
 
   // Gets the next element from the cross-trainer cache, blocking if the data is
@@ -136,6 +155,10 @@ class CachingTaskRunner : public TaskRunner {
   // return a Cancelled status.
   void Cancel() override;
 
+  std::shared_ptr<model::Model> model() const override {
+    return fcfs_task_runner_.model();
+  }
+
  private:
   // The `GetElementResultSequence` generates a sequence of elements from the
   // `FirstComeFirstServedTaskRunner`. It is used for the `CrossTrainerCache` to
@@ -146,6 +169,10 @@ class CachingTaskRunner : public TaskRunner {
         FirstComeFirstServedTaskRunner& fcfs_task_runner);
     StatusOr<GetElementResult> GetNext() override;
     size_t GetElementSizeBytes(const GetElementResult& element) const override;
+    StatusOr<std::string> SerializeElement(
+        const GetElementResult& element) const override;
+    StatusOr<GetElementResult> DeserializeElement(
+        const std::string& serialized) const override;
 
    private:
     FirstComeFirstServedTaskRunner& fcfs_task_runner_;
@@ -184,6 +211,8 @@ class PrefetchThread {
                     std::vector<std::unique_ptr<Element>>& out);
   // Returns the status for any failures encountered by the prefetch thread.
   Status GetStatus();
+  // Returns the performance model of the prefetched iterator.
+  std::shared_ptr<model::Model> model() const { return iterator_->model(); }
 
  private:
   const std::unique_ptr<TaskIterator> iterator_;
@@ -228,6 +257,9 @@ class RoundRobinTaskRunner : public TaskRunner {
   Status GetNext(const GetElementRequest& req,
                  GetElementResult& result) override;
   void Cancel() override;
+  std::shared_ptr<model::Model> model() const override {
+    return prefetch_thread_.model();
+  }
 
  private:
   // Prepares a full round of data. `wait_us` indicates how long to wait before
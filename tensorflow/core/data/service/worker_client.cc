@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/worker_client.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
@@ -24,6 +26,7 @@ limitations under the License.
 #include "grpcpp/security/credentials.h"
 #include "grpcpp/support/channel_arguments.h"
 #include "grpcpp/support/status.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
@@ -32,12 +35,14 @@ limitations under the License.
 #include "tensorflow/core/data/service/credentials_factory.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/grpc_util.h"
+#include "tensorflow/core/data/service/shared_memory.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/service/worker_impl.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/platform/errors.h"
@@ -81,6 +86,10 @@ std::string DataServiceWorkerClient::GetDataTransferProtocol() const {
       LocalWorkers::Get(address_) != nullptr) {
     return kLocalTransferProtocol;
   }
+  if (transfer_protocol_ == kGrpcTransferProtocol &&
+      IsLocalAddress(address_)) {
+    return kGrpcSharedMemoryTransferProtocol;
+  }
   return transfer_protocol_;
 }
 
@@ -89,7 +98,8 @@ void DataServiceWorkerClient::TryCancel() { client_->TryCancel(); }
 class GrpcDataTransferClient : public DataTransferClient {
  public:
   GrpcDataTransferClient(std::shared_ptr<grpc::ChannelCredentials> credentials,
-                         std::string address) {
+                         std::string address, bool use_shared_memory)
+      : use_shared_memory_(use_shared_memory) {
     VLOG(2) << "Create GrpcDataTransferClient for worker " << address << ".";
     grpc::ChannelArguments args;
     args.SetMaxReceiveMessageSize(-1);
@@ -101,6 +111,29 @@ class GrpcDataTransferClient : public DataTransferClient {
                     GetElementResult& result) override {
     VLOG(3) << "GetElement for task " << req.task_id() << " from gRPC worker "
             << "server.";
+    if (use_shared_memory_) {
+      return GetElementWithSharedMemory(req, result);
+    }
+    GetElementResponse resp;
+    TF_RETURN_IF_ERROR(CallGetElement(req, resp));
+    return ParseResponse(req, resp, result);
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel GrpcDataTransferClient.";
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    for (const auto& ctx : active_contexts_) {
+      ctx->TryCancel();
+    }
+  }
+
+ private:
+  // The maximum number of worker segments kept open by the client.
+  static constexpr size_t kMaxOpenSegments = 64;
+
+  Status CallGetElement(const GetElementRequest& req,
+                        GetElementResponse& resp) {
     {
       mutex_lock l(mu_);
       if (cancelled_) {
@@ -112,14 +145,164 @@ class GrpcDataTransferClient : public DataTransferClient {
       mutex_lock l(mu_);
       active_contexts_.insert(&ctx);
     }
-    GetElementResponse resp;
     grpc::Status s = stub_->GetElement(&ctx, req, &resp);
+    {
+      mutex_lock l(mu_);
+      active_contexts_.erase(&ctx);
+    }
+    if (!s.ok()) {
+      return grpc_util::WrapError("Failed to get element", s);
+    }
+    return OkStatus();
+  }
+
+  // Requests an element that the worker may send through one of its shared
+  // memory segments instead of over gRPC, and releases the segments read
+  // since the previous request.
+  Status GetElementWithSharedMemory(const GetElementRequest& req,
+                                    GetElementResult& result) {
+    GetElementRequest shared_memory_req = req;
+    {
+      mutex_lock l(shared_memory_mu_);
+      shared_memory_req.set_accept_shared_memory(!shared_memory_unavailable_);
+      for (std::string& name : released_segments_) {
+        shared_memory_req.add_released_shared_memory(std::move(name));
+      }
+      released_segments_.clear();
+    }
+    GetElementResponse resp;
+    Status s = CallGetElement(shared_memory_req, resp);
+    if (!s.ok()) {
+      // The worker may not have seen the released segments.
+      mutex_lock l(shared_memory_mu_);
+      for (const std::string& name :
+           shared_memory_req.released_shared_memory()) {
+        released_segments_.push_back(name);
+      }
+      return s;
+    }
+    return ParseResponse(shared_memory_req, resp, result);
+  }
+
+  // Returns a mapping of the worker segment described by `element`, opening
+  // it if needed.
+  StatusOr<std::shared_ptr<const SharedMemorySegment>> GetSegment(
+      const SharedMemoryElement& element) {
+    mutex_lock l(shared_memory_mu_);
+    auto it = open_segments_.find(element.name());
+    if (it != open_segments_.end() &&
+        it->second->size() == element.segment_size()) {
+      return it->second;
+    }
+    TF_ASSIGN_OR_RETURN(
+        std::unique_ptr<SharedMemorySegment> segment,
+        SharedMemorySegment::Open(element.name(), element.segment_size()));
+    if (open_segments_.size() >= kMaxOpenSegments) {
+      open_segments_.clear();
+    }
+    std::shared_ptr<const SharedMemorySegment> shared_segment =
+        std::move(segment);
+    open_segments_[element.name()] = shared_segment;
+    return shared_segment;
+  }
+
+  // Reads an element that the worker wrote into one of its segments, and
+  // releases the segment with the next request. If the client cannot open
+  // the segment, e.g. because the worker runs in another container, it asks
+  // the worker for the segment contents and stops accepting shared memory.
+  Status ParseSharedMemoryElement(const GetElementRequest& req,
+                                  const SharedMemoryElement& element,
+                                  GetElementResult& result) {
+    StatusOr<std::shared_ptr<const SharedMemorySegment>> segment =
+        GetSegment(element);
+    if (segment.ok()) {
+      Status s = ParseSharedMemoryData(element, (*segment)->data(),
+                                       (*segment)->size(), result);
+      mutex_lock l(shared_memory_mu_);
+      released_segments_.push_back(element.name());
+      return s;
+    }
+    LOG(WARNING) << "Failed to open shared memory segment " << element.name()
+                 << " of tf.data service worker; falling back to gRPC: "
+                 << segment.status();
+    {
+      mutex_lock l(shared_memory_mu_);
+      shared_memory_unavailable_ = true;
+    }
+    GetElementRequest read_req;
+    read_req.set_task_id(req.task_id());
+    SharedMemoryRead* read = read_req.mutable_read_shared_memory();
+    read->set_name(element.name());
+    read->set_size(SharedMemoryDataSize(element));
+    GetElementResponse read_resp;
+    TF_RETURN_IF_ERROR(CallGetElement(read_req, read_resp));
+    const std::string& data = read_resp.shared_memory().data();
+    return ParseSharedMemoryData(element, data.data(), data.size(), result);
+  }
+
+  // Returns the number of bytes of its segment used by `element`.
+  static int64_t SharedMemoryDataSize(const SharedMemoryElement& element) {
+    if (element.has_compressed()) {
+      return element.compressed_data_size();
+    }
+    int64_t size = 0;
+    for (const SharedMemoryTensor& tensor : element.components()) {
+      size = std::max(size, tensor.offset() + tensor.size());
+    }
+    return size;
+  }
+
+  // Copies the element described by `element` out of the `size` bytes at
+  // `data`.
+  static Status ParseSharedMemoryData(const SharedMemoryElement& element,
+                                      const char* data, size_t size,
+                                      GetElementResult& result) {
+    if (element.has_compressed()) {
+      if (element.compressed_data_size() < 0 ||
+          element.compressed_data_size() > static_cast<int64_t>(size)) {
+        return errors::Internal("Received an invalid compressed element of ",
+                                element.compressed_data_size(),
+                                " bytes in shared memory of ", size,
+                                " bytes.");
+      }
+      CompressedElement compressed = element.compressed();
+      compressed.set_data(data, element.compressed_data_size());
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(compressed);
+      result.components.push_back(std::move(tensor));
+      return OkStatus();
+    }
+    for (const SharedMemoryTensor& component : element.components()) {
+      TensorShape shape;
+      TF_RETURN_IF_ERROR(
+          TensorShape::BuildTensorShape(component.shape(), &shape));
+      Tensor tensor(component.dtype(), shape);
+      if (!DataTypeCanUseMemcpy(component.dtype()) ||
+          component.size() != tensor.TotalBytes() || component.offset() < 0 ||
+          component.offset() + component.size() >
+              static_cast<int64_t>(size)) {
+        return errors::Internal("Received an invalid tensor of ",
+                                component.size(), " bytes at offset ",
+                                component.offset(), " in shared memory of ",
+                                size, " bytes.");
+      }
+      if (component.size() > 0) {
+        memcpy(tensor.data(), data + component.offset(), component.size());
+      }
+      result.components.push_back(std::move(tensor));
+    }
+    return OkStatus();
+  }
+
+  // Populates `result` from the response `resp` to `req`.
+  Status ParseResponse(const GetElementRequest& req, GetElementResponse& resp,
+                       GetElementResult& result) {
     result.end_of_sequence = resp.end_of_sequence();
     result.skip = resp.skip_task();
     switch (resp.element_case()) {
       case GetElementResponse::kCompressed: {
         Tensor tensor(DT_VARIANT, TensorShape{});
-        tensor.scalar<Variant>()() = std::move(resp.compressed());
+        tensor.scalar<Variant>()() = std::move(*resp.mutable_compressed());
         result.components.push_back(tensor);
         break;
       }
@@ -131,29 +314,14 @@ class GrpcDataTransferClient : public DataTransferClient {
           }
         }
         break;
+      case GetElementResponse::kSharedMemory:
+        return ParseSharedMemoryElement(req, resp.shared_memory(), result);
       case GetElementResponse::ELEMENT_NOT_SET:
         break;
     }
-    {
-      mutex_lock l(mu_);
-      active_contexts_.erase(&ctx);
-    }
-    if (!s.ok()) {
-      return grpc_util::WrapError("Failed to get element", s);
-    }
     return OkStatus();
   }
 
-  void TryCancel() override {
-    VLOG(2) << "Cancel GrpcDataTransferClient.";
-    mutex_lock l(mu_);
-    cancelled_ = true;
-    for (const auto& ctx : active_contexts_) {
-      ctx->TryCancel();
-    }
-  }
-
- private:
   mutex mu_;
   std::unique_ptr<WorkerService::Stub> stub_;
   // Set of all currently active clients contexts. Used to support
@@ -163,21 +331,36 @@ class GrpcDataTransferClient : public DataTransferClient {
   // Indicates that the client has been cancelled, so no further requests should
   // be accepted.
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
+
+  // Whether to ask the worker to send elements through shared memory.
+  const bool use_shared_memory_;
+  mutex shared_memory_mu_;
+  // The worker segments the client has mapped, keyed by name.
+  absl::flat_hash_map<std::string, std::shared_ptr<const SharedMemorySegment>>
+      open_segments_ TF_GUARDED_BY(shared_memory_mu_);
+  // Worker segments read since the previous request.
+  std::vector<std::string> released_segments_ TF_GUARDED_BY(shared_memory_mu_);
+  // Set if the client cannot open the worker's segments.
+  bool shared_memory_unavailable_ TF_GUARDED_BY(shared_memory_mu_) = false;
 };
 
 class GrpcTransferClientRegistrar {
  public:
   GrpcTransferClientRegistrar() {
-    DataTransferClient::Register(
-        kGrpcTransferProtocol, [](DataTransferClient::Config config,
-                                  std::unique_ptr<DataTransferClient>* out) {
-          std::shared_ptr<grpc::ChannelCredentials> credentials;
-          TF_RETURN_IF_ERROR(CredentialsFactory::CreateClientCredentials(
-              config.protocol, &credentials));
-          *out = std::make_unique<GrpcDataTransferClient>(credentials,
-                                                          config.address);
-          return OkStatus();
-        });
+    for (bool use_shared_memory : {false, true}) {
+      DataTransferClient::Register(
+          use_shared_memory ? kGrpcSharedMemoryTransferProtocol
+                            : kGrpcTransferProtocol,
+          [use_shared_memory](DataTransferClient::Config config,
+                              std::unique_ptr<DataTransferClient>* out) {
+            std::shared_ptr<grpc::ChannelCredentials> credentials;
+            TF_RETURN_IF_ERROR(CredentialsFactory::CreateClientCredentials(
+                config.protocol, &credentials));
+            *out = std::make_unique<GrpcDataTransferClient>(
+                credentials, config.address, use_shared_memory);
+            return OkStatus();
+          });
+    }
   }
 };
 static GrpcTransferClientRegistrar gprc_client_registrar;
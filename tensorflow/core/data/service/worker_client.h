@@ -31,6 +31,9 @@ namespace data {
 
 constexpr const char kLocalTransferProtocol[] = "local";
 constexpr const char kGrpcTransferProtocol[] = "grpc";
+// Like `kGrpcTransferProtocol`, but elements are passed through shared memory
+// when the worker runs on the same host.
+constexpr const char kGrpcSharedMemoryTransferProtocol[] = "grpc+shm";
 
 // Client for communicating with the tf.data service worker.
 class DataServiceWorkerClient : public DataServiceClientBase {
@@ -53,7 +56,8 @@ class DataServiceWorkerClient : public DataServiceClientBase {
 
  private:
   // Returns the data transfer protocol, preferring to use the local transfer
-  // protocol if a local tf.data worker exists.
+  // protocol if a local tf.data worker exists, and shared memory if the worker
+  // runs on the same host.
   std::string GetDataTransferProtocol() const;
 
   const std::string transfer_protocol_;
@@ -15,13 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/data/service/worker_impl.h"
 
+#include <cstring>
+#include <ctime>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "grpcpp/create_channel.h"
 #include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
@@ -38,18 +43,27 @@ limitations under the License.
 #include "tensorflow/core/data/service/dispatcher_client.h"
 #include "tensorflow/core/data/service/export.pb.h"
 #include "tensorflow/core/data/service/grpc_util.h"
+#include "tensorflow/core/data/service/shared_dataset_prefix.h"
+#include "tensorflow/core/data/service/shared_memory.h"
 #include "tensorflow/core/data/service/split_provider.h"
 #include "tensorflow/core/data/service/task_runner.h"
 #include "tensorflow/core/data/service/utils.h"
 #include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/data/split_utils.h"
 #include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
@@ -92,10 +106,95 @@ Status MoveElementToResponse(std::vector<Tensor>&& element,
         "it produced ",
         variant.TypeName());
   }
-  *resp.mutable_compressed() = *compressed;
+  if (element[0].RefCountIsOne()) {
+    resp.mutable_compressed()->Swap(compressed);
+  } else {
+    // Other tensors share the element, e.g. because it is cached.
+    *resp.mutable_compressed() = *compressed;
+  }
   return OkStatus();
 }
 
+// Shared memory segments are aligned like tensor buffers.
+constexpr size_t kSharedMemoryAlignment = Allocator::kAllocatorAlignment;
+// Bounds the total size of a worker's shared memory segments.
+constexpr size_t kMaxSharedMemoryBytes = size_t{1} << 30;  // 1GB.
+// Segments not released within this time are reused when the pool is full.
+constexpr int64_t kSharedMemoryAbandonAfterMicros =
+    10 * 60 * 1000 * 1000;  // 10 minutes.
+
+// Returns the layout of `element` in a shared memory segment, and the number
+// of bytes it needs, or nullopt if the element cannot be passed through shared
+// memory without serializing it.
+std::optional<size_t> SharedMemoryLayout(const std::vector<Tensor>& element,
+                                         SharedMemoryElement& shared_memory) {
+  if (element.size() == 1 && element[0].dtype() == DT_VARIANT &&
+      TensorShapeUtils::IsScalar(element[0].shape())) {
+    const CompressedElement* compressed =
+        element[0].scalar<Variant>()().get<CompressedElement>();
+    if (compressed == nullptr) {
+      return std::nullopt;
+    }
+    CompressedElement* metadata = shared_memory.mutable_compressed();
+    *metadata->mutable_component_metadata() = compressed->component_metadata();
+    metadata->set_codec(compressed->codec());
+    shared_memory.set_compressed_data_size(compressed->data().size());
+    return compressed->data().size();
+  }
+  size_t offset = 0;
+  for (const Tensor& component : element) {
+    if (!DataTypeCanUseMemcpy(component.dtype())) {
+      return std::nullopt;
+    }
+    SharedMemoryTensor* tensor = shared_memory.add_components();
+    tensor->set_dtype(component.dtype());
+    component.shape().AsProto(tensor->mutable_shape());
+    tensor->set_offset(offset);
+    tensor->set_size(component.TotalBytes());
+    offset += (component.TotalBytes() + kSharedMemoryAlignment - 1) /
+              kSharedMemoryAlignment * kSharedMemoryAlignment;
+  }
+  return offset;
+}
+
+// Copies `element` into a segment of `pool` and describes it in `resp`.
+// Returns false if the element has to be sent inline instead, e.g. because it
+// has components that can only be serialized or because the pool is full.
+bool MaybeMoveElementToSharedMemory(const std::vector<Tensor>& element,
+                                    SharedMemoryPool& pool,
+                                    GetElementResponse& resp) {
+  SharedMemoryElement shared_memory;
+  std::optional<size_t> size = SharedMemoryLayout(element, shared_memory);
+  if (!size.has_value() || *size == 0) {
+    return false;
+  }
+  StatusOr<SharedMemorySegment*> segment = pool.Acquire(*size);
+  if (!segment.ok() || *segment == nullptr) {
+    VLOG(2) << "Sending element inline: "
+            << (segment.ok() ? "the shared memory pool is full"
+                             : segment.status().ToString());
+    return false;
+  }
+  char* data = (*segment)->data();
+  if (shared_memory.has_compressed()) {
+    const std::string& compressed_data =
+        element[0].scalar<Variant>()().get<CompressedElement>()->data();
+    memcpy(data, compressed_data.data(), compressed_data.size());
+  } else {
+    for (int i = 0; i < element.size(); ++i) {
+      const StringPiece buffer = element[i].tensor_data();
+      if (!buffer.empty()) {
+        memcpy(data + shared_memory.components(i).offset(), buffer.data(),
+               buffer.size());
+      }
+    }
+  }
+  shared_memory.set_name((*segment)->name());
+  shared_memory.set_segment_size((*segment)->size());
+  *resp.mutable_shared_memory() = std::move(shared_memory);
+  return true;
+}
+
 WorkerConfig ApplyWorkerDefaults(const WorkerConfig& config) {
   WorkerConfig new_config(config);
   if (new_config.heartbeat_interval_ms() == 0) {
@@ -145,7 +244,12 @@ LocalWorkers::AddressToWorkerMap* LocalWorkers::local_workers_ =
     new AddressToWorkerMap();
 
 DataServiceWorkerImpl::DataServiceWorkerImpl(const WorkerConfig& config)
-    : config_(ApplyWorkerDefaults(config)), worker_uid_(port::JobUid()) {
+    : config_(ApplyWorkerDefaults(config)),
+      worker_uid_(port::JobUid()),
+      shared_prefixes_(
+          std::make_unique<SharedDatasetPrefixRegistry>(config_)),
+      shared_memory_pool_(kMaxSharedMemoryBytes,
+                          kSharedMemoryAbandonAfterMicros) {
   metrics::RecordTFDataServiceWorkerCreated();
 }
 
@@ -191,16 +295,22 @@ Status DataServiceWorkerImpl::Start(const std::string& worker_address,
 
 void DataServiceWorkerImpl::Stop() {
   std::vector<std::shared_ptr<Task>> tasks;
+  std::vector<std::shared_ptr<SnapshotChunk>> snapshot_chunks;
   {
     mutex_lock l(mu_);
     cancelled_ = true;
     for (const auto& entry : tasks_) {
       tasks.push_back(entry.second);
     }
+    for (auto& entry : snapshot_chunks_) {
+      snapshot_chunks.push_back(std::move(entry.second));
+    }
+    snapshot_chunks_.clear();
   }
   for (auto& task : tasks) {
     StopTask(*task);
   }
+  StopSnapshotChunks(snapshot_chunks);
   // At this point there are no outstanding requests in this RPC handler.
   // However, requests successfully returned from this RPC handler may still be
   // in progress within the gRPC server. If we shut down the gRPC server
@@ -361,9 +471,28 @@ DataServiceWorkerImpl::MakeDataset(const DatasetDef& dataset_def,
   TF_ASSIGN_OR_RETURN(
       GraphDef rewritten_graph,
       auto_shard_rewriter.ApplyAutoShardRewrite(dataset_def.graph()));
+  std::vector<std::pair<string, Tensor>> inputs;
+  if (!task_def.shared_prefix_node().empty()) {
+    StatusOr<std::shared_ptr<SharedDatasetPrefix>> prefix =
+        shared_prefixes_->GetOrCreate(task_def.shared_prefix_fingerprint(),
+                                      rewritten_graph,
+                                      task_def.shared_prefix_node());
+    if (prefix.ok()) {
+      TF_ASSIGN_OR_RETURN(Tensor prefix_dataset,
+                          SharedDatasetPrefix::MakeReaderDataset(*prefix));
+      inputs.emplace_back(absl::StrCat(task_def.shared_prefix_node(), ":0"),
+                          std::move(prefix_dataset));
+    } else if (errors::IsFailedPrecondition(prefix.status())) {
+      // The task computes the prefix itself.
+      VLOG(1) << "Not sharing the dataset prefix of task "
+              << task_def.task_id() << ": " << prefix.status();
+    } else {
+      return prefix.status();
+    }
+  }
   std::unique_ptr<standalone::Dataset> dataset;
   TF_RETURN_IF_ERROR(standalone::Dataset::FromGraph(
-      standalone::Dataset::Params(), rewritten_graph, &dataset));
+      standalone::Dataset::Params(), rewritten_graph, inputs, &dataset));
   return dataset;
 }
 
@@ -411,13 +540,26 @@ void DataServiceWorkerImpl::StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_) {
 Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
                                          GetElementResponse* response) {
   VLOG(3) << "Received GetElement request for task " << request->task_id();
+  for (const std::string& name : request->released_shared_memory()) {
+    shared_memory_pool_.Release(name);
+  }
+  if (request->has_read_shared_memory()) {
+    const SharedMemoryRead& read = request->read_shared_memory();
+    return shared_memory_pool_.ReadAndRelease(
+        read.name(), read.size(),
+        *response->mutable_shared_memory()->mutable_data());
+  }
   struct GetElementResult result;
   TF_RETURN_IF_ERROR(GetElementResult(request, &result));
   response->set_end_of_sequence(result.end_of_sequence);
   response->set_skip_task(result.skip);
   if (!response->end_of_sequence() && !response->skip_task()) {
-    TF_RETURN_IF_ERROR(
-        MoveElementToResponse(std::move(result.components), *response));
+    if (!request->accept_shared_memory() ||
+        !MaybeMoveElementToSharedMemory(result.components,
+                                        shared_memory_pool_, *response)) {
+      TF_RETURN_IF_ERROR(
+          MoveElementToResponse(std::move(result.components), *response));
+    }
     VLOG(3) << "Producing an element for task " << request->task_id();
   }
   return OkStatus();
@@ -436,6 +578,46 @@ Status DataServiceWorkerImpl::GetWorkerTasks(
   return OkStatus();
 }
 
+Status DataServiceWorkerImpl::GetPipelineDiagnostics(
+    const GetPipelineDiagnosticsRequest* request,
+    GetPipelineDiagnosticsResponse* response) {
+  Task* task = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (cancelled_) {
+      return errors::Cancelled("Worker is shutting down");
+    }
+    auto it = tasks_.find(request->task_id());
+    if (it == tasks_.end()) {
+      return errors::NotFound("Task ", request->task_id(),
+                              " not found in worker ", worker_address_);
+    }
+    task = it->second.get();
+    task->outstanding_requests++;
+  }
+  auto cleanup = gtl::MakeCleanup([&] {
+    mutex_lock l(mu_);
+    task->outstanding_requests--;
+    cv_.notify_all();
+  });
+  std::shared_ptr<model::Model> model;
+  {
+    mutex_lock l(task->mu);
+    if (!task->initialized) {
+      return errors::FailedPrecondition("Task ", request->task_id(),
+                                        " has not started producing elements");
+    }
+    model = task->task_runner->model();
+  }
+  if (model == nullptr) {
+    return errors::FailedPrecondition(
+        "Task ", request->task_id(),
+        " does not have a performance model to diagnose");
+  }
+  *response->mutable_diagnostics() = model::GetPipelineDiagnostics(model);
+  return OkStatus();
+}
+
 void DataServiceWorkerImpl::TaskCompletionThread() TF_LOCKS_EXCLUDED(mu_) {
   while (true) {
     {
@@ -514,11 +696,15 @@ void DataServiceWorkerImpl::HeartbeatThread() TF_LOCKS_EXCLUDED(mu_) {
 
 Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
   std::vector<int64_t> current_tasks;
+  std::optional<double> cpu_utilization;
+  std::vector<SnapshotChunkProgress> completed_snapshot_chunks;
   {
     mutex_lock l(mu_);
     for (const auto& task : tasks_) {
       current_tasks.push_back(task.first);
     }
+    cpu_utilization = MeasureCpuUtilization();
+    completed_snapshot_chunks.swap(completed_snapshot_chunks_);
   }
   WorkerHeartbeatRequest request;
   request.set_worker_address(worker_address_);
@@ -527,10 +713,25 @@ Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
   request.set_worker_uid(worker_uid_);
   *request.mutable_current_tasks() = {current_tasks.begin(),
                                       current_tasks.end()};
-  TF_ASSIGN_OR_RETURN(WorkerHeartbeatResponse response,
-                      dispatcher_->WorkerHeartbeat(request));
+  if (cpu_utilization.has_value()) {
+    request.set_cpu_utilization(*cpu_utilization);
+  }
+  *request.mutable_completed_snapshot_chunks() = {
+      completed_snapshot_chunks.begin(), completed_snapshot_chunks.end()};
+  StatusOr<WorkerHeartbeatResponse> response_or =
+      dispatcher_->WorkerHeartbeat(request);
+  if (!response_or.ok()) {
+    // Report the completed chunks again in the next heartbeat.
+    mutex_lock l(mu_);
+    completed_snapshot_chunks_.insert(completed_snapshot_chunks_.begin(),
+                                      completed_snapshot_chunks.begin(),
+                                      completed_snapshot_chunks.end());
+    return response_or.status();
+  }
+  const WorkerHeartbeatResponse& response = *response_or;
 
   std::vector<std::shared_ptr<Task>> tasks_to_delete;
+  std::vector<std::shared_ptr<SnapshotChunk>> snapshot_chunks_to_stop;
   {
     mutex_lock l(mu_);
     for (const auto& task : response.new_tasks()) {
@@ -555,13 +756,161 @@ Status DataServiceWorkerImpl::Heartbeat() TF_LOCKS_EXCLUDED(mu_) {
       tasks_.erase(task_id);
       finished_tasks_.insert(task_id);
     }
+    UpdateSnapshotChunks(response, snapshot_chunks_to_stop);
   }
   for (const auto& task : tasks_to_delete) {
     StopTask(*task);
   }
+  StopSnapshotChunks(snapshot_chunks_to_stop);
   return OkStatus();
 }
 
+void DataServiceWorkerImpl::UpdateSnapshotChunks(
+    const WorkerHeartbeatResponse& response,
+    std::vector<std::shared_ptr<SnapshotChunk>>& chunks_to_stop)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  absl::flat_hash_set<SnapshotChunkKey> assigned_chunks;
+  for (const SnapshotChunkDef& chunk_def : response.snapshot_chunks()) {
+    SnapshotChunkKey key(chunk_def.path(), chunk_def.chunk_index());
+    assigned_chunks.insert(key);
+    auto it = snapshot_chunks_.find(key);
+    if (it != snapshot_chunks_.end()) {
+      if (!it->second->finished || it->second->status.ok()) {
+        continue;
+      }
+      // The previous attempt failed; retry it.
+      chunks_to_stop.push_back(std::move(it->second));
+      snapshot_chunks_.erase(it);
+    }
+    if (cancelled_) {
+      continue;
+    }
+    VLOG(1) << "Writing chunk " << chunk_def.chunk_index() << " of snapshot "
+            << chunk_def.path();
+    auto chunk = std::make_shared<SnapshotChunk>(chunk_def);
+    chunk->thread = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf-data-service-snapshot-chunk",
+        [this, chunk] { SnapshotChunkThread(chunk); }));
+    snapshot_chunks_[key] = std::move(chunk);
+  }
+  for (auto it = snapshot_chunks_.begin(); it != snapshot_chunks_.end();) {
+    if (assigned_chunks.contains(it->first)) {
+      ++it;
+      continue;
+    }
+    // The chunk was committed, possibly by another worker.
+    chunks_to_stop.push_back(std::move(it->second));
+    snapshot_chunks_.erase(it++);
+  }
+}
+
+void DataServiceWorkerImpl::StopSnapshotChunks(
+    const std::vector<std::shared_ptr<SnapshotChunk>>& chunks)
+    TF_LOCKS_EXCLUDED(mu_) {
+  for (const auto& chunk : chunks) {
+    chunk->writer.Cancel();
+  }
+  for (const auto& chunk : chunks) {
+    chunk->thread.reset();
+  }
+}
+
+void DataServiceWorkerImpl::SnapshotChunkThread(
+    std::shared_ptr<SnapshotChunk> chunk) TF_LOCKS_EXCLUDED(mu_) {
+  const SnapshotChunkDef& chunk_def = chunk->writer.chunk_def();
+  StatusOr<int64_t> num_elements = WriteSnapshotChunk(*chunk);
+  mutex_lock l(mu_);
+  chunk->finished = true;
+  chunk->status = num_elements.status();
+  if (!num_elements.ok()) {
+    if (!errors::IsCancelled(num_elements.status())) {
+      LOG(WARNING) << "Failed to write chunk " << chunk_def.chunk_index()
+                   << " of snapshot " << chunk_def.path() << ": "
+                   << num_elements.status();
+    }
+    return;
+  }
+  SnapshotChunkProgress progress;
+  progress.set_path(chunk_def.path());
+  progress.set_chunk_index(chunk_def.chunk_index());
+  progress.set_attempt(chunk_def.attempt());
+  progress.set_num_elements(*num_elements);
+  for (DataType dtype : chunk->dtypes) {
+    progress.add_dtypes(dtype);
+  }
+  completed_snapshot_chunks_.push_back(std::move(progress));
+}
+
+StatusOr<int64_t> DataServiceWorkerImpl::WriteSnapshotChunk(
+    SnapshotChunk& chunk) const {
+  const SnapshotChunkDef& chunk_def = chunk.writer.chunk_def();
+  TaskDef task_def;
+  task_def.set_dataset_id(chunk_def.dataset_id());
+  task_def.mutable_processing_mode_def()->set_sharding_policy(
+      ProcessingModeDef::OFF);
+  DatasetDef dataset_def;
+  TF_RETURN_IF_ERROR(
+      dispatcher_->GetDatasetDef(chunk_def.dataset_id(), dataset_def));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Dataset> dataset,
+                      MakeDataset(dataset_def, task_def));
+  chunk.dtypes = dataset->Get()->output_dtypes();
+
+  // Each chunk reads every `num_chunks`-th split of the dataset's sources, so
+  // that the chunks only process their own share of the input.
+  std::vector<std::unique_ptr<SplitProvider>> split_providers;
+  Status s = dataset->MakeSplitProviders(&split_providers);
+  if (errors::IsUnimplemented(s)) {
+    // Without splits, every chunk would read the whole input and keep its
+    // share of the elements, which doesn't divide the work.
+    LOG(WARNING) << "Dataset " << chunk_def.dataset_id()
+                 << " does not support splits, so chunk "
+                 << chunk_def.chunk_index() << " of snapshot "
+                 << chunk_def.path() << " is written from a shard of its "
+                 << "files or data: " << s;
+    task_def.mutable_processing_mode_def()->set_sharding_policy(
+        ProcessingModeDef::FILE_OR_DATA);
+    task_def.set_num_workers(chunk_def.num_chunks());
+    task_def.set_worker_index(chunk_def.chunk_index());
+    TF_ASSIGN_OR_RETURN(dataset, MakeDataset(dataset_def, task_def));
+    std::unique_ptr<standalone::Iterator> iterator;
+    TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+    return chunk.writer.Run(*iterator);
+  }
+  TF_RETURN_IF_ERROR(s);
+  for (std::unique_ptr<SplitProvider>& split_provider : split_providers) {
+    split_provider = std::make_unique<ShardingSplitProvider>(
+        chunk_def.num_chunks(), chunk_def.chunk_index(),
+        std::shared_ptr<SplitProvider>(std::move(split_provider)));
+  }
+  std::unique_ptr<standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(
+      dataset->MakeIterator(std::move(split_providers), &iterator));
+  return chunk.writer.Run(*iterator);
+}
+
+std::optional<double> DataServiceWorkerImpl::MeasureCpuUtilization()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  const int64_t now_micros = Env::Default()->NowMicros();
+  const std::clock_t cpu_clock = std::clock();
+  if (cpu_clock == static_cast<std::clock_t>(-1)) {
+    return std::nullopt;
+  }
+  std::optional<double> cpu_utilization;
+  if (last_cpu_measurement_micros_ > 0 &&
+      now_micros > last_cpu_measurement_micros_ &&
+      cpu_clock >= last_cpu_clock_) {
+    const double cpu_seconds =
+        static_cast<double>(cpu_clock - last_cpu_clock_) / CLOCKS_PER_SEC;
+    const double wall_seconds =
+        static_cast<double>(now_micros - last_cpu_measurement_micros_) / 1e6;
+    cpu_utilization =
+        cpu_seconds / (wall_seconds * port::NumSchedulableCPUs());
+  }
+  last_cpu_measurement_micros_ = now_micros;
+  last_cpu_clock_ = cpu_clock;
+  return cpu_utilization;
+}
+
 void DataServiceWorkerImpl::DeleteLocalTask(const TaskInfo& task_info)
     TF_LOCKS_EXCLUDED(mu_) {
   std::shared_ptr<Task> task;
@@ -15,9 +15,12 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 
+#include <ctime>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -27,10 +30,14 @@ limitations under the License.
 #include "tensorflow/core/data/service/dispatcher.grpc.pb.h"
 #include "tensorflow/core/data/service/dispatcher_client.h"
 #include "tensorflow/core/data/service/export.pb.h"
+#include "tensorflow/core/data/service/shared_dataset_prefix.h"
+#include "tensorflow/core/data/service/shared_memory.h"
+#include "tensorflow/core/data/service/snapshot_chunk_writer.h"
 #include "tensorflow/core/data/service/task_runner.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -81,6 +88,8 @@ class DataServiceWorkerImpl {
                     GetElementResponse* response);
   Status GetWorkerTasks(const GetWorkerTasksRequest* request,
                         GetWorkerTasksResponse* response);
+  Status GetPipelineDiagnostics(const GetPipelineDiagnosticsRequest* request,
+                                GetPipelineDiagnosticsResponse* response);
 
   // Exports the worker state for debugging.
   WorkerStateExport ExportState() const;
@@ -96,6 +105,22 @@ class DataServiceWorkerImpl {
     std::unique_ptr<TaskRunner> task_runner;
   };
 
+  // A snapshot chunk being written by the worker, keyed by snapshot path and
+  // chunk index.
+  using SnapshotChunkKey = std::pair<std::string, int64_t>;
+  struct SnapshotChunk {
+    explicit SnapshotChunk(const SnapshotChunkDef& chunk_def)
+        : writer(Env::Default(), chunk_def) {}
+
+    SnapshotChunkWriter writer;
+    // The output types of the dataset, set by the writer thread.
+    DataTypeVector dtypes;
+    // Whether the writer thread has returned, and its status.
+    bool finished TF_GUARDED_BY(&DataServiceWorkerImpl::mu_) = false;
+    Status status TF_GUARDED_BY(&DataServiceWorkerImpl::mu_);
+    std::unique_ptr<Thread> thread;
+  };
+
   // Validates the worker config.
   Status ValidateWorkerConfig() const;
   // Sends task status to the dispatcher and checks for dispatcher commands.
@@ -113,6 +138,25 @@ class DataServiceWorkerImpl {
   void HeartbeatThread() TF_LOCKS_EXCLUDED(mu_);
   // Performs a heartbeat to the dispatcher.
   Status Heartbeat() TF_LOCKS_EXCLUDED(mu_);
+  // Starts and stops snapshot chunk writers to match the chunks assigned by the
+  // dispatcher. Writers to stop are moved to `chunks_to_stop`.
+  void UpdateSnapshotChunks(
+      const WorkerHeartbeatResponse& response,
+      std::vector<std::shared_ptr<SnapshotChunk>>& chunks_to_stop)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Cancels the writers of `chunks` and waits for their threads to exit.
+  void StopSnapshotChunks(
+      const std::vector<std::shared_ptr<SnapshotChunk>>& chunks)
+      TF_LOCKS_EXCLUDED(mu_);
+  // Writes a snapshot chunk, recording the result for the next heartbeat.
+  void SnapshotChunkThread(std::shared_ptr<SnapshotChunk> chunk)
+      TF_LOCKS_EXCLUDED(mu_);
+  // Creates an iterator over the chunk's share of its dataset and writes it.
+  StatusOr<int64_t> WriteSnapshotChunk(SnapshotChunk& chunk) const;
+  // Returns the fraction of the host's CPU capacity used by this process since
+  // the previous call, or nullopt on the first call.
+  std::optional<double> MeasureCpuUtilization()
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Gets the DatasetDef for `task_def`.
   StatusOr<DatasetDef> GetDatasetDef(const TaskDef& task_def) const;
   // Creates a dataset from `dataset_def`.
@@ -130,6 +174,10 @@ class DataServiceWorkerImpl {
   std::string worker_address_;
   std::string transfer_address_;
   std::unique_ptr<DataServiceDispatcherClient> dispatcher_;
+  // Dataset prefixes shared between the worker's tasks.
+  std::unique_ptr<SharedDatasetPrefixRegistry> shared_prefixes_;
+  // Shared memory segments for sending elements to clients on the same host.
+  SharedMemoryPool shared_memory_pool_;
 
   mutable mutex mu_;
   condition_variable cv_;
@@ -143,11 +191,21 @@ class DataServiceWorkerImpl {
   // Tasks deleted by the local client. If the client tries to read from them
   // again, the worker will return a non-retriable FailedPrecondition error.
   absl::flat_hash_set<int64_t> deleted_tasks_ TF_GUARDED_BY(mu_);
+  // Snapshot chunks assigned to this worker by the dispatcher.
+  absl::flat_hash_map<SnapshotChunkKey, std::shared_ptr<SnapshotChunk>>
+      snapshot_chunks_ TF_GUARDED_BY(mu_);
+  // Written snapshot chunks which haven't yet been reported to the dispatcher.
+  std::vector<SnapshotChunkProgress> completed_snapshot_chunks_
+      TF_GUARDED_BY(mu_);
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
   // Whether the worker has registered with the dispatcher yet.
   bool registered_ TF_GUARDED_BY(mu_) = false;
   condition_variable task_completion_cv_ TF_GUARDED_BY(mu_);
   condition_variable heartbeat_cv_ TF_GUARDED_BY(mu_);
+  // Wall time and process CPU time of the previous CPU utilization
+  // measurement.
+  int64_t last_cpu_measurement_micros_ TF_GUARDED_BY(mu_) = 0;
+  std::clock_t last_cpu_clock_ TF_GUARDED_BY(mu_) = 0;
   CancellationManager cancellation_manager_;
 
   // A thread for notifying the dispatcher when tasks complete.
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <functional>
+#include <numeric>
 #include <queue>
 #include <string>
 #include <utility>
@@ -24,6 +25,7 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/read_ahead_file.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor.pb.h"
@@ -38,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/platform/coding.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/strcat.h"
@@ -108,6 +111,10 @@ Status Writer::Create(Env* env, const std::string& filename,
       *out_writer =
           absl::make_unique<TFRecordWriter>(filename, compression_type);
       break;
+    case 3:
+      *out_writer =
+          absl::make_unique<IndexedWriter>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot writer version: ", version,
                                      " is not supported.");
@@ -173,6 +180,93 @@ TFRecordWriter::~TFRecordWriter() {
   }
 }
 
+IndexedWriter::IndexedWriter(const std::string& filename,
+                             const std::string& compression_type,
+                             const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes) {}
+
+Status IndexedWriter::Initialize(tensorflow::Env* env) {
+  if (compression_type_ != io::compression::kNone &&
+      compression_type_ != io::compression::kSnappy) {
+    return errors::InvalidArgument(
+        "Snapshot version 3 only supports no compression or snappy "
+        "compression, got: ",
+        compression_type_);
+  }
+  // Record offsets are relative to the start of the file, so the file is
+  // always written from scratch.
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename_, &dest_));
+  record_writer_ = absl::make_unique<io::RecordWriter>(dest_.get());
+  return OkStatus();
+}
+
+Status IndexedWriter::WriteRecord(StringPiece data) {
+  record_offsets_.push_back(offset_);
+  TF_RETURN_IF_ERROR(record_writer_->WriteRecord(data));
+  offset_ += io::RecordWriter::kHeaderSize + data.size() +
+             io::RecordWriter::kFooterSize;
+  return OkStatus();
+}
+
+Status IndexedWriter::WriteTensors(const std::vector<Tensor>& tensors) {
+  if (tensors.size() != dtypes_.size()) {
+    return errors::InvalidArgument("Expected ", dtypes_.size(),
+                                   " components, got ", tensors.size());
+  }
+  for (const auto& tensor : tensors) {
+    TensorProto proto;
+    tensor.AsProtoTensorContent(&proto);
+    std::string serialized = proto.SerializeAsString();
+    if (compression_type_ == io::compression::kSnappy) {
+      std::string compressed;
+      if (!port::Snappy_Compress(serialized.data(), serialized.size(),
+                                 &compressed)) {
+        return errors::Internal("Failed to compress using snappy.");
+      }
+      serialized = std::move(compressed);
+    }
+    TF_RETURN_IF_ERROR(WriteRecord(serialized));
+  }
+  return OkStatus();
+}
+
+Status IndexedWriter::Sync() {
+  TF_RETURN_IF_ERROR(record_writer_->Flush());
+  return dest_->Flush();
+}
+
+Status IndexedWriter::Close() {
+  if (record_writer_ == nullptr) {
+    return OkStatus();
+  }
+  std::string index;
+  index.reserve(record_offsets_.size() * sizeof(uint64));
+  for (uint64 record_offset : record_offsets_) {
+    core::PutFixed64(&index, record_offset);
+  }
+  const uint64 index_offset = offset_;
+  TF_RETURN_IF_ERROR(record_writer_->WriteRecord(index));
+  TF_RETURN_IF_ERROR(record_writer_->Close());
+
+  std::string trailer;
+  core::PutFixed64(&trailer, index_offset);
+  core::PutFixed64(&trailer, kIndexedFileMagic);
+  TF_RETURN_IF_ERROR(dest_->Append(trailer));
+  TF_RETURN_IF_ERROR(dest_->Close());
+  record_writer_ = nullptr;
+  dest_ = nullptr;
+  return OkStatus();
+}
+
+IndexedWriter::~IndexedWriter() {
+  Status s = Close();
+  if (!s.ok()) {
+    LOG(ERROR) << "Failed to close snapshot file " << filename_ << ": " << s;
+  }
+}
+
 CustomWriter::CustomWriter(const std::string& filename,
                            const std::string& compression_type,
                            const DataTypeVector& dtypes)
@@ -351,6 +445,10 @@ Status Reader::Create(Env* env, const std::string& filename,
       *out_reader =
           absl::make_unique<TFRecordReader>(filename, compression_type, dtypes);
       break;
+    case 3:
+      *out_reader =
+          absl::make_unique<IndexedReader>(filename, compression_type, dtypes);
+      break;
     default:
       return errors::InvalidArgument("Snapshot reader version: ", version,
                                      " is not supported.");
@@ -391,6 +489,41 @@ class Reader::Dataset : public DatasetBase {
 
   std::string DebugString() const override { return "SnapshotDatasetReader"; }
 
+  // Version 3 files are indexed, so their elements can be read by index, e.g.
+  // by a global shuffle.
+  int64_t CardinalityInternal() const override {
+    if (version_ != 3) {
+      return kUnknownCardinality;
+    }
+    mutex_lock l(mu_);
+    if (!InitializeIndexedReaders(Env::Default()).ok()) {
+      return kUnknownCardinality;
+    }
+    return std::max<int64_t>(file_end_indices_.back() - start_index_, 0);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return CardinalityInternal();
+  }
+
+  Status Get(AnyContext ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(InitializeIndexedReaders(ctx.env));
+    const int64_t shard_index = start_index_ + index;
+    const auto file = std::upper_bound(file_end_indices_.begin(),
+                                       file_end_indices_.end(), shard_index);
+    const int64_t file_index = file - file_end_indices_.begin();
+    const int64_t file_start =
+        file_index == 0 ? 0 : file_end_indices_[file_index - 1];
+    std::vector<int> components(dtypes_.size());
+    std::iota(components.begin(), components.end(), 0);
+    out_tensors->clear();
+    return indexed_readers_[file_index]->ReadComponents(
+        shard_index - file_start, components, out_tensors);
+  }
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
     return OkStatus();
   }
@@ -500,13 +633,9 @@ class Reader::Dataset : public DatasetBase {
                                    current_checkpoint_id_);
     }
 
-    // TODO(frankchn): Optimize this to not parse every single element.
+    // Indexed readers skip without parsing the skipped elements.
     Status AdvanceToStartIndex(IteratorContext* ctx) {
-      for (int64_t i = 0; i < start_index_; ++i) {
-        std::vector<Tensor> unused;
-        TF_RETURN_IF_ERROR(reader_->ReadTensors(&unused));
-      }
-      return OkStatus();
+      return reader_->SkipRecords(start_index_);
     }
 
     std::unique_ptr<Reader> reader_;
@@ -518,12 +647,50 @@ class Reader::Dataset : public DatasetBase {
     int64_t start_index_;
   };
 
+  // Opens the files of the shard of a version 3 snapshot for random access, if
+  // not done yet.
+  Status InitializeIndexedReaders(Env* env) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (!indexed_readers_.empty()) {
+      return OkStatus();
+    }
+    std::vector<std::unique_ptr<IndexedReader>> readers;
+    std::vector<int64_t> end_indices;
+    for (int64_t checkpoint_id = 0;; ++checkpoint_id) {
+      const std::string filename =
+          GetCheckpointFileName(shard_dir_, checkpoint_id);
+      if (errors::IsNotFound(env->FileExists(filename))) {
+        break;
+      }
+      std::unique_ptr<Reader> reader;
+      TF_RETURN_IF_ERROR(Reader::Create(env, filename, compression_, version_,
+                                        dtypes_, &reader));
+      readers.emplace_back(static_cast<IndexedReader*>(reader.release()));
+      end_indices.push_back(
+          (end_indices.empty() ? 0 : end_indices.back()) +
+          readers.back()->num_elements());
+    }
+    if (readers.empty()) {
+      return errors::NotFound("No snapshot files found in ", shard_dir_);
+    }
+    indexed_readers_ = std::move(readers);
+    file_end_indices_ = std::move(end_indices);
+    return OkStatus();
+  }
+
   const tstring shard_dir_;
   const std::string compression_;
   const int64_t version_;
   const DataTypeVector dtypes_;
   const std::vector<PartialTensorShape> shapes_;
   const int64_t start_index_;
+
+  mutable mutex mu_;
+  // The readers of the files of the shard, and the cumulative number of
+  // elements up to the end of each file. Only used for random access.
+  mutable std::vector<std::unique_ptr<IndexedReader>> indexed_readers_
+      TF_GUARDED_BY(mu_);
+  mutable std::vector<int64_t> file_end_indices_ TF_GUARDED_BY(mu_);
 };
 
 Reader::DatasetOp::DatasetOp(OpKernelConstruction* ctx) : DatasetOpKernel(ctx) {
@@ -716,6 +883,7 @@ TFRecordReader::TFRecordReader(const std::string& filename,
 
 Status TFRecordReader::Initialize(Env* env) {
   TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  file_ = MaybeReadAhead(std::move(file_), /*block_size=*/0);
 
   record_reader_ = absl::make_unique<io::RecordReader>(
       file_.get(), io::RecordReaderOptions::CreateRecordReaderOptions(
@@ -742,6 +910,156 @@ Status TFRecordReader::ReadTensors(std::vector<Tensor>* read_tensors) {
   return OkStatus();
 }
 
+IndexedReader::IndexedReader(const std::string& filename,
+                             const string& compression_type,
+                             const DataTypeVector& dtypes)
+    : filename_(filename),
+      compression_type_(compression_type),
+      dtypes_(dtypes) {}
+
+Status IndexedReader::Initialize(Env* env) {
+  if (dtypes_.empty()) {
+    return errors::InvalidArgument(
+        "Snapshot version 3 requires at least one component.");
+  }
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename_, &file_size));
+  if (file_size < IndexedWriter::kTrailerSize) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " is too small to contain an index.");
+  }
+
+  char trailer_scratch[IndexedWriter::kTrailerSize];
+  StringPiece trailer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - IndexedWriter::kTrailerSize,
+                                 IndexedWriter::kTrailerSize, &trailer,
+                                 trailer_scratch));
+  if (trailer.size() != IndexedWriter::kTrailerSize ||
+      core::DecodeFixed64(trailer.data() + sizeof(uint64)) !=
+          IndexedWriter::kIndexedFileMagic) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " does not end with a valid index trailer.");
+  }
+
+  // The index is read once, and subsequent reads go directly to the offsets
+  // it contains.
+  record_reader_ = absl::make_unique<io::RecordReader>(file_.get());
+  uint64 index_offset = core::DecodeFixed64(trailer.data());
+  tstring index;
+  TF_RETURN_IF_ERROR(record_reader_->ReadRecord(&index_offset, &index));
+  if (index.size() % sizeof(uint64) != 0 ||
+      (index.size() / sizeof(uint64)) % dtypes_.size() != 0) {
+    return errors::DataLoss("Snapshot file ", filename_,
+                            " has a malformed index of size ", index.size(),
+                            " for ", dtypes_.size(), " components.");
+  }
+  record_offsets_.resize(index.size() / sizeof(uint64));
+  for (size_t i = 0; i < record_offsets_.size(); ++i) {
+    record_offsets_[i] = core::DecodeFixed64(index.data() + i * sizeof(uint64));
+  }
+  num_elements_ = record_offsets_.size() / dtypes_.size();
+  return OkStatus();
+}
+
+Status IndexedReader::ReadComponent(int64_t index, int component,
+                                    Tensor* tensor) {
+  uint64 offset = record_offsets_[index * dtypes_.size() + component];
+  tstring record;
+  TF_RETURN_IF_ERROR(record_reader_->ReadRecord(&offset, &record));
+
+  TensorProto proto;
+  if (compression_type_ == io::compression::kSnappy) {
+    size_t uncompressed_size;
+    if (!port::Snappy_GetUncompressedLength(record.data(), record.size(),
+                                            &uncompressed_size)) {
+      return errors::DataLoss("Could not get snappy uncompressed length");
+    }
+    std::string uncompressed(uncompressed_size, '\0');
+    if (!port::Snappy_Uncompress(record.data(), record.size(),
+                                 &uncompressed[0])) {
+      return errors::DataLoss("Failed to perform snappy decompression.");
+    }
+    if (!proto.ParseFromString(uncompressed)) {
+      return errors::DataLoss("Unable to parse component ", component,
+                              " of element ", index, " in snapshot file ",
+                              filename_, ".");
+    }
+  } else if (!proto.ParseFromArray(record.data(), record.size())) {
+    return errors::DataLoss("Unable to parse component ", component,
+                            " of element ", index, " in snapshot file ",
+                            filename_, ".");
+  }
+  if (!tensor->FromProto(proto)) {
+    return errors::DataLoss("Unable to parse tensor from stored proto.");
+  }
+  if (tensor->dtype() != dtypes_[component]) {
+    return errors::DataLoss("Expected component ", component, " to have type ",
+                            DataTypeString(dtypes_[component]), ", got ",
+                            DataTypeString(tensor->dtype()));
+  }
+  return OkStatus();
+}
+
+Status IndexedReader::ReadComponents(int64_t index,
+                                     const std::vector<int>& components,
+                                     std::vector<Tensor>* read_tensors) {
+  if (index < 0 || index >= num_elements_) {
+    return errors::OutOfRange("Element index ", index,
+                              " is out of range for snapshot file with ",
+                              num_elements_, " elements.");
+  }
+  read_tensors->reserve(read_tensors->size() + components.size());
+  for (int component : components) {
+    if (component < 0 || component >= dtypes_.size()) {
+      return errors::InvalidArgument("Component index ", component,
+                                     " is out of range for ", dtypes_.size(),
+                                     " components.");
+    }
+    Tensor tensor;
+    TF_RETURN_IF_ERROR(ReadComponent(index, component, &tensor));
+    read_tensors->push_back(std::move(tensor));
+  }
+  return OkStatus();
+}
+
+Status IndexedReader::ReadTensors(std::vector<Tensor>* read_tensors) {
+  if (next_element_ >= num_elements_) {
+    return errors::OutOfRange("eof");
+  }
+  read_tensors->reserve(dtypes_.size());
+  for (int i = 0; i < dtypes_.size(); ++i) {
+    Tensor tensor;
+    TF_RETURN_IF_ERROR(ReadComponent(next_element_, i, &tensor));
+    read_tensors->push_back(std::move(tensor));
+  }
+  ++next_element_;
+  return OkStatus();
+}
+
+Status IndexedReader::SkipRecords(int64_t num_records) {
+  if (num_records < 0) {
+    return errors::InvalidArgument("Cannot skip a negative number of records: ",
+                                   num_records);
+  }
+  if (num_records > num_elements_ - next_element_) {
+    next_element_ = num_elements_;
+    return errors::OutOfRange("eof");
+  }
+  next_element_ += num_records;
+  return OkStatus();
+}
+
+Status IndexedReader::Seek(int64_t index) {
+  if (index < 0 || index > num_elements_) {
+    return errors::OutOfRange("Element index ", index,
+                              " is out of range for snapshot file with ",
+                              num_elements_, " elements.");
+  }
+  next_element_ = index;
+  return OkStatus();
+}
+
 CustomReader::CustomReader(const std::string& filename,
                            const string& compression_type, const int version,
                            const DataTypeVector& dtypes)
@@ -752,6 +1070,7 @@ CustomReader::CustomReader(const std::string& filename,
 
 Status CustomReader::Initialize(Env* env) {
   TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  file_ = MaybeReadAhead(std::move(file_), /*block_size=*/0);
   input_stream_ = std::make_unique<io::RandomAccessInputStream>(file_.get());
 
 #if defined(IS_SLIM_BUILD)
@@ -120,6 +120,52 @@ class TFRecordWriter : public Writer {
   std::unique_ptr<io::RecordWriter> record_writer_;
 };
 
+// Writes snapshots with an indexed file format (version 3). Every component
+// of every element is written as a separate TFRecord, optionally snappy
+// compressed, and the file ends with an index of the offsets of all records.
+// This lets `IndexedReader` seek directly to any element and read any subset
+// of the components, instead of scanning the file from the beginning.
+//
+// File layout:
+//   record(element 0, component 0) ... record(element N-1, component C-1)
+//   record(index): fixed64 offsets of the N * C records above
+//   fixed64 offset of the index record
+//   fixed64 kIndexedFileMagic
+class IndexedWriter : public Writer {
+ public:
+  static constexpr const uint64 kIndexedFileMagic = 0x7464736e61707333;
+  static constexpr const size_t kTrailerSize = 2 * sizeof(uint64);
+
+  IndexedWriter(const std::string& filename,
+                const std::string& compression_type,
+                const DataTypeVector& dtypes);
+
+  Status WriteTensors(const std::vector<Tensor>& tensors) override;
+
+  Status Sync() override;
+
+  Status Close() override;
+
+  ~IndexedWriter() override;
+
+ protected:
+  Status Initialize(tensorflow::Env* env) override;
+
+ private:
+  Status WriteRecord(StringPiece data);
+
+  const std::string filename_;
+  const std::string compression_type_;
+  const DataTypeVector dtypes_;
+
+  std::unique_ptr<WritableFile> dest_;
+  std::unique_ptr<io::RecordWriter> record_writer_;
+  // Offset of the next record to be written.
+  uint64 offset_ = 0;
+  // Offsets of the records written so far.
+  std::vector<uint64> record_offsets_;
+};
+
 // Writes snapshot with a custom (legacy) file format.
 class CustomWriter : public Writer {
  public:
@@ -257,6 +303,49 @@ class TFRecordReader : public Reader {
   const DataTypeVector dtypes_;
 };
 
+// Reads snapshots previously written with `IndexedWriter`.
+class IndexedReader : public Reader {
+ public:
+  IndexedReader(const std::string& filename, const string& compression_type,
+                const DataTypeVector& dtypes);
+
+  // Reads the element at the current position and advances to the next one.
+  Status ReadTensors(std::vector<Tensor>* read_tensors) override;
+
+  // Advances the current position by `num_records` elements without reading
+  // them.
+  Status SkipRecords(int64_t num_records) override;
+
+  // Returns the number of elements in the file.
+  int64_t num_elements() const { return num_elements_; }
+
+  // Sets the current position to the element at `index`.
+  Status Seek(int64_t index);
+
+  // Reads the given `components` of the element at `index`, without changing
+  // the current position.
+  Status ReadComponents(int64_t index, const std::vector<int>& components,
+                        std::vector<Tensor>* read_tensors);
+
+  ~IndexedReader() override {}
+
+ protected:
+  Status Initialize(Env* env) override;
+
+ private:
+  Status ReadComponent(int64_t index, int component, Tensor* tensor);
+
+  std::string filename_;
+  std::unique_ptr<RandomAccessFile> file_;
+  std::unique_ptr<io::RecordReader> record_reader_;
+  std::vector<uint64> record_offsets_;
+  int64_t num_elements_ = 0;
+  int64_t next_element_ = 0;
+
+  const string compression_type_;
+  const DataTypeVector dtypes_;
+};
+
 // Reads snapshots previously written with `CustomWriter`.
 class CustomReader : public Reader {
  public:
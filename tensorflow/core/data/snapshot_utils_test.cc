@@ -89,6 +89,57 @@ TEST(SnapshotUtilTest, CombinationRoundTripTest) {
   SnapshotRoundTrip(io::compression::kNone, 2);
   SnapshotRoundTrip(io::compression::kGzip, 2);
   SnapshotRoundTrip(io::compression::kSnappy, 2);
+
+  SnapshotRoundTrip(io::compression::kNone, 3);
+  SnapshotRoundTrip(io::compression::kSnappy, 3);
+}
+
+TEST(SnapshotUtilTest, IndexedReaderRandomAccess) {
+  DataTypeVector dtypes = {DT_INT64, DT_STRING};
+  std::string filename;
+  EXPECT_TRUE(Env::Default()->LocalTempFilename(&filename));
+
+  std::unique_ptr<Writer> writer;
+  TF_ASSERT_OK(Writer::Create(Env::Default(), filename,
+                              io::compression::kSnappy, /*version=*/3, dtypes,
+                              &writer));
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(writer->WriteTensors(
+        {Tensor(i), Tensor(tstring(strings::StrCat("element_", i)))}));
+  }
+  TF_ASSERT_OK(writer->Close());
+
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                              io::compression::kSnappy, /*version=*/3, dtypes,
+                              &reader));
+  auto* indexed_reader = static_cast<IndexedReader*>(reader.get());
+  EXPECT_EQ(indexed_reader->num_elements(), 10);
+
+  // Read a single component of an element in the middle of the file.
+  std::vector<Tensor> tensors;
+  TF_ASSERT_OK(indexed_reader->ReadComponents(7, {1}, &tensors));
+  ASSERT_EQ(tensors.size(), 1);
+  EXPECT_EQ(tensors[0].scalar<tstring>()(), "element_7");
+
+  // Skipping and seeking do not read the skipped elements.
+  EXPECT_TRUE(errors::IsInvalidArgument(reader->SkipRecords(-1)));
+  TF_ASSERT_OK(reader->SkipRecords(3));
+  tensors.clear();
+  TF_ASSERT_OK(reader->ReadTensors(&tensors));
+  ASSERT_EQ(tensors.size(), 2);
+  EXPECT_EQ(tensors[0].scalar<int64_t>()(), 3);
+  EXPECT_EQ(tensors[1].scalar<tstring>()(), "element_3");
+
+  TF_ASSERT_OK(indexed_reader->Seek(9));
+  tensors.clear();
+  TF_ASSERT_OK(reader->ReadTensors(&tensors));
+  EXPECT_EQ(tensors[0].scalar<int64_t>()(), 9);
+  tensors.clear();
+  EXPECT_TRUE(errors::IsOutOfRange(reader->ReadTensors(&tensors)));
+  EXPECT_TRUE(errors::IsOutOfRange(indexed_reader->Seek(11)));
+
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
 }
 
 void SnapshotReaderBenchmarkLoop(::testing::benchmark::State& state,
@@ -141,11 +192,21 @@ void SnapshotTFRecordReaderGzipBenchmark(::testing::benchmark::State& state) {
   SnapshotReaderBenchmarkLoop(state, io::compression::kGzip, 2);
 }
 
+void SnapshotIndexedReaderNoneBenchmark(::testing::benchmark::State& state) {
+  SnapshotReaderBenchmarkLoop(state, io::compression::kNone, 3);
+}
+
+void SnapshotIndexedReaderSnappyBenchmark(::testing::benchmark::State& state) {
+  SnapshotReaderBenchmarkLoop(state, io::compression::kSnappy, 3);
+}
+
 BENCHMARK(SnapshotCustomReaderNoneBenchmark);
 BENCHMARK(SnapshotCustomReaderGzipBenchmark);
 BENCHMARK(SnapshotCustomReaderSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordReaderNoneBenchmark);
 BENCHMARK(SnapshotTFRecordReaderGzipBenchmark);
+BENCHMARK(SnapshotIndexedReaderNoneBenchmark);
+BENCHMARK(SnapshotIndexedReaderSnappyBenchmark);
 
 void SnapshotWriterBenchmarkLoop(::testing::benchmark::State& state,
                                  std::string compression_type, int version) {
@@ -199,6 +260,17 @@ BENCHMARK(SnapshotTFRecordWriterNoneBenchmark);
 BENCHMARK(SnapshotTFRecordWriterGzipBenchmark);
 BENCHMARK(SnapshotTFRecordWriterSnappyBenchmark);
 
+void SnapshotIndexedWriterNoneBenchmark(::testing::benchmark::State& state) {
+  SnapshotWriterBenchmarkLoop(state, io::compression::kNone, 3);
+}
+
+void SnapshotIndexedWriterSnappyBenchmark(::testing::benchmark::State& state) {
+  SnapshotWriterBenchmarkLoop(state, io::compression::kSnappy, 3);
+}
+
+BENCHMARK(SnapshotIndexedWriterNoneBenchmark);
+BENCHMARK(SnapshotIndexedWriterSnappyBenchmark);
+
 }  // namespace
 }  // namespace snapshot_util
 }  // namespace data
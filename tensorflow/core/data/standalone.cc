@@ -20,6 +20,7 @@ limitations under the License.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
@@ -60,11 +61,19 @@ Status Iterator::GetNext(std::vector<Tensor>* outputs, bool* end_of_input) {
   return iterator_->GetNext(ctx_.get(), outputs, end_of_input);
 }
 
+std::shared_ptr<model::Model> Iterator::model() const { return ctx_->model(); }
+
 Iterator::Iterator(IteratorBase* iterator, IteratorContext* ctx)
     : iterator_(iterator), ctx_(ctx) {}
 
 Status Dataset::FromGraph(Params params, const GraphDef& graph_def,
                           std::unique_ptr<Dataset>* result) {
+  return FromGraph(std::move(params), graph_def, /*inputs=*/{}, result);
+}  // static
+
+Status Dataset::FromGraph(Params params, const GraphDef& graph_def,
+                          const std::vector<std::pair<string, Tensor>>& inputs,
+                          std::unique_ptr<Dataset>* result) {
   Graph graph(OpRegistry::Global());
   TF_RETURN_IF_ERROR(ImportGraphDef({}, graph_def, &graph, nullptr));
 
@@ -101,8 +110,8 @@ Status Dataset::FromGraph(Params params, const GraphDef& graph_def,
   // DT_VARIANT output tensor.
   std::vector<Tensor> outputs;
   GraphRunner graph_runner(device);
-  TF_RETURN_IF_ERROR(graph_runner.Run(&graph, pflr->GetFLR("/device:CPU:0"), {},
-                                      {fetch_node}, &outputs));
+  TF_RETURN_IF_ERROR(graph_runner.Run(&graph, pflr->GetFLR("/device:CPU:0"),
+                                      inputs, {fetch_node}, &outputs));
   data::DatasetBase* dataset;
   TF_RETURN_IF_ERROR(GetDatasetFromVariantTensor(outputs[0], &dataset));
 
@@ -142,6 +151,7 @@ Status Dataset::MakeIterator(
             std::back_inserter(params.split_providers));
   params.thread_factory = unbounded_thread_pool_.get_thread_factory();
   params.thread_pool = &unbounded_thread_pool_;
+  params.model = std::make_shared<model::Model>();
   ctx = absl::make_unique<IteratorContext>(std::move(params));
 
   // Create the iterator from the dataset.
@@ -18,11 +18,14 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/function_handle_cache.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -74,6 +77,10 @@ class Iterator {
   // indication of whether the end of the input pipeline has been reached.
   Status GetNext(std::vector<Tensor>* outputs, bool* end_of_input);
 
+  // Returns the performance model of the input pipeline. The model only
+  // collects information about the pipeline if autotuning is enabled.
+  std::shared_ptr<model::Model> model() const;
+
  private:
   friend class Dataset;
 
@@ -95,6 +102,12 @@ class Dataset {
   // Creates a new `Dataset` instance by running the given dataset graph.
   static Status FromGraph(Params params, const GraphDef& graph_def,
                           std::unique_ptr<Dataset>* result);
+  // Creates a new `Dataset` instance by running the given dataset graph,
+  // feeding `inputs` in place of the named tensors. Feeding the output of a
+  // dataset node replaces the subgraph producing it.
+  static Status FromGraph(Params params, const GraphDef& graph_def,
+                          const std::vector<std::pair<string, Tensor>>& inputs,
+                          std::unique_ptr<Dataset>* result);
 
   ~Dataset();
 
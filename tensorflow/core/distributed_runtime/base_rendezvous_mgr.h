@@ -104,7 +104,7 @@ class BaseRendezvousMgr : public RendezvousMgrInterface {
   // Not owned.
   const WorkerEnv* const worker_env_;
 
-  mutex mu_;
+  profiled_mutex mu_{"BaseRendezvousMgr"};
   Table table_ TF_GUARDED_BY(mu_);
 
   BaseRemoteRendezvous* FindOrCreate(int64_t step_id);
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/call_options.h"
 #include "tensorflow/core/distributed_runtime/cancellable_call.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/scoped_memory_debug_annotation.h"
 #include "tensorflow/core/protobuf/transport_options.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -68,6 +70,28 @@ class RecvBufCall : public CancellableCall {
   RecvBufResponse resp_;
 };
 
+// Returns the wire codec that RecvBuf calls ask peers to encode tensors with,
+// read once from TF_COLLECTIVE_WIRE_CODEC (see wire_codec.h). TOP_K is not
+// offered: its error feedback needs keys that are stable across steps, and
+// buffer keys are not.
+const WireCodecOptions& CollectiveWireCodec() {
+  static const WireCodecOptions* codec = [] {
+    auto* codec = new WireCodecOptions;
+    string spec;
+    Status s = ReadStringFromEnvVar("TF_COLLECTIVE_WIRE_CODEC", "", &spec);
+    if (s.ok()) s = ParseWireCodec(spec, codec);
+    if (s.ok() && codec->codec() == WireCodecOptions::TOP_K) {
+      s = errors::InvalidArgument("topk is not supported for collectives");
+    }
+    if (!s.ok()) {
+      LOG(ERROR) << "Ignoring TF_COLLECTIVE_WIRE_CODEC: " << s;
+      codec->Clear();
+    }
+    return codec;
+  }();
+  return *codec;
+}
+
 void PopulateTensorFromExtra(const RecvBufRespExtra& extra,
                              Tensor* cpu_tensor) {
   char* head = reinterpret_cast<char*>(DMAHelper::base(cpu_tensor));
@@ -86,6 +110,14 @@ Status PopulateTensorFromResponse(const RecvBufResponse& response,
   // copied into request.buf_ptr.
   if (!has_transport_options) return OkStatus();
 
+  if (response.transport_options().Is<CompressedTensorContent>()) {
+    CompressedTensorContent content;
+    if (!response.transport_options().UnpackTo(&content)) {
+      return errors::Internal("Cannot parse wire-encoded RecvBufResponse");
+    }
+    return DecodeTensorContent(content, cpu_tensor);
+  }
+
   const int64_t total_bytes = cpu_tensor->TotalBytes();
   int64_t num_bytes = 0;
   RecvBufRespExtra extra;
@@ -215,6 +247,10 @@ void CollectiveRemoteAccessDistributed::RecvFromPeer(
       step_id_, peer_device, peer_task, key, to_device, to_device_ctx,
       to_alloc_attr, dst_tensor, client_locality, state->server_attributes,
       cancellation_manager, worker_cache_));
+  const WireCodecOptions& codec = CollectiveWireCodec();
+  if (WireCodecAppliesTo(codec, to_tensor->dtype())) {
+    state->call->req_.mutable_transport_options()->PackFrom(codec);
+  }
   CancellationToken abortion_token =
       abortion_cancel_mgr_.get_cancellation_token();
   bool already_aborted = !abortion_cancel_mgr_.RegisterCallback(
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/protobuf/cluster.pb.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/coordination_config.pb.h"
@@ -54,6 +56,12 @@ constexpr int kDefaultHeartbeatTimeoutMs = 10 * 1000;  // 10 seconds
 constexpr int kServiceToClientTimeoutMs = 10 * 1000;   // 10 seconds
 constexpr size_t kOngoingBarriersSoftLimit = 20;
 constexpr char kHealthCheckThread[] = "CoordinationServiceHealthCheck";
+// Barriers with more waiting tasks than this release them by fanning out over
+// a thread pool, `kBarrierFanOutDegree` subranges at a time, instead of one by
+// one under the state lock.
+constexpr size_t kBarrierFanOutLeafSize = 64;
+constexpr size_t kBarrierFanOutDegree = 8;
+constexpr int kBarrierFanOutThreads = 8;
 
 std::string GetTaskName(absl::string_view job_name, int task_id) {
   return strings::StrCat("/job:", job_name, "/replica:", 0, "/task:", task_id);
@@ -176,6 +184,11 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
   void PassBarrier(absl::string_view barrier_id, Status result,
                    BarrierState* barrier)
       TF_EXCLUSIVE_LOCKS_REQUIRED(state_mu_);
+  // Invokes `callbacks[begin, end)` with `result`, splitting large ranges into
+  // subranges delivered concurrently on `barrier_fan_out_pool_`.
+  void DeliverBarrierResult(
+      std::shared_ptr<const std::vector<StatusCallback>> callbacks,
+      size_t begin, size_t end, const Status& result);
   // Check if participating tasks are specified correctly across barrier calls.
   bool ValidateTaskArgs(
       const std::vector<CoordinatedTask>& tasks_args,
@@ -223,6 +236,8 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
 
     State state_ = State::DISCONNECTED;
     Status status_;
+    // Heartbeats only hold `state_mu_` in shared mode, so the heartbeat time
+    // has its own lock.
     mutex last_heartbeat_mu_;
     uint64_t last_heartbeat_us_ TF_GUARDED_BY(last_heartbeat_mu_);
     // This denotes the deadline after which we stop accepting heartbeats from a
@@ -271,6 +286,10 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
   // use a set.
   absl::flat_hash_set<std::string> ongoing_barriers_ TF_GUARDED_BY(state_mu_);
 
+  // Declared last so that it is destroyed first, draining pending barrier
+  // deliveries while the rest of the service is still alive.
+  std::unique_ptr<thread::ThreadPool> barrier_fan_out_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(CoordinationServiceStandaloneImpl);
 };
 
@@ -370,6 +389,8 @@ CoordinationServiceStandaloneImpl::CoordinationServiceStandaloneImpl(
       cluster_state_.emplace(task_name, std::make_unique<TaskState>());
     }
   }
+  barrier_fan_out_pool_ = std::make_unique<thread::ThreadPool>(
+      env, "CoordinationServiceBarrierFanOut", kBarrierFanOutThreads);
   StartCheckStaleness();
 }
 
@@ -380,7 +401,7 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
       env_.StartThread({}, kHealthCheckThread, [this]() {
         const bool has_service_to_client_connection = client_cache_ != nullptr;
         // Used to store stale tasks and barriers.
-        std::vector<absl::string_view> stale_task_names;
+        std::vector<std::string> stale_task_names;
         absl::flat_hash_map<std::string, BarrierState*> expired_barriers;
         while (true) {
           {
@@ -390,10 +411,11 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
               return;
             }
           }
-          // Heartbeat check.
-          Status status = OkStatus();
+          // Heartbeat check. Tasks are scanned under a shared lock so that
+          // the scan doesn't block heartbeats in large clusters; only the
+          // stale tasks found are updated under the exclusive lock.
           {
-            mutex_lock l(state_mu_);
+            tf_shared_lock l(state_mu_);
             for (const auto& [task_name, task_state] : cluster_state_) {
               // Skip tasks that are not registered or in error state
               if (task_state->GetState() != TaskState::State::CONNECTED) {
@@ -405,14 +427,32 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
                       << " stale?=" << is_stale;
               if (is_stale) {
                 stale_task_names.push_back(task_name);
-                status = MakeCoordinationError(errors::Unavailable(
-                    "Task ", task_name,
-                    " heartbeat timeout. This indicates that the remote task "
-                    "has failed, got preempted, or crashed unexpectedly."));
-                SetTaskError(task_name, status);
               }
             }
           }
+          if (!stale_task_names.empty()) {
+            mutex_lock l(state_mu_);
+            // The tasks may have heartbeated or changed state since the scan.
+            std::vector<std::string> scanned_task_names;
+            scanned_task_names.swap(stale_task_names);
+            for (std::string& task_name : scanned_task_names) {
+              auto it = cluster_state_.find(task_name);
+              if (it == cluster_state_.end() ||
+                  it->second->GetState() != TaskState::State::CONNECTED ||
+                  it->second->TimeSinceLastHeartbeatMs() <=
+                      heartbeat_timeout_ms_) {
+                continue;
+              }
+              SetTaskError(
+                  task_name,
+                  MakeCoordinationError(errors::Unavailable(
+                      "Task ", task_name,
+                      " heartbeat timeout. This indicates that the remote "
+                      "task has failed, got preempted, or crashed "
+                      "unexpectedly.")));
+              stale_task_names.push_back(std::move(task_name));
+            }
+          }
           // Propagate heartbeat timeout errors to other connected tasks.
           if (!stale_task_names.empty()) {
             if (!has_service_to_client_connection) {
@@ -645,26 +685,28 @@ Status CoordinationServiceStandaloneImpl::RecordHeartbeat(
   const std::string& task_name = GetTaskName(task);
   Status s = OkStatus();
   {
-    mutex_lock l(state_mu_);
-    if (!cluster_state_.contains(task_name)) {
+    // Heartbeats only read the cluster state, so concurrent heartbeats from
+    // different tasks don't serialize on the state lock.
+    tf_shared_lock l(state_mu_);
+    auto it = cluster_state_.find(task_name);
+    if (it == cluster_state_.end()) {
       return MakeCoordinationError(errors::InvalidArgument(
           "Unexpected task request with task_name=", task_name));
     }
-    if (!cluster_state_[task_name]->GetStatus().ok()) {
-      return cluster_state_[task_name]->GetStatus();
-    } else if (cluster_state_[task_name]->GetState() ==
-                   TaskState::State::DISCONNECTED &&
+    TaskState* task_state = it->second.get();
+    if (!task_state->GetStatus().ok()) {
+      return task_state->GetStatus();
+    } else if (task_state->GetState() == TaskState::State::DISCONNECTED &&
                // We accept heartbeats for a short grace period to account for
                // the lag time between the service recording the state change
                // and the agent stopping heartbeats.
                Env::Default()->NowMicros() >
-                   cluster_state_[task_name]
-                       ->GetDisconnectedGracePeriodMicros()) {
+                   task_state->GetDisconnectedGracePeriodMicros()) {
       return MakeCoordinationError(errors::InvalidArgument(
           "Task with task_name=", task_name,
           " must be registered before sending heartbeat messages"));
     }
-    s = cluster_state_[task_name]->RecordHeartbeat(incarnation);
+    s = task_state->RecordHeartbeat(incarnation);
   }
 
   // Set and propagate any heartbeat errors.
@@ -1107,10 +1149,32 @@ void CoordinationServiceStandaloneImpl::PassBarrier(
   // Note: barrier_id shouldn't be referenced after this line as its lifetime
   // may be tied to one of the callbacks.
   // Propagate results to participating tasks.
-  for (const auto& callback : barrier->done_callbacks) {
-    callback(result);
-  }
+  auto callbacks = std::make_shared<const std::vector<StatusCallback>>(
+      std::move(barrier->done_callbacks));
   barrier->done_callbacks.clear();
+  DeliverBarrierResult(callbacks, 0, callbacks->size(), result);
+}
+
+void CoordinationServiceStandaloneImpl::DeliverBarrierResult(
+    std::shared_ptr<const std::vector<StatusCallback>> callbacks,
+    size_t begin, size_t end, const Status& result) {
+  if (end - begin <= kBarrierFanOutLeafSize) {
+    for (size_t i = begin; i < end; ++i) {
+      (*callbacks)[i](result);
+    }
+    return;
+  }
+  // Deliver to large barriers by tree fan-out, so that releasing N tasks takes
+  // O(log N) sequential steps.
+  const size_t step =
+      (end - begin + kBarrierFanOutDegree - 1) / kBarrierFanOutDegree;
+  for (size_t child_begin = begin; child_begin < end; child_begin += step) {
+    const size_t child_end = std::min(child_begin + step, end);
+    barrier_fan_out_pool_->Schedule(
+        [this, callbacks, child_begin, child_end, result]() {
+          DeliverBarrierResult(callbacks, child_begin, child_end, result);
+        });
+  }
 }
 
 bool CoordinationServiceStandaloneImpl::ValidateTaskArgs(
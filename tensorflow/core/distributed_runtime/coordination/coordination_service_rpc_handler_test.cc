@@ -0,0 +1,180 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/coordination/coordination_service_rpc_handler.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_client.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_service.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/coordination_config.pb.h"
+#include "tensorflow/core/protobuf/coordination_service.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kCoordinationServiceType[] = "standalone";
+constexpr char kJobName[] = "worker";
+// Number of threads issuing simulated task RPCs concurrently.
+constexpr int kNumClientThreads = 32;
+
+// Returns a server def for a cluster of `num_tasks` tasks. The addresses are
+// never dialed, since the service is created without a client cache.
+ServerDef ClusterServerDef(int num_tasks) {
+  ServerDef server_def;
+  server_def.set_protocol("grpc");
+  server_def.set_job_name(kJobName);
+  server_def.set_task_index(0);
+  JobDef* job_def = server_def.mutable_cluster()->add_job();
+  job_def->set_name(kJobName);
+  for (int i = 0; i < num_tasks; ++i) {
+    job_def->mutable_tasks()->insert({i, absl::StrCat("localhost:", i)});
+  }
+  CoordinationServiceConfig* config = server_def.mutable_default_session_config()
+                                          ->mutable_experimental()
+                                          ->mutable_coordination_config();
+  config->set_service_type(kCoordinationServiceType);
+  // Long enough that no task times out between benchmark iterations.
+  config->set_heartbeat_timeout_in_ms(60 * 60 * 1000);
+  return server_def;
+}
+
+CoordinatedTask Task(int task_id) {
+  CoordinatedTask task;
+  task.set_job_name(kJobName);
+  task.set_task_id(task_id);
+  return task;
+}
+
+// A coordination service for `num_tasks` simulated tasks, accessed through an
+// RPC handler as the tasks' RPCs would be.
+class SimulatedCluster {
+ public:
+  explicit SimulatedCluster(int num_tasks)
+      : num_tasks_(num_tasks),
+        service_(CoordinationServiceInterface::EnableCoordinationService(
+            kCoordinationServiceType, Env::Default(),
+            ClusterServerDef(num_tasks), /*cache=*/nullptr)),
+        pool_(Env::Default(), "simulated_tasks", kNumClientThreads) {
+    TF_CHECK_OK(ForEachTask([this](int task_id, StatusCallback done) {
+      RegisterTaskRequest request;
+      *request.mutable_source_task() = Task(task_id);
+      request.set_incarnation(task_id);
+      RegisterTaskResponse response;
+      handler_.RegisterTaskAsync(&request, &response, std::move(done));
+    }));
+  }
+
+  int num_tasks() const { return num_tasks_; }
+
+  // Calls `rpc(task_id, done)` for every task from the client threads, and
+  // waits for all the calls to return and all the `done` callbacks to run.
+  // Returns the first error.
+  Status ForEachTask(std::function<void(int, StatusCallback)> rpc) {
+    BlockingCounter counter(2 * num_tasks_);
+    mutex mu;
+    Status status;
+    auto done = [&](const Status& s) {
+      if (!s.ok()) {
+        mutex_lock l(mu);
+        status.Update(s);
+      }
+      counter.DecrementCount();
+    };
+    for (int i = 0; i < num_tasks_; ++i) {
+      pool_.Schedule([&rpc, &done, &counter, i]() {
+        rpc(i, done);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    return status;
+  }
+
+  Status Heartbeat() {
+    return ForEachTask([this](int task_id, StatusCallback done) {
+      HeartbeatRequest request;
+      *request.mutable_source_task() = Task(task_id);
+      request.set_incarnation(task_id);
+      HeartbeatResponse response;
+      handler_.HeartbeatAsync(&request, &response, std::move(done));
+    });
+  }
+
+  Status Barrier(const std::string& barrier_id) {
+    return ForEachTask([this, &barrier_id](int task_id, StatusCallback done) {
+      BarrierRequest request;
+      request.set_barrier_id(barrier_id);
+      request.set_barrier_timeout_in_ms(60 * 1000);
+      *request.mutable_source_task() = Task(task_id);
+      BarrierResponse response;
+      handler_.BarrierAsync(&request, &response, std::move(done));
+    });
+  }
+
+ private:
+  const int num_tasks_;
+  std::unique_ptr<CoordinationServiceInterface> service_;
+  CoordinationServiceRpcHandler handler_;
+  thread::ThreadPool pool_;
+};
+
+TEST(CoordinationServiceRpcHandlerTest, Heartbeat) {
+  SimulatedCluster cluster(/*num_tasks=*/100);
+  TF_EXPECT_OK(cluster.Heartbeat());
+}
+
+// Large enough that the barrier result is delivered by fan-out.
+TEST(CoordinationServiceRpcHandlerTest, LargeBarrier) {
+  SimulatedCluster cluster(/*num_tasks=*/1000);
+  TF_EXPECT_OK(cluster.Barrier("barrier_0"));
+  TF_EXPECT_OK(cluster.Barrier("barrier_1"));
+}
+
+void BM_Heartbeat(::testing::benchmark::State& state) {
+  SimulatedCluster cluster(state.range(0));
+  for (auto s : state) {
+    TF_CHECK_OK(cluster.Heartbeat());
+  }
+  state.SetItemsProcessed(state.iterations() * cluster.num_tasks());
+}
+BENCHMARK(BM_Heartbeat)->Arg(1000)->Arg(10000);
+
+void BM_Barrier(::testing::benchmark::State& state) {
+  SimulatedCluster cluster(state.range(0));
+  int64_t barrier_index = 0;
+  for (auto s : state) {
+    TF_CHECK_OK(cluster.Barrier(absl::StrCat("barrier_", barrier_index++)));
+  }
+  state.SetItemsProcessed(state.iterations() * cluster.num_tasks());
+}
+BENCHMARK(BM_Barrier)->Arg(1000)->Arg(10000);
+
+}  // namespace
+}  // namespace tensorflow
@@ -101,6 +101,7 @@ Status GetNumRetvals(tensorflow::EagerContext* context, const string& op_name,
 }
 
 Status GetEagerOperationAndNumRetvals(const Operation& operation,
+                                      const OpAttrMap& attrs,
                                       EagerContext* eager_context,
                                       EagerExecutor* eager_executor,
                                       EagerOperation* eager_op,
@@ -144,13 +145,12 @@ Status GetEagerOperationAndNumRetvals(const Operation& operation,
     }
   }
 
-  for (const auto& attr : operation.attrs()) {
+  for (const auto& attr : attrs) {
     eager_op->MutableAttrs()->Set(attr.first, attr.second);
   }
 
   // TODO(nareshmodi): Consider caching this.
-  return GetNumRetvals(eager_context, operation.name(), operation.attrs(),
-                       num_retvals);
+  return GetNumRetvals(eager_context, operation.name(), attrs, num_retvals);
 }
 
 Status TensorHandleProto(TensorHandle* handle, TensorProto* proto) {
@@ -476,8 +476,9 @@ void EagerServiceImpl::RunComponentFunction(
 
   EagerOperation* op = new EagerOperation(eager_context);
   int* num_retvals = new int(0);
-  s = GetEagerOperationAndNumRetvals(operation, eager_context, eager_executor,
-                                     op, num_retvals);
+  s = GetEagerOperationAndNumRetvals(operation, operation.attrs(),
+                                     eager_context, eager_executor, op,
+                                     num_retvals);
   if (!s.ok()) {
     delete num_retvals;
     delete op;
@@ -541,13 +542,14 @@ void EagerServiceImpl::RunComponentFunction(
 
 Status EagerServiceImpl::ExecuteOp(CallOptions* call_opts,
                                    const Operation& operation,
+                                   const OpAttrMap& attrs,
                                    EagerContext* eager_context,
                                    EagerExecutor* eager_executor,
                                    QueueResponse* queue_response) {
   tensorflow::EagerOperation op(eager_context);
   int num_retvals = 0;
   TF_RETURN_IF_ERROR(GetEagerOperationAndNumRetvals(
-      operation, eager_context, eager_executor, &op, &num_retvals));
+      operation, attrs, eager_context, eager_executor, &op, &num_retvals));
 
   auto cm = std::make_shared<CancellationManager>();
   if (call_opts) {
@@ -578,6 +580,29 @@ Status EagerServiceImpl::ExecuteOp(CallOptions* call_opts,
       std::move(add_device_fn));
 }
 
+Status EagerServiceImpl::ServerContext::ResolveOpAttrs(
+    const Operation& operation, const OpAttrMap** attrs) {
+  if (operation.attrs_id() == 0) {
+    *attrs = &operation.attrs();
+    return OkStatus();
+  }
+  mutex_lock l(op_attrs_mu_);
+  auto it = op_attrs_.find(operation.attrs_id());
+  if (it == op_attrs_.end()) {
+    if (operation.attrs().empty()) {
+      return errors::FailedPrecondition(
+          "Operation ", operation.name(), " refers to attributes with id ",
+          operation.attrs_id(), " which were never sent to this context.");
+    }
+    it = op_attrs_
+             .emplace(operation.attrs_id(),
+                      std::make_unique<const OpAttrMap>(operation.attrs()))
+             .first;
+  }
+  *attrs = operation.attrs().empty() ? it->second.get() : &operation.attrs();
+  return OkStatus();
+}
+
 Status EagerServiceImpl::Enqueue(CallOptions* call_opts,
                                  const EnqueueRequest* request,
                                  EnqueueResponse* response, uint64 stream_id) {
@@ -600,8 +625,12 @@ Status EagerServiceImpl::Enqueue(CallOptions* call_opts,
   for (const auto& item : request->queue()) {
     auto* queue_response = response->add_queue_response();
     if (item.has_operation()) {
-      s = ExecuteOp(call_opts, item.operation(), context->Context(), &executor,
-                    queue_response);
+      const OpAttrMap* attrs = nullptr;
+      s = context->ResolveOpAttrs(item.operation(), &attrs);
+      if (s.ok()) {
+        s = ExecuteOp(call_opts, item.operation(), *attrs, context->Context(),
+                      &executor, queue_response);
+      }
     } else if (item.has_handle_to_decref()) {
       auto handle_to_decref = std::make_unique<RemoteTensorHandleInternal>(
           item.handle_to_decref());
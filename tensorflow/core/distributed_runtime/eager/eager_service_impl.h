@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_EAGER_SERVICE_IMPL_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_EAGER_SERVICE_IMPL_H_
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/eager/context.h"
 #include "tensorflow/core/common_runtime/eager/tensor_handle.h"
 #include "tensorflow/core/distributed_runtime/eager/remote_mgr.h"
@@ -29,6 +30,9 @@ limitations under the License.
 namespace tensorflow {
 namespace eager {
 
+// Attributes of a remotely executed `Operation`.
+using OpAttrMap = protobuf::Map<string, AttrValue>;
+
 // A TensorFlow Eager Worker runs ops and supports worker to worker
 // Tensor transfer.
 //
@@ -154,6 +158,12 @@ class EagerServiceImpl {
       return (destroy_after_micros_ > 0 && time_passed > destroy_after_micros_);
     }
 
+    // Sets `*attrs` to the attributes of `operation`. Operations that carry an
+    // `attrs_id` register their attributes under that id the first time they
+    // are seen, and may omit them afterwards. The returned map lives as long
+    // as either `operation` or this context.
+    Status ResolveOpAttrs(const Operation& operation, const OpAttrMap** attrs);
+
    private:
     // The context for this execution.
     tensorflow::EagerContext* ctx_;
@@ -165,6 +175,10 @@ class EagerServiceImpl {
     int64_t destroy_after_micros_;
 
     const bool is_master_;
+
+    mutex op_attrs_mu_;
+    absl::flat_hash_map<uint64, std::unique_ptr<const OpAttrMap>> op_attrs_
+        TF_GUARDED_BY(op_attrs_mu_);
   };
   // The returned ServerContext will need to be Unrefed.
   tensorflow::Status GetServerContext(uint64, ServerContext**);
@@ -210,7 +224,8 @@ class EagerServiceImpl {
 
  private:
   Status ExecuteOp(CallOptions* call_opts, const Operation& operation,
-                   EagerContext* eager_context, EagerExecutor* eager_executor,
+                   const OpAttrMap& attrs, EagerContext* eager_context,
+                   EagerExecutor* eager_executor,
                    QueueResponse* queue_response);
   Status SendTensor(const SendTensorOp& send_tensor,
                     EagerContext* eager_context);
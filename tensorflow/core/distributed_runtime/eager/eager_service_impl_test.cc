@@ -463,6 +463,99 @@ TEST_F(EagerServiceImplTest, BasicTest) {
                                                &close_context_response));
 }
 
+// Test that ops may refer to attributes sent by an earlier op.
+TEST_F(EagerServiceImplTest, CachedOpAttrsTest) {
+  TestEagerServiceImpl eager_service_impl(&worker_env_);
+
+  uint64 context_id = random::New64();
+
+  CreateContextRequest request;
+  request.mutable_server_def()->set_job_name("localhost");
+  request.mutable_server_def()->set_task_index(0);
+  request.set_context_id(context_id);
+  CreateContextResponse response;
+
+  TF_ASSERT_OK(eager_service_impl.CreateContext(&request, &response));
+
+  EnqueueRequest remote_enqueue_request;
+  remote_enqueue_request.set_context_id(context_id);
+  EnqueueResponse remote_enqueue_response;
+
+  std::unordered_map<string, AttrValue> const_attrs;
+  AttrValue val;
+  val.set_type(tensorflow::DataType::DT_FLOAT);
+  const_attrs.insert({"dtype", val});
+  val.Clear();
+  SetTensorProto(val.mutable_tensor());
+  const_attrs.insert({"value", val});
+
+  AddOperationToEnqueueRequest(1, "Const", {}, const_attrs,
+                               "/job:localhost/replica:0/task:0/device:CPU:0",
+                               &remote_enqueue_request);
+
+  std::unordered_map<string, AttrValue> attrs;
+  val.Clear();
+  val.set_type(tensorflow::DataType::DT_FLOAT);
+  attrs.insert({"T", val});
+  val.Clear();
+  val.set_b(false);
+  attrs.insert({"transpose_a", val});
+  attrs.insert({"transpose_b", val});
+
+  AddOperationToEnqueueRequest(
+      2, "MatMul", {std::make_pair(1, 0), std::make_pair(1, 0)}, attrs,
+      "/job:localhost/replica:0/task:0/device:CPU:0", &remote_enqueue_request);
+  remote_enqueue_request.mutable_queue(1)->mutable_operation()->set_attrs_id(
+      7);
+
+  TF_ASSERT_OK(eager_service_impl.Enqueue(nullptr, &remote_enqueue_request,
+                                          &remote_enqueue_response));
+
+  // Only refer to the attributes registered by the previous MatMul.
+  EnqueueRequest cached_enqueue_request;
+  cached_enqueue_request.set_context_id(context_id);
+  EnqueueResponse cached_enqueue_response;
+  AddOperationToEnqueueRequest(
+      3, "MatMul", {std::make_pair(2, 0), std::make_pair(1, 0)}, {},
+      "/job:localhost/replica:0/task:0/device:CPU:0", &cached_enqueue_request);
+  cached_enqueue_request.mutable_queue(0)->mutable_operation()->set_attrs_id(7);
+
+  TF_ASSERT_OK(eager_service_impl.Enqueue(nullptr, &cached_enqueue_request,
+                                          &cached_enqueue_response));
+
+  tensorflow::TensorHandle* tensor_handle;
+  TF_ASSERT_OK(eager_service_impl.GetTensorHandle(
+      context_id, RemoteTensorHandleInternal(3, 0), &tensor_handle));
+  const tensorflow::Tensor* t = nullptr;
+  TF_ASSERT_OK(tensor_handle->Tensor(&t));
+  auto actual = t->flat<float>();
+  EXPECT_EQ(4, actual.size());
+  EXPECT_EQ(37, actual(0));
+  EXPECT_EQ(54, actual(1));
+  EXPECT_EQ(81, actual(2));
+  EXPECT_EQ(118, actual(3));
+
+  // Attributes that were never sent cannot be referred to.
+  EnqueueRequest unknown_enqueue_request;
+  unknown_enqueue_request.set_context_id(context_id);
+  EnqueueResponse unknown_enqueue_response;
+  AddOperationToEnqueueRequest(
+      4, "MatMul", {std::make_pair(1, 0), std::make_pair(1, 0)}, {},
+      "/job:localhost/replica:0/task:0/device:CPU:0", &unknown_enqueue_request);
+  unknown_enqueue_request.mutable_queue(0)->mutable_operation()->set_attrs_id(
+      8);
+  Status status = eager_service_impl.Enqueue(
+      nullptr, &unknown_enqueue_request, &unknown_enqueue_response);
+  EXPECT_EQ(error::FAILED_PRECONDITION, status.code());
+
+  CloseContextRequest close_context_request;
+  close_context_request.set_context_id(context_id);
+  close_context_request.set_context_view_id(0);
+  CloseContextResponse close_context_response;
+  TF_ASSERT_OK(eager_service_impl.CloseContext(&close_context_request,
+                                               &close_context_response));
+}
+
 class EagerServiceImplFunctionTest : public EagerServiceImplTest {
  public:
   EagerServiceImplFunctionTest() : EagerServiceImplTest() {}
@@ -80,6 +80,7 @@ void RemoteExecuteNode::RunAsync(StatusCallback done) {
       request_.get(), response.get(),
       [inputs, retvals, call_opts, response, device,
        context_view_id = context_view_id_, rpc_description, cm, token,
+       success_callbacks = std::move(success_callbacks_),
        done](const Status& status) {
         if (cm != nullptr) {
           cm->TryDeregisterCallback(token);
@@ -117,6 +118,11 @@ void RemoteExecuteNode::RunAsync(StatusCallback done) {
           }
           retvals[i]->Unref();
         }
+        if (status.ok()) {
+          for (const auto& fn : success_callbacks) {
+            fn();
+          }
+        }
         done(status);
       });
 }
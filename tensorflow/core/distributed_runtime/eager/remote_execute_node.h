@@ -17,6 +17,8 @@ limitations under the License.
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_REMOTE_EXECUTE_NODE_H_
 
 #include <cstddef>
+#include <functional>
+#include <vector>
 
 #include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/device.h"
@@ -96,6 +98,11 @@ class RemoteExecuteNode : public AsyncRemoteExecuteNode {
 
   void RunAsync(StatusCallback done) override;
 
+  // Runs `fn` after the remote operation completed successfully.
+  void AddSuccessCallback(std::function<void()> fn) {
+    success_callbacks_.push_back(std::move(fn));
+  }
+
   Status SyncExecutors() override { return eager_context_->SyncExecutors(); }
 
   void Abort(Status status) override {
@@ -133,6 +140,7 @@ class RemoteExecuteNode : public AsyncRemoteExecuteNode {
   const FunctionLibraryDefinition* lib_def_;
   gtl::InlinedVector<TensorHandle*, 4> inputs_;
   gtl::InlinedVector<TensorHandle*, 2> retvals_;
+  std::vector<std::function<void()>> success_callbacks_;
 };
 
 }  // namespace eager
@@ -240,5 +240,30 @@ void RemoteMgr::DeleteExecutorForStream(uint64 stream_id) {
   executor_map_.erase(it);
 }
 
+bool RemoteMgr::HasRemoteOpAttrs(const string& remote_task,
+                                 uint64 context_view_id, uint64 attrs_id) {
+  mutex_lock l(remote_op_attrs_mu_);
+  auto it = remote_op_attrs_.find(std::make_pair(remote_task, context_view_id));
+  return it != remote_op_attrs_.end() && it->second.contains(attrs_id);
+}
+
+bool RemoteMgr::CanCacheRemoteOpAttrs(const string& remote_task,
+                                      uint64 context_view_id) {
+  mutex_lock l(remote_op_attrs_mu_);
+  auto it = remote_op_attrs_.find(std::make_pair(remote_task, context_view_id));
+  return it == remote_op_attrs_.end() ||
+         it->second.size() < kMaxRemoteOpAttrsPerTask;
+}
+
+void RemoteMgr::AddRemoteOpAttrs(const string& remote_task,
+                                 uint64 context_view_id, uint64 attrs_id) {
+  mutex_lock l(remote_op_attrs_mu_);
+  auto& attrs_ids =
+      remote_op_attrs_[std::make_pair(remote_task, context_view_id)];
+  if (attrs_ids.size() < kMaxRemoteOpAttrsPerTask) {
+    attrs_ids.insert(attrs_id);
+  }
+}
+
 }  // namespace eager
 }  // namespace tensorflow
@@ -18,6 +18,9 @@ limitations under the License.
 
 #include <unordered_map>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 #include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
 #include "tensorflow/core/common_runtime/eager/tensor_handle.h"
@@ -79,6 +82,23 @@ class RemoteMgr {
 
   void DeleteExecutorForStream(uint64 stream_id);
 
+  // Bookkeeping for op attributes cached by remote contexts (see `attrs_id` in
+  // eager_service.proto). Entries are keyed by remote task and context view,
+  // since a context update may replace the remote context.
+  //
+  // Returns true if `remote_task` is known to hold the attributes `attrs_id`.
+  bool HasRemoteOpAttrs(const string& remote_task, uint64 context_view_id,
+                        uint64 attrs_id);
+  // Returns true if more attributes may be cached on `remote_task`. The number
+  // of cached attributes per remote context is bounded to bound its memory.
+  bool CanCacheRemoteOpAttrs(const string& remote_task,
+                             uint64 context_view_id);
+  // Records that `remote_task` holds the attributes `attrs_id`.
+  void AddRemoteOpAttrs(const string& remote_task, uint64 context_view_id,
+                        uint64 attrs_id);
+
+  static constexpr int kMaxRemoteOpAttrsPerTask = 1024;
+
  protected:
   mutex next_id_mutex_;
   uint64 next_op_id_ TF_GUARDED_BY(next_id_mutex_) = 1;
@@ -128,6 +148,10 @@ class RemoteMgr {
   mutex executor_map_mu_;
   std::unordered_map<uint64, EagerExecutor> executor_map_
       TF_GUARDED_BY(executor_map_mu_);
+
+  mutex remote_op_attrs_mu_;
+  absl::flat_hash_map<std::pair<string, uint64>, absl::flat_hash_set<uint64>>
+      remote_op_attrs_ TF_GUARDED_BY(remote_op_attrs_mu_);
 };
 
 }  // namespace eager
@@ -273,6 +273,10 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
     // this partition on the worker.
     string graph_handle;
 
+    // If non-zero, identifies the step template of this partition on the
+    // worker. See `ConfigProto.Experimental.register_step_templates`.
+    int64_t step_template_id = 0;
+
     Part() : feed_key(3), key_fetch(3) {}
   };
 
@@ -281,6 +285,10 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   // acquiring locks.
   std::vector<Part> partitions_;
 
+  // step_template_registered_[i] becomes true once a step has registered
+  // the step template of partitions_[i] on its worker.
+  std::unique_ptr<std::atomic<bool>[]> step_template_registered_;
+
   mutable mutex mu_;
 
   // Partition initialization and registration only needs to happen
@@ -500,6 +508,17 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     s.Update(c->status);
     partitions_[i].graph_handle = c->resp.graph_handle();
   }
+  if (s.ok() && !is_partial_ &&
+      session_opts_.config.experimental().register_step_templates()) {
+    step_template_registered_.reset(new std::atomic<bool>[num]);
+    for (int i = 0; i < num; ++i) {
+      step_template_registered_[i] = false;
+      // Zero means "no template" on the worker.
+      do {
+        partitions_[i].step_template_id = random::New64();
+      } while (partitions_[i].step_template_id == 0);
+    }
+  }
   return s;
 }
 
@@ -672,6 +691,9 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
 
   const int num = partitions_.size();
   RunManyGraphs calls(num);
+  // registers_template[i] is true if the i-th call registers the step
+  // template of partitions_[i].
+  gtl::InlinedVector<bool, 4> registers_template(num, false);
 
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
@@ -683,9 +705,20 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
       c->req->set_is_partial(is_partial_);
       c->req->set_is_last_partial_run(is_last_partial_run);
     }
+    // A templated request leaves out everything the worker already knows
+    // from the template: the graph handle, the send names and the recv keys.
+    bool templated = false;
+    if (part.step_template_id != 0) {
+      templated = step_template_registered_[i].load(std::memory_order_acquire);
+      registers_template[i] = !templated;
+      c->req->set_step_template_id(part.step_template_id);
+      c->req->set_register_step_template(!templated);
+    }
     c->req->set_session_handle(session_handle_);
     c->req->set_create_worker_session_called(!should_deregister_);
-    c->req->set_graph_handle(part.graph_handle);
+    if (!templated) {
+      c->req->set_graph_handle(part.graph_handle);
+    }
     c->req->set_step_id(step_id);
     *c->req->mutable_exec_opts() = exec_opts;
     c->req->set_store_errors_in_response_body(true);
@@ -718,9 +751,11 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
         }
       }
     } else {
+      // `part.feed_key` is not modified after registration, so the sends
+      // are added in the same order as when the template was registered.
       for (const auto& feed_key : part.feed_key) {
         const string& feed = feed_key.first;
-        const string& key = feed_key.second;
+        const string& key = templated ? "" : feed_key.second;
         auto iter = feeds.find(feed);
         if (iter == feeds.end()) {
           return errors::Internal("No feed index found for feed: ", feed);
@@ -729,9 +764,11 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
         TF_RETURN_IF_ERROR(
             AddSendFromClientRequest(req, c->req.get(), feed_index, key));
       }
-      for (const auto& key_fetch : part.key_fetch) {
-        const string& key = key_fetch.first;
-        c->req->add_recv_key(key);
+      if (!templated) {
+        for (const auto& key_fetch : part.key_fetch) {
+          const string& key = key_fetch.first;
+          c->req->add_recv_key(key);
+        }
       }
     }
   }
@@ -766,6 +803,11 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
     return errors::Cancelled("Step was cancelled");
   }
   TF_RETURN_IF_ERROR(calls.status());
+  for (int i = 0; i < num; ++i) {
+    if (registers_template[i]) {
+      step_template_registered_[i].store(true, std::memory_order_release);
+    }
+  }
 
   // Collects fetches and metadata.
   Status status;
@@ -397,6 +397,23 @@ void InMemoryRunGraphRequest::set_request_id(int64_t request_id) {
   request_id_ = request_id;
 }
 
+int64_t InMemoryRunGraphRequest::step_template_id() const {
+  return step_template_id_;
+}
+
+void InMemoryRunGraphRequest::set_step_template_id(int64_t step_template_id) {
+  step_template_id_ = step_template_id;
+}
+
+bool InMemoryRunGraphRequest::register_step_template() const {
+  return register_step_template_;
+}
+
+void InMemoryRunGraphRequest::set_register_step_template(
+    bool register_step_template) {
+  register_step_template_ = register_step_template;
+}
+
 const RunGraphRequest& InMemoryRunGraphRequest::ToProto() const {
   if (!proto_version_) {
     proto_version_.reset(new RunGraphRequest);
@@ -420,6 +437,8 @@ const RunGraphRequest& InMemoryRunGraphRequest::ToProto() const {
   proto_version_->set_store_errors_in_response_body(
       store_errors_in_response_body_);
   proto_version_->set_request_id(request_id_);
+  proto_version_->set_step_template_id(step_template_id_);
+  proto_version_->set_register_step_template(register_step_template_);
   return *proto_version_;
 }
 
@@ -545,6 +564,24 @@ void MutableProtoRunGraphRequest::set_request_id(int64_t request_id) {
   request_.set_request_id(request_id);
 }
 
+int64_t MutableProtoRunGraphRequest::step_template_id() const {
+  return request_.step_template_id();
+}
+
+void MutableProtoRunGraphRequest::set_step_template_id(
+    int64_t step_template_id) {
+  request_.set_step_template_id(step_template_id);
+}
+
+bool MutableProtoRunGraphRequest::register_step_template() const {
+  return request_.register_step_template();
+}
+
+void MutableProtoRunGraphRequest::set_register_step_template(
+    bool register_step_template) {
+  request_.set_register_step_template(register_step_template);
+}
+
 const RunGraphRequest& MutableProtoRunGraphRequest::ToProto() const {
   return request_;
 }
@@ -606,6 +643,14 @@ int64_t ProtoRunGraphRequest::request_id() const {
   return request_->request_id();
 }
 
+int64_t ProtoRunGraphRequest::step_template_id() const {
+  return request_->step_template_id();
+}
+
+bool ProtoRunGraphRequest::register_step_template() const {
+  return request_->register_step_template();
+}
+
 const RunGraphRequest& ProtoRunGraphRequest::ToProto() const {
   return *request_;
 }
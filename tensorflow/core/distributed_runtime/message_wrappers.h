@@ -297,6 +297,14 @@ class RunGraphRequestWrapper {
 
   virtual int64_t request_id() const = 0;
 
+  // Identifies a step template registered on the worker. See
+  // `RunGraphRequest.step_template_id` for how templated requests are
+  // interpreted.
+  virtual int64_t step_template_id() const = 0;
+
+  // If true, the worker registers this request as `step_template_id`.
+  virtual bool register_step_template() const = 0;
+
   // Returns the wrapped data as a protocol buffer message.
   virtual const RunGraphRequest& ToProto() const = 0;
 };
@@ -326,6 +334,8 @@ class MutableRunGraphRequestWrapper : public RunGraphRequestWrapper {
   virtual void set_is_last_partial_run(bool is_last_partial_run) = 0;
   virtual void set_store_errors_in_response_body(bool store_errors) = 0;
   virtual void set_request_id(int64_t request_id) = 0;
+  virtual void set_step_template_id(int64_t step_template_id) = 0;
+  virtual void set_register_step_template(bool register_step_template) = 0;
 };
 
 class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
@@ -346,6 +356,8 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   const RunGraphRequest& ToProto() const override;
   bool store_errors_in_response_body() const override;
   int64_t request_id() const override;
+  int64_t step_template_id() const override;
+  bool register_step_template() const override;
 
   // MutableRunGraphRequestWrapper methods.
   void set_session_handle(const string& handle) override;
@@ -364,6 +376,8 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   void set_is_last_partial_run(bool is_last_partial_run) override;
   void set_store_errors_in_response_body(bool store_errors) override;
   void set_request_id(int64_t request_id) override;
+  void set_step_template_id(int64_t step_template_id) override;
+  void set_register_step_template(bool register_step_template) override;
 
  private:
   string session_handle_;
@@ -377,6 +391,8 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   bool is_last_partial_run_ = false;
   bool store_errors_in_response_body_ = false;
   int64_t request_id_ = 0;
+  int64_t step_template_id_ = 0;
+  bool register_step_template_ = false;
 
   // Holds a cached and owned representation of the proto
   // representation of this request, if needed, so that `ToProto()`
@@ -405,6 +421,8 @@ class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
   bool is_last_partial_run() const override;
   bool store_errors_in_response_body() const override;
   int64_t request_id() const override;
+  int64_t step_template_id() const override;
+  bool register_step_template() const override;
   const RunGraphRequest& ToProto() const override;
 
   // MutableRunGraphRequestWrapper methods.
@@ -424,6 +442,8 @@ class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
   void set_is_last_partial_run(bool is_last_partial_run) override;
   void set_store_errors_in_response_body(bool store_errors) override;
   void set_request_id(int64_t request_id) override;
+  void set_step_template_id(int64_t step_template_id) override;
+  void set_register_step_template(bool register_step_template) override;
 
  private:
   RunGraphRequest request_;
@@ -448,6 +468,8 @@ class ProtoRunGraphRequest : public RunGraphRequestWrapper {
   bool is_last_partial_run() const override;
   bool store_errors_in_response_body() const override;
   int64_t request_id() const override;
+  int64_t step_template_id() const override;
+  bool register_step_template() const override;
   const RunGraphRequest& ToProto() const override;
 
  private:
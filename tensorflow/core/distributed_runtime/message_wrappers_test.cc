@@ -81,6 +81,8 @@ void BuildRunGraphRequest(const RunStepRequestWrapper& run_step_request,
   run_graph_request->add_recv_key("recv_2");
   run_graph_request->add_recv_key("recv_3");
   run_graph_request->set_is_partial(true);
+  run_graph_request->set_step_template_id(17);
+  run_graph_request->set_register_step_template(true);
 }
 
 void CheckRunGraphRequest(const RunGraphRequestWrapper& request) {
@@ -97,6 +99,8 @@ void CheckRunGraphRequest(const RunGraphRequestWrapper& request) {
   test::ExpectTensorEqual<int32>(TensorB(), val);
   EXPECT_TRUE(request.is_partial());
   EXPECT_FALSE(request.is_last_partial_run());
+  EXPECT_EQ(17, request.step_template_id());
+  EXPECT_TRUE(request.register_step_template());
 }
 
 void BuildRunGraphResponse(MutableRunGraphResponseWrapper* run_graph_response) {
@@ -0,0 +1,316 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/preemption/emergency_checkpoint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/protobuf/coordination_service.pb.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+constexpr char kStepDirPrefix[] = "step_";
+constexpr char kCheckpointBasename[] = "checkpoint";
+constexpr char kLatestFilename[] = "latest";
+constexpr char kPeerKeyPrefix[] = "EMERGENCY_CHECKPOINT/";
+constexpr char kPeerLatestKey[] = "latest";
+constexpr char kRestoreStepKeyPrefix[] = "EMERGENCY_CHECKPOINT_RESTORE/";
+
+// A manifest lists the step of a replicated checkpoint on its first line, then
+// one "<file> <number of chunks>" line per file of the step directory.
+struct Manifest {
+  int64_t step = -1;
+  std::vector<std::pair<std::string, int64_t>> files;
+};
+
+std::string SerializeManifest(const Manifest& manifest) {
+  std::string result = absl::StrCat(manifest.step, "\n");
+  for (const auto& [file, num_chunks] : manifest.files) {
+    absl::StrAppend(&result, file, " ", num_chunks, "\n");
+  }
+  return result;
+}
+
+StatusOr<Manifest> ParseManifest(absl::string_view text) {
+  std::vector<absl::string_view> lines =
+      absl::StrSplit(text, '\n', absl::SkipEmpty());
+  Manifest manifest;
+  if (lines.empty() || !absl::SimpleAtoi(lines[0], &manifest.step)) {
+    return errors::DataLoss("Malformed emergency checkpoint manifest: ", text);
+  }
+  for (size_t i = 1; i < lines.size(); ++i) {
+    std::vector<absl::string_view> fields = absl::StrSplit(lines[i], ' ');
+    int64_t num_chunks;
+    if (fields.size() != 2 || fields[0].empty() ||
+        fields[0].find('/') != absl::string_view::npos ||
+        !absl::SimpleAtoi(fields[1], &num_chunks) || num_chunks < 1) {
+      return errors::DataLoss("Malformed emergency checkpoint manifest: ",
+                              text);
+    }
+    manifest.files.emplace_back(std::string(fields[0]), num_chunks);
+  }
+  return manifest;
+}
+
+std::string ChunkKey(absl::string_view step_key, absl::string_view file,
+                     int64_t chunk) {
+  return absl::StrCat(step_key, "/", file, "/", chunk);
+}
+
+}  // namespace
+
+std::string EmergencyCheckpointer::StepDir(int64_t step) const {
+  return io::JoinPath(options_.local_dir, absl::StrCat(kStepDirPrefix, step));
+}
+
+Status EmergencyCheckpointer::WriteLocalLatest(int64_t step) {
+  // Rename, so that a task killed while writing leaves the previous value.
+  const std::string latest = io::JoinPath(options_.local_dir, kLatestFilename);
+  const std::string tmp = absl::StrCat(latest, ".tmp");
+  TF_RETURN_IF_ERROR(WriteStringToFile(env_, tmp, absl::StrCat(step)));
+  return env_->RenameFile(tmp, latest);
+}
+
+Status EmergencyCheckpointer::Save(
+    int64_t step, const std::vector<std::pair<std::string, Tensor>>& tensors) {
+  if (options_.local_dir.empty()) {
+    return errors::InvalidArgument(
+        "EmergencyCheckpointOptions.local_dir must be set.");
+  }
+  const uint64 start_micros = env_->NowMicros();
+  const std::string step_dir = StepDir(step);
+  if (env_->IsDirectory(step_dir).ok()) {
+    int64_t undeleted_files, undeleted_dirs;
+    TF_RETURN_IF_ERROR(
+        env_->DeleteRecursively(step_dir, &undeleted_files, &undeleted_dirs));
+  }
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(step_dir));
+
+  BundleWriter writer(env_, io::JoinPath(step_dir, kCheckpointBasename));
+  for (const auto& [name, tensor] : tensors) {
+    TF_RETURN_IF_ERROR(writer.Add(name, tensor));
+  }
+  TF_RETURN_IF_ERROR(writer.Finish());
+  TF_RETURN_IF_ERROR(WriteLocalLatest(step));
+
+  // Host memory is scarce, so only the latest step is kept.
+  std::vector<std::string> children;
+  TF_RETURN_IF_ERROR(env_->GetChildren(options_.local_dir, &children));
+  for (const std::string& child : children) {
+    int64_t child_step;
+    if (absl::StartsWith(child, kStepDirPrefix) &&
+        absl::SimpleAtoi(child.substr(strlen(kStepDirPrefix)), &child_step) &&
+        child_step != step) {
+      int64_t undeleted_files, undeleted_dirs;
+      env_->DeleteRecursively(StepDir(child_step), &undeleted_files,
+                              &undeleted_dirs)
+          .IgnoreError();
+    }
+  }
+  const uint64 local_micros = env_->NowMicros();
+  VLOG(1) << "Wrote emergency checkpoint of step " << step << " to "
+          << step_dir << " in " << (local_micros - start_micros) / 1000
+          << " ms.";
+
+  if (agent_ != nullptr && options_.replicate_to_peer) {
+    TF_RETURN_IF_ERROR(Replicate(step, step_dir));
+    VLOG(1) << "Replicated emergency checkpoint of step " << step << " in "
+            << (env_->NowMicros() - local_micros) / 1000 << " ms.";
+  }
+  LOG(INFO) << "Saved emergency checkpoint of step " << step << " in "
+            << (env_->NowMicros() - start_micros) / 1000 << " ms.";
+  return OkStatus();
+}
+
+StatusOr<std::string> EmergencyCheckpointer::PeerKeyRoot() {
+  TF_ASSIGN_OR_RETURN(CoordinatedTask task, agent_->GetOwnTask());
+  return absl::StrCat(kPeerKeyPrefix, task.job_name(), "/", task.task_id());
+}
+
+Status EmergencyCheckpointer::Replicate(int64_t step,
+                                        const std::string& step_dir) {
+  TF_ASSIGN_OR_RETURN(std::string root, PeerKeyRoot());
+  const std::string step_key = absl::StrCat(root, "/", step);
+  // Drop a partial copy of the same step left by an earlier attempt.
+  TF_RETURN_IF_ERROR(agent_->DeleteKeyValue(step_key));
+
+  Manifest manifest;
+  manifest.step = step;
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env_->GetChildren(step_dir, &files));
+  const int64_t max_chunk_bytes =
+      std::max<int64_t>(options_.max_chunk_bytes, 1);
+  // Files are read one chunk at a time, so that replicating does not hold
+  // another copy of the checkpoint in host memory.
+  std::string scratch;
+  for (const std::string& file : files) {
+    const std::string path = io::JoinPath(step_dir, file);
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(env_->GetFileSize(path, &file_size));
+    std::unique_ptr<RandomAccessFile> reader;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(path, &reader));
+    int64_t num_chunks = 0;
+    uint64 offset = 0;
+    do {
+      const size_t chunk_bytes =
+          std::min<uint64>(max_chunk_bytes, file_size - offset);
+      scratch.resize(chunk_bytes);
+      StringPiece chunk;
+      TF_RETURN_IF_ERROR(
+          reader->Read(offset, chunk_bytes, &chunk, &scratch[0]));
+      TF_RETURN_IF_ERROR(agent_->InsertKeyValue(
+          ChunkKey(step_key, file, num_chunks), std::string(chunk)));
+      offset += chunk_bytes;
+      ++num_chunks;
+    } while (offset < file_size);
+    manifest.files.emplace_back(file, num_chunks);
+  }
+
+  // Publish the manifest last, so that a restore never sees a partial copy.
+  const std::string latest_key = absl::StrCat(root, "/", kPeerLatestKey);
+  StatusOr<std::string> previous = agent_->TryGetKeyValue(latest_key);
+  TF_RETURN_IF_ERROR(agent_->DeleteKeyValue(latest_key));
+  TF_RETURN_IF_ERROR(
+      agent_->InsertKeyValue(latest_key, SerializeManifest(manifest)));
+  if (previous.ok()) {
+    StatusOr<Manifest> previous_manifest = ParseManifest(*previous);
+    if (previous_manifest.ok() && previous_manifest->step != step) {
+      TF_RETURN_IF_ERROR(agent_->DeleteKeyValue(
+          absl::StrCat(root, "/", previous_manifest->step)));
+    }
+  }
+  return OkStatus();
+}
+
+StatusOr<std::string> EmergencyCheckpointer::GetLocalRestorePrefix(
+    int64_t* step) {
+  std::string latest;
+  TF_RETURN_IF_ERROR(ReadFileToString(
+      env_, io::JoinPath(options_.local_dir, kLatestFilename), &latest));
+  if (!absl::SimpleAtoi(latest, step)) {
+    return errors::DataLoss("Malformed emergency checkpoint step: ", latest);
+  }
+  std::string prefix = io::JoinPath(StepDir(*step), kCheckpointBasename);
+  BundleReader reader(env_, prefix);
+  TF_RETURN_IF_ERROR(reader.status());
+  return prefix;
+}
+
+StatusOr<std::string> EmergencyCheckpointer::FetchFromPeer(int64_t* step) {
+  TF_ASSIGN_OR_RETURN(std::string root, PeerKeyRoot());
+  TF_ASSIGN_OR_RETURN(
+      std::string text,
+      agent_->TryGetKeyValue(absl::StrCat(root, "/", kPeerLatestKey)));
+  TF_ASSIGN_OR_RETURN(Manifest manifest, ParseManifest(text));
+
+  const std::string step_key = absl::StrCat(root, "/", manifest.step);
+  const std::string step_dir = StepDir(manifest.step);
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(step_dir));
+  for (const auto& [file, num_chunks] : manifest.files) {
+    std::unique_ptr<WritableFile> writer;
+    TF_RETURN_IF_ERROR(
+        env_->NewWritableFile(io::JoinPath(step_dir, file), &writer));
+    for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+      TF_ASSIGN_OR_RETURN(
+          std::string value,
+          agent_->TryGetKeyValue(ChunkKey(step_key, file, chunk)));
+      TF_RETURN_IF_ERROR(writer->Append(value));
+    }
+    TF_RETURN_IF_ERROR(writer->Close());
+  }
+  TF_RETURN_IF_ERROR(WriteLocalLatest(manifest.step));
+  return GetLocalRestorePrefix(step);
+}
+
+Status EmergencyCheckpointer::AgreeOnStep(int64_t step) {
+  TF_ASSIGN_OR_RETURN(CoordinatedTask task, agent_->GetOwnTask());
+  const std::string key = absl::StrCat(kRestoreStepKeyPrefix,
+                                       task.job_name(), "/", task.task_id());
+  TF_RETURN_IF_ERROR(agent_->DeleteKeyValue(key));
+  TF_RETURN_IF_ERROR(agent_->InsertKeyValue(key, absl::StrCat(step)));
+  TF_RETURN_IF_ERROR(agent_->WaitAtBarrier(
+      options_.restore_barrier_id, options_.restore_barrier_timeout, {}));
+  if (step < 0) {
+    return errors::NotFound("No emergency checkpoint found.");
+  }
+  TF_ASSIGN_OR_RETURN(std::vector<KeyValueEntry> steps,
+                      agent_->GetKeyValueDir(kRestoreStepKeyPrefix));
+  for (const KeyValueEntry& entry : steps) {
+    int64_t task_step;
+    if (!absl::SimpleAtoi(entry.value(), &task_step) || task_step != step) {
+      return errors::NotFound("Emergency checkpoint of ", entry.key(),
+                              " is of step ", entry.value(), " instead of ",
+                              step, ".");
+    }
+  }
+  return OkStatus();
+}
+
+StatusOr<std::string> EmergencyCheckpointer::GetRestorePrefix(int64_t* step) {
+  StatusOr<std::string> prefix =
+      errors::NotFound("EmergencyCheckpointOptions.local_dir is not set.");
+  int64_t available_step = -1;
+  if (!options_.local_dir.empty()) {
+    prefix = GetLocalRestorePrefix(&available_step);
+    if (!prefix.ok()) {
+      VLOG(1) << "No local emergency checkpoint: " << prefix.status();
+      // Copied back before agreeing on the step, so that a failed copy makes
+      // all tasks fall back rather than just this one.
+      if (agent_ != nullptr && options_.replicate_to_peer) {
+        prefix = FetchFromPeer(&available_step);
+        if (prefix.ok()) {
+          LOG(INFO) << "Copied emergency checkpoint of step "
+                    << available_step << " from the coordination service.";
+        } else {
+          VLOG(1) << "No replicated emergency checkpoint: " << prefix.status();
+        }
+      }
+    }
+  }
+  if (!prefix.ok()) available_step = -1;
+
+  // Every task only keeps its latest step, so all tasks either restore the
+  // same step or fall back together.
+  if (agent_ != nullptr) {
+    Status agreed = AgreeOnStep(available_step);
+    if (!agreed.ok()) {
+      LOG(INFO) << "Not restoring the emergency checkpoint: " << agreed;
+      prefix = agreed;
+    }
+  }
+  if (!prefix.ok()) {
+    return errors::NotFound(
+        "No emergency checkpoint found; restore from the regular checkpoint.");
+  }
+  *step = available_step;
+  LOG(INFO) << "Restoring emergency checkpoint of step " << *step << " from "
+            << *prefix;
+  return prefix;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,111 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_PREEMPTION_EMERGENCY_CHECKPOINT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_PREEMPTION_EMERGENCY_CHECKPOINT_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_service_agent.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+
+struct EmergencyCheckpointOptions {
+  // Directory the checkpoint is written to. This should be in host memory,
+  // e.g. under /dev/shm, so that saving finishes within a preemption grace
+  // period.
+  std::string local_dir;
+
+  // If true, the checkpoint is also copied into the coordination service
+  // key-value store, so that it survives the loss of this task's host. The
+  // store is held in the memory of the task running the coordination service
+  // leader, so this is only useful if that task survives the preemption and
+  // has memory for the checkpoints of all tasks.
+  bool replicate_to_peer = false;
+
+  // Upper bound on the size of one key-value store entry, so that each copy
+  // fits in a single RPC.
+  int64_t max_chunk_bytes = 2 << 20;
+
+  // Barrier at which all tasks agree on the step to restore. It must not have
+  // been used before in the lifetime of the coordination service.
+  std::string restore_barrier_id = "emergency_checkpoint_restore";
+  absl::Duration restore_barrier_timeout = absl::Minutes(3);
+};
+
+// Saves and restores a fast, short-lived checkpoint of a task's tensors,
+// meant to be taken once PreemptionSyncManager::ReachedSyncPoint() returns
+// true, when a regular save to remote storage may not finish before the task
+// is killed. Example:
+//
+//   if (preempt_sync_mgr->ReachedSyncPoint(step)) {
+//     TF_RETURN_IF_ERROR(checkpointer.Save(step, variables));
+//   }
+//
+// The checkpoint is a tensor bundle, the format of regular checkpoints,
+// written under `local_dir` and optionally replicated to the coordination
+// service. Only the latest step is kept in either place. After a restart,
+// GetRestorePrefix() returns a prefix to restore from, preferring the local
+// copy over the replicated one; callers fall back to the regular checkpoint
+// if neither exists. With a coordination service agent, all tasks restore
+// the emergency checkpoint only if they all have one of the same step.
+//
+// Replicated copies are keyed by the job name and task id of this task, so a
+// restarted task finds the copy of the task it replaces.
+//
+// Not thread-safe.
+class EmergencyCheckpointer {
+ public:
+  // `agent` may be null, in which case nothing is replicated. If set, it must
+  // be initialized, and must outlive this object.
+  EmergencyCheckpointer(Env* env, CoordinationServiceAgent* agent,
+                        EmergencyCheckpointOptions options)
+      : env_(env), agent_(agent), options_(std::move(options)) {}
+
+  // Writes `tensors`, keyed by name, as the checkpoint of `step`, replacing
+  // any previous emergency checkpoint.
+  Status Save(int64_t step,
+              const std::vector<std::pair<std::string, Tensor>>& tensors);
+
+  // Returns the prefix of the latest emergency checkpoint, and its step in
+  // `step`. If only the replicated copy exists, it is first copied back under
+  // `local_dir`. Returns NotFound if there is no emergency checkpoint. With an
+  // agent, this waits for all tasks to call it, and also returns NotFound if
+  // any task has no emergency checkpoint or one of a different step.
+  StatusOr<std::string> GetRestorePrefix(int64_t* step);
+
+ private:
+  std::string StepDir(int64_t step) const;
+  Status WriteLocalLatest(int64_t step);
+  StatusOr<std::string> GetLocalRestorePrefix(int64_t* step);
+  StatusOr<std::string> PeerKeyRoot();
+  Status Replicate(int64_t step, const std::string& step_dir);
+  StatusOr<std::string> FetchFromPeer(int64_t* step);
+  Status AgreeOnStep(int64_t step);
+
+  Env* const env_;
+  CoordinationServiceAgent* const agent_;
+  const EmergencyCheckpointOptions options_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_PREEMPTION_EMERGENCY_CHECKPOINT_H_
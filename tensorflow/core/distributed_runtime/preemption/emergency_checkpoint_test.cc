@@ -0,0 +1,237 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/preemption/emergency_checkpoint.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "grpcpp/support/channel_arguments.h"
+#include "absl/memory/memory.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_client.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_service.h"
+#include "tensorflow/core/distributed_runtime/coordination/coordination_service_agent.h"
+#include "tensorflow/core/distributed_runtime/rpc/async_service_interface.h"
+#include "tensorflow/core/distributed_runtime/rpc/coordination/grpc_coordination_client.h"
+#include "tensorflow/core/distributed_runtime/rpc/coordination/grpc_coordination_service_impl.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/coordination_config.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kJobName[] = "test_worker";
+
+class EmergencyCheckpointTest : public ::testing::Test {
+ protected:
+  EmergencyCheckpointTest() {
+    local_dir_ = io::JoinPath(testing::TmpDir(), "emergency_checkpoint");
+    DeleteLocalCopy();
+    StartCoordinationService();
+    InitializeCoordinationAgent();
+  }
+  ~EmergencyCheckpointTest() override {
+    // Tear down coordination service objects in order.
+    coord_agent_ = nullptr;
+    coord_service_ = nullptr;
+    grpc_server_->Shutdown();
+    coord_rpc_service_->Shutdown();
+  }
+
+  EmergencyCheckpointer MakeCheckpointer(bool with_agent,
+                                         int64_t max_chunk_bytes = 2 << 20) {
+    EmergencyCheckpointOptions options;
+    options.local_dir = local_dir_;
+    options.replicate_to_peer = true;
+    options.max_chunk_bytes = max_chunk_bytes;
+    return EmergencyCheckpointer(Env::Default(),
+                                 with_agent ? coord_agent_.get() : nullptr,
+                                 options);
+  }
+
+  void DeleteLocalCopy() {
+    int64_t undeleted_files, undeleted_dirs;
+    Env::Default()
+        ->DeleteRecursively(local_dir_, &undeleted_files, &undeleted_dirs)
+        .IgnoreError();
+  }
+
+  std::vector<std::pair<std::string, Tensor>> Variables(float offset) {
+    return {{"bias", test::AsTensor<float>({offset, offset + 1})},
+            {"kernel", test::AsTensor<float>({offset, offset + 1, offset + 2,
+                                              offset + 3},
+                                             TensorShape({2, 2}))}};
+  }
+
+  void ExpectRestoresVariables(EmergencyCheckpointer& checkpointer,
+                               int64_t expected_step, float offset) {
+    int64_t step = -1;
+    TF_ASSERT_OK_AND_ASSIGN(std::string prefix,
+                            checkpointer.GetRestorePrefix(&step));
+    EXPECT_EQ(step, expected_step);
+    BundleReader reader(Env::Default(), prefix);
+    TF_ASSERT_OK(reader.status());
+    for (const auto& [name, expected] : Variables(offset)) {
+      Tensor restored;
+      TF_ASSERT_OK(reader.Lookup(name, &restored));
+      test::ExpectTensorEqual<float>(restored, expected);
+    }
+  }
+
+  std::string local_dir_;
+  std::unique_ptr<CoordinationServiceAgent> coord_agent_ =
+      CreateCoordinationServiceAgent();
+
+ private:
+  // Utility methods to set up coordination service and agents.
+  void StartCoordinationService() {
+    ::grpc::ServerBuilder builder;
+    ServerDef server_def;
+    server_def.set_protocol("grpc");
+    server_def.set_job_name(kJobName);
+    server_def.set_task_index(0);
+    auto job_def = server_def.mutable_cluster()->add_job();
+    job_def->set_name(kJobName);
+    job_def->mutable_tasks()->insert({1, "TEST_ADDRESS_1"});
+    auto coordination_config = server_def.mutable_default_session_config()
+                                   ->mutable_experimental()
+                                   ->mutable_coordination_config();
+    coordination_config->set_service_type("standalone");
+    coord_service_ = CoordinationServiceInterface::EnableCoordinationService(
+        "standalone", Env::Default(), server_def, /*cache=*/nullptr);
+    coord_compute_pool_ = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "CoordinationServiceRpcHandler",
+        /*num_threads=*/1);
+    coord_rpc_service_ = std::make_unique<GrpcCoordinationServiceImpl>(
+        coord_compute_pool_.get(), &builder);
+    grpc_server_ = builder.BuildAndStart();
+    coord_rpc_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        /*thread_options=*/{}, /*name=*/"CoordinationServiceHandleRPCsLoop",
+        [service = coord_rpc_service_.get()]() { service->HandleRPCsLoop(); }));
+  }
+  void InitializeCoordinationAgent() {
+    std::unique_ptr<CoordinationClient> coord_client =
+        absl::WrapUnique(NewGrpcCoordinationClient(
+            grpc_server_->InProcessChannel(::grpc::ChannelArguments())));
+    auto error_fn = [](const Status& status) {
+      LOG(ERROR) << "Coordination service agent in error status: " << status;
+    };
+    CoordinationServiceConfig coord_config;
+    coord_config.set_service_leader("test_leader");
+    TF_CHECK_OK(coord_agent_->Initialize(Env::Default(), kJobName,
+                                         /*task_id=*/1, coord_config,
+                                         std::move(coord_client), error_fn));
+    TF_CHECK_OK(coord_agent_->Connect());
+  }
+
+  std::unique_ptr<CoordinationServiceInterface> coord_service_;
+  std::unique_ptr<::grpc::Server> grpc_server_;
+  std::unique_ptr<thread::ThreadPool> coord_compute_pool_;
+  std::unique_ptr<AsyncServiceInterface> coord_rpc_service_;
+  std::unique_ptr<Thread> coord_rpc_thread_;
+};
+
+TEST_F(EmergencyCheckpointTest, NoCheckpoint_NotFound) {
+  EmergencyCheckpointer checkpointer = MakeCheckpointer(/*with_agent=*/true);
+  int64_t step;
+  EXPECT_TRUE(
+      errors::IsNotFound(checkpointer.GetRestorePrefix(&step).status()));
+}
+
+TEST_F(EmergencyCheckpointTest, RestoresLocalCopy) {
+  EmergencyCheckpointer checkpointer = MakeCheckpointer(/*with_agent=*/false);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/5, Variables(1.0f)));
+
+  // A restarted task on the same host finds the copy in local memory.
+  EmergencyCheckpointer restarted = MakeCheckpointer(/*with_agent=*/false);
+  ExpectRestoresVariables(restarted, /*expected_step=*/5, 1.0f);
+}
+
+TEST_F(EmergencyCheckpointTest, KeepsOnlyLatestStep) {
+  EmergencyCheckpointer checkpointer = MakeCheckpointer(/*with_agent=*/true);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/5, Variables(1.0f)));
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/6, Variables(10.0f)));
+
+  EXPECT_TRUE(errors::IsNotFound(
+      Env::Default()->FileExists(io::JoinPath(local_dir_, "step_5"))));
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<KeyValueEntry> entries,
+      coord_agent_->GetKeyValueDir("EMERGENCY_CHECKPOINT/test_worker/1/5"));
+  EXPECT_TRUE(entries.empty());
+  ExpectRestoresVariables(checkpointer, /*expected_step=*/6, 10.0f);
+}
+
+TEST_F(EmergencyCheckpointTest, RestoresReplicatedCopyIfLocalCopyIsLost) {
+  // Small chunks, so that every file is split across several entries.
+  EmergencyCheckpointer checkpointer =
+      MakeCheckpointer(/*with_agent=*/true, /*max_chunk_bytes=*/16);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/7, Variables(2.0f)));
+
+  // The task is rescheduled on a host without the local copy.
+  DeleteLocalCopy();
+  EmergencyCheckpointer restarted =
+      MakeCheckpointer(/*with_agent=*/true, /*max_chunk_bytes=*/16);
+  ExpectRestoresVariables(restarted, /*expected_step=*/7, 2.0f);
+}
+
+TEST_F(EmergencyCheckpointTest, DoesNotReplicateByDefault) {
+  EmergencyCheckpointOptions options;
+  options.local_dir = local_dir_;
+  EmergencyCheckpointer checkpointer(Env::Default(), coord_agent_.get(),
+                                     options);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/5, Variables(1.0f)));
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<KeyValueEntry> entries,
+      coord_agent_->GetKeyValueDir("EMERGENCY_CHECKPOINT/test_worker/1"));
+  EXPECT_TRUE(entries.empty());
+}
+
+TEST_F(EmergencyCheckpointTest, OtherTaskWithDifferentStep_NotFound) {
+  EmergencyCheckpointer checkpointer = MakeCheckpointer(/*with_agent=*/true);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/5, Variables(1.0f)));
+  // Another task was killed before it saved step 5.
+  TF_ASSERT_OK(coord_agent_->InsertKeyValue(
+      "EMERGENCY_CHECKPOINT_RESTORE/test_worker/0", "4"));
+
+  int64_t step;
+  EXPECT_TRUE(
+      errors::IsNotFound(checkpointer.GetRestorePrefix(&step).status()));
+}
+
+TEST_F(EmergencyCheckpointTest, NoReplication_LostLocalCopyIsNotFound) {
+  EmergencyCheckpointer checkpointer = MakeCheckpointer(/*with_agent=*/false);
+  TF_ASSERT_OK(checkpointer.Save(/*step=*/5, Variables(1.0f)));
+  DeleteLocalCopy();
+
+  EmergencyCheckpointer restarted = MakeCheckpointer(/*with_agent=*/true);
+  int64_t step;
+  EXPECT_TRUE(errors::IsNotFound(restarted.GetRestorePrefix(&step).status()));
+}
+
+}  // namespace
+}  // namespace tensorflow
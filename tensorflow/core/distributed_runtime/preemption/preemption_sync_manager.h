@@ -58,6 +58,8 @@ class PreemptionSyncManager {
   // task. Once a preemption notice is received, all tasks will agree on a safe
   // step to pause training and handle the preemption (e.g. save checkpoint and
   // exit, or wait for preempted task to restart, then resume training).
+  // EmergencyCheckpointer saves a checkpoint to host memory that is fast
+  // enough to finish within the preemption grace period.
   virtual bool ReachedSyncPoint(int step_counter) = 0;
 };
 
@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -195,8 +196,11 @@ using CachingGrpcChannelCache = GenericCachingChannelCache<GrpcChannelCache>;
 class MultiGrpcChannelCache : public CachingGrpcChannelCache {
  public:
   explicit MultiGrpcChannelCache(const std::vector<GrpcChannelCache*>& caches,
-                                 int num_channels_per_target)
-      : CachingGrpcChannelCache(num_channels_per_target), caches_(caches) {}
+                                 int num_channels_per_target,
+                                 int max_channels_per_target)
+      : CachingGrpcChannelCache(num_channels_per_target,
+                                max_channels_per_target),
+        caches_(caches) {}
 
   ~MultiGrpcChannelCache() override {
     for (GrpcChannelCache* cache : caches_) {
@@ -217,6 +221,20 @@ class MultiGrpcChannelCache : public CachingGrpcChannelCache {
     }
   }
 
+  SharedGrpcChannelPtr FindWorkerChannel(const string& target) override {
+    if (!AdaptsChannelsToLoad()) {
+      return CachingGrpcChannelCache::FindWorkerChannel(target);
+    }
+    // The per-job caches already adapt the number of channels to the load,
+    // so do not pin a fixed set of their channels here.
+    GrpcChannelCache* cache;
+    {
+      mutex_lock l(mu_);
+      cache = gtl::FindPtrOrNull(target_caches_, target);
+    }
+    return cache ? cache->FindWorkerChannel(target) : FindChannelOnce(target);
+  }
+
   string TranslateTask(const string& target) override {
     mutex_lock l(mu_);  // could use reader lock
     GrpcChannelCache* cache = gtl::FindPtrOrNull(target_caches_, target);
@@ -264,8 +282,10 @@ class SparseGrpcChannelCache : public CachingGrpcChannelCache {
   SparseGrpcChannelCache(const string& job_id,
                          const std::map<int, string>& host_ports,
                          ChannelCreationFunction channel_func,
-                         int num_channels_per_target)
-      : CachingGrpcChannelCache(num_channels_per_target),
+                         int num_channels_per_target,
+                         int max_channels_per_target)
+      : CachingGrpcChannelCache(num_channels_per_target,
+                                max_channels_per_target),
         job_id_(job_id),
         host_ports_(host_ports),
         channel_func_(std::move(channel_func)) {
@@ -352,17 +372,26 @@ GrpcChannelCache* NewGrpcChannelCache(const GrpcChannelSpec& spec,
     LOG(ERROR) << "Empty channel spec.";
     return nullptr;
   }
+  int64_t max_channels_per_target;
+  Status status = ReadInt64FromEnvVar("TF_GRPC_MAX_CHANNELS_PER_TARGET", 0,
+                                      &max_channels_per_target);
+  if (!status.ok()) {
+    LOG(ERROR) << "Error parsing TF_GRPC_MAX_CHANNELS_PER_TARGET: " << status;
+    max_channels_per_target = 0;
+  }
   std::vector<GrpcChannelCache*> caches;
   caches.reserve(num_jobs);
   for (auto& job : spec.host_ports_jobs()) {
     VLOG(2) << "Creating Grpc Channel Cache for: " << job.job_id;
-    caches.push_back(
-        new SparseGrpcChannelCache(job.job_id, job.host_ports, channel_func,
-                                   options.num_channels_per_target()));
+    caches.push_back(new SparseGrpcChannelCache(
+        job.job_id, job.host_ports, channel_func,
+        options.num_channels_per_target(), max_channels_per_target));
   }
-  return caches.size() == 1 ? caches[0]
-                            : new MultiGrpcChannelCache(
-                                  caches, options.num_channels_per_target());
+  return caches.size() == 1
+             ? caches[0]
+             : new MultiGrpcChannelCache(caches,
+                                         options.num_channels_per_target(),
+                                         max_channels_per_target);
 }
 
 }  // end namespace tensorflow
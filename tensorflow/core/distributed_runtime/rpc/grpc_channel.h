@@ -77,10 +77,20 @@ class GrpcChannelCache {
 
   // Translates a string in the form `/job:X/task:Z` into a host_port.
   virtual string TranslateTask(const string& task) = 0;
+
+  // Returns true if FindWorkerChannel balances callers over a number of
+  // channels per target that grows with the number of channels they hold.
+  // Callers should then look up a channel for each RPC and hold it only
+  // until the RPC completes.
+  virtual bool AdaptsChannelsToLoad() const { return false; }
 };
 
 typedef std::function<SharedGrpcChannelPtr(string)> ChannelCreationFunction;
 
+// If the environment variable TF_GRPC_MAX_CHANNELS_PER_TARGET is larger than
+// `rpc_options.num_channels_per_target()`, the returned cache starts with
+// `num_channels_per_target` channels per target and opens more, up to that
+// limit, as the load on a target grows.
 GrpcChannelCache* NewGrpcChannelCache(
     const GrpcChannelSpec& channel_spec, ChannelCreationFunction channel_func,
     const RPCOptions& rpc_options = RPCOptions());
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CHANNEL_COMMON_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CHANNEL_COMMON_H_
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
@@ -32,23 +33,47 @@ namespace tensorflow {
 // same target to provide throughput gains. When multiple channels exist for
 // the same target they are chosen in a simple round robin fashion on each call
 // to FindWorkerChannel.
+//
+// If `max_channels_per_target` exceeds `num_channels_per_target`, the number
+// of channels per target adapts to the load instead: FindWorkerChannel returns
+// the channel with the fewest outstanding holders, and opens another channel
+// (up to `max_channels_per_target`) once every channel to the target is held
+// by at least `kMaxLoadPerChannel` callers. Callers such as GrpcRemoteWorker
+// hold the channel for as long as they issue RPCs on it, so the number of
+// holders tracks the number of concurrent RPCs to the peer.
 template <typename ChannelCacheT>
 class GenericCachingChannelCache : public ChannelCacheT {
  public:
-  explicit GenericCachingChannelCache(int num_channels_per_target)
+  // Close to the default HTTP/2 limit of 100 concurrent streams per
+  // connection, leaving headroom for short-lived calls.
+  static constexpr int kMaxLoadPerChannel = 64;
+
+  explicit GenericCachingChannelCache(int num_channels_per_target,
+                                      int max_channels_per_target = 0)
       : num_channels_per_target_(
-            num_channels_per_target > 0 ? num_channels_per_target : 1) {}
+            num_channels_per_target > 0 ? num_channels_per_target : 1),
+        max_channels_per_target_(
+            std::max(num_channels_per_target_, max_channels_per_target)) {}
 
   ~GenericCachingChannelCache() override {}
 
+  bool AdaptsChannelsToLoad() const override { return adaptive(); }
+
   SharedGrpcChannelPtr FindWorkerChannel(const string& target) override {
     {
       mutex_lock l(mu_);
       auto iter = channels_.find(target);
       if (iter != channels_.end()) {
-        return GetNextChannelPtrAndUpdateState(iter->second);
+        if (!adaptive()) {
+          return GetNextChannelPtrAndUpdateState(iter->second);
+        }
+        const SharedGrpcChannelPtr& ch = GetLeastLoadedChannel(iter->second);
+        if (!ShouldAddChannel(iter->second, ch)) return ch;
       }
     }
+    if (adaptive()) {
+      return AddChannel(target);
+    }
     ChannelState new_chan_state;
     for (int indx = 0; indx < num_channels_per_target_; indx++) {
       auto ch = FindChannelOnce(target);
@@ -71,16 +96,81 @@ class GenericCachingChannelCache : public ChannelCacheT {
 
  protected:
   // Find the ClientChannel for "target".  Only called when no channel was
-  // found in the channels_ cache for "target".  A non nullptr result will be
-  // cached in channels_.
+  // found in the channels_ cache for "target", or when an adaptive cache
+  // opens another channel to it.  A non nullptr result will be cached in
+  // channels_.
   virtual SharedGrpcChannelPtr FindChannelOnce(const string& target) = 0;
 
  private:
   struct ChannelState {
     std::vector<SharedGrpcChannelPtr> channels;
-    int last_used;
+    int last_used = 0;
   };
 
+  bool adaptive() const {
+    return max_channels_per_target_ > num_channels_per_target_;
+  }
+
+  // Outstanding holders of `ch` other than this cache.
+  static long Load(const SharedGrpcChannelPtr& ch) {
+    return ch.use_count() - 1;
+  }
+
+  // Should be called with mu_ held.
+  const SharedGrpcChannelPtr& GetLeastLoadedChannel(
+      const ChannelState& chan_state) {
+    const SharedGrpcChannelPtr* best = &chan_state.channels[0];
+    for (const SharedGrpcChannelPtr& ch : chan_state.channels) {
+      if (Load(ch) < Load(*best)) best = &ch;
+    }
+    return *best;
+  }
+
+  // Should be called with mu_ held.
+  bool ShouldAddChannel(const ChannelState& chan_state,
+                        const SharedGrpcChannelPtr& least_loaded) {
+    return static_cast<int>(chan_state.channels.size()) <
+               max_channels_per_target_ &&
+           Load(least_loaded) >= kMaxLoadPerChannel;
+  }
+
+  // Opens one more channel to `target`, or the initial
+  // `num_channels_per_target_` channels if there are none yet, and returns
+  // the least loaded channel afterwards. The channels are created without
+  // holding mu_, so concurrent callers may race to add a channel; the cache
+  // keeps at most `max_channels_per_target_` of them.
+  SharedGrpcChannelPtr AddChannel(const string& target) {
+    int num_to_add = 1;
+    {
+      mutex_lock l(mu_);
+      if (channels_.find(target) == channels_.end()) {
+        num_to_add = num_channels_per_target_;
+      }
+    }
+    std::vector<SharedGrpcChannelPtr> added;
+    for (int i = 0; i < num_to_add; ++i) {
+      auto ch = FindChannelOnce(target);
+      if (!ch) break;
+      added.push_back(std::move(ch));
+    }
+    mutex_lock l(mu_);
+    ChannelState& chan_state = channels_[target];
+    for (SharedGrpcChannelPtr& ch : added) {
+      if (static_cast<int>(chan_state.channels.size()) >=
+          max_channels_per_target_) {
+        break;
+      }
+      chan_state.channels.push_back(std::move(ch));
+    }
+    if (chan_state.channels.empty()) {
+      channels_.erase(target);
+      return nullptr;
+    }
+    VLOG(2) << "Channel cache for target: " << target
+            << " Size: " << chan_state.channels.size();
+    return GetLeastLoadedChannel(chan_state);
+  }
+
   // Should be called with mu_ held.
   SharedGrpcChannelPtr GetNextChannelPtrAndUpdateState(
       ChannelState& chan_state) {
@@ -93,6 +183,7 @@ class GenericCachingChannelCache : public ChannelCacheT {
   }
 
   const int num_channels_per_target_;
+  const int max_channels_per_target_;
   // TODO(zhifengc): Eviction when the map becomes too big.
   mutex mu_;
   absl::flat_hash_map<string, ChannelState> channels_ TF_GUARDED_BY(mu_);
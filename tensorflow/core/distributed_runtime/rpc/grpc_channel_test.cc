@@ -15,9 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_channel.h"
 
+#include <set>
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/distributed_runtime/rpc/grpc_channel_common.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -199,6 +201,49 @@ TEST(GrpcChannelTest, HostPortsMultiChannelPerTarget) {
   }
 }
 
+TEST(GrpcChannelTest, HostPortsAdaptiveChannelsPerTarget) {
+  setenv("TF_GRPC_MAX_CHANNELS_PER_TARGET", "3", /*overwrite=*/1);
+  GrpcChannelSpec spec;
+  TF_EXPECT_OK(spec.AddHostPortsJob("mnist", {"a:1", "b:2", "c:3"}));
+  TF_EXPECT_OK(spec.AddHostPortsJob("mnist2", {"a:1", "b:2", "c:3"}));
+  ChannelCreationFunction channel_func =
+      ConvertToChannelCreationFunction(NewHostPortGrpcChannel);
+  std::unique_ptr<GrpcChannelCache> cc(
+      NewGrpcChannelCache(spec, channel_func, RPCOptions()));
+  unsetenv("TF_GRPC_MAX_CHANNELS_PER_TARGET");
+  ASSERT_TRUE(cc->AdaptsChannelsToLoad());
+  EXPECT_EQ(nullptr, cc->FindWorkerChannel("/job:other/replica:0/task:0"));
+
+  for (const string target :
+       {"/job:mnist/replica:0/task:0", "/job:mnist2/replica:0/task:0"}) {
+    // While few callers hold channels, a single channel is shared.
+    std::vector<SharedGrpcChannelPtr> held;
+    using CachingChannelCache = GenericCachingChannelCache<GrpcChannelCache>;
+    const int max_load = CachingChannelCache::kMaxLoadPerChannel;
+    for (int i = 0; i < max_load; ++i) {
+      held.push_back(cc->FindWorkerChannel(target));
+      ASSERT_NE(nullptr, held.back()) << target;
+      EXPECT_EQ(held[0].get(), held.back().get()) << target;
+    }
+
+    // Once the channel is fully loaded, new callers get fresh channels, up
+    // to TF_GRPC_MAX_CHANNELS_PER_TARGET, and are then balanced over them.
+    std::set<grpc::Channel*> distinct;
+    for (int i = 0; i < 4 * max_load; ++i) {
+      held.push_back(cc->FindWorkerChannel(target));
+      distinct.insert(held.back().get());
+    }
+    distinct.insert(held[0].get());
+    EXPECT_EQ(3, distinct.size()) << target;
+
+    // Released channels are preferred again.
+    held.clear();
+    SharedGrpcChannelPtr a = cc->FindWorkerChannel(target);
+    SharedGrpcChannelPtr b = cc->FindWorkerChannel(target);
+    EXPECT_NE(a.get(), b.get()) << target;
+  }
+}
+
 TEST(GrpcChannelTest, HostPortsMultiGrpcMultiChannelPerTarget) {
   GrpcChannelSpec spec;
   TF_EXPECT_OK(spec.AddHostPortsJob("mnist", {"a:1", "b:2", "c:3"}));
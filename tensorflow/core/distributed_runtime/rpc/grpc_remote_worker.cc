@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -40,13 +41,27 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+auto* rpc_latency_usecs = monitoring::Sampler<2>::New(
+    {"/tensorflow/core/grpc_remote_worker/rpc_latency_usecs",
+     "The wall-clock time of WorkerService RPCs issued to a peer, from the "
+     "start of the call until its callback runs, in microseconds.",
+     "peer", "method"},
+    // Power of 2 with bucket count 24 (> 8 seconds)
+    {monitoring::Buckets::Exponential(1, 2, 24)});
+
+}  // namespace
+
 class GrpcRemoteWorker : public WorkerInterface {
  public:
   explicit GrpcRemoteWorker(SharedGrpcChannelPtr channel,
                             ::grpc::CompletionQueue* completion_queue,
                             thread::ThreadPool* callback_threadpool,
-                            WorkerCacheLogger* logger, const string& target)
+                            WorkerCacheLogger* logger, const string& target,
+                            GrpcChannelProvider channel_provider)
       : channel_(std::move(channel)),
+        channel_provider_(std::move(channel_provider)),
         stub_(channel_),
         cq_(completion_queue),
         callback_threadpool_(callback_threadpool),
@@ -66,6 +81,7 @@ class GrpcRemoteWorker : public WorkerInterface {
         instancesource_(Method(GrpcWorkerMethod::kCompleteInstance)),
         getstepsequence_(Method(GrpcWorkerMethod::kGetStepSequence)),
         markrecvfinished_(Method(GrpcWorkerMethod::kMarkRecvFinished)),
+        recvtensors_(Method(GrpcWorkerMethod::kRecvTensors)),
         logger_(logger),
         target_(target) {}
 
@@ -256,6 +272,13 @@ class GrpcRemoteWorker : public WorkerInterface {
     IssueRequest(request, response, recvtensor_, callback, call_opts);
   }
 
+  void RecvTensorsAsync(CallOptions* call_opts,
+                        const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    IssueRequest(request, response, recvtensors_, std::move(done), call_opts);
+  }
+
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override {
     IssueRequest(request, response, logging_, done);
@@ -273,20 +296,47 @@ class GrpcRemoteWorker : public WorkerInterface {
                     protobuf::Message* response, const ::grpc::string& method,
                     StatusCallback done, CallOptions* call_opts = nullptr,
                     bool fail_fast = true) {
+    ::grpc::GenericStub* stub = PrepareCall(method, &done);
     new RPCState<protobuf::Message>(
-        &stub_, cq_, method, *request, response, std::move(done), call_opts,
+        stub, cq_, method, *request, response, std::move(done), call_opts,
         callback_threadpool_, MaxRetries(), fail_fast, &target_);
   }
 
   void IssueRequest(const protobuf::Message* request, TensorResponse* response,
                     const ::grpc::string& method, StatusCallback done,
                     CallOptions* call_opts = nullptr) {
-    new RPCState<TensorResponse>(&stub_, cq_, method, *request, response,
+    ::grpc::GenericStub* stub = PrepareCall(method, &done);
+    new RPCState<TensorResponse>(stub, cq_, method, *request, response,
                                  std::move(done), call_opts,
                                  callback_threadpool_, MaxRetries(),
                                  /*fail_fast=*/true, &target_);
   }
 
+  // Wraps `*done` to record the latency of the call, and returns the stub to
+  // issue it on. With a channel provider, the call holds its own stub and
+  // channel until `*done` runs, so the provider sees it as outstanding load.
+  ::grpc::GenericStub* PrepareCall(const ::grpc::string& method,
+                                   StatusCallback* done) {
+    ::grpc::GenericStub* stub = &stub_;
+    std::unique_ptr<::grpc::GenericStub> owned_stub;
+    if (channel_provider_) {
+      SharedGrpcChannelPtr channel = channel_provider_();
+      if (channel) {
+        owned_stub.reset(new ::grpc::GenericStub(std::move(channel)));
+        stub = owned_stub.get();
+      }
+    }
+    auto* cell = rpc_latency_usecs->GetCell(target_, method);
+    const uint64 start_micros = Env::Default()->NowMicros();
+    *done = [cell, start_micros, owned_stub = owned_stub.release(),
+             done = std::move(*done)](const Status& s) {
+      cell->Add(Env::Default()->NowMicros() - start_micros);
+      delete owned_stub;
+      done(s);
+    };
+    return stub;
+  }
+
   void IssueMarkRecvFinishedRequest(int64_t request_id) {
     VLOG(2) << "Send MarkRecvFinishedRequest for request " << request_id;
     MarkRecvFinishedRequest request;
@@ -309,6 +359,7 @@ class GrpcRemoteWorker : public WorkerInterface {
   }
 
   SharedGrpcChannelPtr channel_;
+  const GrpcChannelProvider channel_provider_;
   ::grpc::GenericStub stub_;
   ::grpc::CompletionQueue* cq_;
   thread::ThreadPool* callback_threadpool_;
@@ -329,6 +380,7 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::string instancesource_;
   const ::grpc::string getstepsequence_;
   const ::grpc::string markrecvfinished_;
+  const ::grpc::string recvtensors_;
 
   // Support for logging.
   WorkerCacheLogger* logger_;
@@ -341,9 +393,11 @@ WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
                                      ::grpc::CompletionQueue* completion_queue,
                                      thread::ThreadPool* callback_threadpool,
                                      WorkerCacheLogger* logger,
-                                     const string& target) {
+                                     const string& target,
+                                     GrpcChannelProvider channel_provider) {
   return new GrpcRemoteWorker(std::move(channel), completion_queue,
-                              callback_threadpool, logger, target);
+                              callback_threadpool, logger, target,
+                              std::move(channel_provider));
 }
 
 }  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_REMOTE_WORKER_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_REMOTE_WORKER_H_
 
+#include <functional>
 #include <memory>
 
 #include "grpcpp/completion_queue.h"
@@ -26,11 +27,18 @@ namespace tensorflow {
 class WorkerCacheLogger;
 class WorkerInterface;
 
-WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
-                                     ::grpc::CompletionQueue* completion_queue,
-                                     thread::ThreadPool* callback_threadpool,
-                                     WorkerCacheLogger* logger,
-                                     const string& target);
+// Returns a channel to the remote worker for a single RPC. The returned
+// channel is held until the RPC completes.
+using GrpcChannelProvider = std::function<SharedGrpcChannelPtr()>;
+
+// If `channel_provider` is set, every RPC issued by the returned worker runs
+// on a channel obtained from it, and `channel` is only used when the
+// provider returns null. This lets a load-aware channel cache spread the
+// RPCs to one peer over a varying number of channels.
+WorkerInterface* NewGrpcRemoteWorker(
+    SharedGrpcChannelPtr channel, ::grpc::CompletionQueue* completion_queue,
+    thread::ThreadPool* callback_threadpool, WorkerCacheLogger* logger,
+    const string& target, GrpcChannelProvider channel_provider = nullptr);
 
 }  // namespace tensorflow
 
@@ -286,6 +286,35 @@ TEST(GrpcSessionTest, FetchMultipleTimes) {
   TF_CHECK_OK(session->Close());
 }
 
+TEST(GrpcSessionTest, RegisterStepTemplates) {
+  GraphDef graph;
+  string node_names[3];
+  // c = a * b
+  CreateGraphDef(&graph, node_names);
+
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
+
+  SessionOptions options = Options(cluster->targets()[0], 1);
+  options.config.mutable_experimental()->set_register_step_templates(true);
+  std::unique_ptr<Session> session(NewRemote(options));
+  ASSERT_TRUE(session != nullptr);
+
+  TF_CHECK_OK(session->Create(graph));
+  // The first step registers the templates and later steps only send the
+  // feed values, which must still reach the right partitions.
+  for (int iters = 0; iters < 5; ++iters) {
+    Tensor a_tensor(DT_FLOAT, TensorShape({1, 2}));
+    test::FillValues<float>(&a_tensor, {1.0f * iters, 2});
+    std::vector<std::pair<string, Tensor>> inputs = {{node_names[0], a_tensor}};
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run(inputs, {node_names[2] + ":0"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    IsSingleFloatValue(outputs[0], 2.0f * iters + 2.0f);
+  }
+  TF_CHECK_OK(session->Close());
+}
+
 TEST(GrpcSessionTest, DisableOutputPartitionGraphs) {
   GraphDef graph;
   string node_names[3];
@@ -60,9 +60,16 @@ class GrpcWorkerCache : public WorkerCachePartial {
         return nullptr;
       }
       size_t index = AssignWorkerToThread(target);
+      GrpcChannelProvider channel_provider;
+      if (channel_cache_->AdaptsChannelsToLoad()) {
+        channel_provider = [channel_cache = channel_cache_, target]() {
+          return channel_cache->FindWorkerChannel(target);
+        };
+      }
       return NewGrpcRemoteWorker(
           channel, worker_env_->GetCompletionQueue(index),
-          worker_env_->GetThreadPool(), &logger_, target);
+          worker_env_->GetThreadPool(), &logger_, target,
+          std::move(channel_provider));
     }
   }
 
@@ -130,9 +137,31 @@ GrpcWorkerEnv::GrpcWorkerEnv(size_t num_completion_queues, size_t num_threads)
     : threadpool_(new thread::ThreadPool(
           Env::Default(), ThreadOptions(), "GrpcWorkerEnvQueues", num_threads,
           /*low_latency_hint=*/false, /*allocator=*/nullptr)),
+      num_completion_queues_(num_completion_queues),
       threads_(num_completion_queues) {}
 
-GrpcWorkerEnv::~GrpcWorkerEnv() { threads_.clear(); }
+GrpcWorkerEnv::~GrpcWorkerEnv() {
+  mutex_lock l(mu_);
+  threads_.clear();
+}
+
+::grpc::CompletionQueue* GrpcWorkerEnv::GetCompletionQueue(size_t index) const {
+  mutex_lock l(mu_);
+  std::unique_ptr<GrpcWorkerCacheThread>& thread = threads_.at(index);
+  if (thread == nullptr) {
+    thread.reset(new GrpcWorkerCacheThread);
+  }
+  return thread->completion_queue();
+}
+
+size_t GrpcWorkerEnv::NumActiveCompletionQueues() const {
+  mutex_lock l(mu_);
+  size_t num_active = 0;
+  for (const auto& thread : threads_) {
+    if (thread != nullptr) ++num_active;
+  }
+  return num_active;
+}
 
 GrpcWorkerEnv::GrpcWorkerCacheThread::GrpcWorkerCacheThread() {
   thread_.reset(Env::Default()->StartThread(
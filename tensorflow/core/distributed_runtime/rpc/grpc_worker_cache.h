@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_client_cq_tag.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
@@ -32,11 +33,16 @@ class GrpcWorkerEnv {
 
   thread::ThreadPool* GetThreadPool() const { return threadpool_.get(); }
 
-  size_t CompletionQueueSize() const { return threads_.size(); }
+  size_t CompletionQueueSize() const { return num_completion_queues_; }
 
-  ::grpc::CompletionQueue* GetCompletionQueue(size_t index) const {
-    return threads_.at(index).completion_queue();
-  }
+  // The thread polling a completion queue is only started the first time
+  // the queue is requested, so a job talking to few peers does not pay for
+  // `num_completion_queues` idle threads.
+  ::grpc::CompletionQueue* GetCompletionQueue(size_t index) const;
+
+  // Returns the number of completion queues whose polling thread has been
+  // started.
+  size_t NumActiveCompletionQueues() const;
 
  private:
   // Thread wrapping class that drives work over a single gRPC
@@ -57,7 +63,11 @@ class GrpcWorkerEnv {
   };
 
   std::unique_ptr<thread::ThreadPool> threadpool_;
-  std::vector<GrpcWorkerCacheThread> threads_;
+  const size_t num_completion_queues_;
+  mutable mutex mu_;
+  // Sized at construction; entries are created on first use.
+  mutable std::vector<std::unique_ptr<GrpcWorkerCacheThread>> threads_
+      TF_GUARDED_BY(mu_);
 };
 
 // Create a GrpcWorkerEnv instance that can be used as argument to create
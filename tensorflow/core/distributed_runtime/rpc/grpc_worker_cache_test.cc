@@ -61,6 +61,33 @@ TEST(GrpcWorkerCacheTest, NewGrpcWorkerCache) {
   EXPECT_EQ(wi, local_wi.get());
 }
 
+TEST(GrpcWorkerCacheTest, CompletionQueuesStartOnDemand) {
+  GrpcChannelSpec spec;
+  TF_ASSERT_OK(spec.AddHostPortsJob("worker", {"a:0", "b:1", "c:2"}));
+  ChannelCreationFunction channel_func =
+      ConvertToChannelCreationFunction(NewHostPortGrpcChannel);
+  auto channel_cache = std::shared_ptr<GrpcChannelCache>(
+      NewGrpcChannelCache(spec, channel_func));
+  std::unique_ptr<GrpcWorkerEnv> grpc_worker_env(
+      new GrpcWorkerEnv(/*num_completion_queues=*/8, /*num_threads=*/2));
+  EXPECT_EQ(0, grpc_worker_env->NumActiveCompletionQueues());
+
+  // Each target is pinned to one completion queue, so only as many polling
+  // threads as targets are started.
+  std::unique_ptr<WorkerCacheInterface> worker_cache(
+      NewGrpcWorkerCache(channel_cache, grpc_worker_env.get()));
+  for (int iter = 0; iter < 3; ++iter) {
+    for (int task = 0; task < 2; ++task) {
+      const string target =
+          strings::StrCat("/job:worker/replica:0/task:", task);
+      WorkerInterface* wi = worker_cache->GetOrCreateWorker(target);
+      EXPECT_NE(wi, nullptr);
+      worker_cache->ReleaseWorker(target, wi);
+    }
+  }
+  EXPECT_EQ(2, grpc_worker_env->NumActiveCompletionQueues());
+}
+
 TEST(GrpcWorkerCacheTest, DestructWorkerCacheInThreadPool) {
   GrpcChannelSpec spec;
   TF_ASSERT_OK(spec.AddHostPortsJob("worker", {"a:1", "b:2", "c:3"}));
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <unordered_map>
@@ -23,6 +24,7 @@ limitations under the License.
 #include "grpcpp/alarm.h"
 #include "grpcpp/server_builder.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
 #include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device.h"
@@ -39,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_session.h"
@@ -148,6 +151,7 @@ class GrpcWorkerServiceThread {
     SETUP_FOR_REQUEST(RunGraph, 100, true);
     SETUP_FOR_REQUEST(CleanupGraph, 100, false);
     SETUP_FOR_REQUEST(MarkRecvFinished, 10, false);
+    SETUP_FOR_REQUEST(RecvTensors, 100, true);
 
     // TODO(ncteisen): Determine a better policy for enqueuing the
     // appropriate number of each request type.
@@ -301,6 +305,25 @@ class GrpcWorkerServiceThread {
     ENQUEUE_REQUEST(RecvBuf, true);
   }
 
+  void RecvTensorsHandler(
+      WorkerCall<RecvTensorsRequest, RecvTensorsResponse>* call) {
+    Schedule([this, call]() {
+      CallOptions* call_opts = new CallOptions;
+      call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+      worker_->RecvTensorsAsync(
+          call_opts, &call->request, &call->response,
+          [call, call_opts](const Status& s) {
+            call->ClearCancelCallback();
+            delete call_opts;
+            if (!s.ok()) {
+              VLOG(3) << "Bad response from RecvTensors:" << s;
+            }
+            call->SendResponse(ToGrpcStatus(s));
+          });
+    });
+    ENQUEUE_REQUEST(RecvTensors, true);
+  }
+
   void CompleteGroupHandler(
       WorkerCall<CompleteGroupRequest, CompleteGroupResponse>* call) {
     Schedule([this, call]() {
@@ -435,6 +458,265 @@ void GrpcWorker::EnableResponseCache() {
   response_cache_ = std::make_unique<GrpcResponseCache>();
 }
 
+namespace {
+// Calls "done" with "val", or with a copy of "val" in host memory if it is in
+// the memory of the accelerator device "src_dev".
+void CopyTensorToHostIfNeeded(
+    Device* src_dev, const Rendezvous::Args& send_args, const Tensor& val,
+    bool is_dead, const string& key,
+    std::function<void(const Tensor&, bool, const Status&)> done) {
+  // DMA can only be used for Tensors that do not fall into
+  // the following three odd edge cases: 1) a zero-size
+  // buffer, 2) a dead tensor which has an uninit value, and
+  // 3) the tensor has the on_host allocation attribute,
+  // i.e. it's in CPU RAM *independent of its assigned
+  // device type*.
+  const bool on_host = send_args.alloc_attrs.on_host();
+  if (src_dev->tensorflow_accelerator_device_info() && (!on_host)) {
+    // Non-DMA cases.
+    DeviceContext* send_dev_context = send_args.device_context;
+    AllocatorAttributes alloc_attrs;
+    alloc_attrs.set_gpu_compatible(true);
+    alloc_attrs.set_on_host(true);
+    Allocator* alloc = src_dev->GetAllocator(alloc_attrs);
+    Tensor* copy = new Tensor(alloc, val.dtype(), val.shape());
+    CHECK(send_dev_context)
+        << "send dev name: " << src_dev->name()
+        << " gpu_info: " << src_dev->tensorflow_accelerator_device_info();
+    // "val" is on an accelerator device. Uses the device_context to
+    // fill the copy on host.
+    StatusCallback copy_ready = [done = std::move(done), copy,
+                                 is_dead](const Status& s) {
+      // The value is now ready to be returned on the wire.
+      done(*copy, is_dead, s);
+      delete copy;
+    };
+
+    CopyDeviceToHost(&val, alloc, alloc, key, src_dev, copy, send_dev_context,
+                     copy_ready);
+    return;
+  }
+  done(val, is_dead, OkStatus());
+}
+
+// Sets "*codec" to the wire codec the sender of "val" asked for in
+// "send_args", or to NONE if there is none that applies to "val".
+Status GetSenderWireCodec(const Rendezvous::Args& send_args, const Tensor& val,
+                          bool is_dead, WireCodecOptions* codec) {
+  codec->Clear();
+  if (send_args.wire_codec.empty() || is_dead) return OkStatus();
+  TF_RETURN_IF_ERROR(ParseWireCodec(send_args.wire_codec, codec));
+  if (!WireCodecAppliesTo(*codec, val.dtype())) codec->Clear();
+  return OkStatus();
+}
+
+// Sets the tensor of "*response" to the dtype and shape of "tensor", and
+// carries its content encoded with "codec" in the transport options.
+Status SetWireEncodedTensor(const WireCodecOptions& codec, const string& key,
+                            const Tensor& tensor,
+                            WireCodecResidualStore* residuals,
+                            RecvTensorResponse* response) {
+  CompressedTensorContent content;
+  TF_RETURN_IF_ERROR(
+      EncodeTensorContent(codec, tensor, key, residuals, &content));
+  response->mutable_tensor()->set_dtype(tensor.dtype());
+  tensor.shape().AsProto(response->mutable_tensor()->mutable_tensor_shape());
+  response->mutable_transport_options()->PackFrom(content);
+  return OkStatus();
+}
+
+// State of a RecvTensors call. The call is answered once all of the tensors
+// are available, or once the first of them is available and the linger time
+// of the request has passed. Tensors that become available after the response
+// was sent are sent to the step's rendezvous again, so that later requests for
+// them can still be served.
+//
+// "request", "response" and "opts" belong to the RPC and are only used until
+// the response is sent; anything needed afterwards is copied.
+class RecvTensorsState {
+ public:
+  // Takes ownership of a reference to "rendezvous", the rendezvous of the step.
+  RecvTensorsState(WireCodecResidualStore* residuals, Env* env,
+                   RemoteRendezvous* rendezvous, CallOptions* opts,
+                   const RecvTensorsRequest* request,
+                   RecvTensorsResponse* response, StatusCallback done)
+      : residuals_(residuals),
+        env_(env),
+        rendezvous_(rendezvous),
+        linger_micros_(request->linger_micros()),
+        opts_(opts),
+        request_(request),
+        response_(response),
+        done_(std::move(done)),
+        received_(request->rendezvous_key_size()) {}
+
+  ~RecvTensorsState() { rendezvous_->Unref(); }
+
+  // Records the tensor received for the "index"-th key of the request.
+  void OnReceived(std::shared_ptr<RecvTensorsState> self, int index,
+                  const Rendezvous::ParsedKey& parsed, Device* src_dev,
+                  const Status& status, const Rendezvous::Args& send_args,
+                  const Tensor& val, bool is_dead) {
+    bool resend = false;
+    {
+      mutex_lock l(mu_);
+      if (responded_) {
+        resend = status.ok();
+      } else {
+        received_[index] = Received{status, src_dev, send_args, val, is_dead};
+        ++num_received_;
+      }
+    }
+    if (resend) {
+      // The response has been sent without this tensor. Make it available
+      // to the next request for "parsed". If the step is over, its rendezvous
+      // has been aborted and the tensor is dropped.
+      Status s = rendezvous_->Send(parsed, send_args, val, is_dead);
+      if (!s.ok()) {
+        VLOG(1) << "Failed to resend " << parsed.FullKey() << ": " << s;
+      }
+      return;
+    }
+    MaybeRespond(std::move(self));
+  }
+
+  // Called once the tensors for all keys have been requested, so that tensors
+  // that are already available are answered together.
+  void Start(std::shared_ptr<RecvTensorsState> self) {
+    {
+      mutex_lock l(mu_);
+      started_ = true;
+    }
+    MaybeRespond(std::move(self));
+  }
+
+ private:
+  struct Received {
+    Status status;
+    Device* src_dev;
+    Rendezvous::Args send_args;
+    Tensor val;
+    bool is_dead;
+  };
+
+  void MaybeRespond(std::shared_ptr<RecvTensorsState> self) {
+    bool respond = false;
+    bool start_linger = false;
+    {
+      mutex_lock l(mu_);
+      if (!started_ || responded_ || num_received_ == 0) return;
+      if (num_received_ == received_.size() || linger_micros_ <= 0) {
+        respond = true;
+      } else if (!lingering_) {
+        lingering_ = true;
+        start_linger = true;
+      }
+    }
+    if (respond) {
+      Respond(std::move(self));
+    } else if (start_linger) {
+      env_->SchedClosureAfter(linger_micros_,
+                              [self]() { self->Respond(self); });
+    }
+  }
+
+  void Respond(std::shared_ptr<RecvTensorsState> self) {
+    auto ready = std::make_shared<std::vector<std::pair<int, Received>>>();
+    Status status;
+    {
+      mutex_lock l(mu_);
+      if (responded_) return;
+      responded_ = true;
+      for (int i = 0; i < received_.size(); ++i) {
+        if (!received_[i].has_value()) continue;
+        status.Update(received_[i]->status);
+        ready->emplace_back(i, std::move(*received_[i]));
+      }
+    }
+    opts_->ClearCancelCallback();
+    if (!status.ok()) {
+      done_(status);
+      return;
+    }
+    // Copies the tensors to host memory where needed, and encodes them once
+    // all copies are done.
+    struct Copies {
+      mutex mu;
+      Status status TF_GUARDED_BY(mu);
+      std::vector<Tensor> tensors;
+      std::atomic<int> num_pending;
+    };
+    auto copies = std::make_shared<Copies>();
+    copies->tensors.resize(ready->size());
+    copies->num_pending = ready->size();
+    for (int i = 0; i < ready->size(); ++i) {
+      const int index = (*ready)[i].first;
+      const Received& received = (*ready)[i].second;
+      CopyTensorToHostIfNeeded(
+          received.src_dev, received.send_args, received.val,
+          received.is_dead, request_->rendezvous_key(index),
+          [this, self, i, ready, copies](const Tensor& tensor, bool is_dead,
+                                         const Status& s) {
+            copies->tensors[i] = tensor;
+            if (!s.ok()) {
+              mutex_lock l(copies->mu);
+              copies->status.Update(s);
+            }
+            if (copies->num_pending.fetch_sub(1) != 1) return;
+            Status status;
+            {
+              mutex_lock l(copies->mu);
+              status = copies->status;
+            }
+            for (int j = 0; j < ready->size() && status.ok(); ++j) {
+              const int index = (*ready)[j].first;
+              const Received& received = (*ready)[j].second;
+              response_->add_key_index(index);
+              RecvTensorResponse* r = response_->add_tensor();
+              r->set_is_dead(received.is_dead);
+              r->set_send_start_micros(Env::Default()->NowMicros());
+              WireCodecOptions codec;
+              status = GetSenderWireCodec(received.send_args,
+                                          copies->tensors[j],
+                                          received.is_dead, &codec);
+              if (status.ok() && codec.codec() != WireCodecOptions::NONE) {
+                status = SetWireEncodedTensor(
+                    codec, request_->rendezvous_key(index),
+                    copies->tensors[j], residuals_, r);
+              } else {
+                copies->tensors[j].AsProtoTensorContent(r->mutable_tensor());
+              }
+            }
+            done_(status);
+          });
+    }
+  }
+
+  WireCodecResidualStore* const residuals_;  // Not owned.
+  Env* const env_;                           // Not owned.
+  RemoteRendezvous* const rendezvous_;
+  const int64_t linger_micros_;
+  CallOptions* const opts_;
+  const RecvTensorsRequest* const request_;
+  RecvTensorsResponse* const response_;
+  const StatusCallback done_;
+
+  mutex mu_;
+  std::vector<absl::optional<Received>> received_ TF_GUARDED_BY(mu_);
+  size_t num_received_ TF_GUARDED_BY(mu_) = 0;
+  bool started_ TF_GUARDED_BY(mu_) = false;
+  bool lingering_ TF_GUARDED_BY(mu_) = false;
+  bool responded_ TF_GUARDED_BY(mu_) = false;
+};
+}  // namespace
+
+void GrpcWorker::EncodeRecvTensorResponse(const RecvTensorRequest& request,
+                                          const Tensor& tensor, bool is_dead,
+                                          bool require_ack,
+                                          ::grpc::ByteBuffer* response) {
+  grpc::EncodeTensorToByteBuffer(is_dead, tensor, require_ack, response);
+}
+
 // GrpcRecvTensorAsync: unlike the other Worker methods, which use protocol
 // buffers for a response object, to avoid extra protocol buffer serialization
 // overhead we generate our response directly into a ::grpc::ByteBuffer object
@@ -448,11 +730,12 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
+  auto do_response = [this, request, response, done, cache_enabled](
+                         const Tensor& tensor, bool is_dead,
+                         const Status& status) {
     if (status.ok()) {
-      grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
+      EncodeRecvTensorResponse(*request, tensor, is_dead, cache_enabled,
+                               response);
     }
     done(status);
   };
@@ -515,51 +798,100 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   });
   env_->rendezvous_mgr->RecvLocalAsync(
       step_id, parsed,
-      [opts, rendezvous_done, src_dev, request](
-          const Status& status, const Rendezvous::Args& send_args,
-          const Rendezvous::Args& recv_args, const Tensor& val,
-          const bool is_dead) {
+      [this, opts, rendezvous_done, src_dev, request, response, done,
+       cache_enabled](const Status& status, const Rendezvous::Args& send_args,
+                      const Rendezvous::Args& recv_args, const Tensor& val,
+                      const bool is_dead) {
         opts->ClearCancelCallback();
-        if (status.ok()) {
-          // DMA can only be used for Tensors that do not fall into
-          // the following three odd edge cases: 1) a zero-size
-          // buffer, 2) a dead tensor which has an uninit value, and
-          // 3) the tensor has the on_host allocation attribute,
-          // i.e. it's in CPU RAM *independent of its assigned
-          // device type*.
-          const bool on_host = send_args.alloc_attrs.on_host();
-          {
-            // Non-DMA cases.
-            if (src_dev->tensorflow_accelerator_device_info() && (!on_host)) {
-              DeviceContext* send_dev_context = send_args.device_context;
-              AllocatorAttributes alloc_attrs;
-              alloc_attrs.set_gpu_compatible(true);
-              alloc_attrs.set_on_host(true);
-              Allocator* alloc = src_dev->GetAllocator(alloc_attrs);
-              Tensor* copy = new Tensor(alloc, val.dtype(), val.shape());
-              CHECK(send_dev_context)
-                  << "send dev name: " << src_dev->name() << " gpu_info: "
-                  << src_dev->tensorflow_accelerator_device_info();
-              // "val" is on an accelerator device. Uses the device_context to
-              // fill the copy on host.
-              StatusCallback copy_ready = [rendezvous_done, copy,
-                                           is_dead](const Status& s) {
-                // The value is now ready to be returned on the wire.
-                rendezvous_done(*copy, is_dead, s);
-                delete copy;
-              };
-
-              CopyDeviceToHost(&val, alloc, alloc, request->rendezvous_key(),
-                               src_dev, copy, send_dev_context, copy_ready);
-              return;
-            }
-          }
+        if (!status.ok()) {
+          rendezvous_done(val, is_dead, status);
+          return;
         }
-
-        rendezvous_done(val, is_dead, status);
+        // The response cache replays tensors to retried requests, which
+        // must not fold the top-k residual in twice, so cached responses
+        // are sent uncompressed.
+        WireCodecOptions codec;
+        Status s = GetSenderWireCodec(send_args, val, is_dead, &codec);
+        if (!s.ok()) {
+          rendezvous_done(val, is_dead, s);
+          return;
+        }
+        if (cache_enabled || codec.codec() == WireCodecOptions::NONE) {
+          CopyTensorToHostIfNeeded(src_dev, send_args, val, is_dead,
+                                   request->rendezvous_key(), rendezvous_done);
+          return;
+        }
+        CopyTensorToHostIfNeeded(
+            src_dev, send_args, val, is_dead, request->rendezvous_key(),
+            [this, codec, request, response, done](
+                const Tensor& tensor, bool is_dead, const Status& status) {
+              Status s = status;
+              if (s.ok()) {
+                RecvTensorResponse proto;
+                proto.set_is_dead(is_dead);
+                proto.set_send_start_micros(Env::Default()->NowMicros());
+                s = SetWireEncodedTensor(codec, request->rendezvous_key(),
+                                         tensor, &wire_codec_residuals_,
+                                         &proto);
+                if (s.ok()) {
+                  grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+                }
+              }
+              done(s);
+            });
       });
 }
 
+void GrpcWorker::RecvTensorsAsync(CallOptions* opts,
+                                  const RecvTensorsRequest* request,
+                                  RecvTensorsResponse* response,
+                                  StatusCallback done) {
+  VLOG(3) << "RecvTensorsAsync req: " << request->DebugString();
+  const int64_t step_id = request->step_id();
+  Status s = recent_request_ids_.TrackUnique(
+      request->request_id(), "RecvTensors (GrpcWorker)", *request);
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+
+  const int num_keys = request->rendezvous_key_size();
+  std::vector<Rendezvous::ParsedKey> parsed(num_keys);
+  std::vector<Device*> src_devs(num_keys, nullptr);
+  for (int i = 0; i < num_keys && s.ok(); ++i) {
+    s = Rendezvous::ParseKey(request->rendezvous_key(i), &parsed[i]);
+    if (s.ok()) {
+      s = PrepareRecvTensor(parsed[i], &src_devs[i]);
+    }
+  }
+  if (!s.ok() || num_keys == 0) {
+    done(s);
+    return;
+  }
+
+  // As in GrpcRecvTensorAsync(), an RPC cancellation while waiting for the
+  // tensors aborts the step.
+  opts->SetCancelCallback([this, step_id]() {
+    LOG(WARNING) << "RecvTensors cancelled for " << step_id;
+    AbortStep(step_id);
+  });
+  auto state = std::make_shared<RecvTensorsState>(
+      &wire_codec_residuals_, env_->env, env_->rendezvous_mgr->Find(step_id),
+      opts, request, response, std::move(done));
+  for (int i = 0; i < num_keys; ++i) {
+    env_->rendezvous_mgr->RecvLocalAsync(
+        step_id, parsed[i],
+        [state, i, parsed = parsed[i], src_dev = src_devs[i]](
+            const Status& status, const Rendezvous::Args& send_args,
+            const Rendezvous::Args& recv_args, const Tensor& val,
+            const bool is_dead) {
+          state->OnReceived(state, i, parsed, src_dev, status, send_args, val,
+                            is_dead);
+        });
+  }
+  state->Start(state);
+}
+
 namespace {
 // If RecvBufRespExtra.tensor_content is a single large string, then gRPC
 // can stall on the recv side when the string buffer needs to be enlarged,
@@ -594,15 +926,28 @@ void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
   const int64_t step_id = request->step_id();
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [this, response, done, cache_enabled](
+  auto do_response = [this, request, response, done, cache_enabled](
                          const Tensor& tensor, bool is_dead,
                          const Status& status) {
-    if (status.ok()) {
-      SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+    Status s = status;
+    if (s.ok()) {
+      // The receiver may ask for the content to be encoded with a wire
+      // codec. Buffer keys are unique to a step, so there is no error
+      // feedback for TOP_K here.
+      WireCodecOptions codec;
+      if (request->transport_options().UnpackTo(&codec) &&
+          WireCodecAppliesTo(codec, tensor.dtype())) {
+        CompressedTensorContent content;
+        s = EncodeTensorContent(codec, tensor, request->buf_rendezvous_key(),
+                                /*residuals=*/nullptr, &content);
+        if (s.ok()) response->mutable_transport_options()->PackFrom(content);
+      } else {
+        SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+      }
     }
     response->set_send_start_micros(env_->env->NowMicros());
     response->set_require_ack(cache_enabled);
-    done(status);
+    done(s);
   };
 
   // If response cache is enabled and the response cache already contains the
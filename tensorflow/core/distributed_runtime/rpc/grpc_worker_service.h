@@ -21,6 +21,7 @@ limitations under the License.
 #include "grpcpp/server_builder.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_response_cache.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
@@ -49,6 +50,10 @@ class GrpcWorker : public Worker {
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override;
 
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override;
+
   void RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
                     RecvBufResponse* response, StatusCallback done) override;
 
@@ -62,9 +67,20 @@ class GrpcWorker : public Worker {
 
   void RemoveCacheEntryForId(int64_t request_id);
 
+ protected:
+  // Encodes the RecvTensorResponse for "request" into "*response". Transports
+  // that move tensor contents out of band can override this to encode a
+  // reference to "tensor" instead of its contents.
+  virtual void EncodeRecvTensorResponse(const RecvTensorRequest& request,
+                                        const Tensor& tensor, bool is_dead,
+                                        bool require_ack,
+                                        ::grpc::ByteBuffer* response);
+
  private:
   std::unique_ptr<GrpcResponseCache> response_cache_;
   const int32 recv_buf_max_chunk_;
+  // Error feedback for tensors sent with the TOP_K wire codec.
+  WireCodecResidualStore wire_codec_residuals_;
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env,
@@ -15,6 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
@@ -31,15 +35,20 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
 namespace {
 
+class RpcRecvTensorBatch;
+class RpcRecvTensorCall;
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id,
+                      const RpcRendezvousMgr::Options& options)
+      : BaseRemoteRendezvous(env, step_id), options_(options) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -49,6 +58,20 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // Adds "call" to the open batch of receives from its source worker, and
+  // sends the batch when it is full.
+  void AddToBatch(RpcRecvTensorCall* call, std::function<void()> recv_done,
+                  std::shared_ptr<WorkerCacheInterface> worker_cache);
+  // Sends "batch" if it is still open when its batching window ends.
+  void FlushBatch(RpcRecvTensorBatch* batch);
+
+  const RpcRendezvousMgr::Options options_;
+
+  mutex batches_mu_;
+  // Batches that are still accepting receives, by source worker.
+  absl::flat_hash_map<string, RpcRecvTensorBatch*> open_batches_
+      TF_GUARDED_BY(batches_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -84,6 +107,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     resp_.Clear();
     {
       mutex_lock l(mu_);
+      DCHECK(batch_ == nullptr) << "RpcRecvTensorCall::Reset() in a batch.";
       status_ = OkStatus();
     }
     done_ = nullptr;
@@ -101,13 +125,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     StartRTCall(std::move(recv_done));
   }
 
-  void StartAbort(const Status& s) override {
-    {
-      mutex_lock l(mu_);
-      status_.Update(s);
-    }
-    opts_.StartCancel();
-  }
+  void StartAbort(const Status& s) override;
 
   Status status() const override {
     mutex_lock l(mu_);
@@ -131,6 +149,17 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
  private:
   friend class RpcRemoteRendezvous;
+  friend class RpcRecvTensorBatch;
+
+  void UpdateStatus(const Status& s) {
+    mutex_lock l(mu_);
+    status_.Update(s);
+  }
+
+  void SetBatch(RpcRecvTensorBatch* batch) {
+    mutex_lock l(mu_);
+    batch_ = batch;
+  }
 
   // Start the main RecvTensor call, checking for an async abort.
   void StartRTCall(std::function<void()> recv_done) {
@@ -179,10 +208,185 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   mutable mutex mu_;
   Status status_ TF_GUARDED_BY(mu_);
+  // The batch that receives this tensor, if any. Not owned.
+  RpcRecvTensorBatch* batch_ TF_GUARDED_BY(mu_) = nullptr;
 
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorCall);
 };
 
+// Receives the tensors of several RpcRecvTensorCalls from the same worker
+// with one RecvTensors RPC. Each call keeps its own abort semantics: an
+// aborted call completes right away, and the RPC is only cancelled once all of
+// its calls are aborted. Calls whose tensors are not in the response, e.g.
+// because they were not produced within the linger time, or calls to workers
+// that do not support RecvTensors are continued with their own RecvTensor RPC.
+class RpcRecvTensorBatch : public core::RefCounted {
+ public:
+  RpcRecvTensorBatch(const WorkerEnv* env, int64_t step_id,
+                     int64_t linger_micros, const string& src_worker,
+                     std::shared_ptr<WorkerCacheInterface> worker_cache)
+      : env_(env),
+        src_worker_(src_worker),
+        worker_cache_(std::move(worker_cache)),
+        wi_(worker_cache_->GetOrCreateWorker(src_worker)) {
+    req_.set_step_id(step_id);
+    req_.set_linger_micros(linger_micros);
+    req_.set_request_id(GetUniqueRequestId());
+  }
+
+  const string& src_worker() const { return src_worker_; }
+
+  // Returns the number of calls in the batch.
+  int Add(RpcRecvTensorCall* call, std::function<void()> recv_done) {
+    call->SetBatch(this);
+    int size;
+    {
+      mutex_lock l(mu_);
+      members_.push_back(Member{call, std::move(recv_done)});
+      size = members_.size();
+    }
+    // Handle an abort that raced with adding "call".
+    if (!call->status().ok()) Abort(call);
+    return size;
+  }
+
+  // Completes "call" with its abort status.
+  void Abort(RpcRecvTensorCall* call) {
+    std::function<void()> recv_done;
+    bool cancel = false;
+    {
+      mutex_lock l(mu_);
+      for (Member& member : members_) {
+        if (member.call == call && member.recv_done != nullptr) {
+          recv_done = std::move(member.recv_done);
+          member.recv_done = nullptr;
+          ++num_finished_;
+          break;
+        }
+      }
+      cancel = sent_ && num_finished_ == members_.size();
+    }
+    if (recv_done != nullptr) {
+      call->SetBatch(nullptr);
+      // Aborts are started with the locks of the rendezvous held, which the
+      // completion of the call acquires.
+      env_->env->SchedClosure(std::move(recv_done));
+    }
+    if (cancel) opts_.StartCancel();
+  }
+
+  void Send() {
+    {
+      mutex_lock l(mu_);
+      sent_ = true;
+      for (int i = 0; i < members_.size(); ++i) {
+        if (members_[i].recv_done == nullptr) continue;
+        req_.add_rendezvous_key(members_[i].call->req_.rendezvous_key());
+        sent_members_.push_back(i);
+      }
+    }
+    if (sent_members_.empty()) return;
+    Ref();
+    wi_->RecvTensorsAsync(&opts_, &req_, &resp_, [this](const Status& s) {
+      OnResponse(s);
+      Unref();
+    });
+    bool cancel = false;
+    {
+      mutex_lock l(mu_);
+      cancel = num_finished_ == members_.size();
+    }
+    if (cancel) opts_.StartCancel();
+  }
+
+ private:
+  struct Member {
+    RpcRecvTensorCall* call;
+    // Null once the call has been completed or continued with its own RPC.
+    std::function<void()> recv_done;
+  };
+
+  ~RpcRecvTensorBatch() override {
+    worker_cache_->ReleaseWorker(src_worker_, wi_);
+  }
+
+  void OnResponse(const Status& s) {
+    const bool unsupported = errors::IsUnimplemented(s);
+    if (unsupported) {
+      VLOG(1) << src_worker_ << " does not support RecvTensors: " << s;
+    }
+    // Index of the response tensor for each call that was sent.
+    std::vector<int> tensor_index(sent_members_.size(), -1);
+    if (s.ok()) {
+      for (int i = 0; i < resp_.key_index_size(); ++i) {
+        const int key_index = resp_.key_index(i);
+        if (key_index >= 0 && key_index < tensor_index.size()) {
+          tensor_index[key_index] = i;
+        }
+      }
+    }
+    for (int i = 0; i < sent_members_.size(); ++i) {
+      RpcRecvTensorCall* call;
+      std::function<void()> recv_done;
+      {
+        mutex_lock l(mu_);
+        Member& member = members_[sent_members_[i]];
+        if (member.recv_done == nullptr) continue;
+        call = member.call;
+        recv_done = std::move(member.recv_done);
+        member.recv_done = nullptr;
+        ++num_finished_;
+      }
+      call->SetBatch(nullptr);
+      if (unsupported || (s.ok() && tensor_index[i] < 0)) {
+        call->StartRTCall(std::move(recv_done));
+        continue;
+      }
+      if (s.ok()) {
+        call->resp_.InitAlloc(call->dst_device_, call->alloc_attrs_);
+        call->UpdateStatus(
+            call->resp_.InitFrom(resp_.mutable_tensor(tensor_index[i])));
+      } else {
+        call->UpdateStatus(s);
+      }
+      recv_done();
+    }
+  }
+
+  const WorkerEnv* const env_;  // Not owned.
+  const string src_worker_;
+  const std::shared_ptr<WorkerCacheInterface> worker_cache_;
+  WorkerInterface* const wi_;
+  CallOptions opts_;
+  RecvTensorsRequest req_;
+  RecvTensorsResponse resp_;
+  // Indices into "members_" of the calls in "req_".
+  std::vector<int> sent_members_;
+
+  mutex mu_;
+  std::vector<Member> members_ TF_GUARDED_BY(mu_);
+  int num_finished_ TF_GUARDED_BY(mu_) = 0;
+  bool sent_ TF_GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorBatch);
+};
+
+void RpcRecvTensorCall::StartAbort(const Status& s) {
+  RpcRecvTensorBatch* batch;
+  {
+    mutex_lock l(mu_);
+    status_.Update(s);
+    batch = batch_;
+    if (batch != nullptr) batch->Ref();
+  }
+  if (batch != nullptr) {
+    batch->Abort(this);
+    batch->Unref();
+    return;
+  }
+  opts_.StartCancel();
+}
+
 class RpcRecvTensorFreeList {
  public:
   RpcRecvTensorFreeList() {}
@@ -287,7 +491,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
 
   // Start "call".
   Ref();
-  call->Start([this, call, recv_args, worker_cache]() {
+  auto recv_done = [this, call, recv_args, worker_cache]() {
     // Removes "call" from calls_. Prevent StartAbort().
     DeregisterCall(call, recv_args);
     // If StartAbort was called prior to DeregisterCall, then the
@@ -300,17 +504,96 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
     get_call_freelist()->Release(call);
     Unref();
-  });
+  };
+  if (options_.recv_tensor_batch_window_micros > 0) {
+    AddToBatch(call, std::move(recv_done), std::move(worker_cache));
+  } else {
+    call->Start(std::move(recv_done));
+  }
+}
+
+void RpcRemoteRendezvous::AddToBatch(
+    RpcRecvTensorCall* call, std::function<void()> recv_done,
+    std::shared_ptr<WorkerCacheInterface> worker_cache) {
+  RpcRecvTensorBatch* full_batch = nullptr;
+  {
+    mutex_lock l(batches_mu_);
+    RpcRecvTensorBatch*& batch = open_batches_[call->src_worker_];
+    if (batch == nullptr) {
+      // The reference of the new batch is owned by the closure that flushes
+      // it at the end of the window.
+      batch = new RpcRecvTensorBatch(
+          env_, step_id_, options_.recv_tensor_batch_window_micros,
+          call->src_worker_, std::move(worker_cache));
+      Ref();
+      env_->env->SchedClosureAfter(options_.recv_tensor_batch_window_micros,
+                                   [this, batch = batch]() {
+                                     FlushBatch(batch);
+                                     batch->Unref();
+                                     Unref();
+                                   });
+    }
+    if (batch->Add(call, std::move(recv_done)) >=
+        options_.max_recv_tensor_batch_size) {
+      full_batch = batch;
+      full_batch->Ref();
+      open_batches_.erase(call->src_worker_);
+    }
+  }
+  if (full_batch != nullptr) {
+    full_batch->Send();
+    full_batch->Unref();
+  }
+}
+
+void RpcRemoteRendezvous::FlushBatch(RpcRecvTensorBatch* batch) {
+  {
+    mutex_lock l(batches_mu_);
+    auto it = open_batches_.find(batch->src_worker());
+    if (it == open_batches_.end() || it->second != batch) return;
+    open_batches_.erase(it);
+  }
+  batch->Send();
+}
+
+}  // namespace
+
+namespace {
+
+// Reads "env_var_name" into "value", keeping its current value if the variable
+// is unset or malformed.
+void ReadOptionFromEnv(StringPiece env_var_name, int64_t* value) {
+  int64_t parsed;
+  Status s = ReadInt64FromEnvVar(env_var_name, *value, &parsed);
+  if (!s.ok()) {
+    LOG(ERROR) << "Ignoring invalid " << env_var_name << ", using " << *value
+               << ": " << s;
+    return;
+  }
+  *value = parsed;
 }
 
 }  // namespace
 
+RpcRendezvousMgr::Options RpcRendezvousMgr::Options::FromEnv() {
+  Options options;
+  ReadOptionFromEnv("TF_RECV_TENSOR_BATCH_WINDOW_MICROS",
+                    &options.recv_tensor_batch_window_micros);
+  ReadOptionFromEnv("TF_RECV_TENSOR_BATCH_MAX_SIZE",
+                    &options.max_recv_tensor_batch_size);
+  return options;
+}
+
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
-    : BaseRendezvousMgr(env) {}
+    : RpcRendezvousMgr(env, Options::FromEnv()) {}
+
+RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env,
+                                   const Options& options)
+    : BaseRendezvousMgr(env), options_(options) {}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64_t step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, step_id);
+  return new RpcRemoteRendezvous(worker_env, step_id, options_);
 }
 
 }  // end namespace tensorflow
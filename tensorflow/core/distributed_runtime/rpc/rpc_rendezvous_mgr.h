@@ -44,12 +44,28 @@ class DeviceMgr;
 // RendezvousMgr must have keys generated by Rendezvous::CreateKey.
 class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
+  struct Options {
+    // If positive, receives from the same remote worker that start within
+    // this window are combined into one RecvTensors RPC, which saves RPCs
+    // for steps with many small cross-worker tensors.
+    int64_t recv_tensor_batch_window_micros = 0;
+    // A batch is sent right away once it holds this many receives.
+    int64_t max_recv_tensor_batch_size = 128;
+
+    // Reads the options from the TF_RECV_TENSOR_BATCH_WINDOW_MICROS and
+    // TF_RECV_TENSOR_BATCH_MAX_SIZE environment variables.
+    static Options FromEnv();
+  };
+
   explicit RpcRendezvousMgr(const WorkerEnv* env);
+  RpcRendezvousMgr(const WorkerEnv* env, const Options& options);
 
  protected:
   BaseRemoteRendezvous* Create(int64_t step_id, const WorkerEnv* worker_env);
 
  private:
+  const Options options_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -66,6 +67,25 @@ class DummyWorker : public TestWorkerInterface {
       done(OkStatus());
     });
   }
+
+  // Returns empty tensors of shape {3, 0} for the even keys of a batch only,
+  // so that the odd keys are received with RecvTensor.
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    ++num_recv_tensors_calls;
+    SchedClosure([request, response, done = std::move(done)]() {
+      Env::Default()->SleepForMicroseconds(10 * 1000);
+      for (int i = 0; i < request->rendezvous_key_size(); i += 2) {
+        response->add_key_index(i);
+        Tensor(DT_FLOAT, TensorShape({3, 0}))
+            .AsProtoTensorContent(response->add_tensor()->mutable_tensor());
+      }
+      done(OkStatus());
+    });
+  }
+
+  std::atomic<int> num_recv_tensors_calls{0};
 };
 
 // Fake cache implementation for WorkerEnv.
@@ -95,6 +115,9 @@ class DummyWorkerCache : public WorkerCacheInterface {
   void GetDeviceLocalityAsync(const string& device, DeviceLocality* locality,
                               StatusCallback done) override {}
 
+ public:
+  DummyWorker* dummy_remote_worker() const { return dummy_remote_worker_; }
+
  private:
   DummyWorker* dummy_remote_worker_ = nullptr;
 };
@@ -348,4 +371,102 @@ TEST_F(RpcRendezvousMgrTest, RemoteRecvAsyncMany) {
   rmgr_.Cleanup(step_id);
 }
 
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatched) {
+  const int64_t step_id = 123;
+  RpcRendezvousMgr::Options options;
+  options.recv_tensor_batch_window_micros = 1000 * 1000;
+  options.max_recv_tensor_batch_size = 4;
+  RpcRendezvousMgr rmgr(&env, options);
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+    Rendezvous::Args args;
+
+    const int num_requests = 10;
+    mutex mu;
+    Status status = OkStatus();
+    int num_batched = 0;
+    BlockingCounter counter(num_requests);
+    for (int i = 0; i < num_requests; i++) {
+      const Rendezvous::ParsedKey key = MakeKey(Rendezvous::CreateKey(
+          "/job:worker/replica:1/task:2/cpu:0", 7890,
+          "/job:mnist/replica:1/task:2/cpu:1", strings::StrCat("foo", i),
+          FrameAndIter(0, 0)));
+      rendez->RecvAsync(
+          key, args,
+          [&mu, &status, &num_batched, &counter](
+              const Status& s, const Rendezvous::Args&,
+              const Rendezvous::Args&, const Tensor& val, const bool) {
+            {
+              mutex_lock l(mu);
+              status.Update(s);
+              num_batched += val.dims() == 2;
+            }
+            counter.DecrementCount();
+          });
+    }
+    // The last batch is only sent at the end of the window.
+    counter.Wait();
+    TF_ASSERT_OK(status);
+    EXPECT_EQ(cache_->dummy_remote_worker()->num_recv_tensors_calls, 3);
+    // The two full batches return two tensors each and the last one returns
+    // one: the other receives fall back to RecvTensor.
+    EXPECT_EQ(num_batched, 5);
+  }
+  rmgr.Cleanup(step_id);
+}
+
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatchedCancelOne) {
+  const int64_t step_id = 123;
+  RpcRendezvousMgr::Options options;
+  options.recv_tensor_batch_window_micros = 1000;
+  RpcRendezvousMgr rmgr(&env, options);
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+    CancellationManager cm;
+    Rendezvous::Args cancelled_args;
+    cancelled_args.cancellation_manager = &cm;
+
+    Notification received;
+    Status received_status;
+    Tensor received_val;
+    rendez->RecvAsync(
+        MakeKey(Rendezvous::CreateKey("/job:worker/replica:1/task:2/cpu:0",
+                                      7890, "/job:mnist/replica:1/task:2/cpu:1",
+                                      "foo", FrameAndIter(0, 0))),
+        Rendezvous::Args(),
+        [&received, &received_status, &received_val](
+            const Status& s, const Rendezvous::Args&, const Rendezvous::Args&,
+            const Tensor& val, const bool) {
+          received_status = s;
+          received_val = val;
+          received.Notify();
+        });
+    Notification cancelled;
+    Status cancelled_status;
+    rendez->RecvAsync(
+        MakeKey(Rendezvous::CreateKey("/job:worker/replica:1/task:2/cpu:0",
+                                      7890, "/job:mnist/replica:1/task:2/cpu:1",
+                                      "bar", FrameAndIter(0, 0))),
+        cancelled_args,
+        [&cancelled, &cancelled_status](const Status& s,
+                                        const Rendezvous::Args&,
+                                        const Rendezvous::Args&, const Tensor&,
+                                        const bool) {
+          cancelled_status = s;
+          cancelled.Notify();
+        });
+    cm.StartCancel();
+    cancelled.WaitForNotification();
+    EXPECT_TRUE(errors::IsCancelled(cancelled_status));
+    received.WaitForNotification();
+    TF_ASSERT_OK(received_status);
+    EXPECT_EQ(received_val.shape(), TensorShape({3, 0}));
+  }
+  rmgr.Cleanup(step_id);
+}
+
 }  // namespace tensorflow
@@ -0,0 +1,544 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/rdma.h"
+
+#include <poll.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+// Number of completion queue entries, shared by all channels.
+constexpr int kCompletionQueueDepth = 4096;
+// Number of work completions polled at once.
+constexpr int kPollBatchSize = 32;
+// Timeout for waiting on completion events, so that shutdown is noticed.
+constexpr int kPollTimeoutMs = 100;
+// Retry and timeout settings of the reliable connection. The timeout is
+// 4.096us * 2^14, i.e. about 67ms per retry.
+constexpr uint8 kTimeout = 14;
+constexpr uint8 kRetryCount = 7;
+constexpr uint8 kRnrRetry = 7;
+constexpr uint8 kMinRnrTimer = 12;
+// Smallest buffer of the buffer pool, and the alignment of its buffers.
+constexpr size_t kMinPooledBufferBytes = 4096;
+
+Status ErrnoError(const string& what) {
+  return errors::Unavailable(what, ": ", strerror(errno));
+}
+
+// State of a tensor read, which may be split into several RDMA reads.
+struct ReadTensorCall {
+  mutex mu;
+  int pending_reads TF_GUARDED_BY(mu) = 0;
+  Status status TF_GUARDED_BY(mu);
+};
+
+}  // namespace
+
+// State of a queued or posted read, passed through the work request id.
+struct RdmaChannel::ReadCall {
+  RdmaChannel* channel;
+  ibv_sge sge;
+  uint64 remote_addr;
+  uint32 rkey;
+  StatusCallback done;
+};
+
+RdmaBufferPool::~RdmaBufferPool() {
+  mutex_lock l(mu_);
+  for (const auto& size_and_buffers : free_buffers_) {
+    for (const Buffer& buffer : size_and_buffers.second) {
+      Free(buffer);
+    }
+  }
+}
+
+Status RdmaBufferPool::Get(size_t size, Buffer* buffer) {
+  const size_t pooled_size =
+      std::max<size_t>(NextPowerOfTwo64(size), kMinPooledBufferBytes);
+  {
+    mutex_lock l(mu_);
+    auto it = free_buffers_.find(pooled_size);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+      *buffer = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= pooled_size;
+      return OkStatus();
+    }
+  }
+  void* data = port::AlignedMalloc(pooled_size, kMinPooledBufferBytes);
+  if (data == nullptr) {
+    return errors::ResourceExhausted("Failed to allocate ", pooled_size,
+                                     " bytes for RDMA");
+  }
+  ibv_mr* mr = ibv_reg_mr(pd_, data, pooled_size,
+                          IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ);
+  if (mr == nullptr) {
+    Status s = ErrnoError("Failed to register RDMA buffer");
+    port::AlignedFree(data);
+    return s;
+  }
+  buffer->data = data;
+  buffer->size = pooled_size;
+  buffer->mr = mr;
+  return OkStatus();
+}
+
+void RdmaBufferPool::Put(const Buffer& buffer) {
+  {
+    mutex_lock l(mu_);
+    if (cached_bytes_ + buffer.size <= max_cached_bytes_) {
+      free_buffers_[buffer.size].push_back(buffer);
+      cached_bytes_ += buffer.size;
+      return;
+    }
+  }
+  Free(buffer);
+}
+
+/* static */
+void RdmaBufferPool::Free(const Buffer& buffer) {
+  ibv_dereg_mr(buffer.mr);
+  port::AlignedFree(buffer.data);
+}
+
+RdmaChannel::RdmaChannel(RdmaMgr* mgr, ibv_qp* qp, const RdmaEndpoint& local)
+    : mgr_(mgr), qp_(qp), local_(local) {}
+
+RdmaChannel::~RdmaChannel() {
+  ibv_destroy_qp(qp_);
+  std::deque<ReadCall*> queued_reads;
+  {
+    mutex_lock l(mu_);
+    queued_reads.swap(queued_reads_);
+  }
+  for (ReadCall* call : queued_reads) {
+    call->done(errors::Cancelled("RDMA channel was closed"));
+    delete call;
+  }
+}
+
+Status RdmaChannel::Connect(const RdmaEndpoint& remote) {
+  const uint8 max_rd_atomic = static_cast<uint8>(
+      std::min(mgr_->device_attr_.max_qp_rd_atom, 16));
+  const uint8 max_dest_rd_atomic = static_cast<uint8>(
+      std::min(mgr_->device_attr_.max_qp_init_rd_atom, 16));
+
+  ibv_qp_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_INIT;
+  attr.pkey_index = 0;
+  attr.port_num = mgr_->port_num_;
+  attr.qp_access_flags = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ;
+  if (ibv_modify_qp(qp_, &attr,
+                    IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT |
+                        IBV_QP_ACCESS_FLAGS) != 0) {
+    return ErrnoError("Failed to set queue pair to INIT");
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_RTR;
+  attr.path_mtu = mgr_->port_attr_.active_mtu;
+  attr.dest_qp_num = remote.qpn();
+  attr.rq_psn = remote.psn();
+  attr.max_dest_rd_atomic = max_dest_rd_atomic;
+  attr.min_rnr_timer = kMinRnrTimer;
+  attr.ah_attr.is_global = 1;
+  attr.ah_attr.grh.dgid.global.subnet_prefix = remote.gid_subnet_prefix();
+  attr.ah_attr.grh.dgid.global.interface_id = remote.gid_interface_id();
+  attr.ah_attr.grh.sgid_index = mgr_->gid_index_;
+  attr.ah_attr.grh.hop_limit = 255;
+  attr.ah_attr.dlid = remote.lid();
+  attr.ah_attr.sl = 0;
+  attr.ah_attr.src_path_bits = 0;
+  attr.ah_attr.port_num = mgr_->port_num_;
+  if (ibv_modify_qp(qp_, &attr,
+                    IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU |
+                        IBV_QP_DEST_QPN | IBV_QP_RQ_PSN |
+                        IBV_QP_MAX_DEST_RD_ATOMIC |
+                        IBV_QP_MIN_RNR_TIMER) != 0) {
+    return ErrnoError("Failed to set queue pair to RTR");
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_RTS;
+  attr.sq_psn = local_.psn();
+  attr.timeout = kTimeout;
+  attr.retry_cnt = kRetryCount;
+  attr.rnr_retry = kRnrRetry;
+  attr.max_rd_atomic = max_rd_atomic;
+  if (ibv_modify_qp(qp_, &attr,
+                    IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
+                        IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN |
+                        IBV_QP_MAX_QP_RD_ATOMIC) != 0) {
+    return ErrnoError("Failed to set queue pair to RTS");
+  }
+  return OkStatus();
+}
+
+void RdmaChannel::Read(void* local, uint32 lkey, uint64 remote_addr,
+                       uint32 rkey, uint32 size, StatusCallback done) {
+  ReadCall* call = new ReadCall;
+  call->channel = this;
+  call->sge.addr = reinterpret_cast<uint64>(local);
+  call->sge.length = size;
+  call->sge.lkey = lkey;
+  call->remote_addr = remote_addr;
+  call->rkey = rkey;
+  call->done = std::move(done);
+  {
+    mutex_lock l(mu_);
+    if (outstanding_reads_ >= RdmaMgr::kMaxOutstandingReads) {
+      queued_reads_.push_back(call);
+      return;
+    }
+    ++outstanding_reads_;
+  }
+  if (!Post(call)) ReadDone();
+}
+
+bool RdmaChannel::Post(ReadCall* call) {
+  ibv_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = reinterpret_cast<uint64>(call);
+  wr.sg_list = &call->sge;
+  wr.num_sge = 1;
+  wr.opcode = IBV_WR_RDMA_READ;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  wr.wr.rdma.remote_addr = call->remote_addr;
+  wr.wr.rdma.rkey = call->rkey;
+
+  ibv_send_wr* bad_wr = nullptr;
+  const int error = ibv_post_send(qp_, &wr, &bad_wr);
+  if (error == 0) return true;
+  call->done(
+      errors::Unavailable("Failed to post RDMA read: ", strerror(error)));
+  delete call;
+  return false;
+}
+
+void RdmaChannel::ReadDone() {
+  // Hands the slot of the completed read to the next queued one.
+  for (;;) {
+    ReadCall* call;
+    {
+      mutex_lock l(mu_);
+      if (queued_reads_.empty()) {
+        --outstanding_reads_;
+        return;
+      }
+      call = queued_reads_.front();
+      queued_reads_.pop_front();
+    }
+    if (Post(call)) return;
+  }
+}
+
+/* static */
+Status RdmaMgr::Create(const string& local_task,
+                       std::unique_ptr<RdmaMgr>* rdma_mgr) {
+  std::unique_ptr<RdmaMgr> mgr(new RdmaMgr(local_task));
+  TF_RETURN_IF_ERROR(mgr->Init());
+  *rdma_mgr = std::move(mgr);
+  return OkStatus();
+}
+
+Status RdmaMgr::Init() {
+  string device_name;
+  int64_t port_num;
+  int64_t gid_index;
+  TF_RETURN_IF_ERROR(ReadStringFromEnvVar("RDMA_DEVICE", "", &device_name));
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("RDMA_DEVICE_PORT", 1, &port_num));
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("RDMA_GID_INDEX", 0, &gid_index));
+  port_num_ = static_cast<uint8>(port_num);
+  gid_index_ = static_cast<int>(gid_index);
+
+  int num_devices = 0;
+  ibv_device** devices = ibv_get_device_list(&num_devices);
+  if (devices == nullptr) return ErrnoError("Failed to list RDMA devices");
+  ibv_device* device = nullptr;
+  for (int i = 0; i < num_devices && device == nullptr; ++i) {
+    if (device_name.empty() || device_name == ibv_get_device_name(devices[i])) {
+      device = devices[i];
+    }
+  }
+  if (device != nullptr) context_ = ibv_open_device(device);
+  ibv_free_device_list(devices);
+  if (device == nullptr) {
+    return errors::NotFound("No RDMA device found",
+                            device_name.empty() ? "" : " named ",
+                            device_name);
+  }
+  if (context_ == nullptr) return ErrnoError("Failed to open RDMA device");
+
+  if (ibv_query_device(context_, &device_attr_) != 0) {
+    return ErrnoError("Failed to query RDMA device");
+  }
+  if (ibv_query_port(context_, port_num_, &port_attr_) != 0) {
+    return ErrnoError("Failed to query RDMA port");
+  }
+  if (port_attr_.state != IBV_PORT_ACTIVE) {
+    return errors::Unavailable("RDMA port ", port_num, " is not active");
+  }
+  if (ibv_query_gid(context_, port_num_, gid_index_, &gid_) != 0) {
+    return ErrnoError("Failed to query RDMA GID");
+  }
+  pd_ = ibv_alloc_pd(context_);
+  if (pd_ == nullptr) return ErrnoError("Failed to allocate protection domain");
+  int64_t buffer_pool_mb;
+  TF_RETURN_IF_ERROR(
+      ReadInt64FromEnvVar("RDMA_BUFFER_POOL_MB", 1024, &buffer_pool_mb));
+  buffer_pool_.reset(new RdmaBufferPool(
+      pd_, static_cast<size_t>(std::max<int64_t>(buffer_pool_mb, 0)) << 20));
+  completion_channel_ = ibv_create_comp_channel(context_);
+  if (completion_channel_ == nullptr) {
+    return ErrnoError("Failed to create completion channel");
+  }
+  cq_ = ibv_create_cq(context_, kCompletionQueueDepth, nullptr,
+                      completion_channel_, 0);
+  if (cq_ == nullptr) return ErrnoError("Failed to create completion queue");
+  if (ibv_req_notify_cq(cq_, 0) != 0) {
+    return ErrnoError("Failed to request completion notifications");
+  }
+  poller_.reset(Env::Default()->StartThread(ThreadOptions(),
+                                            "rdma_completion_poller",
+                                            [this]() { PollCompletions(); }));
+  LOG(INFO) << "Opened RDMA device " << ibv_get_device_name(context_->device)
+            << " port " << port_num << " for " << local_task_;
+  return OkStatus();
+}
+
+RdmaMgr::~RdmaMgr() {
+  shutdown_ = true;
+  poller_.reset();
+  {
+    mutex_lock l(mu_);
+    channels_.clear();
+    accepted_channels_.clear();
+    for (auto& handle_and_tensor : exposed_tensors_) {
+      buffer_pool_->Put(handle_and_tensor.second.buffer);
+    }
+    exposed_tensors_.clear();
+  }
+  buffer_pool_.reset();
+  if (cq_ != nullptr) ibv_destroy_cq(cq_);
+  if (completion_channel_ != nullptr) {
+    ibv_destroy_comp_channel(completion_channel_);
+  }
+  if (pd_ != nullptr) ibv_dealloc_pd(pd_);
+  if (context_ != nullptr) ibv_close_device(context_);
+}
+
+Status RdmaMgr::CreateChannel(std::unique_ptr<RdmaChannel>* channel) {
+  ibv_qp_init_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.send_cq = cq_;
+  attr.recv_cq = cq_;
+  attr.qp_type = IBV_QPT_RC;
+  attr.cap.max_send_wr = kMaxOutstandingReads;
+  attr.cap.max_recv_wr = 1;
+  attr.cap.max_send_sge = 1;
+  attr.cap.max_recv_sge = 1;
+  ibv_qp* qp = ibv_create_qp(pd_, &attr);
+  if (qp == nullptr) return ErrnoError("Failed to create queue pair");
+
+  RdmaEndpoint local;
+  local.set_lid(port_attr_.lid);
+  local.set_qpn(qp->qp_num);
+  local.set_psn(random::New64() & 0xffffff);
+  local.set_gid_subnet_prefix(gid_.global.subnet_prefix);
+  local.set_gid_interface_id(gid_.global.interface_id);
+  channel->reset(new RdmaChannel(this, qp, local));
+  return OkStatus();
+}
+
+Status RdmaMgr::GetChannel(const string& task,
+                           const EndpointExchangeFunction& exchange,
+                           RdmaChannel** channel) {
+  {
+    mutex_lock l(mu_);
+    auto failed = failed_channels_.find(task);
+    if (failed != failed_channels_.end()) return failed->second;
+    auto it = channels_.find(task);
+    if (it != channels_.end()) {
+      *channel = it->second.get();
+      return OkStatus();
+    }
+    if (!connecting_channels_.insert(task).second) {
+      return errors::Unavailable("RDMA channel to ", task,
+                                 " is being connected");
+    }
+  }
+
+  // The endpoint exchange is an RPC, so it runs without holding any lock.
+  std::unique_ptr<RdmaChannel> new_channel;
+  Status status = CreateChannel(&new_channel);
+  RdmaEndpoint remote;
+  if (status.ok()) status = exchange(new_channel->local_endpoint(), &remote);
+  if (status.ok()) status = new_channel->Connect(remote);
+  mutex_lock l(mu_);
+  connecting_channels_.erase(task);
+  if (!status.ok()) {
+    LOG(WARNING) << "Falling back to gRPC for tensors from " << task
+                 << ": " << status;
+    failed_channels_[task] = status;
+    return status;
+  }
+  VLOG(1) << "Connected RDMA channel from " << local_task_ << " to " << task;
+  *channel = new_channel.get();
+  channels_[task] = std::move(new_channel);
+  return OkStatus();
+}
+
+Status RdmaMgr::AcceptChannel(const string& task, const RdmaEndpoint& remote,
+                              RdmaEndpoint* local) {
+  std::unique_ptr<RdmaChannel> channel;
+  TF_RETURN_IF_ERROR(CreateChannel(&channel));
+  TF_RETURN_IF_ERROR(channel->Connect(remote));
+  *local = channel->local_endpoint();
+  VLOG(1) << "Accepted RDMA channel from " << task << " to " << local_task_;
+  mutex_lock l(mu_);
+  accepted_channels_[task] = std::move(channel);
+  return OkStatus();
+}
+
+Status RdmaMgr::ExposeTensor(int64_t step_id, const Tensor& tensor,
+                             RdmaTensorLocation* location) {
+  const StringPiece data = tensor.tensor_data();
+  RdmaBufferPool::Buffer buffer;
+  TF_RETURN_IF_ERROR(buffer_pool_->Get(data.size(), &buffer));
+  memcpy(buffer.data, data.data(), data.size());
+  location->set_remote_addr(reinterpret_cast<uint64>(buffer.data));
+  location->set_rkey(buffer.mr->rkey);
+  location->set_size(data.size());
+  mutex_lock l(mu_);
+  location->set_handle(next_handle_++);
+  exposed_tensors_[location->handle()] = {buffer, step_id};
+  return OkStatus();
+}
+
+void RdmaMgr::ReleaseTensor(uint64 handle) {
+  mutex_lock l(mu_);
+  auto it = exposed_tensors_.find(handle);
+  if (it == exposed_tensors_.end()) return;
+  buffer_pool_->Put(it->second.buffer);
+  exposed_tensors_.erase(it);
+}
+
+void RdmaMgr::ReleaseStep(int64_t step_id) {
+  mutex_lock l(mu_);
+  for (auto it = exposed_tensors_.begin(); it != exposed_tensors_.end();) {
+    if (it->second.step_id == step_id) {
+      buffer_pool_->Put(it->second.buffer);
+      exposed_tensors_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void RdmaMgr::ReadTensor(RdmaChannel* channel,
+                         const RdmaTensorLocation& location,
+                         const Tensor& tensor, StatusCallback done) {
+  if (location.size() != tensor.TotalBytes()) {
+    done(errors::Internal("RDMA tensor of ", location.size(),
+                          " bytes does not fit into ", tensor.TotalBytes(),
+                          " bytes"));
+    return;
+  }
+  RdmaBufferPool::Buffer buffer;
+  Status s = buffer_pool_->Get(location.size(), &buffer);
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+  // A single RDMA read is limited to the maximum message size of the port.
+  const uint64 max_read_bytes = std::max<uint64>(port_attr_.max_msg_sz, 1);
+  const uint64 size = location.size();
+  auto call = std::make_shared<ReadTensorCall>();
+  call->pending_reads = static_cast<int>(
+      std::max<uint64>((size + max_read_bytes - 1) / max_read_bytes, 1));
+  auto read_done = [this, call, buffer, tensor,
+                    done = std::move(done)](const Status& s) {
+    Status status;
+    {
+      mutex_lock l(call->mu);
+      call->status.Update(s);
+      if (--call->pending_reads > 0) return;
+      status = call->status;
+    }
+    if (status.ok()) {
+      memcpy(const_cast<char*>(tensor.tensor_data().data()), buffer.data,
+             tensor.TotalBytes());
+    }
+    buffer_pool_->Put(buffer);
+    done(status);
+  };
+  uint64 offset = 0;
+  do {
+    const uint64 read_bytes = std::min(max_read_bytes, size - offset);
+    channel->Read(static_cast<char*>(buffer.data) + offset, buffer.mr->lkey,
+                  location.remote_addr() + offset, location.rkey(),
+                  static_cast<uint32>(read_bytes), read_done);
+    offset += read_bytes;
+  } while (offset < size);
+}
+
+void RdmaMgr::PollCompletions() {
+  ibv_wc completions[kPollBatchSize];
+  while (!shutdown_) {
+    pollfd fd;
+    fd.fd = completion_channel_->fd;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    if (poll(&fd, 1, kPollTimeoutMs) <= 0) continue;
+    ibv_cq* cq;
+    void* cq_context;
+    if (ibv_get_cq_event(completion_channel_, &cq, &cq_context) != 0) continue;
+    ibv_ack_cq_events(cq, 1);
+    if (ibv_req_notify_cq(cq, 0) != 0) {
+      LOG(ERROR) << "Failed to request RDMA completion notifications";
+    }
+    int n;
+    while ((n = ibv_poll_cq(cq, kPollBatchSize, completions)) > 0) {
+      for (int i = 0; i < n; ++i) {
+        const ibv_wc& completion = completions[i];
+        ReadCall* call = reinterpret_cast<ReadCall*>(completion.wr_id);
+        call->channel->ReadDone();
+        if (completion.status == IBV_WC_SUCCESS) {
+          call->done(OkStatus());
+        } else {
+          call->done(errors::Unavailable("RDMA read failed: ",
+                                         ibv_wc_status_str(completion.status)));
+        }
+        delete call;
+      }
+    }
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,218 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_RDMA_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_RDMA_H_
+
+#include <infiniband/verbs.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_service.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class RdmaMgr;
+
+// Buffers registered with an RDMA device, reused across transfers because
+// ibv_reg_mr pins and maps every page of a buffer and costs far more than
+// copying a tensor. Tensor memory itself is not registered: the allocator may
+// unmap it once the tensor is freed, and a registration cached by address
+// would then read stale pages.
+class RdmaBufferPool {
+ public:
+  struct Buffer {
+    void* data = nullptr;
+    size_t size = 0;
+    ibv_mr* mr = nullptr;
+  };
+
+  // Keeps at most "max_cached_bytes" of free buffers registered.
+  RdmaBufferPool(ibv_pd* pd, size_t max_cached_bytes)
+      : pd_(pd), max_cached_bytes_(max_cached_bytes) {}
+  ~RdmaBufferPool();
+
+  // Returns a registered buffer of at least "size" bytes, readable and
+  // writable by the device.
+  Status Get(size_t size, Buffer* buffer);
+  void Put(const Buffer& buffer);
+
+ private:
+  static void Free(const Buffer& buffer);
+
+  ibv_pd* const pd_;  // Not owned.
+  const size_t max_cached_bytes_;
+
+  mutex mu_;
+  // Free buffers, keyed by size. Sizes are powers of two.
+  absl::flat_hash_map<size_t, std::vector<Buffer>> free_buffers_
+      TF_GUARDED_BY(mu_);
+  size_t cached_bytes_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RdmaBufferPool);
+};
+
+// A reliable-connected queue pair to one remote worker, over which the local
+// worker issues one-sided RDMA reads.
+class RdmaChannel {
+ public:
+  RdmaChannel(RdmaMgr* mgr, ibv_qp* qp, const RdmaEndpoint& local);
+  ~RdmaChannel();
+
+  const RdmaEndpoint& local_endpoint() const { return local_; }
+
+  // Transitions the queue pair to ready-to-send, connected to "remote".
+  Status Connect(const RdmaEndpoint& remote);
+
+  // Reads "size" bytes at "remote_addr" of the remote worker into "local",
+  // which must be registered with "lkey". Never blocks: while the maximum
+  // number of reads is outstanding, the read is queued and posted once an
+  // earlier one completes. "done" is called on the completion thread.
+  void Read(void* local, uint32 lkey, uint64 remote_addr, uint32 rkey,
+            uint32 size, StatusCallback done);
+
+ private:
+  friend class RdmaMgr;
+  struct ReadCall;
+
+  // Posts "call", or fails it and returns false.
+  bool Post(ReadCall* call);
+  // Frees the slot of a completed read, posting the next queued one in it.
+  void ReadDone();
+
+  RdmaMgr* const mgr_;  // Not owned.
+  ibv_qp* const qp_;
+  const RdmaEndpoint local_;
+
+  mutex mu_;
+  int outstanding_reads_ TF_GUARDED_BY(mu_) = 0;
+  std::deque<ReadCall*> queued_reads_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RdmaChannel);
+};
+
+// Owns the RDMA device of a worker: its protection domain, the completion
+// queue shared by all channels, and the tensors exposed for remote reads.
+//
+// The device is picked with the RDMA_DEVICE environment variable (the first
+// device by default), its port with RDMA_DEVICE_PORT (1 by default) and the
+// GID with RDMA_GID_INDEX (0 by default; RoCE usually needs a non-zero one).
+// RDMA_BUFFER_POOL_MB bounds the registered memory kept for reuse (1024 by
+// default).
+class RdmaMgr {
+ public:
+  // Maximum number of reads in flight on one channel.
+  static constexpr int kMaxOutstandingReads = 256;
+
+  // Opens the RDMA device for the worker named "local_task".
+  static Status Create(const string& local_task,
+                       std::unique_ptr<RdmaMgr>* rdma_mgr);
+  ~RdmaMgr();
+
+  const string& local_task() const { return local_task_; }
+
+  // Exchanges a local endpoint for the endpoint of the remote worker.
+  typedef std::function<Status(const RdmaEndpoint& local,
+                               RdmaEndpoint* remote)>
+      EndpointExchangeFunction;
+
+  // Returns the channel to the worker named "task" in "*channel", connecting
+  // it through "exchange" on first use. While another caller is connecting
+  // to "task", returns Unavailable instead of waiting for it. If connecting
+  // fails, the error is returned for all later calls for "task" as well.
+  Status GetChannel(const string& task,
+                    const EndpointExchangeFunction& exchange,
+                    RdmaChannel** channel);
+
+  // Creates a channel for the worker named "task" that connects to the
+  // queue pair at "remote", replacing any previous channel accepted from it,
+  // and returns its endpoint in "*local".
+  Status AcceptChannel(const string& task, const RdmaEndpoint& remote,
+                       RdmaEndpoint* local);
+
+  // Copies "tensor" into a registered buffer for remote reads and returns its
+  // address in "*location". The buffer is kept until ReleaseTensor() is called
+  // with "location->handle()", or the step "step_id" is released.
+  Status ExposeTensor(int64_t step_id, const Tensor& tensor,
+                      RdmaTensorLocation* location);
+  void ReleaseTensor(uint64 handle);
+  void ReleaseStep(int64_t step_id);
+
+  // Reads the remote tensor at "location" over "channel" into the buffer of
+  // "tensor", which must have the same size. Tensors larger than the port's
+  // maximum message size are read in several parts.
+  void ReadTensor(RdmaChannel* channel, const RdmaTensorLocation& location,
+                  const Tensor& tensor, StatusCallback done);
+
+ private:
+  friend class RdmaChannel;
+
+  explicit RdmaMgr(const string& local_task) : local_task_(local_task) {}
+  Status Init();
+  Status CreateChannel(std::unique_ptr<RdmaChannel>* channel);
+  void PollCompletions();
+
+  // A tensor exposed for remote reads.
+  struct ExposedTensor {
+    RdmaBufferPool::Buffer buffer;
+    int64_t step_id;
+  };
+
+  const string local_task_;
+  ibv_context* context_ = nullptr;
+  ibv_pd* pd_ = nullptr;
+  ibv_comp_channel* completion_channel_ = nullptr;
+  ibv_cq* cq_ = nullptr;
+  ibv_device_attr device_attr_;
+  ibv_port_attr port_attr_;
+  ibv_gid gid_;
+  uint8 port_num_ = 1;
+  int gid_index_ = 0;
+
+  std::unique_ptr<RdmaBufferPool> buffer_pool_;
+
+  std::atomic<bool> shutdown_{false};
+  std::unique_ptr<Thread> poller_;
+
+  mutex mu_;
+  absl::flat_hash_map<string, std::unique_ptr<RdmaChannel>> channels_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<string, std::unique_ptr<RdmaChannel>> accepted_channels_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<string, Status> failed_channels_ TF_GUARDED_BY(mu_);
+  // Tasks whose channel is being connected, so that each is connected once.
+  absl::flat_hash_set<string> connecting_channels_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<uint64, ExposedTensor> exposed_tensors_
+      TF_GUARDED_BY(mu_);
+  uint64 next_handle_ TF_GUARDED_BY(mu_) = 1;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RdmaMgr);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_RDMA_H_
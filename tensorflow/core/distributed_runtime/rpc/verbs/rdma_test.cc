@@ -0,0 +1,199 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/rdma.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kLocalTask[] = "/job:worker/replica:0/task:0";
+constexpr char kRemoteTask[] = "/job:worker/replica:0/task:1";
+
+// Connects two RdmaMgrs in this process over the first RDMA device, e.g. a
+// soft-RoCE device. The tests are skipped on hosts without one.
+class RdmaTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Status s = RdmaMgr::Create(kLocalTask, &local_);
+    if (s.ok()) s = RdmaMgr::Create(kRemoteTask, &remote_);
+    if (!s.ok()) {
+      GTEST_SKIP() << "No usable RDMA device: " << s;
+    }
+  }
+
+  Status GetChannel(RdmaChannel** channel) {
+    return local_->GetChannel(
+        kRemoteTask,
+        [this](const RdmaEndpoint& local, RdmaEndpoint* remote) {
+          return remote_->AcceptChannel(kLocalTask, local, remote);
+        },
+        channel);
+  }
+
+  Status ReadTensor(RdmaChannel* channel, const RdmaTensorLocation& location,
+                    const Tensor& tensor) {
+    Status status;
+    Notification done;
+    local_->ReadTensor(channel, location, tensor, [&](const Status& s) {
+      status = s;
+      done.Notify();
+    });
+    done.WaitForNotification();
+    return status;
+  }
+
+  static Tensor MakeTensor(int64_t num_elements, float offset) {
+    Tensor tensor(DT_FLOAT, TensorShape({num_elements}));
+    auto flat = tensor.flat<float>();
+    for (int64_t i = 0; i < num_elements; ++i) {
+      flat(i) = offset + i;
+    }
+    return tensor;
+  }
+
+  std::unique_ptr<RdmaMgr> local_;
+  std::unique_ptr<RdmaMgr> remote_;
+};
+
+TEST_F(RdmaTest, ReadsExposedTensor) {
+  RdmaChannel* channel;
+  TF_ASSERT_OK(GetChannel(&channel));
+
+  const Tensor sent = MakeTensor(1 << 16, 1.0f);
+  RdmaTensorLocation location;
+  TF_ASSERT_OK(remote_->ExposeTensor(/*step_id=*/1, sent, &location));
+  EXPECT_EQ(location.size(), sent.TotalBytes());
+
+  Tensor received(DT_FLOAT, sent.shape());
+  TF_ASSERT_OK(ReadTensor(channel, location, received));
+  test::ExpectTensorEqual<float>(received, sent);
+  remote_->ReleaseTensor(location.handle());
+}
+
+TEST_F(RdmaTest, ReusesChannel) {
+  RdmaChannel* channel;
+  TF_ASSERT_OK(GetChannel(&channel));
+  RdmaChannel* same_channel;
+  TF_ASSERT_OK(local_->GetChannel(
+      kRemoteTask,
+      [](const RdmaEndpoint& local, RdmaEndpoint* remote) {
+        return errors::Internal("Unexpected endpoint exchange");
+      },
+      &same_channel));
+  EXPECT_EQ(same_channel, channel);
+}
+
+TEST_F(RdmaTest, RemembersFailedChannel) {
+  int num_exchanges = 0;
+  auto exchange = [&num_exchanges](const RdmaEndpoint& local,
+                                   RdmaEndpoint* remote) {
+    ++num_exchanges;
+    return errors::Unavailable("Peer is down");
+  };
+  RdmaChannel* channel;
+  EXPECT_TRUE(errors::IsUnavailable(
+      local_->GetChannel(kRemoteTask, exchange, &channel)));
+  EXPECT_TRUE(errors::IsUnavailable(
+      local_->GetChannel(kRemoteTask, exchange, &channel)));
+  EXPECT_EQ(num_exchanges, 1);
+}
+
+TEST_F(RdmaTest, DoesNotWaitForChannelBeingConnected) {
+  Notification exchange_started;
+  Notification finish_exchange;
+  std::unique_ptr<Thread> connecting(Env::Default()->StartThread(
+      ThreadOptions(), "connecting", [&]() {
+        RdmaChannel* channel;
+        TF_EXPECT_OK(local_->GetChannel(
+            kRemoteTask,
+            [&](const RdmaEndpoint& local, RdmaEndpoint* remote) {
+              exchange_started.Notify();
+              finish_exchange.WaitForNotification();
+              return remote_->AcceptChannel(kLocalTask, local, remote);
+            },
+            &channel));
+      }));
+  exchange_started.WaitForNotification();
+
+  // A concurrent caller falls back instead of blocking on the exchange.
+  RdmaChannel* channel;
+  EXPECT_TRUE(errors::IsUnavailable(GetChannel(&channel)));
+  finish_exchange.Notify();
+  connecting.reset();
+  TF_EXPECT_OK(GetChannel(&channel));
+}
+
+TEST_F(RdmaTest, QueuesReadsBeyondOutstandingLimit) {
+  RdmaChannel* channel;
+  TF_ASSERT_OK(GetChannel(&channel));
+
+  // Issued from one thread, so a Read that blocked for a free slot would
+  // only return after earlier reads complete.
+  const int num_reads = 2 * RdmaMgr::kMaxOutstandingReads + 1;
+  std::vector<Tensor> sent;
+  std::vector<Tensor> received;
+  std::vector<RdmaTensorLocation> locations(num_reads);
+  for (int i = 0; i < num_reads; ++i) {
+    sent.push_back(MakeTensor(1024, i));
+    received.emplace_back(DT_FLOAT, sent.back().shape());
+    TF_ASSERT_OK(
+        remote_->ExposeTensor(/*step_id=*/1, sent.back(), &locations[i]));
+  }
+  mutex mu;
+  Status status;
+  BlockingCounter pending(num_reads);
+  for (int i = 0; i < num_reads; ++i) {
+    local_->ReadTensor(channel, locations[i], received[i],
+                       [&](const Status& s) {
+                         {
+                           mutex_lock l(mu);
+                           status.Update(s);
+                         }
+                         pending.DecrementCount();
+                       });
+  }
+  pending.Wait();
+  TF_ASSERT_OK(status);
+  for (int i = 0; i < num_reads; ++i) {
+    test::ExpectTensorEqual<float>(received[i], sent[i]);
+  }
+  remote_->ReleaseStep(/*step_id=*/1);
+}
+
+TEST_F(RdmaTest, RejectsSizeMismatch) {
+  RdmaChannel* channel;
+  TF_ASSERT_OK(GetChannel(&channel));
+  RdmaTensorLocation location;
+  TF_ASSERT_OK(
+      remote_->ExposeTensor(/*step_id=*/1, MakeTensor(1024, 0.0f), &location));
+  Tensor received(DT_FLOAT, TensorShape({512}));
+  EXPECT_TRUE(errors::IsInternal(ReadTensor(channel, location, received)));
+  remote_->ReleaseTensor(location.handle());
+}
+
+}  // namespace
+}  // namespace tensorflow
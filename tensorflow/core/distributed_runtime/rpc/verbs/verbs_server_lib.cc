@@ -0,0 +1,440 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_server_lib.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "grpcpp/grpcpp.h"
+#include "grpcpp/server_builder.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_channel.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
+#include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_service.grpc.pb.h"
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_util.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/worker_cache_wrapper.h"
+#include "tensorflow/core/distributed_runtime/worker_interface.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// Serves the control plane of the verbs transport.
+class GrpcVerbsService : public VerbsService::Service {
+ public:
+  explicit GrpcVerbsService(RdmaMgr* rdma_mgr) : rdma_mgr_(rdma_mgr) {}
+
+  ::grpc::Status GetRemoteAddress(::grpc::ServerContext* context,
+                                  const GetRemoteAddressRequest* request,
+                                  GetRemoteAddressResponse* response) override {
+    return ToGrpcStatus(rdma_mgr_->AcceptChannel(request->task_name(),
+                                                 request->endpoint(),
+                                                 response->mutable_endpoint()));
+  }
+
+  ::grpc::Status ReleaseTensors(::grpc::ServerContext* context,
+                                const ReleaseTensorsRequest* request,
+                                ReleaseTensorsResponse* response) override {
+    for (uint64 handle : request->handle()) {
+      rdma_mgr_->ReleaseTensor(handle);
+    }
+    return ::grpc::Status::OK;
+  }
+
+ private:
+  RdmaMgr* const rdma_mgr_;  // Not owned.
+};
+
+namespace {
+
+// Exposes the tensors of RecvTensor responses for RDMA reads when the
+// receiver accepts them.
+class VerbsWorker : public GrpcWorker {
+ public:
+  VerbsWorker(WorkerEnv* env, const ConfigProto& config, RdmaMgr* rdma_mgr)
+      : GrpcWorker(env, config), rdma_mgr_(rdma_mgr) {}
+
+  void CleanupGraphAsync(const CleanupGraphRequest* request,
+                         CleanupGraphResponse* response,
+                         StatusCallback done) override {
+    // Release the tensors of receivers that failed before reading them.
+    rdma_mgr_->ReleaseStep(request->step_id());
+    GrpcWorker::CleanupGraphAsync(request, response, std::move(done));
+  }
+
+ protected:
+  void EncodeRecvTensorResponse(const RecvTensorRequest& request,
+                                const Tensor& tensor, bool is_dead,
+                                bool require_ack,
+                                ::grpc::ByteBuffer* response) override {
+    // Cached responses may be replayed after the receiver released the
+    // exposed tensor, so they always carry the tensor contents.
+    if (!require_ack && AcceptsRdmaRead(request) &&
+        CanReadOverRdma(tensor, is_dead)) {
+      RdmaTensorLocation location;
+      Status s = rdma_mgr_->ExposeTensor(request.step_id(), tensor, &location);
+      if (s.ok()) {
+        EncodeRdmaRecvTensorResponse(tensor, location, require_ack, response);
+        return;
+      }
+      LOG_EVERY_N_SEC(WARNING, 60)
+          << "Sending tensor through gRPC instead of RDMA: " << s;
+    }
+    GrpcWorker::EncodeRecvTensorResponse(request, tensor, is_dead, require_ack,
+                                         response);
+  }
+
+ private:
+  RdmaMgr* const rdma_mgr_;  // Not owned.
+};
+
+// Wraps the gRPC worker interface of a remote worker, and reads the contents
+// of the tensors it exposes over RDMA.
+class VerbsRemoteWorker : public WorkerInterface {
+ public:
+  VerbsRemoteWorker(const string& target, WorkerInterface* wrapped,
+                    SharedGrpcChannelPtr channel, RdmaMgr* rdma_mgr)
+      : target_(target),
+        wrapped_(wrapped),
+        stub_(VerbsService::NewStub(channel)),
+        rdma_mgr_(rdma_mgr) {}
+  ~VerbsRemoteWorker() override {}
+
+  WorkerInterface* wrapped() const { return wrapped_; }
+
+  void GetStatusAsync(CallOptions* opts, const GetStatusRequest* request,
+                      GetStatusResponse* response, bool fail_fast,
+                      StatusCallback done) override {
+    wrapped_->GetStatusAsync(opts, request, response, fail_fast,
+                             std::move(done));
+  }
+
+  void CreateWorkerSessionAsync(const CreateWorkerSessionRequest* request,
+                                CreateWorkerSessionResponse* response,
+                                StatusCallback done) override {
+    wrapped_->CreateWorkerSessionAsync(request, response, std::move(done));
+  }
+
+  void DeleteWorkerSessionAsync(CallOptions* opts,
+                                const DeleteWorkerSessionRequest* request,
+                                DeleteWorkerSessionResponse* response,
+                                StatusCallback done) override {
+    wrapped_->DeleteWorkerSessionAsync(opts, request, response,
+                                       std::move(done));
+  }
+
+  void RegisterGraphAsync(const RegisterGraphRequest* request,
+                          RegisterGraphResponse* response,
+                          StatusCallback done) override {
+    wrapped_->RegisterGraphAsync(request, response, std::move(done));
+  }
+
+  void DeregisterGraphAsync(const DeregisterGraphRequest* request,
+                            DeregisterGraphResponse* response,
+                            StatusCallback done) override {
+    wrapped_->DeregisterGraphAsync(request, response, std::move(done));
+  }
+
+  void RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
+                     MutableRunGraphResponseWrapper* response,
+                     StatusCallback done) override {
+    wrapped_->RunGraphAsync(opts, request, response, std::move(done));
+  }
+
+  MutableRunGraphRequestWrapper* CreateRunGraphRequest() override {
+    return wrapped_->CreateRunGraphRequest();
+  }
+
+  MutableRunGraphResponseWrapper* CreateRunGraphResponse() override {
+    return wrapped_->CreateRunGraphResponse();
+  }
+
+  void CleanupGraphAsync(const CleanupGraphRequest* request,
+                         CleanupGraphResponse* response,
+                         StatusCallback done) override {
+    wrapped_->CleanupGraphAsync(request, response, std::move(done));
+  }
+
+  void CleanupAllAsync(const CleanupAllRequest* request,
+                       CleanupAllResponse* response,
+                       StatusCallback done) override {
+    wrapped_->CleanupAllAsync(request, response, std::move(done));
+  }
+
+  void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
+                       TensorResponse* response, StatusCallback done) override {
+    // Tensors for devices other than the host are copied to the device after
+    // parsing, so they cannot be the destination of RDMA reads.
+    RdmaChannel* channel = nullptr;
+    if (!response->on_host() || !GetChannel(&channel).ok()) {
+      wrapped_->RecvTensorAsync(opts, request, response, std::move(done));
+      return;
+    }
+    RecvTensorRequest* rdma_request = new RecvTensorRequest(*request);
+    SetAcceptsRdmaRead(rdma_request);
+    wrapped_->RecvTensorAsync(
+        opts, rdma_request, response,
+        [this, channel, rdma_request, response,
+         done = std::move(done)](const Status& s) {
+          delete rdma_request;
+          RdmaTensorLocation location;
+          if (!s.ok() ||
+              !response->metadata().transport_options().UnpackTo(&location)) {
+            done(s);
+            return;
+          }
+          // "done" may release this worker, so the stub is kept alive by the
+          // release call itself.
+          std::shared_ptr<VerbsService::Stub> stub = stub_;
+          rdma_mgr_->ReadTensor(
+              channel, location, response->tensor(),
+              [stub, handle = location.handle(), done](const Status& s) {
+                ReleaseRemoteTensor(std::move(stub), handle);
+                done(s);
+              });
+        });
+  }
+
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    wrapped_->RecvTensorsAsync(opts, request, response, std::move(done));
+  }
+
+  void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
+                    StatusCallback done) override {
+    wrapped_->LoggingAsync(request, response, std::move(done));
+  }
+
+  void TracingAsync(const TracingRequest* request, TracingResponse* response,
+                    StatusCallback done) override {
+    wrapped_->TracingAsync(request, response, std::move(done));
+  }
+
+  void RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
+                    RecvBufResponse* response, StatusCallback done) override {
+    wrapped_->RecvBufAsync(opts, request, response, std::move(done));
+  }
+
+  void CompleteGroupAsync(CallOptions* opts,
+                          const CompleteGroupRequest* request,
+                          CompleteGroupResponse* response,
+                          StatusCallback done) override {
+    wrapped_->CompleteGroupAsync(opts, request, response, std::move(done));
+  }
+
+  void CompleteInstanceAsync(CallOptions* opts,
+                             const CompleteInstanceRequest* request,
+                             CompleteInstanceResponse* response,
+                             StatusCallback done) override {
+    wrapped_->CompleteInstanceAsync(opts, request, response, std::move(done));
+  }
+
+  void GetStepSequenceAsync(const GetStepSequenceRequest* request,
+                            GetStepSequenceResponse* response,
+                            StatusCallback done) override {
+    wrapped_->GetStepSequenceAsync(request, response, std::move(done));
+  }
+
+ private:
+  Status GetChannel(RdmaChannel** channel) {
+    return rdma_mgr_->GetChannel(
+        target_,
+        [this](const RdmaEndpoint& local, RdmaEndpoint* remote) {
+          GetRemoteAddressRequest request;
+          request.set_task_name(rdma_mgr_->local_task());
+          *request.mutable_endpoint() = local;
+          GetRemoteAddressResponse response;
+          ::grpc::ClientContext context;
+          TF_RETURN_IF_ERROR(FromGrpcStatus(
+              stub_->GetRemoteAddress(&context, request, &response)));
+          *remote = response.endpoint();
+          return OkStatus();
+        },
+        channel);
+  }
+
+  static void ReleaseRemoteTensor(std::shared_ptr<VerbsService::Stub> stub,
+                                  uint64 handle) {
+    struct Call {
+      ::grpc::ClientContext context;
+      ReleaseTensorsRequest request;
+      ReleaseTensorsResponse response;
+    };
+    Call* call = new Call;
+    call->request.add_handle(handle);
+    stub->async()->ReleaseTensors(
+        &call->context, &call->request, &call->response,
+        [stub, call](::grpc::Status s) {
+          if (!s.ok()) {
+            VLOG(1) << "Failed to release RDMA tensor: " << s.error_message();
+          }
+          delete call;
+        });
+  }
+
+  const string target_;
+  WorkerInterface* const wrapped_;  // Owned by the wrapped worker cache.
+  const std::shared_ptr<VerbsService::Stub> stub_;
+  RdmaMgr* const rdma_mgr_;  // Not owned.
+
+  TF_DISALLOW_COPY_AND_ASSIGN(VerbsRemoteWorker);
+};
+
+// Wraps the remote workers of a gRPC worker cache in VerbsRemoteWorkers.
+class VerbsWorkerCache : public WorkerCacheWrapper {
+ public:
+  VerbsWorkerCache(WorkerCacheInterface* wrapped,
+                   std::shared_ptr<GrpcChannelCache> channel_cache,
+                   RdmaMgr* rdma_mgr)
+      : WorkerCacheWrapper(wrapped),
+        wrapped_(wrapped),
+        channel_cache_(std::move(channel_cache)),
+        rdma_mgr_(rdma_mgr) {}
+
+  WorkerInterface* GetOrCreateWorker(const string& target) override {
+    WorkerInterface* worker = wrapped_->GetOrCreateWorker(target);
+    if (worker == nullptr || target == rdma_mgr_->local_task()) return worker;
+    SharedGrpcChannelPtr channel = channel_cache_->FindWorkerChannel(target);
+    if (channel == nullptr) return worker;
+    VerbsRemoteWorker* verbs_worker =
+        new VerbsRemoteWorker(target, worker, std::move(channel), rdma_mgr_);
+    mutex_lock l(mu_);
+    verbs_workers_.insert(verbs_worker);
+    return verbs_worker;
+  }
+
+  void ReleaseWorker(const string& target, WorkerInterface* worker) override {
+    VerbsRemoteWorker* verbs_worker = static_cast<VerbsRemoteWorker*>(worker);
+    {
+      mutex_lock l(mu_);
+      if (verbs_workers_.erase(verbs_worker) == 0) verbs_worker = nullptr;
+    }
+    if (verbs_worker == nullptr) {
+      wrapped_->ReleaseWorker(target, worker);
+      return;
+    }
+    wrapped_->ReleaseWorker(target, verbs_worker->wrapped());
+    delete verbs_worker;
+  }
+
+ private:
+  const std::unique_ptr<WorkerCacheInterface> wrapped_;
+  const std::shared_ptr<GrpcChannelCache> channel_cache_;
+  RdmaMgr* const rdma_mgr_;  // Not owned.
+
+  mutex mu_;
+  absl::flat_hash_set<VerbsRemoteWorker*> verbs_workers_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+VerbsServer::VerbsServer(const ServerDef& server_def, Env* env)
+    : GrpcServer(server_def, env) {}
+
+VerbsServer::~VerbsServer() {
+  TF_CHECK_OK(Stop());
+  TF_CHECK_OK(Join());
+}
+
+Status VerbsServer::Init(DeviceMgr* local_device_mgr) {
+  const string local_task =
+      strings::StrCat("/job:", server_def().job_name(), "/replica:0",
+                      "/task:", server_def().task_index());
+  TF_RETURN_IF_ERROR(RdmaMgr::Create(local_task, &rdma_mgr_));
+  verbs_service_.reset(new GrpcVerbsService(rdma_mgr_.get()));
+
+  GrpcServerOptions opts;
+  opts.rendezvous_mgr_func = [](const WorkerEnv* env) {
+    return new RpcRendezvousMgr(env);
+  };
+  opts.service_func = [this](const WorkerEnv* env,
+                             ::grpc::ServerBuilder* builder) {
+    builder->RegisterService(verbs_service_.get());
+  };
+  opts.worker_func = [this](WorkerEnv* env, const ConfigProto& config) {
+    return std::unique_ptr<GrpcWorker>(
+        new VerbsWorker(env, config, rdma_mgr_.get()));
+  };
+  opts.local_device_mgr = local_device_mgr;
+  return GrpcServer::Init(opts);
+}
+
+Status VerbsServer::WorkerCacheFactory(const WorkerCacheFactoryOptions& options,
+                                       WorkerCacheInterface** worker_cache) {
+  WorkerCacheInterface* grpc_worker_cache = nullptr;
+  TF_RETURN_IF_ERROR(
+      GrpcServer::WorkerCacheFactory(options, &grpc_worker_cache));
+  GrpcChannelSpec channel_spec;
+  Status s = ParseChannelSpec(options, &channel_spec);
+  if (!s.ok()) {
+    delete grpc_worker_cache;
+    return s;
+  }
+  std::shared_ptr<GrpcChannelCache> channel_cache(NewGrpcChannelCache(
+      channel_spec, GetChannelCreationFunction(), *options.rpc_options));
+  *worker_cache = new VerbsWorkerCache(grpc_worker_cache,
+                                       std::move(channel_cache),
+                                       rdma_mgr_.get());
+  return OkStatus();
+}
+
+/* static */
+Status VerbsServer::Create(const ServerDef& server_def, Env* env,
+                           DeviceMgr* local_device_mgr,
+                           std::unique_ptr<ServerInterface>* out_server) {
+  std::unique_ptr<VerbsServer> ret(
+      new VerbsServer(server_def, env == nullptr ? Env::Default() : env));
+  Status s = ret->Init(local_device_mgr);
+  if (!s.ok()) {
+    LOG(ERROR) << s;
+    return s;
+  }
+  *out_server = std::move(ret);
+  return OkStatus();
+}
+
+namespace {
+
+class VerbsServerFactory : public ServerFactory {
+ public:
+  bool AcceptsOptions(const ServerDef& server_def) override {
+    return server_def.protocol() == "grpc+verbs";
+  }
+
+  Status NewServer(const ServerDef& server_def, const Options& options,
+                   std::unique_ptr<ServerInterface>* out_server) override {
+    return VerbsServer::Create(server_def, Env::Default(),
+                               options.local_device_mgr, out_server);
+  }
+};
+
+// Registers a `ServerFactory` for `VerbsServer` instances.
+class VerbsServerRegistrar {
+ public:
+  VerbsServerRegistrar() {
+    ServerFactory::Register("VERBS_SERVER", new VerbsServerFactory());
+  }
+};
+static VerbsServerRegistrar registrar;
+
+}  // namespace
+}  // namespace tensorflow
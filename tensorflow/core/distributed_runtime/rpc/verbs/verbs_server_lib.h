@@ -0,0 +1,58 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_SERVER_LIB_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_SERVER_LIB_H_
+
+#include <memory>
+
+#include "tensorflow/core/distributed_runtime/rpc/grpc_server_lib.h"
+#include "tensorflow/core/distributed_runtime/rpc/verbs/rdma.h"
+
+namespace tensorflow {
+
+class GrpcVerbsService;
+
+// A GrpcServer for the "grpc+verbs" protocol. Control messages, and small or
+// non-memcpy-able tensors, are exchanged through gRPC as usual. Receivers on
+// the host read the contents of larger tensors with one-sided RDMA reads from
+// registered buffers of the sender, so that they bypass the gRPC stack.
+class VerbsServer : public GrpcServer {
+ protected:
+  VerbsServer(const ServerDef& server_def, Env* env);
+
+ public:
+  static Status Create(const ServerDef& server_def, Env* env,
+                       DeviceMgr* local_device_mgr,
+                       std::unique_ptr<ServerInterface>* out_server);
+
+  // Destruction is only supported in the factory method. Clean shutdown is
+  // not currently implemented for this server type.
+  ~VerbsServer() override;
+
+ protected:
+  Status Init(DeviceMgr* local_device_mgr);
+
+  Status WorkerCacheFactory(const WorkerCacheFactoryOptions& options,
+                            WorkerCacheInterface** worker_cache) override;
+
+ private:
+  std::unique_ptr<RdmaMgr> rdma_mgr_;
+  std::unique_ptr<GrpcVerbsService> verbs_service_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_SERVER_LIB_H_
@@ -0,0 +1,52 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_util.h"
+
+#include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+
+void SetAcceptsRdmaRead(RecvTensorRequest* request) {
+  request->mutable_transport_options()->PackFrom(RdmaRecvOptions());
+}
+
+bool AcceptsRdmaRead(const RecvTensorRequest& request) {
+  return request.transport_options().Is<RdmaRecvOptions>();
+}
+
+bool CanReadOverRdma(const Tensor& tensor, bool is_dead) {
+  return !is_dead && DataTypeCanUseMemcpy(tensor.dtype()) &&
+         tensor.TotalBytes() >= kMinRdmaTensorBytes &&
+         tensor.TotalBytes() <= kMaxRdmaTensorBytes;
+}
+
+void EncodeRdmaRecvTensorResponse(const Tensor& tensor,
+                                  const RdmaTensorLocation& location,
+                                  bool require_ack,
+                                  ::grpc::ByteBuffer* response) {
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(tensor.dtype());
+  tensor.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_send_start_micros(Env::Default()->NowMicros());
+  proto.mutable_transport_options()->PackFrom(location);
+  proto.set_require_ack(require_ack);
+  grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,56 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_UTIL_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_UTIL_H_
+
+#include <cstddef>
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_service.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace grpc {
+class ByteBuffer;
+}  // namespace grpc
+
+namespace tensorflow {
+
+// Tensors below this size are sent inline in the RecvTensor response, since
+// registering their memory and releasing them costs more than the copy.
+constexpr size_t kMinRdmaTensorBytes = 64 << 10;
+// Largest tensor that is read over RDMA, which bounds the size of the
+// registered buffers it is staged in.
+constexpr size_t kMaxRdmaTensorBytes = 1 << 30;
+
+// Marks "request" as coming from a receiver that can read the tensor contents
+// over RDMA.
+void SetAcceptsRdmaRead(RecvTensorRequest* request);
+bool AcceptsRdmaRead(const RecvTensorRequest& request);
+
+// Returns whether the contents of "tensor" should be read over RDMA rather
+// than sent in the RecvTensor response.
+bool CanReadOverRdma(const Tensor& tensor, bool is_dead);
+
+// Encodes a RecvTensorResponse that holds the dtype and shape of "tensor",
+// and "location" instead of its contents.
+void EncodeRdmaRecvTensorResponse(const Tensor& tensor,
+                                  const RdmaTensorLocation& location,
+                                  bool require_ack,
+                                  ::grpc::ByteBuffer* response);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_VERBS_VERBS_UTIL_H_
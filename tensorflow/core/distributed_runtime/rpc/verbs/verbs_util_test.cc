@@ -0,0 +1,98 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/verbs/verbs_util.h"
+
+#include "grpcpp/support/byte_buffer.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class DummyDevice : public DeviceBase {
+ public:
+  explicit DummyDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("CPU");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
+
+TEST(VerbsUtilTest, CanReadOverRdma) {
+  const int64_t min_elements = kMinRdmaTensorBytes / sizeof(float);
+  EXPECT_FALSE(
+      CanReadOverRdma(Tensor(DT_FLOAT, TensorShape({min_elements - 1})),
+                      /*is_dead=*/false));
+  EXPECT_TRUE(CanReadOverRdma(Tensor(DT_FLOAT, TensorShape({min_elements})),
+                              /*is_dead=*/false));
+  EXPECT_FALSE(CanReadOverRdma(Tensor(DT_FLOAT, TensorShape({min_elements})),
+                               /*is_dead=*/true));
+  EXPECT_FALSE(CanReadOverRdma(
+      Tensor(DT_STRING, TensorShape({min_elements})), /*is_dead=*/false));
+}
+
+TEST(VerbsUtilTest, AcceptsRdmaRead) {
+  RecvTensorRequest request;
+  EXPECT_FALSE(AcceptsRdmaRead(request));
+  SetAcceptsRdmaRead(&request);
+  EXPECT_TRUE(AcceptsRdmaRead(request));
+}
+
+TEST(VerbsUtilTest, EncodeRdmaRecvTensorResponse) {
+  Tensor tensor(DT_FLOAT, TensorShape({4, 8192}));
+  RdmaTensorLocation location;
+  location.set_remote_addr(0x1000);
+  location.set_rkey(7);
+  location.set_size(tensor.TotalBytes());
+  location.set_handle(42);
+
+  ::grpc::ByteBuffer buffer;
+  EncodeRdmaRecvTensorResponse(tensor, location, /*require_ack=*/true,
+                               &buffer);
+
+  DummyDevice device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&device, AllocatorAttributes());
+  GrpcByteSource source(&buffer);
+  TF_ASSERT_OK(response.ParseFrom(&source));
+  EXPECT_TRUE(response.on_host());
+  EXPECT_EQ(response.tensor().dtype(), DT_FLOAT);
+  EXPECT_EQ(response.tensor().shape(), tensor.shape());
+  EXPECT_TRUE(response.metadata().require_ack());
+
+  RdmaTensorLocation parsed;
+  ASSERT_TRUE(response.metadata().transport_options().UnpackTo(&parsed));
+  EXPECT_EQ(parsed.remote_addr(), location.remote_addr());
+  EXPECT_EQ(parsed.rkey(), location.rkey());
+  EXPECT_EQ(parsed.size(), location.size());
+  EXPECT_EQ(parsed.handle(), location.handle());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 
@@ -30,6 +31,8 @@ void TensorResponse::Clear() {
   device_ = nullptr;
   alloc_attrs_ = AllocatorAttributes();
   allocator_ = nullptr;
+  staging_allocator_ = nullptr;
+  staging_context_ = nullptr;
   already_used_ = false;
   ClearTensor();
 }
@@ -48,6 +51,16 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
     on_host_ = true;
   }
   allocator_ = device_->GetAllocator(alloc_attrs_);
+  const DeviceBase::AcceleratorDeviceInfo* device_info =
+      device_->tensorflow_accelerator_device_info();
+  if (!on_host_ && device_info != nullptr &&
+      device_info->default_context != nullptr) {
+    AllocatorAttributes staging_attrs;
+    staging_attrs.set_on_host(true);
+    staging_attrs.set_gpu_compatible(true);
+    staging_allocator_ = device_->GetAllocator(staging_attrs);
+    staging_context_ = device_info->default_context;
+  }
 }
 
 Status TensorResponse::InitFrom(RecvTensorResponse* response) {
@@ -56,9 +69,15 @@ Status TensorResponse::InitFrom(RecvTensorResponse* response) {
   if (on_host_) {
     if (!tensor_.FromProto(allocator_, meta_.tensor())) {
       s = errors::InvalidArgument("Cannot parse tensor from response");
+    } else {
+      s = MaybeDecodeWireContent(&tensor_);
     }
   } else {
-    s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    s = MaybeDecodeWireContentToProto();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_,
+                                       &tensor_);
+    }
   }
   {
     TensorProto empty;
@@ -80,6 +99,18 @@ void TensorResponse::InitPartial(const RecvTensorResponse& response,
 }
 
 Status TensorResponse::ParseFrom(Source* source) {
+  if (!on_host_ && staging_allocator_ != nullptr) {
+    if (already_used_) {
+      ClearTensor();
+    }
+    already_used_ = true;
+    // Avoid parsing the tensor content into a TensorProto first.
+    if (ParseFast(source)) {
+      TF_RETURN_IF_ERROR(MaybeDecodeWireContent(&tensor_));
+      return CopyStagedTensorToDevice();
+    }
+    ClearTensor();
+  }
   if (!on_host_) {
     protobuf::io::CodedInputStream input(source->contents());
 
@@ -87,6 +118,7 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
+    TF_RETURN_IF_ERROR(MaybeDecodeWireContentToProto());
     Status s =
         device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
     // Reduce memory usage for big tensors.
@@ -101,12 +133,46 @@ Status TensorResponse::ParseFrom(Source* source) {
     ClearTensor();
   }
   already_used_ = true;
-  if (ParseFast(source)) return OkStatus();
+  if (ParseFast(source)) return MaybeDecodeWireContent(&tensor_);
   meta_.Clear();
-  if (ParseSlow(source)) return OkStatus();
+  if (ParseSlow(source)) return MaybeDecodeWireContent(&tensor_);
   return errors::InvalidArgument("Cannot parse tensor from response");
 }
 
+Status TensorResponse::CopyStagedTensorToDevice() {
+  Tensor staged = std::move(tensor_);
+  Tensor copy(allocator_, staged.dtype(), staged.shape());
+  if (staged.TotalBytes() > 0) {
+    TF_RETURN_IF_ERROR(staging_context_->CopyCPUTensorToDeviceSync(
+        &staged, static_cast<Device*>(device_), &copy));
+  }
+  tensor_ = std::move(copy);
+  return OkStatus();
+}
+
+Status TensorResponse::MaybeDecodeWireContent(Tensor* t) {
+  if (!meta_.transport_options().Is<CompressedTensorContent>()) {
+    return OkStatus();
+  }
+  CompressedTensorContent content;
+  if (!meta_.transport_options().UnpackTo(&content)) {
+    return errors::InvalidArgument("Cannot parse wire-encoded tensor content");
+  }
+  meta_.clear_transport_options();
+  return DecodeTensorContent(content, t);
+}
+
+Status TensorResponse::MaybeDecodeWireContentToProto() {
+  if (!meta_.transport_options().Is<CompressedTensorContent>()) {
+    return OkStatus();
+  }
+  Tensor host(cpu_allocator(), meta_.tensor().dtype(),
+              TensorShape(meta_.tensor().tensor_shape()));
+  TF_RETURN_IF_ERROR(MaybeDecodeWireContent(&host));
+  host.AsProtoTensorContent(meta_.mutable_tensor());
+  return OkStatus();
+}
+
 // Define some helper routines for decoding protocol buffer wire format data
 namespace {
 // We only need some of the wiretype values for this code
@@ -145,6 +211,7 @@ bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
 
 bool TensorResponse::ParseTensorSubmessage(
     protobuf::io::CodedInputStream* input, TensorProto* tensor_meta) {
+  Allocator* allocator = on_host_ ? allocator_ : staging_allocator_;
   bool seen_tensor_content = false;
   while (true) {
     auto p = input->ReadTagWithCutoff(127);
@@ -155,7 +222,7 @@ bool TensorResponse::ParseTensorSubmessage(
       if (ok && !seen_tensor_content) {
         // No tensor content: could be because it's a zero-length tensor
         TensorShape shape(tensor_meta->tensor_shape());
-        Tensor t(allocator_, tensor_meta->dtype(), shape);
+        Tensor t(allocator, tensor_meta->dtype(), shape);
         tensor_ = std::move(t);
       }
       return ok;
@@ -195,7 +262,7 @@ bool TensorResponse::ParseTensorSubmessage(
         if (!ReadVarintSizeAsInt(input, &num_bytes)) return false;
         seen_tensor_content = true;
         TensorShape shape(tensor_meta->tensor_shape());
-        Tensor t(allocator_, tensor_meta->dtype(), shape);
+        Tensor t(allocator, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
         if (static_cast<size_t>(num_bytes) != buf.size()) return false;
         // TODO(jeff,sanjay): Figure out a way to avoid this copy if
@@ -27,6 +27,7 @@ namespace tensorflow {
 
 class Allocator;
 class DeviceBase;
+class DeviceContext;
 class TensorProto;
 
 // TensorResponse can be used as the destination of an RPC that returns
@@ -91,16 +92,33 @@ class TensorResponse {
   // Return pointer to the device hosting the tensor.
   DeviceBase* device() const { return device_; }
 
+  // Returns true if the tensor is allocated in host memory, in which case its
+  // buffer may be filled in directly once it has been parsed.
+  bool on_host() const { return on_host_; }
+
  private:
   bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
                              TensorProto* tensor_meta);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
+  Status CopyStagedTensorToDevice();
+  // If the sender encoded the tensor content with a wire codec (see
+  // wire_codec.h), decodes it into *t, a host tensor of the right shape.
+  Status MaybeDecodeWireContent(Tensor* t);
+  // As above, but decodes into the content of meta_.tensor(), for devices
+  // that make their tensors from a TensorProto.
+  Status MaybeDecodeWireContentToProto();
 
   bool on_host_ = false;
   DeviceBase* device_ = nullptr;
   AllocatorAttributes alloc_attrs_;
   Allocator* allocator_ = nullptr;
+  // For devices that are not on the host but provide a default context, the
+  // fast path parses the tensor content straight into a staging tensor from
+  // the device's gpu-compatible host allocator, which is then copied to the
+  // device. Otherwise tensors for such devices are parsed from a TensorProto.
+  Allocator* staging_allocator_ = nullptr;
+  DeviceContext* staging_context_ = nullptr;
   bool already_used_ = false;
   Tensor tensor_;
   RecvTensorResponse meta_;
@@ -15,10 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -46,6 +48,64 @@ class DummyDevice : public DeviceBase {
   DeviceAttributes attr_;
 };
 
+// Device context that copies host tensors to a "device" living in host memory
+// and counts the copies.
+class CountingDeviceContext : public DeviceContext {
+ public:
+  void CopyCPUTensorToDevice(const Tensor* cpu_tensor, Device* device,
+                             Tensor* device_tensor, StatusCallback done,
+                             bool sync_dst_compute) const override {
+    ++num_copies_;
+    StringPiece src = cpu_tensor->tensor_data();
+    memcpy(const_cast<char*>(device_tensor->tensor_data().data()), src.data(),
+           src.size());
+    done(OkStatus());
+  }
+
+  int num_copies() const { return num_copies_; }
+
+ private:
+  mutable int num_copies_ = 0;
+};
+
+class DummyAcceleratorDevice : public DeviceBase {
+ public:
+  explicit DummyAcceleratorDevice(Env* env)
+      : DeviceBase(env), context_(new CountingDeviceContext) {
+    attr_.set_device_type("GPU");
+    device_info_.default_context = context_;
+    set_tensorflow_accelerator_device_info(&device_info_);
+  }
+  ~DummyAcceleratorDevice() override { context_->Unref(); }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+  Status MakeTensorFromProto(const TensorProto& tensor_proto,
+                             const AllocatorAttributes alloc_attrs,
+                             Tensor* tensor) override {
+    ++num_protos_;
+    Tensor parsed(tensor_proto.dtype());
+    if (!parsed.FromProto(cpu_allocator(), tensor_proto)) {
+      return errors::InvalidArgument("Cannot parse tensor from proto");
+    }
+    *tensor = std::move(parsed);
+    return OkStatus();
+  }
+
+  int num_copies() const { return context_->num_copies(); }
+  int num_protos() const { return num_protos_; }
+
+ private:
+  DeviceAttributes attr_;
+  CountingDeviceContext* context_;
+  AcceleratorDeviceInfo device_info_;
+  int num_protos_ = 0;
+};
+
 class StringSource : public TensorResponse::Source {
  public:
   explicit StringSource(const string* s, int block_size)
@@ -156,6 +216,59 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, StagesContentForAcceleratorDevice) {
+  Tensor src(DT_FLOAT, TensorShape({2, 3}));
+  test::FillIota<float>(&src, 1.0f);
+  Tensor str(DT_STRING, TensorShape({2}));
+  test::FillValues<tstring>(&str, {"a", "b"});
+
+  DummyAcceleratorDevice device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&device, AllocatorAttributes());
+  for (const Tensor* t : {&src, &str}) {
+    RecvTensorResponse proto;
+    proto.set_send_start_micros(123456);
+    t->AsProtoTensorContent(proto.mutable_tensor());
+    string encoded;
+    proto.AppendToString(&encoded);
+    StringSource source(&encoded, 4);
+    TF_EXPECT_OK(response.ParseFrom(&source));
+    EXPECT_EQ(response.metadata().send_start_micros(), 123456);
+    EXPECT_EQ(response.tensor().DebugString(), t->DebugString());
+  }
+  // Only the string tensor, which has no flat content, goes through a proto.
+  EXPECT_EQ(device.num_copies(), 1);
+  EXPECT_EQ(device.num_protos(), 1);
+}
+
+TEST_F(TensorResponseTest, DecodesWireEncodedContent) {
+  Tensor src(DT_FLOAT, TensorShape({2, 3}));
+  test::FillIota<float>(&src, 1.0f);
+  WireCodecOptions codec;
+  TF_ASSERT_OK(ParseWireCodec("bf16", &codec));
+  CompressedTensorContent content;
+  TF_ASSERT_OK(EncodeTensorContent(codec, src, "key", nullptr, &content));
+
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(DT_FLOAT);
+  src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.mutable_transport_options()->PackFrom(content);
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  DummyDevice cpu_device(Env::Default());
+  DummyAcceleratorDevice accelerator(Env::Default());
+  for (DeviceBase* device :
+       std::vector<DeviceBase*>{&cpu_device, &accelerator}) {
+    TensorResponse response;
+    response.InitAlloc(device, AllocatorAttributes());
+    StringSource source(&encoded, 1024);
+    TF_ASSERT_OK(response.ParseFrom(&source));
+    EXPECT_FALSE(response.metadata().has_transport_options());
+    test::ExpectTensorEqual<float>(src, response.tensor());
+  }
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
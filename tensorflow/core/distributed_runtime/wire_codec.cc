@@ -0,0 +1,261 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Encodes `in` as its k largest-magnitude elements. Returns false, leaving
+// `*out` untouched, when the sparse form would not be smaller than the dense
+// one; the residual for `key` has then been folded into `*dense`.
+bool EncodeTopK(const WireCodecOptions& options, const Tensor& in,
+                const string& key, WireCodecResidualStore* residuals,
+                Tensor* dense, CompressedTensorContent* out) {
+  const int64_t n = in.NumElements();
+  Tensor acc(DT_FLOAT, in.shape());
+  std::memcpy(const_cast<char*>(acc.tensor_data().data()),
+              in.tensor_data().data(), in.TotalBytes());
+  if (residuals != nullptr) residuals->AddResidual(key, &acc);
+  const int64_t k = std::min<int64_t>(
+      n, std::max<int64_t>(1, std::ceil(options.topk_fraction() * n)));
+  // Each kept element costs a value and an index.
+  if (2 * k >= n || n > std::numeric_limits<uint32>::max()) {
+    if (residuals != nullptr) residuals->SetResidual(key, Tensor());
+    *dense = std::move(acc);
+    return false;
+  }
+  float* values = acc.flat<float>().data();
+  std::vector<uint32> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::nth_element(order.begin(), order.begin() + k, order.end(),
+                   [values](uint32 a, uint32 b) {
+                     return std::abs(values[a]) > std::abs(values[b]);
+                   });
+  order.resize(k);
+  std::sort(order.begin(), order.end());
+
+  out->set_codec(WireCodecOptions::TOP_K);
+  string* data = out->mutable_data();
+  data->resize(k * sizeof(float));
+  float* kept = reinterpret_cast<float*>(&(*data)[0]);
+  out->mutable_indices()->Reserve(k);
+  for (int64_t i = 0; i < k; ++i) {
+    kept[i] = values[order[i]];
+    values[order[i]] = 0.0f;
+    out->add_indices(order[i]);
+  }
+  if (residuals != nullptr) residuals->SetResidual(key, std::move(acc));
+  return true;
+}
+
+}  // namespace
+
+Status ParseWireCodec(StringPiece spec, WireCodecOptions* options) {
+  options->Clear();
+  if (spec.empty() || spec == "none") return OkStatus();
+  if (spec == "fp16") {
+    options->set_codec(WireCodecOptions::FLOAT16);
+  } else if (spec == "bf16") {
+    options->set_codec(WireCodecOptions::BFLOAT16);
+  } else if (spec == "snappy") {
+    options->set_codec(WireCodecOptions::SNAPPY);
+  } else if (absl::ConsumePrefix(&spec, "topk:")) {
+    float fraction;
+    if (!absl::SimpleAtof(spec, &fraction) || !(fraction > 0.0f) ||
+        fraction > 1.0f) {
+      return errors::InvalidArgument("Wire codec topk fraction must be in ",
+                                     "(0, 1], got \"", spec, "\"");
+    }
+    options->set_codec(WireCodecOptions::TOP_K);
+    options->set_topk_fraction(fraction);
+  } else {
+    return errors::InvalidArgument(
+        "Unknown wire codec \"", spec,
+        "\"; expected one of none, fp16, bf16, snappy or topk:<fraction>");
+  }
+  return OkStatus();
+}
+
+bool WireCodecAppliesTo(const WireCodecOptions& options, DataType dtype) {
+  switch (options.codec()) {
+    case WireCodecOptions::FLOAT16:
+    case WireCodecOptions::BFLOAT16:
+    case WireCodecOptions::TOP_K:
+      return dtype == DT_FLOAT;
+    case WireCodecOptions::SNAPPY:
+      return DataTypeCanUseMemcpy(dtype);
+    default:
+      return false;
+  }
+}
+
+void WireCodecResidualStore::AddResidual(const string& key, Tensor* t) {
+  mutex_lock l(mu_);
+  auto it = residuals_.find(key);
+  if (it == residuals_.end() || !it->second.IsSameSize(*t)) return;
+  auto dst = t->flat<float>();
+  dst += it->second.flat<float>();
+}
+
+void WireCodecResidualStore::SetResidual(const string& key, Tensor residual) {
+  mutex_lock l(mu_);
+  if (residual.IsInitialized()) {
+    residuals_[key] = std::move(residual);
+  } else {
+    residuals_.erase(key);
+  }
+}
+
+void WireCodecResidualStore::Clear() {
+  mutex_lock l(mu_);
+  residuals_.clear();
+}
+
+Status EncodeTensorContent(const WireCodecOptions& options, const Tensor& in,
+                           const string& key,
+                           WireCodecResidualStore* residuals,
+                           CompressedTensorContent* out) {
+  out->Clear();
+  if (!DataTypeCanUseMemcpy(in.dtype())) {
+    return errors::InvalidArgument("Cannot wire-encode a tensor of type ",
+                                   DataTypeString(in.dtype()));
+  }
+  Tensor dense = in;
+  const int64_t n = in.NumElements();
+  const WireCodecOptions::Codec codec =
+      WireCodecAppliesTo(options, in.dtype()) ? options.codec()
+                                              : WireCodecOptions::NONE;
+  switch (codec) {
+    case WireCodecOptions::FLOAT16: {
+      string* data = out->mutable_data();
+      data->resize(n * sizeof(Eigen::half));
+      const float* src = in.flat<float>().data();
+      Eigen::half* dst = reinterpret_cast<Eigen::half*>(&(*data)[0]);
+      for (int64_t i = 0; i < n; ++i) dst[i] = Eigen::half(src[i]);
+      out->set_codec(codec);
+      return OkStatus();
+    }
+    case WireCodecOptions::BFLOAT16: {
+      string* data = out->mutable_data();
+      data->resize(n * sizeof(bfloat16));
+      RoundFloatToBFloat16(in.flat<float>().data(),
+                           reinterpret_cast<bfloat16*>(&(*data)[0]), n);
+      out->set_codec(codec);
+      return OkStatus();
+    }
+    case WireCodecOptions::TOP_K:
+      if (EncodeTopK(options, in, key, residuals, &dense, out)) {
+        return OkStatus();
+      }
+      break;
+    case WireCodecOptions::SNAPPY: {
+      const StringPiece raw = in.tensor_data();
+      string compressed;
+      if (port::Snappy_Compress(raw.data(), raw.size(), &compressed) &&
+          compressed.size() < raw.size()) {
+        out->set_codec(codec);
+        out->set_data(std::move(compressed));
+        return OkStatus();
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  const StringPiece raw = dense.tensor_data();
+  out->set_codec(WireCodecOptions::NONE);
+  out->set_data(raw.data(), raw.size());
+  return OkStatus();
+}
+
+Status DecodeTensorContent(const CompressedTensorContent& in, Tensor* out) {
+  const int64_t n = out->NumElements();
+  const StringPiece buf = out->tensor_data();
+  char* dst = const_cast<char*>(buf.data());
+  const string& data = in.data();
+  if (in.codec() != WireCodecOptions::NONE &&
+      in.codec() != WireCodecOptions::SNAPPY && out->dtype() != DT_FLOAT) {
+    return errors::InvalidArgument("Wire codec ", in.codec(),
+                                   " cannot decode into a tensor of type ",
+                                   DataTypeString(out->dtype()));
+  }
+  switch (in.codec()) {
+    case WireCodecOptions::NONE:
+      if (data.size() != buf.size()) break;
+      if (!data.empty()) std::memcpy(dst, data.data(), data.size());
+      return OkStatus();
+    case WireCodecOptions::FLOAT16: {
+      if (data.size() != n * sizeof(Eigen::half)) break;
+      const Eigen::half* src =
+          reinterpret_cast<const Eigen::half*>(data.data());
+      float* values = reinterpret_cast<float*>(dst);
+      for (int64_t i = 0; i < n; ++i) values[i] = static_cast<float>(src[i]);
+      return OkStatus();
+    }
+    case WireCodecOptions::BFLOAT16:
+      if (data.size() != n * sizeof(bfloat16)) break;
+      BFloat16ToFloat(reinterpret_cast<const bfloat16*>(data.data()),
+                      reinterpret_cast<float*>(dst), n);
+      return OkStatus();
+    case WireCodecOptions::TOP_K: {
+      if (data.size() != in.indices_size() * sizeof(float)) break;
+      const float* kept = reinterpret_cast<const float*>(data.data());
+      float* values = reinterpret_cast<float*>(dst);
+      std::fill(values, values + n, 0.0f);
+      for (int i = 0; i < in.indices_size(); ++i) {
+        if (in.indices(i) >= n) {
+          return errors::InvalidArgument("Wire codec top-k index ",
+                                         in.indices(i), " is out of range for ",
+                                         n, " elements");
+        }
+        values[in.indices(i)] = kept[i];
+      }
+      return OkStatus();
+    }
+    case WireCodecOptions::SNAPPY: {
+      size_t length;
+      if (!port::Snappy_GetUncompressedLength(data.data(), data.size(),
+                                              &length) ||
+          length != buf.size() ||
+          !port::Snappy_Uncompress(data.data(), data.size(), dst)) {
+        break;
+      }
+      return OkStatus();
+    }
+    default:
+      return errors::Unimplemented("Unknown wire codec ", in.codec());
+  }
+  return errors::InvalidArgument("Wire codec ", in.codec(), " content of ",
+                                 data.size(), " bytes does not match a ",
+                                 out->shape().DebugString(), " tensor");
+}
+
+}  // namespace tensorflow
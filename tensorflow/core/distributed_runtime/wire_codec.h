@@ -0,0 +1,76 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WIRE_CODEC_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WIRE_CODEC_H_
+
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+// Wire codecs trade precision or CPU time for bandwidth when tensors cross
+// the network. They are opt-in: a sender is told which codec to use by the
+// `_wire_codec` attr of a _Send op (see SendOp), or for collectives by the
+// receiver's TF_COLLECTIVE_WIRE_CODEC environment variable. Receivers decode
+// whatever arrives, since CompressedTensorContent is self-describing.
+
+// Parses a codec spec: "" or "none", "fp16", "bf16", "snappy", or
+// "topk:<fraction>" with the fraction in (0, 1].
+Status ParseWireCodec(StringPiece spec, WireCodecOptions* options);
+
+// Returns true if `options` changes how a tensor of `dtype` is sent.
+bool WireCodecAppliesTo(const WireCodecOptions& options, DataType dtype);
+
+// Holds the part of each tensor that TOP_K did not send, keyed by the
+// rendezvous key, so that it can be added to the next send of that key
+// (error feedback). Thread safe.
+class WireCodecResidualStore {
+ public:
+  // Adds the stored residual for `key`, if it has the same shape, to `*t`.
+  void AddResidual(const string& key, Tensor* t);
+
+  // Replaces the stored residual for `key`.
+  void SetResidual(const string& key, Tensor residual);
+
+  void Clear();
+
+ private:
+  mutex mu_;
+  absl::flat_hash_map<string, Tensor> residuals_ TF_GUARDED_BY(mu_);
+};
+
+// Encodes the content of `in`, which must be in host memory, into `*out`.
+// Falls back to the NONE codec, which copies the raw bytes, when `options`
+// does not apply or would not save space. `residuals` may be null, in which
+// case TOP_K runs without error feedback.
+Status EncodeTensorContent(const WireCodecOptions& options, const Tensor& in,
+                           const string& key,
+                           WireCodecResidualStore* residuals,
+                           CompressedTensorContent* out);
+
+// Decodes `in` into `*out`, which must be a host tensor that already has the
+// dtype and shape of the encoded tensor.
+Status DecodeTensorContent(const CompressedTensorContent& in, Tensor* out);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WIRE_CODEC_H_
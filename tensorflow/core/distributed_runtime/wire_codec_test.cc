@@ -0,0 +1,140 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/wire_codec.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+WireCodecOptions Codec(const string& spec) {
+  WireCodecOptions options;
+  TF_CHECK_OK(ParseWireCodec(spec, &options));
+  return options;
+}
+
+Tensor RoundTrip(const WireCodecOptions& options, const Tensor& in,
+                 WireCodecResidualStore* residuals,
+                 CompressedTensorContent* content) {
+  TF_CHECK_OK(EncodeTensorContent(options, in, "key", residuals, content));
+  Tensor out(in.dtype(), in.shape());
+  TF_CHECK_OK(DecodeTensorContent(*content, &out));
+  return out;
+}
+
+TEST(WireCodecTest, ParseSpecs) {
+  EXPECT_EQ(Codec("").codec(), WireCodecOptions::NONE);
+  EXPECT_EQ(Codec("none").codec(), WireCodecOptions::NONE);
+  EXPECT_EQ(Codec("fp16").codec(), WireCodecOptions::FLOAT16);
+  EXPECT_EQ(Codec("bf16").codec(), WireCodecOptions::BFLOAT16);
+  EXPECT_EQ(Codec("snappy").codec(), WireCodecOptions::SNAPPY);
+  WireCodecOptions topk = Codec("topk:0.25");
+  EXPECT_EQ(topk.codec(), WireCodecOptions::TOP_K);
+  EXPECT_FLOAT_EQ(topk.topk_fraction(), 0.25f);
+
+  WireCodecOptions options;
+  EXPECT_FALSE(ParseWireCodec("lz4", &options).ok());
+  EXPECT_FALSE(ParseWireCodec("topk:0", &options).ok());
+  EXPECT_FALSE(ParseWireCodec("topk:1.5", &options).ok());
+  EXPECT_FALSE(ParseWireCodec("topk:x", &options).ok());
+}
+
+TEST(WireCodecTest, AppliesTo) {
+  EXPECT_TRUE(WireCodecAppliesTo(Codec("bf16"), DT_FLOAT));
+  EXPECT_FALSE(WireCodecAppliesTo(Codec("bf16"), DT_INT32));
+  EXPECT_FALSE(WireCodecAppliesTo(Codec("topk:0.1"), DT_DOUBLE));
+  EXPECT_TRUE(WireCodecAppliesTo(Codec("snappy"), DT_INT64));
+  EXPECT_FALSE(WireCodecAppliesTo(Codec("snappy"), DT_STRING));
+  EXPECT_FALSE(WireCodecAppliesTo(Codec("none"), DT_FLOAT));
+}
+
+TEST(WireCodecTest, Downcasts) {
+  Tensor in(DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&in, {1.0f, -2.5f, 0.0f, 1024.0f, 0.125f, 3.0f});
+  for (const char* spec : {"fp16", "bf16"}) {
+    CompressedTensorContent content;
+    Tensor out = RoundTrip(Codec(spec), in, nullptr, &content);
+    EXPECT_EQ(content.data().size(), in.TotalBytes() / 2) << spec;
+    test::ExpectTensorEqual<float>(in, out);
+  }
+}
+
+TEST(WireCodecTest, SnappyIsLossless) {
+  Tensor in(DT_INT32, TensorShape({4096}));
+  auto flat = in.flat<int32>();
+  for (int i = 0; i < flat.size(); ++i) flat(i) = i % 7;
+  CompressedTensorContent content;
+  Tensor out = RoundTrip(Codec("snappy"), in, nullptr, &content);
+  test::ExpectTensorEqual<int32>(in, out);
+  if (content.codec() == WireCodecOptions::SNAPPY) {
+    EXPECT_LT(content.data().size(), in.TotalBytes());
+  } else {
+    // Built without snappy.
+    EXPECT_EQ(content.codec(), WireCodecOptions::NONE);
+  }
+}
+
+TEST(WireCodecTest, TopKWithErrorFeedback) {
+  Tensor in(DT_FLOAT, TensorShape({8}));
+  test::FillValues<float>(&in, {0.1f, -4.0f, 0.2f, 3.0f, 0.0f, 0.3f, 0, 0});
+  WireCodecResidualStore residuals;
+  CompressedTensorContent content;
+  Tensor out = RoundTrip(Codec("topk:0.25"), in, &residuals, &content);
+  EXPECT_EQ(content.codec(), WireCodecOptions::TOP_K);
+  EXPECT_EQ(content.indices_size(), 2);
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, -4.0f, 0, 3.0f, 0, 0, 0, 0}), out);
+
+  // What was dropped is added to the next send of the same key.
+  Tensor zeros(DT_FLOAT, TensorShape({8}));
+  test::FillFn<float>(&zeros, [](int) { return 0.0f; });
+  out = RoundTrip(Codec("topk:0.25"), zeros, &residuals, &content);
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, 0, 0.2f, 0, 0, 0.3f, 0, 0}), out);
+}
+
+TEST(WireCodecTest, FallsBackToRawBytes) {
+  // Too few elements for top-k to save space.
+  Tensor small = test::AsTensor<float>({1.0f, 2.0f});
+  CompressedTensorContent content;
+  Tensor out = RoundTrip(Codec("topk:0.5"), small, nullptr, &content);
+  EXPECT_EQ(content.codec(), WireCodecOptions::NONE);
+  test::ExpectTensorEqual<float>(small, out);
+
+  // Downcasts do not apply to integers.
+  Tensor ints = test::AsTensor<int32>({1, 2, 3});
+  out = RoundTrip(Codec("bf16"), ints, nullptr, &content);
+  EXPECT_EQ(content.codec(), WireCodecOptions::NONE);
+  test::ExpectTensorEqual<int32>(ints, out);
+}
+
+TEST(WireCodecTest, DecodeRejectsMismatchedContent) {
+  Tensor in(DT_FLOAT, TensorShape({4}));
+  test::FillIota<float>(&in, 1.0f);
+  CompressedTensorContent content;
+  TF_ASSERT_OK(EncodeTensorContent(Codec("bf16"), in, "key", nullptr,
+                                   &content));
+  Tensor wrong_shape(DT_FLOAT, TensorShape({5}));
+  EXPECT_FALSE(DecodeTensorContent(content, &wrong_shape).ok());
+  Tensor wrong_type(DT_INT32, TensorShape({4}));
+  EXPECT_FALSE(DecodeTensorContent(content, &wrong_type).ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -104,6 +104,9 @@ void Worker::DeregisterGraphAsync(const DeregisterGraphRequest* request,
   if (s.ok()) {
     s = session->graph_mgr()->Deregister(request->graph_handle());
   }
+  if (s.ok()) {
+    session->DeregisterStepTemplates(request->graph_handle());
+  }
 
   done(s);
 }
@@ -123,9 +126,27 @@ void Worker::AbortStep(int64_t step_id) {
 }
 
 Status Worker::PrepareRunGraph(RunGraphRequestWrapper* req,
+                               const WorkerSession::StepTemplate* step_template,
                                GraphMgr::NamedTensors* in,
                                GraphMgr::NamedTensors* out) {
   static Tensor empty_tensor(DT_FLOAT);
+  if (step_template != nullptr) {
+    if (req->num_sends() != step_template->send_keys.size()) {
+      return errors::InvalidArgument(
+          "RunGraph request has ", req->num_sends(),
+          " sends but step template ", req->step_template_id(), " expects ",
+          step_template->send_keys.size());
+    }
+    Tensor val;
+    for (size_t i = 0; i < req->num_sends(); ++i) {
+      TF_RETURN_IF_ERROR(req->SendValue(i, &val));
+      in->insert({step_template->send_keys[i], val});
+    }
+    for (const string& recv_key : step_template->recv_keys) {
+      out->insert({recv_key, empty_tensor});
+    }
+    return OkStatus();
+  }
   if (req->num_sends() > 0) {
     Tensor val;
     for (size_t i = 0; i < req->num_sends(); ++i) {
@@ -139,6 +160,36 @@ Status Worker::PrepareRunGraph(RunGraphRequestWrapper* req,
   return OkStatus();
 }
 
+Status Worker::ResolveStepTemplate(
+    RunGraphRequestWrapper* req, WorkerSession* session,
+    std::shared_ptr<const WorkerSession::StepTemplate>* step_template) {
+  step_template->reset();
+  if (req->step_template_id() == 0) {
+    if (req->register_step_template()) {
+      return errors::InvalidArgument(
+          "RunGraph request registers a step template without an id");
+    }
+    return OkStatus();
+  }
+  if (req->register_step_template()) {
+    // The request itself is complete, so run it as is and only remember its
+    // fixed parts for subsequent steps.
+    WorkerSession::StepTemplate t;
+    t.graph_handle = req->graph_handle();
+    t.send_keys.reserve(req->num_sends());
+    for (size_t i = 0; i < req->num_sends(); ++i) {
+      t.send_keys.push_back(req->send_key(i));
+    }
+    t.recv_keys.reserve(req->num_recvs());
+    for (size_t i = 0; i < req->num_recvs(); ++i) {
+      t.recv_keys.push_back(req->recv_key(i));
+    }
+    session->RegisterStepTemplate(req->step_template_id(), std::move(t));
+    return OkStatus();
+  }
+  return session->LookupStepTemplate(req->step_template_id(), step_template);
+}
+
 void Worker::RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
                            MutableRunGraphResponseWrapper* response,
                            StatusCallback done) {
@@ -186,14 +237,22 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
     done(s);
     return;
   }
+  std::shared_ptr<const WorkerSession::StepTemplate> step_template;
+  s = ResolveStepTemplate(request, session.get(), &step_template);
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
   GraphMgr::NamedTensors in;
   GraphMgr::NamedTensors* out = new GraphMgr::NamedTensors;
-  s = PrepareRunGraph(request, &in, out);
+  s = PrepareRunGraph(request, step_template.get(), &in, out);
   if (!s.ok()) {
     delete out;
     done(s);
     return;
   }
+  const string& graph_handle =
+      step_template ? step_template->graph_handle : request->graph_handle();
   StepStatsCollector* collector = nullptr;
   if (request->exec_opts().report_tensor_allocations_upon_oom() ||
       request->exec_opts().record_timeline() ||
@@ -225,7 +284,7 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
     return;
   }
   session->graph_mgr()->ExecuteAsync(
-      request->graph_handle(), step_id, request->exec_opts(), in, session.get(),
+      graph_handle, step_id, request->exec_opts(), in, session.get(),
       collector, response, cm, env_->session_mgr->GetCoordinationServiceAgent(),
       [this, step_id, response, session, cm, out, token, collector,
        device_profiler_session, opts, done](const Status& status) {
@@ -288,7 +347,7 @@ void Worker::DoPartialRunGraph(CallOptions* opts,
 
   GraphMgr::NamedTensors in;
   GraphMgr::NamedTensors* out = new GraphMgr::NamedTensors;
-  s = PrepareRunGraph(request, &in, out);
+  s = PrepareRunGraph(request, /*step_template=*/nullptr, &in, out);
   auto finish = [done, out, opts](const Status& s) {
     opts->ClearCancelCallback();
     delete out;
@@ -122,10 +122,19 @@ class Worker : public WorkerInterface {
 
   CancellationManager cancellation_manager_;
 
+  // If `step_template` is non-null, the send and recv keys are taken from
+  // it rather than from `req`.
   Status PrepareRunGraph(RunGraphRequestWrapper* req,
+                         const WorkerSession::StepTemplate* step_template,
                          GraphMgr::NamedTensors* in,
                          GraphMgr::NamedTensors* out);
 
+  // Registers or looks up the step template named by `req`, if any. Leaves
+  // `step_template` null for requests that do not use a template.
+  Status ResolveStepTemplate(
+      RunGraphRequestWrapper* req, WorkerSession* session,
+      std::shared_ptr<const WorkerSession::StepTemplate>* step_template);
+
   void DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
                   MutableRunGraphResponseWrapper* response,
                   StatusCallback done);
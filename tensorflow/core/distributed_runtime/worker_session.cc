@@ -176,6 +176,38 @@ WorkerSession::WorkerSession(
   worker_session_created->GetCell()->Set(true);
 }
 
+void WorkerSession::RegisterStepTemplate(int64_t step_template_id,
+                                         StepTemplate step_template) {
+  auto t = std::make_shared<const StepTemplate>(std::move(step_template));
+  mutex_lock l(step_templates_mu_);
+  step_templates_[step_template_id] = std::move(t);
+}
+
+Status WorkerSession::LookupStepTemplate(
+    int64_t step_template_id,
+    std::shared_ptr<const StepTemplate>* step_template) const {
+  tf_shared_lock l(step_templates_mu_);
+  auto it = step_templates_.find(step_template_id);
+  if (it == step_templates_.end()) {
+    return errors::FailedPrecondition("Step template ", step_template_id,
+                                      " is not registered in session ",
+                                      session_name_);
+  }
+  *step_template = it->second;
+  return OkStatus();
+}
+
+void WorkerSession::DeregisterStepTemplates(const string& graph_handle) {
+  mutex_lock l(step_templates_mu_);
+  for (auto it = step_templates_.begin(); it != step_templates_.end();) {
+    if (it->second->graph_handle == graph_handle) {
+      it = step_templates_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 WorkerSession::~WorkerSession() {
   if (graph_mgr_) {
     Status s = graph_mgr_->DeregisterAll();
@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WORKER_SESSION_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_WORKER_SESSION_H_
 
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/distributed_runtime/cluster_function_library_runtime.h"
@@ -85,6 +88,28 @@ class WorkerSession {
       std::vector<std::unique_ptr<Device>> added_remote_devices,
       const std::vector<Device*>& removed_remote_devices);
 
+  // The parts of a RunGraphRequest that stay fixed across the steps of a
+  // registered graph. See `RunGraphRequest.step_template_id`.
+  struct StepTemplate {
+    string graph_handle;
+    std::vector<string> send_keys;
+    std::vector<string> recv_keys;
+  };
+
+  // Records `step_template` as `step_template_id`, replacing any template
+  // previously registered under the same id.
+  void RegisterStepTemplate(int64_t step_template_id,
+                            StepTemplate step_template);
+
+  // Returns the template registered as `step_template_id`, or a
+  // FailedPrecondition error if there is none.
+  Status LookupStepTemplate(
+      int64_t step_template_id,
+      std::shared_ptr<const StepTemplate>* step_template) const;
+
+  // Drops every template that refers to `graph_handle`.
+  void DeregisterStepTemplates(const string& graph_handle);
+
   ~WorkerSession();
 
  private:
@@ -116,6 +141,10 @@ class WorkerSession {
   const std::unique_ptr<DeviceMgr> device_mgr_;
   DeviceMgr* const borrowed_device_mgr_;  // Not owned.
   std::unique_ptr<DynamicDeviceMgr> remote_device_mgr_;
+
+  mutable mutex step_templates_mu_;
+  std::unordered_map<int64_t, std::shared_ptr<const StepTemplate>>
+      step_templates_ TF_GUARDED_BY(step_templates_mu_);
 };
 
 }  // namespace tensorflow
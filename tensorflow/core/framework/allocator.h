@@ -60,6 +60,10 @@ struct AllocationAttributes {
   // a memory chunk whose freed_at_count is at this value or earlier may be
   // returned.
   std::function<uint64()>* freed_by_func = nullptr;  // Not owned.
+  // If true, the caller guarantees that the buffer is released before the
+  // kernel allocating it returns: it is neither an output nor kept by the
+  // kernel. Such temporaries may be served by a step-scoped arena.
+  bool step_local = false;
 
   TF_DISALLOW_COPY_AND_ASSIGN(AllocationAttributes);
 };
@@ -86,6 +90,10 @@ struct AllocatorStats {
 
   int64_t largest_free_block_bytes;  // Largest free block's size in heap.
 
+  // Number of bytes of freed allocations held by per-thread caches for reuse.
+  // These bytes are not included in `bytes_in_use`.
+  int64_t bytes_in_thread_caches;
+
   AllocatorStats()
       : num_allocs(0),
         bytes_in_use(0),
@@ -93,7 +101,8 @@ struct AllocatorStats {
         largest_alloc_size(0),
         bytes_reserved(0),
         peak_bytes_reserved(0),
-        largest_free_block_bytes(0) {}
+        largest_free_block_bytes(0),
+        bytes_in_thread_caches(0) {}
 
   std::string DebugString() const;
 };
@@ -221,6 +230,10 @@ class Allocator {
 
   virtual void SetSafeFrontier(uint64 count) {}
 
+  // Called after a step that allocated from this allocator has finished.
+  // Allocators may use it to return memory that is no longer needed.
+  virtual void OnStepBoundary() {}
+
   // For allocator that are stream aware, allow to specify the compute
   // stream this allocator is used for. This can also trigger memory
   // preallocation.
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/allocation_sampler.h"
 #include "tensorflow/core/profiler/lib/scoped_memory_debug_annotation.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 
@@ -85,6 +86,8 @@ class CPUAllocator : public Allocator {
     }
 
     void* p = port::AlignedMalloc(num_bytes, alignment);
+    profiler::AllocationSampler::Global()->RecordAllocation("cpu", p,
+                                                            num_bytes);
     if (cpu_allocator_collect_stats) {
       const std::size_t alloc_size = port::MallocExtension_GetAllocatedSize(p);
       mutex_lock l(mu_);
@@ -110,6 +113,7 @@ class CPUAllocator : public Allocator {
   }
 
   void DeallocateRaw(void* ptr) override {
+    profiler::AllocationSampler::Global()->RecordDeallocation(ptr);
     if (cpu_allocator_collect_stats) {
       const std::size_t alloc_size =
           port::MallocExtension_GetAllocatedSize(ptr);
@@ -638,7 +638,7 @@ Status DatasetBase::CheckRandomAccessCompatible(const int64 index) const {
   return OkStatus();
 }
 
-Status DatasetBase::Get(OpKernelContext* ctx, int64 index,
+Status DatasetBase::Get(AnyContext ctx, int64 index,
                         std::vector<Tensor>* out_tensors) const {
   return errors::Unimplemented(
       "Random access is not implemented for this dataset.");
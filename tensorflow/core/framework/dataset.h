@@ -588,6 +588,39 @@ class IteratorContext {
   Params params_;
 };
 
+// Aggregates the runtime support needed to access the elements of a dataset by
+// index (see `DatasetBase::Get()`), which can happen both in op kernels and in
+// iterators.
+struct AnyContext {
+  Allocator* allocator;
+  Env* env;
+  FunctionLibraryRuntime* flr;
+  FunctionHandleCache* function_handle_cache;
+  std::function<void(std::function<void()>)>* runner;
+  int32 runner_threadpool_size;
+  // The op kernel context that random access is happening in, or nullptr if it
+  // is happening in an iterator.
+  OpKernelContext* op_kernel_context;
+
+  explicit AnyContext(IteratorContext* ctx)
+      : allocator(ctx->allocator({})),
+        env(ctx->env()),
+        flr(ctx->flr()),
+        function_handle_cache(ctx->function_handle_cache()),
+        runner(ctx->runner()),
+        runner_threadpool_size(ctx->runner_threadpool_size()),
+        op_kernel_context(nullptr) {}
+
+  explicit AnyContext(OpKernelContext* ctx)
+      : allocator(ctx->get_allocator({})),
+        env(ctx->env()),
+        flr(ctx->function_library()),
+        function_handle_cache(nullptr),
+        runner(ctx->runner()),
+        runner_threadpool_size(GetRunnerThreadpoolSizeFromOpKernelContext(ctx)),
+        op_kernel_context(ctx) {}
+};
+
 // Aggregates runtime support needed for dataset and iterator serialization.
 class SerializationContext {
  public:
@@ -1024,7 +1057,7 @@ class DatasetBase : public core::RefCounted {
   Status CheckRandomAccessCompatible(const int64 index) const;
 
   // Return the element at a particular index for a randomly accessible dataset.
-  virtual Status Get(OpKernelContext* ctx, int64 index,
+  virtual Status Get(AnyContext ctx, int64 index,
                      std::vector<Tensor>* out_tensors) const;
 
   // Return a finalized version of the dataset.  The returned DatasetBase is
@@ -204,6 +204,15 @@ class DeviceBase {
 
   virtual ScopedAllocatorMgr* GetScopedAllocatorMgr() const { return nullptr; }
 
+  // Returns an allocator for the temporary buffers of one step, or nullptr if
+  // the device does not provide one. The executor calls this when a step
+  // starts and passes the result to `ReleaseStepTempAllocator()` when the step
+  // is done. Buffers may be allocated from it by `OpKernelContext` only while
+  // the step is running, and only for temporaries the kernel declares
+  // `AllocationAttributes::step_local`.
+  virtual Allocator* AcquireStepTempAllocator() { return nullptr; }
+  virtual void ReleaseStepTempAllocator(Allocator* allocator) {}
+
   virtual bool has_eigen_cpu_device() const {
     return !eigen_cpu_devices_.empty();
   }
@@ -100,26 +100,26 @@ void LocalRendezvous::ItemQueue::push_back(Item* item) {
 LocalRendezvous::~LocalRendezvous() {
   // Before destroying this rendezvous instance, make sure all the done-callback
   // calls have finished and the tensors have been released from the queue.
-  {
-    mutex_lock l(mu_);
-    while (pending_callback_counter_ != 0) {
-      pending_callback_cond_var_.wait_for(l, std::chrono::milliseconds(50));
+  bool table_not_empty = false;
+  for (int i = 0; i < num_buckets_; ++i) {
+    TableBucket& bucket = table_buckets_[i];
+    mutex_lock l(bucket.mu);
+    while (bucket.pending_callback_counter != 0) {
+      bucket.pending_callback_cond_var.wait_for(l,
+                                                std::chrono::milliseconds(50));
     }
+    table_not_empty |= !bucket.table.empty();
   }
 
-  if (!table_.empty()) {
+  if (table_not_empty) {
     StartAbort(errors::Cancelled("LocalRendezvous deleted"));
   }
 }
 
-namespace {
-uint64 KeyHash(const StringPiece& k) { return Hash64(k.data(), k.size()); }
-}  // namespace
-
 Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
                              const Rendezvous::Args& send_args,
                              const Tensor& val, const bool is_dead) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  const uint64 key_hash = key.hash();
   DVLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
   if (is_dead) {
@@ -132,15 +132,16 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
         ->IncrementBy(1);
   }
 
-  mu_.lock();
-  if (!status_.ok()) {
+  TableBucket& bucket = BucketFor(key_hash);
+  bucket.mu.lock();
+  if (!bucket.status.ok()) {
     // Rendezvous has been aborted.
-    Status s = status_;
-    mu_.unlock();
+    Status s = bucket.status;
+    bucket.mu.unlock();
     return s;
   }
 
-  ItemQueue* queue = &table_[key_hash];
+  ItemQueue* queue = &bucket.table[key_hash];
   if (queue->head == nullptr || queue->head->type == Item::kSend) {
     // There is no waiter for this message. Append the message
     // into the queue. The waiter will pick it up when arrives.
@@ -149,7 +150,7 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
     // the lock.
     DVLOG(2) << "Enqueue Send Item (key:" << key.FullKey() << "). ";
     queue->push_back(new Item(send_args, val, is_dead));
-    mu_.unlock();
+    bucket.mu.unlock();
     return OkStatus();
   }
 
@@ -160,7 +161,7 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
   // Delete the queue when the last element has been consumed.
   if (item->next == nullptr) {
     DVLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-    table_.erase(key_hash);
+    bucket.table.erase(key_hash);
   } else {
     queue->head = item->next;
   }
@@ -174,17 +175,17 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
     rc_owner_ref.reset(rc_owner_);
     rc_owner_->Ref();
   }
-  pending_callback_counter_++;
+  bucket.pending_callback_counter++;
   // Invoke the done-callback, without holding the lock.
-  mu_.unlock();
+  bucket.mu.unlock();
   DCHECK_EQ(item->type, Item::kRecv);
   (*item->recv_state.waiter)(OkStatus(), send_args, item->args, val, is_dead);
   delete item;
   {
-    mutex_lock l(mu_);
-    pending_callback_counter_--;
-    if (pending_callback_counter_ == 0) {
-      pending_callback_cond_var_.notify_all();
+    mutex_lock l(bucket.mu);
+    bucket.pending_callback_counter--;
+    if (bucket.pending_callback_counter == 0) {
+      bucket.pending_callback_cond_var.notify_all();
     }
   }
   return OkStatus();
@@ -193,19 +194,20 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
 void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
                                 const Rendezvous::Args& recv_args,
                                 Rendezvous::DoneCallback done) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  const uint64 key_hash = key.hash();
   DVLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
-  mu_.lock();
-  if (!status_.ok()) {
+  TableBucket& bucket = BucketFor(key_hash);
+  bucket.mu.lock();
+  if (!bucket.status.ok()) {
     // Rendezvous has been aborted.
-    Status s = status_;
-    mu_.unlock();
+    Status s = bucket.status;
+    bucket.mu.unlock();
     done(s, Rendezvous::Args(), recv_args, Tensor(), false);
     return;
   }
 
-  ItemQueue* queue = &table_[key_hash];
+  ItemQueue* queue = &bucket.table[key_hash];
   if (queue->head == nullptr || queue->head->type == Item::kRecv) {
     // There is no message to pick up.
     // Only recv-related fields need to be filled.
@@ -231,8 +233,9 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       already_cancelled = !cm->RegisterCallback(token, [this, token, key_hash] {
         Item* item = nullptr;
         {
-          mutex_lock l(mu_);
-          ItemQueue* queue = &table_[key_hash];
+          TableBucket& bucket = BucketFor(key_hash);
+          mutex_lock l(bucket.mu);
+          ItemQueue* queue = &bucket.table[key_hash];
           // Find an item in the queue with a cancellation token that matches
           // `token`, and remove it.
           if (queue->head != nullptr && queue->head->type == Item::kRecv) {
@@ -243,7 +246,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
                 if (queue->head->next == nullptr) {
                   // We have a single-element queue, so we can erase it from
                   // the table.
-                  table_.erase(key_hash);
+                  bucket.table.erase(key_hash);
                 } else {
                   // Remove the current item from the queue.
                   if (curr == queue->head) {
@@ -275,7 +278,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       });
     }
     if (already_cancelled) {
-      mu_.unlock();
+      bucket.mu.unlock();
       // Unref case (2)
       if (rc_owner_) rc_owner_->Unref();
       done(StatusGroup::MakeDerived(
@@ -312,7 +315,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       queue->push_back(new Item(recv_args, std::move(done), token));
     }
 
-    mu_.unlock();
+    bucket.mu.unlock();
     return;
   }
 
@@ -324,7 +327,7 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
   // Delete the queue when the last element has been consumed.
   if (item->next == nullptr) {
     DVLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-    table_.erase(key_hash);
+    bucket.table.erase(key_hash);
   } else {
     queue->head = item->next;
   }
@@ -338,49 +341,58 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
     rc_owner_ref.reset(rc_owner_);
     rc_owner_->Ref();
   }
-  pending_callback_counter_++;
+  bucket.pending_callback_counter++;
   // Invoke the done-callback, without holding the lock.
-  mu_.unlock();
+  bucket.mu.unlock();
   DCHECK_EQ(item->type, Item::kSend);
   done(OkStatus(), item->args, recv_args, *item->send_state.value,
        item->send_state.is_dead);
   delete item;
   {
-    mutex_lock l(mu_);
-    pending_callback_counter_--;
-    if (pending_callback_counter_ == 0) {
-      pending_callback_cond_var_.notify_all();
+    mutex_lock l(bucket.mu);
+    bucket.pending_callback_counter--;
+    if (bucket.pending_callback_counter == 0) {
+      bucket.pending_callback_cond_var.notify_all();
     }
   }
 }
 
 void LocalRendezvous::StartAbort(const Status& status) {
   CHECK(!status.ok());
-  Table table;
+  Status aborted;
   {
     mutex_lock l(mu_);
     status_.Update(status);
-    table_.swap(table);
+    aborted = status_;
   }
-  for (auto& p : table) {
-    Item* item = p.second.head;
-    while (item != nullptr) {
-      if (item->type == Item::kRecv) {
-        (*item->recv_state.waiter)(status, Rendezvous::Args(),
-                                   Rendezvous::Args(), Tensor(), false);
+  // Each bucket is marked aborted while its table is taken, so no item can be
+  // added after it has been drained.
+  for (int i = 0; i < num_buckets_; ++i) {
+    TableBucket& bucket = table_buckets_[i];
+    Table table;
+    {
+      mutex_lock l(bucket.mu);
+      bucket.status = aborted;
+      bucket.table.swap(table);
+    }
+    for (auto& p : table) {
+      Item* item = p.second.head;
+      while (item != nullptr) {
+        if (item->type == Item::kRecv) {
+          (*item->recv_state.waiter)(status, Rendezvous::Args(),
+                                     Rendezvous::Args(), Tensor(), false);
+        }
+        Item* to_delete = item;
+        item = item->next;
+        delete to_delete;
       }
-      Item* to_delete = item;
-      item = item->next;
-      delete to_delete;
     }
   }
 }
 
 Status LocalRendezvous::status() {
-  mu_.lock();
-  Status s = status_;
-  mu_.unlock();
-  return s;
+  mutex_lock l(mu_);
+  return status_;
 }
 
 }  // namespace tensorflow
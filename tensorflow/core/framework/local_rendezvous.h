@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 
+#include <memory>
+
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -33,14 +35,23 @@ namespace tensorflow {
 // IntraProcessRendezvous or RemoteRendezvous. This class does not implement
 // RendezvousInterface because virtual dispatch to LocalRendezvous methods
 // is not expected to be needed.
+//
+// The table of pending sends and receives is sharded by the hash of the key,
+// which ParseKey computes once, so Send and Recv on different keys rarely
+// contend.
 class LocalRendezvous {
  public:
+  static constexpr int kDefaultNumShards = 16;
+
   // If the class wrapping LocalRendezvous is refcounted (i.e., extending
   // Rendezvous), pass in its pointer in constructor so the LocalRendezvous
   // can make sure it outlives the async recv requests.
   // Pass in nullptr if the wrapping class is not refcounted.
-  explicit LocalRendezvous(Rendezvous* owner)
-      : rc_owner_(owner), pending_callback_counter_(0) {}
+  explicit LocalRendezvous(Rendezvous* owner,
+                           int num_shards = kDefaultNumShards)
+      : num_buckets_(num_shards > 0 ? num_shards : 1),
+        rc_owner_(owner),
+        table_buckets_(new TableBucket[num_buckets_]) {}
   ~LocalRendezvous();
 
   Status Send(const Rendezvous::ParsedKey& key,
@@ -68,16 +79,29 @@ class LocalRendezvous {
 
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
+  struct TableBucket {
+    profiled_mutex mu{"LocalRendezvous"};
+    Table table TF_GUARDED_BY(mu);
+    // Copy of status_ once the rendezvous is aborted, so that Send and Recv
+    // only need the bucket's lock.
+    Status status TF_GUARDED_BY(mu);
+    // Track the number of pening callbacks using a counter.
+    int pending_callback_counter TF_GUARDED_BY(mu) = 0;
+    condition_variable pending_callback_cond_var TF_GUARDED_BY(mu);
+  };
+
+  TableBucket& BucketFor(uint64 key_hash) {
+    return table_buckets_[key_hash % num_buckets_];
+  }
+
+  const int num_buckets_;
+
   // Pointer to the owner class of this LocalRendezvous if it is refcounted.
   const Rendezvous* rc_owner_;
 
-  // TODO(zhifengc): shard table_.
+  std::unique_ptr<TableBucket[]> table_buckets_;
   mutex mu_;
-  Table table_ TF_GUARDED_BY(mu_);
   Status status_ TF_GUARDED_BY(mu_);
-  // Track the number of pening callbacks using a counter.
-  int pending_callback_counter_ TF_GUARDED_BY(mu_);
-  condition_variable pending_callback_cond_var_ TF_GUARDED_BY(mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(LocalRendezvous);
 };
@@ -163,6 +163,25 @@ auto* tf_data_service_cross_trainer_cache_size_bytes =
         "/tensorflow/data/service/cross_trainer_cache_size_bytes",
         "tf.data service cross-trainer cache memory usage in bytes.");
 
+auto* tf_data_service_cross_trainer_cache_disk_size_bytes =
+    monitoring::Gauge<int64_t, 0>::New(
+        "/tensorflow/data/service/cross_trainer_cache_disk_size_bytes",
+        "tf.data service cross-trainer cache disk usage in bytes.");
+
+auto* tf_data_service_cross_trainer_cache_consumer_lag =
+    monitoring::Gauge<int64_t, 1>::New(
+        "/tensorflow/data/service/cross_trainer_cache_consumer_lag",
+        "Number of elements in the tf.data service cross-trainer cache newer "
+        "than the last element read by a trainer.",
+        "trainer_id");
+
+auto* tf_data_service_cross_trainer_cache_skipped_elements_counter =
+    monitoring::Counter<1>::New(
+        "/tensorflow/data/service/cross_trainer_cache_skipped_elements",
+        "Number of elements evicted from the tf.data service cross-trainer "
+        "cache before a trainer read them.",
+        "trainer_id");
+
 auto* tf_data_filename_counter = monitoring::Counter<2>::New(
     "/tensorflow/data/filename", "The file name read by a tf.data Dataset.",
     "name", "filename");
@@ -195,6 +214,13 @@ auto* tf_data_autotune_stopping_criteria_counter =
                                 "algorithm stopping criterion is met.",
                                 "name");
 
+auto* tf_data_autotune_buffer_allocation_bytes =
+    monitoring::Gauge<int64_t, 1>::New(
+        "/tensorflow/data/autotune_buffer_allocation_bytes",
+        "The number of bytes that tf.data autotuning allocated to buffers "
+        "controlled by tunable parameters of the given name.",
+        "parameter");
+
 auto* parse_dense_feature_counter = monitoring::Counter<0>::New(
     "/tensorflow/data/dense_feature",
     "The number of dense features parsed by ops for parsing tf.Example.");
@@ -233,6 +259,24 @@ auto* xla_compilation_time_usecs = monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilation_time_usecs",
     "The total time spent on compiling XLA graphs in microseconds.");
 
+auto* xla_async_compilation_queue_time_usecs = monitoring::Sampler<0>::New(
+    {"/tensorflow/core/xla_async_compilation_queue_time_usecs",
+     "The time an asynchronous XLA compilation waited for a compiler thread "
+     "in microseconds."},
+    // Power of 2 with bucket count 30 (> 17 minutes)
+    {monitoring::Buckets::Exponential(1, 2, 30)});
+
+auto* xla_shape_bucketing_elements = monitoring::Counter<1>::New(
+    "/tensorflow/core/xla_shape_bucketing_elements",
+    "The number of input elements of XLA clusters whose inputs were padded "
+    "to a shape bucket, either real or padding.",
+    "kind");
+
+auto* xla_async_compilations_deferred = monitoring::Counter<0>::New(
+    "/tensorflow/core/xla_async_compilations_deferred",
+    "The number of times an asynchronous XLA compilation was not started "
+    "because the maximum number of compilations were ongoing.");
+
 auto* xla_tpu_spmd_cores_per_replica = monitoring::Counter<1>::New(
     "/tensorflow/tpu/xla_spmd_cores_per_replica",
     "The number of cores used by XLA SPMD-replicated models.", "cores");
@@ -242,6 +286,44 @@ auto* bfc_allocator_delay =
                                 "The total time spent running each graph "
                                 "optimization pass in microseconds.");
 
+auto* bfc_allocator_free_bytes = monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/bfc_allocator_free_bytes",
+    "The bytes held by a BFC allocator that are not in use.", "allocator");
+
+auto* bfc_allocator_largest_free_chunk_bytes =
+    monitoring::Gauge<int64_t, 1>::New(
+        "/tensorflow/core/bfc_allocator_largest_free_chunk_bytes",
+        "The size of the largest free chunk of a BFC allocator.", "allocator");
+
+auto* gpu_copy_bytes = monitoring::Counter<1>::New(
+    "/tensorflow/core/gpu_copy_bytes",
+    "The number of bytes copied between host and GPU memory.", "direction");
+
+auto* gpu_copy_bandwidth_mbps = monitoring::Sampler<1>::New(
+    {"/tensorflow/core/gpu_copy_bandwidth_mbps",
+     "The achieved bandwidth of copies between host and GPU memory in MB/s.",
+     "direction"},
+    // Power of 2 with bucket count 20 (> 500GB/s)
+    {monitoring::Buckets::Exponential(1, 2, 20)});
+
+auto* grappler_pass_time_usecs = monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/grappler/pass_time_usecs",
+    "The wall time of a Grappler pass in the last MetaOptimizer run, summed "
+    "over the optimized graphs and functions.",
+    "pass");
+
+auto* grappler_pass_changed_nodes = monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/grappler/pass_changed_nodes",
+    "The number of nodes that a Grappler pass added, removed or modified in "
+    "the last MetaOptimizer run.",
+    "pass");
+
+auto* grappler_pass_peak_graph_bytes = monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/grappler/pass_peak_graph_bytes",
+    "The largest serialized size of a graph produced by a Grappler pass in "
+    "the last MetaOptimizer run.",
+    "pass");
+
 auto* tpu_variable_distribution_time_usecs = monitoring::Counter<0>::New(
     "/tensorflow/tpu/variable_distribution_time",
     "Time spent sending variables from primary task to other worker tasks "
@@ -394,6 +476,24 @@ void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes) {
       static_cast<int64_t>(bytes));
 }
 
+void RecordTFDataServiceCrossTrainerCacheDiskSizeBytes(size_t bytes) {
+  tf_data_service_cross_trainer_cache_disk_size_bytes->GetCell()->Set(
+      static_cast<int64_t>(bytes));
+}
+
+void RecordTFDataServiceCrossTrainerCacheConsumerLag(
+    const string& trainer_id, int64_t num_elements) {
+  tf_data_service_cross_trainer_cache_consumer_lag->GetCell(trainer_id)->Set(
+      num_elements);
+}
+
+void RecordTFDataServiceCrossTrainerCacheSkippedElements(
+    const string& trainer_id, int64_t num_elements) {
+  tf_data_service_cross_trainer_cache_skipped_elements_counter
+      ->GetCell(trainer_id)
+      ->IncrementBy(num_elements);
+}
+
 void RecordTFDataFilename(const string& name, const string& filename) {
   tf_data_filename_counter->GetCell(name, filename)->IncrementBy(1);
 }
@@ -420,6 +520,11 @@ void RecordTFDataAutotuneStoppingCriteria(const string& name) {
   tf_data_autotune_stopping_criteria_counter->GetCell(name)->IncrementBy(1);
 }
 
+void RecordTFDataAutotuneBufferAllocation(const string& parameter,
+                                          int64_t num_bytes) {
+  tf_data_autotune_buffer_allocation_bytes->GetCell(parameter)->Set(num_bytes);
+}
+
 void RecordParseDenseFeature(int64 num_features) {
   static auto* parse_dense_feature_counter_cell =
       parse_dense_feature_counter->GetCell();
@@ -500,6 +605,26 @@ void UpdateXlaCompilationTime(const uint64 compilation_time_usecs) {
   }
 }
 
+void UpdateXlaAsyncCompilationQueueTime(const uint64 queue_time_usecs) {
+  static auto* xla_async_compilation_queue_time_usecs_cell =
+      xla_async_compilation_queue_time_usecs->GetCell();
+  xla_async_compilation_queue_time_usecs_cell->Add(queue_time_usecs);
+}
+
+void IncrementXlaAsyncCompilationsDeferred() {
+  static auto* xla_async_compilations_deferred_cell =
+      xla_async_compilations_deferred->GetCell();
+  xla_async_compilations_deferred_cell->IncrementBy(1);
+}
+
+void RecordXlaShapeBucketingElements(int64_t real_elements,
+                                     int64_t padding_elements) {
+  static auto* real_cell = xla_shape_bucketing_elements->GetCell("real");
+  static auto* padding_cell = xla_shape_bucketing_elements->GetCell("padding");
+  real_cell->IncrementBy(real_elements);
+  padding_cell->IncrementBy(padding_elements);
+}
+
 void UpdateBfcAllocatorDelayTime(const uint64 delay_usecs) {
   static auto* bfc_allocator_delay_cell = bfc_allocator_delay->GetCell();
   if (delay_usecs > 0) {
@@ -507,6 +632,33 @@ void UpdateBfcAllocatorDelayTime(const uint64 delay_usecs) {
   }
 }
 
+void UpdateBfcAllocatorFreeBytes(const string& allocator_name,
+                                 int64_t free_bytes,
+                                 int64_t largest_free_chunk_bytes) {
+  bfc_allocator_free_bytes->GetCell(allocator_name)->Set(free_bytes);
+  bfc_allocator_largest_free_chunk_bytes->GetCell(allocator_name)
+      ->Set(largest_free_chunk_bytes);
+}
+
+void RecordGpuCopy(const string& direction, int64_t num_bytes,
+                   uint64 duration_usecs) {
+  gpu_copy_bytes->GetCell(direction)->IncrementBy(num_bytes);
+  if (duration_usecs > 0) {
+    // Bytes per microsecond are megabytes per second.
+    gpu_copy_bandwidth_mbps->GetCell(direction)->Add(
+        static_cast<double>(num_bytes) / duration_usecs);
+  }
+}
+
+void UpdateGrapplerPassMetrics(const string& pass_name,
+                               int64_t wall_time_usecs,
+                               int64_t num_changed_nodes,
+                               int64_t peak_graph_bytes) {
+  grappler_pass_time_usecs->GetCell(pass_name)->Set(wall_time_usecs);
+  grappler_pass_changed_nodes->GetCell(pass_name)->Set(num_changed_nodes);
+  grappler_pass_peak_graph_bytes->GetCell(pass_name)->Set(peak_graph_bytes);
+}
+
 void RecordUnusedOutput(const string& op_name) {
   graph_unused_outputs->GetCell(op_name)->IncrementBy(1);
 }
@@ -129,6 +129,20 @@ void RecordTFDataServiceCrossTrainerCacheQuery(bool cache_hit);
 // Records tf.data service cross-trainer cache memory usage in bytes.
 void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes);
 
+// Records the size in bytes of the elements the tf.data service cross-trainer
+// cache has spilled to disk.
+void RecordTFDataServiceCrossTrainerCacheDiskSizeBytes(size_t bytes);
+
+// Records how many cached elements are newer than the element `trainer_id`
+// just read from the tf.data service cross-trainer cache.
+void RecordTFDataServiceCrossTrainerCacheConsumerLag(
+    const string& trainer_id, int64_t num_elements);
+
+// Records elements the tf.data service cross-trainer cache evicted before
+// `trainer_id` could read them.
+void RecordTFDataServiceCrossTrainerCacheSkippedElements(
+    const string& trainer_id, int64_t num_elements);
+
 // Records the file name read by a tf.data Dataset.
 //
 // The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
@@ -155,6 +169,12 @@ void RecordTFDataAutoShardRewriteBatchSize(
 // criterion is met.
 void RecordTFDataAutotuneStoppingCriteria(const string& name);
 
+// Records the number of bytes that tf.data autotuning allocated to buffers
+// controlled by tunable parameters with the given name (e.g. "buffer_size" or
+// "parallelism"), summed over all input pipelines in the process.
+void RecordTFDataAutotuneBufferAllocation(const string& parameter,
+                                          int64_t num_bytes);
+
 // Records parsing of dense tensor features.
 void RecordParseDenseFeature(int64_t num_features);
 
@@ -302,9 +322,47 @@ void UpdateTpuVariableDistributionTime(const uint64 distribution_time_usecs);
 // Updates the metrics stored about time XLA spents compiling graphs.
 void UpdateXlaCompilationTime(const uint64 compilation_time_usecs);
 
+// Updates the distribution of the time asynchronous XLA compilations wait for
+// a compiler thread after they are queued.
+void UpdateXlaAsyncCompilationQueueTime(const uint64 queue_time_usecs);
+
+// Increments the number of asynchronous XLA compilations that were deferred
+// because the maximum number of compilations were already ongoing.
+void IncrementXlaAsyncCompilationsDeferred();
+
+// Records the execution of an XLA cluster whose inputs were padded to a shape
+// bucket, with `real_elements` input elements and `padding_elements` elements
+// of padding. Together with the number of compilations, this measures the
+// trade-off between padding waste and recompilation.
+void RecordXlaShapeBucketingElements(int64_t real_elements,
+                                     int64_t padding_elements);
+
 // Updates the metrics stored about time BFC allocator spents during delay.
 void UpdateBfcAllocatorDelayTime(const uint64 delay_usecs);
 
+// Updates the free bytes and the size of the largest free chunk of the BFC
+// allocator `allocator_name`. Together they measure the fragmentation of its
+// free memory.
+void UpdateBfcAllocatorFreeBytes(const string& allocator_name,
+                                 int64_t free_bytes,
+                                 int64_t largest_free_chunk_bytes);
+
+// Records a copy of `num_bytes` bytes between host and GPU memory in
+// `direction` ("host_to_device" or "device_to_host"), which completed
+// `duration_usecs` after it was issued. The duration includes any time the copy
+// spent queued behind earlier work on its stream.
+void RecordGpuCopy(const string& direction, int64_t num_bytes,
+                   uint64 duration_usecs);
+
+// Updates the metrics of the Grappler optimizer `pass_name` in the last run of
+// the MetaOptimizer: its wall time and the number of nodes it changed, summed
+// over all optimized graphs and functions, and the largest serialized size of
+// a graph it produced.
+void UpdateGrapplerPassMetrics(const string& pass_name,
+                               int64_t wall_time_usecs,
+                               int64_t num_changed_nodes,
+                               int64_t peak_graph_bytes);
+
 // Increments (by 1) a simple integer counter that is exposed for testing.
 void IncrementTestCounter(const string& name, const string& label);
 
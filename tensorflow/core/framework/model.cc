@@ -63,6 +63,66 @@ void RecordAutotuneRamUsage(int64 ram_budget, double max_buffered_bytes) {
       max_buffered_bytes / static_cast<double>(ram_budget));
 }
 
+// Tracks the buffer memory allocated by the `MEMORY_BUDGETED` optimization of
+// all models in the process, so that input pipelines running concurrently share
+// a single RAM budget instead of each of them assuming the budget for itself.
+class BufferAllocations {
+ public:
+  static BufferAllocations* Get() {
+    static BufferAllocations* allocations = new BufferAllocations();
+    return allocations;
+  }
+
+  // Returns the number of bytes allocated to models other than `model`.
+  double AllocatedBytesExcluding(const Model* model) {
+    tf_shared_lock l(mu_);
+    double result = 0;
+    for (const auto& model_allocation : allocations_) {
+      if (model_allocation.first == model) {
+        continue;
+      }
+      for (const auto& pair : model_allocation.second) {
+        result += pair.second;
+      }
+    }
+    return result;
+  }
+
+  // Sets the number of bytes allocated to the tunable parameters of `model`,
+  // keyed by parameter name.
+  void Set(const Model* model, absl::flat_hash_map<string, double> allocation) {
+    mutex_lock l(mu_);
+    allocations_[model] = std::move(allocation);
+    RecordMetrics();
+  }
+
+  void Remove(const Model* model) {
+    mutex_lock l(mu_);
+    if (allocations_.erase(model)) {
+      RecordMetrics();
+    }
+  }
+
+ private:
+  void RecordMetrics() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    absl::flat_hash_map<string, double> totals = {{kBufferSize, 0},
+                                                  {kParallelism, 0}};
+    for (const auto& model_allocation : allocations_) {
+      for (const auto& pair : model_allocation.second) {
+        totals[pair.first] += pair.second;
+      }
+    }
+    for (const auto& pair : totals) {
+      metrics::RecordTFDataAutotuneBufferAllocation(
+          pair.first, static_cast<int64_t>(pair.second));
+    }
+  }
+
+  mutex mu_;
+  absl::flat_hash_map<const Model*, absl::flat_hash_map<string, double>>
+      allocations_ TF_GUARDED_BY(mu_);
+};
+
 // Helper function for node traversal that doesn't skip any nodes.
 inline bool IsAnyNode(const std::shared_ptr<Node> node) { return true; }
 
@@ -1861,6 +1921,67 @@ Status Node::FromProto(ModelProto::Node node_proto,
   return FromProtoHelper(node_proto, *node);
 }
 
+FlightRecorder::FlightRecorder(int64_t capacity, int64_t period_nsec)
+    : capacity_(capacity),
+      period_nsec_(period_nsec),
+      wait_time_nsec_(0),
+      next_snapshot_nsec_(0) {
+  DCHECK_GT(capacity_, 0);
+}
+
+bool FlightRecorder::RecordWaitTime(int64_t now_nsec, int64_t wait_time_nsec) {
+  wait_time_nsec_.fetch_add(wait_time_nsec, std::memory_order_relaxed);
+  int64_t next_snapshot_nsec =
+      next_snapshot_nsec_.load(std::memory_order_relaxed);
+  if (now_nsec < next_snapshot_nsec) {
+    return false;
+  }
+  // Only one of the concurrent callers observing that a snapshot is due wins.
+  return next_snapshot_nsec_.compare_exchange_strong(
+      next_snapshot_nsec, now_nsec + period_nsec_, std::memory_order_relaxed);
+}
+
+void FlightRecorder::RecordSnapshot(int64_t now_nsec,
+                                    const Node::NodeVector& nodes) {
+  Snapshot snapshot;
+  snapshot.time_nsec = now_nsec;
+  snapshot.wait_time_nsec = wait_time_nsec_.load(std::memory_order_relaxed);
+  snapshot.nodes.reserve(nodes.size());
+  for (const auto& node : nodes) {
+    NodeSnapshot node_snapshot;
+    node_snapshot.id = node->id();
+    node_snapshot.name = node->name();
+    node_snapshot.num_elements = node->num_elements();
+    for (const auto& input : node->inputs()) {
+      node_snapshot.input_num_elements += input->num_elements();
+    }
+    node_snapshot.buffered_elements = node->buffered_elements();
+    node_snapshot.buffered_bytes = node->buffered_bytes();
+    auto buffer_size = node->ParameterValue(kBufferSize);
+    if (buffer_size.ok() && buffer_size.ValueOrDie() > 0) {
+      node_snapshot.buffer_size = buffer_size.ValueOrDie();
+    }
+    snapshot.nodes.push_back(std::move(node_snapshot));
+  }
+  mutex_lock l(mu_);
+  if (snapshots_.size() < capacity_) {
+    snapshots_.push_back(std::move(snapshot));
+    return;
+  }
+  snapshots_[next_] = std::move(snapshot);
+  next_ = (next_ + 1) % capacity_;
+}
+
+std::vector<FlightRecorder::Snapshot> FlightRecorder::GetSnapshots() const {
+  mutex_lock l(mu_);
+  std::vector<Snapshot> snapshots;
+  snapshots.reserve(snapshots_.size());
+  for (int64_t i = 0; i < snapshots_.size(); ++i) {
+    snapshots.push_back(snapshots_[(next_ + i) % snapshots_.size()]);
+  }
+  return snapshots;
+}
+
 Model::Model() : optimization_period_ms_(kOptimizationPeriodMinMs) {
   model_gauge_cell_ = metrics::GetTFDataModelGauge(
       strings::StrCat(reinterpret_cast<uint64>(this)));
@@ -1872,6 +1993,7 @@ Model::~Model() {
   // prevent race condition where the gauge callback is called after the Model
   // is destroyed.
   model_gauge_cell_->Set([]() { return std::string(); });
+  BufferAllocations::Get()->Remove(this);
 }
 
 void Model::AddNode(Node::Factory factory, const string& name,
@@ -1943,6 +2065,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
       OptimizeGradientDescent(snapshot, optimization_params,
                               cancellation_manager);
       break;
+    case AutotuneAlgorithm::MEMORY_BUDGETED:
+      OptimizeMemoryBudgeted(snapshot, optimization_params,
+                             cancellation_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -2217,6 +2343,114 @@ void Model::OptimizeMaxParallelism(
                           should_stop);
 }
 
+void Model::OptimizeMemoryBudgeted(
+    std::shared_ptr<Node> snapshot,
+    const OptimizationParams& optimization_params,
+    CancellationManager* cancellation_manager) {
+  VLOG(2) << "Starting optimization of tunable parameters with Memory "
+             "Budgeted Hill Climb.";
+  const double processing_time = TotalProcessingTime(snapshot);
+  auto parameters = CollectTunableParameters(snapshot);
+  if (parameters.empty()) {
+    VLOG(2) << "There are no tunable parameters.";
+    BufferAllocations::Get()->Remove(this);
+    return;
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size();
+
+  // Buffer size parameter will only be incremented if the output latency
+  // improvement is greater than this constant.
+  constexpr double kBufferSizeMinDelta = 1.0L;
+  // Lower bound on the memory cost of a step, so that steps which do not
+  // increase the buffered bytes (e.g. because the element size has not been
+  // measured yet) are preferred without dividing by zero.
+  constexpr double kMinStepBytes = 1.0L;
+
+  const double ram_budget = std::max(
+      0.0, optimization_params.ram_budget() -
+               BufferAllocations::Get()->AllocatedBytesExcluding(this));
+
+  // Initialize the parameter values to minimal before tuning.
+  for (auto& pair : parameters) {
+    pair.second->value = pair.second->min;
+  }
+  double buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+  while (!cancellation_manager->IsCancelled()) {
+    const double output_time =
+        OutputTime(snapshot, optimization_params.model_input_time(),
+                   /*gradients=*/nullptr);
+    if (output_time < processing_time / optimization_params.cpu_budget()) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("output_time");
+      break;
+    }
+
+    bool all_max = true;
+    bool ram_budget_exceeded = false;
+    double best_score = 0.0L;
+    double best_buffered_bytes = buffered_bytes;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      if (pair.second->value >= pair.second->max) {
+        continue;
+      }
+      all_max = false;
+      pair.second->value++;
+      const double new_output_time =
+          OutputTime(snapshot, optimization_params.model_input_time(),
+                     /*gradients=*/nullptr);
+      const double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      pair.second->value--;
+      if (new_buffered_bytes > ram_budget) {
+        ram_budget_exceeded = true;
+        continue;
+      }
+      const double delta = output_time - new_output_time;
+      if (delta <= 0 ||
+          (delta <= kBufferSizeMinDelta && pair.second->name == kBufferSize)) {
+        continue;
+      }
+      const double score =
+          delta /
+          std::max(new_buffered_bytes - buffered_bytes, kMinStepBytes);
+      if (score > best_score) {
+        best_score = score;
+        best_buffered_bytes = new_buffered_bytes;
+        best_parameter = pair.second.get();
+      }
+    }
+    if (all_max) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("all_max");
+      break;
+    }
+    if (!best_parameter) {
+      if (ram_budget_exceeded) {
+        metrics::RecordTFDataAutotuneStoppingCriteria("max_buffered_bytes");
+      }
+      VLOG(2) << "Failed to find a tunable parameter that would further "
+                 "decrease the output time within the RAM budget. The "
+                 "optimization attempt will stop now.";
+      break;
+    }
+    best_parameter->value++;
+    buffered_bytes = best_buffered_bytes;
+  }
+
+  // Attribute the buffered bytes to the parameters. The maximum buffered bytes
+  // of a node are proportional to the value of the parameter bounding its
+  // buffer, so the contribution of a parameter is the decrease of the total
+  // when the parameter is set to zero.
+  absl::flat_hash_map<string, double> allocation;
+  for (auto& pair : parameters) {
+    const double value = pair.second->value;
+    pair.second->value = 0;
+    allocation[pair.second->name] +=
+        buffered_bytes - TotalMaximumBufferedBytes(snapshot);
+    pair.second->value = value;
+  }
+  BufferAllocations::Get()->Set(this, std::move(allocation));
+  UpdateStateValues(&parameters);
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          Model::ParameterGradients* gradients) {
   // To store the input time for each node.
@@ -2327,6 +2561,14 @@ Node::NodeVector Model::CollectNodes(
   return nodes;
 }
 
+void Model::RecordGetNext(int64_t wait_time_nsec) {
+  const int64_t now_nsec = EnvTime::NowNanos();
+  if (flight_recorder_.RecordWaitTime(now_nsec, wait_time_nsec)) {
+    flight_recorder_.RecordSnapshot(
+        now_nsec, CollectNodes(output(), TraversalOrder::BFS, IsAnyNode));
+  }
+}
+
 ModelTiming::ModelTiming(std::shared_ptr<Model> model) : model_(model) {
   ComputeTiming();
 }
@@ -2474,6 +2716,114 @@ std::vector<std::shared_ptr<Node>> ModelTiming::GetStageNodes(
   return model_->CollectNodes(root, TraversalOrder::BFS, IsSyncNode);
 }
 
+PipelineDiagnostics GetPipelineDiagnostics(std::shared_ptr<Model> model) {
+  PipelineDiagnostics diagnostics;
+  const auto snapshots = model->flight_recorder().GetSnapshots();
+  if (snapshots.size() < 2) {
+    return diagnostics;
+  }
+  const auto& first = snapshots.front();
+  const auto& last = snapshots.back();
+  const int64_t window_nsec = last.time_nsec - first.time_nsec;
+  if (window_nsec <= 0) {
+    return diagnostics;
+  }
+  const double window_sec =
+      static_cast<double>(window_nsec) / EnvTime::kSecondsToNanos;
+  diagnostics.set_window_nsec(window_nsec);
+  diagnostics.set_wait_time_fraction(
+      static_cast<double>(last.wait_time_nsec - first.wait_time_nsec) /
+      window_nsec);
+
+  absl::flat_hash_map<int64_t, const FlightRecorder::NodeSnapshot*>
+      first_nodes;
+  for (const auto& node : first.nodes) {
+    first_nodes[node.id] = &node;
+  }
+  // Sums of the buffer statistics over all snapshots of a node.
+  struct BufferStats {
+    double buffered_elements = 0.0;
+    double buffered_bytes = 0.0;
+    double buffer_occupancy = 0.0;
+    int64_t num_snapshots = 0;
+  };
+  absl::flat_hash_map<int64_t, BufferStats> buffer_stats;
+  for (const auto& snapshot : snapshots) {
+    for (const auto& node : snapshot.nodes) {
+      auto& stats = buffer_stats[node.id];
+      stats.buffered_elements += node.buffered_elements;
+      stats.buffered_bytes += node.buffered_bytes;
+      if (node.buffer_size > 0.0) {
+        stats.buffer_occupancy += node.buffered_elements / node.buffer_size;
+      }
+      ++stats.num_snapshots;
+    }
+  }
+
+  ModelTiming model_timing(model);
+  absl::flat_hash_map<int64_t, const ModelTiming::NodeTiming*> timings;
+  for (const auto& node :
+       model->CollectNodes(model->output(), TraversalOrder::BFS, IsAnyNode)) {
+    timings[node->id()] = model_timing.GetTiming(node.get());
+  }
+
+  for (const auto& node : last.nodes) {
+    auto* node_diagnostics = diagnostics.add_nodes();
+    node_diagnostics->set_id(node.id);
+    node_diagnostics->set_name(node.name);
+    auto it = first_nodes.find(node.id);
+    if (it != first_nodes.end()) {
+      node_diagnostics->set_input_rate(
+          (node.input_num_elements - it->second->input_num_elements) /
+          window_sec);
+      node_diagnostics->set_output_rate(
+          (node.num_elements - it->second->num_elements) / window_sec);
+    }
+    const auto& stats = buffer_stats[node.id];
+    node_diagnostics->set_buffered_elements(stats.buffered_elements /
+                                            stats.num_snapshots);
+    node_diagnostics->set_buffered_bytes(stats.buffered_bytes /
+                                         stats.num_snapshots);
+    node_diagnostics->set_buffer_occupancy(stats.buffer_occupancy /
+                                           stats.num_snapshots);
+    auto timing = timings.find(node.id);
+    if (timing != timings.end() && timing->second != nullptr) {
+      node_diagnostics->set_self_time_nsec(timing->second->self_time_nsec);
+      node_diagnostics->set_total_time_nsec(timing->second->total_time_nsec);
+    }
+  }
+  if (diagnostics.nodes_size() > 0) {
+    diagnostics.set_output_rate(diagnostics.nodes(0).output_rate());
+  }
+
+  std::shared_ptr<Node> slowest_stage;
+  double slowest_stage_time_nsec = 0.0;
+  for (const auto& root : model_timing.GetStageRoots()) {
+    const auto* timing = model_timing.GetTiming(root.get());
+    if (timing != nullptr &&
+        timing->total_time_nsec > slowest_stage_time_nsec) {
+      slowest_stage = root;
+      slowest_stage_time_nsec = timing->total_time_nsec;
+    }
+  }
+  if (slowest_stage == nullptr) {
+    return diagnostics;
+  }
+  std::shared_ptr<Node> bottleneck;
+  double bottleneck_self_time_nsec = -1.0;
+  for (const auto& node : model_timing.GetStageNodes(slowest_stage)) {
+    const auto* timing = model_timing.GetTiming(node.get());
+    if (timing != nullptr &&
+        timing->self_time_nsec > bottleneck_self_time_nsec) {
+      bottleneck = node;
+      bottleneck_self_time_nsec = timing->self_time_nsec;
+    }
+  }
+  diagnostics.set_bottleneck_id(bottleneck->id());
+  diagnostics.set_bottleneck_name(bottleneck->name());
+  return diagnostics;
+}
+
 }  // namespace model
 }  // namespace data
 }  // namespace tensorflow
@@ -668,6 +668,67 @@ std::shared_ptr<Node> MakeAsyncUnknownRatioNode(
 // as pass-through between inputs and output.
 std::shared_ptr<Node> MakeUnknownNode(Node::Args args);
 
+// Keeps the recent history of the nodes of a model in a fixed-size ring buffer
+// of periodic snapshots, together with the time the consumer of the output of
+// the model spent waiting for elements. Recording is cheap enough to be always
+// on: waiting time is accounted for with atomic operations and the nodes are
+// only snapshotted once per recording period.
+class FlightRecorder {
+ public:
+  // Snapshot of the state of a node.
+  struct NodeSnapshot {
+    int64_t id = 0;
+    string name;
+    // Number of elements produced by the node.
+    int64_t num_elements = 0;
+    // Number of elements produced by the inputs of the node.
+    int64_t input_num_elements = 0;
+    int64_t buffered_elements = 0;
+    int64_t buffered_bytes = 0;
+    // Value of the buffer size parameter of the node, or zero if the node does
+    // not have one.
+    double buffer_size = 0.0;
+  };
+
+  // Snapshot of the state of a model.
+  struct Snapshot {
+    int64_t time_nsec = 0;
+    // Aggregate time the consumer of the model output has spent waiting.
+    int64_t wait_time_nsec = 0;
+    std::vector<NodeSnapshot> nodes;
+  };
+
+  static constexpr int64_t kDefaultCapacity = 60;
+  static constexpr int64_t kDefaultPeriodNsec = EnvTime::kSecondsToNanos;
+
+  explicit FlightRecorder(int64_t capacity = kDefaultCapacity,
+                          int64_t period_nsec = kDefaultPeriodNsec);
+
+  // Records that the consumer waited `wait_time_nsec` for an element which
+  // became available at `now_nsec`. Returns whether a snapshot is due, in which
+  // case the caller is expected to invoke `RecordSnapshot`.
+  bool RecordWaitTime(int64_t now_nsec, int64_t wait_time_nsec);
+
+  // Records a snapshot of `nodes` taken at `now_nsec`, evicting the oldest
+  // snapshot if the buffer is full.
+  void RecordSnapshot(int64_t now_nsec, const Node::NodeVector& nodes)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the recorded snapshots, ordered from oldest to newest.
+  std::vector<Snapshot> GetSnapshots() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  const int64_t capacity_;
+  const int64_t period_nsec_;
+  std::atomic<int64_t> wait_time_nsec_;
+  std::atomic<int64_t> next_snapshot_nsec_;
+  mutable mutex mu_;
+  // Ring buffer of snapshots, the oldest of which is at `next_` once the buffer
+  // is full.
+  std::vector<Snapshot> snapshots_ TF_GUARDED_BY(mu_);
+  int64_t next_ TF_GUARDED_BY(mu_) = 0;
+};
+
 // Abstract representation of a TensorFlow input pipeline that can be used
 // for collecting runtime information and optimizing performance. It collects
 // runtime information about execution of the input pipeline that is used to
@@ -749,6 +810,14 @@ class Model {
                                 TraversalOrder order,
                                 bool collect_node(const std::shared_ptr<Node>));
 
+  // Records that the consumer of the model output waited `wait_time_nsec` for
+  // an element, periodically recording a snapshot of the model in its flight
+  // recorder.
+  void RecordGetNext(int64_t wait_time_nsec) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the flight recorder keeping the recent history of the model.
+  const FlightRecorder& flight_recorder() const { return flight_recorder_; }
+
  private:
   // Determines whether optimization should stop given total processing time,
   // estimated output time, and estimated number of buffers bytes.
@@ -801,6 +870,19 @@ class Model {
                               const OptimizationParams& optimization_params,
                               CancellationManager* cancellation_manager);
 
+  // This optimization algorithm tunes parallelism and buffer size parameters
+  // jointly under a hard memory cap. It starts by setting all tunable
+  // parameters to the minimum value. It then repeatedly increases the parameter
+  // whose increase decreases the output time the most per byte of additional
+  // buffer memory, using the measured element sizes of each node, skipping
+  // steps that would exceed the RAM budget. The budget is shared by all models
+  // in the process that use this algorithm, and the resulting allocation is
+  // exported through the `/tensorflow/data/autotune_buffer_allocation_bytes`
+  // metric.
+  void OptimizeMemoryBudgeted(std::shared_ptr<Node> snapshot,
+                              const OptimizationParams& optimization_params,
+                              CancellationManager* cancellation_manager);
+
   // Determines if we should stop the gradient descent optimization iterations
   // based on number of increasable parameters, CPU budget, RAM budget and
   // current resource usage.
@@ -845,6 +927,8 @@ class Model {
   // Cached result of the `DebugString()` invocation used to implement rate
   // limitting of the computation.
   std::string cached_debug_string_ = "";
+
+  FlightRecorder flight_recorder_;
 };
 
 // Class to compute timing information for a model.
@@ -900,6 +984,14 @@ class ModelTiming {
   absl::flat_hash_map<const Node*, NodeTiming> timing_nodes_;
 };
 
+// Computes the diagnostics of the input pipeline represented by `model` over
+// the window kept by its flight recorder.
+//
+// Stages separated by asynchronous nodes run concurrently, so the stage with
+// the largest total time limits the throughput of the pipeline. The node of
+// that stage with the largest self time is reported as the bottleneck.
+PipelineDiagnostics GetPipelineDiagnostics(std::shared_ptr<Model> model);
+
 }  // namespace model
 }  // namespace data
 }  // namespace tensorflow
@@ -1310,7 +1310,62 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1, 2, 3));
+                         ::testing::Values(0, 1, 2, 3, 4));
+
+// Returns a model with a single asynchronous node whose `parallelism`
+// parameter bounds a buffer of 1000 byte elements.
+std::unique_ptr<model::Model> MakeMemoryBudgetedModel(
+    std::shared_ptr<Node>* node) {
+  *node = model::MakeAsyncKnownRatioNode(
+      {1, "1", nullptr}, /*ratio=*/1, /*memory_ratio=*/1,
+      {model::MakeParameter(
+          "parallelism",
+          std::make_shared<SharedState>(
+              /*value=*/model::kAutotune, std::make_shared<mutex>(),
+              std::make_shared<condition_variable>()),
+          /*min=*/1, /*max=*/10)});
+  (*node)->record_buffer_event(1000, 1);
+  (*node)->record_bytes_produced(1000);
+  (*node)->record_element();
+  (*node)->add_processing_time(1000000);
+  auto model = std::make_unique<model::Model>();
+  model->AddNode([node](model::Node::Args args) { return *node; }, "1",
+                 nullptr, node);
+  return model;
+}
+
+TEST(OptimizeMemoryBudgetedTest, SharesRamBudget) {
+  CellReader<int64_t> cell_reader(
+      "/tensorflow/data/autotune_buffer_allocation_bytes");
+  constexpr int64_t kRamBudget = 3500;
+  CancellationManager cancellation_manager;
+
+  std::shared_ptr<Node> node1, node2;
+  std::unique_ptr<model::Model> model1 = MakeMemoryBudgetedModel(&node1);
+  std::unique_ptr<model::Model> model2 = MakeMemoryBudgetedModel(&node2);
+
+  model1->Optimize(model::AutotuneAlgorithm::MEMORY_BUDGETED,
+                   /*cpu_budget=*/100, kRamBudget, /*model_input_time=*/0,
+                   &cancellation_manager);
+  // Each unit of parallelism buffers one more 1000 byte element.
+  EXPECT_EQ(node1->parameter_value("parallelism"), 3);
+  EXPECT_EQ(cell_reader.Read("parallelism"), 3000);
+
+  // The second model only gets the part of the budget not used by the first.
+  model2->Optimize(model::AutotuneAlgorithm::MEMORY_BUDGETED,
+                   /*cpu_budget=*/100, kRamBudget, /*model_input_time=*/0,
+                   &cancellation_manager);
+  EXPECT_EQ(node2->parameter_value("parallelism"), 1);
+  EXPECT_EQ(cell_reader.Read("parallelism"), 4000);
+
+  model1.reset();
+  EXPECT_EQ(cell_reader.Read("parallelism"), 1000);
+  model2->Optimize(model::AutotuneAlgorithm::MEMORY_BUDGETED,
+                   /*cpu_budget=*/100, kRamBudget, /*model_input_time=*/0,
+                   &cancellation_manager);
+  EXPECT_EQ(node2->parameter_value("parallelism"), 3);
+  EXPECT_EQ(cell_reader.Read("parallelism"), 3000);
+}
 
 TEST(RecordTimeTest, RecordTimeTest) {
   std::shared_ptr<Node> source = model::MakeSourceNode({});
@@ -1895,6 +1950,66 @@ TEST(ModelTest, ModelMetrics) {
                     HasSubstr("autotune: true")));
 }
 
+TEST(FlightRecorderTest, RingBuffer) {
+  FlightRecorder recorder(/*capacity=*/3, /*period_nsec=*/10);
+  EXPECT_TRUE(recorder.GetSnapshots().empty());
+  for (int64_t i = 0; i < 5; ++i) {
+    const int64_t now_nsec = i * 10;
+    ASSERT_TRUE(recorder.RecordWaitTime(now_nsec, /*wait_time_nsec=*/2));
+    // No more snapshots are due until the end of the period.
+    EXPECT_FALSE(recorder.RecordWaitTime(now_nsec + 5, /*wait_time_nsec=*/1));
+    recorder.RecordSnapshot(now_nsec, /*nodes=*/{});
+  }
+  // The two oldest snapshots have been evicted.
+  auto snapshots = recorder.GetSnapshots();
+  ASSERT_EQ(snapshots.size(), 3);
+  for (int64_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(snapshots[i].time_nsec, (i + 2) * 10);
+    EXPECT_EQ(snapshots[i].wait_time_nsec, (i + 3) * 3);
+  }
+}
+
+TEST(FlightRecorderTest, PipelineDiagnostics) {
+  auto model = std::make_shared<Model>();
+  auto make_node = [](Node::Args args) {
+    return MakeKnownRatioNode(std::move(args), /*ratio=*/1);
+  };
+  std::shared_ptr<Node> root, map, source;
+  model->AddNode(make_node, "Root", nullptr, &root);
+  model->AddNode(make_node, "Map", root, &map);
+  model->AddNode(make_node, "Source", map, &source);
+  auto produce_elements = [&](int64_t num_elements) {
+    for (int64_t i = 0; i < num_elements; ++i) {
+      root->add_processing_time(10);
+      root->record_element();
+      map->add_processing_time(1000);
+      map->record_element();
+      source->add_processing_time(10);
+      source->record_element();
+    }
+  };
+  // Without at least two snapshots there is no window to diagnose.
+  produce_elements(10);
+  model->RecordGetNext(/*wait_time_nsec=*/0);
+  EXPECT_EQ(GetPipelineDiagnostics(model).bottleneck_id(), 0);
+
+  produce_elements(10);
+  Env::Default()->SleepForMicroseconds(FlightRecorder::kDefaultPeriodNsec /
+                                       EnvTime::kMicrosToNanos);
+  model->RecordGetNext(/*wait_time_nsec=*/1000);
+  PipelineDiagnostics diagnostics = GetPipelineDiagnostics(model);
+  EXPECT_GE(diagnostics.window_nsec(), FlightRecorder::kDefaultPeriodNsec);
+  EXPECT_GT(diagnostics.output_rate(), 0.0);
+  EXPECT_GT(diagnostics.wait_time_fraction(), 0.0);
+  ASSERT_EQ(diagnostics.nodes_size(), 3);
+  EXPECT_EQ(diagnostics.nodes(1).name(), "Map");
+  EXPECT_DOUBLE_EQ(diagnostics.nodes(1).input_rate(),
+                   diagnostics.nodes(1).output_rate());
+  EXPECT_EQ(diagnostics.nodes(2).input_rate(), 0.0);
+  EXPECT_EQ(diagnostics.bottleneck_id(), map->id());
+  EXPECT_EQ(diagnostics.bottleneck_name(), "Map");
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
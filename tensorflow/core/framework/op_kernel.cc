@@ -340,7 +340,7 @@ OpKernelContext::OpKernelContext(Params* params)
           params, static_cast<int>(params->op_kernel->output_types().size())) {}
 
 OpKernelContext::OpKernelContext(Params* params, int num_outputs)
-    : params_(params), outputs_(num_outputs) {
+    : params_(params), outputs_(num_outputs), output_tensors_(num_outputs) {
   if (params_->track_allocations) {
     tracking_state_ = absl::make_unique<TrackingState>();
   }
@@ -358,9 +358,9 @@ OpKernelContext::OpKernelContext(Params* params, int num_outputs)
 }
 
 OpKernelContext::~OpKernelContext() {
-  for (TensorValue& value : outputs_) {
-    if (!value.is_ref()) {
-      delete value.tensor;
+  for (int i = 0; i < num_outputs(); ++i) {
+    if (!outputs_[i].is_ref() && !owns_output_storage(i)) {
+      delete outputs_[i].tensor;
     }
   }
   if (params_->track_allocations &&
@@ -719,7 +719,13 @@ Status OpKernelContext::allocate_output(StringPiece name,
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+  return allocate_tensor(get_allocator(attr), type, shape, out_tensor,
+                         allocation_attr);
+}
+
+Status OpKernelContext::allocate_tensor(
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -775,13 +781,25 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
     }
   }
   profiler::ScopedMemoryDebugAnnotation op_annotation(
-      op_kernel().name_view().data(), step_id(), "output", type,
+      op_kernel().name_view().data(), op_kernel().type_string_view().data(),
+      step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
-  auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Tensor* output_tensor = &output_tensors_[index];
+  Allocator* planned_allocator =
+      params_->planned_output_allocators != nullptr
+          ? params_->planned_output_allocators[index]
+          : nullptr;
+  Status s;
+  if (planned_allocator != nullptr && attr.value == 0 && attr.scope_id <= 0 &&
+      !track_allocations()) {
+    s = allocate_tensor(planned_allocator, type, shape, output_tensor,
+                        AllocationAttributes());
+  } else {
+    s = allocate_tensor(type, shape, output_tensor, attr);
+  }
   if (s.ok()) {
-    outputs_[index] = TensorValue(output_tensor.release());
-    *output = outputs_[index].tensor;
+    outputs_[index] = TensorValue(output_tensor);
+    *output = output_tensor;
   }
   return s;
 }
@@ -806,10 +824,18 @@ Status OpKernelContext::allocate_temp(
     allocator_attr.scope_id = -1;
   }
   profiler::ScopedMemoryDebugAnnotation op_annotation(
-      op_kernel().name_view().data(), step_id(), "temp", type,
+      op_kernel().name_view().data(), op_kernel().type_string_view().data(),
+      step_id(), "temp", type,
       [&shape]() { return shape.DebugString(); });
-  Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+  Status s;
+  if (params_->step_temp_allocator != nullptr && allocation_attr.step_local &&
+      allocator_attr.value == 0 && !track_allocations()) {
+    s = allocate_tensor(params_->step_temp_allocator, type, shape, out_temp,
+                        allocation_attr);
+  } else {
+    s = allocate_tensor(type, shape, out_temp, allocator_attr,
+                        allocation_attr);
+  }
   if (track_allocations() && s.ok() && out_temp->TotalBytes() > 0) {
     Allocator* a = get_allocator(allocator_attr);
     if (a->TracksAllocationSizes()) {
@@ -899,7 +925,8 @@ bool OpKernelContext::maybe_set_output_by_allocate_and_copy(
             << params_->forward_from_array[index] << " alloc_attr.scope_id "
             << output_alloc_attr(index).scope_id;
     profiler::ScopedMemoryDebugAnnotation op_annotation(
-        op_kernel().name_view().data(), step_id(), "output", tensor.dtype(),
+        op_kernel().name_view().data(), op_kernel().type_string_view().data(),
+        step_id(), "output", tensor.dtype(),
         [&tensor]() { return tensor.shape().DebugString(); });
     auto new_tensor = MakeUnique<Tensor>();
     Status s = allocate_tensor(tensor.dtype(), tensor.shape(), new_tensor.get(),
@@ -940,7 +967,8 @@ void OpKernelContext::set_output(int index, const Tensor& tensor) {
   if (TF_PREDICT_TRUE(!maybe_set_output_by_allocate_and_copy(index, tensor))) {
     // Input can be forwarded to output; incref on `tensor` and set output at
     // `index` to this tensor.
-    outputs_[index] = TensorValue(new Tensor(tensor));
+    output_tensors_[index] = tensor;
+    outputs_[index] = TensorValue(&output_tensors_[index]);
     maybe_track_allocations_for_set_output(*outputs_[index].tensor);
   }
 }
@@ -953,7 +981,8 @@ void OpKernelContext::set_output(int index, Tensor&& tensor) {
   CHECK_EQ(outputs_[index].tensor, nullptr);
   if (TF_PREDICT_TRUE(!maybe_set_output_by_allocate_and_copy(index, tensor))) {
     // Input can be forwarded to output; set output at `index` to this tensor.
-    outputs_[index] = TensorValue(new Tensor(std::move(tensor)));
+    output_tensors_[index] = std::move(tensor);
+    outputs_[index] = TensorValue(&output_tensors_[index]);
     maybe_track_allocations_for_set_output(*outputs_[index].tensor);
   }
 }
@@ -605,6 +605,16 @@ class OpKernelContext {
     bool track_allocations = false;
     bool log_memory = false;
 
+    // If not null, `allocate_temp()` requests with default allocator
+    // attributes and `AllocationAttributes::step_local` set are served by this
+    // allocator, which is owned by the step.
+    Allocator* step_temp_allocator = nullptr;
+
+    // If not null, the allocators for the planned outputs of this op kernel,
+    // indexed by output. `allocate_output()` requests with default allocator
+    // attributes use the output's entry if it is not null.
+    Allocator* const* planned_output_allocators = nullptr;
+
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
@@ -1179,6 +1189,11 @@ class OpKernelContext {
   void set_output_ref(int index, mutex* mu, Tensor* tensor_for_ref);
   TensorValue release_output(int index);
 
+  // Like release_output(), but a non-ref output stays owned by the context,
+  // which destroys it. The caller may move from the tensor while the context
+  // is alive. Unlike release_output(), never allocates.
+  TensorValue borrow_output(int index);
+
   bool track_allocations() const { return params_->track_allocations; }
 
   // Records temp memory allocation. Tensor object is recorded to identify the
@@ -1250,6 +1265,10 @@ class OpKernelContext {
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
                          const AllocationAttributes& allocation_attr);
 
+  Status allocate_tensor(Allocator* allocator, DataType type,
+                         const TensorShape& shape, Tensor* out_tensor,
+                         const AllocationAttributes& allocation_attr);
+
   // Helpers for `set_output()`.
 
   // Returns `true` if the tensor was copied into an allocated output.
@@ -1268,6 +1287,15 @@ class OpKernelContext {
   friend class CollectiveExecutor;  // for access to params_
   Params* params_;                  // not owned
   gtl::InlinedVector<TensorValue, 4> outputs_;
+  // Storage for the non-ref outputs, so that setting an output does not
+  // allocate a Tensor on the heap. outputs_[i] points either into
+  // output_tensors_[i], at a heap-allocated tensor owned by the context, or,
+  // for a ref output, at a tensor owned elsewhere.
+  gtl::InlinedVector<Tensor, 4> output_tensors_;
+
+  bool owns_output_storage(int index) const {
+    return outputs_[index].tensor == &output_tensors_[index];
+  }
 
   // Keep track of calls to ScopedAllocator.
   // TODO(ayushd): change to absl::flat_hash_set.
@@ -1594,10 +1622,19 @@ inline TensorValue OpKernelContext::release_output(int index) {
   DCHECK_GE(index, 0);
   DCHECK_LT(index, num_outputs());
   TensorValue value = outputs_[index];
+  if (owns_output_storage(index)) {
+    value = TensorValue(new Tensor(std::move(output_tensors_[index])));
+  }
   outputs_[index] = TensorValue();
   return value;
 }
 
+inline TensorValue OpKernelContext::borrow_output(int index) {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, num_outputs());
+  return outputs_[index];
+}
+
 inline Status OpKernelContext::forward_input_or_allocate_output(
     gtl::ArraySlice<int> candidate_input_indices, int output_index,
     const TensorShape& output_shape, Tensor** output, int* forwarded_input) {
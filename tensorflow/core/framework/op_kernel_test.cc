@@ -385,6 +385,105 @@ TEST_F(OpKernelTest, InputDtype) {
   EXPECT_EQ(dtype, DT_INT32);
 }
 
+// Counts the buffers it serves, which come from the CPU allocator.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+  int num_allocations() const { return num_allocations_; }
+
+ private:
+  int num_allocations_ = 0;
+};
+
+TEST_F(OpKernelTest, OnlyStepLocalTempsUseStepAllocator) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  DummyDevice device(env);
+  params.device = &device;
+  Status status;
+  std::unique_ptr<OpKernel> op(
+      CreateOpKernel(DEVICE_CPU, params.device, cpu_allocator(),
+                     CreateNodeDef("Test1", {DT_FLOAT, DT_INT32}),
+                     TF_GRAPH_DEF_VERSION, &status));
+  EXPECT_TRUE(status.ok());
+  params.op_kernel = op.get();
+  CountingAllocator step_allocator;
+  params.step_temp_allocator = &step_allocator;
+  auto ctx = absl::make_unique<OpKernelContext>(&params);
+
+  // A temporary may become an output, so it is only served by the step
+  // allocator if the kernel declares it step-local.
+  Tensor temp;
+  TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({8}), &temp));
+  EXPECT_EQ(step_allocator.num_allocations(), 0);
+
+  AllocationAttributes step_local;
+  step_local.step_local = true;
+  Tensor local_temp;
+  TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({8}), &local_temp,
+                                  AllocatorAttributes(), step_local));
+  EXPECT_EQ(step_allocator.num_allocations(), 1);
+
+  // Temporaries with specific allocator attributes are not.
+  AllocatorAttributes on_host;
+  on_host.set_on_host(true);
+  Tensor host_temp;
+  TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({8}), &host_temp,
+                                  on_host, step_local));
+  EXPECT_EQ(step_allocator.num_allocations(), 1);
+}
+
+TEST_F(OpKernelTest, OutputOwnership) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  DummyDevice device(env);
+  params.device = &device;
+  Status status;
+  std::unique_ptr<OpKernel> op(
+      CreateOpKernel(DEVICE_CPU, params.device, cpu_allocator(),
+                     CreateNodeDef("Test1", {DT_FLOAT, DT_INT32}),
+                     TF_GRAPH_DEF_VERSION, &status));
+  EXPECT_TRUE(status.ok());
+  params.op_kernel = op.get();
+  Tensor a(DT_FLOAT, TensorShape({}));
+  Tensor b(DT_INT32, TensorShape({}));
+  gtl::InlinedVector<TensorValue, 4> inputs{TensorValue(&a), TensorValue(&b)};
+  params.inputs = &inputs;
+
+  {
+    auto ctx = absl::make_unique<OpKernelContext>(&params);
+    Tensor* output;
+    TF_ASSERT_OK(ctx->allocate_output(0, TensorShape({2}), &output));
+    output->flat<uint8>().setConstant(7);
+    EXPECT_EQ(ctx->borrow_output(0).tensor, output);
+    EXPECT_EQ(ctx->mutable_output(0), output);
+
+    // release_output() hands the caller a tensor of its own.
+    TensorValue released = ctx->release_output(0);
+    ASSERT_NE(released.tensor, nullptr);
+    EXPECT_EQ(released.tensor->flat<uint8>()(1), 7);
+    EXPECT_EQ(ctx->mutable_output(0), nullptr);
+    ctx.reset();
+    EXPECT_EQ(released.tensor->flat<uint8>()(0), 7);
+    delete released.tensor;
+  }
+  {
+    auto ctx = absl::make_unique<OpKernelContext>(&params);
+    Tensor t(DT_UINT8, TensorShape({3}));
+    ctx->set_output(0, t);
+    // A borrowed output may be moved from; the context still destroys it.
+    Tensor moved = std::move(*ctx->borrow_output(0).tensor);
+    EXPECT_TRUE(moved.SharesBufferWith(t));
+  }
+}
+
 // A mock device that mimics the behavior of scoped allocator upon calling
 // GetAllocator with a positive scope_id.
 class ScopedAllocatorDevice : public DeviceBase {
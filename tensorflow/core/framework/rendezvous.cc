@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -47,6 +48,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  hash_ = b.hash_;
   return *this;
 }
 
@@ -109,11 +111,36 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     out->src_device = StringPiece(parts[0].data(), parts[0].size());
     out->dst_device = StringPiece(parts[2].data(), parts[2].size());
     out->edge_name = StringPiece(parts[3].data(), parts[3].size());
+    out->hash_ = Hash64(out->buf_.data(), out->buf_.size());
     return OkStatus();
   }
   return errors::InvalidArgument("Invalid  rendezvous key: ", key);
 }
 
+/* static */
+void Rendezvous::ReplaceFrameAndIter(const ParsedKey& key,
+                                     const FrameAndIter& frame_iter,
+                                     ParsedKey* out) {
+  DCHECK_NE(&key, out);
+  // The frame and iteration follow the last ';' of the key.
+  const size_t prefix_size = key.buf_.rfind(';') + 1;
+  DCHECK_GT(prefix_size, 0);
+  out->buf_.assign(key.buf_.data(), prefix_size);
+  strings::StrAppend(&out->buf_, frame_iter.frame_id, ":", frame_iter.iter_id);
+  // The prefix is unchanged, so the parts it contains keep their offsets.
+  auto rebase = [&key, out](StringPiece part) {
+    return StringPiece(out->buf_.data() + (part.data() - key.buf_.data()),
+                       part.size());
+  };
+  out->src_device = rebase(key.src_device);
+  out->src = key.src;
+  out->src_incarnation = key.src_incarnation;
+  out->dst_device = rebase(key.dst_device);
+  out->dst = key.dst;
+  out->edge_name = rebase(key.edge_name);
+  out->hash_ = Hash64(out->buf_.data(), out->buf_.size());
+}
+
 RendezvousInterface::~RendezvousInterface() {}
 
 Status RendezvousInterface::Recv(const ParsedKey& key, const Args& recv_args,
@@ -52,6 +52,9 @@ class RendezvousInterface {
     DeviceContext* device_context = nullptr;
     AllocatorAttributes alloc_attrs;
     CancellationManager* cancellation_manager = nullptr;  // not owned.
+    // Set by a sender to ask remote transports to encode the tensor with a
+    // wire codec, e.g. "bf16" (see distributed_runtime/wire_codec.h).
+    string wire_codec;
   };
 
   // Parses the key constructed by CreateKey and parse src/dst device
@@ -70,11 +73,17 @@ class RendezvousInterface {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // Hash of FullKey(), computed once by ParseKey so that rendezvous tables
+    // don't rehash the key on every Send and Recv. SendOp and RecvOp parse
+    // their keys when the kernel is created.
+    uint64 hash() const { return hash_; }
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     std::string buf_;
+    uint64 hash_ = 0;
   };
 
   // The caller is a tensor producer and it sends a message (a tensor
@@ -176,6 +185,14 @@ class Rendezvous : public RendezvousInterface, public core::RefCounted {
                                const FrameAndIter& frame_iter);
 
   static Status ParseKey(StringPiece key, ParsedKey* out);
+
+  // Sets "out" to the parsed key that "key", as returned by ParseKey, has in
+  // the frame and iteration "frame_iter". This is equivalent to CreateKey
+  // followed by ParseKey, but the device names are not parsed again, so it
+  // suits keys computed on every iteration of a loop.
+  static void ReplaceFrameAndIter(const ParsedKey& key,
+                                  const FrameAndIter& frame_iter,
+                                  ParsedKey* out);
 };
 
 // Returns a Rendezvous instance that is limited to use only by
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -55,6 +56,9 @@ TEST(RendezvousTest, Key) {
   EXPECT_EQ(parsed.src.type, "CPU");
   EXPECT_EQ(parsed.dst_device, "/job:mnist/replica:1/task:2/device:GPU:0");
   EXPECT_EQ(parsed.dst.type, "GPU");
+  EXPECT_EQ(parsed.hash(), Hash64(key));
+  Rendezvous::ParsedKey copied = parsed;
+  EXPECT_EQ(copied.hash(), parsed.hash());
 
   EXPECT_FALSE(Rendezvous::ParseKey("foo;bar;baz", &parsed).ok());
   EXPECT_FALSE(Rendezvous::ParseKey("/job:mnist/replica:1/task:2/CPU:0;"
@@ -65,6 +69,36 @@ TEST(RendezvousTest, Key) {
       Rendezvous::ParseKey(strings::StrCat(key, ";", key), &parsed).ok());
 }
 
+TEST(RendezvousTest, ReplaceFrameAndIter) {
+  Rendezvous::ParsedKey root;
+  TF_ASSERT_OK(Rendezvous::ParseKey(
+      Rendezvous::CreateKey("/job:mnist/replica:1/task:2/CPU:0", 7890,
+                            "/job:mnist/replica:1/task:2/device:GPU:0",
+                            "var0", FrameAndIter(0, 0)),
+      &root));
+  Rendezvous::ParsedKey expected;
+  TF_ASSERT_OK(Rendezvous::ParseKey(
+      Rendezvous::CreateKey("/job:mnist/replica:1/task:2/CPU:0", 7890,
+                            "/job:mnist/replica:1/task:2/device:GPU:0",
+                            "var0", FrameAndIter(12345, 67)),
+      &expected));
+
+  Rendezvous::ParsedKey in_loop;
+  Rendezvous::ReplaceFrameAndIter(root, FrameAndIter(12345, 67), &in_loop);
+  EXPECT_EQ(in_loop.FullKey(), expected.FullKey());
+  EXPECT_EQ(in_loop.hash(), expected.hash());
+  EXPECT_EQ(in_loop.src_device, expected.src_device);
+  EXPECT_EQ(in_loop.src_incarnation, expected.src_incarnation);
+  EXPECT_EQ(in_loop.src.type, "CPU");
+  EXPECT_EQ(in_loop.dst_device, expected.dst_device);
+  EXPECT_EQ(in_loop.dst.type, "GPU");
+  EXPECT_EQ(in_loop.edge_name, "var0");
+  // The parts point into the new key.
+  EXPECT_GE(in_loop.edge_name.data(), in_loop.FullKey().data());
+  EXPECT_LT(in_loop.edge_name.data(),
+            in_loop.FullKey().data() + in_loop.FullKey().size());
+}
+
 class LocalRendezvousTest : public ::testing::Test {
  public:
   LocalRendezvousTest() : threads_(Env::Default(), "test", 16) {
@@ -394,6 +428,34 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+TEST_F(LocalRendezvousTest, AbortWakesRecvsOfAllKeys) {
+  // Enough keys to have waiters in every shard of the table.
+  static const int N = 100;
+  BlockingState state;
+  state.counter = N;
+  for (int i = 0; i < N; ++i) {
+    rendez_->RecvAsync(
+        MakeKey(strings::StrCat(i)), Rendezvous::Args(),
+        [&state](const Status& status, const Rendezvous::Args& sender_args,
+                 const Rendezvous::Args& recver_args, const Tensor& val,
+                 const bool val_dead) {
+          EXPECT_TRUE(errors::IsAborted(status));
+          bool done = false;
+          {
+            mutex_lock l(state.lock);
+            state.counter--;
+            done = state.counter == 0;
+          }
+          if (done) state.done.Notify();
+        });
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  state.done.WaitForNotification();
+  Rendezvous::Args args;
+  EXPECT_TRUE(
+      errors::IsAborted(rendez_->Send(MakeKey("0"), args, V("0"), false)));
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -49,9 +49,11 @@ std::string DtypeAndShapesToString(
 // Must be declared here for pre-C++17 compatibility.
 /* static */ constexpr const char* ResourceHandle::ANONYMOUS_NAME;
 
-ResourceHandle::ResourceHandle() {}
+ResourceHandle::ResourceHandle()
+    : container_hash_(Hash64(container_)), name_hash_(Hash64(name_)) {}
 
-ResourceHandle::ResourceHandle(const ResourceHandleProto& proto) {
+ResourceHandle::ResourceHandle(const ResourceHandleProto& proto)
+    : ResourceHandle() {
   TF_CHECK_OK(FromProto(proto));
 }
 
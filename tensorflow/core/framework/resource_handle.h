@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/type_index.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/platform/casts.h"
+#include "tensorflow/core/platform/hash.h"
 #include "tensorflow/core/platform/intrusive_ptr.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/tensor_coding.h"
@@ -58,11 +59,22 @@ class ResourceHandle {
 
   // Container in which this resource is placed.
   const std::string& container() const { return container_; }
-  void set_container(const std::string& container) { container_ = container; }
+  void set_container(const std::string& container) {
+    container_ = container;
+    container_hash_ = Hash64(container_);
+  }
 
   // Unique name of this resource.
   const std::string& name() const { return name_; }
-  void set_name(const std::string& name) { name_ = name; }
+  void set_name(const std::string& name) {
+    name_ = name;
+    name_hash_ = Hash64(name_);
+  }
+
+  // Hash64 of container() and of name(), cached so that ResourceMgr can find
+  // the resource without hashing either string again.
+  uint64 container_hash() const { return container_hash_; }
+  uint64 name_hash() const { return name_hash_; }
 
   // Hash code for the type of the resource. Is only valid in the same device
   // and in the same execution.
@@ -177,6 +189,8 @@ class ResourceHandle {
   std::string device_;
   std::string container_;
   std::string name_;
+  uint64 container_hash_;
+  uint64 name_hash_;
   uint64 hash_code_ = 0;
   std::string maybe_type_name_;
   std::vector<DtypeAndPartialTensorShape> dtypes_and_shapes_;
@@ -77,6 +77,7 @@ Status ValidateDevice(OpKernelContext* ctx, const ResourceHandle& p) {
 
 Status ResourceMgr::InsertDebugTypeName(uint64 hash_code,
                                         const string& type_name) {
+  mutex_lock l(debug_type_names_mu_);
   auto iter = debug_type_names_.emplace(hash_code, type_name);
   if (iter.first->second != type_name) {
     return errors::AlreadyExists("Duplicate hash code found for type ",
@@ -86,6 +87,8 @@ Status ResourceMgr::InsertDebugTypeName(uint64 hash_code,
 }
 
 const char* ResourceMgr::DebugTypeName(uint64 hash_code) const {
+  // The map's nodes are never erased, so the name outlives the lock.
+  mutex_lock l(debug_type_names_mu_);
   auto type_name_iter = debug_type_names_.find(hash_code);
   if (type_name_iter == debug_type_names_.end()) {
     return "<unknown>";
@@ -138,53 +141,48 @@ ResourceMgr::~ResourceMgr() { Clear(); }
 void ResourceMgr::Clear() {
   // We do the deallocation outside of the lock to avoid a potential deadlock
   // in case any of the destructors access the resource manager.
-  absl::flat_hash_map<string, Container*> tmp_containers;
-  {
-    mutex_lock l(mu_);
-    tmp_containers = std::move(containers_);
+  std::vector<ContainerMap> tmp_containers;
+  tmp_containers.reserve(kNumShards);
+  for (Shard& shard : shards_) {
+    mutex_lock l(shard.mu);
+    tmp_containers.push_back(std::move(shard.containers));
+    shard.containers.clear();
   }
-  for (const auto& p : tmp_containers) {
-    delete p.second;
+  for (const ContainerMap& containers : tmp_containers) {
+    for (const auto& p : containers) {
+      delete p.second;
+    }
   }
   tmp_containers.clear();
 }
 
 string ResourceMgr::DebugString() const {
-  mutex_lock l(mu_);
-  struct Line {
-    const string* container;
-    const string type;
-    const string* resource;
-    const string detail;
-  };
-  std::vector<Line> lines;
-  for (const auto& p : containers_) {
-    const string& container = p.first;
-    for (const auto& q : *p.second) {
-      const Key& key = q.first;
-      const char* type = DebugTypeName(key.first);
-      const core::RefCountPtr<ResourceBase> resource = q.second.GetResource();
-      Line l{&container, port::Demangle(type), q.second.name.get(),
-             resource ? resource->DebugString() : "<nullptr>"};
-      lines.push_back(l);
-    }
-  }
   std::vector<string> text;
-  text.reserve(lines.size());
-  for (const Line& line : lines) {
-    text.push_back(strings::Printf(
-        "%-20s | %-40s | %-40s | %-s", line.container->c_str(),
-        line.type.c_str(), line.resource->c_str(), line.detail.c_str()));
+  for (const Shard& shard : shards_) {
+    tf_shared_lock l(shard.mu);
+    for (const auto& p : shard.containers) {
+      const string& container = p.first;
+      for (const auto& q : *p.second) {
+        const Key& key = q.first;
+        const string type = port::Demangle(DebugTypeName(key.type_hash_code));
+        const core::RefCountPtr<ResourceBase> resource =
+            q.second.GetResource();
+        const string detail = resource ? resource->DebugString() : "<nullptr>";
+        text.push_back(strings::Printf(
+            "%-20s | %-40s | %-40s | %-s", container.c_str(), type.c_str(),
+            q.second.name->c_str(), detail.c_str()));
+      }
+    }
   }
   std::sort(text.begin(), text.end());
   return absl::StrJoin(text, "\n");
 }
 
-Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
-                             const string& name, ResourceBase* resource,
-                             bool owns_resource) {
-  Container* container = [&]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-    Container** ptr = &containers_[container_name];
+Status ResourceMgr::DoCreate(Shard& shard, const string& container_name,
+                             TypeIndex type, const Key& key,
+                             ResourceBase* resource, bool owns_resource) {
+  Container* container = [&]() TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu) {
+    Container** ptr = &shard.containers[container_name];
     if (*ptr == nullptr) {
       *ptr = new Container;
     }
@@ -193,16 +191,17 @@ Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
 
   // NOTE: Separating out the construction of the map key and value so that the
   // key can contain a StringPiece that borrows from the string in the value.
-  ResourceAndName resource_and_name(name);
+  ResourceAndName resource_and_name(std::string(key.name));
 
-  StringPiece borrowed_name(*resource_and_name.name);
+  const Key borrowed_key(key.type_hash_code, key.name_hash,
+                         *resource_and_name.name);
 
   if (owns_resource) {
     resource_and_name.resource = core::RefCountPtr<ResourceBase>(resource);
   } else {
-    auto cleanup_fn = [this, container, type, borrowed_name]() {
-      mutex_lock l(mu_);
-      auto iter = container->find({type.hash_code(), borrowed_name});
+    auto cleanup_fn = [&shard, container, borrowed_key]() {
+      mutex_lock l(shard.mu);
+      auto iter = container->find(borrowed_key);
       if (iter != container->end()) {
         container->erase(iter);
       }
@@ -211,7 +210,7 @@ Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
         core::WeakPtr<ResourceBase>(resource, cleanup_fn);
   }
 
-  Container::value_type key_and_value(Key(type.hash_code(), borrowed_name),
+  Container::value_type key_and_value(borrowed_key,
                                       std::move(resource_and_name));
 
   auto st = container->insert(std::move(key_and_value));
@@ -219,60 +218,58 @@ Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
     TF_RETURN_IF_ERROR(InsertDebugTypeName(type.hash_code(), type.name()));
     return OkStatus();
   }
-  return errors::AlreadyExists("Resource ", container_name, "/", name, "/",
+  return errors::AlreadyExists("Resource ", container_name, "/", key.name, "/",
                                type.name());
 }
 
 Status ResourceMgr::Lookup(const ResourceHandle& handle,
                            ResourceBase** resource) const {
-  tf_shared_lock l(mu_);
-  return DoLookup(handle.container(), handle.hash_code(),
-                  /*type_name=*/"ResourceBase", handle.name(), resource);
-}
-
-Status ResourceMgr::DoLookup(const string& container, TypeIndex type,
-                             const string& name,
-                             ResourceBase** resource) const {
-  return DoLookup(container, type.hash_code(), type.name(), name, resource);
+  const ContainerName container{handle.container(), handle.container_hash()};
+  const Key key(handle.hash_code(), handle.name_hash(), handle.name());
+  const Shard& shard = ShardFor(container, key);
+  tf_shared_lock l(shard.mu);
+  return DoLookup(shard, container, key, /*type_name=*/"ResourceBase",
+                  resource);
 }
 
-Status ResourceMgr::DoLookup(const string& container, uint64 type_hash_code,
-                             const string& type_name,
-                             const string& resource_name,
+Status ResourceMgr::DoLookup(const Shard& shard,
+                             const ContainerName& container, const Key& key,
+                             StringPiece type_name,
                              ResourceBase** resource) const {
-  const Container* b = gtl::FindPtrOrNull(containers_, container);
-  if (b == nullptr) {
-    return errors::NotFound("Container ", container,
+  auto container_iter = shard.containers.find(container);
+  if (container_iter == shard.containers.end()) {
+    return errors::NotFound("Container ", container.name,
                             " does not exist. (Could not find resource: ",
-                            container, "/", resource_name, ")");
+                            container.name, "/", key.name, ")");
   }
-  auto iter = b->find({type_hash_code, resource_name});
+  const Container* b = container_iter->second;
+  auto iter = b->find(key);
   if (iter == b->end()) {
-    return errors::NotFound("Resource ", container, "/", resource_name, "/",
+    return errors::NotFound("Resource ", container.name, "/", key.name, "/",
                             type_name, " does not exist.");
   }
   ResourceBase* ptr = iter->second.GetResource().release();
   if (ptr == nullptr) {
-    return errors::NotFound("Resource ", container, "/", resource_name, "/",
+    return errors::NotFound("Resource ", container.name, "/", key.name, "/",
                             type_name, " has been destroyed.");
   }
   *resource = ptr;
   return OkStatus();
 }
 
-Status ResourceMgr::PopResourceAndName(const string& container,
-                                       uint64 type_hash_code,
-                                       const string& resource_name,
-                                       const string& type_name,
+Status ResourceMgr::PopResourceAndName(const ContainerName& container,
+                                       const Key& key, const string& type_name,
                                        ResourceAndName& resource_and_name) {
-  mutex_lock l(mu_);
-  Container* b = gtl::FindPtrOrNull(containers_, container);
-  if (b == nullptr) {
-    return errors::NotFound("Container ", container, " does not exist.");
+  Shard& shard = ShardFor(container, key);
+  mutex_lock l(shard.mu);
+  auto container_iter = shard.containers.find(container);
+  if (container_iter == shard.containers.end()) {
+    return errors::NotFound("Container ", container.name, " does not exist.");
   }
-  auto iter = b->find({type_hash_code, resource_name});
+  Container* b = container_iter->second;
+  auto iter = b->find(key);
   if (iter == b->end()) {
-    return errors::NotFound("Resource ", container, "/", resource_name, "/",
+    return errors::NotFound("Resource ", container.name, "/", key.name, "/",
                             type_name, " does not exist.");
   }
   std::swap(resource_and_name, iter->second);
@@ -280,17 +277,16 @@ Status ResourceMgr::PopResourceAndName(const string& container,
   return OkStatus();
 }
 
-Status ResourceMgr::DoDelete(const string& container, uint64 type_hash_code,
-                             const string& resource_name,
+Status ResourceMgr::DoDelete(const ContainerName& container, const Key& key,
                              const string& type_name) {
   ResourceAndName resource_and_name;
-  TF_RETURN_IF_ERROR(PopResourceAndName(
-      container, type_hash_code, resource_name, type_name, resource_and_name));
+  TF_RETURN_IF_ERROR(
+      PopResourceAndName(container, key, type_name, resource_and_name));
 
   if (absl::holds_alternative<core::WeakPtr<ResourceBase>>(
           resource_and_name.resource)) {
     return errors::Internal(
-        "Cannot delete an unowned Resource ", container, "/", resource_name,
+        "Cannot delete an unowned Resource ", container.name, "/", key.name,
         "/", type_name, " from ResourceMgr. ",
         "This indicates ref-counting ResourceHandle is exposed to weak "
         "ResourceHandle code paths.");
@@ -298,37 +294,35 @@ Status ResourceMgr::DoDelete(const string& container, uint64 type_hash_code,
   return OkStatus();
 }
 
-Status ResourceMgr::DoDelete(const string& container, TypeIndex type,
-                             const string& resource_name) {
-  return DoDelete(container, type.hash_code(), resource_name, type.name());
-}
-
 Status ResourceMgr::Delete(const ResourceHandle& handle) {
-  return DoDelete(handle.container(), handle.hash_code(), handle.name(),
+  return DoDelete({handle.container(), handle.container_hash()},
+                  Key(handle.hash_code(), handle.name_hash(), handle.name()),
                   "<unknown>");
 }
 
 Status ResourceMgr::Cleanup(const string& container) {
-  {
-    tf_shared_lock l(mu_);
-    if (!gtl::FindOrNull(containers_, container)) {
-      // Nothing to cleanup.
-      return OkStatus();
+  const ContainerName container_name = MakeContainerName(container);
+  std::vector<Container*> removed;
+  for (Shard& shard : shards_) {
+    {
+      tf_shared_lock l(shard.mu);
+      if (!shard.containers.contains(container_name)) {
+        // Nothing to cleanup in this shard.
+        continue;
+      }
     }
-  }
-  Container* b = nullptr;
-  {
-    mutex_lock l(mu_);
-    auto iter = containers_.find(container);
-    if (iter == containers_.end()) {
+    mutex_lock l(shard.mu);
+    auto iter = shard.containers.find(container_name);
+    if (iter == shard.containers.end()) {
       // Nothing to cleanup, it's OK (concurrent cleanup).
-      return OkStatus();
+      continue;
     }
-    b = iter->second;
-    containers_.erase(iter);
+    removed.push_back(iter->second);
+    shard.containers.erase(iter);
+  }
+  for (Container* b : removed) {
+    delete b;
   }
-  CHECK(b != nullptr);
-  delete b;
   return OkStatus();
 }
 
@@ -194,9 +194,21 @@ class ResourceMgr {
   Status Lookup(const ResourceHandle& handle,
                 ResourceBase** resource) const TF_MUST_USE_RESULT;
 
-  // Similar to Lookup, but looks up multiple resources at once, with only a
-  // single lock acquisition.  If containers_and_names[i] is uninitialized
-  // then this function does not modify resources[i].
+  // If the resource manager has a resource of type T in the container and with
+  // the name of "handle", returns it in "*resource" and the caller takes the
+  // ownership of one ref on "*resource". Equivalent to
+  // Lookup<T>(handle.container(), handle.name(), resource), but reuses the
+  // hashes cached in "handle".
+  //
+  // REQUIRES: std::is_base_of<ResourceBase, T>
+  // REQUIRES: resource != nullptr
+  template <typename T, bool use_dynamic_cast = false>
+  Status Lookup(const ResourceHandle& handle,
+                T** resource) const TF_MUST_USE_RESULT;
+
+  // Similar to Lookup, but looks up multiple resources at once.  If
+  // containers_and_names[i] is uninitialized then this function does not
+  // modify resources[i].
   template <typename T, bool use_dynamic_cast = false>
   Status LookupMany(absl::Span<std::pair<const string*, const string*> const>
                         containers_and_names,
@@ -238,15 +250,30 @@ class ResourceMgr {
   std::string DebugString() const;
 
  private:
-  typedef std::pair<uint64, StringPiece> Key;
+  // A resource is keyed by the hash code of its type and by its name. The key
+  // carries the Hash64 of the name, which ResourceHandle caches, so looking a
+  // resource up through a handle hashes nothing and compares the name only
+  // once the hashes match.
+  struct Key {
+    Key(uint64 type_hash_code, uint64 name_hash, StringPiece name)
+        : type_hash_code(type_hash_code), name_hash(name_hash), name(name) {}
+
+    uint64 type_hash_code;
+    uint64 name_hash;
+    StringPiece name;
+  };
+  static Key MakeKey(uint64 type_hash_code, StringPiece name) {
+    return Key(type_hash_code, Hash64(name.data(), name.size()), name);
+  }
   struct KeyHash {
     std::size_t operator()(const Key& k) const {
-      return Hash64(k.second.data(), k.second.size(), k.first);
+      return Hash64Combine(k.name_hash, k.type_hash_code);
     }
   };
   struct KeyEqual {
     bool operator()(const Key& x, const Key& y) const {
-      return (x.second == y.second) && (x.first == y.first);
+      return (x.name_hash == y.name_hash) &&
+             (x.type_hash_code == y.type_hash_code) && (x.name == y.name);
     }
   };
   struct ResourceAndName {
@@ -271,56 +298,92 @@ class ResourceMgr {
   typedef absl::flat_hash_map<Key, ResourceAndName, KeyHash, KeyEqual>
       Container;
 
+  // A container name with its Hash64. Containers are found either by name
+  // alone or, through a ResourceHandle, by name and cached hash.
+  struct ContainerName {
+    StringPiece name;
+    uint64 hash;
+  };
+  static ContainerName MakeContainerName(StringPiece name) {
+    return {name, Hash64(name.data(), name.size())};
+  }
+  struct ContainerNameHash {
+    using is_transparent = void;
+    std::size_t operator()(StringPiece name) const {
+      return Hash64(name.data(), name.size());
+    }
+    std::size_t operator()(const ContainerName& name) const {
+      return name.hash;
+    }
+  };
+  struct ContainerNameEqual {
+    using is_transparent = void;
+    bool operator()(StringPiece x, StringPiece y) const { return x == y; }
+    bool operator()(StringPiece x, const ContainerName& y) const {
+      return x == y.name;
+    }
+    bool operator()(const ContainerName& x, StringPiece y) const {
+      return x.name == y;
+    }
+  };
+  typedef absl::flat_hash_map<string, Container*, ContainerNameHash,
+                              ContainerNameEqual>
+      ContainerMap;
+
+  // Resources are spread over shards by the hash of their container and key.
+  // Each shard holds its own part of every container under its own lock, so
+  // that lookups and creations of different resources don't serialize on one
+  // mutex. Operations on whole containers visit every shard in turn.
+  struct Shard {
+    mutable profiled_mutex mu{"ResourceMgr"};
+    ContainerMap containers TF_GUARDED_BY(mu);
+  };
+  static constexpr int kNumShards = 16;
+
+  Shard& ShardFor(const ContainerName& container, const Key& key) const {
+    return shards_[Hash64Combine(container.hash, KeyHash()(key)) % kNumShards];
+  }
+
   const std::string default_container_;
-  mutable mutex mu_;
-  absl::flat_hash_map<string, Container*> containers_ TF_GUARDED_BY(mu_);
+  mutable Shard shards_[kNumShards];
 
   template <typename T, bool use_dynamic_cast = false>
-  Status LookupInternal(const std::string& container, const std::string& name,
-                        T** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-  Status LookupInternal(const std::string& container, uint64 type_hash_code,
-                        const std::string& name, ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-
-  Status DoCreate(const std::string& container, TypeIndex type,
-                  const std::string& name, ResourceBase* resource,
-                  bool owns_resource)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-
-  Status DoLookup(const std::string& container, TypeIndex type,
-                  const std::string& name, ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-  Status DoLookup(const std::string& container, uint64 type_hash_code,
-                  const std::string& type_name,
-                  const std::string& resource_name,
+  Status LookupInternal(const Shard& shard, const ContainerName& container,
+                        const Key& key, T** resource) const
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
+
+  Status DoCreate(Shard& shard, const std::string& container, TypeIndex type,
+                  const Key& key, ResourceBase* resource, bool owns_resource)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
+
+  Status DoLookup(const Shard& shard, const ContainerName& container,
+                  const Key& key, StringPiece type_name,
                   ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
 
-  Status DoDelete(const std::string& container, uint64 type_hash_code,
-                  const std::string& resource_name,
+  Status DoDelete(const ContainerName& container, const Key& key,
                   const std::string& type_name) TF_MUST_USE_RESULT;
-  Status DoDelete(const std::string& container, TypeIndex type,
-                  const std::string& resource_name) TF_MUST_USE_RESULT;
 
   // Pops the ResourceAndName entry. The entry is moved from the list to
   // the output argument `resource_and_name`.
   Status PopResourceAndName(
-      const std::string& container, uint64 type_hash_code,
-      const std::string& resource_name, const std::string& type_name,
+      const ContainerName& container, const Key& key,
+      const std::string& type_name,
       ResourceAndName& resource_and_name) TF_MUST_USE_RESULT;
   // Inserts the type name for 'hash_code' into the hash_code to type name map.
   Status InsertDebugTypeName(uint64 hash_code, const std::string& type_name)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
+      TF_LOCKS_EXCLUDED(debug_type_names_mu_) TF_MUST_USE_RESULT;
 
   // Returns the type name for the 'hash_code'.
   // Returns "<unknown>" if a resource with such a type was never inserted into
   // the container.
   const char* DebugTypeName(uint64 hash_code) const
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+      TF_LOCKS_EXCLUDED(debug_type_names_mu_);
 
   // Map from type hash_code to type name.
-  std::unordered_map<uint64, string> debug_type_names_ TF_GUARDED_BY(mu_);
+  mutable mutex debug_type_names_mu_;
+  std::unordered_map<uint64, string> debug_type_names_
+      TF_GUARDED_BY(debug_type_names_mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(ResourceMgr);
 };
@@ -632,8 +695,10 @@ Status ResourceMgr::Create(const std::string& container,
                            const std::string& name, T* resource) {
   CheckDeriveFromResourceBase<T>();
   CHECK(resource != nullptr);
-  mutex_lock l(mu_);
-  return DoCreate(container, TypeIndex::Make<T>(), name, resource,
+  const Key key = MakeKey(TypeIndex::Make<T>().hash_code(), name);
+  Shard& shard = ShardFor(MakeContainerName(container), key);
+  mutex_lock l(shard.mu);
+  return DoCreate(shard, container, TypeIndex::Make<T>(), key, resource,
                   /* owns_resource */ true);
 }
 
@@ -641,8 +706,10 @@ template <typename T>
 Status ResourceMgr::CreateUnowned(const std::string& container,
                                   const std::string& name, T* resource) {
   CheckDeriveFromResourceBase<T>();
-  mutex_lock l(mu_);
-  return DoCreate(container, TypeIndex::Make<T>(), name, resource,
+  const Key key = MakeKey(TypeIndex::Make<T>().hash_code(), name);
+  Shard& shard = ShardFor(MakeContainerName(container), key);
+  mutex_lock l(shard.mu);
+  return DoCreate(shard, container, TypeIndex::Make<T>(), key, resource,
                   /* owns_resource */ false);
 }
 
@@ -650,8 +717,25 @@ template <typename T, bool use_dynamic_cast>
 Status ResourceMgr::Lookup(const std::string& container,
                            const std::string& name, T** resource) const {
   CheckDeriveFromResourceBase<T>();
-  tf_shared_lock l(mu_);
-  return LookupInternal<T, use_dynamic_cast>(container, name, resource);
+  const ContainerName container_name = MakeContainerName(container);
+  const Key key = MakeKey(TypeIndex::Make<T>().hash_code(), name);
+  const Shard& shard = ShardFor(container_name, key);
+  tf_shared_lock l(shard.mu);
+  return LookupInternal<T, use_dynamic_cast>(shard, container_name, key,
+                                             resource);
+}
+
+template <typename T, bool use_dynamic_cast>
+Status ResourceMgr::Lookup(const ResourceHandle& handle, T** resource) const {
+  CheckDeriveFromResourceBase<T>();
+  const ContainerName container_name{handle.container(),
+                                     handle.container_hash()};
+  const Key key(TypeIndex::Make<T>().hash_code(), handle.name_hash(),
+                handle.name());
+  const Shard& shard = ShardFor(container_name, key);
+  tf_shared_lock l(shard.mu);
+  return LookupInternal<T, use_dynamic_cast>(shard, container_name, key,
+                                             resource);
 }
 
 template <typename T, bool use_dynamic_cast>
@@ -660,13 +744,12 @@ Status ResourceMgr::LookupMany(
         containers_and_names,
     std::vector<std::unique_ptr<T, core::RefCountDeleter>>* resources) const {
   CheckDeriveFromResourceBase<T>();
-  tf_shared_lock l(mu_);
   resources->resize(containers_and_names.size());
   for (size_t i = 0; i < containers_and_names.size(); ++i) {
     T* resource;
-    Status s = LookupInternal<T, use_dynamic_cast>(
-        *containers_and_names[i].first, *containers_and_names[i].second,
-        &resource);
+    Status s = Lookup<T, use_dynamic_cast>(*containers_and_names[i].first,
+                                           *containers_and_names[i].second,
+                                           &resource);
     if (s.ok()) {
       (*resources)[i].reset(resource);
     }
@@ -686,11 +769,12 @@ struct TypeCastFunctor<T, true> {
 };
 
 template <typename T, bool use_dynamic_cast>
-Status ResourceMgr::LookupInternal(const std::string& container,
-                                   const std::string& name,
-                                   T** resource) const {
+Status ResourceMgr::LookupInternal(const Shard& shard,
+                                   const ContainerName& container,
+                                   const Key& key, T** resource) const {
   ResourceBase* found = nullptr;
-  Status s = DoLookup(container, TypeIndex::Make<T>(), name, &found);
+  Status s =
+      DoLookup(shard, container, key, TypeIndex::Make<T>().name(), &found);
   if (s.ok()) {
     // It's safe to down cast 'found' to T* since
     // typeid(T).hash_code() is part of the map key.
@@ -705,17 +789,22 @@ Status ResourceMgr::LookupOrCreate(const std::string& container,
                                    std::function<Status(T**)> creator) {
   CheckDeriveFromResourceBase<T>();
   *resource = nullptr;
+  const ContainerName container_name = MakeContainerName(container);
+  const Key key = MakeKey(TypeIndex::Make<T>().hash_code(), name);
+  Shard& shard = ShardFor(container_name, key);
   Status s;
   {
-    tf_shared_lock l(mu_);
-    s = LookupInternal<T, use_dynamic_cast>(container, name, resource);
+    tf_shared_lock l(shard.mu);
+    s = LookupInternal<T, use_dynamic_cast>(shard, container_name, key,
+                                            resource);
     if (s.ok()) return s;
   }
-  mutex_lock l(mu_);
-  s = LookupInternal<T, use_dynamic_cast>(container, name, resource);
+  mutex_lock l(shard.mu);
+  s = LookupInternal<T, use_dynamic_cast>(shard, container_name, key,
+                                          resource);
   if (s.ok()) return s;
   TF_RETURN_IF_ERROR(creator(resource));
-  s = DoCreate(container, TypeIndex::Make<T>(), name, *resource,
+  s = DoCreate(shard, container, TypeIndex::Make<T>(), key, *resource,
                /* owns_resource */ true);
   if (!s.ok()) {
     return errors::Internal("LookupOrCreate failed unexpectedly");
@@ -728,7 +817,9 @@ template <typename T>
 Status ResourceMgr::Delete(const std::string& container,
                            const std::string& name) {
   CheckDeriveFromResourceBase<T>();
-  return DoDelete(container, TypeIndex::Make<T>(), name);
+  return DoDelete(MakeContainerName(container),
+                  MakeKey(TypeIndex::Make<T>().hash_code(), name),
+                  TypeIndex::Make<T>().name());
 }
 
 template <typename T>
@@ -798,8 +889,7 @@ Status LookupResource(OpKernelContext* ctx, const ResourceHandle& p,
     return OkStatus();
   }
 
-  return ctx->resource_manager()->Lookup<T, use_dynamic_cast>(p.container(),
-                                                              p.name(), value);
+  return ctx->resource_manager()->Lookup<T, use_dynamic_cast>(p, value);
 }
 
 // Finds the resource as "*value" from the handle. This is a type-erased
@@ -819,19 +909,23 @@ Status LookupResource(OpKernelContext* ctx, const ResourceHandle& p,
   return OkStatus();
 }
 
-// Similar to Lookup, but looks up multiple resources at once, with only a
-// single lock acquisition.
+// Similar to Lookup, but looks up multiple resources at once. If no resource
+// matches p[i], values[i] is left empty.
 template <typename T>
 Status LookupResources(OpKernelContext* ctx,
                        absl::Span<ResourceHandle const* const> p,
                        std::vector<core::RefCountPtr<T>>* values) {
-  std::vector<std::pair<const string*, const string*>> containers_and_names(
-      p.size());
   for (size_t i = 0; i < p.size(); ++i) {
     TF_RETURN_IF_ERROR(internal::ValidateDeviceAndType<T>(ctx, *p[i]));
-    containers_and_names[i] = {&p[i]->container(), &p[i]->name()};
   }
-  return ctx->resource_manager()->LookupMany(containers_and_names, values);
+  values->resize(p.size());
+  for (size_t i = 0; i < p.size(); ++i) {
+    T* value;
+    if (ctx->resource_manager()->Lookup<T>(*p[i], &value).ok()) {
+      (*values)[i].reset(value);
+    }
+  }
+  return OkStatus();
 }
 
 // If the resource manager in "ctx" has a resource pointed at by "p", returns
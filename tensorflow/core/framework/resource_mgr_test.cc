@@ -142,6 +142,53 @@ TEST(ResourceMgrTest, Basic) {
   TF_CHECK_OK(rm.Cleanup("bar"));
 }
 
+TEST(ResourceMgrTest, LookupByHandle) {
+  ResourceMgr rm;
+  TF_CHECK_OK(rm.Create("foo", "bar", new Resource("cat")));
+  TF_CHECK_OK(rm.Create("foo", "bar", new Other("tiger")));
+
+  ResourceHandle handle;
+  handle.set_container("foo");
+  handle.set_name("bar");
+  Resource* r;
+  TF_ASSERT_OK(rm.Lookup(handle, &r));
+  EXPECT_EQ("R/cat", r->DebugString());
+  r->Unref();
+  Other* o;
+  TF_ASSERT_OK(rm.Lookup(handle, &o));
+  EXPECT_EQ("O/tiger", o->DebugString());
+  o->Unref();
+
+  // The cached hashes follow the container and the name.
+  handle.set_name("baz");
+  HasError(rm.Lookup(handle, &r), error::NOT_FOUND, "Resource foo/baz");
+  handle.set_container("bar");
+  HasError(rm.Lookup(handle, &r), error::NOT_FOUND, "Container bar");
+}
+
+TEST(ResourceMgrTest, ManyResources) {
+  ResourceMgr rm;
+  constexpr int kNumResources = 100;
+  for (int i = 0; i < kNumResources; ++i) {
+    TF_CHECK_OK(rm.Create("foo", strings::StrCat("r", i),
+                          new Resource(strings::StrCat(i))));
+  }
+  for (int i = 0; i < kNumResources; ++i) {
+    EXPECT_EQ(strings::StrCat("R/", i),
+              Find<Resource>(rm, "foo", strings::StrCat("r", i)));
+  }
+  EXPECT_EQ(kNumResources,
+            static_cast<int>(str_util::Split(rm.DebugString(), '\n').size()));
+
+  // Cleanup removes the container's resources from every shard.
+  TF_CHECK_OK(rm.Cleanup("foo"));
+  for (int i = 0; i < kNumResources; ++i) {
+    HasError(FindErr<Resource>(rm, "foo", strings::StrCat("r", i)),
+             error::NOT_FOUND, "Container foo");
+  }
+  EXPECT_EQ("", rm.DebugString());
+}
+
 TEST(ResourceMgrTest, CreateUnowned) {
   core::RefCountPtr<Resource> cat{new Resource("cat")};
   core::RefCountPtr<Resource> kitty{new Resource("kitty")};
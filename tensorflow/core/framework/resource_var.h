@@ -43,19 +43,22 @@ namespace tensorflow {
 //
 // When a variable is accessed sparsely it switches to copy-on-read mode. To
 // switch we need to grab an exclusive lock and might (if there are aliases)
-// need to copy the entire tensor. Once copy-on-read mode is enabled, no tensor
-// is allowed to alias the variable's internal tensor. This means dense reads
-// must return a copy of the variable, done while holding a shared lock. Dense
-// writes do not need to check whether aliases exist, and can always write
-// directly to the buffer without making a copy, while holding an exclusive
-// lock. Sparse reads and sparse writes, on the other hand, can be done under a
-// shared or exclusive mutex (the damage from writes under a shared mutex is
-// limited since no other buffer is allowed to alias the variable's
-// buffer). Using an exclusive mutex disallows concurrent writes and concurrent
-// sparse reads, providing some extra safety at the expense of performance,
-// while shared mutex allow for "hogwild" behavior. Doing sparse writes under a
-// shared mutex prevents them from overlapping with dense writes, which is
-// necessary as dense writes can change the shape the of the tensor.
+// need to copy the entire tensor. Once copy-on-read mode is enabled, tensors
+// may only alias the variable's internal tensor while `aliased_by_reads` is
+// set. Dense reads alias the tensor and set it while holding an exclusive lock,
+// so that no sparse write can be in flight. Sparse writes that find it set take
+// an exclusive lock and, if the reference count shows that an alias is still
+// alive, copy the tensor before updating it (see
+// `EnsureSparseVariableAccessLocked()`). Dense writes always write to a fresh
+// buffer, while holding an exclusive lock. Sparse reads and sparse writes, on
+// the other hand, can be done under a shared or exclusive mutex (the damage
+// from writes under a shared mutex is limited since no other buffer is allowed
+// to alias the variable's buffer). Using an exclusive mutex disallows
+// concurrent writes and concurrent sparse reads, providing some extra safety at
+// the expense of performance, while shared mutex allow for "hogwild" behavior.
+// Doing sparse writes under a shared mutex prevents them from overlapping with
+// dense writes, which is necessary as dense writes can change the shape the of
+// the tensor.
 //
 // Transitioning a variable from copy-on-read mode to copy-on-write mode is
 // currently not supported. To upgrade a variable from copy-on-write to
@@ -98,11 +101,16 @@ class Var : public ResourceBase {
 
   // Also fake-guarded by mu_. Should be set to True whenever any sparse
   // operation uses the variable. Once this is true no tensor is allowed to
-  // alias the memory of the variable, and we always copy the variable on
-  // reads. This allows sparse operations to happen with only a shared lock if
-  // so desired.
+  // alias the memory of the variable unless `aliased_by_reads` is set. This
+  // allows sparse operations to happen with only a shared lock if so desired.
   std::atomic<bool> copy_on_read_mode{false};
 
+  // Also fake-guarded by mu_, and only set in copy-on-read mode. True if a
+  // dense read (or an assignment) may have aliased the memory of the variable
+  // since the last sparse write, which then has to copy the tensor if its
+  // reference count is bigger than 1. Only set while holding an exclusive lock.
+  std::atomic<bool> aliased_by_reads{false};
+
  private:
   mutex mu_;
   Tensor tensor_;
@@ -749,6 +749,8 @@ class RunHandler::Impl {
 
   int64_t priority() { return options_.priority(); }
 
+  int64_t weight() { return options_.weight(); }
+
  private:
   class ThreadPoolInterfaceWrapper : public thread::ThreadPoolInterface {
    public:
@@ -842,6 +844,8 @@ class RunHandlerPool::Impl {
                     static_cast<int32>(ParamFromEnvWithDefault(
                         "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS",
                         kMaxConcurrentHandlers))));
+    thread_local std::vector<int64_t> weights;
+    bool use_weights = false;
     uint64 version;
     int num_active_requests;
     RunHandler::Impl* handler_impl;
@@ -888,9 +892,15 @@ class RunHandlerPool::Impl {
         (*thread_work_sources)[i] = (*it)->tws();
         ++it;
       }
+      weights.clear();
+      for (RunHandler::Impl* active_handler : sorted_active_handlers_) {
+        weights.push_back(active_handler->weight());
+        use_weights |= active_handler->weight() > 0;
+      }
       version = ++version_;
     }
-    RecomputePoolStats(num_active_requests, version, *thread_work_sources);
+    RecomputePoolStats(num_active_requests, version, *thread_work_sources,
+                       use_weights ? &weights : nullptr);
     return WrapUnique<RunHandler>(new RunHandler(handler_impl));
   }
 
@@ -936,10 +946,13 @@ class RunHandlerPool::Impl {
   }
 
  private:
+  // Assigns the threads to the active requests, in proportion to `weights` if
+  // it is not null.
   void RecomputePoolStats(
       int num_active_requests, uint64 version,
       const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
-          thread_work_sources);
+          thread_work_sources,
+      const std::vector<int64_t>* weights);
 
   void LogInfo() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
@@ -975,7 +988,8 @@ class RunHandlerPool::Impl {
 void RunHandlerPool::Impl::RecomputePoolStats(
     int num_active_requests, uint64 version,
     const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
-        thread_work_sources) {
+        thread_work_sources,
+    const std::vector<int64_t>* weights) {
   if (num_active_requests == 0) return;
 
   int sub_thread_pool_id = 0;
@@ -996,8 +1010,13 @@ void RunHandlerPool::Impl::RecomputePoolStats(
   int num_blocking_threads = run_handler_thread_pool()->NumBlockingThreads();
   int num_non_blocking_threads = num_threads - num_blocking_threads;
 
-  std::vector<int> request_idx_list = ChooseRequestsWithExponentialDistribution(
-      num_active_requests, num_blocking_threads);
+  auto choose_requests = [num_active_requests, weights](int num_assigned) {
+    return weights != nullptr
+               ? ChooseRequestsWithWeights(*weights, num_assigned)
+               : ChooseRequestsWithExponentialDistribution(num_active_requests,
+                                                           num_assigned);
+  };
+  std::vector<int> request_idx_list = choose_requests(num_blocking_threads);
   for (int i = 0; i < num_blocking_threads; ++i) {
     VLOG(2) << "Set work for tid=" << i
             << " with start_request_idx=" << request_idx_list[i];
@@ -1005,8 +1024,7 @@ void RunHandlerPool::Impl::RecomputePoolStats(
         i, request_idx_list[i], version, thread_work_sources);
   }
 
-  request_idx_list = ChooseRequestsWithExponentialDistribution(
-      num_active_requests, num_non_blocking_threads);
+  request_idx_list = choose_requests(num_non_blocking_threads);
   for (int i = 0; i < num_non_blocking_threads; ++i) {
     VLOG(2) << "Set work for tid=" << (i + num_blocking_threads)
             << " with start_request_idx=" << request_idx_list[i];
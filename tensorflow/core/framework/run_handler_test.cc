@@ -779,6 +779,72 @@ TEST_F(RunHandlerTest, TestConcurrencyUseRunHandlerPoolWithPriority) {
   delete tp;
 }
 
+TEST_F(RunHandlerTest, TestConcurrencyUseRunHandlerPoolWithWeights) {
+  Initialize({1, 2, 3, 4});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  EXPECT_EQ(OkStatus(), session->Create(def_));
+
+  // Three threads of heavy, low priority traffic share the pool with one
+  // thread of light, high priority traffic that asks for a larger share.
+  thread::ThreadPool* tp = new thread::ThreadPool(Env::Default(), "test", 4);
+  std::vector<string> output_names = {y_ + ":0"};
+  auto fn = [&session, output_names](int num_runs, int64_t priority,
+                                     int64_t weight) {
+    RunOptions run_options;
+    run_options.mutable_experimental()->set_use_run_handler_pool(true);
+    auto* pool_options =
+        run_options.mutable_experimental()->mutable_run_handler_pool_options();
+    pool_options->set_priority(priority);
+    pool_options->set_weight(weight);
+    for (int i = 0; i < num_runs; ++i) {
+      std::vector<std::pair<string, Tensor>> inputs;
+      std::vector<Tensor> outputs;
+      Status s = session->Run(run_options, inputs, output_names, {}, &outputs,
+                              nullptr);
+      EXPECT_EQ(OkStatus(), s);
+      ASSERT_EQ(1, outputs.size());
+      auto mat = outputs[0].matrix<float>();
+      EXPECT_FLOAT_EQ(3.0, mat(0, 0));
+    }
+  };
+
+  for (int i = 0; i < 3; ++i) {
+    tp->Schedule([&fn]() { fn(1000, /*priority=*/0, /*weight=*/1); });
+  }
+  tp->Schedule([&fn]() { fn(100, /*priority=*/1, /*weight=*/4); });
+
+  // Wait for the functions to finish.
+  delete tp;
+}
+
+TEST(RunHandlerUtilTest, WeightedIntraOpScheduling) {
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(4, 4));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  options.set_weight(1);
+  auto heavy = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_priority(1);
+  options.set_weight(3);
+  auto light = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+
+  // The work of both requests completes, whichever threads pick it up first.
+  BlockingCounter counter(200);
+  for (int i = 0; i < 100; ++i) {
+    heavy->AsIntraThreadPoolInterface()->Schedule(
+        [&counter]() { counter.DecrementCount(); });
+    light->AsIntraThreadPoolInterface()->Schedule(
+        [&counter]() { counter.DecrementCount(); });
+  }
+  counter.Wait();
+
+  std::vector<int64_t> sorted_active_list =
+      pool->GetActiveHandlerPrioritiesForTesting();
+  ASSERT_EQ(sorted_active_list.size(), 2);
+  EXPECT_EQ(sorted_active_list[0], 1);
+  EXPECT_EQ(sorted_active_list[1], 0);
+}
+
 TEST_F(RunHandlerTest, TestWaitTimeout) {
   std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1, 1));
 
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/run_handler_util.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "tensorflow/core/lib/strings/numbers.h"
@@ -181,4 +182,27 @@ std::vector<int> ChooseRequestsWithExponentialDistribution(
   return request_idx_list;
 }
 
+std::vector<int> ChooseRequestsWithWeights(const std::vector<int64_t>& weights,
+                                           int num_threads) {
+  std::vector<int> request_idx_list(num_threads);
+  if (weights.empty()) return request_idx_list;
+  double total_weight = 0;
+  for (int64_t weight : weights) total_weight += std::max<int64_t>(weight, 1);
+
+  // Thread `tid` takes the request whose share of the cumulative weight covers
+  // the middle of its own 1 / num_threads slice.
+  int request_idx = 0;
+  double cumulative_weight = std::max<int64_t>(weights[0], 1);
+  for (int tid = 0; tid < num_threads; ++tid) {
+    const double position = (tid + 0.5) * total_weight / num_threads;
+    while (request_idx < static_cast<int>(weights.size()) - 1 &&
+           position >= cumulative_weight) {
+      ++request_idx;
+      cumulative_weight += std::max<int64_t>(weights[request_idx], 1);
+    }
+    request_idx_list[tid] = request_idx;
+  }
+  return request_idx_list;
+}
+
 }  // namespace tensorflow
@@ -54,6 +54,12 @@ void ComputeInterOpStealingRanges(int num_threads, int min_threads_per_domain,
 std::vector<int> ChooseRequestsWithExponentialDistribution(
     int num_active_requests, int num_threads);
 
+// Like ChooseRequestsWithExponentialDistribution, but distributes the threads
+// in proportion to `weights`, one per active request. Weights that are not
+// positive count as 1.
+std::vector<int> ChooseRequestsWithWeights(const std::vector<int64_t>& weights,
+                                           int num_threads);
+
 // Look up environment variable named 'var_name' and return the value if it
 // exist and can be parsed. Return 'default_value' otherwise.
 double ParamFromEnvWithDefault(const char* var_name, double default_value);
@@ -126,6 +126,24 @@ TEST(RunHandlerUtilTest, TestExponentialRequestDistribution) {
   ASSERT_EQ(actual_distribution, expected_distribution);
 }
 
+TEST(RunHandlerUtilTest, TestWeightedDistribution) {
+  std::vector<int> actual_distribution =
+      ChooseRequestsWithWeights({1, 3}, /*num_threads=*/8);
+  std::vector<int> expected_distribution{0, 0, 1, 1, 1, 1, 1, 1};
+  ASSERT_EQ(actual_distribution, expected_distribution);
+
+  // Weights that are not positive count as 1.
+  actual_distribution = ChooseRequestsWithWeights({2, 0, -1}, 8);
+  expected_distribution = {0, 0, 0, 0, 1, 1, 2, 2};
+  ASSERT_EQ(actual_distribution, expected_distribution);
+
+  // A request gets no thread of its own if its share is too small, but its
+  // work is still stolen by the others.
+  actual_distribution = ChooseRequestsWithWeights({10, 1}, 4);
+  expected_distribution = {0, 0, 0, 0};
+  ASSERT_EQ(actual_distribution, expected_distribution);
+}
+
 TEST(RunHandlerUtilTest, TestParamFromEnvWithDefault) {
   std::vector<double> result = ParamFromEnvWithDefault(
       "RUN_HANDLER_TEST_ENV", std::vector<double>{0, 0, 0});
@@ -50,6 +50,7 @@ class TensorProto;
 class Var;
 
 namespace batch_util {
+class ElementCopier;
 Status CopyElementToSlice(Tensor element, Tensor* parent, int64_t index);
 Status CopySliceToElement(const Tensor& parent, Tensor* element, int64_t index);
 Status MaybeMoveSliceToElement(Tensor* parent, Tensor* element, int64_t index);
@@ -708,6 +709,7 @@ class Tensor {
       const Tensor& src, int64_t src_offset, int64_t dst_offset,
       int64_t num_slices,
       Tensor* dst);  // For access to base<T>().
+  friend class batch_util::ElementCopier;  // For access to base<T>().
 
   bool CanUseDMA() const;
 
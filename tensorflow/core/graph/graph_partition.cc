@@ -245,6 +245,11 @@ NodeDef* AddSend(const PartitionOptions& opts, const GraphInfo& g_info,
   if (opts.scheduling_for_recvs) {
     send_builder.Attr("_start_time", start_time);
   }
+  // Let the producer of a tensor opt its cross-process sends into a wire
+  // codec, e.g. to send gradients as bfloat16.
+  if (const AttrValue* wire_codec = src->attrs().Find("_wire_codec")) {
+    send_builder.Attr("_wire_codec", *wire_codec);
+  }
   NodeDef* send = gdef->add_node();
   *status = send_builder.Finalize(send, /*consume=*/true);
   return send;
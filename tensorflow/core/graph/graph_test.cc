@@ -753,6 +753,30 @@ BENCHMARK(BM_GraphCreation)->ArgPair(1 << 9, 16);
 BENCHMARK(BM_GraphCreation)->ArgPair(1 << 12, 16);
 BENCHMARK(BM_GraphCreation)->ArgPair(1 << 15, 16);
 
+void BM_GraphCreationFromMovedGraphDef(::testing::benchmark::State& state) {
+  const int num_nodes = state.range(0);
+  const int num_edges_per_node = state.range(1);
+  const GraphDef graph_def =
+      test::CreateGraphDef(num_nodes, num_edges_per_node);
+  const auto registry = OpRegistry::Global();
+  GraphConstructorOptions opts;
+  int64_t sum = 0;
+  for (auto s : state) {
+    state.PauseTiming();
+    GraphDef graph_def_copy = graph_def;
+    Graph graph(registry);
+    state.ResumeTiming();
+    TF_CHECK_OK(
+        ConvertGraphDefToGraph(opts, std::move(graph_def_copy), &graph));
+    sum += graph.num_node_ids();
+  }
+  VLOG(1) << sum;
+}
+BENCHMARK(BM_GraphCreationFromMovedGraphDef)->ArgPair(1 << 12, 2);
+BENCHMARK(BM_GraphCreationFromMovedGraphDef)->ArgPair(1 << 15, 2);
+BENCHMARK(BM_GraphCreationFromMovedGraphDef)->ArgPair(1 << 18, 2);
+BENCHMARK(BM_GraphCreationFromMovedGraphDef)->ArgPair(1 << 20, 2);
+
 void BM_ToGraphDef(::testing::benchmark::State& state) {
   const int num_nodes = state.range(0);
   const int num_edges_per_node = state.range(1);
@@ -0,0 +1,79 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
+
+#include <cmath>
+#include <map>
+#include <utility>
+
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+struct LogRatios {
+  double sum = 0;
+  int64_t count = 0;
+};
+
+}  // namespace
+
+OpCostProfile TrainOpCostProfile(const OpPerformanceList& measurements,
+                                 const OpLevelCostEstimator& estimator,
+                                 int min_samples) {
+  // Ordered so that the profile is deterministic.
+  std::map<std::pair<string, string>, LogRatios> log_ratios;
+  for (const OpPerformance& measurement : measurements.op_performance()) {
+    if (measurement.compute_cost() <= 0) continue;
+    OpContext op_context;
+    op_context.name = measurement.node();
+    op_context.op_info = measurement.op();
+    Costs costs = estimator.PredictUncalibratedCosts(op_context);
+    if (costs.inaccurate || costs.execution_time.count() <= 0) {
+      VLOG(2) << "Not calibrating from " << measurement.node() << ": "
+              << measurement.op().op() << " has no accurate analytical cost.";
+      continue;
+    }
+    LogRatios& ratios = log_ratios[{measurement.op().device().type(),
+                                    measurement.op().op()}];
+    ratios.sum += std::log(static_cast<double>(measurement.compute_cost()) /
+                           costs.execution_time.count());
+    ++ratios.count;
+  }
+
+  OpCostProfile profile;
+  for (const auto& key_and_ratios : log_ratios) {
+    const LogRatios& ratios = key_and_ratios.second;
+    if (ratios.count < min_samples) continue;
+    OpCostCorrection* correction = profile.add_correction();
+    correction->set_device_type(key_and_ratios.first.first);
+    correction->set_op(key_and_ratios.first.second);
+    correction->set_execution_time_scale(std::exp(ratios.sum / ratios.count));
+    correction->set_num_samples(ratios.count);
+  }
+  return profile;
+}
+
+Status WriteOpCostProfile(const OpCostProfile& profile, const string& path) {
+  return WriteBinaryProto(Env::Default(), path, profile);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,44 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
+
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Trains the correction factors of `estimator` for the hardware that
+// `measurements` were taken on, e.g. by CostGraphToOpPerformanceData from the
+// cost graph of profiled steps. The scale of each op type and device type is
+// the geometric mean of the ratios of the measured (compute_cost) to the
+// uncalibrated analytical execution time. Measurements of ops whose analytical
+// costs are inaccurate are ignored, and op types with fewer than
+// `min_samples` usable measurements are left uncalibrated.
+OpCostProfile TrainOpCostProfile(const OpPerformanceList& measurements,
+                                 const OpLevelCostEstimator& estimator,
+                                 int min_samples = 1);
+
+// Writes `profile` so that it is loaded by every OpLevelCostEstimator when
+// TF_GRAPPLER_COST_PROFILE is set to `path`.
+Status WriteOpCostProfile(const OpCostProfile& profile, const string& path);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
@@ -0,0 +1,129 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
+
+#include "tensorflow/core/grappler/costs/op_context.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpInfo DescribeOp(const string& op) {
+  OpInfo op_info;
+  op_info.set_op(op);
+  auto device = op_info.mutable_device();
+  device->set_type("CPU");
+  device->set_num_cores(10);
+  device->set_bandwidth(10000000);  // 10000000 KB/s = 10 GB/s
+  device->set_frequency(1000);      // 1000 Mhz = 1 GHz
+  for (int i = 0; i < 3; ++i) {
+    auto tensor = i < 2 ? op_info.add_inputs() : op_info.add_outputs();
+    tensor->set_dtype(DT_FLOAT);
+    tensor->mutable_shape()->add_dim()->set_size(1024);
+    tensor->mutable_shape()->add_dim()->set_size(1024);
+  }
+  return op_info;
+}
+
+int64_t PredictNanos(const OpLevelCostEstimator& estimator,
+                     const OpInfo& op_info, bool calibrated) {
+  OpContext op_context;
+  op_context.op_info = op_info;
+  Costs costs = calibrated ? estimator.PredictCosts(op_context)
+                           : estimator.PredictUncalibratedCosts(op_context);
+  return costs.execution_time.count();
+}
+
+void AddMeasurement(const OpInfo& op_info, int64_t compute_cost,
+                    OpPerformanceList* measurements) {
+  OpPerformance* measurement = measurements->add_op_performance();
+  *measurement->mutable_op() = op_info;
+  measurement->set_node(op_info.op());
+  measurement->set_compute_cost(compute_cost);
+}
+
+TEST(CostCalibrationTest, TrainsGeometricMeanScale) {
+  OpLevelCostEstimator estimator;
+  const OpInfo matmul = DescribeOp("MatMul");
+  const int64_t predicted = PredictNanos(estimator, matmul, false);
+  ASSERT_GT(predicted, 0);
+
+  OpPerformanceList measurements;
+  AddMeasurement(matmul, 2 * predicted, &measurements);
+  AddMeasurement(matmul, 8 * predicted, &measurements);
+  // The analytical cost of an unknown op is inaccurate.
+  AddMeasurement(DescribeOp("FancyOp"), 1000, &measurements);
+  // Ops that weren't measured are skipped.
+  AddMeasurement(DescribeOp("AddV2"), 0, &measurements);
+
+  OpCostProfile profile = TrainOpCostProfile(measurements, estimator);
+  ASSERT_EQ(profile.correction_size(), 1);
+  EXPECT_EQ(profile.correction(0).device_type(), "CPU");
+  EXPECT_EQ(profile.correction(0).op(), "MatMul");
+  EXPECT_NEAR(profile.correction(0).execution_time_scale(), 4.0, 1e-6);
+  EXPECT_EQ(profile.correction(0).num_samples(), 2);
+
+  EXPECT_EQ(TrainOpCostProfile(measurements, estimator, /*min_samples=*/3)
+                .correction_size(),
+            0);
+}
+
+TEST(CostCalibrationTest, ScalesPredictedCosts) {
+  OpLevelCostEstimator estimator;
+  const OpInfo matmul = DescribeOp("MatMul");
+  const OpInfo add = DescribeOp("AddV2");
+  const int64_t predicted_matmul = PredictNanos(estimator, matmul, false);
+  const int64_t predicted_add = PredictNanos(estimator, add, false);
+
+  OpPerformanceList measurements;
+  AddMeasurement(matmul, 3 * predicted_matmul, &measurements);
+  estimator.SetCostProfile(TrainOpCostProfile(measurements, estimator));
+
+  EXPECT_NEAR(PredictNanos(estimator, matmul, true), 3 * predicted_matmul, 3);
+  EXPECT_EQ(PredictNanos(estimator, matmul, false), predicted_matmul);
+  EXPECT_EQ(PredictNanos(estimator, add, true), predicted_add);
+
+  // Corrections are specific to the device type.
+  OpInfo gpu_matmul = matmul;
+  gpu_matmul.mutable_device()->set_type("GPU");
+  EXPECT_DOUBLE_EQ(estimator.GetExecutionTimeScale(gpu_matmul), 1.0);
+}
+
+TEST(CostCalibrationTest, WritesProfile) {
+  OpCostProfile profile;
+  OpCostCorrection* correction = profile.add_correction();
+  correction->set_device_type("CPU");
+  correction->set_op("Conv2D");
+  correction->set_execution_time_scale(0.5);
+  correction->set_num_samples(10);
+
+  const string path =
+      io::JoinPath(testing::TmpDir(), "cost_calibration_test_profile.pb");
+  TF_ASSERT_OK(WriteOpCostProfile(profile, path));
+  OpCostProfile loaded;
+  TF_ASSERT_OK(ReadTextOrBinaryProto(Env::Default(), path, &loaded));
+  EXPECT_EQ(loaded.DebugString(), profile.DebugString());
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -26,7 +26,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/utils.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/overflow.h"
 
 namespace tensorflow {
@@ -42,6 +44,8 @@ constexpr char kConv2d[] = "Conv2D";
 constexpr char kConv2dBackpropFilter[] = "Conv2DBackpropFilter";
 constexpr char kConv2dBackpropInput[] = "Conv2DBackpropInput";
 constexpr char kFusedConv2dBiasActivation[] = "FusedConv2DBiasActivation";
+constexpr char kRemapperFusedConv2d[] = "_FusedConv2D";
+constexpr char kRemapperFusedMatMul[] = "_FusedMatMul";
 constexpr char kDataFormatVecPermute[] = "DataFormatVecPermute";
 constexpr char kDepthToSpace[] = "DepthToSpace";
 constexpr char kDepthwiseConv2dNative[] = "DepthwiseConv2dNative";
@@ -316,6 +320,35 @@ bool IsEinsumCorrectlyFormed(const OpContext& einsum_context) {
   return true;
 }
 
+// Returns the cost profile named by TF_GRAPPLER_COST_PROFILE, or nullptr if
+// there is none. The profile is only loaded once.
+const OpCostProfile* DefaultCostProfile() {
+  static const OpCostProfile* profile = []() -> const OpCostProfile* {
+    string path;
+    Status s = ReadStringFromEnvVar("TF_GRAPPLER_COST_PROFILE", "", &path);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return nullptr;
+    }
+    if (path.empty()) return nullptr;
+    auto* profile = new OpCostProfile();
+    s = ReadTextOrBinaryProto(Env::Default(), path, profile);
+    if (!s.ok()) {
+      LOG(WARNING) << "Ignoring the cost profile " << path << ": " << s;
+      delete profile;
+      return nullptr;
+    }
+    VLOG(1) << "Loaded " << profile->correction_size()
+            << " cost corrections from " << path;
+    return profile;
+  }();
+  return profile;
+}
+
+Costs::Duration ScaleDuration(Costs::Duration duration, double scale) {
+  return Costs::Duration(duration.count() * scale);
+}
+
 }  // namespace
 
 // Return a minimum shape if the shape is unknown. If known, return the original
@@ -378,6 +411,12 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
   device_cost_impl_.emplace(
       kFusedConv2dBiasActivation,
       wrap(&OpLevelCostEstimator::PredictFusedConv2DBiasActivation));
+  device_cost_impl_.emplace(
+      kRemapperFusedConv2d,
+      wrap(&OpLevelCostEstimator::PredictFusedContraction));
+  device_cost_impl_.emplace(
+      kRemapperFusedMatMul,
+      wrap(&OpLevelCostEstimator::PredictFusedContraction));
   // reuse Conv2D for DepthwiseConv2dNative because the calculation is the
   // same although the actual meaning of the parameters are different. See
   // comments in PredictConv2D and related functions
@@ -567,6 +606,7 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
   elementwise_ops_.emplace("Ceil", EIGEN_COST(scalar_ceil_op<float>));
   elementwise_ops_.emplace("Cos", EIGEN_COST(scalar_cos_op<float>));
   elementwise_ops_.emplace("Dequantize", EIGEN_COST(scalar_product_op<float>));
+  elementwise_ops_.emplace("Elu", EIGEN_COST(scalar_expm1_op<float>));
   elementwise_ops_.emplace("Erf", 1);
   elementwise_ops_.emplace("Erfc", 1);
   elementwise_ops_.emplace("Exp", EIGEN_COST(scalar_exp_op<float>));
@@ -574,6 +614,8 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
   elementwise_ops_.emplace("Floor", EIGEN_COST(scalar_floor_op<float>));
   elementwise_ops_.emplace("Inv", EIGEN_COST(scalar_inverse_op<float>));
   elementwise_ops_.emplace("InvGrad", 1);
+  elementwise_ops_.emplace("LeakyRelu", EIGEN_COST(scalar_product_op<float>) +
+                                            EIGEN_COST(scalar_max_op<float>));
   elementwise_ops_.emplace("Lgamma", 1);
   elementwise_ops_.emplace("Log", EIGEN_COST(scalar_log_op<float>));
   elementwise_ops_.emplace("Log1p", EIGEN_COST(scalar_log1p_op<float>));
@@ -646,9 +688,47 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  if (const OpCostProfile* profile = DefaultCostProfile()) {
+    SetCostProfile(*profile);
+  }
+}
+
+void OpLevelCostEstimator::SetCostProfile(const OpCostProfile& profile) {
+  execution_time_scales_.clear();
+  for (const OpCostCorrection& correction : profile.correction()) {
+    if (correction.execution_time_scale() <= 0) continue;
+    execution_time_scales_[{correction.device_type(), correction.op()}] =
+        correction.execution_time_scale();
+  }
+}
+
+double OpLevelCostEstimator::GetExecutionTimeScale(
+    const OpInfo& op_info) const {
+  auto it =
+      execution_time_scales_.find({op_info.device().type(), op_info.op()});
+  return it != execution_time_scales_.end() ? it->second : 1.0;
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
+  Costs costs = PredictUncalibratedCosts(op_context);
+  const double scale = GetExecutionTimeScale(op_context.op_info);
+  if (scale != 1.0) {
+    costs.execution_time = ScaleDuration(costs.execution_time, scale);
+    costs.compute_time = ScaleDuration(costs.compute_time, scale);
+    costs.memory_time = ScaleDuration(costs.memory_time, scale);
+    costs.intermediate_memory_time =
+        ScaleDuration(costs.intermediate_memory_time, scale);
+    costs.intermediate_memory_read_time =
+        ScaleDuration(costs.intermediate_memory_read_time, scale);
+    costs.intermediate_memory_write_time =
+        ScaleDuration(costs.intermediate_memory_write_time, scale);
+  }
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictUncalibratedCosts(
+    const OpContext& op_context) const {
   Costs costs;
   NodeCosts node_costs;
   if (PredictNodeCosts(op_context, &node_costs).ok()) {
@@ -1822,6 +1902,57 @@ Status OpLevelCostEstimator::PredictFusedConv2DBiasActivation(
   return PredictFusedOp(op_context_with_output, component_ops, node_costs);
 }
 
+Status OpLevelCostEstimator::PredictFusedContraction(
+    const OpContext& op_context, NodeCosts* node_costs) const {
+  // _FusedConv2D and _FusedMatMul are created by the Grappler remapper. They
+  // compute the contraction of their first two inputs, and then apply the ops
+  // listed in the `fused_ops` attribute to the contraction output:
+  //
+  // Input -> Conv2D/MatMul -> BiasAdd/FusedBatchNorm -> [Add] -> [Activation]
+  //            ^                 ^                       ^
+  //          Filter        Bias/Scale,...           Side Input
+  const auto& op_info = op_context.op_info;
+  if (op_info.inputs_size() < 2) {
+    return errors::InvalidArgument("Fused contraction requires two inputs: ",
+                                   op_info.ShortDebugString());
+  }
+  const bool is_conv2d = op_info.op() == kRemapperFusedConv2d;
+
+  // The fused ops are elementwise, so they all produce the contraction output.
+  bool found_unknown_shapes = op_info.outputs_size() == 0;
+  const OpInfo::TensorProperties output =
+      found_unknown_shapes ? op_info.inputs(0) : op_info.outputs(0);
+
+  std::vector<OpContext> component_ops = {
+      FusedChildContext(op_context, is_conv2d ? kConv2d : kMatMul, output,
+                        {op_info.inputs(0), op_info.inputs(1)})};
+  const auto fused_ops = op_info.attr().find("fused_ops");
+  if (fused_ops != op_info.attr().end()) {
+    for (const std::string& fused_op : fused_ops->second.list().s()) {
+      if (fused_op == "FusedBatchNorm") {
+        // In inference mode the batch norm is a scale and an offset.
+        component_ops.push_back(
+            FusedChildContext(op_context, "Mul", output, {output, output}));
+        component_ops.push_back(
+            FusedChildContext(op_context, "Add", output, {output, output}));
+      } else if (fused_op == "BiasAdd" || fused_op == "Add") {
+        component_ops.push_back(
+            FusedChildContext(op_context, fused_op, output, {output, output}));
+      } else {
+        component_ops.push_back(
+            FusedChildContext(op_context, fused_op, output, {output}));
+      }
+    }
+  }
+
+  TF_RETURN_IF_ERROR(PredictFusedOp(op_context, component_ops, node_costs));
+  if (found_unknown_shapes) {
+    node_costs->inaccurate = true;
+    node_costs->num_nodes_with_unknown_shapes = 1;
+  }
+  return OkStatus();
+}
+
 Status OpLevelCostEstimator::PredictMatMul(const OpContext& op_context,
                                            NodeCosts* node_costs) const {
   const auto& op_info = op_context.op_info;
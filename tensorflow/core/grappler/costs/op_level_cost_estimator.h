@@ -93,8 +93,21 @@ class OpLevelCostEstimator {
   OpLevelCostEstimator();
   virtual ~OpLevelCostEstimator() {}
 
+  // Returns the analytical costs of the op, scaled by the cost profile.
   virtual Costs PredictCosts(const OpContext& op_context) const;
 
+  // Returns the analytical costs of the op, ignoring the cost profile.
+  Costs PredictUncalibratedCosts(const OpContext& op_context) const;
+
+  // Replaces the per-op-type correction factors applied by PredictCosts. By
+  // default they are loaded from the file named by TF_GRAPPLER_COST_PROFILE
+  // (see TrainOpCostProfile in cost_calibration.h).
+  void SetCostProfile(const OpCostProfile& profile);
+
+  // Returns the factor scaling the execution time of the op, 1 if it is not
+  // calibrated.
+  double GetExecutionTimeScale(const OpInfo& op_info) const;
+
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
@@ -143,6 +156,8 @@ class OpLevelCostEstimator {
                                      NodeCosts* node_costs) const;
   Status PredictFusedConv2DBiasActivation(const OpContext& op_context,
                                           NodeCosts* node_costs) const;
+  Status PredictFusedContraction(const OpContext& op_context,
+                                 NodeCosts* node_costs) const;
   Status PredictMatMul(const OpContext& op_context,
                        NodeCosts* node_costs) const;
   Status PredictSparseTensorDenseMatMul(const OpContext& op_context,
@@ -320,6 +335,8 @@ class OpLevelCostEstimator {
   // compute_time and memory_time, instead of sum of those two.
   bool compute_memory_overlap_;
   std::set<string> persistent_ops_;
+  // Execution time scale by device type and op type.
+  std::map<std::pair<string, string>, double> execution_time_scales_;
 
  private:
   friend class OpLevelCostEstimatorTest;
@@ -1036,6 +1036,56 @@ TEST_F(OpLevelCostEstimatorTest,
   EXPECT_EQ(cost.persistent_memory, 0);
 }
 
+TEST_F(OpLevelCostEstimatorTest, FusedMatMulBiasAddRelu) {
+  constexpr int kM = 64, kK = 128, kN = 256;
+  auto describe_output = [](OpContext* op_context) {
+    auto* output = op_context->op_info.add_outputs();
+    output->set_dtype(DT_FLOAT);
+    output->mutable_shape()->add_dim()->set_size(kM);
+    output->mutable_shape()->add_dim()->set_size(kN);
+  };
+
+  OpContext matmul = DescribeMatMul(kM, kN, kK, kK);
+  describe_output(&matmul);
+  OpContext bias_add;
+  SetCpuDevice(&bias_add.op_info);
+  bias_add.op_info.set_op("BiasAdd");
+  *bias_add.op_info.add_inputs() = matmul.op_info.outputs(0);
+  DescribeTensor1D(kN, bias_add.op_info.add_inputs());
+  describe_output(&bias_add);
+  OpContext relu;
+  SetCpuDevice(&relu.op_info);
+  relu.op_info.set_op("Relu");
+  *relu.op_info.add_inputs() = matmul.op_info.outputs(0);
+  describe_output(&relu);
+
+  OpContext fused = DescribeMatMul(kM, kN, kK, kK);
+  fused.op_info.set_op("_FusedMatMul");
+  DescribeTensor1D(kN, fused.op_info.add_inputs());
+  describe_output(&fused);
+  auto* fused_ops = (*fused.op_info.mutable_attr())["fused_ops"].mutable_list();
+  fused_ops->add_s("BiasAdd");
+  fused_ops->add_s("Relu");
+
+  const Costs matmul_cost = PredictCosts(matmul);
+  const Costs bias_add_cost = PredictCosts(bias_add);
+  const Costs relu_cost = PredictCosts(relu);
+  const Costs fused_cost = PredictCosts(fused);
+
+  // The fused op computes the same as its components, but doesn't write and
+  // read back the intermediate results.
+  EXPECT_NEAR((matmul_cost.compute_time + bias_add_cost.compute_time +
+               relu_cost.compute_time)
+                  .count(),
+              fused_cost.compute_time.count(), 3);
+  EXPECT_LT(fused_cost.memory_time, matmul_cost.memory_time +
+                                        bias_add_cost.memory_time +
+                                        relu_cost.memory_time);
+  EXPECT_EQ(fused_cost.num_ops_total, 1);
+  EXPECT_FALSE(fused_cost.inaccurate);
+  EXPECT_EQ(fused_cost.num_ops_with_unknown_shapes, 0);
+}
+
 TEST_F(OpLevelCostEstimatorTest, MulExecutionTime) {
   auto cost = PredictCosts(DescribeBinaryOp("Mul", 1000, 1));
   EXPECT_EQ(Costs::Duration(2000), cost.memory_time);
@@ -102,6 +102,11 @@ struct GrapplerItem {
 
     // Mark the grapper optimization run in eager mode or not.
     bool is_eager_mode = false;
+
+    // If true, the tensors fed to the graph always have the shapes of the fed
+    // nodes, e.g. because the graph was specialized to the shapes of its
+    // feeds, and optimizers may rely on them.
+    bool assume_valid_feeds = false;
   };
 
   const std::unordered_set<string>& devices() const;
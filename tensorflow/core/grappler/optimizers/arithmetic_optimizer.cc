@@ -4441,7 +4441,9 @@ Status ArithmeticOptimizer::Optimize(Cluster* /*cluster*/,
   GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
 
   graph_properties_.reset(new GraphProperties(optimized_item));
-  const bool assume_valid_feeds = opt_level_ == RewriterConfig::AGGRESSIVE;
+  const bool assume_valid_feeds =
+      opt_level_ == RewriterConfig::AGGRESSIVE ||
+      optimized_item.optimization_options().assume_valid_feeds;
   const Status status =
       graph_properties_->InferStatically(assume_valid_feeds,
                                          /*aggressive_shape_inference=*/false,
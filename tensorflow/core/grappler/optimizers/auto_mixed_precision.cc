@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
@@ -39,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/env_var.h"
 
@@ -972,6 +974,13 @@ int GetCudnnVersion(const Cluster& cluster) {
   return 0;
 }
 
+// Returns whether the host CPU has bfloat16 instructions, without which the
+// bfloat16 kernels are emulated and slower than their float32 counterparts.
+bool HasNativeBfloat16() {
+  return port::TestCPUFeature(port::CPUFeature::AVX512_BF16) ||
+         port::TestCPUFeature(port::CPUFeature::AMX_BF16);
+}
+
 class AutoMixedPrecisionImpl {
  public:
   // CastType indicates the type of inserted Cast op
@@ -982,7 +991,9 @@ class AutoMixedPrecisionImpl {
   AutoMixedPrecisionImpl(Cluster* cluster,
                          const std::unordered_set<string>& nodes_to_preserve,
                          GraphDef* graph, string id,
-                         AutoMixedPrecisionMode mode)
+                         AutoMixedPrecisionMode mode,
+                         const absl::flat_hash_map<string, int64_t>*
+                             op_micros = nullptr)
       : virtual_placer_(cluster->GetDevices()),
         nodes_to_preserve_(nodes_to_preserve),
         graph_(graph),
@@ -993,6 +1004,7 @@ class AutoMixedPrecisionImpl {
         cudnn_version_(GetCudnnVersion(*cluster)),
         num_nonvar_casts_to_f16_(0),
         mode_(mode),
+        op_micros_(op_micros),
         target_dtype_((mode_ == AutoMixedPrecisionMode::CUDA ||
                        mode_ == AutoMixedPrecisionMode::CPU)
                           ? DT_HALF
@@ -1009,6 +1021,7 @@ class AutoMixedPrecisionImpl {
         return std::make_unique<AutoMixedPrecisionListsCuda>(cuda_version_,
                                                              cudnn_version_);
       case AutoMixedPrecisionMode::MKL:
+        if (op_micros_ != nullptr) return get_profiled_lists();
         return std::make_unique<AutoMixedPrecisionListsMkl>();
       case AutoMixedPrecisionMode::CPU:
         // Note: this is not a typo here. AutoMixedPrecisionListsCuda is used
@@ -1018,6 +1031,12 @@ class AutoMixedPrecisionImpl {
             /*cudnn_version=*/8000);  // CPU emulates the same ops on GPU.
     }
   }
+  // Returns the MKL lists narrowed down by the calibration profile.
+  std::unique_ptr<AutoMixedPrecisionListsProfiled> get_profiled_lists() const {
+    return std::make_unique<AutoMixedPrecisionListsProfiled>(
+        std::make_unique<AutoMixedPrecisionListsMkl>(), *op_micros_,
+        HasNativeBfloat16());
+  }
   Status PrintDebugLogs(bool preop, size_t timestamp);
   void LogSkippedNode(const NodeDef& node) const;
   bool MustPreserve(const NodeDef& node) const;
@@ -1084,6 +1103,8 @@ class AutoMixedPrecisionImpl {
   bool force_all_fp16_;
   bool treat_infer_as_deny_;
   AutoMixedPrecisionMode mode_;
+  // Compute time per op type from a calibration run, or null if none.
+  const absl::flat_hash_map<string, int64_t>* op_micros_;
   gtl::FlatSet<string> f16_allowlist_;
   gtl::FlatSet<string> f16_denylist_;
   gtl::FlatSet<string> f16_inferlist_;
@@ -1329,6 +1350,15 @@ Status AutoMixedPrecisionImpl::Optimize() {
   treat_infer_as_deny_ = optimization_level == "TREAT_INFER_AS_DENY";
   VLOG(2) << "Optimization Level: " << optimization_level;
 
+  if (op_micros_ != nullptr) {
+    const string report = get_profiled_lists()->NumericRiskReport();
+    if (id_ == "tf_graph") {
+      LOG(INFO) << report;
+    } else {
+      VLOG(1) << report;
+    }
+  }
+
   std::unique_ptr<AutoMixedPrecisionLists> mp_lists =
       get_mixed_precision_lists();
   f16_allowlist_ = mp_lists->AllowList();
@@ -2202,6 +2232,39 @@ int GetNumGPUs(const Cluster& cluster) {
   return num_gpus;
 }
 
+// Sums up the compute time of the nodes in `step_stats` per op type. Op types
+// are looked up in `graph`, or parsed from the "name = Op(...)" timeline
+// labels for nodes that the runtime added.
+absl::flat_hash_map<string, int64_t> GetComputeMicrosPerOpType(
+    const StepStats& step_stats, const GraphDef& graph) {
+  absl::flat_hash_map<string, const string*> node_ops;
+  for (const NodeDef& node : graph.node()) {
+    node_ops[node.name()] = &node.op();
+  }
+  absl::flat_hash_map<string, int64_t> op_micros;
+  for (const DeviceStepStats& device_stats : step_stats.dev_stats()) {
+    for (const NodeExecStats& node_stats : device_stats.node_stats()) {
+      string op;
+      auto it = node_ops.find(node_stats.node_name());
+      if (it != node_ops.end()) {
+        op = *it->second;
+      } else {
+        const string& label = node_stats.timeline_label();
+        const size_t begin = label.find(" = ");
+        const size_t end =
+            begin == string::npos ? begin : label.find('(', begin);
+        if (end == string::npos) continue;
+        op = label.substr(begin + 3, end - begin - 3);
+      }
+      const int64_t micros =
+          node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros();
+      if (op.empty() || micros <= 0) continue;
+      op_micros[op] += micros;
+    }
+  }
+  return op_micros;
+}
+
 }  // end namespace
 
 Status AutoMixedPrecision::Optimize(Cluster* cluster, const GrapplerItem& item,
@@ -2233,9 +2296,28 @@ Status AutoMixedPrecision::Optimize(Cluster* cluster, const GrapplerItem& item,
     return OkStatus();
   }
 
+  absl::flat_hash_map<string, int64_t> op_micros;
+  const bool use_profile = mode_ == AutoMixedPrecisionMode::MKL &&
+                           !calibration_profile_.empty();
+  if (use_profile) {
+    StepStats step_stats;
+    Status status =
+        ReadBinaryProto(Env::Default(), calibration_profile_, &step_stats);
+    if (!status.ok()) {
+      status = ReadTextProto(Env::Default(), calibration_profile_, &step_stats);
+    }
+    if (!status.ok()) {
+      return errors::InvalidArgument(
+          "Failed to read the calibration profile ", calibration_profile_,
+          ": ", status.error_message());
+    }
+    op_micros = GetComputeMicrosPerOpType(step_stats, item.graph);
+  }
+
   // Optimize the output graph in-place.
   AutoMixedPrecisionImpl optimizer(cluster, item.NodesToPreserve(), output,
-                                   item.id, mode_);
+                                   item.id, mode_,
+                                   use_profile ? &op_micros : nullptr);
   if (item.id == "tf_graph") {
     LOG(INFO) << "Running " << name() << " graph optimizer";
   } else {
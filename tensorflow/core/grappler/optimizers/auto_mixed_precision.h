@@ -34,10 +34,13 @@ class AutoMixedPrecision : public GraphOptimizer {
  public:
   // If 'mode' is CUDA, converts nodes to float16 on Nvidia GPUs. If MKL,
   // converts nodes to bfloat16 on CPUs in order to take advantage of MKL
-  // performance improvements with bfloat16.
+  // performance improvements with bfloat16. In MKL mode, a non-empty
+  // 'calibration_profile' is the path of a StepStats proto from a float32 run
+  // that restricts the conversion to the ops that dominate the compute time.
   explicit AutoMixedPrecision(
-      AutoMixedPrecisionMode mode = AutoMixedPrecisionMode::CUDA)
-      : mode_(mode) {}
+      AutoMixedPrecisionMode mode = AutoMixedPrecisionMode::CUDA,
+      const string& calibration_profile = "")
+      : mode_(mode), calibration_profile_(calibration_profile) {}
 
   ~AutoMixedPrecision() override {}
 
@@ -62,6 +65,7 @@ class AutoMixedPrecision : public GraphOptimizer {
 
  private:
   const AutoMixedPrecisionMode mode_;
+  const string calibration_profile_;
 };
 
 }  // end namespace grappler
@@ -16,10 +16,17 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_AUTO_MIXED_PRECISION_LISTS_H_
 #define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_AUTO_MIXED_PRECISION_LISTS_H_
 
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
@@ -549,6 +556,125 @@ class AutoMixedPrecisionListsMkl : public AutoMixedPrecisionLists {
   }
 };
 
+// Narrows the lists of `base` to the ops that a calibration run shows to be
+// worth converting to bfloat16 on the CPU. `op_micros` maps each op type to
+// its compute time in the calibration run, and `has_native_bf16` is whether
+// the CPU executes bfloat16 natively (AVX512-BF16 or AMX-BF16).
+//
+// Allow list ops that take less than kMinAllowTimeShare of the profiled
+// compute time are demoted to the infer list: on their own the inserted Casts
+// cost more than the conversion saves, so they are only converted when their
+// neighbours are. Without native bfloat16 support the conversion is emulated
+// and slower than float32, so the whole allow list is demoted.
+class AutoMixedPrecisionListsProfiled : public AutoMixedPrecisionLists {
+ public:
+  static constexpr double kMinAllowTimeShare = 0.01;
+
+  AutoMixedPrecisionListsProfiled(
+      std::unique_ptr<AutoMixedPrecisionLists> base,
+      absl::flat_hash_map<string, int64_t> op_micros, bool has_native_bf16)
+      : base_allow_list_(base->AllowList()),
+        infer_list_(base->InferList()),
+        deny_list_(base->DenyList()),
+        clear_list_(base->ClearList()),
+        op_micros_(std::move(op_micros)) {
+    for (const auto& op_and_micros : op_micros_) {
+      total_micros_ += op_and_micros.second;
+    }
+    for (const string& op : base_allow_list_) {
+      if (has_native_bf16 && TimeShare(op) >= kMinAllowTimeShare) {
+        allow_list_.insert(op);
+      } else {
+        infer_list_.insert(op);
+      }
+    }
+  }
+
+  gtl::FlatSet<string> AllowList() override { return allow_list_; }
+  gtl::FlatSet<string> InferList() override { return infer_list_; }
+  gtl::FlatSet<string> DenyList() override { return deny_list_; }
+  gtl::FlatSet<string> ClearList() override { return clear_list_; }
+
+  // Returns the fraction of the profiled compute time spent in ops of type
+  // `op`.
+  double TimeShare(const string& op) const {
+    auto it = op_micros_.find(op);
+    if (it == op_micros_.end() || total_micros_ <= 0) return 0.0;
+    return static_cast<double>(it->second) / total_micros_;
+  }
+
+  // Returns a human-readable report of the numeric risk of running the
+  // profiled allow and infer ops in bfloat16, weighted by their share of the
+  // compute time. Contractions keep float32 accumulation and are of medium
+  // risk; reductions, normalizations and transcendentals lose the most
+  // precision and are of high risk.
+  string NumericRiskReport() const {
+    std::vector<std::pair<double, string>> ops;
+    for (const auto& op_and_micros : op_micros_) {
+      const string& op = op_and_micros.first;
+      if (allow_list_.count(op) || infer_list_.count(op)) {
+        ops.emplace_back(TimeShare(op), op);
+      }
+    }
+    std::sort(ops.rbegin(), ops.rend());
+    absl::flat_hash_map<string, double> share_per_risk;
+    string rows;
+    for (const auto& share_and_op : ops) {
+      const string& op = share_and_op.second;
+      const char* risk = NumericRisk(op);
+      share_per_risk[risk] += share_and_op.first;
+      strings::StrAppend(
+          &rows, strings::Printf("  %s: %.1f%% of compute, %s list, %s risk\n",
+                                 op.c_str(), 100.0 * share_and_op.first,
+                                 allow_list_.count(op) ? "allow" : "infer",
+                                 risk));
+    }
+    return strings::StrCat(
+        "bfloat16 numeric risk by share of the profiled compute time: ",
+        strings::Printf("high %.1f%%, medium %.1f%%, low %.1f%%\n",
+                        100.0 * share_per_risk["high"],
+                        100.0 * share_per_risk["medium"],
+                        100.0 * share_per_risk["low"]),
+        rows);
+  }
+
+ private:
+  const char* NumericRisk(const string& op) const {
+    static const auto* const kHighRiskOps = new gtl::FlatSet<string>{
+        "AddN",
+        "BiasAddGrad",
+        "FusedBatchNorm",
+        "FusedBatchNormGrad",
+        "FusedBatchNormGradV2",
+        "FusedBatchNormGradV3",
+        "FusedBatchNormV2",
+        "FusedBatchNormV3",
+        "_FusedBatchNormEx",
+        "Exp",
+        "Log",
+        "Log1p",
+        "LogSoftmax",
+        "Mean",
+        "Prod",
+        "Reciprocal",
+        "Softmax",
+        "Sum",
+    };
+    if (kHighRiskOps->count(op)) return "high";
+    if (base_allow_list_.count(op)) return "medium";
+    return "low";
+  }
+
+  // The allow list before narrowing, i.e. the contractions.
+  const gtl::FlatSet<string> base_allow_list_;
+  gtl::FlatSet<string> allow_list_;
+  gtl::FlatSet<string> infer_list_;
+  gtl::FlatSet<string> deny_list_;
+  gtl::FlatSet<string> clear_list_;
+  const absl::flat_hash_map<string, int64_t> op_micros_;
+  int64_t total_micros_ = 0;
+};
+
 }  // end namespace grappler
 }  // end namespace tensorflow
 
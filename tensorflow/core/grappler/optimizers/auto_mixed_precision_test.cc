@@ -20,6 +20,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/cc/ops/control_flow_ops_internal.h"
 #include "tensorflow/cc/ops/list_ops.h"
 #include "tensorflow/cc/ops/math_ops.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/devices.h"
 #include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/optimizers/auto_mixed_precision_lists.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/random.h"
@@ -1611,6 +1613,35 @@ TEST_F(AutoMixedPrecisionMklTest, InferFollowUpStreamDeny) {
     test::ExpectClose(tensors_expected[i], tensors[i]);
   }
 }
+
+TEST(AutoMixedPrecisionListsProfiledTest, DemotesOpsOutsideTheProfile) {
+  absl::flat_hash_map<string, int64_t> op_micros = {
+      {"MatMul", 900}, {"Conv2D", 5}, {"Softmax", 95}};
+  AutoMixedPrecisionListsProfiled lists(
+      std::make_unique<AutoMixedPrecisionListsMkl>(), op_micros,
+      /*has_native_bf16=*/true);
+  gtl::FlatSet<string> allow_list = lists.AllowList();
+  gtl::FlatSet<string> infer_list = lists.InferList();
+  EXPECT_EQ(allow_list.size(), 1);
+  EXPECT_EQ(allow_list.count("MatMul"), 1);
+  EXPECT_EQ(infer_list.count("Conv2D"), 1);
+  EXPECT_EQ(infer_list.count("BatchMatMulV2"), 1);
+  EXPECT_EQ(infer_list.count("MatMul"), 0);
+  EXPECT_NEAR(lists.TimeShare("MatMul"), 0.9, 1e-6);
+
+  const string report = lists.NumericRiskReport();
+  EXPECT_TRUE(absl::StrContains(report, "MatMul: 90.0% of compute"));
+  EXPECT_TRUE(absl::StrContains(report, "high 9.5%, medium 90.5%"));
+}
+
+TEST(AutoMixedPrecisionListsProfiledTest, NoAllowListWithoutNativeBf16) {
+  absl::flat_hash_map<string, int64_t> op_micros = {{"MatMul", 100}};
+  AutoMixedPrecisionListsProfiled lists(
+      std::make_unique<AutoMixedPrecisionListsMkl>(), op_micros,
+      /*has_native_bf16=*/false);
+  EXPECT_TRUE(lists.AllowList().empty());
+  EXPECT_EQ(lists.InferList().count("MatMul"), 1);
+}
 #endif  // INTEL_MKL
 
 }  // namespace
@@ -46,13 +46,18 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/denormal.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/setround.h"
 #include "tensorflow/core/platform/tensor_coding.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/bcast.h"
+#include "tensorflow/core/util/device_name_utils.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 
 namespace tensorflow {
@@ -189,21 +194,25 @@ float QuantizedTypeMaxAsFloat(DataType data_type) {
 ConstantFolding::ConstantFolding(RewriterConfig::Toggle opt_level,
                                  DeviceBase* cpu_device,
                                  bool disable_compressed_tensor_optimization,
-                                 bool fold_quantization_emulation)
+                                 bool fold_quantization_emulation,
+                                 const ConstantFoldingOptions& options)
     : opt_level_(opt_level),
       cpu_device_(cpu_device),
       disable_compressed_tensor_optimization_(
           disable_compressed_tensor_optimization),
-      fold_quantization_emulation_(fold_quantization_emulation) {
+      fold_quantization_emulation_(fold_quantization_emulation),
+      options_(options),
+      folded_bytes_(0) {
   resource_mgr_.reset(new ResourceMgr());
 }
 
 ConstantFolding::ConstantFolding(DeviceBase* cpu_device,
                                  bool disable_compressed_tensor_optimization,
-                                 bool fold_quantization_ops)
+                                 bool fold_quantization_ops,
+                                 const ConstantFoldingOptions& options)
     : ConstantFolding(RewriterConfig::ON, cpu_device,
                       disable_compressed_tensor_optimization,
-                      fold_quantization_ops) {}
+                      fold_quantization_ops, options) {}
 
 // static
 string ConstantFolding::AddControlDependency(const string& input_name,
@@ -1411,6 +1420,33 @@ Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
   return OkStatus();
 }
 
+int64_t ConstantFolding::EstimateFoldingBytes(
+    const NodeDef& node, const GraphProperties& properties) const {
+  int64_t input_bytes = 0;
+  for (const auto& input : node.input()) {
+    if (IsControlInput(input)) break;
+    const NodeDef* input_node = node_map_->GetNode(input);
+    if (input_node == nullptr || !IsReallyConstant(*input_node)) continue;
+    const auto value = input_node->attr().find("value");
+    if (value == input_node->attr().end()) continue;
+    const PartialTensorShape shape(value->second.tensor().tensor_shape());
+    if (shape.IsFullyDefined()) {
+      input_bytes +=
+          shape.num_elements() * DataTypeSize(value->second.tensor().dtype());
+    }
+  }
+  // Outputs of unknown size are assumed to be as large as the inputs.
+  if (!properties.HasOutputProperties(node.name())) return 2 * input_bytes;
+  int64_t output_bytes = 0;
+  for (const auto& output : properties.GetOutputProperties(node.name())) {
+    const PartialTensorShape shape(output.shape());
+    output_bytes += shape.IsFullyDefined()
+                        ? shape.num_elements() * DataTypeSize(output.dtype())
+                        : input_bytes;
+  }
+  return input_bytes + output_bytes;
+}
+
 Status ConstantFolding::FoldMergeNode(NodeDef* node, GraphDef* output_graph) {
   // Merge nodes are special, in the sense that they execute as soon as one of
   // their input is ready. We can therefore fold a merge node iff it has at
@@ -1513,6 +1549,14 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph,
   std::vector<NodeDef> const_nodes;
   TF_RETURN_IF_ERROR(
       EvaluateOneFoldable(*node, &const_nodes, result_too_large));
+  return ApplyFoldedNodes(node, std::move(const_nodes), output_graph,
+                          result_too_large);
+}
+
+Status ConstantFolding::ApplyFoldedNodes(NodeDef* node,
+                                         std::vector<NodeDef> const_nodes,
+                                         GraphDef* output_graph,
+                                         bool* result_too_large) {
   VLOG(2) << "Folded node: " << SummarizeNodeDef(*node);
 
   NodeDef* constant_output = nullptr;
@@ -1556,6 +1600,22 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph,
     // We rewrite the existing node if it only has a single output, and
     // create new nodes otherwise.
     if (const_nodes.size() == 1) {
+      const NodeDef* duplicate = options_.deduplicate_constants()
+                                     ? FindFoldedDuplicate(*node, *const_node)
+                                     : nullptr;
+      const bool externalize =
+          duplicate == nullptr && IsExternalizable(*const_node);
+      if (duplicate == nullptr && !externalize &&
+          options_.max_folded_bytes() > 0 &&
+          folded_bytes_ +
+                  static_cast<int64_t>(
+                      const_node->attr().at("value").tensor().ByteSizeLong()) >
+              options_.max_folded_bytes()) {
+        *result_too_large = true;
+        return errors::InvalidArgument(
+            "Can't fold ", node->name(), ", the folded constants would exceed ",
+            options_.max_folded_bytes(), " bytes");
+      }
       node->set_op("Const");
       // Note we need to clear the inputs in NodeMap before we clear the inputs
       // in the node, otherwise NodeMap would see empty inputs and effectively
@@ -1567,6 +1627,17 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph,
         node_map_->AddOutput(NodeName(input), node->name());
       }
       *node->mutable_attr() = const_node->attr();
+      if (duplicate != nullptr) {
+        ForwardToFoldedDuplicate(node, *duplicate);
+      } else if (externalize) {
+        const Status s = ExternalizeFoldedConstant(node, output_graph);
+        if (!s.ok()) {
+          VLOG(1) << "Inlining " << node->name() << ": " << s;
+          RecordFoldedConstant(*node);
+        }
+      } else {
+        RecordFoldedConstant(*node);
+      }
       break;
     } else {
       if (node_map_->GetNode(const_node->name())) {
@@ -1629,6 +1700,183 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph,
   return OkStatus();
 }
 
+bool ConstantFolding::IsExternalizable(const NodeDef& const_node) const {
+  return !options_.external_directory().empty() &&
+         static_cast<int64_t>(
+             const_node.attr().at("value").tensor().ByteSizeLong()) >=
+             options_.external_threshold_bytes();
+}
+
+const NodeDef* ConstantFolding::FindFoldedDuplicate(
+    const NodeDef& node, const NodeDef& const_node) const {
+  if (nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end()) {
+    return nullptr;
+  }
+  // Control dependencies on the node can't be forwarded to the duplicate.
+  for (const NodeDef* output : node_map_->GetOutputs(node.name())) {
+    for (const string& input : output->input()) {
+      if (IsControlInput(input) && NodeName(input) == node.name()) {
+        return nullptr;
+      }
+    }
+  }
+  const string value = const_node.attr().at("value").SerializeAsString();
+  const auto it = folded_constants_.find(Fingerprint64(value));
+  if (it == folded_constants_.end()) return nullptr;
+  const absl::flat_hash_set<string> control_inputs(const_node.input().begin(),
+                                                   const_node.input().end());
+  for (const string& name : it->second) {
+    const NodeDef* candidate = node_map_->GetNode(name);
+    if (candidate == nullptr || !IsConstant(*candidate) ||
+        candidate->device() != node.device() ||
+        candidate->input_size() !=
+            static_cast<int>(control_inputs.size()) ||
+        !absl::c_all_of(candidate->input(), [&](const string& input) {
+          return control_inputs.contains(input);
+        })) {
+      continue;
+    }
+    if (candidate->attr().at("value").SerializeAsString() == value) {
+      return candidate;
+    }
+  }
+  return nullptr;
+}
+
+void ConstantFolding::ForwardToFoldedDuplicate(NodeDef* node,
+                                               const NodeDef& duplicate) {
+  VLOG(2) << "Replacing " << node->name() << " with the identical constant "
+          << duplicate.name();
+  for (NodeDef* output : node_map_->GetOutputsOrderedByNodeName(node->name())) {
+    for (int i = 0; i < output->input_size(); ++i) {
+      if (NodeName(output->input(i)) == node->name()) {
+        *output->mutable_input(i) = duplicate.name();
+      }
+    }
+    node_map_->UpdateInput(output->name(), node->name(), duplicate.name());
+  }
+  graph_modified_ = true;
+}
+
+namespace {
+
+// Returns the CPU device of the task that `device` belongs to.
+string HostDevice(const string& device) {
+  DeviceNameUtils::ParsedName parsed;
+  if (device.empty() || !DeviceNameUtils::ParseFullName(device, &parsed)) {
+    return "";
+  }
+  parsed.has_type = true;
+  parsed.type = DEVICE_CPU;
+  parsed.has_id = true;
+  parsed.id = 0;
+  return DeviceNameUtils::ParsedNameToString(parsed);
+}
+
+}  // namespace
+
+Status ConstantFolding::ExternalizeFoldedConstant(NodeDef* node,
+                                                  GraphDef* output_graph) {
+  const string path_name = OptimizedNodeName(*node, "/external_path");
+  const string read_name = OptimizedNodeName(*node, "/external_read");
+  const string parse_name = OptimizedNodeName(*node, "/external_parse");
+  for (const string& name : {path_name, read_name, parse_name}) {
+    if (node_map_->NodeExists(name)) {
+      return errors::AlreadyExists(name, " already present in the graph");
+    }
+  }
+
+  // Identical constants are written to the same file.
+  const TensorProto& value = node->attr().at("value").tensor();
+  const string content = value.SerializeAsString();
+  const Fprint128 fingerprint = Fingerprint128(content);
+  const string path = io::JoinPath(
+      options_.external_directory(),
+      strings::StrCat(strings::Hex(fingerprint.high64, strings::kZeroPad16),
+                      strings::Hex(fingerprint.low64, strings::kZeroPad16),
+                      ".tensorpb"));
+  Env* env = Env::Default();
+  if (!env->FileExists(path).ok()) {
+    TF_RETURN_IF_ERROR(
+        env->RecursivelyCreateDir(options_.external_directory()));
+    const string tmp_path = strings::StrCat(path, ".tmp", env->NowMicros());
+    TF_RETURN_IF_ERROR(WriteStringToFile(env, tmp_path, content));
+    TF_RETURN_IF_ERROR(env->RenameFile(tmp_path, path));
+  }
+  VLOG(2) << "Writing the value of " << node->name() << " to " << path;
+
+  // Rewrite the node into EnsureShape(ParseTensor(ReadFile(path))). The
+  // file is read on the host, and the control dependencies of the folded
+  // constant are moved to the path constant.
+  const string host_device = HostDevice(node->device());
+  const DataType dtype = value.dtype();
+
+  NodeDef* path_node = output_graph->add_node();
+  path_node->set_name(path_name);
+  path_node->set_op("Const");
+  path_node->set_device(host_device);
+  Tensor path_tensor(DT_STRING, TensorShape({}));
+  path_tensor.scalar<tstring>()() = path;
+  (*path_node->mutable_attr())["dtype"].set_type(DT_STRING);
+  path_tensor.AsProtoField(
+      (*path_node->mutable_attr())["value"].mutable_tensor());
+  *path_node->mutable_input() = node->input();
+  node_map_->AddNode(path_name, path_node);
+  for (const string& input : path_node->input()) {
+    node_map_->AddOutput(NodeName(input), path_name);
+  }
+
+  NodeDef* read_node = output_graph->add_node();
+  read_node->set_name(read_name);
+  read_node->set_op("ReadFile");
+  read_node->set_device(host_device);
+  read_node->add_input(path_name);
+  node_map_->AddNode(read_name, read_node);
+  node_map_->AddOutput(path_name, read_name);
+
+  NodeDef* parse_node = output_graph->add_node();
+  parse_node->set_name(parse_name);
+  parse_node->set_op("ParseTensor");
+  parse_node->set_device(host_device);
+  parse_node->add_input(read_name);
+  (*parse_node->mutable_attr())["out_type"].set_type(dtype);
+  node_map_->AddNode(parse_name, parse_node);
+  node_map_->AddOutput(read_name, parse_name);
+
+  TensorShapeProto shape = value.tensor_shape();
+  node_map_->RemoveInputs(node->name());
+  node->clear_input();
+  node->add_input(parse_name);
+  node_map_->AddOutput(parse_name, node->name());
+  node->set_op("EnsureShape");
+  node->clear_attr();
+  auto* attr = node->mutable_attr();
+  (*attr)["T"].set_type(dtype);
+  *(*attr)["shape"].mutable_shape() = std::move(shape);
+  return OkStatus();
+}
+
+void ConstantFolding::RecordFoldedConstant(const NodeDef& node) {
+  const AttrValue& value = node.attr().at("value");
+  folded_bytes_ += value.tensor().ByteSizeLong();
+  if (options_.deduplicate_constants()) {
+    folded_constants_[Fingerprint64(value.SerializeAsString())].push_back(
+        node.name());
+  }
+}
+
+namespace {
+
+// The result of evaluating a foldable node ahead of folding it.
+struct EvaluatedFoldable {
+  bool done = false;
+  Status status;
+  bool result_too_large = false;
+  std::vector<NodeDef> const_nodes;
+};
+
+}  // namespace
+
 Status ConstantFolding::FoldGraph(
     const GraphProperties& properties, GraphDef* optimized_graph,
     absl::flat_hash_set<string>* nodes_to_not_simplify) {
@@ -1643,30 +1891,104 @@ Status ConstantFolding::FoldGraph(
       queue.push_back(graph_->mutable_node(i));
     }
   }
+  folded_constants_.clear();
+  std::unique_ptr<thread::ThreadPool> thread_pool;
+  if (options_.num_threads() > 1) {
+    thread_pool = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "constant_folding", options_.num_threads());
+  }
+  const int64_t memory_budget = options_.memory_budget_bytes();
   while (!queue.empty()) {
-    NodeDef* node = queue.front();
-    queue.pop_front();
-    if (processed_nodes.count(node->name())) {
-      continue;
-    }
-    // We need to record a copy of output nodes before FoldNode() modifies it.
-    // We also need to ensure that the fanout is sorted deterministically.
-    std::vector<NodeDef*> fanout =
-        node_map_->GetOutputsOrderedByNodeName(node->name());
-    bool result_too_large = false;
-    Status s = FoldNode(node, optimized_graph, &result_too_large);
-    processed_nodes.insert(node->name());
-    if (!s.ok()) {
-      VLOG(1) << "Failed to fold node " << node->DebugString()
-              << "\nError message: " << s;
-      if (result_too_large) {
+    // Without a thread pool the nodes are folded one at a time. Otherwise all
+    // the queued nodes only have constant inputs, so they are evaluated
+    // concurrently and then folded in order.
+    std::vector<NodeDef*> batch;
+    std::vector<int64_t> batch_bytes;
+    absl::flat_hash_set<const NodeDef*> batched_nodes;
+    do {
+      NodeDef* node = queue.front();
+      queue.pop_front();
+      if (processed_nodes.count(node->name()) ||
+          !batched_nodes.insert(node).second) {
+        continue;
+      }
+      const int64_t bytes =
+          memory_budget > 0 ? EstimateFoldingBytes(*node, properties) : 0;
+      if (bytes > memory_budget && memory_budget > 0) {
+        VLOG(1) << "Not folding " << node->name() << ", evaluating it would "
+                << "need about " << bytes << " bytes";
+        processed_nodes.insert(node->name());
         nodes_to_not_simplify->emplace(node->name());
+        continue;
       }
-    } else {
-      for (auto& fanout_node : fanout) {
-        if (IsFoldable(*fanout_node, &properties) &&
-            !nodes_to_not_simplify->count(fanout_node->name())) {
-          queue.push_back(fanout_node);
+      batch.push_back(node);
+      batch_bytes.push_back(bytes);
+    } while (thread_pool != nullptr && !queue.empty());
+
+    const int batch_size = batch.size();
+    std::vector<EvaluatedFoldable> evaluated(batch_size);
+    for (int begin = 0, end = 0; thread_pool != nullptr && begin < batch_size;
+         begin = end) {
+      // Evaluate as many nodes as fit in the memory budget at a time.
+      int64_t bytes = 0;
+      for (end = begin; end < batch_size; ++end) {
+        if (end > begin && memory_budget > 0 &&
+            bytes + batch_bytes[end] > memory_budget) {
+          break;
+        }
+        bytes += batch_bytes[end];
+      }
+      BlockingCounter counter(end - begin);
+      for (int i = begin; i < end; ++i) {
+        if (IsMerge(*batch[i])) {
+          counter.DecrementCount();
+          continue;
+        }
+        thread_pool->Schedule([this, &batch, &evaluated, &counter, i]() {
+          port::ScopedFlushDenormal flush;
+          port::ScopedSetRound round(FE_TONEAREST);
+          EvaluatedFoldable& result = evaluated[i];
+          result.status = EvaluateOneFoldable(*batch[i], &result.const_nodes,
+                                              &result.result_too_large);
+          result.done = true;
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+    }
+
+    for (int i = 0; i < batch_size; ++i) {
+      NodeDef* node = batch[i];
+      // We need to record a copy of output nodes before FoldNode() modifies
+      // it. We also need to ensure that the fanout is sorted
+      // deterministically.
+      std::vector<NodeDef*> fanout =
+          node_map_->GetOutputsOrderedByNodeName(node->name());
+      bool result_too_large = false;
+      Status s;
+      if (evaluated[i].done) {
+        result_too_large = evaluated[i].result_too_large;
+        s = evaluated[i].status;
+        if (s.ok()) {
+          s = ApplyFoldedNodes(node, std::move(evaluated[i].const_nodes),
+                               optimized_graph, &result_too_large);
+        }
+      } else {
+        s = FoldNode(node, optimized_graph, &result_too_large);
+      }
+      processed_nodes.insert(node->name());
+      if (!s.ok()) {
+        VLOG(1) << "Failed to fold node " << node->DebugString()
+                << "\nError message: " << s;
+        if (result_too_large) {
+          nodes_to_not_simplify->emplace(node->name());
+        }
+      } else {
+        for (auto& fanout_node : fanout) {
+          if (IsFoldable(*fanout_node, &properties) &&
+              !nodes_to_not_simplify->count(fanout_node->name())) {
+            queue.push_back(fanout_node);
+          }
         }
       }
     }
@@ -4028,6 +4350,7 @@ Status ConstantFolding::Optimize(Cluster* cluster, const GrapplerItem& item,
   port::ScopedFlushDenormal flush;
   port::ScopedSetRound round(FE_TONEAREST);
   nodes_to_preserve_ = item.NodesToPreserve();
+  folded_bytes_ = 0;
   for (const auto& feed : item.feed) {
     feed_nodes_.insert(NodeName(feed.first));
   }
@@ -4050,8 +4373,10 @@ Status ConstantFolding::Optimize(Cluster* cluster, const GrapplerItem& item,
   GraphProperties properties(item_to_optimize);
   // It's possible to feed a placeholder with a tensor of any shape: make sure
   // that the shape inference deals with this conservatively unless we're in
-  // aggressive mode.
-  const bool assume_valid_feeds = opt_level_ == RewriterConfig::AGGRESSIVE;
+  // aggressive mode, or the graph was specialized to the shapes of its feeds.
+  const bool assume_valid_feeds =
+      opt_level_ == RewriterConfig::AGGRESSIVE ||
+      item.optimization_options().assume_valid_feeds;
   if (!properties
            .InferStatically(assume_valid_feeds,
                             /*aggressive_shape_inference=*/false,
@@ -45,12 +45,16 @@ class ConstantFolding : public GraphOptimizer {
   static string AddControlDependency(const string& input_name, GraphDef* graph,
                                      NodeMap* node_map);
 
-  explicit ConstantFolding(DeviceBase* cpu_device,
-                           bool disable_compressed_tensor_optimization = false,
-                           bool fold_quantization_emulation = true);
-  ConstantFolding(RewriterConfig::Toggle opt_level, DeviceBase* cpu_device,
-                  bool disable_compressed_tensor_optimization = false,
-                  bool fold_quantization_emulation = true);
+  explicit ConstantFolding(
+      DeviceBase* cpu_device,
+      bool disable_compressed_tensor_optimization = false,
+      bool fold_quantization_emulation = true,
+      const ConstantFoldingOptions& options = ConstantFoldingOptions());
+  ConstantFolding(
+      RewriterConfig::Toggle opt_level, DeviceBase* cpu_device,
+      bool disable_compressed_tensor_optimization = false,
+      bool fold_quantization_emulation = true,
+      const ConstantFoldingOptions& options = ConstantFoldingOptions());
 
   ~ConstantFolding() override {}
 
@@ -95,9 +99,26 @@ class ConstantFolding : public GraphOptimizer {
   Status EvaluateOneFoldable(const NodeDef& node, std::vector<NodeDef>* outputs,
                              bool* result_too_large);
 
+  // Returns an estimate of the memory needed to evaluate `node`: the size of
+  // its constant inputs plus the size of its outputs.
+  int64_t EstimateFoldingBytes(const NodeDef& node,
+                               const GraphProperties& properties) const;
+
   Status FoldMergeNode(NodeDef* node, GraphDef* output_graph);
   Status FoldNode(NodeDef* node, GraphDef* output_graph,
                   bool* result_too_large);
+  // Replaces `node` with the constants `const_nodes` it evaluated to.
+  Status ApplyFoldedNodes(NodeDef* node, std::vector<NodeDef> const_nodes,
+                          GraphDef* output_graph, bool* result_too_large);
+
+  // Helpers for ConstantFoldingOptions, which only apply to nodes folded into
+  // a single constant.
+  bool IsExternalizable(const NodeDef& const_node) const;
+  const NodeDef* FindFoldedDuplicate(const NodeDef& node,
+                                     const NodeDef& const_node) const;
+  void ForwardToFoldedDuplicate(NodeDef* node, const NodeDef& duplicate);
+  Status ExternalizeFoldedConstant(NodeDef* node, GraphDef* output_graph);
+  void RecordFoldedConstant(const NodeDef& node);
 
   bool IsOnes(const NodeDef& node) const;
   bool IsZeros(const NodeDef& node) const;
@@ -340,6 +361,13 @@ class ConstantFolding : public GraphOptimizer {
   bool graph_contains_assign_or_inplace_op_;
   bool disable_compressed_tensor_optimization_;
   bool fold_quantization_emulation_;
+
+  ConstantFoldingOptions options_;
+  // Total size of the constants inlined by the current run.
+  int64_t folded_bytes_;
+  // Names of the constants folded by the current FoldGraph call, keyed by a
+  // fingerprint of their value.
+  absl::flat_hash_map<uint64, std::vector<string>> folded_constants_;
 };
 
 }  // end namespace grappler
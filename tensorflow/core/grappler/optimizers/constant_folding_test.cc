@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
 
+#include "absl/strings/match.h"
 #include "tensorflow/cc/ops/array_ops.h"
 #include "tensorflow/cc/ops/array_ops_internal.h"
 #include "tensorflow/cc/ops/standard_ops.h"
@@ -28,6 +29,8 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/tensor_coding.h"
 
 namespace tensorflow {
@@ -4410,6 +4413,134 @@ TEST_F(ConstantFoldingTest, QuantizationEmulation) {
   }
 }
 
+// Builds foldable nodes c0 = Add(a, b), c1 = Add(a, b) and c2 = Mul(a, b) over
+// [8, 8] float constants, and non foldable d<i> = Mul(c<i>, x).
+GrapplerItem MakeBudgetedFoldingItem() {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  // Distinct values, so that the folded constants can't be compressed.
+  std::vector<float> a_values(64);
+  std::iota(a_values.begin(), a_values.end(), 0.0f);
+  Output a = ops::Const(s.WithOpName("a"),
+                        test::AsTensor<float>(a_values, TensorShape({8, 8})));
+  Output b = ops::Const(s.WithOpName("b"),
+                        test::AsTensor<float>(std::vector<float>(64, 2.0f),
+                                              TensorShape({8, 8})));
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape(TensorShape({8, 8})));
+  Output c0 = ops::Add(s.WithOpName("c0"), a, b);
+  Output c1 = ops::Add(s.WithOpName("c1"), a, b);
+  Output c2 = ops::Mul(s.WithOpName("c2"), a, b);
+  ops::Mul(s.WithOpName("d0"), c0, x);
+  ops::Mul(s.WithOpName("d1"), c1, x);
+  ops::Mul(s.WithOpName("d2"), c2, x);
+
+  GrapplerItem item;
+  item.fetch = {"d0", "d1", "d2"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  return item;
+}
+
+TEST_F(ConstantFoldingTest, BudgetedFolding_MemoryBudget) {
+  const GrapplerItem item = MakeBudgetedFoldingItem();
+  for (const int64_t budget : {512, 1 << 20}) {
+    ConstantFoldingOptions options;
+    options.set_memory_budget_bytes(budget);
+    ConstantFolding optimizer(/*cpu_device=*/nullptr,
+                              /*disable_compressed_tensor_optimization=*/false,
+                              /*fold_quantization_emulation=*/true, options);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+    // Evaluating c0 needs 3 * 256 bytes.
+    for (const NodeDef& node : output.node()) {
+      if (node.name() == "c0") {
+        EXPECT_EQ(node.op(), budget == 512 ? "Add" : "Const");
+      }
+    }
+  }
+}
+
+TEST_F(ConstantFoldingTest, BudgetedFolding_ParallelDeduplication) {
+  const GrapplerItem item = MakeBudgetedFoldingItem();
+  ConstantFoldingOptions options;
+  options.set_num_threads(4);
+  options.set_deduplicate_constants(true);
+  ConstantFolding optimizer(/*cpu_device=*/nullptr,
+                            /*disable_compressed_tensor_optimization=*/false,
+                            /*fold_quantization_emulation=*/true, options);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  ASSERT_NE(node_map.GetNode("c0"), nullptr);
+  EXPECT_EQ(node_map.GetNode("c0")->op(), "Const");
+  EXPECT_EQ(node_map.GetNode("c1"), nullptr);
+  EXPECT_EQ(node_map.GetNode("c2")->op(), "Const");
+  EXPECT_EQ(node_map.GetNode("d1")->input(0), "c0");
+
+  const Tensor x = GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 8}));
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, {{"x", x}});
+  auto tensors = EvaluateNodes(output, item.fetch, {{"x", x}});
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorEqual<float>(tensors_expected[i], tensors[i]);
+  }
+}
+
+TEST_F(ConstantFoldingTest, BudgetedFolding_MaxFoldedBytes) {
+  const GrapplerItem item = MakeBudgetedFoldingItem();
+  ConstantFoldingOptions options;
+  // Only one of the 64 element constants fits.
+  options.set_max_folded_bytes(400);
+  ConstantFolding optimizer(/*cpu_device=*/nullptr,
+                            /*disable_compressed_tensor_optimization=*/false,
+                            /*fold_quantization_emulation=*/true, options);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  int num_folded = 0;
+  for (const NodeDef& node : output.node()) {
+    if (absl::StartsWith(node.name(), "c") && node.op() == "Const") {
+      ++num_folded;
+    }
+  }
+  EXPECT_EQ(num_folded, 1);
+}
+
+TEST_F(ConstantFoldingTest, BudgetedFolding_ExternalConstants) {
+  const GrapplerItem item = MakeBudgetedFoldingItem();
+  const string directory =
+      io::JoinPath(testing::TmpDir(), "external_folded_constants");
+  ConstantFoldingOptions options;
+  options.set_external_directory(directory);
+  options.set_external_threshold_bytes(64);
+  ConstantFolding optimizer(/*cpu_device=*/nullptr,
+                            /*disable_compressed_tensor_optimization=*/false,
+                            /*fold_quantization_emulation=*/true, options);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  for (const char* name : {"c0", "c1", "c2"}) {
+    const NodeDef* node = node_map.GetNode(name);
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->op(), "EnsureShape");
+    EXPECT_EQ(node->input(0),
+              strings::StrCat("ConstantFolding/", name, "/external_parse"));
+  }
+  // c0 and c1 share the same file.
+  std::vector<string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &files));
+  EXPECT_EQ(files.size(), 2);
+
+  const Tensor x = GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 8}));
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, {{"x", x}});
+  auto tensors = EvaluateNodes(output, item.fetch, {{"x", x}});
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorEqual<float>(tensors_expected[i], tensors[i]);
+  }
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -73,6 +73,7 @@ const ConfigList& DefaultPluginConfigs() {
                       {"dependency_optimization", RewriterConfig::ON},
                       {"auto_parallel", RewriterConfig::ON},
                       {"memory_optimization", RewriterConfig::ON},
+                      {"horizontal_batching", RewriterConfig::ON},
                       {"scoped_allocator_optimization", RewriterConfig::ON}});
   return *default_plugin_configs;
 }
@@ -0,0 +1,328 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/decode_crop_and_resize_fusion.h"
+
+#include <array>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kConst[] = "Const";
+constexpr char kDecodeJpeg[] = "DecodeJpeg";
+constexpr char kDecodeAndCropJpeg[] = "DecodeAndCropJpeg";
+constexpr char kDecodeCropAndResizeJpeg[] = "DecodeCropAndResizeJpeg";
+constexpr char kExpandDims[] = "ExpandDims";
+constexpr char kResizeBilinear[] = "ResizeBilinear";
+constexpr char kSlice[] = "Slice";
+constexpr char kSqueeze[] = "Squeeze";
+
+// Attributes shared by the JPEG decoding ops, other than `ratio`.
+constexpr std::array<const char*, 5> kDecodeJpegAttrs = {
+    "channels", "fancy_upscaling", "try_recover_truncated",
+    "acceptable_fraction", "dct_method"};
+
+// Returns the values of the given integer `Const` node, or an empty vector if
+// the node is not an integer `Const` node.
+std::vector<int64_t> GetConstIntValues(const NodeDef& node) {
+  std::vector<int64_t> result;
+  if (node.op() != kConst) return result;
+  Tensor tensor;
+  if (!tensor.FromProto(node.attr().at("value").tensor())) return result;
+  if (tensor.dtype() == DT_INT32) {
+    for (int i = 0; i < tensor.NumElements(); ++i) {
+      result.push_back(tensor.flat<int32>()(i));
+    }
+  } else if (tensor.dtype() == DT_INT64) {
+    for (int i = 0; i < tensor.NumElements(); ++i) {
+      result.push_back(tensor.flat<int64_t>()(i));
+    }
+  }
+  return result;
+}
+
+NodeDef* AddInt32VectorConstNode(const std::vector<int32>& values,
+                                 MutableGraphView* graph) {
+  Tensor tensor(DT_INT32, TensorShape({static_cast<int64_t>(values.size())}));
+  for (int i = 0; i < values.size(); ++i) {
+    tensor.flat<int32>()(i) = values[i];
+  }
+  AttrValue dtype_attr, value_attr;
+  SetAttrValue(DT_INT32, &dtype_attr);
+  tensor.AsProtoTensorContent(value_attr.mutable_tensor());
+  return graph_utils::AddNode("", kConst, {},
+                              {{"dtype", dtype_attr}, {"value", value_attr}},
+                              graph);
+}
+
+// Returns the node producing the `index`-th input of `node` if the input is
+// the first output of a node with the given op type, and nullptr otherwise.
+NodeDef* GetInputNodeWithOp(const NodeDef& node, int index, StringPiece op,
+                            const MutableGraphView& graph) {
+  if (node.input_size() <= index) return nullptr;
+  const TensorId input = ParseTensorName(node.input(index));
+  if (input.index() != 0) return nullptr;
+  NodeDef* input_node = graph.GetNode(input.node());
+  if (input_node == nullptr || input_node->op() != op) return nullptr;
+  return input_node;
+}
+
+// Returns true if `node` has exactly one consumer.
+bool HasSingleConsumer(const NodeDef& node, const MutableGraphView& graph) {
+  return graph.GetFanouts(node, /*include_controlling_edges=*/true).size() ==
+         1;
+}
+
+void CopyDecodeAttrs(const NodeDef& from, NodeDef* to) {
+  for (const char* attr : kDecodeJpegAttrs) {
+    if (from.attr().contains(attr)) {
+      graph_utils::CopyAttribute(attr, from, to);
+    }
+  }
+}
+
+int64_t GetIntAttr(const NodeDef& node, const string& name,
+                   int64_t default_value) {
+  const AttrValue* attr = gtl::FindOrNull(node.attr(), name);
+  return attr ? attr->i() : default_value;
+}
+
+bool DecodesAtFullScale(const NodeDef& decode) {
+  return GetIntAttr(decode, "ratio", /*default_value=*/1) == 1;
+}
+
+// Matches `Slice(DecodeJpeg(contents), begin, size)` where `size` is a
+// constant `[height, width, channels]` covering all the decoded channels, and
+// returns the `DecodeJpeg` node.
+NodeDef* MatchDecodeAndSlice(const NodeDef& slice,
+                             const MutableGraphView& graph,
+                             std::vector<int64_t>* size) {
+  if (slice.op() != kSlice) return nullptr;
+  NodeDef* decode = GetInputNodeWithOp(slice, 0, kDecodeJpeg, graph);
+  if (!decode || !DecodesAtFullScale(*decode) ||
+      !HasSingleConsumer(*decode, graph)) {
+    return nullptr;
+  }
+  // The number of decoded channels needs to be known for `Slice` to provably
+  // start at the first channel.
+  const int64_t channels =
+      GetIntAttr(*decode, "channels", /*default_value=*/0);
+  if (channels == 0) return nullptr;
+  NodeDef* size_node = graph_utils::GetInputNode(slice, graph, 2);
+  if (!size_node) return nullptr;
+  *size = GetConstIntValues(*size_node);
+  if (size->size() != 3 || (*size)[0] <= 0 || (*size)[1] <= 0 ||
+      (*size)[2] != channels) {
+    return nullptr;
+  }
+  return decode;
+}
+
+// Matches `Squeeze(ResizeBilinear(ExpandDims(DecodeAndCropJpeg(contents,
+// crop_window), 0), size), [0])`, which is what `tf.image.resize` produces for
+// a single image, and returns the nodes of the pattern.
+bool MatchDecodeCropAndResize(const NodeDef& squeeze,
+                              const MutableGraphView& graph,
+                              std::vector<NodeDef*>* pattern) {
+  if (squeeze.op() != kSqueeze) return false;
+  const AttrValue* squeeze_dims =
+      gtl::FindOrNull(squeeze.attr(), "squeeze_dims");
+  if (!squeeze_dims || squeeze_dims->list().i_size() != 1 ||
+      squeeze_dims->list().i(0) != 0) {
+    return false;
+  }
+  NodeDef* resize = GetInputNodeWithOp(squeeze, 0, kResizeBilinear, graph);
+  if (!resize || resize->attr().at("T").type() != DT_UINT8 ||
+      !HasSingleConsumer(*resize, graph)) {
+    return false;
+  }
+  NodeDef* expand_dims = GetInputNodeWithOp(*resize, 0, kExpandDims, graph);
+  if (!expand_dims || !HasSingleConsumer(*expand_dims, graph)) return false;
+  NodeDef* axis = graph_utils::GetInputNode(*expand_dims, graph, 1);
+  if (!axis || GetConstIntValues(*axis) != std::vector<int64_t>({0})) {
+    return false;
+  }
+  NodeDef* decode =
+      GetInputNodeWithOp(*expand_dims, 0, kDecodeAndCropJpeg, graph);
+  if (!decode || !DecodesAtFullScale(*decode) ||
+      !HasSingleConsumer(*decode, graph)) {
+    return false;
+  }
+  *pattern = {decode, expand_dims, resize};
+  return true;
+}
+
+// Returns true if the matched nodes can be removed from the graph. Control
+// dependencies of the matched nodes would be lost by the rewrite, so patterns
+// with control inputs are not rewritten.
+bool CanRemove(const std::vector<const NodeDef*>& nodes,
+               const std::unordered_set<string>& nodes_to_preserve) {
+  for (const NodeDef* node : nodes) {
+    if (nodes_to_preserve.count(node->name()) || HasControlInputs(*node)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Replaces `Slice(DecodeJpeg(contents), begin, size)` with
+// `DecodeAndCropJpeg(contents, concat(begin[:2], size[:2]))`.
+Status FuseDecodeAndSlice(const NodeDef& slice, const NodeDef& decode,
+                          const std::vector<int64_t>& size,
+                          MutableGraphView* graph) {
+  AttrValue int32_attr;
+  SetAttrValue(DT_INT32, &int32_attr);
+
+  string begin = slice.input(1);
+  if (slice.attr().at("Index").type() == DT_INT64) {
+    AttrValue int64_attr;
+    SetAttrValue(DT_INT64, &int64_attr);
+    begin = graph_utils::AddNode("", "Cast", {begin},
+                                 {{"SrcT", int64_attr},
+                                  {"DstT", int32_attr},
+                                  {"Truncate", AttrValue()}},
+                                 graph)
+                ->name();
+  }
+  NodeDef* offset = graph_utils::AddNode(
+      "", kSlice,
+      {begin, AddInt32VectorConstNode({0}, graph)->name(),
+       AddInt32VectorConstNode({2}, graph)->name()},
+      {{"T", int32_attr}, {"Index", int32_attr}}, graph);
+  NodeDef* crop_size = AddInt32VectorConstNode(
+      {static_cast<int32>(size[0]), static_cast<int32>(size[1])}, graph);
+  AttrValue n_attr;
+  SetAttrValue(2, &n_attr);
+  NodeDef* crop_window = graph_utils::AddNode(
+      "", "ConcatV2",
+      {offset->name(), crop_size->name(),
+       graph_utils::AddScalarConstNode<int32>(0, graph)->name()},
+      {{"N", n_attr}, {"T", int32_attr}, {"Tidx", int32_attr}}, graph);
+
+  NodeDef decode_and_crop;
+  graph_utils::SetUniqueGraphNodeName(kDecodeAndCropJpeg, graph->graph(),
+                                      &decode_and_crop);
+  decode_and_crop.set_op(kDecodeAndCropJpeg);
+  decode_and_crop.set_device(decode.device());
+  decode_and_crop.add_input(decode.input(0));
+  decode_and_crop.add_input(crop_window->name());
+  CopyDecodeAttrs(decode, &decode_and_crop);
+  graph_utils::CopyAttribute("ratio", decode, &decode_and_crop);
+  NodeDef* new_node = graph->AddNode(std::move(decode_and_crop));
+  return graph->UpdateFanouts(slice.name(), new_node->name());
+}
+
+// Replaces the matched `tf.image.resize` of a `DecodeAndCropJpeg` result with
+// `DecodeCropAndResizeJpeg(contents, crop_window, size)`.
+Status FuseDecodeCropAndResize(const NodeDef& squeeze, const NodeDef& decode,
+                               const NodeDef& resize, MutableGraphView* graph) {
+  NodeDef fused;
+  graph_utils::SetUniqueGraphNodeName(kDecodeCropAndResizeJpeg, graph->graph(),
+                                      &fused);
+  fused.set_op(kDecodeCropAndResizeJpeg);
+  fused.set_device(decode.device());
+  fused.add_input(decode.input(0));
+  fused.add_input(decode.input(1));
+  fused.add_input(resize.input(1));
+  CopyDecodeAttrs(decode, &fused);
+  for (const char* attr : {"align_corners", "half_pixel_centers"}) {
+    if (resize.attr().contains(attr)) {
+      graph_utils::CopyAttribute(attr, resize, &fused);
+    }
+  }
+  NodeDef* new_node = graph->AddNode(std::move(fused));
+  return graph->UpdateFanouts(squeeze.name(), new_node->name());
+}
+
+}  // namespace
+
+Status DecodeCropAndResizeFusion::OptimizeAndCollectStats(
+    Cluster* cluster, const GrapplerItem& item, GraphDef* output,
+    OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  absl::flat_hash_set<string> nodes_to_delete;
+
+  // Rewrites the nodes of the original graph that match `match`. The nodes are
+  // looked up by name, since rewriting adds nodes to `output`.
+  auto rewrite = [&](const std::function<Status(const NodeDef&)>& match) {
+    std::vector<string> names;
+    for (const NodeDef& node : output->node()) {
+      names.push_back(node.name());
+    }
+    for (const string& name : names) {
+      const NodeDef* node = graph.GetNode(name);
+      if (node == nullptr || nodes_to_delete.contains(name)) continue;
+      TF_RETURN_IF_ERROR(match(*node));
+    }
+    return OkStatus();
+  };
+
+  TF_RETURN_IF_ERROR(rewrite([&](const NodeDef& node) -> Status {
+    std::vector<int64_t> size;
+    NodeDef* decode = MatchDecodeAndSlice(node, graph, &size);
+    if (!decode || !CanRemove({decode, &node}, nodes_to_preserve)) {
+      return OkStatus();
+    }
+    TF_RETURN_IF_ERROR(FuseDecodeAndSlice(node, *decode, size, &graph));
+    nodes_to_delete.insert(node.name());
+    nodes_to_delete.insert(decode->name());
+    stats->num_changes++;
+    return OkStatus();
+  }));
+
+  TF_RETURN_IF_ERROR(rewrite([&](const NodeDef& node) -> Status {
+    std::vector<NodeDef*> pattern;
+    if (!MatchDecodeCropAndResize(node, graph, &pattern)) return OkStatus();
+    std::vector<const NodeDef*> nodes(pattern.begin(), pattern.end());
+    nodes.push_back(&node);
+    if (!CanRemove(nodes, nodes_to_preserve)) return OkStatus();
+    TF_RETURN_IF_ERROR(
+        FuseDecodeCropAndResize(node, *pattern[0], *pattern[2], &graph));
+    for (const NodeDef* pattern_node : nodes) {
+      nodes_to_delete.insert(pattern_node->name());
+    }
+    stats->num_changes++;
+    return OkStatus();
+  }));
+
+  TF_RETURN_IF_ERROR(graph.DeleteNodes(nodes_to_delete));
+  return OkStatus();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(DecodeCropAndResizeFusion,
+                            kDecodeCropAndResizeFusion);
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,62 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_CROP_AND_RESIZE_FUSION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_CROP_AND_RESIZE_FUSION_H_
+
+#include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+
+namespace tensorflow {
+namespace grappler {
+
+constexpr char kDecodeCropAndResizeFusion[] = "decode_crop_and_resize_fusion";
+
+// This optimization fuses JPEG decoding with the cropping and resizing of the
+// decoded image in the functions of tf.data transformations:
+//
+// - `Slice(DecodeJpeg(contents), begin, size)` that keeps all channels, e.g.
+//   as produced by `tf.image.random_crop`, is replaced with
+//   `DecodeAndCropJpeg(contents, crop_window)`, which only decodes the crop
+//   window.
+// - `tf.image.resize` of the result, i.e. `Squeeze(ResizeBilinear(ExpandDims(
+//   DecodeAndCropJpeg(contents, crop_window)), size))`, is replaced with
+//   `DecodeCropAndResizeJpeg(contents, crop_window, size)`, which decodes the
+//   crop window at the smallest sufficient DCT scale.
+//
+// Decoding at a reduced scale changes the values of the resized image, so the
+// optimization is only applied when explicitly enabled.
+class DecodeCropAndResizeFusion : public TFDataOptimizerBase {
+ public:
+  DecodeCropAndResizeFusion() = default;
+  ~DecodeCropAndResizeFusion() override = default;
+
+  string name() const override { return kDecodeCropAndResizeFusion; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return OkStatus();
+  }
+
+  Status OptimizeAndCollectStats(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* output,
+                                 OptimizationStats* stats) override;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_DECODE_CROP_AND_RESIZE_FUSION_H_
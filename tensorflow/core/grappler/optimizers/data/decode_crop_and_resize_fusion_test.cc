@@ -0,0 +1,162 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/decode_crop_and_resize_fusion.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+Status OptimizeWithDecodeCropAndResizeFusion(const GrapplerItem& item,
+                                             GraphDef* output) {
+  DecodeCropAndResizeFusion optimizer;
+  return optimizer.Optimize(nullptr, item, output);
+}
+
+// Returns the nodes of `decode_jpeg -> random_crop -> resize`, with the output
+// of the pipeline in the "output" node.
+std::vector<NodeDef> MakeDecodeCropAndResizeNodes(int channels) {
+  return {
+      NDef("contents", "Placeholder", {}, {{"dtype", DT_STRING}}),
+      NDef("decode", "DecodeJpeg", {"contents"}, {{"channels", channels}}),
+      NDef("begin", "Placeholder", {}, {{"dtype", DT_INT32}}),
+      NDef("crop_size", "Const", {},
+           {{"value", test::AsTensor<int32>({10, 20, 3})},
+            {"dtype", DT_INT32}}),
+      NDef("crop", "Slice", {"decode", "begin", "crop_size"},
+           {{"T", DT_UINT8}, {"Index", DT_INT32}}),
+      NDef("axis", "Const", {},
+           {{"value", test::AsScalar<int32>(0)}, {"dtype", DT_INT32}}),
+      NDef("expand_dims", "ExpandDims", {"crop", "axis"},
+           {{"T", DT_UINT8}, {"Tdim", DT_INT32}}),
+      NDef("size", "Const", {},
+           {{"value", test::AsTensor<int32>({5, 5})}, {"dtype", DT_INT32}}),
+      NDef("resize", "ResizeBilinear", {"expand_dims", "size"},
+           {{"T", DT_UINT8},
+            {"align_corners", false},
+            {"half_pixel_centers", true}}),
+      NDef("squeeze", "Squeeze", {"resize"},
+           {{"T", DT_FLOAT}, {"squeeze_dims", gtl::ArraySlice<int>({0})}}),
+      NDef("output", "Identity", {"squeeze"}, {{"T", DT_FLOAT}})};
+}
+
+TEST(DecodeCropAndResizeFusionTest, FuseDecodeCropAndResize) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(MakeDecodeCropAndResizeNodes(3), {});
+  item.fetch.push_back("output");
+
+  GraphDef output;
+  TF_ASSERT_OK(OptimizeWithDecodeCropAndResizeFusion(item, &output));
+  for (const char* op :
+       {"DecodeJpeg", "DecodeAndCropJpeg", "ExpandDims", "ResizeBilinear",
+        "Squeeze"}) {
+    EXPECT_FALSE(graph_utils::ContainsNodeWithOp(op, output)) << op;
+  }
+  ASSERT_TRUE(
+      graph_utils::ContainsNodeWithOp("DecodeCropAndResizeJpeg", output));
+  const NodeDef& fused = output.node(
+      graph_utils::FindGraphNodeWithOp("DecodeCropAndResizeJpeg", output));
+  ASSERT_EQ(fused.input_size(), 3);
+  EXPECT_EQ(fused.input(0), "contents");
+  EXPECT_EQ(fused.input(2), "size");
+  EXPECT_EQ(fused.attr().at("channels").i(), 3);
+  EXPECT_TRUE(fused.attr().at("half_pixel_centers").b());
+
+  // The crop window is `[begin[0], begin[1], 10, 20]`.
+  const NodeDef& crop_window = output.node(
+      graph_utils::FindGraphNodeWithName(fused.input(1), output));
+  EXPECT_EQ(crop_window.op(), "ConcatV2");
+  const NodeDef& offset = output.node(
+      graph_utils::FindGraphNodeWithName(crop_window.input(0), output));
+  EXPECT_EQ(offset.op(), "Slice");
+  EXPECT_EQ(offset.input(0), "begin");
+
+  const NodeDef& sink = output.node(
+      graph_utils::FindGraphNodeWithName("output", output));
+  EXPECT_EQ(sink.input(0), fused.name());
+}
+
+TEST(DecodeCropAndResizeFusionTest, FuseDecodeAndCrop) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("contents", "Placeholder", {}, {{"dtype", DT_STRING}}),
+       NDef("decode", "DecodeJpeg", {"contents"}, {{"channels", 3}}),
+       NDef("begin", "Placeholder", {}, {{"dtype", DT_INT32}}),
+       NDef("crop_size", "Const", {},
+            {{"value", test::AsTensor<int32>({10, 20, 3})},
+             {"dtype", DT_INT32}}),
+       NDef("crop", "Slice", {"decode", "begin", "crop_size"},
+            {{"T", DT_UINT8}, {"Index", DT_INT32}}),
+       NDef("output", "Identity", {"crop"}, {{"T", DT_UINT8}})},
+      {});
+  item.fetch.push_back("output");
+
+  GraphDef output;
+  TF_ASSERT_OK(OptimizeWithDecodeCropAndResizeFusion(item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("DecodeJpeg", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("crop", output));
+  ASSERT_TRUE(graph_utils::ContainsNodeWithOp("DecodeAndCropJpeg", output));
+  const NodeDef& decode_and_crop = output.node(
+      graph_utils::FindGraphNodeWithOp("DecodeAndCropJpeg", output));
+  EXPECT_EQ(decode_and_crop.input(0), "contents");
+  const NodeDef& sink = output.node(
+      graph_utils::FindGraphNodeWithName("output", output));
+  EXPECT_EQ(sink.input(0), decode_and_crop.name());
+}
+
+TEST(DecodeCropAndResizeFusionTest, UnknownChannels) {
+  // Without a known number of channels, the slice may not start at the first
+  // channel, so nothing is fused.
+  GrapplerItem item;
+  item.graph = test::function::GDef(MakeDecodeCropAndResizeNodes(0), {});
+  item.fetch.push_back("output");
+
+  GraphDef output;
+  TF_ASSERT_OK(OptimizeWithDecodeCropAndResizeFusion(item, &output));
+  EXPECT_TRUE(graph_utils::ContainsNodeWithOp("DecodeJpeg", output));
+  EXPECT_TRUE(graph_utils::ContainsNodeWithOp("ResizeBilinear", output));
+  EXPECT_FALSE(
+      graph_utils::ContainsNodeWithOp("DecodeCropAndResizeJpeg", output));
+}
+
+TEST(DecodeCropAndResizeFusionTest, DecodedImageUsedElsewhere) {
+  // Fusing would decode the image twice when the decoded image has other
+  // consumers.
+  GrapplerItem item;
+  std::vector<NodeDef> nodes = MakeDecodeCropAndResizeNodes(3);
+  nodes.push_back(NDef("other", "Identity", {"decode"}, {{"T", DT_UINT8}}));
+  item.graph = test::function::GDef(nodes, {});
+  item.fetch = {"output", "other"};
+
+  GraphDef output;
+  TF_ASSERT_OK(OptimizeWithDecodeCropAndResizeFusion(item, &output));
+  EXPECT_TRUE(graph_utils::ContainsNodeWithOp("DecodeJpeg", output));
+  EXPECT_TRUE(graph_utils::ContainsNodeWithOp("ResizeBilinear", output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("DecodeAndCropJpeg", output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
 
+#include <algorithm>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
@@ -29,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer_transposer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer_transposer_factory.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -37,6 +40,7 @@ namespace {
 
 constexpr char kNHWC[] = "NHWC";
 constexpr char kNCHW[] = "NCHW";
+constexpr char kDataFormat[] = "data_format";
 constexpr float kVoltaGPURatioThreshold = 0.5;
 constexpr float kConvGPUFP16Threshold = 0.5;
 
@@ -386,6 +390,88 @@ Status EraseCancellableNodesAroundPad(TransposeContext* context) {
   return mutation->Apply();
 }
 
+// Returns the size of a tensor in bytes, or -1 if it is not fully defined.
+int64_t TensorBytes(const TensorShapeProto& shape_proto, DataType dtype) {
+  const PartialTensorShape shape(shape_proto);
+  if (!shape.IsFullyDefined()) return -1;
+  return shape.num_elements() * DataTypeSize(dtype);
+}
+
+int64_t TensorBytes(const OpInfo::TensorProperties& properties) {
+  return TensorBytes(properties.shape(), properties.dtype());
+}
+
+// Returns the size in bytes of the output of a transpose inserted by the
+// transposers, which record it in the output shape attribute, or -1 if it is
+// unknown.
+int64_t InsertedTransposeBytes(const utils::MutableNodeView& node) {
+  const auto* shape_attr = node.GetAttr(kAttrOutputShape);
+  const auto* dtype_attr = node.GetAttr("T");
+  if (shape_attr == nullptr || dtype_attr == nullptr ||
+      shape_attr->list().shape_size() != 1) {
+    return -1;
+  }
+  return TensorBytes(shape_attr->list().shape(0), dtype_attr->type());
+}
+
+// On CPU, transposes are bound by memory bandwidth and cost about as much as
+// reading their input. Converting a graph is only profitable if every transpose
+// inserted by the conversion and left after cancellation, at chain boundaries
+// and around layout agnostic ops alike, reads less data than the layout
+// sensitive ops which now run in the destination format. If some of the sizes
+// are unknown, the conversion must insert fewer transposes than it converts
+// ops.
+bool IsCpuLayoutConversionProfitable(const TransposeContext& context,
+                                     const GraphDef& original_graph) {
+  absl::flat_hash_map<absl::string_view, absl::string_view> original_formats;
+  for (const NodeDef& node : original_graph.node()) {
+    const auto data_format = node.attr().find(kDataFormat);
+    if (data_format != node.attr().end()) {
+      original_formats.emplace(node.name(), data_format->second.s());
+    }
+  }
+
+  const GraphProperties& properties = *context.graph_properties;
+  int64_t transpose_bytes = 0;
+  int64_t converted_bytes = 0;
+  int num_transposes = 0;
+  int num_converted = 0;
+  bool known_bytes = true;
+  const int num_nodes = context.graph_view->NumNodes();
+  for (int i = 0; i < num_nodes; ++i) {
+    const auto* node = context.graph_view->GetNode(i);
+    int64_t bytes = -1;
+    if (i >= context.num_nodes && IsTranspose(*node->node())) {
+      ++num_transposes;
+      bytes = InsertedTransposeBytes(*node);
+      transpose_bytes += std::max<int64_t>(bytes, 0);
+    } else if (i < context.num_nodes && IsLayoutSensitiveOp(*node->node())) {
+      const auto* data_format = node->GetAttr(kDataFormat);
+      const auto original_format = original_formats.find(node->GetName());
+      if (data_format == nullptr || original_format == original_formats.end() ||
+          data_format->s() == original_format->second) {
+        continue;
+      }
+      ++num_converted;
+      const auto& input_props = properties.GetInputProperties(node->GetName());
+      if (!input_props.empty()) {
+        bytes = TensorBytes(input_props[0]);
+      }
+      converted_bytes += std::max<int64_t>(bytes, 0);
+    } else {
+      continue;
+    }
+    known_bytes &= bytes >= 0;
+  }
+
+  VLOG(2) << "CPU layout conversion: " << num_converted
+          << " converted layout sensitive ops reading " << converted_bytes
+          << " bytes, " << num_transposes << " transposes reading "
+          << transpose_bytes << " bytes";
+  if (!known_bytes) return num_transposes < num_converted;
+  return transpose_bytes <= converted_bytes;
+}
+
 Status EraseOutputShapeAttrs(TransposeContext* context) {
   utils::MutableGraphView* graph_view = context->graph_view.get();
   utils::Mutation* mutation = graph_view->GetMutationBuilder();
@@ -406,7 +492,10 @@ Status EraseOutputShapeAttrs(TransposeContext* context) {
 // When there is a GPU, the computation graph is converted to NCHW format.
 // When there is only CPU, there will be no conversion by default, unless user
 // chose to convert the graph to a desired format. Currently, NCHW -> NHWC
-// format conversion is available on CPU.
+// format conversion is available on CPU, and NHWC -> NCHW when oneDNN is
+// enabled since its kernels natively support NCHW. The oneDNN blocked formats
+// block the channels of NCHW tensors, so the kernels reorder NCHW inputs to
+// them without a full transposition.
 Status GenericLayoutOptimizer::Optimize(Cluster* cluster,
                                         const GrapplerItem& item,
                                         GraphDef* output) {
@@ -429,6 +518,9 @@ Status GenericLayoutOptimizer::Optimize(Cluster* cluster,
 
   TransposeContext context;
   context.enforced_layout = enforced_layout_;
+  // Only the conversions to the oneDNN native format are costed, conversions
+  // explicitly requested otherwise are always applied.
+  bool check_conversion_cost = false;
 
   if (num_gpus > 0) {
     TF_RETURN_IF_ERROR(TransposeContext::InitializeTransposeContext(
@@ -445,12 +537,15 @@ Status GenericLayoutOptimizer::Optimize(Cluster* cluster,
       case RewriterConfig::NCHW_TO_NHWC:
         context.AssignDeviceAndDataFormats(kCPU, kNCHW, kNHWC);
         break;
-      // TODO(intel-tf): Add functionality for NHWC_TO_NCHW layout conversion on
-      // CPU.
       case RewriterConfig::NHWC_TO_NCHW:
-        return errors::Aborted(
-            "Conversion from NHWC to NCHW is currently not  available for "
-            "CPU.");
+        if (!IsMKLEnabled()) {
+          return errors::Aborted(
+              "Conversion from NHWC to NCHW is only available for CPU when "
+              "oneDNN is enabled.");
+        }
+        context.AssignDeviceAndDataFormats(kCPU, kNHWC, kNCHW);
+        check_conversion_cost = true;
+        break;
       default:
         *output = item.graph;
         VLOG(2) << "No layout conversion will take place for CPU.";
@@ -464,6 +559,14 @@ Status GenericLayoutOptimizer::Optimize(Cluster* cluster,
     TF_RETURN_IF_ERROR(ExpandLayoutAgnosticOp(&context, &transposer_factory));
     TF_RETURN_IF_ERROR(EraseCancellableNodes(&context));
     TF_RETURN_IF_ERROR(EraseCancellableNodesAroundPad(&context));
+    if (check_conversion_cost &&
+        !IsCpuLayoutConversionProfitable(context, item.graph)) {
+      VLOG(1) << "Skipping CPU layout conversion from " << context.src_format
+              << " to " << context.dst_format
+              << ": the boundary transposes cost more than they save.";
+      *output = item.graph;
+      return OkStatus();
+    }
     // TODO(lyandy): Remove sorting once other optimizers are migrated to using
     // `utils::GraphView`.
     TF_RETURN_IF_ERROR(
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/cc/ops/array_ops.h"
 #include "tensorflow/cc/ops/const_op.h"
@@ -29,10 +30,12 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/devices.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/utils/graph_view.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -339,6 +342,113 @@ TEST_F(GenericLayoutOptimizerTest, CPUDevice) {
 #endif  // (GOOGLE_CUDA || TENSORFLOW_USE_ROCM)
 }
 
+#if !(GOOGLE_CUDA || TENSORFLOW_USE_ROCM)
+// Builds a chain of `num_convs` NHWC convolutions preserving the tensor shape.
+Output NHWCConv2DChain(tensorflow::Scope* s, int num_convs) {
+  Tensor input_data(DT_FLOAT, TensorShape({8, 16, 16, 4}));
+  test::FillIota<float>(&input_data, 1.0f);
+  Output output =
+      ops::Const(s->WithOpName("Input"), Input::Initializer(input_data));
+  Tensor filter_data(DT_FLOAT, TensorShape({3, 3, 4, 4}));
+  test::FillIota<float>(&filter_data, 1.0f);
+  Output filter =
+      ops::Const(s->WithOpName("Filter"), Input::Initializer(filter_data));
+  for (int i = 0; i < num_convs; ++i) {
+    output = ops::Conv2D(
+        s->WithOpName(absl::StrCat("Conv2D_", i)).WithDevice("/CPU:0"), output,
+        filter, {1, 1, 1, 1}, "SAME", ops::Conv2D::Attrs().DataFormat("NHWC"));
+  }
+  return output;
+}
+
+TEST_F(GenericLayoutOptimizerTest, CPUNHWCToNCHWChain) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output chain = NHWCConv2DChain(&s, /*num_convs=*/3);
+  Output fetch = ops::Identity(s.WithOpName("Fetch"), {chain});
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GenericLayoutOptimizer optimizer(RewriterConfig::DEFAULT,
+                                   RewriterConfig::NHWC_TO_NCHW);
+  GraphDef output;
+  const Status status =
+      optimizer.Optimize(virtual_cluster_.get(), item, &output);
+  if (!IsMKLEnabled()) {
+    EXPECT_TRUE(errors::IsAborted(status));
+    return;
+  }
+  TF_ASSERT_OK(status);
+
+  // The whole chain runs in NCHW, with transposes at its boundaries only.
+  Status graph_status;
+  utils::GraphView graph_view(&output, &graph_status);
+  TF_ASSERT_OK(graph_status);
+  for (int i = 0; i < 3; ++i) {
+    auto* conv_node = graph_view.GetNode(absl::StrCat("Conv2D_", i));
+    ASSERT_NE(conv_node, nullptr);
+    VerifyDataFormatAttributeMatch(conv_node, "NCHW");
+  }
+  int num_transposes = 0;
+  for (const NodeDef& node : output.node()) {
+    num_transposes += IsTranspose(node);
+  }
+  EXPECT_EQ(num_transposes, 2);
+}
+
+TEST_F(GenericLayoutOptimizerTest, CPUNHWCToNCHWUnprofitable) {
+  if (!IsMKLEnabled()) GTEST_SKIP() << "Requires oneDNN";
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output chain = NHWCConv2DChain(&s, /*num_convs=*/1);
+  Output fetch = ops::Identity(s.WithOpName("Fetch"), {chain});
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GenericLayoutOptimizer optimizer(RewriterConfig::DEFAULT,
+                                   RewriterConfig::NHWC_TO_NCHW);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(virtual_cluster_.get(), item, &output));
+
+  // Transposing both the input and the output of a single convolution reads
+  // more data than the convolution itself, so the graph is left as is.
+  Status graph_status;
+  utils::GraphView graph_view(&output, &graph_status);
+  TF_ASSERT_OK(graph_status);
+  auto* conv_node = graph_view.GetNode("Conv2D_0");
+  ASSERT_NE(conv_node, nullptr);
+  VerifyDataFormatAttributeMatch(conv_node, "NHWC");
+  EXPECT_EQ(output.node_size(), item.graph.node_size());
+}
+
+TEST_F(GenericLayoutOptimizerTest, CPUNHWCToNCHWSkipsOpsWithoutNCHWKernel) {
+  if (!IsMKLEnabled()) GTEST_SKIP() << "Requires oneDNN";
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output chain = NHWCConv2DChain(&s, /*num_convs=*/3);
+  Output depth_to_space = ops::DepthToSpace(
+      s.WithOpName("DepthToSpace").WithDevice("/CPU:0"), chain, 2);
+  Output fetch = ops::Identity(s.WithOpName("Fetch"), {depth_to_space});
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GenericLayoutOptimizer optimizer(RewriterConfig::DEFAULT,
+                                   RewriterConfig::NHWC_TO_NCHW);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(virtual_cluster_.get(), item, &output));
+
+  // There is no NCHW CPU kernel for DepthToSpace.
+  Status graph_status;
+  utils::GraphView graph_view(&output, &graph_status);
+  TF_ASSERT_OK(graph_status);
+  for (int i = 0; i < 3; ++i) {
+    auto* conv_node = graph_view.GetNode(absl::StrCat("Conv2D_", i));
+    ASSERT_NE(conv_node, nullptr);
+    VerifyDataFormatAttributeMatch(conv_node, "NCHW");
+  }
+  auto* depth_to_space_node = graph_view.GetNode("DepthToSpace");
+  ASSERT_NE(depth_to_space_node, nullptr);
+  VerifyDataFormatAttributeMatch(depth_to_space_node, "NHWC");
+}
+#endif  // !(GOOGLE_CUDA || TENSORFLOW_USE_ROCM)
+
 TEST_F(GenericLayoutOptimizerTest, NoOptimizeIntegerConvolution) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   auto conv = SimpleConv2D<int32>(&s, 4, 2, "VALID", "");
@@ -97,6 +97,29 @@ bool IsNonFloatingConv2D(const utils::MutableNodeView& node) {
   return false;
 }
 
+// Returns true if `node` runs in a channels-first format on CPU, which only
+// the oneDNN kernels of some layout sensitive ops support, for float and
+// bfloat16 only. Other layout sensitive ops, e.g. DepthToSpace and
+// SpaceToDepth, have no NCHW CPU kernel.
+bool IsSupportedChannelsFirstOnCpu(const utils::MutableNodeView& node) {
+  static const auto* const kOneDnnChannelsFirstOps =
+      new absl::flat_hash_set<std::string>(
+          {"AvgPool", "AvgPoolGrad", "Conv2D", "Conv2DBackpropFilter",
+           "Conv2DBackpropInput", "Conv3D", "Conv3DBackpropFilterV2",
+           "Conv3DBackpropInputV2", "DepthwiseConv2dNative",
+           "DepthwiseConv2dNativeBackpropFilter",
+           "DepthwiseConv2dNativeBackpropInput", "FusedBatchNorm",
+           "FusedBatchNormV2", "FusedBatchNormV3", "FusedBatchNormGrad",
+           "FusedBatchNormGradV2", "FusedBatchNormGradV3", "MaxPool",
+           "MaxPoolGrad"});
+  if (!kOneDnnChannelsFirstOps->contains(node.GetOp())) {
+    return false;
+  }
+  const auto* attr = node.GetAttr(kAttrT);
+  return attr != nullptr &&
+         (attr->type() == DT_FLOAT || attr->type() == DT_BFLOAT16);
+}
+
 // Utils for layout agnostic transposer.
 
 bool IsComparisonOp(const NodeDef& node) {
@@ -277,7 +300,14 @@ bool Transposer::ShouldProcess(const TransposeContext& context,
   // Only transposes floating point nodes.
   const bool is_integer_conv2d = IsNonFloatingConv2D(node);
 
+  // On CPU, only converts to channels-first the ops with a kernel for it.
+  const bool is_supported_format =
+      context.target_device != kCPU || !IsLayoutSensitiveOp(*node_def) ||
+      !absl::StartsWith(context.dst_format, "NC") ||
+      IsSupportedChannelsFirstOnCpu(node);
+
   return is_on_target_device && data_format_match && !is_integer_conv2d &&
+         is_supported_format &&
          !context.nodes_to_preserve.contains(node_def->name()) &&
          !(node.NumRegularFanouts() == 0 && node.NumControlledFanouts() == 0);
 }
@@ -0,0 +1,454 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/horizontal_batching.h"
+
+#include <map>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kHorizontalBatching[] = "horizontal_batching";
+
+// MatMuls that don't share an input are only packed into a BatchMatMulV2 when
+// each of them does at most this many multiply-adds: larger ones are already
+// compute bound and the cost of packing their inputs isn't worth it.
+constexpr int64_t kMaxPackedMatMulSize = 64 * 64 * 64;
+
+// Bound on the number of ancestors visited when checking that the members of
+// a group are independent. Members with more ancestors are left alone.
+constexpr int kMaxAncestorsToVisit = 4096;
+
+// Suffixes of the names of the nodes created for a group.
+constexpr const char* kCreatedNodeSuffixes[] = {
+    "weight_axis", "concat", "MatMul",        "Conv2D", "size_splits",
+    "output_axis", "split",  "BatchMatMulV2", "pack_a", "pack_b",
+    "unpack"};
+
+bool IsSupportedType(DataType dtype) {
+  return dtype == DT_HALF || dtype == DT_BFLOAT16 || dtype == DT_FLOAT ||
+         dtype == DT_DOUBLE;
+}
+
+// Returns the dimensions of `properties` if its shape is fully defined and of
+// the given rank, or an empty vector otherwise.
+std::vector<int64_t> StaticShape(const OpInfo::TensorProperties& properties,
+                                 int rank) {
+  const TensorShapeProto& shape = properties.shape();
+  if (shape.unknown_rank() || shape.dim_size() != rank) return {};
+  std::vector<int64_t> dims;
+  for (const auto& dim : shape.dim()) {
+    if (dim.size() < 0) return {};
+    dims.push_back(dim.size());
+  }
+  return dims;
+}
+
+bool GetBoolAttr(const NodeDef& node, const string& name) {
+  const auto it = node.attr().find(name);
+  return it != node.attr().end() && it->second.b();
+}
+
+// Returns a string that is identical for nodes with identical non-internal
+// attributes.
+string AttrSignature(const NodeDef& node) {
+  std::map<string, const AttrValue*> attrs;
+  for (const auto& attr : node.attr()) {
+    if (!absl::StartsWith(attr.first, "_")) {
+      attrs.emplace(attr.first, &attr.second);
+    }
+  }
+  string signature;
+  for (const auto& attr : attrs) {
+    strings::StrAppend(&signature, attr.first, "=",
+                       attr.second->SerializeAsString(), ";");
+  }
+  return signature;
+}
+
+// Returns true if `node` transitively depends on one of `members`, or if this
+// can't be decided within kMaxAncestorsToVisit nodes. Loop back edges are not
+// followed, since they only connect different iterations.
+bool DependsOnAnyOf(const NodeMap& node_map, const NodeDef& node,
+                    const absl::flat_hash_set<const NodeDef*>& members) {
+  absl::flat_hash_set<const NodeDef*> visited;
+  std::vector<const NodeDef*> stack;
+  auto push_fanins = [&](const NodeDef& n) {
+    for (const string& input : n.input()) {
+      const NodeDef* fanin = node_map.GetNode(input);
+      if (fanin != nullptr && !IsNextIteration(*fanin) &&
+          visited.insert(fanin).second) {
+        stack.push_back(fanin);
+      }
+    }
+  };
+  push_fanins(node);
+  while (!stack.empty()) {
+    const NodeDef* ancestor = stack.back();
+    stack.pop_back();
+    if (members.contains(ancestor)) return true;
+    if (visited.size() > kMaxAncestorsToVisit) return true;
+    push_fanins(*ancestor);
+  }
+  return false;
+}
+
+// Removes the members of `group` that depend on another member, so that the
+// remaining ones can be computed by a single node without creating a cycle.
+void RemoveDependentMembers(const NodeMap& node_map,
+                            std::vector<NodeDef*>* group) {
+  const absl::flat_hash_set<const NodeDef*> members(group->begin(),
+                                                    group->end());
+  std::vector<NodeDef*> independent;
+  for (NodeDef* member : *group) {
+    if (!DependsOnAnyOf(node_map, *member, members)) {
+      independent.push_back(member);
+    }
+  }
+  *group = std::move(independent);
+}
+
+class HorizontalBatchingContext {
+ public:
+  HorizontalBatchingContext(const GrapplerItem& item, GraphDef* graph)
+      : nodes_to_preserve_(item.NodesToPreserve()),
+        graph_(graph),
+        node_map_(graph) {}
+
+  const NodeMap& node_map() const { return node_map_; }
+
+  bool IsCandidate(const NodeDef& node) const {
+    if (nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end()) {
+      return false;
+    }
+    if (!IsMatMul(node) && !IsConv2D(node)) return false;
+    if (NumNonControlInputs(node) != 2) return false;
+    return IsSupportedType(GetDataTypeFromAttr(node, "T"));
+  }
+
+  // Returns true if the names of the nodes created for a group whose first
+  // member is `node` are free.
+  bool CanCreateNodesFor(const NodeDef& node) const {
+    const string prefix = GroupPrefix(node);
+    for (const char* suffix : kCreatedNodeSuffixes) {
+      if (node_map_.NodeExists(strings::StrCat(prefix, "/", suffix))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Rewrites members[i] = op(x, w[i]) into
+  //   fused = op(x, ConcatV2(w[0], ..., w[n - 1], weight_axis))
+  //   members[i] = Identity(SplitV(fused, sizes, output_axis):i)
+  void RewriteSharedInputGroup(const std::vector<NodeDef*>& members,
+                               const std::vector<int64_t>& sizes,
+                               int weight_axis, int output_axis) {
+    const NodeDef& first = *members.front();
+    const string prefix = GroupPrefix(first);
+    const string anchor = AsControlDependency(NodeName(first.input(0)));
+    const DataType dtype = GetDataTypeFromAttr(first, "T");
+    const int num_members = members.size();
+
+    NodeDef* weight_axis_node = AddConstNode(
+        strings::StrCat(prefix, "/weight_axis"), first.device(), anchor,
+        Tensor(static_cast<int32>(weight_axis)));
+    NodeDef* concat =
+        AddNode(strings::StrCat(prefix, "/concat"), "ConcatV2", first);
+    for (const NodeDef* member : members) {
+      concat->add_input(member->input(1));
+    }
+    concat->add_input(weight_axis_node->name());
+    SetAttrs(concat, {{"N", num_members}}, dtype);
+    (*concat->mutable_attr())["Tidx"].set_type(DT_INT32);
+
+    NodeDef* fused =
+        AddNode(strings::StrCat(prefix, "/", first.op()), first.op(), first);
+    fused->add_input(first.input(0));
+    fused->add_input(concat->name());
+    for (const auto& attr : first.attr()) {
+      if (!absl::StartsWith(attr.first, "_")) {
+        (*fused->mutable_attr())[attr.first] = attr.second;
+      }
+    }
+    MoveControlInputs(members, fused);
+
+    Tensor size_splits(DT_INT32, TensorShape({num_members}));
+    for (int i = 0; i < num_members; ++i) {
+      size_splits.vec<int32>()(i) = static_cast<int32>(sizes[i]);
+    }
+    NodeDef* sizes_node = AddConstNode(strings::StrCat(prefix, "/size_splits"),
+                                       first.device(), anchor, size_splits);
+    NodeDef* output_axis_node = AddConstNode(
+        strings::StrCat(prefix, "/output_axis"), first.device(), anchor,
+        Tensor(static_cast<int32>(output_axis)));
+    NodeDef* split =
+        AddNode(strings::StrCat(prefix, "/split"), "SplitV", first);
+    split->add_input(fused->name());
+    split->add_input(sizes_node->name());
+    split->add_input(output_axis_node->name());
+    SetAttrs(split, {{"num_split", num_members}}, dtype);
+    (*split->mutable_attr())["Tlen"].set_type(DT_INT32);
+
+    ForwardMembers(members, split->name());
+  }
+
+  // Rewrites members[i] = MatMul(a[i], b[i]) into
+  //   batched = BatchMatMulV2(Pack(a[0], ..., a[n - 1]),
+  //                           Pack(b[0], ..., b[n - 1]))
+  //   members[i] = Identity(Unpack(batched):i)
+  void RewritePackedMatMulGroup(const std::vector<NodeDef*>& members) {
+    const NodeDef& first = *members.front();
+    const string prefix = GroupPrefix(first);
+    const DataType dtype = GetDataTypeFromAttr(first, "T");
+    const int num_members = members.size();
+
+    NodeDef* packed[2];
+    for (int input = 0; input < 2; ++input) {
+      packed[input] = AddNode(
+          strings::StrCat(prefix, input == 0 ? "/pack_a" : "/pack_b"), "Pack",
+          first);
+      for (const NodeDef* member : members) {
+        packed[input]->add_input(member->input(input));
+      }
+      SetAttrs(packed[input], {{"N", num_members}, {"axis", 0}}, dtype);
+    }
+
+    NodeDef* batched = AddNode(strings::StrCat(prefix, "/BatchMatMulV2"),
+                               "BatchMatMulV2", first);
+    batched->add_input(packed[0]->name());
+    batched->add_input(packed[1]->name());
+    SetAttrs(batched, {}, dtype);
+    auto* attr = batched->mutable_attr();
+    (*attr)["adj_x"].set_b(GetBoolAttr(first, "transpose_a"));
+    (*attr)["adj_y"].set_b(GetBoolAttr(first, "transpose_b"));
+    MoveControlInputs(members, batched);
+
+    NodeDef* unpack =
+        AddNode(strings::StrCat(prefix, "/unpack"), "Unpack", first);
+    unpack->add_input(batched->name());
+    SetAttrs(unpack, {{"num", num_members}, {"axis", 0}}, dtype);
+
+    ForwardMembers(members, unpack->name());
+  }
+
+ private:
+  static string GroupPrefix(const NodeDef& node) {
+    return strings::StrCat(node.name(), "/", kHorizontalBatching);
+  }
+
+  NodeDef* AddNode(const string& name, const string& op,
+                   const NodeDef& first_member) {
+    NodeDef* node = graph_->add_node();
+    node->set_name(name);
+    node->set_op(op);
+    node->set_device(first_member.device());
+    node_map_.AddNode(name, node);
+    return node;
+  }
+
+  NodeDef* AddConstNode(const string& name, const string& device,
+                        const string& anchor, const Tensor& value) {
+    NodeDef* node = graph_->add_node();
+    node->set_name(name);
+    node->set_op("Const");
+    node->set_device(device);
+    node->add_input(anchor);
+    auto* attr = node->mutable_attr();
+    (*attr)["dtype"].set_type(value.dtype());
+    value.AsProtoTensorContent((*attr)["value"].mutable_tensor());
+    node_map_.AddNode(name, node);
+    return node;
+  }
+
+  static void SetAttrs(NodeDef* node,
+                       const std::vector<std::pair<string, int>>& int_attrs,
+                       DataType dtype) {
+    auto* attr = node->mutable_attr();
+    for (const auto& int_attr : int_attrs) {
+      (*attr)[int_attr.first].set_i(int_attr.second);
+    }
+    (*attr)["T"].set_type(dtype);
+  }
+
+  // Moves the control inputs of all the members to `fused`, which computes
+  // them from now on.
+  static void MoveControlInputs(const std::vector<NodeDef*>& members,
+                                NodeDef* fused) {
+    absl::flat_hash_set<string> control_inputs;
+    for (const NodeDef* member : members) {
+      for (const string& input : member->input()) {
+        if (IsControlInput(input) && control_inputs.insert(input).second) {
+          fused->add_input(input);
+        }
+      }
+    }
+  }
+
+  // Turns every member into an Identity of its output of `split`, so that
+  // its fanouts are untouched.
+  void ForwardMembers(const std::vector<NodeDef*>& members,
+                      const string& split) {
+    for (int i = 0, end = members.size(); i < end; ++i) {
+      NodeDef* member = members[i];
+      const DataType dtype = GetDataTypeFromAttr(*member, "T");
+      member->set_op("Identity");
+      member->clear_input();
+      member->add_input(strings::StrCat(split, ":", i));
+      member->clear_attr();
+      (*member->mutable_attr())["T"].set_type(dtype);
+    }
+  }
+
+  const std::unordered_set<string> nodes_to_preserve_;
+  GraphDef* graph_;
+  NodeMap node_map_;
+};
+
+}  // namespace
+
+Status HorizontalBatching::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                    GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+
+  HorizontalBatchingContext ctx(item, optimized_graph);
+  std::vector<NodeDef*> candidates;
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    if (ctx.IsCandidate(node)) candidates.push_back(&node);
+  }
+  if (candidates.size() < 2) return errors::Aborted("Nothing to do.");
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(/*assume_valid_feeds=*/false));
+  FrameView frame_view;
+  TF_RETURN_IF_ERROR(frame_view.InferFromGraph(*optimized_graph));
+
+  // Group the nodes that read the same input with the same attributes and
+  // weight shapes, modulo the output dimension. The new Const nodes are
+  // anchored to the shared input, which rules out inputs produced by Switch
+  // nodes.
+  std::map<string, std::vector<NodeDef*>> shared_input_groups;
+  std::map<const NodeDef*, int64_t> output_sizes;
+  for (NodeDef* node : candidates) {
+    const NodeDef* input = ctx.node_map().GetNode(node->input(0));
+    if (input == nullptr || IsSwitch(*input)) continue;
+    const auto& input_props = properties.GetInputProperties(node->name());
+    if (input_props.size() != 2) continue;
+    std::vector<int64_t> weight_shape;
+    if (IsMatMul(*node)) {
+      weight_shape = StaticShape(input_props[1], 2);
+      if (weight_shape.empty()) continue;
+      const bool transpose_b = GetBoolAttr(*node, "transpose_b");
+      output_sizes[node] = weight_shape[transpose_b ? 0 : 1];
+      weight_shape[transpose_b ? 0 : 1] = -1;
+    } else {
+      weight_shape = StaticShape(input_props[1], 4);
+      if (weight_shape.empty()) continue;
+      output_sizes[node] = weight_shape[3];
+      weight_shape[3] = -1;
+    }
+    const string key = strings::StrCat(
+        node->op(), "|", node->input(0), "|", node->device(), "|",
+        AttrSignature(*node), "|", absl::StrJoin(weight_shape, ","));
+    shared_input_groups[key].push_back(node);
+  }
+
+  absl::flat_hash_set<const NodeDef*> rewritten;
+  for (auto& group : shared_input_groups) {
+    std::vector<NodeDef*>& members = group.second;
+    if (members.size() < 2) continue;
+    RemoveDependentMembers(ctx.node_map(), &members);
+    if (members.size() < 2 || !ctx.CanCreateNodesFor(*members.front())) {
+      continue;
+    }
+    std::vector<int64_t> sizes;
+    for (const NodeDef* member : members) {
+      sizes.push_back(output_sizes[member]);
+    }
+    const NodeDef& first = *members.front();
+    int weight_axis;
+    int output_axis;
+    if (IsMatMul(first)) {
+      weight_axis = GetBoolAttr(first, "transpose_b") ? 0 : 1;
+      output_axis = 1;
+    } else {
+      const auto it = first.attr().find("data_format");
+      weight_axis = 3;
+      output_axis =
+          it != first.attr().end() && it->second.s() == "NCHW" ? 1 : 3;
+    }
+    VLOG(2) << "Merging " << members.size() << " " << first.op()
+            << " nodes that read " << first.input(0);
+    ctx.RewriteSharedInputGroup(members, sizes, weight_axis, output_axis);
+    rewritten.insert(members.begin(), members.end());
+  }
+
+  // Group the remaining small MatMuls with identical static shapes. Packing
+  // can't cross frames, so the frames are part of the key.
+  std::map<string, std::vector<NodeDef*>> packed_groups;
+  for (NodeDef* node : candidates) {
+    if (!IsMatMul(*node) || rewritten.contains(node)) continue;
+    const auto& input_props = properties.GetInputProperties(node->name());
+    if (input_props.size() != 2) continue;
+    const std::vector<int64_t> a_shape = StaticShape(input_props[0], 2);
+    const std::vector<int64_t> b_shape = StaticShape(input_props[1], 2);
+    if (a_shape.empty() || b_shape.empty()) continue;
+    // a holds M * K elements, and b holds K * N.
+    const int64_t num_multiply_adds =
+        a_shape[0] * a_shape[1] *
+        b_shape[GetBoolAttr(*node, "transpose_b") ? 0 : 1];
+    if (num_multiply_adds > kMaxPackedMatMulSize) continue;
+    const string key = strings::StrCat(
+        node->device(), "|", AttrSignature(*node), "|",
+        absl::StrJoin(a_shape, ","), "|", absl::StrJoin(b_shape, ","), "|",
+        absl::StrJoin(frame_view.Frames(*node), ","));
+    packed_groups[key].push_back(node);
+  }
+  for (auto& group : packed_groups) {
+    std::vector<NodeDef*>& members = group.second;
+    if (members.size() < 2) continue;
+    RemoveDependentMembers(ctx.node_map(), &members);
+    if (members.size() < 2 || !ctx.CanCreateNodesFor(*members.front())) {
+      continue;
+    }
+    VLOG(2) << "Packing " << members.size() << " MatMul nodes into a "
+            << "BatchMatMulV2";
+    ctx.RewritePackedMatMulGroup(members);
+    rewritten.insert(members.begin(), members.end());
+  }
+
+  if (rewritten.empty()) return errors::Aborted("Nothing to do.");
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
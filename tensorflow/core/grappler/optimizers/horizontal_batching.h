@@ -0,0 +1,51 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_BATCHING_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_BATCHING_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Merges independent sibling MatMul and Conv2D nodes into a single kernel
+// launch:
+//  - MatMuls and Conv2Ds that read the same input are rewritten into one op
+//    over the concatenated weights, followed by a SplitV of its output.
+//  - Small MatMuls with identical static shapes but distinct inputs are
+//    packed into one BatchMatMulV2, followed by an Unpack of its output.
+// Every original node is replaced by an Identity of its slice of the result,
+// so node names and fanouts are unchanged.
+class HorizontalBatching : public GraphOptimizer {
+ public:
+  HorizontalBatching() {}
+  explicit HorizontalBatching(RewriterConfig::Toggle opt_level) {}
+
+  ~HorizontalBatching() override {}
+
+  string name() const override { return "horizontal_batching"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_HORIZONTAL_BATCHING_H_
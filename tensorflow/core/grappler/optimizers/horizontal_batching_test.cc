@@ -0,0 +1,168 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/horizontal_batching.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class HorizontalBatchingTest : public GrapplerTest {
+ protected:
+  int CountOps(const GraphDef& graph, const string& op) {
+    int count = 0;
+    for (const NodeDef& node : graph.node()) {
+      if (node.op() == op) ++count;
+    }
+    return count;
+  }
+
+  void ExpectSameResults(const GrapplerItem& item, const GraphDef& output) {
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+    auto tensors = EvaluateNodes(output, item.fetch);
+    ASSERT_EQ(tensors_expected.size(), tensors.size());
+    for (int i = 0; i < tensors.size(); ++i) {
+      test::ExpectTensorNear<float>(tensors_expected[i], tensors[i], 1e-5);
+    }
+  }
+};
+
+TEST_F(HorizontalBatchingTest, SharedInputMatMuls) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"),
+                        GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 8})));
+  std::vector<string> fetch;
+  for (int i = 0; i < 3; ++i) {
+    const string suffix = strings::StrCat(i);
+    Output w = ops::Const(
+        s.WithOpName("w" + suffix),
+        GenerateRandomTensor<DT_FLOAT>(TensorShape({8, i + 2})));
+    Output m = ops::MatMul(s.WithOpName("m" + suffix), a, w);
+    ops::Relu(s.WithOpName("r" + suffix), m);
+    fetch.push_back("r" + suffix);
+  }
+
+  GrapplerItem item;
+  item.fetch = fetch;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalBatching optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(CountOps(output, "MatMul"), 1);
+  EXPECT_EQ(CountOps(output, "ConcatV2"), 1);
+  EXPECT_EQ(CountOps(output, "SplitV"), 1);
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "m0" || node.name() == "m1" || node.name() == "m2") {
+      EXPECT_EQ(node.op(), "Identity");
+      EXPECT_EQ(node.input(0), strings::StrCat("m0/horizontal_batching/split:",
+                                               node.name().substr(1)));
+    }
+  }
+  ExpectSameResults(item, output);
+}
+
+TEST_F(HorizontalBatchingTest, SharedInputConv2Ds) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = ops::Const(
+      s.WithOpName("input"),
+      GenerateRandomTensor<DT_FLOAT>(TensorShape({1, 5, 5, 3})));
+  Output f0 =
+      ops::Const(s.WithOpName("f0"),
+                 GenerateRandomTensor<DT_FLOAT>(TensorShape({3, 3, 3, 2})));
+  Output f1 =
+      ops::Const(s.WithOpName("f1"),
+                 GenerateRandomTensor<DT_FLOAT>(TensorShape({3, 3, 3, 4})));
+  Output c0 = ops::Conv2D(s.WithOpName("c0"), input, f0, {1, 1, 1, 1}, "SAME");
+  Output c1 = ops::Conv2D(s.WithOpName("c1"), input, f1, {1, 1, 1, 1}, "SAME");
+  ops::Relu(s.WithOpName("r0"), c0);
+  ops::Relu(s.WithOpName("r1"), c1);
+
+  GrapplerItem item;
+  item.fetch = {"r0", "r1"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalBatching optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(CountOps(output, "Conv2D"), 1);
+  EXPECT_EQ(CountOps(output, "SplitV"), 1);
+  ExpectSameResults(item, output);
+}
+
+TEST_F(HorizontalBatchingTest, PackedMatMuls) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  std::vector<string> fetch;
+  for (int i = 0; i < 4; ++i) {
+    const string suffix = strings::StrCat(i);
+    Output a =
+        ops::Const(s.WithOpName("a" + suffix),
+                   GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 8})));
+    Output b =
+        ops::Const(s.WithOpName("b" + suffix),
+                   GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 8})));
+    Output m = ops::MatMul(s.WithOpName("m" + suffix), a, b,
+                           ops::MatMul::TransposeB(true));
+    ops::Relu(s.WithOpName("r" + suffix), m);
+    fetch.push_back("r" + suffix);
+  }
+
+  GrapplerItem item;
+  item.fetch = fetch;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalBatching optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(CountOps(output, "MatMul"), 0);
+  EXPECT_EQ(CountOps(output, "Pack"), 2);
+  EXPECT_EQ(CountOps(output, "BatchMatMulV2"), 1);
+  EXPECT_EQ(CountOps(output, "Unpack"), 1);
+  ExpectSameResults(item, output);
+}
+
+TEST_F(HorizontalBatchingTest, DependentMatMulsAreNotMerged) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"),
+                        GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 8})));
+  Output w = ops::Const(s.WithOpName("w"),
+                        GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 8})));
+  Output m0 = ops::MatMul(s.WithOpName("m0"), a, w);
+  Output m1 = ops::MatMul(s.WithOpName("m1"), a, m0);
+  ops::Relu(s.WithOpName("r"), m1);
+
+  GrapplerItem item;
+  item.fetch = {"r"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  HorizontalBatching optimizer;
+  GraphDef output;
+  EXPECT_TRUE(errors::IsAborted(optimizer.Optimize(nullptr, item, &output)));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -24,9 +24,12 @@ limitations under the License.
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/tensor.pb.h"  // NOLINT
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/costs/graph_memory.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
@@ -37,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/optimizers/static_schedule.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/grappler/utils/traversal.h"
 #include "tensorflow/core/lib/math/math_util.h"
@@ -440,6 +444,18 @@ void RecomputeSubgraph(
   }
 }
 
+// Nodes whose inputs we may want to recompute. This matches node names that
+// contain recomputation_targets_name_scope as a name scope, meaning it either
+// begins with or contains the name scope. Defaults to "gradients/" which will
+// match any node names that begins with "gradients/" or contains
+// "/gradients/".
+bool IsRecomputationTarget(const string& recomputation_targets_name_scope,
+                           const NodeDef& node) {
+  return absl::StartsWith(node.name(), recomputation_targets_name_scope) ||
+         static_cast<int>(
+             node.name().find("/" + recomputation_targets_name_scope)) != -1;
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
                                 GraphDef* graph, const GrapplerItem& item) {
@@ -461,15 +477,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
   std::function<bool(const NodeDef&)> is_target =
       [&recomputation_targets_name_scope](const NodeDef& node) {
-        // Nodes whose inputs we may want to recompute. This matches node names
-        // that contain recomputation_targets_name_scope as a name scope,
-        // meaning it either begins with or contains the name scope.
-        // Defaults to "gradients/" which will match any node names that begins
-        // with "gradients/" or contains "/gradients/".
-        return absl::StartsWith(node.name(),
-                                recomputation_targets_name_scope) ||
-               static_cast<int>(node.name().find(
-                   "/" + recomputation_targets_name_scope)) != -1;
+        return IsRecomputationTarget(recomputation_targets_name_scope, node);
       };
 
   if (optimization_level == RewriterConfig::RECOMPUTATION_HEURISTICS ||
@@ -488,7 +496,8 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                   node.attr().count(kRecomputeHint) > 0);
         },
         is_target);
-  } else if (optimization_level == RewriterConfig::MANUAL) {
+  } else if (optimization_level == RewriterConfig::MANUAL ||
+             optimization_level == RewriterConfig::BUDGETED_RECOMPUTATION) {
     recomputed_subgraphs = GetOpGroupsToRecompute(
         graph, node_map,
         [&feeds, &is_target](const NodeDef& node) {
@@ -512,6 +521,197 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
 }
 
+struct RecomputationCandidate {
+  const NodeDef* node;
+  int64_t memory_used;
+  Costs::NanoSeconds compute_time;
+  // Bytes freed at the peak per nanosecond of recomputation.
+  double fitness;
+
+  bool operator<(const RecomputationCandidate& other) const {
+    return fitness > other.fitness ||
+           (fitness == other.fitness && node->name() < other.node->name());
+  }
+};
+
+// Plans the recomputation of activations against the memory of the GPUs. For
+// every GPU whose estimated peak memory usage exceeds its memory size, the
+// forward activations which are live at the peak and read by target nodes are
+// ranked by the memory they free per unit of compute needed to recompute them,
+// as estimated on a virtual cluster. The best ones are recomputed until the
+// estimated savings cover the overflow, which keeps the extra compute small.
+// Activations are only recomputed from inputs which stay live anyway, so that
+// a recomputation never extends the lifetime of another activation.
+bool BudgetedRecomputationPass(Cluster* cluster,
+                               const string& recomputation_targets_name_scope,
+                               GrapplerItem* item) {
+  GraphDef* graph = &item->graph;
+  // Sort before taking NodeDef pointers, the topological numbering of the
+  // sorted graph is used to place the recomputations.
+  if (!TopologicalSort(graph).ok()) {
+    return false;
+  }
+  GraphMemory memory(*item);
+  Status s = memory.InferStatically(cluster->GetDevices());
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+    return false;
+  }
+
+  std::unordered_map<string, Costs::NanoSeconds> compute_times;
+  {
+    VirtualCluster vcluster(cluster->GetDevices());
+    if (!vcluster.Provision().ok() || !vcluster.Initialize(*item).ok()) {
+      return false;
+    }
+    RunMetadata metadata;
+    s = vcluster.Run(*graph, item->feed, item->fetch, &metadata);
+    if (!s.ok() && s.code() != error::RESOURCE_EXHAUSTED) {
+      return false;
+    }
+    for (const auto& dev_stats : metadata.step_stats().dev_stats()) {
+      for (const auto& node_stats : dev_stats.node_stats()) {
+        compute_times.emplace(
+            node_stats.node_name(),
+            Costs::MicroSeconds(node_stats.op_end_rel_micros() -
+                                node_stats.op_start_rel_micros()));
+      }
+    }
+  }
+
+  NodeMap node_map(graph);
+  std::unordered_set<string> feeds;
+  for (const auto& feed : item->feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  const auto is_target = [&recomputation_targets_name_scope](
+                             const NodeDef& node) {
+    return IsRecomputationTarget(recomputation_targets_name_scope, node);
+  };
+  // Returns true if the input stays live until the targets run, whether or not
+  // `node` is recomputed.
+  const auto is_live_until_targets = [&](const string& input) {
+    const NodeDef* input_node = node_map.GetNode(input);
+    if (input_node == nullptr || is_target(*input_node)) {
+      return false;
+    }
+    if (IsPersistent(*input_node) || IsConstant(*input_node) ||
+        feeds.count(input_node->name()) > 0) {
+      return true;
+    }
+    for (const NodeDef* output : node_map.GetOutputs(input_node->name())) {
+      if (is_target(*output)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  std::unordered_set<const NodeDef*> recomputed_nodes;
+  std::vector<RecomputedSubGraph> recomputed_subgraphs;
+  for (const auto& device : cluster->GetDevices()) {
+    const DeviceProperties& prop = device.second;
+    if (prop.type() != "GPU" || prop.memory_size() <= 0) {
+      continue;
+    }
+    const GraphMemory::MemoryUsage& mem_usage =
+        memory.GetPeakMemoryUsage(device.first);
+    if (mem_usage.used_memory <= prop.memory_size()) {
+      continue;
+    }
+    const int64_t required_savings = mem_usage.used_memory - prop.memory_size();
+
+    std::set<RecomputationCandidate> candidates;
+    for (const auto& live_tensor : mem_usage.live_tensors) {
+      if (live_tensor.memory_used <= 1024) {
+        // Don't bother with small tensors.
+        continue;
+      }
+      const NodeDef* node = node_map.GetNode(live_tensor.node);
+      if (node == nullptr || is_target(*node) ||
+          feeds.count(node->name()) > 0 || IsPersistent(*node) ||
+          IsConstant(*node) || IsControlFlow(*node) || IsStateful(*node) ||
+          absl::StartsWith(node->name(), kRecomputedNodePrefix)) {
+        continue;
+      }
+      bool has_target_output = false;
+      for (const NodeDef* output : node_map.GetOutputs(node->name())) {
+        has_target_output |= is_target(*output);
+      }
+      bool has_live_inputs = true;
+      for (const string& input : node->input()) {
+        has_live_inputs &=
+            IsControlInput(input) || is_live_until_targets(input);
+      }
+      if (!has_target_output || !has_live_inputs) {
+        continue;
+      }
+      auto compute_time = compute_times.find(node->name());
+      if (compute_time == compute_times.end()) {
+        continue;
+      }
+      candidates.insert(
+          {node, static_cast<int64_t>(live_tensor.memory_used),
+           compute_time->second,
+           static_cast<double>(live_tensor.memory_used) /
+               (compute_time->second.count() + 1)});
+    }
+
+    int64_t savings = 0;
+    for (const RecomputationCandidate& candidate : candidates) {
+      if (savings >= required_savings) {
+        break;
+      }
+      // A node may output several live tensors, but is recomputed once.
+      if (recomputed_nodes.count(candidate.node) > 0) {
+        savings += candidate.memory_used;
+        continue;
+      }
+      // Recomputations read the original inputs, so neither the inputs nor
+      // the consumers of a recomputed node can be recomputed as well.
+      bool depends_on_recomputed_node = false;
+      for (const string& input : candidate.node->input()) {
+        depends_on_recomputed_node |=
+            recomputed_nodes.count(node_map.GetNode(input)) > 0;
+      }
+      for (const NodeDef* output :
+           node_map.GetOutputs(candidate.node->name())) {
+        depends_on_recomputed_node |= recomputed_nodes.count(output) > 0;
+      }
+      if (depends_on_recomputed_node) {
+        continue;
+      }
+      recomputed_nodes.insert(candidate.node);
+      RecomputedSubGraph subgraph;
+      subgraph.recomputed_source_nodes.insert(candidate.node);
+      for (NodeDef* output : node_map.GetOutputs(candidate.node->name())) {
+        if (is_target(*output)) {
+          subgraph.target_nodes.insert(output);
+        }
+      }
+      recomputed_subgraphs.push_back(std::move(subgraph));
+      savings += candidate.memory_used;
+      VLOG(1) << "Recomputing " << candidate.node->name() << " to save "
+              << candidate.memory_used << " bytes on " << device.first
+              << " for " << candidate.compute_time.count() << "ns of compute";
+    }
+  }
+  if (recomputed_subgraphs.empty()) {
+    return false;
+  }
+
+  std::unordered_map<const NodeDef*, int> topological_numbering;
+  for (int node_number = 0; node_number < graph->node().size(); ++node_number) {
+    topological_numbering[graph->mutable_node(node_number)] =
+        graph->node().size() - node_number - 1;
+  }
+  for (const RecomputedSubGraph& subgraph : recomputed_subgraphs) {
+    RecomputeSubgraph(subgraph.recomputed_source_nodes, subgraph.target_nodes,
+                      node_map, topological_numbering, graph);
+  }
+  return true;
+}
+
 bool SchedulingPass(Cluster* cluster, std::unique_ptr<GraphMemory>* memory_ptr,
                     GrapplerItem* item) {
   // Look for AddN nodes (and equivalent) and record input names.
@@ -1152,7 +1352,8 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
   std::unordered_map<NodeDef*, SwapInfo> nodes_to_swap;
   if (optimization_level == RewriterConfig::DEFAULT_MEM_OPT ||
       optimization_level == RewriterConfig::SWAPPING_HEURISTICS ||
-      optimization_level == RewriterConfig::HEURISTICS) {
+      optimization_level == RewriterConfig::HEURISTICS ||
+      optimization_level == RewriterConfig::BUDGETED_RECOMPUTATION) {
     // Use heuristics to figure out what needs to be swapped;
     IdentifySwappingCandidates(cluster, item, memory, skip_list,
                                &nodes_to_swap);
@@ -1270,6 +1471,244 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
   return updated_graph;
 }
 
+// Constants smaller than this are left on the device by weight streaming, since
+// copying them in for every use costs more than keeping them resident.
+constexpr int64_t kMinStreamedWeightBytes = 64 * 1024;
+// Number of layers whose streamed weights may be on the device at once. With
+// two, the weights of the next layer are copied in while the current one runs.
+constexpr int kNumStreamedWeightBuffers = 2;
+
+// Returns whether `node` is placed on a GPU and free to move to the host.
+bool IsMovableGpuNode(const NodeDef& node) {
+  string task, device;
+  return node.attr().count("_class") == 0 &&
+         DeviceNameUtils::SplitDeviceName(node.device(), &task, &device) &&
+         absl::StrContains(device, DEVICE_GPU);
+}
+
+// Returns the size in bytes of a weight of type `dtype` and shape `shape`, or
+// 0 if it can't be streamed.
+int64_t WeightBytes(DataType dtype, const TensorShapeProto& shape) {
+  // GPU kernels keep int32 tensors in host memory already.
+  if (dtype == DT_INT32 || !DataTypeCanUseMemcpy(dtype) ||
+      !TensorShape::IsValid(shape)) {
+    return 0;
+  }
+  return TensorShape(shape).num_elements() * DataTypeSize(dtype);
+}
+
+// Returns the size in bytes of the weights held by `node` if it is a GPU
+// constant or resource variable that can be kept in host memory, or 0
+// otherwise.
+int64_t StreamableWeightBytes(const NodeDef& node) {
+  if (!IsMovableGpuNode(node)) {
+    return 0;
+  }
+  DataType dtype;
+  if (IsConstant(node)) {
+    const TensorProto* value;
+    if (!GetNodeAttr(node, "dtype", &dtype).ok() ||
+        !GetNodeAttr(node, "value", &value).ok()) {
+      return 0;
+    }
+    return WeightBytes(dtype, value->tensor_shape());
+  }
+  if (node.op() == "VarHandleOp") {
+    const TensorShapeProto* shape;
+    if (!GetNodeAttr(node, "dtype", &dtype).ok() ||
+        !GetNodeAttr(node, "shape", &shape).ok()) {
+      return 0;
+    }
+    return WeightBytes(dtype, *shape);
+  }
+  return 0;
+}
+
+// Moves the large constants and resource variables of the graph to host
+// memory, and copies each of them back to the GPU right before the op that
+// reads it. The copies are scheduled in the topological order of their
+// readers: the weights of a layer are only copied in once the layer
+// kNumStreamedWeightBuffers steps earlier has run, and each copy is released
+// as soon as its reader is done with it.
+//
+// A variable is moved along with the ReadVariableOp, AssignVariableOp and
+// VarIsInitializedOp nodes using it, which must be all its users, so that its
+// initialization and restore still work. Weights read in a loop are left on the device.
+bool WeightStreamingPass(GrapplerItem* item) {
+  std::vector<const NodeDef*> topo_order;
+  if (!ComputeTopologicalOrder(item->graph, &topo_order).ok()) {
+    return false;
+  }
+  FrameView frame_view;
+  if (!frame_view.InferFromGraph(item->graph).ok()) {
+    return false;
+  }
+  NodeMap node_map(&item->graph);
+
+  // The nodes whose output is streamed, and for each of them the nodes moved
+  // to the host with it.
+  const std::unordered_set<string> nodes_to_preserve = item->NodesToPreserve();
+  auto is_preserved = [&](const NodeDef& node) {
+    return nodes_to_preserve.find(node.name()) != nodes_to_preserve.end();
+  };
+  std::unordered_map<string, NodeDef*> weights;
+  std::unordered_map<string, std::vector<NodeDef*>> moved_nodes;
+  for (auto& node : *item->graph.mutable_node()) {
+    if (is_preserved(node) || frame_view.IsInFrame(node) ||
+        StreamableWeightBytes(node) < kMinStreamedWeightBytes) {
+      continue;
+    }
+    if (IsConstant(node)) {
+      weights[node.name()] = &node;
+      moved_nodes[node.name()] = {&node};
+      continue;
+    }
+    std::vector<NodeDef*> variable_nodes = {&node};
+    std::vector<NodeDef*> reads;
+    bool movable = true;
+    for (NodeDef* user : node_map.GetOutputs(node.name())) {
+      const bool is_read = IsReadVariableOp(*user);
+      if ((!is_read && user->op() != "AssignVariableOp" &&
+           user->op() != "VarIsInitializedOp") ||
+          user->device() != node.device() || is_preserved(*user) ||
+          frame_view.IsInFrame(*user)) {
+        movable = false;
+        break;
+      }
+      variable_nodes.push_back(user);
+      if (is_read) reads.push_back(user);
+    }
+    if (!movable) {
+      continue;
+    }
+    // The reads are streamed together: a variable on the host can't be read
+    // on the GPU.
+    for (NodeDef* read : reads) {
+      weights[read->name()] = read;
+      moved_nodes[read->name()] = variable_nodes;
+    }
+  }
+  // Weights read on another device, in a loop, or through a reference, stay
+  // where they are. So do the initial values of variables, since assignments
+  // move to the host with their variable.
+  std::unordered_set<string> pinned_nodes;
+  for (const NodeDef* node : topo_order) {
+    for (int i = 0; i < node->input_size(); ++i) {
+      const TensorId tensor = ParseTensorName(node->input(i));
+      auto it = weights.find(string(tensor.node()));
+      if (it == weights.end() || tensor.index() < 0) {
+        continue;
+      }
+      const OpDef* op_def;
+      DataType dtype;
+      if (node->device() != it->second->device() ||
+          frame_view.IsInFrame(*node) || node->op() == "AssignVariableOp" ||
+          !OpRegistry::Global()->LookUpOpDef(node->op(), &op_def).ok() ||
+          !InputTypeForNode(*node, *op_def, i, &dtype).ok() ||
+          IsRefType(dtype)) {
+        for (const NodeDef* moved : moved_nodes[it->first]) {
+          pinned_nodes.insert(moved->name());
+        }
+      }
+    }
+  }
+  for (auto it = weights.begin(); it != weights.end();) {
+    bool pinned = false;
+    for (const NodeDef* moved : moved_nodes[it->first]) {
+      pinned |= pinned_nodes.find(moved->name()) != pinned_nodes.end();
+    }
+    if (pinned) {
+      it = weights.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (weights.empty()) {
+    return false;
+  }
+
+  // The nodes reading streamed weights, in the order they will run.
+  std::vector<NodeDef*> layers;
+  // Whether each node may not run, because it is downstream of a Switch.
+  // Such a node can't delay a copy, since a control dependency on a dead node
+  // would make the copy, and its reader, dead too.
+  std::unordered_set<const NodeDef*> maybe_dead;
+  for (const NodeDef* node : topo_order) {
+    bool is_layer = false;
+    bool is_maybe_dead = IsSwitch(*node);
+    for (const string& input : node->input()) {
+      if (weights.find(NodeName(input)) != weights.end() &&
+          !IsControlInput(input)) {
+        is_layer = true;
+      }
+      const NodeDef* fanin = node_map.GetNode(input);
+      is_maybe_dead |= fanin != nullptr && maybe_dead.count(fanin) > 0;
+    }
+    if (is_maybe_dead) {
+      maybe_dead.insert(node);
+    }
+    if (is_layer) {
+      layers.push_back(const_cast<NodeDef*>(node));
+    }
+  }
+
+  const int num_layers = layers.size();
+  for (int layer = 0; layer < num_layers; ++layer) {
+    NodeDef* node = layers[layer];
+    // The latest layer that must have run before the weights of this one are
+    // copied in, if any.
+    const NodeDef* trigger = nullptr;
+    for (int previous = layer - kNumStreamedWeightBuffers; previous >= 0;
+         --previous) {
+      if (maybe_dead.count(layers[previous]) == 0) {
+        trigger = layers[previous];
+        break;
+      }
+    }
+    // Copy each weight once per reader, even if it is read several times.
+    std::unordered_map<string, string> streamed_inputs;
+    for (int i = 0; i < node->input_size(); ++i) {
+      const string input = node->input(i);
+      auto it = weights.find(NodeName(input));
+      if (it == weights.end() || IsControlInput(input)) {
+        continue;
+      }
+      string& stream_in_name = streamed_inputs[input];
+      if (stream_in_name.empty()) {
+        stream_in_name = strings::StrCat("stream_in_", node->name(), "_", i);
+        NodeDef* stream_in = item->graph.add_node();
+        stream_in->set_name(stream_in_name);
+        stream_in->set_op("_CopyFromHostToGpu");
+        stream_in->set_device(node->device());
+        (*stream_in->mutable_attr())["T"].set_type(
+            it->second->attr().at("dtype").type());
+        *stream_in->add_input() = input;
+        if (trigger != nullptr) {
+          *stream_in->add_input() = AsControlDependency(trigger->name());
+        }
+      }
+      *node->mutable_input(i) = stream_in_name;
+    }
+  }
+
+  std::unordered_set<NodeDef*> nodes_to_move;
+  for (const auto& weight : weights) {
+    for (NodeDef* moved : moved_nodes[weight.first]) {
+      nodes_to_move.insert(moved);
+    }
+  }
+  for (NodeDef* node : nodes_to_move) {
+    DeviceNameUtils::ParsedName host;
+    if (!DeviceNameUtils::ParseFullName(node->device(), &host)) {
+      continue;
+    }
+    host.type = DEVICE_CPU;
+    host.id = 0;
+    node->set_device(DeviceNameUtils::ParsedNameToString(host));
+  }
+  return true;
+}
+
 bool CrossesTaskOrCpuGpuBoundary(const NodeDef& node1, const NodeDef& node2) {
   string task1;
   string device1;
@@ -1386,8 +1825,12 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
   bool run_recomputation_pass =
       (optimization_level_ == RewriterConfig::RECOMPUTATION_HEURISTICS ||
        optimization_level_ == RewriterConfig::HEURISTICS ||
-       optimization_level_ == RewriterConfig::MANUAL);
-  if (!run_recomputation_pass && nodes_to_relax.empty() && item.fetch.empty()) {
+       optimization_level_ == RewriterConfig::MANUAL ||
+       optimization_level_ == RewriterConfig::BUDGETED_RECOMPUTATION);
+  bool run_weight_streaming_pass =
+      optimization_level_ == RewriterConfig::WEIGHT_STREAMING;
+  if (!run_recomputation_pass && !run_weight_streaming_pass &&
+      nodes_to_relax.empty() && item.fetch.empty()) {
     return errors::Aborted("Nothing to do.");
   }
 
@@ -1400,12 +1843,22 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                &optimized_item.graph, item);
   }
 
+  if (run_weight_streaming_pass) {
+    WeightStreamingPass(&optimized_item);
+  }
+
   std::unordered_set<string> skip_list;
   // Bound the number of rewrite passes to avoid long processing times on graphs
   // that simply won't fit in memory.
   // SchedulingPass() and SwappingPass() rely on defined fetches in order to
   // infer the memory usage, so skip optimization if there are no fetches.
   std::unique_ptr<GraphMemory> memory;
+  if (optimization_level_ == RewriterConfig::BUDGETED_RECOMPUTATION &&
+      !item.fetch.empty() && cluster != nullptr) {
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+    BudgetedRecomputationPass(cluster, recomputation_targets_name_scope_,
+                              &optimized_item);
+  }
   if (!item.fetch.empty() && cluster != nullptr) {
     bool updated_graph = true;
     for (int i = 0; i < 25 && updated_graph; ++i) {
@@ -1426,7 +1879,8 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       if ((optimization_level_ == RewriterConfig::DEFAULT_MEM_OPT ||
            optimization_level_ == RewriterConfig::SWAPPING_HEURISTICS ||
            optimization_level_ == RewriterConfig::HEURISTICS ||
-           optimization_level_ == RewriterConfig::MANUAL) &&
+           optimization_level_ == RewriterConfig::MANUAL ||
+           optimization_level_ == RewriterConfig::BUDGETED_RECOMPUTATION) &&
           cluster != nullptr) {
         if (SwappingPass(optimization_level_, cluster, &memory, &optimized_item,
                          &skip_list)) {
@@ -20,6 +20,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/cc/ops/resource_variable_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
@@ -203,7 +204,8 @@ TEST_F(RecomputeSubgraphTest, MultiNode) {
 
 class MemoryOptimizerTest : public GrapplerTest {
  public:
-  static std::unique_ptr<VirtualCluster> CreateVirtualCluster() {
+  static std::unique_ptr<VirtualCluster> CreateVirtualCluster(
+      int64_t gpu_memory_size = 1024 * 1024) {
     DeviceProperties cpu_device;
     cpu_device.set_type("CPU");
     cpu_device.set_frequency(1000);
@@ -215,7 +217,7 @@ class MemoryOptimizerTest : public GrapplerTest {
     gpu_device.set_frequency(1000);
     gpu_device.set_num_cores(24);
     gpu_device.set_bandwidth(128);
-    gpu_device.set_memory_size(1024 * 1024);
+    gpu_device.set_memory_size(gpu_memory_size);
     gpu_device.mutable_environment()->insert({"architecture", "6"});
     std::unordered_map<string, DeviceProperties> devices;
     devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
@@ -346,6 +348,74 @@ TEST_F(MemoryOptimizerTest, SwappingHeuristics) {
 #endif
 }
 
+TEST_F(MemoryOptimizerTest, BudgetedRecomputation) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output v = ops::Variable(s.WithOpName("v").WithDevice("/gpu:0"),
+                           {128, 128, 8}, DT_FLOAT);
+  Output a = ops::Sqrt(s.WithOpName("a").WithDevice("/gpu:0"), v);
+  Output b = ops::Square(s.WithOpName("b").WithDevice("/gpu:0"), v);
+  Output c = ops::Exp(s.WithOpName("c").WithDevice("/gpu:0"), v);
+  Output loss = ops::AddN(s.WithOpName("loss").WithDevice("/gpu:0"), {a, b, c});
+  Output grad_a =
+      ops::Mul(s.WithOpName("gradients/a").WithDevice("/gpu:0"), loss, a);
+  Output grad_b =
+      ops::Mul(s.WithOpName("gradients/b").WithDevice("/gpu:0"), grad_a, b);
+  Output grad_c =
+      ops::Mul(s.WithOpName("gradients/c").WithDevice("/gpu:0"), grad_b, c);
+
+  Output constant = ops::Const(s.WithOpName("constant"), 0.0f, {128, 128, 8});
+  Output init = ops::Assign(s.WithOpName("init"), v, constant);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/c"};
+  item.init_ops = {init.name()};
+
+  MemoryOptimizer optimizer(RewriterConfig::BUDGETED_RECOMPUTATION);
+
+  // Everything fits in memory: nothing is recomputed.
+  {
+    std::unique_ptr<VirtualCluster> cluster(
+        CreateVirtualCluster(/*gpu_memory_size=*/1024 * 1024 * 1024));
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+    for (const auto& node : output.node()) {
+      EXPECT_FALSE(absl::StartsWith(node.name(), "Recomputed"));
+    }
+  }
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  // Some of the forward activations are recomputed, and only read by the
+  // gradients.
+  NodeMap node_map(&output);
+  int num_recomputed = 0;
+  for (const NodeDef& node : output.node()) {
+    if (!absl::StartsWith(node.name(), "Recomputed/")) continue;
+    ++num_recomputed;
+    const string original = node.name().substr(strlen("Recomputed/"));
+    EXPECT_FALSE(absl::StartsWith(original, "gradients/"));
+    ASSERT_GT(node.input_size(), 0);
+    EXPECT_EQ(absl::StrCat("^RecomputeTrigger/", original),
+              node.input(node.input_size() - 1));
+    const auto& outputs = node_map.GetOutputs(node.name());
+    EXPECT_FALSE(outputs.empty());
+    for (const NodeDef* output_node : outputs) {
+      EXPECT_TRUE(absl::StartsWith(output_node->name(), "gradients/"));
+    }
+  }
+  EXPECT_GT(num_recomputed, 0);
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  auto tensors_expected = EvaluateFetchNodes(item);
+  GrapplerItem optimized = item.WithGraph(std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+#endif
+}
+
 TEST_F(MemoryOptimizerTest, UnswappableInputs) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output v = ops::Variable(s.WithOpName("v").WithDevice("/gpu:0"),
@@ -393,6 +463,167 @@ TEST_F(MemoryOptimizerTest, UnswappableInputs) {
 #endif
 }
 
+TEST_F(MemoryOptimizerTest, WeightStreaming) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Const(s.WithOpName("x").WithDevice("/gpu:0"), 1.0f,
+                        {8, 256});
+  Output w0 = ops::Const(s.WithOpName("w0").WithDevice("/gpu:0"), 0.5f,
+                         {256, 256});
+  Output w1 = ops::Const(s.WithOpName("w1").WithDevice("/gpu:0"), 0.25f,
+                         {256, 256});
+  Output w2 = ops::Const(s.WithOpName("w2").WithDevice("/gpu:0"), 2.0f,
+                         {256, 256});
+  Output layer0 =
+      ops::MatMul(s.WithOpName("layer0").WithDevice("/gpu:0"), x, w0);
+  Output layer1 =
+      ops::MatMul(s.WithOpName("layer1").WithDevice("/gpu:0"), layer0, w1);
+  Output layer2 =
+      ops::MatMul(s.WithOpName("layer2").WithDevice("/gpu:0"), layer1, w2);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"layer2"};
+
+  MemoryOptimizer optimizer(RewriterConfig::WEIGHT_STREAMING);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  // The weights are kept on the host, the small input stays on the GPU.
+  EXPECT_EQ("/gpu:0", node_map.GetNode("x")->device());
+  for (const string& weight : {"w0", "w1", "w2"}) {
+    EXPECT_EQ("/device:CPU:0", node_map.GetNode(weight)->device());
+  }
+  for (const string& layer : {"layer0", "layer1", "layer2"}) {
+    const NodeDef* node = node_map.GetNode(layer);
+    ASSERT_EQ(2, node->input_size());
+    EXPECT_EQ(absl::StrCat("stream_in_", layer, "_1"), node->input(1));
+    const NodeDef* stream_in = node_map.GetNode(node->input(1));
+    ASSERT_NE(nullptr, stream_in);
+    EXPECT_EQ("_CopyFromHostToGpu", stream_in->op());
+    EXPECT_EQ("/gpu:0", stream_in->device());
+  }
+  // The weights of layer2 are only copied once layer0 is done with its own.
+  const NodeDef* stream_in = node_map.GetNode("stream_in_layer2_1");
+  ASSERT_EQ(2, stream_in->input_size());
+  EXPECT_EQ("w2", stream_in->input(0));
+  EXPECT_EQ("^layer0", stream_in->input(1));
+  EXPECT_EQ(1, node_map.GetNode("stream_in_layer1_1")->input_size());
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  auto tensors_expected = EvaluateFetchNodes(item);
+  GrapplerItem optimized = item.WithGraph(std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+#endif
+}
+
+TEST_F(MemoryOptimizerTest, WeightStreamingMovesVariables) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Const(s.WithOpName("x").WithDevice("/gpu:0"), 1.0f,
+                        {8, 256});
+  Output init = ops::Const(s.WithOpName("init").WithDevice("/gpu:0"), 0.5f,
+                           {256, 256});
+  Output var = ops::VarHandleOp(s.WithOpName("var").WithDevice("/gpu:0"),
+                                DT_FLOAT, {256, 256});
+  ops::AssignVariableOp assign(s.WithOpName("assign").WithDevice("/gpu:0"),
+                               var, init);
+  Output read = ops::ReadVariableOp(
+      s.WithOpName("read").WithDevice("/gpu:0").WithControlDependencies(
+          {assign}),
+      var, DT_FLOAT);
+  Output layer0 =
+      ops::MatMul(s.WithOpName("layer0").WithDevice("/gpu:0"), x, read);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"layer0"};
+
+  MemoryOptimizer optimizer(RewriterConfig::WEIGHT_STREAMING);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  // The variable is moved to the host along with all the ops using it.
+  for (const string& name : {"var", "assign", "read"}) {
+    EXPECT_EQ("/device:CPU:0", node_map.GetNode(name)->device()) << name;
+  }
+  EXPECT_EQ("/gpu:0", node_map.GetNode("init")->device());
+  EXPECT_EQ("init", node_map.GetNode("assign")->input(1));
+  const NodeDef* layer0_node = node_map.GetNode("layer0");
+  ASSERT_EQ(2, layer0_node->input_size());
+  EXPECT_EQ("stream_in_layer0_1", layer0_node->input(1));
+  EXPECT_EQ("read", node_map.GetNode("stream_in_layer0_1")->input(0));
+}
+
+TEST_F(MemoryOptimizerTest, WeightStreamingKeepsVariablesUsedByOtherOps) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Const(s.WithOpName("x").WithDevice("/gpu:0"), 1.0f,
+                        {8, 256});
+  Output var = ops::VarHandleOp(s.WithOpName("var").WithDevice("/gpu:0"),
+                                DT_FLOAT, {256, 256});
+  ops::AssignAddVariableOp update(s.WithOpName("update").WithDevice("/gpu:0"),
+                                  var, x);
+  Output read =
+      ops::ReadVariableOp(s.WithOpName("read").WithDevice("/gpu:0"), var,
+                          DT_FLOAT);
+  Output layer0 =
+      ops::MatMul(s.WithOpName("layer0").WithDevice("/gpu:0"), x, read);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"layer0"};
+
+  MemoryOptimizer optimizer(RewriterConfig::WEIGHT_STREAMING);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  EXPECT_EQ("/gpu:0", node_map.GetNode("var")->device());
+  EXPECT_EQ("/gpu:0", node_map.GetNode("read")->device());
+  EXPECT_EQ("read", node_map.GetNode("layer0")->input(1));
+}
+
+TEST_F(MemoryOptimizerTest, WeightStreamingSkipsConditionalTriggers) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output pred = ops::Const(s.WithOpName("pred").WithDevice("/gpu:0"), true);
+  Output x = ops::Const(s.WithOpName("x").WithDevice("/gpu:0"), 1.0f,
+                        {8, 256});
+  Output w0 = ops::Const(s.WithOpName("w0").WithDevice("/gpu:0"), 0.5f,
+                         {256, 256});
+  Output w1 = ops::Const(s.WithOpName("w1").WithDevice("/gpu:0"), 0.25f,
+                         {256, 256});
+  Output w2 = ops::Const(s.WithOpName("w2").WithDevice("/gpu:0"), 2.0f,
+                         {256, 256});
+  ops::Switch branch(s.WithOpName("branch").WithDevice("/gpu:0"), x, pred);
+  // layer0 only runs if pred is true.
+  Output layer0 = ops::MatMul(s.WithOpName("layer0").WithDevice("/gpu:0"),
+                              branch.output_true, w0);
+  Output merged = ops::Merge(s.WithOpName("merged").WithDevice("/gpu:0"),
+                             {branch.output_false, layer0})
+                      .output;
+  Output layer1 =
+      ops::MatMul(s.WithOpName("layer1").WithDevice("/gpu:0"), merged, w1);
+  Output layer2 =
+      ops::MatMul(s.WithOpName("layer2").WithDevice("/gpu:0"), layer1, w2);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"layer2"};
+
+  MemoryOptimizer optimizer(RewriterConfig::WEIGHT_STREAMING);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  // The weights of layer2 are still streamed, but their copy doesn't wait for
+  // layer0, which may never run.
+  const NodeDef* stream_in = node_map.GetNode("stream_in_layer2_1");
+  ASSERT_NE(nullptr, stream_in);
+  ASSERT_EQ(1, stream_in->input_size());
+  EXPECT_EQ("w2", stream_in->input(0));
+}
+
 TEST_F(MemoryOptimizerTest, AccumulationRewrites) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output a = ops::RandomNormal(s.WithOpName("a").WithDevice("/cpu:0"),
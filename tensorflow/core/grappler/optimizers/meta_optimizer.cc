@@ -17,18 +17,22 @@ limitations under the License.
 
 #include <algorithm>
 #include <functional>
+#include <map>
 #include <string>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/versions.pb.h"
@@ -43,10 +47,12 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/horizontal_batching.h"
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
@@ -59,6 +65,8 @@ limitations under the License.
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/ptr_util.h"
 #include "tensorflow/core/util/util.h"
@@ -87,6 +95,116 @@ int64_t NumEdges(const GraphDef& graph) {
   return num_edges;
 }
 
+// Returns the serialized size of `graph` without its function library.
+int64_t GraphBytes(const GraphDef& graph) {
+  return graph.ByteSizeLong() - graph.library().ByteSizeLong();
+}
+
+// Returns true if `a` and `b` may be equal. Tensor values are compared by type
+// and shape only, as comparing the values of large constants is expensive.
+bool AttrValuesMaybeEqual(const AttrValue& a, const AttrValue& b) {
+  if (a.has_tensor() && b.has_tensor()) {
+    return a.tensor().dtype() == b.tensor().dtype() &&
+           PartialTensorShape(a.tensor().tensor_shape())
+               .IsIdenticalTo(PartialTensorShape(b.tensor().tensor_shape()));
+  }
+  return AreAttrValuesEqual(a, b);
+}
+
+// Returns true if the op, device, inputs and attributes of `a` and `b` may be
+// equal.
+bool NodesMaybeEqual(const NodeDef& a, const NodeDef& b) {
+  if (a.op() != b.op() || a.device() != b.device() ||
+      a.input_size() != b.input_size() || a.attr_size() != b.attr_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.input_size(); ++i) {
+    if (a.input(i) != b.input(i)) return false;
+  }
+  for (const auto& attr : a.attr()) {
+    auto it = b.attr().find(attr.first);
+    if (it == b.attr().end() || !AttrValuesMaybeEqual(attr.second, it->second))
+      return false;
+  }
+  return true;
+}
+
+// Sets the node counts and graph sizes of `report` for an optimizer that
+// rewrote `before` into `after`.
+void ReportChanges(const GraphDef& before, const GraphDef& after,
+                   OptimizationReport::PassReport* report) {
+  report->set_num_nodes_before(before.node_size());
+  report->set_num_nodes_after(after.node_size());
+  const int64_t graph_bytes_before = GraphBytes(before);
+  report->set_graph_bytes_before(graph_bytes_before);
+  if (&before == &after) {
+    // The optimizer failed, and the graph is unchanged.
+    report->set_graph_bytes_after(graph_bytes_before);
+    return;
+  }
+  report->set_graph_bytes_after(GraphBytes(after));
+
+  // Optimizers mostly keep the nodes they do not remove in order, so the
+  // graphs are matched in order up to the first node with a different name,
+  // and only the remaining nodes are matched by name.
+  int64_t num_modified = 0;
+  const int num_common = std::min(before.node_size(), after.node_size());
+  int i = 0;
+  for (; i < num_common && before.node(i).name() == after.node(i).name();
+       ++i) {
+    if (!NodesMaybeEqual(before.node(i), after.node(i))) ++num_modified;
+  }
+  absl::flat_hash_map<absl::string_view, const NodeDef*> before_nodes;
+  before_nodes.reserve(before.node_size() - i);
+  for (int j = i; j < before.node_size(); ++j) {
+    before_nodes.emplace(before.node(j).name(), &before.node(j));
+  }
+  int64_t num_added = 0;
+  for (int j = i; j < after.node_size(); ++j) {
+    const NodeDef& node = after.node(j);
+    auto it = before_nodes.find(node.name());
+    if (it == before_nodes.end()) {
+      ++num_added;
+    } else if (!NodesMaybeEqual(*it->second, node)) {
+      ++num_modified;
+    }
+  }
+  report->set_num_nodes_added(num_added);
+  report->set_num_nodes_removed(before.node_size() -
+                                (after.node_size() - num_added));
+  report->set_num_nodes_modified(num_modified);
+}
+
+// Exports the metrics of each optimizer in `report` to the monitoring gauges.
+void ExportOptimizationReport(const OptimizationReport& report) {
+  struct PassMetrics {
+    int64_t wall_time_us = 0;
+    int64_t num_changed_nodes = 0;
+    int64_t peak_graph_bytes = 0;
+  };
+  std::map<string, PassMetrics> metrics_by_pass;
+  for (const OptimizationReport::ItemReport& item : report.items()) {
+    for (const OptimizationReport::PassReport& pass : item.passes()) {
+      PassMetrics& pass_metrics = metrics_by_pass[pass.optimizer()];
+      pass_metrics.wall_time_us += pass.wall_time_us();
+      pass_metrics.num_changed_nodes += pass.num_nodes_added() +
+                                        pass.num_nodes_removed() +
+                                        pass.num_nodes_modified();
+      pass_metrics.peak_graph_bytes =
+          std::max(pass_metrics.peak_graph_bytes, pass.graph_bytes_after());
+    }
+  }
+  // The gauges of a pass are set together, so that concurrent exports do not
+  // interleave the metrics of different reports.
+  static mutex* mu = new mutex;
+  mutex_lock l(*mu);
+  for (const auto& it : metrics_by_pass) {
+    tensorflow::metrics::UpdateGrapplerPassMetrics(
+        it.first, it.second.wall_time_us, it.second.num_changed_nodes,
+        it.second.peak_graph_bytes);
+  }
+}
+
 string PrintSizesBeforeAfter(const GraphDef& before, const GraphDef& after) {
   return strings::StrCat("Graph size after: ", after.node_size(), " nodes (",
                          after.node_size() - before.node_size(), "), ",
@@ -215,7 +333,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
          new ConstantFolding(
              cpu_device_,
              cfg_.experimental_disable_compressed_tensor_optimization(),
-             !cfg_.experimental_disable_folding_quantization_emulation()));
+             !cfg_.experimental_disable_folding_quantization_emulation(),
+             cfg_.constant_folding_options()));
   MK_OPT("shape", "shape_optimization", new ShapeOptimizer());
   MK_OPT("remap", "remapping",
          new Remapper(cfg_.remapping(), cfg_.cpu_layout_conversion(),
@@ -229,7 +348,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
 #ifdef INTEL_MKL
   if (IsMKLEnabled()) {
     MK_OPT("auto_mixed_precision_mkl", "auto_mixed_precision_mkl",
-           new AutoMixedPrecision(AutoMixedPrecisionMode::MKL));
+           new AutoMixedPrecision(AutoMixedPrecisionMode::MKL,
+                                  cfg_.auto_mixed_precision_mkl_profile()));
   }
 #endif
   MK_OPT("auto_mixed_precision_cpu", "auto_mixed_precision_cpu",
@@ -247,6 +367,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
   MK_OPT("dependency", "dependency_optimization",
          new DependencyOptimizer(cfg_.dependency_optimization()));
   MK_OPT("debug_stripper", "debug_stripper", new DebugStripper());
+  MK_OPT("horizontal_batching", "horizontal_batching",
+         new HorizontalBatching(cfg_.horizontal_batching()));
   MK_OPT("scoped_allocator", "scoped_allocator_optimization",
          new ScopedAllocatorOptimizer(cfg_.scoped_allocator_optimization(),
                                       cfg_.scoped_allocator_opts()));
@@ -352,7 +474,8 @@ Status MetaOptimizer::InitializeOptimizers(
       optimizers->push_back(MakeUnique<ConstantFolding>(
           cfg_.constant_folding(), cpu_device_,
           cfg_.experimental_disable_compressed_tensor_optimization(),
-          !cfg_.experimental_disable_folding_quantization_emulation()));
+          !cfg_.experimental_disable_folding_quantization_emulation(),
+          cfg_.constant_folding_options()));
     }
   }
   if (BOTH_NOT_OFF(shape_optimization)) {
@@ -373,8 +496,8 @@ Status MetaOptimizer::InitializeOptimizers(
       AutoMixedPrecisionEnabled(
           plugin_configs.toggle_config["auto_mixed_precision_mkl"]) &&
       IsMKLEnabled()) {
-    optimizers->push_back(
-        MakeUnique<AutoMixedPrecision>(AutoMixedPrecisionMode::MKL));
+    optimizers->push_back(MakeUnique<AutoMixedPrecision>(
+        AutoMixedPrecisionMode::MKL, cfg_.auto_mixed_precision_mkl_profile()));
   }
 #endif
   if (AutoMixedPrecisionEnabled(cfg_.auto_mixed_precision_cpu()) &&
@@ -463,6 +586,14 @@ Status MetaOptimizer::InitializeOptimizers(
         MakeUnique<AutoParallel>(cfg_.auto_parallel().num_replicas()));
   }
 
+  if (BOTH_ARE_ON(horizontal_batching)) {
+    optimizers->push_back(
+        MakeUnique<HorizontalBatching>(cfg_.horizontal_batching()));
+  } else if (BOTH_ARE_EXPERIMENTAL_MLIR(horizontal_batching) ||
+             BOTH_ARE_EXPERIMENTAL_BOTH(horizontal_batching)) {
+    VLOG(2) << "horizontal_batching is not implemented in TFG yet";
+  }
+
 #ifndef ENABLE_MKL
   if (BOTH_ARE_ON(scoped_allocator_optimization)) {
     optimizers->push_back(MakeUnique<ScopedAllocatorOptimizer>(
@@ -614,6 +745,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
     PRINT_CFG(remapping)
     PRINT_CFG(loop_optimization)
     PRINT_CFG(dependency_optimization)
+    PRINT_CFG(horizontal_batching)
     PRINT_CFG(scoped_allocator_optimization)
 #undef PRINT_CFG
     user_cfg.toggle_config["auto_mixed_precision"] =
@@ -663,6 +795,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
       PRINT_CFG("dependency", "dependency_optimization")
       PRINT_CFG("memory", "memory_optimization")
       PRINT_CFG("autoparallel", "auto_parallel")
+      PRINT_CFG("horizontal_batching", "horizontal_batching")
       PRINT_CFG("scoped_allocator", "scoped_allocator_optimization")
 #undef PRINT_CFG
     }
@@ -697,6 +830,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
         pair.first == "auto_mixed_precision_mkl" ||
         pair.first == "auto_mixed_precision_cpu" ||
         pair.first == "pin_to_host_optimization" ||
+        pair.first == "horizontal_batching" ||
         pair.first == "scoped_allocator_optimization") {
       // These optimizers are turned off by default.
       strings::StrAppend(
@@ -732,6 +866,7 @@ Status MetaOptimizer::OptimizeGraph(
   tensorflow::metrics::ScopedCounter<2> timings(
       tensorflow::metrics::GetGraphOptimizationCounter(),
       {kGrapplerCategory, "OptimizeMainGraph"});
+  const uint64 start_us = Env::Default()->NowMicros();
 
   // Initialize the configured verifiers.
   std::vector<std::unique_ptr<GraphVerifier>> inter_optimizer_verifiers;
@@ -769,6 +904,7 @@ Status MetaOptimizer::OptimizeGraph(
 #ifndef ENABLE_MKL
   GraphOptimizer* sa_optimizer = nullptr;
 #endif
+  int last_iteration = 0;
 
   // Constants in the graph are normally compressed after model_pruner.
   // Do it here if model pruner is disabled.
@@ -786,6 +922,7 @@ Status MetaOptimizer::OptimizeGraph(
     }
 
     VLOG(4) << "Starting optimization iteration " << iteration;
+    last_iteration = iteration;
     if (VLOG_IS_ON(4)) {
       DumpGraphDefToFile(
           strings::StrCat("before_MetaOptimizer_iteration_", iteration, "_",
@@ -805,8 +942,9 @@ Status MetaOptimizer::OptimizeGraph(
       }
 #endif
 
-      TF_RETURN_IF_ERROR(RunOptimizer(optimizer.get(), cluster, &item,
-                                      optimized_graph, &optimization_result));
+      TF_RETURN_IF_ERROR(RunOptimizer(optimizer.get(), cluster, iteration,
+                                      &item, optimized_graph,
+                                      &optimization_result));
 
       if (iteration == 0 && optimizer->name() == "model_pruner") {
         CompressConstants(optimized_graph);
@@ -838,8 +976,9 @@ Status MetaOptimizer::OptimizeGraph(
 #ifndef ENABLE_MKL
   // ScopedAllocatorOptimizer must run last.
   if (sa_optimizer != nullptr) {
-    TF_RETURN_IF_ERROR(RunOptimizer(sa_optimizer, cluster, &item,
-                                    optimized_graph, &optimization_result));
+    TF_RETURN_IF_ERROR(RunOptimizer(sa_optimizer, cluster, last_iteration,
+                                    &item, optimized_graph,
+                                    &optimization_result));
     GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
   }
 #endif
@@ -851,7 +990,11 @@ Status MetaOptimizer::OptimizeGraph(
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  optimization_result.wall_time_us = Env::Default()->NowMicros() - start_us;
+  {
+    mutex_lock l(optimization_results_mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -880,8 +1023,9 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
 }
 
 Status MetaOptimizer::RunOptimizer(
-    GraphOptimizer* optimizer, Cluster* cluster, GrapplerItem* optimized_item,
-    GraphDef* optimized_graph, GraphOptimizationResult* optimization_result) {
+    GraphOptimizer* optimizer, Cluster* cluster, int iteration,
+    GrapplerItem* optimized_item, GraphDef* optimized_graph,
+    GraphOptimizationResult* optimization_result) {
   // If optimizer doesn't need a function library, we will replace it with a
   // stub before running optimization, and will put it back at the end.
   std::unique_ptr<FunctionDefLibrary> optimized_graph_function_library;
@@ -906,9 +1050,21 @@ Status MetaOptimizer::RunOptimizer(
       {kGrapplerCategory, optimizer->name()});
   Status status =
       optimizer->Optimize(cluster, *optimized_item, optimized_graph);
-  auto duration_ms = timings.DurationMicroSec().value() / 1000.0f;
+  const int64_t duration_us = timings.DurationMicroSec().value();
+  auto duration_ms = duration_us / 1000.0f;
   timings.ReportAndStop();
 
+  OptimizationReport::PassReport report;
+  report.set_optimizer(optimizer->name());
+  report.set_iteration(iteration);
+  report.set_wall_time_us(duration_us);
+  report.set_status(status.code());
+  if (status.ok()) {
+    ReportChanges(optimized_item->graph, *optimized_graph, &report);
+  } else {
+    ReportChanges(optimized_item->graph, optimized_item->graph, &report);
+  }
+
   string message;
   if (!status.ok()) {
     *optimized_graph = std::move(optimized_item->graph);
@@ -940,7 +1096,8 @@ Status MetaOptimizer::RunOptimizer(
         optimized_graph_function_library.release());
   }
 
-  OptimizerResult optimizer_result{optimizer->name(), message, status};
+  OptimizerResult optimizer_result{optimizer->name(), message, status,
+                                   std::move(report)};
   optimization_result->results.push_back(optimizer_result);
 
   if (!status.ok()) {
@@ -1126,12 +1283,103 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   // True if this is a TPU graph using the old bridge.
   bool is_tpu_graph = IsLegacyTPUBridgeGraphDef(*optimized_graph);
 
+  // Optimizes the body of `func` into `*optimized_func_graph`, given the
+  // GrapplerFunctionItem `*func_item` made from it. Only reads `flib`, so that
+  // functions can be optimized concurrently.
+  const auto optimize_function =
+      [&](const FunctionDef& func, GrapplerFunctionItem* func_item,
+          GraphDef* optimized_func_graph) -> Status {
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+
+    const string& func_name = func.signature().name();
+
+    // Make a GrapplerItem from a FunctionDef.
+    TF_RETURN_IF_ERROR(
+        MakeGrapplerFunctionItem(func, flib, producer, func_item));
+
+    // If we need to compute the gradient of optimized function at runtime, we
+    // can't perform non-differentiable rewrites.
+    func_item->optimization_options().allow_non_differentiable_rewrites =
+        !differentiable_functions.contains(func_name);
+
+    // Device set available to the function is defined only by the runtime,
+    // when we instantiate and execute the function. We can't use all devices
+    // available to the main graph, because after partitioning the function
+    // call node might execute on a remote worker.
+    if (!func_item->devices().empty()) {
+      return errors::Internal("GrapplerFunctionItem devices must be empty.");
+    }
+
+    // We are not allowed to prune certain types of ops from the graph
+    // instantiated by the function definition, because we must guarantee
+    // function execution semantics wrt side effects (see
+    // function_optimizer.cc).
+    func_item->optimization_options().allow_pruning_stateful_and_dataset_ops =
+        false;
+
+    // Optimize function body graph.
+    if (is_tpu_graph) {
+      // Skip optimizing functions if this is a TPU graph. Currently, Grappler
+      // passes do not handle TPU functions correctly in a variety of ways
+      // (Note that due to the pre-placement TPU graph rewriting passes, the
+      // TPU-related ops are encapsulated away into functions). For example,
+      // TPU graphs contain TPUReplicateMetadata node that carries relevant
+      // TPU metadata and Grappler passes could prune that away. Grappler
+      // passes could also cause issues around shape inference. Since the
+      // desired and existing behavior is to not optimize TPU functions with
+      // Grappler, this check preserves that. The only exception is
+      // implementation selector what is required to swap in some TPU specific
+      // lowering code and is verified the work correctly on TPUs.
+      ImplementationSelector implementation_selector;
+
+      // Implementation selector needs to have access to valid function
+      // signature and attributes, and it doesn't need actual function body.
+      std::unique_ptr<FunctionDefLibrary> func_item_function_library(
+          func_item->graph.release_library());
+      *func_item->graph.mutable_library() =
+          GetFunctionDefLibraryStub(*func_item_function_library);
+
+      return implementation_selector.Optimize(cluster, *func_item,
+                                              optimized_func_graph);
+    }
+    GrapplerFunctionItem func_item_copy = *func_item;
+    return OptimizeGraph(cluster, std::move(func_item_copy),
+                         optimized_func_graph);
+  };
+
+  // Replaces `func_name` in `flib` with the function made from `*func_item`
+  // and its optimized body `*optimized_func_graph`.
+  const auto update_function = [&](const string& func_name,
+                                   GrapplerFunctionItem* func_item,
+                                   GraphDef* optimized_func_graph) -> Status {
+    // Function body optimization might have created new specialized
+    // functions for each instantiation context. Add them to the library.
+    for (const FunctionDef& func_def :
+         optimized_func_graph->library().function()) {
+      if (flib.Find(func_def.signature().name()) == nullptr) {
+        TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+      }
+    }
+
+    // Convert optimized graph back to FunctionDef.
+    FunctionDef optimized_func;
+    func_item->SwapFunctionBody(std::move(*optimized_func_graph));
+    TF_RETURN_IF_ERROR(MakeFunctionDef(*func_item, flib, &optimized_func));
+
+    // Replace optimized function with a new FunctionDef.
+    return flib.ReplaceFunction(func_name, optimized_func);
+  };
+
+  const int num_function_threads =
+      cfg_.experimental_function_optimization_threads();
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
 
-    int function_idx = 0;
+    // Functions to optimize in this pass over the library, in library order.
+    std::vector<const FunctionDef*> funcs;
     for (const FunctionDef& func : optimized_graph->library().function()) {
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
 
@@ -1155,86 +1403,66 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       if (data::IsTFDataFunction(func)) continue;
 
       VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
+              << funcs.size() << " of "
               << optimized_graph->library().function_size() << "]";
 
       // Function optimization might specialize nested function calls, so we
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs.push_back(&func);
+    }
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(
-          MakeGrapplerFunctionItem(func, flib, producer, &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
-      }
-
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (is_tpu_graph) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only exception is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        std::unique_ptr<FunctionDefLibrary> func_item_function_library(
-            func_item.graph.release_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(*func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
+    if (num_function_threads <= 1 || funcs.size() <= 1) {
+      for (const FunctionDef* func : funcs) {
+        GrapplerFunctionItem func_item;
+        GraphDef optimized_func_graph;
+        TF_RETURN_IF_ERROR(
+            optimize_function(*func, &func_item, &optimized_func_graph));
+        TF_RETURN_IF_ERROR(update_function(func->signature().name(),
+                                           &func_item, &optimized_func_graph));
       }
-
-      // Function body optimization might have created new specialized
-      // functions for each instantiation context. Add them to the library.
-      for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
-        if (flib.Find(func_def.signature().name()) == nullptr) {
-          TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+    } else {
+      // Optimize all functions of this pass concurrently, against the library
+      // as it was at the start of the pass. Results are then added to the
+      // library in library order, so that the output is deterministic.
+      std::vector<GrapplerFunctionItem> func_items(funcs.size());
+      std::vector<GraphDef> optimized_func_graphs(funcs.size());
+      std::vector<Status> statuses(funcs.size());
+      const size_t first_result = optimization_results_.size();
+      {
+        thread::ThreadPool pool(
+            Env::Default(), "grappler_function_optimization",
+            std::min<int>(num_function_threads, funcs.size()));
+        for (size_t i = 0; i < funcs.size(); ++i) {
+          pool.Schedule([&, i]() {
+            statuses[i] = optimize_function(*funcs[i], &func_items[i],
+                                            &optimized_func_graphs[i]);
+          });
         }
       }
+      for (size_t i = 0; i < funcs.size(); ++i) {
+        TF_RETURN_IF_ERROR(statuses[i]);
+        TF_RETURN_IF_ERROR(update_function(funcs[i]->signature().name(),
+                                           &func_items[i],
+                                           &optimized_func_graphs[i]));
+      }
 
-      // Convert optimized graph back to FunctionDef.
-      FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
-
-      // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
+      // Record the optimization results of the functions in library order too.
+      absl::flat_hash_map<string, size_t> func_order;
+      for (size_t i = 0; i < funcs.size(); ++i) {
+        func_order[funcs[i]->signature().name()] = i;
+      }
+      const auto result_order = [&](const GraphOptimizationResult& result) {
+        auto it = func_order.find(result.id);
+        return it == func_order.end() ? funcs.size() : it->second;
+      };
+      std::stable_sort(optimization_results_.begin() + first_result,
+                       optimization_results_.end(),
+                       [&](const GraphOptimizationResult& a,
+                           const GraphOptimizationResult& b) {
+                         return result_order(a) < result_order(b);
+                       });
     }
 
     // If optimized at least one function, update the graph library.
@@ -1297,6 +1525,19 @@ string MetaOptimizer::GetResultString() const {
 
 void MetaOptimizer::PrintResult() { VLOG(1) << GetResultString(); }
 
+OptimizationReport MetaOptimizer::GetOptimizationReport() const {
+  OptimizationReport report;
+  for (const GraphOptimizationResult& graph_result : optimization_results_) {
+    OptimizationReport::ItemReport* item = report.add_items();
+    item->set_id(graph_result.id);
+    item->set_wall_time_us(graph_result.wall_time_us);
+    for (const OptimizerResult& result : graph_result.results) {
+      *item->add_passes() = result.report;
+    }
+  }
+  return report;
+}
+
 bool MetaOptimizerEnabled(const ConfigProto& cfg) {
   const auto& rewrite_cfg = cfg.graph_options().rewrite_options();
   if (rewrite_cfg.disable_meta_optimizer()) {
@@ -1315,6 +1556,7 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
          rewrite_cfg.auto_parallel().enable() ||
          rewrite_cfg.memory_optimization() != RewriterConfig::NO_MEM_OPT ||
          rewrite_cfg.debug_stripper() == RewriterConfig::ON ||
+         rewrite_cfg.horizontal_batching() == RewriterConfig::ON ||
 #ifndef ENABLE_MKL
          rewrite_cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
 #endif
@@ -1332,8 +1574,10 @@ Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
   MetaOptimizer optimizer(cpu_device, cfg);
   optimizer.set_deadline_usec(
       DeadlineMicroSeconds(cfg.graph_options().rewrite_options()));
-  return optimizer.OptimizeConsumeItem(cluster, std::move(item),
-                                       optimized_graph);
+  Status status =
+      optimizer.OptimizeConsumeItem(cluster, std::move(item), optimized_graph);
+  ExportOptimizationReport(optimizer.GetOptimizationReport());
+  return status;
 }
 
 Status OptimizeGraph(
@@ -1367,16 +1611,32 @@ Status OptimizeGraph(
 
   (*g)->ToGraphDef(&item.graph);
 
-  if (flib) {
-    *item.graph.mutable_library() = flib->ToProto();
+  // Instantiations of the same function get the same optimized graph, which
+  // is looked up before adding the function library to the item.
+  OptimizedGraphCache* cache = OptimizedGraphCache::Global();
+  string cache_key;
+  if (cache->capacity() > 0) {
+    cache_key =
+        OptimizedGraphCache::ComputeKey(item, flib, device_set, config_proto);
   }
 
   tensorflow::GraphDef out_graph;
-  tensorflow::grappler::VirtualCluster cluster(&device_set);
-  // TODO(nareshmodi): Consider adding and using the more generic GraphOptions
-  // proto (which also contain the OptimizerOptions).
-  TF_RETURN_IF_ERROR(tensorflow::grappler::RunMetaOptimizer(
-      std::move(item), config_proto, cpu_device, &cluster, &out_graph));
+  const bool cache_hit =
+      !cache_key.empty() && cache->Lookup(cache_key, &out_graph);
+  if (cache_hit) {
+    VLOG(1) << "Reusing the optimized graph of grappler item: "
+            << grappler_item_id;
+  } else {
+    if (flib) {
+      *item.graph.mutable_library() = flib->ToProto();
+    }
+
+    tensorflow::grappler::VirtualCluster cluster(&device_set);
+    // TODO(nareshmodi): Consider adding and using the more generic
+    // GraphOptions proto (which also contain the OptimizerOptions).
+    TF_RETURN_IF_ERROR(tensorflow::grappler::RunMetaOptimizer(
+        std::move(item), config_proto, cpu_device, &cluster, &out_graph));
+  }
 
   std::unique_ptr<tensorflow::Graph> optimized_graph(
       new tensorflow::Graph(OpRegistry::Global()));
@@ -1396,6 +1656,21 @@ Status OptimizeGraph(
     }
   }
 
+  if (!cache_key.empty() && !cache_hit) {
+    // Only the optimized functions reachable from the graph are needed to run
+    // it, instead of the whole library returned by the optimizers.
+    GraphDef cached_graph;
+    *cached_graph.mutable_node() = out_graph.node();
+    *cached_graph.mutable_versions() = out_graph.versions();
+    if (flib) {
+      *cached_graph.mutable_library() =
+          flib->ReachableDefinitions(out_graph).ToProto();
+    } else {
+      *cached_graph.mutable_library() = out_graph.library();
+    }
+    cache->Insert(cache_key, std::move(cached_graph));
+  }
+
   TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(
       GraphConstructorOptions(), std::move(out_graph), optimized_graph.get()));
 
@@ -24,7 +24,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
 #include "tensorflow/core/grappler/verifiers/graph_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/optimization_report.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/protobuf/verifier_config.pb.h"
 
@@ -54,6 +56,10 @@ class MetaOptimizer : public GraphOptimizer {
 
   void PrintResult();
 
+  // Returns the metrics of each optimizer pass over each graph in the last
+  // call to Optimize().
+  OptimizationReport GetOptimizationReport() const;
+
  private:
   std::unique_ptr<GraphOptimizer> MakeNewOptimizer(
       const string& optimizer, const std::set<string>& device_types) const;
@@ -106,18 +112,23 @@ class MetaOptimizer : public GraphOptimizer {
     string optimizer_name;
     string message;
     Status status;
+    OptimizationReport::PassReport report;
   };
 
   struct GraphOptimizationResult {
     explicit GraphOptimizationResult(const string& id) : id(id) {}
     string id;
     std::vector<OptimizerResult> results;
+    int64_t wall_time_us = 0;
   };
 
   Status RunOptimizer(GraphOptimizer* optimizer, Cluster* cluster,
-                      GrapplerItem* optimized_item, GraphDef* optimized_graph,
+                      int iteration, GrapplerItem* optimized_item,
+                      GraphDef* optimized_graph,
                       GraphOptimizationResult* optimization_result);
 
+  // Functions of the library may be optimized concurrently.
+  mutex optimization_results_mu_;
   std::vector<GraphOptimizationResult> optimization_results_;
 };
 
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -255,6 +256,69 @@ TEST_F(MetaOptimizerTest, RunToggleOptimizersAndCustomGraphOptimizerTwice) {
   EXPECT_TRUE(TestGraphOptimizer::IsOptimized());
 }
 
+TEST_F(MetaOptimizerTest, OptimizationReport) {
+  tensorflow::Scope scope = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(scope.WithOpName("a"), 1.0f, {2});
+  Output b = ops::Const(scope.WithOpName("b"), 2.0f, {2});
+  Output c = ops::Add(scope.WithOpName("c"), a, b);
+  Output x = ops::Placeholder(scope.WithOpName("x"), DT_FLOAT);
+  Output y = ops::Mul(scope.WithOpName("y"), x, c);
+
+  GrapplerItem item;
+  item.id = "main";
+  item.fetch = {"y"};
+  TF_CHECK_OK(scope.ToGraphDef(&item.graph));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const OptimizationReport report = optimizer.GetOptimizationReport();
+  ASSERT_GE(report.items_size(), 1);
+  const OptimizationReport::ItemReport& main_graph = report.items(0);
+  EXPECT_EQ(main_graph.id(), "main");
+  ASSERT_GT(main_graph.passes_size(), 0);
+  int64_t pass_time_us = 0;
+  bool folded_constants = false;
+  for (const OptimizationReport::PassReport& pass : main_graph.passes()) {
+    EXPECT_FALSE(pass.optimizer().empty());
+    EXPECT_GE(pass.iteration(), 0);
+    EXPECT_LT(pass.iteration(), 2);
+    EXPECT_EQ(pass.num_nodes_after() - pass.num_nodes_before(),
+              pass.num_nodes_added() - pass.num_nodes_removed());
+    EXPECT_GT(pass.graph_bytes_after(), 0);
+    if (pass.status() != error::OK) {
+      EXPECT_EQ(pass.num_nodes_before(), pass.num_nodes_after());
+      EXPECT_EQ(pass.num_nodes_added() + pass.num_nodes_removed() +
+                    pass.num_nodes_modified(),
+                0);
+    }
+    if (pass.optimizer() == "constant_folding" && pass.iteration() == 0) {
+      // `c` is folded into a constant.
+      EXPECT_EQ(pass.status(), error::OK);
+      EXPECT_GT(pass.num_nodes_removed() + pass.num_nodes_modified(), 0);
+      folded_constants = true;
+    }
+    pass_time_us += pass.wall_time_us();
+  }
+  EXPECT_TRUE(folded_constants);
+  EXPECT_GE(main_graph.wall_time_us(), pass_time_us);
+
+  // RunMetaOptimizer exports the report to the monitoring gauges.
+  monitoring::testing::CellReader<int64_t> changed_nodes(
+      "/tensorflow/core/grappler/pass_changed_nodes");
+  GraphDef exported_output;
+  TF_ASSERT_OK(RunMetaOptimizer(GrapplerItem(item), config_proto, nullptr,
+                                nullptr, &exported_output));
+  EXPECT_GT(changed_nodes.Read("constant_folding"), 0);
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   using test::function::NDef;
 
@@ -420,6 +484,112 @@ TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   test::ExpectTensorEqual<int>(tensors_expected[1], tensors[1]);
 }
 
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  using test::function::NDef;
+
+  // Enable only function optimization, with functions optimized in parallel.
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  rewriter_config.set_function_optimization(RewriterConfig::ON);
+  rewriter_config.add_optimizers("function");
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_experimental_function_optimization_threads(4);
+
+  // Define function library:
+  //
+  //   MyMul(x, y)    = x * y
+  //  *MySquare_i(x)  = MyMul(x, x)  for i in [0, kNumFuncs)
+  //
+  //  * - marked as noinline
+  constexpr int kNumFuncs = 8;
+  std::vector<FunctionDef> funcs = {FunctionDefHelper::Create(
+      "MyMul", {"x:T", "y:T"}, {"z:T"}, {"T: {float, int32}"},
+      {{{"mul"}, "Mul", {"x", "y"}, {{"T", "$T"}}}},
+      /*ret_def=*/
+      {{"z", "mul:z:0"}})};
+
+  // Each square function is called once, and its specialization is optimized
+  // concurrently with the others.
+  std::vector<NodeDef> nodes = {
+      NDef("a", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  for (int i = 0; i < kNumFuncs; ++i) {
+    const string func_name = absl::StrCat("MySquare_", i);
+    FunctionDef square_func = FunctionDefHelper::Create(
+        func_name, {"x:T"}, {"z:T"}, {"T: {float, int32}"},
+        {{{"my_mul"}, "MyMul", {"x", "x"}, {{"T", "$T"}}}},
+        /*ret_def=*/
+        {{"z", "my_mul:z:0"}});
+    (*square_func.mutable_attr())["_noinline"].set_b(true);
+    funcs.push_back(std::move(square_func));
+
+    const string input = nodes.back().name();
+    nodes.push_back(NDef(absl::StrCat("square_", i), func_name, {input},
+                         {{"T", DT_FLOAT}}, kDevice));
+  }
+  nodes.push_back(NDef("out", "Identity", {nodes.back().name()},
+                       {{"T", DT_FLOAT}}, kDevice));
+
+  GrapplerItem item;
+  item.id = "tf_graph";
+  item.graph = test::function::GDef(nodes, funcs);
+
+  GraphDef output;
+  MetaOptimizer optimizer(nullptr, config_proto);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  FunctionLibraryDefinition optimized_flib(OpRegistry::Global(),
+                                           output.library());
+  EXPECT_EQ(kNumFuncs, optimized_flib.num_functions());
+
+  // Every call node calls its own specialization, with MyMul inlined.
+  int num_calls = 0;
+  for (const NodeDef& node : output.node()) {
+    if (!absl::StartsWith(node.name(), "square_")) continue;
+    ++num_calls;
+    EXPECT_EQ(absl::Substitute("MySquare_$0_specialized_for_$1_at_tf_graph",
+                               node.name().substr(7), node.name()),
+              node.op());
+    const FunctionDef* optimized_func = optimized_flib.Find(node.op());
+    ASSERT_NE(optimized_func, nullptr);
+    int count = 0;
+    for (const NodeDef& func_node : optimized_func->node_def()) {
+      if (func_node.name() == "my_mul/mul") {
+        ++count;
+        EXPECT_EQ("Mul", func_node.op());
+      }
+    }
+    EXPECT_EQ(1, count);
+  }
+  EXPECT_EQ(kNumFuncs, num_calls);
+
+  // The optimized library doesn't depend on how functions were scheduled.
+  GraphDef other_output;
+  MetaOptimizer other_optimizer(nullptr, config_proto);
+  TF_EXPECT_OK(other_optimizer.Optimize(nullptr, item, &other_output));
+  ASSERT_EQ(output.library().function_size(),
+            other_output.library().function_size());
+  for (const FunctionDef& func : output.library().function()) {
+    const FunctionDef* other_func = nullptr;
+    for (const FunctionDef& f : other_output.library().function()) {
+      if (f.signature().name() == func.signature().name()) other_func = &f;
+    }
+    ASSERT_NE(other_func, nullptr);
+    EXPECT_TRUE(FunctionDefsEqual(func, *other_func));
+  }
+
+  item.fetch = {"out"};
+  item.feed.emplace_back("a", test::AsScalar<float>(1.5f));
+  auto tensors_expected = EvaluateFetchNodes(item);
+
+  GrapplerItem optimized = item.WithGraph(std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryPruneUnusedOutputs) {
   using test::function::NDef;
 
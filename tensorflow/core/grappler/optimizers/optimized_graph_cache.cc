@@ -0,0 +1,151 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Appends the deterministic serialization of `proto` to `*out`, prefixed by
+// its length so that the fields of the key cannot run into each other.
+void AppendProto(const protobuf::MessageLite& proto, std::string* out) {
+  std::string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  strings::StrAppend(out, serialized.size(), ":", serialized);
+}
+
+void AppendString(const std::string& s, std::string* out) {
+  strings::StrAppend(out, s.size(), ":", s);
+}
+
+void AppendStrings(const std::vector<std::string>& strings, std::string* out) {
+  strings::StrAppend(out, strings.size(), ";");
+  for (const std::string& s : strings) {
+    AppendString(s, out);
+  }
+}
+
+}  // namespace
+
+OptimizedGraphCache::OptimizedGraphCache(int64_t capacity)
+    : capacity_(capacity) {}
+
+OptimizedGraphCache* OptimizedGraphCache::Global() {
+  static OptimizedGraphCache* cache = [] {
+    int64_t capacity;
+    Status s = ReadInt64FromEnvVar("TF_GRAPPLER_OPTIMIZED_GRAPH_CACHE_SIZE",
+                                   /*default_val=*/64, &capacity);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      capacity = 64;
+    }
+    return new OptimizedGraphCache(std::max<int64_t>(capacity, 0));
+  }();
+  return cache;
+}
+
+std::string OptimizedGraphCache::ComputeKey(
+    const GrapplerItem& item, const FunctionLibraryDefinition* flib,
+    const DeviceSet& device_set, const ConfigProto& config) {
+  std::string data;
+  AppendString(item.id, &data);
+  for (const NodeDef& node : item.graph.node()) {
+    AppendProto(node, &data);
+  }
+  AppendProto(item.graph.versions(), &data);
+  if (flib != nullptr) {
+    AppendProto(flib->ReachableDefinitions(item.graph).ToProto(), &data);
+  }
+  AppendStrings(item.fetch, &data);
+  AppendStrings(item.keep_ops, &data);
+
+  const GrapplerItem::OptimizationOptions& options =
+      item.optimization_options();
+  strings::StrAppend(&data, options.allow_non_differentiable_rewrites,
+                     options.allow_pruning_stateful_and_dataset_ops,
+                     options.optimize_function_library, options.is_eager_mode,
+                     options.assume_valid_feeds, ";");
+
+  // The device properties seen by the optimizers are derived from the device
+  // attributes, except for the incarnation which is unique to every device.
+  std::vector<std::string> devices;
+  for (const Device* device : device_set.devices()) {
+    const DeviceAttributes& attributes = device->attributes();
+    devices.push_back(strings::StrCat(
+        attributes.name(), ";", attributes.device_type(), ";",
+        attributes.memory_limit(), ";", attributes.physical_device_desc()));
+  }
+  std::sort(devices.begin(), devices.end());
+  AppendStrings(devices, &data);
+  AppendProto(config, &data);
+
+  const Fprint128 fingerprint = Fingerprint128(data);
+  return strings::StrCat(strings::Hex(fingerprint.high64, strings::kZeroPad16),
+                         strings::Hex(fingerprint.low64, strings::kZeroPad16));
+}
+
+bool OptimizedGraphCache::Lookup(const std::string& key,
+                                 GraphDef* optimized_graph) {
+  std::shared_ptr<const GraphDef> graph;
+  {
+    mutex_lock l(mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    graph = it->second->second;
+  }
+  // Copy outside of the lock, the cached graph is immutable.
+  *optimized_graph = *graph;
+  return true;
+}
+
+void OptimizedGraphCache::Insert(const std::string& key,
+                                 GraphDef optimized_graph) {
+  if (capacity_ == 0) return;
+  auto graph = std::make_shared<const GraphDef>(std::move(optimized_graph));
+  mutex_lock l(mu_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  entries_.emplace_front(key, std::move(graph));
+  index_[key] = entries_.begin();
+  while (static_cast<int64_t>(entries_.size()) > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+int64_t OptimizedGraphCache::size() const {
+  mutex_lock l(mu_);
+  return entries_.size();
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
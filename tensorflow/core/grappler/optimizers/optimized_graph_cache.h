@@ -0,0 +1,91 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A process-wide cache of the graphs that Grappler produces for function
+// instantiations (see `OptimizeGraph()` in meta_optimizer.h).
+//
+// The same function is often instantiated many times, e.g. for every tf.data
+// iterator that runs it or for every eager context that calls it, and each
+// instantiation reruns the whole optimizer pipeline although the result is
+// the same. Results are keyed by everything that Grappler output depends on:
+// the function graph and the functions reachable from it, the fetch and keep
+// nodes, the optimization options, the available devices and the session
+// config. The least recently used entries are evicted once the cache holds
+// `capacity` graphs.
+class OptimizedGraphCache {
+ public:
+  explicit OptimizedGraphCache(int64_t capacity);
+
+  // Returns the cache used by `OptimizeGraph()`. Its capacity is read from
+  // the TF_GRAPPLER_OPTIMIZED_GRAPH_CACHE_SIZE environment variable, and
+  // defaults to 64 graphs; a capacity of 0 disables caching.
+  static OptimizedGraphCache* Global();
+
+  // Returns the key of the graph produced for `item`, whose function library
+  // is `flib`, when optimizing for `device_set` with `config`. The library of
+  // `item.graph` itself is ignored. `flib` may be null.
+  static std::string ComputeKey(const GrapplerItem& item,
+                                const FunctionLibraryDefinition* flib,
+                                const DeviceSet& device_set,
+                                const ConfigProto& config);
+
+  // Copies the graph cached for `key` into `*optimized_graph`. Returns false
+  // if there is none.
+  bool Lookup(const std::string& key, GraphDef* optimized_graph);
+
+  // Caches `optimized_graph` for `key`, replacing any existing entry.
+  void Insert(const std::string& key, GraphDef optimized_graph);
+
+  int64_t capacity() const { return capacity_; }
+  int64_t size() const;
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<const GraphDef>>;
+
+  const int64_t capacity_;
+
+  mutable mutex mu_;
+  // Most recently used entries first.
+  std::list<Entry> entries_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, std::list<Entry>::iterator> index_
+      TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(OptimizedGraphCache);
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
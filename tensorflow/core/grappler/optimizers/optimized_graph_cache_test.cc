@@ -0,0 +1,170 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include <memory>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+class FakeDevice : public Device {
+ public:
+  explicit FakeDevice(const DeviceAttributes& attributes)
+      : Device(nullptr, attributes) {}
+
+  Status Sync() override { return OkStatus(); }
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return nullptr;
+  }
+
+  static std::unique_ptr<Device> Make(const string& name, uint64 incarnation) {
+    DeviceAttributes attributes;
+    attributes.set_name(name);
+    attributes.set_device_type(DEVICE_CPU);
+    attributes.set_incarnation(incarnation);
+    return std::make_unique<FakeDevice>(attributes);
+  }
+};
+
+GrapplerItem MakeItem() {
+  GrapplerItem item;
+  item.id = "f";
+  item.graph = test::function::GDef(
+      {NDef("x", "_Arg", {}, {{"T", DT_FLOAT}, {"index", 0}}),
+       NDef("y", "XTimesTwo", {"x"}, {{"T", DT_FLOAT}}),
+       NDef("z", "_Retval", {"y"}, {{"T", DT_FLOAT}, {"index", 0}})},
+      {});
+  item.fetch = {"z"};
+  return item;
+}
+
+GraphDef MakeGraph(const string& node_name) {
+  return test::function::GDef({NDef(node_name, "NoOp", {}, {})}, {});
+}
+
+TEST(OptimizedGraphCacheTest, ComputeKey) {
+  FunctionDefLibrary library;
+  *library.add_function() = test::function::XTimesTwo();
+  FunctionLibraryDefinition flib(OpRegistry::Global(), library);
+  std::unique_ptr<Device> device = FakeDevice::Make("/device:CPU:0", 1);
+  DeviceSet device_set;
+  device_set.AddDevice(device.get());
+  ConfigProto config;
+
+  const GrapplerItem item = MakeItem();
+  const string key =
+      OptimizedGraphCache::ComputeKey(item, &flib, device_set, config);
+  EXPECT_EQ(key.size(), 32);
+  EXPECT_EQ(key,
+            OptimizedGraphCache::ComputeKey(item, &flib, device_set, config));
+
+  // Functions that are not reachable from the graph and device incarnations
+  // do not change the optimized graph.
+  FunctionDefLibrary larger_library = library;
+  *larger_library.add_function() = test::function::XTimesFour();
+  FunctionLibraryDefinition larger_flib(OpRegistry::Global(), larger_library);
+  EXPECT_EQ(key, OptimizedGraphCache::ComputeKey(item, &larger_flib,
+                                                 device_set, config));
+  std::unique_ptr<Device> restarted_device =
+      FakeDevice::Make("/device:CPU:0", 2);
+  DeviceSet restarted_device_set;
+  restarted_device_set.AddDevice(restarted_device.get());
+  EXPECT_EQ(key, OptimizedGraphCache::ComputeKey(item, &flib,
+                                                 restarted_device_set, config));
+
+  // Everything else does.
+  FunctionDefLibrary other_library;
+  *other_library.add_function() = test::function::XTimesTwoInt32();
+  other_library.mutable_function(0)->mutable_signature()->set_name(
+      "XTimesTwo");
+  FunctionLibraryDefinition other_flib(OpRegistry::Global(), other_library);
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(item, &other_flib,
+                                                 device_set, config));
+  EXPECT_NE(key,
+            OptimizedGraphCache::ComputeKey(item, nullptr, device_set, config));
+
+  GrapplerItem other_item = MakeItem();
+  other_item.fetch.clear();
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(other_item, &flib,
+                                                 device_set, config));
+  other_item = MakeItem();
+  other_item.optimization_options().is_eager_mode = true;
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(other_item, &flib,
+                                                 device_set, config));
+  other_item = MakeItem();
+  other_item.optimization_options().assume_valid_feeds = true;
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(other_item, &flib,
+                                                 device_set, config));
+
+  std::unique_ptr<Device> other_device = FakeDevice::Make("/device:CPU:1", 1);
+  device_set.AddDevice(other_device.get());
+  EXPECT_NE(key,
+            OptimizedGraphCache::ComputeKey(item, &flib, device_set, config));
+
+  ConfigProto other_config;
+  other_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(item, &flib,
+                                                 restarted_device_set,
+                                                 other_config));
+}
+
+TEST(OptimizedGraphCacheTest, LookupAndInsert) {
+  OptimizedGraphCache cache(/*capacity=*/2);
+  GraphDef graph;
+  EXPECT_FALSE(cache.Lookup("a", &graph));
+
+  cache.Insert("a", MakeGraph("a"));
+  cache.Insert("b", MakeGraph("b"));
+  ASSERT_TRUE(cache.Lookup("a", &graph));
+  EXPECT_EQ(graph.node(0).name(), "a");
+  EXPECT_EQ(cache.size(), 2);
+
+  // "b" is the least recently used entry.
+  cache.Insert("c", MakeGraph("c"));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(cache.Lookup("b", &graph));
+  EXPECT_TRUE(cache.Lookup("a", &graph));
+  ASSERT_TRUE(cache.Lookup("c", &graph));
+  EXPECT_EQ(graph.node(0).name(), "c");
+
+  cache.Insert("c", MakeGraph("d"));
+  EXPECT_EQ(cache.size(), 2);
+  ASSERT_TRUE(cache.Lookup("c", &graph));
+  EXPECT_EQ(graph.node(0).name(), "d");
+}
+
+TEST(OptimizedGraphCacheTest, ZeroCapacity) {
+  OptimizedGraphCache cache(/*capacity=*/0);
+  cache.Insert("a", MakeGraph("a"));
+  GraphDef graph;
+  EXPECT_FALSE(cache.Lookup("a", &graph));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
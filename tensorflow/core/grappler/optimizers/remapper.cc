@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_join.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/graph_view.h"
@@ -34,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/util/util.h"
 
 #if GOOGLE_CUDA
+#include "third_party/gpus/cuda/include/cuda.h"
 #include "third_party/gpus/cudnn/cudnn.h"
 #endif  // GOOGLE_CUDA
 
@@ -59,8 +61,10 @@ namespace grappler {
 //
 // Sigmoid + Mul -> _MklSwish  // This fusion only works on Intel CPU.
 //
+// ResizeBilinear[T=uint8] + Sub + Mul -> _FusedResizeBilinear  // CPU only.
 //
-// In all cases, the supported activation functions are Relu, Relu6, and Elu.
+//
+// The activations supported by each pattern are listed in kFusedActivations.
 //
 // Both Conv2D and MatMul implemented as Tensor contraction (on CPU), so all the
 // patterns are "ContractionWith...".
@@ -73,6 +77,7 @@ constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
 constexpr char kFusedBatchNormGradEx[] = "_FusedBatchNormGradEx";
 constexpr char kTensorToHashBucket[] = "_TensorToHashBucketFast";
+constexpr char kFusedResizeBilinear[] = "_FusedResizeBilinear";
 
 constexpr char kDataFormat[] = "data_format";
 constexpr char kIsTraining[] = "is_training";
@@ -143,6 +148,30 @@ struct TensorToHashBucket {
   int string_to_hash_bucket = kMissingIndex;
 };
 
+// Gather of embedding rows whose only consumer is a sparse segment reduction.
+// The reduction can read the rows from the params directly, so that the
+// gathered [num_ids, dim] tensor is never materialized.
+struct SparseSegmentReductionOfGather {
+  SparseSegmentReductionOfGather() = default;
+  SparseSegmentReductionOfGather(int gather, int sparse_segment_reduction)
+      : gather(gather), sparse_segment_reduction(sparse_segment_reduction) {}
+
+  int gather = kMissingIndex;
+  int sparse_segment_reduction = kMissingIndex;
+};
+
+// Mul(Sub(ResizeBilinear(images, size), mean), scale) on a uint8 image, the
+// usual normalization of an image preprocessing graph.
+struct ResizeBilinearWithNormalize {
+  ResizeBilinearWithNormalize() = default;
+
+  int resize_bilinear = kMissingIndex;
+  int sub = kMissingIndex;
+  int mul = kMissingIndex;
+  int mean = kMissingIndex;
+  int scale = kMissingIndex;
+};
+
 // Pad followed by Conv3D/FusedConv3D
 struct PadWithConv3D {
   PadWithConv3D() = default;
@@ -264,6 +293,20 @@ struct ContractionWithBiasAndAddActivation {
   int bias_port = 1;
 };
 
+// A chain of elementwise ops that can be fused into a _FusedElementwise node.
+struct FusedElementwise {
+  FusedElementwise() = default;
+
+  // The fused nodes, from the root of the chain to its head.
+  std::vector<int> nodes;
+  // The input of the head of the chain.
+  string input;
+  // The ops of the chain and the arguments of its binary ops, in the order
+  // in which they are applied.
+  std::vector<string> op_names;
+  std::vector<string> args;
+};
+
 bool IsInPreserveSet(const RemapperContext& ctx, const NodeDef* node) {
   return ctx.nodes_to_preserve.count(node->name()) > 0;
 }
@@ -340,6 +383,15 @@ bool BlasLtMatmulEnabled() {
   return is_enabled;
 }
 
+// The cuBLASLt GELU epilogue is only available from CUDA 11.4 onward.
+bool BlasLtGeluEpilogueEnabled() {
+#if GOOGLE_CUDA && CUDA_VERSION >= 11040
+  return BlasLtMatmulEnabled();
+#else
+  return false;
+#endif  // GOOGLE_CUDA && CUDA_VERSION >= 11040
+}
+
 bool IsGpuCompatibleDataFormat(const RemapperContext& ctx,
                                const NodeDef* conv2d) {
   DCHECK(IsConv2D(*conv2d)) << "Expected Conv2D op";
@@ -473,11 +525,57 @@ bool IsDeviceCompatible(const RemapperContext& ctx, Pattern& matched) {
   return IsCpuCompatible(ctx, matched) || IsGpuCompatible(ctx, matched);
 }
 
+// Masks of the contraction ops that support a fused activation.
+constexpr int kConv2DMask = 1 << 0;
+constexpr int kDepthwiseConv2dNativeMask = 1 << 1;
+constexpr int kMatMulMask = 1 << 2;
+constexpr int kConv3DMask = 1 << 3;
+constexpr int kAnyContractionMask = kConv2DMask | kDepthwiseConv2dNativeMask |
+                                    kMatMulMask | kConv3DMask;
+
+// Activation that the fused contraction kernels can apply to their output,
+// with the contractions that support it after each of the fused ops. Adding a
+// new activation to the fused kernels only requires a new entry here.
+struct FusedActivation {
+  const char* op;
+  bool mkl_only;
+  int with_bias_add;          // Contraction + BiasAdd + Activation.
+  int with_batch_norm;        // Contraction + FusedBatchNorm + Activation.
+  int with_bias_add_and_add;  // Contraction + BiasAdd + Add + Activation.
+};
+
+constexpr FusedActivation kFusedActivations[] = {
+    {"Relu", false, kAnyContractionMask, kConv2DMask, kAnyContractionMask},
+    {"Relu6", false, kAnyContractionMask, kConv2DMask, kAnyContractionMask},
+    {"Elu", false, kAnyContractionMask, kConv2DMask, kAnyContractionMask},
+    {"LeakyRelu", false, kConv2DMask | kMatMulMask | kConv3DMask, kConv2DMask,
+     kConv2DMask | kConv3DMask},
+    {"Tanh", true, kMatMulMask, kConv2DMask, 0},
+    {"Sigmoid", true, kMatMulMask, 0, 0},
+};
+
+// Returns the fused activation computed by `node`, or nullptr if `node` is not
+// an activation supported on this build.
+const FusedActivation* FindFusedActivation(const NodeDef& node) {
+  for (const FusedActivation& activation : kFusedActivations) {
+    if (node.op() == activation.op &&
+        (!activation.mkl_only || IsMKLEnabled())) {
+      return &activation;
+    }
+  }
+  return nullptr;
+}
+
+int ContractionMask(const NodeDef& contraction) {
+  if (IsConv2D(contraction)) return kConv2DMask;
+  if (IsDepthwiseConv2dNative(contraction)) return kDepthwiseConv2dNativeMask;
+  if (IsMatMul(contraction)) return kMatMulMask;
+  if (IsConv3D(contraction)) return kConv3DMask;
+  return 0;
+}
+
 bool IsSupportedActivation(const NodeDef& node) {
-  bool is_default_supported =
-      IsRelu(node) || IsRelu6(node) || IsElu(node) || IsLeakyRelu(node);
-  bool is_mkl_specific = IsMKLEnabled() && (IsTanh(node) || IsSigmoid(node));
-  return (is_default_supported || is_mkl_specific);
+  return FindFusedActivation(node) != nullptr;
 }
 
 inline bool HasControlFaninOrFanout(const utils::MutableNodeView& node_view) {
@@ -660,7 +758,8 @@ bool FindContractionWithBiasAndActivation(
   if (HasControlFaninOrFanout(*node_view)) return false;
 
   const auto* node_def = node_view->node();
-  if (!IsSupportedActivation(*node_def)) return false;
+  const FusedActivation* activation = FindFusedActivation(*node_def);
+  if (activation == nullptr) return false;
 
   // And input to the activation node must match ContractionWithBiasAdd pattern.
   if (node_view->NumRegularFanins() < 1) return false;
@@ -681,15 +780,7 @@ bool FindContractionWithBiasAndActivation(
       bias_add_node_view->GetRegularFanin(1 - base.bias_port).node_view();
   const auto* contraction_node_def = contraction_node_view->node();
 
-  // Currently, only matmul + bias + (tanh or Sigmoid) is enabled
-  if (!IsMatMul(*contraction_node_def) &&
-      (IsTanh(*node_def) || IsSigmoid(*node_def)))
-    return false;
-
-  // Currently, only (conv | matmul) + bias + leakyrelu is enabled
-  if (!(IsConv2D(*contraction_node_def) || IsMatMul(*contraction_node_def) ||
-        (IsConv3D(*contraction_node_def) && IsMKLEnabled())) &&
-      IsLeakyRelu(*node_def))
+  if (!(activation->with_bias_add & ContractionMask(*contraction_node_def)))
     return false;
 
   // Check that data type and data format are supported on assigned device.
@@ -823,11 +914,8 @@ bool FindConv2DWithBatchNormAndActivation(
 
   // Root of the pattern must be an activation node.
   const auto* node_def = node_view->node();
-  if (!IsSupportedActivation(*node_def)) return false;
-
-  // Need to test and enable in Kernel Op before enabling
-  // this activation TODO(intel-tf)
-  if (IsSigmoid(*node_def)) return false;
+  const FusedActivation* activation = FindFusedActivation(*node_def);
+  if (activation == nullptr) return false;
 
   // And input to the activation node must match Conv2DWithBatchNorm pattern.
   if (node_view->NumRegularFanins() < 1) return false;
@@ -838,6 +926,11 @@ bool FindConv2DWithBatchNormAndActivation(
   if (!FindConv2DWithBatchNorm(ctx, batch_norm_node_view->node_index(), &base))
     return false;
 
+  const NodeDef& contraction_node_def =
+      ctx.graph_view.graph()->node(base.contraction);
+  if (!(activation->with_batch_norm & ContractionMask(contraction_node_def)))
+    return false;
+
   const auto* fused_batch_norm_node_view =
       ctx.graph_view.GetNode(base.fused_batch_norm);
   const auto* fused_batch_norm_node_def = fused_batch_norm_node_view->node();
@@ -980,17 +1073,11 @@ bool FindContractionWithBiasAndAddActivation(
   // Root of the pattern must be an activation node.
   const auto* node_def = node_view->node();
   if (node_def == nullptr) return false;
-  if (!IsSupportedActivation(*node_def)) return false;
+  const FusedActivation* activation = FindFusedActivation(*node_def);
+  if (activation == nullptr || !activation->with_bias_add_and_add) return false;
 
   if (!NodeIsOnCpu(node_def)) return false;
 
-  // Currently, Contraction + Bias + Add + Tanh pattern is not supported
-  if (IsTanh(*node_def)) return false;
-
-  // Need to test and enable in Kernel Op before enabling
-  // this activation. TODO(intel-tf)
-  if (IsSigmoid(*node_def)) return false;
-
   // MKL activation op only supports float and bfloat16 data types.
   if (!HasDataType(node_def, DT_FLOAT) && !HasDataType(node_def, DT_BFLOAT16))
     return false;
@@ -1013,9 +1100,8 @@ bool FindContractionWithBiasAndAddActivation(
       bias_add_node_view->GetRegularFanin(0).node_view();
   const auto* contraction_node_def = contraction_node_view->node();
 
-  // Currently, only conv + bias + add + leakyrelu is enabled
-  if (!(IsConv2D(*contraction_node_def) || IsConv3D(*contraction_node_def)) &&
-      IsLeakyRelu(*node_def))
+  if (!(activation->with_bias_add_and_add &
+        ContractionMask(*contraction_node_def)))
     return false;
   // Conv3D fusion is available with oneDNN enabled
   if (IsConv3D(*contraction_node_def) && !IsMKLEnabled()) return false;
@@ -1066,8 +1152,9 @@ bool FindMatMulBiasAddAndGelu(RemapperContext* ctx, int node_index,
                               std::map<string, int>* matched_nodes_map,
                               std::set<int>* remove_node_indices,
                               bool* is_gelu_approximate) {
-  // Gelu fusion is enabled only with oneDNN library.
-  if (!IsMKLEnabled()) return false;
+  // Gelu fusion is enabled with oneDNN library on CPU. On GPU, only the
+  // approximate (tanh) form is fused, as a cuBLASLt epilogue.
+  if (!IsMKLEnabled() && !BlasLtGeluEpilogueEnabled()) return false;
 
   using utils::MatchingDirection;
   using utils::NodeStatus;
@@ -1162,6 +1249,7 @@ bool FindMatMulBiasAddAndGelu(RemapperContext* ctx, int node_index,
   matched_nodes_map->clear();
   remove_node_indices->clear();
   found_gelu_exact =
+      IsMKLEnabled() &&
       graph_matcher.GetMatchedNodes(gelu_exact_pattern, ctx->nodes_to_preserve,
                                     ctx->graph_view.GetNode(node_index),
                                     matched_nodes_map, remove_node_indices);
@@ -1202,7 +1290,12 @@ bool FindMatMulBiasAddAndGelu(RemapperContext* ctx, int node_index,
     NodeDef* matmul_node =
         ctx->graph_view.GetNode(matched_nodes_map->at("matmul"))->node();
 
-    if (!NodeIsOnCpu(matmul_node)) return false;
+    const bool is_cpu_compatible = IsMKLEnabled() && NodeIsOnCpu(matmul_node);
+    const DataType dtype = GetDataTypeFromAttr(*matmul_node, "T");
+    const bool is_gpu_compatible =
+        BlasLtGeluEpilogueEnabled() && NodeIsOnGpu(matmul_node) &&
+        (dtype == DT_FLOAT || dtype == DT_HALF);
+    if (!is_cpu_compatible && !is_gpu_compatible) return false;
 
     // Check if _FusedMatMul contains only BiasAdd
     auto fused_ops = matmul_node->attr().at("fused_ops").list().s();
@@ -1794,6 +1887,149 @@ bool FindTensorToHashBucket(const RemapperContext& ctx, int node_index,
   return true;
 }
 
+bool IsSparseSegmentReduction(const NodeDef& node) {
+  const auto& op = node.op();
+  return op == "SparseSegmentSum" || op == "SparseSegmentMean" ||
+         op == "SparseSegmentSqrtN" ||
+         op == "SparseSegmentSumWithNumSegments" ||
+         op == "SparseSegmentMeanWithNumSegments" ||
+         op == "SparseSegmentSqrtNWithNumSegments";
+}
+
+// Returns true if `node` is a Gather or a GatherV2 along axis 0 without batch
+// dimensions.
+bool IsGatherAlongAxis0(const utils::MutableNodeView& node_view) {
+  const auto* node_def = node_view.node();
+  if (node_def->op() == "Gather") return true;
+  if (node_def->op() != "GatherV2" || node_view.NumRegularFanins() < 3) {
+    return false;
+  }
+  int batch_dims = 0;
+  if (TryGetNodeAttr(*node_def, "batch_dims", &batch_dims) && batch_dims != 0)
+    return false;
+
+  const auto* axis_def = node_view.GetRegularFanin(2).node_view()->node();
+  if (!IsConstant(*axis_def)) return false;
+  Tensor axis;
+  if (!axis.FromProto(axis_def->attr().at("value").tensor()) ||
+      axis.NumElements() != 1) {
+    return false;
+  }
+  if (axis.dtype() == DT_INT32) return axis.flat<int32>()(0) == 0;
+  if (axis.dtype() == DT_INT64) return axis.flat<int64_t>()(0) == 0;
+  return false;
+}
+
+bool FindSparseSegmentReductionOfGather(
+    const RemapperContext& ctx, int node_index,
+    SparseSegmentReductionOfGather* matched) {
+  // Root of the pattern must be a SparseSegment{Sum,Mean,SqrtN} on CPU.
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  const auto* node_def = node_view->node();
+  if (!IsSparseSegmentReduction(*node_def) || !NodeIsOnCpu(node_def) ||
+      node_view->NumRegularFanins() < 3) {
+    return false;
+  }
+
+  // Its data input must be a Gather along axis 0 of 1-D ids.
+  const auto& regular_fanin_0 = node_view->GetRegularFanin(0);
+  const auto* gather_node_view = regular_fanin_0.node_view();
+  const auto* gather_node_def = gather_node_view->node();
+  if (regular_fanin_0.index() != 0 || !IsGatherAlongAxis0(*gather_node_view) ||
+      !NodeIsOnCpu(gather_node_def) ||
+      HasControlFaninOrFanout(*gather_node_view) ||
+      !HasAtMostOneFanoutAtPort0(*gather_node_view) ||
+      IsInPreserveSet(ctx, gather_node_def)) {
+    return false;
+  }
+
+  // The ids become the indices of the reduction.
+  const DataType ids_dtype = GetDataTypeFromAttr(*gather_node_def, "Tindices");
+  if (ids_dtype != DT_INT32 && ids_dtype != DT_INT64) return false;
+  if (!ctx.inferred_graph_properties) return false;
+  const auto& gather_props =
+      ctx.graph_properties.GetInputProperties(gather_node_def->name());
+  if (gather_props.size() < 2 || gather_props[1].shape().unknown_rank() ||
+      gather_props[1].shape().dim_size() != 1) {
+    return false;
+  }
+
+  // Do not clobber an existing node with the name of the new indices node.
+  if (ctx.graph_view.GetNode(
+          AddPrefixToNodeName("gathered_indices", node_def->name())) !=
+      nullptr) {
+    return false;
+  }
+
+  *matched = SparseSegmentReductionOfGather(gather_node_view->node_index(),
+                                            node_index);
+  return true;
+}
+
+// Returns true if `node` is a float constant that broadcasts against the
+// channels of an NHWC image, i.e. all its dimensions but the last are 1.
+bool IsPerChannelFloatConstant(const NodeDef& node) {
+  if (!IsConstant(node) || !HasDataType(&node, DT_FLOAT, "dtype")) return false;
+  const TensorShapeProto& shape =
+      node.attr().at("value").tensor().tensor_shape();
+  if (shape.dim_size() > 4) return false;
+  for (int i = 0; i + 1 < shape.dim_size(); ++i) {
+    if (shape.dim(i).size() != 1) return false;
+  }
+  return true;
+}
+
+bool FindResizeBilinearWithNormalize(const RemapperContext& ctx,
+                                     int node_index,
+                                     ResizeBilinearWithNormalize* matched) {
+  // Root of the pattern must be a float Mul on CPU.
+  const auto* mul_node_view = ctx.graph_view.GetNode(node_index);
+  const auto* mul_node_def = mul_node_view->node();
+  if (!IsMul(*mul_node_def) || !HasDataType(mul_node_def, DT_FLOAT) ||
+      !NodeIsOnCpu(mul_node_def) || HasControlFaninOrFanout(*mul_node_view) ||
+      mul_node_view->NumRegularFanins() != 2) {
+    return false;
+  }
+
+  // One input of the Mul is a per-channel scale and the other a Sub.
+  for (int sub_port = 0; sub_port < 2; ++sub_port) {
+    const auto& sub_fanin = mul_node_view->GetRegularFanin(sub_port);
+    const auto& scale_fanin = mul_node_view->GetRegularFanin(1 - sub_port);
+    const auto* sub_node_view = sub_fanin.node_view();
+    const auto* sub_node_def = sub_node_view->node();
+    if (!IsSub(*sub_node_def) || sub_fanin.index() != 0 ||
+        !IsPerChannelFloatConstant(*scale_fanin.node_view()->node()) ||
+        HasControlFaninOrFanout(*sub_node_view) ||
+        !HasAtMostOneFanoutAtPort0(*sub_node_view) ||
+        IsInPreserveSet(ctx, sub_node_def)) {
+      continue;
+    }
+
+    // The Sub subtracts a per-channel mean from a uint8 ResizeBilinear.
+    const auto& resize_fanin = sub_node_view->GetRegularFanin(0);
+    const auto& mean_fanin = sub_node_view->GetRegularFanin(1);
+    const auto* resize_node_view = resize_fanin.node_view();
+    const auto* resize_node_def = resize_node_view->node();
+    if (resize_node_def->op() != "ResizeBilinear" ||
+        resize_fanin.index() != 0 || !HasDataType(resize_node_def, DT_UINT8) ||
+        !NodeIsOnCpu(resize_node_def) ||
+        !IsPerChannelFloatConstant(*mean_fanin.node_view()->node()) ||
+        HasControlFaninOrFanout(*resize_node_view) ||
+        !HasAtMostOneFanoutAtPort0(*resize_node_view) ||
+        IsInPreserveSet(ctx, resize_node_def)) {
+      continue;
+    }
+
+    matched->resize_bilinear = resize_node_view->node_index();
+    matched->sub = sub_node_view->node_index();
+    matched->mul = node_index;
+    matched->mean = mean_fanin.node_index();
+    matched->scale = scale_fanin.node_index();
+    return true;
+  }
+  return false;
+}
+
 bool FindFusedBatchMatMul(RemapperContext* ctx, int node_index,
                           std::map<string, int>* matched_nodes_map,
                           std::set<int>* remove_node_indices) {
@@ -1886,6 +2122,298 @@ bool FindFusedBatchMatMul(RemapperContext* ctx, int node_index,
   return found_op_type_match;
 }
 
+// The fused attention kernels only beat the BatchMatMul/Softmax subgraph for
+// long sequences, where the score matrix doesn't fit in cache; the GPU kernel
+// also rereads keys and values for every few query rows. Compare
+// BM_MultiHeadAttention in fused_attention_op_test.cc before enabling it.
+bool FusedMultiHeadAttentionEnabled() {
+  bool is_enabled = false;
+  TF_CHECK_OK(tensorflow::ReadBoolFromEnvVar(
+      "TF_ENABLE_FUSED_ATTENTION", /*default_val=*/false, &is_enabled));
+  return is_enabled;
+}
+
+// Scaled dot-product attention in Python generates
+//   BatchMatMul(Softmax(BatchMatMul(query, key, adj_y=true) * scale), value)
+// where the scores are optionally scaled by a multiplication with, or a
+// division by, a scalar constant. The subgraph materializes the full
+// [batch, heads, q_len, kv_len] score matrix, which the fused op avoids.
+bool FindFusedMultiHeadAttention(RemapperContext* ctx, int node_index,
+                                 std::map<string, int>* matched_nodes_map,
+                                 std::set<int>* remove_node_indices,
+                                 float* scale) {
+  using utils::MatchingDirection;
+  using utils::NodeStatus;
+  const auto scores_pattern = [](const string& scale_op) {
+    utils::OpTypePattern scores = {"BatchMatMul|BatchMatMulV2", "scores",
+                                   NodeStatus::kRemove,
+                                   {{"*", "query", NodeStatus::kRemain},
+                                    {"*", "key", NodeStatus::kRemain}}};
+    if (scale_op.empty()) return scores;
+    return utils::OpTypePattern{
+        scale_op,
+        "scaled_scores",
+        NodeStatus::kRemove,
+        {scores, {"Const", "scale", NodeStatus::kRemain}}};
+  };
+  const auto attention_pattern = [&](const string& scale_op) {
+    return utils::OpTypePattern{
+        "BatchMatMul|BatchMatMulV2",
+        "output",
+        NodeStatus::kReplace,
+        {{"Softmax", "softmax", NodeStatus::kRemove,
+          {scores_pattern(scale_op)}},
+         {"*", "value", NodeStatus::kRemain}}};
+  };
+
+  utils::SubGraphMatcher<MatchingDirection::kFollowInputs> graph_matcher(
+      &(ctx->graph_view));
+  bool found_op_type_match = false;
+  for (const string& scale_op : {"Mul", "RealDiv", ""}) {
+    matched_nodes_map->clear();
+    remove_node_indices->clear();
+    found_op_type_match = graph_matcher.GetMatchedNodes(
+        attention_pattern(scale_op), ctx->nodes_to_preserve,
+        ctx->graph_view.GetNode(node_index), matched_nodes_map,
+        remove_node_indices);
+    if (found_op_type_match) break;
+  }
+  if (!found_op_type_match) return false;
+
+  const auto node_def = [&](const string& label) {
+    return ctx->graph_view.GetNode(matched_nodes_map->at(label))->node();
+  };
+  const NodeDef* output_node = node_def("output");
+  const NodeDef* scores_node = node_def("scores");
+  const auto adjoint = [](const NodeDef* node, const string& attr) {
+    return node->attr().count(attr) > 0 && node->attr().at(attr).b();
+  };
+  if (adjoint(scores_node, "adj_x") || !adjoint(scores_node, "adj_y") ||
+      adjoint(output_node, "adj_x") || adjoint(output_node, "adj_y")) {
+    return false;
+  }
+
+  const DataType dtype = GetDataTypeFromAttr(*output_node, "T");
+  bool is_gpu = false;
+  if (NodeIsOnCpu(output_node)) {
+    if (dtype != DT_FLOAT) return false;
+  } else if (NodeIsOnGpu(output_node)) {
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+    if (dtype != DT_FLOAT && dtype != DT_HALF) return false;
+    is_gpu = true;
+#else
+    return false;
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  } else {
+    return false;
+  }
+
+  *scale = 1.0f;
+  if (matched_nodes_map->count("scale") > 0) {
+    Tensor scale_tensor;
+    const NodeDef* scale_node = node_def("scale");
+    if (!scale_tensor.FromProto(scale_node->attr().at("value").tensor()) ||
+        scale_tensor.NumElements() != 1) {
+      return false;
+    }
+    float value;
+    if (scale_tensor.dtype() == DT_FLOAT) {
+      value = scale_tensor.flat<float>()(0);
+    } else if (scale_tensor.dtype() == DT_HALF) {
+      value = static_cast<float>(scale_tensor.flat<Eigen::half>()(0));
+    } else {
+      return false;
+    }
+    if (IsRealDiv(*node_def("scaled_scores"))) {
+      if (value == 0.0f) return false;
+      value = 1.0f / value;
+    }
+    *scale = value;
+  }
+
+  // BatchMatMulV2 broadcasts the batch dimensions, the fused op does not, so
+  // the batch and head dimensions of all inputs must be known to be equal.
+  if (!ctx->inferred_graph_properties) {
+    Status s = ctx->graph_properties.InferStatically(
+        /*assume_valid_feeds=*/true,
+        /*aggressive_shape_inference=*/false,
+        /*include_input_tensor_values=*/false,
+        /*include_output_tensor_values=*/false);
+    if (!s.ok()) return false;
+    ctx->inferred_graph_properties = true;
+  }
+  const auto& scores_props =
+      ctx->graph_properties.GetInputProperties(scores_node->name());
+  const auto& output_props =
+      ctx->graph_properties.GetInputProperties(output_node->name());
+  if (scores_props.size() != 2 || output_props.size() != 2) return false;
+  const TensorShapeProto& query_shape = scores_props[0].shape();
+  const TensorShapeProto& key_shape = scores_props[1].shape();
+  const TensorShapeProto& value_shape = output_props[1].shape();
+  if (Rank(query_shape) != 4 || Rank(key_shape) != 4 ||
+      Rank(value_shape) != 4) {
+    return false;
+  }
+  for (int i = 0; i < 2; ++i) {
+    // Unknown dimensions are -1, while symbolic ones are below -1 and compare
+    // equal only if they are known to be the same.
+    const int64_t size = query_shape.dim(i).size();
+    if (size == -1 || key_shape.dim(i).size() != size ||
+        value_shape.dim(i).size() != size) {
+      return false;
+    }
+  }
+  if (is_gpu) {
+    // The GPU kernel keeps a row of the query and of the output in registers.
+    const int64_t depth = query_shape.dim(3).size();
+    const int64_t value_depth = value_shape.dim(3).size();
+    if (depth < 0 || depth > 128 || value_depth < 0 || value_depth > 128) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FusedElementwiseEnabled() {
+  bool is_enabled = false;
+  TF_CHECK_OK(tensorflow::ReadBoolFromEnvVar(
+      "TF_ENABLE_FUSED_ELEMENTWISE", /*default_val=*/false, &is_enabled));
+  return is_enabled;
+}
+
+// The limits of a _FusedElementwise program.
+// WARN: This should be consistent with fused_elementwise_op.h.
+constexpr int kMaxFusedElementwiseOps = 16;
+constexpr int kMaxFusedElementwiseArgs = 8;
+
+// Returns whether _FusedElementwise supports the op of `node`, and whether it
+// is a binary op and a commutative one.
+// WARN: This should be consistent with fused_elementwise_op.cc.
+bool IsFusableElementwiseOp(const NodeDef& node, bool* is_binary,
+                            bool* is_commutative) {
+  static const auto* const kUnaryOps = new absl::flat_hash_set<string>(
+      {"Abs", "Exp", "Log", "Neg", "Inv", "Reciprocal", "Relu", "Rsqrt",
+       "Sigmoid", "Sqrt", "Square", "Tanh"});
+  static const auto* const kCommutativeOps = new absl::flat_hash_set<string>(
+      {"Add", "AddV2", "Mul", "Maximum", "Minimum"});
+  static const auto* const kNonCommutativeOps =
+      new absl::flat_hash_set<string>({"Sub", "Div", "RealDiv"});
+  *is_binary = !kUnaryOps->contains(node.op());
+  *is_commutative = kCommutativeOps->contains(node.op());
+  return !*is_binary || *is_commutative ||
+         kNonCommutativeOps->contains(node.op());
+}
+
+// Returns the input port of `node_view` that a fused elementwise chain can run
+// through, or -1 if the node cannot be part of a chain. The input at the port
+// must have the shape of the output. The other input of a binary op becomes an
+// argument of the chain, and must be a scalar or have that shape as well.
+int ElementwiseChainPort(const RemapperContext& ctx,
+                         const utils::MutableNodeView& node_view) {
+  const NodeDef* node = node_view.node();
+  bool is_binary, is_commutative;
+  if (!IsFusableElementwiseOp(*node, &is_binary, &is_commutative)) return -1;
+  const DataType dtype = GetDataTypeFromAttr(*node, "T");
+  if (dtype != DT_FLOAT && dtype != DT_HALF) return -1;
+  if (!is_binary) return 0;
+
+  const auto& input_props =
+      ctx.graph_properties.GetInputProperties(node->name());
+  const auto& output_props =
+      ctx.graph_properties.GetOutputProperties(node->name());
+  if (input_props.size() != 2 || output_props.size() != 1) return -1;
+  const TensorShapeProto& output_shape = output_props[0].shape();
+
+  int chain_port = -1;
+  for (int port = 0; port < (is_commutative ? 2 : 1); ++port) {
+    const TensorShapeProto& arg_shape = input_props[1 - port].shape();
+    if (!ShapesSymbolicallyEqual(input_props[port].shape(), output_shape) ||
+        !(Rank(arg_shape) == 0 ||
+          ShapesSymbolicallyEqual(arg_shape, output_shape))) {
+      continue;
+    }
+    // Prefer the port whose input can continue the chain.
+    const NodeDef* input = node_view.GetRegularFanin(port).node_view()->node();
+    bool unused;
+    if (IsFusableElementwiseOp(*input, &unused, &unused)) return port;
+    if (chain_port == -1) chain_port = port;
+  }
+  return chain_port;
+}
+
+// Finds the longest chain of elementwise ops that ends at `node_index`, in
+// which every op but the last has no other consumer. Each op of the chain
+// reads and writes a full tensor when it runs on its own, and the fused op
+// does so once for the whole chain.
+bool FindFusedElementwise(RemapperContext* ctx, int node_index,
+                          FusedElementwise* matched) {
+  utils::MutableNodeView* node_view = ctx->graph_view.GetNode(node_index);
+  const NodeDef* root = node_view->node();
+  bool is_binary, is_commutative;
+  if (!IsFusableElementwiseOp(*root, &is_binary, &is_commutative) ||
+      HasControlFaninOrFanout(*node_view)) {
+    return false;
+  }
+  if (!NodeIsOnCpu(root)) {
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+    if (!NodeIsOnGpu(root)) return false;
+#else
+    return false;
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  }
+
+  if (!ctx->inferred_graph_properties) {
+    Status s = ctx->graph_properties.InferStatically(
+        /*assume_valid_feeds=*/true,
+        /*aggressive_shape_inference=*/false,
+        /*include_input_tensor_values=*/false,
+        /*include_output_tensor_values=*/false);
+    if (!s.ok()) return false;
+    ctx->inferred_graph_properties = true;
+  }
+
+  const DataType dtype = GetDataTypeFromAttr(*root, "T");
+  FusedElementwise chain;
+  int port = ElementwiseChainPort(*ctx, *node_view);
+  while (port >= 0) {
+    const NodeDef* node = node_view->node();
+    chain.nodes.push_back(node_view->node_index());
+    chain.op_names.push_back(node->op());
+    IsFusableElementwiseOp(*node, &is_binary, &is_commutative);
+    if (is_binary) chain.args.push_back(node->input(1 - port));
+
+    // Follow the input at `port` while it is an op that only this chain
+    // consumes.
+    const auto& fanin = node_view->GetRegularFanin(port);
+    utils::MutableNodeView* input_view = fanin.node_view();
+    const NodeDef* input = input_view->node();
+    const int input_port =
+        fanin.index() == 0 ? ElementwiseChainPort(*ctx, *input_view) : -1;
+    bool input_is_binary = false;
+    if (input_port >= 0) {
+      IsFusableElementwiseOp(*input, &input_is_binary, &is_commutative);
+    }
+    if (input_port < 0 || IsInPreserveSet(*ctx, input) ||
+        HasControlFaninOrFanout(*input_view) ||
+        !HasAtMostOneFanoutAtPort0(*input_view) ||
+        input->device() != root->device() ||
+        GetDataTypeFromAttr(*input, "T") != dtype ||
+        chain.nodes.size() == kMaxFusedElementwiseOps ||
+        (input_is_binary && chain.args.size() == kMaxFusedElementwiseArgs)) {
+      chain.input = node->input(port);
+      break;
+    }
+    node_view = input_view;
+    port = input_port;
+  }
+  if (chain.nodes.size() < 2) return false;
+
+  std::reverse(chain.op_names.begin(), chain.op_names.end());
+  std::reverse(chain.args.begin(), chain.args.end());
+  *matched = std::move(chain);
+  return true;
+}
+
 void CopyConv2DAttributes(const NodeDef& conv2d, NodeDef* fused_conv2d,
                           const NodeDef* activation = nullptr) {
   DCHECK(IsConv2D(conv2d)) << "Input node must be a Conv2D";
@@ -2907,6 +3435,86 @@ Status AddTensorToHashBucketNode(RemapperContext* ctx,
   return OkStatus();
 }
 
+Status AddSparseSegmentReductionOfGatherNodes(
+    RemapperContext* ctx, const SparseSegmentReductionOfGather& matched,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& gather = graph->node(matched.gather);
+  const NodeDef& reduction = graph->node(matched.sparse_segment_reduction);
+  VLOG(2) << "Fuse " << gather.op() << " into " << reduction.op() << ":"
+          << " gather=" << gather.name() << " reduction=" << reduction.name();
+
+  // reduction(gather(params, ids), indices, segment_ids) is
+  // reduction(params, gather(ids, indices), segment_ids). Gathering the ids
+  // is cheap compared to gathering [num_ids, dim] embedding rows.
+  NodeDef indices;
+  indices.set_name(AddPrefixToNodeName("gathered_indices", reduction.name()));
+  indices.set_op("Gather");
+  indices.set_device(reduction.device());
+  indices.add_input(gather.input(1));     // 0: params (the ids)
+  indices.add_input(reduction.input(1));  // 1: indices
+  auto* indices_attr = indices.mutable_attr();
+  (*indices_attr)["Tparams"] = gather.attr().at("Tindices");
+  (*indices_attr)["Tindices"] = reduction.attr().at("Tidx");
+  SetAttrValue(true, &(*indices_attr)["validate_indices"]);
+
+  NodeDef fused_op = reduction;
+  fused_op.set_input(0, gather.input(0));  // 0: params
+  fused_op.set_input(1, indices.name());   // 1: indices into params
+  (*fused_op.mutable_attr())["Tidx"] = gather.attr().at("Tindices");
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(indices), &status);
+  TF_RETURN_IF_ERROR(status);
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.sparse_segment_reduction] = true;
+  (*nodes_to_delete)[matched.gather] = true;
+
+  return OkStatus();
+}
+
+Status AddResizeBilinearWithNormalizeNode(
+    RemapperContext* ctx, const ResizeBilinearWithNormalize& matched,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& resize_bilinear = graph->node(matched.resize_bilinear);
+  const NodeDef& mul = graph->node(matched.mul);
+  VLOG(2) << "Fuse ResizeBilinear with Sub and Mul:"
+          << " resize_bilinear=" << resize_bilinear.name()
+          << " mul=" << mul.name();
+
+  NodeDef fused_op;
+  fused_op.set_name(mul.name());
+  fused_op.set_op(kFusedResizeBilinear);
+  fused_op.set_device(resize_bilinear.device());
+  fused_op.add_input(resize_bilinear.input(0));           // 0: images
+  fused_op.add_input(resize_bilinear.input(1));           // 1: size
+  fused_op.add_input(graph->node(matched.mean).name());   // 2: mean
+  fused_op.add_input(graph->node(matched.scale).name());  // 3: scale
+
+  auto* attr = fused_op.mutable_attr();
+  auto& src_attr = resize_bilinear.attr();
+  (*attr)["T"] = src_attr.at("T");
+  (*attr)["align_corners"] = src_attr.at("align_corners");
+  (*attr)["half_pixel_centers"] = src_attr.at("half_pixel_centers");
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.mul] = true;
+  (*nodes_to_delete)[matched.sub] = true;
+  (*nodes_to_delete)[matched.resize_bilinear] = true;
+
+  return OkStatus();
+}
+
 Status AddFusedBatchMatMul(RemapperContext* ctx,
                            const std::map<string, int>& matched_nodes_map,
                            const std::set<int>& remove_node_indices,
@@ -2946,6 +3554,73 @@ Status AddFusedBatchMatMul(RemapperContext* ctx,
   return OkStatus();
 }
 
+Status AddFusedMultiHeadAttention(
+    RemapperContext* ctx, const std::map<string, int>& matched_nodes_map,
+    const std::set<int>& remove_node_indices, float scale,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  auto* output_node =
+      ctx->graph_view.GetNode(matched_nodes_map.at("output"))->node();
+  auto* scores_node =
+      ctx->graph_view.GetNode(matched_nodes_map.at("scores"))->node();
+
+  NodeDef fused_node;
+  fused_node.set_name(output_node->name());
+  fused_node.set_op("_FusedMultiHeadAttention");
+  fused_node.set_device(output_node->device());
+  fused_node.add_input(scores_node->input(0));
+  fused_node.add_input(scores_node->input(1));
+  fused_node.add_input(output_node->input(1));
+
+  auto* attr = fused_node.mutable_attr();
+  (*attr)["T"] = output_node->attr().at("T");
+  SetAttrValue(scale, &(*attr)["scale"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_node), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+  (*invalidated_nodes)[matched_nodes_map.at("output")] = true;
+
+  for (const auto& node_idx : remove_node_indices) {
+    (*nodes_to_delete)[node_idx] = true;
+  }
+  return OkStatus();
+}
+
+Status AddFusedElementwiseNode(RemapperContext* ctx,
+                               const FusedElementwise& matched,
+                               std::vector<bool>* invalidated_nodes,
+                               std::vector<bool>* nodes_to_delete) {
+  const NodeDef* root = ctx->graph_view.GetNode(matched.nodes[0])->node();
+  VLOG(2) << "Fuse elementwise ops: root=" << root->name() << " op_names=["
+          << absl::StrJoin(matched.op_names, ", ") << "]";
+
+  NodeDef fused_op;
+  fused_op.set_name(root->name());
+  fused_op.set_op("_FusedElementwise");
+  fused_op.set_device(root->device());
+  fused_op.add_input(matched.input);
+  for (const string& arg : matched.args) fused_op.add_input(arg);
+
+  auto* attr = fused_op.mutable_attr();
+  (*attr)["T"] = root->attr().at("T");
+  SetAttrValue(static_cast<int>(matched.args.size()), &(*attr)["num_args"]);
+  SetAttrValue(matched.op_names, &(*attr)["op_names"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.nodes[0]] = true;
+  for (int i = 1; i < matched.nodes.size(); ++i) {
+    (*nodes_to_delete)[matched.nodes[i]] = true;
+  }
+  return OkStatus();
+}
+
 // This function supports below patterns that require inferred
 // shapes:
 // 1. Contraction + Add.
@@ -3201,14 +3876,109 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index) {
     return false;
   };
 
+  // Candidate for folding a Gather into a sparse segment reduction, which
+  // needs the rank of the gathered ids.
+  const auto is_sparse_segment_reduction_of_gather_candidate = [&]() -> bool {
+    if (!IsSparseSegmentReduction(*node_def)) return false;
+    if (node_view->NumRegularFanins() < 1) return false;
+    return IsGather(*node_view->GetRegularFanin(0).node_view()->node());
+  };
+
   if (IsMKLEnabled())
     return is_batch_norm_candidate() || is_batch_norm_fusion_candidate() ||
            IsContractionWithAdd(ctx, node_index) ||
-           is_relu_biasadd_conv_candidate();
+           is_relu_biasadd_conv_candidate() ||
+           is_sparse_segment_reduction_of_gather_candidate();
 
   return is_relu_biasadd_conv_candidate() || is_batch_norm_candidate() ||
          is_batch_norm_fusion_candidate() ||
-         is_batch_norm_grad_fusion_candidate();
+         is_batch_norm_grad_fusion_candidate() ||
+         is_sparse_segment_reduction_of_gather_candidate();
+}
+
+// Dynamic quantization trades accuracy for speed, so it is only done on
+// explicit opt-in. The variable is read on every run rather than cached, so
+// that it can be toggled between graphs.
+bool DynamicQuantizedMatMulEnabled() {
+  bool is_enabled = false;
+  TF_CHECK_OK(tensorflow::ReadBoolFromEnvVar(
+      "TF_ENABLE_DYNAMIC_QUANTIZED_MATMUL", /*default_val=*/false,
+      &is_enabled));
+  return is_enabled;
+}
+
+// Checks if `node` is a float MatMul on CPU, possibly with a fused BiasAdd
+// (+ Relu), whose weights are a constant that _DynamicQuantizedMatMul can
+// quantize once.
+bool IsDynamicQuantizedMatMulCandidate(const NodeMap& node_map,
+                                       const NodeDef& node) {
+  if (node.op() != "MatMul" && node.op() != "_FusedMatMul") return false;
+  if (!NodeIsOnCpu(&node) || GetDataTypeFromAttr(node, "T") != DT_FLOAT) {
+    return false;
+  }
+  if (node.op() == "_FusedMatMul") {
+    const auto& fused_ops = node.attr().at("fused_ops").list().s();
+    if (fused_ops.empty() || fused_ops.size() > 2 ||
+        fused_ops.at(0) != "BiasAdd" ||
+        (fused_ops.size() == 2 && fused_ops.at(1) != "Relu")) {
+      return false;
+    }
+  }
+  const NodeDef* weights = node_map.GetNode(node.input(1));
+  return weights != nullptr && IsConstant(*weights);
+}
+
+// Rewrites every candidate for _DynamicQuantizedMatMul in `graph`. This runs
+// after the other remappings, so that MatMuls they fused with a BiasAdd are
+// quantized together with it.
+void AddDynamicQuantizedMatMulNodes(GraphDef* graph) {
+  NodeMap node_map(graph);
+  for (NodeDef& node : *graph->mutable_node()) {
+    if (!IsDynamicQuantizedMatMulCandidate(node_map, node)) continue;
+    VLOG(2) << "Rewriting " << node.name() << " to _DynamicQuantizedMatMul";
+    if (node.op() == "MatMul") {
+      AddNodeAttr("num_args", 0, &node);
+      AddNodeAttr("fused_ops", gtl::ArraySlice<string>(), &node);
+    }
+    node.set_op("_DynamicQuantizedMatMul");
+    // Drop the _FusedMatMul attributes the new op does not have.
+    node.mutable_attr()->erase("epsilon");
+    node.mutable_attr()->erase("leakyrelu_alpha");
+  }
+}
+
+// Packing constant weights once keeps a packed copy of them alive for the
+// lifetime of the kernel, so it is only done on explicit opt-in.
+bool ConstantWeightsPackingEnabled() {
+  bool is_enabled = false;
+  TF_CHECK_OK(tensorflow::ReadBoolFromEnvVar(
+      "TF_ENABLE_CPU_WEIGHT_PACKING", /*default_val=*/false, &is_enabled));
+  return is_enabled;
+}
+
+// Checks if `node` is a float MatMul or Conv2D on CPU whose weights come from
+// a constant, possibly through Identity nodes as in frozen graphs.
+bool HasConstantWeightsOnCpu(const NodeMap& node_map, const NodeDef& node) {
+  if (node.op() != "MatMul" && node.op() != "Conv2D") return false;
+  if (!NodeIsOnCpu(&node) || GetDataTypeFromAttr(node, "T") != DT_FLOAT) {
+    return false;
+  }
+  const NodeDef* weights = node_map.GetNode(node.input(1));
+  while (weights != nullptr && IsIdentity(*weights)) {
+    weights = node_map.GetNode(weights->input(0));
+  }
+  return weights != nullptr && IsConstant(*weights);
+}
+
+// Marks the MatMul and Conv2D nodes in `graph` whose kernels can pack their
+// constant weights once, instead of on every call.
+void MarkConstantWeights(GraphDef* graph) {
+  NodeMap node_map(graph);
+  for (NodeDef& node : *graph->mutable_node()) {
+    if (!HasConstantWeightsOnCpu(node_map, node)) continue;
+    VLOG(2) << "Marking the weights of " << node.name() << " as constant";
+    AddNodeAttr("_grappler_constant_weights", true, &node);
+  }
 }
 }  // namespace
 
@@ -3234,6 +4004,7 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   // not perform rewrite if the graph will be differentiated later.
   bool allow_non_differentiable_rewrites =
       item.optimization_options().allow_non_differentiable_rewrites;
+  const bool fused_elementwise_enabled = FusedElementwiseEnabled();
 
   for (int i = num_nodes - 1; i >= 0; --i) {
     // Check if node was invalidated by one of the previous remaps.
@@ -3255,6 +4026,31 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     ContractionWithBiasAddAndAdd contract_with_bias_and_add;
     ContractionWithBiasAndAddActivation contract_with_bias_and_add_activation;
 
+    // Remap MatMul + BiasAdd + gelu-subgraph
+    std::map<string, int> matched_nodes_map;
+    std::set<int> remove_node_indices;
+    bool is_gelu_approximate = false;
+    if (FindMatMulBiasAddAndGelu(&ctx, i, &matched_nodes_map,
+                                 &remove_node_indices, &is_gelu_approximate)) {
+      TF_RETURN_IF_ERROR(AddFusedMatMulBiasAddAndGelu(
+          &ctx, matched_nodes_map, remove_node_indices, &invalidated_nodes,
+          &nodes_to_delete, is_gelu_approximate));
+      continue;
+    }
+
+    // Remap BatchMatMul+Softmax+BatchMatMul into _FusedMultiHeadAttention.
+    matched_nodes_map.clear();
+    remove_node_indices.clear();
+    float attention_scale;
+    if (allow_non_differentiable_rewrites && FusedMultiHeadAttentionEnabled() &&
+        FindFusedMultiHeadAttention(&ctx, i, &matched_nodes_map,
+                                    &remove_node_indices, &attention_scale)) {
+      TF_RETURN_IF_ERROR(AddFusedMultiHeadAttention(
+          &ctx, matched_nodes_map, remove_node_indices, attention_scale,
+          &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
+
     if (IsMKLEnabled()) {
       // Remap Conv2D+BiasAdd+Add+relu into the _FusedConv2D.
       // or Remap Conv3D+BiasAdd+Add+relu into _FusedConv3D
@@ -3283,19 +4079,6 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
         continue;
       }
 
-      // Remap MatMul + BiasAdd + gelu-subgraph
-      std::map<string, int> matched_nodes_map;
-      std::set<int> remove_node_indices;
-      bool is_gelu_approximate = false;
-      if (FindMatMulBiasAddAndGelu(&ctx, i, &matched_nodes_map,
-                                   &remove_node_indices,
-                                   &is_gelu_approximate)) {
-        TF_RETURN_IF_ERROR(AddFusedMatMulBiasAddAndGelu(
-            &ctx, matched_nodes_map, remove_node_indices, &invalidated_nodes,
-            &nodes_to_delete, is_gelu_approximate));
-        continue;
-      }
-
       // Softplus + Tanh + Mul to Mish conversion
       matched_nodes_map.clear();
       remove_node_indices.clear();
@@ -3425,6 +4208,30 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    // Remap SparseSegment{Sum,Mean,SqrtN}(Gather(params, ids), ...) into a
+    // reduction that reads from params directly. The gradient of the result
+    // with respect to params is dense, so only do this for inference.
+    SparseSegmentReductionOfGather sparse_segment_reduction_of_gather;
+    if (allow_non_differentiable_rewrites &&
+        FindSparseSegmentReductionOfGather(
+            ctx, i, &sparse_segment_reduction_of_gather)) {
+      TF_RETURN_IF_ERROR(AddSparseSegmentReductionOfGatherNodes(
+          &ctx, sparse_segment_reduction_of_gather, &invalidated_nodes,
+          &nodes_to_delete));
+      continue;
+    }
+
+    // Remap ResizeBilinear+Sub+Mul on uint8 images into _FusedResizeBilinear.
+    ResizeBilinearWithNormalize resize_bilinear_with_normalize;
+    if (allow_non_differentiable_rewrites &&
+        FindResizeBilinearWithNormalize(ctx, i,
+                                        &resize_bilinear_with_normalize)) {
+      TF_RETURN_IF_ERROR(AddResizeBilinearWithNormalizeNode(
+          &ctx, resize_bilinear_with_normalize, &invalidated_nodes,
+          &nodes_to_delete));
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
@@ -3432,6 +4239,16 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       TF_RETURN_IF_ERROR(AddBatchNormNodes(&ctx, fused_batch_norm));
       continue;
     }
+
+    // Remap chains of elementwise ops into a _FusedElementwise. This runs
+    // after the other patterns, which may consume elementwise ops as well.
+    FusedElementwise fused_elementwise;
+    if (allow_non_differentiable_rewrites && fused_elementwise_enabled &&
+        FindFusedElementwise(&ctx, i, &fused_elementwise)) {
+      TF_RETURN_IF_ERROR(AddFusedElementwiseNode(
+          &ctx, fused_elementwise, &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
   }
 
   // Remove invalidated nodes.
@@ -3443,6 +4260,13 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   }
   TF_RETURN_IF_ERROR(mutation->Apply());
 
+  if (allow_non_differentiable_rewrites && DynamicQuantizedMatMulEnabled()) {
+    AddDynamicQuantizedMatMulNodes(&mutable_item.graph);
+  }
+  if (ConstantWeightsPackingEnabled()) {
+    MarkConstantWeights(&mutable_item.graph);
+  }
+
   *optimized_graph = std::move(mutable_item.graph);
 
   return OkStatus();
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/util/util.h"
 
 #if GOOGLE_CUDA
+#include "third_party/gpus/cuda/include/cuda.h"
 #include "third_party/gpus/cudnn/cudnn.h"
 #endif  // GOOGLE_CUDA
 
@@ -1352,6 +1353,72 @@ TEST_F(RemapperTensorToHashBucketTest, I32) { RunTest<DT_INT32>(); }
 
 TEST_F(RemapperTensorToHashBucketTest, I64) { RunTest<DT_INT64>(); }
 
+TEST_F(RemapperTest, FuseGatherIntoSparseSegmentSum) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/device:CPU:0");
+
+  auto params = Placeholder(s.WithOpName("params"), DT_FLOAT,
+                            ops::Placeholder::Shape({16, 8}));
+  auto unique_ids = Placeholder(s.WithOpName("unique_ids"), DT_INT64,
+                                ops::Placeholder::Shape({5}));
+  auto idx = Placeholder(s.WithOpName("idx"), DT_INT32,
+                         ops::Placeholder::Shape({7}));
+  auto segment_ids = Placeholder(s.WithOpName("segment_ids"), DT_INT32,
+                                 ops::Placeholder::Shape({7}));
+  auto axis = ops::Const(s.WithOpName("axis"), 0);
+  auto gather =
+      ops::GatherV2(s.WithOpName("gather"), params, unique_ids, axis);
+  auto reduction = ops::SparseSegmentSum(s.WithOpName("reduction"), gather,
+                                         idx, segment_ids);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), reduction);
+
+  auto params_t = GenerateRandomTensor<DT_FLOAT>({16, 8});
+  auto unique_ids_t = test::AsTensor<int64_t>({3, 0, 15, 7, 9});
+  auto idx_t = test::AsTensor<int32>({0, 1, 1, 4, 2, 3, 0});
+  auto segment_ids_t = test::AsTensor<int32>({0, 0, 1, 1, 1, 3, 3});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"params", params_t},
+               {"unique_ids", unique_ids_t},
+               {"idx", idx_t},
+               {"segment_ids", segment_ids_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.name(), "gather");
+    if (node.name() == "reduction") {
+      EXPECT_EQ(node.op(), "SparseSegmentSum");
+      ASSERT_GE(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "params");
+      EXPECT_EQ(node.input(1), "reduction/gathered_indices");
+      EXPECT_EQ(node.attr().at("Tidx").type(), DT_INT64);
+      found++;
+    }
+    if (node.name() == "reduction/gathered_indices") {
+      EXPECT_EQ(node.op(), "Gather");
+      ASSERT_EQ(node.input_size(), 2);
+      EXPECT_EQ(node.input(0), "unique_ids");
+      EXPECT_EQ(node.input(1), "idx");
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 2);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+}
+
 class RemapperFuseMatMulWithBiasTest : public RemapperTest {
  public:
   template <DataType DTYPE>
@@ -1657,6 +1724,465 @@ TEST_F(RemapperFuseMatMulWithBiasAndActivationTest, Bf16) {
   RunTest<DT_BFLOAT16>();  // NOLINT
 }
 
+TEST_F(RemapperTest, FuseMatMulWithBiasAndGeluApproximateOnGPU) {
+#if !(GOOGLE_CUDA && CUDA_VERSION >= 11040)
+  GTEST_SKIP() << "The cuBLASLt GELU epilogue requires CUDA 11.4 or newer.";
+#endif  // !(GOOGLE_CUDA && CUDA_VERSION >= 11040)
+  if (GetNumAvailableGPUs() == 0) {
+    GTEST_SKIP() << "No GPU, skipping FuseMatMulWithBiasAndGeluApproximate.";
+  }
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto lhs = Placeholder(s.WithOpName("lhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({8, 32}));
+  auto rhs = Placeholder(s.WithOpName("rhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({32, 64}));
+  auto bias = Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                          ops::Placeholder::Shape({64}));
+
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), lhs, rhs);
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+
+  // Gelu approximate as the arithmetic optimizer leaves it, with Pow(x, 3)
+  // rewritten as x * Square(x).
+  auto empirical_const =
+      ops::Const(s.WithOpName("empirical_const"), {0.044715f}, {});
+  auto empirical_const_times_matmul = ops::Mul(
+      s.WithOpName("empirical_const_times_matmul"), empirical_const, bias_add);
+  auto square = ops::Square(s.WithOpName("square"), bias_add);
+  auto mul =
+      ops::Mul(s.WithOpName("mul"), empirical_const_times_matmul, square);
+  auto matmul_plus_mul =
+      ops::AddV2(s.WithOpName("matmul_plus_mul"), bias_add, mul);
+  auto square_root_two_over_pi =
+      ops::Const(s.WithOpName("square_root_two_over_pi"), {0.797884f}, {});
+  auto matmul_plus_mul_times_square_root_two_over_pi =
+      ops::Mul(s.WithOpName("matmul_plus_mul_times_square_root_two_over_pi"),
+               matmul_plus_mul, square_root_two_over_pi);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"),
+                        matmul_plus_mul_times_square_root_two_over_pi);
+  auto one = ops::Const(s.WithOpName("one"), {1.0f}, {});
+  auto tanh_plus_one = ops::AddV2(s.WithOpName("tanh_plus_one"), tanh, one);
+  auto one_half = ops::Const(s.WithOpName("one_half"), {0.5f}, {});
+  auto tanh_plus_one_times_one_half = ops::Mul(
+      s.WithOpName("tanh_plus_one_times_one_half"), tanh_plus_one, one_half);
+  auto gelu = ops::Mul(s.WithOpName("gelu"), tanh_plus_one_times_one_half,
+                       bias_add);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), gelu);
+
+  auto lhs_t = GenerateTensorWithSetRandom<DT_FLOAT>({8, 32});
+  auto rhs_t = GenerateTensorWithSetRandom<DT_FLOAT>({32, 64});
+  auto bias_t = GenerateTensorWithSetRandom<DT_FLOAT>({64});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"lhs", lhs_t}, {"rhs", rhs_t}, {"bias", bias_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on GPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:GPU:0");
+  }
+
+  // The first pass fuses MatMul + BiasAdd, the second folds the Gelu
+  // subgraph into the resulting _FusedMatMul.
+  Remapper optimizer(RewriterConfig::ON);
+  GrapplerItem first_pass = item;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &first_pass.graph));
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, first_pass, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "gelu") {
+      EXPECT_EQ(node.op(), "_FusedMatMul");
+      ASSERT_GE(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "lhs");
+      EXPECT_EQ(node.input(1), "rhs");
+      EXPECT_EQ(node.input(2), "bias");
+
+      const auto fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(fused_ops.size(), 2);
+      EXPECT_EQ(fused_ops[0], "BiasAdd");
+      EXPECT_EQ(fused_ops[1], "GeluApproximate");
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectClose(tensors[0], tensors_expected[0], 1e-5, 1e-5);
+}
+
+TEST_F(RemapperTest, DynamicQuantizedMatMul) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto lhs = Placeholder(s.WithOpName("lhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({8, 32}));
+  auto weights_t = GenerateRandomTensor<DT_FLOAT>({32, 64});
+  auto weights = ops::Const(s.WithOpName("weights"), weights_t);
+  auto rhs = Placeholder(s.WithOpName("rhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({64, 16}));
+  auto bias = ops::Const(s.WithOpName("bias"),
+                         GenerateRandomTensor<DT_FLOAT>({64}));
+
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), lhs, weights);
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), bias_add);
+  // Weights that are not constant are left alone.
+  auto matmul_1 = ops::MatMul(s.WithOpName("matmul_1"), relu, rhs);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), matmul_1);
+
+  auto lhs_t = GenerateTensorWithSetRandom<DT_FLOAT>({8, 32});
+  auto rhs_t = GenerateTensorWithSetRandom<DT_FLOAT>({64, 16});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"lhs", lhs_t}, {"rhs", rhs_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  // Without the opt-in, the MatMul is only fused with its BiasAdd and Relu.
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_DynamicQuantizedMatMul");
+  }
+
+  setenv("TF_ENABLE_DYNAMIC_QUANTIZED_MATMUL", "1", 1 /* replace */);
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  unsetenv("TF_ENABLE_DYNAMIC_QUANTIZED_MATMUL");
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "relu") {
+      EXPECT_EQ(node.op(), "_DynamicQuantizedMatMul");
+      ASSERT_GE(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "lhs");
+      EXPECT_EQ(node.input(1), "weights");
+      EXPECT_EQ(node.input(2), "bias");
+      const auto fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(fused_ops.size(), 2);
+      EXPECT_EQ(fused_ops[0], "BiasAdd");
+      EXPECT_EQ(fused_ops[1], "Relu");
+      found++;
+    } else if (node.name() == "matmul_1") {
+      EXPECT_EQ(node.op(), "MatMul");
+      found++;
+    }
+  }
+  EXPECT_EQ(2, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectClose(tensors[0], tensors_expected[0], 0.5, 0.05);
+}
+
+TEST_F(RemapperTest, MarkConstantWeights) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto input = Placeholder(s.WithOpName("input"), DT_FLOAT,
+                           ops::Placeholder::Shape({8, 32, 32, 3}));
+  auto filter = ops::Const(s.WithOpName("filter"),
+                           GenerateRandomTensor<DT_FLOAT>({1, 1, 3, 16}));
+  auto conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                          "SAME");
+  auto reshape = ops::Reshape(s.WithOpName("reshape"), conv,
+                              ops::Const(s.WithOpName("shape"), {-1, 16}));
+  // Frozen variables are read through an Identity.
+  auto weights = ops::Const(s.WithOpName("weights"),
+                            GenerateRandomTensor<DT_FLOAT>({16, 8}));
+  auto read = ops::Identity(s.WithOpName("read"), weights);
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), reshape, read);
+  auto rhs = Placeholder(s.WithOpName("rhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({8, 4}));
+  auto matmul_1 = ops::MatMul(s.WithOpName("matmul_1"), matmul, rhs);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), matmul_1);
+
+  auto input_t = GenerateTensorWithSetRandom<DT_FLOAT>({8, 32, 32, 3});
+  auto rhs_t = GenerateTensorWithSetRandom<DT_FLOAT>({8, 4});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"input", input_t}, {"rhs", rhs_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  setenv("TF_ENABLE_CPU_WEIGHT_PACKING", "1", 1 /* replace */);
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  unsetenv("TF_ENABLE_CPU_WEIGHT_PACKING");
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    const auto& attr = node.attr();
+    if (node.name() == "conv" || node.name() == "matmul") {
+      ASSERT_EQ(attr.count("_grappler_constant_weights"), 1) << node.name();
+      EXPECT_TRUE(attr.at("_grappler_constant_weights").b());
+      found++;
+    } else if (node.name() == "matmul_1") {
+      EXPECT_EQ(attr.count("_grappler_constant_weights"), 0);
+      found++;
+    }
+  }
+  EXPECT_EQ(3, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-3);
+}
+
+TEST_F(RemapperTest, FuseMultiHeadAttention) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto query = Placeholder(s.WithOpName("query"), DT_FLOAT,
+                           ops::Placeholder::Shape({2, 4, 16, 8}));
+  auto key = Placeholder(s.WithOpName("key"), DT_FLOAT,
+                         ops::Placeholder::Shape({2, 4, 32, 8}));
+  auto value = Placeholder(s.WithOpName("value"), DT_FLOAT,
+                           ops::Placeholder::Shape({2, 4, 32, 8}));
+  auto scale = ops::Const(s.WithOpName("scale"), 0.125f, {});
+
+  auto scores = ops::BatchMatMulV2(s.WithOpName("scores"), query, key,
+                                   ops::BatchMatMulV2::AdjY(true));
+  auto scaled_scores = ops::Mul(s.WithOpName("scaled_scores"), scale, scores);
+  auto softmax = ops::Softmax(s.WithOpName("softmax"), scaled_scores);
+  auto attention =
+      ops::BatchMatMulV2(s.WithOpName("attention"), softmax, value);
+  // Scores that are divided by a constant, and that are not scaled at all.
+  auto scores_1 = ops::BatchMatMulV2(s.WithOpName("scores_1"), query, key,
+                                     ops::BatchMatMulV2::AdjY(true));
+  auto divided_scores =
+      ops::RealDiv(s.WithOpName("divided_scores"), scores_1,
+                   ops::Const(s.WithOpName("divisor"), 4.0f, {}));
+  auto attention_1 = ops::BatchMatMulV2(
+      s.WithOpName("attention_1"),
+      ops::Softmax(s.WithOpName("softmax_1"), divided_scores), value);
+  auto attention_2 = ops::BatchMatMulV2(
+      s.WithOpName("attention_2"),
+      ops::Softmax(s.WithOpName("softmax_2"),
+                   ops::BatchMatMulV2(s.WithOpName("scores_2"), query, key,
+                                      ops::BatchMatMulV2::AdjY(true))),
+      value);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), attention);
+  auto fetch_1 = ops::Identity(s.WithOpName("fetch_1"), attention_1);
+  auto fetch_2 = ops::Identity(s.WithOpName("fetch_2"), attention_2);
+
+  auto query_t = GenerateRandomTensor<DT_FLOAT>({2, 4, 16, 8});
+  auto key_t = GenerateRandomTensor<DT_FLOAT>({2, 4, 32, 8});
+  auto value_t = GenerateRandomTensor<DT_FLOAT>({2, 4, 32, 8});
+
+  GrapplerItem item;
+  item.fetch = {"fetch", "fetch_1", "fetch_2"};
+  item.feed = {{"query", query_t}, {"key", key_t}, {"value", value_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_FusedMultiHeadAttention");
+  }
+
+  setenv("TF_ENABLE_FUSED_ATTENTION", "1", 1 /* replace */);
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  unsetenv("TF_ENABLE_FUSED_ATTENTION");
+
+  std::map<string, float> expected_scales = {
+      {"attention", 0.125f}, {"attention_1", 0.25f}, {"attention_2", 1.0f}};
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    auto it = expected_scales.find(node.name());
+    if (it == expected_scales.end()) {
+      EXPECT_NE(node.op(), "Softmax") << node.name();
+      continue;
+    }
+    EXPECT_EQ(node.op(), "_FusedMultiHeadAttention") << node.name();
+    ASSERT_EQ(node.input_size(), 3);
+    EXPECT_EQ(node.input(0), "query");
+    EXPECT_EQ(node.input(1), "key");
+    EXPECT_EQ(node.input(2), "value");
+    EXPECT_FLOAT_EQ(node.attr().at("scale").f(), it->second);
+    found++;
+  }
+  EXPECT_EQ(3, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 3);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorNear<float>(tensors[i], tensors_expected[i], 1e-5);
+  }
+}
+
+TEST_F(RemapperTest, FuseElementwiseChain) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto x = Placeholder(s.WithOpName("x"), DT_FLOAT,
+                       ops::Placeholder::Shape({8, 16}));
+  auto y = Placeholder(s.WithOpName("y"), DT_FLOAT,
+                       ops::Placeholder::Shape({8, 16}));
+  auto half = ops::Const(s.WithOpName("half"), 0.5f, {});
+
+  auto mul = ops::Mul(s.WithOpName("mul"), x, y);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), mul);
+  auto add = ops::AddV2(s.WithOpName("add"), half, tanh);
+  auto sigmoid = ops::Sigmoid(s.WithOpName("sigmoid"), add);
+  // The chain stops at an op with another consumer.
+  auto relu = ops::Relu(s.WithOpName("relu"), x);
+  auto exp = ops::Exp(s.WithOpName("exp"), relu);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), sigmoid);
+  auto fetch_1 = ops::Identity(s.WithOpName("fetch_1"), relu);
+  auto fetch_2 = ops::Identity(s.WithOpName("fetch_2"), exp);
+
+  auto x_t = GenerateRandomTensor<DT_FLOAT>({8, 16});
+  auto y_t = GenerateRandomTensor<DT_FLOAT>({8, 16});
+
+  GrapplerItem item;
+  item.fetch = {"fetch", "fetch_1", "fetch_2"};
+  item.feed = {{"x", x_t}, {"y", y_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  // Without the opt-in, the chain is left alone.
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_FusedElementwise");
+  }
+
+  setenv("TF_ENABLE_FUSED_ELEMENTWISE", "1", 1 /* replace */);
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  unsetenv("TF_ENABLE_FUSED_ELEMENTWISE");
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "sigmoid") {
+      EXPECT_EQ(node.op(), "_FusedElementwise");
+      ASSERT_EQ(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "x");
+      EXPECT_EQ(node.input(1), "y");
+      EXPECT_EQ(node.input(2), "half");
+      EXPECT_EQ(node.attr().at("num_args").i(), 2);
+      const auto op_names = node.attr().at("op_names").list().s();
+      ASSERT_EQ(op_names.size(), 4);
+      EXPECT_EQ(op_names[0], "Mul");
+      EXPECT_EQ(op_names[1], "Tanh");
+      EXPECT_EQ(op_names[2], "AddV2");
+      EXPECT_EQ(op_names[3], "Sigmoid");
+      found++;
+    } else if (node.name() == "exp") {
+      EXPECT_EQ(node.op(), "Exp");
+      found++;
+    } else if (node.name() == "relu") {
+      EXPECT_EQ(node.op(), "Relu");
+      found++;
+    }
+    EXPECT_NE(node.name(), "mul");
+    EXPECT_NE(node.name(), "tanh");
+    EXPECT_NE(node.name(), "add");
+  }
+  EXPECT_EQ(3, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 3);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorNear<float>(tensors[i], tensors_expected[i], 1e-6);
+  }
+}
+
+TEST_F(RemapperTest, FuseResizeBilinearWithNormalize) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto images = Placeholder(s.WithOpName("images"), DT_UINT8,
+                            ops::Placeholder::Shape({2, 9, 7, 3}));
+  auto size = ops::Const(s.WithOpName("size"), {5, 12}, {2});
+  auto mean = ops::Const(s.WithOpName("mean"), {123.7f, 116.3f, 103.5f}, {3});
+  auto scale = ops::Const(s.WithOpName("scale"), 1.0f / 58.4f, {});
+  auto resize = ops::ResizeBilinear(
+      s.WithOpName("resize"), images, size,
+      ops::ResizeBilinear::HalfPixelCenters(true));
+  auto sub = ops::Sub(s.WithOpName("sub"), resize, mean);
+  auto mul = ops::Mul(s.WithOpName("mul"), scale, sub);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), mul);
+
+  Tensor images_t(DT_UINT8, {2, 9, 7, 3});
+  images_t.flat<uint8>().setRandom();
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"images", images_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "mul") {
+      EXPECT_EQ(node.op(), "_FusedResizeBilinear");
+      ASSERT_EQ(node.input_size(), 4);
+      EXPECT_EQ(node.input(0), "images");
+      EXPECT_EQ(node.input(1), "size");
+      EXPECT_EQ(node.input(2), "mean");
+      EXPECT_EQ(node.input(3), "scale");
+      EXPECT_TRUE(node.attr().at("half_pixel_centers").b());
+      found++;
+    }
+    EXPECT_NE(node.name(), "resize");
+    EXPECT_NE(node.name(), "sub");
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 2e-4);
+}
+
 TEST_F(RemapperTest, FuseConv2DWithBatchNorm) {
   using ops::Placeholder;
 
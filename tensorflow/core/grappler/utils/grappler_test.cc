@@ -78,6 +78,7 @@ void SetAllOptimizers(RewriterConfig* cfg, RewriterConfig::Toggle value) {
   cfg->set_debug_stripper(value);
   cfg->set_dependency_optimization(value);
   cfg->set_function_optimization(value);
+  cfg->set_horizontal_batching(value);
   cfg->set_implementation_selector(value);
   cfg->set_layout_optimizer(value);
   cfg->set_loop_optimization(value);
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/op_requires.h"
 #include "tensorflow/core/framework/resource_mgr.h"
@@ -47,6 +48,14 @@ constexpr char kMinInflightBatchesAttr[] = "_min_inflight_batches";
 constexpr char kInitialInflightBatchesAttr[] = "_initial_inflight_batches";
 constexpr char kMaxInflightBatchesAttr[] = "_max_inflight_batches";
 constexpr char kBatchesToAverageOverAttr[] = "_batches_to_average_over";
+constexpr char kEnablePriorityQueueAttr[] = "_enable_priority_queue";
+constexpr char kLowPriorityBatchTimeoutMicrosAttr[] =
+    "_low_priority_batch_timeout_micros";
+constexpr char kLowPriorityMaxEnqueuedBatchesAttr[] =
+    "_low_priority_max_enqueued_batches";
+// Set on a batch op to make its inputs low priority in a queue created with
+// `kEnablePriorityQueueAttr`.
+constexpr char kLowPriorityAttr[] = "_low_priority";
 
 // Default thread count in the per-process batching thread pool.
 constexpr int64_t kBatchThreadPoolSize = 128;
@@ -137,7 +146,10 @@ class BatchResource : public serving::BatchResourceBase {
                        FunctionLibraryRuntime::Handle fhandle,
                        FunctionLibraryRuntime* flib,
                        bool enable_large_batch_splitting,
-                       std::unique_ptr<BatchResource>* resource) {
+                       std::unique_ptr<BatchResource>* resource,
+                       bool enable_priority_queue = false,
+                       int32_t low_priority_batch_timeout_micros = 0,
+                       int32_t low_priority_max_enqueued_batches = 10) {
     BatcherT::Options batcher_options;
     batcher_options.num_batch_threads = num_batch_threads;
     std::shared_ptr<BatcherT> batcher;
@@ -148,7 +160,10 @@ class BatchResource : public serving::BatchResourceBase {
         GetBatcherQueueOptions(num_batch_threads, max_execution_batch_size,
                                batch_timeout_micros, max_enqueued_batches,
                                allowed_batch_sizes,
-                               enable_large_batch_splitting),
+                               enable_large_batch_splitting,
+                               enable_priority_queue,
+                               low_priority_batch_timeout_micros,
+                               low_priority_max_enqueued_batches),
         allowed_batch_sizes));
     return OkStatus();
   }
@@ -176,6 +191,15 @@ class BatchResource : public serving::BatchResourceBase {
   string DebugString() const final { return "BatchResource"; }
 
  private:
+  Status CreateBatchTask(OpKernelContext* context,
+                         std::unique_ptr<BatchTask>* output) const override {
+    *output = absl::make_unique<BatchTask>();
+    // Absent the attr, `low_priority` keeps its default of false.
+    TryGetNodeAttr(context->op_kernel().def(), kLowPriorityAttr,
+                   &(*output)->low_priority);
+    return OkStatus();
+  }
+
   BatchResource(FunctionLibraryRuntime::Handle fhandle,
                 FunctionLibraryRuntime* flib, std::shared_ptr<BatcherT> batcher,
                 const BatcherT::QueueOptions& batcher_queue_options,
@@ -256,6 +280,25 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
     has_attribute_enable_large_batch_splitting_ = false;
   }
 
+  if (c->HasAttr(kEnablePriorityQueueAttr)) {
+    OP_REQUIRES_OK(c, c->GetAttr(kEnablePriorityQueueAttr,
+                                 &enable_priority_queue_));
+  }
+  if (c->HasAttr(kLowPriorityBatchTimeoutMicrosAttr)) {
+    OP_REQUIRES_OK(c, c->GetAttr(kLowPriorityBatchTimeoutMicrosAttr,
+                                 &low_priority_batch_timeout_micros_));
+  }
+  if (c->HasAttr(kLowPriorityMaxEnqueuedBatchesAttr)) {
+    OP_REQUIRES_OK(c, c->GetAttr(kLowPriorityMaxEnqueuedBatchesAttr,
+                                 &low_priority_max_enqueued_batches_));
+  }
+  OP_REQUIRES(c,
+              !enable_priority_queue_ || low_priority_max_enqueued_batches_ > 0,
+              errors::InvalidArgument(
+                  kLowPriorityMaxEnqueuedBatchesAttr,
+                  " must be positive when the priority queue is enabled; was ",
+                  low_priority_max_enqueued_batches_));
+
   // Helper function `SetAdaptiveBatchSchedulerOptions` calls
   // `OP_REQUIRES_OK`, which exits the current function upon error.
   // So validate status of `op-kernel-construction`.
@@ -341,7 +384,9 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
       TF_RETURN_IF_ERROR(BatchResource::Create(
           num_batch_threads_, max_batch_size_, batch_timeout_micros_,
           max_enqueued_batches_, allowed_batch_sizes_, handle, flib_,
-          enable_large_batch_splitting_, &new_resource));
+          enable_large_batch_splitting_, &new_resource, enable_priority_queue_,
+          low_priority_batch_timeout_micros_,
+          low_priority_max_enqueued_batches_));
       *r = new_resource.release();
       return OkStatus();
     };
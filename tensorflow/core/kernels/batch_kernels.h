@@ -95,6 +95,10 @@ class BatchFunctionKernel : public AsyncOpKernel {
   bool enable_large_batch_splitting_;
   bool has_attribute_enable_large_batch_splitting_;
   bool enable_adaptive_batch_threads_ = false;
+  // Priority queue parameters for the non-adaptive batch scheduler only.
+  bool enable_priority_queue_ = false;
+  int32 low_priority_batch_timeout_micros_ = 0;
+  int32 low_priority_max_enqueued_batches_ = 10;
 
   mutex mu_;
 
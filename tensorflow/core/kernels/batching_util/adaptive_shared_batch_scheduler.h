@@ -132,6 +132,19 @@ class AdaptiveSharedBatchScheduler
     // full_batch_scheduling_boost_micros==zero) for backward compatibility of
     // API.
     bool fifo_scheduling = false;
+
+    // If true, schedule batches so that each queue receives processing time in
+    // proportion to its `QueueOptions::fair_share_weight`, instead of by batch
+    // age. A batch costs the time its processing callback takes (e.g. the
+    // device time of running a model on it), so a queue with expensive
+    // batches cannot starve queues with cheap ones.
+    // Requires that `fifo_scheduling` is false.
+    bool fair_scheduling = false;
+    // Only used with `fair_scheduling`. If true, a queue may use the share of
+    // the in-flight batches that other queues leave unused. If false, each
+    // queue is limited to its share of the in-flight batches (but may always
+    // have one batch in flight).
+    bool fair_scheduling_work_conserving = true;
   };
 
   // Ownership is shared between the caller of Create() and any queues created
@@ -168,6 +181,9 @@ class AdaptiveSharedBatchScheduler
                          int max_batch_size,
                          std::vector<std::unique_ptr<TaskType>>* output_tasks)>
         split_input_task_func;
+    // The relative share of processing time this queue receives when the
+    // scheduler uses `Options::fair_scheduling`. Must be positive.
+    double fair_share_weight = 1.0;
   };
 
   using BatchProcessor = std::function<void(std::unique_ptr<Batch<TaskType>>)>;
@@ -198,6 +214,11 @@ class AdaptiveSharedBatchScheduler
   // Schedules batch using FIFO policy if in_flight_batches_limit_ is not met.
   void MaybeScheduleNextBatchFIFO() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Returns the schedulable batch in batches_ whose queue has received the
+  // least processing time relative to its weight, or batches_.end().
+  typename std::vector<const internal::ASBSBatch<TaskType>*>::iterator
+  FindFairBatch(int64_t now_micros) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Schedules all closed batches in batches_ for which an idle thread is
   // available in batch_thread_pool_.
   // Batches scheduled this way are called express batches.
@@ -234,6 +255,24 @@ class AdaptiveSharedBatchScheduler
   std::unordered_map<const internal::ASBSQueue<TaskType>*, BatchProcessor>
       queues_and_callbacks_ TF_GUARDED_BY(mu_);
 
+  // Processing time accounting of a queue, used by fair scheduling.
+  struct FairShareState {
+    double weight = 1.0;
+    // Processing time received by the queue, in microseconds, divided by its
+    // weight.
+    double virtual_time_micros = 0;
+    // Number of regular batches of the queue currently being processed.
+    int64_t in_flight_batches = 0;
+  };
+  std::unordered_map<const internal::ASBSQueue<TaskType>*, FairShareState>
+      fair_share_states_ TF_GUARDED_BY(mu_);
+  // Sum of the weights in fair_share_states_.
+  double total_fair_share_weight_ TF_GUARDED_BY(mu_) = 0;
+  // The virtual time of the most recently scheduled batch. Queues that were
+  // idle resume from here, rather than catching up on processing time they
+  // did not ask for.
+  double fair_virtual_time_micros_ TF_GUARDED_BY(mu_) = 0;
+
   mutex mu_;
 
   // Responsible for running the batch processing callbacks.
@@ -417,6 +456,10 @@ Status AdaptiveSharedBatchScheduler<TaskType>::Create(
         "greater than or equal to 1; was ",
         options.batches_to_average_over);
   }
+  if (options.fair_scheduling && options.fifo_scheduling) {
+    return errors::InvalidArgument(
+        "fair_scheduling and fifo_scheduling can't both be enabled");
+  }
   scheduler->reset(new AdaptiveSharedBatchScheduler<TaskType>(options));
   return OkStatus();
 }
@@ -452,6 +495,10 @@ Status AdaptiveSharedBatchScheduler<TaskType>::AddQueue(
         "max_enqueued_batches must be positive; was ",
         options.max_enqueued_batches);
   }
+  if (!(options.fair_share_weight > 0)) {
+    return errors::InvalidArgument("fair_share_weight must be positive; was ",
+                                   options.fair_share_weight);
+  }
   if (options.max_input_task_size.has_value()) {
     if (options.max_input_task_size.value() < options.max_batch_size) {
       return errors::InvalidArgument(
@@ -466,6 +513,12 @@ Status AdaptiveSharedBatchScheduler<TaskType>::AddQueue(
                    this->shared_from_this(), options));
   mutex_lock l(mu_);
   queues_and_callbacks_[asbs_queue_raw] = process_batch_callback;
+  if (options_.fair_scheduling) {
+    FairShareState& state = fair_share_states_[asbs_queue_raw];
+    state.weight = options.fair_share_weight;
+    state.virtual_time_micros = fair_virtual_time_micros_;
+    total_fair_share_weight_ += options.fair_share_weight;
+  }
   return OkStatus();
 }
 
@@ -501,6 +554,11 @@ void AdaptiveSharedBatchScheduler<TaskType>::RemoveQueue(
     const internal::ASBSQueue<TaskType>* queue) {
   mutex_lock l(mu_);
   queues_and_callbacks_.erase(queue);
+  auto it = fair_share_states_.find(queue);
+  if (it != fair_share_states_.end()) {
+    total_fair_share_weight_ -= it->second.weight;
+    fair_share_states_.erase(it);
+  }
 }
 
 template <typename TaskType>
@@ -560,23 +618,34 @@ void AdaptiveSharedBatchScheduler<TaskType>::MaybeScheduleNextBatch() {
   }
 
   auto best_it = batches_.end();
-  double best_score = (std::numeric_limits<double>::max)();
   int64_t now_micros = GetEnv()->NowMicros();
-  for (auto it = batches_.begin(); it != batches_.end(); it++) {
-    if ((*it)->schedulable_time_micros() > now_micros) continue;
-    const double score =
-        (*it)->creation_time_micros() -
-        options_.full_batch_scheduling_boost_micros * (*it)->size() /
-            static_cast<double>((*it)->queue()->max_task_size());
-    if (best_it == batches_.end() || score < best_score) {
-      best_score = score;
-      best_it = it;
+  if (options_.fair_scheduling) {
+    best_it = FindFairBatch(now_micros);
+  } else {
+    double best_score = (std::numeric_limits<double>::max)();
+    for (auto it = batches_.begin(); it != batches_.end(); it++) {
+      if ((*it)->schedulable_time_micros() > now_micros) continue;
+      const double score =
+          (*it)->creation_time_micros() -
+          options_.full_batch_scheduling_boost_micros * (*it)->size() /
+              static_cast<double>((*it)->queue()->max_task_size());
+      if (best_it == batches_.end() || score < best_score) {
+        best_score = score;
+        best_it = it;
+      }
     }
   }
   // No schedulable batches.
   if (best_it == batches_.end()) return;
   const internal::ASBSBatch<TaskType>* batch = *best_it;
   batches_.erase(best_it);
+  if (options_.fair_scheduling) {
+    FairShareState& state = fair_share_states_[batch->queue()];
+    state.virtual_time_micros =
+        std::max(state.virtual_time_micros, fair_virtual_time_micros_);
+    fair_virtual_time_micros_ = state.virtual_time_micros;
+    state.in_flight_batches++;
+  }
   // Queue may destroy itself after ReleaseBatch is called.
   batch->queue()->ReleaseBatch(batch);
   batch_thread_pool_->Schedule(
@@ -585,6 +654,33 @@ void AdaptiveSharedBatchScheduler<TaskType>::MaybeScheduleNextBatch() {
   in_flight_batches_++;
 }
 
+template <typename TaskType>
+typename std::vector<const internal::ASBSBatch<TaskType>*>::iterator
+AdaptiveSharedBatchScheduler<TaskType>::FindFairBatch(int64_t now_micros) {
+  auto best_it = batches_.end();
+  double best_virtual_time_micros = 0;
+  for (auto it = batches_.begin(); it != batches_.end(); it++) {
+    if ((*it)->schedulable_time_micros() > now_micros) continue;
+    const FairShareState& state = fair_share_states_[(*it)->queue()];
+    if (!options_.fair_scheduling_work_conserving &&
+        state.in_flight_batches > 0 &&
+        state.in_flight_batches >= in_flight_batches_limit_ * state.weight /
+                                       total_fair_share_weight_) {
+      continue;
+    }
+    const double virtual_time_micros =
+        std::max(state.virtual_time_micros, fair_virtual_time_micros_);
+    if (best_it == batches_.end() ||
+        virtual_time_micros < best_virtual_time_micros ||
+        (virtual_time_micros == best_virtual_time_micros &&
+         (*it)->creation_time_micros() < (*best_it)->creation_time_micros())) {
+      best_virtual_time_micros = virtual_time_micros;
+      best_it = it;
+    }
+  }
+  return best_it;
+}
+
 template <typename TaskType>
 void AdaptiveSharedBatchScheduler<TaskType>::MaybeScheduleClosedBatches() {
   mutex_lock l(mu_);
@@ -633,10 +729,23 @@ void AdaptiveSharedBatchScheduler<TaskType>::CallbackWrapper(
       profiler::ContextType::kAdaptiveSharedBatchScheduler,
       batch->traceme_context_id());
   const int64_t start_time = batch->creation_time_micros();
+  // The batch, but not necessarily its queue, is gone after the callback.
+  const internal::ASBSQueue<TaskType>* queue = batch->queue();
+  const int64_t callback_start_time = GetEnv()->NowMicros();
   callback(std::unique_ptr<Batch<TaskType>>(
       const_cast<internal::ASBSBatch<TaskType>*>(batch)));
   int64_t end_time = GetEnv()->NowMicros();
   mutex_lock l(mu_);
+  if (options_.fair_scheduling) {
+    auto it = fair_share_states_.find(queue);
+    if (it != fair_share_states_.end()) {
+      it->second.virtual_time_micros +=
+          (end_time - callback_start_time) / it->second.weight;
+      if (!is_express) {
+        it->second.in_flight_batches--;
+      }
+    }
+  }
   if (is_express) {
     in_flight_express_batches_--;
     MaybeScheduleClosedBatchesLocked();
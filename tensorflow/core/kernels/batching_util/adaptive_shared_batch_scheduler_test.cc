@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -343,6 +344,92 @@ TEST(AdaptiveSharedBatchSchedulerTest, FIFO) {
   stop_teardown.Notify();
 }
 
+TEST(AdaptiveSharedBatchSchedulerTest, FairScheduling) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    AdaptiveSharedBatchScheduler<FakeTask>::Options options;
+    options.env = &env;
+    options.initial_in_flight_batches_limit = 1;
+    options.num_batch_threads = 1;
+    options.batches_to_average_over = 1000;
+    options.full_batch_scheduling_boost_micros = 0;
+    options.fair_scheduling = true;
+    mutex mu;
+    std::vector<string> processed;
+    Notification finish_processing;
+    // Batches of queue A take 10x longer to process than those of queue B.
+    auto queue_a_callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      finish_processing.WaitForNotification();
+      env.AdvanceByMicroseconds(100);
+      mutex_lock l(mu);
+      processed.push_back(strings::StrCat("a", batch->size()));
+    };
+    auto queue_b_callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      env.AdvanceByMicroseconds(10);
+      mutex_lock l(mu);
+      processed.push_back(strings::StrCat("b", batch->size()));
+    };
+    std::shared_ptr<AdaptiveSharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(
+        AdaptiveSharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    AdaptiveSharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = 10;
+    queue_options.batch_timeout_micros = 0;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue_a;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue_b;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, queue_a_callback, &queue_a));
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, queue_b_callback, &queue_b));
+
+    // First batch immediately processed; the others wait for it.
+    TF_ASSERT_OK(ScheduleTask(10, queue_a.get()));
+    env.AdvanceByMicroseconds(1);
+    TF_ASSERT_OK(ScheduleTask(9, queue_a.get()));
+    env.AdvanceByMicroseconds(1);
+    TF_ASSERT_OK(ScheduleTask(8, queue_a.get()));
+    env.AdvanceByMicroseconds(1);
+    TF_ASSERT_OK(ScheduleTask(10, queue_b.get()));
+    env.AdvanceByMicroseconds(1);
+    TF_ASSERT_OK(ScheduleTask(9, queue_b.get()));
+
+    finish_processing.Notify();
+    while (true) {
+      mutex_lock l(mu);
+      if (processed.size() == 5) break;
+    }
+    // Although queue A's batches are older, queue B's cheaper batches run
+    // first since queue A already used 100us of processing time.
+    mutex_lock l(mu);
+    EXPECT_THAT(processed,
+                ::testing::ElementsAre("a10", "b10", "b9", "a9", "a8"));
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(AdaptiveSharedBatchSchedulerTest, BadFairSchedulingOptions) {
+  using Scheduler = AdaptiveSharedBatchScheduler<FakeTask>;
+  std::shared_ptr<Scheduler> scheduler;
+  Scheduler::Options options;
+  options.fair_scheduling = true;
+  options.fifo_scheduling = true;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options.fifo_scheduling = false;
+  TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+  Scheduler::QueueOptions queue_options;
+  queue_options.fair_share_weight = 0;
+  std::unique_ptr<BatchScheduler<FakeTask>> queue;
+  EXPECT_FALSE(
+      scheduler
+          ->AddQueue(queue_options,
+                     [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue)
+          .ok());
+}
+
 TEST(AdaptiveSharedBatchSchedulerTest, DeleteQueue) {
   AdaptiveSharedBatchScheduler<FakeTask>::Options options;
   options.initial_in_flight_batches_limit = 1;
@@ -35,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/incremental_barrier.h"
 
 namespace tensorflow {
@@ -131,6 +132,49 @@ void RecordProcessedBatchSizeV2(int32_t batch_size, const string& model_name,
       ->IncrementBy(1);
 }
 
+// Returns true if batched outputs may be handed to tasks as slices aliasing the
+// batched output tensor, rather than as copies. This saves a copy of every
+// output, at the expense of keeping each batched output alive until all of the
+// tasks' outputs are released.
+bool AliasBatchedOutputs() {
+  static const bool alias_batched_outputs = [] {
+    bool alias;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_BATCHING_ALIAS_BATCHED_OUTPUTS",
+                                   /*default_val=*/false, &alias));
+    return alias;
+  }();
+  return alias_batched_outputs;
+}
+
+// Returns true if tasks should be queued by the shapes of their inputs, so that
+// only tasks whose inputs agree beyond the 0th dimension (e.g. in sequence
+// length) are batched together.
+bool BucketByInputShape() {
+  static const bool bucket_by_input_shape = [] {
+    bool bucket;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_BATCHING_BUCKET_BY_INPUT_SHAPE",
+                                   /*default_val=*/false, &bucket));
+    return bucket;
+  }();
+  return bucket_by_input_shape;
+}
+
+// Tracks the tasks submitted to batch queues, by priority and whether the
+// queue had room for them.
+void RecordScheduledTask(bool low_priority, const Status& status,
+                         const string& model_name, const string& op_name) {
+  static auto* cell = monitoring::Counter<4>::New(
+      "/tensorflow/serving/batching/scheduled_tasks",
+      "Tracks the tasks submitted to batch queues by model_name, op name, "
+      "priority (high or low) and status (ok, full or error).",
+      "model_name", "op_name", "priority", "status");
+  const char* status_label =
+      status.ok() ? "ok" : (errors::IsUnavailable(status) ? "full" : "error");
+  cell->GetCell(model_name, op_name, low_priority ? "low" : "high",
+                status_label)
+      ->IncrementBy(1);
+}
+
 // TODO(b/181883417): Replace with RecordBatchDelayUsV2.
 void RecordBatchDelayUs(int64_t batch_delay_us, const string& model_name,
                         const string& op_name, int32_t batch_size) {
@@ -207,6 +251,43 @@ const string& GetModelName(OpKernelContext* ctx) {
 
 }  // namespace
 
+namespace internal {
+
+bool SplitIntoAlignedSlices(const Tensor& input,
+                            const std::vector<int64_t>& sizes,
+                            std::vector<Tensor>* outputs) {
+  std::vector<Tensor> slices;
+  slices.reserve(sizes.size());
+  int64_t position = 0;
+  for (const int64_t size : sizes) {
+    slices.push_back(input.Slice(position, position + size));
+    if (!slices.back().IsAligned()) {
+      return false;
+    }
+    position += size;
+  }
+  *outputs = std::move(slices);
+  return true;
+}
+
+void RecordPaddingEfficiency(int32_t batch_size, int32_t padded_batch_size,
+                             const string& model_name, const string& op_name) {
+  static auto* cell = tensorflow::monitoring::Sampler<2>::New(
+      {"/tensorflow/serving/batching/padding_efficiency",
+       "Tracks the percentage of processed batch slots that are not padding, "
+       "by model_name and op name (if available).",
+       "model_name", "op_name"},
+      // Buckets of 5% each.
+      monitoring::Buckets::Explicit({5,  10, 15, 20, 25, 30, 35, 40, 45, 50,
+                                     55, 60, 65, 70, 75, 80, 85, 90, 95, 100}));
+  if (padded_batch_size > 0) {
+    cell->GetCell(model_name, op_name)
+        ->Add(100.0 * batch_size / padded_batch_size);
+  }
+}
+
+}  // namespace internal
+
 std::unique_ptr<BatchResourceBase::BatchTask>
 BatchResourceBase::BatchTask::CreateSplitTask(
     int split_index, AsyncOpKernel::DoneCallback done_callback) {
@@ -223,6 +304,10 @@ BatchResourceBase::BatchTask::CreateSplitTask(
   task->status = this->status;
   task->is_partial = true;
   task->start_time = this->start_time;
+  task->low_priority = this->low_priority;
+  task->deadline_micros = this->deadline_micros;
+  task->sequence_id = this->sequence_id;
+  task->end_of_sequence = this->end_of_sequence;
   task->request_cost = this->request_cost;
 
   return task;
@@ -307,9 +392,14 @@ Status BatchResourceBase::RegisterInput(
   }
 
   BatcherQueueT* batcher_queue;
-  TF_RETURN_IF_ERROR(
-      LookupOrCreateBatcherQueue(batcher_queue_name, &batcher_queue));
-  return batcher_queue->Schedule(&batch_components);
+  TF_RETURN_IF_ERROR(LookupOrCreateBatcherQueue(
+      GetTaskQueueName(batcher_queue_name, *batch_components),
+      &batcher_queue));
+  const bool low_priority = batch_components->low_priority;
+  Status status = batcher_queue->Schedule(&batch_components);
+  RecordScheduledTask(low_priority, status, GetModelName(context),
+                      context->op_kernel().name());
+  return status;
 }
 
 /*static*/ BatchResourceBase::BatcherT::QueueOptions
@@ -317,13 +407,23 @@ BatchResourceBase::GetBatcherQueueOptions(
     int32_t num_batch_threads, int32_t max_batch_size,
     int32_t batch_timeout_micros, int32_t max_enqueued_batches,
     const std::vector<int32>& allowed_batch_sizes,
-    bool enable_large_batch_splitting) {
+    bool enable_large_batch_splitting, bool enable_priority_queue,
+    int32_t low_priority_batch_timeout_micros,
+    int32_t low_priority_max_enqueued_batches) {
   BatcherT::QueueOptions batcher_queue_options;
   batcher_queue_options.input_batch_size_limit = max_batch_size;
   batcher_queue_options.max_enqueued_batches = max_enqueued_batches;
   batcher_queue_options.batch_timeout_micros = batch_timeout_micros;
   batcher_queue_options.enable_large_batch_splitting =
       enable_large_batch_splitting;
+  batcher_queue_options.task_deadline_micros_func = [](const BatchTask& task) {
+    return task.deadline_micros;
+  };
+  batcher_queue_options.enable_priority_queue = enable_priority_queue;
+  batcher_queue_options.low_priority_queue_options.batch_timeout_micros =
+      low_priority_batch_timeout_micros;
+  batcher_queue_options.low_priority_queue_options.max_enqueued_batches =
+      low_priority_max_enqueued_batches;
   if (enable_large_batch_splitting) {
     batcher_queue_options.split_input_task_func =
         [](std::unique_ptr<BatchTask>* input_task,
@@ -428,6 +528,9 @@ Status BatchResourceBase::ConcatInputTensors(
                              string(context->op_kernel().name_view()));
   RecordBatchSize(batch.size(), GetModelName(context),
                   string(context->op_kernel().name_view()));
+  internal::RecordPaddingEfficiency(batch.size(), padded_batch_size,
+                                    GetModelName(context),
+                                    context->op_kernel().name());
 
   // All tasks should have the same number of input edges.
   const int num_inputs = batch.task(0).inputs.size();
@@ -463,6 +566,12 @@ Status BatchResourceBase::ConcatInputTensors(
       }
     }
 
+    // A single unpadded task is already the batch.
+    if (to_concatenate.size() == 1) {
+      concatenated_tensors->push_back(to_concatenate[0]);
+      continue;
+    }
+
     Tensor concatenated_tensor;
     Status concat_status =
         Concat(context, to_concatenate, &concatenated_tensor);
@@ -610,12 +719,20 @@ Status BatchResourceBase::SplitOutputTensors(
     }
 
     std::vector<Tensor> split_tensor;
-    const Status split_status = tensor::Split(
-        output_tensor, task_sizes_plus_optional_padding, &split_tensor);
-    DCHECK(split_status.ok()) << split_status.ToString();
-    if (!split_status.ok()) {
-      return errors::Internal("Tensor split operation failed: ",
-                              split_status.error_message());
+    if (task_sizes_plus_optional_padding.size() == 1) {
+      // A single unpadded task gets the whole batched output.
+      split_tensor.push_back(output_tensor);
+    } else if (!AliasBatchedOutputs() ||
+               !internal::SplitIntoAlignedSlices(
+                   output_tensor, task_sizes_plus_optional_padding,
+                   &split_tensor)) {
+      const Status split_status = tensor::Split(
+          output_tensor, task_sizes_plus_optional_padding, &split_tensor);
+      DCHECK(split_status.ok()) << split_status.ToString();
+      if (!split_status.ok()) {
+        return errors::Internal("Tensor split operation failed: ",
+                                split_status.error_message());
+      }
     }
     DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
     if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
@@ -704,6 +821,14 @@ void BatchResourceBase::ProcessFuncBatch(std::unique_ptr<BatchT> batch) const {
   std::vector<Tensor> combined_outputs;
   std::vector<Tensor> args(concatenated_tensors.begin(),
                            concatenated_tensors.end());
+  std::vector<int64_t> sequence_ids;
+  if (paged_state_pool_ != nullptr) {
+    status = AddPagedStateArgs(paged_state_pool_.get(), *batch,
+                               processed_size, &sequence_ids, &args);
+    if (!status.ok()) {
+      return;
+    }
+  }
   const auto& captured_inputs =
       batch->task(batch->num_tasks() - 1).captured_inputs;
   args.insert(args.end(), captured_inputs.begin(), captured_inputs.end());
@@ -737,10 +862,67 @@ void BatchResourceBase::ProcessFuncBatch(std::unique_ptr<BatchT> batch) const {
         if (!final_status.ok()) {
           return;
         }
+        if (paged_state_pool_ != nullptr) {
+          final_status = AppendPagedState(paged_state_pool_.get(), *batch,
+                                          sequence_ids, &combined_outputs);
+          if (!final_status.ok()) {
+            return;
+          }
+        }
         final_status = SplitOutputTensors(combined_outputs, batch.get());
       });
 }
 
+Status BatchResourceBase::AddPagedStateArgs(
+    PagedStatePool* pool, const BatchT& batch, int64_t num_rows,
+    std::vector<int64_t>* sequence_ids, std::vector<Tensor>* args) {
+  sequence_ids->clear();
+  sequence_ids->reserve(batch.num_tasks());
+  for (int i = 0; i < batch.num_tasks(); ++i) {
+    const BatchTask& task = batch.task(i);
+    if (task.sequence_id < 0 || task.size() != 1) {
+      return errors::InvalidArgument(
+          "With a paged state pool, each task must run one step of one "
+          "sequence; got a task of size ",
+          task.size(), " for sequence ", task.sequence_id);
+    }
+    if (pool->SequenceLength(task.sequence_id) < 0) {
+      TF_RETURN_IF_ERROR(pool->AddSequence(task.sequence_id));
+    }
+    sequence_ids->push_back(task.sequence_id);
+  }
+  Tensor page_table, lengths;
+  TF_RETURN_IF_ERROR(
+      pool->GetPageTable(*sequence_ids, num_rows, &page_table, &lengths));
+  args->push_back(pool->pages());
+  args->push_back(std::move(page_table));
+  args->push_back(std::move(lengths));
+  return OkStatus();
+}
+
+Status BatchResourceBase::AppendPagedState(
+    PagedStatePool* pool, const BatchT& batch,
+    const std::vector<int64_t>& sequence_ids, std::vector<Tensor>* outputs) {
+  const int64_t num_sequences = sequence_ids.size();
+  if (outputs->empty() || outputs->back().dims() < 1 ||
+      outputs->back().dim_size(0) < num_sequences) {
+    return errors::InvalidArgument(
+        "Expected the batch function to return the state of ", num_sequences,
+        " sequences as its last output");
+  }
+  const Tensor states = std::move(outputs->back());
+  outputs->pop_back();
+  // Rows past the sequences pad the batch.
+  TF_RETURN_IF_ERROR(
+      pool->AppendBatch(sequence_ids, states.Slice(0, num_sequences)));
+  for (int i = 0; i < batch.num_tasks(); ++i) {
+    if (batch.task(i).end_of_sequence) {
+      TF_RETURN_IF_ERROR(pool->RemoveSequence(batch.task(i).sequence_id));
+    }
+  }
+  return OkStatus();
+}
+
 // Processes a batch of one or more BatchTask entries.
 void BatchResourceBase::ProcessBatch(std::unique_ptr<BatchT> batch) const {
   if (batch->empty()) {
@@ -845,6 +1027,35 @@ void BatchResourceBase::ProcessBatch(std::unique_ptr<BatchT> batch) const {
   return OkStatus();
 }
 
+string BatchResourceBase::GetTaskQueueName(const string& batcher_queue_name,
+                                           const BatchTask& task) {
+  if (!BucketByInputShape()) {
+    return batcher_queue_name;
+  }
+  return GetInputShapeQueueName(batcher_queue_name, task);
+}
+
+string BatchResourceBase::GetInputShapeQueueName(
+    const string& batcher_queue_name, const BatchTask& task) {
+  string queue_name = strings::StrCat(batcher_queue_name, "/shape:");
+  for (const Tensor& input : task.inputs) {
+    for (int i = 1; i < input.dims(); ++i) {
+      strings::StrAppend(&queue_name, input.dim_size(i), ",");
+    }
+    strings::StrAppend(&queue_name, ";");
+  }
+
+  mutex_lock l(batcher_queues_mu_);
+  std::set<string>& buckets = input_shape_buckets_[batcher_queue_name];
+  if (buckets.count(queue_name) == 0) {
+    if (buckets.size() >= kMaxInputShapeBucketsPerQueue) {
+      return batcher_queue_name;
+    }
+    buckets.insert(queue_name);
+  }
+  return queue_name;
+}
+
 // Looks up the batcher queue for 'queue_name'. If it did't previously exist,
 // creates it.
 Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
@@ -889,6 +1100,22 @@ Status BatchResourceBase::CreateBatchTask(
 void BatchResourceBase::SplitBatchCosts(
     std::vector<std::unique_ptr<CostMeasurement>>& batch_cost_measurements,
     const int64_t processed_size, BatchT& batch) {
+  // Records how the batch was shared, so that the cost of each request can
+  // also be amortized by its consumers.
+  RequestCost::BatchMetrics batch_metrics;
+  batch_metrics.processed_size = processed_size;
+  batch_metrics.padding_size = processed_size - batch.size();
+  for (auto& batch_cost_measurement : batch_cost_measurements) {
+    batch_metrics.batch_costs[batch_cost_measurement->GetCostType()] +=
+        batch_cost_measurement->GetTotalCost();
+  }
+  for (int i = 0; i < batch.num_tasks(); i++) {
+    RequestCost* request_cost = batch.task(i).request_cost;
+    if (!request_cost) continue;
+    batch_metrics.input_size = batch.task(i).size();
+    request_cost->RecordBatchMetrics(batch_metrics);
+  }
+
   for (auto& batch_cost_measurement : batch_cost_measurements) {
     if (batch_cost_measurement->GetTotalCost() <= absl::ZeroDuration()) {
       return;
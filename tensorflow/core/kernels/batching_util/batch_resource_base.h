@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_RESOURCE_BASE_H_
 
 #include <map>
+#include <set>
 
 #include "absl/strings/str_join.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
@@ -27,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/batching_util/adaptive_shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/paged_state_pool.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
 #include "tensorflow/core/platform/context.h"
@@ -93,8 +95,29 @@ class BatchResourceBase : public ResourceBase {
 
     uint64 start_time;
 
+    // Whether this task may wait for other tasks to be batched first; see
+    // `SharedBatchScheduler::QueueOptions::enable_priority_queue`. Set by
+    // `CreateBatchTask()` overrides, e.g. from the criticality of a request.
+    bool low_priority = false;
+
+    // The time by which this task should finish, in microseconds of
+    // `Env::NowMicros()`, or 0 if it has no deadline; see
+    // `SharedBatchScheduler::QueueOptions::task_deadline_micros_func`. Set by
+    // `CreateBatchTask()` overrides, e.g. from the deadline of a request.
+    int64_t deadline_micros = 0;
+
+    // The sequence this task decodes one step of, when the resource has a
+    // paged state pool; see `set_paged_state_pool()`. Set by
+    // `CreateBatchTask()` overrides.
+    int64_t sequence_id = -1;
+    // Whether this is the last step of `sequence_id`, after which its state
+    // is released.
+    bool end_of_sequence = false;
+
     size_t size() const override { return inputs[0].shape().dim_size(0); }
 
+    bool is_low_priority() const override { return low_priority; }
+
     // Create a split task from this one. The caller needs to setup the inputs
     // of the new task
     std::unique_ptr<BatchTask> CreateSplitTask(
@@ -146,11 +169,16 @@ class BatchResourceBase : public ResourceBase {
         adaptive_batcher_queue_options_(batcher_queue_options),
         allowed_batch_sizes_(std::move(allowed_batch_sizes)) {}
 
+  // If `enable_priority_queue` is true, low-priority tasks wait in a separate
+  // lane of the queue with the given timeout and capacity; see
+  // `SharedBatchScheduler::QueueOptions::enable_priority_queue`.
   static BatcherT::QueueOptions GetBatcherQueueOptions(
       int32_t num_batch_threads, int32_t max_batch_size,
       int32_t batch_timeout_micros, int32_t max_enqueued_batches,
       const std::vector<int32>& allowed_batch_sizes,
-      bool enable_large_batch_splitting);
+      bool enable_large_batch_splitting, bool enable_priority_queue = false,
+      int32_t low_priority_batch_timeout_micros = 0,
+      int32_t low_priority_max_enqueued_batches = 10);
 
   static AdaptiveBatcherT::QueueOptions GetAdaptiveBatcherQueueOptions(
       int32_t max_batch_size, int32_t batch_timeout_micros,
@@ -192,10 +220,58 @@ class BatchResourceBase : public ResourceBase {
   //    and paddings do not share any cost;
   // 2) non-smeared cost: batch cost is split proportionally to each task or
   //    padding's size. Here padding's cost is not assigned to any tasks.
+  // The batch metrics (sizes and total costs) are also recorded on each
+  // task's request_cost, whether or not there is any cost to split.
   static void SplitBatchCosts(
       std::vector<std::unique_ptr<CostMeasurement>>& batch_cost_measurements,
       const int64_t processed_size, BatchT& batch);
 
+  // Adds the state of the sequences of 'batch' in 'pool' to 'args': the
+  // pages of 'pool', and the page table and lengths of the sequences padded
+  // to 'num_rows' rows; see `PagedStatePool::GetPageTable()`. Returns the
+  // sequence of each task in 'sequence_ids'. Sequences that are not in
+  // 'pool' yet are added to it.
+  static Status AddPagedStateArgs(PagedStatePool* pool, const BatchT& batch,
+                                  int64_t num_rows,
+                                  std::vector<int64_t>* sequence_ids,
+                                  std::vector<Tensor>* args);
+
+  // Removes the last of 'outputs', the state of the step of the batch, and
+  // appends its rows to the sequences in 'sequence_ids'. Then releases the
+  // sequences whose task in 'batch' has `end_of_sequence` set.
+  static Status AppendPagedState(PagedStatePool* pool, const BatchT& batch,
+                                 const std::vector<int64_t>& sequence_ids,
+                                 std::vector<Tensor>* outputs);
+
+ protected:
+  // Enables iteration-level batching of autoregressive models, where each
+  // batch runs one decode step of the sequences of its tasks. The batch
+  // function gets three more inputs after the batched ones: the pages of
+  // 'pool', the int32 page table of the batch's sequences and their int32
+  // lengths. It returns the state of the step, of shape
+  // [batch_size, num_tokens] + token_shape, as its last output, which is
+  // appended to the sequences instead of being returned to the tasks. Must be
+  // called before any input is registered.
+  void set_paged_state_pool(std::unique_ptr<PagedStatePool> pool) {
+    paged_state_pool_ = std::move(pool);
+  }
+
+  // The maximum number of input shape buckets per batcher queue. Tasks of
+  // other shapes share the queue's default bucket.
+  static constexpr int kMaxInputShapeBucketsPerQueue = 64;
+
+  // Returns the name of the batcher queue 'task' should go to. That is
+  // 'batcher_queue_name', or, when bucketing tasks by input shape, a queue of
+  // tasks whose inputs have the same shape beyond the 0th dimension.
+  string GetTaskQueueName(const string& batcher_queue_name,
+                          const BatchTask& task);
+
+  // Returns the name of the queue of tasks whose inputs have the same shape
+  // as those of 'task' beyond the 0th dimension, or 'batcher_queue_name' if
+  // that queue would be past its 'kMaxInputShapeBucketsPerQueue' buckets.
+  string GetInputShapeQueueName(const string& batcher_queue_name,
+                                const BatchTask& task);
+
  private:
   // Implementation of calling the process batch function.
   virtual void ProcessFuncBatchImpl(
@@ -259,13 +335,38 @@ class BatchResourceBase : public ResourceBase {
   mutable mutex batcher_queues_mu_;
   std::map<string, std::unique_ptr<BatcherQueueT>> batcher_queues_
       TF_GUARDED_BY(batcher_queues_mu_);
+  // The input shape bucket queues of each batcher queue name; see
+  // 'GetInputShapeQueueName'.
+  std::map<string, std::set<string>> input_shape_buckets_
+      TF_GUARDED_BY(batcher_queues_mu_);
 
   std::vector<int32> allowed_batch_sizes_;
   // A concatenated string of <allowed_batch_sizes_>, separated by ",". This is
   // used to record batching parameter.
   string allowed_batch_sizes_str_;
+
+  // The state of the sequences decoded by batches, if any; see
+  // 'set_paged_state_pool'.
+  std::unique_ptr<PagedStatePool> paged_state_pool_;
 };
 
+namespace internal {
+
+// Splits 'input' along the 0th dimension into slices of 'sizes' that alias
+// it. Returns false, leaving 'outputs' untouched, if some slice would be
+// misaligned. Exposed for testing.
+bool SplitIntoAlignedSlices(const Tensor& input,
+                            const std::vector<int64_t>& sizes,
+                            std::vector<Tensor>* outputs);
+
+// Records the percentage of the 'padded_batch_size' slots of a processed batch
+// that hold task data rather than padding, if the batch has any slots. Exposed
+// for testing.
+void RecordPaddingEfficiency(int32_t batch_size, int32_t padded_batch_size,
+                             const string& model_name, const string& op_name);
+
+}  // namespace internal
+
 }  // namespace serving
 }  // namespace tensorflow
 
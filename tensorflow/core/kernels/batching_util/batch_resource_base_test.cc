@@ -19,12 +19,19 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/cost_measurement.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/no_op_cost_measurement.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/batching_util/paged_state_pool.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
 namespace serving {
 namespace {
 
+using ::tensorflow::monitoring::testing::CellReader;
+using ::tensorflow::monitoring::testing::Histogram;
 using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
 
@@ -164,6 +171,314 @@ TEST(SplitBatchCostTest, SplitMultiCostTypes) {
                            Pair("test_gcu_no_smear", absl::Milliseconds(90))));
 }
 
+TEST(SplitBatchCostTest, RecordsBatchMetrics) {
+  BatchResourceBase::BatchT batch;
+  RequestCost cost1, cost2;
+  batch.AddTask(MakeBatchTask(/*task_size=*/1, &cost1));
+  batch.AddTask(MakeBatchTask(/*task_size=*/9, &cost2));
+  batch.Close();
+
+  CostMeasurement::Context context{/*is_per_query=*/false};
+  std::vector<std::unique_ptr<CostMeasurement>> batch_cost_measurements;
+  batch_cost_measurements.push_back(
+      CostMeasurementRegistry::CreateByNameOrNull("test_tpu", context));
+  BatchResourceBase::SplitBatchCosts(batch_cost_measurements,
+                                     /*processed_size=*/16, batch);
+
+  std::vector<RequestCost::BatchMetrics> batch_metrics =
+      cost1.GetBatchMetrics();
+  ASSERT_EQ(batch_metrics.size(), 1);
+  EXPECT_EQ(batch_metrics[0].processed_size, 16);
+  EXPECT_EQ(batch_metrics[0].input_size, 1);
+  EXPECT_EQ(batch_metrics[0].padding_size, 6);
+  EXPECT_THAT(batch_metrics[0].batch_costs,
+              UnorderedElementsAre(Pair("test_tpu", absl::Milliseconds(100))));
+
+  batch_metrics = cost2.GetBatchMetrics();
+  ASSERT_EQ(batch_metrics.size(), 1);
+  EXPECT_EQ(batch_metrics[0].input_size, 9);
+}
+
+std::unique_ptr<BatchResourceBase::BatchTask> MakeSequenceTask(
+    int64_t sequence_id, bool end_of_sequence) {
+  auto task = MakeBatchTask(/*task_size=*/1, nullptr);
+  task->sequence_id = sequence_id;
+  task->end_of_sequence = end_of_sequence;
+  return task;
+}
+
+TEST(BatcherQueueOptionsTest, UsesTaskDeadlines) {
+  const BatchResourceBase::BatcherT::QueueOptions options =
+      BatchResourceBase::GetBatcherQueueOptions(
+          /*num_batch_threads=*/1, /*max_batch_size=*/8,
+          /*batch_timeout_micros=*/1000, /*max_enqueued_batches=*/1,
+          /*allowed_batch_sizes=*/{}, /*enable_large_batch_splitting=*/true);
+  ASSERT_TRUE(options.task_deadline_micros_func);
+  std::unique_ptr<BatchResourceBase::BatchTask> task =
+      MakeBatchTask(/*task_size=*/4, /*request_cost=*/nullptr);
+  EXPECT_EQ(options.task_deadline_micros_func(*task), 0);
+  task->deadline_micros = 12345;
+  EXPECT_EQ(options.task_deadline_micros_func(*task), 12345);
+
+  // Split tasks keep the deadline of the task they were split from.
+  std::unique_ptr<BatchResourceBase::BatchTask> split_task =
+      task->CreateSplitTask(/*split_index=*/1, /*done_callback=*/[] {});
+  EXPECT_EQ(options.task_deadline_micros_func(*split_task), 12345);
+}
+
+TEST(BatcherQueueOptionsTest, ConfiguresPriorityQueue) {
+  const BatchResourceBase::BatcherT::QueueOptions default_options =
+      BatchResourceBase::GetBatcherQueueOptions(
+          /*num_batch_threads=*/1, /*max_batch_size=*/8,
+          /*batch_timeout_micros=*/1000, /*max_enqueued_batches=*/1,
+          /*allowed_batch_sizes=*/{}, /*enable_large_batch_splitting=*/true);
+  EXPECT_FALSE(default_options.enable_priority_queue);
+
+  const BatchResourceBase::BatcherT::QueueOptions options =
+      BatchResourceBase::GetBatcherQueueOptions(
+          /*num_batch_threads=*/1, /*max_batch_size=*/8,
+          /*batch_timeout_micros=*/1000, /*max_enqueued_batches=*/1,
+          /*allowed_batch_sizes=*/{}, /*enable_large_batch_splitting=*/true,
+          /*enable_priority_queue=*/true,
+          /*low_priority_batch_timeout_micros=*/5000,
+          /*low_priority_max_enqueued_batches=*/3);
+  EXPECT_TRUE(options.enable_priority_queue);
+  EXPECT_EQ(options.low_priority_queue_options.batch_timeout_micros, 5000);
+  EXPECT_EQ(options.low_priority_queue_options.max_enqueued_batches, 3);
+}
+
+// Returns a float tensor of shape [num_rows, row_size] holding 0, 1, 2, ...
+Tensor MakeRows(int64_t num_rows, int64_t row_size) {
+  Tensor tensor(DT_FLOAT, TensorShape({num_rows, row_size}));
+  auto flat = tensor.flat<float>();
+  for (int64_t i = 0; i < flat.size(); ++i) flat(i) = i;
+  return tensor;
+}
+
+TEST(SplitIntoAlignedSlicesTest, AliasesAlignedSlicesWithRemainder) {
+  // Rows of 64 floats keep every slice aligned, whatever its size.
+  const Tensor input = MakeRows(/*num_rows=*/7, /*row_size=*/64);
+  std::vector<Tensor> slices;
+  // The last slice is the remainder after the tasks, e.g. padding.
+  ASSERT_TRUE(internal::SplitIntoAlignedSlices(input, {3, 1, 2, 1}, &slices));
+  ASSERT_EQ(slices.size(), 4);
+  int64_t position = 0;
+  for (const Tensor& slice : slices) {
+    EXPECT_TRUE(slice.SharesBufferWith(input));
+    test::ExpectTensorEqual<float>(
+        slice, input.Slice(position, position + slice.dim_size(0)));
+    position += slice.dim_size(0);
+  }
+}
+
+TEST(SplitIntoAlignedSlicesTest, AcceptsEmptySlices) {
+  const Tensor input = MakeRows(/*num_rows=*/4, /*row_size=*/64);
+  std::vector<Tensor> slices;
+  ASSERT_TRUE(internal::SplitIntoAlignedSlices(input, {0, 4, 0}, &slices));
+  ASSERT_EQ(slices.size(), 3);
+  EXPECT_EQ(slices[0].NumElements(), 0);
+  test::ExpectTensorEqual<float>(slices[1], input);
+  EXPECT_EQ(slices[2].NumElements(), 0);
+}
+
+TEST(SplitIntoAlignedSlicesTest, RejectsMisalignedSlices) {
+  // The number of one-float rows that spans one alignment boundary.
+  const int64_t rows_per_alignment = EIGEN_MAX_ALIGN_BYTES / sizeof(float);
+  if (rows_per_alignment <= 1) {
+    GTEST_SKIP() << "Every float row is aligned";
+  }
+  const Tensor input =
+      MakeRows(/*num_rows=*/2 * rows_per_alignment + 1, /*row_size=*/1);
+  std::vector<Tensor> slices = {Tensor(DT_FLOAT, TensorShape({1}))};
+
+  // Slices that start on alignment boundaries, including a one-row remainder.
+  ASSERT_TRUE(internal::SplitIntoAlignedSlices(
+      input, {rows_per_alignment, rows_per_alignment, 1}, &slices));
+  EXPECT_EQ(slices.size(), 3);
+
+  // The slice after a one-row task is misaligned, so nothing is split.
+  slices = {Tensor(DT_FLOAT, TensorShape({1}))};
+  EXPECT_FALSE(internal::SplitIntoAlignedSlices(
+      input, {rows_per_alignment, 1, rows_per_alignment}, &slices));
+  ASSERT_EQ(slices.size(), 1);
+  EXPECT_EQ(slices[0].dim_size(0), 1);
+}
+
+// A BatchResourceBase that exposes how it picks the queue of a task.
+class QueueNameTestResource : public BatchResourceBase {
+ public:
+  static Status Create(std::unique_ptr<QueueNameTestResource>* resource) {
+    std::shared_ptr<BatcherT> batcher;
+    TF_RETURN_IF_ERROR(BatcherT::Create(BatcherT::Options(), &batcher));
+    resource->reset(new QueueNameTestResource(std::move(batcher)));
+    return OkStatus();
+  }
+
+  using BatchResourceBase::GetInputShapeQueueName;
+  using BatchResourceBase::GetTaskQueueName;
+  using BatchResourceBase::kMaxInputShapeBucketsPerQueue;
+
+  string DebugString() const override { return "QueueNameTestResource"; }
+
+ private:
+  explicit QueueNameTestResource(std::shared_ptr<BatcherT> batcher)
+      : BatchResourceBase(/*has_process_batch_function=*/false,
+                          std::move(batcher), BatcherT::QueueOptions(),
+                          /*allowed_batch_sizes=*/{}) {}
+
+  void ProcessFuncBatchImpl(
+      const BatchTask& last_task, absl::Span<const Tensor> inputs,
+      std::vector<Tensor>* combined_outputs,
+      std::function<void(const Status&)> done) const override {
+    done(errors::Unimplemented("Not used"));
+  }
+};
+
+// Returns a task with one input of shape [task_size, inner_size] and one of
+// shape [task_size].
+std::unique_ptr<BatchResourceBase::BatchTask> MakeShapedTask(
+    int64_t task_size, int64_t inner_size) {
+  auto task = absl::make_unique<BatchResourceBase::BatchTask>();
+  task->inputs.push_back(
+      Tensor(DT_FLOAT, TensorShape({task_size, inner_size})));
+  task->inputs.push_back(Tensor(DT_INT32, TensorShape({task_size})));
+  return task;
+}
+
+TEST(TaskQueueNameTest, UsesBatcherQueueByDefault) {
+  std::unique_ptr<QueueNameTestResource> resource;
+  TF_ASSERT_OK(QueueNameTestResource::Create(&resource));
+  // TF_BATCHING_BUCKET_BY_INPUT_SHAPE is not set.
+  EXPECT_EQ(resource->GetTaskQueueName(
+                "queue", *MakeShapedTask(/*task_size=*/2, /*inner_size=*/5)),
+            "queue");
+}
+
+TEST(TaskQueueNameTest, BucketsByShapeBeyondBatchDimension) {
+  std::unique_ptr<QueueNameTestResource> resource;
+  TF_ASSERT_OK(QueueNameTestResource::Create(&resource));
+  const string name = resource->GetInputShapeQueueName(
+      "queue", *MakeShapedTask(/*task_size=*/2, /*inner_size=*/5));
+  EXPECT_EQ(name, "queue/shape:5,;;");
+  // The size of the 0th dimension does not matter.
+  EXPECT_EQ(resource->GetInputShapeQueueName(
+                "queue", *MakeShapedTask(/*task_size=*/7, /*inner_size=*/5)),
+            name);
+  EXPECT_NE(resource->GetInputShapeQueueName(
+                "queue", *MakeShapedTask(/*task_size=*/2, /*inner_size=*/6)),
+            name);
+  // Buckets are per batcher queue.
+  EXPECT_EQ(resource->GetInputShapeQueueName(
+                "other_queue",
+                *MakeShapedTask(/*task_size=*/2, /*inner_size=*/5)),
+            "other_queue/shape:5,;;");
+}
+
+TEST(TaskQueueNameTest, SharesBatcherQueuePastMaxBuckets) {
+  std::unique_ptr<QueueNameTestResource> resource;
+  TF_ASSERT_OK(QueueNameTestResource::Create(&resource));
+  const int max_buckets = QueueNameTestResource::kMaxInputShapeBucketsPerQueue;
+  for (int i = 0; i < max_buckets; ++i) {
+    EXPECT_NE(resource->GetInputShapeQueueName(
+                  "queue", *MakeShapedTask(/*task_size=*/1, /*inner_size=*/i)),
+              "queue");
+  }
+  // New shapes go to the batcher queue, while known ones keep their bucket.
+  EXPECT_EQ(resource->GetInputShapeQueueName(
+                "queue",
+                *MakeShapedTask(/*task_size=*/1, /*inner_size=*/max_buckets)),
+            "queue");
+  EXPECT_EQ(resource->GetInputShapeQueueName(
+                "queue", *MakeShapedTask(/*task_size=*/1, /*inner_size=*/0)),
+            "queue/shape:0,;;");
+  // Other batcher queues have buckets of their own.
+  EXPECT_NE(resource->GetInputShapeQueueName(
+                "other_queue",
+                *MakeShapedTask(/*task_size=*/1, /*inner_size=*/max_buckets)),
+            "other_queue");
+}
+
+TEST(PaddingEfficiencyTest, RecordsPercentageOfTaskSlots) {
+  // Batches without slots are not recorded, but create the metric.
+  internal::RecordPaddingEfficiency(/*batch_size=*/0, /*padded_batch_size=*/0,
+                                    "model", "op");
+  CellReader<Histogram> reader(
+      "/tensorflow/serving/batching/padding_efficiency");
+  internal::RecordPaddingEfficiency(/*batch_size=*/0, /*padded_batch_size=*/0,
+                                    "model", "op");
+  EXPECT_FLOAT_EQ(reader.Delta("model", "op").num(), 0.0);
+
+  internal::RecordPaddingEfficiency(/*batch_size=*/3, /*padded_batch_size=*/4,
+                                    "model", "op");
+  internal::RecordPaddingEfficiency(/*batch_size=*/8, /*padded_batch_size=*/8,
+                                    "model", "op");
+  const Histogram histogram = reader.Delta("model", "op");
+  EXPECT_FLOAT_EQ(histogram.num(), 2.0);
+  EXPECT_FLOAT_EQ(histogram.sum(), 175.0);
+  EXPECT_FLOAT_EQ(reader.Delta("model", "other_op").num(), 0.0);
+}
+
+TEST(PagedStateTest, RunsStepsOfSequences) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_FLOAT, TensorShape({}),
+                                      /*num_pages=*/4, /*page_size=*/2, &pool));
+  BatchResourceBase::BatchT batch;
+  batch.AddTask(MakeSequenceTask(/*sequence_id=*/7, false));
+  batch.AddTask(MakeSequenceTask(/*sequence_id=*/3, true));
+  batch.Close();
+
+  std::vector<int64_t> sequence_ids;
+  std::vector<Tensor> args = {test::AsTensor<float>({0, 0, 0})};
+  TF_ASSERT_OK(BatchResourceBase::AddPagedStateArgs(
+      pool.get(), batch, /*num_rows=*/3, &sequence_ids, &args));
+  EXPECT_EQ(sequence_ids, std::vector<int64_t>({7, 3}));
+  ASSERT_EQ(args.size(), 4);
+  // The pages are passed without a copy.
+  EXPECT_TRUE(args[1].SharesBufferWith(pool->pages()));
+  EXPECT_EQ(args[2].shape(), TensorShape({3, 0}));
+  test::ExpectTensorEqual<int32>(args[3], test::AsTensor<int32>({0, 0, 0}));
+
+  // The state of the step is the last output; the padding row is dropped.
+  std::vector<Tensor> outputs = {
+      test::AsTensor<float>({1, 2, 3}),
+      test::AsTensor<float>({10, 30, 0}, TensorShape({3, 1}))};
+  TF_ASSERT_OK(BatchResourceBase::AppendPagedState(pool.get(), batch,
+                                                   sequence_ids, &outputs));
+  ASSERT_EQ(outputs.size(), 1);
+  EXPECT_EQ(pool->SequenceLength(7), 1);
+  // The last step of sequence 3 released it.
+  EXPECT_EQ(pool->SequenceLength(3), -1);
+  EXPECT_EQ(pool->num_free_pages(), 3);
+}
+
+TEST(PagedStateTest, RejectsTasksWithoutSequence) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_FLOAT, TensorShape({}),
+                                      /*num_pages=*/4, /*page_size=*/2, &pool));
+  BatchResourceBase::BatchT batch;
+  batch.AddTask(MakeBatchTask(/*task_size=*/1, nullptr));
+  batch.Close();
+  std::vector<int64_t> sequence_ids;
+  std::vector<Tensor> args;
+  EXPECT_TRUE(errors::IsInvalidArgument(BatchResourceBase::AddPagedStateArgs(
+      pool.get(), batch, /*num_rows=*/1, &sequence_ids, &args)));
+}
+
+TEST(PagedStateTest, RejectsMissingStateOutput) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_FLOAT, TensorShape({}),
+                                      /*num_pages=*/4, /*page_size=*/2, &pool));
+  BatchResourceBase::BatchT batch;
+  batch.AddTask(MakeSequenceTask(/*sequence_id=*/1, false));
+  batch.Close();
+  std::vector<int64_t> sequence_ids = {1};
+  TF_ASSERT_OK(pool->AddSequence(1));
+  // A scalar has no row per sequence.
+  std::vector<Tensor> outputs = {Tensor(DT_FLOAT, TensorShape({}))};
+  EXPECT_TRUE(errors::IsInvalidArgument(BatchResourceBase::AppendPagedState(
+      pool.get(), batch, sequence_ids, &outputs)));
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
@@ -64,6 +64,10 @@ class BatchTask {
   // Returns the size of the task, in terms of how much it contributes to the
   // size of a batch. (A batch's size is the sum of its task sizes.)
   virtual size_t size() const = 0;
+
+  // Returns true if the task may wait for other tasks to be batched first.
+  // Only queues that enable priority lanes treat such tasks differently.
+  virtual bool is_low_priority() const { return false; }
 };
 
 // A thread-safe collection of BatchTasks, to be executed together in some
@@ -0,0 +1,249 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/paged_state_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/core/platform/errors.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Returns true if the dimensions of `shape` from `first_dim` on are
+// `token_shape`.
+bool EndsWithTokenShape(const TensorShape& shape, int first_dim,
+                        const TensorShape& token_shape) {
+  if (shape.dims() != first_dim + token_shape.dims()) {
+    return false;
+  }
+  for (int i = 0; i < token_shape.dims(); ++i) {
+    if (shape.dim_size(first_dim + i) != token_shape.dim_size(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the shape of the storage of `num_pages` pages.
+TensorShape StorageShape(const TensorShape& token_shape, int num_pages,
+                         int page_size) {
+  TensorShape shape({num_pages, page_size});
+  shape.AppendShape(token_shape);
+  return shape;
+}
+
+}  // namespace
+
+Status PagedStatePool::Create(DataType dtype, const TensorShape& token_shape,
+                              int num_pages, int page_size,
+                              std::unique_ptr<PagedStatePool>* pool) {
+  if (!DataTypeCanUseMemcpy(dtype)) {
+    return errors::InvalidArgument("Unsupported state type ",
+                                   DataTypeString(dtype));
+  }
+  if (num_pages <= 0 || page_size <= 0) {
+    return errors::InvalidArgument(
+        "num_pages and page_size must be positive, got ", num_pages, " and ",
+        page_size);
+  }
+  pool->reset(new PagedStatePool(dtype, token_shape, num_pages, page_size));
+  return OkStatus();
+}
+
+PagedStatePool::PagedStatePool(DataType dtype, const TensorShape& token_shape,
+                               int num_pages, int page_size)
+    : dtype_(dtype),
+      token_shape_(token_shape),
+      page_size_(page_size),
+      token_bytes_(token_shape.num_elements() * DataTypeSize(dtype)),
+      storage_(dtype, StorageShape(token_shape, num_pages, page_size)) {
+  // Hand out the lowest pages first.
+  free_pages_.reserve(num_pages);
+  for (int page = num_pages - 1; page >= 0; --page) {
+    free_pages_.push_back(page);
+  }
+}
+
+char* PagedStatePool::page_data(int page) const {
+  return const_cast<char*>(storage_.tensor_data().data()) +
+         static_cast<int64_t>(page) * page_size_ * token_bytes_;
+}
+
+int64_t PagedStatePool::PagesNeeded(const Sequence& sequence,
+                                    int64_t num_tokens) const {
+  const int64_t total_pages =
+      (sequence.length + num_tokens + page_size_ - 1) / page_size_;
+  return std::max<int64_t>(
+      0, total_pages - static_cast<int64_t>(sequence.pages.size()));
+}
+
+void PagedStatePool::AppendLocked(Sequence* sequence, const char* data,
+                                  int64_t num_tokens) {
+  while (num_tokens > 0) {
+    const int64_t page = sequence->length / page_size_;
+    const int64_t offset = sequence->length % page_size_;
+    if (page == static_cast<int64_t>(sequence->pages.size())) {
+      sequence->pages.push_back(free_pages_.back());
+      free_pages_.pop_back();
+    }
+    const int64_t n = std::min<int64_t>(num_tokens, page_size_ - offset);
+    std::memcpy(page_data(sequence->pages[page]) + offset * token_bytes_, data,
+                n * token_bytes_);
+    data += n * token_bytes_;
+    sequence->length += n;
+    num_tokens -= n;
+  }
+}
+
+Status PagedStatePool::AddSequence(int64_t id) {
+  mutex_lock l(mu_);
+  if (!sequences_.emplace(id, Sequence()).second) {
+    return errors::AlreadyExists("Sequence ", id, " is already tracked");
+  }
+  return OkStatus();
+}
+
+Status PagedStatePool::RemoveSequence(int64_t id) {
+  mutex_lock l(mu_);
+  auto it = sequences_.find(id);
+  if (it == sequences_.end()) {
+    return errors::NotFound("Sequence ", id, " is not tracked");
+  }
+  free_pages_.insert(free_pages_.end(), it->second.pages.rbegin(),
+                     it->second.pages.rend());
+  sequences_.erase(it);
+  return OkStatus();
+}
+
+Status PagedStatePool::Append(int64_t id, const Tensor& states) {
+  if (states.dtype() != dtype_ ||
+      !EndsWithTokenShape(states.shape(), 1, token_shape_)) {
+    return errors::InvalidArgument("Expected states of type ",
+                                   DataTypeString(dtype_), " and shape [n, ",
+                                   token_shape_.DebugString(), "], got ",
+                                   states.DebugString());
+  }
+  const int64_t num_tokens = states.dim_size(0);
+
+  mutex_lock l(mu_);
+  auto it = sequences_.find(id);
+  if (it == sequences_.end()) {
+    return errors::NotFound("Sequence ", id, " is not tracked");
+  }
+  if (PagesNeeded(it->second, num_tokens) >
+      static_cast<int64_t>(free_pages_.size())) {
+    return errors::ResourceExhausted("Not enough free pages to append ",
+                                     num_tokens, " tokens to sequence ", id);
+  }
+  AppendLocked(&it->second, states.tensor_data().data(), num_tokens);
+  return OkStatus();
+}
+
+Status PagedStatePool::AppendBatch(absl::Span<const int64_t> ids,
+                                   const Tensor& states) {
+  if (states.dtype() != dtype_ ||
+      !EndsWithTokenShape(states.shape(), 2, token_shape_) ||
+      states.dim_size(0) != static_cast<int64_t>(ids.size())) {
+    return errors::InvalidArgument(
+        "Expected states of type ", DataTypeString(dtype_), " and shape [",
+        ids.size(), ", n, ", token_shape_.DebugString(), "], got ",
+        states.DebugString());
+  }
+  const int64_t num_tokens = states.dim_size(1);
+  const int64_t row_bytes = num_tokens * token_bytes_;
+
+  mutex_lock l(mu_);
+  std::vector<Sequence*> sequences;
+  sequences.reserve(ids.size());
+  int64_t pages_needed = 0;
+  for (int64_t id : ids) {
+    auto it = sequences_.find(id);
+    if (it == sequences_.end()) {
+      return errors::NotFound("Sequence ", id, " is not tracked");
+    }
+    if (std::find(sequences.begin(), sequences.end(), &it->second) !=
+        sequences.end()) {
+      return errors::InvalidArgument("Sequence ", id,
+                                     " appears more than once in the batch");
+    }
+    sequences.push_back(&it->second);
+    pages_needed += PagesNeeded(it->second, num_tokens);
+  }
+  if (pages_needed > static_cast<int64_t>(free_pages_.size())) {
+    return errors::ResourceExhausted("Not enough free pages to append ",
+                                     num_tokens, " tokens to ", ids.size(),
+                                     " sequences");
+  }
+  const char* data = states.tensor_data().data();
+  for (Sequence* sequence : sequences) {
+    AppendLocked(sequence, data, num_tokens);
+    data += row_bytes;
+  }
+  return OkStatus();
+}
+
+Status PagedStatePool::GetPageTable(absl::Span<const int64_t> ids,
+                                    int64_t num_rows, Tensor* page_table,
+                                    Tensor* lengths) const {
+  if (num_rows < static_cast<int64_t>(ids.size())) {
+    return errors::InvalidArgument("Cannot fit the pages of ", ids.size(),
+                                   " sequences into ", num_rows, " rows");
+  }
+  tf_shared_lock l(mu_);
+  std::vector<const Sequence*> sequences;
+  sequences.reserve(ids.size());
+  int64_t max_pages = 0;
+  for (int64_t id : ids) {
+    auto it = sequences_.find(id);
+    if (it == sequences_.end()) {
+      return errors::NotFound("Sequence ", id, " is not tracked");
+    }
+    sequences.push_back(&it->second);
+    max_pages =
+        std::max(max_pages, static_cast<int64_t>(it->second.pages.size()));
+  }
+
+  *page_table = Tensor(DT_INT32, TensorShape({num_rows, max_pages}));
+  *lengths = Tensor(DT_INT32, TensorShape({num_rows}));
+  auto page_table_matrix = page_table->matrix<int32>();
+  auto lengths_flat = lengths->flat<int32>();
+  page_table_matrix.setZero();
+  lengths_flat.setZero();
+  for (int64_t i = 0; i < static_cast<int64_t>(sequences.size()); ++i) {
+    const Sequence& sequence = *sequences[i];
+    for (int64_t p = 0; p < static_cast<int64_t>(sequence.pages.size()); ++p) {
+      page_table_matrix(i, p) = sequence.pages[p];
+    }
+    lengths_flat(i) = sequence.length;
+  }
+  return OkStatus();
+}
+
+int64_t PagedStatePool::SequenceLength(int64_t id) const {
+  tf_shared_lock l(mu_);
+  auto it = sequences_.find(id);
+  return it == sequences_.end() ? -1 : it->second.length;
+}
+
+int PagedStatePool::num_free_pages() const {
+  tf_shared_lock l(mu_);
+  return free_pages_.size();
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,144 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_PAGED_STATE_POOL_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_PAGED_STATE_POOL_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Holds the per-sequence state of autoregressive models served with
+// iteration-level batching, such as the keys and values of attention layers.
+//
+// With iteration-level batching every decode step is its own batched call, so
+// sequences join the batch when they start and leave it as soon as they are
+// done instead of holding a slot until the longest sequence of their batch
+// finishes. The state they carry from one step to the next lives here, in
+// fixed-size pages of one preallocated buffer: a sequence only holds the pages
+// its tokens fill, and the pages of finished sequences are handed to new ones
+// without any allocation. A step reads the state in place, through a table of
+// the pages of its sequences, so its cost doesn't grow with their length.
+//
+// Example usage, for a decode step over the sequences in `ids`:
+//   TF_RETURN_IF_ERROR(
+//       pool->GetPageTable(ids, ids.size(), &page_table, &lengths));
+//   ... run the step on pool->pages(), which produces `new_states` ...
+//   TF_RETURN_IF_ERROR(pool->AppendBatch(ids, new_states));
+//
+// BatchResourceBase runs these calls around each batch when it has a pool;
+// see `BatchResourceBase::set_paged_state_pool()`.
+//
+// This class is thread-safe. A step may run while other sequences are
+// appended to, but its own sequences must not be appended to or removed until
+// it finishes reading their pages.
+class PagedStatePool {
+ public:
+  // Creates a pool of `num_pages` pages of `page_size` tokens each. The state
+  // of one token is a tensor of type `dtype` and shape `token_shape`.
+  static Status Create(DataType dtype, const TensorShape& token_shape,
+                       int num_pages, int page_size,
+                       std::unique_ptr<PagedStatePool>* pool);
+
+  // Starts tracking sequence `id`, with no state yet.
+  Status AddSequence(int64_t id) TF_LOCKS_EXCLUDED(mu_);
+
+  // Stops tracking sequence `id` and releases its pages.
+  Status RemoveSequence(int64_t id) TF_LOCKS_EXCLUDED(mu_);
+
+  // Appends `states`, of shape [num_tokens] + token_shape, to the state of
+  // sequence `id`. Returns ResourceExhausted, and appends nothing, if the pool
+  // doesn't have enough free pages.
+  Status Append(int64_t id, const Tensor& states) TF_LOCKS_EXCLUDED(mu_);
+
+  // Appends row i of `states`, of shape [ids.size(), num_tokens] +
+  // token_shape, to the state of sequence ids[i]. Either all the rows are
+  // appended or none is.
+  Status AppendBatch(absl::Span<const int64_t> ids, const Tensor& states)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the pages of the sequences in `ids` in `page_table`, an int32
+  // tensor of shape [num_rows, max_pages] whose row i lists the indices into
+  // `pages()` of the pages of ids[i], in order. Their lengths are returned as
+  // an int32 vector of `num_rows` elements in `lengths`. Rows past the pages
+  // of a sequence, and rows from ids.size() on, which pad the batch, are
+  // filled with zeros and must be masked by `lengths`.
+  Status GetPageTable(absl::Span<const int64_t> ids, int64_t num_rows,
+                      Tensor* page_table, Tensor* lengths) const
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // All pages, of shape [num_pages, page_size] + token_shape. Token t of a
+  // sequence is at [page_table[t / page_size], t % page_size].
+  const Tensor& pages() const { return storage_; }
+
+  const TensorShape& token_shape() const { return token_shape_; }
+
+  // Returns the number of tokens in the state of sequence `id`, or -1 if the
+  // sequence isn't tracked.
+  int64_t SequenceLength(int64_t id) const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of pages not held by any sequence.
+  int num_free_pages() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Sequence {
+    std::vector<int> pages;
+    int64_t length = 0;
+  };
+
+  PagedStatePool(DataType dtype, const TensorShape& token_shape,
+                 int num_pages, int page_size);
+
+  // Returns the number of pages `sequence` needs to hold `num_tokens` more.
+  int64_t PagesNeeded(const Sequence& sequence, int64_t num_tokens) const;
+
+  // Copies `num_tokens` token states from `data` at the end of `sequence`.
+  // The caller must have checked that enough pages are free.
+  void AppendLocked(Sequence* sequence, const char* data, int64_t num_tokens)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  char* page_data(int page) const;
+
+  const DataType dtype_;
+  const TensorShape token_shape_;
+  const int page_size_;
+  // Size of the state of one token, in bytes.
+  const int64_t token_bytes_;
+
+  // Of shape [num_pages, page_size_] + token_shape_.
+  Tensor storage_;
+
+  mutable mutex mu_;
+  std::vector<int> free_pages_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<int64_t, Sequence> sequences_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PagedStatePool);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_PAGED_STATE_POOL_H_
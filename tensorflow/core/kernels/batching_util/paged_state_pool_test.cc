@@ -0,0 +1,141 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/paged_state_pool.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Reads the state of row `row` of `page_table` out of the pages of `pool`, the
+// way a decode step does.
+template <typename T>
+std::vector<T> ReadRow(const PagedStatePool& pool, const Tensor& page_table,
+                       const Tensor& lengths, int row) {
+  const int64_t page_size = pool.pages().dim_size(1);
+  const int64_t token_size = pool.token_shape().num_elements();
+  auto pages = pool.pages().flat<T>();
+  std::vector<T> state;
+  for (int64_t t = 0; t < lengths.flat<int32>()(row); ++t) {
+    const int64_t page = page_table.matrix<int32>()(row, t / page_size);
+    const int64_t offset = (page * page_size + t % page_size) * token_size;
+    for (int64_t i = 0; i < token_size; ++i) {
+      state.push_back(pages(offset + i));
+    }
+  }
+  return state;
+}
+
+TEST(PagedStatePoolTest, InvalidOptions) {
+  std::unique_ptr<PagedStatePool> pool;
+  EXPECT_TRUE(errors::IsInvalidArgument(PagedStatePool::Create(
+      DT_STRING, TensorShape({2}), /*num_pages=*/4, /*page_size=*/2, &pool)));
+  EXPECT_TRUE(errors::IsInvalidArgument(PagedStatePool::Create(
+      DT_FLOAT, TensorShape({2}), /*num_pages=*/0, /*page_size=*/2, &pool)));
+}
+
+TEST(PagedStatePoolTest, AppendAndGather) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_FLOAT, TensorShape({2}),
+                                      /*num_pages=*/4, /*page_size=*/2, &pool));
+  TF_ASSERT_OK(pool->AddSequence(7));
+  TF_ASSERT_OK(pool->AddSequence(9));
+  EXPECT_TRUE(errors::IsAlreadyExists(pool->AddSequence(7)));
+
+  // The prompt of sequence 7 spans two pages.
+  TF_ASSERT_OK(pool->Append(
+      7, test::AsTensor<float>({1, 2, 3, 4, 5, 6}, TensorShape({3, 2}))));
+  EXPECT_EQ(3, pool->SequenceLength(7));
+  EXPECT_EQ(0, pool->SequenceLength(9));
+  EXPECT_EQ(-1, pool->SequenceLength(8));
+  EXPECT_EQ(2, pool->num_free_pages());
+
+  // A decode step appends one token to both sequences.
+  TF_ASSERT_OK(pool->AppendBatch(
+      {7, 9}, test::AsTensor<float>({7, 8, 9, 10}, TensorShape({2, 1, 2}))));
+  EXPECT_EQ(1, pool->num_free_pages());
+
+  // The third row pads the batch.
+  Tensor page_table, lengths;
+  TF_ASSERT_OK(pool->GetPageTable({9, 7}, /*num_rows=*/3, &page_table,
+                                  &lengths));
+  test::ExpectTensorEqual<int32>(
+      test::AsTensor<int32>({2, 0, 0, 1, 0, 0}, TensorShape({3, 2})),
+      page_table);
+  test::ExpectTensorEqual<int32>(test::AsTensor<int32>({1, 4, 0}), lengths);
+  EXPECT_EQ(pool->pages().shape(), TensorShape({4, 2, 2}));
+  EXPECT_EQ(ReadRow<float>(*pool, page_table, lengths, 0),
+            std::vector<float>({9, 10}));
+  EXPECT_EQ(ReadRow<float>(*pool, page_table, lengths, 1),
+            std::vector<float>({1, 2, 3, 4, 5, 6, 7, 8}));
+
+  EXPECT_TRUE(errors::IsInvalidArgument(pool->GetPageTable(
+      {9, 7}, /*num_rows=*/1, &page_table, &lengths)));
+  EXPECT_TRUE(errors::IsNotFound(pool->GetPageTable(
+      {8}, /*num_rows=*/1, &page_table, &lengths)));
+}
+
+TEST(PagedStatePoolTest, FinishedSequencesReleasePages) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_INT64, TensorShape({}),
+                                      /*num_pages=*/2, /*page_size=*/2, &pool));
+  TF_ASSERT_OK(pool->AddSequence(1));
+  TF_ASSERT_OK(pool->AddSequence(2));
+  TF_ASSERT_OK(pool->Append(1, test::AsTensor<int64_t>({1, 2, 3})));
+  EXPECT_EQ(0, pool->num_free_pages());
+
+  // Nothing is appended when the pool runs out of pages.
+  EXPECT_TRUE(errors::IsResourceExhausted(
+      pool->Append(2, test::AsTensor<int64_t>({4}))));
+  EXPECT_EQ(0, pool->SequenceLength(2));
+
+  // Once sequence 1 leaves the batch, sequence 2 can grow into its pages.
+  TF_ASSERT_OK(pool->RemoveSequence(1));
+  EXPECT_TRUE(errors::IsNotFound(pool->RemoveSequence(1)));
+  EXPECT_EQ(2, pool->num_free_pages());
+  TF_ASSERT_OK(pool->Append(2, test::AsTensor<int64_t>({4, 5, 6})));
+
+  Tensor page_table, lengths;
+  TF_ASSERT_OK(pool->GetPageTable({2}, /*num_rows=*/1, &page_table, &lengths));
+  EXPECT_EQ(ReadRow<int64_t>(*pool, page_table, lengths, 0),
+            std::vector<int64_t>({4, 5, 6}));
+}
+
+TEST(PagedStatePoolTest, AppendBatchIsAllOrNothing) {
+  std::unique_ptr<PagedStatePool> pool;
+  TF_ASSERT_OK(PagedStatePool::Create(DT_FLOAT, TensorShape({}),
+                                      /*num_pages=*/1, /*page_size=*/2, &pool));
+  TF_ASSERT_OK(pool->AddSequence(1));
+  TF_ASSERT_OK(pool->AddSequence(2));
+  EXPECT_TRUE(errors::IsResourceExhausted(pool->AppendBatch(
+      {1, 2}, test::AsTensor<float>({1, 2}, TensorShape({2, 1})))));
+  EXPECT_TRUE(errors::IsNotFound(pool->AppendBatch(
+      {1, 3}, test::AsTensor<float>({1, 2}, TensorShape({2, 1})))));
+  EXPECT_TRUE(errors::IsInvalidArgument(pool->AppendBatch(
+      {1, 1}, test::AsTensor<float>({1, 2}, TensorShape({2, 1})))));
+  EXPECT_EQ(0, pool->SequenceLength(1));
+  EXPECT_EQ(1, pool->num_free_pages());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <array>
 #include <deque>
 #include <functional>
 #include <list>
@@ -218,6 +220,40 @@ class SharedBatchScheduler
     // submit batches whose size is in a small set of allowed sizes, that can be
     // done by adding padding in the process-batch callback.
     size_t max_execution_batch_size = 1000;
+
+    // If set, returns the deadline of `task` in microseconds on the clock of
+    // `Options::env`, or 0 if the task has no deadline.
+    //
+    // The queue then also closes the open batch before `batch_timeout_micros`
+    // expires, once waiting any longer would make it finish after the
+    // earliest deadline of its tasks. The time needed to process a batch is
+    // estimated from the processing times of earlier batches of similar size,
+    // so larger timeouts can be used for throughput without delaying tasks
+    // with tight deadlines.
+    std::function<int64_t(const TaskType& task)> task_deadline_micros_func;
+
+    // If true, tasks whose `is_low_priority()` returns true are kept in a
+    // separate low-priority lane. Batches are filled with regular tasks first,
+    // and low-priority tasks pad whatever room is left when a batch closes. A
+    // batch made of (or completed with) low-priority tasks alone is formed
+    // once the lane reaches `max_execution_batch_size` or its oldest task has
+    // waited for `low_priority_queue_options.batch_timeout_micros`.
+    //
+    // Must be false if `enable_lazy_split` is true; elsewise errors will be
+    // returned at queue creation time.
+    bool enable_priority_queue = false;
+
+    struct PriorityQueueOptions {
+      // The low-priority counterpart of `batch_timeout_micros`.
+      int64_t batch_timeout_micros = 0;
+
+      // The maximum number of enqueued low-priority tasks, in units of
+      // `max_execution_batch_size`. If this limit is reached, Schedule() of a
+      // low-priority task returns an UNAVAILABLE error, whatever the room left
+      // for regular tasks.
+      size_t max_enqueued_batches = 10;
+    };
+    PriorityQueueOptions low_priority_queue_options;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -279,6 +315,52 @@ class SharedBatchScheduler
 
 namespace internal {
 
+// Estimates the time it takes to process a batch from the processing times of
+// earlier batches. Batch sizes are bucketed by powers of two, and each bucket
+// keeps an exponential moving average of its batches' processing times.
+//
+// Not thread-safe.
+class BatchLatencyModel {
+ public:
+  // Records that processing a batch of `batch_size` took `latency_micros`.
+  void Record(size_t batch_size, int64_t latency_micros) {
+    int64_t& estimate = estimates_micros_[Bucket(batch_size)];
+    if (estimate == 0) {
+      estimate = std::max<int64_t>(latency_micros, 1);
+    } else {
+      estimate = std::max<int64_t>(
+          estimate + (latency_micros - estimate) / kSmoothingDivisor, 1);
+    }
+  }
+
+  // Returns the estimated time to process a batch of `batch_size`. Falls back
+  // to the estimate of the largest smaller batch size seen so far, and to 0 if
+  // no such batch has been processed yet.
+  int64_t EstimateMicros(size_t batch_size) const {
+    for (int bucket = Bucket(batch_size); bucket >= 0; --bucket) {
+      if (estimates_micros_[bucket] != 0) return estimates_micros_[bucket];
+    }
+    return 0;
+  }
+
+ private:
+  // Weight of a new sample is 1 / kSmoothingDivisor.
+  static constexpr int64_t kSmoothingDivisor = 8;
+  static constexpr int kNumBuckets = 64;
+
+  // Returns ceil(log2(batch_size)).
+  static int Bucket(size_t batch_size) {
+    int bucket = 0;
+    while (bucket + 1 < kNumBuckets && (size_t{1} << bucket) < batch_size) {
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  // Zero iff no batch in the bucket has been processed yet.
+  std::array<int64_t, kNumBuckets> estimates_micros_{};
+};
+
 // A task queue for SharedBatchScheduler. Accepts tasks and accumulates them
 // into batches, and dispenses those batches to be processed via a "pull"
 // interface. The queue's behavior is governed by maximum batch size, timeout
@@ -421,6 +503,28 @@ class Queue {
   // Returns the number of enqueued batches.
   int64 num_enqueued_batches() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Adds a low-priority `task` to the low-priority lane.
+  Status ScheduleLowPriorityTask(std::unique_ptr<TaskType>* task);
+
+  // Moves low-priority tasks into the open batch while they fit.
+  void PadOpenBatchWithLowPriorityTasks() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Determines whether the low-priority lane is due to be batched, even if no
+  // regular batch is.
+  bool IsLowPriorityBatchSchedulable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the deadline of `task` per `task_deadline_micros_func`, or 0.
+  int64_t GetTaskDeadlineMicros(const TaskType& task) const;
+
+  // Records that a task with `deadline_micros` was added to the open batch.
+  void AddToOpenBatchDeadline(int64_t deadline_micros)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if the open batch, of `open_batch_size`, must be closed now to
+  // finish before the earliest deadline of its tasks.
+  bool IsOpenBatchDeadlineDue(size_t open_batch_size) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   const typename SharedBatchScheduler<TaskType>::QueueOptions options_;
 
   // The environment to use.
@@ -469,6 +573,23 @@ class Queue {
   // in 'batches_'. Valid iff that batch contains at least one task.
   uint64 open_batch_start_time_micros_ TF_GUARDED_BY(mu_);
 
+  // The earliest deadline of the tasks in the open batch, or 0 if none of them
+  // has a deadline.
+  int64_t open_batch_deadline_micros_ TF_GUARDED_BY(mu_) = 0;
+
+  // Batch processing times, used to close batches ahead of task deadlines.
+  BatchLatencyModel latency_model_ TF_GUARDED_BY(mu_);
+
+  // The low-priority lane, used iff `QueueOptions.enable_priority_queue` is
+  // true. Tasks are in enqueue order.
+  struct LowPriorityTask {
+    std::unique_ptr<TaskType> task;
+    uint64 enqueue_time_micros;
+  };
+  std::deque<LowPriorityTask> low_priority_tasks_ TF_GUARDED_BY(mu_);
+  // The total size of the tasks in `low_priority_tasks_`.
+  size_t low_priority_tasks_size_ TF_GUARDED_BY(mu_) = 0;
+
   // Whether this queue contains a batch that is eligible to be scheduled.
   // Used to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ TF_GUARDED_BY(mu_) = false;
@@ -603,6 +724,19 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         "enable_large_batch_splitting is enabled.");
   }
 
+  if (options.enable_priority_queue && options.enable_lazy_split) {
+    return errors::InvalidArgument(
+        "enable_priority_queue cannot be combined with enable_lazy_split.");
+  }
+
+  if (options.enable_priority_queue &&
+      options.low_priority_queue_options.max_enqueued_batches == 0) {
+    return errors::InvalidArgument(
+        "low_priority_queue_options.max_enqueued_batches must be positive; "
+        "was ",
+        options.low_priority_queue_options.max_enqueued_batches);
+  }
+
   if (options.enable_large_batch_splitting &&
       (options.input_batch_size_limit < options.max_execution_batch_size)) {
     return errors::InvalidArgument(
@@ -826,6 +960,7 @@ Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
     }
     const int64 open_batch_capacity =
         max_execution_batch_size - this->tail_batch_task_size();
+    const int64_t task_deadline_micros = GetTaskDeadlineMicros(**task);
 
     auto input_batch = std::make_shared<BatchInputTask<TaskType>>(
         std::move(*task), open_batch_capacity, max_execution_batch_size,
@@ -841,7 +976,9 @@ Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
       }
       if (task_handle_batches_.back()->empty()) {
         open_batch_start_time_micros_ = env_->NowMicros();
+        open_batch_deadline_micros_ = 0;
       }
+      AddToOpenBatchDeadline(task_deadline_micros);
       profiler::TraceMeProducer trace_me(
           [&task_handles, i] {
             return profiler::TraceMeEncode("ScheduleOutputTask",
@@ -883,6 +1020,9 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
                               : "ScheduleWithoutSplit",
         {{"batching_input_task_size", (*task)->size()}});
   });
+  if (options_.enable_priority_queue && (*task)->is_low_priority()) {
+    return ScheduleLowPriorityTask(task);
+  }
 
   bool notify_of_schedulable_batch = false;
   {
@@ -903,6 +1043,7 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
         max_execution_batch_size() - batches_.back()->size();
 
     const int64_t input_task_size = (*task)->size();
+    const int64_t task_deadline_micros = GetTaskDeadlineMicros(**task);
 
     std::vector<std::unique_ptr<TaskType>> output_tasks;
 
@@ -921,7 +1062,9 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
       }
       if (batches_.back()->empty()) {
         open_batch_start_time_micros_ = env_->NowMicros();
+        open_batch_deadline_micros_ = 0;
       }
+      AddToOpenBatchDeadline(task_deadline_micros);
       profiler::TraceMeProducer trace_me(
           [&output_tasks, i] {
             return profiler::TraceMeEncode("ScheduleOutputTask",
@@ -947,6 +1090,80 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
   return OkStatus();
 }
 
+template <typename TaskType>
+Status Queue<TaskType>::ScheduleLowPriorityTask(
+    std::unique_ptr<TaskType>* task) {
+  bool notify_of_schedulable_batch = false;
+  {
+    mutex_lock l(mu_);
+
+    DCHECK(!closed_);
+
+    const size_t low_priority_capacity =
+        options_.low_priority_queue_options.max_enqueued_batches *
+        max_execution_batch_size();
+    if (low_priority_tasks_size_ + (*task)->size() > low_priority_capacity) {
+      return errors::Unavailable(
+          "The low priority lane of the batch scheduling queue to which this "
+          "task was submitted is full");
+    }
+
+    // Split the task up front so that each piece can pad any batch.
+    std::vector<std::unique_ptr<TaskType>> output_tasks;
+    if ((*task)->size() > max_execution_batch_size() &&
+        options_.enable_large_batch_splitting) {
+      TF_RETURN_IF_ERROR(options_.split_input_task_func(
+          task, max_execution_batch_size(), max_execution_batch_size(),
+          &output_tasks));
+    } else {
+      output_tasks.push_back(std::move(*task));
+    }
+
+    const uint64 now_micros = env_->NowMicros();
+    for (auto& output_task : output_tasks) {
+      low_priority_tasks_size_ += output_task->size();
+      low_priority_tasks_.push_back({std::move(output_task), now_micros});
+    }
+
+    if (!schedulable_batch_) {
+      if (batches_.size() > 1 || IsOpenBatchSchedulable() ||
+          IsLowPriorityBatchSchedulable()) {
+        schedulable_batch_ = true;
+        notify_of_schedulable_batch = true;
+      }
+    }
+  }
+
+  if (notify_of_schedulable_batch) {
+    schedulable_batch_callback_();
+  }
+
+  return OkStatus();
+}
+
+template <typename TaskType>
+void Queue<TaskType>::PadOpenBatchWithLowPriorityTasks() {
+  Batch<TaskType>* open_batch = batches_.back().get();
+  while (!low_priority_tasks_.empty() &&
+         open_batch->size() + low_priority_tasks_.front().task->size() <=
+             max_execution_batch_size()) {
+    low_priority_tasks_size_ -= low_priority_tasks_.front().task->size();
+    open_batch->AddTask(std::move(low_priority_tasks_.front().task));
+    low_priority_tasks_.pop_front();
+  }
+}
+
+template <typename TaskType>
+bool Queue<TaskType>::IsLowPriorityBatchSchedulable() const {
+  if (low_priority_tasks_.empty()) {
+    return false;
+  }
+  return closed_ || low_priority_tasks_size_ >= max_execution_batch_size() ||
+         env_->NowMicros() >=
+             low_priority_tasks_.front().enqueue_time_micros +
+                 options_.low_priority_queue_options.batch_timeout_micros;
+}
+
 template <typename TaskType>
 size_t Queue<TaskType>::NumEnqueuedTasks() const {
   size_t num_enqueued_tasks = 0;
@@ -961,7 +1178,7 @@ size_t Queue<TaskType>::NumEnqueuedTasks() const {
   for (const auto& batch : batches_) {
     num_enqueued_tasks += batch->num_tasks();
   }
-  return num_enqueued_tasks;
+  return num_enqueued_tasks + low_priority_tasks_.size();
 }
 
 template <typename TaskType>
@@ -1022,7 +1239,8 @@ Queue<TaskType>::ScheduleBatchWithEagerSplit() {
     mutex_lock l(mu_);
 
     // Consider closing the open batch at this time, to schedule it.
-    if (batches_.size() == 1 && IsOpenBatchSchedulable()) {
+    if (batches_.size() == 1 &&
+        (IsOpenBatchSchedulable() || IsLowPriorityBatchSchedulable())) {
       StartNewBatch();
     }
 
@@ -1081,10 +1299,14 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
+  const size_t batch_size = batch->size();
+  const uint64 start_time_micros = env_->NowMicros();
   process_batch_callback_(std::move(batch));
+  const int64_t latency_micros = env_->NowMicros() - start_time_micros;
 
   {
     mutex_lock l(mu_);
+    latency_model_.Record(batch_size, latency_micros);
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -1122,7 +1344,7 @@ bool Queue<TaskType>::IsEmptyInternal() const {
            task_handle_batches_.back()->empty();
   }
   return num_batches_being_processed_ == 0 && batches_.size() == 1 &&
-         batches_.back()->empty();
+         batches_.back()->empty() && low_priority_tasks_.empty();
 }
 
 template <typename TaskType>
@@ -1133,6 +1355,9 @@ void Queue<TaskType>::StartNewBatch() {
         ++traceme_context_id_counter_));
     return;
   }
+  if (options_.enable_priority_queue) {
+    PadOpenBatchWithLowPriorityTasks();
+  }
   batches_.back()->Close();
   batches_.emplace_back(new Batch<TaskType>(++traceme_context_id_counter_));
 }
@@ -1156,7 +1381,8 @@ bool Queue<TaskType>::IsOpenBatchSchedulableAfterEagerSplit() const {
   }
   return closed_ || open_batch->size() >= max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + options_.batch_timeout_micros ||
+         IsOpenBatchDeadlineDue(open_batch->size());
 }
 
 template <typename TaskType>
@@ -1171,7 +1397,34 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
   }
   return closed_ || open_batch->size() >= max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + options_.batch_timeout_micros ||
+         IsOpenBatchDeadlineDue(open_batch->size());
+}
+
+template <typename TaskType>
+int64_t Queue<TaskType>::GetTaskDeadlineMicros(const TaskType& task) const {
+  if (!options_.task_deadline_micros_func) {
+    return 0;
+  }
+  return std::max<int64_t>(options_.task_deadline_micros_func(task), 0);
+}
+
+template <typename TaskType>
+void Queue<TaskType>::AddToOpenBatchDeadline(int64_t deadline_micros) {
+  if (deadline_micros > 0 && (open_batch_deadline_micros_ == 0 ||
+                              deadline_micros < open_batch_deadline_micros_)) {
+    open_batch_deadline_micros_ = deadline_micros;
+  }
+}
+
+template <typename TaskType>
+bool Queue<TaskType>::IsOpenBatchDeadlineDue(size_t open_batch_size) const {
+  if (open_batch_deadline_micros_ == 0) {
+    return false;
+  }
+  return static_cast<int64_t>(env_->NowMicros()) +
+             latency_model_.EstimateMicros(open_batch_size) >=
+         open_batch_deadline_micros_;
 }
 
 template <typename TaskType>
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
@@ -42,14 +43,18 @@ namespace {
 
 class FakeTask : public BatchTask {
  public:
-  explicit FakeTask(size_t size) : size_(size) {}
+  explicit FakeTask(size_t size, bool low_priority = false)
+      : size_(size), low_priority_(low_priority) {}
 
   ~FakeTask() override = default;
 
   size_t size() const override { return size_; }
 
+  bool is_low_priority() const override { return low_priority_; }
+
  private:
   const size_t size_;
+  const bool low_priority_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(FakeTask);
 };
@@ -64,8 +69,9 @@ using SplitFunc =
 
 // Creates a FakeTask of size 'task_size', and calls 'scheduler->Schedule()' on
 // that task. Returns the resulting status.
-Status ScheduleTask(size_t task_size, BatchScheduler<FakeTask>* scheduler) {
-  std::unique_ptr<FakeTask> task(new FakeTask(task_size));
+Status ScheduleTask(size_t task_size, BatchScheduler<FakeTask>* scheduler,
+                    bool low_priority = false) {
+  std::unique_ptr<FakeTask> task(new FakeTask(task_size, low_priority));
   Status status = scheduler->Schedule(&task);
   // Schedule() should have consumed 'task' iff it returned Status::OK.
   CHECK_EQ(status.ok(), task == nullptr);
@@ -396,6 +402,69 @@ TEST_P(SharedBatchSchedulerTest, ObeysTimeout) {
   stop_teardown.Notify();
 }
 
+TEST_P(SharedBatchSchedulerTest, ClosesBatchAheadOfDeadline) {
+  // Set up a fake clock, which only advances when we explicitly tell it to.
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    Notification first_batch_processed, second_batch_processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      if (!first_batch_processed.HasBeenNotified()) {
+        // Teach the queue that a batch of this size takes 20us to process.
+        env.AdvanceByMicroseconds(20);
+        first_batch_processed.Notify();
+        return;
+      }
+      if (!second_batch_processed.HasBeenNotified()) {
+        second_batch_processed.Notify();
+        return;
+      }
+
+      EXPECT_TRUE(false) << "Unexpected condition";
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+
+    const size_t input_batch_size_limit = 4;
+    const size_t batch_timeout_micros = 1000 * 1000;
+    const size_t max_enqueued_batches = 2;
+    QueueOptions options =
+        CreateQueueOptions(input_batch_size_limit, input_batch_size_limit,
+                           batch_timeout_micros, max_enqueued_batches);
+    std::atomic<int64_t> deadline_micros{0};
+    options.task_deadline_micros_func = [&](const FakeTask& task) {
+      return deadline_micros.load();
+    };
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    // With no processing time known yet, the batch closes at the deadline,
+    // well before the timeout.
+    deadline_micros = env.NowMicros() + 50;
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(49);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(first_batch_processed.HasBeenNotified());
+    env.AdvanceByMicroseconds(1);
+    first_batch_processed.WaitForNotification();
+
+    // The batch now closes early enough to finish by the deadline.
+    deadline_micros = env.NowMicros() + 50;
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(29);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(second_batch_processed.HasBeenNotified());
+    env.AdvanceByMicroseconds(1);
+    second_batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
 TEST_P(SharedBatchSchedulerTest, ObeysTimeoutWithRealClock) {
   Notification first_batch_processed, second_batch_processed;
   auto callback = [&first_batch_processed, &second_batch_processed](
@@ -730,6 +799,73 @@ TEST_P(SharedBatchSchedulerTest, QueueDestructorBlocksUntilAllTasksProcessed) {
   stop_teardown.Notify();
 }
 
+// Tests that low-priority tasks pad batches of regular tasks, and are bounded
+// by their own capacity.
+TEST(SharedBatchSchedulerPriorityTest, LowPriorityTasksPadBatches) {
+  mutex mu;
+  std::vector<std::vector<std::pair<size_t, bool>>> batches;
+  auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+    ASSERT_TRUE(batch->IsClosed());
+    std::vector<std::pair<size_t, bool>> tasks;
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      tasks.push_back(
+          {batch->task(i).size(), batch->task(i).is_low_priority()});
+    }
+    mutex_lock l(mu);
+    batches.push_back(tasks);
+  };
+
+  {
+    auto scheduler = CreateSharedBatchScheduler(1);
+    const size_t batch_size_limit = 4;
+    const size_t batch_timeout_micros = 1000 * 1000 * 1000;
+    QueueOptions options = CreateQueueOptions(
+        batch_size_limit, batch_size_limit, batch_timeout_micros,
+        /*max_enqueued_batches=*/2, /*enable_large_batch_splitting=*/false,
+        /*enable_lazy_split=*/false, /*split_func=*/nullptr);
+    options.enable_priority_queue = true;
+    options.low_priority_queue_options.batch_timeout_micros =
+        batch_timeout_micros;
+    options.low_priority_queue_options.max_enqueued_batches = 1;
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    TF_ASSERT_OK(ScheduleTask(2, queue.get(), /*low_priority=*/true));
+    // The low-priority lane holds at most one batch worth of tasks.
+    EXPECT_EQ(error::UNAVAILABLE,
+              ScheduleTask(3, queue.get(), /*low_priority=*/true).code());
+    EXPECT_EQ(1, queue->NumEnqueuedTasks());
+
+    // Closing the first batch pads it with the low-priority task.
+    TF_ASSERT_OK(ScheduleTask(2, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(3, queue.get()));
+  }
+
+  ASSERT_EQ(2, batches.size());
+  EXPECT_THAT(batches[0],
+              ::testing::ElementsAre(std::make_pair(size_t{2}, false),
+                                     std::make_pair(size_t{2}, true)));
+  EXPECT_THAT(batches[1],
+              ::testing::ElementsAre(std::make_pair(size_t{3}, false)));
+}
+
+TEST(SharedBatchSchedulerPriorityTest, InvalidPriorityQueueOptions) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+
+  auto scheduler = CreateSharedBatchScheduler(2);
+  QueueOptions options = CreateQueueOptions(
+      /*max_execution_batch_size=*/10, /*input_batch_size_limit=*/10,
+      /*batch_timeout_micros=*/100 * 1000, /*max_enqueued_batches=*/2,
+      /*enable_large_batch_splitting=*/false, /*enable_lazy_split=*/false,
+      /*split_func=*/nullptr);
+  options.enable_priority_queue = true;
+  options.low_priority_queue_options.max_enqueued_batches = 0;
+  std::unique_ptr<Queue> queue;
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            scheduler->AddQueue(options, callback, &queue).code());
+}
+
 // Tests that `enable_lazy_split` could be enabled only if
 // `enable_large_batch_splitting` is enabled.
 TEST_P(SharedBatchSchedulerTest, InvalidLazySplitOptions) {
@@ -45,6 +45,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/conv_2d.h"
 #include "tensorflow/core/kernels/deep_conv2d.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/kernels/packed_gemm.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/numbers.h"
@@ -652,6 +653,56 @@ Status ComputeConv2DDimension(const Conv2DParameters& params,
 
 #undef TF_REQUIRES
 
+// Launches the convolutions that LaunchGeneric reduces to a matrix
+// multiplication with the filter packed once for all calls of the kernel
+// (see packed_gemm.h). Run() returns false for other convolutions, devices
+// and types.
+template <typename Device, typename T>
+class LaunchPackedFilterConvOp {
+ public:
+  bool Run(OpKernelContext* ctx, const Tensor& input, const Tensor& filter,
+           const Conv2DDimensions& dimensions, Padding padding,
+           TensorFormat data_format, Tensor* output) {
+    return false;
+  }
+};
+
+template <>
+class LaunchPackedFilterConvOp<CPUDevice, float> {
+ public:
+  bool Run(OpKernelContext* ctx, const Tensor& input, const Tensor& filter,
+           const Conv2DDimensions& dimensions, Padding padding,
+           TensorFormat data_format, Tensor* output) {
+    if (data_format != FORMAT_NHWC ||
+        dimensions.in_depth != dimensions.patch_depth) {
+      return false;
+    }
+    int64_t m;  // Rows of the input and output matrices.
+    if (dimensions.filter_rows == 1 && dimensions.filter_cols == 1 &&
+        dimensions.stride_rows == 1 && dimensions.stride_cols == 1 &&
+        (padding == SAME || padding == VALID)) {
+      m = dimensions.batch * dimensions.out_rows * dimensions.out_cols;
+    } else if (dimensions.filter_rows == dimensions.input_rows &&
+               dimensions.filter_cols == dimensions.input_cols &&
+               dimensions.dilation_rows == 1 &&
+               dimensions.dilation_cols == 1 && padding == VALID) {
+      m = dimensions.batch;
+    } else {
+      return false;
+    }
+    const int64_t k = filter.NumElements() / dimensions.out_depth;
+    std::shared_ptr<const PackedRhsGemm<float>> packed =
+        cache_.Get(filter, k, dimensions.out_depth, /*transpose=*/false);
+    packed->Multiply(*ctx->device()->tensorflow_cpu_worker_threads(),
+                     input.flat<float>().data(), m, /*transpose_lhs=*/false,
+                     output->flat<float>().data());
+    return true;
+  }
+
+ private:
+  PackedWeightsCache<float> cache_;
+};
+
 template <typename Device, typename T>
 class Conv2DOp : public BinaryOp<T> {
  public:
@@ -660,6 +711,7 @@ class Conv2DOp : public BinaryOp<T> {
 
     OP_REQUIRES_OK(context, context->GetAttr("use_cudnn_on_gpu", &use_cudnn_));
     cudnn_use_autotune_ = CudnnUseAutotune();
+    packed_filter_ = HasConstantWeights(context);
   }
 
   void Compute(OpKernelContext* context) override {
@@ -727,6 +779,13 @@ class Conv2DOp : public BinaryOp<T> {
       return;
     }
 
+    if (packed_filter_ &&
+        packed_filter_launcher_.Run(context, input, filter, dimensions,
+                                    params_.padding, params_.data_format,
+                                    output)) {
+      return;
+    }
+
     launcher_(context, use_cudnn_, cudnn_use_autotune_, input, filter,
               dimensions.dilation_rows, dimensions.dilation_cols,
               dimensions.stride_rows, dimensions.stride_cols, params_.padding,
@@ -737,8 +796,10 @@ class Conv2DOp : public BinaryOp<T> {
   Conv2DParameters params_;
   bool use_cudnn_;
   bool cudnn_use_autotune_;
+  bool packed_filter_;
 
   LaunchConv2DOp<Device, T> launcher_;
+  LaunchPackedFilterConvOp<Device, T> packed_filter_launcher_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(Conv2DOp);
 };
@@ -298,6 +298,9 @@ struct LaunchFusedConv2DOp<CPUDevice, T> {
                                            fused_batch_norm_args),
                context, input, filter, output);
         break;
+      default:
+        OP_REQUIRES_OK(context,
+                       errors::Internal("Fusion type is not supported"));
     }
   }
 };
@@ -17,8 +17,14 @@ limitations under the License.
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+#include "absl/base/call_once.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/profiler/lib/scoped_annotation.h"
 #include "tensorflow/core/protobuf/autotuning.pb.h"
+#include "tensorflow/core/util/autotune_maps/autotune_serialize.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/proto/proto_utils.h"
 #include "tensorflow/core/util/use_cudnn.h"
 
@@ -100,6 +106,90 @@ StatusOr<std::vector<tensorflow::AutotuneResult>> AutotuneConvImpl(
 }  // namespace
 #endif  // GOOGLE_CUDA
 
+namespace {
+
+// Returns a fingerprint of the GPU driver and DNN library versions `stream`
+// runs with, under which autotune results are persisted.
+std::string AutotuneRuntimeFingerprint(se::Stream* stream) {
+  se::StreamExecutor* executor = stream->parent();
+  std::string dnn_version = "unknown";
+  if (auto* dnn = executor->AsDnn()) {
+    auto version = dnn->GetVersion();
+    if (version.ok()) {
+      dnn_version = absl::StrCat(version->major_version(), ".",
+                                 version->minor_version(), ".",
+                                 version->patch());
+    }
+  }
+  return absl::StrCat("driver ",
+                      executor->GetDeviceDescription().driver_version(),
+                      ", dnn ", dnn_version);
+}
+
+// Returns the path of the persistent autotune store, or "" if none is set.
+const std::string& AutotuneStorePath() {
+  static const std::string* path = [] {
+    std::string value;
+    Status status = ReadStringFromEnvVar(kAutotuneStoreEnvVar, "", &value);
+    if (!status.ok()) LOG(ERROR) << status;
+    return new std::string(std::move(value));
+  }();
+  return *path;
+}
+
+// Loads the results in the persistent autotune store, if there is one, the
+// first time it is called.
+void MaybeLoadAutotuneStore(se::Stream* stream) {
+  static absl::once_flag once;
+  absl::call_once(once, [stream] {
+    const std::string& path = AutotuneStorePath();
+    if (path.empty()) return;
+    Status status = LoadAutotuneStore(path, AutotuneRuntimeFingerprint(stream));
+    if (status.ok()) {
+      LOG(INFO) << "Loaded autotune results from " << path;
+    } else {
+      VLOG(1) << "Did not load autotune results: " << status;
+    }
+  });
+}
+
+// How long results of new autotuning runs are collected before they are
+// written to the persistent autotune store together.
+constexpr int64_t kAutotuneStoreUpdateDelayMicros = 1000 * 1000;  // 1s.
+
+// Adds the results of a new autotuning run to the persistent autotune store,
+// if there is one. Each update rewrites the whole store, so instead of
+// updating it for every result, this schedules one update on a background
+// thread that also picks up the results found until it runs. Results found in
+// the last second before the process exits may not be stored.
+void MaybeUpdateAutotuneStore(se::Stream* stream) {
+  const std::string& path = AutotuneStorePath();
+  if (path.empty()) return;
+  static mutex* mu = new mutex;
+  static bool update_scheduled = false;
+  {
+    mutex_lock l(*mu);
+    if (update_scheduled) return;
+    update_scheduled = true;
+  }
+  Env::Default()->SchedClosureAfter(
+      kAutotuneStoreUpdateDelayMicros,
+      [&path, fingerprint = AutotuneRuntimeFingerprint(stream)] {
+        {
+          // Results inserted from now on schedule another update.
+          mutex_lock l(*mu);
+          update_scheduled = false;
+        }
+        Status status = UpdateAutotuneStore(path, fingerprint);
+        if (!status.ok()) {
+          LOG(WARNING) << "Failed to update the autotune store " << path
+                       << ": " << status;
+        }
+      });
+}
+
+}  // namespace
+
 bool ComputeInNhwcEnabled(DataType data_type, se::Stream* stream,
                           bool is_conv2d) {
 #if GOOGLE_CUDA
@@ -144,6 +234,7 @@ StatusOr<AutotuneEntry<se::dnn::FusedConvOp>> AutotuneFusedConv(
 #if GOOGLE_CUDA
   AutotuneEntry<se::dnn::FusedConvOp> autotune_entry;
   auto* stream = ctx->op_device_context()->stream();
+  MaybeLoadAutotuneStore(stream);
 
   if (!autotune_map->Find(params, &autotune_entry)) {
     profiler::ScopedAnnotation trace("cudnn_autotuning");
@@ -230,6 +321,7 @@ StatusOr<AutotuneEntry<se::dnn::FusedConvOp>> AutotuneFusedConv(
     }
 
     autotune_map->Insert(params, autotune_entry);
+    MaybeUpdateAutotuneStore(stream);
   }
   return autotune_entry;
 #else
@@ -285,6 +377,7 @@ StatusOr<AutotuneEntry<se::dnn::ConvOp>> AutotuneUnfusedConv(
   AutotuneEntry<se::dnn::ConvOp> autotune_entry;
 
   auto* stream = ctx->op_device_context()->stream();
+  MaybeLoadAutotuneStore(stream);
 
   if (!autotune_map->Find(conv_parameters, &autotune_entry)) {
     profiler::ScopedAnnotation annotation("cudnn_autotuning");
@@ -437,6 +530,7 @@ StatusOr<AutotuneEntry<se::dnn::ConvOp>> AutotuneUnfusedConv(
 #endif
 
     autotune_map->Insert(conv_parameters, autotune_entry);
+    MaybeUpdateAutotuneStore(stream);
   }
 
   return autotune_entry;
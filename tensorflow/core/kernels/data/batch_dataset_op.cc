@@ -134,7 +134,7 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     return input_->CheckExternalState();
   }
 
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext ctx, int64 index,
              std::vector<Tensor>* out_tensors) const override {
     const int64 cardinality = Cardinality();
     if (index < 0 || index >= cardinality) {
@@ -150,8 +150,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(input_->Get(ctx, i, &batch_element_tuple));
       batch_elements.emplace_back(std::move(batch_element_tuple));
     }
-    TF_RETURN_IF_ERROR(CopyBatch(CopyBatchParams(ctx), batch_elements,
-                                 parallel_copy_,
+    TF_RETURN_IF_ERROR(CopyBatch(CopyBatchParams(ctx),
+                                 std::move(batch_elements), parallel_copy_,
                                  /*allocation_callback=*/nullptr, out_tensors));
     return OkStatus();
   }
@@ -229,9 +229,10 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       // respective slice locations. This would require a different GetNext()
       // overload that supports zero-copy, and might make sense in an
       // optimization pass.
-      TF_RETURN_IF_ERROR(CopyBatch(
-          CopyBatchParams(ctx), batch_elements, dataset()->parallel_copy_,
-          /*allocation_callback=*/nullptr, out_tensors));
+      TF_RETURN_IF_ERROR(
+          CopyBatch(CopyBatchParams(ctx), std::move(batch_elements),
+                    dataset()->parallel_copy_,
+                    /*allocation_callback=*/nullptr, out_tensors));
 
       *end_of_sequence = false;
       return OkStatus();
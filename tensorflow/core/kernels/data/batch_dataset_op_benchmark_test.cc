@@ -0,0 +1,92 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <functional>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Returns `batch_size` elements, each with `num_components` scalar components
+// of type `dtype`.
+std::vector<std::vector<Tensor>> MakeBatchElements(int64_t batch_size,
+                                                   int64_t num_components,
+                                                   DataType dtype) {
+  std::vector<std::vector<Tensor>> batch_elements(batch_size);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    batch_elements[i].reserve(num_components);
+    for (int64_t j = 0; j < num_components; ++j) {
+      if (dtype == DT_STRING) {
+        batch_elements[i].push_back(test::AsScalar<tstring>(
+            absl::StrCat("a string that is not stored inline ", i, "_", j)));
+      } else {
+        batch_elements[i].push_back(test::AsScalar<int64_t>(i * j));
+      }
+    }
+  }
+  return batch_elements;
+}
+
+// Measures batching elements that are not shared with other tensors, such as
+// the outputs of a map function.
+void CopyBatchBenchmark(::testing::benchmark::State& state, DataType dtype) {
+  const int64_t batch_size = state.range(0);
+  const int64_t num_components = state.range(1);
+  std::function<void(std::function<void()>)> runner =
+      [](std::function<void()> fn) { fn(); };
+  for (auto s : state) {
+    state.PauseTiming();
+    std::vector<std::vector<Tensor>> batch_elements =
+        MakeBatchElements(batch_size, num_components, dtype);
+    std::vector<Tensor> out_tensors;
+    state.ResumeTiming();
+    TF_CHECK_OK(CopyBatch(CopyBatchParams(cpu_allocator(), &runner,
+                                          /*runner_threadpool_size=*/1),
+                          std::move(batch_elements), /*parallel_copy=*/false,
+                          /*allocation_callback=*/nullptr, &out_tensors));
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size * num_components);
+}
+
+void BM_CopyBatchInt64(::testing::benchmark::State& state) {
+  CopyBatchBenchmark(state, DT_INT64);
+}
+
+void BM_CopyBatchString(::testing::benchmark::State& state) {
+  CopyBatchBenchmark(state, DT_STRING);
+}
+
+BENCHMARK(BM_CopyBatchInt64)
+    ->ArgPair(32, 1)
+    ->ArgPair(32, 64)
+    ->ArgPair(256, 1)
+    ->ArgPair(256, 64);
+BENCHMARK(BM_CopyBatchString)
+    ->ArgPair(32, 1)
+    ->ArgPair(32, 64)
+    ->ArgPair(256, 1)
+    ->ArgPair(256, 64);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -70,6 +70,11 @@ constexpr char kIncompleteCacheErrorMessage[] =
     "contents of the dataset  will be discarded. This can happen if you have "
     "an input pipeline similar to `dataset.cache().take(k).repeat()`. You "
     "should use `dataset.take(k).cache().repeat()` instead.";
+
+CacheOptions GetCacheOptions(IteratorContext* ctx) {
+  return ctx->options() != nullptr ? ctx->options()->cache_options()
+                                   : CacheOptions();
+}
 }  // namespace
 
 class PartialCache {
@@ -78,8 +83,16 @@ class PartialCache {
 
   // Extends the temporary cache up to a given index and then updates
   // out_tensors with the element at that index.
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext any_ctx, int64 index,
              std::vector<Tensor>* out_tensors) {
+    // The temporary cache is filled through an iterator resource, which needs
+    // an op kernel context.
+    OpKernelContext* ctx = any_ctx.op_kernel_context;
+    if (ctx == nullptr) {
+      return errors::Unimplemented(
+          "Random access to a partially cached dataset is only supported in "
+          "op kernels.");
+    }
     if (!iter_resource_) {
       TF_ASSIGN_OR_RETURN(iter_resource_,
                           GetIteratorResourceFromDataset(ctx, input_));
@@ -765,7 +778,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     return input_->Cardinality(options);
   };
 
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext ctx, int64 index,
              std::vector<Tensor>* out_tensors) const override {
     mutex_lock l(mu_);
 
@@ -823,8 +836,10 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       if (cache_->IsCompleted()) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheCompleted), ""));
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(cache_->GetAll(&elements));
         TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+            WriteElementsToCheckpoint(writer, prefix(), elements));
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -838,7 +853,9 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         std::vector<std::vector<Tensor>> temp_cache;
         TF_RETURN_IF_ERROR(
             ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
-        cache_->Complete(std::move(temp_cache));
+        MemoryCache restored_cache(GetCacheOptions(ctx));
+        TF_RETURN_IF_ERROR(restored_cache.PutAll(std::move(temp_cache)));
+        TF_RETURN_IF_ERROR(cache_->Complete(std::move(restored_cache)));
       }
       TF_RETURN_IF_ERROR(InitializeIterator(ctx));
       return RestoreInput(ctx, reader, iterator_);
@@ -852,13 +869,15 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
+        if (temp_cache_ && temp_cache_->size() > 0 && !cache_->IsCompleted()) {
           LOG(WARNING) << kIncompleteCacheErrorMessage;
           cache_->Reset();
         }
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        temp_cache_ = std::make_unique<MemoryCache>(GetCacheOptions(ctx));
         return dataset()->input_->MakeIterator(ctx, this, prefix(),
                                                &input_impl_);
       }
@@ -872,16 +891,19 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (*end_of_sequence) {
           if (!cache_->IsCompleted()) {
             VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
+            TF_RETURN_IF_ERROR(cache_->Complete(std::move(*temp_cache_)));
           }
           return OkStatus();
         }
-        RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        const int64_t index = temp_cache_->size();
+        TF_RETURN_IF_ERROR(temp_cache_->Put(index, *out_tensors));
+        if (!temp_cache_->IsSpilled(index)) {
+          RecordBufferEnqueue(ctx, *out_tensors);
+        }
+        if (temp_cache_->size() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          TF_RETURN_IF_ERROR(cache_->Complete(std::move(*temp_cache_)));
         }
         return OkStatus();
       }
@@ -897,8 +919,10 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         if (!cache_->IsCompleted()) {
+          std::vector<std::vector<Tensor>> elements;
+          TF_RETURN_IF_ERROR(temp_cache_->GetAll(&elements));
           TF_RETURN_IF_ERROR(
-              WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+              WriteElementsToCheckpoint(writer, prefix(), elements));
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -907,8 +931,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
         if (!reader->Contains(full_name(kCacheCompleted))) {
+          std::vector<std::vector<Tensor>> elements;
           TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache_));
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &elements));
+          temp_cache_->Reset();
+          TF_RETURN_IF_ERROR(temp_cache_->PutAll(std::move(elements)));
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
@@ -917,7 +944,9 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
-      std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      // Collects the elements until the input is exhausted, at which point they
+      // are moved to `cache_`.
+      std::unique_ptr<MemoryCache> temp_cache_ TF_GUARDED_BY(mu_);
     };  // MemoryWriterIterator
 
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
@@ -935,7 +964,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         // iterator.
         tf_shared_lock l(mu_);
         for (size_t i = 0; i < cache_->size(); ++i) {
-          RecordBufferEnqueue(ctx, cache_->at(i));
+          if (cache_->IsSpilled(i)) {
+            continue;
+          }
+          std::vector<Tensor> element;
+          TF_RETURN_IF_ERROR(cache_->Get(i, &element));
+          RecordBufferEnqueue(ctx, element);
         }
         return OkStatus();
       }
@@ -945,7 +979,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
         if (index_ < cache_->size()) {
-          const std::vector<Tensor>& cache_tensors = cache_->at(index_);
+          std::vector<Tensor> cache_tensors;
+          TF_RETURN_IF_ERROR(cache_->Get(index_, &cache_tensors));
           out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
                               cache_tensors.end());
           index_++;
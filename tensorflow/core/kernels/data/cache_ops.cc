@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <algorithm>
+
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -22,50 +25,273 @@ limitations under the License.
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kSpillFilePrefix[] = "tf_data_cache_";
+constexpr int64_t kDefaultNumShards = 16;
 
 }  // namespace
 
 string MemoryCacheManager::DebugString() const { return kMemoryCache; }
 
-void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
+MemoryCache::MemoryCache(const CacheOptions& options)
+    : ram_budget_(options.ram_budget()),
+      spill_directory_(options.spill_directory()) {
+  const int64_t num_shards =
+      options.optional_num_shards_case() == CacheOptions::kNumShards
+          ? std::max(options.num_shards(), 1)
+          : kDefaultNumShards;
+  shards_.reserve(num_shards);
+  for (int64_t i = 0; i < num_shards; ++i) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+MemoryCache::~MemoryCache() { DeleteSpillFiles(); }
+
+Status MemoryCache::Put(int64_t index, std::vector<Tensor> element) {
+  // Holding `mu_` keeps `Complete()` from swapping the shards while in use.
+  tf_shared_lock cache_lock(mu_);
+  if (completed_.load(std::memory_order_acquire)) {
+    return errors::FailedPrecondition(
+        "Cannot add elements to a completed cache.");
+  }
+  Shard& shard = *shards_[index % shards_.size()];
+  const int64_t slot = index / shards_.size();
+  const int64_t num_bytes = GetAllocatedBytes(element);
+  bool spill = false;
+  if (CanSpill()) {
+    spill = allocated_bytes_.fetch_add(num_bytes) + num_bytes > ram_budget_;
+    if (spill) {
+      allocated_bytes_.fetch_sub(num_bytes);
+    }
+  } else {
+    allocated_bytes_.fetch_add(num_bytes);
+  }
+  mutex_lock l(shard.mu);
+  if (shard.entries.size() <= slot) {
+    shard.entries.resize(slot + 1);
+  }
+  Entry& entry = shard.entries[slot];
+  if (spill) {
+    TF_RETURN_IF_ERROR(Spill(shard, element, &entry));
+  } else {
+    entry.element = std::move(element);
+  }
+  size_.fetch_add(1);
+  return OkStatus();
+}
+
+Status MemoryCache::PutAll(std::vector<std::vector<Tensor>>&& elements) {
+  const int64_t num_shards = shards_.size();
+  const int num_threads = std::min<int64_t>(
+      {num_shards, static_cast<int64_t>(elements.size()),
+       static_cast<int64_t>(port::MaxParallelism())});
+  // Without spilling, filling the cache only moves tensor buffers.
+  if (!CanSpill() || num_threads <= 1) {
+    for (int64_t i = 0; i < elements.size(); ++i) {
+      TF_RETURN_IF_ERROR(Put(i, std::move(elements[i])));
+    }
+    return OkStatus();
+  }
+  std::vector<Status> statuses(num_shards);
+  {
+    thread::ThreadPool pool(Env::Default(), ThreadOptions(), "fill_cache",
+                            num_threads, /*low_latency_hint=*/false);
+    for (int64_t shard = 0; shard < num_shards; ++shard) {
+      pool.Schedule([this, shard, num_shards, &elements, &statuses]() {
+        for (int64_t i = shard; i < elements.size(); i += num_shards) {
+          statuses[shard] = Put(i, std::move(elements[i]));
+          if (!statuses[shard].ok()) {
+            return;
+          }
+        }
+      });
+    }
+  }
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return OkStatus();
+}
+
+Status MemoryCache::Complete(MemoryCache&& other) {
   mutex_lock l(mu_);
-  if (!completed_) {
-    cache_ = std::move(cache);
-    completed_ = true;
+  if (completed_.load(std::memory_order_acquire)) {
+    return OkStatus();
   }
+  TF_RETURN_IF_ERROR(other.FinalizeSpillFiles());
+  shards_.swap(other.shards_);
+  size_.store(other.size_.exchange(0));
+  allocated_bytes_.store(other.allocated_bytes_.exchange(0));
+  completed_.store(true, std::memory_order_release);
+  return OkStatus();
 }
 
-bool MemoryCache::IsCompleted() {
-  tf_shared_lock l(mu_);
-  return completed_;
+bool MemoryCache::IsCompleted() const {
+  return completed_.load(std::memory_order_acquire);
 }
 
 void MemoryCache::Reset() {
   mutex_lock l(mu_);
-  completed_ = false;
-  cache_.clear();
+  completed_.store(false, std::memory_order_release);
+  DeleteSpillFiles();
+  for (auto& shard : shards_) {
+    mutex_lock shard_lock(shard->mu);
+    shard->entries.clear();
+  }
+  size_.store(0);
+  allocated_bytes_.store(0);
 }
 
-const std::vector<Tensor>& MemoryCache::at(int64_t index) {
-  tf_shared_lock l(mu_);
-  DCHECK(index < cache_.size());
-  return cache_[index];
+Status MemoryCache::Get(int64_t index, std::vector<Tensor>* element) const {
+  if (completed_.load(std::memory_order_acquire)) {
+    // The shards are immutable once the cache is completed.
+    const Shard& shard = *shards_[index % shards_.size()];
+    return GetFromShard(shard, index / shards_.size(), element);
+  }
+  tf_shared_lock cache_lock(mu_);
+  const Shard& shard = *shards_[index % shards_.size()];
+  const int64_t slot = index / shards_.size();
+  mutex_lock l(shard.mu);
+  return GetFromShard(shard, slot, element);
 }
 
-size_t MemoryCache::size() {
-  tf_shared_lock l(mu_);
-  return cache_.size();
+Status MemoryCache::GetAll(std::vector<std::vector<Tensor>>* elements) const {
+  elements->resize(size());
+  for (int64_t i = 0; i < elements->size(); ++i) {
+    TF_RETURN_IF_ERROR(Get(i, &(*elements)[i]));
+  }
+  return OkStatus();
 }
 
-const std::vector<std::vector<Tensor>>& MemoryCache::data() {
-  tf_shared_lock l(mu_);
-  return cache_;
+bool MemoryCache::IsSpilled(int64_t index) const {
+  if (completed_.load(std::memory_order_acquire)) {
+    const Shard& shard = *shards_[index % shards_.size()];
+    return IsSpilledInShard(shard, index / shards_.size());
+  }
+  tf_shared_lock cache_lock(mu_);
+  const Shard& shard = *shards_[index % shards_.size()];
+  const int64_t slot = index / shards_.size();
+  tf_shared_lock l(shard.mu);
+  return IsSpilledInShard(shard, slot);
+}
+
+size_t MemoryCache::size() const { return size_.load(); }
+
+int64_t MemoryCache::AllocatedBytes() const { return allocated_bytes_.load(); }
+
+Status MemoryCache::GetFromShard(const Shard& shard, int64_t slot,
+                                 std::vector<Tensor>* element) const {
+  if (slot >= shard.entries.size()) {
+    return errors::OutOfRange("Slot ", slot, " is out of range for a cache ",
+                              "shard of size ", shard.entries.size());
+  }
+  const Entry& entry = shard.entries[slot];
+  if (entry.spilled) {
+    return ReadSpilled(shard, entry, element);
+  }
+  *element = entry.element;
+  return OkStatus();
+}
+
+bool MemoryCache::IsSpilledInShard(const Shard& shard, int64_t slot) const {
+  return slot < shard.entries.size() && shard.entries[slot].spilled;
+}
+
+Status MemoryCache::Spill(Shard& shard, const std::vector<Tensor>& element,
+                          Entry* entry) {
+  Env* env = Env::Default();
+  if (!shard.spill_writer) {
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(spill_directory_));
+    shard.spill_filename = io::JoinPath(
+        spill_directory_,
+        strings::StrCat(kSpillFilePrefix, random::New64()));
+    TF_RETURN_IF_ERROR(
+        env->NewWritableFile(shard.spill_filename, &shard.spill_writer));
+    shard.spill_size = 0;
+  }
+  CompressedElement compressed;
+  TF_RETURN_IF_ERROR(CompressElement(element, &compressed));
+  const string serialized = compressed.SerializeAsString();
+  TF_RETURN_IF_ERROR(shard.spill_writer->Append(serialized));
+  entry->element.clear();
+  entry->spilled = true;
+  entry->offset = shard.spill_size;
+  entry->length = serialized.size();
+  shard.spill_size += serialized.size();
+  return OkStatus();
+}
+
+Status MemoryCache::ReadSpilled(const Shard& shard, const Entry& entry,
+                                std::vector<Tensor>* element) const {
+  std::unique_ptr<RandomAccessFile> reader;
+  const RandomAccessFile* file = shard.spill_reader.get();
+  if (file == nullptr) {
+    // The spill file of an incomplete cache is still being written, and the
+    // shard lock is held exclusively.
+    TF_RETURN_IF_ERROR(shard.spill_writer->Flush());
+    TF_RETURN_IF_ERROR(
+        Env::Default()->NewRandomAccessFile(shard.spill_filename, &reader));
+    file = reader.get();
+  }
+  tstring buffer;
+  buffer.resize_uninitialized(entry.length);
+  StringPiece result;
+  TF_RETURN_IF_ERROR(file->Read(entry.offset, entry.length, &result,
+                                buffer.mdata()));
+  if (result.size() != entry.length) {
+    return errors::DataLoss("Failed to read spilled cache element from ",
+                            shard.spill_filename, ": expected ", entry.length,
+                            " bytes, got ", result.size());
+  }
+  CompressedElement compressed;
+  if (!compressed.ParseFromArray(result.data(), result.size())) {
+    return errors::DataLoss("Failed to parse spilled cache element from ",
+                            shard.spill_filename);
+  }
+  return UncompressElement(compressed, element);
+}
+
+Status MemoryCache::FinalizeSpillFiles() {
+  for (auto& shard : shards_) {
+    mutex_lock l(shard->mu);
+    if (!shard->spill_writer) {
+      continue;
+    }
+    TF_RETURN_IF_ERROR(shard->spill_writer->Close());
+    shard->spill_writer.reset();
+    TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(
+        shard->spill_filename, &shard->spill_reader));
+  }
+  return OkStatus();
+}
+
+void MemoryCache::DeleteSpillFiles() {
+  for (auto& shard : shards_) {
+    mutex_lock l(shard->mu);
+    if (shard->spill_filename.empty()) {
+      continue;
+    }
+    shard->spill_reader.reset();
+    if (shard->spill_writer) {
+      shard->spill_writer->Close().IgnoreError();
+      shard->spill_writer.reset();
+    }
+    Status s = Env::Default()->DeleteFile(shard->spill_filename);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete cache spill file "
+                   << shard->spill_filename << ": " << s;
+    }
+    shard->spill_filename.clear();
+  }
 }
 
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
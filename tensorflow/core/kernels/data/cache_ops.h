@@ -16,45 +16,129 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/platform/file_system.h"
 
 namespace tensorflow {
 namespace data {
 
 // A thread-safe data structure for caching dataset elements.
 //
-// The expected use is that a single `MemoryWriterIterator` populates the
-// cache with dataset elements. Once all elements are cached, the cache can
-// be used by one or more `MemoryReaderIterator`s.
+// The elements are distributed across independently locked shards (element
+// `i` is stored in shard `i % num_shards`) so that concurrent producers and
+// consumers do not serialize on a single lock. Once the cache is completed its
+// contents are immutable and reads do not acquire any locks.
+//
+// If `CacheOptions` specify a RAM budget and a spill directory, elements that
+// would exceed the budget are written to a per-shard file in the spill
+// directory instead of being kept in memory.
+//
+// The expected use is that a single `MemoryWriterIterator` populates a private
+// cache with dataset elements and, once all elements are cached, moves them
+// into the shared cache through `Complete()`. The shared cache can then be
+// used by one or more `MemoryReaderIterator`s.
 class MemoryCache {
  public:
-  MemoryCache() = default;
+  MemoryCache() : MemoryCache(CacheOptions()) {}
+  explicit MemoryCache(const CacheOptions& options);
+  ~MemoryCache();
+
+  // Stores `element` at position `index`. Elements with different indices may
+  // be put concurrently.
+  Status Put(int64_t index, std::vector<Tensor> element);
 
-  // Marks the cache as completed.
-  void Complete(std::vector<std::vector<Tensor>>&& cache);
+  // Stores `elements` at positions `[0, elements.size())`, filling the shards
+  // in parallel.
+  Status PutAll(std::vector<std::vector<Tensor>>&& elements);
+
+  // Marks the cache as completed, taking over the elements of `other`. Does
+  // nothing if the cache is already completed.
+  Status Complete(MemoryCache&& other);
 
   // Returns whether the cache is completed.
-  bool IsCompleted();
+  bool IsCompleted() const;
 
-  // Resets the cache.
+  // Resets the cache. Must not be called concurrently with other methods.
   void Reset();
 
   // Returns the element at the given index.
-  const std::vector<Tensor>& at(int64_t index);
+  Status Get(int64_t index, std::vector<Tensor>* element) const;
+
+  // Returns all elements of the cache.
+  Status GetAll(std::vector<std::vector<Tensor>>* elements) const;
+
+  // Returns whether the element at the given index has been spilled to disk.
+  bool IsSpilled(int64_t index) const;
 
   // Returns the size of the cache.
-  size_t size();
+  size_t size() const;
 
-  // Returns a reference to the cache's data. The returned reference will be
-  // invalidated by any call to Reset().
-  const std::vector<std::vector<Tensor>>& data();
+  // Returns the number of bytes of cached elements held in memory.
+  int64_t AllocatedBytes() const;
 
  private:
-  mutex mu_;
-  // Determines whether all elements of the dataset have been cached.
-  bool completed_ TF_GUARDED_BY(mu_) = false;
-  std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  struct Entry {
+    std::vector<Tensor> element;
+    bool spilled = false;
+    // The location of the serialized element in the spill file.
+    uint64 offset = 0;
+    uint64 length = 0;
+  };
+
+  struct Shard {
+    mutable mutex mu;
+    std::vector<Entry> entries TF_GUARDED_BY(mu);
+    string spill_filename TF_GUARDED_BY(mu);
+    std::unique_ptr<WritableFile> spill_writer TF_GUARDED_BY(mu);
+    std::unique_ptr<RandomAccessFile> spill_reader TF_GUARDED_BY(mu);
+    uint64 spill_size TF_GUARDED_BY(mu) = 0;
+  };
+
+  // Returns the element in the given slot of `shard`. Requires either the shard
+  // lock or a completed cache.
+  Status GetFromShard(const Shard& shard, int64_t slot,
+                      std::vector<Tensor>* element) const
+      TF_NO_THREAD_SAFETY_ANALYSIS;
+  bool IsSpilledInShard(const Shard& shard, int64_t slot) const
+      TF_NO_THREAD_SAFETY_ANALYSIS;
+
+  // Writes `element` to the spill file of `shard`, recording its location in
+  // `entry`.
+  Status Spill(Shard& shard, const std::vector<Tensor>& element, Entry* entry)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu);
+
+  // Reads the spilled element described by `entry` from `shard`.
+  Status ReadSpilled(const Shard& shard, const Entry& entry,
+                     std::vector<Tensor>* element) const
+      TF_NO_THREAD_SAFETY_ANALYSIS;
+
+  // Closes the spill writers and opens the spill readers of all shards.
+  Status FinalizeSpillFiles();
+
+  // Closes and deletes the spill files of all shards.
+  void DeleteSpillFiles();
+
+  bool CanSpill() const {
+    return ram_budget_ > 0 && !spill_directory_.empty();
+  }
+
+  const int64_t ram_budget_;
+  const string spill_directory_;
+  // Held exclusively by `Complete()` and `Reset()`, which replace the shards,
+  // and shared by readers and writers of an incomplete cache.
+  mutable mutex mu_;
+  // Determines whether all elements of the dataset have been cached. The shards
+  // are immutable once this is set, which allows for lock-free reads.
+  std::atomic<bool> completed_{false};
+  std::atomic<int64_t> size_{0};
+  std::atomic<int64_t> allocated_bytes_{0};
+  std::vector<std::unique_ptr<Shard>> shards_;
 };
 
 // A resource wrapping a shared instance of a memory cache.
@@ -0,0 +1,169 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/cache_ops.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::vector<Tensor> MakeElement(int64_t value) {
+  return {test::AsTensor<int64_t>({value, value + 1, value + 2, value + 3})};
+}
+
+void ExpectElements(const MemoryCache& cache, int64_t num_elements) {
+  ASSERT_EQ(cache.size(), num_elements);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(cache.Get(i, &element));
+    ASSERT_EQ(element.size(), 1);
+    test::ExpectEqual(element[0], MakeElement(i)[0]);
+  }
+}
+
+TEST(MemoryCacheTest, PutAndGetAcrossShards) {
+  CacheOptions options;
+  options.set_num_shards(3);
+  MemoryCache temp_cache(options);
+  for (int64_t i = 9; i >= 0; --i) {
+    TF_ASSERT_OK(temp_cache.Put(i, MakeElement(i)));
+  }
+  ExpectElements(temp_cache, 10);
+
+  MemoryCache cache;
+  EXPECT_FALSE(cache.IsCompleted());
+  TF_ASSERT_OK(cache.Complete(std::move(temp_cache)));
+  EXPECT_TRUE(cache.IsCompleted());
+  ExpectElements(cache, 10);
+  EXPECT_GT(cache.AllocatedBytes(), 0);
+}
+
+TEST(MemoryCacheTest, ConcurrentPut) {
+  constexpr int64_t kNumElements = 1000;
+  MemoryCache temp_cache;
+  {
+    thread::ThreadPool pool(Env::Default(), "concurrent_put", 8);
+    for (int64_t i = 0; i < kNumElements; ++i) {
+      pool.Schedule([&temp_cache, i]() {
+        TF_CHECK_OK(temp_cache.Put(i, MakeElement(i)));
+      });
+    }
+  }
+  MemoryCache cache;
+  TF_ASSERT_OK(cache.Complete(std::move(temp_cache)));
+  ExpectElements(cache, kNumElements);
+}
+
+TEST(MemoryCacheTest, CompleteOnlyOnce) {
+  MemoryCache first;
+  TF_ASSERT_OK(first.PutAll({MakeElement(0), MakeElement(1)}));
+  MemoryCache second;
+  TF_ASSERT_OK(second.Put(0, MakeElement(5)));
+
+  MemoryCache cache;
+  TF_ASSERT_OK(cache.Complete(std::move(first)));
+  TF_ASSERT_OK(cache.Complete(std::move(second)));
+  ExpectElements(cache, 2);
+  EXPECT_TRUE(errors::IsFailedPrecondition(cache.Put(2, MakeElement(2))));
+
+  cache.Reset();
+  EXPECT_FALSE(cache.IsCompleted());
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(MemoryCacheTest, ConcurrentCompleteAndGet) {
+  constexpr int64_t kNumElements = 100;
+  MemoryCache cache;
+  {
+    thread::ThreadPool pool(Env::Default(), "concurrent_complete", 8);
+    for (int writer = 0; writer < 4; ++writer) {
+      pool.Schedule([&cache]() {
+        MemoryCache temp_cache;
+        std::vector<std::vector<Tensor>> elements;
+        for (int64_t i = 0; i < kNumElements; ++i) {
+          elements.push_back(MakeElement(i));
+        }
+        TF_CHECK_OK(temp_cache.PutAll(std::move(elements)));
+        TF_CHECK_OK(cache.Complete(std::move(temp_cache)));
+      });
+      pool.Schedule([&cache]() {
+        // Reads before the cache is completed find no elements; reads after
+        // find all of them.
+        for (int64_t i = 0; i < kNumElements; ++i) {
+          std::vector<Tensor> element;
+          Status s = cache.Get(i, &element);
+          if (s.ok()) {
+            test::ExpectEqual(element[0], MakeElement(i)[0]);
+          } else {
+            EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+          }
+        }
+      });
+    }
+  }
+  ExpectElements(cache, kNumElements);
+}
+
+TEST(MemoryCacheTest, SpillOverRamBudget) {
+  constexpr int64_t kNumElements = 100;
+  const int64_t element_bytes = GetAllocatedBytes(MakeElement(0));
+  const string spill_directory =
+      io::JoinPath(testing::TmpDir(), "memory_cache_spill");
+  CacheOptions options;
+  options.set_num_shards(4);
+  options.set_ram_budget(10 * element_bytes);
+  options.set_spill_directory(spill_directory);
+  {
+    MemoryCache temp_cache(options);
+    std::vector<std::vector<Tensor>> elements;
+    for (int64_t i = 0; i < kNumElements; ++i) {
+      elements.push_back(MakeElement(i));
+    }
+    TF_ASSERT_OK(temp_cache.PutAll(std::move(elements)));
+    EXPECT_LE(temp_cache.AllocatedBytes(), options.ram_budget());
+    ExpectElements(temp_cache, kNumElements);
+
+    MemoryCache cache;
+    TF_ASSERT_OK(cache.Complete(std::move(temp_cache)));
+    ExpectElements(cache, kNumElements);
+    int64_t num_spilled = 0;
+    for (int64_t i = 0; i < kNumElements; ++i) {
+      num_spilled += cache.IsSpilled(i);
+    }
+    // Concurrent shards may spill more eagerly than strictly necessary.
+    EXPECT_GE(num_spilled, kNumElements - 10);
+
+    std::vector<string> spill_files;
+    TF_ASSERT_OK(Env::Default()->GetChildren(spill_directory, &spill_files));
+    EXPECT_EQ(spill_files.size(), options.num_shards());
+  }
+  // The spill files are deleted with the cache.
+  std::vector<string> spill_files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(spill_directory, &spill_files));
+  EXPECT_TRUE(spill_files.empty());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -460,7 +460,9 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       do {
         while (!ResultReady() && !Finished() && !cancelled_ && status_.ok()) {
           VLOG(3) << "Blocking in GetNext: " << DebugString();
+          const int64_t wait_start_micros = EnvTime::NowMicros();
           get_next_cv_.wait(l);
+          wait_time_us_ += EnvTime::NowMicros() - wait_start_micros;
         }
         if (cancelled_) {
           VLOG(3) << "Returning from GetNext due to cancellation";
@@ -549,6 +551,8 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       bool in_use TF_GUARDED_BY(&Iterator::mu_) = false;
       // Indicates whether the worker has returned end_of_sequence for the task.
       bool end_of_sequence TF_GUARDED_BY(&Iterator::mu_) = false;
+      // Time spent waiting for elements from the task since the last
+      // dispatcher heartbeat.
     };
 
     struct Result {
@@ -786,6 +790,10 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
           req.set_blocked_round(round_robin_round_limit_.value());
         }
       }
+      {
+        mutex_lock l(mu_);
+        RecordWaitTime(req);
+      }
       ClientHeartbeatResponse resp;
       Status s = dispatcher_->ClientHeartbeat(req, resp);
       if (!s.ok()) {
@@ -814,6 +822,19 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       RecordTFMetrics(resp);
     }
 
+    // Reports the time GetNext spent blocked since the previous heartbeat, so
+    // that the dispatcher can recommend how many workers to run.
+    void RecordWaitTime(ClientHeartbeatRequest& req)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64_t now_micros = EnvTime::NowMicros();
+      if (last_wait_time_reset_micros_ > 0) {
+        req.set_wait_time_us(wait_time_us_);
+        req.set_wait_time_window_us(now_micros - last_wait_time_reset_micros_);
+      }
+      wait_time_us_ = 0;
+      last_wait_time_reset_micros_ = now_micros;
+    }
+
     void UpdateTasks(const ClientHeartbeatResponse& resp)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       absl::flat_hash_map<int64_t, TaskInfo> task_id_to_task;
@@ -1249,6 +1270,11 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
     // The index of the next task in `tasks_` to read from.
     int64_t next_task_index_ TF_GUARDED_BY(mu_) = 0;
 
+    // Time GetNext spent blocked since `last_wait_time_reset_micros_`.
+    int64_t wait_time_us_ TF_GUARDED_BY(mu_) = 0;
+    // The time at which the wait time was last reported to the dispatcher.
+    int64_t last_wait_time_reset_micros_ TF_GUARDED_BY(mu_) = 0;
+
     // The number tasks in the `tasks_` list that have reached end_of_sequence.
     int64_t finished_tasks_ TF_GUARDED_BY(mu_) = 0;
 
@@ -1484,7 +1510,8 @@ void DataServiceDatasetOp::MakeDataset(OpKernelContext* ctx,
     OP_REQUIRES_OK(ctx, compression.status());
     should_uncompress =
         should_uncompress &&
-        (*compression == DataServiceMetadata::COMPRESSION_SNAPPY);
+        (*compression == DataServiceMetadata::COMPRESSION_SNAPPY ||
+         *compression == DataServiceMetadata::COMPRESSION_CODEC);
   }
   DataTypeVector data_service_output_types = output_types_;
   std::vector<PartialTensorShape> data_service_output_shapes = output_shapes_;
@@ -39,7 +39,8 @@ Status GetElementAtIndexOp::DoCompute(OpKernelContext* ctx) {
 
   std::vector<Tensor> components;
 
-  TF_RETURN_IF_ERROR(finalized_dataset->Get(ctx, index, &components));
+  TF_RETURN_IF_ERROR(
+      finalized_dataset->Get(AnyContext(ctx), index, &components));
   TF_RETURN_IF_ERROR(VerifyTypesMatch(output_types_, components));
   TF_RETURN_IF_ERROR(VerifyShapesCompatible(output_shapes_, components));
 
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/fixed_length_record_dataset_op.h"
 
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/read_ahead_file.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -189,6 +190,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         }
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             TranslateFileName(next_filename), &file_));
+        file_ = MaybeReadAhead(std::move(file_), dataset()->buffer_size_);
         input_buffer_ = std::make_unique<io::InputBuffer>(
             file_.get(), dataset()->buffer_size_);
         TF_RETURN_IF_ERROR(input_buffer_->SkipNBytes(dataset()->header_bytes_));
@@ -234,6 +236,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         file_pos_limit_ = file_size - dataset()->footer_bytes_;
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             TranslateFileName(current_filename), &file_));
+        file_ = MaybeReadAhead(std::move(file_), dataset()->buffer_size_);
         input_buffer_ = std::make_unique<io::InputBuffer>(
             file_.get(), dataset()->buffer_size_);
         TF_RETURN_IF_ERROR(input_buffer_->Seek(current_pos));
@@ -354,6 +357,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             TranslateFileName(dataset()->filenames_[current_file_index_]),
             &file_));
+        file_ = MaybeReadAhead(std::move(file_), dataset()->buffer_size_);
         if (!dataset()->compression_type_.empty()) {
           const io::ZlibCompressionOptions zlib_options =
               dataset()->compression_type_ == kZLIB
@@ -418,6 +422,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             TranslateFileName(dataset()->filenames_[current_file_index_]),
             &file_));
+        file_ = MaybeReadAhead(std::move(file_), dataset()->buffer_size_);
         const io::ZlibCompressionOptions zlib_options =
             dataset()->compression_type_ == kZLIB
                 ? io::ZlibCompressionOptions::DEFAULT()
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/data/captured_function.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/finalization_utils.h"
+#include "tensorflow/core/data/incremental_checkpoint.h"
 #include "tensorflow/core/data/metric_utils.h"
 #include "tensorflow/core/data/root_dataset.h"
 #include "tensorflow/core/data/serialization_utils.h"
@@ -98,7 +99,8 @@ IteratorResource::IteratorResource(
                                               std::move(pflr), flr,
                                               /*iterator=*/nullptr)),
       output_dtypes_(output_dtypes),
-      output_shapes_(output_shapes) {
+      output_shapes_(output_shapes),
+      env_(env) {
   VLOG(2) << "creating iterator resource";
 }
 
@@ -159,6 +161,60 @@ Status IteratorResource::Save(SerializationContext* ctx,
       "saving it.");
 }
 
+Status IteratorResource::SaveIncremental(SerializationContext* ctx,
+                                         const std::string& directory,
+                                         bool asynchronous) {
+  // Capturing the state only takes references to the buffers of the saved
+  // tensors, so iteration can continue while they are written.
+  auto state_writer = std::make_shared<VariantTensorDataWriter>();
+  TF_RETURN_IF_ERROR(Save(ctx, state_writer.get()));
+  mutex_lock l(checkpoint_mu_);
+  TF_RETURN_IF_ERROR(WaitForCheckpointLocked());
+  if (!checkpoint_writer_ || checkpoint_writer_->directory() != directory) {
+    checkpoint_writer_ =
+        std::make_unique<IncrementalCheckpointWriter>(env_, directory);
+  }
+  auto write = [checkpoint_writer = checkpoint_writer_.get(), state_writer]() {
+    std::vector<const VariantTensorData*> data;
+    state_writer->GetData(&data);
+    return checkpoint_writer->Write(data);
+  };
+  if (!asynchronous) {
+    return write();
+  }
+  checkpoint_thread_ = absl::WrapUnique(env_->StartThread(
+      {}, "tf_data_iterator_checkpoint",
+      [this, write = std::move(write)]() { checkpoint_status_ = write(); }));
+  return OkStatus();
+}
+
+Status IteratorResource::RestoreIncremental(OpKernelContext* ctx,
+                                            const std::string& directory) {
+  {
+    mutex_lock l(checkpoint_mu_);
+    TF_RETURN_IF_ERROR(WaitForCheckpointLocked());
+  }
+  std::vector<std::unique_ptr<VariantTensorData>> data;
+  TF_RETURN_IF_ERROR(ReadIncrementalCheckpoint(env_, directory, &data));
+  std::vector<const VariantTensorData*> data_ptrs;
+  data_ptrs.reserve(data.size());
+  for (const auto& d : data) {
+    data_ptrs.push_back(d.get());
+  }
+  VariantTensorDataReader reader(data_ptrs);
+  return Restore(ctx, &reader);
+}
+
+Status IteratorResource::WaitForCheckpointLocked() {
+  if (!checkpoint_thread_) {
+    return OkStatus();
+  }
+  checkpoint_thread_.reset();
+  Status status = checkpoint_status_;
+  checkpoint_status_ = OkStatus();
+  return status;
+}
+
 Status IteratorResource::Restore(OpKernelContext* ctx,
                                  IteratorStateReader* reader) {
   const DatasetBase* dataset;
@@ -1102,6 +1158,55 @@ void DeserializeIteratorOp::Compute(OpKernelContext* ctx) {
   }
 }
 
+IteratorSaveIncrementalOp::IteratorSaveIncrementalOp(
+    OpKernelConstruction* ctx)
+    : OpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kAsynchronous, &asynchronous_));
+  int64_t state_change_option;
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kExternalStatePolicy, &state_change_option));
+  external_state_policy_ =
+      SerializationContext::ExternalStatePolicy(state_change_option);
+}
+
+void IteratorSaveIncrementalOp::Compute(OpKernelContext* ctx) {
+  tensorflow::ResourceTagger tag(kTFDataResourceTag,
+                                 ctx->op_kernel().type_string());
+  IteratorResource* iterator_resource;
+  OP_REQUIRES_OK(
+      ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &iterator_resource));
+  core::ScopedUnref unref_iterator(iterator_resource);
+  tstring directory;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "directory", &directory));
+  SerializationContext::Params params(ctx);
+  params.external_state_policy = external_state_policy_;
+  SerializationContext serialization_ctx(params);
+  OP_REQUIRES_OK(ctx, iterator_resource->SaveIncremental(
+                          &serialization_ctx, directory, asynchronous_));
+}
+
+void IteratorRestoreIncrementalOp::Compute(OpKernelContext* ctx) {
+  tensorflow::ResourceTagger tag(kTFDataResourceTag,
+                                 ctx->op_kernel().type_string());
+  IteratorResource* iterator_resource;
+  OP_REQUIRES_OK(
+      ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &iterator_resource));
+  core::ScopedUnref unref_iterator(iterator_resource);
+  tstring directory;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "directory", &directory));
+  Status s = iterator_resource->RestoreIncremental(ctx, directory);
+  if (!s.ok()) {
+    OP_REQUIRES_OK(
+        ctx,
+        errors::CreateWithUpdatedMessage(
+            s, absl::StrCat(
+                   "Failed to restore dataset iterator from checkpoint: ",
+                   s.error_message(),
+                   ". Make sure the dataset definition has not changed between "
+                   "the process that saved the checkpoint and the process that "
+                   "is restoring it.")));
+  }
+}
+
 namespace {
 
 REGISTER_KERNEL_BUILDER(Name("Iterator").Device(DEVICE_CPU), IteratorHandleOp);
@@ -1178,6 +1283,10 @@ REGISTER_KERNEL_BUILDER(Name("SerializeIterator").Device(DEVICE_CPU),
                         SerializeIteratorOp);
 REGISTER_KERNEL_BUILDER(Name("DeserializeIterator").Device(DEVICE_CPU),
                         DeserializeIteratorOp);
+REGISTER_KERNEL_BUILDER(Name("IteratorSaveIncremental").Device(DEVICE_CPU),
+                        IteratorSaveIncrementalOp);
+REGISTER_KERNEL_BUILDER(Name("IteratorRestoreIncremental").Device(DEVICE_CPU),
+                        IteratorRestoreIncrementalOp);
 
 }  // namespace
 
@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/incremental_checkpoint.h"
 #include "tensorflow/core/data/metric_utils.h"
 #include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -61,6 +62,23 @@ class IteratorResource : public ResourceBase {
   // Restores the state of the iterator from a checkpoint created by `Save`.
   Status Restore(OpKernelContext* ctx, IteratorStateReader* reader);
 
+  // Saves a checkpoint of the state of the iterator to `directory`, writing
+  // only the tensors that changed since the previous checkpoint of the
+  // directory.
+  //
+  // If `asynchronous` is true, returns once the state has been captured and
+  // writes it in a background thread while iteration continues. An error of
+  // the background write is returned by the next call to `SaveIncremental` or
+  // `RestoreIncremental`.
+  Status SaveIncremental(SerializationContext* ctx,
+                         const std::string& directory, bool asynchronous)
+      TF_LOCKS_EXCLUDED(checkpoint_mu_);
+
+  // Restores the state of the iterator from the latest checkpoint written to
+  // `directory` by `SaveIncremental`.
+  Status RestoreIncremental(OpKernelContext* ctx, const std::string& directory)
+      TF_LOCKS_EXCLUDED(checkpoint_mu_);
+
   // Creates an iterator for `dataset`, and associates the iterator with this
   // iterator resource.
   //
@@ -134,6 +152,10 @@ class IteratorResource : public ResourceBase {
     core::RefCountPtr<DatasetBase> dataset_;
   };
 
+  // Waits for the background write of the last `SaveIncremental` call, if
+  // any, and returns its status.
+  Status WaitForCheckpointLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(checkpoint_mu_);
+
   IteratorMetricsCollector metrics_collector_;
   UnboundedThreadPool unbounded_thread_pool_;
 
@@ -142,6 +164,15 @@ class IteratorResource : public ResourceBase {
   std::shared_ptr<State> iterator_state_ TF_GUARDED_BY(mu_);
   const DataTypeVector output_dtypes_;
   const std::vector<PartialTensorShape> output_shapes_;
+
+  Env* const env_;
+  mutex checkpoint_mu_;
+  std::unique_ptr<IncrementalCheckpointWriter> checkpoint_writer_
+      TF_GUARDED_BY(checkpoint_mu_);
+  // Written by `checkpoint_thread_`, and only read after joining it.
+  Status checkpoint_status_;
+  // Declared last so that it is joined before the state it uses is destroyed.
+  std::unique_ptr<Thread> checkpoint_thread_ TF_GUARDED_BY(checkpoint_mu_);
 };
 
 class IteratorHandleOp : public OpKernel {
@@ -321,6 +352,30 @@ class DeserializeIteratorOp : public OpKernel {
   void Compute(OpKernelContext* ctx) override;
 };
 
+class IteratorSaveIncrementalOp : public OpKernel {
+ public:
+  static constexpr const char* const kAsynchronous = "asynchronous";
+  static constexpr const char* const kExternalStatePolicy =
+      "external_state_policy";
+
+  explicit IteratorSaveIncrementalOp(OpKernelConstruction* ctx);
+
+  void Compute(OpKernelContext* ctx) override;
+
+ private:
+  bool asynchronous_ = false;
+  SerializationContext::ExternalStatePolicy external_state_policy_ =
+      SerializationContext::ExternalStatePolicy::kWarn;
+};
+
+class IteratorRestoreIncrementalOp : public OpKernel {
+ public:
+  explicit IteratorRestoreIncrementalOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override;
+};
+
 }  // namespace data
 }  // namespace tensorflow
 
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 
 #include <cstdint>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/monitoring/test_utils.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/test.h"
@@ -107,6 +109,33 @@ TEST_F(IteratorOpsTest, CollectMetrics) {
   EXPECT_GT(iterator_busy.Delta(), 0.0);
 }
 
+TEST_F(IteratorOpsTest, SaveAndRestoreIncremental) {
+  const std::string directory =
+      io::JoinPath(testing::TmpDir(), "save_and_restore_incremental");
+  RangeDatasetParams dataset_params = RangeDatasetParams(0, 10, 1);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(core::RefCountPtr<IteratorResource> iter_resource,
+                          GetIteratorResource());
+  SerializationContext serialization_ctx(
+      (SerializationContext::Params(dataset_ctx_.get())));
+  for (bool asynchronous : {false, true}) {
+    std::vector<Tensor> tensors;
+    bool end_of_sequence = false;
+    TF_ASSERT_OK(
+        iter_resource->GetNext(dataset_ctx_.get(), &tensors, &end_of_sequence));
+    TF_ASSERT_OK(iter_resource->SaveIncremental(&serialization_ctx, directory,
+                                                asynchronous));
+    const int64_t expected = tensors[0].scalar<int64_t>()() + 1;
+    TF_ASSERT_OK(
+        iter_resource->GetNext(dataset_ctx_.get(), &tensors, &end_of_sequence));
+    TF_ASSERT_OK(iter_resource->RestoreIncremental(dataset_ctx_.get(),
+                                                   directory));
+    TF_ASSERT_OK(
+        iter_resource->GetNext(dataset_ctx_.get(), &tensors, &end_of_sequence));
+    EXPECT_EQ(tensors[0].scalar<int64_t>()(), expected);
+  }
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -231,7 +231,8 @@ class PaddedBatchDatasetOp::Dataset : public DatasetBase {
         return OkStatus();
       }
 
-      TF_RETURN_IF_ERROR(CopyBatch(ctx, batch_elements, out_tensors));
+      TF_RETURN_IF_ERROR(
+          CopyBatch(ctx, std::move(batch_elements), out_tensors));
       *end_of_sequence = false;
       return OkStatus();
     }
@@ -278,7 +279,7 @@ class PaddedBatchDatasetOp::Dataset : public DatasetBase {
     // locations. This would require a different GetNext() overload that
     // supports zero-copy, and might make sense in an optimization pass.
     Status CopyBatch(IteratorContext* ctx,
-                     const std::vector<std::vector<Tensor>>& batch_elements,
+                     std::vector<std::vector<Tensor>>&& batch_elements,
                      std::vector<Tensor>* out_tensors) {
       const size_t num_tuple_components = batch_elements[0].size();
       const int64_t num_batch_elements = batch_elements.size();
@@ -344,14 +345,15 @@ class PaddedBatchDatasetOp::Dataset : public DatasetBase {
         for (int i = 1; i < batch_component_shape.dims(); ++i) {
           component_shape.AddDim(batch_component_shape.dim_size(i));
         }
+        const batch_util::ElementCopier copier(&batch_component);
         auto copy_element_fn = [component_index, &batch_elements,
-                                &batch_component, &component_shape](int index) {
+                                &batch_component, &component_shape,
+                                &copier](int index) {
           // Take the fast path if possible.
           if (batch_elements[index][component_index].shape() ==
               component_shape) {
-            TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
-                batch_elements[index][component_index], &batch_component,
-                index));
+            TF_RETURN_IF_ERROR(copier.CopyElementToSlice(
+                std::move(batch_elements[index][component_index]), index));
           } else {
             TF_RETURN_IF_ERROR(batch_util::CopyElementToLargerSlice(
                 batch_elements[index][component_index], &batch_component,
@@ -409,7 +409,8 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
                     RecordBufferEnqueue(ctx.get(), result->output);
                     return OkStatus();
                   };
-          status = CopyBatch(CopyBatchParams(ctx.get()), *batch_elements,
+          status = CopyBatch(CopyBatchParams(ctx.get()),
+                             std::move(*batch_elements),
                              dataset()->parallel_copy_,
                              std::move(allocation_callback), &result->output);
           result->status.Update(status);
@@ -23,13 +23,17 @@ limitations under the License.
 
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/random_permutation.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
@@ -70,6 +74,9 @@ constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kNumShards[] = "num_shards";
+constexpr char kEndOfEpoch[] = "end_of_epoch";
+constexpr char kGlobalShufflePosition[] = "global_shuffle_position";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
 constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
@@ -138,7 +145,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     return input_->CheckExternalState();
   }
 
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext ctx, int64 index,
              std::vector<Tensor>* out_tensors) const override {
     TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
     {
@@ -200,17 +207,52 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           params.dataset->buffer_size_);
     }
 
+    ~Iterator() override {
+      if (cancellation_manager_) {
+        CancelThreads();
+        std::vector<std::unique_ptr<Thread>> filler_threads;
+        {
+          mutex_lock l(mu_);
+          filler_threads.swap(filler_threads_);
+        }
+        // Joins the filler threads.
+        filler_threads.clear();
+      }
+      if (deregister_fn_) deregister_fn_();
+    }
+
     Status Initialize(IteratorContext* ctx) override {
-      mutex_lock l(mu_);
-      seed_generator_->GenerateSeeds(&seed_, &seed2_);
-      ResetRngs();
-      return OkStatus();
+      const ShuffleOptions shuffle_options =
+          ctx->options() != nullptr ? ctx->options()->shuffle_options()
+                                    : ShuffleOptions();
+      {
+        mutex_lock l(mu_);
+        seed_generator_->GenerateSeeds(&seed_, &seed2_);
+        ResetRngs();
+        if (shuffle_options.global_shuffle()) {
+          return InitializeGlobalShuffle();
+        }
+        if (shuffle_options.num_shards() <= 1 || dataset()->buffer_size_ <= 1) {
+          return OkStatus();
+        }
+        InitializeShards(shuffle_options);
+      }
+      cancellation_manager_ = std::make_unique<CancellationManager>();
+      return RegisterCancellationCallback(
+          ctx->cancellation_manager(), [this]() { CancelThreads(); },
+          &deregister_fn_);
     }
 
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
       mutex_lock l(mu_);
+      if (global_shuffle_) {
+        return GetNextFromPermutation(ctx, out_tensors, end_of_sequence);
+      }
+      if (sharded()) {
+        return GetNextFromShards(ctx, l, out_tensors, end_of_sequence);
+      }
       TF_RETURN_IF_ERROR(FillBuffer(ctx));
       if (num_elements_ == 0) {
         DCHECK(input_impl_ == nullptr);
@@ -253,6 +295,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     Status SaveInternal(SerializationContext* ctx,
                         IteratorStateWriter* writer) override {
       mutex_lock l(mu_);
+      if (sharded()) {
+        PauseFillers(l);
+      }
+      auto cleanup = gtl::MakeCleanup([this]() TF_EXCLUSIVE_LOCKS_REQUIRED(
+                                          mu_) { ResumeFillers(); });
       // Save state needed to restore the random number generators.
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(full_name(kEpochNumRandomSamples),
@@ -261,6 +308,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                                              num_random_samples_));
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed), seed_));
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed2), seed2_));
+      if (global_shuffle_) {
+        return SaveGlobalShuffle(writer);
+      }
 
       // Save input iterator if it hasn't been exhausted else write
       // "end_of_input_sequence".
@@ -275,6 +325,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kEpoch), epoch_));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(this->full_name(kNumElements), num_elements_));
+      if (sharded()) {
+        return SaveShards(writer);
+      }
       TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(writer, prefix(), *buffer_));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(this->full_name(kSlicesSize), slices_.size()));
@@ -298,6 +351,28 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
       mutex_lock l(mu_);
+      if (sharded()) {
+        PauseFillers(l);
+      }
+      auto cleanup = gtl::MakeCleanup([this]() TF_EXCLUSIVE_LOCKS_REQUIRED(
+                                          mu_) { ResumeFillers(); });
+      if (sharded() != reader->Contains(this->full_name(kNumShards))) {
+        return errors::FailedPrecondition(
+            "The shuffle iterator checkpoint was written ",
+            sharded() ? "without" : "with",
+            " a sharded shuffle buffer, but the iterator being restored ",
+            sharded() ? "has" : "does not have",
+            " one. Restore with the same `num_shards` shuffle option.");
+      }
+      if (global_shuffle_ !=
+          reader->Contains(this->full_name(kGlobalShufflePosition))) {
+        return errors::FailedPrecondition(
+            "The shuffle iterator checkpoint was written ",
+            global_shuffle_ ? "without" : "with",
+            " global shuffling, but the iterator being restored ",
+            global_shuffle_ ? "uses" : "does not use",
+            " it. Restore with the same `global_shuffle` shuffle option.");
+      }
       // Restore the random number generators.
       int64_t num_random_samples;
       TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
@@ -309,6 +384,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kSeed), &seed_));
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kSeed2), &seed2_));
       ResetRngs();
+      if (global_shuffle_) {
+        return RestoreGlobalShuffle(reader);
+      }
 
       // Restore the input iterator if it wasn't already exhausted.
       if (!reader->Contains(this->full_name(kEndOfInputSequence))) {
@@ -323,6 +401,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kEpoch), &epoch_));
       TF_RETURN_IF_ERROR(
           reader->ReadScalar(this->full_name(kNumElements), &num_elements_));
+      if (sharded()) {
+        return RestoreShards(ctx, reader);
+      }
       size_t slices_size;
       {
         int64_t temp;
@@ -475,10 +556,351 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
     }
 
+    // Prepares the global mode, in which the input is not buffered but read
+    // by index, in the order of a pseudorandom permutation of the indices of
+    // each epoch. This requires the input to support random access.
+    Status InitializeGlobalShuffle() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      CardinalityOptions options;
+      options.set_compute_level(
+          CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+      const int64_t cardinality = dataset()->input_->Cardinality(options);
+      if (cardinality == kInfiniteCardinality ||
+          cardinality == kUnknownCardinality) {
+        return errors::FailedPrecondition(
+            "Global shuffling requires an input with a known, finite "
+            "cardinality, but the input of ",
+            dataset()->DebugString(), " has ",
+            cardinality == kInfiniteCardinality ? "infinite" : "unknown",
+            " cardinality.");
+      }
+      // The global mode does not use the ring buffer of the default mode.
+      buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
+      global_shuffle_ = true;
+      input_cardinality_ = cardinality;
+      VLOG(1) << "Globally shuffling " << cardinality << " elements";
+      return OkStatus();
+    }
+
+    Status GetNextFromPermutation(IteratorContext* ctx,
+                                  std::vector<Tensor>* out_tensors,
+                                  bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (permutation_ == nullptr || position_ == permutation_->size()) {
+        if (input_cardinality_ == 0 ||
+            (dataset()->count_ != -1 && epoch_ >= dataset()->count_)) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        if (epoch_ > 0) {
+          // Reinitialize the RNG state for the next epoch.
+          num_random_samples_ = 0;
+          seed_generator_->GenerateSeeds(&seed_, &seed2_);
+          ResetRngs();
+        }
+        permutation_ = std::make_unique<RandomPermutation>(input_cardinality_,
+                                                           seed_, seed2_);
+        position_ = 0;
+        epoch_++;
+      }
+      Status s = dataset()->input_->Get(
+          AnyContext(ctx), permutation_->Map(position_), out_tensors);
+      if (errors::IsUnimplemented(s)) {
+        return errors::FailedPrecondition(
+            "Global shuffling requires an input that supports random access: ",
+            s.error_message());
+      }
+      TF_RETURN_IF_ERROR(s);
+      position_++;
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+    Status SaveGlobalShuffle(IteratorStateWriter* writer)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kEpoch), epoch_));
+      return writer->WriteScalar(this->full_name(kGlobalShufflePosition),
+                                 position_);
+    }
+
+    Status RestoreGlobalShuffle(IteratorStateReader* reader)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kEpoch), &epoch_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          this->full_name(kGlobalShufflePosition), &position_));
+      // The permutation of the current epoch is determined by the seeds.
+      permutation_.reset();
+      if (epoch_ > 0) {
+        if (position_ < 0 || position_ > input_cardinality_) {
+          return errors::FailedPrecondition(
+              "The shuffle iterator checkpoint is at position ", position_,
+              " of an epoch, but the input has ", input_cardinality_,
+              " elements.");
+        }
+        permutation_ = std::make_unique<RandomPermutation>(input_cardinality_,
+                                                           seed_, seed2_);
+      }
+      return OkStatus();
+    }
+
     std::string BufferSizeString() {
       return absl::StrCat(dataset()->buffer_size_);
     }
 
+    // Whether the buffer is split into shards which are filled in parallel by
+    // `filler_threads_`.
+    //
+    // In that mode, each shard has a dedicated filler thread that reads from
+    // the shared `input_impl_`, so upstream reads are interleaved across the
+    // shards. An element is sampled uniformly from the union of the shards,
+    // i.e. a shard is picked with probability proportional to its size. Epochs
+    // are not mixed in the buffer: the next epoch starts filling once the
+    // buffer is drained.
+    bool sharded() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !shards_.empty();
+    }
+
+    void InitializeShards(const ShuffleOptions& shuffle_options)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      // The sharded buffer does not use the ring buffer of the default mode.
+      buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
+      shards_.resize(std::min<int64_t>(shuffle_options.num_shards(),
+                                       dataset()->buffer_size_));
+      warm_start_ = shuffle_options.warm_start();
+      VLOG(1) << "Using a shuffle buffer of size " << BufferSizeString()
+              << " split into " << shards_.size() << " shards";
+    }
+
+    // Returns the number of elements shard `shard_index` can hold. The shard
+    // capacities add up to the buffer size.
+    int64_t ShardCapacity(int64_t shard_index) const
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64_t num_shards = shards_.size();
+      return dataset()->buffer_size_ / num_shards +
+             (shard_index < dataset()->buffer_size_ % num_shards ? 1 : 0);
+    }
+
+    // Whether the input of the current epoch has been fully read into the
+    // buffer.
+    bool EpochExhausted() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return (!input_impl_ || end_of_epoch_) && num_fills_in_flight_ == 0;
+    }
+
+    bool ShouldFillShard(int64_t shard_index) const
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return input_impl_ && !end_of_epoch_ && !fillers_paused_ &&
+             fill_status_.ok() &&
+             shards_[shard_index].size() < ShardCapacity(shard_index);
+    }
+
+    void EnsureFillerThreadsStarted(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!filler_threads_.empty()) {
+        return;
+      }
+      IteratorContext::Params params(ctx);
+      params.cancellation_manager = cancellation_manager_.get();
+      auto ctx_copy = std::make_shared<IteratorContext>(params);
+      for (int64_t i = 0; i < shards_.size(); ++i) {
+        filler_threads_.push_back(ctx->StartThread(
+            "tf_data_shuffle_filler",
+            std::bind(&Iterator::FillerThread, this, ctx_copy, i)));
+      }
+    }
+
+    void FillerThread(const std::shared_ptr<IteratorContext>& ctx,
+                      int64_t shard_index) TF_LOCKS_EXCLUDED(mu_) {
+      RecordStart(ctx.get());
+      auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
+      while (true) {
+        IteratorBase* input;
+        {
+          mutex_lock l(mu_);
+          while (!cancelled_ && !ShouldFillShard(shard_index)) {
+            RecordStop(ctx.get());
+            cond_var_.wait(l);
+            RecordStart(ctx.get());
+          }
+          if (cancelled_) {
+            return;
+          }
+          input = input_impl_.get();
+          num_fills_in_flight_++;
+        }
+        std::vector<Tensor> element;
+        bool end_of_input = false;
+        Status s = input->GetNext(ctx.get(), &element, &end_of_input);
+        mutex_lock l(mu_);
+        num_fills_in_flight_--;
+        if (!s.ok()) {
+          fill_status_.Update(s);
+        } else if (end_of_input) {
+          end_of_epoch_ = true;
+        } else {
+          data_produced_ = true;
+          RecordBufferEnqueue(ctx.get(), element);
+          shards_[shard_index].push_back(std::move(element));
+          num_elements_++;
+        }
+        cond_var_.notify_all();
+      }
+    }
+
+    Status GetNextFromShards(IteratorContext* ctx, mutex_lock& l,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      EnsureFillerThreadsStarted(ctx);
+      while (true) {
+        if (!fill_status_.ok()) {
+          // Report the error once and let the fillers continue, like the
+          // default mode does for errors of its input.
+          Status s = fill_status_;
+          fill_status_ = OkStatus();
+          cond_var_.notify_all();
+          return s;
+        }
+        if (num_elements_ > 0 &&
+            (warm_start_ || num_elements_ >= dataset()->buffer_size_ ||
+             EpochExhausted())) {
+          break;
+        }
+        if (EpochExhausted()) {
+          bool end_of_input = false;
+          TF_RETURN_IF_ERROR(PrepareNextShardedEpoch(ctx, &end_of_input));
+          if (end_of_input) {
+            *end_of_sequence = true;
+            return OkStatus();
+          }
+          cond_var_.notify_all();
+          continue;
+        }
+        RecordStop(ctx);
+        cond_var_.wait(l);
+        RecordStart(ctx);
+      }
+      int64_t index = Random() % num_elements_;
+      int64_t shard_index = 0;
+      while (index >= shards_[shard_index].size()) {
+        index -= shards_[shard_index].size();
+        shard_index++;
+      }
+      auto& shard = shards_[shard_index];
+      *out_tensors = std::move(shard[index]);
+      RecordBufferDequeue(ctx, *out_tensors);
+      if (index != shard.size() - 1) {
+        shard[index] = std::move(shard.back());
+      }
+      shard.pop_back();
+      num_elements_--;
+      *end_of_sequence = false;
+      // Wakes up the filler of the shard.
+      cond_var_.notify_all();
+      return OkStatus();
+    }
+
+    // Starts reading the next epoch of the input into the buffer, or sets
+    // `end_of_input` if there are no more epochs to read.
+    Status PrepareNextShardedEpoch(IteratorContext* ctx, bool* end_of_input)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      input_impl_.reset();
+      if (dataset()->count_ != -1 && epoch_ >= dataset()->count_) {
+        *end_of_input = true;
+        return OkStatus();
+      }
+      if (epoch_ > 0) {
+        if (ctx->split_providers().empty() && !data_produced_ &&
+            dataset()->count_ == -1) {
+          // See the corresponding comment in `FillBuffer`.
+          *end_of_input = true;
+          return OkStatus();
+        }
+        for (const auto& provider : ctx->split_providers()) {
+          TF_RETURN_IF_ERROR(provider->Reset());
+        }
+        // Reinitialize the RNG state for the next epoch.
+        num_random_samples_ = 0;
+        seed_generator_->GenerateSeeds(&seed_, &seed2_);
+        ResetRngs();
+      }
+      TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+          ctx, this, this->prefix(), &input_impl_));
+      epoch_++;
+      end_of_epoch_ = false;
+      return OkStatus();
+    }
+
+    // Stops the fillers from reading further input and waits for in-progress
+    // reads to finish, so that the buffer and the input can be checkpointed
+    // consistently.
+    void PauseFillers(mutex_lock& l) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      fillers_paused_ = true;
+      while (num_fills_in_flight_ > 0) {
+        cond_var_.wait(l);
+      }
+    }
+
+    void ResumeFillers() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (fillers_paused_) {
+        fillers_paused_ = false;
+        cond_var_.notify_all();
+      }
+    }
+
+    Status SaveShards(IteratorStateWriter* writer)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(this->full_name(kNumShards), shards_.size()));
+      std::vector<std::vector<Tensor>> elements;
+      elements.reserve(num_elements_);
+      for (const auto& shard : shards_) {
+        elements.insert(elements.end(), shard.begin(), shard.end());
+      }
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(writer, prefix(), elements));
+      if (end_of_epoch_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kEndOfEpoch), ""));
+      }
+      if (data_produced_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kDataProduced), ""));
+      }
+      return OkStatus();
+    }
+
+    Status RestoreShards(IteratorContext* ctx, IteratorStateReader* reader)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::vector<std::vector<Tensor>> elements;
+      TF_RETURN_IF_ERROR(
+          ReadElementsFromCheckpoint(ctx, reader, prefix(), &elements));
+      if (elements.size() > dataset()->buffer_size_) {
+        return errors::FailedPrecondition(
+            "The shuffle iterator checkpoint has ", elements.size(),
+            " buffered elements, which exceeds the buffer size of ",
+            BufferSizeString());
+      }
+      // Distributing the elements round-robin keeps every shard within its
+      // capacity, regardless of the number of shards at checkpoint time.
+      for (auto& shard : shards_) {
+        shard.clear();
+      }
+      for (int64_t i = 0; i < elements.size(); ++i) {
+        RecordBufferEnqueue(ctx, elements[i]);
+        shards_[i % shards_.size()].push_back(std::move(elements[i]));
+      }
+      num_elements_ = elements.size();
+      end_of_epoch_ = reader->Contains(this->full_name(kEndOfEpoch));
+      data_produced_ = reader->Contains(this->full_name(kDataProduced));
+      fill_status_ = OkStatus();
+      return OkStatus();
+    }
+
+    void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
+      cancellation_manager_->StartCancel();
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+    }
+
     mutex mu_;
     SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
     std::unique_ptr<std::vector<std::vector<Tensor>>> buffer_
@@ -498,6 +920,35 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_GUARDED_BY(mu_);
     int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
+
+    // State of the sharded mode, see `sharded()`. `num_elements_` counts the
+    // elements of all shards.
+    std::vector<std::vector<std::vector<Tensor>>> shards_ TF_GUARDED_BY(mu_);
+    bool warm_start_ TF_GUARDED_BY(mu_) = false;
+    // Number of `GetNext` calls on `input_impl_` in progress.
+    int64_t num_fills_in_flight_ TF_GUARDED_BY(mu_) = 0;
+    // Whether `input_impl_` reached the end of the current epoch.
+    bool end_of_epoch_ TF_GUARDED_BY(mu_) = false;
+    bool fillers_paused_ TF_GUARDED_BY(mu_) = false;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    // The first error encountered by the fillers, reported by the next
+    // `GetNext` call.
+    Status fill_status_ TF_GUARDED_BY(mu_);
+    // Notified when the buffer, `num_fills_in_flight_` or the fill status
+    // change, and when the fillers are resumed or cancelled.
+    condition_variable cond_var_;
+    // Cancels the input reads of the fillers when the iterator is cancelled.
+    std::unique_ptr<CancellationManager> cancellation_manager_;
+    std::function<void()> deregister_fn_;
+    std::vector<std::unique_ptr<Thread>> filler_threads_ TF_GUARDED_BY(mu_);
+
+    // State of the global mode, see `InitializeGlobalShuffle()`.
+    bool global_shuffle_ TF_GUARDED_BY(mu_) = false;
+    int64_t input_cardinality_ TF_GUARDED_BY(mu_) = 0;
+    // The permutation of the current epoch, or nullptr before the first one.
+    std::unique_ptr<RandomPermutation> permutation_ TF_GUARDED_BY(mu_);
+    // The position in `permutation_` of the next element to produce.
+    int64_t position_ TF_GUARDED_BY(mu_) = 0;
   };
 
   const DatasetBase* const input_;
@@ -565,6 +565,219 @@ TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   }
 }
 
+// Returns the parameters of a shuffle of `range(num_elements)` repeated
+// `count` times.
+ShuffleDatasetParams ShardedShuffleDatasetParams(
+    int64_t num_elements, int64_t buffer_size, int64_t count,
+    bool reshuffle_each_iteration = true) {
+  return ShuffleDatasetParams(RangeDatasetParams(0, num_elements, 1),
+                              buffer_size,
+                              /*seed=*/1,
+                              /*seed2=*/2, count, reshuffle_each_iteration,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleAndRepeatNodeName);
+}
+
+class ShuffleOptionsDatasetOpTest : public ShuffleDatasetOpTest {
+ protected:
+  // Creates an iterator context that enables the sharded shuffle buffer.
+  void CreateShardedIteratorContext(int32_t num_shards, bool warm_start) {
+    options_.mutable_shuffle_options()->set_num_shards(num_shards);
+    options_.mutable_shuffle_options()->set_warm_start(warm_start);
+    IteratorContext::Params params(iterator_ctx_.get());
+    params.options = &options_;
+    shuffle_ctx_ = std::make_unique<IteratorContext>(params);
+  }
+
+  // Creates an iterator context that enables global shuffling.
+  void CreateGlobalShuffleIteratorContext() {
+    options_.mutable_shuffle_options()->set_global_shuffle(true);
+    IteratorContext::Params params(iterator_ctx_.get());
+    params.options = &options_;
+    shuffle_ctx_ = std::make_unique<IteratorContext>(params);
+  }
+
+  Status GetNext(int64_t num_elements, std::vector<Tensor>* out_tensors) {
+    bool end_of_sequence = false;
+    while (!end_of_sequence && out_tensors->size() < num_elements) {
+      std::vector<Tensor> next;
+      TF_RETURN_IF_ERROR(
+          iterator_->GetNext(shuffle_ctx_.get(), &next, &end_of_sequence));
+      out_tensors->insert(out_tensors->end(), next.begin(), next.end());
+    }
+    return OkStatus();
+  }
+
+  Options options_;
+  std::unique_ptr<IteratorContext> shuffle_ctx_;
+};
+
+TEST_F(ShuffleOptionsDatasetOpTest, ShardedGetNext) {
+  auto dataset_params = ShardedShuffleDatasetParams(
+      /*num_elements=*/100, /*buffer_size=*/10, /*count=*/2);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CreateShardedIteratorContext(/*num_shards=*/3, /*warm_start=*/false);
+  TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &out_tensors));
+  ASSERT_EQ(out_tensors.size(), 200);
+
+  // Elements of different epochs are not mixed.
+  std::vector<Tensor> expected_epoch;
+  for (int64_t i = 0; i < 100; ++i) {
+    expected_epoch.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      std::vector<Tensor>(out_tensors.begin(), out_tensors.begin() + 100),
+      expected_epoch, /*compare_order=*/false));
+  TF_EXPECT_OK(ExpectEqual(
+      std::vector<Tensor>(out_tensors.begin() + 100, out_tensors.end()),
+      expected_epoch, /*compare_order=*/false));
+}
+
+TEST_F(ShuffleOptionsDatasetOpTest, ShardedWarmStart) {
+  // The buffer is larger than the input, so without a warm start the first
+  // element is only produced once the whole input has been read.
+  auto dataset_params = ShardedShuffleDatasetParams(
+      /*num_elements=*/20, /*buffer_size=*/1000, /*count=*/1);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CreateShardedIteratorContext(/*num_shards=*/4, /*warm_start=*/true);
+  TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &out_tensors));
+  std::vector<Tensor> expected;
+  for (int64_t i = 0; i < 20; ++i) {
+    expected.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected, /*compare_order=*/false));
+}
+
+TEST_F(ShuffleOptionsDatasetOpTest, ShardedSaveAndRestore) {
+  auto dataset_params = ShardedShuffleDatasetParams(
+      /*num_elements=*/30, /*buffer_size=*/8, /*count=*/1);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CreateShardedIteratorContext(/*num_shards=*/3, /*warm_start=*/false);
+  TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetNext(/*num_elements=*/10, &out_tensors));
+
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+
+  // A sharded checkpoint cannot be restored without sharding.
+  std::unique_ptr<IteratorBase> unsharded_iterator;
+  VariantTensorDataReader unsharded_reader(data);
+  EXPECT_TRUE(errors::IsFailedPrecondition(RestoreIterator(
+      iterator_ctx_.get(), &unsharded_reader, dataset_params.iterator_prefix(),
+      *dataset_, &unsharded_iterator)));
+
+  // The restored iterator may use a different number of shards.
+  CreateShardedIteratorContext(/*num_shards=*/2, /*warm_start=*/false);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(shuffle_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &out_tensors));
+  std::vector<Tensor> expected;
+  for (int64_t i = 0; i < 30; ++i) {
+    expected.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected, /*compare_order=*/false));
+}
+
+TEST_F(ShuffleOptionsDatasetOpTest, GlobalShuffleGetNext) {
+  // The buffer is much smaller than the input, but every epoch is shuffled as
+  // a whole.
+  auto dataset_params = ShardedShuffleDatasetParams(
+      /*num_elements=*/100, /*buffer_size=*/2, /*count=*/2);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CreateGlobalShuffleIteratorContext();
+  TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &out_tensors));
+  ASSERT_EQ(out_tensors.size(), 200);
+
+  std::vector<Tensor> expected_epoch;
+  for (int64_t i = 0; i < 100; ++i) {
+    expected_epoch.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  std::vector<Tensor> first_epoch(out_tensors.begin(),
+                                  out_tensors.begin() + 100);
+  std::vector<Tensor> second_epoch(out_tensors.begin() + 100,
+                                   out_tensors.end());
+  TF_EXPECT_OK(
+      ExpectEqual(first_epoch, expected_epoch, /*compare_order=*/false));
+  TF_EXPECT_OK(
+      ExpectEqual(second_epoch, expected_epoch, /*compare_order=*/false));
+  // The epochs are shuffled, and differently.
+  EXPECT_FALSE(ExpectEqual(first_epoch, expected_epoch,
+                           /*compare_order=*/true)
+                   .ok());
+  EXPECT_FALSE(ExpectEqual(first_epoch, second_epoch, /*compare_order=*/true)
+                   .ok());
+}
+
+TEST_F(ShuffleOptionsDatasetOpTest, GlobalShuffleSaveAndRestore) {
+  // Every iterator uses the same seeds, so that they produce the same
+  // elements.
+  auto dataset_params = ShardedShuffleDatasetParams(
+      /*num_elements=*/30, /*buffer_size=*/8, /*count=*/2,
+      /*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CreateGlobalShuffleIteratorContext();
+  TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> expected;
+  TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &expected));
+  ASSERT_EQ(expected.size(), 60);
+
+  for (int num_elements_before_save : {0, 10, 30, 45, 60}) {
+    TF_ASSERT_OK(dataset_->MakeIterator(shuffle_ctx_.get(),
+                                        /*parent=*/nullptr,
+                                        dataset_params.iterator_prefix(),
+                                        &iterator_));
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(GetNext(num_elements_before_save, &out_tensors));
+
+    std::unique_ptr<SerializationContext> serialization_ctx;
+    TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+    VariantTensorDataWriter writer;
+    TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+
+    // A checkpoint of global shuffling cannot be restored without it.
+    std::unique_ptr<IteratorBase> buffered_iterator;
+    VariantTensorDataReader buffered_reader(data);
+    EXPECT_TRUE(errors::IsFailedPrecondition(
+        RestoreIterator(iterator_ctx_.get(), &buffered_reader,
+                        dataset_params.iterator_prefix(), *dataset_,
+                        &buffered_iterator)));
+
+    // The restored iterator continues with the same permutations.
+    VariantTensorDataReader reader(data);
+    TF_ASSERT_OK(RestoreIterator(shuffle_ctx_.get(), &reader,
+                                 dataset_params.iterator_prefix(), *dataset_,
+                                 &iterator_));
+    TF_ASSERT_OK(GetNext(/*num_elements=*/1000, &out_tensors));
+    TF_EXPECT_OK(ExpectEqual(out_tensors, expected, /*compare_order=*/true));
+  }
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
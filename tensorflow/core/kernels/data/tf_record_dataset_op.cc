@@ -14,7 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/read_ahead_file.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -25,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
 namespace data {
@@ -36,13 +39,19 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kFileNames;
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
+/* static */ constexpr const char* const TFRecordDatasetOp::kNumInflateThreads;
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
 constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
+constexpr char kMmapTFRecordReaderExperiment[] = "mmap_tfrecord_reader";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+// Bounds on the number of records, and their total size, read from the file
+// at once by the iterator.
+constexpr int kReadBatchMaxRecords = 64;
+constexpr int64_t kReadBatchMaxBytes = 256 << 10;  // 256KB.
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -52,18 +61,53 @@ bool is_cloud_tpu_gcs_fs() {
   return false;
 }
 
+// Returns true if `filename` refers to the local file system.
+bool IsLocalFile(const string& filename) {
+  StringPiece scheme, host, path;
+  io::ParseURI(filename, &scheme, &host, &path);
+  return scheme.empty() || scheme == "file";
+}
+
+// A scalar string buffer whose value is a view into a memory-mapped region.
+// The buffer keeps the region alive, so that record tensors remain valid after
+// the iterator has moved on to the next file.
+class MappedRecordBuffer : public TensorBuffer {
+ public:
+  MappedRecordBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     StringPiece record)
+      : TensorBuffer(&value_), region_(std::move(region)) {
+    value_.assign_as_view(record.data(), record.size());
+  }
+
+  size_t size() const override { return sizeof(tstring); }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size());
+    proto->set_allocator_name("MappedRecordBuffer");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  tstring value_;
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+};
+
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64_t buffer_size)
+                   const string& compression_type, int64_t buffer_size,
+                   int32_t num_inflate_threads, bool use_mmap)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
-            compression_type)) {
+            compression_type)),
+        use_mmap_(use_mmap &&
+                  options_.compression_type == io::RecordReaderOptions::NONE) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    options_.zlib_options.num_inflate_threads = num_inflate_threads;
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -103,8 +147,12 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+    AttrValue num_inflate_threads;
+    b->BuildAttrValue(options_.zlib_options.num_inflate_threads,
+                      &num_inflate_threads);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {filenames, compression_type, buffer_size},
+                      {{kNumInflateThreads, num_inflate_threads}}, output));
     return OkStatus();
   }
 
@@ -120,21 +168,49 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       out_tensors->reserve(1);
       mutex_lock l(mu_);
       do {
-        // We are currently processing a file, so try to read the next record.
+        // We are currently processing a memory-mapped file, so try to read
+        // the next record without copying it.
+        if (mapped_reader_) {
+          StringPiece record;
+          Status s = mapped_reader_->ReadRecord(&mapped_offset_, &record);
+          if (s.ok()) {
+            auto* buffer = new MappedRecordBuffer(region_, record);
+            out_tensors->emplace_back(DT_STRING, TensorShape({}), buffer);
+            buffer->Unref();
+            static monitoring::CounterCell* bytes_counter =
+                metrics::GetTFDataBytesReadCounter(kDatasetType);
+            bytes_counter->IncrementBy(record.size());
+            *end_of_sequence = false;
+            return OkStatus();
+          }
+          ResetStreamsLocked();
+          ++current_file_index_;
+          if (!errors::IsOutOfRange(s)) {
+            return s;
+          }
+        }
+
+        // We are currently processing a file, so try to read the next record,
+        // refilling the record buffer with a batch of records if needed.
         if (reader_) {
-          out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
-                                    TensorShape({}));
-          Status s =
-              reader_->ReadRecord(&out_tensors->back().scalar<tstring>()());
+          Status s = OkStatus();
+          if (next_record_ == records_.size()) {
+            records_.clear();
+            next_record_ = 0;
+            s = reader_->ReadRecords(kReadBatchMaxRecords, kReadBatchMaxBytes,
+                                     &records_);
+          }
           if (s.ok()) {
+            out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
+                                      TensorShape({}));
+            tstring& record = out_tensors->back().scalar<tstring>()();
+            record = std::move(records_[next_record_++]);
             static monitoring::CounterCell* bytes_counter =
                 metrics::GetTFDataBytesReadCounter(kDatasetType);
-            bytes_counter->IncrementBy(
-                out_tensors->back().scalar<tstring>()().size());
+            bytes_counter->IncrementBy(record.size());
             *end_of_sequence = false;
             return OkStatus();
           }
-          out_tensors->pop_back();
           if (!errors::IsOutOfRange(s)) {
             // In case of other errors e.g., DataLoss, we still move forward
             // the file index so that it works with ignore_errors.
@@ -165,9 +241,34 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       *num_skipped = 0;
       mutex_lock l(mu_);
       do {
+        if (mapped_reader_) {
+          int last_num_skipped;
+          Status s = mapped_reader_->SkipRecords(
+              &mapped_offset_, num_to_skip - *num_skipped, &last_num_skipped);
+          *num_skipped += last_num_skipped;
+          if (s.ok()) {
+            *end_of_sequence = false;
+            return OkStatus();
+          }
+          ResetStreamsLocked();
+          ++current_file_index_;
+          if (!errors::IsOutOfRange(s)) {
+            return s;
+          }
+        }
+
         // We are currently processing a file, so try to skip reading
-        // the next (num_to_skip - *num_skipped) record.
+        // the next (num_to_skip - *num_skipped) record, starting with the
+        // records that have already been read.
         if (reader_) {
+          while (next_record_ < records_.size() && *num_skipped < num_to_skip) {
+            ++next_record_;
+            ++*num_skipped;
+          }
+          if (*num_skipped == num_to_skip) {
+            *end_of_sequence = false;
+            return OkStatus();
+          }
           int last_num_skipped;
           Status s = reader_->SkipRecords(num_to_skip - *num_skipped,
                                           &last_num_skipped);
@@ -213,9 +314,19 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCurrentFileIndex),
                                              current_file_index_));
 
-      if (reader_) {
-        TF_RETURN_IF_ERROR(
-            writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
+      if (mapped_reader_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(kOffset), static_cast<int64_t>(mapped_offset_)));
+      } else if (reader_) {
+        // Records that have been read from the file but not yet produced are
+        // re-read after restoring.
+        uint64 offset = reader_->TellOffset();
+        for (size_t i = next_record_; i < records_.size(); ++i) {
+          offset -= io::RecordReader::kHeaderSize + records_[i].size() +
+                    io::RecordReader::kFooterSize;
+        }
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kOffset),
+                                               static_cast<int64_t>(offset)));
       }
       return OkStatus();
     }
@@ -232,7 +343,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
         int64_t offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        if (mapped_reader_) {
+          mapped_offset_ = offset;
+        } else {
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
       }
       return OkStatus();
     }
@@ -247,9 +362,25 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       }
 
       // Actually move on to next file.
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-          TranslateFileName(dataset()->filenames_[current_file_index_]),
-          &file_));
+      const string filename =
+          TranslateFileName(dataset()->filenames_[current_file_index_]);
+      if (dataset()->use_mmap_ && IsLocalFile(filename)) {
+        std::unique_ptr<ReadOnlyMemoryRegion> region;
+        Status s = env->NewReadOnlyMemoryRegionFromFile(filename, &region);
+        if (s.ok()) {
+          region_ = std::move(region);
+          mapped_reader_ = std::make_unique<io::InMemoryRecordReader>(
+              StringPiece(static_cast<const char*>(region_->data()),
+                          region_->length()));
+          mapped_offset_ = 0;
+          return OkStatus();
+        }
+        // Memory-mapping is not supported for all files (e.g. empty files),
+        // in which case we fall back to regular reads.
+        VLOG(2) << "Failed to memory-map " << filename << ": " << s;
+      }
+      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
+      file_ = MaybeReadAhead(std::move(file_), dataset()->options_.buffer_size);
       reader_ = std::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
       return OkStatus();
@@ -259,6 +390,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
       file_.reset();
+      records_.clear();
+      next_record_ = 0;
+      mapped_reader_.reset();
+      region_.reset();
+      mapped_offset_ = 0;
     }
 
     mutex mu_;
@@ -268,15 +404,32 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+    // Records read from `reader_` in the last batch, of which the first
+    // `next_record_` have already been produced.
+    std::vector<tstring> records_ TF_GUARDED_BY(mu_);
+    size_t next_record_ TF_GUARDED_BY(mu_) = 0;
+
+    // Set instead of `file_` and `reader_` when the current file is
+    // memory-mapped. `region_` is shared with the buffers of all the record
+    // tensors produced from it.
+    std::shared_ptr<ReadOnlyMemoryRegion> region_ TF_GUARDED_BY(mu_);
+    std::unique_ptr<io::InMemoryRecordReader> mapped_reader_
+        TF_GUARDED_BY(mu_);
+    uint64 mapped_offset_ TF_GUARDED_BY(mu_) = 0;
   };
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
+  // Whether local, uncompressed files are memory-mapped and read without
+  // copying the records.
+  const bool use_mmap_;
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
-    : DatasetOpKernel(ctx) {}
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kNumInflateThreads, &num_inflate_threads_));
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -324,8 +477,9 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
     buffer_size = kS3BlockSize;
   }
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  bool use_mmap = GetExperiments().contains(kMmapTFRecordReaderExperiment);
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, num_inflate_threads_, use_mmap);
 }
 
 namespace {
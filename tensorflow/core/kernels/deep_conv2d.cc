@@ -432,11 +432,13 @@ struct TransformFilters {
     // Allocate buffer for filter transform matrix:
     //   [tile_spatial_size, base_filter_spatial_size]
     Tensor filter_transform_matrix;
+    AllocationAttributes step_local;
+    step_local.step_local = true;
     OP_REQUIRES_OK(
         ctx, ctx->allocate_temp(
                  DataTypeToEnum<T>::value,
                  TensorShape({tile_spatial_size, base_filter_spatial_size}),
-                 &filter_transform_matrix));
+                 &filter_transform_matrix, AllocatorAttributes(), step_local));
     T* transform_matrix = filter_transform_matrix.template flat<T>().data();
     transform->GetFilterTransformMatrix(
         tile_spatial_size, base_filter_spatial_size, transform_matrix);
@@ -975,14 +977,17 @@ struct DeepConv2D<CPUDevice, T> {
         std::max(int64_t{0}, args.filter_cols - base_filter_rows);
     const int64_t filter_shards_col = 1 + (filter_residual_col + 2 - 1) / 2;
 
-    // Allocate buffer for transformed filters.
+    // Allocate buffer for transformed filters. This and the transform matrices
+    // below are released before Compute() returns.
+    AllocationAttributes step_local;
+    step_local.step_local = true;
     Tensor filter_transform;
     OP_REQUIRES_OK(
         ctx, ctx->allocate_temp(
                  DataTypeToEnum<T>::value,
                  TensorShape({tile_rows, tile_cols, out_depth,
                               filter_shards_row, filter_shards_col, in_depth}),
-                 &filter_transform));
+                 &filter_transform, AllocatorAttributes(), step_local));
     T* filter_transform_data = filter_transform.template flat<T>().data();
 
     // Transform filters.
@@ -999,7 +1004,8 @@ struct DeepConv2D<CPUDevice, T> {
     OP_REQUIRES_OK(ctx, ctx->allocate_temp(
                             DataTypeToEnum<T>::value,
                             TensorShape({tile_spatial_size, tile_spatial_size}),
-                            &tile_transform_matrix_tensor));
+                            &tile_transform_matrix_tensor,
+                            AllocatorAttributes(), step_local));
     T* tile_transform_matrix =
         tile_transform_matrix_tensor.template flat<T>().data();
     transform->GetInputTransformMatrix(tile_spatial_size, tile_spatial_size,
@@ -1010,7 +1016,8 @@ struct DeepConv2D<CPUDevice, T> {
     OP_REQUIRES_OK(ctx, ctx->allocate_temp(DataTypeToEnum<T>::value,
                                            TensorShape({out_tile_spatial_size,
                                                         tile_spatial_size}),
-                                           &output_transform_matrix_tensor));
+                                           &output_transform_matrix_tensor,
+                                           AllocatorAttributes(), step_local));
     T* output_transform_matrix =
         output_transform_matrix_tensor.template flat<T>().data();
     transform->GetOutputTransformMatrix(
@@ -0,0 +1,287 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements a MatMul in 8-bit integer arithmetic for float inputs, quantizing
+// the constant weights once and the activations on every call.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_join.h"
+#include "ruy/context.h"  // from @ruy
+#include "ruy/matrix.h"  // from @ruy
+#include "ruy/mul_params.h"  // from @ruy
+#include "ruy/ruy.h"  // from @ruy
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+// Values are quantized to the symmetric range [-127, 127], so that the int8
+// products need no zero-point correction.
+constexpr float kQuantizedMax = 127.0f;
+
+// Quantizes `size` values, read `stride` apart starting at `in`, with one
+// symmetric scale, and returns the scale. A non-finite value makes the scale
+// NaN, so that it propagates to every product it takes part in.
+float QuantizeSymmetric(const float* in, int64_t size, int64_t stride,
+                        int8* out) {
+  float max_abs = 0.0f;
+  bool all_finite = true;
+  for (int64_t i = 0; i < size; ++i) {
+    const float value = in[i * stride];
+    all_finite &= std::isfinite(value);
+    max_abs = std::max(max_abs, std::abs(value));
+  }
+  if (!all_finite || max_abs == 0.0f) {
+    std::fill_n(out, size, 0);
+    return all_finite ? 0.0f : std::numeric_limits<float>::quiet_NaN();
+  }
+  const float scale = max_abs / kQuantizedMax;
+  const float inverse_scale = kQuantizedMax / max_abs;
+  for (int64_t i = 0; i < size; ++i) {
+    out[i] = static_cast<int8>(std::round(in[i * stride] * inverse_scale));
+  }
+  return scale;
+}
+
+// The weights of a _DynamicQuantizedMatMul, quantized per output column.
+struct QuantizedWeights {
+  // The weights the quantization was computed from. Holding on to them keeps
+  // their buffer from being reused for different values.
+  Tensor source;
+  // [n, k] quantized values: the k weights of each output column are
+  // contiguous, i.e. a column-major right-hand side.
+  std::vector<int8> values;
+  // [n] scales.
+  std::vector<float> scales;
+
+  // Returns a ruy context that no other call is using. ruy caches the packed
+  // form of `values` in each context, keyed by its address, so the weights
+  // are packed once per context rather than on every call. The contexts are
+  // owned by these weights so that the cache never outlives `values`.
+  std::unique_ptr<ruy::Context> AcquireContext(int num_threads)
+      TF_LOCKS_EXCLUDED(mu) {
+    {
+      mutex_lock l(mu);
+      if (!free_contexts.empty()) {
+        std::unique_ptr<ruy::Context> context = std::move(free_contexts.back());
+        free_contexts.pop_back();
+        return context;
+      }
+    }
+    auto context = std::make_unique<ruy::Context>();
+    context->set_max_num_threads(num_threads);
+    return context;
+  }
+
+  void ReleaseContext(std::unique_ptr<ruy::Context> context)
+      TF_LOCKS_EXCLUDED(mu) {
+    mutex_lock l(mu);
+    free_contexts.push_back(std::move(context));
+  }
+
+  mutex mu;
+  std::vector<std::unique_ptr<ruy::Context>> free_contexts TF_GUARDED_BY(mu);
+};
+
+}  // namespace
+
+class DynamicQuantizedMatMulOp : public OpKernel {
+ public:
+  explicit DynamicQuantizedMatMulOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("transpose_a", &transpose_a_));
+    OP_REQUIRES_OK(context, context->GetAttr("transpose_b", &transpose_b_));
+    std::vector<string> fused_ops;
+    OP_REQUIRES_OK(context, context->GetAttr("fused_ops", &fused_ops));
+    int num_args;
+    OP_REQUIRES_OK(context, context->GetAttr("num_args", &num_args));
+    if (fused_ops.empty()) {
+      OP_REQUIRES(context, num_args == 0,
+                  errors::InvalidArgument(
+                      "_DynamicQuantizedMatMul without fused ops must not have "
+                      "extra arguments."));
+    } else {
+      OP_REQUIRES(context,
+                  fused_ops[0] == "BiasAdd" &&
+                      (fused_ops.size() == 1 ||
+                       (fused_ops.size() == 2 && fused_ops[1] == "Relu")),
+                  errors::Unimplemented("Fusion is not implemented: [",
+                                        absl::StrJoin(fused_ops, ","), "]"));
+      OP_REQUIRES(context, num_args == 1,
+                  errors::InvalidArgument(
+                      "_DynamicQuantizedMatMul with BiasAdd must have one "
+                      "extra argument: bias."));
+      bias_add_ = true;
+      relu_ = fused_ops.size() == 2;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& a = context->input(0);
+    const Tensor& b = context->input(1);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(a.shape()),
+                errors::InvalidArgument("In[0] is not a matrix. Instead it has "
+                                        "shape ",
+                                        a.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(b.shape()),
+                errors::InvalidArgument("In[1] is not a matrix. Instead it has "
+                                        "shape ",
+                                        b.shape().DebugString()));
+    const int64_t m = a.dim_size(transpose_a_ ? 1 : 0);
+    const int64_t k = a.dim_size(transpose_a_ ? 0 : 1);
+    const int64_t n = b.dim_size(transpose_b_ ? 0 : 1);
+    OP_REQUIRES(context, k == b.dim_size(transpose_b_ ? 1 : 0),
+                errors::InvalidArgument(
+                    "Matrix size-incompatible: In[0]: ",
+                    a.shape().DebugString(), ", In[1]: ",
+                    b.shape().DebugString()));
+    const float* bias_data = nullptr;
+    if (bias_add_) {
+      const Tensor& bias = context->input(2);
+      OP_REQUIRES(context,
+                  TensorShapeUtils::IsVector(bias.shape()) &&
+                      bias.dim_size(0) == n,
+                  errors::InvalidArgument(
+                      "bias must be a vector of size ", n, ", got shape ",
+                      bias.shape().DebugString()));
+      bias_data = bias.flat<float>().data();
+    }
+
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({m, n}), &out));
+    if (out->NumElements() == 0) return;
+    OP_REQUIRES(
+        context, k <= std::numeric_limits<int>::max() / (127 * 127),
+        errors::InvalidArgument("_DynamicQuantizedMatMul inner dimension ", k,
+                                " is too large for int32 accumulation."));
+
+    std::shared_ptr<QuantizedWeights> weights = GetQuantizedWeights(b);
+    auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
+
+    // Quantize each row of `a` with its own scale.
+    const float* a_data = a.flat<float>().data();
+    std::vector<int8> a_values(m * k);
+    std::vector<float> a_scales(m);
+    Shard(worker_threads->num_threads, worker_threads->workers, m,
+          /*cost_per_unit=*/3 * k, [&](int64_t begin, int64_t end) {
+            for (int64_t row = begin; row < end; ++row) {
+              const float* in = transpose_a_ ? a_data + row : a_data + row * k;
+              a_scales[row] = QuantizeSymmetric(in, k, transpose_a_ ? m : 1,
+                                                a_values.data() + row * k);
+            }
+          });
+
+    Tensor product;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DT_INT32, TensorShape({m, n}), &product));
+    int32* product_data = product.flat<int32>().data();
+    if (k == 0) {
+      std::fill_n(product_data, m * n, 0);
+    } else {
+      ruy::Matrix<int8> lhs;
+      ruy::MakeSimpleLayout(m, k, ruy::Order::kRowMajor,
+                            lhs.mutable_layout());
+      lhs.set_data(a_values.data());
+      ruy::Matrix<int8> rhs;
+      ruy::MakeSimpleLayout(k, n, ruy::Order::kColMajor,
+                            rhs.mutable_layout());
+      rhs.set_data(weights->values.data());
+      rhs.set_cache_policy(ruy::CachePolicy::kAlwaysCache);
+      ruy::Matrix<int32> result;
+      ruy::MakeSimpleLayout(m, n, ruy::Order::kRowMajor,
+                            result.mutable_layout());
+      result.set_data(product_data);
+      ruy::MulParams<int32, int32> mul_params;
+      std::unique_ptr<ruy::Context> ruy_context =
+          weights->AcquireContext(worker_threads->num_threads);
+      ruy::Mul(lhs, rhs, mul_params, ruy_context.get(), &result);
+      weights->ReleaseContext(std::move(ruy_context));
+    }
+
+    // Scale the products back to float and apply the fused ops.
+    float* out_data = out->flat<float>().data();
+    const float* b_scales = weights->scales.data();
+    Shard(worker_threads->num_threads, worker_threads->workers, m,
+          /*cost_per_unit=*/3 * n, [&](int64_t begin, int64_t end) {
+            for (int64_t row = begin; row < end; ++row) {
+              const int32* in = product_data + row * n;
+              float* dst = out_data + row * n;
+              const float a_scale = a_scales[row];
+              for (int64_t col = 0; col < n; ++col) {
+                float value = in[col] * a_scale * b_scales[col];
+                if (bias_add_) value += bias_data[col];
+                if (relu_) value = std::max(value, 0.0f);
+                dst[col] = value;
+              }
+            }
+          });
+  }
+
+ private:
+  // Returns the quantized form of the weights `b`, quantizing them if they
+  // are not the weights of the previous call.
+  std::shared_ptr<QuantizedWeights> GetQuantizedWeights(const Tensor& b)
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    if (weights_ != nullptr && weights_->source.SharesBufferWith(b) &&
+        weights_->source.shape() == b.shape()) {
+      return weights_;
+    }
+    const int64_t k = b.dim_size(transpose_b_ ? 1 : 0);
+    const int64_t n = b.dim_size(transpose_b_ ? 0 : 1);
+    const float* b_data = b.flat<float>().data();
+    auto weights = std::make_shared<QuantizedWeights>();
+    weights->source = b;
+    weights->values.resize(n * k);
+    weights->scales.resize(n);
+    for (int64_t col = 0; col < n; ++col) {
+      const float* in = transpose_b_ ? b_data + col * k : b_data + col;
+      weights->scales[col] = QuantizeSymmetric(
+          in, k, transpose_b_ ? 1 : n, weights->values.data() + col * k);
+    }
+    weights_ = std::move(weights);
+    return weights_;
+  }
+
+  bool transpose_a_;
+  bool transpose_b_;
+  bool bias_add_ = false;
+  bool relu_ = false;
+
+  mutex mu_;
+  std::shared_ptr<QuantizedWeights> weights_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DynamicQuantizedMatMulOp);
+};
+
+REGISTER_KERNEL_BUILDER(Name("_DynamicQuantizedMatMul")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<float>("T"),
+                        DynamicQuantizedMatMulOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,190 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+class DynamicQuantizedMatMulTest : public OpsTestBase {
+ protected:
+  void MakeOp(bool transpose_a, bool transpose_b,
+              const std::vector<string>& fused_ops) {
+    const int num_args = fused_ops.empty() ? 0 : 1;
+    TF_ASSERT_OK(
+        NodeDefBuilder("dynamic_quantized_matmul", "_DynamicQuantizedMatMul")
+            .Input(FakeInput(DT_FLOAT))
+            .Input(FakeInput(DT_FLOAT))
+            .Input(FakeInput(num_args, DT_FLOAT))
+            .Attr("transpose_a", transpose_a)
+            .Attr("transpose_b", transpose_b)
+            .Attr("num_args", num_args)
+            .Attr("fused_ops", fused_ops)
+            .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+// Each value is quantized to within half a step of 1/127 of the largest
+// magnitude in its row of A or column of B.
+TEST_F(DynamicQuantizedMatMulTest, Small) {
+  MakeOp(/*transpose_a=*/false, /*transpose_b=*/false, {});
+  // A matrix is:
+  // |  1 |  2 |  3 |
+  // |  4 |  5 |  6 |
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  // B matrix is:
+  // |  7 |  8 |  9 | 10 |
+  // | 11 | 12 | 13 | 14 |
+  // | 15 | 16 | 17 | 18 |
+  AddInputFromArray<float>(TensorShape({3, 4}),
+                           {7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 4}));
+  test::FillValues<float>(&expected, {74, 80, 86, 92, 173, 188, 203, 218});
+  test::ExpectClose(expected, *GetOutput(0), /*atol=*/1.0, /*rtol=*/1e-2);
+}
+
+TEST_F(DynamicQuantizedMatMulTest, TransposedWithBiasAndRelu) {
+  MakeOp(/*transpose_a=*/true, /*transpose_b=*/true, {"BiasAdd", "Relu"});
+  // A matrix is the transpose of:
+  // |  1 | -2 |  3 |
+  // | -4 |  5 | -6 |
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, -4, -2, 5, 3, -6});
+  // B matrix is the transpose of:
+  // |  1 |  0 |
+  // |  0 |  1 |
+  // |  1 |  1 |
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 0, 1, 0, 1, 1});
+  AddInputFromArray<float>(TensorShape({2}), {0.5f, -10.0f});
+  TF_ASSERT_OK(RunOpKernel());
+  // Products are {4, 1} and {-10, -1}, before the bias and the Relu.
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected, {4.5f, 0.0f, 0.0f, 0.0f});
+  test::ExpectClose(expected, *GetOutput(0), /*atol=*/0.1, /*rtol=*/1e-2);
+}
+
+// Runs the same weights with new activations, which reuses the quantized
+// weights, and checks the error against the float product.
+TEST_F(DynamicQuantizedMatMulTest, ReusesWeights) {
+  constexpr int kM = 16, kK = 64, kN = 8;
+  MakeOp(/*transpose_a=*/false, /*transpose_b=*/false, {});
+  Tensor a(DT_FLOAT, TensorShape({kM, kK}));
+  Tensor b(DT_FLOAT, TensorShape({kK, kN}));
+  a.flat<float>().setRandom();
+  b.flat<float>().setRandom();
+  AddInputFromArray<float>(a.shape(), a.flat<float>());
+  AddInputFromArray<float>(b.shape(), b.flat<float>());
+  for (int run = 0; run < 2; ++run) {
+    if (run == 1) {
+      // Overwrite the activations in place, keeping the weights.
+      a.flat<float>().setRandom();
+      mutable_input(0).tensor->flat<float>() = a.flat<float>();
+    }
+    TF_ASSERT_OK(RunOpKernel());
+    Tensor expected(allocator(), DT_FLOAT, TensorShape({kM, kN}));
+    expected.matrix<float>() = a.matrix<float>().contract(
+        b.matrix<float>(),
+        Eigen::array<Eigen::IndexPair<int>, 1>{Eigen::IndexPair<int>(1, 0)});
+    // Each product accumulates kK terms with a relative error of about 1/127.
+    test::ExpectClose(expected, *GetOutput(0), /*atol=*/0.5, /*rtol=*/0.05);
+  }
+}
+
+TEST_F(DynamicQuantizedMatMulTest, ZeroRow) {
+  MakeOp(/*transpose_a=*/false, /*transpose_b=*/false, {"BiasAdd"});
+  AddInputFromArray<float>(TensorShape({2, 2}), {0, 0, 1, 2});
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2}), {1, -1});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected, {1, -1, 8, 9});
+  test::ExpectClose(expected, *GetOutput(0), /*atol=*/0.1, /*rtol=*/1e-2);
+}
+
+TEST_F(DynamicQuantizedMatMulTest, UnsupportedFusion) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("dynamic_quantized_matmul", "_DynamicQuantizedMatMul")
+          .Input(FakeInput(DT_FLOAT))
+          .Input(FakeInput(DT_FLOAT))
+          .Input(FakeInput(1, DT_FLOAT))
+          .Attr("num_args", 1)
+          .Attr("fused_ops", {"BiasAdd", "Elu"})
+          .Finalize(node_def()));
+  EXPECT_EQ(InitOp().code(), error::UNIMPLEMENTED);
+}
+
+//----------------------------------------------------------------------------//
+// Performance benchmarks are below.                                          //
+//----------------------------------------------------------------------------//
+
+// Multiplies random activations by constant weights, either with the float
+// MatMul or with _DynamicQuantizedMatMul.
+static Graph* ConstantWeightsMatMul(int m, int k, int n, bool quantized) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor a(DT_FLOAT, TensorShape({m, k}));
+  a.flat<float>().setRandom();
+  Tensor b(DT_FLOAT, TensorShape({k, n}));
+  b.flat<float>().setRandom();
+  Node* a_node = test::graph::Constant(g, a);
+  Node* b_node = test::graph::Constant(g, b);
+  if (!quantized) {
+    test::graph::Matmul(g, a_node, b_node, /*transpose_a=*/false,
+                        /*transpose_b=*/false);
+    return g;
+  }
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_DynamicQuantizedMatMul")
+                  .Input(a_node)
+                  .Input(b_node)
+                  .Input(std::vector<NodeBuilder::NodeOut>{})
+                  .Attr("T", DT_FLOAT)
+                  .Attr("transpose_a", false)
+                  .Attr("transpose_b", false)
+                  .Attr("num_args", 0)
+                  .Attr("fused_ops", std::vector<string>{})
+                  .Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_DynamicQuantizedMatMul(M, K, N, QUANTIZED, LABEL)                  \
+  static void BM_DynamicQuantizedMatMul_##M##_##K##_##N##_##LABEL(            \
+      ::testing::benchmark::State& state) {                                   \
+    test::Benchmark("cpu", ConstantWeightsMatMul(M, K, N, QUANTIZED))         \
+        .Run(state);                                                          \
+    state.SetItemsProcessed(state.iterations() * M * K * N * 2);              \
+  }                                                                           \
+  BENCHMARK(BM_DynamicQuantizedMatMul_##M##_##K##_##N##_##LABEL)              \
+      ->MeasureProcessCPUTime();
+
+#define BM_DynamicQuantizedMatMulVsFloat(M, K, N)   \
+  BM_DynamicQuantizedMatMul(M, K, N, false, float); \
+  BM_DynamicQuantizedMatMul(M, K, N, true, quantized);
+
+BM_DynamicQuantizedMatMulVsFloat(1, 512, 512);
+BM_DynamicQuantizedMatMulVsFloat(16, 512, 512);
+BM_DynamicQuantizedMatMulVsFloat(128, 512, 512);
+BM_DynamicQuantizedMatMulVsFloat(128, 1024, 1024);
+
+}  // namespace tensorflow
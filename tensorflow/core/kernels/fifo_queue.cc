@@ -51,6 +51,30 @@ void FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
 void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                            DoneCallback callback) {
   CancellationManager* cm = ctx->cancellation_manager();
+  // If no other enqueue is waiting and there is room, enqueue without
+  // registering an attempt, and only flush the attempts if a dequeue is
+  // waiting for the element.
+  if (!cm->IsCancelled()) {
+    bool enqueued = false;
+    bool has_dequeue_attempts;
+    {
+      mutex_lock l(mu_);
+      if (!closed_ && enqueue_attempts_.empty() &&
+          queues_[0].size() < static_cast<size_t>(capacity_)) {
+        for (int i = 0; i < num_components(); ++i) {
+          queues_[i].push_back(tuple[i]);
+        }
+        enqueued = true;
+      }
+      has_dequeue_attempts = !dequeue_attempts_.empty();
+    }
+    if (enqueued) {
+      if (has_dequeue_attempts) FlushUnlocked();
+      callback();
+      return;
+    }
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
@@ -154,6 +178,26 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
 
 void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
   CancellationManager* cm = ctx->cancellation_manager();
+  // If no other dequeue is waiting and the queue is not empty, dequeue without
+  // registering an attempt, and only flush the attempts if an enqueue is
+  // waiting for room.
+  if (!cm->IsCancelled()) {
+    Tuple tuple;
+    bool has_enqueue_attempts;
+    {
+      mutex_lock l(mu_);
+      if (dequeue_attempts_.empty() && !queues_[0].empty()) {
+        DequeueLocked(ctx, &tuple);
+      }
+      has_enqueue_attempts = !enqueue_attempts_.empty();
+    }
+    if (!tuple.empty()) {
+      if (has_enqueue_attempts) FlushUnlocked();
+      callback(tuple);
+      return;
+    }
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
@@ -245,6 +289,54 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
   }
 
   CancellationManager* cm = ctx->cancellation_manager();
+  // If no other dequeue is waiting and the queue holds enough elements, take
+  // the first `num_elements` of them at once, and copy them into the batch
+  // after releasing the lock. The batch does not depend on the elements, so
+  // it is allocated before taking the lock, and dropped if the call has to
+  // wait.
+  if (!cm->IsCancelled()) {
+    Tuple batch;
+    batch.reserve(num_components());
+    for (int i = 0; i < num_components(); ++i) {
+      Tensor component;
+      Status s = ctx->allocate_temp(component_dtypes_[i],
+                                    ManyOutShape(i, num_elements), &component);
+      if (!s.ok()) {
+        ctx->SetStatus(s);
+        callback(Tuple());
+        return;
+      }
+      batch.push_back(std::move(component));
+    }
+    std::vector<Tuple> elements;
+    bool has_enqueue_attempts;
+    {
+      mutex_lock l(mu_);
+      if (dequeue_attempts_.empty() &&
+          queues_[0].size() >= static_cast<size_t>(num_elements)) {
+        elements.resize(num_elements);
+        for (Tuple& element : elements) DequeueLocked(ctx, &element);
+      }
+      has_enqueue_attempts = !enqueue_attempts_.empty();
+    }
+    if (!elements.empty()) {
+      if (has_enqueue_attempts) FlushUnlocked();
+      for (int64_t index = 0; index < num_elements; ++index) {
+        for (int i = 0; i < num_components(); ++i) {
+          Status s = batch_util::CopyElementToSlice(
+              std::move(elements[index][i]), &batch[i], index);
+          if (!s.ok()) {
+            ctx->SetStatus(s);
+            callback(Tuple());
+            return;
+          }
+        }
+      }
+      callback(batch);
+      return;
+    }
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
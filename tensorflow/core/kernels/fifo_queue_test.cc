@@ -0,0 +1,403 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/fifo_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/cc/client/client_session.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+// A FIFOQueue of int32 scalars with ops to enqueue a fed value, dequeue one
+// or `n` elements, and close the queue.
+class FIFOQueueTest : public ::testing::Test {
+ protected:
+  explicit FIFOQueueTest(int capacity = -1)
+      : root_(Scope::NewRootScope()),
+        queue_(ops::FIFOQueue(root_, {DT_INT32},
+                              ops::FIFOQueue::Shapes({TensorShape({})})
+                                  .Capacity(capacity))),
+        value_(ops::Placeholder(root_, DT_INT32)),
+        n_(ops::Placeholder(root_, DT_INT32)),
+        enqueue_(ops::QueueEnqueue(root_, queue_, {value_})),
+        dequeue_(ops::QueueDequeue(root_, queue_, {DT_INT32})),
+        dequeue_many_(ops::QueueDequeueMany(root_, queue_, n_, {DT_INT32})),
+        close_(ops::QueueClose(root_, queue_)),
+        session_(root_) {}
+
+  Status Enqueue(int value) {
+    return session_.Run({{value_, value}}, {}, {enqueue_.operation}, nullptr);
+  }
+
+  StatusOr<Tensor> Dequeue() {
+    std::vector<Tensor> outputs;
+    TF_RETURN_IF_ERROR(session_.Run({dequeue_.components[0]}, &outputs));
+    return outputs[0];
+  }
+
+  StatusOr<Tensor> DequeueMany(int n) {
+    std::vector<Tensor> outputs;
+    TF_RETURN_IF_ERROR(
+        session_.Run({{n_, n}}, {dequeue_many_.components[0]}, &outputs));
+    return outputs[0];
+  }
+
+  Status Close() {
+    return session_.Run({}, {}, {close_.operation}, nullptr);
+  }
+
+  Scope root_;
+  ops::FIFOQueue queue_;
+  ops::Placeholder value_;
+  ops::Placeholder n_;
+  ops::QueueEnqueue enqueue_;
+  ops::QueueDequeue dequeue_;
+  ops::QueueDequeueMany dequeue_many_;
+  ops::QueueClose close_;
+  ClientSession session_;
+};
+
+class BoundedFIFOQueueTest : public FIFOQueueTest {
+ protected:
+  BoundedFIFOQueueTest() : FIFOQueueTest(/*capacity=*/2) {}
+};
+
+TEST_F(FIFOQueueTest, DequeueManyReturnsElementsInOrder) {
+  for (int i = 0; i < 5; ++i) {
+    TF_ASSERT_OK(Enqueue(i));
+  }
+  TF_ASSERT_OK_AND_ASSIGN(Tensor batch, DequeueMany(3));
+  test::ExpectTensorEqual<int32>(batch, test::AsTensor<int32>({0, 1, 2}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor element, Dequeue());
+  test::ExpectTensorEqual<int32>(element, test::AsScalar<int32>(3));
+  TF_ASSERT_OK_AND_ASSIGN(batch, DequeueMany(1));
+  test::ExpectTensorEqual<int32>(batch, test::AsTensor<int32>({4}));
+}
+
+TEST_F(FIFOQueueTest, DequeueManyWaitsForElements) {
+  TF_ASSERT_OK(Enqueue(0));
+  StatusOr<Tensor> batch;
+  std::unique_ptr<Thread> consumer(Env::Default()->StartThread(
+      ThreadOptions(), "consumer", [&]() { batch = DequeueMany(3); }));
+  TF_ASSERT_OK(Enqueue(1));
+  TF_ASSERT_OK(Enqueue(2));
+  consumer.reset();
+  TF_ASSERT_OK(batch.status());
+  test::ExpectTensorEqual<int32>(*batch, test::AsTensor<int32>({0, 1, 2}));
+}
+
+TEST_F(FIFOQueueTest, DequeueManyFailsOnClosedQueue) {
+  TF_ASSERT_OK(Enqueue(0));
+  TF_ASSERT_OK(Close());
+  EXPECT_TRUE(errors::IsOutOfRange(DequeueMany(2).status()));
+}
+
+TEST_F(BoundedFIFOQueueTest, DequeueManyReleasesWaitingEnqueue) {
+  TF_ASSERT_OK(Enqueue(0));
+  TF_ASSERT_OK(Enqueue(1));
+  Status enqueue_status;
+  std::unique_ptr<Thread> producer(Env::Default()->StartThread(
+      ThreadOptions(), "producer", [&]() { enqueue_status = Enqueue(2); }));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor batch, DequeueMany(2));
+  test::ExpectTensorEqual<int32>(batch, test::AsTensor<int32>({0, 1}));
+  producer.reset();
+  TF_ASSERT_OK(enqueue_status);
+  TF_ASSERT_OK_AND_ASSIGN(Tensor element, Dequeue());
+  test::ExpectTensorEqual<int32>(element, test::AsScalar<int32>(2));
+}
+
+// Calls a FIFOQueue of int32 scalars with capacity 2 directly, so that tests
+// can tell whether a call completed right away or waits as a pending attempt.
+class FIFOQueueAttemptTest : public ::testing::Test {
+ protected:
+  // The state of one call into the queue.
+  struct Call {
+    CancellationManager cancellation_manager;
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx;
+    bool done = false;
+    QueueInterface::Tuple tuple;
+  };
+
+  void SetUp() override {
+    device_ = DeviceFactory::NewDevice("CPU", {}, "/job:a/replica:0/task:0");
+    // The kernel only names the calls' contexts.
+    NodeDef node_def;
+    TF_ASSERT_OK(NodeDefBuilder("size", "QueueSizeV2")
+                     .Input(FakeInput(DT_RESOURCE))
+                     .Finalize(&node_def));
+    Status status;
+    kernel_ = CreateOpKernel(DEVICE_CPU, device_.get(), cpu_allocator(),
+                             node_def, TF_GRAPH_DEF_VERSION, &status);
+    TF_ASSERT_OK(status);
+    queue_ = new FIFOQueue(/*capacity=*/2, {DT_INT32}, {TensorShape({})},
+                           "test_queue");
+    TF_ASSERT_OK(queue_->Initialize());
+  }
+
+  void TearDown() override {
+    if (queue_ == nullptr) return;
+    // Completes the calls that are still pending.
+    Close(/*cancel_pending_enqueues=*/true);
+    queue_->Unref();
+  }
+
+  Call* NewCall(bool cancelled) {
+    calls_.push_back(std::make_unique<Call>());
+    Call* call = calls_.back().get();
+    call->params.device = device_.get();
+    call->params.op_kernel = kernel_.get();
+    call->params.cancellation_manager = &call->cancellation_manager;
+    call->ctx = std::make_unique<OpKernelContext>(&call->params);
+    if (cancelled) call->cancellation_manager.StartCancel();
+    return call;
+  }
+
+  Call* Enqueue(int value, bool cancelled = false) {
+    Call* call = NewCall(cancelled);
+    queue_->TryEnqueue({test::AsScalar<int32>(value)}, call->ctx.get(),
+                       [call]() { call->done = true; });
+    return call;
+  }
+
+  Call* EnqueueMany(const std::vector<int32>& values) {
+    Call* call = NewCall(/*cancelled=*/false);
+    queue_->TryEnqueueMany({test::AsTensor<int32>(values)}, call->ctx.get(),
+                           [call]() { call->done = true; });
+    return call;
+  }
+
+  Call* Dequeue(bool cancelled = false) {
+    Call* call = NewCall(cancelled);
+    queue_->TryDequeue(call->ctx.get(),
+                       [call](const QueueInterface::Tuple& tuple) {
+                         call->tuple = tuple;
+                         call->done = true;
+                       });
+    return call;
+  }
+
+  Call* DequeueMany(int num_elements) {
+    Call* call = NewCall(/*cancelled=*/false);
+    queue_->TryDequeueMany(num_elements, call->ctx.get(),
+                           /*allow_small_batch=*/false,
+                           [call](const QueueInterface::Tuple& tuple) {
+                             call->tuple = tuple;
+                             call->done = true;
+                           });
+    return call;
+  }
+
+  Call* Close(bool cancel_pending_enqueues) {
+    Call* call = NewCall(/*cancelled=*/false);
+    queue_->Close(call->ctx.get(), cancel_pending_enqueues,
+                  [call]() { call->done = true; });
+    return call;
+  }
+
+  // Expects `call` to have completed with `expected`.
+  void ExpectDequeued(const Call* call, const Tensor& expected) {
+    ASSERT_TRUE(call->done);
+    TF_ASSERT_OK(call->ctx->status());
+    ASSERT_EQ(call->tuple.size(), 1);
+    test::ExpectTensorEqual<int32>(call->tuple[0], expected);
+  }
+
+  std::unique_ptr<Device> device_;
+  std::unique_ptr<OpKernel> kernel_;
+  FIFOQueue* queue_ = nullptr;
+  std::vector<std::unique_ptr<Call>> calls_;
+};
+
+TEST_F(FIFOQueueAttemptTest, PendingEnqueuesKeepTheirOrder) {
+  EXPECT_TRUE(Enqueue(0)->done);
+  EXPECT_TRUE(Enqueue(1)->done);
+  Call* enqueue_many = EnqueueMany({2, 3});
+  Call* enqueue = Enqueue(4);
+  EXPECT_FALSE(enqueue_many->done);
+  EXPECT_FALSE(enqueue->done);
+
+  // Each dequeue makes room for one element of the oldest pending enqueue.
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(0));
+  EXPECT_FALSE(enqueue_many->done);
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(1));
+  EXPECT_TRUE(enqueue_many->done);
+  EXPECT_FALSE(enqueue->done);
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(2));
+  EXPECT_TRUE(enqueue->done);
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(3));
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(4));
+  EXPECT_EQ(queue_->size(), 0);
+}
+
+TEST_F(FIFOQueueAttemptTest, DequeueDoesNotOvertakePendingDequeueMany) {
+  EXPECT_TRUE(Enqueue(0)->done);
+  Call* dequeue_many = DequeueMany(3);
+  Call* dequeue = Dequeue();
+  EXPECT_FALSE(dequeue_many->done);
+  EXPECT_FALSE(dequeue->done);
+
+  // The enqueued elements complete the older DequeueMany first.
+  EXPECT_TRUE(Enqueue(1)->done);
+  EXPECT_TRUE(Enqueue(2)->done);
+  ExpectDequeued(dequeue_many, test::AsTensor<int32>({0, 1, 2}));
+  EXPECT_FALSE(dequeue->done);
+  EXPECT_TRUE(Enqueue(3)->done);
+  ExpectDequeued(dequeue, test::AsScalar<int32>(3));
+}
+
+TEST_F(FIFOQueueAttemptTest, EnqueueDoesNotOvertakePendingClose) {
+  EXPECT_TRUE(Enqueue(0)->done);
+  EXPECT_TRUE(Enqueue(1)->done);
+  Call* pending_enqueue = Enqueue(2);
+  Call* close = Close(/*cancel_pending_enqueues=*/false);
+  EXPECT_FALSE(close->done);
+
+  // The dequeue makes room for the pending enqueue, after which the queue
+  // closes. Later enqueues fail even though there is room.
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(0));
+  EXPECT_TRUE(pending_enqueue->done);
+  TF_EXPECT_OK(pending_enqueue->ctx->status());
+  EXPECT_TRUE(close->done);
+  TF_EXPECT_OK(close->ctx->status());
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(1));
+  Call* enqueue = Enqueue(3);
+  EXPECT_TRUE(enqueue->done);
+  EXPECT_TRUE(errors::IsCancelled(enqueue->ctx->status()));
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(2));
+}
+
+TEST_F(FIFOQueueAttemptTest, CancelledCallsDoNotTakeTheFastPath) {
+  Call* enqueue = Enqueue(0, /*cancelled=*/true);
+  EXPECT_TRUE(enqueue->done);
+  EXPECT_TRUE(errors::IsCancelled(enqueue->ctx->status()));
+  EXPECT_EQ(queue_->size(), 0);
+
+  EXPECT_TRUE(Enqueue(1)->done);
+  Call* dequeue = Dequeue(/*cancelled=*/true);
+  EXPECT_TRUE(dequeue->done);
+  EXPECT_TRUE(errors::IsCancelled(dequeue->ctx->status()));
+  EXPECT_EQ(queue_->size(), 1);
+}
+
+TEST_F(FIFOQueueAttemptTest, CancelPendingAttempts) {
+  Call* dequeue = Dequeue();
+  EXPECT_FALSE(dequeue->done);
+  dequeue->cancellation_manager.StartCancel();
+  EXPECT_TRUE(dequeue->done);
+  EXPECT_TRUE(errors::IsCancelled(dequeue->ctx->status()));
+
+  // The cancelled dequeue does not take the next element.
+  EXPECT_TRUE(Enqueue(0)->done);
+  EXPECT_TRUE(Enqueue(1)->done);
+  EXPECT_EQ(queue_->size(), 2);
+
+  Call* enqueue = Enqueue(2);
+  EXPECT_FALSE(enqueue->done);
+  enqueue->cancellation_manager.StartCancel();
+  EXPECT_TRUE(enqueue->done);
+  EXPECT_TRUE(errors::IsCancelled(enqueue->ctx->status()));
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(0));
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(1));
+  EXPECT_EQ(queue_->size(), 0);
+}
+
+TEST_F(FIFOQueueAttemptTest, ClosedQueue) {
+  EXPECT_TRUE(Enqueue(0)->done);
+  Call* dequeue_many = DequeueMany(2);
+  EXPECT_TRUE(Close(/*cancel_pending_enqueues=*/false)->done);
+  // The pending DequeueMany fails, and returns its element to the queue.
+  EXPECT_TRUE(dequeue_many->done);
+  EXPECT_TRUE(errors::IsOutOfRange(dequeue_many->ctx->status()));
+
+  Call* enqueue = Enqueue(1);
+  EXPECT_TRUE(enqueue->done);
+  EXPECT_TRUE(errors::IsCancelled(enqueue->ctx->status()));
+  // The remaining element can still be dequeued.
+  ExpectDequeued(Dequeue(), test::AsScalar<int32>(0));
+  Call* dequeue = Dequeue();
+  EXPECT_TRUE(dequeue->done);
+  EXPECT_TRUE(errors::IsOutOfRange(dequeue->ctx->status()));
+}
+
+TEST_F(FIFOQueueAttemptTest, CloseCancelsPendingEnqueues) {
+  EXPECT_TRUE(Enqueue(0)->done);
+  EXPECT_TRUE(Enqueue(1)->done);
+  Call* enqueue = Enqueue(2);
+  EXPECT_FALSE(enqueue->done);
+  EXPECT_TRUE(Close(/*cancel_pending_enqueues=*/true)->done);
+  EXPECT_TRUE(enqueue->done);
+  EXPECT_TRUE(errors::IsCancelled(enqueue->ctx->status()));
+  EXPECT_EQ(queue_->size(), 2);
+}
+
+// Enqueues and dequeues `batch_size` elements of 1024 floats, one at a time
+// or with DequeueMany.
+void BM_FIFOQueue(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+  const bool dequeue_many = state.range(1);
+  Scope root = Scope::NewRootScope();
+  auto queue = ops::FIFOQueue(
+      root, {DT_FLOAT}, ops::FIFOQueue::Shapes({TensorShape({1024})}));
+  Tensor element(DT_FLOAT, TensorShape({1024}));
+  element.flat<float>().setZero();
+  auto enqueue = ops::QueueEnqueue(root, queue, {ops::Const(root, element)});
+  auto dequeue = ops::QueueDequeue(root, queue, {DT_FLOAT});
+  auto dequeue_many =
+      ops::QueueDequeueMany(root, queue, batch_size, {DT_FLOAT});
+  ClientSession session(root);
+  std::vector<Tensor> outputs;
+  for (auto s : state) {
+    for (int i = 0; i < batch_size; ++i) {
+      TF_CHECK_OK(session.Run({}, {}, {enqueue.operation}, nullptr));
+    }
+    if (dequeue_many) {
+      TF_CHECK_OK(session.Run({dequeue_many.components[0]}, &outputs));
+    } else {
+      for (int i = 0; i < batch_size; ++i) {
+        TF_CHECK_OK(session.Run({dequeue.components[0]}, &outputs));
+      }
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          batch_size);
+}
+BENCHMARK(BM_FIFOQueue)
+    ->ArgPair(1, false)
+    ->ArgPair(32, false)
+    ->ArgPair(32, true)
+    ->ArgPair(256, true);
+
+}  // namespace
+}  // namespace tensorflow
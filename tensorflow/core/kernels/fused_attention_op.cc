@@ -0,0 +1,226 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/nn_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/fused_attention_op.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/fill_functor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+using CPUDevice = Eigen::ThreadPoolDevice;
+using GPUDevice = Eigen::GpuDevice;
+
+namespace functor {
+
+// The CPU kernel computes the attention of blocks of kQueryBlock queries,
+// visiting the keys and values kKeyBlock rows at a time. The products of the
+// blocks are computed in float by Eigen's matrix multiplication.
+constexpr int64_t kQueryBlock = 64;
+constexpr int64_t kKeyBlock = 256;
+
+template <typename Scalar>
+using RowMajorMatrix =
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+template <typename T>
+struct FusedMultiHeadAttentionFunctor<CPUDevice, T> {
+  static Status Compute(OpKernelContext* context,
+                        typename TTypes<T, 3>::ConstTensor query,
+                        typename TTypes<T, 3>::ConstTensor key,
+                        typename TTypes<T, 3>::ConstTensor value, float scale,
+                        typename TTypes<T, 3>::Tensor output) {
+    using Matrix = RowMajorMatrix<float>;
+    using ConstMatrixMap = Eigen::Map<const RowMajorMatrix<T>>;
+    using MatrixMap = Eigen::Map<RowMajorMatrix<T>>;
+
+    const int64_t batch = query.dimension(0);
+    const int64_t q_len = query.dimension(1);
+    const int64_t depth = query.dimension(2);
+    const int64_t kv_len = key.dimension(1);
+    const int64_t value_depth = value.dimension(2);
+    const int64_t num_query_blocks = (q_len + kQueryBlock - 1) / kQueryBlock;
+
+    auto work = [&](int64_t start, int64_t limit) {
+      Matrix queries, keys, values, scores, accumulator;
+      Eigen::ArrayXf row_max, row_sum;
+      for (int64_t task = start; task < limit; ++task) {
+        const int64_t b = task / num_query_blocks;
+        const int64_t q0 = task % num_query_blocks * kQueryBlock;
+        const int64_t rows = std::min(kQueryBlock, q_len - q0);
+
+        queries = ConstMatrixMap(query.data() + (b * q_len + q0) * depth, rows,
+                                 depth)
+                      .template cast<float>() *
+                  scale;
+        accumulator.setZero(rows, value_depth);
+        row_max.setConstant(rows, -std::numeric_limits<float>::infinity());
+        row_sum.setZero(rows);
+
+        for (int64_t k0 = 0; k0 < kv_len; k0 += kKeyBlock) {
+          const int64_t cols = std::min(kKeyBlock, kv_len - k0);
+          keys = ConstMatrixMap(key.data() + (b * kv_len + k0) * depth, cols,
+                                depth)
+                     .template cast<float>();
+          values = ConstMatrixMap(
+                       value.data() + (b * kv_len + k0) * value_depth, cols,
+                       value_depth)
+                       .template cast<float>();
+          scores.noalias() = queries * keys.transpose();
+
+          for (int64_t r = 0; r < rows; ++r) {
+            const float new_max =
+                std::max(row_max(r), scores.row(r).maxCoeff());
+            // The partial sums of the row were computed relative to the old
+            // maximum.
+            const float correction = std::exp(row_max(r) - new_max);
+            scores.row(r) = (scores.row(r).array() - new_max).exp();
+            row_sum(r) = row_sum(r) * correction + scores.row(r).sum();
+            accumulator.row(r) *= correction;
+            row_max(r) = new_max;
+          }
+          accumulator.noalias() += scores * values;
+        }
+
+        MatrixMap(output.data() + (b * q_len + q0) * value_depth, rows,
+                  value_depth) =
+            (accumulator.array().colwise() / row_sum).template cast<T>();
+      }
+    };
+
+    const int64_t cost_per_task =
+        std::min(kQueryBlock, q_len) * kv_len * (depth + value_depth) * 2;
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          batch * num_query_blocks, cost_per_task, work);
+    return OkStatus();
+  }
+};
+
+}  // namespace functor
+
+template <typename Device, typename T>
+class FusedMultiHeadAttentionOp : public OpKernel {
+ public:
+  explicit FusedMultiHeadAttentionOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("scale", &scale_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& query = context->input(0);
+    const Tensor& key = context->input(1);
+    const Tensor& value = context->input(2);
+
+    OP_REQUIRES(context,
+                query.dims() == 4 && key.dims() == 4 && value.dims() == 4,
+                errors::InvalidArgument(
+                    "query, key and value must be 4-dimensional: ",
+                    query.shape().DebugString(), ", ",
+                    key.shape().DebugString(), ", ",
+                    value.shape().DebugString()));
+    for (int i = 0; i < 2; ++i) {
+      OP_REQUIRES(context,
+                  query.dim_size(i) == key.dim_size(i) &&
+                      query.dim_size(i) == value.dim_size(i),
+                  errors::InvalidArgument(
+                      "query, key and value must have the same batch and head "
+                      "dimensions: ",
+                      query.shape().DebugString(), ", ",
+                      key.shape().DebugString(), ", ",
+                      value.shape().DebugString()));
+    }
+    OP_REQUIRES(context, query.dim_size(3) == key.dim_size(3),
+                errors::InvalidArgument(
+                    "query and key must have the same depth: ",
+                    query.shape().DebugString(), " vs. ",
+                    key.shape().DebugString()));
+    OP_REQUIRES(context, key.dim_size(2) == value.dim_size(2),
+                errors::InvalidArgument(
+                    "key and value must have the same length: ",
+                    key.shape().DebugString(), " vs. ",
+                    value.shape().DebugString()));
+
+    const int64_t batch = query.dim_size(0) * query.dim_size(1);
+    const int64_t q_len = query.dim_size(2);
+    const int64_t depth = query.dim_size(3);
+    const int64_t kv_len = key.dim_size(2);
+    const int64_t value_depth = value.dim_size(3);
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(
+        context, context->allocate_output(
+                     0,
+                     TensorShape({query.dim_size(0), query.dim_size(1), q_len,
+                                  value_depth}),
+                     &output));
+    if (output->NumElements() == 0) return;
+    if (kv_len == 0) {
+      // Attending to no keys yields zeros, as the unfused subgraph does.
+      functor::SetZeroFunctor<Device, T>()(context->eigen_device<Device>(),
+                                           output->flat<T>());
+      return;
+    }
+
+    OP_REQUIRES_OK(
+        context,
+        functor::FusedMultiHeadAttentionFunctor<Device, T>::Compute(
+            context, query.shaped<T, 3>({batch, q_len, depth}),
+            key.shaped<T, 3>({batch, kv_len, depth}),
+            value.shaped<T, 3>({batch, kv_len, value_depth}), scale_,
+            output->shaped<T, 3>({batch, q_len, value_depth})));
+  }
+
+ private:
+  float scale_;
+};
+
+#define REGISTER_CPU(T)                                      \
+  REGISTER_KERNEL_BUILDER(Name("_FusedMultiHeadAttention")   \
+                              .Device(DEVICE_CPU)            \
+                              .TypeConstraint<T>("T"),       \
+                          FusedMultiHeadAttentionOp<CPUDevice, T>);
+
+TF_CALL_half(REGISTER_CPU);
+TF_CALL_float(REGISTER_CPU);
+#undef REGISTER_CPU
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+#define REGISTER_GPU(T)                                      \
+  REGISTER_KERNEL_BUILDER(Name("_FusedMultiHeadAttention")   \
+                              .Device(DEVICE_GPU)            \
+                              .TypeConstraint<T>("T"),       \
+                          FusedMultiHeadAttentionOp<GPUDevice, T>);
+
+TF_CALL_half(REGISTER_GPU);
+TF_CALL_float(REGISTER_GPU);
+#undef REGISTER_GPU
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+}  // namespace tensorflow
@@ -0,0 +1,51 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_FUSED_ATTENTION_OP_H_
+#define TENSORFLOW_CORE_KERNELS_FUSED_ATTENTION_OP_H_
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace functor {
+
+// Computes `output = softmax(scale * query * key^T) * value` for every batch
+// entry, where the batch dimension folds the batch and head dimensions of the
+// op:
+//   query:  [batch, q_len, depth]
+//   key:    [batch, kv_len, depth]
+//   value:  [batch, kv_len, value_depth]
+//   output: [batch, q_len, value_depth]
+//
+// Keys are processed in blocks with an online softmax, that rescales the
+// partial sums whenever the running maximum of a query row changes, so that
+// only a block of the [q_len, kv_len] scores is ever held in memory.
+//
+// REQUIRES: kv_len > 0
+template <typename Device, typename T>
+struct FusedMultiHeadAttentionFunctor {
+  static Status Compute(OpKernelContext* context,
+                        typename TTypes<T, 3>::ConstTensor query,
+                        typename TTypes<T, 3>::ConstTensor key,
+                        typename TTypes<T, 3>::ConstTensor value, float scale,
+                        typename TTypes<T, 3>::Tensor output);
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_FUSED_ATTENTION_OP_H_
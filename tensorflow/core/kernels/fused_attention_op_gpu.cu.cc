@@ -0,0 +1,207 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+#define EIGEN_USE_GPU
+
+#include <limits>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/kernels/fused_attention_op.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/gpu_kernel_helper.h"
+
+namespace tensorflow {
+
+using GPUDevice = Eigen::GpuDevice;
+
+namespace {
+
+// Every warp of a block computes the output of one query row. The warps of a
+// block share tiles of kWarpSize keys and values that they stage in shared
+// memory, and each lane of a warp computes the score of one key of the tile,
+// and accumulates value dimensions lane, lane + kWarpSize, etc.
+constexpr int kWarpSize = TF_RED_WARPSIZE;
+constexpr int kWarpsPerBlock = 8;
+constexpr int kMaxValueDepth = 128;
+constexpr int kMaxDepth = 128;
+
+__device__ inline float WarpMax(float value) {
+  for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+    value = max(value, GpuShuffleXorSync(kGpuWarpAll, value, offset));
+  }
+  return value;
+}
+
+__device__ inline float WarpSum(float value) {
+  for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+    value += GpuShuffleXorSync(kGpuWarpAll, value, offset);
+  }
+  return value;
+}
+
+template <typename T>
+__global__ void __launch_bounds__(kWarpsPerBlock* kWarpSize)
+    FusedMultiHeadAttentionKernel(const T* __restrict__ query,
+                                  const T* __restrict__ key,
+                                  const T* __restrict__ value, int q_len,
+                                  int kv_len, int depth, int value_depth,
+                                  float scale, T* __restrict__ output) {
+  // The key rows are padded by one element so that the lanes of a warp,
+  // which read the same element of different keys, use different banks.
+  GPU_DYNAMIC_SHARED_MEM_DECL(sizeof(float), unsigned char, shared_memory);
+  const int key_stride = depth + 1;
+  float* keys = reinterpret_cast<float*>(shared_memory);
+  float* values = keys + kWarpSize * key_stride;
+  float* queries = values + kWarpSize * value_depth;
+
+  const int warp = threadIdx.x / kWarpSize;
+  const int lane = threadIdx.x % kWarpSize;
+  const int row_blocks = (q_len + kWarpsPerBlock - 1) / kWarpsPerBlock;
+  const int64 b = blockIdx.x / row_blocks;
+  const int row = blockIdx.x % row_blocks * kWarpsPerBlock + warp;
+  // Rows past the end still help staging the tiles.
+  const bool active = row < q_len;
+
+  float* row_query = queries + warp * depth;
+  if (active) {
+    const T* query_row = query + (b * q_len + row) * depth;
+    for (int d = lane; d < depth; d += kWarpSize) {
+      row_query[d] = static_cast<float>(query_row[d]) * scale;
+    }
+  }
+
+  float accumulator[kMaxValueDepth / kWarpSize];
+  for (int i = 0; i < kMaxValueDepth / kWarpSize; ++i) accumulator[i] = 0;
+  float row_max = -std::numeric_limits<float>::infinity();
+  float row_sum = 0;
+
+  for (int k0 = 0; k0 < kv_len; k0 += kWarpSize) {
+    const int tile = min(kWarpSize, kv_len - k0);
+    // Wait until the previous tile has been consumed.
+    __syncthreads();
+    const T* key_tile = key + (b * kv_len + k0) * depth;
+    for (int i = threadIdx.x; i < tile * depth; i += blockDim.x) {
+      keys[i / depth * key_stride + i % depth] =
+          static_cast<float>(key_tile[i]);
+    }
+    const T* value_tile = value + (b * kv_len + k0) * value_depth;
+    for (int i = threadIdx.x; i < tile * value_depth; i += blockDim.x) {
+      values[i] = static_cast<float>(value_tile[i]);
+    }
+    __syncthreads();
+    if (!active) continue;
+
+    float score = -std::numeric_limits<float>::infinity();
+    if (lane < tile) {
+      score = 0;
+      const float* key_row = keys + lane * key_stride;
+      for (int d = 0; d < depth; ++d) score += row_query[d] * key_row[d];
+    }
+    const float new_max = max(row_max, WarpMax(score));
+    const float probability = lane < tile ? __expf(score - new_max) : 0;
+    // Rescale the partial sums, which are relative to the old maximum.
+    const float correction = __expf(row_max - new_max);
+    row_sum = row_sum * correction + WarpSum(probability);
+    for (int i = 0; i < kMaxValueDepth / kWarpSize; ++i) {
+      accumulator[i] *= correction;
+    }
+    for (int j = 0; j < tile; ++j) {
+      const float p = GpuShuffleSync(kGpuWarpAll, probability, j);
+      const float* value_row = values + j * value_depth;
+      for (int i = 0; i < kMaxValueDepth / kWarpSize; ++i) {
+        const int d = lane + i * kWarpSize;
+        if (d < value_depth) accumulator[i] += p * value_row[d];
+      }
+    }
+    row_max = new_max;
+  }
+
+  if (active) {
+    T* output_row = output + (b * q_len + row) * value_depth;
+    for (int i = 0; i < kMaxValueDepth / kWarpSize; ++i) {
+      const int d = lane + i * kWarpSize;
+      if (d < value_depth) {
+        output_row[d] = static_cast<T>(accumulator[i] / row_sum);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+namespace functor {
+
+template <typename T>
+struct FusedMultiHeadAttentionFunctor<GPUDevice, T> {
+  static Status Compute(OpKernelContext* context,
+                        typename TTypes<T, 3>::ConstTensor query,
+                        typename TTypes<T, 3>::ConstTensor key,
+                        typename TTypes<T, 3>::ConstTensor value, float scale,
+                        typename TTypes<T, 3>::Tensor output) {
+    const int64 batch = query.dimension(0);
+    const int64 q_len = query.dimension(1);
+    const int64 depth = query.dimension(2);
+    const int64 kv_len = key.dimension(1);
+    const int64 value_depth = value.dimension(2);
+    if (depth > kMaxDepth || value_depth > kMaxValueDepth) {
+      return errors::Unimplemented(
+          "_FusedMultiHeadAttention on GPU supports depths of at most ",
+          kMaxDepth, ", got ", depth, " and ", value_depth);
+    }
+    const int64 block_count =
+        batch * ((q_len + kWarpsPerBlock - 1) / kWarpsPerBlock);
+    if (q_len > std::numeric_limits<int>::max() ||
+        kv_len > std::numeric_limits<int>::max() ||
+        block_count > std::numeric_limits<int>::max()) {
+      return errors::InvalidArgument(
+          "_FusedMultiHeadAttention inputs are too large");
+    }
+
+    const GPUDevice& d = context->eigen_device<GPUDevice>();
+    const int shared_memory_size =
+        (kWarpSize * (depth + 1 + value_depth) + kWarpsPerBlock * depth) *
+        sizeof(float);
+    if (shared_memory_size > d.sharedMemPerBlock()) {
+      return errors::Unimplemented(
+          "_FusedMultiHeadAttention needs ", shared_memory_size,
+          " bytes of shared memory, but the device has ",
+          d.sharedMemPerBlock());
+    }
+    return GpuLaunchKernel(FusedMultiHeadAttentionKernel<T>,
+                           static_cast<int>(block_count),
+                           kWarpsPerBlock * kWarpSize, shared_memory_size,
+                           d.stream(), query.data(), key.data(), value.data(),
+                           static_cast<int>(q_len), static_cast<int>(kv_len),
+                           static_cast<int>(depth),
+                           static_cast<int>(value_depth), scale,
+                           output.data());
+  }
+};
+
+}  // namespace functor
+
+#define DEFINE_GPU_SPEC(T) \
+  template struct functor::FusedMultiHeadAttentionFunctor<GPUDevice, T>;
+
+TF_CALL_half(DEFINE_GPU_SPEC);
+TF_CALL_float(DEFINE_GPU_SPEC);
+#undef DEFINE_GPU_SPEC
+
+}  // namespace tensorflow
+
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -0,0 +1,248 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+class FusedMultiHeadAttentionOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType dtype, float scale) {
+    TF_EXPECT_OK(NodeDefBuilder("attention", "_FusedMultiHeadAttention")
+                     .Input(FakeInput(dtype))
+                     .Input(FakeInput(dtype))
+                     .Input(FakeInput(dtype))
+                     .Attr("scale", scale)
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+
+  // Computes softmax(scale * query * key^T) * value one row at a time.
+  static Tensor ReferenceAttention(const Tensor& query, const Tensor& key,
+                                   const Tensor& value, float scale) {
+    const int64_t batch = query.dim_size(0) * query.dim_size(1);
+    const int64_t q_len = query.dim_size(2);
+    const int64_t depth = query.dim_size(3);
+    const int64_t kv_len = key.dim_size(2);
+    const int64_t value_depth = value.dim_size(3);
+    auto q = query.shaped<float, 3>({batch, q_len, depth});
+    auto k = key.shaped<float, 3>({batch, kv_len, depth});
+    auto v = value.shaped<float, 3>({batch, kv_len, value_depth});
+
+    Tensor expected(DT_FLOAT, TensorShape({query.dim_size(0),
+                                           query.dim_size(1), q_len,
+                                           value_depth}));
+    auto out = expected.shaped<float, 3>({batch, q_len, value_depth});
+    std::vector<double> scores(kv_len);
+    for (int64_t b = 0; b < batch; ++b) {
+      for (int64_t i = 0; i < q_len; ++i) {
+        double max_score = -INFINITY;
+        for (int64_t j = 0; j < kv_len; ++j) {
+          double dot = 0;
+          for (int64_t d = 0; d < depth; ++d) dot += q(b, i, d) * k(b, j, d);
+          scores[j] = dot * scale;
+          max_score = std::max(max_score, scores[j]);
+        }
+        double sum = 0;
+        for (double& score : scores) {
+          score = std::exp(score - max_score);
+          sum += score;
+        }
+        for (int64_t e = 0; e < value_depth; ++e) {
+          double result = 0;
+          for (int64_t j = 0; j < kv_len; ++j) {
+            result += scores[j] * v(b, j, e);
+          }
+          out(b, i, e) = result / sum;
+        }
+      }
+    }
+    return expected;
+  }
+
+  void RunAndCheck(int64_t batch, int64_t heads, int64_t q_len,
+                   int64_t kv_len, int64_t depth, int64_t value_depth) {
+    const float scale = 1.0f / std::sqrt(static_cast<float>(depth));
+    MakeOp(DT_FLOAT, scale);
+    Tensor* query = AddInput(DT_FLOAT, {batch, heads, q_len, depth});
+    Tensor* key = AddInput(DT_FLOAT, {batch, heads, kv_len, depth});
+    Tensor* value = AddInput(DT_FLOAT, {batch, heads, kv_len, value_depth});
+    // Logits spread wide enough that the softmax of a row is dominated by a
+    // few keys, which exercises the running maximum across key blocks.
+    query->flat<float>().setRandom();
+    key->flat<float>().setRandom();
+    value->flat<float>().setRandom();
+    query->flat<float>() = (query->flat<float>() - 0.5f) * 8.0f;
+    key->flat<float>() = (key->flat<float>() - 0.5f) * 8.0f;
+
+    TF_ASSERT_OK(RunOpKernel());
+    const Tensor expected = ReferenceAttention(*query, *key, *value, scale);
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+  }
+};
+
+TEST_F(FusedMultiHeadAttentionOpTest, Small) { RunAndCheck(1, 1, 3, 5, 4, 4); }
+
+TEST_F(FusedMultiHeadAttentionOpTest, MultipleBlocks) {
+  // Spans several query and key blocks, with partial blocks at the end.
+  RunAndCheck(2, 3, 130, 600, 16, 8);
+}
+
+TEST_F(FusedMultiHeadAttentionOpTest, SingleKey) {
+  RunAndCheck(2, 2, 7, 1, 8, 3);
+}
+
+TEST_F(FusedMultiHeadAttentionOpTest, Half) {
+  MakeOp(DT_HALF, 0.5f);
+  AddInputFromList<Eigen::half>(TensorShape({1, 1, 2, 2}), {1, 0, 0, 1});
+  AddInputFromList<Eigen::half>(TensorShape({1, 1, 2, 2}), {2, 0, 0, 2});
+  AddInputFromList<Eigen::half>(TensorShape({1, 1, 2, 1}), {1, 3});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Each query scores 1 against its matching key and 0 against the other.
+  const float p = 1.0f / (1.0f + std::exp(-1.0f));
+  Tensor expected(allocator(), DT_HALF, TensorShape({1, 1, 2, 1}));
+  test::FillValues<Eigen::half>(
+      &expected, {static_cast<Eigen::half>(p + 3 * (1 - p)),
+                  static_cast<Eigen::half>((1 - p) + 3 * p)});
+  test::ExpectTensorNear<Eigen::half>(expected, *GetOutput(0),
+                                      static_cast<Eigen::half>(1e-2));
+}
+
+TEST_F(FusedMultiHeadAttentionOpTest, EmptyKeys) {
+  MakeOp(DT_FLOAT, 1.0f);
+  AddInputFromArray<float>(TensorShape({1, 2, 3, 4}),
+                           std::vector<float>(24, 1.0f));
+  AddInputFromArray<float>(TensorShape({1, 2, 0, 4}), {});
+  AddInputFromArray<float>(TensorShape({1, 2, 0, 5}), {});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({1, 2, 3, 5}));
+  test::FillFn<float>(&expected, [](int) { return 0.0f; });
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedMultiHeadAttentionOpTest, MismatchedDepth) {
+  MakeOp(DT_FLOAT, 1.0f);
+  AddInputFromArray<float>(TensorShape({1, 1, 2, 4}),
+                           std::vector<float>(8, 1.0f));
+  AddInputFromArray<float>(TensorShape({1, 1, 2, 3}),
+                           std::vector<float>(6, 1.0f));
+  AddInputFromArray<float>(TensorShape({1, 1, 2, 3}),
+                           std::vector<float>(6, 1.0f));
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "same depth")) << s;
+}
+
+TEST_F(FusedMultiHeadAttentionOpTest, MismatchedHeads) {
+  MakeOp(DT_FLOAT, 1.0f);
+  AddInputFromArray<float>(TensorShape({1, 2, 1, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({1, 1, 1, 2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({1, 1, 1, 2}), {1, 2});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "batch and head")) << s;
+}
+
+// Builds either _FusedMultiHeadAttention or the BatchMatMul/Softmax subgraph
+// that the remapper replaces with it.
+static Graph* MultiHeadAttention(bool fused, int batch, int heads, int q_len,
+                                 int kv_len, int depth) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor query_t(DT_FLOAT, TensorShape({batch, heads, q_len, depth}));
+  Tensor key_t(DT_FLOAT, TensorShape({batch, heads, kv_len, depth}));
+  Tensor value_t(DT_FLOAT, TensorShape({batch, heads, kv_len, depth}));
+  query_t.flat<float>().setRandom();
+  key_t.flat<float>().setRandom();
+  value_t.flat<float>().setRandom();
+  Node* query = test::graph::Constant(g, query_t, "query");
+  Node* key = test::graph::Constant(g, key_t, "key");
+  Node* value = test::graph::Constant(g, value_t, "value");
+  const float scale = 1.0f / std::sqrt(static_cast<float>(depth));
+
+  if (fused) {
+    Node* attention;
+    TF_CHECK_OK(NodeBuilder(g->NewName("attention"), "_FusedMultiHeadAttention")
+                    .Input(query)
+                    .Input(key)
+                    .Input(value)
+                    .Attr("T", DT_FLOAT)
+                    .Attr("scale", scale)
+                    .Finalize(g, &attention));
+    return g;
+  }
+  Node* scores = test::graph::BatchMatmul(g, query, key, /*adj_x=*/false,
+                                          /*adj_y=*/true);
+  Node* scaled_scores = test::graph::Binary(
+      g, "Mul", scores, test::graph::Constant(g, test::AsScalar<float>(scale)));
+  Node* softmax;
+  TF_CHECK_OK(NodeBuilder(g->NewName("softmax"), "Softmax")
+                  .Input(scaled_scores)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &softmax));
+  test::graph::BatchMatmul(g, softmax, value, /*adj_x=*/false,
+                           /*adj_y=*/false);
+  return g;
+}
+
+#define BM_NAME(NAME, FUSED, B, H, Q, K, D, DEVICE) \
+  BM_##NAME##_##FUSED##_##B##_##H##_##Q##_##K##_##D##_##DEVICE
+
+// clang-format off
+// NOLINTBEGIN
+#define BM_MultiHeadAttention(FUSED, B, H, Q, K, D, DEVICE)                    \
+  static void BM_NAME(MultiHeadAttention, FUSED, B, H, Q, K, D, DEVICE)(       \
+      ::testing::benchmark::State & state) {                                  \
+    test::Benchmark(#DEVICE,                                                  \
+                    MultiHeadAttention(FUSED, B, H, Q, K, D),                 \
+                    /*old_benchmark_api*/ false)                              \
+        .Run(state);                                                          \
+    state.SetItemsProcessed(state.iterations() * B * H * Q * K * D * 2);      \
+  }                                                                           \
+  BENCHMARK(BM_NAME(MultiHeadAttention, FUSED, B, H, Q, K, D, DEVICE))         \
+      ->UseRealTime();
+
+// NOLINTEND
+// clang-format on
+
+BM_MultiHeadAttention(false, 8, 12, 128, 128, 64, cpu);
+BM_MultiHeadAttention(true, 8, 12, 128, 128, 64, cpu);
+BM_MultiHeadAttention(false, 2, 12, 1024, 1024, 64, cpu);
+BM_MultiHeadAttention(true, 2, 12, 1024, 1024, 64, cpu);
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+BM_MultiHeadAttention(false, 8, 12, 128, 128, 64, gpu);
+BM_MultiHeadAttention(true, 8, 12, 128, 128, 64, gpu);
+BM_MultiHeadAttention(false, 2, 12, 1024, 1024, 64, gpu);
+BM_MultiHeadAttention(true, 2, 12, 1024, 1024, 64, gpu);
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+}  // namespace tensorflow
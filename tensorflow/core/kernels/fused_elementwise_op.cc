@@ -0,0 +1,268 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/fused_elementwise_op.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+using CPUDevice = Eigen::ThreadPoolDevice;
+using GPUDevice = Eigen::GpuDevice;
+
+namespace functor {
+
+// The CPU kernel runs the program over blocks of kBlockSize elements at a
+// time, so that each operation is vectorized over a block that stays in L1.
+constexpr int64_t kBlockSize = 1024;
+
+template <typename T>
+struct FusedElementwiseFunctor<CPUDevice, T> {
+  static Status Compute(OpKernelContext* context,
+                        const FusedElementwiseProgram& program,
+                        const FusedElementwiseArgs<T>& args, const T* input,
+                        int64_t size, T* output) {
+    using Array = Eigen::Array<T, Eigen::Dynamic, 1>;
+    using ConstArrayMap = Eigen::Map<const Array>;
+    // NaNs propagate through Relu, Maximum and Minimum, as in their kernels.
+    using MaxOp =
+        Eigen::internal::scalar_max_op<float, float, Eigen::PropagateNaN>;
+    using MinOp =
+        Eigen::internal::scalar_min_op<float, float, Eigen::PropagateNaN>;
+
+    auto work = [&](int64_t start, int64_t limit) {
+      Eigen::ArrayXf values(kBlockSize);
+      Eigen::ArrayXf operand(kBlockSize);
+      for (int64_t block = start; block < limit; ++block) {
+        const int64_t offset = block * kBlockSize;
+        const int64_t n = std::min(kBlockSize, size - offset);
+        auto v = values.head(n);
+        v = ConstArrayMap(input + offset, n).template cast<float>();
+
+        int arg = 0;
+        for (int k = 0; k < program.num_ops; ++k) {
+          const FusedElementwiseOpcode opcode = program.opcodes[k];
+          auto a = operand.head(n);
+          if (IsBinaryOpcode(opcode)) {
+            if (args.is_scalar[arg]) {
+              a.setConstant(static_cast<float>(args.data[arg][0]));
+            } else {
+              a = ConstArrayMap(args.data[arg] + offset, n)
+                      .template cast<float>();
+            }
+            ++arg;
+          }
+          switch (opcode) {
+            case FusedElementwiseOpcode::kAbs:
+              v = v.abs();
+              break;
+            case FusedElementwiseOpcode::kExp:
+              v = v.exp();
+              break;
+            case FusedElementwiseOpcode::kLog:
+              v = v.log();
+              break;
+            case FusedElementwiseOpcode::kNeg:
+              v = -v;
+              break;
+            case FusedElementwiseOpcode::kReciprocal:
+              v = v.inverse();
+              break;
+            case FusedElementwiseOpcode::kRelu:
+              v = v.binaryExpr(Eigen::ArrayXf::Zero(n), MaxOp());
+              break;
+            case FusedElementwiseOpcode::kRsqrt:
+              v = v.rsqrt();
+              break;
+            case FusedElementwiseOpcode::kSigmoid:
+              v = v.logistic();
+              break;
+            case FusedElementwiseOpcode::kSqrt:
+              v = v.sqrt();
+              break;
+            case FusedElementwiseOpcode::kSquare:
+              v = v.square();
+              break;
+            case FusedElementwiseOpcode::kTanh:
+              v = v.tanh();
+              break;
+            case FusedElementwiseOpcode::kAdd:
+              v += a;
+              break;
+            case FusedElementwiseOpcode::kSub:
+              v -= a;
+              break;
+            case FusedElementwiseOpcode::kMul:
+              v *= a;
+              break;
+            case FusedElementwiseOpcode::kDiv:
+              v /= a;
+              break;
+            case FusedElementwiseOpcode::kMaximum:
+              v = v.binaryExpr(a, MaxOp());
+              break;
+            case FusedElementwiseOpcode::kMinimum:
+              v = v.binaryExpr(a, MinOp());
+              break;
+          }
+        }
+        Eigen::Map<Array>(output + offset, n) = v.template cast<T>();
+      }
+    };
+
+    const int64_t num_blocks = (size + kBlockSize - 1) / kBlockSize;
+    const int64_t cost_per_block =
+        kBlockSize * (2 * sizeof(T) + 4 * program.num_ops);
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, num_blocks,
+          cost_per_block, work);
+    return OkStatus();
+  }
+};
+
+}  // namespace functor
+
+template <typename Device, typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    // WARN: This should be consistent with the FusedElementwise pattern of the
+    // remapper.
+    using functor::FusedElementwiseOpcode;
+    static const auto* const kOpcodes =
+        new std::unordered_map<string, FusedElementwiseOpcode>({
+            {"Abs", FusedElementwiseOpcode::kAbs},
+            {"Exp", FusedElementwiseOpcode::kExp},
+            {"Log", FusedElementwiseOpcode::kLog},
+            {"Neg", FusedElementwiseOpcode::kNeg},
+            {"Inv", FusedElementwiseOpcode::kReciprocal},
+            {"Reciprocal", FusedElementwiseOpcode::kReciprocal},
+            {"Relu", FusedElementwiseOpcode::kRelu},
+            {"Rsqrt", FusedElementwiseOpcode::kRsqrt},
+            {"Sigmoid", FusedElementwiseOpcode::kSigmoid},
+            {"Sqrt", FusedElementwiseOpcode::kSqrt},
+            {"Square", FusedElementwiseOpcode::kSquare},
+            {"Tanh", FusedElementwiseOpcode::kTanh},
+            {"Add", FusedElementwiseOpcode::kAdd},
+            {"AddV2", FusedElementwiseOpcode::kAdd},
+            {"Sub", FusedElementwiseOpcode::kSub},
+            {"Mul", FusedElementwiseOpcode::kMul},
+            {"Div", FusedElementwiseOpcode::kDiv},
+            {"RealDiv", FusedElementwiseOpcode::kDiv},
+            {"Maximum", FusedElementwiseOpcode::kMaximum},
+            {"Minimum", FusedElementwiseOpcode::kMinimum},
+        });
+
+    std::vector<string> op_names;
+    OP_REQUIRES_OK(context, context->GetAttr("op_names", &op_names));
+    OP_REQUIRES(context,
+                !op_names.empty() &&
+                    op_names.size() <= functor::kMaxFusedElementwiseOps,
+                errors::InvalidArgument(
+                    "_FusedElementwise supports 1 to ",
+                    functor::kMaxFusedElementwiseOps, " ops, got ",
+                    op_names.size()));
+    int num_binary_ops = 0;
+    for (const string& op_name : op_names) {
+      auto it = kOpcodes->find(op_name);
+      OP_REQUIRES(context, it != kOpcodes->end(),
+                  errors::InvalidArgument(
+                      "Unsupported op in _FusedElementwise: ", op_name));
+      program_.opcodes[program_.num_ops++] = it->second;
+      if (functor::IsBinaryOpcode(it->second)) ++num_binary_ops;
+    }
+    int num_args;
+    OP_REQUIRES_OK(context, context->GetAttr("num_args", &num_args));
+    OP_REQUIRES(context,
+                num_args == num_binary_ops &&
+                    num_args <= functor::kMaxFusedElementwiseArgs,
+                errors::InvalidArgument(
+                    "_FusedElementwise with ", num_binary_ops,
+                    " binary ops must have as many args, and at most ",
+                    functor::kMaxFusedElementwiseArgs, ", got ", num_args));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OpInputList args;
+    OP_REQUIRES_OK(context, context->input_list("args", &args));
+
+    functor::FusedElementwiseArgs<T> program_args;
+    program_args.num_args = args.size();
+    for (int i = 0; i < args.size(); ++i) {
+      const Tensor& arg = args[i];
+      const bool is_scalar = TensorShapeUtils::IsScalar(arg.shape());
+      OP_REQUIRES(context, is_scalar || arg.shape() == input.shape(),
+                  errors::InvalidArgument(
+                      "_FusedElementwise args must be scalars or have the "
+                      "shape of the input ",
+                      input.shape().DebugString(), ", got ",
+                      arg.shape().DebugString(), " for arg ", i));
+      program_args.data[i] = arg.flat<T>().data();
+      program_args.is_scalar[i] = is_scalar;
+    }
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                {0}, 0, input.shape(), &output));
+    if (input.NumElements() == 0) return;
+
+    OP_REQUIRES_OK(context,
+                   functor::FusedElementwiseFunctor<Device, T>::Compute(
+                       context, program_, program_args, input.flat<T>().data(),
+                       input.NumElements(), output->flat<T>().data()));
+  }
+
+ private:
+  functor::FusedElementwiseProgram program_;
+};
+
+#define REGISTER_CPU(T)                                                    \
+  REGISTER_KERNEL_BUILDER(                                                 \
+      Name("_FusedElementwise").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<CPUDevice, T>);
+
+TF_CALL_half(REGISTER_CPU);
+TF_CALL_float(REGISTER_CPU);
+#undef REGISTER_CPU
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+#define REGISTER_GPU(T)                                                    \
+  REGISTER_KERNEL_BUILDER(                                                 \
+      Name("_FusedElementwise").Device(DEVICE_GPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<GPUDevice, T>);
+
+TF_CALL_half(REGISTER_GPU);
+TF_CALL_float(REGISTER_GPU);
+#undef REGISTER_GPU
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+}  // namespace tensorflow
@@ -0,0 +1,87 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_FUSED_ELEMENTWISE_OP_H_
+#define TENSORFLOW_CORE_KERNELS_FUSED_ELEMENTWISE_OP_H_
+
+#include <cstdint>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace functor {
+
+// The operations of a `_FusedElementwise` program. Unary operations replace
+// the running value `v` with `op(v)`, binary operations with `op(v, arg)`,
+// where `arg` is the next unused argument of the program.
+enum class FusedElementwiseOpcode : int8_t {
+  kAbs,
+  kExp,
+  kLog,
+  kNeg,
+  kReciprocal,
+  kRelu,
+  kRsqrt,
+  kSigmoid,
+  kSqrt,
+  kSquare,
+  kTanh,
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+  kMaximum,
+  kMinimum,
+};
+
+EIGEN_DEVICE_FUNC inline bool IsBinaryOpcode(FusedElementwiseOpcode opcode) {
+  return opcode >= FusedElementwiseOpcode::kAdd;
+}
+
+// The limits are kept small so that a program and its arguments can be passed
+// to a GPU kernel by value.
+constexpr int kMaxFusedElementwiseOps = 16;
+constexpr int kMaxFusedElementwiseArgs = 8;
+
+struct FusedElementwiseProgram {
+  int num_ops = 0;
+  FusedElementwiseOpcode opcodes[kMaxFusedElementwiseOps];
+};
+
+// The arguments of the binary operations of a program, in order. An argument
+// either has as many elements as the input, or is a scalar.
+template <typename T>
+struct FusedElementwiseArgs {
+  int num_args = 0;
+  const T* data[kMaxFusedElementwiseArgs];
+  bool is_scalar[kMaxFusedElementwiseArgs];
+};
+
+// Computes `output[i] = program(input[i], args...)` for the `size` elements of
+// `input`. Intermediate values are kept in float.
+template <typename Device, typename T>
+struct FusedElementwiseFunctor {
+  static Status Compute(OpKernelContext* context,
+                        const FusedElementwiseProgram& program,
+                        const FusedElementwiseArgs<T>& args, const T* input,
+                        int64_t size, T* output);
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_FUSED_ELEMENTWISE_OP_H_
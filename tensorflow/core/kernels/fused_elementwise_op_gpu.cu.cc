@@ -0,0 +1,142 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+#define EIGEN_USE_GPU
+
+#include <limits>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/kernels/fused_elementwise_op.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/gpu_kernel_helper.h"
+
+namespace tensorflow {
+
+typedef Eigen::GpuDevice GPUDevice;
+
+// Each thread runs the whole program on its elements, keeping the running
+// value in a register, so the input and each argument are read once and the
+// output is written once. The program is uniform across threads, so the
+// dispatch on the opcodes does not diverge.
+//
+// NaNs propagate through Relu, Maximum and Minimum, as in their kernels.
+// `input` and `output` may alias, so they are not marked __restrict__.
+template <typename T>
+__global__ void FusedElementwiseKernel(
+    const functor::FusedElementwiseProgram program,
+    const functor::FusedElementwiseArgs<T> args, const T* input, int size,
+    T* output) {
+  using functor::FusedElementwiseOpcode;
+  GPU_1D_KERNEL_LOOP(i, size) {
+    float v = static_cast<float>(input[i]);
+    int arg = 0;
+    for (int k = 0; k < program.num_ops; ++k) {
+      const FusedElementwiseOpcode opcode = program.opcodes[k];
+      float a = 0.0f;
+      if (functor::IsBinaryOpcode(opcode)) {
+        a = static_cast<float>(args.data[arg][args.is_scalar[arg] ? 0 : i]);
+        ++arg;
+      }
+      switch (opcode) {
+        case FusedElementwiseOpcode::kAbs:
+          v = fabsf(v);
+          break;
+        case FusedElementwiseOpcode::kExp:
+          v = expf(v);
+          break;
+        case FusedElementwiseOpcode::kLog:
+          v = logf(v);
+          break;
+        case FusedElementwiseOpcode::kNeg:
+          v = -v;
+          break;
+        case FusedElementwiseOpcode::kReciprocal:
+          v = 1.0f / v;
+          break;
+        case FusedElementwiseOpcode::kRelu:
+          v = isnan(v) || v > 0.0f ? v : 0.0f;
+          break;
+        case FusedElementwiseOpcode::kRsqrt:
+          v = rsqrtf(v);
+          break;
+        case FusedElementwiseOpcode::kSigmoid:
+          v = 1.0f / (1.0f + expf(-v));
+          break;
+        case FusedElementwiseOpcode::kSqrt:
+          v = sqrtf(v);
+          break;
+        case FusedElementwiseOpcode::kSquare:
+          v = v * v;
+          break;
+        case FusedElementwiseOpcode::kTanh:
+          v = tanhf(v);
+          break;
+        case FusedElementwiseOpcode::kAdd:
+          v += a;
+          break;
+        case FusedElementwiseOpcode::kSub:
+          v -= a;
+          break;
+        case FusedElementwiseOpcode::kMul:
+          v *= a;
+          break;
+        case FusedElementwiseOpcode::kDiv:
+          v /= a;
+          break;
+        case FusedElementwiseOpcode::kMaximum:
+          v = isnan(v) || v > a ? v : a;
+          break;
+        case FusedElementwiseOpcode::kMinimum:
+          v = isnan(v) || v < a ? v : a;
+          break;
+      }
+    }
+    output[i] = static_cast<T>(v);
+  }
+}
+
+namespace functor {
+
+template <typename T>
+struct FusedElementwiseFunctor<GPUDevice, T> {
+  static Status Compute(OpKernelContext* context,
+                        const FusedElementwiseProgram& program,
+                        const FusedElementwiseArgs<T>& args, const T* input,
+                        int64_t size, T* output) {
+    if (size > std::numeric_limits<int>::max()) {
+      return errors::Unimplemented(
+          "_FusedElementwise on GPU supports at most ",
+          std::numeric_limits<int>::max(), " elements, got ", size);
+    }
+    const GPUDevice& d = context->eigen_device<GPUDevice>();
+    GpuLaunchConfig config =
+        GetGpuLaunchConfig(size, d, FusedElementwiseKernel<T>, 0, 0);
+    return GpuLaunchKernel(FusedElementwiseKernel<T>, config.block_count,
+                           config.thread_per_block, 0, d.stream(), program,
+                           args, input, static_cast<int>(size), output);
+  }
+};
+
+}  // namespace functor
+
+template struct functor::FusedElementwiseFunctor<GPUDevice, Eigen::half>;
+template struct functor::FusedElementwiseFunctor<GPUDevice, float>;
+
+}  // namespace tensorflow
+
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -0,0 +1,111 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(DataType dtype, int num_args,
+                const std::vector<string>& op_names) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("fused", "_FusedElementwise")
+                           .Input(FakeInput(dtype))
+                           .Input(FakeInput(num_args, dtype))
+                           .Attr("num_args", num_args)
+                           .Attr("op_names", op_names)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, UnaryAndBinaryOps) {
+  // Spans several blocks of the CPU kernel, the last one partial.
+  const int size = 2500;
+  TF_ASSERT_OK(MakeOp(DT_FLOAT, 2, {"Mul", "Tanh", "AddV2", "Sigmoid"}));
+  Tensor* x = AddInput(DT_FLOAT, {size});
+  Tensor* y = AddInput(DT_FLOAT, {size});
+  x->flat<float>().setRandom();
+  y->flat<float>().setRandom();
+  AddInputFromArray<float>(TensorShape({}), {0.5f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({size}));
+  test::FillFn<float>(&expected, [&](int i) {
+    const float v = std::tanh(x->flat<float>()(i) * y->flat<float>()(i));
+    return 1.0f / (1.0f + std::exp(-(v + 0.5f)));
+  });
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedElementwiseOpTest, Half) {
+  TF_ASSERT_OK(MakeOp(DT_HALF, 1, {"Square", "Sub", "Relu"}));
+  AddInputFromList<Eigen::half>(TensorShape({2, 2}), {1, -2, 3, 0});
+  AddInputFromList<Eigen::half>(TensorShape({2, 2}), {2, 1, 4, 1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_HALF, TensorShape({2, 2}));
+  test::FillValues<Eigen::half>(&expected, {Eigen::half(0), Eigen::half(3),
+                                            Eigen::half(5), Eigen::half(0)});
+  test::ExpectTensorEqual<Eigen::half>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, MaximumPropagatesNaN) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  TF_ASSERT_OK(MakeOp(DT_FLOAT, 1, {"Maximum", "Neg"}));
+  AddInputFromArray<float>(TensorShape({3}), {1, nan, 3});
+  AddInputFromArray<float>(TensorShape({3}), {nan, 2, 1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const auto output = GetOutput(0)->flat<float>();
+  EXPECT_TRUE(std::isnan(output(0)));
+  EXPECT_TRUE(std::isnan(output(1)));
+  EXPECT_EQ(output(2), -3.0f);
+}
+
+TEST_F(FusedElementwiseOpTest, UnsupportedOp) {
+  Status s = MakeOp(DT_FLOAT, 0, {"Tanh", "Erf"});
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "Erf")) << s;
+}
+
+TEST_F(FusedElementwiseOpTest, MismatchedNumArgs) {
+  Status s = MakeOp(DT_FLOAT, 2, {"Mul", "Tanh"});
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(FusedElementwiseOpTest, MismatchedArgShape) {
+  TF_ASSERT_OK(MakeOp(DT_FLOAT, 1, {"Mul"}));
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "shape of the input"))
+      << s;
+}
+
+}  // namespace tensorflow
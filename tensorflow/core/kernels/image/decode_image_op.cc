@@ -69,6 +69,23 @@ FileFormat ClassifyFileFormat(StringPiece data) {
   return kUnknownFormat;
 }
 
+// Reads the `dct_method` attribute of the JPEG decoding ops.
+Status GetDctMethod(OpKernelConstruction* context, J_DCT_METHOD* dct_method) {
+  string dct_method_attr;
+  TF_RETURN_IF_ERROR(context->GetAttr("dct_method", &dct_method_attr));
+  // The TensorFlow-chosen default for JPEG decoding is IFAST, sacrificing
+  // image quality for speed.
+  if (dct_method_attr.empty() || dct_method_attr == "INTEGER_FAST") {
+    *dct_method = JDCT_IFAST;
+  } else if (dct_method_attr == "INTEGER_ACCURATE") {
+    *dct_method = JDCT_ISLOW;
+  } else {
+    return errors::InvalidArgument(
+        "dct_method must be one of {'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}");
+  }
+  return OkStatus();
+}
+
 // Decode an image. Supported image formats are JPEG, PNG, GIF and BMP. This is
 // a newer version of `DecodeImageOp` for enabling image data parsing to take
 // place in kernels only, reducing security vulnerabilities and redundancy.
@@ -108,21 +125,7 @@ class DecodeImageV2Op : public OpKernel {
       OP_REQUIRES_OK(context,
                      context->GetAttr("acceptable_fraction",
                                       &flags_.min_acceptable_fraction));
-      string dct_method;
-      OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
-      OP_REQUIRES(
-          context,
-          (dct_method.empty() || dct_method == "INTEGER_FAST" ||
-           dct_method == "INTEGER_ACCURATE"),
-          errors::InvalidArgument("dct_method must be one of "
-                                  "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
-      // The TensorFlow-chosen default for JPEG decoding is IFAST, sacrificing
-      // image quality for speed.
-      if (dct_method.empty() || dct_method == "INTEGER_FAST") {
-        flags_.dct_method = JDCT_IFAST;
-      } else if (dct_method == "INTEGER_ACCURATE") {
-        flags_.dct_method = JDCT_ISLOW;
-      }
+      OP_REQUIRES_OK(context, GetDctMethod(context, &flags_.dct_method));
     } else {
       flags_ = jpeg::UncompressFlags();
       flags_.dct_method = JDCT_IFAST;
@@ -743,5 +746,211 @@ void DecodeImageV2Op::DecodeBMP(const uint8* input, const int row_size,
   }
 }
 
+// Decodes a crop window of a JPEG image and bilinearly resizes it. The window
+// is decoded at the smallest DCT scaling factor for which the scaled window is
+// still at least as large as the requested size, so that large crops that
+// are resized to a small size only decode a fraction of the coefficients.
+class DecodeCropAndResizeJpegOp : public OpKernel {
+ public:
+  explicit DecodeCropAndResizeJpegOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+    OP_REQUIRES(context, channels_ == 0 || channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument("`channels` must be 0, 1 or 3 but got ",
+                                        channels_));
+    OP_REQUIRES_OK(context, context->GetAttr("fancy_upscaling",
+                                             &flags_.fancy_upscaling));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("try_recover_truncated",
+                                    &flags_.try_recover_truncated_jpeg));
+    OP_REQUIRES_OK(context, context->GetAttr("acceptable_fraction",
+                                             &flags_.min_acceptable_fraction));
+    OP_REQUIRES_OK(context, GetDctMethod(context, &flags_.dct_method));
+    OP_REQUIRES_OK(context, context->GetAttr("align_corners", &align_corners_));
+    OP_REQUIRES_OK(context, context->GetAttr("half_pixel_centers",
+                                             &half_pixel_centers_));
+    OP_REQUIRES(context, !(align_corners_ && half_pixel_centers_),
+                errors::InvalidArgument("If half_pixel_centers is True, "
+                                        "align_corners must be False."));
+    flags_.components = channels_;
+    flags_.crop = true;
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(
+        context, TensorShapeUtils::IsScalar(contents.shape()),
+        errors::InvalidArgument("`contents` must be scalar but got shape",
+                                contents.shape().DebugString()));
+    const StringPiece input = contents.scalar<tstring>()();
+    OP_REQUIRES(context, !input.empty(),
+                errors::InvalidArgument("Input is empty."));
+    OP_REQUIRES(context, input.size() <= std::numeric_limits<int>::max(),
+                errors::InvalidArgument(
+                    "Input contents are too large for int: ", input.size()));
+    OP_REQUIRES(context, ClassifyFileFormat(input) == kJpgFormat,
+                errors::InvalidArgument(
+                    "DecodeCropAndResizeJpeg operation can run on JPEG only."));
+
+    const Tensor& crop_window = context->input(1);
+    OP_REQUIRES(context,
+                crop_window.dims() == 1 && crop_window.dim_size(0) == 4,
+                errors::InvalidArgument(
+                    "crop_window must be 1-D with four elements, got shape ",
+                    crop_window.shape().DebugString()));
+    const auto crop_window_vec = crop_window.vec<int32>();
+    const int crop_y = crop_window_vec(0);
+    const int crop_x = crop_window_vec(1);
+    const int crop_height = crop_window_vec(2);
+    const int crop_width = crop_window_vec(3);
+
+    const Tensor& size = context->input(2);
+    OP_REQUIRES(context, size.dims() == 1 && size.dim_size(0) == 2,
+                errors::InvalidArgument(
+                    "size must be 1-D with two elements, got shape ",
+                    size.shape().DebugString()));
+    const int out_height = size.vec<int32>()(0);
+    const int out_width = size.vec<int32>()(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("size must be positive, got [",
+                                        out_height, ", ", out_width, "]"));
+
+    int width, height, components;
+    OP_REQUIRES(context,
+                jpeg::GetImageInfo(input.data(), input.size(), &width, &height,
+                                   &components),
+                errors::InvalidArgument("Invalid JPEG data, size ",
+                                        input.size()));
+    OP_REQUIRES(
+        context,
+        crop_y >= 0 && crop_x >= 0 && crop_height > 0 && crop_width > 0 &&
+            static_cast<int64_t>(crop_y) + crop_height <= height &&
+            static_cast<int64_t>(crop_x) + crop_width <= width,
+        errors::InvalidArgument("Invalid crop window [", crop_y, ", ", crop_x,
+                                ", ", crop_height, ", ", crop_width,
+                                "] for image of size ", height, "x", width));
+
+    // Pick the largest downscaling ratio supported by libjpeg that keeps at
+    // least as many pixels as requested in both dimensions.
+    int ratio = 8;
+    while (ratio > 1 && (crop_height / ratio < out_height ||
+                         crop_width / ratio < out_width)) {
+      ratio /= 2;
+    }
+
+    // Map the crop window to the scaled image, rounding outwards so that the
+    // scaled window covers the entire crop window.
+    auto ceil_div = [](int64_t a, int64_t b) { return (a + b - 1) / b; };
+    const int scaled_y = crop_y / ratio;
+    const int scaled_x = crop_x / ratio;
+    const int scaled_height = std::min(ceil_div(crop_y + crop_height, ratio),
+                                       ceil_div(height, ratio)) -
+                              scaled_y;
+    const int scaled_width = std::min(ceil_div(crop_x + crop_width, ratio),
+                                      ceil_div(width, ratio)) -
+                             scaled_x;
+
+    // Use local copy of flags to avoid race condition as the class member is
+    // shared among different invocations.
+    jpeg::UncompressFlags flags = flags_;
+    flags.ratio = ratio;
+    flags.crop_y = scaled_y;
+    flags.crop_x = scaled_x;
+    flags.crop_height = scaled_height;
+    flags.crop_width = scaled_width;
+
+    Tensor decoded;
+    uint8* buffer = jpeg::Uncompress(
+        input.data(), input.size(), flags, nullptr /* nwarn */,
+        [&](int width, int height, int channels) -> uint8* {
+          Status status = context->allocate_temp(
+              DT_UINT8, TensorShape({height, width, channels}), &decoded);
+          if (!status.ok()) {
+            VLOG(1) << status;
+            context->SetStatus(status);
+            return nullptr;
+          }
+          return decoded.flat<uint8>().data();
+        });
+    OP_REQUIRES(
+        context, buffer,
+        errors::InvalidArgument(
+            "jpeg::Uncompress failed. Invalid JPEG data or crop window."));
+
+    const int channels = decoded.dim_size(2);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({out_height, out_width, channels}),
+                       &output));
+
+    std::vector<Interpolation> ys(out_height);
+    ComputeInterpolation(out_height, crop_height, crop_y, ratio, scaled_y,
+                         decoded.dim_size(0), &ys);
+    std::vector<Interpolation> xs(out_width);
+    ComputeInterpolation(out_width, crop_width, crop_x, ratio, scaled_x,
+                         decoded.dim_size(1), &xs);
+
+    const auto in = decoded.tensor<uint8, 3>();
+    auto out = output->tensor<float, 3>();
+    for (int y = 0; y < out_height; ++y) {
+      for (int x = 0; x < out_width; ++x) {
+        for (int c = 0; c < channels; ++c) {
+          const float top_left = in(ys[y].lower, xs[x].lower, c);
+          const float top_right = in(ys[y].lower, xs[x].upper, c);
+          const float bottom_left = in(ys[y].upper, xs[x].lower, c);
+          const float bottom_right = in(ys[y].upper, xs[x].upper, c);
+          const float top = top_left + (top_right - top_left) * xs[x].lerp;
+          const float bottom =
+              bottom_left + (bottom_right - bottom_left) * xs[x].lerp;
+          out(y, x, c) = top + (bottom - top) * ys[y].lerp;
+        }
+      }
+    }
+  }
+
+ private:
+  struct Interpolation {
+    int64_t lower;
+    int64_t upper;
+    float lerp;
+  };
+
+  // Computes the interpolation indices and weights along one dimension. The
+  // sampling positions follow `ResizeBilinear` in the coordinates of the crop
+  // window and are then mapped to the window decoded at 1/`ratio` scale, which
+  // starts at `scaled_offset` and has `scaled_size` pixels.
+  void ComputeInterpolation(int out_size, int crop_size, int crop_offset,
+                            int ratio, int scaled_offset, int64_t scaled_size,
+                            std::vector<Interpolation>* interpolation) const {
+    const float scale = (align_corners_ && out_size > 1)
+                            ? (crop_size - 1) / static_cast<float>(out_size - 1)
+                            : crop_size / static_cast<float>(out_size);
+    for (int i = 0; i < out_size; ++i) {
+      const float in = half_pixel_centers_ ? (i + 0.5f) * scale - 0.5f
+                                           : i * scale;
+      const float scaled =
+          ratio == 1
+              ? in
+              : (crop_offset + in + 0.5f) / ratio - 0.5f - scaled_offset;
+      const float in_floor = std::floor(scaled);
+      auto& entry = (*interpolation)[i];
+      entry.lower = std::min<int64_t>(std::max<int64_t>(in_floor, 0),
+                                      scaled_size - 1);
+      entry.upper = std::min<int64_t>(std::max<int64_t>(std::ceil(scaled), 0),
+                                      scaled_size - 1);
+      entry.lerp = scaled - in_floor;
+    }
+  }
+
+  int channels_ = 0;
+  bool align_corners_ = false;
+  bool half_pixel_centers_ = false;
+  jpeg::UncompressFlags flags_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DecodeCropAndResizeJpeg").Device(DEVICE_CPU),
+                        DecodeCropAndResizeJpegOp);
+
 }  // namespace
 }  // namespace tensorflow
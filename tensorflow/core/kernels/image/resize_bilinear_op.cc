@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/image_resizer_state.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -462,6 +463,192 @@ struct ResizeBilinearGrad<CPUDevice, T> {
 
 }  // namespace functor
 
+namespace {
+// Number of fractional bits of the fixed-point horizontal interpolation
+// weights of the uint8 path. A horizontally interpolated value is below
+// 255 * 2^kFixedPointBits < 2^24, so it converts to float exactly.
+constexpr int kFixedPointBits = 15;
+
+struct FixedPointInterpolation {
+  int64_t lower;  // Offset of the left pixel's first channel in a row.
+  int64_t upper;  // Offset of the right pixel's first channel in a row.
+  int32 weight;   // Weight of the right pixel, in units of 2^-kFixedPointBits.
+};
+
+// Interpolates the uint8 row `in_row` horizontally into `out_row`, which holds
+// out_width * channels values scaled by 2^kFixedPointBits.
+inline void ResizeRowHorizontalUint8(const uint8* in_row,
+                                     const FixedPointInterpolation* xs,
+                                     const int64_t out_width,
+                                     const int channels, int32* out_row) {
+  constexpr int32 kOne = 1 << kFixedPointBits;
+  if (channels == 3) {
+    for (int64_t x = 0; x < out_width; ++x) {
+      const uint8* left = in_row + xs[x].lower;
+      const uint8* right = in_row + xs[x].upper;
+      const int32 w = xs[x].weight;
+      out_row[0] = left[0] * (kOne - w) + right[0] * w;
+      out_row[1] = left[1] * (kOne - w) + right[1] * w;
+      out_row[2] = left[2] * (kOne - w) + right[2] * w;
+      out_row += 3;
+    }
+    return;
+  }
+  for (int64_t x = 0; x < out_width; ++x) {
+    const uint8* left = in_row + xs[x].lower;
+    const uint8* right = in_row + xs[x].upper;
+    const int32 w = xs[x].weight;
+    for (int c = 0; c < channels; ++c) {
+      out_row[c] = left[c] * (kOne - w) + right[c] * w;
+    }
+    out_row += channels;
+  }
+}
+
+// Interpolates two horizontally resized rows vertically and applies
+// `out = value * scale + offset` elementwise; `scale` also undoes the
+// fixed-point scaling. Written as a flat loop over contiguous arrays so that
+// it is vectorized by the compiler.
+inline void ResizeRowVerticalAndNormalize(const int32* top, const int32* bottom,
+                                          const float y_lerp,
+                                          const float* scale,
+                                          const float* offset,
+                                          const int64_t size, float* out) {
+  for (int64_t i = 0; i < size; ++i) {
+    const float t = static_cast<float>(top[i]);
+    const float b = static_cast<float>(bottom[i]);
+    out[i] = (t + (b - t) * y_lerp) * scale[i] + offset[i];
+  }
+}
+}  // namespace
+
+// ResizeBilinear of a uint8 image followed by `(x - mean) * scale`, with
+// `mean` and `scale` either scalars or per-channel vectors. Created by the
+// Grappler remapper from ResizeBilinear + Sub + Mul.
+//
+// Each input row is interpolated horizontally once, in fixed point on the
+// uint8 pixels, and reused by all output rows that read it. Vertical
+// interpolation and normalization then take a single float pass over each
+// output row. Results differ from the unfused ops by at most
+// 255 * 2^-(kFixedPointBits + 1) before scaling.
+class FusedResizeBilinearOp : public OpKernel {
+ public:
+  explicit FusedResizeBilinearOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("align_corners", &align_corners_));
+    OP_REQUIRES_OK(
+        context, context->GetAttr("half_pixel_centers", &half_pixel_centers_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    ImageResizerState st(align_corners_, half_pixel_centers_);
+    st.ValidateAndCreateOutput(context);
+
+    if (!context->status().ok()) return;
+
+    // Return if the output is empty.
+    if (st.output->NumElements() == 0) return;
+
+    const Tensor& mean = context->input(2);
+    const Tensor& scale = context->input(3);
+    const int channels = st.channels;
+    OP_REQUIRES(context,
+                mean.NumElements() == 1 || mean.NumElements() == channels,
+                errors::InvalidArgument("mean must have 1 or ", channels,
+                                        " elements but has ",
+                                        mean.NumElements()));
+    OP_REQUIRES(context,
+                scale.NumElements() == 1 || scale.NumElements() == channels,
+                errors::InvalidArgument("scale must have 1 or ", channels,
+                                        " elements but has ",
+                                        scale.NumElements()));
+
+    const int64_t in_height = st.in_height;
+    const int64_t in_width = st.in_width;
+    const int64_t out_height = st.out_height;
+    const int64_t out_width = st.out_width;
+    const int64_t in_row_size = in_width * channels;
+    const int64_t out_row_size = out_width * channels;
+
+    // Per-element normalization of an output row.
+    const auto mean_flat = mean.flat<float>();
+    const auto scale_flat = scale.flat<float>();
+    std::vector<float> row_scale(out_row_size);
+    std::vector<float> row_offset(out_row_size);
+    for (int64_t i = 0; i < out_row_size; ++i) {
+      const int c = i % channels;
+      const float m = mean_flat(mean.NumElements() == 1 ? 0 : c);
+      const float s = scale_flat(scale.NumElements() == 1 ? 0 : c);
+      row_scale[i] = s / (1 << kFixedPointBits);
+      row_offset[i] = -m * s;
+    }
+
+    std::vector<CachedInterpolation> ys(out_height + 1);
+    std::vector<CachedInterpolation> xs_float(out_width + 1);
+    if (half_pixel_centers_) {
+      compute_interpolation_weights(HalfPixelScaler(), out_height, in_height,
+                                    st.height_scale, ys.data());
+      compute_interpolation_weights(HalfPixelScaler(), out_width, in_width,
+                                    st.width_scale, xs_float.data());
+    } else {
+      compute_interpolation_weights(LegacyScaler(), out_height, in_height,
+                                    st.height_scale, ys.data());
+      compute_interpolation_weights(LegacyScaler(), out_width, in_width,
+                                    st.width_scale, xs_float.data());
+    }
+    std::vector<FixedPointInterpolation> xs(out_width);
+    for (int64_t x = 0; x < out_width; ++x) {
+      xs[x].lower = xs_float[x].lower * channels;
+      xs[x].upper = xs_float[x].upper * channels;
+      xs[x].weight = static_cast<int32>(
+          std::round(xs_float[x].lerp * (1 << kFixedPointBits)));
+    }
+
+    const uint8* images = context->input(0).flat<uint8>().data();
+    float* output = st.output->flat<float>().data();
+
+    // Shards over the output rows of all images. Each shard keeps the last
+    // two horizontally resized input rows, which adjacent output rows share.
+    auto resize_rows = [&](int64_t start, int64_t end) {
+      std::vector<int32> rows(2 * out_row_size);
+      int64_t row_keys[2] = {-1, -1};
+      // Returns the horizontally resized input row `key`, which is
+      // batch * in_height + y, without evicting row `keep`.
+      auto get_row = [&](int64_t key, int64_t keep) -> const int32* {
+        for (int slot = 0; slot < 2; ++slot) {
+          if (row_keys[slot] == key) return rows.data() + slot * out_row_size;
+        }
+        const int slot = row_keys[0] == keep ? 1 : 0;
+        row_keys[slot] = key;
+        int32* row = rows.data() + slot * out_row_size;
+        ResizeRowHorizontalUint8(images + key * in_row_size, xs.data(),
+                                 out_width, channels, row);
+        return row;
+      };
+      for (int64_t i = start; i < end; ++i) {
+        const int64_t b = i / out_height;
+        const int64_t y = i % out_height;
+        const int64_t top_key = b * in_height + ys[y].lower;
+        const int64_t bottom_key = b * in_height + ys[y].upper;
+        const int32* top = get_row(top_key, bottom_key);
+        const int32* bottom = get_row(bottom_key, top_key);
+        ResizeRowVerticalAndNormalize(top, bottom, ys[y].lerp, row_scale.data(),
+                                      row_offset.data(), out_row_size,
+                                      output + i * out_row_size);
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          st.batch_size * out_height, /*cost_per_unit=*/8 * out_row_size,
+          resize_rows);
+  }
+
+ private:
+  bool align_corners_;
+  bool half_pixel_centers_;
+};
+
 #define REGISTER_KERNEL(T)                            \
   REGISTER_KERNEL_BUILDER(Name("ResizeBilinear")      \
                               .Device(DEVICE_CPU)     \
@@ -485,6 +672,12 @@ TF_CALL_bfloat16(REGISTER_GRAD_KERNEL);
 
 #undef REGISTER_GRAD_KERNEL
 
+REGISTER_KERNEL_BUILDER(Name("_FusedResizeBilinear")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<uint8>("T")
+                            .HostMemory("size"),
+                        FusedResizeBilinearOp);
+
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
 #define REGISTER_KERNEL(T)                            \
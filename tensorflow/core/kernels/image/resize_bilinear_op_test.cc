@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -550,6 +551,122 @@ INSTANTIATE_TEST_SUITE_P(ResizeBilinearOpAlignCornersTestGpu,
                          ::testing::Values(TestDevice::GPU));
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+class FusedResizeBilinearOpTest : public OpsTestBase {
+ protected:
+  // Runs _FusedResizeBilinear on a random uint8 image and compares it with
+  // resizing in float followed by `(x - mean) * scale`.
+  void TestFusedResize(int batch_size, int in_height, int in_width,
+                       int channels, int out_height, int out_width,
+                       bool half_pixel_centers, const std::vector<float>& mean,
+                       const std::vector<float>& scale) {
+    TF_ASSERT_OK(
+        NodeDefBuilder("fused_resize_bilinear_op", "_FusedResizeBilinear")
+            .Input(FakeInput(DT_UINT8))
+            .Input(FakeInput(DT_INT32))
+            .Input(FakeInput(DT_FLOAT))
+            .Input(FakeInput(DT_FLOAT))
+            .Attr("half_pixel_centers", half_pixel_centers)
+            .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    std::vector<uint8> images(batch_size * in_height * in_width * channels);
+    for (uint8& value : images) value = rnd.Uniform(256);
+    AddInputFromArray<uint8>(
+        TensorShape({batch_size, in_height, in_width, channels}), images);
+    AddInputFromArray<int32>(TensorShape({2}), {out_height, out_width});
+    AddInputFromArray<float>(TensorShape({static_cast<int64_t>(mean.size())}),
+                             mean);
+    AddInputFromArray<float>(TensorShape({static_cast<int64_t>(scale.size())}),
+                             scale);
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected(DT_FLOAT,
+                    TensorShape({batch_size, out_height, out_width, channels}));
+    auto expected_t = expected.tensor<float, 4>();
+    const float height_scale = in_height / static_cast<float>(out_height);
+    const float width_scale = in_width / static_cast<float>(out_width);
+    auto pixel = [&](int b, int64_t y, int64_t x, int c) -> float {
+      return images[((b * in_height + y) * in_width + x) * channels + c];
+    };
+    for (int b = 0; b < batch_size; ++b) {
+      for (int64_t y = 0; y < out_height; ++y) {
+        const float in_y =
+            half_pixel_centers
+                ? (static_cast<float>(y) + 0.5f) * height_scale - 0.5f
+                : y * height_scale;
+        const int64_t top = std::max(static_cast<int64_t>(floorf(in_y)),
+                                     static_cast<int64_t>(0));
+        const int64_t bottom = std::min(static_cast<int64_t>(ceilf(in_y)),
+                                        static_cast<int64_t>(in_height - 1));
+        const float y_lerp = in_y - std::floor(in_y);
+        for (int64_t x = 0; x < out_width; ++x) {
+          const float in_x =
+              half_pixel_centers
+                  ? (static_cast<float>(x) + 0.5f) * width_scale - 0.5f
+                  : x * width_scale;
+          const int64_t left = std::max(static_cast<int64_t>(floorf(in_x)),
+                                        static_cast<int64_t>(0));
+          const int64_t right = std::min(static_cast<int64_t>(ceilf(in_x)),
+                                         static_cast<int64_t>(in_width - 1));
+          const float x_lerp = in_x - std::floor(in_x);
+          for (int c = 0; c < channels; ++c) {
+            const float top_value =
+                pixel(b, top, left, c) +
+                (pixel(b, top, right, c) - pixel(b, top, left, c)) * x_lerp;
+            const float bottom_value =
+                pixel(b, bottom, left, c) +
+                (pixel(b, bottom, right, c) - pixel(b, bottom, left, c)) *
+                    x_lerp;
+            const float value = top_value + (bottom_value - top_value) * y_lerp;
+            expected_t(b, y, x, c) =
+                (value - mean[mean.size() == 1 ? 0 : c]) *
+                scale[scale.size() == 1 ? 0 : c];
+          }
+        }
+      }
+    }
+    // The fixed-point horizontal weights are off by at most 2^-16.
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+  }
+};
+
+TEST_F(FusedResizeBilinearOpTest, Upsample3Channels) {
+  TestFusedResize(2, 11, 13, 3, 29, 31, /*half_pixel_centers=*/true,
+                  {123.68f, 116.78f, 103.94f}, {0.017f, 0.0175f, 0.0174f});
+}
+
+TEST_F(FusedResizeBilinearOpTest, Downsample1Channel) {
+  TestFusedResize(1, 40, 37, 1, 9, 8, /*half_pixel_centers=*/false, {127.5f},
+                  {1.0f / 127.5f});
+}
+
+TEST_F(FusedResizeBilinearOpTest, SameSize4Channels) {
+  TestFusedResize(3, 6, 5, 4, 6, 5, /*half_pixel_centers=*/true, {0.0f},
+                  {1.0f / 255.0f});
+}
+
+TEST_F(FusedResizeBilinearOpTest, InvalidMean) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("fused_resize_bilinear_op", "_FusedResizeBilinear")
+          .Input(FakeInput(DT_UINT8))
+          .Input(FakeInput(DT_INT32))
+          .Input(FakeInput(DT_FLOAT))
+          .Input(FakeInput(DT_FLOAT))
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<uint8>(TensorShape({1, 2, 2, 3}),
+                           {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  AddInputFromArray<int32>(TensorShape({2}), {4, 4});
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({}), {1});
+  Status s = RunOpKernel();
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+  EXPECT_TRUE(absl::StrContains(s.error_message(), "mean must have 1 or 3"))
+      << s;
+}
+
 class ResizeBM : public ResizeBilinearOpTest {
  public:
   void TestBody() override {}
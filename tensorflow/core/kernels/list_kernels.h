@@ -20,6 +20,8 @@ limitations under the License.
 #define EIGEN_USE_GPU
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+#include <algorithm>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -115,6 +117,60 @@ inline void CopyTensor(OpKernelContext* ctx, Tensor& src, Tensor& dst) {
   dst_t.device(ctx->eigen_device<Device>()) = src_t;
 }
 
+// Returns true if the slices of `t` along its first dimension can be used as
+// list elements without copying them, i.e. if they are all aligned and hold
+// plain data that the list may share with `t`.
+inline bool CanUseSlicesAsElements(const Tensor& t) {
+  if (!DataTypeCanUseMemcpy(t.dtype()) || !t.IsAligned()) return false;
+  if (t.dims() == 0 || t.dim_size(0) == 0) return false;
+  const int64_t element_bytes =
+      t.NumElements() / t.dim_size(0) * DataTypeSize(t.dtype());
+  return element_bytes % std::max(EIGEN_MAX_ALIGN_BYTES, 1) == 0;
+}
+
+// Returns slice `i` of `t` along its first dimension with that dimension
+// removed.
+inline Tensor ElementSlice(const Tensor& t, int64_t i) {
+  Tensor slice = t.Slice(i, i + 1);
+  TensorShape element_shape = slice.shape();
+  element_shape.RemoveDim(0);
+  Tensor element;
+  CHECK(element.CopyFrom(slice, element_shape));  // Crash OK.
+  return element;
+}
+
+// If elements [begin, end) of `list` are still the consecutive slices of its
+// storage that they were created as, sets `*view` to those slices of the
+// storage and returns true. Stacking or gathering them then needs no copy.
+inline bool GetStorageView(const TensorList& list, int64_t begin, int64_t end,
+                           const TensorShape& element_shape, Tensor* view) {
+  const Tensor& storage = list.storage();
+  if (begin < 0 || begin >= end ||
+      end > static_cast<int64_t>(list.tensors().size()) ||
+      storage.dims() == 0 || end > storage.dim_size(0) ||
+      storage.dtype() != list.element_dtype) {
+    return false;
+  }
+  TensorShape storage_element_shape = storage.shape();
+  storage_element_shape.RemoveDim(0);
+  if (storage_element_shape != element_shape ||
+      element_shape.num_elements() == 0) {
+    return false;
+  }
+  const int64_t element_bytes =
+      element_shape.num_elements() * DataTypeSize(storage.dtype());
+  const char* base = storage.tensor_data().data();
+  for (int64_t i = begin; i < end; ++i) {
+    const Tensor& t = list.tensors()[i];
+    if (t.dtype() != storage.dtype() || t.shape() != element_shape ||
+        t.tensor_data().data() != base + i * element_bytes) {
+      return false;
+    }
+  }
+  *view = storage.Slice(begin, end);
+  return true;
+}
+
 template <typename T>
 void ConcatPluggableDevice(
     OpKernelContext* context,
@@ -216,6 +272,14 @@ class TensorListStack : public OpKernel {
                     partial_element_shape.DebugString()));
     TensorShape output_shape = element_shape;
     output_shape.InsertDim(0, tensor_list->tensors().size());
+    // A list built from a tensor and not modified since is stacked by
+    // returning that tensor.
+    Tensor view;
+    if (GetStorageView(*tensor_list, 0, tensor_list->tensors().size(),
+                       element_shape, &view)) {
+      c->set_output(0, view);
+      return;
+    }
     Tensor* output;
     OP_REQUIRES_OK(c, c->allocate_output(0, output_shape, &output));
     if (output->NumElements() == 0) {
@@ -704,6 +768,21 @@ class TensorListGather : public OpKernel {
                                 partial_element_shape.DebugString()));
     TensorShape output_shape = element_shape;
     output_shape.InsertDim(0, indices.NumElements());
+    // Gathering a contiguous range of elements that are still slices of the
+    // list's storage returns those slices without copying them.
+    const auto indices_flat = indices.flat<int32>();
+    bool is_range = indices.NumElements() > 0;
+    for (int index = 1; is_range && index < indices.NumElements(); ++index) {
+      is_range = indices_flat(index) == indices_flat(0) + index;
+    }
+    Tensor view;
+    if (is_range &&
+        GetStorageView(*tensor_list, indices_flat(0),
+                       int64_t{indices_flat(0)} + indices.NumElements(),
+                       element_shape, &view)) {
+      c->set_output(0, view);
+      return;
+    }
     Tensor* output;
     OP_REQUIRES_OK(c, c->allocate_output(0, output_shape, &output));
     if (output->NumElements() == 0) {
@@ -785,6 +864,17 @@ class TensorListFromTensor : public OpKernel {
     output_list.element_shape = element_shape;
     output_list.tensors().reserve(t.shape().dim_size(0));
 
+    if (CanUseSlicesAsElements(t)) {
+      // The elements share the buffer of `t`, which saves allocating and
+      // copying each of them and lets the list be stacked without a copy.
+      for (int i = 0; i < t.shape().dim_size(0); ++i) {
+        output_list.tensors().push_back(ElementSlice(t, i));
+      }
+      output_list.storage() = t;
+      output_tensor->scalar<Variant>()() = std::move(output_list);
+      return;
+    }
+
     const auto copy_tensor = IsPluggableDevice(c)
                                  ? &CopyTensorPluggableDevice<T>
                                  : &CopyTensor<Device, T>;
@@ -812,8 +902,13 @@ Status Scatter(OpKernelContext* c, const Tensor& value, const Tensor& indices,
                TensorList* list) {
   const auto copy_tensor = IsPluggableDevice(c) ? &CopyTensorPluggableDevice<T>
                                                 : &CopyTensor<Device, T>;
+  const bool use_slices = CanUseSlicesAsElements(value);
   for (int index = 0; index < indices.NumElements(); ++index) {
     const int i = indices.flat<int32>()(index);
+    if (use_slices) {
+      list->tensors()[i] = ElementSlice(value, index);
+      continue;
+    }
     Tensor tmp = value.Slice(index, index + 1);
     TensorShape tmp_shape = tmp.shape();
     tmp_shape.RemoveDim(0);
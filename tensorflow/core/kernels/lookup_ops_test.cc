@@ -19,12 +19,15 @@ limitations under the License.
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +103,145 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+TEST_F(LookupOpsTest, ConcurrentMutableHashTable_ConcurrentInsertAndFind) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("concurrent_hash_table", "ConcurrentMutableHashTable")
+          .Attr("key_dtype", DT_INT64)
+          .Attr("value_dtype", DT_INT64)
+          .Attr("num_shards", 4)
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  lookup::LookupInterface* table;
+  TF_ASSERT_OK(LookupResource(context_.get(), handle, &table));
+  core::ScopedUnref unref(table);
+
+  constexpr int kNumThreads = 8;
+  constexpr int kKeysPerThread = 1000;
+  {
+    thread::ThreadPool pool(Env::Default(), "insert", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([this, table, t]() {
+        Tensor keys(DT_INT64, TensorShape({kKeysPerThread}));
+        Tensor values(DT_INT64, TensorShape({kKeysPerThread}));
+        for (int i = 0; i < kKeysPerThread; ++i) {
+          keys.flat<int64_t>()(i) = t * kKeysPerThread + i;
+          values.flat<int64_t>()(i) = 2 * (t * kKeysPerThread + i);
+        }
+        TF_EXPECT_OK(table->Insert(context_.get(), keys, values));
+        Tensor found(DT_INT64, TensorShape({kKeysPerThread}));
+        TF_EXPECT_OK(table->Find(context_.get(), keys, &found,
+                                 test::AsScalar<int64_t>(-1)));
+        for (int i = 0; i < kKeysPerThread; ++i) {
+          EXPECT_EQ(values.flat<int64_t>()(i), found.flat<int64_t>()(i));
+        }
+      });
+    }
+  }
+  EXPECT_EQ(kNumThreads * kKeysPerThread, table->size());
+
+  // Duplicate keys in one batch keep the last value; missing keys use the
+  // default.
+  TF_ASSERT_OK(table->Insert(context_.get(), test::AsTensor<int64_t>({7, 7}),
+                             test::AsTensor<int64_t>({1, 2})));
+  TF_ASSERT_OK(table->Remove(context_.get(), test::AsTensor<int64_t>({8})));
+  Tensor found(DT_INT64, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(context_.get(),
+                           test::AsTensor<int64_t>({7, 8, 9}), &found,
+                           test::AsScalar<int64_t>(-1)));
+  test::ExpectTensorEqual<int64_t>(test::AsTensor<int64_t>({2, -1, 18}),
+                                   found);
+}
+
+TEST_F(LookupOpsTest, DynamicEmbeddingTable_AdmissionAndEviction) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("dynamic_embedding_table", "DynamicEmbeddingTable")
+          .Attr("key_dtype", DT_INT64)
+          .Attr("value_dtype", DT_FLOAT)
+          .Attr("value_shape", TensorShape({2}))
+          .Attr("admission_threshold", 2)
+          .Attr("max_entries", 2)
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  lookup::LookupInterface* table;
+  TF_ASSERT_OK(LookupResource(context_.get(), handle, &table));
+  core::ScopedUnref unref(table);
+
+  auto insert = [&](std::initializer_list<int64_t> keys) {
+    const int64_t num_keys = keys.size();
+    Tensor values(DT_FLOAT, TensorShape({num_keys, 2}));
+    int64_t i = 0;
+    for (int64_t key : keys) {
+      values.matrix<float>()(i, 0) = key;
+      values.matrix<float>()(i, 1) = -key;
+      ++i;
+    }
+    TF_ASSERT_OK(
+        table->Insert(context_.get(), test::AsTensor<int64_t>(keys), values));
+  };
+
+  // Keys are admitted on their second insert.
+  insert({1, 2, 3});
+  EXPECT_EQ(0, table->size());
+  insert({1, 1, 2});
+  EXPECT_EQ(2, table->size());
+
+  // Admitting a third key exceeds max_entries; the least frequently inserted
+  // key (2) is evicted.
+  insert({3});
+  EXPECT_EQ(2, table->size());
+  Tensor found(DT_FLOAT, TensorShape({3, 2}));
+  TF_ASSERT_OK(table->Find(context_.get(), test::AsTensor<int64_t>({1, 2, 3}),
+                           &found, test::AsTensor<float>({0, 0})));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({1, -1, 0, 0, 3, -3}, TensorShape({3, 2})), found);
+}
+
+TEST_F(LookupOpsTest, DynamicEmbeddingTable_EvictionAgesFrequencies) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("dynamic_embedding_table", "DynamicEmbeddingTable")
+          .Attr("key_dtype", DT_INT64)
+          .Attr("value_dtype", DT_FLOAT)
+          .Attr("value_shape", TensorShape({1}))
+          .Attr("admission_threshold", 1)
+          .Attr("max_entries", 2)
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  const ResourceHandle& handle = GetOutput(0)->scalar<ResourceHandle>()();
+  lookup::LookupInterface* table;
+  TF_ASSERT_OK(LookupResource(context_.get(), handle, &table));
+  core::ScopedUnref unref(table);
+
+  auto insert = [&](std::initializer_list<int64_t> keys) {
+    const int64_t num_keys = keys.size();
+    Tensor values(DT_FLOAT, TensorShape({num_keys, 1}));
+    int64_t i = 0;
+    for (int64_t key : keys) {
+      values.matrix<float>()(i++, 0) = key;
+    }
+    TF_ASSERT_OK(
+        table->Insert(context_.get(), test::AsTensor<int64_t>(keys), values));
+  };
+
+  // Key 1 is hot, then stops being inserted while keys 2 and 3 take turns.
+  insert({1, 1, 1, 1, 1, 1, 1, 1});
+  insert({2, 2});
+  for (int i = 0; i < 2; ++i) {
+    insert({3, 3});
+    insert({2, 2});
+  }
+  // Each eviction halved the count of key 1, so it was eventually evicted.
+  EXPECT_EQ(2, table->size());
+  Tensor found(DT_FLOAT, TensorShape({3, 1}));
+  TF_ASSERT_OK(table->Find(context_.get(), test::AsTensor<int64_t>({1, 2, 3}),
+                           &found, test::AsTensor<float>({0})));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, 2, 3}, TensorShape({3, 1})), found);
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -16,16 +16,23 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/random.h"
 
 namespace tensorflow {
@@ -878,6 +885,610 @@ class MutableDenseHashTable final : public LookupInterface {
   uint64 deleted_key_hash_;
 };
 
+// Hashes keys for ConcurrentMutableHashTableOfScalars. The shard of a key is
+// picked from a remix of this hash; see `ShardIndex`.
+template <class K>
+struct ConcurrentKeyHash {
+  size_t operator()(const K& key) const { return absl::Hash<K>()(key); }
+};
+
+template <>
+struct ConcurrentKeyHash<tstring> {
+  size_t operator()(const tstring& key) const {
+    return Hash64(key.data(), key.size());
+  }
+};
+
+// Lookup table with the same semantics as MutableHashTableOfScalars, but split
+// into `num_shards` independently locked absl::flat_hash_maps so that lookups
+// and inserts from many threads do not contend on a single mutex.
+//
+// Find, Insert and Remove first bucket the batch by shard and then visit each
+// shard once under its lock, prefetching the slots of upcoming keys while
+// probing the current one. Within a shard, keys are visited in batch order, so
+// duplicate keys in one Insert keep last-write-wins semantics. Import and
+// Export lock all shards, so they observe and replace the table atomically.
+template <class K, class V>
+class ConcurrentMutableHashTableOfScalars final : public LookupInterface {
+ public:
+  ConcurrentMutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "num_shards", &num_shards_));
+    OP_REQUIRES(ctx, num_shards_ > 0,
+                errors::InvalidArgument("num_shards must be positive, got: ",
+                                        num_shards_));
+    shards_.reset(new Shard[num_shards_]);
+  }
+
+  size_t size() const override {
+    size_t total = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      tf_shared_lock l(shards_[s].mu);
+      total += shards_[s].table.size();
+    }
+    return total;
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionByShard(key_values, &order, &offsets);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+        if (j + kPrefetchDistance < offsets[s + 1]) {
+          shard.table.prefetch(key_values(order[j + kPrefetchDistance]));
+        }
+        const int64_t i = order[j];
+        auto it = shard.table.find(SubtleMustCopyIfIntegral(key_values(i)));
+        if (it != shard.table.end()) {
+          value_values(i) = it->second;
+        } else {
+          value_values(i) =
+              is_full_size_default ? default_flat(i) : default_flat(0);
+        }
+      }
+    }
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionByShard(key_values, &order, &offsets);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      InsertRange(key_values, value_values, order, offsets[s], offsets[s + 1],
+                  &shards_[s].table);
+    }
+    return OkStatus();
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionByShard(key_values, &order, &offsets);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+        shards_[s].table.erase(SubtleMustCopyIfIntegral(key_values(order[j])));
+      }
+    }
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionByShard(key_values, &order, &offsets);
+    std::vector<std::unique_ptr<mutex_lock>> locks;
+    locks.reserve(num_shards_);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      locks.emplace_back(new mutex_lock{shards_[s].mu});
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      shards_[s].table.clear();
+      InsertRange(key_values, value_values, order, offsets[s], offsets[s + 1],
+                  &shards_[s].table);
+    }
+    return OkStatus();
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    std::vector<std::unique_ptr<tf_shared_lock>> locks = LockAllShared();
+    int64_t size = SizeLocked();
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+    ExportKeysAndValues(keys, values);
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64_t MemoryUsed() const override {
+    int64_t ret = sizeof(ConcurrentMutableHashTableOfScalars) +
+                  num_shards_ * sizeof(Shard);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      tf_shared_lock l(shards_[s].mu);
+      // One control byte plus one slot per bucket.
+      ret += shards_[s].table.capacity() *
+             (1 + sizeof(typename ShardTable::value_type));
+    }
+    return ret;
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    std::vector<std::unique_ptr<tf_shared_lock>> locks = LockAllShared();
+    int64_t size = SizeLocked();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size}));
+    ExportKeysAndValues(&keys, &values);
+
+    // See MutableHashTableOfScalars::AsGraphDef for why the node name is
+    // shared.
+    Node* table = ops::SourceOp(
+        "ConcurrentMutableHashTable",
+        builder->opts()
+            .WithName(UniqueNodeName("ConcurrentMutableHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("num_shards", num_shards_));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return OkStatus();
+  }
+
+ private:
+  using ShardTable = absl::flat_hash_map<K, V, ConcurrentKeyHash<K>>;
+
+  // Number of keys ahead of the current one whose slots Find prefetches.
+  static constexpr int64_t kPrefetchDistance = 8;
+
+  // Seed of the remix of key hashes that picks their shard.
+  static constexpr uint64 kShardHashSeed = 0x5bd1e9955bd1e995ULL;
+
+  // Each shard sits on its own cache line so that locking one shard does not
+  // invalidate its neighbours.
+  struct alignas(64) Shard {
+    mutable mutex mu;
+    ShardTable table TF_GUARDED_BY(mu);
+  };
+
+  int64_t ShardIndex(const K& key) const {
+    // flat_hash_map uses all of the hash: its 7 low bits tag the slot and the
+    // rest pick the probe start. Picking the shard from any of those bits
+    // would leave them constant within a shard, so the hash is remixed first.
+    return FingerprintCat64(kShardHashSeed, ConcurrentKeyHash<K>()(key)) %
+           static_cast<uint64>(num_shards_);
+  }
+
+  // Computes a permutation `order` of [0, keys.size()) that groups keys by
+  // shard while keeping batch order within a shard. The keys of shard `s` are
+  // order[offsets[s]] .. order[offsets[s + 1] - 1].
+  template <typename KeyFlat>
+  void PartitionByShard(const KeyFlat& keys, std::vector<int64_t>* order,
+                        std::vector<int64_t>* offsets) const {
+    const int64_t num_keys = keys.size();
+    std::vector<int64_t> key_shards(num_keys);
+    offsets->assign(num_shards_ + 1, 0);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      key_shards[i] = ShardIndex(keys(i));
+      ++(*offsets)[key_shards[i] + 1];
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      (*offsets)[s + 1] += (*offsets)[s];
+    }
+    std::vector<int64_t> next(offsets->begin(), offsets->end() - 1);
+    order->resize(num_keys);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      (*order)[next[key_shards[i]]++] = i;
+    }
+  }
+
+  template <typename KeyFlat, typename ValueFlat>
+  static void InsertRange(const KeyFlat& keys, const ValueFlat& values,
+                          const std::vector<int64_t>& order, int64_t begin,
+                          int64_t end, ShardTable* table) {
+    for (int64_t j = begin; j < end; ++j) {
+      const int64_t i = order[j];
+      gtl::InsertOrUpdate(table, SubtleMustCopyIfIntegral(keys(i)),
+                          SubtleMustCopyIfIntegral(values(i)));
+    }
+  }
+
+  std::vector<std::unique_ptr<tf_shared_lock>> LockAllShared() const {
+    std::vector<std::unique_ptr<tf_shared_lock>> locks;
+    locks.reserve(num_shards_);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      locks.emplace_back(new tf_shared_lock{shards_[s].mu});
+    }
+    return locks;
+  }
+
+  // REQUIRES: all shards are locked.
+  int64_t SizeLocked() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    int64_t size = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      size += shards_[s].table.size();
+    }
+    return size;
+  }
+
+  // Writes all keys and values into `keys` and `values`, which must have
+  // SizeLocked() elements.
+  // REQUIRES: all shards are locked.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64_t i = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      for (const auto& kv : shards_[s].table) {
+        keys_data(i) = kv.first;
+        values_data(i) = kv.second;
+        ++i;
+      }
+    }
+  }
+
+  int64_t num_shards_ = 0;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Lookup table for embeddings over an unbounded id space. Values are vectors
+// of shape `value_shape`, as in MutableHashTableOfTensors, but the table
+// bounds its own size:
+//
+//  * Admission: a key that is not in the table is only added once it has been
+//    inserted `admission_threshold` times. Until then its count is kept in a
+//    candidate map, whose counts are halved whenever it outgrows the table
+//    budget so that rare ids are forgotten.
+//  * TTL: when `ttl_seconds` > 0, entries that have not been inserted for that
+//    long are dropped. The sweep runs at most once every `ttl_seconds`.
+//  * Budget: when `max_entries` > 0 and an Insert grows the table past it, the
+//    least frequently inserted entries (oldest first on ties) are evicted
+//    until the table holds 90% of `max_entries`, which amortizes the scan
+//    over the following inserts. The counts of the remaining entries are then
+//    halved, so that keys which used to be hot do not outrank current ones
+//    forever.
+//
+// Find does not change any statistics and runs under a shared lock. Import
+// admits every key directly, and Export writes only keys and values, so it is
+// compatible with the existing LookupTableExport/Import based checkpointing.
+template <class K, class V>
+class DynamicEmbeddingTable final : public LookupInterface {
+ public:
+  DynamicEmbeddingTable(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(value_shape_),
+        errors::InvalidArgument("Default value must be a vector, got shape ",
+                                value_shape_.DebugString()));
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "admission_threshold",
+                                    &admission_threshold_));
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "max_entries", &max_entries_));
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "ttl_seconds", &ttl_seconds_));
+    OP_REQUIRES(ctx, admission_threshold_ > 0 && max_entries_ >= 0 &&
+                         ttl_seconds_ >= 0,
+                errors::InvalidArgument(
+                    "admission_threshold must be positive and max_entries "
+                    "and ttl_seconds must be non-negative, got: ",
+                    admission_threshold_, ", ", max_entries_, ", ",
+                    ttl_seconds_));
+  }
+
+  size_t size() const override {
+    tf_shared_lock l(mu_);
+    return table_.size();
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto default_flat = default_value.flat_inner_dims<V, 2>();
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat_inner_dims<V, 2>();
+    const int64_t value_dim = value_shape_.dim_size(0);
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    tf_shared_lock l(mu_);
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      auto it = table_.find(SubtleMustCopyIfIntegral(key_values(i)));
+      for (int64_t j = 0; j < value_dim; j++) {
+        if (it != table_.end()) {
+          value_values(i, j) = it->second.value[j];
+        } else {
+          value_values(i, j) =
+              is_full_size_default ? default_flat(i, j) : default_flat(0, j);
+        }
+      }
+    }
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    const int64_t now_micros = Env::Default()->NowMicros();
+
+    mutex_lock l(mu_);
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      const K key = SubtleMustCopyIfIntegral(key_values(i));
+      auto it = table_.find(key);
+      if (it == table_.end()) {
+        int64_t frequency = 1;
+        if (admission_threshold_ > 1) {
+          frequency = ++candidates_[key];
+          if (frequency < admission_threshold_) continue;
+          candidates_.erase(key);
+        }
+        it = table_.emplace(key, Entry()).first;
+        it->second.frequency = frequency;
+      } else {
+        ++it->second.frequency;
+      }
+      SetValue(value_values, i, &it->second);
+      it->second.last_update_micros = now_micros;
+    }
+    MaybeDecayCandidates();
+    MaybeExpire(now_micros);
+    MaybeEvict();
+    return OkStatus();
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+
+    mutex_lock l(mu_);
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      const K key = SubtleMustCopyIfIntegral(key_values(i));
+      table_.erase(key);
+      candidates_.erase(key);
+    }
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    const int64_t now_micros = Env::Default()->NowMicros();
+
+    mutex_lock l(mu_);
+    table_.clear();
+    candidates_.clear();
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      Entry& entry = table_[SubtleMustCopyIfIntegral(key_values(i))];
+      SetValue(value_values, i, &entry);
+      entry.frequency = admission_threshold_;
+      entry.last_update_micros = now_micros;
+    }
+    MaybeEvict();
+    return OkStatus();
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    tf_shared_lock l(mu_);
+    int64_t size = table_.size();
+    int64_t value_dim = value_shape_.dim_size(0);
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(ctx->allocate_output(
+        "values", TensorShape({size, value_dim}), &values));
+    ExportKeysAndValues(keys, values);
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return value_shape_; }
+
+  int64_t MemoryUsed() const override {
+    tf_shared_lock l(mu_);
+    const int64_t value_bytes = value_shape_.num_elements() * sizeof(V);
+    return sizeof(DynamicEmbeddingTable) +
+           table_.capacity() *
+               (1 + sizeof(typename EntryMap::value_type) + value_bytes) +
+           candidates_.capacity() *
+               (1 + sizeof(typename CandidateMap::value_type));
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    tf_shared_lock l(mu_);
+    int64_t size = table_.size();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
+    ExportKeysAndValues(&keys, &values);
+
+    // See MutableHashTableOfScalars::AsGraphDef for why the node name is
+    // shared.
+    Node* table = ops::SourceOp(
+        "DynamicEmbeddingTable",
+        builder->opts()
+            .WithName(UniqueNodeName("DynamicEmbeddingTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("value_shape", value_shape_)
+            .WithAttr("admission_threshold", admission_threshold_)
+            .WithAttr("max_entries", max_entries_)
+            .WithAttr("ttl_seconds", ttl_seconds_));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return OkStatus();
+  }
+
+ private:
+  // Upper bound on the candidate map when the table itself is unbounded.
+  static constexpr int64_t kDefaultMaxCandidates = 1 << 20;
+
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  struct Entry {
+    ValueArray value;
+    // Number of inserts of this key, including those before admission.
+    int64_t frequency = 0;
+    int64_t last_update_micros = 0;
+  };
+
+  using EntryMap = absl::flat_hash_map<K, Entry, ConcurrentKeyHash<K>>;
+  using CandidateMap = absl::flat_hash_map<K, int64_t, ConcurrentKeyHash<K>>;
+
+  template <typename ValueMatrix>
+  void SetValue(const ValueMatrix& values, int64_t row, Entry* entry) const {
+    const int64_t value_dim = value_shape_.dim_size(0);
+    entry->value.resize(value_dim);
+    for (int64_t j = 0; j < value_dim; j++) {
+      entry->value[j] = values(row, j);
+    }
+  }
+
+  // Halves the candidate counts, dropping those that reach zero, once the
+  // candidate map outgrows the table budget.
+  void MaybeDecayCandidates() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const int64_t max_candidates =
+        max_entries_ > 0 ? max_entries_ : kDefaultMaxCandidates;
+    if (candidates_.size() <= max_candidates) return;
+    for (auto it = candidates_.begin(); it != candidates_.end();) {
+      it->second /= 2;
+      if (it->second == 0) {
+        candidates_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void MaybeExpire(int64_t now_micros) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (ttl_seconds_ == 0 || now_micros < next_expiration_micros_) return;
+    const int64_t ttl_micros =
+        ttl_seconds_ * static_cast<int64_t>(EnvTime::kSecondsToMicros);
+    next_expiration_micros_ = now_micros + ttl_micros;
+    for (auto it = table_.begin(); it != table_.end();) {
+      if (now_micros - it->second.last_update_micros > ttl_micros) {
+        table_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void MaybeEvict() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (max_entries_ == 0 || table_.size() <= max_entries_) return;
+    const int64_t target = max_entries_ - max_entries_ / 10;
+    const int64_t num_evicted = table_.size() - target;
+    // (frequency, last update) of every entry; the smallest are evicted.
+    std::vector<std::pair<std::pair<int64_t, int64_t>, K>> ranked;
+    ranked.reserve(table_.size());
+    for (const auto& kv : table_) {
+      ranked.push_back(
+          {{kv.second.frequency, kv.second.last_update_micros}, kv.first});
+    }
+    std::nth_element(ranked.begin(), ranked.begin() + num_evicted,
+                     ranked.end());
+    for (int64_t i = 0; i < num_evicted; ++i) {
+      table_.erase(ranked[i].second);
+    }
+    // Ages the counts, as MaybeDecayCandidates does for candidates.
+    for (auto& kv : table_) {
+      kv.second.frequency /= 2;
+    }
+  }
+
+  // Writes all keys and values into `keys` and `values`. `keys` and `values`
+  // must point to tensors of size `table_.size()`.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
+      TF_SHARED_LOCKS_REQUIRED(mu_) {
+    int64_t value_dim = value_shape_.dim_size(0);
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->matrix<V>();
+    int64_t i = 0;
+    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
+      keys_data(i) = it->first;
+      for (int64_t j = 0; j < value_dim; j++) {
+        values_data(i, j) = it->second.value[j];
+      }
+    }
+  }
+
+  TensorShape value_shape_;
+  int64_t admission_threshold_ = 1;
+  int64_t max_entries_ = 0;
+  int64_t ttl_seconds_ = 0;
+  mutable mutex mu_;
+  EntryMap table_ TF_GUARDED_BY(mu_);
+  CandidateMap candidates_ TF_GUARDED_BY(mu_);
+  int64_t next_expiration_micros_ TF_GUARDED_BY(mu_) = 0;
+};
+
 }  // namespace lookup
 
 // Base class for kernels that take a LookupTable handle as the 0th input.
@@ -1160,6 +1771,53 @@ REGISTER_KERNEL(tstring, int64_t);
 
 #undef REGISTER_KERNEL
 
+// Register the ConcurrentMutableHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                      \
+  REGISTER_KERNEL_BUILDER(                                           \
+      Name("ConcurrentMutableHashTable")                             \
+          .Device(DEVICE_CPU)                                        \
+          .TypeConstraint<key_dtype>("key_dtype")                    \
+          .TypeConstraint<value_dtype>("value_dtype"),               \
+      LookupTableOp<lookup::ConcurrentMutableHashTableOfScalars<     \
+                        key_dtype, value_dtype>,                     \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, int32);
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(int64_t, Variant);
+REGISTER_KERNEL(tstring, bool);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, int32);
+REGISTER_KERNEL(tstring, int64_t);
+
+#undef REGISTER_KERNEL
+
+// Register the DynamicEmbeddingTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                              \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("DynamicEmbeddingTable")                                          \
+          .Device(DEVICE_CPU)                                                \
+          .TypeConstraint<key_dtype>("key_dtype")                            \
+          .TypeConstraint<value_dtype>("value_dtype"),                       \
+      LookupTableOp<lookup::DynamicEmbeddingTable<key_dtype, value_dtype>,   \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+
+#undef REGISTER_KERNEL
+
 // Register the MutableHashTableOfTensors op.
 #define REGISTER_KERNEL(key_dtype, value_dtype)                                \
   REGISTER_KERNEL_BUILDER(                                                     \
@@ -173,6 +173,8 @@ se::port::StatusOr<se::blas::Epilogue> GetBlasLtEpilogOp(
     epilog_op = se::blas::Epilogue::kBias;
   } else if (fusion == FusedComputationType::kBiasAddWithRelu) {
     epilog_op = se::blas::Epilogue::kBiasThenReLU;
+  } else if (fusion == FusedComputationType::kBiasAddWithGeluApproximate) {
+    epilog_op = se::blas::Epilogue::kBiasThenGELU;
   } else {
     return se::port::InternalError("Unsupported fusion for BlasLt Matmul");
   }
@@ -370,8 +372,10 @@ class FusedMatMulOp : public OpKernel {
           {FCT::kBiasAddWithLeakyRelu, {"BiasAdd", "LeakyRelu"}},
       };
     } else if (std::is_same<Device, GPUDevice>::value) {
-      patterns = {{FCT::kBiasAdd, {"BiasAdd"}},
-                  {FCT::kBiasAddWithRelu, {"BiasAdd", "Relu"}}};
+      patterns = {
+          {FCT::kBiasAdd, {"BiasAdd"}},
+          {FCT::kBiasAddWithRelu, {"BiasAdd", "Relu"}},
+          {FCT::kBiasAddWithGeluApproximate, {"BiasAdd", "GeluApproximate"}}};
     }
 
     OP_REQUIRES_OK(context, InitializeFusedComputation(
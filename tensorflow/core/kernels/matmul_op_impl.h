@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/framework/type_traits.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/fill_functor.h"
+#include "tensorflow/core/kernels/packed_gemm.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/platform/logging.h"
@@ -686,6 +687,38 @@ struct LaunchBatchMatMul<GPUDevice, Scalar> {
 
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+// Multiplies by weights that are packed once for all calls of the kernel
+// (see packed_gemm.h). Run() returns false if this is not supported for the
+// device and type.
+template <typename Device, typename Scalar>
+class LaunchPackedWeightsMatMul {
+ public:
+  bool Run(OpKernelContext* context, const Tensor& in_x, const Tensor& in_y,
+           bool trans_x, bool trans_y, Tensor* out) {
+    return false;
+  }
+};
+
+template <>
+class LaunchPackedWeightsMatMul<CPUDevice, float> {
+ public:
+  bool Run(OpKernelContext* context, const Tensor& in_x, const Tensor& in_y,
+           bool trans_x, bool trans_y, Tensor* out) {
+    const int64_t m = out->dim_size(0);
+    const int64_t n = out->dim_size(1);
+    const int64_t k = in_x.dim_size(trans_x ? 0 : 1);
+    std::shared_ptr<const PackedRhsGemm<float>> packed =
+        cache_.Get(in_y, k, n, trans_y);
+    packed->Multiply(*context->device()->tensorflow_cpu_worker_threads(),
+                     in_x.flat<float>().data(), m, trans_x,
+                     out->flat<float>().data());
+    return true;
+  }
+
+ private:
+  PackedWeightsCache<float> cache_;
+};
+
 template <typename Device, typename Ta, typename Tb, typename Tout>
 class BaseBatchMatMulOp : public OpKernel {
  public:
@@ -698,6 +731,10 @@ class BaseBatchMatMulOp : public OpKernel {
       OP_REQUIRES_OK(context, context->GetAttr("transpose_b", &trans_y_));
       adj_x_ = false;
       adj_y_ = false;
+      // Only the plain MatMul has its weights marked by Grappler.
+      packed_weights_ = std::is_same<Ta, Tout>::value &&
+                        std::is_same<Tb, Tout>::value &&
+                        HasConstantWeights(context);
     } else {
       OP_REQUIRES_OK(context, context->GetAttr("adj_x", &adj_x_));
       OP_REQUIRES_OK(context, context->GetAttr("adj_y", &adj_y_));
@@ -762,6 +799,10 @@ class BaseBatchMatMulOp : public OpKernel {
       f(ctx->eigen_device<Device>(), out->flat<Tout>());
       return;
     }
+    if (packed_weights_ &&
+        packed_weights_matmul_.Run(ctx, in0, in1, trans_x_, trans_y_, out)) {
+      return;
+    }
     Tensor out_reshaped;
     OP_REQUIRES(ctx,
                 out_reshaped.CopyFrom(*out, TensorShape({batch_size, d0, d3})),
@@ -818,6 +859,8 @@ class BaseBatchMatMulOp : public OpKernel {
   bool adj_y_ = false;
   bool trans_x_ = false;
   bool trans_y_ = false;
+  bool packed_weights_ = false;
+  LaunchPackedWeightsMatMul<Device, Tout> packed_weights_matmul_;
 
   // Cast `t` from `SrcT` to `DstT`.
   template <typename SrcT, typename DstT>
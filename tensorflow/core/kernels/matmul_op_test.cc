@@ -17,8 +17,11 @@ limitations under the License.
 #include "tensorflow/cc/ops/nn_ops_internal.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/ops_util.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
@@ -345,6 +348,87 @@ using FusedBiasAddDataTypes = ::testing::Types<float>;
 INSTANTIATE_TYPED_TEST_SUITE_P(Test, FusedMatMulWithBiasOpTest,
                                FusedBiasAddDataTypes);
 
+// MatMul with weights that Grappler marked as constant, which the kernel
+// packs once for all runs.
+class PackedWeightsMatMulOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(bool transpose_a, bool transpose_b) {
+    TF_ASSERT_OK(NodeDefBuilder("matmul", "MatMul")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("transpose_a", transpose_a)
+                     .Attr("transpose_b", transpose_b)
+                     .Attr("_grappler_constant_weights", true)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Runs the kernel and compares its output with an Eigen contraction.
+  void RunAndVerify(const Tensor& a, const Tensor& b, bool transpose_a,
+                    bool transpose_b) {
+    TF_ASSERT_OK(RunOpKernel());
+    Eigen::array<Eigen::IndexPair<int>, 1> contract_dims = {
+        Eigen::IndexPair<int>(transpose_a ? 0 : 1, transpose_b ? 1 : 0)};
+    Tensor expected(allocator(), DT_FLOAT, GetOutput(0)->shape());
+    expected.matrix<float>() =
+        a.matrix<float>().contract(b.matrix<float>(), contract_dims);
+    test::ExpectClose(expected, *GetOutput(0), /*atol=*/1e-4, /*rtol=*/1e-4);
+  }
+
+  void VerifyMatMul(int m, int k, int n, bool transpose_a, bool transpose_b) {
+    MakeOp(transpose_a, transpose_b);
+    Tensor a(DT_FLOAT, transpose_a ? TensorShape({k, m}) : TensorShape({m, k}));
+    Tensor b(DT_FLOAT, transpose_b ? TensorShape({n, k}) : TensorShape({k, n}));
+    a.flat<float>().setRandom();
+    b.flat<float>().setRandom();
+    AddInputFromArray<float>(a.shape(), a.flat<float>());
+    AddInputFromArray<float>(b.shape(), b.flat<float>());
+    RunAndVerify(a, b, transpose_a, transpose_b);
+
+    // New activations reuse the packed weights.
+    a.flat<float>().setRandom();
+    mutable_input(0).tensor->flat<float>() = a.flat<float>();
+    RunAndVerify(a, b, transpose_a, transpose_b);
+  }
+};
+
+TEST_F(PackedWeightsMatMulOpTest, MatMul1x256x256) {
+  VerifyMatMul(1, 256, 256, false, false);
+}
+
+TEST_F(PackedWeightsMatMulOpTest, MatMul37x513x129) {
+  VerifyMatMul(37, 513, 129, false, false);
+}
+
+TEST_F(PackedWeightsMatMulOpTest, MatMul600x300x1000TransposeA) {
+  VerifyMatMul(600, 300, 1000, true, false);
+}
+
+TEST_F(PackedWeightsMatMulOpTest, MatMul300x1100x17TransposeB) {
+  VerifyMatMul(300, 1100, 17, false, true);
+}
+
+TEST_F(PackedWeightsMatMulOpTest, MatMul64x64x64TransposeAB) {
+  VerifyMatMul(64, 64, 64, true, true);
+}
+
+TEST_F(PackedWeightsMatMulOpTest, RepacksNewWeights) {
+  MakeOp(/*transpose_a=*/false, /*transpose_b=*/false);
+  Tensor a(DT_FLOAT, TensorShape({8, 32}));
+  Tensor b(DT_FLOAT, TensorShape({32, 16}));
+  a.flat<float>().setRandom();
+  b.flat<float>().setRandom();
+  AddInputFromArray<float>(a.shape(), a.flat<float>());
+  AddInputFromArray<float>(b.shape(), b.flat<float>());
+  RunAndVerify(a, b, false, false);
+
+  // Weights in a new buffer are packed again.
+  b.flat<float>().setRandom();
+  tensors_.push_back(new Tensor(tensor::DeepCopy(b)));
+  inputs_[1] = TensorValue(tensors_.back());
+  RunAndVerify(a, b, false, false);
+}
+
 //----------------------------------------------------------------------------//
 // Performance benchmarks are below.                                          //
 //----------------------------------------------------------------------------//
@@ -0,0 +1,214 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/packed_gemm.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+using Eigen::Index;
+
+// Eigen's GEBP kernel multiplies column-major matrices. The row-major
+// product `out[m, n] = lhs[m, k] * rhs[k, n]` is the column-major product
+// `out^T[n, m] = rhs^T[n, k] * lhs^T[k, m]`, so the weights are the GEBP
+// left-hand side, and the activations its right-hand side.
+template <typename T>
+struct Gebp {
+  using Traits = Eigen::internal::gebp_traits<T, T>;
+
+  template <int StorageOrder>
+  using InputMapper =
+      Eigen::internal::const_blas_data_mapper<T, Index, StorageOrder>;
+  using OutputMapper =
+      Eigen::internal::blas_data_mapper<T, Index, Eigen::ColMajor>;
+
+  template <int StorageOrder>
+  using PackLhs = Eigen::internal::gemm_pack_lhs<
+      T, Index, InputMapper<StorageOrder>, Traits::mr, Traits::LhsProgress,
+      typename Traits::LhsPacket4Packing, StorageOrder>;
+  template <int StorageOrder>
+  using PackRhs =
+      Eigen::internal::gemm_pack_rhs<T, Index, InputMapper<StorageOrder>,
+                                     Traits::nr, StorageOrder>;
+  using Kernel = Eigen::internal::gebp_kernel<T, T, Index, OutputMapper,
+                                              Traits::mr, Traits::nr>;
+};
+
+// Number of activation rows (GEBP columns) that are packed together.
+constexpr int64_t kBlockM = 256;
+
+template <typename T, int StorageOrder>
+void PackWeights(const T* rhs, int64_t k, int64_t n, int64_t block_k,
+                 int64_t block_n, const std::vector<int64_t>& offsets,
+                 T* packed) {
+  // A [k, n] row-major matrix is an [n, k] column-major one, and vice versa.
+  const typename Gebp<T>::template InputMapper<StorageOrder> mapper(
+      rhs, StorageOrder == Eigen::ColMajor ? n : k);
+  typename Gebp<T>::template PackLhs<StorageOrder> pack;
+  const int64_t num_k_blocks = (k + block_k - 1) / block_k;
+  for (int64_t n0 = 0, nb = 0; n0 < n; n0 += block_n, ++nb) {
+    const int64_t rows = std::min(block_n, n - n0);
+    for (int64_t k0 = 0, kb = 0; k0 < k; k0 += block_k, ++kb) {
+      const int64_t depth = std::min(block_k, k - k0);
+      pack(packed + offsets[nb * num_k_blocks + kb],
+           mapper.getSubMapper(n0, k0), depth, rows);
+    }
+  }
+}
+
+}  // namespace
+
+template <typename T>
+PackedRhsGemm<T>::PackedRhsGemm(const T* rhs, int64_t k, int64_t n,
+                                bool transpose)
+    : k_(k), n_(n) {
+  using Traits = typename Gebp<T>::Traits;
+  // Let Eigen pick the depth and weight blocking for the cache sizes of the
+  // host, for a nominal block of activations.
+  Index kc = k, mc = n, nc = kBlockM;
+  Eigen::internal::computeProductBlockingSizes<T, T, 1>(kc, mc, nc);
+  block_k_ = std::max<int64_t>(kc, 1);
+  block_n_ = std::max<int64_t>(mc / Traits::mr * Traits::mr, Traits::mr);
+  num_k_blocks_ = (k + block_k_ - 1) / block_k_;
+  num_n_blocks_ = (n + block_n_ - 1) / block_n_;
+
+  // GEBP loads the packed weights with aligned loads.
+  const int64_t alignment = Allocator::kAllocatorAlignment / sizeof(T);
+  int64_t size = 0;
+  offsets_.reserve(num_n_blocks_ * num_k_blocks_);
+  for (int64_t nb = 0; nb < num_n_blocks_; ++nb) {
+    const int64_t rows = std::min(block_n_, n - nb * block_n_);
+    for (int64_t kb = 0; kb < num_k_blocks_; ++kb) {
+      const int64_t depth = std::min(block_k_, k - kb * block_k_);
+      offsets_.push_back(size);
+      size += (rows * depth + alignment - 1) / alignment * alignment;
+    }
+  }
+  packed_ = Tensor(DataTypeToEnum<T>::value, TensorShape({size}));
+  T* packed = packed_.flat<T>().data();
+  if (transpose) {
+    PackWeights<T, Eigen::RowMajor>(rhs, k, n, block_k_, block_n_, offsets_,
+                                    packed);
+  } else {
+    PackWeights<T, Eigen::ColMajor>(rhs, k, n, block_k_, block_n_, offsets_,
+                                    packed);
+  }
+  packed_data_ = packed;
+}
+
+template <typename T>
+void PackedRhsGemm<T>::Multiply(
+    const DeviceBase::CpuWorkerThreads& worker_threads, const T* lhs,
+    int64_t m, bool transpose_lhs, T* out) const {
+  if (m == 0 || n_ == 0) return;
+  if (k_ == 0) {
+    std::fill_n(out, m * n_, T(0));
+    return;
+  }
+  const int64_t num_m_blocks = (m + kBlockM - 1) / kBlockM;
+  // Small batches do not have enough activation blocks to keep every thread
+  // busy, so the weight blocks are split between threads as well.
+  const int64_t num_n_groups =
+      std::min(num_n_blocks_,
+               std::max<int64_t>(1, worker_threads.num_threads / num_m_blocks));
+  const int64_t cost_per_task =
+      std::min(kBlockM, m) * k_ * n_ / num_n_groups;
+
+  auto work = [&](int64_t start, int64_t limit) {
+    // A [m, k] row-major matrix is a [k, m] column-major one, and vice versa.
+    const Index stride = transpose_lhs ? m : k_;
+    const typename Gebp<T>::template InputMapper<Eigen::ColMajor> col_major(
+        lhs, stride);
+    const typename Gebp<T>::template InputMapper<Eigen::RowMajor> row_major(
+        lhs, stride);
+    const typename Gebp<T>::OutputMapper output(out, n_);
+    typename Gebp<T>::template PackRhs<Eigen::ColMajor> pack_col_major;
+    typename Gebp<T>::template PackRhs<Eigen::RowMajor> pack_row_major;
+    typename Gebp<T>::Kernel gebp;
+    std::vector<T, Eigen::aligned_allocator<T>> packed_lhs(
+        block_k_ * std::min(kBlockM, m));
+
+    for (int64_t task = start; task < limit; ++task) {
+      const int64_t m0 = task / num_n_groups * kBlockM;
+      const int64_t cols = std::min(kBlockM, m - m0);
+      const int64_t group = task % num_n_groups;
+      const int64_t nb_begin = group * num_n_blocks_ / num_n_groups;
+      const int64_t nb_end = (group + 1) * num_n_blocks_ / num_n_groups;
+      const int64_t n_begin = nb_begin * block_n_;
+      const int64_t n_end = std::min(n_, nb_end * block_n_);
+
+      // GEBP accumulates into its output.
+      for (int64_t i = m0; i < m0 + cols; ++i) {
+        std::fill(out + i * n_ + n_begin, out + i * n_ + n_end, T(0));
+      }
+      for (int64_t kb = 0; kb < num_k_blocks_; ++kb) {
+        const int64_t k0 = kb * block_k_;
+        const int64_t depth = std::min(block_k_, k_ - k0);
+        if (transpose_lhs) {
+          pack_row_major(packed_lhs.data(), row_major.getSubMapper(k0, m0),
+                         depth, cols);
+        } else {
+          pack_col_major(packed_lhs.data(), col_major.getSubMapper(k0, m0),
+                         depth, cols);
+        }
+        for (int64_t nb = nb_begin; nb < nb_end; ++nb) {
+          const int64_t n0 = nb * block_n_;
+          const int64_t rows = std::min(block_n_, n_ - n0);
+          gebp(output.getSubMapper(n0, m0), Block(nb, kb), packed_lhs.data(),
+               rows, depth, cols, T(1));
+        }
+      }
+    }
+  };
+  Shard(worker_threads.num_threads, worker_threads.workers,
+        num_m_blocks * num_n_groups, cost_per_task, work);
+}
+
+template <typename T>
+std::shared_ptr<const PackedRhsGemm<T>> PackedWeightsCache<T>::Get(
+    const Tensor& weights, int64_t k, int64_t n, bool transpose) {
+  mutex_lock l(mu_);
+  if (packed_ == nullptr || transpose != transpose_ ||
+      weights_.tensor_data().data() != weights.tensor_data().data() ||
+      !weights_.shape().IsSameSize(weights.shape())) {
+    packed_ = std::make_shared<PackedRhsGemm<T>>(
+        weights.flat<T>().data(), k, n, transpose);
+    weights_ = weights;
+    transpose_ = transpose;
+  }
+  return packed_;
+}
+
+bool HasConstantWeights(OpKernelConstruction* context) {
+  bool constant_weights = false;
+  if (!context->GetAttr(kConstantWeightsAttr, &constant_weights).ok()) {
+    return false;
+  }
+  return constant_weights;
+}
+
+template class PackedRhsGemm<float>;
+template class PackedWeightsCache<float>;
+
+}  // namespace tensorflow
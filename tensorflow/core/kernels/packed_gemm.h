@@ -0,0 +1,108 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_PACKED_GEMM_H_
+#define TENSORFLOW_CORE_KERNELS_PACKED_GEMM_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Boolean node attribute that Grappler sets on CPU MatMul and Conv2D nodes
+// whose weights (the second input) come from a constant. Kernels of such
+// nodes pack the weights once, instead of on every call.
+constexpr char kConstantWeightsAttr[] = "_grappler_constant_weights";
+
+// A CPU matrix multiplication with a fixed right-hand side that is packed
+// once into the panel layout consumed by Eigen's GEBP micro-kernel. Eigen's
+// tensor contraction packs both operands on every evaluation; for inference
+// with constant weights, packing the weights again on every step is wasted
+// work, so only the left-hand side is packed per call here.
+//
+// All matrices are row-major. The object is immutable once constructed, and
+// Multiply() can be called concurrently.
+template <typename T>
+class PackedRhsGemm {
+ public:
+  // Packs `rhs`, which is a [k, n] matrix, or an [n, k] matrix that is used
+  // transposed if `transpose` is true.
+  PackedRhsGemm(const T* rhs, int64_t k, int64_t n, bool transpose);
+
+  int64_t k() const { return k_; }
+  int64_t n() const { return n_; }
+
+  // Computes `out[m, n] = lhs * rhs`, where `lhs` is an [m, k] matrix, or a
+  // [k, m] matrix that is used transposed if `transpose_lhs` is true.
+  void Multiply(const DeviceBase::CpuWorkerThreads& worker_threads,
+                const T* lhs, int64_t m, bool transpose_lhs, T* out) const;
+
+ private:
+  // Returns the packed [k_block, n_block] block of the weights.
+  const T* Block(int64_t n_block, int64_t k_block) const {
+    return packed_data_ + offsets_[n_block * num_k_blocks_ + k_block];
+  }
+
+  int64_t k_;
+  int64_t n_;
+  int64_t block_k_;
+  int64_t block_n_;
+  int64_t num_k_blocks_;
+  int64_t num_n_blocks_;
+  // Offsets of the packed blocks into `packed_`, all of them aligned to a
+  // cache line.
+  std::vector<int64_t> offsets_;
+  Tensor packed_;
+  const T* packed_data_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedRhsGemm);
+};
+
+// Holds the packed form of a kernel's constant weights. The weights tensor
+// is kept alive along with its packed form, so that a new buffer, as
+// produced for instance by an assignment to a resource variable while the
+// old value is still referenced, always packs the weights again.
+template <typename T>
+class PackedWeightsCache {
+ public:
+  // Returns `weights` packed as a [k, n] right-hand side (see
+  // PackedRhsGemm), reusing the cached packing if `weights` is the same
+  // buffer with the same shape as in the previous call.
+  std::shared_ptr<const PackedRhsGemm<T>> Get(const Tensor& weights,
+                                              int64_t k, int64_t n,
+                                              bool transpose)
+      TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  mutex mu_;
+  Tensor weights_ TF_GUARDED_BY(mu_);
+  bool transpose_ TF_GUARDED_BY(mu_) = false;
+  std::shared_ptr<const PackedRhsGemm<T>> packed_ TF_GUARDED_BY(mu_);
+};
+
+// Returns whether the node of the kernel under construction was marked by
+// Grappler as having constant weights.
+bool HasConstantWeights(OpKernelConstruction* context);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_PACKED_GEMM_H_
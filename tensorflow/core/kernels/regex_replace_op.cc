@@ -23,10 +23,15 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/util/ptr_util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
 
+// Rough cycle cost of running a regex over one short string, including the
+// copy in and out of a std::string.
+constexpr int64_t kRegexReplaceCostPerElement = 1000;
+
 // Execute the specified regex using the given context.
 // Context requirements:
 //  - "input" string Tensor at input_index=0
@@ -49,17 +54,25 @@ Status InternalCompute(const RE2& regex, const string& rewrite,
     output_tensor->flat<tstring>() = input_tensor->flat<tstring>();
   }
   auto output_flat = output_tensor->flat<tstring>();
-  for (size_t i = 0; i < output_flat.size(); ++i) {
-    // TODO(dero): Mitigate copy; Global and GlobalReplace below currently only
-    // accept std::string.
-    string buf = output_flat(i);
-    if (replace_global) {
-      RE2::GlobalReplace(&buf, regex, rewrite);
-    } else {
-      RE2::Replace(&buf, regex, rewrite);
+  // RE2 matching is thread-safe on a const regex, so elements are rewritten
+  // in parallel on the intra-op pool.
+  auto replace_range = [&](int64_t start, int64_t limit) {
+    for (int64_t i = start; i < limit; ++i) {
+      // TODO(dero): Mitigate copy; Global and GlobalReplace below currently
+      // only accept std::string.
+      string buf = output_flat(i);
+      if (replace_global) {
+        RE2::GlobalReplace(&buf, regex, rewrite);
+      } else {
+        RE2::Replace(&buf, regex, rewrite);
+      }
+      output_flat(i) = std::move(buf);
     }
-    output_flat(i) = std::move(buf);
-  }
+  };
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads.num_threads, worker_threads.workers, output_flat.size(),
+        kRegexReplaceCostPerElement, replace_range);
   return OkStatus();
 }
 }  // namespace
@@ -93,42 +93,21 @@ ReadVariableOp::ReadVariableOp(OpKernelConstruction* c) : OpKernel(c) {
 
 namespace {
 
-Status CopyVariable(int output_idx, OpKernelContext* ctx, const Tensor* t) {
-  Tensor* output;
-  Notification n;
-  Status status;
-  AllocatorAttributes attr;
-  if (t->dtype() == DT_VARIANT) {
-    attr.set_on_host(true);
-  }
-  TF_RETURN_IF_ERROR(
-      ctx->allocate_output(output_idx, t->shape(), &output, attr));
-  if (t->dtype() == DT_VARIANT) {
-    output->flat<Variant>() = t->flat<Variant>();
-  } else if (ctx->op_device_context() != nullptr) {
-    // TODO(apassos): remove the down_cast by just returning Device* from
-    // OpKernelContext
-    Device* device = down_cast<Device*>(ctx->device());
-    ctx->op_device_context()->CopyTensorInSameDevice(
-        t, device, output, [&n, &status](const Status& s) {
-          status = s;
-          n.Notify();
-        });
-    n.WaitForNotification();
-    return status;
-  } else {
-    switch (t->dtype()) {
-#define HANDLER(type)                       \
-  case DataTypeToEnum<type>::value:         \
-    output->flat<type>() = t->flat<type>(); \
-    break;
-      TF_CALL_ALL_TYPES(HANDLER);
-#undef HANDLER
-      default:
-        return errors::Internal("Unsupported dtype", t->dtype());
+// Returns a tensor aliasing the value of `variable`. The reference to the
+// underlying buffer is acquired while holding the variable's lock to guarantee
+// ordering of reads and writes. In copy-on-read mode that lock is exclusive, so
+// that no sparse write can update the buffer in place while it is aliased;
+// later sparse writes copy the buffer if the returned tensor is still alive.
+Tensor AliasVariable(Var* variable) {
+  {
+    tf_shared_lock ml(*variable->mu());
+    if (!variable->copy_on_read_mode.load()) {
+      return *variable->tensor();
     }
   }
-  return OkStatus();
+  mutex_lock ml(*variable->mu());
+  variable->aliased_by_reads.store(true);
+  return *variable->tensor();
 }
 
 }  // namespace
@@ -145,21 +124,13 @@ void ReadVariableOp::Compute(OpKernelContext* ctx) {
                   "Debug info: container=", handle.container(),
                   ", status error message=", status.error_message()));
 
-  tf_shared_lock ml(*variable->mu());
-  // We're acquiring a reference to the underlying buffer while
-  // holding a shared lock to guarantee ordering of reads and
-  // writes when in copy-on-write mode.
-  const Tensor* t = variable->tensor();
-  if (!variable->copy_on_read_mode.load()) {
-    OP_REQUIRES(
-        ctx, dtype_ == t->dtype(),
-        errors::InvalidArgument(
-            "Trying to read variable with wrong dtype. Expected ",
-            DataTypeString(dtype_), " got ", DataTypeString(t->dtype())));
-    ctx->set_output(0, *t);
-  } else {
-    OP_REQUIRES_OK(ctx, CopyVariable(0, ctx, t));
-  }
+  const Tensor t = AliasVariable(variable.get());
+  OP_REQUIRES(
+      ctx, dtype_ == t.dtype(),
+      errors::InvalidArgument(
+          "Trying to read variable with wrong dtype. Expected ",
+          DataTypeString(dtype_), " got ", DataTypeString(t.dtype())));
+  ctx->set_output(0, t);
 }
 
 ReadVariablesOp::ReadVariablesOp(OpKernelConstruction* c) : OpKernel(c) {
@@ -195,22 +166,14 @@ void ReadVariablesOp::Compute(OpKernelContext* ctx) {
                   absl::StrJoin(uninitialized_vars, ", ")));
 
   for (size_t i = 0; i < dtypes_.size(); ++i) {
-    // We're acquiring a reference to the underlying buffer while
-    // holding a shared lock to guarantee ordering of reads and
-    // writes.
-    tf_shared_lock ml(*variables[i]->mu());
-    OP_REQUIRES(ctx, dtypes_[i] == variables[i]->tensor()->dtype(),
+    const Tensor t = AliasVariable(variables[i].get());
+    OP_REQUIRES(ctx, dtypes_[i] == t.dtype(),
                 errors::InvalidArgument(
                     "Trying to read variable ", handles[i]->name(),
                     " from Container: ", handles[i]->container(),
                     " with wrong dtype. Expected ", DataTypeString(dtypes_[i]),
-                    " got ", DataTypeString(variables[i]->tensor()->dtype())));
-    if (variables[i]->copy_on_read_mode.load()) {
-      OP_REQUIRES_OK(ctx, CopyVariable(i, ctx, variables[i]->tensor()));
-    } else {
-      const Tensor& t = *variables[i]->tensor();
-      ctx->set_output(i, t);
-    }
+                    " got ", DataTypeString(t.dtype())));
+    ctx->set_output(i, t);
   }
 }
 
@@ -370,11 +333,12 @@ void DisableCopyOnReadOp::Compute(OpKernelContext* ctx) {
                   "In TF1, it can also mean the variable is uninitialized. ",
                   "Debug info: container=", handle.container(),
                   ", status error message=", status.error_message()));
-  // If the variable is currently in copy-on-read mode, its refcount is 1
+  // Aliases left by reads in copy-on-read mode are handled by copy-on-write.
   if (variable->copy_on_read_mode.load()) {
     // Obtain an exclusive lock on the variable and change the access mode
     mutex_lock ml(*variable->mu());
     variable->copy_on_read_mode.store(false);
+    variable->aliased_by_reads.store(false);
   }
 }
 
@@ -450,18 +414,11 @@ class AssignVariableOp : public OpKernel {
               variable->tensor()->shape().DebugString(), " got ",
               value.shape().DebugString()));
     }
+    // In copy-on-read mode the value is aliased too (e.g. a constant); the
+    // first sparse write copies it if it is still shared by then.
+    *variable->tensor() = value;
     if (variable->copy_on_read_mode.load()) {
-      AllocatorAttributes attr;
-      attr.set_gpu_compatible(true);
-      attr.set_nic_compatible(true);
-      OP_REQUIRES_OK(context,
-                     context->allocate_temp(value.dtype(), value.shape(),
-                                            variable->tensor(), attr));
-      functor::DenseUpdate<Device, T, ASSIGN> copy_functor;
-      copy_functor(context->eigen_device<Device>(),
-                   variable->tensor()->flat<T>(), value.flat<T>());
-    } else {
-      *variable->tensor() = value;
+      variable->aliased_by_reads.store(true);
     }
     variable->is_initialized = true;
   }
@@ -1042,14 +999,18 @@ class ResourceScatterUpdateOp : public OpKernel {
     const bool is_non_pod_dtype = c->input_dtype(0) == DT_RESOURCE ||
                                   c->input_dtype(0) == DT_STRING ||
                                   c->input_dtype(0) == DT_VARIANT;
-    if (is_non_pod_dtype || use_exclusive_lock_) {
-      mutex_lock ml(*v->mu());
-      DoCompute(c);
-    } else {
-      // For POD dtypes, we can safely run the update without the mutex.
+    if (!is_non_pod_dtype && !use_exclusive_lock_) {
+      // For POD dtypes, we can safely run the update without the mutex, unless
+      // a dense read aliased the buffer.
       tf_shared_lock ml(*v->mu());
-      DoCompute(c);
+      if (!v->aliased_by_reads.load()) {
+        DoCompute(c);
+        return;
+      }
     }
+    mutex_lock ml(*v->mu());
+    OP_REQUIRES_OK(c, EnsureSparseVariableAccessLocked<Device, T>(c, v.get()));
+    DoCompute(c);
   }
 
  private:
@@ -0,0 +1,110 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/type_index.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class CopyOnReadVariableTest : public OpsTestBase {
+ protected:
+  void SetUp() override {
+    var_ = new Var(DT_FLOAT);
+    *var_->tensor() = test::AsTensor<float>({1, 2, 3, 4});
+    var_->is_initialized = true;
+    var_->copy_on_read_mode.store(true);
+    ResourceMgr* rm = device_->resource_manager();
+    TF_ASSERT_OK(rm->Create(rm->default_container(), "var", var_));
+  }
+
+  void AddVariableInput() {
+    AddResourceInputInternal(device_->resource_manager()->default_container(),
+                             "var", TypeIndex::Make<Var>());
+  }
+
+  Status ReadVariable(Tensor* value) {
+    inputs_.clear();
+    TF_RETURN_IF_ERROR(NodeDefBuilder("read", "ReadVariableOp")
+                           .Input(FakeInput(DT_RESOURCE))
+                           .Attr("dtype", DT_FLOAT)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    AddVariableInput();
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *value = *GetOutput(0);
+    return OkStatus();
+  }
+
+  Status ScatterUpdate(int32 index, float update) {
+    inputs_.clear();
+    TF_RETURN_IF_ERROR(NodeDefBuilder("update", "ResourceScatterUpdate")
+                           .Input(FakeInput(DT_RESOURCE))
+                           .Input(FakeInput(DT_INT32))
+                           .Input(FakeInput(DT_FLOAT))
+                           .Attr("dtype", DT_FLOAT)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    AddVariableInput();
+    AddInputFromArray<int32>(TensorShape({1}), {index});
+    AddInputFromArray<float>(TensorShape({1}), {update});
+    return RunOpKernel();
+  }
+
+  Var* var_;  // Owned by the resource manager.
+};
+
+TEST_F(CopyOnReadVariableTest, ReadAliasesBuffer) {
+  Tensor value;
+  TF_ASSERT_OK(ReadVariable(&value));
+  test::ExpectTensorEqual<float>(value, test::AsTensor<float>({1, 2, 3, 4}));
+  EXPECT_EQ(value.data(), var_->tensor()->data());
+  EXPECT_TRUE(var_->aliased_by_reads.load());
+}
+
+TEST_F(CopyOnReadVariableTest, SparseWriteCopiesLiveAlias) {
+  Tensor value;
+  TF_ASSERT_OK(ReadVariable(&value));
+  TF_ASSERT_OK(ScatterUpdate(0, 10));
+  test::ExpectTensorEqual<float>(value, test::AsTensor<float>({1, 2, 3, 4}));
+  test::ExpectTensorEqual<float>(*var_->tensor(),
+                                 test::AsTensor<float>({10, 2, 3, 4}));
+  EXPECT_NE(value.data(), var_->tensor()->data());
+  EXPECT_FALSE(var_->aliased_by_reads.load());
+  EXPECT_TRUE(var_->copy_on_read_mode.load());
+}
+
+TEST_F(CopyOnReadVariableTest, SparseWriteAfterReleasedAliasIsInPlace) {
+  Tensor value;
+  TF_ASSERT_OK(ReadVariable(&value));
+  const void* buffer = value.data();
+  value = Tensor();
+  TF_ASSERT_OK(ScatterUpdate(1, 20));
+  test::ExpectTensorEqual<float>(*var_->tensor(),
+                                 test::AsTensor<float>({1, 20, 3, 4}));
+  EXPECT_EQ(buffer, var_->tensor()->data());
+  EXPECT_FALSE(var_->aliased_by_reads.load());
+}
+
+}  // namespace
+}  // namespace tensorflow
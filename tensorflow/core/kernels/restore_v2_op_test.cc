@@ -31,9 +31,11 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
 namespace {
@@ -356,5 +358,48 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+TEST_F(RestoreV2OpTest, RestoreWithParallelReaders) {
+  constexpr int kNumTensors = 10;
+  const string prefix =
+      io::JoinPath(testing::TmpDir(), "tensor_parallel_readers");
+  std::vector<string> tensor_names;
+  {
+    BundleWriter writer(Env::Default(), prefix);
+    for (int i = 0; i < kNumTensors; ++i) {
+      tensor_names.push_back(strings::StrCat("tensor_", i));
+      TF_ASSERT_OK(writer.Add(
+          tensor_names.back(),
+          MakeInput<float>(TensorShape({4}),
+                           [i](int x) -> float { return 10 * i + x; })));
+    }
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  setenv("TF_RESTORE_TENSORS_PARALLEL_READERS", "3", /*overwrite=*/1);
+  TF_ASSERT_OK(NodeDefBuilder("myop", "RestoreV2")
+                   .Input(FakeInput())  // prefix
+                   .Input(FakeInput())  // tensor_names
+                   .Input(FakeInput())  // shape_and_slices
+                   .Attr("dtypes", std::vector<DataType>(kNumTensors, DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<tstring>(TensorShape({}), {prefix});
+  AddInputFromArray<tstring>(
+      TensorShape({kNumTensors}),
+      std::vector<tstring>(tensor_names.begin(), tensor_names.end()));
+  AddInputFromArray<tstring>(TensorShape({kNumTensors}),
+                             std::vector<tstring>(kNumTensors, ""));
+  TF_ASSERT_OK(RunOpKernel());
+  unsetenv("TF_RESTORE_TENSORS_PARALLEL_READERS");
+
+  for (int i = 0; i < kNumTensors; ++i) {
+    Tensor* output = GetOutput(i);
+    ASSERT_EQ(4, output->NumElements());
+    for (int x = 0; x < 4; ++x) {
+      EXPECT_EQ(10 * i + x, output->flat<float>()(x));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -33,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -250,6 +252,45 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Default number of threads used to restore large tensors and, when enabled,
+// ranges of small tensors.
+const int64_t kDefaultRestoreThreads = 8;
+
+// Number of threads in the "restore_tensors" pool. Configurable through
+// TF_RESTORE_TENSORS_NUM_THREADS.
+int64_t RestoreThreads() {
+  int64_t num_threads;
+  Status s = ReadInt64FromEnvVar("TF_RESTORE_TENSORS_NUM_THREADS",
+                                 kDefaultRestoreThreads, &num_threads);
+  if (!s.ok() || num_threads < 1) {
+    LOG(ERROR) << "Ignoring invalid TF_RESTORE_TENSORS_NUM_THREADS ("
+               << num_threads << "): " << s;
+    return kDefaultRestoreThreads;
+  }
+  return num_threads;
+}
+
+// Maximum number of BundleReaders used to read small tensors in parallel.
+// Small tensors are sorted for sequential access and split into this many
+// contiguous ranges, each read by its own reader, so that reads are issued
+// concurrently across shards and across ranges of a single shard while each
+// reader still streams sequentially. The default of 1 reads all small tensors
+// from the op thread. Configurable through TF_RESTORE_TENSORS_PARALLEL_READERS.
+//
+// The variables are re-read on every restore so that they can be changed
+// between loads in the same process; this is negligible next to the IO.
+int64_t RestoreParallelReaders() {
+  int64_t num_readers;
+  Status s = ReadInt64FromEnvVar("TF_RESTORE_TENSORS_PARALLEL_READERS", 1,
+                                 &num_readers);
+  if (!s.ok() || num_readers < 1) {
+    LOG(ERROR) << "Ignoring invalid TF_RESTORE_TENSORS_PARALLEL_READERS ("
+               << num_readers << "): " << s;
+    return 1;
+  }
+  return num_readers;
+}
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -412,25 +453,54 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     }
   }
 
+  // Split the (sequentially sorted) small tensors into contiguous ranges. The
+  // first range is read from the op thread with `default_reader`; the others
+  // are read from the pool, each with its own reader.
+  const int64_t num_ranges = std::min<int64_t>(
+      RestoreParallelReaders(),
+      std::max<int64_t>(1, direct_restore_ops.size()));
+  const int64_t range_size =
+      (direct_restore_ops.size() + num_ranges - 1) / num_ranges;
+  std::vector<Status> range_statuses(num_ranges);
+
   {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
+    if (!pool_restore_ops.empty() || num_ranges > 1) {
+      reader_pool.reset(new thread::ThreadPool(
+          Env::Default(), "restore_tensors", RestoreThreads()));
       for (auto* op : pool_restore_ops) {
         reader_pool->Schedule([op]() { op->run_with_new_reader(); });
       }
     }
 
-    // Read small tensors from the op thread
-    for (auto* op : direct_restore_ops) {
-      TF_RETURN_IF_ERROR(op->run(&default_reader));
+    for (int64_t r = 1; r < num_ranges; ++r) {
+      const int64_t begin = r * range_size;
+      const int64_t end = std::min<int64_t>(begin + range_size,
+                                            direct_restore_ops.size());
+      if (begin >= end) break;
+      reader_pool->Schedule([&, r, begin, end]() {
+        BundleReader reader(Env::Default(), prefix_string);
+        range_statuses[r] = reader.status();
+        for (int64_t i = begin; i < end && range_statuses[r].ok(); ++i) {
+          range_statuses[r] = direct_restore_ops[i]->run(&reader);
+        }
+      });
+    }
+
+    // Read the first range of small tensors from the op thread
+    const int64_t first_end =
+        std::min<int64_t>(range_size, direct_restore_ops.size());
+    for (int64_t i = 0; i < first_end && range_statuses[0].ok(); ++i) {
+      range_statuses[0] = direct_restore_ops[i]->run(&default_reader);
     }
   }
 
   // Check status of pool ops; this must come after the pool shuts down.
+  for (const Status& s : range_statuses) {
+    TF_RETURN_IF_ERROR(s);
+  }
   for (auto* op : pool_restore_ops) {
     TF_RETURN_IF_ERROR(op->status);
   }
@@ -15,23 +15,29 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/checkpoint_callback_manager.h"
 #include "tensorflow/core/kernels/save_restore_tensor.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
+#include "tensorflow/core/util/tensor_bundle/pending_checkpoint_saves.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 
@@ -87,6 +93,53 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
   }
 }
 
+// Number of data files each SaveV2 op spreads its tensors over, written
+// concurrently.  The default of 1 writes a single data file from the op thread.
+// Configurable through TF_SAVE_TENSORS_NUM_DATA_FILES.
+int SaveNumDataFiles() {
+  int64_t num_data_files;
+  Status s =
+      ReadInt64FromEnvVar("TF_SAVE_TENSORS_NUM_DATA_FILES", 1, &num_data_files);
+  if (!s.ok() || num_data_files < 1) {
+    LOG(ERROR) << "Ignoring invalid TF_SAVE_TENSORS_NUM_DATA_FILES ("
+               << num_data_files << "): " << s;
+    return 1;
+  }
+  return static_cast<int>(num_data_files);
+}
+
+// Size of the blocks each tensor of a fixed-size dtype is checksummed in, so
+// that readers can map the tensor and check only the parts they use.  The
+// default of 0 only checksums whole tensors.  Configurable through
+// TF_SAVE_TENSORS_CHECKSUM_BLOCK_SIZE.
+int64_t SaveChecksumBlockSize() {
+  int64_t block_size;
+  Status s =
+      ReadInt64FromEnvVar("TF_SAVE_TENSORS_CHECKSUM_BLOCK_SIZE", 0, &block_size);
+  if (!s.ok() || block_size < 0) {
+    LOG(ERROR) << "Ignoring invalid TF_SAVE_TENSORS_CHECKSUM_BLOCK_SIZE ("
+               << block_size << "): " << s;
+    return 0;
+  }
+  return block_size;
+}
+
+// Maximum time MergeV2Checkpoints waits for the shards of an asynchronous
+// save to be written, 10 minutes by default.  Configurable through
+// TF_SAVE_TENSORS_ASYNC_TIMEOUT_IN_MS.
+int64_t AsyncSaveTimeoutInMs() {
+  const int64_t kDefaultTimeoutInMs = 10 * 60 * 1000;
+  int64_t timeout_in_ms;
+  Status s = ReadInt64FromEnvVar("TF_SAVE_TENSORS_ASYNC_TIMEOUT_IN_MS",
+                                 kDefaultTimeoutInMs, &timeout_in_ms);
+  if (!s.ok() || timeout_in_ms < 0) {
+    LOG(ERROR) << "Ignoring invalid TF_SAVE_TENSORS_ASYNC_TIMEOUT_IN_MS ("
+               << timeout_in_ms << "): " << s;
+    return kDefaultTimeoutInMs;
+  }
+  return timeout_in_ms;
+}
+
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
@@ -108,34 +161,32 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
-    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
-
+    // Fails the save if an earlier background save failed and nothing else
+    // reported it, since the earlier checkpoint is incomplete.
+    OP_REQUIRES_OK(context, checkpoint::PendingCheckpointSaves::Global()
+                                ->TakeUnreportedError());
+    const bool async_save = checkpoint::AsyncSaveEnabled();
+    std::vector<SaveEntry> entries(num_tensors);
     for (int i = 0; i < num_tensors; ++i) {
-      const string& tensor_name = tensor_names_flat(i);
+      SaveEntry& entry = entries[i];
+      entry.name = tensor_names_flat(i);
       const Tensor& tensor = context->input(i + kFixedInputs);
-      VLOG(2) << "Starting save of " << tensor_name;
 
       if (!shape_and_slices_flat(i).empty()) {
         const string& shape_spec = shape_and_slices_flat(i);
-        TensorShape shape;
-        TensorSlice slice(tensor.dims());
         TensorShape slice_shape;
+        entry.slice = TensorSlice(tensor.dims());
 
         OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                    shape_spec, &shape, &slice, &slice_shape));
+                                    shape_spec, &entry.shape, &entry.slice,
+                                    &slice_shape));
         OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
                     errors::InvalidArgument("Slice in shape_and_slice "
                                             "specification does not match the "
                                             "shape of the tensor to  save: ",
                                             shape_spec, ", tensor: ",
                                             tensor.shape().DebugString()));
-
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
-      } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        entry.is_slice = true;
       }
 
       if (VLOG_IS_ON(5)) {
@@ -155,14 +206,15 @@ class SaveV2 : public OpKernel {
         }
       }
 
-      VLOG(2) << "Done save of " << tensor_name;
+      // Variables may be updated in place once the op returns, so a
+      // background save writes a snapshot of them.
+      entry.tensor = async_save ? tensor::DeepCopy(tensor) : tensor;
     }
-    OP_REQUIRES_OK(context, writer.Finish());
-    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
 
+    checkpoint::CheckpointCallbackManager* checkpoint_callback_manager =
+        nullptr;
     ResourceMgr* resource_manager = context->resource_manager();
     if (resource_manager != nullptr) {
-      checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
       OP_REQUIRES_OK(
           context,
           resource_manager
@@ -175,9 +227,79 @@ class SaveV2 : public OpKernel {
                     *out = new checkpoint::CheckpointCallbackManager();
                     return OkStatus();
                   }));
-      checkpoint_callback_manager->Save(prefix_string);
-      checkpoint_callback_manager->Unref();
     }
+
+    if (!async_save) {
+      // Waits for a background save to the same prefix, so that the two do
+      // not write the same files.
+      Status status = checkpoint::PendingCheckpointSaves::Global()->Wait(
+          prefix_string);
+      if (status.ok()) {
+        status = WriteBundle(prefix_string, entries,
+                             checkpoint_callback_manager);
+      } else if (checkpoint_callback_manager != nullptr) {
+        checkpoint_callback_manager->Unref();
+      }
+      OP_REQUIRES_OK(context, status);
+      return;
+    }
+
+    VLOG(1) << "Scheduling background save of " << prefix_string;
+    checkpoint::PendingCheckpointSaves::Global()->Schedule(
+        prefix_string,
+        [prefix_string, entries = std::move(entries),
+         checkpoint_callback_manager]() {
+          return WriteBundle(prefix_string, entries,
+                             checkpoint_callback_manager);
+        });
+  }
+
+ private:
+  // A tensor to save, with the full shape and slice of sliced entries.
+  struct SaveEntry {
+    string name;
+    bool is_slice = false;
+    TensorShape shape;
+    TensorSlice slice;
+    Tensor tensor;
+  };
+
+  // Writes the bundle of `prefix`, then runs the checkpoint callbacks, if
+  // `checkpoint_callback_manager` is set.  Takes the reference to
+  // `checkpoint_callback_manager`.
+  static Status WriteBundle(
+      const string& prefix, const std::vector<SaveEntry>& entries,
+      checkpoint::CheckpointCallbackManager* checkpoint_callback_manager) {
+    core::ScopedUnref unref_manager(checkpoint_callback_manager);
+    BundleWriter::Options options;
+    options.num_data_files = SaveNumDataFiles();
+    options.checksum_block_size = SaveChecksumBlockSize();
+    if (options.checksum_block_size > 0) {
+      // Aligns the tensors for BundleReader::LookupMapped(), which is what the
+      // block checksums are for.
+      options.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    }
+    BundleWriter writer(Env::Default(), prefix, options);
+    TF_RETURN_IF_ERROR(writer.status());
+    VLOG(1) << "BundleWriter, prefix_string: " << prefix;
+
+    for (const SaveEntry& entry : entries) {
+      VLOG(2) << "Starting save of " << entry.name;
+      if (entry.is_slice) {
+        TF_RETURN_IF_ERROR(
+            writer.AddSlice(entry.name, entry.shape, entry.slice, entry.tensor));
+      } else {
+        TF_RETURN_IF_ERROR(writer.Add(entry.name, entry.tensor));
+      }
+      VLOG(2) << "Done save of " << entry.name;
+    }
+    TF_RETURN_IF_ERROR(writer.Finish());
+    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix;
+
+    if (checkpoint_callback_manager != nullptr) {
+      checkpoint_callback_manager->Save(prefix);
+    }
+    return OkStatus();
   }
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
@@ -202,6 +324,8 @@ class RestoreV2 : public OpKernel {
     if (!context->status().ok()) return;
 
     const string& prefix_string = prefix.scalar<tstring>()();
+    OP_REQUIRES_OK(context, checkpoint::PendingCheckpointSaves::Global()->Wait(
+                                prefix_string));
 
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
@@ -279,6 +403,23 @@ class MergeV2Checkpoints : public OpKernel {
         gtl::ArraySlice<tstring>(checkpoint_prefixes.flat<tstring>());
     Env* env = Env::Default();
     const string& merged_prefix = destination_prefix.scalar<tstring>()();
+    // The shards may still be written in the background, by this process or,
+    // in a distributed save, by the other workers.
+    if (checkpoint::AsyncSaveEnabled()) {
+      const int64_t timeout_in_ms = AsyncSaveTimeoutInMs();
+      for (const tstring& input_prefix : input_prefixes) {
+        OP_REQUIRES_OK(context, checkpoint::WaitForBundleIndex(
+                                    env, input_prefix, timeout_in_ms));
+      }
+    } else {
+      for (const tstring& input_prefix : input_prefixes) {
+        OP_REQUIRES_OK(context,
+                       checkpoint::PendingCheckpointSaves::Global()->Wait(
+                           input_prefix));
+      }
+    }
+    OP_REQUIRES_OK(context, checkpoint::PendingCheckpointSaves::Global()
+                                ->TakeUnreportedError());
     OP_REQUIRES_OK(
         context, tensorflow::MergeBundles(env, input_prefixes, merged_prefix));
 
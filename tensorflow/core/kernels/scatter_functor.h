@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/kernels/dense_update_functor.h"
+#include "tensorflow/core/kernels/sparse_row_groups.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/work_sharder.h"
@@ -144,40 +145,32 @@ struct ScatterFunctorBase {
                         typename TTypes<Index>::ConstFlat indices) {
     const Index N = static_cast<Index>(indices.size());
     const Index limit = static_cast<Index>(params.dimension(0));
-    const Index kMaxLocks = 1024;
-    const Index entries_per_lock = (limit + kMaxLocks - 1) / kMaxLocks;
-    // To reduce the number of locks and the memory usage, we divide the whole
-    // index space into kMaxLocks regions with each lock serializing access to
-    // a region.
-    mutex accessed[kMaxLocks];
-    std::atomic<Index> bad_index(-1);
-    auto ParallelScatter = [&](Index start, Index end) {
-      for (Index i = start; i < end; ++i) {
-        // Grab the index and check its validity.  Do this carefully,
-        // to avoid checking the value and grabbing it again from
-        // memory a second time (a security risk since it may change in
-        // between).
-        const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, limit)) {
-          bad_index = i;
-          return;
-        }
-        const Index lock_id = index / entries_per_lock;
-        // Copy last Ndim-1 dimensions of updates[i] to params[index]
-        {
-          mutex_lock l(accessed[lock_id]);
-          scatter_op::internal::Assign<op>::Run(params.template chip<0>(index),
+    // Group the updates by destination row, so that each row is updated by
+    // one thread, in input order, without locking. This also keeps the
+    // result identical to SerialExecute().
+    SparseRowGroups<Index> groups;
+    if (groups.Init(indices.data(), N, limit) >= 0) {
+      // Report the first bad index after applying the updates before it,
+      // exactly as the serial loop does.
+      return SerialExecute(c, d, params, updates, indices);
+    }
+    auto ParallelScatter = [&](int64_t start, int64_t end) {
+      for (Index g = start; g < end; ++g) {
+        auto row = params.template chip<0>(groups.row(g));
+        groups.ForEachPosition(g, [&](Index i) {
+          scatter_op::internal::Assign<op>::Run(row,
                                                 updates.template chip<0>(i));
-        }
+        });
       }
     };
+    const Index num_groups = groups.num_groups();
     const float kMovingCost = 2.5f;
-    float shard_cost = kMovingCost * params.dimension(1);
+    float shard_cost = kMovingCost * params.dimension(1) * N / num_groups;
     const DeviceBase::CpuWorkerThreads& worker_threads =
         *(c->device()->tensorflow_cpu_worker_threads());
-    Shard(worker_threads.num_threads, worker_threads.workers, N, shard_cost,
-          ParallelScatter);  // TODO: Come up with a good cost estimate.
-    return bad_index;
+    Shard(worker_threads.num_threads, worker_threads.workers, num_groups,
+          shard_cost, ParallelScatter);
+    return -1;
   }
   Index SerialExecute(OpKernelContext* c, const Device& d,
                       typename TTypes<T>::Matrix params,
@@ -206,24 +199,19 @@ struct ScatterFunctorBase {
 #ifdef PLATFORM_GOOGLE
     // The parallel version is significantly slower internally. Only call the
     // serial version for now.
-    // TODO(penporn): Avoid locking in parallelization (sort beforehand).
+    // TODO(penporn): Re-evaluate now that ParallelExecute() sorts instead of
+    // locking.
     return SerialExecute(c, d, params, updates, indices);
 #else
     // indices and params sizes were validated in DoCompute().
     const Index N = static_cast<Index>(indices.size());
-    const Index limit = static_cast<Index>(params.dimension(0));
     const Index min_n_threshold = 1024;
-    const Index ser_par_ratio = 10000;
-    // For parallelizing the updates, duplicate entries need to be handled
-    // correctly. Multiple updates to the same index has to be serialized.
-    // This can lead to lock contention which may nullify the benefits of
-    // parallelization. Assuming uniform random distribution of the indices, we
-    // come up with a rough heuristic and determine whether the updates execute
-    // serially or parallelly. Also if 'N' is small, overheads of parallel
-    // execution outweigh its benefits and hence we check the value of N.
-    const bool execute_serial = N < min_n_threshold ||
-                                (N / limit) > ser_par_ratio ||
-                                OpDeterminismRequired();
+    // ParallelExecute() groups duplicate entries by index and applies each
+    // group from a single thread in input order, so it is deterministic and
+    // free of lock contention no matter how the indices are distributed. If
+    // 'N' is small, overheads of parallel execution outweigh its benefits and
+    // hence we check the value of N.
+    const bool execute_serial = N < min_n_threshold;
     if (execute_serial)
       return SerialExecute(c, d, params, updates, indices);
     else
@@ -217,6 +217,39 @@ TEST_F(ScatterSubOpTest, StressIndexTest) {
   test::ExpectTensorEqual<int32>(expected, params_tensor);
 }
 
+TEST_F(ScatterSubOpTest, DuplicateIndicesMatchSerialOrder) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+  // Enough updates to take the parallel path, with many duplicate rows whose
+  // float results depend on the order the updates are applied in.
+  const int kRows = 37;
+  const int kCols = 3;
+  const int kNumUpdates = 5000;
+  std::vector<float> values(kRows * kCols);
+  for (size_t i = 0; i < values.size(); ++i) values[i] = 1e7f + i;
+  std::vector<int32> indices(kNumUpdates);
+  std::vector<float> updates(kNumUpdates * kCols);
+  for (int i = 0; i < kNumUpdates; ++i) {
+    indices[i] = (i * 7 + i / 11) % kRows;
+    for (int j = 0; j < kCols; ++j) {
+      updates[i * kCols + j] = (i % 5 == 0 ? 1e6f : 0.37f) * (j + 1);
+    }
+  }
+  std::vector<float> expected_values = values;
+  for (int i = 0; i < kNumUpdates; ++i) {
+    for (int j = 0; j < kCols; ++j) {
+      expected_values[indices[i] * kCols + j] -= updates[i * kCols + j];
+    }
+  }
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), values);
+  AddInputFromArray<int32>(TensorShape({kNumUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kNumUpdates, kCols}), updates);
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor params_tensor = *mutable_input(0).tensor;
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kRows, kCols}));
+  test::FillValues<float>(&expected, expected_values);
+  test::ExpectTensorEqual<float>(expected, params_tensor);
+}
+
 TEST_F(ScatterUpdateOpTest, Error_WrongDimsIndices) {
   MakeOp(DT_FLOAT_REF, DT_INT32);
 
@@ -18,7 +18,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 #define TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "tensorflow/core/framework/op_requires.h"
 #include "tensorflow/core/platform/types.h"
@@ -40,8 +42,10 @@ limitations under the License.
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 #include "tensorflow/core/common_runtime/gpu/gpu_event_mgr.h"
@@ -76,6 +80,79 @@ Status ValidateSparseSegmentReduction(OpKernelContext* context,
                                       const Tensor& indices,
                                       const Tensor& segment_ids,
                                       bool has_num_segments);
+
+// Input rows per shard below which a segment reduction runs on the calling
+// thread; smaller reductions do not amortize the cost of scheduling.
+constexpr int64_t kMinSegmentReductionElementsPerShard = 1 << 15;
+
+// Splits segments [0, num_segments) into at most `max_shards` contiguous
+// ranges of about the same cost, so that a few large segments do not leave
+// most threads idle when segment sizes are skewed. `rows_before(s)` returns
+// the number of input rows in segments [0, s) and must be non-decreasing;
+// each segment costs its rows plus one for its output row. Returns the range
+// boundaries, starting with 0 and ending with num_segments.
+template <typename RowsBeforeF>
+std::vector<int64_t> SegmentBalancedShardBoundaries(int64_t num_segments,
+                                                    int64_t max_shards,
+                                                    RowsBeforeF rows_before) {
+  auto cost_before = [&](int64_t s) -> int64_t { return rows_before(s) + s; };
+  const int64_t total_cost = cost_before(num_segments);
+  const int64_t num_shards =
+      std::max<int64_t>(1, std::min(max_shards, num_segments));
+
+  std::vector<int64_t> boundaries = {0};
+  for (int64_t shard = 1; shard < num_shards; ++shard) {
+    // Find the first segment at which the cost reaches this shard's share.
+    const int64_t target = total_cost * shard / num_shards;
+    int64_t lo = boundaries.back();
+    int64_t hi = num_segments;
+    while (lo < hi) {
+      const int64_t mid = lo + (hi - lo) / 2;
+      if (cost_before(mid) < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo > boundaries.back()) boundaries.push_back(lo);
+  }
+  if (boundaries.back() < num_segments) boundaries.push_back(num_segments);
+  return boundaries;
+}
+
+// Calls `fn(begin, end)` on ranges of segments [0, num_segments) in parallel
+// on the CPU worker threads of `context`, balancing the ranges by the number
+// of input rows in each segment as given by `rows_before` (see
+// SegmentBalancedShardBoundaries). Every segment is handled by exactly one
+// call. `num_cols` is the number of elements in each input row.
+template <typename RowsBeforeF, typename Fn>
+void ParallelForSegments(OpKernelContext* context, int64_t num_segments,
+                         int64_t num_cols, RowsBeforeF rows_before, Fn fn) {
+  if (num_segments == 0) return;
+  const int64_t num_elements = (rows_before(num_segments) + num_segments) *
+                               std::max<int64_t>(1, num_cols);
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  const int64_t max_shards = std::min<int64_t>(
+      4 * worker_threads->num_threads,
+      num_elements / kMinSegmentReductionElementsPerShard);
+  if (max_shards <= 1) {
+    fn(0, num_segments);
+    return;
+  }
+  const std::vector<int64_t> boundaries =
+      SegmentBalancedShardBoundaries(num_segments, max_shards, rows_before);
+  worker_threads->workers->ParallelFor(
+      boundaries.size() - 1 /* total */,
+      thread::ThreadPool::SchedulingParams(
+          thread::ThreadPool::SchedulingStrategy::
+              kFixedBlockSize /* strategy */,
+          absl::nullopt /* cost_per_unit */, 1 /* block_size */),
+      [&](int64_t shard_begin, int64_t shard_end) {
+        for (int64_t shard = shard_begin; shard < shard_end; ++shard) {
+          fn(boundaries[shard], boundaries[shard + 1]);
+        }
+      });
+}
 }  // namespace internal
 
 // This operator handles reducing segments along the first dimension.
@@ -125,82 +202,106 @@ class SegmentReductionOp : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
-    Eigen::IndexList<Eigen::type2index<0> > dims_to_reduce;
-    Index start = 0, end = 1;
-
-    Index uninitialized_index = 0;  // Index from which the output is not set.
-    Index out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    // TODO(agarwal): if this loop becomes a bottleneck, consider sharding it
-    // across threads.
-    Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
-    while (end <= num_indices) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      Index next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
+    // Validate the segment ids and find the range of rows reduced into each
+    // output row. The segments are then reduced in parallel, balanced by their
+    // number of rows; each one also fills the rows of missing segment ids
+    // before it with the default value.
+    std::vector<Segment> segments;
+    {
+      int64_t start = 0;
+      Index uninitialized_index = 0;  // Index from which the output is not set.
+      Index out_index = internal::SubtleMustCopy(segment_vec(start));
+      for (int64_t end = 1; end <= num_indices; ++end) {
+        // We initialize next_index to 0 to avoid "warning: 'next_index' may be
+        // used uninitialized in this function" in the Mac build (since the
+        // compiler isn't smart enough to realize the code is safe).
+        Index next_index = 0;
+        if (end < num_indices) {
+          next_index = internal::SubtleMustCopy(segment_vec(end));
+          if (out_index == next_index) continue;
+          // We have a new segment here.  Verify that the segment ids are
+          // growing.
+          OP_REQUIRES(
+              context, out_index < next_index,
+              errors::InvalidArgument("segment ids are not increasing"));
         }
-        // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
-                    errors::InvalidArgument("segment ids are not increasing"));
+
+        OP_REQUIRES(
+            context, FastBoundsCheck(out_index, output_rows),
+            errors::InvalidArgument(
+                "Segment id ", out_index, " out of range [0, ", output_rows,
+                "), possibly because 'segment_ids' input is not sorted."));
+
+        segments.push_back({out_index, uninitialized_index, start, end});
+        start = end;
+        uninitialized_index = out_index + 1;
+        out_index = next_index;
       }
+    }
 
-      // Process segment [start, end)
-      const T* in_slice_ptr = &input_flat(start, 0);
+    Eigen::IndexList<Eigen::type2index<0> > dims_to_reduce;
+    Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
+    auto reduce_segments = [&](int64_t begin, int64_t end) {
       typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
                                Eigen::Unaligned>
           OutT;
+      for (int64_t i = begin; i < end; ++i) {
+        const Segment& segment = segments[i];
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        if (segment.out_index > segment.gap_start) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              segment.out_index - segment.gap_start, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(segment.gap_start, 0), gap_slice_shape);
+          gap_slice.setConstant(T(default_value));
+        }
 
-      OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
-          errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
-              "), possibly because 'segment_ids' input is not sorted."));
-
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(T(default_value));
-      }
-
-      T* out_slice_ptr = &output_flat(out_index, 0);
-      OutT out_slice(out_slice_ptr, out_slice_shape);
-      // We don't use out_slice.device(context->eigen_device<Device>)
-      // because these pieces of work are likely to be very small and
-      // the context switching overhead dwarfs any benefit we get from
-      // using another thread to do this work.
-      if (start == end - 1) {
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, out_slice_shape);
-        out_slice = in_slice;
-      } else {
-        Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(end - start,
-                                                           num_col);
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, in_slice_shape);
-
-        out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+        // Process segment [start, end)
+        const T* in_slice_ptr = &input_flat(segment.start, 0);
+        T* out_slice_ptr = &output_flat(segment.out_index, 0);
+        OutT out_slice(out_slice_ptr, out_slice_shape);
+        // We don't use out_slice.device(context->eigen_device<Device>)
+        // because these pieces of work are likely to be very small and
+        // the context switching overhead dwarfs any benefit we get from
+        // using another thread to do this work.
+        if (segment.start == segment.end - 1) {
+          typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
+                                   Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, out_slice_shape);
+          out_slice = in_slice;
+        } else {
+          Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(
+              segment.end - segment.start, num_col);
+          typedef Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
+                                   Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, in_slice_shape);
+
+          out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+        }
       }
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-    }
+    };
+    internal::ParallelForSegments(
+        context, segments.size(), num_col,
+        [&](int64_t s) -> int64_t {
+          return s < static_cast<int64_t>(segments.size()) ? segments[s].start
+                                                         : num_indices;
+        },
+        reduce_segments);
   }
+
+ private:
+  // The range [start, end) of input rows reduced into output row `out_index`.
+  // Rows [gap_start, out_index) have no input rows and get the default value.
+  struct Segment {
+    Index out_index;
+    Index gap_start;
+    int64_t start;
+    int64_t end;
+  };
 };
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -366,37 +467,58 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     const int64_t inner_dim = data.dimension(1);
     ReductionF reduction;
 
-    // `num_real_segment` counts the rows actually reduced from input,
-    // the rows with negative segment index will be excluded.
-    // It will be used for cost model.
-    int64_t num_real_segment = N;
-    // `num_reductions` counts the rows actually reduced in output,
-    // the rows only filled with InitialValueF() will be excluded.
-    int64_t num_reductions = 0;
-    // `row_counter` records how many input rows will be reduced in each
-    // output row, the row only fills with InitialValueF() will keep 0.
-    // Length of non-zero elements is `num_reductions`.
-    std::vector<Index> row_counter(num_segments, 0);
+    // `segment_starts[j]` will hold the number of input rows reduced into
+    // output rows [0, j), filled by a count pass followed by a prefix sum.
+    // The rows with negative segment index are excluded.
+    std::vector<int64_t> segment_starts(num_segments + 1, 0);
+    // The number of rows with negative segment index.
+    int64_t num_dropped = 0;
+    // Whether the segment ids happen to be sorted, in which case the rows of
+    // each segment are contiguous and follow the dropped rows.
+    bool sorted = true;
+    Index prev_j = 0;
 
     for (int64_t i = 0; i < N; ++i) {
       Index j = internal::SubtleMustCopy(segment_ids(i));
+      if (i > 0 && j < prev_j) sorted = false;
+      prev_j = j;
       if (j < 0) {
-        --num_real_segment;
+        ++num_dropped;
         continue;
       }
       OP_REQUIRES(ctx, FastBoundsCheck(j, num_segments),
                   errors::InvalidArgument(
                       "segment_ids", SliceDebugString(segment_ids_shape, i),
                       " = ", j, " is out of range [0, ", num_segments, ")"));
-      if (row_counter[j] == 0) num_reductions++;
-      row_counter[j]++;
+      ++segment_starts[j + 1];
     }
 
     // Nothing to reduce. All output values equal to `InitialValueF()`.
-    if (num_reductions == 0) return;
+    if (num_dropped == N) return;
+
+    for (int64_t j = 0; j < num_segments; ++j) {
+      segment_starts[j + 1] += segment_starts[j];
+    }
 
-    // Parallelize by `num_segments`. It's simple, efficient and safe
-    // (no data dependency):
+    // Unless the ids are sorted, group the input rows by segment with a
+    // counting sort, which keeps the rows of each segment in input order.
+    std::vector<int64_t> rows;
+    if (!sorted) {
+      rows.resize(N - num_dropped);
+      std::vector<int64_t> next(segment_starts.begin(),
+                                segment_starts.end() - 1);
+      for (int64_t i = 0; i < N; ++i) {
+        Index j = internal::SubtleMustCopy(segment_ids(i));
+        if (FastBoundsCheck(j, num_segments) &&
+            next[j] < segment_starts[j + 1]) {
+          rows[next[j]++] = i;
+        }
+      }
+    }
+
+    // Parallelize by `num_segments`, balancing the shards by the number of
+    // rows in each segment. Every output row is reduced by one worker, in
+    // input order, so there is no data dependency:
     //
     //   input   segment_ids                 num_segments  operation
     //   | a0 |  | 0 |            worker 1:  |0|           f(a0, a1)
@@ -404,27 +526,19 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // N | c0 |  | 2 |       -->  worker 3:  |2|           f(c0)
     //   | b1 |  | 1 |
     //   | a1 |  | 0 |
-    //
-    // TODO(intel-tf): Balance workload in `row_counter` to make parallelism
-    //                 more efficient.
     auto reductionWorker = [&](int64_t begin, int64_t end) -> void {
-      for (int64_t i = 0; i < N; i++) {
-        Index j = internal::SubtleMustCopy(segment_ids(i));
-        // If `j` is in work scope of this worker, do the reduction.
-        if (j >= begin && j < end) {
-          reduction(data.template chip<0>(i), output.template chip<0>(j));
+      for (int64_t j = begin; j < end; ++j) {
+        auto out = output.template chip<0>(j);
+        for (int64_t k = segment_starts[j]; k < segment_starts[j + 1]; ++k) {
+          const int64_t i = sorted ? num_dropped + k : rows[k];
+          reduction(data.template chip<0>(i), out);
         }
       }
     };
-
-    // Reduction functors includes Sum, Max, Min, etc. Simply consider it
-    // will cost 5 cycles per operation.
-    const int64_t kAverTaskSize = num_real_segment / num_segments;
-    const int64_t compute_cycles = 5 * inner_dim * kAverTaskSize;
-    const int64_t input_bytes = sizeof(T) * inner_dim * kAverTaskSize;
-    const int64_t output_bytes = sizeof(T) * inner_dim * kAverTaskSize;
-    const Eigen::TensorOpCost cost(input_bytes, output_bytes, compute_cycles);
-    cpu_device.parallelFor(num_segments, cost, reductionWorker);
+    internal::ParallelForSegments(
+        ctx, num_segments, inner_dim,
+        [&](int64_t j) -> int64_t { return segment_starts[j]; },
+        reductionWorker);
   }
 };
 
@@ -602,60 +716,88 @@ class SparseSegmentReductionOpBase : public OpKernel {
     }
     auto temp_flat = temp.flat_outer_dims<float>();
 
-    int64_t start = 0, end = 1;
+    // Validate the segment ids and find the range of `indices` reduced into
+    // each output row. The segments are then reduced in parallel; each one
+    // also fills the rows of missing segment ids before it with the default
+    // value.
+    std::vector<SparseSegment> segments;
     // Index from which the output is not initialized.
     SegmentId uninitialized_index = 0;
-    SegmentId out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    while (true) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      SegmentId next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
+    {
+      int64_t start = 0;
+      SegmentId out_index = internal::SubtleMustCopy(segment_vec(start));
+      for (int64_t end = 1; end <= num_indices; ++end) {
+        // We initialize next_index to 0 to avoid "warning: 'next_index' may be
+        // used uninitialized in this function" in the Mac build (since the
+        // compiler isn't smart enough to realize the code is safe).
+        SegmentId next_index = 0;
+        if (end < num_indices) {
+          next_index = internal::SubtleMustCopy(segment_vec(end));
+          if (out_index == next_index) continue;
+          // We have a new segment here.  Verify that the segment ids are
+          // growing.
+          OP_REQUIRES(
+              context, out_index < next_index,
+              errors::InvalidArgument("segment ids are not increasing"));
         }
-        // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
-                    errors::InvalidArgument("segment ids are not increasing"));
-      }
 
-      OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
-          errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
-              "), possibly because 'segment_ids' input is not sorted."));
-
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(default_value_);
+        OP_REQUIRES(
+            context, FastBoundsCheck(out_index, output_rows),
+            errors::InvalidArgument(
+                "Segment id ", out_index, " out of range [0, ", output_rows,
+                "), possibly because 'segment_ids' input is not sorted."));
+
+        segments.push_back({out_index, uninitialized_index, start, end});
+        start = end;
+        uninitialized_index = out_index + 1;
+        out_index = next_index;
       }
-
-      auto out = output_flat.template chip<0>(out_index);
-      auto temp = temp_flat.template chip<0>(out_index);
-      const int bad_offset = Reduce<T, Index>(input_flat, indices_vec, start,
-                                              end - start, out, temp);
-      OP_REQUIRES(context, bad_offset < 0,
-                  errors::InvalidArgument(
-                      "Bad: indices[", start + bad_offset,
-                      "] == ", indices_vec(start + bad_offset),
-                      " out of range [0, ", input_flat.dimension(0), ")"));
-
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-      if (end > num_indices) break;
     }
 
+    mutex mu;
+    // Smallest position in `indices` holding an out-of-range index, or -1.
+    int64_t bad_position = -1;
+    auto reduce_segments = [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const SparseSegment& segment = segments[i];
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        if (segment.out_index > segment.gap_start) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              segment.out_index - segment.gap_start, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(segment.gap_start, 0), gap_slice_shape);
+          gap_slice.setConstant(default_value_);
+        }
+
+        auto out = output_flat.template chip<0>(segment.out_index);
+        auto temp = temp_flat.template chip<0>(segment.out_index);
+        const int64_t bad_offset =
+            Reduce<T, Index>(input_flat, indices_vec, segment.start,
+                             segment.end - segment.start, out, temp);
+        if (bad_offset >= 0) {
+          mutex_lock l(mu);
+          if (bad_position < 0 || segment.start + bad_offset < bad_position) {
+            bad_position = segment.start + bad_offset;
+          }
+        }
+      }
+    };
+    // Each segment gathers and accumulates about num_indices / num_segments
+    // rows of `num_col` elements.
+    const int64_t cost_per_segment =
+        (num_indices / segments.size() + 1) * num_col *
+        (Eigen::TensorOpCost::AddCost<T>() + sizeof(T));
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers,
+          segments.size(), cost_per_segment, reduce_segments);
+    OP_REQUIRES(context, bad_position < 0,
+                errors::InvalidArgument(
+                    "Bad: indices[", bad_position,
+                    "] == ", indices_vec(bad_position), " out of range [0, ",
+                    input_flat.dimension(0), ")"));
+
     // Fill the gap at the end with the default value.
     if (uninitialized_index < output_rows) {
       Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
@@ -667,6 +809,15 @@ class SparseSegmentReductionOpBase : public OpKernel {
   }
 
  private:
+  // The range [start, end) of `indices` reduced into output row `out_index`.
+  // Rows [gap_start, out_index) have no indices and get the default value.
+  struct SparseSegment {
+    SegmentId out_index;
+    SegmentId gap_start;
+    int64_t start;
+    int64_t end;
+  };
+
   const DataType dtidx_;
   template <typename Tin>
   using EnableIfBfloat16OrHalf =
@@ -40,7 +40,9 @@ namespace tensorflow {
 
 static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
                                         const string& reduction, int num_rows,
-                                        int num_cols, int segment_size) {
+                                        int num_cols, int segment_size,
+                                        std::function<int(int)> segment_id =
+                                            nullptr) {
   std::unique_ptr<Device> device(
       DeviceFactory::NewDevice("CPU", {}, "/job:a/replica:0/task:0"));
 
@@ -53,8 +55,10 @@ static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
 
   TensorShape shape2({num_rows});
   Tensor indices(DT_INT32, shape2);
-  test::FillFn<int>(&indices,
-                    [&segment_size](int i) -> int { return i % segment_size; });
+  if (segment_id == nullptr) {
+    segment_id = [segment_size](int i) -> int { return i % segment_size; };
+  }
+  test::FillFn<int>(&indices, segment_id);
   reduction_inputs.push_back({nullptr, &indices});
 
   Tensor num_segments(DT_INT32, TensorShape({}));
@@ -106,10 +110,39 @@ static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
 BM_UnsortedReduce_Arg(4096, 1024, 1);
 BM_UnsortedReduce_Arg(4096, 1024, 128);
 
+// Half of the rows go to segment 0 and the rest are spread over all segments,
+// either interleaved or sorted by segment id.
+static int SkewedSegmentId(int num_rows, int num_segments, int i) {
+  const int half = num_rows / 2;
+  return i < half ? 0 : static_cast<int64_t>(i - half) * num_segments /
+                            (num_rows - half);
+}
+
+#define BM_UnsortedReduceSkewed(O, R, C, S)                     \
+  static void BM_##O##_Skewed_##R##_##C##_##S(                  \
+      ::testing::benchmark::State& state) {                     \
+    BM_UnsortedSegmentReduction(state, #O, R, C, S, [](int i) { \
+      return SkewedSegmentId(R, S, (i % 2) * (R / 2) + i / 2);  \
+    });                                                         \
+  }                                                             \
+  static void BM_##O##_SkewedSorted_##R##_##C##_##S(            \
+      ::testing::benchmark::State& state) {                     \
+    BM_UnsortedSegmentReduction(state, #O, R, C, S, [](int i) { \
+      return SkewedSegmentId(R, S, i);                          \
+    });                                                         \
+  }                                                             \
+  BENCHMARK(BM_##O##_Skewed_##R##_##C##_##S);                   \
+  BENCHMARK(BM_##O##_SkewedSorted_##R##_##C##_##S);
+
+BM_UnsortedReduceSkewed(UnsortedSegmentSum, 65536, 64, 256);
+BM_UnsortedReduceSkewed(UnsortedSegmentMax, 65536, 64, 256);
+
 template <typename Index>
 static void BM_SegmentReduction(::testing::benchmark::State& state,
                                 const string& reduction, Index num_rows,
-                                Index num_cols, Index segment_size) {
+                                Index num_cols, Index segment_size,
+                                std::function<Index(Index)> segment_id =
+                                    nullptr) {
   std::unique_ptr<Device> device(
       DeviceFactory::NewDevice("CPU", {}, "/job:a/replica:0/task:0"));
 
@@ -121,9 +154,12 @@ static void BM_SegmentReduction(::testing::benchmark::State& state,
 
   TensorShape shape2({num_rows});
   Tensor input2(DataTypeToEnum<Index>::v(), shape2);
-  test::FillFn<Index>(&input2, [&num_rows, &segment_size](Index i) -> Index {
-    return std::min(i / segment_size, num_rows - 1);
-  });
+  if (segment_id == nullptr) {
+    segment_id = [num_rows, segment_size](Index i) -> Index {
+      return std::min(i / segment_size, num_rows - 1);
+    };
+  }
+  test::FillFn<Index>(&input2, segment_id);
   reduction_inputs.push_back({nullptr, &input2});
 
   NodeDef reduction_node_def;
@@ -181,6 +217,18 @@ BM_Reduce_Arg(64, 32, 2);
 BM_Reduce_Arg(4096, 32, 2);
 BM_Reduce_Arg(4096, 128, 2);
 
+#define BM_ReduceSkewed(O, R, C, S)                            \
+  static void BM_Reduce_##O##_Skewed_##R##_##C##_##S(          \
+      ::testing::benchmark::State& state) {                    \
+    BM_SegmentReduction<int32>(state, #O, R, C, S, [](int i) { \
+      return SkewedSegmentId(R, S, i);                         \
+    });                                                        \
+  }                                                            \
+  BENCHMARK(BM_Reduce_##O##_Skewed_##R##_##C##_##S);
+
+BM_ReduceSkewed(SegmentSum, 65536, 64, 256);
+BM_ReduceSkewed(SegmentMax, 65536, 64, 256);
+
 template <DataType T>
 static void SparseSegmentMeanGradHelper(::testing::benchmark::State& state,
                                         float uniqueness, int size) {
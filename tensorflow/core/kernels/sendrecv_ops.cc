@@ -75,6 +75,9 @@ SendOp::SendOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
   if (!ctx->GetAttr("_hostmem_sendrecv", &hostmem_sendrecv_).ok()) {
     hostmem_sendrecv_ = false;
   }
+  if (!ctx->GetAttr("_wire_codec", &wire_codec_).ok()) {
+    wire_codec_.clear();
+  }
 }
 
 void SendOp::Compute(OpKernelContext* ctx) {
@@ -89,6 +92,7 @@ void SendOp::Compute(OpKernelContext* ctx) {
   Rendezvous::Args args;
   args.device_context = ctx->op_device_context();
   args.alloc_attrs = ctx->input_alloc_attr(0);
+  args.wire_codec = wire_codec_;
 
   FrameAndIter frame_iter = GetFrameAndIter(ctx, hostmem_sendrecv_);
   if (frame_iter == FrameAndIter(0, 0)) {
@@ -100,11 +104,9 @@ void SendOp::Compute(OpKernelContext* ctx) {
     return;
   } else {
     Rendezvous::ParsedKey in_loop_parsed;
-    GetRendezvousKey(key_prefix_, frame_iter, &in_loop_parsed.buf_);
+    Rendezvous::ReplaceFrameAndIter(parsed_key_, frame_iter, &in_loop_parsed);
     VLOG(2) << "Send " << in_loop_parsed.buf_ << " using "
             << reinterpret_cast<uintptr_t>(ctx->rendezvous());
-    OP_REQUIRES_OK(ctx,
-                   Rendezvous::ParseKey(in_loop_parsed.buf_, &in_loop_parsed));
 
     ctx->SetStatus(ctx->rendezvous()->Send(in_loop_parsed, args, ctx->input(0),
                                            ctx->is_input_dead()));
@@ -206,11 +208,9 @@ void RecvOp::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
                                  make_recv_callback(ctx, std::move(done)));
   } else {
     Rendezvous::ParsedKey in_loop_parsed;
-    GetRendezvousKey(key_prefix_, frame_iter, &in_loop_parsed.buf_);
+    Rendezvous::ReplaceFrameAndIter(parsed_key_, frame_iter, &in_loop_parsed);
     VLOG(2) << "Recv " << in_loop_parsed.buf_ << " using "
             << reinterpret_cast<uintptr_t>(ctx->rendezvous());
-    OP_REQUIRES_OK_ASYNC(
-        ctx, Rendezvous::ParseKey(in_loop_parsed.buf_, &in_loop_parsed), done);
     ctx->rendezvous()->RecvAsync(in_loop_parsed, args,
                                  make_recv_callback(ctx, std::move(done)));
   }
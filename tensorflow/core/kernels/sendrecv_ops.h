@@ -32,6 +32,7 @@ class SendOp : public OpKernel {
   string key_prefix_;
   Rendezvous::ParsedKey parsed_key_;
   bool hostmem_sendrecv_;
+  string wire_codec_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SendOp);
 };
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/sparse/kernels.h"
 
+#include <algorithm>
 #include <numeric>
+#include <vector>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -103,4 +105,52 @@ Status SparseTensorToCSRSparseMatrixCPUFunctor::operator()(
 }
 
 }  // namespace functor
+
+std::vector<int64_t> NnzBalancedShardBoundaries(const CSRSparseMatrix& csr,
+                                                const int64_t batch_size,
+                                                const int64_t num_rows,
+                                                const int64_t max_shards) {
+  std::vector<int64_t> nnz_before_batch(batch_size + 1, 0);
+  for (int64_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
+    nnz_before_batch[batch_idx + 1] =
+        nnz_before_batch[batch_idx] + csr.nnz(batch_idx);
+  }
+  const int64_t total_rows = batch_size * num_rows;
+  // The cost of all rows before flattened row `row`.
+  auto cost_before = [&](int64_t row) -> int64_t {
+    if (row == total_rows) return nnz_before_batch[batch_size] + total_rows;
+    const int64_t batch_idx = row / num_rows;
+    return nnz_before_batch[batch_idx] +
+           csr.row_pointers_vec(batch_idx)(row % num_rows) + row;
+  };
+  const int64_t total_cost = cost_before(total_rows);
+  const int64_t num_shards =
+      std::max<int64_t>(1, std::min(max_shards, total_rows));
+
+  std::vector<int64_t> boundaries = {0};
+  for (int64_t shard = 1; shard < num_shards; ++shard) {
+    // Find the first row at which the cost reaches this shard's share.
+    const int64_t target = total_cost * shard / num_shards;
+    int64_t lo = boundaries.back();
+    int64_t hi = total_rows;
+    while (lo < hi) {
+      const int64_t mid = lo + (hi - lo) / 2;
+      if (cost_before(mid) < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    // End the shard before or after the row that crosses the target, whichever
+    // is closer, so that a long row does not absorb the short rows before it.
+    if (lo > boundaries.back() &&
+        target - cost_before(lo - 1) < cost_before(lo) - target) {
+      --lo;
+    }
+    if (lo > boundaries.back() && lo < total_rows) boundaries.push_back(lo);
+  }
+  if (total_rows > 0) boundaries.push_back(total_rows);
+  return boundaries;
+}
+
 }  // namespace tensorflow
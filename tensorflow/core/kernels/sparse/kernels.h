@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SPARSE_KERNELS_H_
 #define TENSORFLOW_CORE_KERNELS_SPARSE_KERNELS_H_
 
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor_types.h"
@@ -247,6 +249,18 @@ class CSRSparseMatrixBatchMulVec {
 
 }  // namespace functor
 
+// Splits the rows of every batch of `csr`, flattened into
+// [0, batch_size * num_rows), into at most `max_shards` contiguous ranges of
+// roughly equal cost, counting one unit per row plus one per nonzero.
+// Compared to fixed-size blocks of rows, this keeps the threads evenly
+// loaded when row lengths are skewed, as in the adjacency matrices of
+// power-law graphs. Returns the range boundaries, starting with 0 and ending
+// with batch_size * num_rows.
+std::vector<int64_t> NnzBalancedShardBoundaries(const CSRSparseMatrix& csr,
+                                                int64_t batch_size,
+                                                int64_t num_rows,
+                                                int64_t max_shards);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_SPARSE_KERNELS_H_
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/sparse/kernels.h"
 
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -73,6 +75,75 @@ TEST(SparseTensorToCSRSparseMatrix, BatchConversion) {
   test::ExpectTensorEqual<int32>(csr_col_ind, test::AsTensor<int32>({0, 3, 1}));
 }
 
+// Returns a float CSRSparseMatrix of shape [batch_size, num_rows, num_cols]
+// whose row `r` of batch `b` holds row_lengths[b][r] nonzeros.
+CSRSparseMatrix MakeCSRSparseMatrix(
+    int num_cols, const std::vector<std::vector<int>>& row_lengths) {
+  const int batch_size = row_lengths.size();
+  const int num_rows = row_lengths[0].size();
+  std::vector<int32> batch_ptrs = {0};
+  std::vector<int32> row_ptrs;
+  std::vector<int32> col_indices;
+  for (const std::vector<int>& batch : row_lengths) {
+    row_ptrs.push_back(0);
+    for (const int row_length : batch) {
+      for (int col = 0; col < row_length; ++col) col_indices.push_back(col);
+      row_ptrs.push_back(row_ptrs.back() + row_length);
+    }
+    batch_ptrs.push_back(batch_ptrs.back() + row_ptrs.back());
+  }
+  const int64_t total_nnz = col_indices.size();
+  Tensor values(DT_FLOAT, TensorShape({total_nnz}));
+  values.flat<float>().setConstant(1.0f);
+  CSRSparseMatrix matrix;
+  TF_CHECK_OK(CSRSparseMatrix::CreateCSRSparseMatrix(
+      DT_FLOAT, test::AsTensor<int64_t>({batch_size, num_rows, num_cols}),
+      test::AsTensor<int32>(batch_ptrs), test::AsTensor<int32>(row_ptrs),
+      test::AsTensor<int32>(col_indices), values, &matrix));
+  return matrix;
+}
+
+TEST(NnzBalancedShardBoundaries, SplitsEmptyRowsEvenly) {
+  const CSRSparseMatrix matrix =
+      MakeCSRSparseMatrix(/*num_cols=*/4, {{0, 0, 0, 0}, {0, 0, 0, 0}});
+  EXPECT_EQ(NnzBalancedShardBoundaries(matrix, /*batch_size=*/2,
+                                       /*num_rows=*/4, /*max_shards=*/4),
+            std::vector<int64_t>({0, 2, 4, 6, 8}));
+  // There are no more shards than rows.
+  EXPECT_EQ(NnzBalancedShardBoundaries(matrix, /*batch_size=*/2,
+                                       /*num_rows=*/4, /*max_shards=*/16),
+            std::vector<int64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8}));
+  EXPECT_EQ(NnzBalancedShardBoundaries(matrix, /*batch_size=*/2,
+                                       /*num_rows=*/4, /*max_shards=*/1),
+            std::vector<int64_t>({0, 8}));
+}
+
+TEST(NnzBalancedShardBoundaries, IsolatesLongRows) {
+  // A long first row gets a shard of its own, and so do the short rows after
+  // it, rather than splitting the short rows into fixed-size blocks.
+  EXPECT_EQ(NnzBalancedShardBoundaries(
+                MakeCSRSparseMatrix(/*num_cols=*/32,
+                                    {{24, 0, 0, 0, 0, 0, 0, 0}}),
+                /*batch_size=*/1, /*num_rows=*/8, /*max_shards=*/4),
+            std::vector<int64_t>({0, 1, 8}));
+  // The short rows before a long last row are not merged into its shard.
+  EXPECT_EQ(NnzBalancedShardBoundaries(
+                MakeCSRSparseMatrix(/*num_cols=*/32,
+                                    {{0, 0, 0, 0, 0, 0, 0, 24}}),
+                /*batch_size=*/1, /*num_rows=*/8, /*max_shards=*/4),
+            std::vector<int64_t>({0, 7, 8}));
+}
+
+TEST(NnzBalancedShardBoundaries, BalancesAcrossBatches) {
+  // Rows of all batches are flattened, so the rows of the dense first batch
+  // get most of the shards and the empty second batch joins the last one.
+  EXPECT_EQ(NnzBalancedShardBoundaries(
+                MakeCSRSparseMatrix(/*num_cols=*/8,
+                                    {{7, 7, 7, 7}, {0, 0, 0, 0}}),
+                /*batch_size=*/2, /*num_rows=*/4, /*max_shards=*/4),
+            std::vector<int64_t>({0, 1, 2, 3, 8}));
+}
+
 }  // namespace
 }  // namespace tensorflow
 
@@ -300,19 +300,21 @@ class CSRMatMulCPUOp : public CSRMatMulOp<CPUDevice, T> {
     // rows in each batch.
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
     const int32_t num_threads = worker_threads.num_threads;
-    const int64_t block_size =
-        num_lhs_rows / std::max(kMaxShards, kNumShardsPerThread * num_threads);
+    const std::vector<int64_t> shard_boundaries = NnzBalancedShardBoundaries(
+        lhs, batch_size, num_lhs_rows,
+        batch_size * std::max(kMaxShards, kNumShardsPerThread * num_threads));
     const int64_t num_rhs_rows = rhs.dim_size(rhs.dims() - 2);
     const int64_t num_rhs_cols = rhs.dim_size(rhs.dims() - 1);
     worker_threads.workers->ParallelFor(
-        batch_size * num_lhs_rows /* total */,
+        shard_boundaries.size() - 1 /* total */,
         thread::ThreadPool::SchedulingParams(
             thread::ThreadPool::SchedulingStrategy::
                 kFixedBlockSize /* strategy */,
-            absl::nullopt /* cost_per_unit */, block_size),
-        [&](int64_t batch_and_row_begin, int64_t batch_and_row_end) {
+            absl::nullopt /* cost_per_unit */, 1 /* block_size */),
+        [&](int64_t shard_begin, int64_t shard_end) {
           HandleBatchAndRowRange(
-              num_lhs_rows, batch_and_row_begin, batch_and_row_end,
+              num_lhs_rows, shard_boundaries[shard_begin],
+              shard_boundaries[shard_end],
               [&](int64_t batch_idx, int64_t row_begin, int64_t row_end) {
                 const int64_t num_shard_rows = row_end - row_begin;
 
@@ -373,17 +375,19 @@ class CSRMatMulCPUOp : public CSRMatMulOp<CPUDevice, T> {
 
     // Parallelize matrix multiplication across batch dimensions and across
     // columns of A^T in each batch. These correspond to rows of A.
-    const int64_t block_size =
-        num_lhs_cols / std::max(kMaxShards, kNumShardsPerThread * num_threads);
+    const std::vector<int64_t> shard_boundaries = NnzBalancedShardBoundaries(
+        lhs, batch_size, num_lhs_cols,
+        batch_size * std::max(kMaxShards, kNumShardsPerThread * num_threads));
     worker_threads.workers->ParallelForWithWorkerId(
-        batch_size * num_lhs_cols /* total */,
+        shard_boundaries.size() - 1 /* total */,
         thread::ThreadPool::SchedulingParams(
             thread::ThreadPool::SchedulingStrategy::
                 kFixedBlockSize /* strategy */,
-            absl::nullopt /* cost_per_unit */, block_size),
-        [&](int64_t batch_and_row_begin, int64_t batch_and_row_end, int tid) {
+            absl::nullopt /* cost_per_unit */, 1 /* block_size */),
+        [&](int64_t shard_begin, int64_t shard_end, int tid) {
           HandleBatchAndRowRange(
-              num_lhs_cols, batch_and_row_begin, batch_and_row_end,
+              num_lhs_cols, shard_boundaries[shard_begin],
+              shard_boundaries[shard_end],
               [&](int64_t batch_idx, int64_t row_begin, int64_t row_end) {
                 const int64_t num_shard_rows = row_end - row_begin;
 
@@ -0,0 +1,87 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_SPARSE_ROW_GROUPS_H_
+#define TENSORFLOW_CORE_KERNELS_SPARSE_ROW_GROUPS_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/bounds_check.h"
+
+namespace tensorflow {
+
+// `SparseRowGroups` groups the positions of a vector of row indices by index,
+// so that the updates to each distinct destination row of a scatter or sparse
+// optimizer step can be applied by a single thread, without locks, while
+// different rows are updated in parallel.
+//
+// Positions keep their original relative order within a group, so applying
+// a group's updates in sequence reproduces a serial loop over the indices
+// exactly, including for duplicate indices.
+template <typename Index>
+class SparseRowGroups {
+ public:
+  // Groups the `n` entries of `indices`, each of which is read exactly once.
+  // Returns the first position whose index is outside `[0, limit)`, in which
+  // case the groups are left empty, or -1 if every index is in range.
+  Index Init(const Index* indices, Index n, Index limit) {
+    entries_.resize(n);
+    for (Index i = 0; i < n; ++i) {
+      const Index index = internal::SubtleMustCopy(indices[i]);
+      if (!FastBoundsCheck(index, limit)) {
+        entries_.clear();
+        starts_.assign(1, 0);
+        return i;
+      }
+      entries_[i] = {index, i};
+    }
+    // Sorting by (index, position) keeps each group in input order.
+    std::sort(entries_.begin(), entries_.end());
+    starts_.clear();
+    for (Index i = 0; i < n; ++i) {
+      if (i == 0 || entries_[i].first != entries_[i - 1].first) {
+        starts_.push_back(i);
+      }
+    }
+    starts_.push_back(n);
+    return -1;
+  }
+
+  Index num_groups() const { return static_cast<Index>(starts_.size()) - 1; }
+
+  // Returns the destination row of group `g`.
+  Index row(Index g) const { return entries_[starts_[g]].first; }
+
+  // Calls `fn(position)` for every position of group `g`, in input order.
+  template <typename Fn>
+  void ForEachPosition(Index g, Fn fn) const {
+    for (Index k = starts_[g]; k < starts_[g + 1]; ++k) {
+      fn(entries_[k].second);
+    }
+  }
+
+ private:
+  // (index, position) pairs sorted by index, then position.
+  std::vector<std::pair<Index, Index>> entries_;
+  // Offsets into `entries_` of the first entry of each group, followed by
+  // the number of entries.
+  std::vector<Index> starts_ = {0};
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_SPARSE_ROW_GROUPS_H_
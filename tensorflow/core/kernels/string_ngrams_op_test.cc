@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/shape_inference.h"
@@ -22,9 +24,11 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace text {
@@ -587,5 +591,37 @@ TEST_F(NgramKernelTest, ShapeFn) {
   INFER_ERROR("Shape must be rank 1 but is rank 0", op, "?;[]");
 }
 
+// Builds bigrams and trigrams over `batch_size` sequences of 32 tokens.
+static void BM_StringNGrams(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+  const int tokens_per_item = 32;
+
+  Tensor data(DT_STRING, TensorShape({batch_size * tokens_per_item}));
+  auto data_flat = data.flat<tstring>();
+  for (int i = 0; i < data_flat.size(); ++i) {
+    data_flat(i) = absl::StrCat("token", i % 1000);
+  }
+  Tensor splits(DT_INT64, TensorShape({batch_size + 1}));
+  auto splits_flat = splits.flat<int64_t>();
+  for (int i = 0; i <= batch_size; ++i) splits_flat(i) = i * tokens_per_item;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  TF_CHECK_OK(NodeBuilder("string_ngrams_op", "StringNGrams")
+                  .Input(test::graph::Constant(g, data))
+                  .Input(test::graph::Constant(g, splits))
+                  .Attr("separator", " ")
+                  .Attr("ngram_widths", std::vector<int>{2, 3})
+                  .Attr("left_pad", "<")
+                  .Attr("right_pad", ">")
+                  .Attr("pad_width", -1)
+                  .Attr("preserve_short_sequences", false)
+                  .Finalize(g, nullptr /* node */));
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          batch_size);
+}
+
+BENCHMARK(BM_StringNGrams)->UseRealTime()->Arg(8)->Arg(256)->Arg(4096);
+
 }  // namespace text
 }  // namespace tensorflow
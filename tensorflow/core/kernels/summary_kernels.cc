@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/summary/schema.h"
 #include "tensorflow/core/summary/summary_db_writer.h"
 #include "tensorflow/core/summary/summary_file_writer.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/event.pb.h"
 
 namespace tensorflow {
@@ -33,7 +34,16 @@ REGISTER_KERNEL_BUILDER(Name("SummaryWriter").Device(DEVICE_CPU),
 class CreateSummaryFileWriterOp : public OpKernel {
  public:
   explicit CreateSummaryFileWriterOp(OpKernelConstruction* ctx)
-      : OpKernel(ctx) {}
+      : OpKernel(ctx) {
+    // A positive TF_SUMMARY_ASYNC_WRITER_MAX_PENDING moves the file I/O of
+    // new writers to a background thread that buffers up to that many events.
+    OP_REQUIRES_OK(ctx,
+                   ReadInt64FromEnvVar("TF_SUMMARY_ASYNC_WRITER_MAX_PENDING",
+                                       0, &async_max_pending_events_));
+    OP_REQUIRES_OK(
+        ctx, ReadBoolFromEnvVar("TF_SUMMARY_ASYNC_WRITER_DROP_ON_OVERFLOW",
+                                false, &async_drop_on_overflow_));
+  }
 
   void Compute(OpKernelContext* ctx) override {
     const Tensor* tmp;
@@ -57,13 +67,24 @@ class CreateSummaryFileWriterOp : public OpKernel {
     core::RefCountPtr<SummaryWriterInterface> s;
     OP_REQUIRES_OK(ctx, LookupOrCreateResource<SummaryWriterInterface>(
                             ctx, HandleFromInput(ctx, 0), &s,
-                            [max_queue, flush_millis, logdir, filename_suffix,
-                             ctx](SummaryWriterInterface** s) {
+                            [this, max_queue, flush_millis, logdir,
+                             filename_suffix, ctx](SummaryWriterInterface** s) {
+                              if (async_max_pending_events_ > 0) {
+                                return CreateAsyncSummaryFileWriter(
+                                    max_queue, flush_millis,
+                                    async_max_pending_events_,
+                                    async_drop_on_overflow_, logdir,
+                                    filename_suffix, ctx->env(), s);
+                              }
                               return CreateSummaryFileWriter(
                                   max_queue, flush_millis, logdir,
                                   filename_suffix, ctx->env(), s);
                             }));
   }
+
+ private:
+  int64_t async_max_pending_events_;
+  bool async_drop_on_overflow_;
 };
 REGISTER_KERNEL_BUILDER(Name("CreateSummaryFileWriter").Device(DEVICE_CPU),
                         CreateSummaryFileWriterOp);
@@ -126,6 +126,13 @@ class TensorList {
   std::vector<Tensor>& tensors() { return tensors_->values_; }
   const std::vector<Tensor>& tensors() const { return tensors_->values_; }
 
+  // A tensor whose slices along its first dimension were used as the leading
+  // elements of the list when it was built (see TensorListFromTensor), or a
+  // default-constructed tensor. Elements may since have been replaced, so
+  // callers must check that an element still aliases its slice before using it.
+  Tensor& storage() { return tensors_->storage_; }
+  const Tensor& storage() const { return tensors_->storage_; }
+
   // Get a new TensorList containing a copy of the underlying tensor container.
   TensorList Copy() const {
     TensorList out;
@@ -134,6 +141,7 @@ class TensorList {
     out.max_num_elements = max_num_elements;
     // This performs a copy of the std::vector.
     out.tensors_->values_ = tensors_->values_;
+    out.tensors_->storage_ = tensors_->storage_;
     return out;
   }
 
@@ -145,6 +153,7 @@ class TensorList {
   class Tensors : public core::RefCounted {
    public:
     std::vector<Tensor> values_;
+    Tensor storage_;
   };
   Tensors* tensors_;
 };
@@ -37,6 +37,22 @@ template <typename T>
 void TileSimple(const Eigen::GpuDevice& d, Tensor* out, const Tensor& in);
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+// Device-specific implementation for Tile that copies whole innermost rows of
+// the input. Returns false, leaving `out` untouched, if the innermost
+// dimension is too small for row copies to pay off.
+
+template <typename T>
+bool TileUsingRowCopies(const Eigen::ThreadPoolDevice& d, Tensor* out,
+                        const Tensor& in);
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+template <typename T>
+bool TileUsingRowCopies(const Eigen::GpuDevice& d, Tensor* out,
+                        const Tensor& in) {
+  return false;
+}
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
 template <typename Device, typename T, typename Tmultiples, int NDIM>
 void TileUsingEigen(const Device& d, Tensor* out, const Tensor& in,
                     const gtl::ArraySlice<Tmultiples> broadcast_array) {
@@ -64,6 +80,7 @@ template <typename Device, typename T, typename Tmultiples>
 struct Tile {
   void operator()(const Device& d, Tensor* out, const Tensor& in,
                   const gtl::ArraySlice<Tmultiples> broadcast_array) const {
+    if (internal::TileUsingRowCopies<T>(d, out, in)) return;
     switch (in.dims()) {
       case 0:
         internal::TileUsingEigen<Device, T, Tmultiples>(d, out, in,
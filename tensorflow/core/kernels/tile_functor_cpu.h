@@ -17,6 +17,8 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/kernels/tile_functor.h"
 
@@ -51,6 +53,54 @@ void TileSimple(const Eigen::ThreadPoolDevice& d, Tensor* out,
   return TileSimpleImpl<Eigen::ThreadPoolDevice, T>(d, out, in);
 }
 
+// Row copies are used once the innermost dimension of the input spans at
+// least this many bytes; below that, Eigen's broadcast does better.
+constexpr int64_t kMinTileRowBytes = 64;
+
+// Every innermost row of the output is one innermost row of the input, so
+// the output is produced one contiguous row copy at a time, with the rows
+// spread over the intra-op thread pool.
+template <typename T>
+bool TileUsingRowCopies(const Eigen::ThreadPoolDevice& d, Tensor* out,
+                        const Tensor& in) {
+  const int ndims = in.dims();
+  if (ndims == 0) return false;
+  const int64_t row_size = in.dim_size(ndims - 1);
+  if (row_size * static_cast<int64_t>(sizeof(T)) < kMinTileRowBytes) {
+    return false;
+  }
+  const int64_t num_rows = out->NumElements() / row_size;
+  if (num_rows == 0) return true;
+  gtl::InlinedVector<int64_t, 8> in_strides =
+      ComputeStride<int64_t>(in.shape());
+  // Output rows along each dimension; the innermost dimension holds
+  // `multiples` rows per input row.
+  gtl::InlinedVector<int64_t, 8> out_rows(ndims);
+  for (int i = 0; i < ndims - 1; ++i) out_rows[i] = out->dim_size(i);
+  out_rows[ndims - 1] = out->dim_size(ndims - 1) / row_size;
+  const T* p = in.flat<T>().data();
+  T* q = out->flat<T>().data();
+  auto copy_rows = [=, &in_strides, &out_rows, &in](int64_t begin,
+                                                    int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t in_offset = 0;
+      int64_t t = row / out_rows[ndims - 1];
+      for (int i = ndims - 2; i >= 0; --i) {
+        in_offset += t % out_rows[i] % in.dim_size(i) * in_strides[i];
+        t /= out_rows[i];
+      }
+      std::copy_n(p + in_offset, row_size, q + row * row_size);
+    }
+  };
+  Eigen::TensorOpCost cost(
+      /*bytes_loaded=*/row_size * sizeof(T),
+      /*bytes_stored=*/row_size * sizeof(T),
+      /*compute_cycles=*/ndims * (2 * Eigen::TensorOpCost::DivCost<int64_t>() +
+                                  Eigen::TensorOpCost::MulCost<int64_t>()));
+  d.parallelFor(num_rows, cost, std::move(copy_rows));
+  return true;
+}
+
 }  // namespace internal
 }  // end namespace tensorflow
 
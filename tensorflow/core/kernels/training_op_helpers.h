@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 #define TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
@@ -25,20 +27,19 @@ limitations under the License.
 
 namespace tensorflow {
 
-// Must be called before performing a sparse operation on a variable. Ensures
-// that no concurrent dense operations can happen while holding the variable's
-// lock.
+// Like `EnsureSparseVariableAccess()`, but for callers that already hold an
+// exclusive lock on `*var->mu()`. Must also be called under that lock before a
+// sparse write updates the variable's buffer in place: in copy-on-read mode
+// dense reads may alias the buffer (see `Var::aliased_by_reads`), in which case
+// it is copied here if any of those reads are still alive.
+// REQUIRES: *var->mu() is held exclusively.
 template <typename Device, typename T>
-Status EnsureSparseVariableAccess(OpKernelContext* ctx, Var* var) {
-  if (var->copy_on_read_mode.load()) {
-    return OkStatus();
-  }
-  mutex_lock ml(*var->mu());
-  // Once copy-on-read mode is True the refcount is guaranteed to be 1. This can
-  // also happen if there are no concurrent reads of the variable and
-  // copy-on-read mode is false.
+Status EnsureSparseVariableAccessLocked(OpKernelContext* ctx, Var* var) {
+  // The refcount is 1 if no live tensor aliases the variable's buffer, in
+  // which case it can be updated in place.
   if (var->tensor()->RefCountIsOne()) {
     var->copy_on_read_mode.store(true);
+    var->aliased_by_reads.store(false);
     return OkStatus();
   }
   Tensor tmp;
@@ -65,9 +66,26 @@ Status EnsureSparseVariableAccess(OpKernelContext* ctx, Var* var) {
   }
   *var->tensor() = tmp;
   var->copy_on_read_mode.store(true);
+  var->aliased_by_reads.store(false);
   return OkStatus();
 }
 
+// Must be called before performing a sparse operation on a variable. Ensures
+// that no concurrent dense operations can happen while holding the variable's
+// lock.
+//
+// Sparse writes must additionally call `EnsureSparseVariableAccessLocked()`
+// after acquiring an exclusive lock if `var->aliased_by_reads` is set, since a
+// dense read may alias the buffer between this call and taking the lock.
+template <typename Device, typename T>
+Status EnsureSparseVariableAccess(OpKernelContext* ctx, Var* var) {
+  if (var->copy_on_read_mode.load()) {
+    return OkStatus();
+  }
+  mutex_lock ml(*var->mu());
+  return EnsureSparseVariableAccessLocked<Device, T>(ctx, var);
+}
+
 // Utility structure that releases a sequence of borrowed mutexes when it is
 // deleted.
 struct VariableInputLockHolder {
@@ -133,9 +151,12 @@ mutex* GetTrainingVariableMutex(OpKernelContext* ctx, int input, bool sparse,
 // variable gets switched to copy-on-read mode before trying to acquire the
 // locks. If do_lock is false, returns immediately for reference variables. For
 // resource variables in copy-on-read-mode it will grab a shared lock if do_lock
-// is false, exclusive lock otherwise.  Note that this silently doesn't lock
-// mutexes for invalid variable references; in all usages this is followed by
-// GetInputTensor which will signal a failure.
+// is false, exclusive lock otherwise; if sparse is true and a dense read has
+// aliased one of the variables, exclusive locks are taken regardless so that
+// its buffer can be copied before it is updated; if that copy fails, the
+// failure is set on `ctx`, which callers must check.  Note that this silently
+// doesn't lock mutexes for invalid variable references; in all usages this is
+// followed by GetInputTensor which will signal a failure.
 template <typename Device, typename T>
 VariableInputLockHolder MaybeLockVariableInputMutexesInOrder(
     OpKernelContext* ctx, bool do_lock, bool sparse,
@@ -181,6 +202,31 @@ VariableInputLockHolder MaybeLockVariableInputMutexesInOrder(
       }
     }
   }
+  if (sparse && std::any_of(vars.begin(), vars.end(), [](Var* var) {
+        return var->aliased_by_reads.load();
+      })) {
+    // A dense read aliased the buffer of a variable that is about to be
+    // updated in place, so it may need to be copied, which requires exclusive
+    // locks.
+    if (!do_lock) {
+      shared_locks->clear();
+      for (auto acquire : acquire_order) {
+        mutex* mu = mutexes[acquire];
+        if (mu != nullptr) {
+          locks->emplace_back(*mu);
+        }
+      }
+    }
+    for (Var* var : vars) {
+      if (var->aliased_by_reads.load()) {
+        Status s = EnsureSparseVariableAccessLocked<Device, T>(ctx, var);
+        if (!s.ok()) {
+          ctx->CtxFailureWithWarning(s);
+          break;
+        }
+      }
+    }
+  }
   return VariableInputLockHolder(std::move(vars), std::move(locks),
                                  std::move(shared_locks));
 }
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/kernels/sparse_row_groups.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -181,61 +182,63 @@ struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
                                     Eigen::TensorOpCost::MulCost<T>() * 2);
     const Eigen::TensorOpCost cost(in_bytes, out_bytes, cycles);
 
-    if (inner_dim > 1) {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
-        }
-      }
+    // Each distinct row is updated by one thread, applying its gradients in
+    // input order, so duplicate indices neither race nor change the result
+    // of a serial loop.
+    SparseRowGroups<Tindex> groups;
+    const Tindex bad_i = groups.Init(indices.data(), N, first_dim_size);
+    if (bad_i >= 0) {
+      return errors::InvalidArgument(strings::StrCat(
+          "Index ", internal::SubtleMustCopy(indices(bad_i)), " at offset ",
+          bad_i, " in indices is out of range"));
+    }
+    const Tindex num_groups = groups.num_groups();
+    const Eigen::TensorOpCost group_cost =
+        cost * (static_cast<double>(N) / num_groups);
 
+    if (inner_dim > 1) {
       const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
+        for (Tindex group = start_idx; group < end_idx; ++group) {
+          const Tindex index = groups.row(group);
           auto a = accum.template chip<0>(index);
-          auto g = grad.template chip<0>(i);
           auto v = var.template chip<0>(index);
-          if (update_slots) {
-            a += g.square();
-          }
-          if (has_epsilon) {
-            v -= g.constant(lr_scalar) * g / (a.sqrt() + a.constant(epsilon()));
-          } else {
-            v -= g.constant(lr_scalar) * g * a.rsqrt();
-          }
+          groups.ForEachPosition(group, [&](Tindex i) {
+            auto g = grad.template chip<0>(i);
+            if (update_slots) {
+              a += g.square();
+            }
+            if (has_epsilon) {
+              v -= g.constant(lr_scalar) * g /
+                   (a.sqrt() + a.constant(epsilon()));
+            } else {
+              v -= g.constant(lr_scalar) * g * a.rsqrt();
+            }
+          });
         }
       };
 
-      d.parallelFor(N, cost, shard);
+      d.parallelFor(num_groups, group_cost, shard);
     } else {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
-        }
-      }
-
       const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
+        for (Tindex group = start_idx; group < end_idx; ++group) {
+          const Tindex index = groups.row(group);
           T& a = accum(index);
-          const T& g = grad(i);
-          if (update_slots) {
-            a += g * g;
-          }
-          if (has_epsilon) {
-            var(index) -= lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon());
-          } else {
-            var(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
-          }
+          groups.ForEachPosition(group, [&](Tindex i) {
+            const T& g = grad(i);
+            if (update_slots) {
+              a += g * g;
+            }
+            if (has_epsilon) {
+              var(index) -=
+                  lr_scalar * g / (Eigen::numext::sqrt(a) + epsilon());
+            } else {
+              var(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
+            }
+          });
         }
       };
 
-      d.parallelFor(N, cost, shard);
+      d.parallelFor(num_groups, group_cost, shard);
     }
 
     return OkStatus();
@@ -726,19 +729,36 @@ struct SparseApplyKerasMomentum<CPUDevice, T, Tindex> {
                     bool use_nesterov) {
     const Tindex N = static_cast<Tindex>(indices.size());
     const Tindex first_dim_size = static_cast<Tindex>(var.dimension(0));
-    for (Tindex i = 0; i < N; i++) {
-      const Tindex index = internal::SubtleMustCopy(indices(i));
-      if (!FastBoundsCheck(index, first_dim_size)) return i;
-      auto a = accum.template chip<0>(index);
-      auto g = grad.template chip<0>(i);
-      auto v = var.template chip<0>(index);
-      a = a * a.constant(momentum()) - g * g.constant(lr());
-      if (use_nesterov) {
-        v += a * a.constant(momentum()) - g * g.constant(lr());
-      } else {
-        v += a;
+    if (N == 0) return -1;
+    // Rows are updated in parallel, each by one thread that applies its
+    // gradients in input order.
+    SparseRowGroups<Tindex> groups;
+    const Tindex bad_i = groups.Init(indices.data(), N, first_dim_size);
+    if (bad_i >= 0) return bad_i;
+    const Tindex num_groups = groups.num_groups();
+    const int64_t inner_dim = var.dimension(1);
+    const Eigen::TensorOpCost cost(
+        inner_dim * sizeof(T) * 3, inner_dim * sizeof(T) * 2,
+        inner_dim * (Eigen::TensorOpCost::AddCost<T>() * 3 +
+                     Eigen::TensorOpCost::MulCost<T>() * 4));
+    const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
+      for (Tindex group = start_idx; group < end_idx; ++group) {
+        const Tindex index = groups.row(group);
+        auto a = accum.template chip<0>(index);
+        auto v = var.template chip<0>(index);
+        groups.ForEachPosition(group, [&](Tindex i) {
+          auto g = grad.template chip<0>(i);
+          a = a * a.constant(momentum()) - g * g.constant(lr());
+          if (use_nesterov) {
+            v += a * a.constant(momentum()) - g * g.constant(lr());
+          } else {
+            v += a;
+          }
+        });
       }
-    }
+    };
+    d.parallelFor(num_groups, cost * (static_cast<double>(N) / num_groups),
+                  shard);
     return -1;
   }
 };
@@ -968,6 +988,7 @@ class ApplyGradientDescentOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1051,6 +1072,7 @@ class ApplyAdadeltaOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
     DoValidate(ctx);
     if (!ctx->status().ok()) return;
     DoCompute(ctx);
@@ -1196,6 +1218,7 @@ class SparseApplyAdadeltaOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
     DoCompute(ctx);
   }
 
@@ -1365,6 +1388,7 @@ class ApplyProximalGradientDescentOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1435,6 +1459,7 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
         ctx, use_exclusive_lock_, sparse, {0});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1581,6 +1606,7 @@ class ApplyAdagradOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1678,6 +1704,7 @@ class ApplyAdagradV2Op : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1779,6 +1806,7 @@ class ApplyProximalAdagradOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -1890,6 +1918,7 @@ class SparseApplyAdagradOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -2020,6 +2049,7 @@ class SparseApplyAdagradV2Op : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -2153,6 +2183,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -2295,6 +2326,7 @@ class ApplyAdagradDAOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -2397,6 +2429,7 @@ class SparseApplyAdagradDAOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -2598,6 +2631,7 @@ class ApplyFtrlOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -2808,6 +2842,7 @@ class SparseApplyFtrlOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, sparse, &var));
@@ -3070,6 +3105,7 @@ class ApplyMomentumOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3174,6 +3210,7 @@ class SparseApplyMomentumOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
@@ -3291,6 +3328,7 @@ class ApplyKerasMomentumOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3393,6 +3431,7 @@ class SparseApplyKerasMomentumOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3526,6 +3565,7 @@ class ApplyAdamOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3665,6 +3705,7 @@ class ApplyAdamWithAmsgradOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3807,6 +3848,7 @@ class ApplyAdaMaxOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -3936,6 +3978,7 @@ class ApplyRMSPropOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -4019,6 +4062,7 @@ class ApplyCenteredRMSPropOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2, 3});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -4181,6 +4225,7 @@ class SparseApplyRMSPropOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
@@ -4311,6 +4356,7 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
     const bool sparse = true;
     auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1, 2, 3});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
@@ -4486,6 +4532,7 @@ class ApplyAddSignOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -4593,6 +4640,7 @@ class ApplyPowerSignOp : public OpKernel {
     const bool sparse = false;
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
         ctx, use_exclusive_lock_, sparse, {0, 1});
+    if (!ctx->status().ok()) return;
 
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
@@ -15,6 +15,7 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
 #include <complex>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
@@ -68,12 +69,143 @@ void TransposeSimple(const CPUDevice& device, const Tensor& in,
   device.parallelFor(in.NumElements(), cost, std::move(transpose_fn));
 }
 
+// Row copies are used for permutations that keep the innermost dimension in
+// place once it spans at least this many bytes; below that, Eigen's shuffle
+// does better.
+constexpr int64_t kMinTransposeRowBytes = 64;
+
+// Transposes a tensor whose (reduced) permutation keeps the innermost
+// dimension in place: every innermost row of the output is a contiguous row
+// of the input, so it is copied as a whole.
+template <typename T, bool conjugate>
+void TransposeRows(const CPUDevice& device, const T* in,
+                   const internal::TransposeDimsVec& dims,
+                   const internal::TransposePermsVec& perm, T* out) {
+  const int ndims = dims.size();
+  const int64_t row_size = dims[ndims - 1];
+  internal::TransposeDimsVec in_strides(ndims, 1);
+  internal::TransposeDimsVec out_dims(ndims);
+  int64_t num_rows = 1;
+  for (int i = ndims - 2; i >= 0; --i) {
+    in_strides[i] = in_strides[i + 1] * dims[i + 1];
+  }
+  for (int i = 0; i < ndims - 1; ++i) {
+    out_dims[i] = dims[perm[i]];
+    num_rows *= out_dims[i];
+  }
+  auto copy_rows = [=, &in_strides, &out_dims, &perm](int64_t begin,
+                                                      int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t in_offset = 0;
+      int64_t t = row;
+      for (int i = ndims - 2; i >= 0; --i) {
+        in_offset += (t % out_dims[i]) * in_strides[perm[i]];
+        t /= out_dims[i];
+      }
+      const T* src = in + in_offset;
+      T* dst = out + row * row_size;
+      if (conjugate) {
+        for (int64_t j = 0; j < row_size; ++j) {
+          dst[j] = Eigen::numext::conj(src[j]);
+        }
+      } else {
+        std::copy_n(src, row_size, dst);
+      }
+    }
+  };
+  Eigen::TensorOpCost cost(
+      /*bytes_loaded=*/row_size * sizeof(T),
+      /*bytes_stored=*/row_size * sizeof(T),
+      /*compute_cycles=*/ndims * (Eigen::TensorOpCost::DivCost<int64_t>() +
+                                  Eigen::TensorOpCost::MulCost<int64_t>()));
+  device.parallelFor(num_rows, cost, std::move(copy_rows));
+}
+
+// Transposes `batch` row-major `rows` x `cols` matrices. The matrices are
+// walked in square tiles small enough for both the rows read and the rows
+// written by a tile to stay in L1, which Eigen's shuffle does not do, and the
+// tiles are spread over the intra-op thread pool.
+template <typename T, bool conjugate>
+void TransposeTiled(const CPUDevice& device, const T* in, int64_t batch,
+                    int64_t rows, int64_t cols, T* out) {
+  // 128 bytes per tile row, i.e. 32x32 tiles for 4-byte types.
+  constexpr int64_t kTileSize =
+      std::max<int64_t>(8, 128 / static_cast<int64_t>(sizeof(T)));
+  const int64_t row_tiles = (rows + kTileSize - 1) / kTileSize;
+  const int64_t col_tiles = (cols + kTileSize - 1) / kTileSize;
+  auto transpose_tiles = [=](int64_t begin, int64_t end) {
+    for (int64_t tile = begin; tile < end; ++tile) {
+      const int64_t b = tile / (row_tiles * col_tiles);
+      const int64_t r0 = tile / col_tiles % row_tiles * kTileSize;
+      const int64_t c0 = tile % col_tiles * kTileSize;
+      const int64_t r1 = std::min(r0 + kTileSize, rows);
+      const int64_t c1 = std::min(c0 + kTileSize, cols);
+      const T* src = in + b * rows * cols;
+      T* dst = out + b * rows * cols;
+      // Write the output tile row by row so that the stores are contiguous;
+      // the strided loads hit the cache lines the tile already brought in.
+      for (int64_t c = c0; c < c1; ++c) {
+        for (int64_t r = r0; r < r1; ++r) {
+          if (conjugate) {
+            dst[c * rows + r] = Eigen::numext::conj(src[r * cols + c]);
+          } else {
+            dst[c * rows + r] = src[r * cols + c];
+          }
+        }
+      }
+    }
+  };
+  const int64_t tile_elements = kTileSize * kTileSize;
+  Eigen::TensorOpCost cost(/*bytes_loaded=*/tile_elements * sizeof(T),
+                           /*bytes_stored=*/tile_elements * sizeof(T),
+                           /*compute_cycles=*/(conjugate ? 1 : 0) *
+                               tile_elements);
+  device.parallelFor(batch * row_tiles * col_tiles, cost,
+                     std::move(transpose_tiles));
+}
+
+// Handles the permutations that have a specialized CPU kernel once adjacent
+// dimensions that stay together are merged. Returns false if the
+// permutation has none and `out` is left untouched.
+template <typename T, bool conjugate>
+bool TransposeUsingSpecializedKernel(const CPUDevice& device, const Tensor& in,
+                                     const gtl::ArraySlice<int32> perm,
+                                     Tensor* out) {
+  if (in.dims() < 2 || in.NumElements() == 0) return false;
+  internal::TransposePermsVec new_perm;
+  internal::TransposeDimsVec new_dims;
+  internal::ReduceTransposeDimensions(in.shape(), perm, &new_perm, &new_dims);
+  const T* p = reinterpret_cast<const T*>(in.tensor_data().data());
+  T* q = reinterpret_cast<T*>(const_cast<char*>((out->tensor_data().data())));
+  const int ndims = new_dims.size();
+  if (new_perm[ndims - 1] == ndims - 1 &&
+      (ndims == 1 || new_dims[ndims - 1] * static_cast<int64_t>(sizeof(T)) >=
+                         kMinTransposeRowBytes)) {
+    TransposeRows<T, conjugate>(device, p, new_dims, new_perm, q);
+    return true;
+  }
+  if (ndims == 2 && new_perm[0] == 1) {
+    TransposeTiled<T, conjugate>(device, p, /*batch=*/1, new_dims[0],
+                                 new_dims[1], q);
+    return true;
+  }
+  if (ndims == 3 && new_perm == internal::TransposePermsVec({0, 2, 1})) {
+    TransposeTiled<T, conjugate>(device, p, new_dims[0], new_dims[1],
+                                 new_dims[2], q);
+    return true;
+  }
+  return false;
+}
+
 }  // namespace
 
 template <typename T, bool conjugate>
 struct Transpose<CPUDevice, T, conjugate> {
   static void run(const CPUDevice& d, const Tensor& in,
                   const gtl::ArraySlice<int32> perm, Tensor* out) {
+    if (TransposeUsingSpecializedKernel<T, conjugate>(d, in, perm, out)) {
+      return;
+    }
     switch (in.dims()) {
       case 2:
         internal::TransposeUsingEigen<CPUDevice, T, 2>(d, in, perm, conjugate,
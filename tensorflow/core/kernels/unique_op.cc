@@ -13,9 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
@@ -68,6 +71,208 @@ struct UniqueOpHashMap<bfloat16, TIndex> {
   using map_type = std::unordered_map<bfloat16, TIndex>;
 };
 
+// Inputs to the single-element path with at least this many elements are
+// uniquified by `ParallelUnique` when more than one worker thread is
+// available.
+constexpr int64_t kParallelUniqueMinElements = 1 << 17;
+
+// Target number of input elements per hash partition. A partition's hash map
+// of this size stays resident in a per-core cache while it is built.
+constexpr int64_t kUniqueElementsPerPartition = 1 << 14;
+constexpr int kMaxUniquePartitions = 1 << 12;
+
+// `ParallelUnique` uniquifies a 1-D input on the intra-op thread pool, with
+// the same output contract as the serial path: unique values are numbered in
+// order of their first occurrence in the input.
+//
+// The input is scattered by hash into cache-sized partitions, so that equal
+// elements always land in the same partition. Each partition is deduplicated
+// independently, recording the input position at which every local unique
+// value first occurs. Marking those positions and taking a prefix sum over
+// the input then yields each value's global id, which is used to remap the
+// partition-local ids written to `idx`.
+template <typename T, typename TIndex>
+class ParallelUnique {
+ public:
+  using MapType = typename UniqueOpHashMap<T, TIndex>::map_type;
+
+  ParallelUnique(typename TTypes<T>::ConstFlat input,
+                 const DeviceBase::CpuWorkerThreads& worker_threads)
+      : input_(input), worker_threads_(worker_threads) {}
+
+  // Fills `idx` and returns the number of unique elements.
+  int64_t Compute(typename TTypes<TIndex>::Vec idx) {
+    const int64_t n = input_.size();
+    int partition_bits = 0;
+    while ((int64_t{1} << partition_bits) < kMaxUniquePartitions &&
+           ((int64_t{kUniqueElementsPerPartition} << partition_bits) < n ||
+            (1 << partition_bits) < worker_threads_.num_threads)) {
+      ++partition_bits;
+    }
+    const int num_partitions = 1 << partition_bits;
+    const int num_chunks = static_cast<int>(std::min<int64_t>(
+        2 * worker_threads_.num_threads,
+        (n + kUniqueElementsPerPartition - 1) / kUniqueElementsPerPartition));
+    const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+    const int64_t chunk_cost = chunk_size * 32;
+
+    // Assigns every element to a partition and counts each partition's share
+    // of every chunk.
+    partition_.resize(n);
+    std::vector<int64_t> offsets(static_cast<size_t>(num_chunks) *
+                                 num_partitions);
+    typename MapType::hasher hasher;
+    RunChunks(num_chunks, chunk_size, chunk_cost,
+              [&](int chunk, int64_t begin, int64_t end) {
+                int64_t* hist = &offsets[chunk * num_partitions];
+                for (int64_t i = begin; i < end; ++i) {
+                  const uint64 h = static_cast<uint64>(hasher(input_(i)));
+                  const int p =
+                      partition_bits == 0
+                          ? 0
+                          : static_cast<int>((h * 0x9E3779B97F4A7C15ULL) >>
+                                             (64 - partition_bits));
+                  partition_[i] = static_cast<uint16>(p);
+                  ++hist[p];
+                }
+              });
+
+    // Lays the partitions out back to back, each holding its elements in
+    // input order.
+    partition_begin_.resize(num_partitions + 1);
+    int64_t running = 0;
+    for (int p = 0; p < num_partitions; ++p) {
+      partition_begin_[p] = running;
+      for (int c = 0; c < num_chunks; ++c) {
+        const int64_t count = offsets[c * num_partitions + p];
+        offsets[c * num_partitions + p] = running;
+        running += count;
+      }
+    }
+    partition_begin_[num_partitions] = running;
+    std::vector<int32> order(n);
+    RunChunks(num_chunks, chunk_size, chunk_cost,
+              [&](int chunk, int64_t begin, int64_t end) {
+                int64_t* cursor = &offsets[chunk * num_partitions];
+                for (int64_t i = begin; i < end; ++i) {
+                  order[cursor[partition_[i]]++] = static_cast<int32>(i);
+                }
+              });
+
+    // Deduplicates each partition, writing partition-local ids to `idx`.
+    first_.resize(num_partitions);
+    counts_.resize(num_partitions);
+    std::vector<uint8> is_first(n, 0);
+    Shard(worker_threads_.num_threads, worker_threads_.workers, num_partitions,
+          kUniqueElementsPerPartition * 64, [&](int64_t start, int64_t limit) {
+            for (int64_t p = start; p < limit; ++p) {
+              const int64_t begin = partition_begin_[p];
+              const int64_t end = partition_begin_[p + 1];
+              MapType uniq;
+              uniq.reserve(2 * (end - begin));
+              std::vector<int32>& first = first_[p];
+              std::vector<TIndex>& counts = counts_[p];
+              for (int64_t k = begin; k < end; ++k) {
+                const int32 i = order[k];
+                auto it = uniq.emplace(input_(i), first.size());
+                if (it.second) {
+                  first.push_back(i);
+                  counts.push_back(0);
+                  is_first[i] = 1;
+                }
+                idx(i) = it.first->second;
+                ++counts[it.first->second];
+              }
+            }
+          });
+
+    // Numbers the first occurrences in input order, reusing `order` to hold
+    // the global id at each first-occurrence position.
+    std::vector<int64_t> chunk_base(num_chunks + 1, 0);
+    RunChunks(num_chunks, chunk_size, chunk_cost,
+              [&](int chunk, int64_t begin, int64_t end) {
+                int64_t count = 0;
+                for (int64_t i = begin; i < end; ++i) count += is_first[i];
+                chunk_base[chunk + 1] = count;
+              });
+    for (int c = 0; c < num_chunks; ++c) chunk_base[c + 1] += chunk_base[c];
+    RunChunks(num_chunks, chunk_size, chunk_cost,
+              [&](int chunk, int64_t begin, int64_t end) {
+                int32 next = static_cast<int32>(chunk_base[chunk]);
+                for (int64_t i = begin; i < end; ++i) {
+                  if (is_first[i]) order[i] = next++;
+                }
+              });
+
+    global_.resize(num_partitions);
+    for (int p = 0; p < num_partitions; ++p) {
+      global_[p].resize(first_[p].size());
+      for (size_t u = 0; u < first_[p].size(); ++u) {
+        global_[p][u] = static_cast<TIndex>(order[first_[p][u]]);
+      }
+    }
+    RunChunks(num_chunks, chunk_size, chunk_cost,
+              [&](int chunk, int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                  idx(i) = global_[partition_[i]][idx(i)];
+                }
+              });
+    return chunk_base[num_chunks];
+  }
+
+  // Writes the unique values, in order of first occurrence, to `output`.
+  // Must be called after `Compute()`.
+  void WriteUnique(typename TTypes<T>::Flat output) {
+    ForEachUnique([&](int p, size_t u) {
+      output(global_[p][u]) = input_(first_[p][u]);
+    });
+  }
+
+  // Writes the number of occurrences of each unique value to `counts`.
+  // Must be called after `Compute()`.
+  void WriteCounts(typename TTypes<TIndex>::Vec counts) {
+    ForEachUnique(
+        [&](int p, size_t u) { counts(global_[p][u]) = counts_[p][u]; });
+  }
+
+ private:
+  template <typename Fn>
+  void RunChunks(int num_chunks, int64_t chunk_size, int64_t chunk_cost,
+                 Fn fn) {
+    const int64_t n = input_.size();
+    Shard(worker_threads_.num_threads, worker_threads_.workers, num_chunks,
+          chunk_cost, [&](int64_t start, int64_t limit) {
+            for (int64_t c = start; c < limit; ++c) {
+              fn(static_cast<int>(c), c * chunk_size,
+                 std::min(n, (c + 1) * chunk_size));
+            }
+          });
+  }
+
+  template <typename Fn>
+  void ForEachUnique(Fn fn) {
+    Shard(worker_threads_.num_threads, worker_threads_.workers,
+          static_cast<int64_t>(first_.size()), kUniqueElementsPerPartition,
+          [&](int64_t start, int64_t limit) {
+            for (int64_t p = start; p < limit; ++p) {
+              for (size_t u = 0; u < first_[p].size(); ++u) {
+                fn(static_cast<int>(p), u);
+              }
+            }
+          });
+  }
+
+  typename TTypes<T>::ConstFlat input_;
+  const DeviceBase::CpuWorkerThreads& worker_threads_;
+  std::vector<uint16> partition_;
+  std::vector<int64_t> partition_begin_;
+  // Per partition: the input position of each local unique value's first
+  // occurrence, its number of occurrences, and its global id.
+  std::vector<std::vector<int32>> first_;
+  std::vector<std::vector<TIndex>> counts_;
+  std::vector<std::vector<TIndex>> global_;
+};
+
 // `UniqueOp` computes the unique elements in the input tensor.
 //
 // * `T` is the element type.
@@ -143,7 +348,30 @@ class UniqueOp : public OpKernel {
     auto idx_vec = idx->template vec<TIndex>();
 
     int64_t uniq_size;
-    if (new_sizes[0] == 1 && new_sizes[2] == 1) {
+    bool counts_written = false;
+    const DeviceBase::CpuWorkerThreads* worker_threads =
+        context->device()->tensorflow_cpu_worker_threads();
+    if (new_sizes[0] == 1 && new_sizes[2] == 1 &&
+        input.NumElements() >= kParallelUniqueMinElements &&
+        worker_threads != nullptr && worker_threads->num_threads > 1) {
+      ParallelUnique<T, TIndex> parallel_unique(input.flat<T>(),
+                                                *worker_threads);
+      uniq_size = parallel_unique.Compute(idx_vec);
+      TensorShape output_shape(input.shape());
+      output_shape.set_dim(axis, uniq_size);
+      Tensor* output = nullptr;
+      OP_REQUIRES_OK(context,
+                     context->allocate_output(0, output_shape, &output));
+      parallel_unique.WriteUnique(output->flat<T>());
+      if (num_outputs() > 2) {
+        Tensor* count_output = nullptr;
+        OP_REQUIRES_OK(context,
+                       context->allocate_output(2, TensorShape({uniq_size}),
+                                                &count_output));
+        parallel_unique.WriteCounts(count_output->template vec<TIndex>());
+        counts_written = true;
+      }
+    } else if (new_sizes[0] == 1 && new_sizes[2] == 1) {
       // Specialized and faster implementation when unique is run over single
       // elements. Here we put T directly into the map rather than ints pointing
       // to them as in the general case.
@@ -225,7 +453,7 @@ class UniqueOp : public OpKernel {
       }
     }
 
-    if (num_outputs() > 2) {
+    if (num_outputs() > 2 && !counts_written) {
       Tensor* output = nullptr;
       OP_REQUIRES_OK(context, context->allocate_output(
                                   2, TensorShape({uniq_size}), &output));
@@ -15,10 +15,15 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -64,6 +69,83 @@ TensorProto GetRandomInt32TensorProtoWithRepeat(int dim, int repeat,
   return tensor_proto;
 }
 
+class UniqueWithCountsOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType type) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "UniqueWithCounts")
+                     .Input(FakeInput(type))
+                     .Attr("out_idx", DT_INT32)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+// Large enough to take the partitioned, multithreaded path; the outputs must
+// match a serial first-occurrence numbering.
+TEST_F(UniqueWithCountsOpTest, LargeInputMatchesSerialOrder) {
+  MakeOp(DT_INT64);
+  const int n = 300000;
+  std::vector<int64_t> values(n);
+  for (int i = 0; i < n; ++i) {
+    values[i] = (static_cast<int64_t>(i) * 7919) % 40009 - 20000;
+  }
+  AddInputFromArray<int64_t>(TensorShape({n}), values);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::unordered_map<int64_t, int32> ids;
+  std::vector<int64_t> expected_y;
+  std::vector<int32> expected_idx(n);
+  std::vector<int32> expected_count;
+  for (int i = 0; i < n; ++i) {
+    auto it = ids.emplace(values[i], static_cast<int32>(expected_y.size()));
+    if (it.second) {
+      expected_y.push_back(values[i]);
+      expected_count.push_back(0);
+    }
+    expected_idx[i] = it.first->second;
+    ++expected_count[it.first->second];
+  }
+  const int64_t num_unique = expected_y.size();
+  test::ExpectTensorEqual<int64_t>(
+      *GetOutput(0), test::AsTensor<int64_t>(expected_y, {num_unique}));
+  test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                 test::AsTensor<int32>(expected_idx, {n}));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(2), test::AsTensor<int32>(expected_count, {num_unique}));
+}
+
+TEST_F(UniqueWithCountsOpTest, LargeStringInputMatchesSerialOrder) {
+  MakeOp(DT_STRING);
+  const int n = 200000;
+  std::vector<tstring> values(n);
+  for (int i = 0; i < n; ++i) {
+    values[i] = strings::StrCat("key", (i * 104729) % 5003);
+  }
+  AddInputFromArray<tstring>(TensorShape({n}), values);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::unordered_map<string, int32> ids;
+  std::vector<tstring> expected_y;
+  std::vector<int32> expected_idx(n);
+  std::vector<int32> expected_count;
+  for (int i = 0; i < n; ++i) {
+    auto it = ids.emplace(values[i], static_cast<int32>(expected_y.size()));
+    if (it.second) {
+      expected_y.push_back(values[i]);
+      expected_count.push_back(0);
+    }
+    expected_idx[i] = it.first->second;
+    ++expected_count[it.first->second];
+  }
+  const int64_t num_unique = expected_y.size();
+  test::ExpectTensorEqual<tstring>(
+      *GetOutput(0), test::AsTensor<tstring>(expected_y, {num_unique}));
+  test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                 test::AsTensor<int32>(expected_idx, {n}));
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(2), test::AsTensor<int32>(expected_count, {num_unique}));
+}
+
 void BM_Unique_INT32(::testing::benchmark::State& state) {
   const int dim = state.range(0);
   const int max_int = state.range(1);
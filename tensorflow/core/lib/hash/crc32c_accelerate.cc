@@ -41,10 +41,51 @@ limitations under the License.
 #include <nmmintrin.h>
 #endif
 
+// ARMv8 accelerated CRC32c, available when compiled with +crc.
+#undef USE_ARM_CRC32C
+#if !defined(USE_SSE_CRC32C) && defined(__aarch64__) && \
+    defined(__ARM_FEATURE_CRC32)
+#define USE_ARM_CRC32C 1
+#include <arm_acle.h>
+#endif
+
 namespace tensorflow {
 namespace crc32c {
 
-#ifndef USE_SSE_CRC32C
+#if defined(USE_ARM_CRC32C)
+
+// The crc32c instructions are guaranteed to be present when the compiler
+// targets them.
+bool CanAccelerate() { return true; }
+
+uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+  const uint8_t *e = p + size;
+  uint32_t l = crc ^ 0xffffffffu;
+
+  // Process bytes until p is 8-byte aligned.
+  while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = __crc32cb(l, *p);
+    p++;
+  }
+
+  // Process bytes 16 at a time
+  while ((e - p) >= 16) {
+    l = __crc32cd(l, *reinterpret_cast<const uint64_t *>(p));
+    l = __crc32cd(l, *reinterpret_cast<const uint64_t *>(p + 8));
+    p += 16;
+  }
+
+  // Process remaining bytes one at a time.
+  while (p < e) {
+    l = __crc32cb(l, *p);
+    p++;
+  }
+
+  return l ^ 0xffffffffu;
+}
+
+#elif !defined(USE_SSE_CRC32C)
 
 bool CanAccelerate() { return false; }
 uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <algorithm>
+
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
@@ -85,26 +87,73 @@ RecordReader::RecordReader(RandomAccessFile* file,
 #endif
 }
 
+int64_t RecordReader::Position() const {
+  const int64_t pos = input_stream_->Tell();
+  return pos < 0 ? pos : pos - static_cast<int64_t>(read_ahead_.size());
+}
+
+Status RecordReader::ReadBytes(size_t n, tstring* result) {
+  if (read_ahead_.empty()) {
+    return input_stream_->ReadNBytes(n, result);
+  }
+  const size_t from_read_ahead = std::min(n, read_ahead_.size());
+  result->assign(read_ahead_.data(), from_read_ahead);
+  read_ahead_.erase(0, from_read_ahead);
+  if (from_read_ahead == n) {
+    return OkStatus();
+  }
+  tstring rest;
+  Status s = input_stream_->ReadNBytes(n - from_read_ahead, &rest);
+  result->append(rest.data(), rest.size());
+  return s;
+}
+
+Status RecordReader::SkipBytes(int64_t n) {
+  const int64_t from_read_ahead =
+      std::min<int64_t>(n, static_cast<int64_t>(read_ahead_.size()));
+  read_ahead_.erase(0, from_read_ahead);
+  if (from_read_ahead == n) {
+    return OkStatus();
+  }
+  return input_stream_->SkipNBytes(n - from_read_ahead);
+}
+
+Status RecordReader::ResetInputStream() {
+  read_ahead_.clear();
+  return input_stream_->Reset();
+}
+
 // Read n+4 bytes from file, verify that checksum of first n bytes is
 // stored in the last 4 bytes and store the first n bytes in *result.
+// Up to "read_ahead" more bytes are read in the same call and kept in
+// read_ahead_ for the next read.
 //
 // offset corresponds to the user-provided value to ReadRecord()
 // and is used only in error messages.
-Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
-  if (n >= SIZE_MAX - sizeof(uint32)) {
+Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result,
+                                     size_t read_ahead) {
+  if (n >= SIZE_MAX - sizeof(uint32) - read_ahead) {
     return errors::DataLoss("record size too large");
   }
 
   const size_t expected = n + sizeof(uint32);
-  TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
+  Status s = ReadBytes(expected + read_ahead, result);
 
-  if (result->size() != expected) {
+  if (result->size() < expected) {
+    TF_RETURN_IF_ERROR(s);
     if (result->empty()) {
       return errors::OutOfRange("eof");
     } else {
       return errors::DataLoss("truncated record at ", offset);
     }
   }
+  // Running out of data is only an error if it cut the record short.
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    return s;
+  }
+  if (result->size() > expected) {
+    read_ahead_.assign(result->data() + expected, result->size() - expected);
+  }
 
   const uint32 masked_crc = core::DecodeFixed32(result->data() + n);
   if (crc32c::Unmask(masked_crc) != crc32c::Value(result->data(), n)) {
@@ -122,7 +171,7 @@ Status RecordReader::GetMetadata(Metadata* md) {
 
   // Compute the metadata of the TFRecord file if not cached.
   if (!cached_metadata_) {
-    TF_RETURN_IF_ERROR(input_stream_->Reset());
+    TF_RETURN_IF_ERROR(ResetInputStream());
 
     int64_t data_size = 0;
     int64_t entries = 0;
@@ -148,7 +197,7 @@ Status RecordReader::GetMetadata(Metadata* md) {
 
       // Skip reading the actual data since we just want the number
       // of records and the size of the data.
-      TF_RETURN_IF_ERROR(input_stream_->SkipNBytes(length + kFooterSize));
+      TF_RETURN_IF_ERROR(SkipBytes(length + kFooterSize));
       offset += kHeaderSize + length + kFooterSize;
 
       // Increment running stats.
@@ -168,23 +217,27 @@ Status RecordReader::GetMetadata(Metadata* md) {
 }
 
 Status RecordReader::PositionInputStream(uint64 offset) {
-  int64_t curr_pos = input_stream_->Tell();
+  int64_t curr_pos = Position();
   int64_t desired_pos = static_cast<int64_t>(offset);
   if (curr_pos > desired_pos || curr_pos < 0 /* EOF */ ||
       (curr_pos == desired_pos && last_read_failed_)) {
     last_read_failed_ = false;
-    TF_RETURN_IF_ERROR(input_stream_->Reset());
+    TF_RETURN_IF_ERROR(ResetInputStream());
     TF_RETURN_IF_ERROR(input_stream_->SkipNBytes(desired_pos));
   } else if (curr_pos < desired_pos) {
-    TF_RETURN_IF_ERROR(input_stream_->SkipNBytes(desired_pos - curr_pos));
+    TF_RETURN_IF_ERROR(SkipBytes(desired_pos - curr_pos));
   }
-  DCHECK_EQ(desired_pos, input_stream_->Tell());
+  DCHECK_EQ(desired_pos, Position());
   return OkStatus();
 }
 
 Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
+  return ReadRecordAtPosition(offset, record, /*read_next_header=*/false);
+}
 
+Status RecordReader::ReadRecordAtPosition(uint64* offset, tstring* record,
+                                          bool read_next_header) {
   // Read header data.
   Status s = ReadChecksummed(*offset, sizeof(uint64), record);
   if (!s.ok()) {
@@ -194,7 +247,8 @@ Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   const uint64 length = core::DecodeFixed64(record->data());
 
   // Read data
-  s = ReadChecksummed(*offset + kHeaderSize, length, record);
+  s = ReadChecksummed(*offset + kHeaderSize, length, record,
+                      read_next_header ? kHeaderSize : 0);
   if (!s.ok()) {
     last_read_failed_ = true;
     if (errors::IsOutOfRange(s)) {
@@ -205,7 +259,57 @@ Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   }
 
   *offset += kHeaderSize + length + kFooterSize;
-  DCHECK_EQ(*offset, input_stream_->Tell());
+  DCHECK_EQ(*offset, Position());
+  return OkStatus();
+}
+
+Status RecordReader::ReadRecords(uint64* offset, int max_records,
+                                 int64_t max_bytes,
+                                 std::vector<tstring>* records) {
+  if (max_records <= 0) {
+    return errors::InvalidArgument("max_records must be positive, got ",
+                                   max_records);
+  }
+  if (!deferred_status_.ok()) {
+    Status s = deferred_status_;
+    deferred_status_ = OkStatus();
+    if (*offset == deferred_offset_) {
+      return s;
+    }
+  }
+  TF_RETURN_IF_ERROR(PositionInputStream(*offset));
+
+  // The stream only needs to be positioned once for the whole batch, since
+  // consecutive records are read back to back. Each record is read together
+  // with the header of the next one, so that it takes a single read from the
+  // stream.
+  int64_t bytes_read = 0;
+  for (int i = 0; i < max_records; ++i) {
+    if (i > 0 && bytes_read >= max_bytes) {
+      break;
+    }
+    tstring record;
+    Status s = ReadRecordAtPosition(offset, &record, /*read_next_header=*/true);
+    if (!s.ok()) {
+      if (i == 0) {
+        return s;
+      }
+      if (errors::IsOutOfRange(s) && Position() == *offset) {
+        // A clean end of file leaves the stream at `*offset`, so the next call
+        // can read from there without re-positioning the stream.
+        last_read_failed_ = false;
+      } else {
+        // Return the error from the next call, rather than re-positioning the
+        // stream, which for compressed files means decompressing it again
+        // from the start, only to fail on the same record.
+        deferred_status_ = s;
+        deferred_offset_ = *offset;
+      }
+      return OkStatus();
+    }
+    bytes_read += record.size();
+    records->push_back(std::move(record));
+  }
   return OkStatus();
 }
 
@@ -225,7 +329,7 @@ Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
     const uint64 length = core::DecodeFixed64(record.data());
 
     // Skip data
-    s = input_stream_->SkipNBytes(length + kFooterSize);
+    s = SkipBytes(length + kFooterSize);
     if (!s.ok()) {
       last_read_failed_ = true;
       if (errors::IsOutOfRange(s)) {
@@ -235,7 +339,54 @@ Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
       return s;
     }
     *offset += kHeaderSize + length + kFooterSize;
-    DCHECK_EQ(*offset, input_stream_->Tell());
+    DCHECK_EQ(*offset, Position());
+    (*num_skipped)++;
+  }
+  return OkStatus();
+}
+
+Status InMemoryRecordReader::ReadHeader(uint64 offset, uint64* length) const {
+  if (offset >= data_.size()) {
+    return errors::OutOfRange("eof");
+  }
+  if (data_.size() - offset < RecordReader::kHeaderSize) {
+    return errors::DataLoss("truncated record at ", offset);
+  }
+  const char* header = data_.data() + offset;
+  const uint32 masked_crc = core::DecodeFixed32(header + sizeof(uint64));
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", offset);
+  }
+  *length = core::DecodeFixed64(header);
+  const uint64 remaining = data_.size() - offset - RecordReader::kHeaderSize;
+  if (remaining < RecordReader::kFooterSize ||
+      *length > remaining - RecordReader::kFooterSize) {
+    return errors::DataLoss("truncated record at ", offset);
+  }
+  return OkStatus();
+}
+
+Status InMemoryRecordReader::ReadRecord(uint64* offset,
+                                        StringPiece* record) const {
+  uint64 length;
+  TF_RETURN_IF_ERROR(ReadHeader(*offset, &length));
+  const char* payload = data_.data() + *offset + RecordReader::kHeaderSize;
+  const uint32 masked_crc = core::DecodeFixed32(payload + length);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(payload, length)) {
+    return errors::DataLoss("corrupted record at ", *offset);
+  }
+  *record = StringPiece(payload, length);
+  *offset += RecordReader::kHeaderSize + length + RecordReader::kFooterSize;
+  return OkStatus();
+}
+
+Status InMemoryRecordReader::SkipRecords(uint64* offset, int num_to_skip,
+                                         int* num_skipped) const {
+  *num_skipped = 0;
+  for (int i = 0; i < num_to_skip; ++i) {
+    uint64 length;
+    TF_RETURN_IF_ERROR(ReadHeader(*offset, &length));
+    *offset += RecordReader::kHeaderSize + length + RecordReader::kFooterSize;
     (*num_skipped)++;
   }
   return OkStatus();
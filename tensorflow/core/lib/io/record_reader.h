@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_LIB_IO_RECORD_READER_H_
 #define TENSORFLOW_CORE_LIB_IO_RECORD_READER_H_
 
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/io/inputstream_interface.h"
@@ -97,6 +100,19 @@ class RecordReader {
   // OUT_OF_RANGE for end of file, or something else for an error.
   Status ReadRecord(uint64* offset, tstring* record);
 
+  // Read up to "max_records" consecutive records starting at "*offset",
+  // appending them to *records, and update *offset to point to the offset of
+  // the first record that was not read. Reading stops early once the records
+  // read so far add up to at least "max_bytes" payload bytes; at least one
+  // record is read on success.
+  //
+  // Returns OK if at least one record was read. If reading a record fails
+  // after some records have already been read, the error is returned by the
+  // next call, if it starts at the failing record. Returns OUT_OF_RANGE if no
+  // records are left, or something else for an error.
+  Status ReadRecords(uint64* offset, int max_records, int64_t max_bytes,
+                     std::vector<tstring>* records);
+
   // Skip num_to_skip record starting at "*offset" and update *offset
   // to point to the offset of the next num_to_skip + 1 record.
   // Return OK on success, OUT_OF_RANGE for end of file, or something
@@ -116,18 +132,70 @@ class RecordReader {
   Status GetMetadata(Metadata* md);
 
  private:
-  Status ReadChecksummed(uint64 offset, size_t n, tstring* result);
+  Status ReadChecksummed(uint64 offset, size_t n, tstring* result,
+                         size_t read_ahead = 0);
   Status PositionInputStream(uint64 offset);
+  // Reads the record at "*offset", assuming the input stream is already
+  // positioned there. If "read_next_header" is true, the header of the next
+  // record is read along with it and kept in read_ahead_.
+  Status ReadRecordAtPosition(uint64* offset, tstring* record,
+                              bool read_next_header);
+
+  // Like the InputStreamInterface methods of the same purpose, but account
+  // for the bytes in read_ahead_, which come first.
+  int64_t Position() const;
+  Status ReadBytes(size_t n, tstring* result);
+  Status SkipBytes(int64_t n);
+  Status ResetInputStream();
 
   RecordReaderOptions options_;
   std::unique_ptr<InputStreamInterface> input_stream_;
   bool last_read_failed_;
+  // Bytes already read from input_stream_ but not yet returned; at most the
+  // header of one record.
+  std::string read_ahead_;
+
+  // Error that ReadRecords() hit after reading some records, to be returned
+  // by the next call if it starts at deferred_offset_.
+  Status deferred_status_;
+  uint64 deferred_offset_ = 0;
 
   std::unique_ptr<Metadata> cached_metadata_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
 };
 
+// Reads uncompressed TFRecords directly out of a contiguous in-memory buffer
+// (for example, a memory-mapped file), without copying the record payloads.
+//
+// The returned records alias the buffer passed to the constructor, which must
+// outlive any use of them.
+//
+// Note: this class is not thread safe; external synchronization required.
+class InMemoryRecordReader {
+ public:
+  explicit InMemoryRecordReader(StringPiece data) : data_(data) {}
+
+  // Parses the record at "*offset", stores a view of its payload in *record
+  // and updates *offset to point to the offset of the next record. Returns OK
+  // on success, OUT_OF_RANGE for end of buffer, or something else for an
+  // error.
+  Status ReadRecord(uint64* offset, StringPiece* record) const;
+
+  // Skip num_to_skip records starting at "*offset" and update *offset to
+  // point to the offset of the next record. Payload checksums of skipped
+  // records are not verified. "*num_skipped" records the number of records
+  // that are actually skipped.
+  Status SkipRecords(uint64* offset, int num_to_skip, int* num_skipped) const;
+
+ private:
+  // Validates the header of the record at `offset` and stores the length of
+  // its payload in *length.
+  Status ReadHeader(uint64 offset, uint64* length) const;
+
+  const StringPiece data_;
+};
+
 // High-level interface to read TFRecord files.
 //
 // Note: this class is not thread safe; external synchronization required.
@@ -147,6 +215,15 @@ class SequentialRecordReader {
     return underlying_.ReadRecord(&offset_, record);
   }
 
+  // Read up to max_records of the next records in the file into *records,
+  // stopping early once at least max_bytes payload bytes have been read.
+  // Returns OK if at least one record was read, OUT_OF_RANGE for end of file,
+  // or something else for an error. See RecordReader::ReadRecords().
+  Status ReadRecords(int max_records, int64_t max_bytes,
+                     std::vector<tstring>* records) {
+    return underlying_.ReadRecords(&offset_, max_records, max_bytes, records);
+  }
+
   // Skip the next num_to_skip record in the file. Return OK on success,
   // OUT_OF_RANGE for end of file, or something else for an error.
   // "*num_skipped" records the number of records that are actually skipped.
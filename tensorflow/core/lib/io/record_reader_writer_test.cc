@@ -305,6 +305,220 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestReadRecords) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_read_records_test";
+
+  for (auto buf_size : BufferSizes()) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+
+      io::RecordWriterOptions options;
+      options.zlib_options.output_buffer_size = buf_size;
+      io::RecordWriter writer(file.get(), options);
+      TF_EXPECT_OK(writer.WriteRecord("abc"));
+      TF_EXPECT_OK(writer.WriteRecord("defg"));
+      TF_EXPECT_OK(writer.WriteRecord("hij"));
+      TF_EXPECT_OK(writer.WriteRecord("klmno"));
+      TF_CHECK_OK(writer.Flush());
+    }
+
+    {
+      std::unique_ptr<RandomAccessFile> read_file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+      io::RecordReaderOptions options;
+      options.buffer_size = buf_size;
+      io::SequentialRecordReader reader(read_file.get(), options);
+      std::vector<tstring> records;
+      // Limited by the number of records.
+      TF_CHECK_OK(reader.ReadRecords(2, 1 << 20, &records));
+      EXPECT_EQ(std::vector<tstring>({"abc", "defg"}), records);
+      EXPECT_EQ(2 * 16 + 7, reader.TellOffset());
+      // Limited by the number of bytes, but at least one record is read.
+      records.clear();
+      TF_CHECK_OK(reader.ReadRecords(10, 0, &records));
+      EXPECT_EQ(std::vector<tstring>({"hij"}), records);
+      // Limited by the end of the file.
+      records.clear();
+      TF_CHECK_OK(reader.ReadRecords(10, 1 << 20, &records));
+      EXPECT_EQ(std::vector<tstring>({"klmno"}), records);
+      records.clear();
+      EXPECT_EQ(error::OUT_OF_RANGE,
+                reader.ReadRecords(10, 1 << 20, &records).code());
+      EXPECT_TRUE(records.empty());
+    }
+  }
+}
+
+TEST(RecordReaderWriterTest, TestReadRecordsZlibMixedWithReadRecord) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_read_records_zlib_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriterOptions options;
+    options.compression_type = io::RecordWriterOptions::ZLIB_COMPRESSION;
+    io::RecordWriter writer(file.get(), options);
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_EXPECT_OK(writer.WriteRecord("hij"));
+    TF_EXPECT_OK(writer.WriteRecord("klmno"));
+    TF_EXPECT_OK(writer.WriteRecord("pq"));
+    TF_CHECK_OK(writer.Close());
+  }
+
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordReaderOptions options;
+  options.compression_type = io::RecordReaderOptions::ZLIB_COMPRESSION;
+  io::RecordReader reader(read_file.get(), options);
+  uint64 offset = 0;
+  std::vector<tstring> records;
+  TF_CHECK_OK(reader.ReadRecords(&offset, 1, 1 << 20, &records));
+  EXPECT_EQ(std::vector<tstring>({"abc"}), records);
+
+  // The header of "defg" was already read along with "abc".
+  tstring record;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("defg", record);
+
+  records.clear();
+  TF_CHECK_OK(reader.ReadRecords(&offset, 1, 1 << 20, &records));
+  EXPECT_EQ(std::vector<tstring>({"hij"}), records);
+  int num_skipped;
+  TF_CHECK_OK(reader.SkipRecords(&offset, 1, &num_skipped));
+  EXPECT_EQ(1, num_skipped);
+
+  // Ends cleanly at the end of the file.
+  records.clear();
+  TF_CHECK_OK(reader.ReadRecords(&offset, 10, 1 << 20, &records));
+  EXPECT_EQ(std::vector<tstring>({"pq"}), records);
+  records.clear();
+  EXPECT_EQ(error::OUT_OF_RANGE,
+            reader.ReadRecords(&offset, 10, 1 << 20, &records).code());
+
+  // Going back re-positions the stream.
+  offset = 0;
+  records.clear();
+  TF_CHECK_OK(reader.ReadRecords(&offset, 2, 1 << 20, &records));
+  EXPECT_EQ(std::vector<tstring>({"abc", "defg"}), records);
+}
+
+TEST(RecordReaderWriterTest, TestReadRecordsDefersErrors) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_read_records_error_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Close());
+  }
+  {
+    // Corrupt the payload of the second record.
+    string contents;
+    TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+    contents[19 + io::RecordReader::kHeaderSize + 1] ^= 0x1;
+    TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  }
+
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordReader reader(read_file.get());
+  uint64 offset = 0;
+  std::vector<tstring> records;
+  TF_CHECK_OK(reader.ReadRecords(&offset, 10, 1 << 20, &records));
+  EXPECT_EQ(std::vector<tstring>({"abc"}), records);
+  EXPECT_EQ(19, offset);
+  records.clear();
+  EXPECT_EQ(error::DATA_LOSS,
+            reader.ReadRecords(&offset, 10, 1 << 20, &records).code());
+  EXPECT_EQ(19, offset);
+}
+
+TEST(RecordReaderWriterTest, TestInMemoryReader) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_in_memory_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord(""));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_EXPECT_OK(writer.WriteRecord("hij"));
+    TF_CHECK_OK(writer.Close());
+  }
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::InMemoryRecordReader reader(StringPiece(
+      static_cast<const char*>(region->data()), region->length()));
+  uint64 offset = 0;
+  StringPiece record;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("abc", record);
+  EXPECT_EQ(static_cast<const char*>(region->data()) + 12, record.data());
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("", record);
+  int num_skipped;
+  TF_CHECK_OK(reader.SkipRecords(&offset, 1, &num_skipped));
+  EXPECT_EQ(1, num_skipped);
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("hij", record);
+  EXPECT_EQ(region->length(), offset);
+  EXPECT_EQ(error::OUT_OF_RANGE, reader.ReadRecord(&offset, &record).code());
+}
+
+TEST(RecordReaderWriterTest, TestInMemoryReaderCorruption) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_in_memory_corruption_test";
+
+  string contents;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Close());
+  }
+  TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+
+  {
+    // Flip a payload byte of the first record.
+    string corrupted = contents;
+    corrupted[io::RecordReader::kHeaderSize] ^= 0x1;
+    io::InMemoryRecordReader reader(corrupted);
+    uint64 offset = 0;
+    StringPiece record;
+    EXPECT_EQ(error::DATA_LOSS, reader.ReadRecord(&offset, &record).code());
+    // Skipping does not look at the payload.
+    int num_skipped;
+    TF_EXPECT_OK(reader.SkipRecords(&offset, 1, &num_skipped));
+    TF_EXPECT_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("defg", record);
+  }
+
+  {
+    // Drop the footer of the last record.
+    string truncated = contents.substr(0, contents.size() - 2);
+    io::InMemoryRecordReader reader(truncated);
+    uint64 offset = 0;
+    StringPiece record;
+    TF_EXPECT_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ(error::DATA_LOSS, reader.ReadRecord(&offset, &record).code());
+  }
+}
+
 TEST(RecordReaderWriterTest, TestUseAfterClose) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_flush_close_test";
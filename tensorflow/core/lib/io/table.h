@@ -26,6 +26,8 @@ class RandomAccessFile;
 
 namespace table {
 
+class FilterBlockReader;
+class Footer;
 struct Options;
 
 // A Table is a sorted map from strings to strings.  Tables are
@@ -61,6 +63,12 @@ class Table {
   // be close to the file length.
   uint64 ApproximateOffsetOf(const StringPiece& key) const;
 
+  // Returns false if the filter block of the table shows that `key` is not in
+  // the table, without reading any data block.  Returns true if `key` may be
+  // in the table, including when the table was opened without
+  // `Options::filter_policy` or has no filter block for it.
+  bool KeyMayMatch(const StringPiece& key) const;
+
  private:
   struct Rep;
   Rep* rep_;
@@ -68,6 +76,11 @@ class Table {
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const StringPiece&);
 
+  // Reads the filter block of the table, if any, into `rep_->filter`.
+  // Errors are not propagated, since the filter is not needed for reads.
+  void ReadMeta(const Footer& footer);
+  void ReadFilter(const StringPiece& filter_handle_value);
+
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
@@ -22,6 +22,7 @@ namespace tensorflow {
 namespace table {
 
 class Cache;
+class FilterPolicy;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -68,6 +69,16 @@ struct Options {
 
   // If non-null, use the specified cache for blocks.
   Cache* block_cache = nullptr;
+
+  // If non-null, use the specified filter policy to decide whether a key may
+  // be in a data block without reading the block.  When building a table, a
+  // filter block for all the data blocks is written with this policy.  When
+  // reading one, the filter block written with a policy of the same name is
+  // used, and tables without one are read as before.  Filter blocks are
+  // ignored by readers that do not set a policy.
+  //
+  // Default: nullptr.  NewBloomFilterPolicy() is a good choice.
+  const FilterPolicy* filter_policy = nullptr;
 };
 
 }  // namespace table
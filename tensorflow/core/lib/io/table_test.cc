@@ -24,12 +24,14 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/block.h"
 #include "tensorflow/core/lib/io/block_builder.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/format.h"
 #include "tensorflow/core/lib/io/iterator.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -633,5 +635,88 @@ TEST(TableTest, SeekToFirstKeyDoesNotReadTooMuch) {
   EXPECT_LT(c.BytesRead(), 200);
 }
 
+static string FilterKey(int i) { return strings::Printf("k%06d", i); }
+
+TEST(TableTest, BloomFilter) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  options.filter_policy = policy.get();
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  const int kNumKeys = 10000;
+  for (int i = 0; i < kNumKeys; i += 2) {
+    builder.Add(FilterKey(i), "value");
+  }
+  TF_ASSERT_OK(builder.Finish());
+
+  StringSource source(sink.contents());
+  Table* table;
+  TF_ASSERT_OK(
+      Table::Open(options, &source, sink.contents().size(), &table));
+  std::unique_ptr<Table> table_deleter(table);
+
+  // No data block is read to check for a key.
+  const uint64 bytes_read = source.BytesRead();
+  int false_positives = 0;
+  for (int i = 0; i < kNumKeys; i++) {
+    if (i % 2 == 0) {
+      EXPECT_TRUE(table->KeyMayMatch(FilterKey(i))) << i;
+    } else if (table->KeyMayMatch(FilterKey(i))) {
+      false_positives++;
+    }
+  }
+  EXPECT_FALSE(table->KeyMayMatch("zzz"));
+  EXPECT_EQ(source.BytesRead(), bytes_read);
+  // About 1% false positives are expected with 10 bits per key.
+  EXPECT_LT(false_positives, kNumKeys / 2 / 50);
+
+  // The filter does not change how blocks are read.
+  std::unique_ptr<Iterator> iter(table->NewIterator());
+  iter->Seek(FilterKey(42));
+  ASSERT_TRUE(iter->Valid());
+  EXPECT_EQ(iter->key(), FilterKey(42));
+  iter->Seek(FilterKey(43));
+  ASSERT_TRUE(iter->Valid());
+  EXPECT_EQ(iter->key(), FilterKey(44));
+}
+
+static string BuildSmallTable(const FilterPolicy* policy) {
+  Options options;
+  options.compression = kNoCompression;
+  options.filter_policy = policy;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  builder.Add("k1", "v1");
+  builder.Add("k3", "v3");
+  TF_CHECK_OK(builder.Finish());
+  return sink.contents();
+}
+
+TEST(TableTest, BloomFilterIsOptional) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  // Tables with and without a filter block can be read with and without a
+  // policy.  The filter is only used when both have one.
+  for (const FilterPolicy* write_policy : {policy.get(), nullptr}) {
+    const string contents = BuildSmallTable(write_policy);
+    for (const FilterPolicy* read_policy : {policy.get(), nullptr}) {
+      StringSource source(contents);
+      Options options;
+      options.filter_policy = read_policy;
+      Table* table;
+      TF_ASSERT_OK(Table::Open(options, &source, contents.size(), &table));
+      std::unique_ptr<Table> table_deleter(table);
+      EXPECT_TRUE(table->KeyMayMatch("k1"));
+      EXPECT_EQ(table->KeyMayMatch("k2"),
+                write_policy == nullptr || read_policy == nullptr);
+      std::unique_ptr<Iterator> iter(table->NewIterator());
+      iter->Seek("k2");
+      ASSERT_TRUE(iter->Valid());
+      EXPECT_EQ(iter->key(), "k3");
+    }
+  }
+}
+
 }  // namespace table
 }  // namespace tensorflow
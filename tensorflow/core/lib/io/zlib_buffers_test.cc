@@ -109,6 +109,39 @@ TEST(ZlibBuffers, Gzip) {
   TestAllCombinations(CompressionOptions::GZIP(), CompressionOptions::GZIP());
 }
 
+// Gzip options writing members of 1000 input bytes, or reading their members
+// on `num_inflate_threads` threads.
+static CompressionOptions GzipMembers(int num_inflate_threads = 0) {
+  CompressionOptions options = CompressionOptions::GZIP();
+  options.gzip_member_size = 1000;
+  options.num_inflate_threads = num_inflate_threads;
+  return options;
+}
+
+TEST(ZlibBuffers, GzipMembers) {
+  TestAllCombinations(CompressionOptions::GZIP(), GzipMembers());
+}
+
+TEST(ZlibBuffers, GzipMembersInParallel) {
+  TestAllCombinations(GzipMembers(4), GzipMembers());
+}
+
+TEST(ZlibBuffers, GzipInParallelWithoutMembers) {
+  TestAllCombinations(GzipMembers(4), CompressionOptions::GZIP());
+}
+
+TEST(ZlibOutputBuffer, GzipMembersRequireGzip) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  std::unique_ptr<WritableFile> file_writer;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file_writer));
+  CompressionOptions options = CompressionOptions::DEFAULT();
+  options.gzip_member_size = 1000;
+  ZlibOutputBuffer out(file_writer.get(), 100, 100, options);
+  EXPECT_TRUE(errors::IsInvalidArgument(out.Init()));
+}
+
 void TestMultipleWrites(uint8 input_buf_size, uint8 output_buf_size,
                         int num_writes, bool with_flush = false) {
   Env* env = Env::Default();
@@ -348,6 +381,10 @@ TEST(ZlibInputStream, TellGzip) {
   TestTell(CompressionOptions::GZIP(), CompressionOptions::GZIP());
 }
 
+TEST(ZlibInputStream, TellGzipMembersInParallel) {
+  TestTell(GzipMembers(2), GzipMembers());
+}
+
 TEST(ZlibInputStream, SkipNBytesDefaultOptions) {
   TestSkipNBytes(CompressionOptions::DEFAULT(), CompressionOptions::DEFAULT());
 }
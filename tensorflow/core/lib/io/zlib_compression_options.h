@@ -117,8 +117,32 @@ class ZlibCompressionOptions {
   //
   // This option is ignored for `ZlibOutputBuffer`.
   bool soft_fail_on_error = false;  // NOLINT
+
+  // When positive and writing gzip (window_bits > 15), `ZlibOutputBuffer`
+  // starts a new gzip member after every `gzip_member_size` bytes of input and
+  // on every `Flush()`. Each member records its compressed size in its header,
+  // so that `ZlibInputStream` can find the members without inflating them.
+  // The output is still a valid multi-member gzip file. At most 1GB.
+  //
+  // This option is ignored for `ZlibInputStream`.
+  int64_t gzip_member_size = 0;
+
+  // When positive, `ZlibInputStream` inflates the members of a gzip file
+  // written with `gzip_member_size` on this many threads, ahead of the reader.
+  // Other files are still inflated on the reader's thread.
+  //
+  // This option is ignored for `ZlibOutputBuffer`.
+  int32 num_inflate_threads = 0;
 };
 
+// The gzip header of a member written with `gzip_member_size` carries an extra
+// field with a single subfield, identified by these two bytes, holding the
+// compressed size of the member as a little-endian uint32.
+constexpr char kGzipMemberSizeId[] = "TF";
+// The size of such a header, and the offset of the compressed size in it.
+constexpr size_t kGzipMemberHeaderSize = 20;
+constexpr size_t kGzipMemberSizeOffset = 16;
+
 inline ZlibCompressionOptions ZlibCompressionOptions::DEFAULT() {
   return ZlibCompressionOptions();
 }
@@ -17,12 +17,78 @@ limitations under the License.
 
 #include <zlib.h>
 
+#include <deque>
+#include <memory>
+
+#include "tensorflow/core/platform/coding.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace io {
 
+namespace {
+
+// Size of the ISIZE trailer of a gzip member.
+constexpr size_t kGzipTrailerSize = 4;
+
+// Returns the compressed size of the gzip member starting with `header`, as
+// recorded by `ZlibOutputBuffer` when writing with `gzip_member_size`, or 0 if
+// the header does not carry one.
+uint32 GzipMemberSize(StringPiece header) {
+  if (header.size() < kGzipMemberHeaderSize) {
+    return 0;
+  }
+  const uint8* bytes = reinterpret_cast<const uint8*>(header.data());
+  // ID1, ID2, CM and the FEXTRA flag, followed by an extra field that only
+  // holds the member size subfield.
+  if (bytes[0] != 0x1f || bytes[1] != 0x8b || bytes[2] != Z_DEFLATED ||
+      (bytes[3] & 0x04) == 0 ||
+      core::DecodeFixed16(header.data() + 10) != kGzipMemberHeaderSize - 12 ||
+      header[12] != kGzipMemberSizeId[0] ||
+      header[13] != kGzipMemberSizeId[1] ||
+      core::DecodeFixed16(header.data() + 14) != 4) {
+    return 0;
+  }
+  const uint32 size = core::DecodeFixed32(header.data() + kGzipMemberSizeOffset);
+  return size > kGzipMemberHeaderSize + kGzipTrailerSize ? size : 0;
+}
+
+// Inflates the single gzip member `member` into `output`.
+Status InflateGzipMember(StringPiece member, string* output) {
+  output->resize(core::DecodeFixed32(member.data() + member.size() -
+                                     kGzipTrailerSize));
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, MAX_WBITS + 16) != Z_OK) {
+    return errors::DataLoss("inflateInit failed for a gzip member.");
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(member.data()));
+  stream.avail_in = member.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream.avail_out = output->size();
+  const int error = inflate(&stream, Z_FINISH);
+  string error_string;
+  if (error != Z_STREAM_END || stream.total_out != output->size() ||
+      stream.avail_in != 0) {
+    error_string =
+        strings::StrCat("inflate() failed with error ", error, " on a ",
+                        member.size(), " byte gzip member");
+    if (stream.msg != nullptr) {
+      strings::StrAppend(&error_string, ": ", stream.msg);
+    }
+  }
+  inflateEnd(&stream);
+  if (!error_string.empty()) {
+    return errors::DataLoss(error_string);
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
 struct ZStreamDef {
   ZStreamDef(size_t input_buffer_capacity, size_t output_buffer_capacity)
       : input(new Bytef[input_buffer_capacity]),
@@ -52,6 +118,39 @@ struct ZStreamDef {
   std::unique_ptr<z_stream> stream;
 };
 
+struct ParallelInflateState {
+  // A gzip member, inflated on `pool`.
+  struct Member {
+    tstring input;
+    Notification done;
+    // Set once `done` is notified.
+    Status status;
+    string output;
+  };
+
+  explicit ParallelInflateState(int num_threads)
+      : max_members(2 * num_threads),
+        pool(Env::Default(), "zlib_inflate", num_threads) {}
+
+  // The number of members read ahead of the reader.
+  const size_t max_members;
+
+  // Header of the next member, when it has already been read.
+  tstring next_header;
+
+  // Whether all the members of the input have been scheduled.
+  bool end_of_input = false;
+
+  // Members in input order; the front one is being read from, starting at
+  // `next_unread_byte` of its output.
+  std::deque<std::shared_ptr<Member>> members;
+  size_t next_unread_byte = 0;
+
+  // Declared last, so that it waits for the scheduled members before the
+  // state they use is destroyed.
+  thread::ThreadPool pool;
+};
+
 ZlibInputStream::ZlibInputStream(
     InputStreamInterface* input_stream,
     size_t input_buffer_bytes,   // size of z_stream.next_in buffer
@@ -88,6 +187,8 @@ Status ZlibInputStream::Reset() {
   if (init_error_) {
     return errors::DataLoss("unable to reset stream, cannot decompress.");
   }
+  parallel_state_.reset();
+  checked_gzip_members_ = false;
   TF_RETURN_IF_ERROR(input_stream_->Reset());
   inflateEnd(z_stream_def_->stream.get());
   InitZlibBuffer();
@@ -198,6 +299,14 @@ Status ZlibInputStream::ReadNBytes(int64_t bytes_to_read, tstring* result) {
     return errors::DataLoss("Unable to decompress Zlib file.");
   }
 
+  if (zlib_options_.num_inflate_threads > 0 &&
+      zlib_options_.window_bits > MAX_WBITS && !checked_gzip_members_) {
+    TF_RETURN_IF_ERROR(CheckGzipMembers());
+  }
+  if (parallel_state_) {
+    return ReadNBytesFromMembers(bytes_to_read, result);
+  }
+
   result->clear();
   // Read as many bytes as possible from cache.
   bytes_to_read -= ReadBytesFromCache(bytes_to_read, result);
@@ -228,6 +337,101 @@ Status ZlibInputStream::ReadNBytes(int64_t bytes_to_read, tstring* result) {
   return OkStatus();
 }
 
+Status ZlibInputStream::CheckGzipMembers() {
+  checked_gzip_members_ = true;
+  if (input_buffer_capacity_ < kGzipMemberHeaderSize) {
+    return OkStatus();
+  }
+  tstring header;
+  Status s = input_stream_->ReadNBytes(kGzipMemberHeaderSize, &header);
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    return s;
+  }
+  if (GzipMemberSize(header) > 0) {
+    parallel_state_.reset(
+        new ParallelInflateState(zlib_options_.num_inflate_threads));
+    parallel_state_->next_header = std::move(header);
+    return OkStatus();
+  }
+  // Nothing has been inflated yet, so the header is inflated serially as if
+  // ReadFromStream() had read it.
+  memcpy(z_stream_def_->input.get(), header.data(), header.size());
+  z_stream_def_->stream->next_in = z_stream_def_->input.get();
+  z_stream_def_->stream->avail_in = header.size();
+  return OkStatus();
+}
+
+Status ZlibInputStream::ScheduleGzipMembers() {
+  ParallelInflateState* state = parallel_state_.get();
+  while (!state->end_of_input && state->members.size() < state->max_members) {
+    tstring header;
+    if (!state->next_header.empty()) {
+      header = std::move(state->next_header);
+      state->next_header = tstring();
+    } else {
+      Status s = input_stream_->ReadNBytes(kGzipMemberHeaderSize, &header);
+      if (errors::IsOutOfRange(s) && header.empty()) {
+        state->end_of_input = true;
+        break;
+      }
+      if (!s.ok() && !errors::IsOutOfRange(s)) {
+        return s;
+      }
+    }
+    const uint32 member_size = GzipMemberSize(header);
+    if (member_size == 0) {
+      return errors::DataLoss(
+          "Found a gzip member without a recorded size after ", bytes_read_,
+          " inflated bytes.");
+    }
+    auto member = std::make_shared<ParallelInflateState::Member>();
+    member->input = std::move(header);
+    tstring data;
+    Status s = input_stream_->ReadNBytes(member_size - kGzipMemberHeaderSize,
+                                         &data);
+    if (errors::IsOutOfRange(s)) {
+      return errors::DataLoss("Truncated gzip member of ", member_size,
+                              " bytes.");
+    }
+    TF_RETURN_IF_ERROR(s);
+    member->input.append(data.data(), data.size());
+    state->pool.Schedule([member]() {
+      member->status = InflateGzipMember(member->input, &member->output);
+      member->input = tstring();
+      member->done.Notify();
+    });
+    state->members.push_back(std::move(member));
+  }
+  return OkStatus();
+}
+
+Status ZlibInputStream::ReadNBytesFromMembers(int64_t bytes_to_read,
+                                              tstring* result) {
+  ParallelInflateState* state = parallel_state_.get();
+  result->clear();
+  while (bytes_to_read > 0) {
+    TF_RETURN_IF_ERROR(ScheduleGzipMembers());
+    if (state->members.empty()) {
+      return errors::OutOfRange("EOF reached");
+    }
+    ParallelInflateState::Member* member = state->members.front().get();
+    member->done.WaitForNotification();
+    TF_RETURN_IF_ERROR(member->status);
+    const size_t can_read_bytes = std::min<size_t>(
+        bytes_to_read, member->output.size() - state->next_unread_byte);
+    result->append(member->output.data() + state->next_unread_byte,
+                   can_read_bytes);
+    state->next_unread_byte += can_read_bytes;
+    bytes_read_ += can_read_bytes;
+    bytes_to_read -= can_read_bytes;
+    if (state->next_unread_byte == member->output.size()) {
+      state->members.pop_front();
+      state->next_unread_byte = 0;
+    }
+  }
+  return OkStatus();
+}
+
 #if defined(TF_CORD_SUPPORT)
 Status ZlibInputStream::ReadNBytes(int64_t bytes_to_read, absl::Cord* result) {
   // TODO(frankchn): Optimize this instead of bouncing through the buffer.
@@ -31,10 +31,14 @@ namespace io {
 // Forward declare some members of zlib.h, which is only included in the
 // .cc file.
 struct ZStreamDef;
+struct ParallelInflateState;
 
 // An ZlibInputStream provides support for reading from a stream compressed
 // using zlib (http://www.zlib.net/). Buffers the contents of the file.
 //
+// Gzip files written with `ZlibCompressionOptions::gzip_member_size` are
+// inflated on `num_inflate_threads` threads when that option is positive.
+//
 // A given instance of an ZlibInputStream is NOT safe for concurrent use
 // by multiple threads
 class ZlibInputStream : public InputStreamInterface {
@@ -90,6 +94,25 @@ class ZlibInputStream : public InputStreamInterface {
 
   std::unique_ptr<ZStreamDef> z_stream_def_;
 
+  // Whether the first gzip header has been checked for a member size, when
+  // `num_inflate_threads` is positive.
+  bool checked_gzip_members_ = false;
+
+  // Set iff the members of the input are inflated in parallel.
+  std::unique_ptr<ParallelInflateState> parallel_state_;
+
+  // Reads the first gzip header of the input and sets up `parallel_state_` if
+  // it carries a member size. Otherwise leaves the bytes read in
+  // `z_stream_def_->input`, to be inflated serially.
+  Status CheckGzipMembers();
+
+  // Reads gzip members from `input_stream_` and schedules their inflation
+  // until enough members are in flight or the input is exhausted.
+  Status ScheduleGzipMembers();
+
+  // Equivalent of ReadNBytes() when `parallel_state_` is set.
+  Status ReadNBytesFromMembers(int64_t bytes_to_read, tstring* result);
+
   // Reads data from `input_stream_` and tries to fill up `z_stream_input_` if
   // enough unread data is left in `input_stream_`.
   //
@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/coding.h"
 
 namespace tensorflow {
 namespace io {
@@ -49,6 +52,16 @@ Status ZlibOutputBuffer::Init() {
         "output_buffer_bytes should be greater than "
         "1");
   }
+  if (WritesGzipMembers()) {
+    if (zlib_options_.window_bits <= MAX_WBITS) {
+      return errors::InvalidArgument(
+          "gzip_member_size requires gzip encoding.");
+    }
+    if (zlib_options_.gzip_member_size > (1 << 30)) {
+      return errors::InvalidArgument("gzip_member_size should be at most 1GB, ",
+                                     "got ", zlib_options_.gzip_member_size);
+    }
+  }
   memset(z_stream_.get(), 0, sizeof(z_stream));
   z_stream_->zalloc = Z_NULL;
   z_stream_->zfree = Z_NULL;
@@ -153,6 +166,21 @@ Status ZlibOutputBuffer::Append(StringPiece data) {
   // The deflated output is accumulated in z_stream_output_ and gets written to
   // file as and when needed.
 
+  if (WritesGzipMembers()) {
+    while (!data.empty()) {
+      const size_t bytes_to_add =
+          std::min<size_t>(data.size(), zlib_options_.gzip_member_size -
+                                            member_input_.size());
+      member_input_.append(data.data(), bytes_to_add);
+      data.remove_prefix(bytes_to_add);
+      if (member_input_.size() ==
+          static_cast<size_t>(zlib_options_.gzip_member_size)) {
+        TF_RETURN_IF_ERROR(WriteGzipMember());
+      }
+    }
+    return OkStatus();
+  }
+
   size_t bytes_to_write = data.size();
 
   if (static_cast<int32>(bytes_to_write) <= AvailableInputSpace()) {
@@ -201,6 +229,10 @@ Status ZlibOutputBuffer::Append(const absl::Cord& cord) {
 #endif
 
 Status ZlibOutputBuffer::Flush() {
+  if (WritesGzipMembers()) {
+    TF_RETURN_IF_ERROR(WriteGzipMember());
+    return file_->Flush();
+  }
   TF_RETURN_IF_ERROR(DeflateBuffered(Z_PARTIAL_FLUSH));
   TF_RETURN_IF_ERROR(FlushOutputBufferToFile());
   return file_->Flush();
@@ -217,8 +249,12 @@ Status ZlibOutputBuffer::Sync() {
 
 Status ZlibOutputBuffer::Close() {
   if (z_stream_) {
-    TF_RETURN_IF_ERROR(DeflateBuffered(Z_FINISH));
-    TF_RETURN_IF_ERROR(FlushOutputBufferToFile());
+    if (WritesGzipMembers()) {
+      TF_RETURN_IF_ERROR(WriteGzipMember());
+    } else {
+      TF_RETURN_IF_ERROR(DeflateBuffered(Z_FINISH));
+      TF_RETURN_IF_ERROR(FlushOutputBufferToFile());
+    }
     deflateEnd(z_stream_.get());
     z_stream_.reset(nullptr);
   }
@@ -238,6 +274,54 @@ Status ZlibOutputBuffer::Deflate(int flush) {
   return errors::DataLoss(error_string);
 }
 
+Status ZlibOutputBuffer::WriteGzipMember() {
+  if (member_input_.empty()) {
+    return OkStatus();
+  }
+  // The compressed size is patched into the extra field once it is known.
+  Bytef extra[kGzipMemberHeaderSize - 12] = {
+      static_cast<Bytef>(kGzipMemberSizeId[0]),
+      static_cast<Bytef>(kGzipMemberSizeId[1]), 4, 0, 0, 0, 0, 0};
+  gz_header header;
+  memset(&header, 0, sizeof(header));
+  header.extra = extra;
+  header.extra_len = sizeof(extra);
+  header.os = 255;  // Unknown, as in the headers written by zlib.
+  if (deflateReset(z_stream_.get()) != Z_OK ||
+      deflateSetHeader(z_stream_.get(), &header) != Z_OK) {
+    return errors::DataLoss("Could not start a gzip member.");
+  }
+
+  string member(deflateBound(z_stream_.get(), member_input_.size()), '\0');
+  z_stream_->next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(member_input_.data()));
+  z_stream_->avail_in = member_input_.size();
+  z_stream_->next_out = reinterpret_cast<Bytef*>(&member[0]);
+  z_stream_->avail_out = member.size();
+  while (true) {
+    int error = deflate(z_stream_.get(), Z_FINISH);
+    if (error == Z_STREAM_END) break;
+    if (error != Z_OK && error != Z_BUF_ERROR) {
+      return errors::DataLoss("deflate() failed with error ", error);
+    }
+    // Out of output space, which deflateBound() should have prevented.
+    const size_t used = member.size() - z_stream_->avail_out;
+    member.resize(2 * member.size());
+    z_stream_->next_out = reinterpret_cast<Bytef*>(&member[used]);
+    z_stream_->avail_out = member.size() - used;
+  }
+  member.resize(member.size() - z_stream_->avail_out);
+  core::EncodeFixed32(&member[kGzipMemberSizeOffset], member.size());
+
+  // Restore z_stream pointers.
+  z_stream_->next_in = z_stream_input_.get();
+  z_stream_->avail_in = 0;
+  z_stream_->next_out = z_stream_output_.get();
+  z_stream_->avail_out = output_buffer_capacity_;
+  member_input_.clear();
+  return file_->Append(member);
+}
+
 Status ZlibOutputBuffer::Tell(int64_t* position) {
   return file_->Tell(position);
 }
@@ -145,6 +145,16 @@ class ZlibOutputBuffer : public WritableFile {
   // Calls `deflate()` and returns DataLoss Status if it failed.
   Status Deflate(int flush);
 
+  // Whether the input is written as gzip members of `gzip_member_size` bytes.
+  bool WritesGzipMembers() const { return zlib_options_.gzip_member_size > 0; }
+
+  // Deflates `member_input_` as a complete gzip member carrying its compressed
+  // size and appends it to `file_`.
+  Status WriteGzipMember();
+
+  // Input of the gzip member being written, when `WritesGzipMembers()`.
+  string member_input_;
+
   static bool IsSyncOrFullFlush(uint8 flush_mode) {
     return flush_mode == Z_SYNC_FLUSH || flush_mode == Z_FULL_FLUSH;
   }
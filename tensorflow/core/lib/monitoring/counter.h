@@ -99,10 +99,15 @@ namespace monitoring {
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// The value is split into shards on separate cache lines, and each thread
+// increments the shard it is assigned to, so cells updated concurrently from
+// hot paths do not bounce a cache line between cores. The shards are only
+// summed when the value is read.
+//
 // This class is thread-safe.
 class CounterCell {
  public:
-  explicit CounterCell(int64_t value) : value_(value) {}
+  explicit CounterCell(int64_t value) { shards_[0].value = value; }
   ~CounterCell() {}
 
   // Atomically increments the value by step.
@@ -113,7 +118,16 @@ class CounterCell {
   int64_t value() const;
 
  private:
-  std::atomic<int64_t> value_;
+  static constexpr int kNumShards = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  // Returns the shard assigned to the calling thread.
+  static int ThreadShard();
+
+  Shard shards_[kNumShards];
 
   TF_DISALLOW_COPY_AND_ASSIGN(CounterCell);
 };
@@ -194,12 +208,25 @@ class Counter {
 //  Implementation details follow. API readers may skip.
 ////
 
+inline int CounterCell::ThreadShard() {
+  static std::atomic<int> next_shard{0};
+  thread_local const int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
 inline void CounterCell::IncrementBy(const int64_t step) {
   DCHECK_LE(0, step) << "Must not decrement cumulative metrics.";
-  value_ += step;
+  shards_[ThreadShard()].value.fetch_add(step, std::memory_order_relaxed);
 }
 
-inline int64_t CounterCell::value() const { return value_; }
+inline int64_t CounterCell::value() const {
+  int64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
 
 template <int NumLabels>
 template <typename... MetricDefArgs>
@@ -15,6 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/counter.h"
 
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -50,6 +54,22 @@ TEST(LabeledCounterDeathTest, DiesOnDecrement) {
       "decrement");
 }
 
+TEST(LabeledCounterTest, ConcurrentIncrements) {
+  auto* cell = counter_with_labels->GetCell("ConcurrentOp");
+  constexpr int kNumThreads = 32;
+  constexpr int kNumIncrements = 1000;
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "increment", [cell] {
+            for (int j = 0; j < kNumIncrements; ++j) cell->IncrementBy(2);
+          }));
+    }
+  }
+  EXPECT_EQ(2 * kNumThreads * kNumIncrements, cell->value());
+}
+
 auto* init_counter_without_labels = Counter<0>::New(
     "/tensorflow/test/init_counter_without_labels",
     "Counter without any labels to check if it is initialized as 0.");
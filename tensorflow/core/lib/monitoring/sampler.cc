@@ -96,6 +96,31 @@ class ExponentialBuckets : public Buckets {
 
 }  // namespace
 
+SamplerCell::SamplerCell(const std::vector<double>& bucket_limits)
+    : bucket_limits_(bucket_limits),
+      buckets_(new std::atomic<int64_t>[bucket_limits.size()]),
+      min_(bucket_limits.back()) {
+  for (size_t i = 0; i < bucket_limits_.size(); ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+HistogramProto SamplerCell::value() const {
+  // Same encoding as histogram::Histogram::EncodeToProto with zero buckets
+  // preserved.
+  HistogramProto pb;
+  pb.set_min(min_.load(std::memory_order_relaxed));
+  pb.set_max(max_.load(std::memory_order_relaxed));
+  pb.set_num(num_.load(std::memory_order_relaxed));
+  pb.set_sum(sum_.load(std::memory_order_relaxed));
+  pb.set_sum_squares(sum_squares_.load(std::memory_order_relaxed));
+  for (size_t i = 0; i < bucket_limits_.size(); ++i) {
+    pb.add_bucket_limit(bucket_limits_[i]);
+    pb.add_bucket(buckets_[i].load(std::memory_order_relaxed));
+  }
+  return pb;
+}
+
 // static
 std::unique_ptr<Buckets> Buckets::Explicit(std::vector<double> bucket_limits) {
   return std::unique_ptr<Buckets>(
@@ -112,7 +112,11 @@ class Sampler {
 
 #include <float.h>
 
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "tensorflow/core/framework/summary.pb.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -134,11 +138,14 @@ namespace monitoring {
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// Samples are added without taking a lock: bucket counts are atomic and the
+// summary statistics are updated with compare-and-swap loops. A value read
+// while samples are being added may reflect a sample in some fields only.
+//
 // This class is thread-safe.
 class SamplerCell {
  public:
-  SamplerCell(const std::vector<double>& bucket_limits)
-      : histogram_(bucket_limits) {}
+  SamplerCell(const std::vector<double>& bucket_limits);
 
   ~SamplerCell() {}
 
@@ -149,7 +156,18 @@ class SamplerCell {
   HistogramProto value() const;
 
  private:
-  histogram::ThreadSafeHistogram histogram_;
+  static void AtomicAdd(std::atomic<double>* value, double delta);
+  static void AtomicMin(std::atomic<double>* value, double sample);
+  static void AtomicMax(std::atomic<double>* value, double sample);
+
+  // Upper bounds of the buckets, as in histogram::Histogram.
+  const std::vector<double> bucket_limits_;
+  std::unique_ptr<std::atomic<int64_t>[]> buckets_;
+  std::atomic<int64_t> num_{0};
+  std::atomic<double> sum_{0.0};
+  std::atomic<double> sum_squares_{0.0};
+  std::atomic<double> min_;
+  std::atomic<double> max_{-DBL_MAX};
 
   TF_DISALLOW_COPY_AND_ASSIGN(SamplerCell);
 };
@@ -277,12 +295,44 @@ class Sampler {
 //  Implementation details follow. API readers may skip.
 ////
 
-inline void SamplerCell::Add(const double sample) { histogram_.Add(sample); }
+inline void SamplerCell::AtomicAdd(std::atomic<double>* value,
+                                   const double delta) {
+  double old_value = value->load(std::memory_order_relaxed);
+  while (!value->compare_exchange_weak(old_value, old_value + delta,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+inline void SamplerCell::AtomicMin(std::atomic<double>* value,
+                                   const double sample) {
+  double old_value = value->load(std::memory_order_relaxed);
+  while (sample < old_value &&
+         !value->compare_exchange_weak(old_value, sample,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+inline void SamplerCell::AtomicMax(std::atomic<double>* value,
+                                   const double sample) {
+  double old_value = value->load(std::memory_order_relaxed);
+  while (sample > old_value &&
+         !value->compare_exchange_weak(old_value, sample,
+                                       std::memory_order_relaxed)) {
+  }
+}
 
-inline HistogramProto SamplerCell::value() const {
-  HistogramProto pb;
-  histogram_.EncodeToProto(&pb, true /* preserve_zero_buckets */);
-  return pb;
+inline void SamplerCell::Add(const double sample) {
+  // Samples at or above the last limit land in the last bucket.
+  size_t bucket = std::upper_bound(bucket_limits_.begin(),
+                                   bucket_limits_.end(), sample) -
+                  bucket_limits_.begin();
+  bucket = std::min(bucket, bucket_limits_.size() - 1);
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  num_.fetch_add(1, std::memory_order_relaxed);
+  AtomicAdd(&sum_, sample);
+  AtomicAdd(&sum_squares_, sample * sample);
+  AtomicMin(&min_, sample);
+  AtomicMax(&max_, sample);
 }
 
 template <int NumLabels>
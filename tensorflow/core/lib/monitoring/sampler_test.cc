@@ -15,6 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/sampler.h"
 
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -112,6 +116,27 @@ TEST(ExponentialSamplerTest, ExponentialBucketBoundaries) {
   EqHistograms(expected, cell->value());
 }
 
+TEST(LabeledSamplerTest, ConcurrentAdds) {
+  constexpr int kNumThreads = 16;
+  constexpr int kNumSamples = 1000;
+  Histogram expected({10.0, 20.0, DBL_MAX});
+  auto* cell = sampler_with_labels->GetCell("ConcurrentAdds");
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "add", [cell, i] {
+            for (int j = 0; j < kNumSamples; ++j) cell->Add(i + j % 3);
+          }));
+    }
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (int j = 0; j < kNumSamples; ++j) expected.Add(i + j % 3);
+  }
+
+  EqHistograms(expected, cell->value());
+}
+
 TEST(ExplicitSamplerTest, SameName) {
   auto* same_sampler = Sampler<1>::New({"/tensorflow/test/sampler_with_labels",
                                         "Sampler with one label.", "MyLabel"},
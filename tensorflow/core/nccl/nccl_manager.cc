@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/nccl/nccl_manager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <utility>
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -28,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/annotated_traceme.h"
 #include "tensorflow/core/profiler/lib/connected_traceme.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/util/env_var.h"
 #if GOOGLE_CUDA
 #include "tensorflow/stream_executor/cuda/cuda_activation.h"
 #elif TENSORFLOW_USE_ROCM
@@ -117,6 +120,16 @@ struct NcclManager::Communicator {
   const int num_devices;
   std::vector<CommunicatorMember> members;
   const string key;
+
+  // Value of NcclManager::communicator_use_clock_ when a collective last
+  // picked this communicator.  Guarded by NcclManager::mu_.
+  uint64 last_use = 0;
+
+  // Number of live collectives that use this communicator; it is only evicted
+  // when this is zero.  Shared with those collectives, which may outlive the
+  // communicator after StartAbort.
+  std::shared_ptr<std::atomic<int>> num_active_collectives =
+      std::make_shared<std::atomic<int>>(0);
 };
 
 namespace {
@@ -185,6 +198,10 @@ struct NcclManager::Collective : public core::RefCounted {
 #endif
   }
 
+  ~Collective() override {
+    if (communicator_refs != nullptr) --*communicator_refs;
+  }
+
   const string collective_key;  // A unique key for debugging.
   const DataType data_type;
   const CollectiveType type;
@@ -195,6 +212,8 @@ struct NcclManager::Collective : public core::RefCounted {
   const string communicator_key;
 
   Communicator* communicator = nullptr;
+  // `communicator->num_active_collectives`, held once `communicator` is set.
+  std::shared_ptr<std::atomic<int>> communicator_refs;
 
   // All collective participants.
   //
@@ -230,6 +249,13 @@ NcclManager::NcclManager() {
 #if TENSORFLOW_USE_ROCM
   ++instance_count;
 #endif
+  Status s = ReadInt64FromEnvVar("TF_NCCL_MAX_CACHED_COMMUNICATORS",
+                                 /*default_val=*/0, &max_cached_communicators_);
+  if (!s.ok()) LOG(WARNING) << s;
+  s = ReadInt64FromEnvVar("TF_NCCL_MAX_GROUPED_LAUNCHES",
+                          /*default_val=*/1, &max_grouped_launches_);
+  if (!s.ok()) LOG(WARNING) << s;
+  max_grouped_launches_ = std::max<int64_t>(max_grouped_launches_, 1);
 }
 NcclManager::~NcclManager() {
   VLOG(2) << "~NcclManager " << this;
@@ -285,6 +311,7 @@ Status NcclManager::GetCommunicator(NcclManager::Collective* collective,
     return status_;
   }
 
+  Communicator* found = nullptr;
   if (collective->communicator_key.empty()) {
     // For single-node collectives, when the caller does not specify a
     // `communicator_key`, we identify a communicator uniquely by the set of
@@ -298,8 +325,10 @@ Status NcclManager::GetCommunicator(NcclManager::Collective* collective,
     // example, a communicator for GPUs 0 and 1 is separate from one for GPUs 0,
     // 1, and 2.
     //
-    // Since it's expected that a small number of distinct communicators will
-    // be needed, communicators_ is not garbage collected currently.
+    // Communicators are kept across steps since NCCL initialization is
+    // expensive.  If TF_NCCL_MAX_CACHED_COMMUNICATORS is set, the least
+    // recently used idle single-node communicators are destroyed once more
+    // than that many exist; see EvictCommunicators.
     //
     // Launching of kernels must be serialized so that, given collectives A and
     // B, and an order of them (e.g., A before B), then for each comm_stream
@@ -317,8 +346,8 @@ Status NcclManager::GetCommunicator(NcclManager::Collective* collective,
           }
         }
         if (i == collective->num_local_devices) {
-          *communicator = comm.get();
-          return OkStatus();
+          found = comm.get();
+          break;
         }
       }
     }
@@ -337,11 +366,18 @@ Status NcclManager::GetCommunicator(NcclManager::Collective* collective,
     // `Communicator` corresponding to this id.
     for (auto& comm : communicators_) {
       if (comm->key == collective->communicator_key) {
-        *communicator = comm.get();
-        return OkStatus();
+        found = comm.get();
+        break;
       }
     }
   }
+  if (found != nullptr) {
+    found->last_use = ++communicator_use_clock_;
+    collective->communicator_refs = found->num_active_collectives;
+    ++*collective->communicator_refs;
+    *communicator = found;
+    return OkStatus();
+  }
 
   auto* env = Env::Default();
   std::set<NcclStream*> used_streams;
@@ -425,10 +461,63 @@ Status NcclManager::GetCommunicator(NcclManager::Collective* collective,
   }
   communicators_.emplace_back(
       new Communicator(std::move(members), collective->communicator_key));
-  *communicator = communicators_.back().get();
+  found = communicators_.back().get();
+  found->last_use = ++communicator_use_clock_;
+  collective->communicator_refs = found->num_active_collectives;
+  ++*collective->communicator_refs;
+  *communicator = found;
+  EvictCommunicators();
   return OkStatus();
 }
 
+void NcclManager::EvictCommunicators() {
+  if (max_cached_communicators_ <= 0) return;
+  while (static_cast<int64_t>(communicators_.size()) >
+         max_cached_communicators_) {
+    auto victim = communicators_.end();
+    for (auto it = communicators_.begin(); it != communicators_.end(); ++it) {
+      const Communicator& comm = **it;
+      // A multi-node communicator cannot be re-created without the other
+      // nodes, so only single-node ones are evicted.
+      if (!comm.key.empty() || *comm.num_active_collectives > 0) continue;
+      if (victim == communicators_.end() ||
+          comm.last_use < (*victim)->last_use) {
+        victim = it;
+      }
+    }
+    if (victim == communicators_.end()) return;
+    VLOG(2) << "Evicting NCCL communicator over " << (*victim)->num_devices
+            << " devices, last used at " << (*victim)->last_use;
+    communicators_.erase(victim);
+  }
+}
+
+Status NcclManager::WarmUpCommunicator(
+    std::vector<std::unique_ptr<Participant>> participants,
+    const Context& context) {
+  if (participants.size() != context.num_local_devices) {
+    return errors::InvalidArgument("WarmUpCommunicator expected ",
+                                   context.num_local_devices,
+                                   " participants but got ",
+                                   participants.size());
+  }
+  if (context.num_local_devices != context.num_global_devices &&
+      context.communicator_key.empty()) {
+    return errors::InvalidArgument(
+        "WarmUpCommunicator for a multi node communicator requires a "
+        "communicator_key");
+  }
+  // The collective is never launched; it only carries the participants'
+  // devices and ranks to GetCommunicator.
+  core::RefCountPtr<Collective> collective(new Collective(
+      context.collective_key, DT_FLOAT, kAllReduce, ncclSum,
+      context.num_local_devices, context.num_global_devices,
+      context.communicator_key));
+  TF_RETURN_IF_ERROR(collective->status);
+  collective->participants = std::move(participants);
+  return GetCommunicator(collective.get(), &collective->communicator);
+}
+
 void NcclManager::AddToAllReduce(std::unique_ptr<Participant> participant,
                                  const Context& context,
                                  ncclRedOp_t reduction_op) {
@@ -705,30 +794,13 @@ void NcclManager::LoopKernelLaunches(NcclStream* nccl_stream) {
   const cudaStream_t* cu_stream = reinterpret_cast<const cudaStream_t*>(
       comm_stream->implementation()->GpuStreamMemberHack());
 
-  while (true) {
-    // Find collective to run.
-    std::pair<Collective*, int> next_launch;
-    {
-      VLOG(3) << "Locking mutex nccl_stream " << nccl_stream;
-      mutex_lock l(nccl_stream->mu);
-      while (nccl_stream->pending_launches_.empty()) {
-        if (nccl_stream->shutdown_requested) {
-          // No work and shutdown requested, exit.
-          return;
-        }
-        nccl_stream->cv.wait(l);
-      }
-      next_launch = nccl_stream->pending_launches_.back();
-      nccl_stream->pending_launches_.pop_back();
-    }
-
-    // Launch the nccl kernel.
-    Collective* collective = next_launch.first;
-    tensorflow::profiler::TraceMeConsumer traceme("Run Collective",
-                                                  collective->trace_context);
-
+  // Enqueues the kernel for participant `p_idx` of `collective`.  Sets
+  // `*enqueued` to false if the participant is malformed and nothing was
+  // enqueued.
+  auto launch_kernel = [&](Collective* collective, int p_idx,
+                           bool* enqueued) -> Status {
+    *enqueued = true;
     ncclDataType_t data_type = ToNcclType(collective->data_type);
-    int p_idx = next_launch.second;
     Participant* p = collective->participants[p_idx].get();
     auto nccl_comm = collective->communicator->members[p_idx].nccl_comm;
     ncclResult_t nccl_result = ncclSuccess;
@@ -770,10 +842,9 @@ void NcclManager::LoopKernelLaunches(NcclStream* nccl_stream) {
           recvbuff = const_cast<void*>(sendbuff);
         }
         if (num_elements < 0) {
-          p->done_callback(errors::Internal(
-              "Both input and output are null in ncclBroadcast"));
-          collective->Unref();
-          continue;
+          *enqueued = false;
+          return errors::Internal(
+              "Both input and output are null in ncclBroadcast");
         }
         VLOG(2) << "call NcclBroadcast collective_key "
                 << collective->collective_key << " participant " << p_idx
@@ -829,23 +900,124 @@ void NcclManager::LoopKernelLaunches(NcclStream* nccl_stream) {
         break;
       }
     }
+    if (nccl_result != ncclSuccess) {
+      // Propagate the error, but note that if other members of the collective
+      // did launch their kernels, then they are hanging.
+      return errors::Unknown("Error invoking NCCL: ",
+                             ncclGetErrorString(nccl_result));
+    }
+    return OkStatus();
+  };
 
-    // Run the done_callback when the nccl kernel finishes running.
-    auto done_callback = [collective, p_idx, nccl_result]() {
-      VLOG(2) << "done Nccl kernel collective_key "
-              << collective->collective_key << " participant " << p_idx
-              << " ncclResult " << nccl_result;
-      if (nccl_result == ncclSuccess) {
-        collective->participants[p_idx]->done_callback(OkStatus());
-      } else {
-        // Propagate the error, but note that if other members of the collective
-        // did launch their kernels, then they are hanging.
-        collective->participants[p_idx]->done_callback(errors::Unknown(
-            "Error invoking NCCL: ", ncclGetErrorString(nccl_result)));
+  while (true) {
+    // Find collectives to run.  Launches that are queued back to back on the
+    // same communicator are issued as one NCCL group so that NCCL can
+    // aggregate many small collectives into a single kernel launch.  Each
+    // stream groups independently, so how launches are split into groups
+    // depends on queue timing and may differ across ranks; grouping is
+    // therefore opt-in via TF_NCCL_MAX_GROUPED_LAUNCHES.
+    std::vector<std::pair<Collective*, int>> launches;
+    {
+      VLOG(3) << "Locking mutex nccl_stream " << nccl_stream;
+      mutex_lock l(nccl_stream->mu);
+      while (nccl_stream->pending_launches_.empty()) {
+        if (nccl_stream->shutdown_requested) {
+          // No work and shutdown requested, exit.
+          return;
+        }
+        nccl_stream->cv.wait(l);
+      }
+      launches.push_back(nccl_stream->pending_launches_.back());
+      nccl_stream->pending_launches_.pop_back();
+#if NCCL_MAJOR >= 2
+      while (static_cast<int64_t>(launches.size()) < max_grouped_launches_ &&
+             !nccl_stream->pending_launches_.empty() &&
+             nccl_stream->pending_launches_.back().first->communicator ==
+                 launches.front().first->communicator) {
+        launches.push_back(nccl_stream->pending_launches_.back());
+        nccl_stream->pending_launches_.pop_back();
       }
-      collective->Unref();
-    };
-    p->event_mgr->ThenExecute(comm_stream, done_callback);
+#endif
+    }
+
+    std::vector<Status> statuses(launches.size());
+    std::vector<bool> enqueued(launches.size(), false);
+    std::vector<uint64> start_micros(launches.size());
+#if NCCL_MAJOR >= 2
+    const bool grouped = launches.size() > 1;
+    if (grouped) {
+      VLOG(2) << "Grouping " << launches.size() << " NCCL launches on stream "
+              << nccl_stream;
+      ncclResult_t group_result = ncclGroupStart();
+      if (group_result != ncclSuccess) {
+        statuses.assign(launches.size(),
+                        errors::Unknown("Error invoking NCCL: ",
+                                        ncclGetErrorString(group_result)));
+      }
+    }
+#endif
+    for (size_t i = 0; i < launches.size(); ++i) {
+      if (!statuses[i].ok()) continue;
+      Collective* collective = launches[i].first;
+      // Launch the nccl kernel.
+      tensorflow::profiler::TraceMeConsumer traceme("Run Collective",
+                                                    collective->trace_context);
+      start_micros[i] = Env::Default()->NowMicros();
+      bool launch_enqueued;
+      statuses[i] =
+          launch_kernel(collective, launches[i].second, &launch_enqueued);
+      enqueued[i] = launch_enqueued;
+    }
+#if NCCL_MAJOR >= 2
+    if (grouped) {
+      ncclResult_t group_result = ncclGroupEnd();
+      if (group_result != ncclSuccess) {
+        for (Status& status : statuses) {
+          status.Update(errors::Unknown("Error invoking NCCL: ",
+                                        ncclGetErrorString(group_result)));
+        }
+      }
+    }
+#endif
+
+    for (size_t i = 0; i < launches.size(); ++i) {
+      Collective* collective = launches[i].first;
+      const int p_idx = launches[i].second;
+      Participant* p = collective->participants[p_idx].get();
+      Status status = statuses[i];
+      if (!enqueued[i]) {
+        // Nothing was enqueued for this participant.
+        p->done_callback(status);
+        collective->Unref();
+        continue;
+      }
+      // Run the done_callback when the nccl kernel finishes running.
+      const uint64 start = start_micros[i];
+      const size_t buffer_size = ComputeBufferSize(p, collective->data_type);
+      auto done_callback = [collective, p_idx, status, start, buffer_size]() {
+        VLOG(2) << "done Nccl kernel collective_key "
+                << collective->collective_key << " participant " << p_idx
+                << " status " << status;
+        // Latency is measured from enqueue to when the EventMgr observes
+        // completion, so it includes time spent behind earlier work on the
+        // stream.
+        const uint64 latency_us =
+            std::max<uint64>(Env::Default()->NowMicros() - start, 1);
+        profiler::TraceMe::InstantActivity([&] {
+          return profiler::TraceMeEncode(
+              "NcclCollectiveDone",
+              {{"collective_key", collective->collective_key},
+               {"participant", p_idx},
+               {"buffer_size", buffer_size},
+               {"latency_us", latency_us},
+               {"bandwidth_gbps",
+                static_cast<double>(buffer_size) / latency_us / 1e3}});
+        });
+        collective->participants[p_idx]->done_callback(status);
+        collective->Unref();
+      };
+      p->event_mgr->ThenExecute(comm_stream, done_callback);
+    }
   }
 }
 
@@ -905,6 +1077,20 @@ void NcclManager::Reset() {
   VLOG(2) << "Reset NcclManager " << this;
 }
 
+int NcclManager::NumCommunicatorsForTesting() {
+  mutex_lock l(mu_);
+  return communicators_.size();
+}
+
+int NcclManager::NumIdleCommunicatorsForTesting() {
+  mutex_lock l(mu_);
+  int num_idle = 0;
+  for (const auto& comm : communicators_) {
+    if (*comm->num_active_collectives == 0) ++num_idle;
+  }
+  return num_idle;
+}
+
 }  // namespace tensorflow
 
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
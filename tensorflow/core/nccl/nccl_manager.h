@@ -184,6 +184,15 @@ class NcclManager {
   void AddReduceRecv(std::unique_ptr<Participant> participant,
                      const Context& context, ncclRedOp_t reduction_op);
 
+  // Creates (or looks up) the communicator that collectives over the devices of
+  // `participants`, or over `context.communicator_key` for multi-node
+  // collectives, will use, so that NCCL initialization is not paid on the
+  // first collective of a step.  `participants` must hold one participant per
+  // local device; their tensors and `done_callback` are not used.
+  Status WarmUpCommunicator(
+      std::vector<std::unique_ptr<Participant>> participants,
+      const Context& context);
+
   // Signals that the `Collective` corresponding to `key` is ready to launch
   // across all nodes participating in this multi-node collective operation.
   //
@@ -200,6 +209,11 @@ class NcclManager {
   // collectives.
   void Reset();
 
+  // Returns the number of cached communicators, and how many of them have no
+  // in-flight collectives.  For testing only.
+  int NumCommunicatorsForTesting() TF_LOCKS_EXCLUDED(mu_);
+  int NumIdleCommunicatorsForTesting() TF_LOCKS_EXCLUDED(mu_);
+
  private:
   enum CollectiveType {
     kAllReduce = 1,
@@ -220,6 +234,10 @@ class NcclManager {
   // the corresponding NCCL/CUDA error string.
   Status GetCommunicator(Collective* collective, Communicator** communicator);
 
+  // Destroys least recently used single-node communicators that have no
+  // in-flight collectives until at most `max_cached_communicators_` remain.
+  void EvictCommunicators() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Adds a participant device to the local `Collective` instance corresponding
   // to `collective_key`.  Launches the `Collective` if it is ready, which it
   // checks by calling `CheckReady()`.  Also performs consistency and sanity
@@ -255,6 +273,19 @@ class NcclManager {
 
   std::vector<std::unique_ptr<Communicator>> communicators_ TF_GUARDED_BY(mu_);
 
+  // Upper bound on `communicators_.size()`, read from
+  // TF_NCCL_MAX_CACHED_COMMUNICATORS.  0 means unbounded.
+  int64_t max_cached_communicators_ = 0;
+
+  // Upper bound on how many launches for one communicator a stream issues as a
+  // single NCCL group, read from TF_NCCL_MAX_GROUPED_LAUNCHES.  Defaults to 1,
+  // which disables grouping, since ranks may split launches into groups
+  // differently depending on when each stream's queue fills.
+  int64_t max_grouped_launches_ = 1;
+
+  // Logical clock used to order communicators by last use.
+  uint64 communicator_use_clock_ TF_GUARDED_BY(mu_) = 0;
+
   Status status_ TF_GUARDED_BY(mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(NcclManager);
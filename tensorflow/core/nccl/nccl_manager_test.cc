@@ -418,6 +418,39 @@ class NcclManagerTest : public ::testing::Test {
     this->VerifyResults(test_case.get());
   }
 
+  // Runs a sum reduction of `shape` over the first `num_ranks` devices with
+  // `manager`, and verifies the results.
+  void RunSumReduction(NcclManager* manager, int num_ranks,
+                       const string& collective_key,
+                       const TensorShape& shape) {
+    std::unique_ptr<TestCase> test_case(MakeReductionTestCase(
+        /*num_nodes=*/1, num_ranks, ncclSum, shape, 0.0f));
+    for (int rank = 0; rank < num_ranks; ++rank) {
+      auto* device = GetDevice(num_ranks, /*node=*/0, rank);
+      auto* info = device->tensorflow_accelerator_device_info();
+      auto participant = absl::make_unique<NcclManager::Participant>(
+          device->executor(), info->stream, info, &test_case->ins[rank],
+          &test_case->outs[rank], /*global_rank=*/-1,
+          CreateDoneCallback(test_case.get()));
+      manager->AddToAllReduce(
+          std::move(participant),
+          {collective_key, /*num_local_devices=*/num_ranks,
+           /*num_global_devices=*/num_ranks, /*communicator_key=*/"",
+           /*source_rank=*/-1},
+          ncclSum);
+    }
+    VerifyResults(test_case.get());
+  }
+
+  // Waits until no communicator of `manager` has in-flight collectives.  Done
+  // callbacks run before a collective releases its communicator.
+  static void WaitForIdleCommunicators(NcclManager* manager) {
+    while (manager->NumIdleCommunicatorsForTesting() <
+           manager->NumCommunicatorsForTesting()) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
   static int GlobalRank(int num_ranks_per_node, int node, int local_rank) {
     return node * num_ranks_per_node + local_rank;
   }
@@ -494,6 +527,112 @@ TYPED_TEST(NcclManagerTest, BasicSumReduction) {
   }
 }
 
+// Warms up the communicator for all local devices, then runs a reduction over
+// the same devices, which should reuse it.
+TYPED_TEST(NcclManagerTest, WarmUpCommunicator) {
+  const int num_ranks = this->NumGPUs();
+  std::vector<std::unique_ptr<NcclManager::Participant>> warm_up_participants;
+  for (int rank = 0; rank < num_ranks; ++rank) {
+    auto* device = this->GetDevice(num_ranks, /*node=*/0, rank);
+    auto* info = device->tensorflow_accelerator_device_info();
+    warm_up_participants.push_back(absl::make_unique<NcclManager::Participant>(
+        device->executor(), info->stream, info, /*input=*/nullptr,
+        /*output=*/nullptr, /*global_rank=*/-1, [](Status) {}));
+  }
+  TF_ASSERT_OK(NcclManager::instance()->WarmUpCommunicator(
+      std::move(warm_up_participants),
+      {"warmup", /*num_local_devices=*/num_ranks,
+       /*num_global_devices=*/num_ranks, /*communicator_key=*/"",
+       /*source_rank=*/-1}));
+
+  std::unique_ptr<typename TestFixture::TestCase> test_case(
+      this->MakeReductionTestCase(/*num_nodes=*/1, num_ranks, ncclSum,
+                                  TensorShape({2, 3}), 0.0f));
+  for (int rank = 0; rank < num_ranks; ++rank) {
+    auto* device = this->GetDevice(num_ranks, /*node=*/0, rank);
+    auto* info = device->tensorflow_accelerator_device_info();
+    auto participant = absl::make_unique<NcclManager::Participant>(
+        device->executor(), info->stream, info, &test_case->ins[rank],
+        &test_case->outs[rank], /*global_rank=*/-1,
+        this->CreateDoneCallback(test_case.get()));
+    NcclManager::instance()->AddToAllReduce(
+        std::move(participant),
+        {"allreduce_after_warmup", /*num_local_devices=*/num_ranks,
+         /*num_global_devices=*/num_ranks, /*communicator_key=*/"",
+         /*source_rank=*/-1},
+        ncclSum);
+  }
+
+  LOG(INFO) << "Verifying results";
+  this->VerifyResults(test_case.get());
+}
+
+// Runs reductions that are queued back to back with grouping enabled, so that
+// they are launched as NCCL groups.
+TYPED_TEST(NcclManagerTest, GroupedLaunches) {
+  const int num_ranks = this->NumGPUs();
+  const int num_collectives = 16;
+  setenv("TF_NCCL_MAX_GROUPED_LAUNCHES", "4", 1 /* replace */);
+  NcclManager manager;
+  unsetenv("TF_NCCL_MAX_GROUPED_LAUNCHES");
+
+  std::vector<std::unique_ptr<typename TestFixture::TestCase>> test_cases;
+  for (int i = 0; i < num_collectives; ++i) {
+    test_cases.emplace_back(this->MakeReductionTestCase(
+        /*num_nodes=*/1, num_ranks, ncclSum, TensorShape({i % 4 + 1, 3}),
+        1.1f * i));
+  }
+  // Every rank adds all of its collectives in the same order before moving on
+  // to the next rank, so that launches pile up on each stream.
+  for (int rank = 0; rank < num_ranks; ++rank) {
+    auto* device = this->GetDevice(num_ranks, /*node=*/0, rank);
+    auto* info = device->tensorflow_accelerator_device_info();
+    for (int i = 0; i < num_collectives; ++i) {
+      typename TestFixture::TestCase* test_case = test_cases[i].get();
+      auto participant = absl::make_unique<NcclManager::Participant>(
+          device->executor(), info->stream, info, &test_case->ins[rank],
+          &test_case->outs[rank], /*global_rank=*/-1,
+          this->CreateDoneCallback(test_case));
+      manager.AddToAllReduce(
+          std::move(participant),
+          {strings::StrCat("grouped_allreduce", i),
+           /*num_local_devices=*/num_ranks,
+           /*num_global_devices=*/num_ranks, /*communicator_key=*/"",
+           /*source_rank=*/-1},
+          ncclSum);
+    }
+  }
+
+  for (int i = 0; i < num_collectives; ++i) {
+    this->VerifyResults(test_cases[i].get());
+  }
+}
+
+// Checks that idle communicators are evicted once more than
+// TF_NCCL_MAX_CACHED_COMMUNICATORS exist, and recreated when used again.
+TYPED_TEST(NcclManagerTest, EvictsIdleCommunicators) {
+  const int num_ranks = this->NumGPUs();
+  setenv("TF_NCCL_MAX_CACHED_COMMUNICATORS", "1", 1 /* replace */);
+  NcclManager manager;
+  unsetenv("TF_NCCL_MAX_CACHED_COMMUNICATORS");
+
+  this->RunSumReduction(&manager, num_ranks, "all_devices",
+                        TensorShape({2, 3}));
+  EXPECT_EQ(manager.NumCommunicatorsForTesting(), 1);
+
+  // A different set of devices needs a new communicator, which evicts the
+  // idle one.
+  this->WaitForIdleCommunicators(&manager);
+  this->RunSumReduction(&manager, num_ranks - 1, "fewer_devices",
+                        TensorShape({2, 3}));
+  EXPECT_EQ(manager.NumCommunicatorsForTesting(), 1);
+
+  this->WaitForIdleCommunicators(&manager);
+  this->RunSumReduction(&manager, num_ranks, "all_devices_again",
+                        TensorShape({2, 3}));
+  EXPECT_EQ(manager.NumCommunicatorsForTesting(), 1);
+}
+
 // Same as the Basic test, but with multiple threads launching parts of many
 // reductions.
 //
@@ -764,6 +764,7 @@ REGISTER_OP("TextLineDataset")
     .Input("compression_type: string")
     .Input("buffer_size: int64")
     .Attr("metadata: string = ''")
+    .Attr("num_inflate_threads: int >= 0 = 0")
     .Output("handle: variant")
     .SetDoNotOptimize()  // TODO(b/123753214): See comment in dataset_ops.cc.
     .SetTypeConstructor(full_type::UnaryTensorContainer(TFT_DATASET,
@@ -998,6 +999,28 @@ REGISTER_OP("DeserializeIterator")
     .Input("serialized: variant")
     .SetShapeFn(shape_inference::NoOutputs);
 
+REGISTER_OP("IteratorSaveIncremental")
+    .Input("iterator: resource")
+    .Input("directory: string")
+    .Attr("asynchronous: bool = false")
+    .Attr("external_state_policy: int = 0")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      return OkStatus();
+    });
+
+REGISTER_OP("IteratorRestoreIncremental")
+    .Input("iterator: resource")
+    .Input("directory: string")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      return OkStatus();
+    });
+
 REGISTER_OP("DatasetToGraph")
     .Input("input_dataset: variant")
     .Attr("stateful_whitelist: list(string) >= 0 = []")
@@ -305,6 +305,25 @@ REGISTER_OP("ResizeBilinear")
     .Attr("half_pixel_centers: bool = false")
     .SetShapeFn(ResizeShapeFn);
 
+REGISTER_OP("_FusedResizeBilinear")
+    .Input("images: T")
+    .Input("size: int32")
+    .Input("mean: float")
+    .Input("scale: float")
+    .Output("resized_images: float")
+    .Attr("T: {uint8}")
+    .Attr("align_corners: bool = false")
+    .Attr("half_pixel_centers: bool = false")
+    .SetShapeFn(ResizeShapeFn)
+    .Doc(R"doc(
+Resizes `images` like ResizeBilinear and returns `(resized - mean) * scale`.
+
+`mean` and `scale` hold either one value or one value per channel.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 REGISTER_OP("ScaleAndTranslate")
     .Input("images: T")
@@ -511,6 +530,47 @@ REGISTER_OP("DecodeAndCropJpeg")
       return OkStatus();
     });
 
+// --------------------------------------------------------------------------
+REGISTER_OP("DecodeCropAndResizeJpeg")
+    .Input("contents: string")
+    .Input("crop_window: int32")
+    .Input("size: int32")
+    .Attr("channels: int = 0")
+    .Attr("fancy_upscaling: bool = true")
+    .Attr("try_recover_truncated: bool = false")
+    .Attr("acceptable_fraction: float = 1.0")
+    .Attr("dct_method: string = ''")
+    .Attr("align_corners: bool = false")
+    .Attr("half_pixel_centers: bool = false")
+    .Output("resized_image: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      DimensionHandle channels_dim = c->UnknownDim();
+
+      int32_t channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      if (channels != 0) {
+        if (channels < 0) {
+          return errors::InvalidArgument("channels must be non-negative, got ",
+                                         channels);
+        }
+        channels_dim = c->MakeDim(channels);
+      }
+
+      DimensionHandle unused_dim;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(unused, 0), 4, &unused_dim));
+
+      ShapeHandle size;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(unused, 0), 2, &unused_dim));
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(2, &size));
+      c->set_output(0, c->MakeShape({c->Dim(size, 0), c->Dim(size, 1),
+                                     channels_dim}));
+      return OkStatus();
+    });
+
 // --------------------------------------------------------------------------
 REGISTER_OP("EncodeJpeg")
     .Input("image: uint8")
@@ -410,6 +410,17 @@ REGISTER_OP("AnonymousMutableHashTable")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
+REGISTER_OP("ConcurrentMutableHashTable")
+    .Output("table_handle: resource")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: type")
+    .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 1 = 16")
+    .SetIsStateful()
+    .SetShapeFn(MutableHashTableShapeFn);
+
 REGISTER_OP("MutableHashTableOfTensors")
     .Output("table_handle: Ref(string)")
     .Attr("container: string = ''")
@@ -440,6 +451,20 @@ REGISTER_OP("AnonymousMutableHashTableOfTensors")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
+REGISTER_OP("DynamicEmbeddingTable")
+    .Output("table_handle: resource")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: type")
+    .Attr("value_dtype: type")
+    .Attr("value_shape: shape = {}")
+    .Attr("admission_threshold: int >= 1 = 1")
+    .Attr("max_entries: int >= 0 = 0")
+    .Attr("ttl_seconds: int >= 0 = 0")
+    .SetIsStateful()
+    .SetShapeFn(MutableHashTableOfTensorsShapeFn);
+
 REGISTER_OP("MutableDenseHashTable")
     .Input("empty_key: key_dtype")
     .Output("table_handle: Ref(string)")
@@ -337,6 +337,23 @@ REGISTER_OP("_UnaryOpsComposition")
 expected to create these operators.
 )doc");
 
+// Computes a chain of elementwise ops in one kernel. `op_names` are applied in
+// order to a running value that starts at `x`: unary ops replace it with
+// op(value), binary ops with op(value, arg), consuming `args` in order. Each
+// arg is a scalar or has the shape of `x`.
+REGISTER_OP("_FusedElementwise")
+    .Input("x: T")
+    .Input("args: num_args * T")
+    .Output("y: T")
+    .Attr("T: {half, float}")
+    .Attr("num_args: int >= 0")
+    .Attr("op_names: list(string)")
+    .SetShapeFn(shape_inference::UnchangedShape)
+    .Doc(R"doc(
+*NOTE*: Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to create these operators.
+)doc");
+
 #undef UNARY
 #undef UNARY_REAL
 #undef UNARY_COMPLEX
@@ -1015,6 +1032,33 @@ _FusedConv2D output.
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_DynamicQuantizedMatMul")
+    .Input("a: T")
+    .Input("b: T")
+    .Input("args: num_args * T")
+    .Output("product: T")
+    .Attr("transpose_a: bool = false")
+    .Attr("transpose_b: bool = false")
+    .Attr("T: {float}")
+    .Attr("num_args: int >= 0")
+    .Attr("fused_ops: list(string) = []")
+    .SetShapeFn(shape_inference::MatMulShape)
+    .Doc(R"doc(
+Performs a MatMul in 8-bit integer arithmetic, optionally followed by a series
+of operations as in _FusedMatMul.
+
+`b` holds constant weights. They are quantized to int8 once, with one scale per
+output column, and the quantized weights are reused by later calls. The rows of
+`a` are quantized to int8 on every call, with one scale per row. The int32
+products are scaled back to float before the `fused_ops` are applied.
+
+Currently supported fused_op combinations are: [], ["BiasAdd"] and
+["BiasAdd","Relu"].
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 // For operations where the output is a reduction function along some
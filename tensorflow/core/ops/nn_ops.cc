@@ -1218,6 +1218,49 @@ REGISTER_OP("Softmax")
 
 // --------------------------------------------------------------------------
 
+// Computes `softmax(scale * query * key^T) * value` for every batch entry and
+// head, without materializing the [q_len, kv_len] attention scores:
+//   query:  [batch, heads, q_len, depth]
+//   key:    [batch, heads, kv_len, depth]
+//   value:  [batch, heads, kv_len, value_depth]
+//   output: [batch, heads, q_len, value_depth]
+//
+// Added by the Grappler remapper in place of the BatchMatMul-Softmax-
+// BatchMatMul subgraph of an attention layer.
+REGISTER_OP("_FusedMultiHeadAttention")
+    .Input("query: T")
+    .Input("key: T")
+    .Input("value: T")
+    .Output("output: T")
+    .Attr("T: {half, float}")
+    .Attr("scale: float = 1.0")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle query, key, value;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 4, &query));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 4, &key));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 4, &value));
+
+      // All inputs have the same batch and head dimensions.
+      ShapeHandle batch_heads, key_batch_heads, value_batch_heads;
+      TF_RETURN_IF_ERROR(c->Subshape(query, 0, 2, &batch_heads));
+      TF_RETURN_IF_ERROR(c->Subshape(key, 0, 2, &key_batch_heads));
+      TF_RETURN_IF_ERROR(c->Subshape(value, 0, 2, &value_batch_heads));
+      TF_RETURN_IF_ERROR(c->Merge(batch_heads, key_batch_heads, &batch_heads));
+      TF_RETURN_IF_ERROR(
+          c->Merge(batch_heads, value_batch_heads, &batch_heads));
+
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(query, 3), c->Dim(key, 3), &unused));
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(key, 2), c->Dim(value, 2), &unused));
+
+      c->set_output(0, c->MakeShape({c->Dim(batch_heads, 0),
+                                     c->Dim(batch_heads, 1), c->Dim(query, 2),
+                                     c->Dim(value, 3)}));
+      return OkStatus();
+    });
+
+// --------------------------------------------------------------------------
+
 REGISTER_OP("LogSoftmax")
     .Input("logits: T")
     .Output("logsoftmax: T")
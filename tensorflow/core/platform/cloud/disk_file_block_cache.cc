@@ -0,0 +1,329 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/disk_file_block_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "tensorflow/core/platform/file_statistics.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/strcat.h"
+
+namespace tensorflow {
+namespace {
+
+// Suffix of the files that blocks are written to before being renamed into
+// place. They are skipped when listing the cache.
+constexpr char kTempSuffix[] = ".tmp";
+
+// How often the cache directory is rescanned to account for the blocks that
+// other processes added or removed, even if the blocks added by this process
+// keep the size estimate within max_bytes.
+constexpr uint64 kTrimScanIntervalSeconds = 60;
+
+}  // namespace
+
+DiskFileBlockCache::DiskFileBlockCache(const string& cache_dir,
+                                       size_t block_size, size_t max_bytes,
+                                       uint64 max_staleness,
+                                       BlockFetcher block_fetcher, Env* env)
+    : cache_dir_(cache_dir),
+      block_size_(block_size),
+      max_bytes_(max_bytes),
+      max_staleness_(max_staleness),
+      block_fetcher_(std::move(block_fetcher)),
+      env_(env) {
+  if (IsCacheEnabled()) {
+    Status status = env_->RecursivelyCreateDir(cache_dir_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Could not create the block cache directory "
+                   << cache_dir_ << ": " << status;
+    }
+  }
+  VLOG(1) << "GCS disk file block cache in " << cache_dir_ << " is "
+          << (IsCacheEnabled() ? "enabled" : "disabled");
+}
+
+string DiskFileBlockCache::FileDir(const string& filename) const {
+  return io::JoinPath(cache_dir_,
+                      strings::StrCat(strings::Hex(Fingerprint64(filename),
+                                                   strings::kZeroPad16)));
+}
+
+string DiskFileBlockCache::BlockPath(const string& filename, size_t offset) {
+  int64_t signature = 0;
+  {
+    mutex_lock lock(mu_);
+    auto it = file_signature_map_.find(filename);
+    if (it != file_signature_map_.end()) {
+      signature = it->second;
+    }
+  }
+  return io::JoinPath(FileDir(filename),
+                      strings::StrCat(signature, "_", offset));
+}
+
+bool DiskFileBlockCache::ReadCachedBlock(const string& path, size_t pos,
+                                         size_t offset, size_t n, char* buffer,
+                                         size_t* block_data_size) {
+  FileStatistics stat;
+  if (!env_->Stat(path, &stat).ok()) {
+    return false;
+  }
+  const uint64 now = env_->NowSeconds();
+  const uint64 mtime = stat.mtime_nsec / 1000000000;
+  if (max_staleness_ > 0 && now > mtime && now - mtime > max_staleness_) {
+    env_->DeleteFile(path).IgnoreError();
+    return false;
+  }
+  const size_t data_size = stat.length;
+  const size_t begin = std::max(offset, pos);
+  const size_t end = std::min(pos + data_size, offset + n);
+  if (begin < end) {
+    std::unique_ptr<RandomAccessFile> file;
+    if (!env_->NewRandomAccessFile(path, &file).ok()) {
+      return false;
+    }
+    StringPiece result;
+    // The block may have been evicted by another process since the Stat(), in
+    // which case this read fails and the block is fetched again.
+    Status status = file->Read(begin - pos, end - begin, &result, buffer);
+    if (!status.ok() || result.size() != end - begin) {
+      return false;
+    }
+    if (result.data() != buffer) {
+      memcpy(buffer, result.data(), result.size());
+    }
+  }
+  *block_data_size = data_size;
+  return true;
+}
+
+void DiskFileBlockCache::WriteCachedBlock(const string& filename,
+                                          const string& path,
+                                          const std::vector<char>& data) {
+  const string tmp_path = strings::StrCat(
+      path, kTempSuffix, strings::Hex(random::New64(), strings::kZeroPad16));
+  Status status = env_->RecursivelyCreateDir(FileDir(filename));
+  if (status.ok()) {
+    status = WriteStringToFile(env_, tmp_path,
+                               StringPiece(data.data(), data.size()));
+  }
+  if (status.ok()) {
+    // The rename is atomic, so concurrent readers in other processes see
+    // either no block or the whole block.
+    status = env_->RenameFile(tmp_path, path);
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not add a block of " << filename
+                 << " to the block cache: " << status;
+    env_->DeleteFile(tmp_path).IgnoreError();
+    return;
+  }
+  Trim(data.size());
+}
+
+Status DiskFileBlockCache::Read(const string& filename, size_t offset,
+                                size_t n, char* buffer,
+                                size_t* bytes_transferred) {
+  *bytes_transferred = 0;
+  if (n == 0) {
+    return OkStatus();
+  }
+  if (!IsCacheEnabled() || (n > max_bytes_)) {
+    // The cache is effectively disabled, so we pass the read through to the
+    // fetcher without breaking it up into blocks.
+    return block_fetcher_(filename, offset, n, buffer, bytes_transferred);
+  }
+  // Calculate the block-aligned start and end of the read.
+  size_t start = block_size_ * (offset / block_size_);
+  size_t finish = block_size_ * ((offset + n) / block_size_);
+  if (finish < offset + n) {
+    finish += block_size_;
+  }
+  size_t total_bytes_transferred = 0;
+  // Now iterate through the blocks, reading them one at a time.
+  for (size_t pos = start; pos < finish; pos += block_size_) {
+    const string path = BlockPath(filename, pos);
+    char* out = buffer + total_bytes_transferred;
+    size_t data_size;
+    if (ReadCachedBlock(path, pos, offset, n, out, &data_size)) {
+      {
+        mutex_lock lock(mu_);
+        ++hits_;
+      }
+      if (cache_stats_ != nullptr) {
+        cache_stats_->RecordCacheHitBlockSize(data_size);
+      }
+    } else {
+      std::vector<char> data(block_size_);
+      TF_RETURN_IF_ERROR(
+          block_fetcher_(filename, pos, block_size_, data.data(), &data_size));
+      {
+        mutex_lock lock(mu_);
+        ++misses_;
+      }
+      if (cache_stats_ != nullptr) {
+        cache_stats_->RecordCacheMissBlockSize(data_size);
+      }
+      data.resize(data_size);
+      WriteCachedBlock(filename, path, data);
+      const size_t begin = std::max(offset, pos);
+      const size_t end = std::min(pos + data_size, offset + n);
+      if (begin < end) {
+        memcpy(out, data.data() + (begin - pos), end - begin);
+      }
+    }
+    if (offset >= pos + data_size) {
+      // The requested offset is at or beyond the end of the file. This can
+      // happen if `offset` is not block-aligned, and the read returns the last
+      // block in the file, which does not extend all the way out to `offset`.
+      *bytes_transferred = total_bytes_transferred;
+      return errors::OutOfRange("EOF at offset ", offset, " in file ", filename,
+                                " at position ", pos, " with data size ",
+                                data_size);
+    }
+    total_bytes_transferred +=
+        std::min(pos + data_size, offset + n) - std::max(offset, pos);
+    if (data_size < block_size_) {
+      // The block was a partial block and thus signals EOF at its upper bound.
+      break;
+    }
+  }
+  *bytes_transferred = total_bytes_transferred;
+  return OkStatus();
+}
+
+bool DiskFileBlockCache::ValidateAndUpdateFileSignature(
+    const string& filename, int64_t file_signature) {
+  {
+    mutex_lock lock(mu_);
+    auto it = file_signature_map_.find(filename);
+    if (it == file_signature_map_.end()) {
+      file_signature_map_[filename] = file_signature;
+      return true;
+    }
+    if (it->second == file_signature) {
+      return true;
+    }
+    it->second = file_signature;
+  }
+  // Blocks of the old signature are never read again by any process that has
+  // seen the new one, so remove them.
+  RemoveFile(filename);
+  return false;
+}
+
+void DiskFileBlockCache::RemoveFile(const string& filename) {
+  int64_t undeleted_files, undeleted_dirs;
+  env_->DeleteRecursively(FileDir(filename), &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+}
+
+void DiskFileBlockCache::Flush() {
+  std::vector<string> children;
+  if (!env_->GetChildren(cache_dir_, &children).ok()) {
+    return;
+  }
+  for (const string& child : children) {
+    int64_t undeleted_files, undeleted_dirs;
+    env_->DeleteRecursively(io::JoinPath(cache_dir_, child), &undeleted_files,
+                            &undeleted_dirs)
+        .IgnoreError();
+  }
+}
+
+uint64 DiskFileBlockCache::ListBlocks(std::vector<CachedBlock>* blocks) const {
+  uint64 total_size = 0;
+  std::vector<string> file_dirs;
+  if (!env_->GetChildren(cache_dir_, &file_dirs).ok()) {
+    return 0;
+  }
+  for (const string& file_dir : file_dirs) {
+    const string dir = io::JoinPath(cache_dir_, file_dir);
+    std::vector<string> names;
+    if (!env_->GetChildren(dir, &names).ok()) {
+      continue;
+    }
+    for (const string& name : names) {
+      if (name.find(kTempSuffix) != string::npos) {
+        continue;
+      }
+      CachedBlock block;
+      block.path = io::JoinPath(dir, name);
+      FileStatistics stat;
+      if (!env_->Stat(block.path, &stat).ok() || stat.is_directory) {
+        continue;
+      }
+      block.size = stat.length;
+      block.mtime_nsec = stat.mtime_nsec;
+      total_size += block.size;
+      if (blocks != nullptr) {
+        blocks->push_back(std::move(block));
+      }
+    }
+  }
+  return total_size;
+}
+
+size_t DiskFileBlockCache::CacheSize() const { return ListBlocks(nullptr); }
+
+void DiskFileBlockCache::Trim(size_t added_bytes) {
+  mutex_lock lock(trim_mu_);
+  estimated_size_ += added_bytes;
+  const uint64 now = env_->NowSeconds();
+  if (scanned_ && estimated_size_ <= max_bytes_ &&
+      now < last_scan_seconds_ + kTrimScanIntervalSeconds) {
+    return;
+  }
+  std::vector<CachedBlock> blocks;
+  uint64 total_size = ListBlocks(&blocks);
+  scanned_ = true;
+  last_scan_seconds_ = now;
+  estimated_size_ = total_size;
+  if (total_size <= max_bytes_) {
+    return;
+  }
+  // Evict the blocks that were added first, by any process.
+  std::sort(blocks.begin(), blocks.end(),
+            [](const CachedBlock& a, const CachedBlock& b) {
+              return a.mtime_nsec < b.mtime_nsec;
+            });
+  for (const CachedBlock& block : blocks) {
+    if (total_size <= max_bytes_) {
+      break;
+    }
+    // Another process may already have evicted the block.
+    env_->DeleteFile(block.path).IgnoreError();
+    total_size -= block.size;
+  }
+  estimated_size_ = total_size;
+}
+
+uint64 DiskFileBlockCache::hits() const {
+  mutex_lock lock(mu_);
+  return hits_;
+}
+
+uint64 DiskFileBlockCache::misses() const {
+  mutex_lock lock(mu_);
+  return misses_;
+}
+
+}  // namespace tensorflow
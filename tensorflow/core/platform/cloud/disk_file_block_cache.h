@@ -0,0 +1,171 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_PLATFORM_CLOUD_DISK_FILE_BLOCK_CACHE_H_
+#define TENSORFLOW_CORE_PLATFORM_CLOUD_DISK_FILE_BLOCK_CACHE_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+/// \brief A block cache of file contents stored in a local directory.
+///
+/// Every block is a file under `cache_dir`, named after the file it belongs
+/// to, the file signature and the block offset. Pointing all the processes of
+/// a host at the same directory (e.g. on a local SSD) lets them share blocks:
+/// a block fetched by one process is a cache hit for all the others.
+///
+/// Blocks are written to a temporary file and renamed into place, so readers
+/// never see partial blocks. Blocks of a different file signature are never
+/// read, and are removed when a new signature is seen. Once the directory
+/// holds more than `max_bytes`, the oldest blocks are evicted, whichever
+/// process added them. Each process keeps an estimate of the directory size
+/// from the blocks it adds, and only rescans the directory when the estimate
+/// exceeds `max_bytes` or the last scan is a minute old.
+///
+/// Errors accessing the directory are logged and turn into cache misses; they
+/// never fail a read that the fetcher can serve.
+class DiskFileBlockCache : public FileBlockCache {
+ public:
+  DiskFileBlockCache(const string& cache_dir, size_t block_size,
+                     size_t max_bytes, uint64 max_staleness,
+                     BlockFetcher block_fetcher, Env* env = Env::Default());
+
+  /// Read `n` bytes from `filename` starting at `offset` into `out`. This
+  /// method will return:
+  ///
+  /// 1) The error from the remote filesystem, if the read from the remote
+  ///    filesystem failed.
+  /// 2) OUT_OF_RANGE if the read from the remote filesystem succeeded, but
+  ///    the file contents do not extend past `offset` and thus nothing was
+  ///    placed in `out`.
+  /// 3) OK otherwise (i.e. the read succeeded, and at least one byte was placed
+  ///    in `out`).
+  Status Read(const string& filename, size_t offset, size_t n, char* buffer,
+              size_t* bytes_transferred) override;
+
+  // Validate the given file signature with the existing file signature in the
+  // cache. Returns true if the signature doesn't change or the file doesn't
+  // exist before. If the signature changes, update the existing signature with
+  // the new one and remove the file from cache.
+  bool ValidateAndUpdateFileSignature(const string& filename,
+                                      int64_t file_signature) override
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all cached blocks for `filename`, in every process.
+  void RemoveFile(const string& filename) override;
+
+  /// Remove all cached data, in every process.
+  void Flush() override;
+
+  /// Accessors for cache parameters.
+  size_t block_size() const override { return block_size_; }
+  size_t max_bytes() const override { return max_bytes_; }
+  uint64 max_staleness() const override { return max_staleness_; }
+
+  /// The current size (in bytes) of the cache directory.
+  size_t CacheSize() const override;
+
+  // Returns true if the cache is enabled. If false, the BlockFetcher callback
+  // is always executed during Read.
+  bool IsCacheEnabled() const override {
+    return block_size_ > 0 && max_bytes_ > 0;
+  }
+
+  /// The number of blocks this process found in, or had to add to, the cache.
+  uint64 hits() const TF_LOCKS_EXCLUDED(mu_);
+  uint64 misses() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  /// A block file found in the cache directory.
+  struct CachedBlock {
+    string path;
+    uint64 size;
+    int64_t mtime_nsec;
+  };
+
+  /// Returns the directory holding the blocks of `filename`.
+  string FileDir(const string& filename) const;
+
+  /// Returns the path of the block of `filename` at `offset`, for the current
+  /// signature of the file.
+  string BlockPath(const string& filename, size_t offset) TF_LOCKS_EXCLUDED(mu_);
+
+  /// Copies the part of the cached block at `path` that overlaps
+  /// [offset, offset + n) into `buffer`. `pos` is the offset of the block in
+  /// the file. Returns false if the block is missing, stale or unreadable.
+  bool ReadCachedBlock(const string& path, size_t pos, size_t offset, size_t n,
+                       char* buffer, size_t* block_data_size);
+
+  /// Atomically stores `data` as the block at `path`, then trims the cache.
+  void WriteCachedBlock(const string& filename, const string& path,
+                        const std::vector<char>& data);
+
+  /// Lists the block files in the cache directory and returns their total
+  /// size.
+  uint64 ListBlocks(std::vector<CachedBlock>* blocks) const;
+
+  /// Accounts for a new block of `added_bytes` bytes. If the cache may hold
+  /// more than max_bytes_, or it was not scanned recently, rescans it and
+  /// evicts the oldest blocks until it holds at most max_bytes_.
+  void Trim(size_t added_bytes) TF_LOCKS_EXCLUDED(trim_mu_);
+
+  /// The directory shared by all the processes using the cache.
+  const string cache_dir_;
+  /// The size of the blocks stored in the cache, as well as the size of the
+  /// reads from the underlying filesystem.
+  const size_t block_size_;
+  /// The maximum number of bytes (sum of block sizes) allowed in the cache.
+  const size_t max_bytes_;
+  /// The maximum staleness of any block in the cache, in seconds.
+  const uint64 max_staleness_;
+  /// The callback to read a block from the underlying filesystem.
+  const BlockFetcher block_fetcher_;
+  /// The Env used to access the cache directory and read timestamps.
+  Env* const env_;  // not owned
+
+  /// Guards the signature map and the hit counters.
+  mutable mutex mu_;
+
+  // A filename->file_signature map.
+  std::map<string, int64_t> file_signature_map_ TF_GUARDED_BY(mu_);
+
+  uint64 hits_ TF_GUARDED_BY(mu_) = 0;
+  uint64 misses_ TF_GUARDED_BY(mu_) = 0;
+
+  /// Serializes the directory scans of Trim() within this process.
+  mutex trim_mu_;
+
+  /// The size of the cache directory at the last scan, plus the blocks added
+  /// by this process since.
+  uint64 estimated_size_ TF_GUARDED_BY(trim_mu_) = 0;
+  /// Whether the directory was scanned, and when.
+  bool scanned_ TF_GUARDED_BY(trim_mu_) = false;
+  uint64 last_scan_seconds_ TF_GUARDED_BY(trim_mu_) = 0;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PLATFORM_CLOUD_DISK_FILE_BLOCK_CACHE_H_
@@ -0,0 +1,204 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/disk_file_block_cache.h"
+
+#include <cstring>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Status ReadCache(DiskFileBlockCache* cache, const string& filename,
+                 size_t offset, size_t n, std::vector<char>* out) {
+  out->clear();
+  out->resize(n, 0);
+  size_t bytes_transferred = 0;
+  Status status =
+      cache->Read(filename, offset, n, out->data(), &bytes_transferred);
+  EXPECT_LE(bytes_transferred, n);
+  out->resize(bytes_transferred, n);
+  return status;
+}
+
+class FakeEnv : public EnvWrapper {
+ public:
+  FakeEnv() : EnvWrapper(Env::Default()) {}
+
+  uint64 NowSeconds() const override { return now; }
+  uint64 now = 10000;
+};
+
+string CacheDir(const string& name) {
+  const string dir = io::JoinPath(testing::TmpDir(), name);
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  return dir;
+}
+
+// Serves `contents` as the file, counting the calls.
+FileBlockCache::BlockFetcher MakeFetcher(const string& contents, int* calls) {
+  return [contents, calls](const string& filename, size_t offset, size_t n,
+                           char* buffer, size_t* bytes_transferred) {
+    ++*calls;
+    *bytes_transferred = 0;
+    if (offset < contents.size()) {
+      *bytes_transferred = std::min(n, contents.size() - offset);
+      memcpy(buffer, contents.data() + offset, *bytes_transferred);
+    }
+    return OkStatus();
+  };
+}
+
+TEST(DiskFileBlockCacheTest, IsCacheEnabled) {
+  int calls = 0;
+  auto fetcher = MakeFetcher("", &calls);
+  const string dir = CacheDir("is_cache_enabled");
+  DiskFileBlockCache cache1(dir, 0, 0, 0, fetcher);
+  DiskFileBlockCache cache2(dir, 16, 0, 0, fetcher);
+  DiskFileBlockCache cache3(dir, 0, 32, 0, fetcher);
+  DiskFileBlockCache cache4(dir, 16, 32, 0, fetcher);
+
+  EXPECT_FALSE(cache1.IsCacheEnabled());
+  EXPECT_FALSE(cache2.IsCacheEnabled());
+  EXPECT_FALSE(cache3.IsCacheEnabled());
+  EXPECT_TRUE(cache4.IsCacheEnabled());
+}
+
+TEST(DiskFileBlockCacheTest, ReadAcrossBlocks) {
+  int calls = 0;
+  DiskFileBlockCache cache(CacheDir("read_across_blocks"), 4, 64, 0,
+                           MakeFetcher("0123456789", &calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 2, 5, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "23456");
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(cache.misses(), 2);
+
+  // The same range is now served from the cache directory.
+  TF_EXPECT_OK(ReadCache(&cache, "a", 1, 6, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "123456");
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(cache.hits(), 2);
+
+  // The last block is partial and ends the read.
+  TF_EXPECT_OK(ReadCache(&cache, "a", 6, 10, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "6789");
+  EXPECT_EQ(calls, 3);
+
+  // Reading past the end of the file is out of range.
+  EXPECT_TRUE(errors::IsOutOfRange(ReadCache(&cache, "a", 11, 2, &out)));
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(DiskFileBlockCacheTest, SharedBetweenCaches) {
+  // Two caches over the same directory stand in for two processes.
+  const string dir = CacheDir("shared_between_caches");
+  int calls1 = 0;
+  int calls2 = 0;
+  DiskFileBlockCache cache1(dir, 8, 64, 0, MakeFetcher("abcdefgh", &calls1));
+  DiskFileBlockCache cache2(dir, 8, 64, 0, MakeFetcher("abcdefgh", &calls2));
+  EXPECT_TRUE(cache1.ValidateAndUpdateFileSignature("a", 1));
+  EXPECT_TRUE(cache2.ValidateAndUpdateFileSignature("a", 1));
+
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache1, "a", 0, 8, &out));
+  EXPECT_EQ(calls1, 1);
+  TF_EXPECT_OK(ReadCache(&cache2, "a", 0, 8, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "abcdefgh");
+  EXPECT_EQ(calls2, 0);
+  EXPECT_EQ(cache2.hits(), 1);
+  EXPECT_EQ(cache1.CacheSize(), 8);
+
+  // A new signature seen by one cache removes the blocks for both.
+  EXPECT_FALSE(cache2.ValidateAndUpdateFileSignature("a", 2));
+  EXPECT_EQ(cache1.CacheSize(), 0);
+  TF_EXPECT_OK(ReadCache(&cache2, "a", 0, 8, &out));
+  EXPECT_EQ(calls2, 1);
+
+  // Blocks of another signature are never read.
+  TF_EXPECT_OK(ReadCache(&cache1, "a", 0, 8, &out));
+  EXPECT_EQ(calls1, 2);
+}
+
+TEST(DiskFileBlockCacheTest, Trim) {
+  int calls = 0;
+  DiskFileBlockCache cache(CacheDir("trim"), 8, 16, 0,
+                           MakeFetcher(string(64, 'x'), &calls));
+  std::vector<char> out;
+  for (size_t offset = 0; offset < 64; offset += 8) {
+    TF_EXPECT_OK(ReadCache(&cache, "a", offset, 8, &out));
+    EXPECT_LE(cache.CacheSize(), 16);
+  }
+  EXPECT_EQ(calls, 8);
+  EXPECT_EQ(cache.CacheSize(), 16);
+}
+
+TEST(DiskFileBlockCacheTest, TrimRescansWhenFullOrAfterInterval) {
+  FakeEnv env;
+  const string dir = CacheDir("trim_rescans");
+  int calls = 0;
+  DiskFileBlockCache cache(dir, 8, 32, 0, MakeFetcher(string(64, 'x'), &calls),
+                           &env);
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 0, 8, &out));
+
+  // Another process adds a large block. This process does not rescan the
+  // directory while the blocks it adds fit.
+  const string other_dir = io::JoinPath(dir, "other");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(other_dir));
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(),
+                                 io::JoinPath(other_dir, "0_0"),
+                                 string(64, 'y')));
+  TF_EXPECT_OK(ReadCache(&cache, "a", 8, 8, &out));
+  EXPECT_EQ(cache.CacheSize(), 80);
+
+  // It does once the last scan is old enough.
+  env.now += 60;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 16, 8, &out));
+  EXPECT_LE(cache.CacheSize(), 32);
+
+  // Or once its own blocks exceed the limit.
+  for (size_t offset = 24; offset < 64; offset += 8) {
+    TF_EXPECT_OK(ReadCache(&cache, "a", offset, 8, &out));
+    EXPECT_LE(cache.CacheSize(), 32);
+  }
+  EXPECT_EQ(calls, 8);
+}
+
+TEST(DiskFileBlockCacheTest, RemoveFileAndFlush) {
+  int calls = 0;
+  DiskFileBlockCache cache(CacheDir("remove_file_and_flush"), 8, 64, 0,
+                           MakeFetcher("abcdefgh", &calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 0, 8, &out));
+  TF_EXPECT_OK(ReadCache(&cache, "b", 0, 8, &out));
+  EXPECT_EQ(cache.CacheSize(), 16);
+  cache.RemoveFile("a");
+  EXPECT_EQ(cache.CacheSize(), 8);
+  cache.Flush();
+  EXPECT_EQ(cache.CacheSize(), 0);
+  TF_EXPECT_OK(ReadCache(&cache, "b", 0, 8, &out));
+  EXPECT_EQ(calls, 3);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -22,6 +22,7 @@ limitations under the License.
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <string>
@@ -37,6 +38,7 @@ limitations under the License.
 #include "json/json.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/platform/cloud/curl_http_request.h"
+#include "tensorflow/core/platform/cloud/disk_file_block_cache.h"
 #include "tensorflow/core/platform/cloud/file_block_cache.h"
 #include "tensorflow/core/platform/cloud/google_auth_provider.h"
 #include "tensorflow/core/platform/cloud/ram_file_block_cache.h"
@@ -69,6 +71,16 @@ constexpr char kStorageHost[] = "storage.googleapis.com";
 constexpr char kBucketMetadataLocationKey[] = "location";
 constexpr size_t kReadAppendableFileBufferSize = 1024 * 1024;  // In bytes.
 constexpr int kGetChildrenDefaultPageSize = 1000;
+// Number of threads shared by the prefetch requests and part uploads of a
+// GcsFileSystem.
+constexpr int kTransferThreads = 16;
+// The maximum number of source objects of a single compose request.
+constexpr size_t kMaxComposeSources = 32;
+// The maximum number of components of a composite object.
+constexpr int64_t kMaxComposeComponents = 1024;
+// The number of parts of a composite upload after which the part size doubles,
+// so that large files stay within kMaxComposeComponents.
+constexpr int64_t kPartsPerPartSizeDoubling = 128;
 // The HTTP response code "308 Resume Incomplete".
 constexpr uint64 HTTP_CODE_RESUME_INCOMPLETE = 308;
 // The HTTP response code "412 Precondition Failed".
@@ -390,6 +402,179 @@ class BufferedGcsRandomAccessFile : public RandomAccessFile {
   mutable string buffer_ TF_GUARDED_BY(buffer_mutex_);
 };
 
+/// A GCS-based implementation of a random access file that prefetches ranges.
+///
+/// Every read is served from fixed-size range requests, so adjacent small reads
+/// are coalesced into a single request. Once the reader has been sequential for
+/// a few reads, further requests are issued ahead of it on `pool` so that the
+/// next ranges are already in flight when the reader reaches them.
+class PrefetchingGcsRandomAccessFile : public RandomAccessFile {
+ public:
+  using ReadFn =
+      std::function<Status(const string& filename, uint64 offset, size_t n,
+                           StringPiece* result, char* scratch)>;
+
+  // Initialize the reader. Provided read_fn should be thread safe.
+  PrefetchingGcsRandomAccessFile(const string& filename, uint64 request_size,
+                                 int max_outstanding_requests,
+                                 int sequential_reads, thread::ThreadPool* pool,
+                                 ReadFn read_fn)
+      : filename_(filename),
+        read_fn_(std::move(read_fn)),
+        request_size_(request_size),
+        max_outstanding_requests_(max_outstanding_requests),
+        sequential_reads_threshold_(sequential_reads),
+        pool_(pool),
+        state_(std::make_shared<State>()) {}
+
+  Status Name(StringPiece* result) const override {
+    *result = filename_;
+    return OkStatus();
+  }
+
+  /// The implementation of reads with prefetched ranges. Thread safe.
+  /// Returns `OUT_OF_RANGE` if fewer than n bytes were stored in `*result`
+  /// because of EOF.
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    mutex_lock l(state_->mu);
+    if (offset == state_->next_offset) {
+      ++state_->sequential_reads;
+    } else {
+      state_->sequential_reads = 0;
+    }
+    size_t copy_size = 0;
+    while (copy_size < n) {
+      const uint64 position = offset + copy_size;
+      // Drop the ranges that the reader has moved past, and everything if it
+      // jumped outside of the ranges in flight.
+      auto& ranges = state_->ranges;
+      while (!ranges.empty() &&
+             ranges.front()->offset + request_size_ <= position) {
+        ranges.pop_front();
+      }
+      if (!ranges.empty() && ranges.front()->offset > position) {
+        ranges.clear();
+      }
+      if (ranges.empty()) {
+        if (position >= state_->eof_offset) break;
+        StartRequest(position);
+      }
+      std::shared_ptr<Range> range = ranges.front();
+      while (!range->done) {
+        state_->cv.wait(l);
+      }
+      if (!range->status.ok() && !errors::IsOutOfRange(range->status)) {
+        // Forget all ranges to avoid caching bad reads.
+        Status status = range->status;
+        ranges.clear();
+        state_->next_offset = kUnknownOffset;
+        return status;
+      }
+      const uint64 range_end = range->offset + range->data.size();
+      if (position >= range_end) break;
+      const size_t size =
+          std::min(n - copy_size, static_cast<size_t>(range_end - position));
+      memcpy(scratch + copy_size,
+             range->data.data() + (position - range->offset), size);
+      copy_size += size;
+    }
+    *result = StringPiece(scratch, copy_size);
+    state_->next_offset = offset + copy_size;
+    if (copy_size < n) {
+      // Forget the ranges and end-of-file offset to allow for clients that poll
+      // on the same file.
+      state_->ranges.clear();
+      state_->eof_offset = kUnknownOffset;
+      return errors::OutOfRange("EOF reached. Requested to read ", n,
+                                " bytes from ", offset, ".");
+    }
+    if (state_->sequential_reads >= sequential_reads_threshold_) {
+      Prefetch();
+    }
+    return OkStatus();
+  }
+
+ private:
+  static constexpr uint64 kUnknownOffset = std::numeric_limits<uint64>::max();
+
+  // One range request of `request_size_` bytes starting at `offset`.
+  struct Range {
+    uint64 offset;
+    bool done = false;
+    Status status;
+    string data;
+  };
+
+  // The mutable state of the file. It is shared with the pending requests so
+  // that they can complete after the file itself has been closed.
+  struct State {
+    mutex mu;
+    condition_variable cv;
+    std::deque<std::shared_ptr<Range>> ranges TF_GUARDED_BY(mu);
+    uint64 next_offset TF_GUARDED_BY(mu) = 0;
+    int sequential_reads TF_GUARDED_BY(mu) = 0;
+    uint64 eof_offset TF_GUARDED_BY(mu) = kUnknownOffset;
+  };
+
+  // Issues requests for the ranges following the last one in flight, until
+  // `max_outstanding_requests_` of them are past the one being read.
+  void Prefetch() const TF_EXCLUSIVE_LOCKS_REQUIRED(state_->mu) {
+    auto& ranges = state_->ranges;
+    while (!ranges.empty() &&
+           ranges.size() <= static_cast<size_t>(max_outstanding_requests_)) {
+      const uint64 next = ranges.back()->offset + request_size_;
+      if (next >= state_->eof_offset) break;
+      StartRequest(next);
+    }
+  }
+
+  // Appends a range starting at `offset` and schedules its request.
+  void StartRequest(uint64 offset) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(state_->mu) {
+    auto range = std::make_shared<Range>();
+    range->offset = offset;
+    state_->ranges.push_back(range);
+    pool_->Schedule([state = state_, range, filename = filename_,
+                     read_fn = read_fn_, request_size = request_size_]() {
+      string data(request_size, '\0');
+      StringPiece str_piece;
+      Status status =
+          read_fn(filename, range->offset, request_size, &str_piece, &data[0]);
+      data.resize(str_piece.size());
+      mutex_lock l(state->mu);
+      if (errors::IsOutOfRange(status)) {
+        state->eof_offset =
+            std::min(state->eof_offset, range->offset + data.size());
+      }
+      range->data = std::move(data);
+      range->status = status;
+      range->done = true;
+      state->cv.notify_all();
+    });
+  }
+
+  // The filename of this file.
+  const string filename_;
+
+  // The implementation of the read operation (provided by the GCSFileSystem).
+  const ReadFn read_fn_;
+
+  // Size of each range request that we send to GCS.
+  const uint64 request_size_;
+
+  // Number of range requests kept in flight ahead of the reader.
+  const int max_outstanding_requests_;
+
+  // Consecutive sequential reads needed before prefetching starts.
+  const int sequential_reads_threshold_;
+
+  // Runs the range requests. Not owned.
+  thread::ThreadPool* const pool_;
+
+  const std::shared_ptr<State> state_;
+};
+
 // Function object declaration with params needed to create upload sessions.
 typedef std::function<Status(
     uint64 start_offset, const std::string& object_to_upload,
@@ -737,6 +922,398 @@ class GcsWritableFile : public WritableFile {
   const GenerationGetter generation_getter_;
 };
 
+// Function object declaration with params needed to get the current generation
+// and size of an object.
+typedef std::function<Status(int64_t* generation, int64_t* size)>
+    ObjectVersionGetter;
+
+/// \brief GCS-based implementation of a writable file using composite uploads.
+///
+/// Appended data is buffered in memory and uploaded in parts as temporary
+/// objects while the file is still being written, with a bounded number of
+/// parts in flight. Sync() and Close() compose the parts into the target object
+/// using the GCS compose API, so no local temporary file is needed.
+///
+/// Since a composite object has at most kMaxComposeComponents components, the
+/// part size doubles every kPartsPerPartSizeDoubling parts.
+class CompositeGcsWritableFile : public WritableFile {
+ public:
+  CompositeGcsWritableFile(const string& bucket, const string& object,
+                           GcsFileSystem* filesystem,
+                           GcsFileSystem::TimeoutConfig* timeouts,
+                           std::function<void()> file_cache_erase,
+                           RetryConfig retry_config, size_t part_size,
+                           int max_parts_in_flight, thread::ThreadPool* pool,
+                           ObjectVersionGetter version_getter)
+      : bucket_(bucket),
+        object_(object),
+        filesystem_(filesystem),
+        timeouts_(timeouts),
+        file_cache_erase_(std::move(file_cache_erase)),
+        retry_config_(retry_config),
+        version_getter_(std::move(version_getter)),
+        part_size_(part_size),
+        max_parts_in_flight_(std::max(max_parts_in_flight, 1)),
+        pool_(pool),
+        state_(std::make_shared<State>()) {
+    VLOG(3) << "CompositeGcsWritableFile: " << GetGcsPath();
+  }
+
+  ~CompositeGcsWritableFile() override {
+    Close().IgnoreError();
+    // Parts still uploading refer to the state, not to this file, but wait for
+    // them so that no upload outlives the file.
+    mutex_lock l(state_->mu);
+    while (state_->parts_in_flight > 0) {
+      state_->cv.wait(l);
+    }
+  }
+
+  Status Append(StringPiece data) override {
+    TF_RETURN_IF_ERROR(CheckWritable());
+    VLOG(3) << "Append: " << GetGcsPath() << " size " << data.length();
+    sync_needed_ = true;
+    while (!data.empty()) {
+      const size_t size = std::min(part_size_ - buffer_.size(), data.size());
+      buffer_.append(data.data(), size);
+      data.remove_prefix(size);
+      position_ += size;
+      if (buffer_.size() == part_size_) {
+        StartPart();
+      }
+    }
+    return OkStatus();
+  }
+
+  Status Close() override {
+    VLOG(3) << "Close:" << GetGcsPath();
+    if (closed_) {
+      return OkStatus();
+    }
+    Status sync_status = Sync();
+    if (sync_status.ok()) {
+      closed_ = true;
+    }
+    return sync_status;
+  }
+
+  Status Flush() override {
+    VLOG(3) << "Flush:" << GetGcsPath();
+    return Sync();
+  }
+
+  Status Name(StringPiece* result) const override {
+    return errors::Unimplemented(
+        "CompositeGcsWritableFile does not support Name()");
+  }
+
+  Status Sync() override {
+    VLOG(3) << "Sync started:" << GetGcsPath();
+    TF_RETURN_IF_ERROR(CheckWritable());
+    if (!sync_needed_) {
+      return OkStatus();
+    }
+    Status status = SyncImpl();
+    VLOG(3) << "Sync finished " << GetGcsPath();
+    if (status.ok()) {
+      sync_needed_ = false;
+    }
+    return status;
+  }
+
+  Status Tell(int64_t* position) override {
+    *position = position_;
+    return OkStatus();
+  }
+
+ private:
+  // One part of the file, uploaded as a temporary object.
+  struct Part {
+    string object;
+    uint64 size = 0;
+    // The contents of the part. Released once the upload succeeded.
+    string data;
+    bool done = false;
+    Status status;
+  };
+
+  // The state shared with the part uploads running on the pool.
+  struct State {
+    mutex mu;
+    condition_variable cv;
+    int parts_in_flight TF_GUARDED_BY(mu) = 0;
+  };
+
+  /// Uploads the buffered data, waits for all the parts and composes them
+  /// into the target object.
+  ///
+  /// Parts that failed to upload are uploaded again, so that Sync() can be
+  /// retried by RetryingFileSystem.
+  Status SyncImpl() {
+    if (!buffer_.empty()) {
+      StartPart();
+    }
+    {
+      mutex_lock l(state_->mu);
+      for (const auto& part : parts_) {
+        while (!part->done) {
+          state_->cv.wait(l);
+        }
+      }
+    }
+    Status status;
+    for (const auto& part : parts_) {
+      if (!part->status.ok()) {
+        status.Update(part->status);
+        part->done = false;
+        ScheduleUpload(part);
+      }
+    }
+    if (!status.ok()) {
+      return errors::Unavailable(strings::StrCat(
+          "Upload to ", GetGcsPath(),
+          " failed, caused by: ", status.error_message()));
+    }
+    if (parts_.empty() && !object_exists_) {
+      // Nothing was appended, create an empty object.
+      TF_RETURN_IF_ERROR(RetryingUtils::CallWithRetries(
+          [this]() {
+            return UploadObject(filesystem_, bucket_, object_, "",
+                                &generation_);
+          },
+          retry_config_));
+      object_exists_ = true;
+      num_components_ = 1;
+    }
+    while (!parts_.empty()) {
+      // Compose into the object what has been composed so far, followed by as
+      // many parts as a single compose request allows.
+      std::vector<string> sources;
+      if (object_exists_) {
+        sources.push_back(object_);
+      }
+      const size_t num_parts =
+          std::min(parts_.size(), kMaxComposeSources - sources.size());
+      const int64_t num_components =
+          (object_exists_ ? num_components_ : 0) + num_parts;
+      if (num_components > kMaxComposeComponents) {
+        return errors::ResourceExhausted(
+            "Composing ", GetGcsPath(), " would exceed ",
+            kMaxComposeComponents,
+            " components. Sync less often or increase the part size.");
+      }
+      uint64 size = committed_size_;
+      for (size_t i = 0; i < num_parts; ++i) {
+        sources.push_back(parts_[i]->object);
+        size += parts_[i]->size;
+      }
+      TF_RETURN_IF_ERROR(ComposeObject(sources, size));
+      object_exists_ = true;
+      num_components_ = num_components;
+      committed_size_ = size;
+      // Forget the composed parts before deleting them, so that a failed delete
+      // does not get them composed again by a retried Sync().
+      std::vector<std::shared_ptr<Part>> composed(
+          parts_.begin(), parts_.begin() + num_parts);
+      parts_.erase(parts_.begin(), parts_.begin() + num_parts);
+      for (const auto& part : composed) {
+        const string part_path = GetGcsPathWithObject(part->object);
+        Status status = RetryingUtils::DeleteWithRetries(
+            [&part_path, this]() {
+              return filesystem_->DeleteFile(part_path, nullptr);
+            },
+            retry_config_);
+        if (!status.ok()) {
+          LOG(WARNING) << "Failed to delete the composed part " << part_path
+                       << ": " << status;
+        }
+      }
+    }
+    // Erase the file from the file cache on every successful write.
+    file_cache_erase_();
+    return OkStatus();
+  }
+
+  /// Moves the buffered data into a new part and schedules its upload,
+  /// waiting first if too many parts are already in flight.
+  void StartPart() {
+    auto part = std::make_shared<Part>();
+    part->object = strings::StrCat(io::Dirname(object_), "/.tmpcompose/",
+                                   io::Basename(object_), ".",
+                                   position_ - buffer_.size());
+    part->size = buffer_.size();
+    part->data.swap(buffer_);
+    if (++num_parts_started_ % kPartsPerPartSizeDoubling == 0) {
+      part_size_ *= 2;
+    }
+    {
+      mutex_lock l(state_->mu);
+      while (state_->parts_in_flight >= max_parts_in_flight_) {
+        state_->cv.wait(l);
+      }
+    }
+    parts_.push_back(part);
+    ScheduleUpload(part);
+  }
+
+  void ScheduleUpload(std::shared_ptr<Part> part) {
+    {
+      mutex_lock l(state_->mu);
+      ++state_->parts_in_flight;
+    }
+    pool_->Schedule([state = state_, part, filesystem = filesystem_,
+                     bucket = bucket_, retry_config = retry_config_]() {
+      Status status = RetryingUtils::CallWithRetries(
+          [&]() {
+            return UploadObject(filesystem, bucket, part->object, part->data,
+                                /*generation=*/nullptr);
+          },
+          retry_config);
+      mutex_lock l(state->mu);
+      if (status.ok()) {
+        string().swap(part->data);
+      }
+      part->status = status;
+      part->done = true;
+      --state->parts_in_flight;
+      state->cv.notify_all();
+    });
+  }
+
+  /// Uploads `data` as the whole contents of `object` in a single request, and
+  /// returns the generation of the new object in `generation` if not null.
+  static Status UploadObject(GcsFileSystem* filesystem, const string& bucket,
+                             const string& object, const string& data,
+                             int64_t* generation) {
+    std::vector<char> output_buffer;
+    std::unique_ptr<HttpRequest> request;
+    TF_RETURN_IF_ERROR(filesystem->CreateHttpRequest(&request));
+    request->SetUri(strings::StrCat(kGcsUploadUriBase, "b/", bucket,
+                                    "/o?uploadType=media&name=",
+                                    request->EscapeString(object)));
+    const GcsFileSystem::TimeoutConfig timeouts = filesystem->timeouts();
+    request->SetTimeouts(timeouts.connect, timeouts.idle, timeouts.write);
+    if (data.empty()) {
+      request->SetPostEmptyBody();
+    } else {
+      request->SetPostFromBuffer(data.data(), data.size());
+    }
+    request->SetResultBuffer(&output_buffer);
+    TF_RETURN_WITH_CONTEXT_IF_ERROR(request->Send(), " when uploading gs://",
+                                    bucket, "/", object);
+    if (generation == nullptr) {
+      return OkStatus();
+    }
+    Json::Value root;
+    TF_RETURN_IF_ERROR(ParseJson(output_buffer, &root));
+    return GetInt64Value(root, "generation", generation);
+  }
+
+  /// Replaces the target object with the concatenation of `sources`, whose
+  /// total size is `size`.
+  ///
+  /// Once the target object exists it is composed only if its generation is
+  /// still the one this file wrote last, since composing it again after a lost
+  /// response would duplicate the parts.
+  Status ComposeObject(const std::vector<string>& sources, uint64 size) {
+    VLOG(3) << "ComposeObject: " << sources.size() << " objects to "
+            << GetGcsPath();
+    const bool precondition = object_exists_;
+    Status status = RetryingUtils::CallWithRetries(
+        [&sources, precondition, this]() {
+          std::vector<char> output_buffer;
+          std::unique_ptr<HttpRequest> request;
+          TF_RETURN_IF_ERROR(filesystem_->CreateHttpRequest(&request));
+
+          string uri = strings::StrCat(kGcsUriBase, "b/", bucket_, "/o/",
+                                       request->EscapeString(object_),
+                                       "/compose");
+          if (precondition) {
+            strings::StrAppend(&uri, "?ifGenerationMatch=", generation_);
+          }
+          request->SetUri(uri);
+
+          string request_body = "{'sourceObjects': [";
+          for (size_t i = 0; i < sources.size(); ++i) {
+            strings::StrAppend(&request_body, i > 0 ? "," : "", "{'name': '",
+                               sources[i], "'}");
+          }
+          strings::StrAppend(&request_body, "]}");
+          request->SetTimeouts(timeouts_->connect, timeouts_->idle,
+                               timeouts_->metadata);
+          request->AddHeader("content-type", "application/json");
+          request->SetPostFromBuffer(request_body.c_str(), request_body.size());
+          request->SetResultBuffer(&output_buffer);
+          TF_RETURN_WITH_CONTEXT_IF_ERROR(request->Send(),
+                                          " when composing to ", GetGcsPath());
+          Json::Value root;
+          TF_RETURN_IF_ERROR(ParseJson(output_buffer, &root));
+          return GetInt64Value(root, "generation", &generation_);
+        },
+        retry_config_);
+    if (!precondition || !errors::IsFailedPrecondition(status)) {
+      return status;
+    }
+    // A retried request fails the precondition if an earlier attempt composed
+    // the object but its response was lost. The object then has a new
+    // generation and the expected size.
+    int64_t generation = 0;
+    int64_t current_size = 0;
+    TF_RETURN_IF_ERROR(version_getter_(&generation, &current_size));
+    if (generation == generation_ ||
+        current_size != static_cast<int64_t>(size)) {
+      return errors::FailedPrecondition(
+          "The object ", GetGcsPath(),
+          " was modified concurrently with a composite upload: ",
+          status.error_message());
+    }
+    generation_ = generation;
+    return OkStatus();
+  }
+
+  Status CheckWritable() const {
+    if (closed_) {
+      return errors::FailedPrecondition("The file ", GetGcsPath(),
+                                        " is closed.");
+    }
+    return OkStatus();
+  }
+
+  string GetGcsPathWithObject(string object) const {
+    return strings::StrCat("gs://", bucket_, "/", object);
+  }
+  string GetGcsPath() const { return GetGcsPathWithObject(object_); }
+
+  string bucket_;
+  string object_;
+  GcsFileSystem* const filesystem_;  // Not owned.
+  GcsFileSystem::TimeoutConfig* timeouts_;
+  std::function<void()> file_cache_erase_;
+  RetryConfig retry_config_;
+  const ObjectVersionGetter version_getter_;
+  // The size of the next part.
+  size_t part_size_;
+  const int max_parts_in_flight_;
+  thread::ThreadPool* const pool_;  // Not owned.
+  const std::shared_ptr<State> state_;
+  // The parts uploaded or uploading since the last successful Sync().
+  std::vector<std::shared_ptr<Part>> parts_;
+  // Data appended since the last part was started.
+  string buffer_;
+  // The number of bytes appended so far.
+  uint64 position_ = 0;
+  bool sync_needed_ = true;  // whether there is data that needs to be synced
+  bool object_exists_ = false;  // whether Sync() has created the object
+  // The generation, number of components and size of the object as of the
+  // last compose.
+  int64_t generation_ = 0;
+  int64_t num_components_ = 0;
+  uint64 committed_size_ = 0;
+  // The number of parts started since the file was created.
+  int64_t num_parts_started_ = 0;
+  bool closed_ = false;
+};
+
 class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
  public:
   GcsReadOnlyMemoryRegion(std::unique_ptr<char[]> data, uint64 length)
@@ -806,9 +1383,36 @@ GcsFileSystem::GcsFileSystem(bool make_default_cache) {
   if (!make_default_cache) {
     max_bytes = 0;
   }
+
+  StringPiece cache_dir;
+  if (GetEnvVar(kCacheDir, StringPieceIdentity, &cache_dir)) {
+    cache_dir_ = string(cache_dir);
+  }
+
+  // Apply the overrides for prefetching sequentially read files if provided.
+  int64_t prefetch_value;
+  if (GetEnvVar(kPrefetchMaxRequests, strings::safe_strto64,
+                &prefetch_value)) {
+    prefetch_options_.max_outstanding_requests = prefetch_value;
+  }
+  if (GetEnvVar(kPrefetchSequentialReads, strings::safe_strto64,
+                &prefetch_value)) {
+    prefetch_options_.sequential_reads = prefetch_value;
+  }
+
+  // Apply the overrides for composite uploads if provided.
+  if (GetEnvVar(kCompositeUploadPartSize, strings::safe_strtou64, &value)) {
+    composite_upload_options_.part_size = value * 1024 * 1024;
+  }
+  int64_t parts_in_flight;
+  if (GetEnvVar(kCompositeUploadMaxPartsInFlight, strings::safe_strto64,
+                &parts_in_flight)) {
+    composite_upload_options_.max_parts_in_flight = parts_in_flight;
+  }
   VLOG(1) << "GCS cache max size = " << max_bytes << " ; "
           << "block size = " << block_size_ << " ; "
-          << "max staleness = " << max_staleness;
+          << "max staleness = " << max_staleness << " ; "
+          << "directory = " << cache_dir_;
   file_block_cache_ = MakeFileBlockCache(block_size_, max_bytes, max_staleness);
   // Apply overrides for the stat cache max age and max entries, if provided.
   uint64 stat_cache_max_age = kStatCacheDefaultMaxAge;
@@ -961,6 +1565,14 @@ GcsFileSystem::GcsFileSystem(
 Status GcsFileSystem::NewRandomAccessFile(
     const string& fname, TransactionToken* token,
     std::unique_ptr<RandomAccessFile>* result) {
+  return NewRandomAccessFileWithOptions(fname, token, prefetch_options_,
+                                        result);
+}
+
+Status GcsFileSystem::NewRandomAccessFileWithOptions(
+    const string& fname, TransactionToken* token,
+    const PrefetchOptions& prefetch_options,
+    std::unique_ptr<RandomAccessFile>* result) {
   string bucket, object;
   TF_RETURN_IF_ERROR(ParseGcsPath(fname, false, &bucket, &object));
   TF_RETURN_IF_ERROR(CheckBucketLocationConstraint(bucket));
@@ -996,26 +1608,46 @@ Status GcsFileSystem::NewRandomAccessFile(
       return OkStatus();
     }));
   } else {
-    result->reset(new BufferedGcsRandomAccessFile(
-        fname, block_size_,
-        [this, bucket, object](const string& fname, uint64 offset, size_t n,
-                               StringPiece* result, char* scratch) {
-          *result = StringPiece();
-          size_t bytes_transferred;
-          TF_RETURN_IF_ERROR(
-              LoadBufferFromGCS(fname, offset, n, scratch, &bytes_transferred));
-          *result = StringPiece(scratch, bytes_transferred);
-          if (bytes_transferred < n) {
-            return errors::OutOfRange("EOF reached, ", result->size(),
-                                      " bytes were read out of ", n,
-                                      " bytes requested.");
-          }
-          return OkStatus();
-        }));
+    auto read_fn = [this, bucket, object](const string& fname, uint64 offset,
+                                          size_t n, StringPiece* result,
+                                          char* scratch) {
+      *result = StringPiece();
+      size_t bytes_transferred;
+      TF_RETURN_IF_ERROR(
+          LoadBufferFromGCS(fname, offset, n, scratch, &bytes_transferred));
+      *result = StringPiece(scratch, bytes_transferred);
+      if (bytes_transferred < n) {
+        return errors::OutOfRange("EOF reached, ", result->size(),
+                                  " bytes were read out of ", n,
+                                  " bytes requested.");
+      }
+      return OkStatus();
+    };
+    const uint64 request_size = prefetch_options.request_size > 0
+                                    ? prefetch_options.request_size
+                                    : block_size_;
+    if (prefetch_options.max_outstanding_requests > 0 && request_size > 0) {
+      result->reset(new PrefetchingGcsRandomAccessFile(
+          fname, request_size, prefetch_options.max_outstanding_requests,
+          prefetch_options.sequential_reads, TransferPool(),
+          std::move(read_fn)));
+    } else {
+      result->reset(
+          new BufferedGcsRandomAccessFile(fname, block_size_, read_fn));
+    }
   }
   return OkStatus();
 }
 
+thread::ThreadPool* GcsFileSystem::TransferPool() {
+  mutex_lock l(transfer_pool_mu_);
+  if (transfer_pool_ == nullptr) {
+    transfer_pool_ = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "gcs_transfer", kTransferThreads);
+  }
+  return transfer_pool_.get();
+}
+
 void GcsFileSystem::ResetFileBlockCache(size_t block_size_bytes,
                                         size_t max_bytes,
                                         uint64 max_staleness_secs) {
@@ -1030,13 +1662,18 @@ void GcsFileSystem::ResetFileBlockCache(size_t block_size_bytes,
 // A helper function to build a FileBlockCache for GcsFileSystem.
 std::unique_ptr<FileBlockCache> GcsFileSystem::MakeFileBlockCache(
     size_t block_size, size_t max_bytes, uint64 max_staleness) {
-  std::unique_ptr<FileBlockCache> file_block_cache(new RamFileBlockCache(
-      block_size, max_bytes, max_staleness,
-      [this](const string& filename, size_t offset, size_t n, char* buffer,
-             size_t* bytes_transferred) {
-        return LoadBufferFromGCS(filename, offset, n, buffer,
-                                 bytes_transferred);
-      }));
+  auto block_fetcher = [this](const string& filename, size_t offset, size_t n,
+                              char* buffer, size_t* bytes_transferred) {
+    return LoadBufferFromGCS(filename, offset, n, buffer, bytes_transferred);
+  };
+  std::unique_ptr<FileBlockCache> file_block_cache;
+  if (!cache_dir_.empty()) {
+    file_block_cache.reset(new DiskFileBlockCache(
+        cache_dir_, block_size, max_bytes, max_staleness, block_fetcher));
+  } else {
+    file_block_cache.reset(new RamFileBlockCache(block_size, max_bytes,
+                                                 max_staleness, block_fetcher));
+  }
 
   // Check if cache is enabled here to avoid unnecessary mutex contention.
   cache_enabled_ = file_block_cache->IsCacheEnabled();
@@ -1263,9 +1900,39 @@ void GcsFileSystem::ClearFileCaches(const string& fname) {
 Status GcsFileSystem::NewWritableFile(const string& fname,
                                       TransactionToken* token,
                                       std::unique_ptr<WritableFile>* result) {
+  return NewWritableFileWithOptions(fname, token, composite_upload_options_,
+                                    result);
+}
+
+Status GcsFileSystem::NewWritableFileWithOptions(
+    const string& fname, TransactionToken* token,
+    const CompositeUploadOptions& composite_upload_options,
+    std::unique_ptr<WritableFile>* result) {
   string bucket, object;
   TF_RETURN_IF_ERROR(ParseGcsPath(fname, false, &bucket, &object));
 
+  if (composite_upload_options.part_size > 0) {
+    auto version_getter = [this, fname, bucket, object](int64_t* generation,
+                                                        int64_t* size) {
+      GcsFileStat stat;
+      TF_RETURN_IF_ERROR(RetryingUtils::CallWithRetries(
+          [&fname, &bucket, &object, &stat, this]() {
+            return UncachedStatForObject(fname, bucket, object, &stat);
+          },
+          retry_config_));
+      *generation = stat.generation_number;
+      *size = stat.base.length;
+      return OkStatus();
+    };
+    result->reset(new CompositeGcsWritableFile(
+        bucket, object, this, &timeouts_,
+        [this, fname]() { ClearFileCaches(fname); }, retry_config_,
+        composite_upload_options.part_size,
+        composite_upload_options.max_parts_in_flight, TransferPool(),
+        version_getter));
+    return OkStatus();
+  }
+
   auto session_creator =
       [this](uint64 start_offset, const std::string& object_to_upload,
              const std::string& bucket, uint64 file_size,
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/retrying_file_system.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 
@@ -62,6 +63,27 @@ constexpr size_t kDefaultMaxCacheSize = 0;
 // will be evicted on the next read.
 constexpr char kMaxStaleness[] = "GCS_READ_CACHE_MAX_STALENESS";
 constexpr uint64 kDefaultMaxStaleness = 0;
+// The environment variable that makes the block cache store blocks in a local
+// directory instead of in memory. All the processes of a host that use the
+// same directory share the cached blocks.
+constexpr char kCacheDir[] = "GCS_READ_CACHE_DIR";
+// The environment variable that sets how many range requests a sequentially
+// read file keeps outstanding ahead of the reader. A value of 0 (the default)
+// disables prefetching. Only used when the block cache is disabled.
+constexpr char kPrefetchMaxRequests[] = "GCS_PREFETCH_MAX_REQUESTS";
+// The environment variable that sets the number of consecutive sequential reads
+// after which a file starts prefetching.
+constexpr char kPrefetchSequentialReads[] = "GCS_PREFETCH_SEQUENTIAL_READS";
+constexpr int kDefaultPrefetchSequentialReads = 2;
+// The environment variable that sets the part size, in MB, of composite
+// uploads. A value of 0 (the default) uploads each file from a local temporary
+// file instead.
+constexpr char kCompositeUploadPartSize[] = "GCS_COMPOSITE_UPLOAD_PART_SIZE_MB";
+// The environment variable that sets how many parts of a composite upload can
+// be in flight at once.
+constexpr char kCompositeUploadMaxPartsInFlight[] =
+    "GCS_COMPOSITE_UPLOAD_MAX_PARTS_IN_FLIGHT";
+constexpr int kDefaultCompositeUploadMaxPartsInFlight = 4;
 
 // Helper function to extract an environment variable and convert it into a
 // value of type T.
@@ -125,6 +147,8 @@ struct UploadSessionHandle {
 class GcsFileSystem : public FileSystem {
  public:
   struct TimeoutConfig;
+  struct PrefetchOptions;
+  struct CompositeUploadOptions;
 
   // Main constructor used (via RetryingFileSystem) throughout Tensorflow
   explicit GcsFileSystem(bool make_default_cache = true);
@@ -148,9 +172,27 @@ class GcsFileSystem : public FileSystem {
       const string& fname, TransactionToken* token,
       std::unique_ptr<RandomAccessFile>* result) override;
 
+  /// \brief Creates a random access file with explicit prefetch options.
+  ///
+  /// NewRandomAccessFile() uses the options configured through the
+  /// environment; this lets callers that know their access pattern tune a
+  /// single file instead. Prefetching is ignored when the block cache is on.
+  Status NewRandomAccessFileWithOptions(
+      const string& fname, TransactionToken* token,
+      const PrefetchOptions& prefetch_options,
+      std::unique_ptr<RandomAccessFile>* result);
+
   Status NewWritableFile(const string& fname, TransactionToken* token,
                          std::unique_ptr<WritableFile>* result) override;
 
+  /// \brief Creates a writable file with explicit composite upload options.
+  ///
+  /// NewWritableFile() uses the options configured through the environment.
+  Status NewWritableFileWithOptions(
+      const string& fname, TransactionToken* token,
+      const CompositeUploadOptions& composite_upload_options,
+      std::unique_ptr<WritableFile>* result);
+
   Status NewAppendableFile(const string& fname, TransactionToken* token,
                            std::unique_ptr<WritableFile>* result) override;
 
@@ -210,6 +252,10 @@ class GcsFileSystem : public FileSystem {
     return file_block_cache_->max_staleness();
   }
   TimeoutConfig timeouts() const { return timeouts_; }
+  const PrefetchOptions& prefetch_options() const { return prefetch_options_; }
+  const CompositeUploadOptions& composite_upload_options() const {
+    return composite_upload_options_;
+  }
   std::unordered_set<string> allowed_locations() const {
     return allowed_locations_;
   }
@@ -267,6 +313,40 @@ class GcsFileSystem : public FileSystem {
           write(write) {}
   };
 
+  /// Structure controlling how a random access file prefetches ranges when it
+  /// is read sequentially.
+  ///
+  /// Small reads are always coalesced into requests of `request_size` bytes.
+  /// Once `sequential_reads` consecutive reads each started where the previous
+  /// one ended, the file keeps `max_outstanding_requests` further requests in
+  /// flight ahead of the reader. Any other read drops the prefetched ranges.
+  struct PrefetchOptions {
+    // Number of range requests kept in flight ahead of the reader. 0 disables
+    // prefetching.
+    int max_outstanding_requests = 0;
+
+    // Consecutive sequential reads needed before prefetching starts.
+    int sequential_reads = kDefaultPrefetchSequentialReads;
+
+    // Size of each range request. 0 means the readahead buffer size.
+    size_t request_size = 0;
+  };
+
+  /// Structure controlling how a writable file uploads its contents as parts.
+  ///
+  /// Appended data is buffered in memory until `part_size` bytes are available
+  /// and then uploaded as a temporary object, with up to
+  /// `max_parts_in_flight` parts uploading concurrently. Sync() and Close()
+  /// compose the uploaded parts into the target object and delete them.
+  struct CompositeUploadOptions {
+    // Size of each uploaded part. It doubles every 128 parts to stay within
+    // the component limit of composite objects. 0 disables composite uploads.
+    size_t part_size = 0;
+
+    // Number of parts that can be uploading at once.
+    int max_parts_in_flight = kDefaultCompositeUploadMaxPartsInFlight;
+  };
+
   Status CreateHttpRequest(std::unique_ptr<HttpRequest>* request);
 
   /// \brief Sets a new AuthProvider on the GCS FileSystem.
@@ -338,6 +418,12 @@ class GcsFileSystem : public FileSystem {
   /// The retry configuration used for retrying failed calls.
   RetryConfig retry_config_;
 
+  /// The prefetch options used by NewRandomAccessFile.
+  PrefetchOptions prefetch_options_;
+
+  /// The composite upload options used by NewWritableFile.
+  CompositeUploadOptions composite_upload_options_;
+
  private:
   // GCS file statistics.
   struct GcsFileStat {
@@ -407,6 +493,10 @@ class GcsFileSystem : public FileSystem {
   // Clear all the caches related to the file with name `filename`.
   void ClearFileCaches(const string& fname);
 
+  // Returns the pool issuing prefetch requests and part uploads, creating it
+  // on first use.
+  thread::ThreadPool* TransferPool();
+
   mutex mu_;
   std::unique_ptr<AuthProvider> auth_provider_ TF_GUARDED_BY(mu_);
   std::shared_ptr<HttpRequest::Factory> http_request_factory_;
@@ -415,6 +505,9 @@ class GcsFileSystem : public FileSystem {
   // Reads smaller than block_size_ will trigger a read of block_size_.
   uint64 block_size_;
 
+  // The local directory of the block cache. Empty means the cache is in memory.
+  string cache_dir_;
+
   // block_cache_lock_ protects the file_block_cache_ pointer (Note that
   // FileBlockCache instances are themselves threadsafe).
   mutex block_cache_lock_;
@@ -441,6 +534,13 @@ class GcsFileSystem : public FileSystem {
   // Additional header material to be transmitted with all GCS requests
   std::unique_ptr<std::pair<const string, const string>> additional_header_;
 
+  // Runs the range requests of prefetching files and the part uploads of
+  // composite uploads. Declared last so that it is destroyed, and its pending
+  // requests finished, before anything they use.
+  mutex transfer_pool_mu_;
+  std::unique_ptr<thread::ThreadPool> transfer_pool_
+      TF_GUARDED_BY(transfer_pool_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(GcsFileSystem);
 };
 
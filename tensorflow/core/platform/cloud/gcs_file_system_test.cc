@@ -202,6 +202,123 @@ TEST(GcsFileSystemTest, NewRandomAccessFile_Buffered_Errors) {
   EXPECT_EQ("123", result);
 }
 
+TEST(GcsFileSystemTest, NewRandomAccessFile_Prefetched) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 0-9\n"
+          "Timeouts: 5 1 20\n",
+          "0123456789"),
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 10-19\n"
+          "Timeouts: 5 1 20\n",
+          "abcdefghij"),
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 20-29\n"
+          "Timeouts: 5 1 20\n",
+          "klm"),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 10 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single request ahead of the reader keeps the fake requests in order.
+  GcsFileSystem::PrefetchOptions prefetch_options;
+  prefetch_options.max_outstanding_requests = 1;
+  prefetch_options.sequential_reads = 2;
+  std::unique_ptr<RandomAccessFile> file;
+  TF_EXPECT_OK(fs.NewRandomAccessFileWithOptions(
+      "gs://bucket/random_access.txt", nullptr, prefetch_options, &file));
+
+  char scratch[11];
+  StringPiece result;
+
+  // The first reads are coalesced into a single request.
+  TF_EXPECT_OK(file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("0123", result);
+  // The second sequential read starts prefetching the next range.
+  TF_EXPECT_OK(file->Read(4, 4, &result, scratch));
+  EXPECT_EQ("4567", result);
+  TF_EXPECT_OK(file->Read(8, 4, &result, scratch));
+  EXPECT_EQ("89ab", result);
+  TF_EXPECT_OK(file->Read(12, 11, &result, scratch));
+  EXPECT_EQ("cdefghijklm", result);
+
+  // Nothing is requested past the end of the file.
+  EXPECT_TRUE(errors::IsOutOfRange(file->Read(23, 4, &result, scratch)));
+  EXPECT_EQ("", result);
+}
+
+TEST(GcsFileSystemTest, NewRandomAccessFile_Prefetched_RandomAccess) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 0-9\n"
+          "Timeouts: 5 1 20\n",
+          "0123456789"),
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 10-19\n"
+          "Timeouts: 5 1 20\n",
+          "abcdefghij"),
+      new FakeHttpRequest(
+          "Uri: https://storage.googleapis.com/bucket/random_access.txt\n"
+          "Auth Token: fake_token\n"
+          "Range: 0-9\n"
+          "Timeouts: 5 1 20\n",
+          "0123456789"),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 10 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single request ahead of the reader keeps the fake requests in order.
+  GcsFileSystem::PrefetchOptions prefetch_options;
+  prefetch_options.max_outstanding_requests = 1;
+  prefetch_options.sequential_reads = 2;
+  std::unique_ptr<RandomAccessFile> file;
+  TF_EXPECT_OK(fs.NewRandomAccessFileWithOptions(
+      "gs://bucket/random_access.txt", nullptr, prefetch_options, &file));
+
+  char scratch[11];
+  StringPiece result;
+
+  TF_EXPECT_OK(file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("0123", result);
+  TF_EXPECT_OK(file->Read(4, 4, &result, scratch));
+  EXPECT_EQ("4567", result);
+
+  // A read that skips ahead is served from the prefetched range, but does not
+  // prefetch any further.
+  TF_EXPECT_OK(file->Read(12, 2, &result, scratch));
+  EXPECT_EQ("cd", result);
+
+  // Seeking back drops the prefetched range and requests the data again.
+  TF_EXPECT_OK(file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("0123", result);
+}
+
 TEST(GcsFileSystemTest, NewRandomAccessFile_Buffered_ReadAtEOF) {
   std::vector<HttpRequest*> requests(
       {new FakeHttpRequest(
@@ -996,6 +1113,317 @@ TEST(GcsFileSystemTest, NewWritableFile) {
   TF_EXPECT_OK(wfile->Close());
 }
 
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUpload) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 0123\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 4567\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.8\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 89\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/.tmpcompose/writeable.0'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.4'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.8'}"
+          "]}\n",
+          "{\"generation\": \"1\"}"),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.8\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 8 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single part in flight keeps the fake requests in order.
+  GcsFileSystem::CompositeUploadOptions composite_upload_options;
+  composite_upload_options.part_size = 4;
+  composite_upload_options.max_parts_in_flight = 1;
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFileWithOptions("gs://bucket/some/path/writeable",
+                                             nullptr, composite_upload_options,
+                                             &file));
+
+  TF_EXPECT_OK(file->Append("012"));
+  TF_EXPECT_OK(file->Append("3456789"));
+  int64_t position;
+  TF_EXPECT_OK(file->Tell(&position));
+  EXPECT_EQ(10, position);
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadWithFlush) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 0123\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 456\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/.tmpcompose/writeable.0'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.4'}"
+          "]}\n",
+          "{\"generation\": \"1\"}"),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.7\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 78\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose?ifGenerationMatch=1\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/writeable'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.7'}"
+          "]}\n",
+          "{\"generation\": \"2\"}"),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.7\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 8 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single part in flight keeps the fake requests in order.
+  GcsFileSystem::CompositeUploadOptions composite_upload_options;
+  composite_upload_options.part_size = 4;
+  composite_upload_options.max_parts_in_flight = 1;
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFileWithOptions("gs://bucket/some/path/writeable",
+                                             nullptr, composite_upload_options,
+                                             &file));
+
+  TF_EXPECT_OK(file->Append("0123456"));
+  TF_EXPECT_OK(file->Flush());
+  // Data appended after the flush is composed with the existing object.
+  TF_EXPECT_OK(file->Append("78"));
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadEmpty) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2Fwriteable\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post: yes\n",
+          "{\"generation\": \"1\"}"),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 8 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single part in flight keeps the fake requests in order.
+  GcsFileSystem::CompositeUploadOptions composite_upload_options;
+  composite_upload_options.part_size = 4;
+  composite_upload_options.max_parts_in_flight = 1;
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFileWithOptions("gs://bucket/some/path/writeable",
+                                             nullptr, composite_upload_options,
+                                             &file));
+
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadRetriesLostCompose) {
+  std::vector<HttpRequest*> requests({
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 0123\n",
+          ""),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/.tmpcompose/writeable.0'}"
+          "]}\n",
+          "{\"generation\": \"1\"}"),
+      // Deleting the part fails, which does not fail the flush.
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.0\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          "", errors::PermissionDenied("403"), 403),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 30\n"
+          "Post body: 45\n",
+          ""),
+      // The compose succeeds but its response is lost.
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose?ifGenerationMatch=1\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/writeable'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.4'}"
+          "]}\n",
+          "", errors::Unavailable("503"), 503),
+      // The retry fails the precondition instead of duplicating the part.
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable/compose?ifGenerationMatch=1\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Header content-type: application/json\n"
+          "Post body: {'sourceObjects': ["
+          "{'name': 'some/path/writeable'}"
+          ",{'name': 'some/path/.tmpcompose/writeable.4'}"
+          "]}\n",
+          "", errors::FailedPrecondition("412"), 412),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2Fwriteable?fields=size%2Cgeneration%2Cupdated\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n",
+          strings::StrCat("{\"size\": \"6\",\"generation\": \"2\","
+                          "\"updated\": \"2016-04-29T23:15:24.896Z\"}")),
+      new FakeHttpRequest(
+          "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+          "some%2Fpath%2F.tmpcompose%2Fwriteable.4\n"
+          "Auth Token: fake_token\n"
+          "Timeouts: 5 1 10\n"
+          "Delete: yes\n",
+          ""),
+  });
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 8 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+
+  // A single part in flight keeps the fake requests in order.
+  GcsFileSystem::CompositeUploadOptions composite_upload_options;
+  composite_upload_options.part_size = 4;
+  composite_upload_options.max_parts_in_flight = 1;
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFileWithOptions("gs://bucket/some/path/writeable",
+                                             nullptr, composite_upload_options,
+                                             &file));
+
+  TF_EXPECT_OK(file->Append("0123"));
+  TF_EXPECT_OK(file->Flush());
+  TF_EXPECT_OK(file->Append("45"));
+  TF_EXPECT_OK(file->Close());
+}
+
 TEST(GcsFileSystemTest, NewWritableFile_ResumeUploadSucceeds) {
   std::vector<HttpRequest*> requests(
       {new FakeHttpRequest(
@@ -3683,6 +4111,22 @@ TEST(GcsFileSystemTest, OverrideCacheParameters) {
   EXPECT_EQ(20, fs5.timeouts().metadata);
   EXPECT_EQ(30, fs5.timeouts().read);
   EXPECT_EQ(40, fs5.timeouts().write);
+
+  // Verify prefetch overrides.
+  EXPECT_EQ(0, fs5.prefetch_options().max_outstanding_requests);
+  setenv("GCS_PREFETCH_MAX_REQUESTS", "4", 1);
+  setenv("GCS_PREFETCH_SEQUENTIAL_READS", "3", 1);
+  GcsFileSystem fs6;
+  EXPECT_EQ(4, fs6.prefetch_options().max_outstanding_requests);
+  EXPECT_EQ(3, fs6.prefetch_options().sequential_reads);
+
+  // Verify composite upload overrides.
+  EXPECT_EQ(0, fs6.composite_upload_options().part_size);
+  setenv("GCS_COMPOSITE_UPLOAD_PART_SIZE_MB", "32", 1);
+  setenv("GCS_COMPOSITE_UPLOAD_MAX_PARTS_IN_FLIGHT", "8", 1);
+  GcsFileSystem fs7;
+  EXPECT_EQ(32 * 1024 * 1024, fs7.composite_upload_options().part_size);
+  EXPECT_EQ(8, fs7.composite_upload_options().max_parts_in_flight);
 }
 
 TEST(GcsFileSystemTest, CreateHttpRequest) {
@@ -29,13 +29,32 @@ limitations under the License.
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define TF_POSIX_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
 #include "tensorflow/core/platform/default/posix_file_system.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/file_system_helper.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 
 namespace tensorflow {
@@ -45,6 +64,275 @@ using ::tensorflow::errors::IOError;
 // 128KB of copy buffer
 constexpr size_t kPosixCopyFileBufferSize = 128 * 1024;
 
+#if defined(TF_POSIX_HAS_IO_URING)
+// A process-wide io_uring for asynchronous file reads. Reads are submitted
+// from the calling thread and their callbacks run on a single completion
+// thread. Short reads are resubmitted from the completion thread until the
+// read is complete or reaches the end of the file. The ring is driven with
+// raw syscalls, so it needs no liburing.
+class IoUring {
+ public:
+  // Called with the number of bytes read, which is less than requested only
+  // at the end of the file, or a negative errno.
+  using Callback = std::function<void(int64_t)>;
+
+  // Returns the process-wide ring, or nullptr if io_uring is not supported by
+  // the kernel or not permitted (e.g. by a seccomp policy).
+  static IoUring* Get() {
+    static IoUring* ring = Create();  // Never deleted.
+    return ring;
+  }
+
+  // Returns false once the ring failed. Reads submitted after that fail.
+  bool ok() TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return error_ == 0;
+  }
+
+  // Submits a read of `n` bytes of `fd` at `offset` into `dst`, and calls
+  // `done` when the read completes. Blocks while the ring is full.
+  void Read(int fd, uint64 offset, size_t n, char* dst, Callback done)
+      TF_LOCKS_EXCLUDED(mu_) {
+    auto request = std::make_unique<Request>();
+    request->fd = fd;
+    request->offset = offset;
+    request->iov.iov_base = dst;
+    request->iov.iov_len = n;
+    request->done = std::move(done);
+    int error = 0;
+    {
+      mutex_lock l(mu_);
+      // Bounding the reads in flight by the completion queue size ensures
+      // that no completion is dropped.
+      while (error_ == 0 && num_in_flight_ >= cq_entries_) {
+        ring_not_full_.wait(l);
+      }
+      error = error_ != 0 ? error_ : SubmitLocked(request.get());
+      if (error == 0) {
+        ++num_in_flight_;
+        pending_.insert(request.get());
+      }
+    }
+    if (error != 0) {
+      request->done(-error);
+      return;
+    }
+    request.release();  // Deleted by the completion thread.
+  }
+
+ private:
+  static constexpr unsigned kNumEntries = 256;
+
+  struct Request {
+    int fd;
+    // The offset and the destination of the part that is still to be read.
+    uint64 offset;
+    struct iovec iov;
+    size_t bytes_read = 0;
+    Callback done;
+  };
+
+  static IoUring* Create() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = syscall(__NR_io_uring_setup, kNumEntries, &params);
+    if (ring_fd < 0) {
+      VLOG(1) << "io_uring is not available: " << strerror(errno);
+      return nullptr;
+    }
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = false;
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+#endif
+    if (single_mmap) {
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    void* sq = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    void* cq = single_mmap ? sq
+                           : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd,
+                                  IORING_OFF_CQ_RING);
+    void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+      LOG(WARNING) << "Failed to map the io_uring queues: " << strerror(errno);
+      // The mappings are released with the ring file descriptor, in the
+      // unlikely event that only some of them succeeded.
+      close(ring_fd);
+      return nullptr;
+    }
+    return new IoUring(ring_fd, params, static_cast<char*>(sq),
+                       static_cast<char*>(cq),
+                       static_cast<io_uring_sqe*>(sqes));
+  }
+
+  IoUring(int ring_fd, const io_uring_params& params, char* sq, char* cq,
+          io_uring_sqe* sqes)
+      : ring_fd_(ring_fd),
+        cq_entries_(params.cq_entries),
+        sq_tail_(reinterpret_cast<unsigned*>(sq + params.sq_off.tail)),
+        sq_mask_(reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask)),
+        sq_array_(reinterpret_cast<unsigned*>(sq + params.sq_off.array)),
+        sqes_(sqes),
+        cq_head_(reinterpret_cast<unsigned*>(cq + params.cq_off.head)),
+        cq_tail_(reinterpret_cast<unsigned*>(cq + params.cq_off.tail)),
+        cq_mask_(reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask)),
+        cqes_(reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes)) {
+    completion_thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "tf_io_uring_completions",
+        [this]() { ReapCompletions(); }));
+  }
+
+  // Queues a read of the rest of `request` and returns 0, or returns an errno
+  // if the kernel did not accept it.
+  int SubmitLocked(Request* request) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = request->fd;
+    sqe->off = request->offset;
+    sqe->addr = reinterpret_cast<uint64>(&request->iov);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uint64>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    int r;
+    do {
+      r = syscall(__NR_io_uring_enter, ring_fd_, /*to_submit=*/1,
+                  /*min_complete=*/0, /*flags=*/0, nullptr, 0);
+    } while (r < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+    if (r < 0) {
+      // The kernel did not consume the submission, so it can be withdrawn.
+      __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+      return errno;
+    }
+    return 0;
+  }
+
+  // Handles a completion of `request` with `*result`. Returns true if the
+  // rest of the read was resubmitted, in which case the request keeps its
+  // place in the ring. Otherwise sets `*result` to the result of the whole
+  // read.
+  bool ContinueLocked(Request* request, int64_t* result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (*result > 0 && *result < static_cast<int64_t>(request->iov.iov_len)) {
+      request->offset += *result;
+      request->iov.iov_base =
+          static_cast<char*>(request->iov.iov_base) + *result;
+      request->iov.iov_len -= *result;
+      request->bytes_read += *result;
+    } else if (*result != -EINTR && *result != -EAGAIN) {
+      // The read is complete, reached the end of the file, or failed.
+      if (*result >= 0) {
+        *result += request->bytes_read;
+      }
+      return false;
+    }
+    const int error = SubmitLocked(request);
+    if (error != 0) {
+      *result = -error;
+      return false;
+    }
+    return true;
+  }
+
+  // Fails all pending reads with `error` after the ring stopped delivering
+  // completions, and fails all later reads too.
+  void FailPendingReads(int error) TF_LOCKS_EXCLUDED(mu_) {
+    std::vector<Request*> pending;
+    {
+      mutex_lock l(mu_);
+      error_ = error;
+      pending.assign(pending_.begin(), pending_.end());
+      pending_.clear();
+      num_in_flight_ = 0;
+      ring_not_full_.notify_all();
+    }
+    LOG(ERROR) << "Failed to wait for io_uring completions, failing "
+               << pending.size() << " pending reads: " << strerror(error);
+    for (Request* request : pending) {
+      std::unique_ptr<Request> owned_request(request);
+      owned_request->done(-error);
+    }
+  }
+
+  // Runs the callbacks of completed reads. Returns only if the ring fails.
+  void ReapCompletions() {
+    std::vector<std::pair<Request*, int64_t>> completed;
+    while (true) {
+      int r = syscall(__NR_io_uring_enter, ring_fd_, /*to_submit=*/0,
+                      /*min_complete=*/1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        FailPendingReads(errno);
+        return;
+      }
+      // Only this thread consumes completions, so `cq_head_` needs no
+      // synchronization with other threads.
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        completed.emplace_back(reinterpret_cast<Request*>(cqe.user_data),
+                               cqe.res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      if (completed.empty()) {
+        continue;
+      }
+      {
+        mutex_lock l(mu_);
+        // Keep only the reads that are finished.
+        size_t num_finished = 0;
+        for (auto& request_and_result : completed) {
+          if (!ContinueLocked(request_and_result.first,
+                              &request_and_result.second)) {
+            pending_.erase(request_and_result.first);
+            completed[num_finished++] = request_and_result;
+          }
+        }
+        completed.resize(num_finished);
+        num_in_flight_ -= num_finished;
+        ring_not_full_.notify_all();
+      }
+      for (const auto& request_and_result : completed) {
+        std::unique_ptr<Request> request(request_and_result.first);
+        request->done(request_and_result.second);
+      }
+      completed.clear();
+    }
+  }
+
+  const int ring_fd_;
+  const unsigned cq_entries_;
+  // Submission queue, written under `mu_`.
+  unsigned* const sq_tail_;
+  const unsigned* const sq_mask_;
+  unsigned* const sq_array_;
+  io_uring_sqe* const sqes_;
+  // Completion queue, read by the completion thread.
+  unsigned* const cq_head_;
+  const unsigned* const cq_tail_;
+  const unsigned* const cq_mask_;
+  const io_uring_cqe* const cqes_;
+
+  mutex mu_;
+  condition_variable ring_not_full_;
+  unsigned num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  // The reads that were submitted and whose callbacks have not run.
+  std::unordered_set<Request*> pending_ TF_GUARDED_BY(mu_);
+  // The errno with which the ring failed, or 0.
+  int error_ TF_GUARDED_BY(mu_) = 0;
+  std::unique_ptr<Thread> completion_thread_;
+};
+#endif  // TF_POSIX_HAS_IO_URING
+
 // pread() based random-access
 class PosixRandomAccessFile : public RandomAccessFile {
  private:
@@ -96,6 +384,34 @@ class PosixRandomAccessFile : public RandomAccessFile {
     return s;
   }
 
+#if defined(TF_POSIX_HAS_IO_URING)
+  void ReadAsync(uint64 offset, size_t n, char* scratch,
+                 ReadDoneCallback done) const override {
+    IoUring* ring = IoUring::Get();
+    if (ring == nullptr || !ring->ok() || n == 0 || n > INT32_MAX) {
+      RandomAccessFile::ReadAsync(offset, n, scratch, std::move(done));
+      return;
+    }
+    ring->Read(fd_, offset, n, scratch,
+               [this, n, scratch, done = std::move(done)](int64_t r) {
+                 if (r < 0) {
+                   done(IOError(filename_, -r), StringPiece(scratch, 0));
+                 } else if (r < static_cast<int64_t>(n)) {
+                   done(Status(error::OUT_OF_RANGE,
+                               "Read less bytes than requested"),
+                        StringPiece(scratch, r));
+                 } else {
+                   done(OkStatus(), StringPiece(scratch, n));
+                 }
+               });
+  }
+
+  bool SupportsAsyncRead() const override {
+    IoUring* ring = IoUring::Get();
+    return ring != nullptr && ring->ok();
+  }
+#endif  // TF_POSIX_HAS_IO_URING
+
 #if defined(TF_CORD_SUPPORT)
   Status Read(uint64 offset, size_t n, absl::Cord* cord) const override {
     if (n == 0) {
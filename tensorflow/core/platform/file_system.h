@@ -774,6 +774,35 @@ class RandomAccessFile {
   virtual tensorflow::Status Read(uint64 offset, size_t n, StringPiece* result,
                                   char* scratch) const = 0;
 
+  /// \brief Callback for `ReadAsync`, called with the status and the data
+  /// that `Read` would have returned.
+  using ReadDoneCallback =
+      std::function<void(const tensorflow::Status& status, StringPiece result)>;
+
+  /// \brief Starts reading up to `n` bytes from the file starting at
+  /// `offset`, and calls `done` when the read completes.
+  ///
+  /// `scratch[0..n-1]` may be written by this routine and must be live until
+  /// `done` is called. `done` may be called on another thread, or before
+  /// `ReadAsync` returns, and should not block. The file must outlive all the
+  /// reads started on it.
+  ///
+  /// The default implementation calls `Read` synchronously. File systems
+  /// which support asynchronous reads should also override
+  /// `SupportsAsyncRead`.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(uint64 offset, size_t n, char* scratch,
+                         ReadDoneCallback done) const {
+    StringPiece result;
+    tensorflow::Status s = Read(offset, n, &result, scratch);
+    done(s, result);
+  }
+
+  /// \brief Returns whether `ReadAsync` returns before the read completes,
+  /// so that a single thread can keep several reads in flight.
+  virtual bool SupportsAsyncRead() const { return false; }
+
 #if defined(TF_CORD_SUPPORT)
   /// \brief Read up to `n` bytes from the file starting at `offset`.
   virtual tensorflow::Status Read(uint64 offset, size_t n,
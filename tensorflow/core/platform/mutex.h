@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_PLATFORM_MUTEX_H_
 #define TENSORFLOW_CORE_PLATFORM_MUTEX_H_
 
+#include <atomic>
 #include <chrono>  // NOLINT
+#include <cstdint>
 // for std::try_to_lock_t and std::cv_status
 #include <condition_variable>  // NOLINT
 #include <mutex>               // NOLINT
@@ -141,6 +143,107 @@ class Condition {
   static bool ReturnBool(const Condition* cond);  // access *(bool *)arg_
 };
 
+// One contended acquisition of a profiled_mutex, as reported to the handler
+// installed with SetMutexContentionHandler().
+struct MutexContention {
+  // The name the mutex was constructed with.
+  const char* name;
+  // The return addresses of the lock() calls made by the thread that last
+  // acquired the mutex exclusively (0 if unknown) and by the waiting thread.
+  uintptr_t holder_pc;
+  uintptr_t waiter_pc;
+  // How long the waiting thread was blocked.
+  int64_t wait_nanos;
+};
+
+typedef void (*MutexContentionHandler)(const MutexContention& contention);
+
+namespace internal {
+// Constant-initialized, so reading it needs no initialization guard.
+inline std::atomic<MutexContentionHandler>& mutex_contention_handler() {
+  static std::atomic<MutexContentionHandler> handler{nullptr};
+  return handler;
+}
+}  // namespace internal
+
+// Installs `handler` to be called, on the waiting thread after it acquires
+// the mutex, for every contended acquisition of a profiled_mutex. Passing
+// nullptr turns contention profiling off, which is the default. The handler
+// must not acquire a profiled_mutex.
+inline void SetMutexContentionHandler(MutexContentionHandler handler) {
+  internal::mutex_contention_handler().store(handler,
+                                             std::memory_order_release);
+}
+
+// A mutex that reports contention under `name` while a contention handler is
+// installed. It is a drop-in replacement for the framework's most contended
+// locks: while profiling is off, lock() costs one relaxed load more than
+// mutex::lock(); while it is on, uncontended acquisitions additionally record
+// their call site, and only contended ones are timed. Reacquisitions by
+// condition variables and Await() are not profiled.
+class TF_LOCKABLE profiled_mutex : public mutex {
+ public:
+  // `name` must outlive the mutex; usually it is a string literal.
+  explicit profiled_mutex(const char* name) : name_(name) {}
+
+  const char* name() const { return name_; }
+
+  void lock() TF_EXCLUSIVE_LOCK_FUNCTION() TF_NO_THREAD_SAFETY_ANALYSIS {
+    if (ProfilingEnabled()) {
+      ProfiledLock(/*shared=*/false);
+    } else {
+      mutex::lock();
+    }
+  }
+
+  void lock_shared() TF_SHARED_LOCK_FUNCTION() TF_NO_THREAD_SAFETY_ANALYSIS {
+    if (ProfilingEnabled()) {
+      ProfiledLock(/*shared=*/true);
+    } else {
+      mutex::lock_shared();
+    }
+  }
+
+ private:
+  static bool ProfilingEnabled() {
+    return internal::mutex_contention_handler().load(
+               std::memory_order_relaxed) != nullptr;
+  }
+
+  // Not inlined, so that its return address identifies the caller of lock().
+#if defined(__GNUC__)
+  __attribute__((noinline))
+#endif
+  void ProfiledLock(bool shared) TF_NO_THREAD_SAFETY_ANALYSIS {
+    uintptr_t pc = 0;
+#if defined(__GNUC__)
+    pc = reinterpret_cast<uintptr_t>(__builtin_return_address(0));
+#endif
+    if (shared ? mutex::try_lock_shared() : mutex::try_lock()) {
+      if (!shared) holder_pc_.store(pc, std::memory_order_relaxed);
+      return;
+    }
+    const uintptr_t holder_pc = holder_pc_.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    if (shared) {
+      mutex::lock_shared();
+    } else {
+      mutex::lock();
+      holder_pc_.store(pc, std::memory_order_relaxed);
+    }
+    const MutexContentionHandler handler =
+        internal::mutex_contention_handler().load(std::memory_order_acquire);
+    if (handler == nullptr) return;
+    handler({name_, holder_pc, pc,
+             std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count()});
+  }
+
+  const char* const name_;
+  std::atomic<uintptr_t> holder_pc_{0};
+};
+
 // Mimic a subset of the std::unique_lock<tensorflow::mutex> functionality.
 class TF_SCOPED_LOCKABLE mutex_lock {
  public:
@@ -151,6 +254,11 @@ class TF_SCOPED_LOCKABLE mutex_lock {
     mu_->lock();
   }
 
+  explicit mutex_lock(profiled_mutex& mu) TF_EXCLUSIVE_LOCK_FUNCTION(mu)
+      : mu_(&mu) {
+    mu.lock();
+  }
+
   mutex_lock(mutex_type& mu, std::try_to_lock_t) TF_EXCLUSIVE_LOCK_FUNCTION(mu)
       : mu_(&mu) {
     if (!mu.try_lock()) {
@@ -191,6 +299,11 @@ class TF_SCOPED_LOCKABLE tf_shared_lock {
     mu_->lock_shared();
   }
 
+  explicit tf_shared_lock(profiled_mutex& mu) TF_SHARED_LOCK_FUNCTION(mu)
+      : mu_(&mu) {
+    mu.lock_shared();
+  }
+
   tf_shared_lock(mutex_type& mu, std::try_to_lock_t) TF_SHARED_LOCK_FUNCTION(mu)
       : mu_(&mu) {
     if (!mu.try_lock_shared()) {
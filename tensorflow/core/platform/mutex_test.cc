@@ -35,5 +35,25 @@ struct SharedMutexLockTest {
   mutex mu;
 };
 
+// Check that a profiled_mutex can stand in for a mutex, including in the
+// thread-safety annotations.
+struct ProfiledMutexLockTest {
+  void Increment() {
+    mutex_lock lock(mu);
+    ++value;
+  }
+  int Read() {
+    tf_shared_lock lock(mu);
+    return value;
+  }
+  void Wait() {
+    mutex_lock lock(mu);
+    cv.wait(lock);
+  }
+  profiled_mutex mu{"ProfiledMutexLockTest"};
+  int value TF_GUARDED_BY(mu) = 0;
+  condition_variable cv;
+};
+
 }  // namespace
 }  // namespace tensorflow
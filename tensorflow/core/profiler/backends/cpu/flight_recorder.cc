@@ -0,0 +1,173 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/backends/cpu/flight_recorder.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/profiler/backends/cpu/host_tracer_utils.h"
+#include "tensorflow/core/profiler/lib/profiler_lock.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_utils.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+size_t CountEvents(const TraceMeRecorder::Events& events) {
+  size_t num_events = 0;
+  for (const auto& thread : events) num_events += thread.events.size();
+  return num_events;
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder(const FlightRecorderOptions& options)
+    : options_(options), env_(Env::Default()) {
+  thread_.reset(env_->StartThread(ThreadOptions(), "tf_flight_recorder",
+                                  [this] { Run(); }));
+}
+
+FlightRecorder::~FlightRecorder() {
+  {
+    mutex_lock lock(mu_);
+    stopping_ = true;
+    cv_.notify_all();
+  }
+  // Joins the background thread.
+  thread_.reset();
+}
+
+void FlightRecorder::Run() {
+  const bool continuous = options_.sampling_ratio >= 1.0;
+  const uint64 period_ns =
+      std::max<int64_t>(options_.period_ms, 1) * EnvTime::kMillisToNanos;
+  const uint64 active_ns =
+      continuous ? period_ns
+                 : static_cast<uint64>(
+                       period_ns * std::max(options_.sampling_ratio, 0.0));
+  ProfilerLock profiler_lock;
+  uint64 slice_start_ns = 0;
+  for (;;) {
+    const uint64 period_start_ns = env_->NowNanos();
+    if (!profiler_lock.Active() && active_ns > 0) {
+      StatusOr<ProfilerLock> lock = ProfilerLock::Acquire();
+      // Skip this period if a profiling session owns the TraceMeRecorder.
+      if (lock.ok() && TraceMeRecorder::Start(options_.trace_level)) {
+        profiler_lock = std::move(lock).value();
+        slice_start_ns = period_start_ns;
+      }
+    }
+    if (!WaitUntil(period_start_ns + active_ns)) break;
+    if (profiler_lock.Active()) {
+      Slice slice;
+      slice.start_ns = slice_start_ns;
+      if (continuous) {
+        slice.events = TraceMeRecorder::Collect();
+      } else {
+        slice.events = TraceMeRecorder::Stop();
+        profiler_lock.ReleaseIfActive();
+      }
+      slice.end_ns = env_->NowNanos();
+      slice_start_ns = slice.end_ns;
+      AddSlice(std::move(slice));
+    }
+    if (!WaitUntil(period_start_ns + period_ns)) break;
+  }
+  if (profiler_lock.Active()) {
+    TraceMeRecorder::Stop();
+    profiler_lock.ReleaseIfActive();
+  }
+}
+
+bool FlightRecorder::WaitUntil(uint64 deadline_ns) {
+  mutex_lock lock(mu_);
+  while (!stopping_) {
+    uint64 now_ns = env_->NowNanos();
+    if (now_ns >= deadline_ns) return true;
+    WaitForMilliseconds(
+        &lock, &cv_, (deadline_ns - now_ns) / EnvTime::kMillisToNanos + 1);
+  }
+  return false;
+}
+
+void FlightRecorder::AddSlice(Slice&& slice) {
+  const size_t max_events = std::max<int64_t>(options_.max_events, 0);
+  const uint64 window_ns =
+      std::max<int64_t>(options_.window_ms, 0) * EnvTime::kMillisToNanos;
+  const uint64 cutoff_ns =
+      slice.end_ns > window_ns ? slice.end_ns - window_ns : 0;
+
+  mutex_lock lock(mu_);
+  num_events_ += CountEvents(slice.events);
+  slices_.push_back(std::move(slice));
+  while (!slices_.empty() &&
+         (slices_.front().end_ns < cutoff_ns ||
+          (num_events_ > max_events && slices_.size() > 1))) {
+    num_events_ -= CountEvents(slices_.front().events);
+    slices_.pop_front();
+  }
+  if (num_events_ <= max_events) return;
+  // A single slice is over the limit, drop its oldest events.
+  TraceMeRecorder::Events& events = slices_.front().events;
+  while (num_events_ > max_events) {
+    TraceMeRecorder::ThreadEvents* oldest = nullptr;
+    for (auto& thread : events) {
+      if (thread.events.empty()) continue;
+      if (oldest == nullptr || thread.events.front().start_time <
+                                   oldest->events.front().start_time) {
+        oldest = &thread;
+      }
+    }
+    oldest->events.pop_front();
+    --num_events_;
+  }
+}
+
+size_t FlightRecorder::NumEvents() const {
+  mutex_lock lock(mu_);
+  return num_events_;
+}
+
+void FlightRecorder::Dump(XSpace* space) {
+  TraceMeRecorder::Events events;
+  uint64 start_ns = 0;
+  {
+    mutex_lock lock(mu_);
+    if (slices_.empty()) return;
+    start_ns = slices_.front().start_ns;
+    absl::flat_hash_map<uint32, size_t> thread_index;
+    for (const Slice& slice : slices_) {
+      for (const auto& thread : slice.events) {
+        auto iter = thread_index.try_emplace(thread.thread.tid, events.size());
+        if (iter.second) {
+          events.push_back({thread.thread, {}});
+        }
+        auto& merged = events[iter.first->second].events;
+        merged.insert(merged.end(), thread.events.begin(),
+                      thread.events.end());
+      }
+    }
+  }
+  XPlane* plane = FindOrAddMutablePlaneWithName(space, kHostThreadsPlaneName);
+  ConvertCompleteEventsToXPlane(start_ns, std::move(events), plane);
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,109 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_PROFILER_BACKENDS_CPU_FLIGHT_RECORDER_H_
+#define TENSORFLOW_CORE_PROFILER_BACKENDS_CPU_FLIGHT_RECORDER_H_
+
+#include <deque>
+#include <memory>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/backends/cpu/traceme_recorder.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+struct FlightRecorderOptions {
+  // Only TraceMes with level <= trace_level are recorded.
+  int trace_level = 1;
+
+  // Fraction of each period during which TraceMes are recorded. 1.0 records
+  // continuously, 0.0 disables recording.
+  double sampling_ratio = 0.1;
+
+  // Length of one sampling period.
+  int64_t period_ms = 1000;
+
+  // Events recorded more than window_ms ago are discarded.
+  int64_t window_ms = 60 * 1000;
+
+  // Maximum number of events retained. The oldest events are discarded first.
+  int64_t max_events = 1 << 20;
+};
+
+// FlightRecorder keeps the TraceMe events of the last few seconds in memory so
+// they can be exported when something goes wrong, e.g. when a step misses its
+// latency target, without running a full profiling session.
+//
+// A background thread turns the TraceMeRecorder on for a fraction of every
+// period, so the cost for the traced program is that of TraceMe while
+// recording and that of a disabled TraceMe otherwise. Events are recorded in
+// the TraceMeRecorder's lock-free per-thread buffers and moved into a bounded
+// window at the end of every recording slice.
+//
+// The recorder is only started when no profiling session is active, and a
+// profiling session started while a slice is being recorded fails as if
+// another session were active. Activities split by TraceMe::ActivityStart and
+// TraceMe::ActivityEnd across two slices are discarded.
+class FlightRecorder {
+ public:
+  explicit FlightRecorder(const FlightRecorderOptions& options);
+  ~FlightRecorder();
+
+  // Adds the events retained in the window to the host threads plane of
+  // space. The events are kept, so Dump may be called repeatedly.
+  void Dump(XSpace* space) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of events retained in the window.
+  size_t NumEvents() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Events recorded in [start_ns, end_ns).
+  struct Slice {
+    uint64 start_ns;
+    uint64 end_ns;
+    TraceMeRecorder::Events events;
+  };
+
+  void Run();
+
+  // Waits until deadline_ns. Returns false if the recorder is being destroyed.
+  bool WaitUntil(uint64 deadline_ns) TF_LOCKS_EXCLUDED(mu_);
+
+  // Adds a slice to the window and discards the events falling out of it.
+  void AddSlice(Slice&& slice) TF_LOCKS_EXCLUDED(mu_);
+
+  const FlightRecorderOptions options_;
+  Env* const env_;
+
+  mutable mutex mu_;
+  condition_variable cv_;
+  bool stopping_ TF_GUARDED_BY(mu_) = false;
+  std::deque<Slice> slices_ TF_GUARDED_BY(mu_);
+  size_t num_events_ TF_GUARDED_BY(mu_) = 0;
+
+  std::unique_ptr<Thread> thread_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FlightRecorder);
+};
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_BACKENDS_CPU_FLIGHT_RECORDER_H_
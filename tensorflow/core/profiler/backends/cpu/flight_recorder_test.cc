@@ -0,0 +1,104 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/backends/cpu/flight_recorder.h"
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/profiler_lock.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_visitor.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+// Emits TraceMes until the recorder retains at least min_events.
+void TraceUntil(const FlightRecorder& recorder, size_t min_events) {
+  while (recorder.NumEvents() < min_events) {
+    { TraceMe traceme("step"); }
+    Env::Default()->SleepForMicroseconds(100);
+  }
+}
+
+TEST(FlightRecorderTest, DumpsRecentEvents) {
+  FlightRecorderOptions options;
+  options.sampling_ratio = 1.0;
+  options.period_ms = 10;
+  FlightRecorder recorder(options);
+  TraceUntil(recorder, 3);
+
+  XSpace space;
+  recorder.Dump(&space);
+  ASSERT_EQ(space.planes_size(), 1);
+  const XPlane& plane = space.planes(0);
+  EXPECT_EQ(plane.name(), kHostThreadsPlaneName);
+  XPlaneVisitor xplane(&plane);
+  int num_steps = 0;
+  xplane.ForEachLine([&](const XLineVisitor& line) {
+    line.ForEachEvent([&](const XEventVisitor& event) {
+      if (event.Name() == "step") ++num_steps;
+    });
+  });
+  EXPECT_GE(num_steps, 3);
+
+  // Dump does not consume the window.
+  EXPECT_GE(recorder.NumEvents(), 3);
+}
+
+TEST(FlightRecorderTest, SampledRecording) {
+  FlightRecorderOptions options;
+  options.sampling_ratio = 0.5;
+  options.period_ms = 10;
+  FlightRecorder recorder(options);
+  TraceUntil(recorder, 3);
+}
+
+TEST(FlightRecorderTest, RespectsMaxEvents) {
+  FlightRecorderOptions options;
+  options.sampling_ratio = 1.0;
+  options.period_ms = 10;
+  options.max_events = 5;
+  FlightRecorder recorder(options);
+  TraceUntil(recorder, 5);
+  for (int i = 0; i < 100; ++i) {
+    TraceMe traceme("step");
+  }
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_LE(recorder.NumEvents(), 5);
+}
+
+TEST(FlightRecorderTest, YieldsToProfilingSession) {
+  StatusOr<ProfilerLock> lock = ProfilerLock::Acquire();
+  ASSERT_TRUE(lock.ok());
+  FlightRecorderOptions options;
+  options.sampling_ratio = 1.0;
+  options.period_ms = 10;
+  {
+    FlightRecorder recorder(options);
+    for (int i = 0; i < 100; ++i) {
+      { TraceMe traceme("step"); }
+      Env::Default()->SleepForMicroseconds(100);
+    }
+    EXPECT_EQ(recorder.NumEvents(), 0);
+  }
+  lock->ReleaseIfActive();
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
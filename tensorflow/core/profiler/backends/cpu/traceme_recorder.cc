@@ -395,6 +395,16 @@ TraceMeRecorder::Events TraceMeRecorder::StopRecording() {
   return events;
 }
 
+TraceMeRecorder::Events TraceMeRecorder::CollectRecording() {
+  TraceMeRecorder::Events events;
+  mutex_lock lock(mutex_);
+  if (internal::g_trace_level.load(std::memory_order_acquire) !=
+      kTracingDisabled) {
+    events = Consume();
+  }
+  return events;
+}
+
 /*static*/ int64_t TraceMeRecorder::NewActivityId() {
   // Activity IDs: To avoid contention over a counter, the top 32 bits identify
   // the originating thread, the bottom 32 bits name the event within a thread.
@@ -89,6 +89,11 @@ class TraceMeRecorder {
   // Events passed to Record after Stop has started will be dropped.
   static Events Stop() { return Get()->StopRecording(); }
 
+  // Returns events recorded since Start() or the previous Collect() without
+  // stopping. Activities whose start and end are returned by different calls
+  // are discarded.
+  static Events Collect() { return Get()->CollectRecording(); }
+
   // Returns whether we're currently recording. Racy, but cheap!
   static inline bool Active(int level = 1) {
     return internal::g_trace_level.load(std::memory_order_acquire) >= level;
@@ -119,6 +124,7 @@ class TraceMeRecorder {
 
   bool StartRecording(int level);
   Events StopRecording();
+  Events CollectRecording();
 
   // Clears events from all active threads that were added due to Record
   // racing with StopRecording.
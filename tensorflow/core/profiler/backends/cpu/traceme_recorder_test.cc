@@ -57,6 +57,24 @@ TEST(RecorderTest, SingleThreaded) {
               ElementsAre(Named("during1"), Named("during2")));
 }
 
+TEST(RecorderTest, CollectWhileRecording) {
+  int64_t start_time = GetCurrentTimeNanos();
+  int64_t end_time = start_time + UniToNano(1);
+
+  TraceMeRecorder::Start(/*level=*/1);
+  TraceMeRecorder::Record({"first", start_time, end_time});
+  auto first = TraceMeRecorder::Collect();
+  EXPECT_TRUE(TraceMeRecorder::Active());
+  TraceMeRecorder::Record({"second", start_time, end_time});
+  auto second = TraceMeRecorder::Stop();
+
+  ASSERT_EQ(first.size(), 1);
+  EXPECT_THAT(first[0].events, ElementsAre(Named("first")));
+  ASSERT_EQ(second.size(), 1);
+  EXPECT_THAT(second[0].events, ElementsAre(Named("second")));
+  EXPECT_TRUE(TraceMeRecorder::Collect().empty());
+}
+
 // Checks the functional behavior of the recorder, when used from several
 // unsynchronized threads.
 //
@@ -0,0 +1,354 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/profiler/convert/xplane_to_critical_path.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/profiler/lib/context_types.h"
+#include "tensorflow/core/profiler/utils/tf_op_utils.h"
+#include "tensorflow/core/profiler/utils/tf_xplane_visitor.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_utils.h"
+#include "tensorflow/core/profiler/utils/xplane_visitor.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+constexpr absl::string_view kSendOp = "_Send";
+constexpr absl::string_view kRecvOp = "_Recv";
+
+// A TF op executed as part of a step.
+struct OpNode {
+  int host = 0;
+  std::string name;
+  std::string type;
+  int64_t start_ps = 0;
+  int64_t end_ps = 0;
+  // The "from" and "to" nodes of a _Send or _Recv.
+  std::string from;
+  std::string to;
+};
+
+// The ops of one step on one host, ordered by end time.
+struct HostOps {
+  std::vector<int> by_end;
+  std::vector<int64_t> ends;
+
+  void Sort(const std::vector<OpNode>& ops) {
+    absl::c_sort(by_end, [&ops](int a, int b) {
+      return std::make_tuple(ops[a].end_ps, ops[a].start_ps, a) <
+             std::make_tuple(ops[b].end_ps, ops[b].start_ps, b);
+    });
+    ends.clear();
+    for (int op : by_end) ends.push_back(ops[op].end_ps);
+  }
+
+  // Returns the op that finished last before `op` started, or -1.
+  int LatestBefore(const std::vector<OpNode>& ops, const OpNode& op) const {
+    int i = std::upper_bound(ends.begin(), ends.end(), op.start_ps) -
+            ends.begin();
+    while (--i >= 0) {
+      // Requiring an earlier start skips `op` itself if it is instantaneous,
+      // and guarantees that walking back terminates.
+      if (ops[by_end[i]].start_ps < op.start_ps) return by_end[i];
+    }
+    return -1;
+  }
+};
+
+struct StepGraph {
+  std::vector<OpNode> ops;
+  // The earliest start of the step on each host.
+  absl::flat_hash_map<int, int64_t> host_start_ps;
+  absl::flat_hash_map<int, HostOps> host_ops;
+  // The _Send ops of other hosts that a _Recv on each host waits for.
+  absl::flat_hash_map<int, HostOps> remote_sends;
+};
+
+struct StepSpan {
+  int64_t start_ps;
+  int64_t end_ps;
+  int64_t step_id;
+};
+
+void UpdateStart(int host, int64_t start_ps, StepGraph* step) {
+  auto it = step->host_start_ps.try_emplace(host, start_ps).first;
+  it->second = std::min(it->second, start_ps);
+}
+
+void CollectHostOps(const XPlane& host_plane, int host,
+                    std::map<int64_t, StepGraph>* steps) {
+  XPlaneVisitor plane = CreateTfXPlaneVisitor(&host_plane);
+  plane.ForEachLine([&](const XLineVisitor& line) {
+    std::vector<StepSpan> spans;
+    std::vector<OpNode> ops;
+    line.ForEachEvent([&](const XEventVisitor& event) {
+      std::optional<int64_t> producer_type, consumer_type;
+      std::optional<uint64_t> producer_id, consumer_id;
+      OpNode op;
+      event.ForEachStat([&](const XStatVisitor& stat) {
+        if (!stat.Type().has_value()) {
+          if (stat.Name() == "from") {
+            op.from = std::string(stat.StrOrRefValue());
+          } else if (stat.Name() == "to") {
+            op.to = std::string(stat.StrOrRefValue());
+          }
+          return;
+        }
+        switch (*stat.Type()) {
+          case StatType::kProducerType:
+            producer_type = stat.IntValue();
+            break;
+          case StatType::kProducerId:
+            producer_id = stat.IntOrUintValue();
+            break;
+          case StatType::kConsumerType:
+            consumer_type = stat.IntValue();
+            break;
+          case StatType::kConsumerId:
+            consumer_id = stat.IntOrUintValue();
+            break;
+          default:
+            break;
+        }
+      });
+      constexpr int64_t kTfExecutor =
+          static_cast<int64_t>(ContextType::kTfExecutor);
+      if (producer_type == kTfExecutor && producer_id.has_value()) {
+        // The producer of a step context starts the step on this host.
+        UpdateStart(host, event.TimestampPs(), &(*steps)[*producer_id]);
+      }
+      if (consumer_type == kTfExecutor && consumer_id.has_value()) {
+        spans.push_back({event.TimestampPs(), event.EndTimestampPs(),
+                         static_cast<int64_t>(*consumer_id)});
+        UpdateStart(host, event.TimestampPs(), &(*steps)[*consumer_id]);
+        return;
+      }
+      TfOp tf_op = ParseTfOpFullname(event.Name());
+      if (tf_op.category != Category::kTensorFlow) return;
+      op.host = host;
+      op.name = std::string(tf_op.name);
+      op.type = std::string(tf_op.type);
+      op.start_ps = event.TimestampPs();
+      op.end_ps = event.EndTimestampPs();
+      ops.push_back(std::move(op));
+    });
+
+    // Assign each op to the step of the Process event enclosing it. Process
+    // events on one thread do not overlap.
+    absl::c_sort(spans, [](const StepSpan& a, const StepSpan& b) {
+      return a.start_ps < b.start_ps;
+    });
+    for (OpNode& op : ops) {
+      auto it = std::upper_bound(spans.begin(), spans.end(), op.start_ps,
+                                 [](int64_t start_ps, const StepSpan& span) {
+                                   return start_ps < span.start_ps;
+                                 });
+      if (it == spans.begin()) continue;
+      --it;
+      if (op.end_ps > it->end_ps) continue;
+      (*steps)[it->step_id].ops.push_back(std::move(op));
+    }
+  });
+}
+
+// Indexes the ops of `step` by host, and matches each _Recv with the _Send
+// of another host it receives from.
+void BuildDependencies(StepGraph* step) {
+  const std::vector<OpNode>& ops = step->ops;
+  absl::flat_hash_map<std::pair<std::string, std::string>, std::vector<int>>
+      sends;
+  for (int i = 0; i < ops.size(); ++i) {
+    step->host_ops[ops[i].host].by_end.push_back(i);
+    if (ops[i].type == kSendOp) sends[{ops[i].from, ops[i].to}].push_back(i);
+  }
+  absl::flat_hash_map<int, absl::flat_hash_set<int>> remote_sends;
+  for (int i = 0; i < ops.size(); ++i) {
+    if (ops[i].type != kRecvOp) continue;
+    auto it = sends.find({ops[i].from, ops[i].to});
+    if (it == sends.end()) continue;
+    for (int send : it->second) {
+      if (ops[send].host != ops[i].host) {
+        remote_sends[ops[i].host].insert(send);
+      }
+    }
+  }
+  for (auto& host_and_ops : step->host_ops) host_and_ops.second.Sort(ops);
+  for (const auto& host_and_sends : remote_sends) {
+    HostOps& host_sends = step->remote_sends[host_and_sends.first];
+    host_sends.by_end.assign(host_and_sends.second.begin(),
+                             host_and_sends.second.end());
+    host_sends.Sort(ops);
+  }
+}
+
+void AddGap(const StepGraph& step, const std::vector<std::string>& host_names,
+            CriticalPathGap::Kind kind, int before, int after,
+            int64_t start_ps, std::vector<CriticalPathGap>* gaps) {
+  const OpNode& after_op = step.ops[after];
+  if (after_op.start_ps <= start_ps) return;
+  CriticalPathGap gap;
+  gap.set_kind(kind);
+  gap.set_host_name(host_names[after_op.host]);
+  if (before >= 0) gap.set_before_op(step.ops[before].name);
+  gap.set_after_op(after_op.name);
+  gap.set_start_ps(start_ps);
+  gap.set_duration_ps(after_op.start_ps - start_ps);
+  gaps->push_back(std::move(gap));
+}
+
+void ComputeCriticalPath(const StepGraph& step,
+                         const std::vector<std::string>& host_names,
+                         StepCriticalPath* critical_path) {
+  const std::vector<OpNode>& ops = step.ops;
+  int last = 0;
+  int64_t step_start_ps = std::numeric_limits<int64_t>::max();
+  for (int i = 0; i < ops.size(); ++i) {
+    if (ops[i].end_ps > ops[last].end_ps) last = i;
+    step_start_ps = std::min(step_start_ps, ops[i].start_ps);
+  }
+  for (const auto& host_and_start : step.host_start_ps) {
+    step_start_ps = std::min(step_start_ps, host_and_start.second);
+  }
+
+  // Walk back from the last op, each time to the dependency that finished
+  // last.
+  std::vector<int> path;
+  std::vector<CriticalPathGap> gaps;
+  for (int current = last; current >= 0;) {
+    path.push_back(current);
+    const OpNode& op = ops[current];
+    int local = -1;
+    auto host_ops = step.host_ops.find(op.host);
+    if (host_ops != step.host_ops.end()) {
+      local = host_ops->second.LatestBefore(ops, op);
+    }
+    int remote = -1;
+    auto host_sends = step.remote_sends.find(op.host);
+    if (host_sends != step.remote_sends.end()) {
+      remote = host_sends->second.LatestBefore(ops, op);
+    }
+    if (remote >= 0 && (local < 0 || ops[remote].end_ps > ops[local].end_ps)) {
+      AddGap(step, host_names, CriticalPathGap::TRANSFER, remote, current,
+             ops[remote].end_ps, &gaps);
+      current = remote;
+    } else if (local >= 0) {
+      AddGap(step, host_names, CriticalPathGap::IDLE, local, current,
+             ops[local].end_ps, &gaps);
+      current = local;
+    } else {
+      auto host_start = step.host_start_ps.find(op.host);
+      if (host_start != step.host_start_ps.end()) {
+        AddGap(step, host_names, CriticalPathGap::IDLE, -1, current,
+               host_start->second, &gaps);
+      }
+      current = -1;
+    }
+  }
+  absl::c_reverse(path);
+  absl::c_reverse(gaps);
+
+  const uint64_t step_time_ps = ops[last].end_ps - step_start_ps;
+  critical_path->set_step_time_ps(step_time_ps);
+  uint64_t op_time_ps = 0;
+  absl::flat_hash_map<std::string, CriticalPathCategory> categories;
+  for (int i : path) {
+    const OpNode& op = ops[i];
+    CriticalPathOp* path_op = critical_path->add_op();
+    path_op->set_host_name(host_names[op.host]);
+    path_op->set_op_name(op.name);
+    path_op->set_op_type(op.type);
+    path_op->set_start_ps(op.start_ps);
+    path_op->set_duration_ps(op.end_ps - op.start_ps);
+    op_time_ps += path_op->duration_ps();
+    CriticalPathCategory& category = categories[op.type];
+    category.set_op_type(op.type);
+    category.set_occurrences(category.occurrences() + 1);
+    category.set_time_ps(category.time_ps() + path_op->duration_ps());
+  }
+  critical_path->set_op_time_ps(op_time_ps);
+
+  std::vector<CriticalPathCategory> ranked;
+  ranked.reserve(categories.size());
+  for (auto& type_and_category : categories) {
+    CriticalPathCategory& category = type_and_category.second;
+    category.set_fraction_of_step(
+        step_time_ps > 0
+            ? static_cast<double>(category.time_ps()) / step_time_ps
+            : 0.0);
+    ranked.push_back(std::move(category));
+  }
+  absl::c_sort(ranked, [](const CriticalPathCategory& a,
+                          const CriticalPathCategory& b) {
+    return std::make_tuple(b.time_ps(), a.op_type()) <
+           std::make_tuple(a.time_ps(), b.op_type());
+  });
+  for (CriticalPathCategory& category : ranked) {
+    *critical_path->add_category() = std::move(category);
+  }
+
+  uint64_t idle_time_ps = 0;
+  for (CriticalPathGap& gap : gaps) {
+    idle_time_ps += gap.duration_ps();
+    *critical_path->add_gap() = std::move(gap);
+  }
+  critical_path->set_idle_time_ps(idle_time_ps);
+}
+
+}  // namespace
+
+CriticalPathDatabase ConvertXSpacesToCriticalPaths(
+    const std::vector<const XSpace*>& spaces) {
+  std::map<int64_t, StepGraph> steps;
+  std::vector<std::string> host_names;
+  for (const XSpace* space : spaces) {
+    const XPlane* host_plane = FindPlaneWithName(*space, kHostThreadsPlaneName);
+    if (host_plane == nullptr) continue;
+    const int host = host_names.size();
+    host_names.push_back(space->hostnames_size() > 0
+                             ? space->hostnames(0)
+                             : absl::StrCat("host", host));
+    CollectHostOps(*host_plane, host, &steps);
+  }
+
+  CriticalPathDatabase database;
+  for (auto& id_and_step : steps) {
+    StepGraph& step = id_and_step.second;
+    if (step.ops.empty()) continue;
+    BuildDependencies(&step);
+    StepCriticalPath* critical_path = database.add_step();
+    critical_path->set_step_id(id_and_step.first);
+    ComputeCriticalPath(step, host_names, critical_path);
+  }
+  return database;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,51 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_CRITICAL_PATH_H_
+#define TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_CRITICAL_PATH_H_
+
+#include <vector>
+
+#include "tensorflow/core/profiler/protobuf/critical_path.pb.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Extracts the critical path of each executor step from the host traces of
+// one or more hosts.
+//
+// A TF op belongs to the step of the ExecutorState::Process event enclosing
+// it, i.e. the consumer of the kTfExecutor context produced for that step.
+// The executor does not trace the edges of the graph, so an op is assumed to
+// depend on the op of the same step and host that finished last before it
+// started. Across hosts, an op may also depend on a _Send whose "from" and
+// "to" match a _Recv of the same step on its host, in which case the gap
+// before it is reported as a transfer. The critical path is found by walking
+// these dependencies back from the last op of the step to finish.
+//
+// The hosts' clocks are assumed to be synchronized.
+CriticalPathDatabase ConvertXSpacesToCriticalPaths(
+    const std::vector<const XSpace*>& spaces);
+
+inline CriticalPathDatabase ConvertXSpaceToCriticalPaths(
+    const XSpace& space) {
+  return ConvertXSpacesToCriticalPaths({&space});
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_CRITICAL_PATH_H_
@@ -0,0 +1,165 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/profiler/convert/xplane_to_critical_path.h"
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/profiler/lib/context_types.h"
+#include "tensorflow/core/profiler/protobuf/critical_path.pb.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+#include "tensorflow/core/profiler/utils/math_utils.h"
+#include "tensorflow/core/profiler/utils/xplane_builder.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_test_utils.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+void CreateProcessEvent(XPlaneBuilder* plane, XLineBuilder* line,
+                        int64_t step_id, int64_t start_ms,
+                        int64_t duration_ms) {
+  CreateXEvent(plane, line, HostEventType::kExecutorStateProcess,
+               MilliToPico(start_ms), MilliToPico(duration_ms),
+               {{StatType::kConsumerType,
+                 static_cast<int64_t>(ContextType::kTfExecutor)},
+                {StatType::kConsumerId, step_id}});
+}
+
+void CreateOpEvent(XPlaneBuilder* plane, XLineBuilder* line,
+                   absl::string_view name, int64_t start_ms,
+                   int64_t duration_ms) {
+  CreateXEvent(plane, line, name, MilliToPico(start_ms),
+               MilliToPico(duration_ms));
+}
+
+// Creates a _Send or _Recv with the stats parsed from its TraceString.
+void CreateSendRecvEvent(XPlaneBuilder* plane, XLineBuilder* line,
+                         absl::string_view name, absl::string_view from,
+                         absl::string_view to, int64_t start_ms,
+                         int64_t duration_ms) {
+  XEventBuilder event = line->AddEvent(*plane->GetOrCreateEventMetadata(name));
+  event.SetOffsetPs(MilliToPico(start_ms));
+  event.SetDurationPs(MilliToPico(duration_ms));
+  event.AddStatValue(*plane->GetOrCreateStatMetadata("from"), from);
+  event.AddStatValue(*plane->GetOrCreateStatMetadata("to"), to);
+}
+
+TEST(ConvertXSpaceToCriticalPaths, SingleHost) {
+  XSpace space;
+  XPlaneBuilder host_plane(GetOrCreateHostXPlane(&space));
+  XLineBuilder thread1 = host_plane.GetOrCreateLine(/*line_id=*/1);
+  CreateProcessEvent(&host_plane, &thread1, /*step_id=*/1, 0, 100);
+  CreateOpEvent(&host_plane, &thread1, "a:MatMul", 0, 40);
+  CreateOpEvent(&host_plane, &thread1, "b:AddV2", 50, 10);
+  XLineBuilder thread2 = host_plane.GetOrCreateLine(/*line_id=*/2);
+  CreateProcessEvent(&host_plane, &thread2, /*step_id=*/1, 40, 60);
+  CreateOpEvent(&host_plane, &thread2, "c:Conv2D", 45, 45);
+  // Ops outside of any step are ignored.
+  CreateOpEvent(&host_plane, &thread2, "d:Relu", 200, 10);
+
+  CriticalPathDatabase database = ConvertXSpaceToCriticalPaths(space);
+  ASSERT_EQ(database.step_size(), 1);
+  const StepCriticalPath& step = database.step(0);
+  EXPECT_EQ(step.step_id(), 1);
+  EXPECT_EQ(step.step_time_ps(), MilliToPico(90));
+  EXPECT_EQ(step.op_time_ps(), MilliToPico(85));
+  EXPECT_EQ(step.idle_time_ps(), MilliToPico(5));
+
+  ASSERT_EQ(step.op_size(), 2);
+  EXPECT_EQ(step.op(0).op_name(), "a");
+  EXPECT_EQ(step.op(0).host_name(), "host0");
+  EXPECT_EQ(step.op(1).op_name(), "c");
+  EXPECT_EQ(step.op(1).duration_ps(), MilliToPico(45));
+
+  ASSERT_EQ(step.category_size(), 2);
+  EXPECT_EQ(step.category(0).op_type(), "Conv2D");
+  EXPECT_EQ(step.category(0).occurrences(), 1);
+  EXPECT_DOUBLE_EQ(step.category(0).fraction_of_step(), 0.5);
+  EXPECT_EQ(step.category(1).op_type(), "MatMul");
+
+  ASSERT_EQ(step.gap_size(), 1);
+  EXPECT_EQ(step.gap(0).kind(), CriticalPathGap::IDLE);
+  EXPECT_EQ(step.gap(0).before_op(), "a");
+  EXPECT_EQ(step.gap(0).after_op(), "c");
+  EXPECT_EQ(step.gap(0).start_ps(), MilliToPico(40));
+  EXPECT_EQ(step.gap(0).duration_ps(), MilliToPico(5));
+}
+
+TEST(ConvertXSpaceToCriticalPaths, IdleAtStepStart) {
+  XSpace space;
+  XPlaneBuilder host_plane(GetOrCreateHostXPlane(&space));
+  XLineBuilder thread = host_plane.GetOrCreateLine(/*line_id=*/1);
+  CreateProcessEvent(&host_plane, &thread, /*step_id=*/3, 0, 20);
+  CreateOpEvent(&host_plane, &thread, "a:MatMul", 5, 15);
+
+  CriticalPathDatabase database = ConvertXSpaceToCriticalPaths(space);
+  ASSERT_EQ(database.step_size(), 1);
+  const StepCriticalPath& step = database.step(0);
+  EXPECT_EQ(step.step_time_ps(), MilliToPico(20));
+  EXPECT_EQ(step.idle_time_ps(), MilliToPico(5));
+  ASSERT_EQ(step.gap_size(), 1);
+  EXPECT_EQ(step.gap(0).before_op(), "");
+  EXPECT_EQ(step.gap(0).after_op(), "a");
+}
+
+TEST(ConvertXSpacesToCriticalPaths, CrossWorkerSendRecv) {
+  XSpace worker0;
+  worker0.add_hostnames("worker0");
+  XPlaneBuilder plane0(GetOrCreateHostXPlane(&worker0));
+  XLineBuilder thread0 = plane0.GetOrCreateLine(/*line_id=*/1);
+  CreateProcessEvent(&plane0, &thread0, /*step_id=*/7, 0, 30);
+  CreateOpEvent(&plane0, &thread0, "x:MatMul", 0, 10);
+  CreateSendRecvEvent(&plane0, &thread0, "s:_Send", "x", "y", 10, 10);
+
+  XSpace worker1;
+  worker1.add_hostnames("worker1");
+  XPlaneBuilder plane1(GetOrCreateHostXPlane(&worker1));
+  XLineBuilder thread1 = plane1.GetOrCreateLine(/*line_id=*/1);
+  CreateProcessEvent(&plane1, &thread1, /*step_id=*/7, 0, 60);
+  CreateSendRecvEvent(&plane1, &thread1, "r:_Recv", "x", "y", 0, 1);
+  CreateOpEvent(&plane1, &thread1, "z:Identity", 1, 4);
+  CreateOpEvent(&plane1, &thread1, "y:AddV2", 35, 15);
+
+  CriticalPathDatabase database =
+      ConvertXSpacesToCriticalPaths({&worker0, &worker1});
+  ASSERT_EQ(database.step_size(), 1);
+  const StepCriticalPath& step = database.step(0);
+  EXPECT_EQ(step.step_id(), 7);
+  EXPECT_EQ(step.step_time_ps(), MilliToPico(50));
+  EXPECT_EQ(step.op_time_ps(), MilliToPico(35));
+  EXPECT_EQ(step.idle_time_ps(), MilliToPico(15));
+
+  ASSERT_EQ(step.op_size(), 3);
+  EXPECT_EQ(step.op(0).op_name(), "x");
+  EXPECT_EQ(step.op(0).host_name(), "worker0");
+  EXPECT_EQ(step.op(1).op_name(), "s");
+  EXPECT_EQ(step.op(2).op_name(), "y");
+  EXPECT_EQ(step.op(2).host_name(), "worker1");
+
+  ASSERT_EQ(step.gap_size(), 1);
+  EXPECT_EQ(step.gap(0).kind(), CriticalPathGap::TRANSFER);
+  EXPECT_EQ(step.gap(0).host_name(), "worker1");
+  EXPECT_EQ(step.gap(0).before_op(), "s");
+  EXPECT_EQ(step.gap(0).after_op(), "y");
+  EXPECT_EQ(step.gap(0).duration_ps(), MilliToPico(15));
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,190 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/profiler/convert/xplane_to_roofline_model.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/grappler/clusters/utils.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/convert/xplane_to_op_metrics_db.h"
+#include "tensorflow/core/profiler/convert/xplane_to_op_stats.h"
+#include "tensorflow/core/profiler/protobuf/op_metrics.pb.h"
+#include "tensorflow/core/profiler/utils/cost_utils.h"
+#include "tensorflow/core/profiler/utils/math_utils.h"
+#include "tensorflow/core/profiler/utils/op_metrics_db_utils.h"
+#include "tensorflow/core/profiler/utils/tf_op_utils.h"
+#include "tensorflow/core/profiler/utils/tf_xplane_visitor.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_utils.h"
+#include "tensorflow/core/profiler/utils/xplane_visitor.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+// Accumulated costs of all occurrences of a TF-op type.
+struct OpTypeCosts {
+  int64_t occurrences = 0;
+  uint64 time_ps = 0;
+  uint64 flops = 0;
+  uint64 bytes_accessed = 0;
+};
+
+using OpTypeCostsMap = absl::flat_hash_map<std::string, OpTypeCosts>;
+
+void CollectHostOpTypeCosts(const XPlane& host_plane,
+                            OpTypeCostsMap* op_type_costs) {
+  TfOpRoofLineCostEstimator cost_estimator;
+  XPlaneVisitor plane = CreateTfXPlaneVisitor(&host_plane);
+  plane.ForEachLine([&](const XLineVisitor& line) {
+    line.ForEachEvent([&](const XEventVisitor& event) {
+      TfOp tf_op = ParseTfOpFullname(event.Name());
+      if (tf_op.category != Category::kTensorFlow) return;
+      TfOpRoofLineCostEstimator::OpRoofLineStats costs =
+          cost_estimator.Predict(event);
+      OpTypeCosts& op_costs = (*op_type_costs)[tf_op.type];
+      ++op_costs.occurrences;
+      op_costs.time_ps += event.DurationPs();
+      op_costs.flops += costs.flops;
+      op_costs.bytes_accessed += costs.bytes_accessed;
+    });
+  });
+}
+
+void CollectDeviceOpTypeCosts(const XPlane& device_plane,
+                              OpTypeCostsMap* op_type_costs) {
+  OpMetricsDb op_metrics_db =
+      ConvertDeviceTraceXPlaneToOpMetricsDb(device_plane);
+  for (const OpMetrics& metrics : op_metrics_db.metrics_db()) {
+    if (IsIdleOp(metrics)) continue;
+    OpTypeCosts& op_costs = (*op_type_costs)[metrics.category()];
+    op_costs.occurrences += metrics.occurrences();
+    op_costs.time_ps += metrics.time_ps();
+    op_costs.flops += metrics.flops();
+    op_costs.bytes_accessed += metrics.bytes_accessed();
+  }
+}
+
+void AddRooflineModelRecords(absl::string_view host_or_device,
+                             const PerfEnv& perf_env,
+                             const OpTypeCostsMap& op_type_costs,
+                             std::vector<RooflineModelRecord>* records) {
+  const double peak_giga_flops_per_second =
+      TeraToGiga(perf_env.peak_tera_flops_per_second());
+  const double peak_giga_bytes_per_second =
+      perf_env.peak_hbm_bw_giga_bytes_per_second();
+  for (const auto& op_type_and_costs : op_type_costs) {
+    const OpTypeCosts& costs = op_type_and_costs.second;
+    RooflineModelRecord record;
+    record.set_host_or_device(std::string(host_or_device));
+    record.set_op_type(op_type_and_costs.first);
+    record.set_occurrences(costs.occurrences);
+    record.set_total_time_in_us(PicoToMicro(costs.time_ps));
+    record.set_flops(costs.flops);
+    record.set_bytes_accessed(costs.bytes_accessed);
+    // FLOPs per ns and bytes per ns are GFLOP/s and GB/s.
+    const double time_ns = PicoToNano(costs.time_ps);
+    record.set_measured_flop_rate(SafeDivide(costs.flops, time_ns));
+    record.set_measured_memory_bw(SafeDivide(costs.bytes_accessed, time_ns));
+    record.set_operational_intensity(
+        SafeDivide(costs.flops, costs.bytes_accessed));
+    if (costs.flops == 0 && costs.bytes_accessed == 0) {
+      // The cost model does not support this op type.
+      record.set_bound_by("Unknown");
+    } else {
+      record.set_bound_by(
+          (costs.bytes_accessed != 0 &&
+           record.operational_intensity() < perf_env.ridge_point())
+              ? "Memory"
+              : "Compute");
+      // At the roofline, the op takes as long as the slower of its compute
+      // and its memory accesses at peak throughput.
+      const double roofline_time_ns = std::max(
+          SafeDivide(costs.flops, peak_giga_flops_per_second),
+          SafeDivide(costs.bytes_accessed, peak_giga_bytes_per_second));
+      record.set_roofline_efficiency(
+          std::min(1.0, SafeDivide(roofline_time_ns, time_ns)));
+      record.set_potential_savings_in_us(
+          NanoToMicro(std::max(0.0, time_ns - roofline_time_ns)));
+    }
+    records->push_back(std::move(record));
+  }
+}
+
+}  // namespace
+
+PerfEnv GetLocalHostPerfEnv() {
+  grappler::OpLevelCostEstimator cost_estimator;
+  grappler::DeviceInfo device_info =
+      cost_estimator.GetDeviceInfo(grappler::GetLocalCPUInfo());
+  return MakePerfEnv(GigaToTera(device_info.gigaops), device_info.gb_per_sec);
+}
+
+RooflineModelDatabase ConvertXSpaceToRooflineModel(
+    const XSpace& space, const RooflineModelOptions& options) {
+  RooflineModelDatabase roofline_model;
+  std::vector<RooflineModelRecord> records;
+
+  if (const XPlane* host_plane =
+          FindPlaneWithName(space, kHostThreadsPlaneName)) {
+    *roofline_model.mutable_host_perf_env() =
+        options.host_perf_env.has_value() ? *options.host_perf_env
+                                          : GetLocalHostPerfEnv();
+    OpTypeCostsMap host_op_type_costs;
+    CollectHostOpTypeCosts(*host_plane, &host_op_type_costs);
+    AddRooflineModelRecords("Host", roofline_model.host_perf_env(),
+                            host_op_type_costs, &records);
+  }
+
+  std::vector<const XPlane*> device_planes =
+      FindPlanesWithPrefix(space, kGpuPlanePrefix);
+  if (!device_planes.empty()) {
+    // Device time is accumulated over all devices, so ops are measured
+    // against the peak of a single device.
+    *roofline_model.mutable_device_perf_env() =
+        GetPerfEnvFromXPlane(*device_planes.front());
+    OpTypeCostsMap device_op_type_costs;
+    for (const XPlane* device_plane : device_planes) {
+      CollectDeviceOpTypeCosts(*device_plane, &device_op_type_costs);
+    }
+    AddRooflineModelRecords("Device", roofline_model.device_perf_env(),
+                            device_op_type_costs, &records);
+  }
+
+  absl::c_stable_sort(records, [](const RooflineModelRecord& a,
+                                  const RooflineModelRecord& b) {
+    if (a.potential_savings_in_us() != b.potential_savings_in_us()) {
+      return a.potential_savings_in_us() > b.potential_savings_in_us();
+    }
+    return a.total_time_in_us() > b.total_time_in_us();
+  });
+  uint64 rank = 0;
+  for (RooflineModelRecord& record : records) {
+    record.set_rank(++rank);
+    *roofline_model.add_roofline_model_record() = std::move(record);
+  }
+  return roofline_model;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
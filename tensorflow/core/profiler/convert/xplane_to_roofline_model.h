@@ -0,0 +1,48 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_ROOFLINE_MODEL_H_
+#define TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_ROOFLINE_MODEL_H_
+
+#include "absl/types/optional.h"
+#include "tensorflow/core/profiler/protobuf/op_stats.pb.h"
+#include "tensorflow/core/profiler/protobuf/roofline_model.pb.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+struct RooflineModelOptions {
+  // Peak performance of the host CPUs. If unset, it is detected on the local
+  // machine, so it should be set when converting a profile captured elsewhere.
+  absl::optional<PerfEnv> host_perf_env;
+};
+
+// Returns the peak performance of the local CPUs as seen by the grappler cost
+// model.
+PerfEnv GetLocalHostPerfEnv();
+
+// Classifies each TF-op type in space as compute or memory bound by combining
+// the FLOPs and bytes accessed estimated by the grappler cost model with the
+// measured time. Host ops are measured against the host peak and device ops
+// against the device peak. Records are ranked by the time that would be saved
+// if the op type ran at the roofline.
+RooflineModelDatabase ConvertXSpaceToRooflineModel(
+    const XSpace& space, const RooflineModelOptions& options = {});
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_CONVERT_XPLANE_TO_ROOFLINE_MODEL_H_
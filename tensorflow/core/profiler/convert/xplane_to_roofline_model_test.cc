@@ -0,0 +1,86 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/profiler/convert/xplane_to_roofline_model.h"
+
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/profiler/convert/xplane_to_op_stats.h"
+#include "tensorflow/core/profiler/protobuf/roofline_model.pb.h"
+#include "tensorflow/core/profiler/protobuf/xplane.pb.h"
+#include "tensorflow/core/profiler/utils/math_utils.h"
+#include "tensorflow/core/profiler/utils/xplane_builder.h"
+#include "tensorflow/core/profiler/utils/xplane_schema.h"
+#include "tensorflow/core/profiler/utils/xplane_test_utils.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+TEST(ConvertXSpaceToRooflineModel, HostOps) {
+  XSpace space;
+  XPlaneBuilder host_plane(GetOrCreateHostXPlane(&space));
+  XLineBuilder thread = host_plane.GetOrCreateLine(/*line_id=*/10);
+  CreateXEvent(&host_plane, &thread, "matmul:MatMul", /*offset_ps=*/0,
+               /*duration_ps=*/MilliToPico(100),
+               {{StatType::kTensorShapes,
+                 "(float[2048,2048];float[2048,2048])"}});
+  CreateXEvent(&host_plane, &thread, "add:AddV2",
+               /*offset_ps=*/MilliToPico(100),
+               /*duration_ps=*/MilliToPico(10),
+               {{StatType::kTensorShapes, "(float[1048576];float[1048576])"}});
+  CreateXEvent(&host_plane, &thread, "fancy:FancyOp",
+               /*offset_ps=*/MilliToPico(110),
+               /*duration_ps=*/MilliToPico(1));
+
+  RooflineModelOptions options;
+  // 1 TFLOP/s and 10 GB/s, so the ridge point is 100 FLOP/Byte.
+  options.host_perf_env = MakePerfEnv(1, 10);
+  RooflineModelDatabase roofline_model =
+      ConvertXSpaceToRooflineModel(space, options);
+
+  EXPECT_DOUBLE_EQ(roofline_model.host_perf_env().ridge_point(), 100);
+  EXPECT_FALSE(roofline_model.has_device_perf_env());
+  ASSERT_EQ(roofline_model.roofline_model_record_size(), 3);
+
+  const RooflineModelRecord& matmul = roofline_model.roofline_model_record(0);
+  EXPECT_EQ(matmul.rank(), 1);
+  EXPECT_EQ(matmul.host_or_device(), "Host");
+  EXPECT_EQ(matmul.op_type(), "MatMul");
+  EXPECT_EQ(matmul.occurrences(), 1);
+  EXPECT_GT(matmul.flops(), 0);
+  EXPECT_EQ(matmul.bound_by(), "Compute");
+  EXPECT_GT(matmul.roofline_efficiency(), 0);
+  EXPECT_LT(matmul.roofline_efficiency(), 1);
+  EXPECT_GT(matmul.potential_savings_in_us(), 0);
+
+  const RooflineModelRecord& add = roofline_model.roofline_model_record(1);
+  EXPECT_EQ(add.rank(), 2);
+  EXPECT_EQ(add.op_type(), "AddV2");
+  EXPECT_GT(add.bytes_accessed(), 0);
+  EXPECT_EQ(add.bound_by(), "Memory");
+  EXPECT_GT(add.potential_savings_in_us(), 0);
+  EXPECT_LT(add.potential_savings_in_us(), matmul.potential_savings_in_us());
+
+  // Ops without shapes cannot be analyzed.
+  const RooflineModelRecord& fancy = roofline_model.roofline_model_record(2);
+  EXPECT_EQ(fancy.rank(), 3);
+  EXPECT_EQ(fancy.op_type(), "FancyOp");
+  EXPECT_EQ(fancy.bound_by(), "Unknown");
+  EXPECT_EQ(fancy.potential_savings_in_us(), 0);
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,200 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/lib/allocation_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/profiler/lib/scoped_memory_debug_annotation.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+constexpr char kUnknown[] = "unknown";
+
+// The metrics are created on first use, as allocations may be sampled during
+// static initialization.
+monitoring::Gauge<int64_t, 3>* SampledBytesInUse() {
+  static auto* gauge = monitoring::Gauge<int64_t, 3>::New(
+      "/tensorflow/core/memory/sampled_bytes_in_use",
+      "Estimated bytes in use, by allocator, op type and region.", "allocator",
+      "op_type", "region");
+  return gauge;
+}
+
+monitoring::Counter<3>* SampledBytesAllocated() {
+  static auto* counter = monitoring::Counter<3>::New(
+      "/tensorflow/core/memory/sampled_bytes_allocated",
+      "Estimated bytes allocated, by allocator, op type and region.",
+      "allocator", "op_type", "region");
+  return counter;
+}
+
+// Returns the number of bytes until the calling thread's next sample.
+int64_t NextSampleDistance(int64_t sampling_interval_bytes) {
+  thread_local std::mt19937_64 rng(random::New64());
+  std::exponential_distribution<double> distribution(
+      1.0 / sampling_interval_bytes);
+  return static_cast<int64_t>(distribution(rng)) + 1;
+}
+
+}  // namespace
+
+AllocationSampler* AllocationSampler::Global() {
+  static AllocationSampler* sampler = new AllocationSampler();
+  return sampler;
+}
+
+AllocationSampler::AllocationSampler() {
+  int64_t sampling_interval_bytes;
+  Status s = ReadInt64FromEnvVar("TF_ALLOCATION_SAMPLING_INTERVAL_BYTES",
+                                 /*default_val=*/0, &sampling_interval_bytes);
+  if (!s.ok()) {
+    LOG(ERROR) << s;
+    sampling_interval_bytes = 0;
+  }
+  SetSamplingIntervalBytes(sampling_interval_bytes);
+}
+
+void AllocationSampler::SetSamplingIntervalBytes(
+    int64_t sampling_interval_bytes) {
+  sampling_interval_bytes_.store(std::max<int64_t>(sampling_interval_bytes, 0),
+                                 std::memory_order_relaxed);
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AllocationSampler::ShouldSample(size_t num_bytes) {
+  thread_local int64_t generation = -1;
+  thread_local int64_t bytes_until_sample = 0;
+  const int64_t current_generation =
+      generation_.load(std::memory_order_relaxed);
+  if (generation != current_generation) {
+    generation = current_generation;
+    const int64_t sampling_interval_bytes =
+        sampling_interval_bytes_.load(std::memory_order_relaxed);
+    if (sampling_interval_bytes <= 0) return false;
+    bytes_until_sample = NextSampleDistance(sampling_interval_bytes);
+  }
+  bytes_until_sample -= static_cast<int64_t>(num_bytes);
+  if (bytes_until_sample > 0) return false;
+  const int64_t sampling_interval_bytes =
+      sampling_interval_bytes_.load(std::memory_order_relaxed);
+  if (sampling_interval_bytes <= 0) return false;
+  bytes_until_sample = NextSampleDistance(sampling_interval_bytes);
+  return true;
+}
+
+void AllocationSampler::RecordSample(absl::string_view allocator_name,
+                                     const void* ptr, size_t num_bytes) {
+  const double sampling_interval_bytes =
+      sampling_interval_bytes_.load(std::memory_order_relaxed);
+  if (sampling_interval_bytes <= 0) return;
+  // With exponentially distributed sample distances, an allocation is sampled
+  // with probability 1 - exp(-num_bytes / interval).
+  const double probability =
+      -std::expm1(-(num_bytes / sampling_interval_bytes));
+  if (probability <= 0) return;
+  const int64_t bytes = std::llround(num_bytes / probability);
+
+  const MemoryDebugAnnotation& annotation =
+      ScopedMemoryDebugAnnotation::CurrentAnnotation();
+  const char* op_type = annotation.pending_op_type != nullptr
+                            ? annotation.pending_op_type
+                            : kUnknown;
+  const char* region_type = annotation.pending_region_type != nullptr
+                                ? annotation.pending_region_type
+                                : kUnknown;
+
+  int key_index;
+  {
+    mutex_lock l(mu_);
+    const std::string key =
+        absl::StrCat(allocator_name, "\n", op_type, "\n", region_type);
+    auto it = key_indices_.find(key);
+    if (it == key_indices_.end()) {
+      Attribution attribution;
+      attribution.allocator_name = std::string(allocator_name);
+      attribution.op_type = op_type;
+      attribution.region_type = region_type;
+      attributions_.push_back(std::move(attribution));
+      it = key_indices_.emplace(key, attributions_.size() - 1).first;
+    }
+    key_index = it->second;
+    Attribution& attribution = attributions_[key_index];
+    attribution.bytes_in_use += bytes;
+    attribution.bytes_allocated += bytes;
+    SampledBytesInUse()
+        ->GetCell(attribution.allocator_name, attribution.op_type,
+                  attribution.region_type)
+        ->Set(attribution.bytes_in_use);
+    SampledBytesAllocated()
+        ->GetCell(attribution.allocator_name, attribution.op_type,
+                  attribution.region_type)
+        ->IncrementBy(bytes);
+  }
+
+  // A sample left behind by an allocator that does not report deallocations
+  // is superseded when its address is reused.
+  ReleaseSample(ptr);
+  SampleShard& shard = ShardFor(ptr);
+  mutex_lock l(shard.mu);
+  shard.samples[ptr] = Sample{key_index, bytes};
+  num_live_samples_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationSampler::ReleaseSample(const void* ptr) {
+  Sample sample;
+  {
+    SampleShard& shard = ShardFor(ptr);
+    mutex_lock l(shard.mu);
+    auto it = shard.samples.find(ptr);
+    if (it == shard.samples.end()) return;
+    sample = it->second;
+    shard.samples.erase(it);
+  }
+  num_live_samples_.fetch_sub(1, std::memory_order_relaxed);
+
+  mutex_lock l(mu_);
+  Attribution& attribution = attributions_[sample.key_index];
+  attribution.bytes_in_use -= sample.bytes;
+  SampledBytesInUse()
+      ->GetCell(attribution.allocator_name, attribution.op_type,
+                attribution.region_type)
+      ->Set(attribution.bytes_in_use);
+}
+
+AllocationSampler::SampleShard& AllocationSampler::ShardFor(const void* ptr) {
+  // Allocations are at least 16-byte aligned, so the low bits carry no
+  // information.
+  return shards_[(reinterpret_cast<uintptr_t>(ptr) >> 4) % kNumSampleShards];
+}
+
+std::vector<AllocationSampler::Attribution>
+AllocationSampler::GetAttributions() const {
+  mutex_lock l(mu_);
+  return attributions_;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
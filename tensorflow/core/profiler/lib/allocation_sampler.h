@@ -0,0 +1,127 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_PROFILER_LIB_ALLOCATION_SAMPLER_H_
+#define TENSORFLOW_CORE_PROFILER_LIB_ALLOCATION_SAMPLER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Live attribution of allocated memory to the op type and region (e.g.
+// "output" or "temp") that requested it, as tagged by
+// ScopedMemoryDebugAnnotation.
+//
+// Allocators report every allocation and deallocation, but only a sample of
+// allocations is recorded: on average one every `sampling_interval_bytes`
+// bytes, each weighted by the inverse of its probability of being sampled so
+// that the totals are unbiased. Unsampled calls only count down a thread-local
+// byte budget, and sampling is off unless TF_ALLOCATION_SAMPLING_INTERVAL_BYTES
+// is set or `SetSamplingIntervalBytes` is called.
+//
+// The estimates are exported through the monitoring collection registry as
+// /tensorflow/core/memory/sampled_bytes_in_use and
+// /tensorflow/core/memory/sampled_bytes_allocated, labelled by allocator, op
+// type and region, so that they can be scraped from a running server.
+class AllocationSampler {
+ public:
+  // Estimated memory attributed to one (allocator, op type, region) triple.
+  struct Attribution {
+    std::string allocator_name;
+    std::string op_type;
+    std::string region_type;
+    int64_t bytes_in_use = 0;
+    // Cumulative, for computing allocation rates.
+    int64_t bytes_allocated = 0;
+  };
+
+  // Returns the process-wide sampler.
+  static AllocationSampler* Global();
+
+  // Returns true if allocations are being sampled.
+  bool enabled() const {
+    return sampling_interval_bytes_.load(std::memory_order_relaxed) > 0;
+  }
+
+  // Sets the mean number of bytes between samples. 0 disables sampling.
+  // Allocations sampled before the change are still released on deallocation.
+  void SetSamplingIntervalBytes(int64_t sampling_interval_bytes);
+
+  // Reports that `allocator_name` allocated `num_bytes` at `ptr`, on behalf of
+  // the current ScopedMemoryDebugAnnotation.
+  void RecordAllocation(absl::string_view allocator_name, const void* ptr,
+                        size_t num_bytes) {
+    if (ptr == nullptr || !enabled()) return;
+    if (ShouldSample(num_bytes)) RecordSample(allocator_name, ptr, num_bytes);
+  }
+
+  // Reports that the allocation at `ptr` was freed.
+  void RecordDeallocation(const void* ptr) {
+    if (ptr == nullptr ||
+        num_live_samples_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    ReleaseSample(ptr);
+  }
+
+  // Returns the current estimates, one per triple seen since startup.
+  std::vector<Attribution> GetAttributions() const;
+
+ private:
+  struct Sample {
+    int key_index;
+    int64_t bytes;
+  };
+
+  struct SampleShard {
+    mutex mu;
+    absl::flat_hash_map<const void*, Sample> samples TF_GUARDED_BY(mu);
+  };
+
+  static constexpr int kNumSampleShards = 16;
+
+  AllocationSampler();
+
+  // Counts `num_bytes` down the calling thread's budget until the next sample.
+  bool ShouldSample(size_t num_bytes);
+  void RecordSample(absl::string_view allocator_name, const void* ptr,
+                    size_t num_bytes);
+  void ReleaseSample(const void* ptr);
+  SampleShard& ShardFor(const void* ptr);
+
+  std::atomic<int64_t> sampling_interval_bytes_{0};
+  // Bumped by SetSamplingIntervalBytes so that threads redraw their budget.
+  std::atomic<int64_t> generation_{0};
+  std::atomic<int64_t> num_live_samples_{0};
+  SampleShard shards_[kNumSampleShards];
+
+  mutable mutex mu_;
+  std::vector<Attribution> attributions_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, int> key_indices_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_LIB_ALLOCATION_SAMPLER_H_
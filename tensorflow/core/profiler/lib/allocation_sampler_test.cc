@@ -0,0 +1,158 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/lib/allocation_sampler.h"
+
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/profiler/lib/scoped_memory_debug_annotation.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+using monitoring::testing::CellReader;
+
+const void* FakePointer(int64_t i) {
+  return reinterpret_cast<const void*>(static_cast<uintptr_t>(64 * (i + 1)));
+}
+
+AllocationSampler::Attribution FindAttribution(
+    const std::string& allocator_name, const std::string& op_type,
+    const std::string& region_type) {
+  for (const auto& attribution :
+       AllocationSampler::Global()->GetAttributions()) {
+    if (attribution.allocator_name == allocator_name &&
+        attribution.op_type == op_type &&
+        attribution.region_type == region_type) {
+      return attribution;
+    }
+  }
+  return AllocationSampler::Attribution();
+}
+
+class AllocationSamplerTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    AllocationSampler::Global()->SetSamplingIntervalBytes(0);
+  }
+};
+
+TEST_F(AllocationSamplerTest, DisabledByDefault) {
+  AllocationSampler* sampler = AllocationSampler::Global();
+  EXPECT_FALSE(sampler->enabled());
+  sampler->RecordAllocation("disabled", FakePointer(0), 1 << 20);
+  EXPECT_EQ(FindAttribution("disabled", "unknown", "unknown").bytes_allocated,
+            0);
+}
+
+TEST_F(AllocationSamplerTest, AttributesToAnnotatedOpType) {
+  AllocationSampler* sampler = AllocationSampler::Global();
+  // Every allocation much larger than the interval is sampled, at its size.
+  sampler->SetSamplingIntervalBytes(1);
+  {
+    ScopedMemoryDebugAnnotation annotation("my_matmul", "MatMul", 1, "output",
+                                           0, []() { return ""; });
+    sampler->RecordAllocation("annotated", FakePointer(0), 1024);
+    sampler->RecordAllocation("annotated", FakePointer(1), 1024);
+  }
+  sampler->RecordAllocation("annotated", FakePointer(2), 512);
+
+  AllocationSampler::Attribution matmul =
+      FindAttribution("annotated", "MatMul", "output");
+  EXPECT_EQ(matmul.bytes_in_use, 2048);
+  EXPECT_EQ(matmul.bytes_allocated, 2048);
+  EXPECT_EQ(FindAttribution("annotated", "unknown", "unknown").bytes_in_use,
+            512);
+
+  sampler->RecordDeallocation(FakePointer(0));
+  sampler->RecordDeallocation(FakePointer(2));
+  matmul = FindAttribution("annotated", "MatMul", "output");
+  EXPECT_EQ(matmul.bytes_in_use, 1024);
+  EXPECT_EQ(matmul.bytes_allocated, 2048);
+  EXPECT_EQ(FindAttribution("annotated", "unknown", "unknown").bytes_in_use,
+            0);
+  sampler->RecordDeallocation(FakePointer(1));
+}
+
+TEST_F(AllocationSamplerTest, ExportsMetrics) {
+  CellReader<int64_t> bytes_in_use(
+      "/tensorflow/core/memory/sampled_bytes_in_use");
+  CellReader<int64_t> bytes_allocated(
+      "/tensorflow/core/memory/sampled_bytes_allocated");
+  AllocationSampler* sampler = AllocationSampler::Global();
+  sampler->SetSamplingIntervalBytes(1);
+  {
+    ScopedMemoryDebugAnnotation annotation("my_conv", "Conv2D", 1, "temp", 0,
+                                           []() { return ""; });
+    sampler->RecordAllocation("exported", FakePointer(0), 4096);
+  }
+  EXPECT_EQ(bytes_in_use.Read("exported", "Conv2D", "temp"), 4096);
+  EXPECT_EQ(bytes_allocated.Delta("exported", "Conv2D", "temp"), 4096);
+
+  sampler->RecordDeallocation(FakePointer(0));
+  EXPECT_EQ(bytes_in_use.Read("exported", "Conv2D", "temp"), 0);
+  EXPECT_EQ(bytes_allocated.Delta("exported", "Conv2D", "temp"), 0);
+}
+
+TEST_F(AllocationSamplerTest, EstimatesAreUnbiased) {
+  AllocationSampler* sampler = AllocationSampler::Global();
+  sampler->SetSamplingIntervalBytes(1000);
+  // 1MB in 100 byte allocations, of which about 1000 are sampled.
+  constexpr int kNumAllocations = 10000;
+  for (int i = 0; i < kNumAllocations; ++i) {
+    sampler->RecordAllocation("estimated", FakePointer(i), 100);
+  }
+  AllocationSampler::Attribution attribution =
+      FindAttribution("estimated", "unknown", "unknown");
+  EXPECT_NEAR(attribution.bytes_allocated, 100 * kNumAllocations,
+              15 * kNumAllocations);
+
+  for (int i = 0; i < kNumAllocations; ++i) {
+    sampler->RecordDeallocation(FakePointer(i));
+  }
+  EXPECT_EQ(FindAttribution("estimated", "unknown", "unknown").bytes_in_use,
+            0);
+}
+
+TEST_F(AllocationSamplerTest, ReleasesSamplesAfterDisabling) {
+  AllocationSampler* sampler = AllocationSampler::Global();
+  sampler->SetSamplingIntervalBytes(1);
+  sampler->RecordAllocation("disabling", FakePointer(0), 1024);
+  sampler->SetSamplingIntervalBytes(0);
+  sampler->RecordDeallocation(FakePointer(0));
+  EXPECT_EQ(FindAttribution("disabling", "unknown", "unknown").bytes_in_use,
+            0);
+}
+
+void BM_RecordAllocation(::testing::benchmark::State& state) {
+  AllocationSampler* sampler = AllocationSampler::Global();
+  sampler->SetSamplingIntervalBytes(state.range(0));
+  int64_t i = 0;
+  for (auto s : state) {
+    sampler->RecordAllocation("benchmark", FakePointer(i % 1024), 256);
+    sampler->RecordDeallocation(FakePointer(i % 1024));
+    ++i;
+  }
+  sampler->SetSamplingIntervalBytes(0);
+}
+BENCHMARK(BM_RecordAllocation)->Arg(0)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,151 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/lib/mutex_contention_profiler.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/debugging/symbolize.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/profiler/backends/cpu/traceme_recorder.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/profiler/utils/time_utils.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+constexpr char kUnknown[] = "unknown";
+
+auto* contentions = monitoring::Counter<2>::New(
+    "/tensorflow/core/mutex/contentions",
+    "The number of contended acquisitions of a profiled mutex, by mutex and "
+    "by the call site holding it.",
+    "mutex", "holder");
+
+auto* contention_wait_usecs = monitoring::Counter<2>::New(
+    "/tensorflow/core/mutex/contention_wait_usecs",
+    "The time spent waiting for a profiled mutex, by mutex and by the call "
+    "site holding it.",
+    "mutex", "holder");
+
+bool EnableFromEnv() {
+  bool enabled;
+  Status s = ReadBoolFromEnvVar("TF_MUTEX_CONTENTION_PROFILING",
+                                /*default_val=*/false, &enabled);
+  if (!s.ok()) {
+    LOG(ERROR) << s;
+    return false;
+  }
+  if (enabled) MutexContentionProfiler::Global()->Enable();
+  return enabled;
+}
+
+const bool enabled_from_env TF_ATTRIBUTE_UNUSED = EnableFromEnv();
+
+}  // namespace
+
+MutexContentionProfiler* MutexContentionProfiler::Global() {
+  static MutexContentionProfiler* profiler = new MutexContentionProfiler();
+  return profiler;
+}
+
+void MutexContentionProfiler::Enable() {
+  SetMutexContentionHandler(&HandleContention);
+}
+
+void MutexContentionProfiler::Disable() {
+  if (enabled()) SetMutexContentionHandler(nullptr);
+}
+
+bool MutexContentionProfiler::enabled() const {
+  return internal::mutex_contention_handler().load(
+             std::memory_order_relaxed) == &HandleContention;
+}
+
+void MutexContentionProfiler::HandleContention(
+    const MutexContention& contention) {
+  Global()->RecordContention(contention);
+}
+
+void MutexContentionProfiler::RecordContention(
+    const MutexContention& contention) {
+  const int64_t end_time = GetCurrentTimeNanos();
+  std::string holder;
+  std::string waiter;
+  {
+    mutex_lock l(mu_);
+    holder = Symbolize(contention.holder_pc);
+    waiter = Symbolize(contention.waiter_pc);
+    auto it = indices_.find(std::make_tuple(std::string(contention.name),
+                                            contention.holder_pc));
+    if (it == indices_.end()) {
+      Contention entry;
+      entry.mutex_name = contention.name;
+      entry.holder = holder;
+      contentions_.push_back(std::move(entry));
+      it = indices_
+               .emplace(std::make_tuple(std::string(contention.name),
+                                        contention.holder_pc),
+                        contentions_.size() - 1)
+               .first;
+    }
+    Contention& entry = contentions_[it->second];
+    ++entry.contentions;
+    entry.wait_nanos += contention.wait_nanos;
+  }
+
+  contentions->GetCell(contention.name, holder)->IncrementBy(1);
+  contention_wait_usecs->GetCell(contention.name, holder)
+      ->IncrementBy(contention.wait_nanos / 1000);
+  if (TraceMeRecorder::Active(static_cast<int>(TraceMeLevel::kInfo))) {
+    TraceMeRecorder::Record({TraceMeEncode("MutexContention",
+                                           {{"mutex", contention.name},
+                                            {"holder", holder},
+                                            {"waiter", waiter}}),
+                             end_time - contention.wait_nanos, end_time});
+  }
+}
+
+const std::string& MutexContentionProfiler::Symbolize(uintptr_t pc) {
+  auto it = symbols_.find(pc);
+  if (it != symbols_.end()) return it->second;
+  std::string symbol;
+  char buffer[1024];
+  if (pc == 0) {
+    symbol = kUnknown;
+  } else if (absl::Symbolize(reinterpret_cast<const void*>(pc), buffer,
+                             sizeof(buffer))) {
+    symbol = buffer;
+  } else {
+    symbol = absl::StrCat("0x", absl::Hex(pc));
+  }
+  return symbols_.emplace(pc, std::move(symbol)).first->second;
+}
+
+std::vector<MutexContentionProfiler::Contention>
+MutexContentionProfiler::GetContentions() const {
+  mutex_lock l(mu_);
+  return contentions_;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
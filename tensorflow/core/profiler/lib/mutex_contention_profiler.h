@@ -0,0 +1,85 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_PROFILER_LIB_MUTEX_CONTENTION_PROFILER_H_
+#define TENSORFLOW_CORE_PROFILER_LIB_MUTEX_CONTENTION_PROFILER_H_
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Aggregates the contention reported by every profiled_mutex (see
+// tensorflow/core/platform/mutex.h) by mutex name and by the call site that
+// held the mutex while others waited for it. Every contended acquisition is
+// recorded; none are sampled.
+//
+// Profiling is off unless TF_MUTEX_CONTENTION_PROFILING is set or `Enable` is
+// called. While it is on, the totals are exported through the monitoring
+// collection registry as /tensorflow/core/mutex/contentions and
+// /tensorflow/core/mutex/contention_wait_usecs, labelled by mutex and holder,
+// and each wait is recorded as a "MutexContention" TraceMe, which appears in
+// the host XPlane of a profile captured at the same time.
+class MutexContentionProfiler {
+ public:
+  // Contention on one mutex while held by one call site.
+  struct Contention {
+    std::string mutex_name;
+    // The symbolized holder call site, or its address if it can't be
+    // symbolized, or "unknown".
+    std::string holder;
+    int64_t contentions = 0;
+    int64_t wait_nanos = 0;
+  };
+
+  // Returns the process-wide profiler.
+  static MutexContentionProfiler* Global();
+
+  // Starts or stops profiling every profiled_mutex in the process.
+  void Enable();
+  void Disable();
+  bool enabled() const;
+
+  // Aggregates one contended acquisition. Called by the installed handler.
+  void RecordContention(const MutexContention& contention);
+
+  // Returns the totals, one per (mutex, holder) pair seen since startup.
+  std::vector<Contention> GetContentions() const;
+
+ private:
+  MutexContentionProfiler() = default;
+
+  static void HandleContention(const MutexContention& contention);
+
+  // Returns the name of the function containing `pc`, cached.
+  const std::string& Symbolize(uintptr_t pc) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable mutex mu_;
+  std::vector<Contention> contentions_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::tuple<std::string, uintptr_t>, int> indices_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<uintptr_t, std::string> symbols_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PROFILER_LIB_MUTEX_CONTENTION_PROFILER_H_
@@ -0,0 +1,149 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/profiler/lib/mutex_contention_profiler.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/profiler/backends/cpu/traceme_recorder.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+using monitoring::testing::CellReader;
+
+MutexContentionProfiler::Contention FindContention(
+    const std::string& mutex_name) {
+  MutexContentionProfiler::Contention total;
+  for (const auto& contention :
+       MutexContentionProfiler::Global()->GetContentions()) {
+    if (contention.mutex_name == mutex_name) {
+      total.mutex_name = contention.mutex_name;
+      total.holder = contention.holder;
+      total.contentions += contention.contentions;
+      total.wait_nanos += contention.wait_nanos;
+    }
+  }
+  return total;
+}
+
+class MutexContentionProfilerTest : public ::testing::Test {
+ protected:
+  void TearDown() override { MutexContentionProfiler::Global()->Disable(); }
+};
+
+TEST_F(MutexContentionProfilerTest, DisabledByDefault) {
+  EXPECT_FALSE(MutexContentionProfiler::Global()->enabled());
+  MutexContentionProfiler::Global()->Enable();
+  EXPECT_TRUE(MutexContentionProfiler::Global()->enabled());
+  MutexContentionProfiler::Global()->Disable();
+  EXPECT_FALSE(MutexContentionProfiler::Global()->enabled());
+}
+
+TEST_F(MutexContentionProfilerTest, AggregatesByMutexAndHolder) {
+  MutexContentionProfiler* profiler = MutexContentionProfiler::Global();
+  profiler->RecordContention({"aggregated", 0, 0, 1000});
+  profiler->RecordContention({"aggregated", 0, 0, 3000});
+  MutexContentionProfiler::Contention contention =
+      FindContention("aggregated");
+  EXPECT_EQ(contention.holder, "unknown");
+  EXPECT_EQ(contention.contentions, 2);
+  EXPECT_EQ(contention.wait_nanos, 4000);
+}
+
+TEST_F(MutexContentionProfilerTest, ExportsMetrics) {
+  CellReader<int64_t> contentions("/tensorflow/core/mutex/contentions");
+  CellReader<int64_t> wait_usecs(
+      "/tensorflow/core/mutex/contention_wait_usecs");
+  MutexContentionProfiler::Global()->RecordContention(
+      {"exported", 0, 0, 5000});
+  EXPECT_EQ(contentions.Delta("exported", "unknown"), 1);
+  EXPECT_EQ(wait_usecs.Delta("exported", "unknown"), 5);
+}
+
+TEST_F(MutexContentionProfilerTest, RecordsTraceMeWhileTracing) {
+  ASSERT_TRUE(TraceMeRecorder::Start(static_cast<int>(TraceMeLevel::kInfo)));
+  MutexContentionProfiler::Global()->RecordContention(
+      {"traced", 0, 0, 2000});
+  TraceMeRecorder::Events events = TraceMeRecorder::Stop();
+
+  int num_contentions = 0;
+  for (const auto& thread : events) {
+    for (const auto& event : thread.events) {
+      if (absl::StartsWith(event.name, "MutexContention#") &&
+          absl::StrContains(event.name, "mutex=traced")) {
+        ++num_contentions;
+        EXPECT_EQ(event.end_time - event.start_time, 2000);
+      }
+    }
+  }
+  EXPECT_EQ(num_contentions, 1);
+}
+
+TEST_F(MutexContentionProfilerTest, ProfilesContendedMutex) {
+  profiled_mutex mu("contended");
+  MutexContentionProfiler::Global()->Enable();
+  // The waiter is usually blocked by the time the holder releases the mutex,
+  // but retry in case it is not.
+  for (int attempt = 0;
+       attempt < 10 && FindContention("contended").contentions == 0;
+       ++attempt) {
+    Notification held;
+    std::unique_ptr<Thread> holder(Env::Default()->StartThread(
+        ThreadOptions(), "holder", [&mu, &held]() {
+          mutex_lock l(mu);
+          held.Notify();
+          Env::Default()->SleepForMicros(50 * 1000);
+        }));
+    held.WaitForNotification();
+    { mutex_lock l(mu); }
+  }
+  MutexContentionProfiler::Contention contention = FindContention("contended");
+  EXPECT_GT(contention.contentions, 0);
+  EXPECT_GT(contention.wait_nanos, 0);
+  EXPECT_NE(contention.holder, "unknown");
+}
+
+TEST_F(MutexContentionProfilerTest, IgnoresUncontendedMutex) {
+  profiled_mutex mu("uncontended");
+  MutexContentionProfiler::Global()->Enable();
+  { mutex_lock l(mu); }
+  { tf_shared_lock l(mu); }
+  EXPECT_EQ(FindContention("uncontended").contentions, 0);
+}
+
+void BM_ProfiledMutexLock(::testing::benchmark::State& state) {
+  if (state.range(0)) MutexContentionProfiler::Global()->Enable();
+  profiled_mutex mu("benchmark");
+  for (auto s : state) {
+    mutex_lock l(mu);
+  }
+  MutexContentionProfiler::Global()->Disable();
+}
+BENCHMARK(BM_ProfiledMutexLock)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
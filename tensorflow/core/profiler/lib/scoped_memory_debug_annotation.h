@@ -28,6 +28,8 @@ namespace profiler {
 // memory, and some allocators will try to tag allocations with the annotations.
 struct MemoryDebugAnnotation {
   const char* pending_op_name = nullptr;
+  // The type of the op named by `pending_op_name`, if known.
+  const char* pending_op_type = nullptr;
   int64_t pending_step_id = 0;
   const char* pending_region_type = nullptr;
   int32_t pending_data_type = 0;
@@ -90,6 +92,21 @@ class ScopedMemoryDebugAnnotation {
     thread_local_annotation->pending_shape_func = std::move(pending_shape_func);
   }
 
+  explicit ScopedMemoryDebugAnnotation(
+      const char* op_name, const char* op_type, int64_t step_id,
+      const char* region_type, int32_t data_type,
+      std::function<std::string()>&& pending_shape_func) {
+    MemoryDebugAnnotation* thread_local_annotation =
+        ThreadMemoryDebugAnnotation();
+    last_annotation_ = *thread_local_annotation;
+    thread_local_annotation->pending_op_name = op_name;
+    thread_local_annotation->pending_op_type = op_type;
+    thread_local_annotation->pending_step_id = step_id;
+    thread_local_annotation->pending_region_type = region_type;
+    thread_local_annotation->pending_data_type = data_type;
+    thread_local_annotation->pending_shape_func = std::move(pending_shape_func);
+  }
+
   ~ScopedMemoryDebugAnnotation() {
     *ThreadMemoryDebugAnnotation() = last_annotation_;
   }
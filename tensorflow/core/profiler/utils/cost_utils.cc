@@ -100,6 +100,12 @@ TfOpRoofLineCostEstimator::OpRoofLineStats TfOpRoofLineCostEstimator::Predict(
     }
   });
 
+  // TF ops traced on the host are named by their TraceMe instead of a stat.
+  if (tf_op.type.empty()) {
+    TfOp host_tf_op = ParseTfOpFullname(event.Name());
+    if (host_tf_op.category != Category::kUnknown) tf_op = host_tf_op;
+  }
+
   // Return empty OpRoofLineStats if shape is not traced or this is not a tf op.
   if (tf_op.type.empty() || tensor_shapes.empty()) {
     return {0ULL, 0ULL, /*inaccurate=*/true};
@@ -17,7 +17,10 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <utility>
 
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/common_runtime/eager/context.h"
 #include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/framework/function.h"
@@ -33,6 +36,25 @@ limitations under the License.
 namespace tensorflow {
 namespace tfd {
 
+// FallbackKernelCostRecorder is set in the RequestContext of requests sampled
+// for cost profiling. It receives the op type and the execution time of every
+// fallback kernel run by the request, and may be called from multiple threads.
+class FallbackKernelCostRecorder {
+ public:
+  using RecordFn =
+      std::function<void(absl::string_view op_type, absl::Duration duration)>;
+
+  explicit FallbackKernelCostRecorder(RecordFn record_fn)
+      : record_fn_(std::move(record_fn)) {}
+
+  void Record(absl::string_view op_type, absl::Duration duration) const {
+    record_fn_(op_type, duration);
+  }
+
+ private:
+  RecordFn record_fn_;
+};
+
 // FallbackResourceArray holds the tensors that are computed only once during
 // initialization and read-only afterwards.
 class FallbackResourceArray {
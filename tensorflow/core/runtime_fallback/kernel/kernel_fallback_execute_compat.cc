@@ -17,6 +17,8 @@ limitations under the License.
 #include <optional>
 #include <string>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "llvm/ADT/StringRef.h"
 #include "tensorflow/core/common_runtime/eager/context.h"
 #include "tensorflow/core/framework/logging.h"
@@ -257,13 +259,15 @@ OpKernelRunState& GetThreadLocalOpKernelRunState() {
 // Execute a tensorflow::OpKernel Asynchronously. `kernel_runner` and
 // `input_tf_tensors` are expected to be alive during the call to this function.
 // Set result AsyncValues in `results` and return a Chain that indicates the
-// execution completion of error otherwise.
+// execution completion of error otherwise. If `cost_recorder` is not null, the
+// time until the kernel is done is reported to it.
 template <typename TensorType>
 static void KernelFallbackExecuteCompatAsyncInternal(
     const tfrt::ExecutionContext& exec_ctx, OpKernelRunState* run_state,
     const OpKernelRunner& kernel_runner,
     tfrt::AsyncValueRef<tfrt::Chain>* op_chain,
-    llvm::MutableArrayRef<tfrt::RCReference<tfrt::AsyncValue>> results) {
+    llvm::MutableArrayRef<tfrt::RCReference<tfrt::AsyncValue>> results,
+    const FallbackKernelCostRecorder* cost_recorder = nullptr) {
   auto chain =
       tfrt::MakeUnconstructedAsyncValueRef<tfrt::Chain>(exec_ctx.host());
   if (op_chain) *op_chain = chain.CopyRef();
@@ -296,8 +300,13 @@ static void KernelFallbackExecuteCompatAsyncInternal(
 
   auto* context_ptr = &async_state->context;
 
-  auto done_callback = [async_state = std::move(async_state), exec_ctx]() {
+  auto done_callback = [async_state = std::move(async_state), exec_ctx,
+                        cost_recorder, start_time = absl::Now()]() {
     auto& context = async_state->context;
+    if (cost_recorder) {
+      cost_recorder->Record(context.op_kernel().type_string(),
+                            absl::Now() - start_time);
+    }
 
     if (!context.status().ok()) {
       auto diag = tfrt::EmitError(
@@ -564,15 +573,24 @@ TF_ATTRIBUTE_ALWAYS_INLINE static void KernelFallbackExecuteOpInternal(
 
   SetUpParams(kernel_runner, fallback_request_state, device, run_state);
 
+  // Only present in requests sampled for cost profiling.
+  const auto* cost_recorder =
+      exec_ctx.request_ctx()->GetDataIfExists<FallbackKernelCostRecorder>();
+
   if (is_async) {
     KernelFallbackExecuteCompatAsyncInternal<
         tensorflow::tfrt_stub::FallbackTensor>(
-        exec_ctx, &run_state, kernel_runner, op_chain, results);
+        exec_ctx, &run_state, kernel_runner, op_chain, results, cost_recorder);
   } else {
+    const absl::Time start_time = cost_recorder ? absl::Now() : absl::Time();
     KernelFallbackExecuteCompatSyncInternal<
         tensorflow::tfrt_stub::FallbackTensor>(
         exec_ctx, &fallback_request_state, &run_state, kernel_runner, op_chain,
         results);
+    if (cost_recorder) {
+      cost_recorder->Record(kernel_runner.op_kernel()->type_string(),
+                            absl::Now() - start_time);
+    }
   }
 }
 
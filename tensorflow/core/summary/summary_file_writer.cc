@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/summary/summary_file_writer.h"
 
+#include <deque>
+
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -22,6 +24,9 @@ limitations under the License.
 #include "tensorflow/core/framework/summary.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/summary/summary_converter.h"
 #include "tensorflow/core/util/events_writer.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -29,14 +34,33 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 
+auto* async_writer_dropped_events = monitoring::Counter<0>::New(
+    "/tensorflow/core/summary/async_writer_dropped_events",
+    "The number of summary events dropped because the queue of an async "
+    "summary file writer was full.");
+
+auto* async_writer_queue_depth = monitoring::Sampler<0>::New(
+    {"/tensorflow/core/summary/async_writer_queue_depth",
+     "The number of events pending in an async summary file writer when its "
+     "background thread picks them up."},
+    // Power of 2 with bucket count 16 (> 32k)
+    {monitoring::Buckets::Exponential(1, 2, 16)});
+
+auto* async_writer_write_latency_usecs = monitoring::Sampler<0>::New(
+    {"/tensorflow/core/summary/async_writer_write_latency_usecs",
+     "The time an async summary file writer spends writing and flushing one "
+     "batch of events in microseconds."},
+    // Power of 2 with bucket count 24 (> 16 seconds)
+    {monitoring::Buckets::Exponential(1, 2, 24)});
+
 class SummaryFileWriter : public SummaryWriterInterface {
  public:
   SummaryFileWriter(int max_queue, int flush_millis, Env* env)
       : SummaryWriterInterface(),
-        is_initialized_(false),
         max_queue_(max_queue),
         flush_millis_(flush_millis),
-        env_(env) {}
+        env_(env),
+        is_initialized_(false) {}
 
   Status Initialize(const string& logdir, const string& filename_suffix) {
     const Status is_dir = env_->IsDirectory(logdir);
@@ -161,28 +185,37 @@ class SummaryFileWriter : public SummaryWriterInterface {
 
   string DebugString() const override { return "SummaryFileWriter"; }
 
- private:
-  double GetWallTime() {
-    return static_cast<double>(env_->NowMicros()) / 1.0e6;
-  }
-
-  Status InternalFlush() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-    for (const std::unique_ptr<Event>& e : queue_) {
+ protected:
+  // Writes `events` and flushes the events file.
+  Status WriteEventsAndFlush(const std::vector<std::unique_ptr<Event>>& events)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    for (const std::unique_ptr<Event>& e : events) {
       events_writer_->WriteEvent(*e);
     }
-    queue_.clear();
     TF_RETURN_WITH_CONTEXT_IF_ERROR(events_writer_->Flush(),
                                     "Could not flush events file.");
     last_flush_ = env_->NowMicros();
     return OkStatus();
   }
 
-  bool is_initialized_;
   const int max_queue_;
   const int flush_millis_;
-  uint64 last_flush_;
   Env* env_;
   mutex mu_;
+
+ private:
+  double GetWallTime() {
+    return static_cast<double>(env_->NowMicros()) / 1.0e6;
+  }
+
+  Status InternalFlush() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const Status s = WriteEventsAndFlush(queue_);
+    queue_.clear();
+    return s;
+  }
+
+  bool is_initialized_;
+  uint64 last_flush_;
   std::vector<std::unique_ptr<Event>> queue_ TF_GUARDED_BY(mu_);
   // A pointer to allow deferred construction.
   std::unique_ptr<EventsWriter> events_writer_ TF_GUARDED_BY(mu_);
@@ -190,6 +223,153 @@ class SummaryFileWriter : public SummaryWriterInterface {
       TF_GUARDED_BY(mu_);
 };
 
+// A SummaryFileWriter whose file I/O happens on a background thread.
+//
+// WriteEvent only appends the event to `pending_` under `queue_mu_`, which is
+// never held across I/O. The background thread takes everything pending at
+// once and writes it as one batch followed by a single flush, so a slow file
+// system delays the thread rather than the steps producing summaries.
+class AsyncSummaryFileWriter : public SummaryFileWriter {
+ public:
+  AsyncSummaryFileWriter(int max_queue, int flush_millis,
+                         int max_pending_events, bool drop_on_overflow,
+                         Env* env)
+      : SummaryFileWriter(max_queue, flush_millis, env),
+        max_pending_events_(std::max(max_pending_events, 1)),
+        drop_on_overflow_(drop_on_overflow) {}
+
+  ~AsyncSummaryFileWriter() override {
+    {
+      mutex_lock l(queue_mu_);
+      stop_ = true;
+      queue_cv_.notify_all();
+      space_cv_.notify_all();
+    }
+    // Joins the background thread, which writes out whatever is pending first.
+    writer_thread_.reset();
+  }
+
+  void StartWriterThread() {
+    writer_thread_.reset(env_->StartThread(
+        ThreadOptions(), "summary_file_writer", [this]() { WriterLoop(); }));
+  }
+
+  Status WriteEvent(std::unique_ptr<Event> event) override {
+    mutex_lock l(queue_mu_);
+    while (!stop_ && pending_.size() >= max_pending_events_) {
+      if (drop_on_overflow_) {
+        async_writer_dropped_events->GetCell()->IncrementBy(1);
+        return OkStatus();
+      }
+      queue_cv_.notify_one();
+      space_cv_.wait(l);
+    }
+    pending_.emplace_back(std::move(event));
+    if (flush_millis_ <= 0 || pending_.size() > max_queue_) {
+      queue_cv_.notify_one();
+    }
+    return OkStatus();
+  }
+
+  // Blocks until every event enqueued before the call has been written and
+  // flushed, and returns the first write error seen since the last Flush().
+  Status Flush() override {
+    mutex_lock l(queue_mu_);
+    const int64_t request = ++flush_requests_;
+    queue_cv_.notify_one();
+    while (flushes_done_ < request) {
+      flush_cv_.wait(l);
+    }
+    Status s = write_status_;
+    write_status_ = OkStatus();
+    return s;
+  }
+
+  string DebugString() const override { return "AsyncSummaryFileWriter"; }
+
+ private:
+  // Whether the background thread should write out `pending_` now.
+  bool ShouldWrite() TF_EXCLUSIVE_LOCKS_REQUIRED(queue_mu_) {
+    return stop_ || flush_requests_ > flushes_done_ ||
+           pending_.size() > max_queue_ ||
+           pending_.size() >= max_pending_events_ ||
+           (flush_millis_ <= 0 && !pending_.empty());
+  }
+
+  void WriterLoop() {
+    uint64 last_write = env_->NowMicros();
+    while (true) {
+      std::vector<std::unique_ptr<Event>> batch;
+      int64_t flush_request;
+      bool flush_requested;
+      bool stop;
+      {
+        mutex_lock l(queue_mu_);
+        while (!ShouldWrite()) {
+          if (flush_millis_ <= 0) {
+            queue_cv_.wait(l);
+            continue;
+          }
+          const uint64 deadline =
+              last_write + 1000 * static_cast<uint64>(flush_millis_);
+          const uint64 now = env_->NowMicros();
+          if (now >= deadline) {
+            if (!pending_.empty()) break;
+            last_write = now;
+            continue;
+          }
+          queue_cv_.wait_for(l, std::chrono::microseconds(deadline - now));
+        }
+        batch.reserve(pending_.size());
+        for (auto& e : pending_) batch.push_back(std::move(e));
+        pending_.clear();
+        flush_request = flush_requests_;
+        flush_requested = flush_requests_ > flushes_done_;
+        stop = stop_;
+        space_cv_.notify_all();
+      }
+
+      Status s;
+      if (!batch.empty() || flush_requested) {
+        async_writer_queue_depth->GetCell()->Add(batch.size());
+        const uint64 start = env_->NowMicros();
+        {
+          mutex_lock ml(mu_);
+          s = WriteEventsAndFlush(batch);
+        }
+        last_write = env_->NowMicros();
+        async_writer_write_latency_usecs->GetCell()->Add(last_write - start);
+      }
+
+      {
+        mutex_lock l(queue_mu_);
+        write_status_.Update(s);
+        flushes_done_ = flush_request;
+        flush_cv_.notify_all();
+      }
+      if (stop) return;
+    }
+  }
+
+  const size_t max_pending_events_;
+  const bool drop_on_overflow_;
+
+  mutex queue_mu_;
+  // Signalled when the background thread has work to do.
+  condition_variable queue_cv_;
+  // Signalled when `pending_` has room for more events.
+  condition_variable space_cv_;
+  // Signalled when `flushes_done_` advances.
+  condition_variable flush_cv_;
+  std::deque<std::unique_ptr<Event>> pending_ TF_GUARDED_BY(queue_mu_);
+  bool stop_ TF_GUARDED_BY(queue_mu_) = false;
+  int64_t flush_requests_ TF_GUARDED_BY(queue_mu_) = 0;
+  int64_t flushes_done_ TF_GUARDED_BY(queue_mu_) = 0;
+  Status write_status_ TF_GUARDED_BY(queue_mu_);
+
+  std::unique_ptr<Thread> writer_thread_;
+};
+
 }  // namespace
 
 Status CreateSummaryFileWriter(int max_queue, int flush_millis,
@@ -207,4 +387,23 @@ Status CreateSummaryFileWriter(int max_queue, int flush_millis,
   return OkStatus();
 }
 
+Status CreateAsyncSummaryFileWriter(int max_queue, int flush_millis,
+                                    int max_pending_events,
+                                    bool drop_on_overflow,
+                                    const string& logdir,
+                                    const string& filename_suffix, Env* env,
+                                    SummaryWriterInterface** result) {
+  AsyncSummaryFileWriter* w = new AsyncSummaryFileWriter(
+      max_queue, flush_millis, max_pending_events, drop_on_overflow, env);
+  const Status s = w->Initialize(logdir, filename_suffix);
+  if (!s.ok()) {
+    w->Unref();
+    *result = nullptr;
+    return s;
+  }
+  w->StartWriterThread();
+  *result = w;
+  return OkStatus();
+}
+
 }  // namespace tensorflow
@@ -38,6 +38,24 @@ Status CreateSummaryFileWriter(int max_queue, int flush_millis,
                                const string& filename_suffix, Env* env,
                                SummaryWriterInterface** result);
 
+/// \brief Creates SummaryWriterInterface which writes to a file from a
+/// background thread.
+///
+/// Behaves like CreateSummaryFileWriter, except that WriteEvent and the
+/// Write* methods only enqueue the event and never touch the file. A
+/// background thread writes everything pending as one batch followed by a
+/// single flush once more than max_queue events are pending, at least every
+/// flush_millis milliseconds, and on Flush(). At most max_pending_events
+/// events are buffered; beyond that, new events are dropped if
+/// drop_on_overflow is true, and the caller waits for the background thread
+/// otherwise. Write errors are returned by the next call to Flush().
+Status CreateAsyncSummaryFileWriter(int max_queue, int flush_millis,
+                                    int max_pending_events,
+                                    bool drop_on_overflow,
+                                    const string& logdir,
+                                    const string& filename_suffix, Env* env,
+                                    SummaryWriterInterface** result);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_SUMMARY_SUMMARY_FILE_WRITER_H_
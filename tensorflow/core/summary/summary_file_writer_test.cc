@@ -281,5 +281,83 @@ TEST_F(SummaryFileWriterTest, AvoidFilenameCollision) {
       << "files = [" << absl::StrJoin(files, ", ") << "]";
 }
 
+TEST_F(SummaryFileWriterTest, AsyncWriter) {
+  // Keep unique with all other test names in this file.
+  const string test_name = "async_writer_test";
+  const string logdir = io::JoinPath(testing::TmpDir(), test_name);
+  SummaryWriterInterface* writer;
+  // Nothing is written before Flush(): max_queue and flush_millis are large.
+  TF_CHECK_OK(CreateAsyncSummaryFileWriter(
+      /*max_queue=*/1000, /*flush_millis=*/1000000,
+      /*max_pending_events=*/1000, /*drop_on_overflow=*/false, logdir,
+      test_name, &env_, &writer));
+  core::ScopedUnref deleter(writer);
+  for (int step = 0; step < 5; ++step) {
+    Tensor t(DT_FLOAT, TensorShape({}));
+    t.scalar<float>()() = step;
+    TF_CHECK_OK(writer->WriteScalar(step, t, "loss"));
+  }
+  TF_CHECK_OK(writer->Flush());
+
+  std::vector<string> files;
+  TF_CHECK_OK(env_.GetChildren(logdir, &files));
+  ASSERT_EQ(files.size(), 1);
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(
+      env_.NewRandomAccessFile(io::JoinPath(logdir, files[0]), &read_file));
+  io::RecordReader reader(read_file.get(), io::RecordReaderOptions());
+  tstring record;
+  uint64 offset = 0;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));  // File version event.
+  for (int step = 0; step < 5; ++step) {
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    Event e;
+    ASSERT_TRUE(e.ParseFromString(record));
+    EXPECT_EQ(e.step(), step);
+    ASSERT_EQ(e.summary().value_size(), 1);
+    EXPECT_EQ(e.summary().value(0).tag(), "loss");
+    EXPECT_EQ(e.summary().value(0).simple_value(), step);
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+}
+
+TEST_F(SummaryFileWriterTest, AsyncWriterDropsOnOverflow) {
+  // Keep unique with all other test names in this file.
+  const string test_name = "async_writer_drop_test";
+  const string logdir = io::JoinPath(testing::TmpDir(), test_name);
+  SummaryWriterInterface* writer;
+  // The background thread only runs on Flush(), so the queue holds at most
+  // two events and the remaining three are dropped.
+  TF_CHECK_OK(CreateAsyncSummaryFileWriter(
+      /*max_queue=*/1000, /*flush_millis=*/1000000,
+      /*max_pending_events=*/2, /*drop_on_overflow=*/true, logdir, test_name,
+      &env_, &writer));
+  core::ScopedUnref deleter(writer);
+  for (int step = 0; step < 5; ++step) {
+    std::unique_ptr<Event> e{new Event};
+    e->set_step(step);
+    TF_CHECK_OK(writer->WriteEvent(std::move(e)));
+  }
+  TF_CHECK_OK(writer->Flush());
+
+  std::vector<string> files;
+  TF_CHECK_OK(env_.GetChildren(logdir, &files));
+  ASSERT_EQ(files.size(), 1);
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(
+      env_.NewRandomAccessFile(io::JoinPath(logdir, files[0]), &read_file));
+  io::RecordReader reader(read_file.get(), io::RecordReaderOptions());
+  tstring record;
+  uint64 offset = 0;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));  // File version event.
+  for (int step = 0; step < 2; ++step) {
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    Event e;
+    ASSERT_TRUE(e.ParseFromString(record));
+    EXPECT_EQ(e.step(), step);
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -50,6 +50,13 @@ struct GraphExecutionOptions {
   tensorflow::SessionMetadata model_metadata;
 
   tensorflow::TfrtCompileOptions compile_options;
+
+  // If positive, one out of every `request_cost_profiling_interval` requests
+  // is profiled. The set-up, queueing, execution and fallback kernel time of a
+  // profiled request are recorded in latency histograms per signature and per
+  // fallback op, and added to the RequestCost of the current rpc if a
+  // RequestCostAccessor is configured.
+  int request_cost_profiling_interval = 0;
 };
 
 // Per-request options for graph execution.
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -33,9 +34,14 @@ limitations under the License.
 #include "tensorflow/compiler/mlir/tensorflow/translate/import_model.h"
 #include "tensorflow/compiler/mlir/tfrt/jit/tf_jitrt_request_context.h"
 #include "tensorflow/compiler/mlir/tfrt/translate/import_model.h"
+#include "tensorflow/core/common_runtime/cost_util.h"
+#include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/common_runtime/request_cost_accessor.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/threadpool_interface.h"
@@ -74,6 +80,89 @@ constexpr char kDeadlineExceededMessage[] = "Deadline exceeded.";
 constexpr char kTensorNameJoiningDelimiter[] = "-";
 constexpr char kArgumentTypeJoiningDelimiter[] = "^";
 
+auto* request_phase_latency = monitoring::Sampler<3>::New(
+    {"/tensorflow/tfrt/graph_executor/request_phase_latency",
+     "Latency in microseconds of the phases of profiled requests. The phases "
+     "are setup, queue, execution and fallback_kernels. The load phase is the "
+     "compilation and initialization of a client graph.",
+     "model_id", "signature", "phase"},
+    // The last bucket starts at ~17s.
+    monitoring::Buckets::Exponential(10, 1.5, 36));
+
+auto* fallback_op_latency = monitoring::Sampler<2>::New(
+    {"/tensorflow/tfrt/graph_executor/fallback_op_latency",
+     "Execution time in microseconds of the fallback kernels run by profiled "
+     "requests.",
+     "model_id", "op_type"},
+    monitoring::Buckets::Exponential(10, 1.5, 36));
+
+std::string GetModelId(const SessionMetadata& model_metadata) {
+  return absl::StrCat(model_metadata.name(), ":", model_metadata.version());
+}
+
+// Returns true for one out of every `request_cost_profiling_interval` calls.
+bool ShouldProfileRequest(const GraphExecutionOptions& options) {
+  if (options.request_cost_profiling_interval <= 0) return false;
+  static auto* request_count = new std::atomic<int64_t>(0);
+  return request_count->fetch_add(1, std::memory_order_relaxed) %
+             options.request_cost_profiling_interval ==
+         0;
+}
+
+// Collects the cost breakdown of a profiled request.
+class RequestCostProfile {
+ public:
+  RequestCostProfile(std::string model_id, absl::string_view signature_name)
+      : model_id_(std::move(model_id)), signature_name_(signature_name) {}
+
+  // Must be called from the thread running the request.
+  void RecordPhase(absl::string_view phase, absl::Duration duration) {
+    request_phase_latency
+        ->GetCell(model_id_, signature_name_, std::string(phase))
+        ->Add(absl::ToDoubleMicroseconds(duration));
+    phases_.push_back({absl::StrCat("tfrt_", phase), duration});
+  }
+
+  // Thread-safe.
+  void RecordFallbackKernel(absl::string_view op_type,
+                            absl::Duration duration) {
+    fallback_op_latency->GetCell(model_id_, std::string(op_type))
+        ->Add(absl::ToDoubleMicroseconds(duration));
+    mutex_lock l(mu_);
+    fallback_kernel_time_ += duration;
+  }
+
+  // Records the total fallback kernel time, and reports all phases to the
+  // RequestCost of the current rpc if there is one.
+  void Finish() {
+    absl::Duration fallback_kernel_time;
+    {
+      mutex_lock l(mu_);
+      fallback_kernel_time = fallback_kernel_time_;
+    }
+    RecordPhase("fallback_kernels", fallback_kernel_time);
+
+    std::unique_ptr<RequestCostAccessor> request_cost_accessor =
+        CreateRequestCostAccessor();
+    RequestCost* request_cost = request_cost_accessor
+                                    ? request_cost_accessor->GetRequestCost()
+                                    : nullptr;
+    if (request_cost == nullptr) return;
+    std::vector<std::pair<absl::string_view, absl::Duration>> costs;
+    costs.reserve(phases_.size());
+    for (const auto& phase : phases_) costs.push_back(phase);
+    request_cost->RecordCost(costs);
+  }
+
+ private:
+  const std::string model_id_;
+  const std::string signature_name_;
+  std::vector<std::pair<std::string, absl::Duration>> phases_;
+
+  mutex mu_;
+  absl::Duration fallback_kernel_time_ TF_GUARDED_BY(mu_);
+};
+
 }  // namespace
 
 StatusOr<std::unique_ptr<RequestInfo>> SetUpRequestContext(
@@ -81,7 +170,8 @@ StatusOr<std::unique_ptr<RequestInfo>> SetUpRequestContext(
     const SessionMetadata& model_metadata, tfrt::HostContext* host,
     tensorflow::tfrt_stub::WorkQueueInterface* work_queue,
     tfrt::ResourceContext* resource_context,
-    const tensorflow::tfrt_stub::FallbackState& fallback_state) {
+    const tensorflow::tfrt_stub::FallbackState& fallback_state,
+    tfd::FallbackKernelCostRecorder::RecordFn fallback_kernel_cost_fn) {
   DCHECK(host);
   DCHECK(work_queue);
   // Create request context and prepare deadline tracker.
@@ -117,6 +207,11 @@ StatusOr<std::unique_ptr<RequestInfo>> SetUpRequestContext(
       &request_context_builder, &fallback_state.device_manager(),
       &fallback_state.process_function_library_runtime(), intra_op_threadpool,
       model_metadata, &request_info->runner));
+  if (fallback_kernel_cost_fn) {
+    request_context_builder.context_data()
+        .emplace<tfd::FallbackKernelCostRecorder>(
+            std::move(fallback_kernel_cost_fn));
+  }
 
   TF_RETURN_IF_ERROR(
       tensorflow::SetUpTfJitRtRequestContext(&request_context_builder));
@@ -147,12 +242,27 @@ tensorflow::Status GraphExecutionRunOnFunction(
     tfrt::RequestDeadlineTracker& req_deadline_tracker) {
   auto* host = runtime.core_runtime()->GetHostContext();
 
+  // Shared with the fallback kernels, which may outlive this call on errors.
+  std::shared_ptr<RequestCostProfile> cost_profile;
+  tfd::FallbackKernelCostRecorder::RecordFn fallback_kernel_cost_fn;
+  absl::Time setup_start_time;
+  if (ShouldProfileRequest(options)) {
+    cost_profile = std::make_shared<RequestCostProfile>(
+        GetModelId(options.model_metadata), signature_name);
+    fallback_kernel_cost_fn = [cost_profile](absl::string_view op_type,
+                                             absl::Duration duration) {
+      cost_profile->RecordFallbackKernel(op_type, duration);
+    };
+    setup_start_time = absl::Now();
+  }
+
   TF_ASSIGN_OR_RETURN(
       auto request_info,
       SetUpRequestContext(run_options, options.model_metadata, host,
                           run_options.work_queue ? run_options.work_queue
                                                  : runtime.work_queue(),
-                          resource_context, fallback_state));
+                          resource_context, fallback_state,
+                          std::move(fallback_kernel_cost_fn)));
 
   tensorflow::profiler::TraceMeProducer traceme(
       // To TraceMeConsumers in RunHandlerThreadPool::WorkerLoop.
@@ -213,9 +323,17 @@ tensorflow::Status GraphExecutionRunOnFunction(
   llvm::SmallVector<tfrt::RCReference<tfrt::AsyncValue>, 4> chain_and_results;
   chain_and_results.resize(func.result_types().size());
 
+  absl::Time enqueue_time;
+  absl::Time execution_start_time;
+  if (cost_profile) {
+    enqueue_time = absl::Now();
+    cost_profile->RecordPhase("setup", enqueue_time - setup_start_time);
+  }
+
   // Hand over the execution to thread pool.
   std::array<tfrt::RCReference<tfrt::AsyncValue>, 1> executed = {
       EnqueueWork(exec_ctx, [&]() -> tfrt::Chain {
+        if (cost_profile) execution_start_time = absl::Now();
         func.Execute(exec_ctx, arguments, chain_and_results);
         return {};
       })};
@@ -227,6 +345,13 @@ tensorflow::Status GraphExecutionRunOnFunction(
   // side-effects are visible when SavedModel::Run() returns.
   exec_ctx.work_queue().Await(chain_and_results);
 
+  if (cost_profile) {
+    cost_profile->RecordPhase("queue", execution_start_time - enqueue_time);
+    cost_profile->RecordPhase("execution",
+                              absl::Now() - execution_start_time);
+    cost_profile->Finish();
+  }
+
   DCHECK(!chain_and_results.empty());
 
   tfrt::RCReference<tfrt::AsyncValue>& chain = chain_and_results[0];
@@ -417,6 +542,15 @@ tensorflow::Status GraphExecutor::Extend(const GraphDef& graph) {
 
 StatusOr<std::unique_ptr<GraphExecutor::LoadedClientGraph>>
 GraphExecutor::LoadClientGraph(const GraphExecutor::ClientGraph& client_graph) {
+  // Loading is rare, so it is always recorded.
+  const absl::Time load_start_time = absl::Now();
+  auto record_load_latency = tensorflow::gtl::MakeCleanup([&]() {
+    request_phase_latency
+        ->GetCell(GetModelId(options_.model_metadata), client_graph.name,
+                  "load")
+        ->Add(absl::ToDoubleMicroseconds(absl::Now() - load_start_time));
+  });
+
   auto loaded_client_graph = std::make_unique<LoadedClientGraph>();
   loaded_client_graph->name = client_graph.name;
   loaded_client_graph->resource_context = CreateResourceContext(
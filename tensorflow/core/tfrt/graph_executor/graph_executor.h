@@ -23,6 +23,7 @@ limitations under the License.
 #include "mlir/IR/BuiltinOps.h"  // from @llvm-project
 #include "tensorflow/core/common_runtime/graph_execution_state.h"
 #include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/runtime_fallback/kernel/kernel_fallback_compat_request_state.h"
 #include "tensorflow/core/tfrt/fallback/fallback_state.h"
 #include "tensorflow/core/tfrt/graph_executor/graph_execution_options.h"
 #include "tensorflow/core/tfrt/runtime/work_queue_interface.h"
@@ -46,13 +47,17 @@ struct RequestInfo {
   std::function<void(std::function<void()>)> runner;
 };
 
-// Creates a `RequestInfo` given relative data.
+// Creates a `RequestInfo` given relative data. If `fallback_kernel_cost_fn` is
+// set, it receives the op type and execution time of every fallback kernel run
+// in the request.
 StatusOr<std::unique_ptr<RequestInfo>> SetUpRequestContext(
     const GraphExecutionRunOptions& run_options,
     const SessionMetadata& model_metadata, tfrt::HostContext* host,
     tensorflow::tfrt_stub::WorkQueueInterface* work_queue,
     tfrt::ResourceContext* resource_context,
-    const FallbackState& fallback_state);
+    const FallbackState& fallback_state,
+    tfd::FallbackKernelCostRecorder::RecordFn fallback_kernel_cost_fn =
+        nullptr);
 
 // Runs on a function given input/output and other info.
 tensorflow::Status GraphExecutionRunOnFunction(
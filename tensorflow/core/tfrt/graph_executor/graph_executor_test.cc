@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/tfrt/saved_model/saved_model_testutil.h"
@@ -81,6 +82,61 @@ TEST_F(GraphExecutorTest, Vanilla) {
               ::testing::ElementsAreArray({2}));
 }
 
+TEST_F(GraphExecutorTest, RequestCostProfiling) {
+  using ::tensorflow::monitoring::testing::CellReader;
+  using ::tensorflow::monitoring::testing::Histogram;
+  CellReader<Histogram> phase_latency(
+      "/tensorflow/tfrt/graph_executor/request_phase_latency");
+
+  GraphDef graph_def;
+  {
+    auto scope = tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+
+    auto input = ops::Placeholder(scope.WithOpName("input"), DT_INT32);
+    auto rank = ops::Rank(scope.WithOpName("rank"), input);
+
+    TF_ASSERT_OK(scope.ToGraphDef(&graph_def));
+  }
+
+  auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+  GraphExecutor::Options options(runtime.get());
+  options.model_metadata.set_name("model");
+  options.model_metadata.set_version(1);
+  options.request_cost_profiling_interval = 1;
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto fallback_state,
+      tensorflow::tfrt_stub::FallbackState::Create(
+          CreateDefaultSessionOptions(options), graph_def.library()));
+  auto tpu_model_resource = std::make_unique<tfrt::tpu::TpuModelResource>();
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto graph_executor,
+      GraphExecutor::Create(std::move(options), *fallback_state,
+                            tpu_model_resource.get(), graph_def));
+
+  std::vector<std::pair<std::string, tensorflow::Tensor>> inputs;
+  inputs.push_back({"input", CreateTfTensor<int32_t>(
+                                 /*shape=*/{1, 3}, /*data=*/{1, 1, 1})});
+
+  for (int i = 0; i < 2; ++i) {
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK(graph_executor->Run(/*run_options=*/{}, inputs,
+                                     /*output_tensor_names=*/{"rank"},
+                                     /*target_tensor_names=*/{}, &outputs));
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_THAT(GetTfTensorData<int32_t>(outputs[0]),
+                ::testing::ElementsAreArray({2}));
+  }
+
+  // The client graph is loaded once, and both requests are profiled.
+  const std::string signature = "input^rank^";
+  EXPECT_FLOAT_EQ(phase_latency.Delta("model:1", signature, "load").num(), 1);
+  for (const char* phase :
+       {"setup", "queue", "execution", "fallback_kernels"}) {
+    EXPECT_FLOAT_EQ(phase_latency.Delta("model:1", signature, phase).num(), 2)
+        << phase;
+  }
+}
+
 TEST_F(GraphExecutorTest, Extend) {
   GraphDef graph_def;
   {
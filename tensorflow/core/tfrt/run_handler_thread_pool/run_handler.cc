@@ -348,6 +348,7 @@ RunHandlerThreadPool::RunHandlerThreadPool(
       blocking_thread_max_waiting_time_(
           options.blocking_threads_max_sleep_time_micro_sec),
       enable_wake_up_(options.enable_wake_up),
+      prioritize_earlier_requests_(options.prioritize_earlier_requests),
       thread_data_(num_threads_),
       env_(env, thread_options, name),
       name_(name),
@@ -476,7 +477,10 @@ Task RunHandlerThreadPool::FindTask(
     const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources,
     bool* task_from_blocking_queue, ThreadWorkSource** tws) {
   Task t;
-  int current_index = thread_data_[thread_id].current_index;
+  // Work sources are sorted by priority and then by arrival.
+  int current_index = prioritize_earlier_requests_
+                          ? searching_range_start
+                          : thread_data_[thread_id].current_index;
   *task_from_blocking_queue = false;
 
   for (int i = 0; i < searching_range_end - searching_range_start; ++i) {
@@ -724,7 +728,8 @@ class RunHandlerPool::Impl {
                 options.use_adaptive_waiting_time, options.enable_wake_up,
                 options.max_concurrent_handler,
                 options.num_threads_in_sub_thread_pool,
-                options.sub_thread_request_percentage),
+                options.sub_thread_request_percentage,
+                options.prioritize_earlier_requests),
             tensorflow::Env::Default(), tensorflow::ThreadOptions(),
             "tf_run_handler_pool", &waiters_mu_, &queue_waiters_)),
         iterations_(0),
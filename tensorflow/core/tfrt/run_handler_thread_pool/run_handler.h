@@ -101,6 +101,13 @@ class RunHandlerPool {
 
     // If true, threads will be waken up by new tasks.
     bool enable_wake_up = true;
+
+    // If true, threads look for work starting from the highest priority
+    // request (the earliest one among equal priorities) every time, instead of
+    // resuming the round robin from where they last found work. A request's
+    // ops then keep the priority of its arrival, so a burst of new requests
+    // cannot delay the ones already running.
+    bool prioritize_earlier_requests = false;
   };
   explicit RunHandlerPool(Options options);
   ~RunHandlerPool();
@@ -294,6 +301,7 @@ class RunHandlerThreadPool {
     int max_concurrent_handler;
     std::vector<int> num_threads_in_sub_thread_pool;
     std::vector<double> sub_thread_request_percentage;
+    bool prioritize_earlier_requests;
     Options(int num_blocking_threads, int num_non_blocking_threads,
             bool wait_if_no_active_request,
             int non_blocking_threads_sleep_time_micro_sec,
@@ -301,7 +309,8 @@ class RunHandlerThreadPool {
             bool use_adaptive_waiting_time, bool enable_wake_up,
             int max_concurrent_handler,
             const std::vector<int>& num_threads_in_sub_thread_pool,
-            const std::vector<double>& sub_thread_request_percentage)
+            const std::vector<double>& sub_thread_request_percentage,
+            bool prioritize_earlier_requests = false)
         : num_blocking_threads(num_blocking_threads),
           num_non_blocking_threads(num_non_blocking_threads),
           wait_if_no_active_request(wait_if_no_active_request),
@@ -313,7 +322,8 @@ class RunHandlerThreadPool {
           enable_wake_up(enable_wake_up),
           max_concurrent_handler(max_concurrent_handler),
           num_threads_in_sub_thread_pool(num_threads_in_sub_thread_pool),
-          sub_thread_request_percentage(sub_thread_request_percentage) {}
+          sub_thread_request_percentage(sub_thread_request_percentage),
+          prioritize_earlier_requests(prioritize_earlier_requests) {}
   };
   struct PerThread {
     constexpr PerThread() : pool(nullptr), thread_id(-1) {}
@@ -354,7 +364,9 @@ class RunHandlerThreadPool {
 
   // Search tasks from Requets range searching_range_start to
   // searching_range_end. If there is no tasks in the search range and
-  // may_steal_blocking_work is true, then search from all requests.
+  // may_steal_blocking_work is true, then search from all requests. The search
+  // starts at searching_range_start if prioritize_earlier_requests is set, and
+  // where the previous search of the thread stopped otherwise.
   Task FindTask(
       int searching_range_start, int searching_range_end, int thread_id,
       int sub_thread_pool_id, int max_blocking_inflight,
@@ -392,6 +404,7 @@ class RunHandlerThreadPool {
   const int non_blocking_thread_sleep_time_;
   const int blocking_thread_max_waiting_time_;
   const bool enable_wake_up_;
+  const bool prioritize_earlier_requests_;
   Eigen::MaxSizeVector<ThreadData> thread_data_;
   internal::RunHandlerEnvironment env_;
   std::atomic<bool> cancelled_;
@@ -53,6 +53,8 @@ RunHandlerThreadWorkQueue::RunHandlerThreadWorkQueue(const Options& options)
   pool_options.enable_wake_up = options.enable_wake_up;
   pool_options.wait_if_no_active_request = options.wait_if_no_active_request;
   pool_options.use_adaptive_waiting_time = options.use_adaptive_waiting_time;
+  pool_options.prioritize_earlier_requests =
+      options.prioritize_earlier_requests;
   handler_pool_ = std::make_unique<RunHandlerPool>(pool_options);
 }
 
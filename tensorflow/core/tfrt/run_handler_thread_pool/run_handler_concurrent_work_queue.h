@@ -74,6 +74,13 @@ class RunHandlerThreadWorkQueue
 
     // If true, threads will be waken up by new tasks.
     bool enable_wake_up = true;
+
+    // If true, threads look for work starting from the highest priority
+    // request (the earliest one among equal priorities) every time, instead of
+    // resuming the round robin from where they last found work. A request's
+    // ops then keep the priority of its arrival, so a burst of new requests
+    // cannot delay the ones already running.
+    bool prioritize_earlier_requests = false;
   };
 
   explicit RunHandlerThreadWorkQueue(const Options& options);
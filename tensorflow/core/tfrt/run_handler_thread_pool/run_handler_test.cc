@@ -548,6 +548,79 @@ TEST_P(RunHandlerThreadPoolTest, RoundRobinExecution) {
   delete run_handler_thread_pool;
 }
 
+TEST_P(RunHandlerThreadPoolTest, PrioritizeEarlierRequests) {
+  Eigen::MaxSizeVector<tensorflow::mutex> waiters_mu(1);
+  waiters_mu.resize(1);
+  Eigen::MaxSizeVector<internal::Waiter> waiters(1);
+  waiters.resize(1);
+  internal::RunHandlerThreadPool* run_handler_thread_pool =
+      new internal::RunHandlerThreadPool(
+          internal::RunHandlerThreadPool::Options(
+              /*num_blocking_threads=*/1, /*num_non_blocking_threads=*/0,
+              /*wait_if_no_active_request=*/true,
+              /*non_blocking_threads_sleep_time_micro_sec=*/250,
+              /*blocking_threads_max_sleep_time_micro_sec=*/250,
+              /*use_adaptive_waiting_time=*/true, /*enable_wake_up=*/true,
+              /*max_concurrent_handler=*/128,
+              /*num_threads_in_sub_thread_pool=*/{1},
+              /*sub_thread_request_percentage=*/{1},
+              /*prioritize_earlier_requests=*/true),
+          tensorflow::Env::Default(), tensorflow::ThreadOptions(),
+          "tf_run_handler_pool", &waiters_mu, &waiters);
+  Eigen::MaxSizeVector<internal::ThreadWorkSource*> thread_work_sources(3);
+  thread_work_sources.resize(3);
+  internal::ThreadWorkSource tws[3];
+  for (int i = 0; i < 3; ++i) {
+    tws[i].SetWaiter(1, &waiters[0], &waiters_mu[0]);
+    thread_work_sources[i] = &tws[i];
+  }
+
+  int result = 0;
+  tensorflow::mutex mu;
+  bool ok_to_execute = false;
+  bool ok_to_validate = false;
+  tensorflow::condition_variable function_start;
+  tensorflow::condition_variable function_end;
+  std::vector<std::function<void()>> fns;
+  for (int i = 0; i < 3; ++i) {
+    fns.push_back([&result, &mu, &function_start, &function_end, &ok_to_execute,
+                   &ok_to_validate, i] {
+      tensorflow::mutex_lock l(mu);
+      while (!ok_to_execute) {
+        function_start.wait(l);
+      }
+      result = i;
+      ok_to_execute = false;
+      ok_to_validate = true;
+      function_end.notify_one();
+    });
+    run_handler_thread_pool->AddWorkToQueue(&tws[i], /*is_blocking=*/true,
+                                            TaskFunction(fns[i]));
+    run_handler_thread_pool->AddWorkToQueue(&tws[i], /*is_blocking=*/true,
+                                            TaskFunction(fns[i]));
+  }
+  run_handler_thread_pool->Start();
+  run_handler_thread_pool->SetThreadWorkSources(
+      /*tid=*/0, /*version=*/1, thread_work_sources);
+
+  // Validate that all the tasks of a request run before those of the later
+  // requests.
+  tensorflow::mutex_lock l(mu);
+  for (int i = 0; i < 3; ++i) {
+    for (int round = 0; round < 2; ++round) {
+      ok_to_execute = true;
+      function_start.notify_one();
+      while (!ok_to_validate) {
+        function_end.wait(l);
+      }
+      ok_to_validate = false;
+      EXPECT_EQ(result, i);
+    }
+  }
+
+  delete run_handler_thread_pool;
+}
+
 TEST_P(RunHandlerThreadPoolTest, MultipleSubThreadPool) {
   Eigen::MaxSizeVector<tensorflow::mutex> waiters_mu(2);
   waiters_mu.resize(2);
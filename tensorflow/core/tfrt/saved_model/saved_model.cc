@@ -554,12 +554,25 @@ std::unique_ptr<SavedModel> SavedModelImpl::LoadSavedModel(
                               std::move(*meta_graph_def.mutable_graph_def())));
 
     // Finally, create the saved model.
-    return {std::make_unique<SavedModelImpl>(
+    auto saved_model = std::make_unique<SavedModelImpl>(
         std::move(options), std::move(meta_graph_def), std::move(bef),
         std::move(bef_file),
         std::move(initializers_and_signatures.signature_map),
         std::move(fallback_state), std::move(tpu_model_resource),
-        std::move(resource_context), std::move(graph_executor))};
+        std::move(resource_context), std::move(graph_executor));
+    if (saved_model->options_.enable_lazy_loading) {
+      for (const auto& name :
+           saved_model->options_.lazy_loading_prewarm_signatures) {
+        if (!saved_model->signatures_.contains(name)) {
+          return tensorflow::errors::InvalidArgument(
+              "Unknown signature in lazy_loading_prewarm_signatures: ", name);
+        }
+        TF_RETURN_IF_ERROR(
+            saved_model->GetOrCreateLoadingResult({name}, /*pin=*/true)
+                .status());
+      }
+    }
+    return {std::move(saved_model)};
   }();
 
   if (!statusor_saved_model.ok()) {
@@ -655,14 +668,16 @@ tensorflow::Status SavedModelImpl::Run(
 
   const tfrt::Function* func;
   tfrt::ResourceContext* resource_context;
+  // Keeps a lazily loaded signature alive even if it is evicted meanwhile.
+  std::shared_ptr<const LoadingResult> loading_result;
   if (options_.enable_lazy_loading) {
     // If lazy loading is enabled, no signature is loaded into `bef_file_`, so
     // we need to find the BEF from the cache or create one.
-    TF_ASSIGN_OR_RETURN(const LoadingResult& loading_result,
+    TF_ASSIGN_OR_RETURN(loading_result,
                         GetOrCreateLoadingResult({std::string(name)}));
-    func = loading_result.bef_file->GetFunction(
+    func = loading_result->bef_file->GetFunction(
         tensorflow::kImportModelDefaultGraphFuncName);
-    resource_context = loading_result.resource_context.get();
+    resource_context = loading_result->resource_context.get();
   } else {
     func = bef_file_->GetFunction({name.data(), name.size()});
     resource_context = resource_context_.get();
@@ -920,7 +935,7 @@ StatusOr<JoinedSignature> JoinSignatures(
 }  // namespace
 
 // TODO(b/216379787): Reuse `GraphExecutor::LoadClientGraph()`.
-StatusOr<std::reference_wrapper<const SavedModelImpl::LoadingResult>>
+StatusOr<std::shared_ptr<const SavedModelImpl::LoadingResult>>
 SavedModelImpl::LoadJoinedSignature(const JoinedSignature& joined_signature) {
   // Step 1: Import the combined subgraph from proto to an MLIR module.
   mlir::MLIRContext context;
@@ -952,23 +967,51 @@ SavedModelImpl::LoadJoinedSignature(const JoinedSignature& joined_signature) {
       loading_result->resource_context.get(), *fallback_state_));
 
   // Store loading_result in cache.
-  const auto* loading_result_ptr = loading_result.get();
-  loading_result_cache_[joined_signature.name] = std::move(loading_result);
-  return {*loading_result_ptr};
+  std::shared_ptr<const LoadingResult> shared_loading_result =
+      std::move(loading_result);
+  loading_result_cache_bytes_ += shared_loading_result->bef.size();
+  loading_result_cache_[joined_signature.name].loading_result =
+      shared_loading_result;
+  return shared_loading_result;
 }
 
-StatusOr<std::reference_wrapper<const SavedModelImpl::LoadingResult>>
-SavedModelImpl::GetOrCreateLoadingResult(absl::Span<const std::string> names) {
+StatusOr<std::shared_ptr<const SavedModelImpl::LoadingResult>>
+SavedModelImpl::GetOrCreateLoadingResult(absl::Span<const std::string> names,
+                                         bool pin) {
   const auto joined_name = absl::StrJoin(names, kSignatureJoiningDelimiter);
   tensorflow::mutex_lock l(loading_result_cache_mu_);
-  const auto iter = loading_result_cache_.find(joined_name);
-  if (iter != loading_result_cache_.end()) return {*iter->second};
-
-  TF_ASSIGN_OR_RETURN(
-      const auto joined_signature,
-      JoinSignatures(names, signatures_, meta_graph_def_.signature_def()));
+  auto iter = loading_result_cache_.find(joined_name);
+  if (iter == loading_result_cache_.end()) {
+    TF_ASSIGN_OR_RETURN(
+        const auto joined_signature,
+        JoinSignatures(names, signatures_, meta_graph_def_.signature_def()));
+    TF_RETURN_IF_ERROR(LoadJoinedSignature(joined_signature).status());
+    MaybeEvictLoadingResults(joined_name);
+    iter = loading_result_cache_.find(joined_name);
+  }
+  iter->second.last_use = ++loading_result_use_count_;
+  iter->second.pinned |= pin;
+  return iter->second.loading_result;
+}
 
-  return LoadJoinedSignature(joined_signature);
+void SavedModelImpl::MaybeEvictLoadingResults(const std::string& keep) {
+  const int64_t limit = options_.lazy_loading_memory_limit_bytes;
+  if (limit <= 0) return;
+  while (loading_result_cache_bytes_ > limit) {
+    auto victim = loading_result_cache_.end();
+    for (auto it = loading_result_cache_.begin();
+         it != loading_result_cache_.end(); ++it) {
+      if (it->second.pinned || it->first == keep) continue;
+      if (victim == loading_result_cache_.end() ||
+          it->second.last_use < victim->second.last_use) {
+        victim = it;
+      }
+    }
+    if (victim == loading_result_cache_.end()) return;
+    VLOG(1) << "Evicting lazily loaded signature " << victim->first;
+    loading_result_cache_bytes_ -= victim->second.loading_result->bef.size();
+    loading_result_cache_.erase(victim);
+  }
 }
 
 }  // namespace tfrt_stub
@@ -130,6 +130,17 @@ class SavedModel {
     // the individual signatures will be loaded along with the saved model.
     bool enable_lazy_loading = false;
 
+    // Only used with `enable_lazy_loading`. The signatures to load along with
+    // the saved model, so that their first invocations do not pay for the
+    // loading. They are never evicted.
+    std::vector<std::string> lazy_loading_prewarm_signatures;
+
+    // Only used with `enable_lazy_loading`. If positive, the least recently
+    // used signatures are evicted once the compiled BEFs of the lazily loaded
+    // signatures take more than this many bytes. An evicted signature is
+    // loaded again on its next invocation.
+    int64_t lazy_loading_memory_limit_bytes = 0;
+
     GraphExecutionOptions graph_execution_options;
   };
 
@@ -270,18 +281,34 @@ class SavedModelImpl final : public SavedModel {
       const std::vector<std::string>& output_nodes,
       const std::vector<std::string>& target_nodes);
 
+  // A cached loading result and its eviction state.
+  struct CachedLoadingResult {
+    // Shared with the running requests, so that an evicted result stays alive
+    // until they finish.
+    std::shared_ptr<const LoadingResult> loading_result;
+    // The value of `loading_result_use_count_` when the result was last used.
+    int64_t last_use = 0;
+    // Prewarmed results are never evicted.
+    bool pinned = false;
+  };
+
   // Given the joined signature, loads the subgraph and returns loading result.
-  tensorflow::StatusOr<
-      std::reference_wrapper<const SavedModelImpl::LoadingResult>>
+  tensorflow::StatusOr<std::shared_ptr<const SavedModelImpl::LoadingResult>>
   LoadJoinedSignature(const JoinedSignature& joined_signature)
       TF_EXCLUSIVE_LOCKS_REQUIRED(loading_result_cache_mu_);
 
-  // Returns the loading result given the signature names.
-  tensorflow::StatusOr<
-      std::reference_wrapper<const SavedModelImpl::LoadingResult>>
-  GetOrCreateLoadingResult(absl::Span<const std::string> names)
+  // Returns the loading result given the signature names. If `pin` is true,
+  // the result will not be evicted.
+  tensorflow::StatusOr<std::shared_ptr<const SavedModelImpl::LoadingResult>>
+  GetOrCreateLoadingResult(absl::Span<const std::string> names,
+                           bool pin = false)
       TF_LOCKS_EXCLUDED(loading_result_cache_mu_);
 
+  // Evicts the least recently used loading results other than `keep` until
+  // they fit in `lazy_loading_memory_limit_bytes`.
+  void MaybeEvictLoadingResults(const std::string& keep)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(loading_result_cache_mu_);
+
   // Runs `func` with the given inputs, and outputs the result.
   tensorflow::Status RunInternal(const RunOptions& run_options,
                                  absl::string_view signature_name,
@@ -309,11 +336,13 @@ class SavedModelImpl final : public SavedModel {
   std::unique_ptr<tfrt::tpu::TpuModelResource> tpu_model_resource_;
   std::unique_ptr<tfrt::ResourceContext> resource_context_;
   tensorflow::mutex loading_result_cache_mu_;
-  // For pointer stability of values in `absl::flat_hash_map<>`, additional
-  // `std::unique_ptr<>` is necessary. (See https://abseil.io/tips/136.)
-  absl::flat_hash_map<std::string /*joined_name*/,
-                      std::unique_ptr<LoadingResult>>
+  absl::flat_hash_map<std::string /*joined_name*/, CachedLoadingResult>
       loading_result_cache_ TF_GUARDED_BY(loading_result_cache_mu_);
+  // The total size of the BEFs in `loading_result_cache_`.
+  int64_t loading_result_cache_bytes_ TF_GUARDED_BY(loading_result_cache_mu_) =
+      0;
+  int64_t loading_result_use_count_ TF_GUARDED_BY(loading_result_cache_mu_) =
+      0;
   std::unique_ptr<GraphExecutor> graph_executor_;
 };
 
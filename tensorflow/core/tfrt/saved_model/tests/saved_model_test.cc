@@ -84,6 +84,43 @@ INSTANTIATE_TEST_SUITE_P(
         TestParams{0, 1, 1}, TestParams{1, 0, 0}, TestParams{1, 0, 1},
         TestParams{1, 1, 0}, TestParams{1, 1, 1}));
 
+TEST(SavedModelTest, LazyLoadingPrewarmAndEviction) {
+  std::string saved_model_dir = tensorflow::GetDataDependencyFilepath(
+      "tensorflow/core/tfrt/saved_model/tests/toy_v1");
+
+  auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+  auto options = DefaultSavedModelOptions(runtime.get());
+  options.enable_lazy_loading = true;
+  // Any loaded signature exceeds the limit.
+  options.lazy_loading_memory_limit_bytes = 1;
+
+  // An unknown prewarm signature fails the loading.
+  options.lazy_loading_prewarm_signatures = {"unknown"};
+  tensorflow::Status status;
+  auto saved_model =
+      SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                     /*tags=*/{"serve"}, &status);
+  EXPECT_FALSE(status.ok());
+
+  options.lazy_loading_prewarm_signatures = {"toy"};
+  saved_model = SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                               /*tags=*/{"serve"}, &status);
+  TF_CHECK_OK(status);
+
+  std::vector<tensorflow::Tensor> inputs;
+  inputs.push_back(
+      CreateTfTensor<int32_t>(/*shape=*/{1, 3}, /*data=*/{1, 1, 1}));
+
+  // The prewarmed signature is kept across runs despite the limit.
+  for (int i = 0; i < 2; ++i) {
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK(saved_model->Run({}, "toy", inputs, &outputs));
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_THAT(GetTfTensorData<int32_t>(outputs[0]),
+                ::testing::ElementsAreArray({6}));
+  }
+}
+
 TEST(SavedModelTest, BasicV2) {
   // SavedModel toy contains a graph of a single 'tf.AddV2' op. It is generated
   // using the following python code:
@@ -21,6 +21,9 @@ limitations under the License.
 #include <unordered_map>
 #include <vector>
 
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/str_util.h"
 #include "tensorflow/core/util/activation_mode.h"
 #include "tensorflow/core/util/autotune_maps/autotune_map.pb.h"
@@ -178,14 +181,52 @@ Status PopulateConvMap(
 }  // namespace
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
-Status SerializeAutotuneMaps(std::string *output) {
+namespace {
+
+AutotuneMapsProto AutotuneMapsToProto() {
   AutotuneMapsProto proto;
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
   *proto.mutable_conv_map() = ConvMapToProto(*ConvAutotuneMap::GetInstance());
   *proto.mutable_fused_conv_map() =
       ConvMapToProto(*FusedConvAutotuneMap::GetInstance());
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
-  *output = autotune_maps_utils::SerializeProtoDeterministic(proto);
+  return proto;
+}
+
+Status LoadAutotuneMapsFromProto(const AutotuneMapsProto &proto) {
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  TF_RETURN_IF_ERROR(
+      PopulateConvMap(proto.conv_map(), ConvAutotuneMap::GetInstance()));
+  TF_RETURN_IF_ERROR(PopulateConvMap(proto.fused_conv_map(),
+                                     FusedConvAutotuneMap::GetInstance()));
+  // TODO(b/189530096): Populate autotune maps for more ops.
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  return OkStatus();
+}
+
+// Reads the store at `path` into `store`. A missing store reads as empty.
+Status ReadAutotuneStore(const std::string &path, AutotuneStoreProto *store) {
+  Env *env = Env::Default();
+  if (!env->FileExists(path).ok()) return OkStatus();
+  std::string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, path, &contents));
+  if (!store->ParseFromString(contents)) {
+    return errors::DataLoss("Failed to parse the autotune store ", path);
+  }
+  return OkStatus();
+}
+
+// Serializes updates of stores within this process.
+mutex *AutotuneStoreMutex() {
+  static mutex *mu = new mutex();
+  return mu;
+}
+
+}  // namespace
+
+Status SerializeAutotuneMaps(std::string *output) {
+  *output = autotune_maps_utils::SerializeProtoDeterministic(
+      AutotuneMapsToProto());
   return OkStatus();
 }
 
@@ -199,15 +240,70 @@ Status LoadSerializedAutotuneMaps(absl::string_view s) {
     return errors::InvalidArgument(
         "Failed to parse the autotune maps from string.");
   }
-  TF_RETURN_IF_ERROR(
-      PopulateConvMap(proto.conv_map(), ConvAutotuneMap::GetInstance()));
-  TF_RETURN_IF_ERROR(PopulateConvMap(proto.fused_conv_map(),
-                                     FusedConvAutotuneMap::GetInstance()));
-  // TODO(b/189530096): Populate autotune maps for more ops.
+  TF_RETURN_IF_ERROR(LoadAutotuneMapsFromProto(proto));
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
   return OkStatus();
 }
 
+Status LoadAutotuneStore(const std::string &path,
+                         absl::string_view runtime_fingerprint) {
+  AutotuneStoreProto store;
+  TF_RETURN_IF_ERROR(ReadAutotuneStore(path, &store));
+  auto it = store.maps_by_runtime().find(std::string(runtime_fingerprint));
+  if (it == store.maps_by_runtime().end()) {
+    return errors::NotFound("The autotune store ", path,
+                            " has no results for ", runtime_fingerprint);
+  }
+  return LoadAutotuneMapsFromProto(it->second);
+}
+
+Status UpdateAutotuneStore(const std::string &path,
+                           absl::string_view runtime_fingerprint) {
+  mutex_lock l(*AutotuneStoreMutex());
+  AutotuneStoreProto store;
+  Status read_status = ReadAutotuneStore(path, &store);
+  if (!read_status.ok()) {
+    LOG(WARNING) << "Replacing the unreadable autotune store: " << read_status;
+    store.Clear();
+  }
+  // Pick up the results other processes added since this one loaded the
+  // store. They may have been measured on GPU models this process does not
+  // have, which the runtime maps cannot hold, so the entries of the store are
+  // kept and the runtime's entries are added to them.
+  AutotuneMapsProto &maps =
+      (*store.mutable_maps_by_runtime())[std::string(runtime_fingerprint)];
+  const AutotuneMapsProto runtime_maps = AutotuneMapsToProto();
+  auto merge = [](const ConvMapProto &from, ConvMapProto *to) {
+    std::map<std::string, ConvMapProto::Entry> sorted_map;
+    for (const ConvMapProto &m : {*to, from}) {
+      for (const ConvMapProto::Entry &kv : m.kv_pairs()) {
+        sorted_map[autotune_maps_utils::SerializeProtoDeterministic(
+            kv.key())] = kv;
+      }
+    }
+    to->clear_kv_pairs();
+    for (auto &p : sorted_map) *to->add_kv_pairs() = std::move(p.second);
+  };
+  merge(runtime_maps.conv_map(), maps.mutable_conv_map());
+  merge(runtime_maps.fused_conv_map(), maps.mutable_fused_conv_map());
+
+  // Write a temporary file next to the store and rename it over the store,
+  // which is atomic on local file systems.
+  Env *env = Env::Default();
+  std::string tmp_path = path;
+  if (!env->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file name for ",
+                            path);
+  }
+  TF_RETURN_IF_ERROR(WriteStringToFile(
+      env, tmp_path, autotune_maps_utils::SerializeProtoDeterministic(store)));
+  Status rename_status = env->RenameFile(tmp_path, path);
+  if (!rename_status.ok()) {
+    env->DeleteFile(tmp_path).IgnoreError();
+  }
+  return rename_status;
+}
+
 void ResetAutotuneMaps() {
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
   ConvAutotuneMap::GetInstance()->ClearMap();
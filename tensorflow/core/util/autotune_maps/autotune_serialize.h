@@ -27,6 +27,7 @@ limitations under the License.
 
 #include <string>
 
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/platform/status.h"
 
 namespace tensorflow {
@@ -40,6 +41,26 @@ Status LoadSerializedAutotuneMaps(absl::string_view s);
 // LoadSerializedAutotuneMaps.
 Status SerializeAutotuneMaps(std::string* output);
 
+// The environment variable naming a persistent autotune store: a file holding
+// autotune results that several processes load at startup and update, so
+// that each new job does not autotune again.
+inline constexpr char kAutotuneStoreEnvVar[] = "TF_AUTOTUNE_STORE_FILE";
+
+// Loads the autotune maps that the store at `path` holds for
+// `runtime_fingerprint` (see AutotuneStoreProto) and uses them to update the
+// runtime autotune maps. Returns NotFound if the store does not exist or has
+// no results for `runtime_fingerprint`.
+Status LoadAutotuneStore(const std::string& path,
+                         absl::string_view runtime_fingerprint);
+
+// Merges the runtime autotune maps into the results that the store at `path`
+// holds for `runtime_fingerprint`, creating the store if needed. The store is
+// replaced atomically, so readers never see a partial file; concurrent
+// updates from other processes may be lost, but are merged again by their
+// next update.
+Status UpdateAutotuneStore(const std::string& path,
+                           absl::string_view runtime_fingerprint);
+
 // Resets all autotune maps. For test use only.
 void ResetAutotuneMaps();
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/util/autotune_maps/autotune_serialize.h"
 
 #include "absl/types/variant.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/util/autotune_maps/conv_autotune_maps.h"
@@ -173,6 +174,51 @@ TEST(AutotuneSerializeTest, VersionControl) {
                HasSubstr("Aborted because the loaded autotune results")));
   EXPECT_EQ(ConvAutotuneMap::GetInstance()->GetMap().size(), 0);
 }
+
+// Tests that UpdateAutotuneStore merges the current autotune maps into the
+// store under the runtime fingerprint, and that LoadAutotuneStore only loads
+// the entries recorded for a matching fingerprint.
+TEST(AutotuneSerializeTest, Store) {
+  TF_CHECK_OK(GpuDriver::Init());
+  ResetAutotuneMaps();
+  ConvParameters conv_params_example_a = {
+      /*batch=*/1,
+      /*in_depths=*/1,
+      /*in=*/{{1, 1}},
+      /*data_format=*/TensorFormat::FORMAT_NCHW,
+      /*out_depths=*/1,
+      /*filter=*/{{1, 1}},
+      /*dilation=*/{{1, 1}},
+      /*stride=*/{{1, 1}},
+      /*padding=*/{{1, 1}},
+      /*dtype=*/DataType::DT_INT8,
+      /*device_id=*/0,
+      /*group_count=*/1};
+  AlgorithmDesc algorithm(/*algo_id=*/1, /*use_tensor_ops=*/true);
+  AlgorithmDesc algorithm_no_scratch(/*algo_id=*/1, /*use_tensor_ops=*/true);
+  AutotuneEntry<se::dnn::ConvOp> example_a(algorithm, algorithm_no_scratch);
+  ConvAutotuneMap::GetInstance()->Insert(conv_params_example_a, example_a);
+
+  const std::string path =
+      io::JoinPath(::testing::TempDir(), "autotune_store.pb");
+  TF_CHECK_OK(UpdateAutotuneStore(path, "runtime_a"));
+  // Updating again with the same entries leaves a single copy of each.
+  TF_CHECK_OK(UpdateAutotuneStore(path, "runtime_a"));
+
+  ResetAutotuneMaps();
+  EXPECT_THAT(LoadAutotuneStore(path, "runtime_b"),
+              StatusIs(error::NOT_FOUND));
+  EXPECT_EQ(ConvAutotuneMap::GetInstance()->GetMap().size(), 0);
+  EXPECT_THAT(LoadAutotuneStore(io::JoinPath(path, "missing"), "runtime_a"),
+              StatusIs(error::NOT_FOUND));
+
+  TF_CHECK_OK(LoadAutotuneStore(path, "runtime_a"));
+  EXPECT_EQ(ConvAutotuneMap::GetInstance()->GetMap().size(), 1);
+  AutotuneEntry<se::dnn::ConvOp> entry;
+  EXPECT_TRUE(
+      ConvAutotuneMap::GetInstance()->Find(conv_params_example_a, &entry));
+  EXPECT_EQ(entry, example_a);
+}
 }  // namespace
 }  // namespace tensorflow
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -190,6 +190,64 @@ Status CopyElementToSlice(Tensor element, Tensor* parent, int64_t index) {
   }
 }
 
+template <typename T>
+Status ElementCopier::CopyValues(Tensor* element, Tensor* parent,
+                                 int64_t offset) {
+  return HandleElementToSlice<T>(*element, element->base<T>(),
+                                 parent->base<T>() + offset,
+                                 element->NumElements());
+}
+
+ElementCopier::ElementCopier(Tensor* parent) : parent_(parent) {
+  DCHECK_GT(parent->dims(), 0);
+  if (parent->dim_size(0) > 0) {
+    slice_num_values_ = parent->NumElements() / parent->dim_size(0);
+  }
+  if (DataTypeCanUseMemcpy(parent->dtype())) {
+    slice_bytes_ = slice_num_values_ * DataTypeSize(parent->dtype());
+    return;
+  }
+#define HANDLE_TYPE(T)             \
+  case DataTypeToEnum<T>::value: { \
+    copy_fn_ = &CopyValues<T>;     \
+    break;                         \
+  }
+
+  switch (parent->dtype()) {
+    TF_CALL_ALL_TYPES(HANDLE_TYPE);
+    TF_CALL_QUANTIZED_TYPES(HANDLE_TYPE);
+#undef HANDLE_TYPE
+    default:
+      break;
+  }
+}
+
+Status ElementCopier::CopyElementToSlice(Tensor element, int64_t index) const {
+  if (element.dtype() != parent_->dtype()) {
+    return errors::Internal(
+        "ElementCopier cannot perform copy: element has dtype ",
+        DataTypeString(element.dtype()), " but parent has dtype ",
+        DataTypeString(parent_->dtype()));
+  }
+  if (element.NumElements() != slice_num_values_) {
+    return ValidateInput(*parent_, element, index);
+  }
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, parent_->dim_size(0));
+  if (slice_bytes_ >= 0) {
+    if (slice_bytes_ > 0) {
+      memcpy(static_cast<char*>(parent_->data()) + index * slice_bytes_,
+             element.data(), slice_bytes_);
+    }
+    return OkStatus();
+  }
+  if (copy_fn_ == nullptr) {
+    return errors::Unimplemented("CopyElementToSlice Unhandled data type: ",
+                                 element.dtype());
+  }
+  return copy_fn_(&element, parent_, index * slice_num_values_);
+}
+
 // Copies the index^th slice of parent (in the 0th dimension) into element.
 Status CopySliceToElement(const Tensor& parent, Tensor* element,
                           int64_t index) {
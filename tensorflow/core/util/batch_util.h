@@ -29,6 +29,45 @@ namespace batch_util {
 // for DT_STRING tensors.
 Status CopyElementToSlice(Tensor element, Tensor* parent, int64_t index);
 
+// Copies elements into slices (in the 0th dimension) of a parent tensor.
+//
+// Unlike `CopyElementToSlice()`, which dispatches on the dtype of every
+// element it copies, the copier resolves the dtype and slice size of the
+// parent once, so copying many small elements (e.g. the scalar components of
+// a batch) only checks the size of each element and copies its values. Values
+// of types that can be copied with `memcpy` are copied with one `memcpy`
+// per element, and the values of DT_STRING and DT_VARIANT elements that are
+// not shared with other tensors are moved.
+class ElementCopier {
+ public:
+  // `parent` must have at least one dimension and outlive the copier.
+  explicit ElementCopier(Tensor* parent);
+
+  // Copies element into the index^th slice of the parent.
+  //
+  // The `element` argument is taken by value. Use `std::move()` to move the
+  // `element` argument into this function, so that its values can be moved
+  // instead of copied.
+  Status CopyElementToSlice(Tensor element, int64_t index) const;
+
+ private:
+  using CopyFn = Status (*)(Tensor* element, Tensor* parent, int64_t offset);
+
+  // Copies the values of `element` into `parent`, starting at the `offset`^th
+  // value of `parent`.
+  template <typename T>
+  static Status CopyValues(Tensor* element, Tensor* parent, int64_t offset);
+
+  Tensor* const parent_;
+  int64_t slice_num_values_ = 0;
+  // The number of bytes of a slice if the values of the parent can be copied
+  // with `memcpy`, and -1 otherwise.
+  int64_t slice_bytes_ = -1;
+  // Copies the values of an element whose values cannot be copied with
+  // `memcpy`, or nullptr if the dtype is not supported.
+  CopyFn copy_fn_ = nullptr;
+};
+
 // Copies the index^th slice of parent (in the 0th dimension) into element.
 Status CopySliceToElement(const Tensor& parent, Tensor* element, int64_t index);
 
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/coding.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
@@ -299,13 +300,52 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
+        if (packed_length == 0) {
+          // There may be no buffer left to point at, and nothing to decode.
+          stream.PopLimit(limit);
+          return true;
+        }
         auto packed_limit = stream.PushLimit(packed_length);
 
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64_t>(n));
+        const void* buffer;
+        int buffer_size;
+        if (!stream.GetDirectBufferPointer(&buffer, &buffer_size) ||
+            static_cast<uint32>(buffer_size) < packed_length) {
+          return false;
+        }
+        const char* begin = static_cast<const char*>(buffer);
+        const char* end = begin + packed_length;
+
+        // Every varint ends in exactly one byte with the high bit clear, so
+        // counting those bytes (a loop the compiler vectorizes) sizes the
+        // output once instead of growing it value by value.
+        size_t num_values = 0;
+        for (const char* p = begin; p < end; ++p) {
+          num_values += (static_cast<uint8>(*p) < 0x80);
+        }
+        if (static_cast<uint8>(end[-1]) >= 0x80) {
+          return false;
+        }
+
+        // As in ParseFloatList, size() may be less than requested for a
+        // LimitedArraySlice; values past it are decoded but dropped.
+        const size_t initial_size = int64_list->size();
+        int64_list->resize(initial_size + num_values);
+        const size_t available = int64_list->size();
+        size_t index = initial_size;
+        for (const char* p = begin; p < end; ++index) {
+          uint64 n;
+          if (static_cast<uint8>(*p) < 0x80) {
+            n = static_cast<uint8>(*p++);
+          } else {
+            p = core::GetVarint64Ptr(p, end, &n);
+            if (p == nullptr) return false;
+          }
+          if (index < available) {
+            int64_list->data()[index] = static_cast<int64_t>(n);
+          }
         }
+        if (!stream.Skip(packed_length)) return false;
 
         stream.PopLimit(packed_limit);
       } else {  // non-packed
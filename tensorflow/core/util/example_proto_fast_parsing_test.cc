@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <limits>
 #include <utility>
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
@@ -170,6 +171,37 @@ TEST(FastParse, Packed) {
       "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d");
 }
 
+TEST(FastParse, PackedInt64OfAllVarintLengths) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["age"]
+          .mutable_int64_list();
+  for (int shift = 0; shift < 64; shift += 7) {
+    int64_list->add_value(int64_t{1} << shift);
+    int64_list->add_value((int64_t{1} << shift) - 1);
+  }
+  int64_list->add_value(-1);
+  int64_list->add_value(std::numeric_limits<int64_t>::min());
+  int64_list->add_value(std::numeric_limits<int64_t>::max());
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, PackedInt64WithTruncatedVarint) {
+  // A packed int64 list holding one value whose only byte has its
+  // continuation bit set.
+  Example fast_example;
+  EXPECT_FALSE(TestFastParse("\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a"
+                             "\x03\x0a\x01\x8d",
+                             &fast_example));
+}
+
+TEST(FastParse, EmptyPackedInt64AtEndOfBuffer) {
+  // The explicit size keeps the trailing zero length of the packed list.
+  TestCorrectness(string(
+      "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x0a\x00",
+      15));
+}
+
 TEST(FastParse, ValueBeforeKeyInMap) {
   TestCorrectness("\x0a\x12\x0a\x10\x12\x09\x0a\x07\x0a\x05value\x0a\x03key");
 }
@@ -0,0 +1,503 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/mapped_graph_def.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/null_file_system.h"
+#include "tensorflow/core/protobuf/meta_graph.pb.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Field numbers on the path from a SavedModel to the tensor_content of the
+// "value" attr of the nodes of its graphs.
+constexpr uint32 kSavedModelMetaGraphsField = 2;
+constexpr uint32 kMetaGraphDefGraphDefField = 2;
+constexpr uint32 kGraphDefNodeField = 1;
+constexpr uint32 kGraphDefLibraryField = 2;
+constexpr uint32 kGraphDefVersionsField = 4;
+constexpr uint32 kNodeDefAttrField = 5;
+constexpr uint32 kMapEntryKeyField = 1;
+constexpr uint32 kMapEntryValueField = 2;
+constexpr uint32 kAttrValueTensorField = 8;
+constexpr uint32 kTensorProtoContentField = 4;
+
+constexpr int kLengthDelimited = 2;
+
+// A field unknown to GraphDef, with the largest valid field number, that
+// WriteBinaryGraphDefWithAlignedConstants() writes to align the nodes after
+// it.  Readers skip it.
+constexpr uint32 kPaddingField = (1u << 29) - 1;
+
+// Reads the next field of the serialized message in `*input`.  For length
+// delimited fields, `*value` is set to the bytes of the field, pointing into
+// `*input`.  Returns false if the message is malformed.
+bool NextField(StringPiece* input, uint32* field, int* wire_type,
+               StringPiece* value) {
+  uint64 tag;
+  if (!core::GetVarint64(input, &tag)) return false;
+  *field = static_cast<uint32>(tag >> 3);
+  *wire_type = static_cast<int>(tag & 7);
+  uint64 unused;
+  uint32 length;
+  switch (*wire_type) {
+    case 0:
+      return core::GetVarint64(input, &unused);
+    case 1:
+      length = 8;
+      break;
+    case kLengthDelimited:
+      if (!core::GetVarint32(input, &length)) return false;
+      break;
+    case 5:
+      length = 4;
+      break;
+    default:  // Groups are not used by these protos.
+      return false;
+  }
+  if (input->size() < length) return false;
+  *value = StringPiece(input->data(), length);
+  input->remove_prefix(length);
+  return true;
+}
+
+// Sets `*field_value` to the last length-delimited field `field` of the
+// serialized message `message`, for which `matches` returns true.  Returns
+// false if there is none.
+template <typename Predicate>
+bool FindField(StringPiece message, uint32 field, Predicate matches,
+               StringPiece* field_value) {
+  bool found = false;
+  uint32 number;
+  int wire_type;
+  StringPiece value;
+  while (!message.empty() &&
+         NextField(&message, &number, &wire_type, &value)) {
+    if (number == field && wire_type == kLengthDelimited && matches(value)) {
+      *field_value = value;
+      found = true;
+    }
+  }
+  return found;
+}
+
+bool AnyField(StringPiece value) { return true; }
+
+// Splits the serialized message `message` into the values of its
+// length-delimited fields `field`, appended to `values`, and its other fields
+// but padding, appended to `other_fields`.
+Status SplitFields(StringPiece message, uint32 field,
+                   std::vector<StringPiece>* values, string* other_fields) {
+  while (!message.empty()) {
+    const char* const field_start = message.data();
+    uint32 number;
+    int wire_type;
+    StringPiece value;
+    if (!NextField(&message, &number, &wire_type, &value)) {
+      return errors::DataLoss("Malformed binary proto");
+    }
+    if (number == field && wire_type == kLengthDelimited) {
+      values->push_back(value);
+    } else if (number != kPaddingField) {
+      other_fields->append(field_start, message.data() - field_start);
+    }
+  }
+  return OkStatus();
+}
+
+bool IsValueAttrEntry(StringPiece entry) {
+  StringPiece key;
+  return FindField(entry, kMapEntryKeyField, AnyField, &key) && key == "value";
+}
+
+// Finds the bytes of the tensor_content of the "value" attr in the serialized
+// NodeDef `node`.
+bool FindConstTensorContent(StringPiece node, StringPiece* content) {
+  StringPiece entry, attr, tensor;
+  return FindField(node, kNodeDefAttrField, IsValueAttrEntry, &entry) &&
+         FindField(entry, kMapEntryValueField, AnyField, &attr) &&
+         FindField(attr, kAttrValueTensorField, AnyField, &tensor) &&
+         FindField(tensor, kTensorProtoContentField, AnyField, content);
+}
+
+// Turns the Const node `node` into an ImmutableConst node reading its value
+// from `content`, at `offset` in `filename`, if it is big enough and
+// suitably aligned for the tensor buffer.
+void MaybeMapConstant(const string& filename, StringPiece content,
+                      uint64 offset, const MappedGraphDefOptions& options,
+                      NodeDef* node) {
+  if (static_cast<int64_t>(content.size()) < options.min_mapped_bytes ||
+      reinterpret_cast<uintptr_t>(content.data()) %
+              Allocator::kAllocatorAlignment !=
+          0) {
+    return;
+  }
+  // ImmutableConst only has a CPU kernel.
+  DeviceNameUtils::ParsedName device;
+  if (!DeviceNameUtils::ParseFullName(node->device(), &device) ||
+      (device.has_type && device.type != DEVICE_CPU)) {
+    return;
+  }
+  const auto value = node->attr().find("value");
+  if (value == node->attr().end() || !value->second.has_tensor()) return;
+  const TensorProto& tensor = value->second.tensor();
+  const DataType dtype = tensor.dtype();
+  if (!DataTypeCanUseMemcpy(dtype) ||
+      !TensorShape::IsValid(tensor.tensor_shape())) {
+    return;
+  }
+  const TensorShape shape(tensor.tensor_shape());
+  if (shape.num_elements() * DataTypeSize(dtype) != content.size()) return;
+
+  AttrValue shape_attr;
+  *shape_attr.mutable_shape() = tensor.tensor_shape();
+  AttrValue region_attr;
+  region_attr.set_s(strings::StrCat(kMappedConstantPrefix, offset, ":",
+                                    content.size(), ":", filename));
+  auto* attrs = node->mutable_attr();
+  attrs->erase("value");
+  (*attrs)["shape"] = std::move(shape_attr);
+  (*attrs)["memory_region_name"] = std::move(region_attr);
+  node->set_op("ImmutableConst");
+}
+
+class SliceOfReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  SliceOfReadOnlyMemoryRegion(std::unique_ptr<ReadOnlyMemoryRegion> region,
+                              uint64 offset, uint64 length)
+      : region_(std::move(region)), offset_(offset), length_(length) {}
+  ~SliceOfReadOnlyMemoryRegion() override = default;
+  const void* data() override {
+    return reinterpret_cast<const char*>(region_->data()) + offset_;
+  }
+  uint64 length() override { return length_; }
+
+ private:
+  const std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  const uint64 offset_;
+  const uint64 length_;
+};
+
+// Serves the regions named by MaybeMapConstant() by mapping slices of the
+// files they refer to.
+class MappedConstantFileSystem : public NullFileSystem {
+ public:
+  TF_USE_FILESYSTEM_METHODS_WITH_NO_TRANSACTION_SUPPORT;
+
+  Status NewReadOnlyMemoryRegionFromFile(
+      const string& fname, TransactionToken* token,
+      std::unique_ptr<ReadOnlyMemoryRegion>* result) override {
+    uint64 offset, length;
+    string filename;
+    TF_RETURN_IF_ERROR(ParseRegionName(fname, &offset, &length, &filename));
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    TF_RETURN_IF_ERROR(
+        Env::Default()->NewReadOnlyMemoryRegionFromFile(filename, &region));
+    if (offset > region->length() || length > region->length() - offset) {
+      return errors::DataLoss("Region ", fname, " is past the end of ",
+                              filename, " of ", region->length(), " bytes");
+    }
+    result->reset(
+        new SliceOfReadOnlyMemoryRegion(std::move(region), offset, length));
+    return OkStatus();
+  }
+
+  Status FileExists(const string& fname, TransactionToken* token) override {
+    uint64 offset, length;
+    string filename;
+    TF_RETURN_IF_ERROR(ParseRegionName(fname, &offset, &length, &filename));
+    return Env::Default()->FileExists(filename);
+  }
+
+ private:
+  static Status ParseRegionName(const string& fname, uint64* offset,
+                                uint64* length, string* filename) {
+    StringPiece name(fname);
+    std::vector<string> parts;
+    if (absl::ConsumePrefix(&name, kMappedConstantPrefix)) {
+      parts = absl::StrSplit(name, absl::MaxSplits(':', 2));
+    }
+    if (parts.size() != 3 || !strings::safe_strtou64(parts[0], offset) ||
+        !strings::safe_strtou64(parts[1], length)) {
+      return errors::InvalidArgument("Invalid mapped constant region ", fname);
+    }
+    *filename = std::move(parts[2]);
+    return OkStatus();
+  }
+};
+
+REGISTER_FILE_SYSTEM("mappedconst", MappedConstantFileSystem);
+
+// Parses the binary GraphDef `serialized`, which is in the mapping of
+// `filename` at `base`, mapping its big constants.  All the fields but the
+// nodes are parsed at once, and the nodes one by one right from the mapping,
+// mapping their constants before the next one.
+Status ParseGraphDef(StringPiece serialized, const char* base,
+                     const string& filename,
+                     const MappedGraphDefOptions& options,
+                     GraphDef* graph_def) {
+  std::vector<StringPiece> nodes;
+  string other_fields;
+  TF_RETURN_IF_ERROR(
+      SplitFields(serialized, kGraphDefNodeField, &nodes, &other_fields));
+  graph_def->Clear();
+  if (!graph_def->ParseFromString(other_fields)) {
+    return errors::DataLoss("Malformed binary proto");
+  }
+  graph_def->mutable_node()->Reserve(nodes.size());
+  for (StringPiece serialized_node : nodes) {
+    NodeDef* node = graph_def->add_node();
+    if (!node->ParseFromArray(serialized_node.data(), serialized_node.size())) {
+      return errors::DataLoss("Can't parse node ", graph_def->node_size() - 1);
+    }
+    StringPiece content;
+    if (node->op() == "Const" &&
+        FindConstTensorContent(serialized_node, &content)) {
+      MaybeMapConstant(filename, content, content.data() - base, options,
+                       node);
+    }
+  }
+  return OkStatus();
+}
+
+// Parses the binary SavedModel `serialized`, as ParseGraphDef().
+Status ParseSavedModel(StringPiece serialized, const char* base,
+                       const string& filename,
+                       const MappedGraphDefOptions& options,
+                       SavedModel* saved_model) {
+  std::vector<StringPiece> meta_graphs;
+  string other_fields;
+  TF_RETURN_IF_ERROR(SplitFields(serialized, kSavedModelMetaGraphsField,
+                                 &meta_graphs, &other_fields));
+  saved_model->Clear();
+  if (!saved_model->ParseFromString(other_fields)) {
+    return errors::DataLoss("Malformed binary proto");
+  }
+  for (StringPiece serialized_meta_graph : meta_graphs) {
+    MetaGraphDef* meta_graph = saved_model->add_meta_graphs();
+    std::vector<StringPiece> graphs;
+    other_fields.clear();
+    TF_RETURN_IF_ERROR(SplitFields(serialized_meta_graph,
+                                   kMetaGraphDefGraphDefField, &graphs,
+                                   &other_fields));
+    if (!meta_graph->ParseFromString(other_fields)) {
+      return errors::DataLoss("Malformed binary proto");
+    }
+    // Repeated occurrences of a message field are merged.
+    for (StringPiece serialized_graph : graphs) {
+      GraphDef graph_def;
+      TF_RETURN_IF_ERROR(
+          ParseGraphDef(serialized_graph, base, filename, options, &graph_def));
+      if (meta_graph->has_graph_def()) {
+        meta_graph->mutable_graph_def()->MergeFrom(graph_def);
+      } else {
+        meta_graph->mutable_graph_def()->Swap(&graph_def);
+      }
+    }
+  }
+  return OkStatus();
+}
+
+// Maps `filename` into `*region`, or returns false if it can't be mapped or
+// its constants can't be aliased.
+bool MapFile(Env* env, const string& filename,
+             std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+  // Big-endian hosts need to swap the bytes of tensor contents.
+  return port::kLittleEndian &&
+         env->NewReadOnlyMemoryRegionFromFile(filename, region).ok() &&
+         (*region)->length() <= static_cast<uint64>(kint32max);
+}
+
+// Appends the tag of the length-delimited field `field` to `*out`.
+void AppendTag(uint32 field, string* out) {
+  core::PutVarint32(out, (field << 3) | kLengthDelimited);
+}
+
+// Appends the length-delimited field `field` with value `value` to `*out`.
+void AppendField(uint32 field, StringPiece value, string* out) {
+  AppendTag(field, out);
+  core::PutVarint32(out, value.size());
+  out->append(value.data(), value.size());
+}
+
+// Appends the tag of the length-delimited field `field` to `*out`, followed
+// by room for its length, and returns where that room starts.  The value is
+// appended next and its length set by SetFieldLength(), so that the offsets
+// in `*out` of the value are known while it is written.
+size_t StartField(uint32 field, string* out) {
+  AppendTag(field, out);
+  const size_t length_start = out->size();
+  out->append(core::kMaxVarint32Bytes, '\0');
+  return length_start;
+}
+
+// Sets the length of the field started at `length_start` to the bytes
+// appended to `*out` since.  The length is encoded in all the bytes left for
+// it, with redundant continuation bits, which parsers accept.
+void SetFieldLength(size_t length_start, string* out) {
+  uint32 length = out->size() - length_start - core::kMaxVarint32Bytes;
+  char* const bytes = &(*out)[length_start];
+  for (int i = 0; i < core::kMaxVarint32Bytes - 1; ++i) {
+    bytes[i] = static_cast<char>((length & 0x7f) | 0x80);
+    length >>= 7;
+  }
+  bytes[core::kMaxVarint32Bytes - 1] = static_cast<char>(length);
+}
+
+// Appends a padding field to `*out`, if needed for the byte `offset` bytes
+// after it to be aligned for the tensor allocator.
+void AppendPadding(size_t offset, string* out) {
+  if ((out->size() + offset) % Allocator::kAllocatorAlignment == 0) return;
+  // The padding field has a one byte length.
+  const size_t end = out->size() +
+                     core::VarintLength((kPaddingField << 3) | kLengthDelimited) +
+                     1 + offset;
+  const size_t padding = (Allocator::kAllocatorAlignment -
+                          end % Allocator::kAllocatorAlignment) %
+                         Allocator::kAllocatorAlignment;
+  AppendField(kPaddingField, string(padding, '\0'), out);
+}
+
+// Appends the fields of `graph_def` to `*out`, which holds the file from its
+// start, aligning the big constants.
+void AppendGraphDef(const GraphDef& graph_def,
+                    const MappedGraphDefOptions& options, string* out) {
+  for (const NodeDef& node : graph_def.node()) {
+    const string serialized = node.SerializeAsString();
+    StringPiece content;
+    if (node.op() == "Const" && FindConstTensorContent(serialized, &content) &&
+        static_cast<int64_t>(content.size()) >= options.min_mapped_bytes) {
+      AppendPadding(core::VarintLength((kGraphDefNodeField << 3) |
+                                       kLengthDelimited) +
+                        core::VarintLength(serialized.size()) +
+                        (content.data() - serialized.data()),
+                    out);
+    }
+    AppendField(kGraphDefNodeField, serialized, out);
+  }
+  if (graph_def.has_library()) {
+    AppendField(kGraphDefLibraryField, graph_def.library().SerializeAsString(),
+                out);
+  }
+  if (graph_def.has_versions()) {
+    AppendField(kGraphDefVersionsField,
+                graph_def.versions().SerializeAsString(), out);
+  }
+}
+
+}  // namespace
+
+Status ReadBinaryGraphDefWithMappedConstants(
+    Env* env, const string& filename, const MappedGraphDefOptions& options,
+    GraphDef* graph_def) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  if (!MapFile(env, filename, &region)) {
+    return ReadBinaryProto(env, filename, graph_def);
+  }
+  const char* const base = reinterpret_cast<const char*>(region->data());
+  Status status = ParseGraphDef(StringPiece(base, region->length()), base,
+                                filename, options, graph_def);
+  if (!status.ok()) {
+    return errors::DataLoss("Can't parse ", filename,
+                            " as binary proto: ", status.error_message());
+  }
+  return OkStatus();
+}
+
+Status ReadBinarySavedModelWithMappedConstants(
+    Env* env, const string& filename, const MappedGraphDefOptions& options,
+    SavedModel* saved_model) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  if (!MapFile(env, filename, &region)) {
+    return ReadBinaryProto(env, filename, saved_model);
+  }
+  const char* const base = reinterpret_cast<const char*>(region->data());
+  Status status = ParseSavedModel(StringPiece(base, region->length()), base,
+                                  filename, options, saved_model);
+  if (!status.ok()) {
+    return errors::DataLoss("Can't parse ", filename,
+                            " as binary proto: ", status.error_message());
+  }
+  return OkStatus();
+}
+
+Status WriteBinaryGraphDefWithAlignedConstants(
+    Env* env, const string& filename, const GraphDef& graph_def,
+    const MappedGraphDefOptions& options) {
+  string contents;
+  AppendGraphDef(graph_def, options, &contents);
+  return WriteStringToFile(env, filename, contents);
+}
+
+Status WriteBinarySavedModelWithAlignedConstants(
+    Env* env, const string& filename, const SavedModel& saved_model,
+    const MappedGraphDefOptions& options) {
+  SavedModel other_fields;
+  other_fields.set_saved_model_schema_version(
+      saved_model.saved_model_schema_version());
+  string contents = other_fields.SerializeAsString();
+  for (const MetaGraphDef& meta_graph : saved_model.meta_graphs()) {
+    const size_t meta_graph_start =
+        StartField(kSavedModelMetaGraphsField, &contents);
+    // Everything but the graph, which is written last.
+    MetaGraphDef other_meta_graph_fields;
+    if (meta_graph.has_meta_info_def()) {
+      *other_meta_graph_fields.mutable_meta_info_def() =
+          meta_graph.meta_info_def();
+    }
+    if (meta_graph.has_saver_def()) {
+      *other_meta_graph_fields.mutable_saver_def() = meta_graph.saver_def();
+    }
+    *other_meta_graph_fields.mutable_collection_def() =
+        meta_graph.collection_def();
+    *other_meta_graph_fields.mutable_signature_def() =
+        meta_graph.signature_def();
+    *other_meta_graph_fields.mutable_asset_file_def() =
+        meta_graph.asset_file_def();
+    if (meta_graph.has_object_graph_def()) {
+      *other_meta_graph_fields.mutable_object_graph_def() =
+          meta_graph.object_graph_def();
+    }
+    contents.append(other_meta_graph_fields.SerializeAsString());
+    const size_t graph_start =
+        StartField(kMetaGraphDefGraphDefField, &contents);
+    AppendGraphDef(meta_graph.graph_def(), options, &contents);
+    SetFieldLength(graph_start, &contents);
+    SetFieldLength(meta_graph_start, &contents);
+  }
+  return WriteStringToFile(env, filename, contents);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,82 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_MAPPED_GRAPH_DEF_H_
+#define TENSORFLOW_CORE_UTIL_MAPPED_GRAPH_DEF_H_
+
+#include <string>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/saved_model.pb.h"
+
+namespace tensorflow {
+
+// Memory regions of constants left in a mapped GraphDef file use this prefix,
+// followed by "<offset>:<length>:<filename>".  They are served by a file
+// system registered for it, so that ImmutableConst kernels can map them from
+// Env::Default() like regions of a memmapped package.
+constexpr char kMappedConstantPrefix[] = "mappedconst://";
+
+struct MappedGraphDefOptions {
+  // Const nodes whose tensor_content has at least this many bytes are mapped
+  // from the file instead of being copied into the GraphDef.
+  int64_t min_mapped_bytes = 1 << 20;
+};
+
+// Reads the binary GraphDef in `filename` through a read-only memory mapping
+// of the file.  Each Const node of the graph whose tensor_content has at least
+// `options.min_mapped_bytes` and is suitably aligned in the file is turned
+// into an ImmutableConst node that aliases those bytes of the file, so the
+// contents of the constant are never copied to the heap.  Nodes are parsed
+// one at a time, so the peak memory use is that of the resulting GraphDef
+// plus the largest node.
+//
+// Other constants, including those in the function library, are read as by
+// ReadBinaryProto(), which is also used when `env` cannot map `filename`.
+// The file must not change while the graph is in use.
+//
+// ReadBinaryProto() reads the file as usual.  Files written by
+// WriteBinaryGraphDefWithAlignedConstants() have all their big constants
+// aligned; in others they are only aligned by chance.
+Status ReadBinaryGraphDefWithMappedConstants(
+    Env* env, const std::string& filename,
+    const MappedGraphDefOptions& options, GraphDef* graph_def);
+
+// Like ReadBinaryGraphDefWithMappedConstants(), for the graphs of the binary
+// SavedModel in `filename`, such as a saved_model.pb.
+Status ReadBinarySavedModelWithMappedConstants(
+    Env* env, const std::string& filename,
+    const MappedGraphDefOptions& options, SavedModel* saved_model);
+
+// Writes `graph_def` to `filename` in binary, with the tensor_content of its
+// Const nodes of at least `options.min_mapped_bytes` aligned in the file for
+// ReadBinaryGraphDefWithMappedConstants().  Alignment is achieved by padding
+// fields unknown to GraphDef before those nodes.  The deprecated `version`
+// field is not written.
+Status WriteBinaryGraphDefWithAlignedConstants(
+    Env* env, const std::string& filename, const GraphDef& graph_def,
+    const MappedGraphDefOptions& options);
+
+// Like WriteBinaryGraphDefWithAlignedConstants(), for the graphs of
+// `saved_model`.
+Status WriteBinarySavedModelWithAlignedConstants(
+    Env* env, const std::string& filename, const SavedModel& saved_model,
+    const MappedGraphDefOptions& options);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_MAPPED_GRAPH_DEF_H_
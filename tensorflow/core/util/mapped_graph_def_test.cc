@@ -0,0 +1,224 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/mapped_graph_def.h"
+
+#include <cstring>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kBigTensorSize = 4096;
+
+NodeDef ConstNode(const string& name, const Tensor& value) {
+  NodeDef node;
+  TF_CHECK_OK(NodeDefBuilder(name, "Const")
+                  .Attr("dtype", value.dtype())
+                  .Attr("value", value)
+                  .Finalize(&node));
+  return node;
+}
+
+// Writes a graph with a small and a big constant to `filename`, padding the
+// name of the big one so that its contents are aligned for mapping iff
+// `aligned`.  Returns the big constant.
+Tensor WriteGraph(const string& filename, bool aligned, GraphDef* graph_def) {
+  Tensor big(DT_FLOAT, TensorShape({kBigTensorSize}));
+  test::FillFn<float>(&big, [](int i) { return static_cast<float>(i) + 0.5f; });
+  const StringPiece content = big.tensor_data();
+  for (int padding = 0;; ++padding) {
+    graph_def->Clear();
+    graph_def->mutable_versions()->set_producer(42);
+    *graph_def->add_node() = ConstNode("small", test::AsScalar<float>(1.0f));
+    *graph_def->add_node() =
+        ConstNode(strings::StrCat("big", string(padding, 'x')), big);
+    string serialized;
+    graph_def->SerializeToString(&serialized);
+    const size_t offset = serialized.find(string(content));
+    CHECK_NE(offset, string::npos);
+    if ((offset % Allocator::kAllocatorAlignment == 0) == aligned) {
+      TF_CHECK_OK(WriteStringToFile(Env::Default(), filename, serialized));
+      return big;
+    }
+  }
+}
+
+TEST(MappedGraphDefTest, MapsBigAlignedConstants) {
+  Env* env = Env::Default();
+  const string filename = io::JoinPath(testing::TmpDir(), "mapped_graph.pb");
+  GraphDef original;
+  const Tensor big = WriteGraph(filename, /*aligned=*/true, &original);
+
+  MappedGraphDefOptions options;
+  options.min_mapped_bytes = 1024;
+  GraphDef graph_def;
+  TF_ASSERT_OK(ReadBinaryGraphDefWithMappedConstants(env, filename, options,
+                                                     &graph_def));
+  EXPECT_EQ(graph_def.versions().producer(), 42);
+  ASSERT_EQ(graph_def.node_size(), 2);
+  EXPECT_EQ(graph_def.node(0).DebugString(), original.node(0).DebugString());
+
+  const NodeDef& node = graph_def.node(1);
+  EXPECT_EQ(node.name(), original.node(1).name());
+  EXPECT_EQ(node.op(), "ImmutableConst");
+  EXPECT_EQ(node.attr().count("value"), 0);
+  EXPECT_EQ(node.attr().at("dtype").type(), DT_FLOAT);
+  EXPECT_EQ(TensorShape(node.attr().at("shape").shape()), big.shape());
+
+  // The region aliases the contents of the constant in the file.
+  const string& region_name = node.attr().at("memory_region_name").s();
+  EXPECT_TRUE(absl::StartsWith(region_name, kMappedConstantPrefix));
+  TF_EXPECT_OK(env->FileExists(region_name));
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_ASSERT_OK(env->NewReadOnlyMemoryRegionFromFile(region_name, &region));
+  ASSERT_EQ(region->length(), big.TotalBytes());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(region->data()) %
+                Allocator::kAllocatorAlignment,
+            0);
+  EXPECT_EQ(memcmp(region->data(), big.tensor_data().data(), region->length()),
+            0);
+}
+
+TEST(MappedGraphDefTest, KeepsOtherConstants) {
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "unaligned_graph.pb");
+  GraphDef original;
+  WriteGraph(filename, /*aligned=*/false, &original);
+
+  // Neither the small constant nor the misaligned one are mapped.
+  MappedGraphDefOptions options;
+  options.min_mapped_bytes = 1;
+  GraphDef graph_def;
+  TF_ASSERT_OK(ReadBinaryGraphDefWithMappedConstants(
+      Env::Default(), filename, options, &graph_def));
+  EXPECT_EQ(graph_def.DebugString(), original.DebugString());
+
+  // Nor are big aligned ones with a higher threshold.
+  WriteGraph(filename, /*aligned=*/true, &original);
+  options.min_mapped_bytes = kBigTensorSize * sizeof(float) + 1;
+  TF_ASSERT_OK(ReadBinaryGraphDefWithMappedConstants(
+      Env::Default(), filename, options, &graph_def));
+  EXPECT_EQ(graph_def.DebugString(), original.DebugString());
+}
+
+// Returns a graph with a small constant and a big one, `*big`.
+GraphDef MakeGraph(Tensor* big) {
+  *big = Tensor(DT_FLOAT, TensorShape({kBigTensorSize}));
+  test::FillFn<float>(big, [](int i) { return static_cast<float>(i) * 2; });
+  GraphDef graph_def;
+  graph_def.mutable_versions()->set_producer(42);
+  *graph_def.add_node() = ConstNode("small", test::AsScalar<float>(1.0f));
+  *graph_def.add_node() = ConstNode("big", *big);
+  return graph_def;
+}
+
+// Checks that `node` aliases `big` in its file.
+void ExpectMapped(const NodeDef& node, const Tensor& big) {
+  EXPECT_EQ(node.op(), "ImmutableConst");
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_ASSERT_OK(Env::Default()->NewReadOnlyMemoryRegionFromFile(
+      node.attr().at("memory_region_name").s(), &region));
+  ASSERT_EQ(region->length(), big.TotalBytes());
+  EXPECT_EQ(memcmp(region->data(), big.tensor_data().data(), region->length()),
+            0);
+}
+
+TEST(MappedGraphDefTest, WritesAlignedConstants) {
+  Env* env = Env::Default();
+  const string filename = io::JoinPath(testing::TmpDir(), "aligned_graph.pb");
+  Tensor big;
+  const GraphDef original = MakeGraph(&big);
+  MappedGraphDefOptions options;
+  options.min_mapped_bytes = 1024;
+  TF_ASSERT_OK(WriteBinaryGraphDefWithAlignedConstants(env, filename, original,
+                                                       options));
+
+  // The file is an ordinary GraphDef.
+  GraphDef graph_def;
+  TF_ASSERT_OK(ReadBinaryProto(env, filename, &graph_def));
+  ASSERT_EQ(graph_def.node_size(), 2);
+  EXPECT_EQ(graph_def.node(1).DebugString(), original.node(1).DebugString());
+  EXPECT_EQ(graph_def.versions().producer(), 42);
+
+  TF_ASSERT_OK(ReadBinaryGraphDefWithMappedConstants(env, filename, options,
+                                                     &graph_def));
+  ASSERT_EQ(graph_def.node_size(), 2);
+  EXPECT_EQ(graph_def.node(0).DebugString(), original.node(0).DebugString());
+  ExpectMapped(graph_def.node(1), big);
+
+  // Without mapping, the padding is dropped.
+  options.min_mapped_bytes = kBigTensorSize * sizeof(float) + 1;
+  TF_ASSERT_OK(ReadBinaryGraphDefWithMappedConstants(env, filename, options,
+                                                     &graph_def));
+  EXPECT_EQ(graph_def.DebugString(), original.DebugString());
+}
+
+TEST(MappedGraphDefTest, MapsConstantsOfSavedModel) {
+  Env* env = Env::Default();
+  const string filename = io::JoinPath(testing::TmpDir(), "saved_model.pb");
+  Tensor big;
+  SavedModel original;
+  original.set_saved_model_schema_version(1);
+  MetaGraphDef* meta_graph = original.add_meta_graphs();
+  meta_graph->mutable_meta_info_def()->add_tags("serve");
+  (*meta_graph->mutable_signature_def())["serving_default"].set_method_name(
+      "predict");
+  *meta_graph->mutable_graph_def() = MakeGraph(&big);
+  MappedGraphDefOptions options;
+  options.min_mapped_bytes = 1024;
+  TF_ASSERT_OK(WriteBinarySavedModelWithAlignedConstants(env, filename,
+                                                         original, options));
+
+  SavedModel saved_model;
+  TF_ASSERT_OK(ReadBinaryProto(env, filename, &saved_model));
+  ASSERT_EQ(saved_model.meta_graphs_size(), 1);
+  EXPECT_EQ(saved_model.meta_graphs(0).graph_def().node(1).DebugString(),
+            meta_graph->graph_def().node(1).DebugString());
+
+  TF_ASSERT_OK(ReadBinarySavedModelWithMappedConstants(env, filename, options,
+                                                       &saved_model));
+  EXPECT_EQ(saved_model.saved_model_schema_version(), 1);
+  ASSERT_EQ(saved_model.meta_graphs_size(), 1);
+  const MetaGraphDef& read = saved_model.meta_graphs(0);
+  EXPECT_EQ(read.meta_info_def().DebugString(),
+            meta_graph->meta_info_def().DebugString());
+  EXPECT_EQ(read.signature_def().at("serving_default").method_name(),
+            "predict");
+  EXPECT_EQ(read.graph_def().versions().producer(), 42);
+  ASSERT_EQ(read.graph_def().node_size(), 2);
+  EXPECT_EQ(read.graph_def().node(0).op(), "Const");
+  ExpectMapped(read.graph_def().node(1), big);
+}
+
+TEST(MappedGraphDefTest, InvalidRegionName) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      Env::Default()->NewReadOnlyMemoryRegionFromFile(
+          strings::StrCat(kMappedConstantPrefix, "12:/tmp/file"), &region)));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,13 +15,44 @@ limitations under the License.
 
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace sparse {
 
 namespace {
 
+// Below this many rows `Reorder()` uses a comparison sort.
+constexpr int64_t kRadixSortMinEntries = 1024;
+// Rows handled by each parallel chunk of the radix sort.
+constexpr int64_t kRadixSortRowsPerChunk = 1 << 15;
+constexpr int kRadixBits = 8;
+constexpr int kRadixBuckets = 1 << kRadixBits;
+
+// Runs `fn(chunk, begin, end)` over `num_chunks` contiguous chunks of
+// `[0, n)`, in parallel on `pool` when one is given.
+template <typename Fn>
+void RunRadixChunks(thread::ThreadPool* pool, int num_chunks, int64_t n,
+                    Fn fn) {
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  auto work = [&](int64_t start, int64_t limit) {
+    for (int64_t c = start; c < limit; ++c) {
+      fn(static_cast<int>(c), c * chunk_size,
+         std::min(n, (c + 1) * chunk_size));
+    }
+  };
+  if (pool == nullptr || num_chunks == 1) {
+    work(0, num_chunks);
+  } else {
+    Shard(pool->NumThreads(), pool, num_chunks, chunk_size * 64, work);
+  }
+}
+
 int UnsafeGetDimsFromIx(const Tensor& ix) {
   DCHECK(TensorShapeUtils::IsMatrix(ix.shape()));
   return ix.dim_size(1);
@@ -275,6 +306,105 @@ Status SparseTensor::IndicesValidHelper() const {
   return OkStatus();
 }
 
+bool SparseTensor::RadixSortOrder(const VarDimArray& order,
+                                  thread::ThreadPool* pool,
+                                  std::vector<int64_t>* reorder) const {
+  const int64_t n = num_entries();
+  if (dims_ == 0 || n < kRadixSortMinEntries) return false;
+
+  // Strides of the indices linearized in `order`.
+  gtl::InlinedVector<uint64, 8> strides(dims_);
+  uint64 num_elements = 1;
+  for (int d = dims_ - 1; d >= 0; --d) {
+    const int64_t size = shape_[order[d]];
+    if (size <= 0) return false;
+    if (num_elements > std::numeric_limits<uint64>::max() / size) {
+      return false;
+    }
+    strides[d] = num_elements;
+    num_elements *= size;
+  }
+
+  const int num_chunks = static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(pool == nullptr ? 1 : 2 * pool->NumThreads(),
+                           n / kRadixSortRowsPerChunk)));
+  const auto ix_t = ix_.matrix<int64_t>();
+  std::vector<uint64> keys(n);
+  std::vector<char> chunk_in_bounds(num_chunks, true);
+  std::vector<char> chunk_sorted(num_chunks, true);
+  RunRadixChunks(pool, num_chunks, n, [&](int c, int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      uint64 key = 0;
+      for (int d = 0; d < dims_; ++d) {
+        const int64_t ix = ix_t(i, order[d]);
+        if (ix < 0 || ix >= shape_[order[d]]) {
+          chunk_in_bounds[c] = false;
+          return;
+        }
+        key += static_cast<uint64>(ix) * strides[d];
+      }
+      keys[i] = key;
+      if (i > begin && keys[i - 1] > key) chunk_sorted[c] = false;
+    }
+  });
+  bool sorted = true;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  for (int c = 0; c < num_chunks; ++c) {
+    if (!chunk_in_bounds[c]) return false;
+    sorted = sorted && chunk_sorted[c] &&
+             (c == 0 || keys[c * chunk_size - 1] <= keys[c * chunk_size]);
+  }
+  if (sorted) {
+    reorder->clear();
+    return true;
+  }
+
+  // Stable LSD radix sort of (key, row) pairs. Each pass histograms its
+  // digit per chunk, then scatters every chunk to its own offsets, and is
+  // skipped when all keys share that digit.
+  int key_bits = 0;
+  while (key_bits < 64 && ((num_elements - 1) >> key_bits) != 0) ++key_bits;
+  std::vector<uint64> keys_tmp(n);
+  std::vector<int64_t> rows(n);
+  std::vector<int64_t> rows_tmp(n);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<int64_t> offsets(static_cast<size_t>(num_chunks) *
+                               kRadixBuckets);
+  for (int shift = 0; shift < key_bits; shift += kRadixBits) {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    RunRadixChunks(pool, num_chunks, n, [&](int c, int64_t begin, int64_t end) {
+      int64_t* hist = &offsets[c * kRadixBuckets];
+      for (int64_t i = begin; i < end; ++i) {
+        ++hist[(keys[i] >> shift) & (kRadixBuckets - 1)];
+      }
+    });
+    int64_t running = 0;
+    bool single_bucket = false;
+    for (int b = 0; b < kRadixBuckets; ++b) {
+      const int64_t bucket_begin = running;
+      for (int c = 0; c < num_chunks; ++c) {
+        const int64_t count = offsets[c * kRadixBuckets + b];
+        offsets[c * kRadixBuckets + b] = running;
+        running += count;
+      }
+      if (running - bucket_begin == n) single_bucket = true;
+    }
+    if (single_bucket) continue;
+    RunRadixChunks(pool, num_chunks, n, [&](int c, int64_t begin, int64_t end) {
+      int64_t* cursor = &offsets[c * kRadixBuckets];
+      for (int64_t i = begin; i < end; ++i) {
+        const int64_t dst = cursor[(keys[i] >> shift) & (kRadixBuckets - 1)]++;
+        keys_tmp[dst] = keys[i];
+        rows_tmp[dst] = rows[i];
+      }
+    });
+    keys.swap(keys_tmp);
+    rows.swap(rows_tmp);
+  }
+  *reorder = std::move(rows);
+  return true;
+}
+
 Status SparseTensor::IndicesValid() const {
   if (shape_.size() == 1 && IndicesValidVectorFastPath()) {
     return OkStatus();
@@ -37,6 +37,11 @@ limitations under the License.
 #include "tensorflow/core/util/sparse/group_iterator.h"
 
 namespace tensorflow {
+
+namespace thread {
+class ThreadPool;
+}  // namespace thread
+
 namespace sparse {
 
 class SparseTensor {
@@ -120,8 +125,12 @@ class SparseTensor {
   VarDimArray order() const { return order_; }
 
   // Resorts the indices and values according to the dimensions in order.
+  //
+  // When the linearized indices fit in 64 bits the rows are ordered with a
+  // radix sort, split across `pool` if one is given; rows that are already
+  // in order are left untouched.
   template <typename T>
-  void Reorder(const VarDimArray& order);
+  void Reorder(const VarDimArray& order, thread::ThreadPool* pool = nullptr);
 
   // Returns a group iterable that can be used for clumping indices
   // and values according to the group indices of interest.
@@ -214,6 +223,15 @@ class SparseTensor {
   template <bool standard_order>
   Status IndicesValidHelper() const;
 
+  // Computes in `reorder` the row permutation that sorts the indices by
+  // `order`, using a radix sort over the indices linearized in that order.
+  // Leaves `reorder` empty if the rows are already sorted. Returns false, and
+  // leaves `reorder` untouched, if the linearized indices do not fit in 64
+  // bits, some index is out of bounds, or there are too few rows for the
+  // radix sort to pay off.
+  bool RadixSortOrder(const VarDimArray& order, thread::ThreadPool* pool,
+                      std::vector<int64_t>* reorder) const;
+
   // Helper for ToDense<T>()
   template <typename T>
   bool ValidateAndInitializeToDense(Tensor* out, bool initialize);
@@ -267,37 +285,46 @@ class SparseTensor {
 };
 
 // This operation updates the indices and values Tensor rows, so it is
-// an in-place algorithm.  It requires O(N log N) time and O(N)
-// temporary space.
+// an in-place algorithm.  It requires O(N log N) time (O(N) when the radix
+// sort applies) and O(N) temporary space.
 template <typename T>
-inline void SparseTensor::Reorder(const VarDimArray& order) {
+inline void SparseTensor::Reorder(const VarDimArray& order,
+                                  thread::ThreadPool* pool) {
   DCHECK_EQ(DataTypeToEnum<T>::v(), dtype())
       << "Reorder requested with the wrong datatype";
   DCHECK_EQ(order.size(), dims_) << "Order length must be SparseTensor rank";
   auto ix_t = ix_.matrix<int64_t>();
   auto vals_t = vals_.vec<T>();
 
-  std::vector<int64_t> reorder(num_entries());
-  std::iota(reorder.begin(), reorder.end(), 0);
+  std::vector<int64_t> reorder;
+  if (RadixSortOrder(order, pool, &reorder)) {
+    if (reorder.empty()) {
+      order_ = ShapeArray(order.begin(), order.end());
+      return;
+    }
+  } else {
+    reorder.resize(num_entries());
+    std::iota(reorder.begin(), reorder.end(), 0);
 
-  // Sort to get order of indices
-  switch (order.size()) {
+    // Sort to get order of indices
+    switch (order.size()) {
 #define CASE_SORT(ORDER_SIZE)                                    \
   case ORDER_SIZE: {                                             \
     FixedDimComparator<ORDER_SIZE> sorter(ix_t, order, shape()); \
     std::sort(reorder.begin(), reorder.end(), sorter);           \
     break;                                                       \
   }
-    CASE_SORT(0);
-    CASE_SORT(1);
-    CASE_SORT(2);
-    CASE_SORT(3);
-    CASE_SORT(4);
-    CASE_SORT(5);
+      CASE_SORT(0);
+      CASE_SORT(1);
+      CASE_SORT(2);
+      CASE_SORT(3);
+      CASE_SORT(4);
+      CASE_SORT(5);
 #undef CASE_SORT
-    default: {
-      DimComparator sorter(ix_t, order, shape());
-      std::sort(reorder.begin(), reorder.end(), sorter);
+      default: {
+        DimComparator sorter(ix_t, order, shape());
+        std::sort(reorder.begin(), reorder.end(), sorter);
+      }
     }
   }
 
@@ -21,12 +21,15 @@ limitations under the License.
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace sparse {
@@ -271,6 +274,65 @@ TEST(SparseTensorTest, SortingWorksCorrectly) {
   }
 }
 
+// Large enough to take the radix sort path; each value records its row's
+// original position so that the rows can be checked to travel intact.
+void CheckLargeReorder(const std::vector<int64_t>& shape, int64_t max_index,
+                       thread::ThreadPool* pool) {
+  const int N = 50000;
+  const int NDIM = shape.size();
+  Tensor ix(DT_INT64, TensorShape({N, NDIM}));
+  Tensor vals(DT_INT64, TensorShape({N}));
+  auto ix_t = ix.matrix<int64_t>();
+  auto vals_t = vals.vec<int64_t>();
+  random::PhiloxRandom philox(17, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int n = 0; n < N; ++n) {
+    for (int d = 0; d < NDIM; ++d) ix_t(n, d) = rnd.Uniform64(max_index);
+    vals_t(n) = n;
+  }
+  const Tensor original_ix = tensor::DeepCopy(ix);
+  const auto original_ix_t = original_ix.matrix<int64_t>();
+
+  SparseTensor st;
+  TF_ASSERT_OK(SparseTensor::Create(ix, vals, shape, &st));
+  for (const std::vector<int64_t>& order :
+       std::vector<std::vector<int64_t>>{{0, 1, 2}, {2, 0, 1}, {0, 1, 2}}) {
+    st.Reorder<int64_t>(order, pool);
+    EXPECT_EQ(st.order(), order);
+    const auto sorted_ix_t = st.indices().matrix<int64_t>();
+    const auto sorted_vals_t = st.values().vec<int64_t>();
+    for (int n = 0; n < N; ++n) {
+      for (int d = 0; d < NDIM; ++d) {
+        ASSERT_EQ(sorted_ix_t(n, d), original_ix_t(sorted_vals_t(n), d));
+      }
+      if (n == 0) continue;
+      bool less_equal = true;
+      for (int64_t d : order) {
+        if (sorted_ix_t(n - 1, d) != sorted_ix_t(n, d)) {
+          less_equal = sorted_ix_t(n - 1, d) < sorted_ix_t(n, d);
+          break;
+        }
+      }
+      ASSERT_TRUE(less_equal) << "rows " << n - 1 << " and " << n;
+    }
+  }
+}
+
+TEST(SparseTensorTest, LargeReorderWithRadixSort) {
+  CheckLargeReorder({1000, 1000, 1000}, 1000, nullptr);
+}
+
+TEST(SparseTensorTest, LargeReorderWithRadixSortOnThreadPool) {
+  thread::ThreadPool pool(Env::Default(), "reorder", 4);
+  CheckLargeReorder({100, 5000, 70}, 70, &pool);
+}
+
+TEST(SparseTensorTest, LargeReorderBeyond64BitFallsBack) {
+  thread::ThreadPool pool(Env::Default(), "reorder", 4);
+  const int64_t big = int64_t{1} << 30;
+  CheckLargeReorder({big, big, big}, big, &pool);
+}
+
 TEST(SparseTensorTest, ValidateIndicesFindsInvalid) {
   int N = 2;
   const int NDIM = 3;
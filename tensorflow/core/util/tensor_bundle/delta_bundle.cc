@@ -0,0 +1,277 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include <cstring>
+#include <memory>
+#include <set>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/util/saved_tensor_slice_util.h"
+
+namespace tensorflow {
+
+const char* const kDeltaRowsSuffix = "/.DELTA/ROWS";
+const char* const kDeltaValuesSuffix = "/.DELTA/VALUES";
+
+namespace {
+
+// Returns whether changes to "val" are saved by rows.
+bool SavedByRows(const Tensor& val) {
+  return DataTypeCanUseMemcpy(val.dtype()) && val.dims() >= 1;
+}
+
+// Returns the number of bytes of a row of "val".
+// REQUIRES: SavedByRows(val)
+size_t RowBytes(const Tensor& val) {
+  const int64_t num_rows = val.dim_size(0);
+  return num_rows == 0 ? 0 : val.TotalBytes() / num_rows;
+}
+
+// Returns the fingerprints of the rows of "val".
+// REQUIRES: SavedByRows(val)
+std::vector<uint64> RowFingerprints(const Tensor& val) {
+  const int64_t num_rows = val.dim_size(0);
+  const size_t row_bytes = RowBytes(val);
+  const char* data = val.tensor_data().data();
+  std::vector<uint64> fingerprints(num_rows);
+  for (int64_t i = 0; i < num_rows; ++i) {
+    fingerprints[i] = Fingerprint64(StringPiece(data + i * row_bytes, row_bytes));
+  }
+  return fingerprints;
+}
+
+// Reads the tensor keyed by "key" from "reader", allocating "val".
+Status LookupAllocated(BundleReader* reader, StringPiece key, Tensor* val) {
+  DataType dtype;
+  TensorShape shape;
+  TF_RETURN_IF_ERROR(reader->LookupDtypeAndShape(key, &dtype, &shape));
+  *val = Tensor(dtype, shape);
+  return reader->Lookup(key, val);
+}
+
+// Returns the index of the latest bundle holding a full copy of the tensor
+// keyed by "key", or -1 if there is none.
+int LatestFullCopy(gtl::ArraySlice<BundleReader*> bundles, StringPiece key) {
+  for (int i = bundles.size() - 1; i >= 0; --i) {
+    if (bundles[i]->Contains(key)) return i;
+  }
+  return -1;
+}
+
+// Copies the changed rows stored in "bundle" for "key", if any, into "val".
+Status ApplyDelta(BundleReader* bundle, StringPiece key, Tensor* val) {
+  const string rows_key = strings::StrCat(key, kDeltaRowsSuffix);
+  if (!bundle->Contains(rows_key)) return OkStatus();
+  Tensor rows, values;
+  TF_RETURN_IF_ERROR(LookupAllocated(bundle, rows_key, &rows));
+  TF_RETURN_IF_ERROR(LookupAllocated(
+      bundle, strings::StrCat(key, kDeltaValuesSuffix), &values));
+
+  if (!SavedByRows(*val)) {
+    return errors::DataLoss("Changed rows stored for tensor ", key, " of dtype ",
+                            DataTypeString(val->dtype()), " and shape ",
+                            val->shape().DebugString());
+  }
+  TensorShape row_shape = val->shape();
+  row_shape.RemoveDim(0);
+  TensorShape expected_values_shape({rows.NumElements()});
+  expected_values_shape.AppendShape(row_shape);
+  if (rows.dtype() != DT_INT64 || rows.dims() != 1 ||
+      values.dtype() != val->dtype() ||
+      values.shape() != expected_values_shape) {
+    return errors::DataLoss("Invalid changed rows of tensor ", key,
+                            ": indices of dtype ", DataTypeString(rows.dtype()),
+                            " and shape ", rows.shape().DebugString(),
+                            ", values of dtype ", DataTypeString(values.dtype()),
+                            " and shape ", values.shape().DebugString());
+  }
+
+  const int64_t num_rows = val->dim_size(0);
+  const size_t row_bytes = RowBytes(*val);
+  char* data = const_cast<char*>(val->tensor_data().data());
+  const char* values_data = values.tensor_data().data();
+  const auto rows_flat = rows.flat<int64_t>();
+  for (int64_t i = 0; i < rows.NumElements(); ++i) {
+    const int64_t row = rows_flat(i);
+    if (row < 0 || row >= num_rows) {
+      return errors::DataLoss("Changed row ", row, " of tensor ", key,
+                              " is out of range [0, ", num_rows, ")");
+    }
+    std::memcpy(data + row * row_bytes, values_data + i * row_bytes,
+                row_bytes);
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+void RowDeltaTracker::Track(StringPiece key, const Tensor& val,
+                            std::vector<uint64> row_fingerprints) {
+  TrackedTensor& tracked = pending_tensors_[string(key)];
+  tracked.dtype = val.dtype();
+  tracked.shape = val.shape();
+  tracked.row_fingerprints = std::move(row_fingerprints);
+}
+
+Status RowDeltaTracker::AddBase(BundleWriter* writer, StringPiece key,
+                                const Tensor& val) {
+  TF_RETURN_IF_ERROR(writer->Add(key, val));
+  Track(key, val,
+        SavedByRows(val) ? RowFingerprints(val) : std::vector<uint64>());
+  return OkStatus();
+}
+
+Status RowDeltaTracker::AddDelta(BundleWriter* writer, StringPiece key,
+                                 const Tensor& val, int64_t* num_rows_written) {
+  const auto it = tensors_.find(key);
+  if (!SavedByRows(val) || it == tensors_.end() ||
+      it->second.dtype != val.dtype() || it->second.shape != val.shape()) {
+    TF_RETURN_IF_ERROR(AddBase(writer, key, val));
+    if (num_rows_written != nullptr) {
+      *num_rows_written = val.dims() > 0 ? val.dim_size(0) : 1;
+    }
+    return OkStatus();
+  }
+
+  std::vector<uint64> fingerprints = RowFingerprints(val);
+  const std::vector<uint64>& saved_fingerprints = it->second.row_fingerprints;
+  std::vector<int64_t> changed_rows;
+  const int64_t num_rows = fingerprints.size();
+  for (int64_t i = 0; i < num_rows; ++i) {
+    if (fingerprints[i] != saved_fingerprints[i]) changed_rows.push_back(i);
+  }
+  if (num_rows_written != nullptr) *num_rows_written = changed_rows.size();
+  if (changed_rows.empty()) return OkStatus();
+
+  const int64_t num_changed = changed_rows.size();
+  Tensor rows(DT_INT64, TensorShape({num_changed}));
+  TensorShape values_shape = val.shape();
+  values_shape.set_dim(0, num_changed);
+  Tensor values(val.dtype(), values_shape);
+  const size_t row_bytes = RowBytes(val);
+  const char* data = val.tensor_data().data();
+  char* values_data = const_cast<char*>(values.tensor_data().data());
+  auto rows_flat = rows.flat<int64_t>();
+  for (int64_t i = 0; i < num_changed; ++i) {
+    rows_flat(i) = changed_rows[i];
+    std::memcpy(values_data + i * row_bytes,
+                data + changed_rows[i] * row_bytes, row_bytes);
+  }
+  TF_RETURN_IF_ERROR(writer->Add(strings::StrCat(key, kDeltaRowsSuffix), rows));
+  TF_RETURN_IF_ERROR(
+      writer->Add(strings::StrCat(key, kDeltaValuesSuffix), values));
+  Track(key, val, std::move(fingerprints));
+  return OkStatus();
+}
+
+Status RowDeltaTracker::Finish(BundleWriter* writer) {
+  absl::flat_hash_map<string, TrackedTensor> pending =
+      std::move(pending_tensors_);
+  pending_tensors_.clear();
+  TF_RETURN_IF_ERROR(writer->Finish());
+  for (auto& [key, tracked] : pending) {
+    tensors_[key] = std::move(tracked);
+  }
+  return OkStatus();
+}
+
+Status LookupWithDeltas(gtl::ArraySlice<BundleReader*> bundles, StringPiece key,
+                        Tensor* val) {
+  const int base = LatestFullCopy(bundles, key);
+  if (base < 0) {
+    return errors::NotFound("Key ", key,
+                            " not found in any checkpoint of the chain");
+  }
+  Tensor result;
+  TF_RETURN_IF_ERROR(LookupAllocated(bundles[base], key, &result));
+  const int num_bundles = bundles.size();
+  for (int i = base + 1; i < num_bundles; ++i) {
+    TF_RETURN_IF_ERROR(ApplyDelta(bundles[i], key, &result));
+  }
+  *val = std::move(result);
+  return OkStatus();
+}
+
+Status CompactBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
+                      StringPiece output_prefix,
+                      const BundleWriter::Options& options) {
+  std::vector<std::unique_ptr<BundleReader>> readers;
+  std::vector<BundleReader*> bundles;
+  for (const tstring& prefix : prefixes) {
+    readers.emplace_back(new BundleReader(env, prefix));
+    TF_RETURN_IF_ERROR(readers.back()->status());
+    bundles.push_back(readers.back().get());
+  }
+
+  // Collects the keys of the tensors, leaving out the keys of slices, which
+  // are written along with their partitioned tensors.
+  std::set<string> keys;
+  for (BundleReader* bundle : bundles) {
+    bundle->Seek(kHeaderEntryKey);
+    for (bundle->Next(); bundle->Valid(); bundle->Next()) {
+      string key(bundle->key());
+      if (absl::EndsWith(key, kDeltaValuesSuffix)) continue;
+      if (absl::EndsWith(key, kDeltaRowsSuffix)) {
+        key.resize(key.size() - strlen(kDeltaRowsSuffix));
+      } else {
+        string name;
+        TensorSlice slice;
+        if (checkpoint::DecodeTensorNameSlice(key, &name, &slice).ok()) {
+          continue;
+        }
+      }
+      keys.insert(std::move(key));
+    }
+  }
+
+  BundleWriter writer(env, output_prefix, options);
+  TF_RETURN_IF_ERROR(writer.status());
+  for (const string& key : keys) {
+    const int base = LatestFullCopy(bundles, key);
+    if (base < 0) {
+      return errors::NotFound("Changed rows of ", key,
+                              " found without a full copy of the tensor");
+    }
+    std::vector<TensorSlice> slices;
+    TF_RETURN_IF_ERROR(bundles[base]->LookupTensorSlices(key, &slices));
+    if (slices.empty()) {
+      Tensor val;
+      TF_RETURN_IF_ERROR(LookupWithDeltas(bundles, key, &val));
+      TF_RETURN_IF_ERROR(writer.Add(key, val));
+      continue;
+    }
+    DataType dtype;
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(bundles[base]->LookupDtypeAndShape(key, &dtype, &shape));
+    for (const TensorSlice& slice : slices) {
+      TensorShape slice_shape;
+      TF_RETURN_IF_ERROR(slice.SliceTensorShape(shape, &slice_shape));
+      Tensor val(dtype, slice_shape);
+      TF_RETURN_IF_ERROR(bundles[base]->LookupSlice(key, slice, &val));
+      TF_RETURN_IF_ERROR(writer.AddSlice(key, shape, slice, val));
+    }
+  }
+  return writer.Finish();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,153 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Incremental checkpoints on top of tensor bundles.
+//
+// A chain of bundles consists of a base bundle followed by delta bundles.  A
+// delta bundle stores, for every tensor that changed since the previous bundle
+// of the chain, either the full tensor under its own key, or, for tensors of
+// which only a few rows along the first dimension changed (typically embedding
+// tables), just those rows:
+//
+//   key + kDeltaRowsSuffix    -> int64 vector of the indices of the rows.
+//   key + kDeltaValuesSuffix  -> the rows, of shape [num_rows, ...].
+//
+// Tensors that did not change are not stored in a delta bundle at all.  Usage:
+//
+//   RowDeltaTracker tracker;
+//   {
+//     BundleWriter writer(env, "/fs/ckpt/base");
+//     tracker.AddBase(&writer, "embedding", embedding);
+//     tracker.Finish(&writer);
+//   }
+//   ...  // Training updates some rows of "embedding".
+//   {
+//     BundleWriter writer(env, "/fs/ckpt/delta-1");
+//     tracker.AddDelta(&writer, "embedding", embedding);
+//     tracker.Finish(&writer);
+//   }
+//   ...
+//   BundleReader base(env, "/fs/ckpt/base"), delta(env, "/fs/ckpt/delta-1");
+//   LookupWithDeltas({&base, &delta}, "embedding", &restored);
+//
+// CompactBundles() merges a chain into a single, ordinary bundle, which can
+// serve as the base of a new chain.
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+
+// Suffixes of the keys of the changed rows of a tensor in a delta bundle.
+extern const char* const kDeltaRowsSuffix;
+extern const char* const kDeltaValuesSuffix;
+
+// Finds the rows of tensors that changed between the bundles of a chain.
+//
+// Rather than relying on every kernel that updates a variable to record the
+// rows it touched, the tracker keeps a 64-bit fingerprint of every row of the
+// tensors it saved, and compares the rows against them on the next save.  This
+// costs one pass over the tensor in memory and 8 bytes per row, and works for
+// any kind of update.  Only tensors of fixed-size dtypes with at least one
+// dimension are saved by rows; others, such as scalars and strings, are saved
+// in full by every delta bundle.
+//
+// The fingerprints of the rows added to a writer only replace the previous
+// ones once Finish() wrote the bundle, so that after a failed save the next
+// delta still holds every row changed since the last bundle of the chain.
+//
+// All threads accessing the same RowDeltaTracker must synchronize.
+class RowDeltaTracker {
+ public:
+  RowDeltaTracker() = default;
+
+  // Adds "val" under "key" to "writer", which writes the base bundle of a
+  // chain, and remembers its rows.
+  Status AddBase(BundleWriter* writer, StringPiece key, const Tensor& val);
+
+  // Adds the rows of "val" that changed since "key" was last added to
+  // "writer", which writes the next delta bundle of the chain.  Adds nothing
+  // if no row changed.  Tensors not added before, or whose dtype or shape
+  // changed, are added in full.
+  //
+  // If "num_rows_written" is not null, it is set to the number of rows
+  // written; a tensor added in full counts all its rows, or 1 for a scalar.
+  Status AddDelta(BundleWriter* writer, StringPiece key, const Tensor& val,
+                  int64_t* num_rows_written = nullptr);
+
+  // Finishes "writer", which must be the writer of the preceding AddBase() and
+  // AddDelta() calls.  If it succeeds, the next AddDelta() compares against
+  // the rows added since the last Finish(); otherwise they are discarded.
+  // Every writer passed to AddBase() or AddDelta() must be finished this way.
+  Status Finish(BundleWriter* writer);
+
+  // Forgets all tensors, so that the next AddDelta() adds them in full.
+  void Reset() {
+    tensors_.clear();
+    pending_tensors_.clear();
+  }
+
+ private:
+  struct TrackedTensor {
+    DataType dtype;
+    TensorShape shape;
+    // Fingerprints of the rows, empty if the tensor is not saved by rows.
+    std::vector<uint64> row_fingerprints;
+  };
+
+  // Stores "val" as the next state of "key", to be committed by Finish().
+  void Track(StringPiece key, const Tensor& val,
+             std::vector<uint64> row_fingerprints);
+
+  // The tensors as of the last bundle written.
+  absl::flat_hash_map<string, TrackedTensor> tensors_;
+  // The tensors added since the last Finish().
+  absl::flat_hash_map<string, TrackedTensor> pending_tensors_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RowDeltaTracker);
+};
+
+// Looks up the tensor keyed by "key" in a chain of bundles: a base bundle
+// followed by delta bundles, in the order they were written.  Reads the latest
+// full copy of the tensor and applies the changed rows stored after it.
+//
+// Discards the original content of "val".  Returns a NotFound error if no
+// bundle of the chain has a full copy of the tensor.
+Status LookupWithDeltas(gtl::ArraySlice<BundleReader*> bundles, StringPiece key,
+                        Tensor* val) TF_MUST_USE_RESULT;
+
+// Writes the tensors of the chain of bundles "prefixes" into a single bundle
+// "output_prefix", in which every tensor is stored in full.  Partitioned tensors
+// keep their slices.
+Status CompactBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
+                      StringPiece output_prefix,
+                      const BundleWriter::Options& options =
+                          BundleWriter::Options()) TF_MUST_USE_RESULT;
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
@@ -0,0 +1,211 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+
+namespace tensorflow {
+namespace {
+
+string Prefix(const string& prefix) {
+  return strings::StrCat(testing::TmpDir(), "/", prefix);
+}
+
+Tensor Table(int64_t num_rows, float offset) {
+  Tensor table(DT_FLOAT, TensorShape({num_rows, 3}));
+  auto flat = table.flat<float>();
+  for (int64_t i = 0; i < flat.size(); ++i) flat(i) = offset + i;
+  return table;
+}
+
+TEST(DeltaBundleTest, WritesOnlyChangedRows) {
+  Env* env = Env::Default();
+  RowDeltaTracker tracker;
+  Tensor table = Table(100, 0.f);
+  Tensor step = test::AsScalar<int64_t>(1);
+  {
+    BundleWriter writer(env, Prefix("base"));
+    TF_ASSERT_OK(tracker.AddBase(&writer, "table", table));
+    TF_ASSERT_OK(tracker.AddBase(&writer, "step", step));
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  table.matrix<float>()(7, 1) = -1.f;
+  table.matrix<float>()(42, 0) = -2.f;
+  step.scalar<int64_t>()() = 2;
+  {
+    BundleWriter writer(env, Prefix("delta1"));
+    int64_t num_rows;
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", table, &num_rows));
+    EXPECT_EQ(num_rows, 2);
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "step", step, &num_rows));
+    EXPECT_EQ(num_rows, 1);
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  table.matrix<float>()(42, 2) = -3.f;
+  {
+    BundleWriter writer(env, Prefix("delta2"));
+    int64_t num_rows;
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", table, &num_rows));
+    EXPECT_EQ(num_rows, 1);
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  BundleReader base(env, Prefix("base"));
+  BundleReader delta1(env, Prefix("delta1"));
+  BundleReader delta2(env, Prefix("delta2"));
+  TF_ASSERT_OK(base.status());
+  TF_ASSERT_OK(delta1.status());
+  TF_ASSERT_OK(delta2.status());
+  EXPECT_FALSE(delta1.Contains("table"));
+  EXPECT_TRUE(delta1.Contains(strings::StrCat("table", kDeltaRowsSuffix)));
+  EXPECT_FALSE(delta2.Contains("step"));
+
+  Tensor restored;
+  TF_ASSERT_OK(LookupWithDeltas({&base, &delta1, &delta2}, "table", &restored));
+  test::ExpectTensorEqual<float>(restored, table);
+  TF_ASSERT_OK(LookupWithDeltas({&base, &delta1, &delta2}, "step", &restored));
+  test::ExpectTensorEqual<int64_t>(restored, step);
+
+  // Restoring a prefix of the chain gives the tensors as of that bundle.
+  TF_ASSERT_OK(LookupWithDeltas({&base}, "table", &restored));
+  test::ExpectTensorEqual<float>(restored, Table(100, 0.f));
+
+  EXPECT_TRUE(errors::IsNotFound(
+      LookupWithDeltas({&base, &delta1}, "missing", &restored)));
+}
+
+TEST(DeltaBundleTest, AddsNewAndReshapedTensorsInFull) {
+  Env* env = Env::Default();
+  RowDeltaTracker tracker;
+  {
+    BundleWriter writer(env, Prefix("reshaped_base"));
+    TF_ASSERT_OK(tracker.AddBase(&writer, "table", Table(4, 0.f)));
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+  {
+    BundleWriter writer(env, Prefix("reshaped_delta"));
+    int64_t num_rows;
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", Table(6, 1.f), &num_rows));
+    EXPECT_EQ(num_rows, 6);
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "new", Table(2, 5.f), &num_rows));
+    EXPECT_EQ(num_rows, 2);
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+  BundleReader base(env, Prefix("reshaped_base"));
+  BundleReader delta(env, Prefix("reshaped_delta"));
+  Tensor restored;
+  TF_ASSERT_OK(LookupWithDeltas({&base, &delta}, "table", &restored));
+  test::ExpectTensorEqual<float>(restored, Table(6, 1.f));
+  TF_ASSERT_OK(LookupWithDeltas({&base, &delta}, "new", &restored));
+  test::ExpectTensorEqual<float>(restored, Table(2, 5.f));
+}
+
+TEST(DeltaBundleTest, FailedDeltaIsWrittenAgain) {
+  Env* env = Env::Default();
+  RowDeltaTracker tracker;
+  Tensor table = Table(10, 0.f);
+  {
+    BundleWriter writer(env, Prefix("retry_base"));
+    TF_ASSERT_OK(tracker.AddBase(&writer, "table", table));
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  table.matrix<float>()(3, 0) = 100.f;
+  {
+    // A directory in place of the data file makes the save fail.
+    const string prefix = Prefix("retry_failed");
+    TF_ASSERT_OK(env->RecursivelyCreateDir(
+        io::JoinPath(DataFilename(prefix, 0, 1), "blocker")));
+    BundleWriter writer(env, prefix);
+    int64_t num_rows;
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", table, &num_rows));
+    EXPECT_EQ(num_rows, 1);
+    EXPECT_FALSE(tracker.Finish(&writer).ok());
+  }
+
+  table.matrix<float>()(5, 0) = 200.f;
+  {
+    BundleWriter writer(env, Prefix("retry_delta"));
+    int64_t num_rows;
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", table, &num_rows));
+    // Holds the row of the failed save as well.
+    EXPECT_EQ(num_rows, 2);
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  BundleReader base(env, Prefix("retry_base"));
+  BundleReader delta(env, Prefix("retry_delta"));
+  Tensor restored;
+  TF_ASSERT_OK(LookupWithDeltas({&base, &delta}, "table", &restored));
+  test::ExpectTensorEqual<float>(restored, table);
+}
+
+TEST(DeltaBundleTest, CompactBundles) {
+  Env* env = Env::Default();
+  RowDeltaTracker tracker;
+  Tensor table = Table(10, 0.f);
+  {
+    BundleWriter writer(env, Prefix("compact_base"));
+    TF_ASSERT_OK(tracker.AddBase(&writer, "table", table));
+    // Partitioned tensors are written in full by AddSlice().
+    TF_ASSERT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Table(2, 1.f)));
+    TF_ASSERT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Table(2, 2.f)));
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+  table.matrix<float>()(3, 0) = 100.f;
+  {
+    BundleWriter writer(env, Prefix("compact_delta"));
+    TF_ASSERT_OK(tracker.AddDelta(&writer, "table", table));
+    TF_ASSERT_OK(tracker.Finish(&writer));
+  }
+
+  TF_ASSERT_OK(CompactBundles(
+      env, {Prefix("compact_base"), Prefix("compact_delta")},
+      Prefix("compacted")));
+
+  BundleReader compacted(env, Prefix("compacted"));
+  TF_ASSERT_OK(compacted.status());
+  Tensor restored(DT_FLOAT, TensorShape({10, 3}));
+  TF_ASSERT_OK(compacted.Lookup("table", &restored));
+  test::ExpectTensorEqual<float>(restored, table);
+  EXPECT_FALSE(compacted.Contains(strings::StrCat("table", kDeltaRowsSuffix)));
+
+  std::vector<TensorSlice> slices;
+  TF_ASSERT_OK(compacted.LookupTensorSlices("part", &slices));
+  EXPECT_EQ(slices.size(), 2);
+  Tensor part(DT_FLOAT, TensorShape({2, 3}));
+  TF_ASSERT_OK(
+      compacted.LookupSlice("part", TensorSlice::ParseOrDie("2,2:-"), &part));
+  test::ExpectTensorEqual<float>(part, Table(2, 2.f));
+}
+
+}  // namespace
+}  // namespace tensorflow
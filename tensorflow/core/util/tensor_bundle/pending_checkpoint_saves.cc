@@ -0,0 +1,190 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/util/tensor_bundle/pending_checkpoint_saves.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+PendingCheckpointSaves::PendingCheckpointSaves(Env* env, int num_threads)
+    : env_(env), num_threads_(num_threads) {}
+
+PendingCheckpointSaves::~PendingCheckpointSaves() {
+  std::unique_ptr<thread::ThreadPool> pool;
+  {
+    mutex_lock l(mu_);
+    pool = std::move(pool_);
+  }
+  // Waits for the scheduled writes.
+  pool.reset();
+}
+
+PendingCheckpointSaves* PendingCheckpointSaves::Global() {
+  static PendingCheckpointSaves* saves = [] {
+    auto* saves = new PendingCheckpointSaves(Env::Default(), kDefaultNumThreads);
+    // Returning from main() would otherwise drop the writes still pending,
+    // leaving partial bundles behind.
+    std::atexit([] {
+      Status status = Global()->WaitAll();
+      if (!status.ok()) {
+        LOG(ERROR) << "Background checkpoint save failed at exit: " << status;
+      }
+    });
+    return saves;
+  }();
+  return saves;
+}
+
+void PendingCheckpointSaves::Schedule(absl::string_view prefix,
+                                      std::function<Status()> write) {
+  auto save = std::make_shared<PendingSave>();
+  save->prefix = std::string(prefix);
+  save->write = std::move(write);
+  thread::ThreadPool* pool;
+  {
+    mutex_lock l(mu_);
+    std::shared_ptr<PendingSave>& latest = saves_[save->prefix];
+    std::shared_ptr<PendingSave> previous = std::move(latest);
+    latest = save;
+    if (previous != nullptr && !previous->done) {
+      // Writing two bundles to the same files at once would interleave them.
+      previous->next = std::move(save);
+      return;
+    }
+    // Started on first use, since most processes only read bundles.
+    if (pool_ == nullptr) {
+      pool_ = std::make_unique<thread::ThreadPool>(env_, "checkpoint_saves",
+                                                   num_threads_);
+    }
+    pool = pool_.get();
+  }
+  pool->Schedule([this, save]() { Run(save); });
+}
+
+void PendingCheckpointSaves::Run(std::shared_ptr<PendingSave> save) {
+  while (save != nullptr) {
+    Status status = save->write();
+    save->write = nullptr;
+    if (!status.ok()) {
+      LOG(ERROR) << "Background save of " << save->prefix
+                 << " failed: " << status;
+    }
+    mutex_lock l(mu_);
+    save->done = true;
+    save->status = std::move(status);
+    if (!save->status.ok()) failures_.push_back(save);
+    cv_.notify_all();
+    save = std::move(save->next);
+  }
+}
+
+Status PendingCheckpointSaves::Wait(absl::string_view prefix) {
+  mutex_lock l(mu_);
+  const auto it = saves_.find(prefix);
+  if (it == saves_.end()) return OkStatus();
+  const std::shared_ptr<PendingSave> save = it->second;
+  while (!save->done) cv_.wait(l);
+  // A save scheduled while waiting stays until it is waited for.
+  const auto latest = saves_.find(prefix);
+  if (latest != saves_.end() && latest->second == save) saves_.erase(latest);
+  return Report(*save);
+}
+
+Status PendingCheckpointSaves::Report(PendingSave& save) {
+  if (save.reported) return OkStatus();
+  save.reported = true;
+  return save.status;
+}
+
+Status PendingCheckpointSaves::WaitAll() {
+  mutex_lock l(mu_);
+  std::vector<std::shared_ptr<PendingSave>> saves;
+  saves.reserve(saves_.size());
+  for (const auto& entry : saves_) saves.push_back(entry.second);
+  Status status;
+  for (const std::shared_ptr<PendingSave>& save : saves) {
+    while (!save->done) cv_.wait(l);
+    const auto latest = saves_.find(save->prefix);
+    if (latest != saves_.end() && latest->second == save) saves_.erase(latest);
+  }
+  // Includes failed writes that were superseded by a later write of the same
+  // prefix.
+  for (const std::shared_ptr<PendingSave>& failure : failures_) {
+    status.Update(Report(*failure));
+  }
+  failures_.clear();
+  return status;
+}
+
+Status PendingCheckpointSaves::TakeUnreportedError() {
+  mutex_lock l(mu_);
+  while (!failures_.empty()) {
+    std::shared_ptr<PendingSave> failure = std::move(failures_.front());
+    failures_.erase(failures_.begin());
+    Status status = Report(*failure);
+    if (!status.ok()) {
+      return Status(status.code(),
+                    absl::StrCat("Background save of ", failure->prefix,
+                                 " failed: ", status.error_message()));
+    }
+  }
+  return OkStatus();
+}
+
+bool PendingCheckpointSaves::IsPending(absl::string_view prefix) {
+  mutex_lock l(mu_);
+  const auto it = saves_.find(prefix);
+  return it != saves_.end() && !it->second->done;
+}
+
+bool AsyncSaveEnabled() {
+  bool async_save;
+  Status s = ReadBoolFromEnvVar("TF_SAVE_TENSORS_ASYNC", false, &async_save);
+  if (!s.ok()) {
+    LOG(ERROR) << "Ignoring invalid TF_SAVE_TENSORS_ASYNC: " << s;
+    return false;
+  }
+  return async_save;
+}
+
+Status WaitForBundleIndex(Env* env, absl::string_view prefix,
+                          int64_t timeout_in_ms) {
+  TF_RETURN_IF_ERROR(PendingCheckpointSaves::Global()->Wait(prefix));
+  const std::string index = MetaFilename(prefix);
+  const uint64 deadline = env->NowMicros() + timeout_in_ms * 1000;
+  int64_t backoff_in_ms = 10;
+  while (true) {
+    Status status = env->FileExists(index);
+    if (!errors::IsNotFound(status)) return status;
+    if (env->NowMicros() >= deadline) {
+      return errors::DeadlineExceeded("Timed out waiting for ", index);
+    }
+    env->SleepForMicroseconds(backoff_in_ms * 1000);
+    backoff_in_ms = std::min<int64_t>(backoff_in_ms * 2, 1000);
+  }
+}
+
+}  // namespace checkpoint
+}  // namespace tensorflow
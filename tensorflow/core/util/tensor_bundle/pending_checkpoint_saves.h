@@ -0,0 +1,140 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_PENDING_CHECKPOINT_SAVES_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_PENDING_CHECKPOINT_SAVES_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+// Tracks checkpoint bundles that are written in the background, keyed by the
+// bundle prefix passed to SaveV2.
+//
+// An asynchronous SaveV2 snapshots its inputs and hands the write of the
+// bundle to Schedule(), so that the step can continue while the bundle is
+// serialized.  The prefix is the handle of the write: Wait() blocks until the
+// bundle of a prefix is complete and returns the status of its write.
+// BundleReader, MergeV2Checkpoints and later saves to the same prefix wait for
+// it, so they never observe a partially written bundle.  A failed write is
+// reported once: by Wait() on its prefix, or else by the next SaveV2 or
+// MergeV2Checkpoints through TakeUnreportedError().
+//
+// Writes are only tracked within a process.  A bundle written by another
+// process is complete once its index file exists, as BundleWriter writes the
+// index last; see WaitForBundleIndex().
+//
+// This class is thread safe.
+class PendingCheckpointSaves {
+ public:
+  // Number of threads writing bundles of the Global() instance.
+  static constexpr int kDefaultNumThreads = 4;
+
+  PendingCheckpointSaves(Env* env, int num_threads);
+  // Waits for all scheduled writes.
+  ~PendingCheckpointSaves();
+
+  PendingCheckpointSaves(const PendingCheckpointSaves&) = delete;
+  PendingCheckpointSaves& operator=(const PendingCheckpointSaves&) = delete;
+
+  // Returns the process-wide instance used by the save and restore kernels.
+  // It is never destroyed; the writes pending when the process exits normally
+  // are waited for by an atexit() handler.
+  static PendingCheckpointSaves* Global();
+
+  // Schedules `write` to produce the bundle of `prefix`.  A write scheduled
+  // while an earlier one for the same prefix is pending runs after it.
+  void Schedule(absl::string_view prefix, std::function<Status()> write);
+
+  // Blocks until the writes scheduled for `prefix` so far are complete.
+  // Returns the status of the latest one, or OK if there is none.  The status
+  // is reported once; a later Wait() returns OK.
+  Status Wait(absl::string_view prefix);
+
+  // Blocks until all writes scheduled so far are complete.  Returns the first
+  // error among them that was not reported yet, and forgets all of them.
+  Status WaitAll();
+
+  // Returns the error of the earliest failed write that was not reported yet,
+  // naming its prefix, and marks it reported.  Returns OK if there is none.
+  // Does not block.
+  Status TakeUnreportedError();
+
+  // Returns whether a write for `prefix` is scheduled or running.
+  bool IsPending(absl::string_view prefix);
+
+ private:
+  struct PendingSave {
+    std::string prefix;
+    std::function<Status()> write;
+    bool done = false;
+    Status status;
+    bool reported = false;
+    // The next write of the same prefix, started once this one is done.
+    std::shared_ptr<PendingSave> next;
+  };
+
+  // Runs the write of `save`, then the writes queued behind it.
+  void Run(std::shared_ptr<PendingSave> save);
+
+  // Returns the status of `save`, unless it was already reported.
+  Status Report(PendingSave& save) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const int num_threads_;
+
+  mutex mu_;
+  condition_variable cv_;
+  // The latest write of every prefix, kept until its status is waited for.
+  absl::flat_hash_map<std::string, std::shared_ptr<PendingSave>> saves_
+      TF_GUARDED_BY(mu_);
+  // Failed writes, in the order they failed, until they are reported.
+  std::vector<std::shared_ptr<PendingSave>> failures_ TF_GUARDED_BY(mu_);
+  // Created by the first Schedule().
+  std::unique_ptr<thread::ThreadPool> pool_ TF_GUARDED_BY(mu_);
+};
+
+// Returns whether SaveV2 writes bundles in the background.  Configurable
+// through TF_SAVE_TENSORS_ASYNC.
+//
+// This is meant for graph-mode savers.  In TF2, tf.train.Checkpoint with
+// CheckpointOptions(experimental_enable_async_checkpoint=True) already copies
+// the variables to the host and saves on a background thread; enabling both
+// only adds a second copy.  Either way, MultiDeviceSaver's final
+// MergeV2Checkpoints waits for the shards, so a TF2 save is complete once it
+// returns.
+bool AsyncSaveEnabled();
+
+// Blocks until the bundle of `prefix` is complete: first for a write pending in
+// this process, then, for bundles written by other processes, until the index
+// file of `prefix` exists, for at most `timeout_in_ms`.
+Status WaitForBundleIndex(Env* env, absl::string_view prefix,
+                          int64_t timeout_in_ms);
+
+}  // namespace checkpoint
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_PENDING_CHECKPOINT_SAVES_H_
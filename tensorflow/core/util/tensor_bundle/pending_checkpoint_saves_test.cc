@@ -0,0 +1,109 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/util/tensor_bundle/pending_checkpoint_saves.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+
+namespace tensorflow {
+namespace checkpoint {
+namespace {
+
+TEST(PendingCheckpointSavesTest, WaitReturnsStatusOfWrite) {
+  PendingCheckpointSaves saves(Env::Default(), /*num_threads=*/2);
+  Notification start;
+  saves.Schedule("ok", [&start]() {
+    start.WaitForNotification();
+    return OkStatus();
+  });
+  saves.Schedule("bad", []() { return errors::Internal("write failed"); });
+  EXPECT_TRUE(saves.IsPending("ok"));
+  start.Notify();
+
+  TF_EXPECT_OK(saves.Wait("ok"));
+  EXPECT_FALSE(saves.IsPending("ok"));
+  EXPECT_EQ(saves.Wait("bad").code(), error::INTERNAL);
+  // The error is only reported once.
+  TF_EXPECT_OK(saves.Wait("bad"));
+  TF_EXPECT_OK(saves.TakeUnreportedError());
+  TF_EXPECT_OK(saves.Wait("unknown"));
+}
+
+TEST(PendingCheckpointSavesTest, UnreportedErrorIsTakenOnce) {
+  PendingCheckpointSaves saves(Env::Default(), /*num_threads=*/2);
+  saves.Schedule("first", []() { return errors::Internal("first failed"); });
+  saves.Schedule("second", []() { return errors::DataLoss("second failed"); });
+  EXPECT_EQ(saves.Wait("first").code(), error::INTERNAL);
+  while (saves.IsPending("second")) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+
+  // "first" was reported by Wait(), so only "second" is left.
+  Status status = saves.TakeUnreportedError();
+  EXPECT_EQ(status.code(), error::DATA_LOSS);
+  EXPECT_TRUE(absl::StrContains(status.error_message(), "second"));
+  TF_EXPECT_OK(saves.TakeUnreportedError());
+  TF_EXPECT_OK(saves.Wait("second"));
+}
+
+TEST(PendingCheckpointSavesTest, WritesOfSamePrefixRunInOrder) {
+  PendingCheckpointSaves saves(Env::Default(), /*num_threads=*/4);
+  mutex mu;
+  std::vector<int> order;
+  Notification start;
+  for (int i = 0; i < 5; ++i) {
+    saves.Schedule("prefix", [&, i]() {
+      if (i == 0) start.WaitForNotification();
+      mutex_lock l(mu);
+      order.push_back(i);
+      return OkStatus();
+    });
+  }
+  start.Notify();
+  TF_EXPECT_OK(saves.Wait("prefix"));
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+}
+
+TEST(PendingCheckpointSavesTest, WaitAllReturnsFirstError) {
+  PendingCheckpointSaves saves(Env::Default(), /*num_threads=*/2);
+  saves.Schedule("a", []() { return OkStatus(); });
+  saves.Schedule("b", []() { return errors::Unavailable("retry"); });
+  EXPECT_EQ(saves.WaitAll().code(), error::UNAVAILABLE);
+  TF_EXPECT_OK(saves.WaitAll());
+  TF_EXPECT_OK(saves.TakeUnreportedError());
+}
+
+TEST(PendingCheckpointSavesTest, WaitForBundleIndex) {
+  Env* env = Env::Default();
+  const std::string prefix = io::JoinPath(testing::TmpDir(), "bundle_index");
+  EXPECT_EQ(WaitForBundleIndex(env, prefix, /*timeout_in_ms=*/0).code(),
+            error::DEADLINE_EXCEEDED);
+  TF_ASSERT_OK(WriteStringToFile(env, MetaFilename(prefix), ""));
+  TF_EXPECT_OK(WaitForBundleIndex(env, prefix, /*timeout_in_ms=*/0));
+}
+
+}  // namespace
+}  // namespace checkpoint
+}  // namespace tensorflow
@@ -18,9 +18,11 @@ limitations under the License.
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -33,8 +35,10 @@ limitations under the License.
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/random.h"
@@ -47,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/byte_swap.h"
+#include "tensorflow/core/util/tensor_bundle/pending_checkpoint_saves.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
 
 #ifdef PLATFORM_WINDOWS
@@ -383,8 +388,16 @@ Status CorruptFileError(const Status& in_status, const string& filename,
                       detail, "): ", in_status.error_message()));
 }
 
+// Bloom filter for the keys of the metadata table, so that lookups of missing
+// keys do not read a data block.  Readers that predate the filter ignore it.
+const table::FilterPolicy* IndexFilterPolicy() {
+  static const table::FilterPolicy* policy = table::NewBloomFilterPolicy(10);
+  return policy;
+}
+
 table::Options TableBuilderOptions() {
   table::Options o;
+  o.filter_policy = IndexFilterPolicy();
   // Compressed tables cannot be read by TensorFlow releases prior to 1.1.
   // To smoothen the transition, compressed writes are disabled for now
   // (version 1.2) with the intention that they will be enabled again at
@@ -409,17 +422,65 @@ Status PadAlignment(FileOutputBuffer* out, int alignment, int64_t* size) {
   return status;
 }
 
+// A tensor buffer over bytes of a memory-mapped data file.  Keeps the mapping
+// alive.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("MappedTensorBuffer");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 }  // namespace
 
+// A data file of a bundle under construction.
+struct BundleWriter::DataFile {
+  int32 shard_id;
+  string path;
+  std::unique_ptr<FileOutputBuffer> out;
+  int64_t size = 0;  // Number of bytes written into out.
+  Status status;
+  // Bytes of the tensors assigned to this file; only used by Add().
+  int64_t assigned_bytes = 0;
+
+  mutex mu;
+  // Tensors waiting to be written by pool_, with the keys of their entries.
+  std::deque<std::pair<string, Tensor>> queue TF_GUARDED_BY(mu);
+  // Whether a closure writing the queue is scheduled on pool_.
+  bool draining TF_GUARDED_BY(mu) = false;
+};
+
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
-    : env_(env), options_(options), prefix_(prefix), out_(nullptr), size_(0) {
+    : env_(env), options_(options), prefix_(prefix) {
+  if (options_.num_data_files < 1) {
+    status_ = errors::InvalidArgument("num_data_files must be >= 1, got ",
+                                      options_.num_data_files);
+    return;
+  }
+  if (options_.checksum_block_size < 0) {
+    status_ = errors::InvalidArgument("checksum_block_size must be >= 0, got ",
+                                      options_.checksum_block_size);
+    return;
+  }
   status_ = env_->HasAtomicMove(prefix_, &use_temp_file_);
   if (!status_.ok()) return;
 
-  data_path_ = DataFilename(prefix_, 0, 1);
   metadata_path_ = MetaFilename(prefix_);
   if (use_temp_file_) {
-    data_path_ = strings::StrCat(data_path_, ".tempstate", random::New64());
     metadata_path_ =
         strings::StrCat(metadata_path_, ".tempstate", random::New64());
   }
@@ -429,50 +490,133 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
     return;
   }
 
-  std::unique_ptr<WritableFile> wrapper;
-  status_ = env_->NewWritableFile(data_path_, &wrapper);
-  if (!status_.ok()) return;
-  out_ = std::unique_ptr<FileOutputBuffer>(
-      new FileOutputBuffer(wrapper.release(), 8 << 20 /* 8MB write buffer */));
+  const int num_data_files = options_.num_data_files;
+  for (int i = 0; i < num_data_files; ++i) {
+    auto file = std::make_unique<DataFile>();
+    file->shard_id = i;
+    file->path = DataFilename(prefix_, i, num_data_files);
+    if (use_temp_file_) {
+      file->path = strings::StrCat(file->path, ".tempstate", random::New64());
+    }
+    std::unique_ptr<WritableFile> wrapper;
+    status_ = env_->NewWritableFile(file->path, &wrapper);
+    if (!status_.ok()) return;
+    file->out = std::unique_ptr<FileOutputBuffer>(new FileOutputBuffer(
+        wrapper.release(), 8 << 20 /* 8MB write buffer */));
+    VLOG(1) << "Writing to file " << file->path;
+    data_files_.push_back(std::move(file));
+  }
+  if (num_data_files > 1) {
+    pool_ = std::make_unique<thread::ThreadPool>(env_, "bundle_writer",
+                                                 num_data_files);
+  }
+}
 
-  VLOG(1) << "Writing to file " << data_path_;
+BundleWriter::~BundleWriter() {
+  // Waits for the pending writes, which reference the data files.
+  pool_.reset();
 }
 
 Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   if (!status_.ok()) return status_;
   CHECK_NE(key, kHeaderEntryKey);
   const string key_string(key);
-  if (entries_.find(key_string) != entries_.end()) {
-    status_ = errors::InvalidArgument("Adding duplicate key: ", key);
-    return status_;
+  DataFile* file = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (entries_.find(key_string) != entries_.end()) {
+      status_ = errors::InvalidArgument("Adding duplicate key: ", key);
+      return status_;
+    }
+
+    // Balances the bytes, not the number of tensors, over the data files.
+    for (const auto& data_file : data_files_) {
+      if (file == nullptr || data_file->assigned_bytes < file->assigned_bytes) {
+        file = data_file.get();
+      }
+    }
+
+    BundleEntryProto* entry = &entries_[key_string];
+    entry->set_dtype(val.dtype());
+    val.shape().AsProto(entry->mutable_shape());
+    entry->set_shard_id(file->shard_id);
   }
+  file->assigned_bytes += val.TotalBytes();
 
-  BundleEntryProto* entry = &entries_[key_string];
-  entry->set_dtype(val.dtype());
-  val.shape().AsProto(entry->mutable_shape());
-  entry->set_shard_id(0);
-  entry->set_offset(size_);
+  if (pool_ != nullptr) {
+    ScheduleWrite(key_string, val, file);
+    return OkStatus();
+  }
+  WriteToDataFile(key_string, val, file);
+  status_ = file->status;
+  return status_;
+}
+
+void BundleWriter::WriteToDataFile(const string& key, const Tensor& val,
+                                   DataFile* file) {
+  if (!file->status.ok()) return;
+  const int64_t offset = file->size;
 
   // Updates the data file.
+  FileOutputBuffer* out = file->out.get();
   size_t data_bytes_written = 0;
   uint32 crc32c = 0;
-  out_->clear_crc32c();
+  std::vector<uint32> block_crc32c;
+  out->clear_crc32c();
   if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
+    file->status = WriteStringTensor(val, out, &data_bytes_written, &crc32c);
   } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
+    file->status = WriteVariantTensor(val, out, &data_bytes_written, &crc32c);
   } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32c();
+    const bool block_checksums = options_.checksum_block_size > 0;
+    if (block_checksums) out->StartBlockChecksums(options_.checksum_block_size);
+    file->status = WriteTensor(val, out, &data_bytes_written);
+    crc32c = out->crc32c();
+    if (block_checksums) block_crc32c = out->FinishBlockChecksums();
+  }
+  if (!file->status.ok()) return;
+
+  file->size += data_bytes_written;
+  file->status = PadAlignment(out, options_.data_alignment, &file->size);
+
+  mutex_lock l(mu_);
+  BundleEntryProto* entry = &entries_[key];
+  entry->set_offset(offset);
+  entry->set_size(data_bytes_written);
+  entry->set_crc32c(crc32c::Mask(crc32c));
+  if (!block_crc32c.empty()) {
+    entry->set_checksum_block_size(options_.checksum_block_size);
+    for (const uint32 block_crc : block_crc32c) {
+      entry->add_block_crc32c(crc32c::Mask(block_crc));
+    }
   }
+}
+
+void BundleWriter::ScheduleWrite(const string& key, const Tensor& val,
+                                 DataFile* file) {
+  mutex_lock l(file->mu);
+  file->queue.emplace_back(key, val);
+  if (file->draining) return;
+  file->draining = true;
+  pool_->Schedule([this, file]() { DrainDataFile(file); });
+}
 
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+void BundleWriter::DrainDataFile(DataFile* file) {
+  // At most one closure drains a data file at a time, so the writes to it stay
+  // sequential while the different data files are written concurrently.
+  while (true) {
+    std::pair<string, Tensor> pending;
+    {
+      mutex_lock l(file->mu);
+      if (file->queue.empty()) {
+        file->draining = false;
+        return;
+      }
+      pending = std::move(file->queue.front());
+      file->queue.pop_front();
+    }
+    WriteToDataFile(pending.first, pending.second, file);
   }
-  return status_;
 }
 
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
@@ -493,20 +637,23 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
   // the "slices" field of multiple metadata entries corresponding to the same
   // full tensor.
   const string full_tensor_key_string(full_tensor_key);
-  BundleEntryProto* full_entry = &entries_[full_tensor_key_string];
-  if (full_entry->dtype() != DT_INVALID) {
-    CHECK_EQ(full_entry->dtype(), slice_tensor.dtype());
-  }
-  if (full_entry->has_shape()) {
-    CHECK(TensorShape(full_entry->shape()) == full_tensor_shape);
-  }
+  {
+    mutex_lock l(mu_);
+    BundleEntryProto* full_entry = &entries_[full_tensor_key_string];
+    if (full_entry->dtype() != DT_INVALID) {
+      CHECK_EQ(full_entry->dtype(), slice_tensor.dtype());
+    }
+    if (full_entry->has_shape()) {
+      CHECK(TensorShape(full_entry->shape()) == full_tensor_shape);
+    }
 
-  // Populates dtype, shape, and slices.  Intentionally leaving out shard_id and
-  // offset, which do not make sense for this full tensor entry.
-  full_entry->set_dtype(slice_tensor.dtype());
-  full_tensor_shape.AsProto(full_entry->mutable_shape());
-  TensorSliceProto* slice_proto = full_entry->add_slices();
-  slice_spec.AsProto(slice_proto);
+    // Populates dtype, shape, and slices.  Intentionally leaving out shard_id
+    // and offset, which do not make sense for this full tensor entry.
+    full_entry->set_dtype(slice_tensor.dtype());
+    full_tensor_shape.AsProto(full_entry->mutable_shape());
+    TensorSliceProto* slice_proto = full_entry->add_slices();
+    slice_spec.AsProto(slice_proto);
+  }
 
   // The slice itself is handled by a regular Add(), which includes adding its
   // own metadata entry, and writing out the slice's values.
@@ -519,18 +666,28 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
-  if (out_) {
-    status_.Update(out_->Close());
-    out_ = nullptr;
-    if (status_.ok()) {
-      if (use_temp_file_) {
-        status_ =
-            Env::Default()->RenameFile(data_path_, DataFilename(prefix_, 0, 1));
-      }
-    } else {
-      Env::Default()->DeleteFile(data_path_).IgnoreError();
+  // Waits for the pending writes.
+  pool_.reset();
+  for (const auto& file : data_files_) {
+    status_.Update(file->status);
+  }
+  for (const auto& file : data_files_) {
+    status_.Update(file->out->Close());
+  }
+  const int num_data_files = data_files_.size();
+  if (status_.ok() && use_temp_file_) {
+    for (const auto& file : data_files_) {
+      status_ = Env::Default()->RenameFile(
+          file->path, DataFilename(prefix_, file->shard_id, num_data_files));
+      if (!status_.ok()) break;
+    }
+  }
+  if (!status_.ok()) {
+    for (const auto& file : data_files_) {
+      Env::Default()->DeleteFile(file->path).IgnoreError();
     }
   }
+  data_files_.clear();
   if (!status_.ok()) return status_;
   // Build key -> BundleEntryProto table.
   std::unique_ptr<WritableFile> file;
@@ -541,10 +698,11 @@ Status BundleWriter::Finish() {
     // platforms (e.g. Android).  The metadata file is small, so this is fine.
     table::Options options;
     options.compression = table::kNoCompression;
+    options.filter_policy = IndexFilterPolicy();
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_data_files);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -554,6 +712,7 @@ Status BundleWriter::Finish() {
     builder.Add(kHeaderEntryKey, header.SerializeAsString());
 
     // All others.
+    mutex_lock l(mu_);
     for (const auto& p : entries_) {
       builder.Add(p.first, p.second.SerializeAsString());
     }
@@ -751,6 +910,10 @@ BundleReader::BundleReader(Env* env, StringPiece prefix)
       index_cache_(nullptr),
       iter_(nullptr),
       need_to_swap_bytes_(false) {
+  // The bundle may still be written in the background by SaveV2.
+  status_ = checkpoint::PendingCheckpointSaves::Global()->Wait(prefix_);
+  if (!status_.ok()) return;
+
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -763,6 +926,7 @@ BundleReader::BundleReader(Env* env, StringPiece prefix)
   metadata_ = wrapper.release();
 
   table::Options o;
+  o.filter_policy = IndexFilterPolicy();
   int64_t cache_size;
   Status s =
       ReadInt64FromEnvVar("TF_TABLE_INDEX_CACHE_SIZE_IN_MB", 0, &cache_size);
@@ -825,6 +989,9 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
                                          BundleEntryProto* entry) {
   entry->Clear();
   TF_CHECK_OK(status_);
+  if (!table_->KeyMayMatch(key)) {
+    return errors::NotFound("Key ", key, " not found in checkpoint");
+  }
   Seek(key);
   if (!iter_->Valid() || iter_->key() != key) {
     return errors::NotFound("Key ", key, " not found in checkpoint");
@@ -952,6 +1119,140 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMapped(StringPiece key,
+                                  std::unique_ptr<MappedTensor>* tensor) {
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  if (!entry.slices().empty()) {
+    return errors::Unimplemented("Cannot map partitioned tensor ", key,
+                                 "; map its slices instead");
+  }
+  if (!DataTypeCanUseMemcpy(entry.dtype())) {
+    return errors::Unimplemented("Cannot map tensor ", key, " of dtype ",
+                                 DataTypeString(entry.dtype()));
+  }
+  if (need_to_swap_bytes_) {
+    return errors::Unimplemented(
+        "Cannot map tensor ", key, ": TensorBundle at ", prefix_,
+        " is of a different endianness than this machine's hardware");
+  }
+  const TensorShape shape(entry.shape());
+  const int64_t expected_size =
+      shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key,
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+  if (expected_size == 0) {
+    tensor->reset(new MappedTensor(string(key), Tensor(entry.dtype(), shape),
+                                   entry));
+    return OkStatus();
+  }
+
+  std::shared_ptr<ReadOnlyMemoryRegion>& region =
+      mapped_data_[entry.shard_id()];
+  if (region == nullptr) {
+    std::unique_ptr<ReadOnlyMemoryRegion> new_region;
+    Status status = env_->NewReadOnlyMemoryRegionFromFile(
+        DataFilename(prefix_, entry.shard_id(), num_shards_), &new_region);
+    if (!status.ok()) {
+      mapped_data_.erase(entry.shard_id());
+      return status;
+    }
+    region = std::move(new_region);
+  }
+  if (entry.offset() < 0 ||
+      entry.offset() + entry.size() > static_cast<int64_t>(region->length())) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), ": tensor ", key, " at [",
+                            entry.offset(), ", ",
+                            entry.offset() + entry.size(),
+                            ") lies outside of the data file of ",
+                            region->length(), " bytes");
+  }
+
+  auto* buffer = new MappedTensorBuffer(
+      region, static_cast<const char*>(region->data()) + entry.offset(),
+      entry.size());
+  Tensor mapped(entry.dtype(), shape, buffer);
+  buffer->Unref();
+  if (!mapped.IsAligned()) {
+    return errors::FailedPrecondition(
+        "Cannot map tensor ", key, ": its offset ", entry.offset(),
+        " in the data file is not aligned to ", EIGEN_MAX_ALIGN_BYTES,
+        " bytes; write the bundle with a larger data_alignment");
+  }
+  tensor->reset(new MappedTensor(string(key), mapped, entry));
+  return OkStatus();
+}
+
+MappedTensor::MappedTensor(const string& key, const Tensor& tensor,
+                           const BundleEntryProto& entry)
+    : key_(key), tensor_(tensor) {
+  if (entry.checksum_block_size() > 0 && entry.block_crc32c_size() > 0) {
+    block_size_ = entry.checksum_block_size();
+    for (const uint32 masked_crc : entry.block_crc32c()) {
+      block_crc32c_.push_back(crc32c::Unmask(masked_crc));
+    }
+  } else {
+    block_size_ = std::max<int64_t>(entry.size(), 1);
+    block_crc32c_.push_back(crc32c::Unmask(entry.crc32c()));
+  }
+  verified_.resize(block_crc32c_.size(), false);
+}
+
+Status MappedTensor::VerifyBytes(int64_t begin, int64_t end) {
+  const int64_t size = tensor_.TotalBytes();
+  if (begin < 0 || end < begin || end > size) {
+    return errors::InvalidArgument("Invalid byte range [", begin, ", ", end,
+                                   ") of tensor ", key_, " of ", size,
+                                   " bytes");
+  }
+  if (begin == end) return OkStatus();
+  mutex_lock l(mu_);
+  const int64_t num_blocks = static_cast<int64_t>(verified_.size());
+  for (int64_t block = begin / block_size_; block <= (end - 1) / block_size_;
+       ++block) {
+    if (block < num_blocks && verified_[block]) continue;
+    TF_RETURN_IF_ERROR(VerifyBlock(block));
+    verified_[block] = true;
+  }
+  return OkStatus();
+}
+
+Status MappedTensor::VerifyRows(int64_t begin, int64_t end) {
+  CHECK_GE(tensor_.dims(), 1);
+  const int64_t num_rows = tensor_.dim_size(0);
+  if (begin < 0 || end < begin || end > num_rows) {
+    return errors::InvalidArgument("Invalid row range [", begin, ", ", end,
+                                   ") of tensor ", key_, " of ", num_rows,
+                                   " rows");
+  }
+  if (num_rows == 0) return OkStatus();
+  const int64_t row_bytes = tensor_.TotalBytes() / num_rows;
+  return VerifyBytes(begin * row_bytes, end * row_bytes);
+}
+
+Status MappedTensor::VerifyBlock(int64_t block) {
+  if (block >= static_cast<int64_t>(block_crc32c_.size())) {
+    return errors::DataLoss("Missing checksum of block ", block, " of tensor ",
+                            key_);
+  }
+  const int64_t begin = block * block_size_;
+  const int64_t end =
+      std::min<int64_t>(begin + block_size_, tensor_.TotalBytes());
+  const uint32 actual_crc32c = crc32c::Value(
+      tensor_.tensor_data().data() + begin, static_cast<size_t>(end - begin));
+  if (actual_crc32c != block_crc32c_[block]) {
+    return errors::DataLoss("Checksum does not match for bytes [", begin, ", ",
+                            end, ") of mapped tensor ", key_, ": stored ",
+                            block_crc32c_[block], " vs. calculated ",
+                            actual_crc32c);
+  }
+  return OkStatus();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1106,6 +1407,7 @@ Status BundleReader::GetSliceValue(StringPiece full_tensor_key,
 }
 
 bool BundleReader::Contains(StringPiece key) {
+  if (!table_->KeyMayMatch(key)) return false;
   Seek(key);
   return Valid() && (this->key() == key);
 }
@@ -1166,12 +1468,12 @@ Status FileOutputBuffer::Append(StringPiece data) {
   if (data.size() + position_ <= buffer_size_) {
     // Can fit into the current buffer.
     memcpy(buffer_ptr_ + position_, data.data(), data.size());
-    crc32c_ = crc32c::Extend(crc32c_, buffer_ptr_ + position_, data.size());
+    UpdateChecksums(buffer_ptr_ + position_, data.size());
   } else if (data.size() <= buffer_size_) {
     // Cannot fit, but can fit after flushing.
     TF_RETURN_IF_ERROR(FlushBuffer(false));
     memcpy(buffer_ptr_, data.data(), data.size());
-    crc32c_ = crc32c::Extend(crc32c_, buffer_ptr_, data.size());
+    UpdateChecksums(buffer_ptr_, data.size());
   } else {
     // Cannot fit even after flushing.  So we break down "data" by chunk, and
     // flush/checksum each chunk.
@@ -1179,7 +1481,7 @@ Status FileOutputBuffer::Append(StringPiece data) {
     for (size_t i = 0; i < data.size(); i += buffer_size_) {
       const size_t nbytes = std::min(data.size() - i, buffer_size_);
       memcpy(buffer_ptr_, data.data() + i, nbytes);
-      crc32c_ = crc32c::Extend(crc32c_, buffer_ptr_, nbytes);
+      UpdateChecksums(buffer_ptr_, nbytes);
       position_ = nbytes;
       TF_RETURN_IF_ERROR(FlushBuffer(false));
     }
@@ -1189,6 +1491,38 @@ Status FileOutputBuffer::Append(StringPiece data) {
   return OkStatus();
 }
 
+void FileOutputBuffer::StartBlockChecksums(size_t block_size) {
+  DCHECK_GT(block_size, 0);
+  block_size_ = block_size;
+  block_crc32c_.clear();
+  current_block_crc32c_ = 0;
+  current_block_size_ = 0;
+}
+
+std::vector<uint32> FileOutputBuffer::FinishBlockChecksums() {
+  if (current_block_size_ > 0) block_crc32c_.push_back(current_block_crc32c_);
+  block_size_ = 0;
+  return std::move(block_crc32c_);
+}
+
+void FileOutputBuffer::UpdateChecksums(const char* data, size_t size) {
+  crc32c_ = crc32c::Extend(crc32c_, data, size);
+  if (block_size_ == 0) return;
+  while (size > 0) {
+    const size_t nbytes = std::min(size, block_size_ - current_block_size_);
+    current_block_crc32c_ =
+        crc32c::Extend(current_block_crc32c_, data, nbytes);
+    current_block_size_ += nbytes;
+    data += nbytes;
+    size -= nbytes;
+    if (current_block_size_ == block_size_) {
+      block_crc32c_.push_back(current_block_crc32c_);
+      current_block_crc32c_ = 0;
+      current_block_size_ = 0;
+    }
+  }
+}
+
 Status FileOutputBuffer::Close() {
   TF_RETURN_IF_ERROR(FlushBuffer(true));
   return file_->Close();
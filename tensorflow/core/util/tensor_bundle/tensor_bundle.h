@@ -39,7 +39,7 @@ limitations under the License.
 //   reader.Lookup("name", &tensor);
 //
 // A tensor bundle can be built using BundleWriter.  Each BundleWriter builds a
-// single data file bundle.  Multiple bundles can then be merged by
+// bundle with a single data file unless Options::num_data_files is set.  Multiple bundles can then be merged by
 // MergeBundles() without reading and writing large chunk of data: it reads the
 // metadata files and outputs a single merged metadata.  Typical usage:
 //
@@ -62,8 +62,10 @@ limitations under the License.
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
@@ -80,6 +82,8 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
@@ -89,6 +93,10 @@ namespace tensorflow {
 
 class FileOutputBuffer;
 
+namespace thread {
+class ThreadPool;
+}  // namespace thread
+
 // Versioning of the tensor bundle format.
 // Follows the same rules as 3p/tf/core/public/version.h.
 //
@@ -116,9 +124,23 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data files the tensors are spread over.  Must be >= 1.
+    //
+    // With more than one data file, each tensor is assigned to the data file
+    // with the fewest bytes assigned so far, and the data files are written
+    // and checksummed concurrently from a pool of "num_data_files" threads.
+    // Add() then only references the tensor's buffer, which must not be
+    // modified until Finish() returns, and errors writing the data are
+    // reported by Finish().
+    int num_data_files{1};
+    // If positive, each tensor of a fixed-size dtype is also checksummed in
+    // blocks of this many bytes, so that MappedTensor can check the parts of
+    // it that are used without reading all of it.
+    int64_t checksum_block_size{0};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
@@ -150,16 +172,31 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  struct DataFile;
+
+  // Appends "val" to "file" and records its offset, size and checksum in the
+  // entry of "key".  Calls for the same data file must not overlap.
+  void WriteToDataFile(const string& key, const Tensor& val, DataFile* file);
+
+  // Queues "val" to be written to "file" from pool_.
+  void ScheduleWrite(const string& key, const Tensor& val, DataFile* file);
+
+  // Writes the queued tensors of "file" until its queue is empty.
+  void DrainDataFile(DataFile* file);
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
   string metadata_path_;
-  string data_path_;
   bool use_temp_file_;
-  std::unique_ptr<FileOutputBuffer> out_;
-  int64_t size_;  // Number of bytes written into out_.
-  std::map<string, BundleEntryProto> entries_;
+  std::vector<std::unique_ptr<DataFile>> data_files_;
+  // Guards entries_ against the writes of pool_.
+  mutex mu_;
+  std::map<string, BundleEntryProto> entries_ TF_GUARDED_BY(mu_);
   Status status_;
+  // Only set with more than one data file.  Declared last, so that pending
+  // writes finish before the data files are destroyed.
+  std::unique_ptr<thread::ThreadPool> pool_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
@@ -180,6 +217,61 @@ class BundleWriter {
 Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
                     StringPiece merged_prefix);
 
+// A tensor of a bundle whose buffer is a read-only memory mapping of its bytes
+// in the data file, as returned by BundleReader::LookupMapped().  Pages of the
+// tensor are read from the file when they are first accessed and may be
+// evicted again under memory pressure, so tensors larger than the available
+// memory, e.g. embedding tables, can be served through the page cache.
+//
+// The bytes are not checked when mapping them; callers check the parts of the
+// tensor they use with the Verify*() methods.
+//
+// This class is thread safe.
+class MappedTensor {
+ public:
+  // The mapped tensor.  Its buffer keeps the mapping alive, so it remains valid
+  // after this object and its reader are destroyed.
+  const Tensor& tensor() const { return tensor_; }
+
+  // Checks bytes [begin, end) of tensor() against the stored checksums, which
+  // reads them if they are not resident.  Each checksum block is checked once,
+  // so repeated calls are cheap.  Without block checksums in the bundle (see
+  // BundleWriter::Options::checksum_block_size), the whole tensor is checked.
+  Status VerifyBytes(int64_t begin, int64_t end) TF_MUST_USE_RESULT;
+
+  // Checks rows [begin, end) along the first dimension of tensor().
+  // REQUIRES: tensor().dims() >= 1
+  Status VerifyRows(int64_t begin, int64_t end) TF_MUST_USE_RESULT;
+
+  // Checks all bytes of tensor().
+  Status Verify() TF_MUST_USE_RESULT {
+    return VerifyBytes(0, tensor_.TotalBytes());
+  }
+
+ private:
+  friend class BundleReader;
+
+  MappedTensor(const string& key, const Tensor& tensor,
+               const BundleEntryProto& entry);
+
+  // Checks block "block" of the tensor, or the whole tensor without block
+  // checksums.
+  Status VerifyBlock(int64_t block) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const string key_;
+  const Tensor tensor_;
+  // Byte size of the checksum blocks, the whole tensor without block
+  // checksums.
+  int64_t block_size_;
+  // The unmasked checksum of each block.
+  std::vector<uint32> block_crc32c_;
+
+  mutex mu_;
+  std::vector<bool> verified_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedTensor);
+};
+
 // On construction, silently attempts to read the metadata associated with
 // "prefix".  If caller intends to call any function afterwards, "status()"
 // must be checked.
@@ -260,6 +352,18 @@ class BundleReader {
   Status LookupSlice(StringPiece full_tensor_key, const TensorSlice& slice_spec,
                      Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensor keyed by "key" without reading it, by mapping its
+  // bytes in the data file into memory; see MappedTensor.
+  //
+  // Only supports non-partitioned tensors of fixed-size dtypes, in bundles of
+  // this machine's endianness, on file systems that support memory mapping.
+  // The tensor must be aligned for Eigen, so the bundle must be written with a
+  // BundleWriter::Options::data_alignment that is a multiple of
+  // EIGEN_MAX_ALIGN_BYTES.
+  // REQUIRES: status().ok()
+  Status LookupMapped(StringPiece key, std::unique_ptr<MappedTensor>* tensor)
+      TF_MUST_USE_RESULT;
+
   // Seeks to the first position in the bundle whose key is no less than "key".
   // REQUIRES: status().ok()
   void Seek(StringPiece key) { return iter_->Seek(key); }
@@ -309,6 +413,9 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Memory mappings of the data files, shared with the mapped tensors.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -343,6 +450,13 @@ class FileOutputBuffer {
   // Clears the running crc32c checksum.
   void clear_crc32c() { crc32c_ = 0; }
 
+  // Starts checksumming the appended bytes in blocks of "block_size" bytes as
+  // well.
+  void StartBlockChecksums(size_t block_size);
+  // Stops the block checksums and returns the checksums of the blocks
+  // appended since StartBlockChecksums(), the last of which may be partial.
+  std::vector<uint32> FinishBlockChecksums();
+
   // Appends the buffered data, then closes the underlying file.
   Status Close();
 
@@ -350,6 +464,9 @@ class FileOutputBuffer {
   // Appends the buffered data to the underlying file. Does NOT flush the file.
   Status FlushBuffer(bool closing);
 
+  // Extends the running and block checksums with "data".
+  void UpdateChecksums(const char* data, size_t size);
+
   WritableFile* file_;  // Owned.
 
   // buffer_ptr_[0, position_) holds the buffered data not yet appended to the
@@ -360,6 +477,13 @@ class FileOutputBuffer {
 
   // Checksum of all appended bytes since construction or last clear_crc32c().
   uint32 crc32c_ = 0;
+
+  // Block checksums, if block_size_ is positive: the checksums of the full
+  // blocks, and the checksum and size of the current block.
+  size_t block_size_ = 0;
+  std::vector<uint32> block_crc32c_;
+  uint32 current_block_crc32c_ = 0;
+  size_t current_block_size_ = 0;
 };
 
 template <class T>
@@ -889,6 +889,68 @@ TEST(TensorBundleTest, DirectoryStructure) {
                           "merged.data-00001-of-00002"});
 }
 
+TEST(TensorBundleTest, MultipleDataFiles) {
+  Env* env = Env::Default();
+  const string kPrefix = Prefix("multi_file");
+  {
+    BundleWriter::Options opts;
+    opts.num_data_files = 3;
+    opts.data_alignment = 8;
+    BundleWriter writer(env, kPrefix, opts);
+    TF_ASSERT_OK(writer.status());
+    TF_EXPECT_OK(writer.Add("big", Constant<float>(1.f, TensorShape({1024}))));
+    for (int i = 0; i < 6; ++i) {
+      TF_EXPECT_OK(writer.Add(strings::StrCat("small", i),
+                              Constant_2x3<int32>(static_cast<int32>(i))));
+    }
+    TF_EXPECT_OK(writer.Add("strs", test::AsTensor<tstring>({"a", "bc"})));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("0,2:-"),
+                                 Constant_2x3<float>(2.f)));
+    TF_EXPECT_OK(writer.AddSlice("part", TensorShape({4, 3}),
+                                 TensorSlice::ParseOrDie("2,2:-"),
+                                 Constant_2x3<float>(3.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string dir(io::Dirname(kPrefix));
+  for (const char* data_file :
+       {"multi_file.data-00000-of-00003", "multi_file.data-00001-of-00003",
+        "multi_file.data-00002-of-00003"}) {
+    TF_EXPECT_OK(env->FileExists(io::JoinPath(dir, data_file)));
+  }
+
+  BundleReader reader(env, kPrefix);
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "big", Constant<float>(1.f, TensorShape({1024})));
+  for (int i = 0; i < 6; ++i) {
+    Expect<int32>(&reader, strings::StrCat("small", i),
+                  Constant_2x3<int32>(static_cast<int32>(i)));
+  }
+  Expect<tstring>(&reader, "strs", test::AsTensor<tstring>({"a", "bc"}));
+  Tensor part(DT_FLOAT, TensorShape({2, 3}));
+  TF_ASSERT_OK(
+      reader.LookupSlice("part", TensorSlice::ParseOrDie("2,2:-"), &part));
+  test::ExpectTensorEqual<float>(part, Constant_2x3<float>(3.f));
+
+  // The large tensor fills one data file, the small ones share the others.
+  int num_large_files = 0;
+  for (int i = 0; i < 3; ++i) {
+    uint64 file_size;
+    TF_ASSERT_OK(env->GetFileSize(DataFilename(kPrefix, i, 3), &file_size));
+    if (file_size >= 4096) ++num_large_files;
+  }
+  EXPECT_EQ(num_large_files, 1);
+
+  // Bundles with several data files can be merged like any other.
+  const string kMerged = Prefix("multi_file_merged");
+  TF_ASSERT_OK(MergeBundles(env, {kPrefix}, kMerged));
+  BundleReader merged_reader(env, kMerged);
+  TF_ASSERT_OK(merged_reader.status());
+  Expect<float>(&merged_reader, "big",
+                Constant<float>(1.f, TensorShape({1024})));
+  Expect<int32>(&merged_reader, "small5", Constant_2x3<int32>(5));
+}
+
 TEST(TensorBundleTest, SortForSequentialAccess) {
   Env* env = Env::Default();
   const std::vector<string> kBundlePrefixes = {Prefix("worker0"),
@@ -939,6 +1001,12 @@ TEST(TensorBundleTest, Error) {
     EXPECT_TRUE(writer.Finish().ok());
     EXPECT_FALSE(writer.Finish().ok());
   }
+  {  // No data files.
+    BundleWriter::Options opts;
+    opts.num_data_files = 0;
+    BundleWriter writer(Env::Default(), Prefix("no_data_files"), opts);
+    EXPECT_EQ(writer.status().code(), error::INVALID_ARGUMENT);
+  }
   {  // Not found.
     BundleReader reader(Env::Default(), Prefix("nonexist"));
     EXPECT_EQ(reader.status().code(), error::NOT_FOUND);
@@ -1013,6 +1081,75 @@ TEST(TensorBundleTest, Checksum) {
   }
 }
 
+TEST(TensorBundleTest, MappedTensor) {
+  Env* env = Env::Default();
+  Tensor table(DT_FLOAT, TensorShape({100, 4}));
+  for (int i = 0; i < table.NumElements(); ++i) table.flat<float>()(i) = i;
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    opts.checksum_block_size = 160;  // 10 rows.
+    BundleWriter writer(env, Prefix("mapped"), opts);
+    TF_EXPECT_OK(writer.Add("small", Constant_2x3<int32>(7)));
+    TF_EXPECT_OK(writer.Add("table", table));
+    TF_EXPECT_OK(writer.Add("strs", test::AsTensor<tstring>({"a"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleReader reader(env, Prefix("mapped"));
+    TF_ASSERT_OK(reader.status());
+    std::unique_ptr<MappedTensor> mapped;
+    TF_ASSERT_OK(reader.LookupMapped("table", &mapped));
+    test::ExpectTensorEqual<float>(mapped->tensor(), table);
+    TF_EXPECT_OK(mapped->VerifyRows(15, 37));
+    TF_EXPECT_OK(mapped->Verify());
+    EXPECT_TRUE(errors::IsInvalidArgument(mapped->VerifyRows(90, 101)));
+
+    std::unique_ptr<MappedTensor> small;
+    TF_ASSERT_OK(reader.LookupMapped("small", &small));
+    test::ExpectTensorEqual<int32>(small->tensor(), Constant_2x3<int32>(7));
+    TF_EXPECT_OK(small->Verify());
+
+    std::unique_ptr<MappedTensor> strs;
+    EXPECT_TRUE(errors::IsUnimplemented(reader.LookupMapped("strs", &strs)));
+    EXPECT_TRUE(errors::IsNotFound(reader.LookupMapped("missing", &strs)));
+  }
+
+  // Corrupts row 42 of the table, which follows "small" padded to 64 bytes.
+  const int kTableOffset = 64;
+  const string data_file = DataFilename(Prefix("mapped"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, data_file, &data));
+  data[kTableOffset + 42 * 16] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(env, data_file, data));
+
+  BundleReader reader(env, Prefix("mapped"));
+  TF_ASSERT_OK(reader.status());
+  std::unique_ptr<MappedTensor> mapped;
+  TF_ASSERT_OK(reader.LookupMapped("table", &mapped));
+  TF_EXPECT_OK(mapped->VerifyRows(0, 40));
+  TF_EXPECT_OK(mapped->VerifyRows(50, 100));
+  EXPECT_TRUE(errors::IsDataLoss(mapped->VerifyRows(41, 43)));
+  EXPECT_TRUE(errors::IsDataLoss(mapped->Verify()));
+}
+
+TEST(TensorBundleTest, MappedTensorWithoutBlockChecksums) {
+  Env* env = Env::Default();
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(env, Prefix("mapped_whole"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3<float>(2.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(env, Prefix("mapped_whole"));
+  TF_ASSERT_OK(reader.status());
+  std::unique_ptr<MappedTensor> mapped;
+  TF_ASSERT_OK(reader.LookupMapped("foo", &mapped));
+  TF_EXPECT_OK(mapped->VerifyRows(1, 2));
+  test::ExpectTensorEqual<float>(mapped->tensor(), Constant_2x3<float>(2.f));
+}
+
 TEST(TensorBundleTest, TruncatedTensorContents) {
   Env* env = Env::Default();
   BundleWriter writer(env, Prefix("end"));
@@ -97,5 +97,61 @@ int ReduceInBfloat16MaxGroupSize() {
   return 8;
 }
 
+bool EnableCollectiveScheduling() {
+  char* dtensor_enable_collective_scheduling_str =
+      std::getenv("DTENSOR_ENABLE_COLLECTIVE_SCHEDULING");
+  if (dtensor_enable_collective_scheduling_str == nullptr) return false;
+  return true;
+}
+
+int AllGatherPrefetchBudgetMiB() {
+  char* dtensor_all_gather_prefetch_budget_mib_str =
+      std::getenv("DTENSOR_ALL_GATHER_PREFETCH_BUDGET_MIB");
+  if (dtensor_all_gather_prefetch_budget_mib_str == nullptr) return 1024;
+  int dtensor_all_gather_prefetch_budget_mib;
+  if (absl::SimpleAtoi(dtensor_all_gather_prefetch_budget_mib_str,
+                       &dtensor_all_gather_prefetch_budget_mib) &&
+      dtensor_all_gather_prefetch_budget_mib >= 0)
+    return dtensor_all_gather_prefetch_budget_mib;
+  LOG(WARNING) << "Invalid DTENSOR_ALL_GATHER_PREFETCH_BUDGET_MIB, using "
+                  "the default value 1024.";
+  return 1024;
+}
+
+bool EnableLayoutPropagationCostModel() {
+  char* dtensor_layout_propagation_cost_model_str =
+      std::getenv("DTENSOR_LAYOUT_PROPAGATION_COST_MODEL");
+  if (dtensor_layout_propagation_cost_model_str == nullptr) return false;
+  return true;
+}
+
+int LayoutCostModelBandwidthGBps() {
+  char* dtensor_layout_cost_model_bandwidth_gbps_str =
+      std::getenv("DTENSOR_LAYOUT_COST_MODEL_BANDWIDTH_GBPS");
+  if (dtensor_layout_cost_model_bandwidth_gbps_str == nullptr) return 100;
+  int dtensor_layout_cost_model_bandwidth_gbps;
+  if (absl::SimpleAtoi(dtensor_layout_cost_model_bandwidth_gbps_str,
+                       &dtensor_layout_cost_model_bandwidth_gbps) &&
+      dtensor_layout_cost_model_bandwidth_gbps > 0)
+    return dtensor_layout_cost_model_bandwidth_gbps;
+  LOG(WARNING) << "Invalid DTENSOR_LAYOUT_COST_MODEL_BANDWIDTH_GBPS, using "
+                  "the default value 100.";
+  return 100;
+}
+
+int LayoutCostModelComputeGElementsPerSecond() {
+  char* dtensor_layout_cost_model_compute_str =
+      std::getenv("DTENSOR_LAYOUT_COST_MODEL_COMPUTE_GELEMENTS_PER_SECOND");
+  if (dtensor_layout_cost_model_compute_str == nullptr) return 1000;
+  int dtensor_layout_cost_model_compute;
+  if (absl::SimpleAtoi(dtensor_layout_cost_model_compute_str,
+                       &dtensor_layout_cost_model_compute) &&
+      dtensor_layout_cost_model_compute > 0)
+    return dtensor_layout_cost_model_compute;
+  LOG(WARNING) << "Invalid DTENSOR_LAYOUT_COST_MODEL_COMPUTE_GELEMENTS_PER_"
+                  "SECOND, using the default value 1000.";
+  return 1000;
+}
+
 }  // namespace dtensor
 }  // namespace tensorflow
@@ -51,6 +51,26 @@ bool DoNotFuseReduceScatter();
 // reduce op.
 int ReduceInBfloat16MaxGroupSize();
 
+// Returns whether to hoist all-gathers and reduce-scatters to right after
+// the producers of their inputs, so that they overlap with compute.
+bool EnableCollectiveScheduling();
+
+// Returns the extra memory, in MiB, that all-gathers hoisted by collective
+// scheduling may keep alive at the same time.
+int AllGatherPrefetchBudgetMiB();
+
+// Returns whether layout propagation should resolve disagreeing producer and
+// consumer layouts with a communication and compute cost model.
+bool EnableLayoutPropagationCostModel();
+
+// Returns the bandwidth, in GB/s, each device is assumed to receive data at
+// by the layout propagation cost model.
+int LayoutCostModelBandwidthGBps();
+
+// Returns the rate, in billions of elements per second, each device is assumed
+// to process tensor elements at by the layout propagation cost model.
+int LayoutCostModelComputeGElementsPerSecond();
+
 }  // namespace dtensor
 }  // namespace tensorflow
 
@@ -0,0 +1,162 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
+#include "mlir/IR/Block.h"  // from @llvm-project
+#include "mlir/IR/BuiltinTypes.h"  // from @llvm-project
+#include "mlir/IR/Operation.h"  // from @llvm-project
+#include "mlir/IR/Value.h"  // from @llvm-project
+#include "mlir/Pass/Pass.h"  // from @llvm-project
+#include "tensorflow/compiler/mlir/tensorflow/ir/tf_device.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/dtensor/cc/dtensor_utils.h"
+#include "tensorflow/dtensor/mlir/dtensor_mlir_passes.h"
+#include "tensorflow/dtensor/mlir/dtensor_mlir_passes_classes.h"
+#include "tensorflow/dtensor/mlir/ir/tf_dtensor.h"
+
+namespace tensorflow {
+namespace dtensor {
+
+namespace {
+
+// Returns the last op in `block` that defines, or contains the definition of,
+// an operand of `op`, or nullptr if all operands are available at the start
+// of `block`.
+mlir::Operation* LatestOperandProducer(mlir::Operation* op,
+                                       mlir::Block& block) {
+  mlir::Operation* latest = nullptr;
+  for (mlir::Value operand : op->getOperands()) {
+    mlir::Operation* producer = operand.getDefiningOp();
+    if (!producer) continue;
+    producer = block.findAncestorOpInBlock(*producer);
+    if (!producer) continue;
+    if (!latest || latest->isBeforeInBlock(producer)) latest = producer;
+  }
+  return latest;
+}
+
+// Returns the number of bytes an all-gather adds to live memory, or -1 if its
+// shapes aren't static.
+int64_t AllGatherExtraBytes(mlir::TF::DTensorAllGatherOp all_gather) {
+  auto input_type =
+      all_gather.input().getType().dyn_cast<mlir::RankedTensorType>();
+  auto output_type =
+      all_gather.output().getType().dyn_cast<mlir::RankedTensorType>();
+  if (!input_type || !output_type || !input_type.hasStaticShape() ||
+      !output_type.hasStaticShape())
+    return -1;
+  const int64_t element_bytes =
+      std::max<int64_t>(input_type.getElementTypeBitWidth() / 8, 1);
+  return (output_type.getNumElements() - input_type.getNumElements()) *
+         element_bytes;
+}
+
+// Moves every DTensorAllGather and DTensorReduceScatter in `block` to right
+// after the producer of its last operand, so that the collective is issued as
+// soon as its input is ready and runs while the ops between its producer and
+// its consumers compute. Collectives sharing a producer keep their order.
+//
+// Hoisting an all-gather keeps its output alive for longer. All-gathers are
+// hoisted greedily in program order as long as the extra bytes of the
+// hoisted all-gathers alive at the same time stay within `budget_bytes`.
+// Reduce-scatters shrink their input and are always hoisted.
+void ScheduleCollectivesInBlock(mlir::Block& block, int64_t budget_bytes) {
+  llvm::DenseMap<mlir::Operation*, int> position;
+  llvm::SmallVector<mlir::Operation*, 8> collectives;
+  int index = 0;
+  for (mlir::Operation& op : block) {
+    position[&op] = index++;
+    if (llvm::isa<mlir::TF::DTensorAllGatherOp,
+                  mlir::TF::DTensorReduceScatterOp>(op))
+      collectives.push_back(&op);
+  }
+
+  // The original positions between which hoisted all-gathers extend the
+  // lifetime of their outputs.
+  struct LiveRange {
+    int begin;
+    int end;
+    int64_t bytes;
+  };
+  std::vector<LiveRange> prefetched;
+  // The last collective moved after each producer.
+  llvm::DenseMap<mlir::Operation*, mlir::Operation*> last_moved;
+  int num_moved = 0;
+  for (mlir::Operation* op : collectives) {
+    mlir::Operation* producer = LatestOperandProducer(op, block);
+    const int begin = producer ? position[producer] : -1;
+    const int end = position[op];
+    if (begin + 1 >= end) continue;
+
+    if (auto all_gather = llvm::dyn_cast<mlir::TF::DTensorAllGatherOp>(op)) {
+      const int64_t bytes = AllGatherExtraBytes(all_gather);
+      if (bytes < 0) continue;
+      int64_t live_bytes = bytes;
+      for (const LiveRange& range : prefetched)
+        if (range.begin < end && begin < range.end) live_bytes += range.bytes;
+      if (live_bytes > budget_bytes) continue;
+      prefetched.push_back({begin, end, bytes});
+    }
+
+    auto moved = last_moved.find(producer);
+    if (moved != last_moved.end())
+      op->moveAfter(moved->second);
+    else if (producer)
+      op->moveAfter(producer);
+    else
+      op->moveBefore(&block.front());
+    last_moved[producer] = op;
+    ++num_moved;
+  }
+  VLOG(2) << "Hoisted " << num_moved << " of " << collectives.size()
+          << " collectives";
+}
+
+struct DTensorCollectiveScheduling
+    : public DTensorCollectiveSchedulingBase<DTensorCollectiveScheduling> {
+  void runOnOperation() override {
+    mlir::func::FuncOp function = getOperation();
+    const int64_t budget_bytes =
+        static_cast<int64_t>(AllGatherPrefetchBudgetMiB()) * 1024 * 1024;
+    function.walk([&](mlir::tf_device::ClusterOp cluster) {
+      llvm::SmallSetVector<mlir::Block*, 4> blocks;
+      cluster.GetBody().walk([&](mlir::Operation* op) {
+        if (llvm::isa<mlir::TF::DTensorAllGatherOp,
+                      mlir::TF::DTensorReduceScatterOp>(op))
+          blocks.insert(op->getBlock());
+      });
+      for (mlir::Block* block : blocks)
+        ScheduleCollectivesInBlock(*block, budget_bytes);
+    });
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateDTensorCollectiveScheduling() {
+  return std::make_unique<DTensorCollectiveScheduling>();
+}
+
+}  // namespace dtensor
+}  // namespace tensorflow
@@ -170,6 +170,13 @@ void CreateDTensorMLIRPass(const mlir::TF::StandardPipelineOptions &options,
   // const only had one usage) as part of layout propagation.
   pm->addPass(mlir::createCSEPass());
 
+  // Issue all-gathers as soon as their inputs are ready, e.g. prefetch the
+  // weights of later layers in fully sharded layouts, so that they overlap
+  // with compute.
+  if (EnableCollectiveScheduling()) {
+    pm->addNestedPass<mlir::func::FuncOp>(CreateDTensorCollectiveScheduling());
+  }
+
   // Lower the AllGather collectives. This has to happen before the all reduce
   // optimizations and AllGather may emit an AllReduce.
   pm->addPass(CreateDTensorAllGatherLoweringPass());
@@ -187,6 +194,12 @@ void CreateDTensorMLIRPass(const mlir::TF::StandardPipelineOptions &options,
 
   AddDTensorAllReduceCombineOptimization(pm);
 
+  // Likewise issue the reduce-scatters created above, e.g. of gradients, as
+  // soon as their inputs are ready.
+  if (EnableCollectiveScheduling()) {
+    pm->addNestedPass<mlir::func::FuncOp>(CreateDTensorCollectiveScheduling());
+  }
+
   // DTensorReduceScatter lowering should come before DTensorAllReduce
   // and DTensorAllScatter lowerings since for some devices DTensorReduceScatter
   // will be decomposed into an DTensorAllReduce+DTensorScatter.
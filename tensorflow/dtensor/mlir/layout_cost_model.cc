@@ -0,0 +1,151 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/dtensor/mlir/layout_cost_model.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace tensorflow {
+namespace dtensor {
+namespace {
+
+// Returns the number of shards of tensor dimension `dim` under `layout`.
+// "any" and "match" specs count as unsharded.
+int64_t NumShards(const Layout& layout, int dim) {
+  const std::string& spec = layout.sharding_spec(dim);
+  if (Layout::IsUnshardedDimension(spec) || spec == Layout::kAny ||
+      spec == Layout::kMatch)
+    return 1;
+  StatusOr<int64> dim_size = layout.mesh().dim_size(spec);
+  return dim_size.ok() ? dim_size.ValueOrDie() : 1;
+}
+
+int64_t CeilOfRatio(int64_t numerator, int64_t denominator) {
+  return (numerator + denominator - 1) / denominator;
+}
+
+// Returns the number of local elements an op that requested `requested`
+// works on when the value has layout `candidate`: dimensions the op accepts
+// any sharding of follow `candidate`.
+int64_t ComputedNumElements(const Layout& requested, const Layout& candidate,
+                            llvm::ArrayRef<int64_t> global_shape) {
+  int64_t num_elements = 1;
+  for (int j = 0; j < global_shape.size(); ++j) {
+    const int64_t shards = requested.sharding_spec(j) == Layout::kAny
+                               ? NumShards(candidate, j)
+                               : NumShards(requested, j);
+    num_elements *= CeilOfRatio(global_shape[j], shards);
+  }
+  return num_elements;
+}
+
+// Returns `layout` with "any" specs replaced by unsharded ones.
+StatusOr<Layout> WithoutAnySpecs(const Layout& layout) {
+  std::vector<std::string> specs = layout.sharding_spec_strs();
+  for (std::string& spec : specs)
+    if (spec == Layout::kAny) spec = Layout::kUnshardedDim;
+  return Layout::GetLayout(specs, layout.mesh());
+}
+
+}  // namespace
+
+int64_t LocalNumElements(const Layout& layout,
+                         llvm::ArrayRef<int64_t> global_shape) {
+  int64_t num_elements = 1;
+  for (int j = 0; j < global_shape.size(); ++j)
+    num_elements *= CeilOfRatio(global_shape[j], NumShards(layout, j));
+  return num_elements;
+}
+
+int64_t RelayoutBytes(const Layout& from, const Layout& to,
+                      llvm::ArrayRef<int64_t> global_shape,
+                      int64_t element_bytes) {
+  if (from.rank() != global_shape.size() || to.rank() != global_shape.size())
+    return 0;
+  // Dimensions kept sharded are those `to` shards the same way or accepts any
+  // sharding of; every other sharded dimension of `from` is all-gathered.
+  int64_t from_elements = 1;
+  int64_t gathered_elements = 1;
+  for (int j = 0; j < global_shape.size(); ++j) {
+    const int64_t shards = NumShards(from, j);
+    const std::string& to_spec = to.sharding_spec(j);
+    const bool kept =
+        to_spec == from.sharding_spec(j) || to_spec == Layout::kAny;
+    from_elements *= CeilOfRatio(global_shape[j], shards);
+    gathered_elements *= CeilOfRatio(global_shape[j], kept ? shards : 1);
+  }
+  return (gathered_elements - from_elements) * element_bytes;
+}
+
+double LayoutCost(const Layout& candidate,
+                  const absl::optional<Layout>& producer,
+                  llvm::ArrayRef<Layout> consumers,
+                  llvm::ArrayRef<int64_t> global_shape, int64_t element_bytes,
+                  const LayoutCostModelOptions& options) {
+  int64_t relayout_bytes = 0;
+  int64_t computed_elements = 0;
+  if (producer) {
+    relayout_bytes +=
+        RelayoutBytes(*producer, candidate, global_shape, element_bytes);
+    computed_elements +=
+        ComputedNumElements(*producer, candidate, global_shape);
+  }
+  for (const Layout& consumer : consumers) {
+    relayout_bytes +=
+        RelayoutBytes(candidate, consumer, global_shape, element_bytes);
+    computed_elements +=
+        ComputedNumElements(consumer, candidate, global_shape);
+  }
+  return relayout_bytes / options.bandwidth_bytes_per_second +
+         computed_elements / options.compute_elements_per_second;
+}
+
+Layout ChooseLayoutByCost(const Layout& default_layout,
+                          const absl::optional<Layout>& producer,
+                          llvm::ArrayRef<Layout> consumers,
+                          llvm::ArrayRef<int64_t> global_shape,
+                          int64_t element_bytes,
+                          const LayoutCostModelOptions& options) {
+  std::vector<Layout> candidates;
+  auto add_candidate = [&](const Layout& layout) {
+    if (layout.rank() != default_layout.rank() ||
+        layout.mesh() != default_layout.mesh())
+      return;
+    StatusOr<Layout> candidate = WithoutAnySpecs(layout);
+    if (candidate.ok()) candidates.push_back(candidate.ValueOrDie());
+  };
+  if (producer) add_candidate(*producer);
+  for (const Layout& consumer : consumers) add_candidate(consumer);
+  // Sort so that ties are broken the same way in every run.
+  std::sort(candidates.begin(), candidates.end());
+
+  Layout best = default_layout;
+  double best_cost = LayoutCost(default_layout, producer, consumers,
+                                global_shape, element_bytes, options);
+  for (const Layout& candidate : candidates) {
+    const double cost = LayoutCost(candidate, producer, consumers,
+                                   global_shape, element_bytes, options);
+    if (cost < best_cost) {
+      best = candidate;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+}  // namespace dtensor
+}  // namespace tensorflow
@@ -0,0 +1,78 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DTENSOR_MLIR_LAYOUT_COST_MODEL_H_
+#define TENSORFLOW_DTENSOR_MLIR_LAYOUT_COST_MODEL_H_
+
+#include <cstdint>
+
+#include "absl/types/optional.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "tensorflow/dtensor/cc/tensor_layout.h"
+
+namespace tensorflow {
+namespace dtensor {
+
+// A simple cost model used by layout propagation to choose the layout of a
+// value whose producer and consumers disagree.
+//
+// Changing a value from one layout to another all-gathers every tensor
+// dimension that is sharded in the source layout but not in the same way in
+// the target layout; sharding a dimension is a local slice and is free. Each
+// op that accepts any sharding of a dimension ("any" spec) computes on the
+// local shard of the chosen layout, so sharding that dimension reduces its
+// work. The cost of a layout is the time spent on both at the given rates.
+struct LayoutCostModelOptions {
+  // Bytes each device can receive per second.
+  double bandwidth_bytes_per_second = 1e11;
+  // Elements each device can process per second.
+  double compute_elements_per_second = 1e12;
+};
+
+// Returns the number of elements of a tensor of `global_shape` held by each
+// device under `layout`. `global_shape` must be static.
+int64_t LocalNumElements(const Layout& layout,
+                         llvm::ArrayRef<int64_t> global_shape);
+
+// Returns the number of bytes each device receives to change a tensor of
+// `global_shape`, with `element_bytes`-byte elements, from layout `from` to
+// layout `to`.
+int64_t RelayoutBytes(const Layout& from, const Layout& to,
+                      llvm::ArrayRef<int64_t> global_shape,
+                      int64_t element_bytes);
+
+// Returns the estimated time in seconds spent on `candidate` as the layout of
+// a value produced with layout `producer` (if any) and consumed by ops
+// requesting `consumers`.
+double LayoutCost(const Layout& candidate,
+                  const absl::optional<Layout>& producer,
+                  llvm::ArrayRef<Layout> consumers,
+                  llvm::ArrayRef<int64_t> global_shape, int64_t element_bytes,
+                  const LayoutCostModelOptions& options);
+
+// Returns the cheapest of `default_layout`, the producer layout and the
+// consumer layouts, preferring `default_layout` on ties. "any" specs in the
+// producer and consumer layouts are treated as unsharded.
+Layout ChooseLayoutByCost(const Layout& default_layout,
+                          const absl::optional<Layout>& producer,
+                          llvm::ArrayRef<Layout> consumers,
+                          llvm::ArrayRef<int64_t> global_shape,
+                          int64_t element_bytes,
+                          const LayoutCostModelOptions& options);
+
+}  // namespace dtensor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DTENSOR_MLIR_LAYOUT_COST_MODEL_H_
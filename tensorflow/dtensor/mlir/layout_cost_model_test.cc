@@ -0,0 +1,100 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/dtensor/mlir/layout_cost_model.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/dtensor/cc/tensor_layout.h"
+
+namespace tensorflow {
+namespace dtensor {
+namespace {
+
+constexpr char kMesh[] =
+    "mesh|x=2,y=2|0,1,2,3|0,1,2,3|/job:localhost/task:0/device:CPU:0,"
+    "/job:localhost/task:0/device:CPU:1,/job:localhost/task:0/device:CPU:2,"
+    "/job:localhost/task:0/device:CPU:3";
+
+class LayoutCostModelTest : public ::testing::Test {
+ protected:
+  Layout MakeLayout(const std::vector<std::string>& specs) {
+    StatusOr<Mesh> mesh = Mesh::FromString(kMesh);
+    CHECK(mesh.ok()) << mesh.status();
+    StatusOr<Layout> layout = Layout::GetLayout(specs, mesh.ValueOrDie());
+    CHECK(layout.ok()) << layout.status();
+    return layout.ValueOrDie();
+  }
+
+  const std::vector<int64_t> shape_ = {8, 4};
+  const LayoutCostModelOptions options_;
+};
+
+TEST_F(LayoutCostModelTest, LocalNumElements) {
+  EXPECT_EQ(LocalNumElements(MakeLayout({"x", "y"}), shape_), 8);
+  EXPECT_EQ(LocalNumElements(MakeLayout({"x", Layout::kUnshardedDim}), shape_),
+            16);
+  EXPECT_EQ(LocalNumElements(MakeLayout({Layout::kAny, "y"}), shape_), 16);
+}
+
+TEST_F(LayoutCostModelTest, RelayoutBytes) {
+  const Layout sharded = MakeLayout({"x", Layout::kUnshardedDim});
+  const Layout replicated =
+      MakeLayout({Layout::kUnshardedDim, Layout::kUnshardedDim});
+  // All-gathering `x` receives the other half of the tensor.
+  EXPECT_EQ(RelayoutBytes(sharded, replicated, shape_, 4), 64);
+  // Slicing is local.
+  EXPECT_EQ(RelayoutBytes(replicated, sharded, shape_, 4), 0);
+  EXPECT_EQ(RelayoutBytes(sharded, sharded, shape_, 4), 0);
+  EXPECT_EQ(RelayoutBytes(sharded, MakeLayout({Layout::kAny, "y"}), shape_, 4),
+            0);
+}
+
+TEST_F(LayoutCostModelTest, PrefersOneAllGatherOverMany) {
+  const Layout sharded = MakeLayout({"x", Layout::kUnshardedDim});
+  const Layout replicated =
+      MakeLayout({Layout::kUnshardedDim, Layout::kUnshardedDim});
+  // Keeping the producer layout makes both consumers all-gather, while
+  // gathering once after the producer serves both.
+  EXPECT_EQ(ChooseLayoutByCost(sharded, sharded, {replicated, replicated},
+                               shape_, 4, options_),
+            replicated);
+}
+
+TEST_F(LayoutCostModelTest, KeepsShardingForConsumersAcceptingAny) {
+  const Layout sharded = MakeLayout({"x", Layout::kUnshardedDim});
+  const Layout replicated =
+      MakeLayout({Layout::kUnshardedDim, Layout::kUnshardedDim});
+  const Layout any = MakeLayout({Layout::kAny, Layout::kUnshardedDim});
+  EXPECT_EQ(ChooseLayoutByCost(replicated, sharded, {any}, shape_, 4, options_),
+            sharded);
+}
+
+TEST_F(LayoutCostModelTest, PrefersDefaultOnTies) {
+  const Layout replicated =
+      MakeLayout({Layout::kUnshardedDim, Layout::kUnshardedDim});
+  const Layout sharded = MakeLayout({"x", Layout::kUnshardedDim});
+  EXPECT_EQ(ChooseLayoutByCost(replicated, absl::nullopt, {sharded}, shape_, 4,
+                               options_),
+            replicated);
+}
+
+}  // namespace
+}  // namespace dtensor
+}  // namespace tensorflow
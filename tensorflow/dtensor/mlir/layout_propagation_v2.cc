@@ -52,6 +52,7 @@ limitations under the License.
 #include "tensorflow/dtensor/mlir/dtensor_mlir_passes.h"
 #include "tensorflow/dtensor/mlir/dtensor_mlir_passes_classes.h"
 #include "tensorflow/dtensor/mlir/ir/tf_dtensor.h"
+#include "tensorflow/dtensor/mlir/layout_cost_model.h"
 #include "tensorflow/dtensor/mlir/layout_parsing.h"
 #include "tensorflow/dtensor/mlir/op_utils.h"
 #include "tensorflow/dtensor/mlir/spmd_expander.h"
@@ -174,6 +175,88 @@ void FilterkAnySpecs(std::vector<std::string>& proposed_specs) {
     if (spec == Layout::kAny) spec = Layout::kUnshardedDim;
   }
 }
+
+// Gets the global shape and element size of `value` for the layout cost
+// model. Returns false if they aren't statically known.
+bool GetCostModelShape(mlir::Value value, llvm::ArrayRef<int64_t>* global_shape,
+                       int64_t* element_bytes) {
+  auto type = value.getType().dyn_cast<mlir::RankedTensorType>();
+  if (!type || !type.hasStaticShape()) return false;
+  mlir::Type element_type = type.getElementType();
+  if (!element_type.isIntOrFloat()) return false;
+  *global_shape = type.getShape();
+  *element_bytes =
+      std::max<int64_t>(element_type.getIntOrFloatBitWidth() / 8, 1);
+  return true;
+}
+
+LayoutCostModelOptions GetLayoutCostModelOptions() {
+  LayoutCostModelOptions options;
+  options.bandwidth_bytes_per_second = LayoutCostModelBandwidthGBps() * 1e9;
+  options.compute_elements_per_second =
+      LayoutCostModelComputeGElementsPerSecond() * 1e9;
+  return options;
+}
+
+// Returns the layout with the lowest estimated cost for `value`, given the
+// layout proposed by MergeLayouts. Falls back to `merged` if the shape of
+// `value` isn't statically known.
+Layout ChooseLayoutByCostForValue(
+    mlir::Value value, const absl::optional<Layout>& producer,
+    const mlir::DenseMap<mlir::OpOperand*, Layout>& consumers,
+    const Layout& merged) {
+  llvm::ArrayRef<int64_t> global_shape;
+  int64_t element_bytes;
+  if (!GetCostModelShape(value, &global_shape, &element_bytes) ||
+      global_shape.size() != merged.rank())
+    return merged;
+  std::vector<Layout> consumer_layouts;
+  consumer_layouts.reserve(consumers.size());
+  for (const auto& consumer : consumers)
+    consumer_layouts.push_back(consumer.second);
+  return ChooseLayoutByCost(merged, producer, consumer_layouts, global_shape,
+                            element_bytes, GetLayoutCostModelOptions());
+}
+
+// Logs the all-gathers needed wherever the final layout of a value differs
+// from the layout requested by its producer or its consumers.
+void ReportRelayouts(
+    const llvm::DenseMap<mlir::Value, absl::optional<Layout>>& producer_request,
+    const llvm::DenseMap<mlir::Value, mlir::DenseMap<mlir::OpOperand*, Layout>>&
+        consumer_requests,
+    const llvm::DenseMap<mlir::Value, Layout>& merged_layouts) {
+  int64_t num_relayouts = 0;
+  int64_t total_bytes = 0;
+  for (const auto& value_and_layout : merged_layouts) {
+    const mlir::Value value = value_and_layout.getFirst();
+    const Layout& layout = value_and_layout.getSecond();
+    llvm::ArrayRef<int64_t> global_shape;
+    int64_t element_bytes;
+    if (!GetCostModelShape(value, &global_shape, &element_bytes) ||
+        global_shape.size() != layout.rank())
+      continue;
+    auto report = [&](const Layout& from, const Layout& to) {
+      const int64_t bytes =
+          RelayoutBytes(from, to, global_shape, element_bytes);
+      if (bytes <= 0) return;
+      ++num_relayouts;
+      total_bytes += bytes;
+      VLOG(1) << "All-gather of " << bytes << " bytes per device for "
+              << mlir::GetNameFromLoc(value.getLoc()) << " from "
+              << from.ToString() << " to " << to.ToString();
+    };
+    auto producer = producer_request.find(value);
+    if (producer != producer_request.end() && producer->second)
+      report(*producer->second, layout);
+    auto consumers = consumer_requests.find(value);
+    if (consumers == consumer_requests.end()) continue;
+    for (const auto& consumer : consumers->second)
+      report(layout, consumer.second);
+  }
+  LOG(INFO) << "DTensor layout propagation needs " << num_relayouts
+            << " all-gathers receiving an estimated " << total_bytes
+            << " bytes per device.";
+}
 }  // namespace
 
 // Merges the producer and consumer layouts into a single layout.
@@ -445,12 +528,16 @@ mlir::LogicalResult MergeAndGetUpdatedLayouts(
     if (!merged.ok())
       return value.getDefiningOp()->emitOpError()
              << merged.status().error_message();
+    Layout merged_layout = merged.ValueOrDie();
+    if (EnableLayoutPropagationCostModel())
+      merged_layout = ChooseLayoutByCostForValue(
+          value, producer_layout, consumer_requests[value], merged_layout);
 
     auto current_layout = merged_layouts.find(value);
     if (current_layout == merged_layouts.end() ||
-        current_layout->second != merged.ValueOrDie()) {
+        current_layout->second != merged_layout) {
       updated_merge.insert(value);
-      merged_layouts[value] = merged.ValueOrDie();
+      merged_layouts[value] = merged_layout;
     }
   }
 
@@ -1558,6 +1645,9 @@ struct DLayoutPropagationPassV2
     if (!AllOpResultsHaveLayouts(&module, tf_dialect, merged_layouts))
       return signalPassFailure();
 
+    if (EnableLayoutPropagationCostModel())
+      ReportRelayouts(producer_request, consumer_requests, merged_layouts);
+
     if (mlir::failed(InsertDTensorLayoutOps(builder, merged_layouts)))
       return signalPassFailure();
 
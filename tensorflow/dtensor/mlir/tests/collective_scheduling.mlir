@@ -0,0 +1,131 @@
+// RUN: dtensor-opt %s -split-input-file -dtensor-collective-scheduling | FileCheck %s
+// RUN: env DTENSOR_ALL_GATHER_PREFETCH_BUDGET_MIB=1 dtensor-opt %s -split-input-file -dtensor-collective-scheduling | FileCheck %s --check-prefix=BUDGET
+
+// Check that an all-gather of a function argument is issued at the start of
+// the cluster, before the unrelated compute.
+// CHECK-LABEL: func @hoist_all_gather_of_argument
+// CHECK-SAME: %[[ARG0:[a-z0-9]*]]: tensor<2x4xf32>
+func.func @hoist_all_gather_of_argument(%arg0: tensor<2x4xf32>, %arg1: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  // CHECK:      "tf_device.cluster"
+  // CHECK-NEXT:   %[[GATHER:.*]] = "tf.DTensorAllGather"(%[[ARG0]])
+  // CHECK-NEXT:   %[[MATMUL:.*]] = "tf.MatMul"
+  // CHECK-NEXT:   %[[RELU:.*]] = "tf.Relu"(%[[MATMUL]])
+  // CHECK-NEXT:   "tf.AddV2"(%[[RELU]], %[[GATHER]])
+  %0 = "tf_device.cluster"() ({
+    %1 = "tf.MatMul"(%arg1, %arg1) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %2 = "tf.Relu"(%1) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+    %3 = "tf.DTensorAllGather"(%arg0) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<2x4xf32>) -> tensor<4x4xf32>
+    %4 = "tf.AddV2"(%2, %3) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    tf_device.return %4 : tensor<4x4xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> tensor<4x4xf32>
+  func.return %0 : tensor<4x4xf32>
+}
+
+// -----
+
+// Check that an all-gather is moved to right after the producer of its input.
+// CHECK-LABEL: func @hoist_all_gather_to_producer
+func.func @hoist_all_gather_to_producer(%arg0: tensor<2x4xf32>, %arg1: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  // CHECK:      %[[NEG:.*]] = "tf.Neg"
+  // CHECK-NEXT: %[[GATHER:.*]] = "tf.DTensorAllGather"(%[[NEG]])
+  // CHECK-NEXT: "tf.MatMul"
+  // CHECK-NEXT: "tf.Relu"
+  // CHECK-NEXT: "tf.AddV2"(%{{.*}}, %[[GATHER]])
+  %0 = "tf_device.cluster"() ({
+    %1 = "tf.Neg"(%arg0) : (tensor<2x4xf32>) -> tensor<2x4xf32>
+    %2 = "tf.MatMul"(%arg1, %arg1) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %3 = "tf.Relu"(%2) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+    %4 = "tf.DTensorAllGather"(%1) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<2x4xf32>) -> tensor<4x4xf32>
+    %5 = "tf.AddV2"(%3, %4) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    tf_device.return %5 : tensor<4x4xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> tensor<4x4xf32>
+  func.return %0 : tensor<4x4xf32>
+}
+
+// -----
+
+// Check that a reduce-scatter waits for all of its operands, including the
+// group assignment and scatter dimension.
+// CHECK-LABEL: func @hoist_reduce_scatter
+func.func @hoist_reduce_scatter(%arg0: tensor<4x4xf32>, %arg1: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  // CHECK:      %[[GROUPS:.*]] = "tf.Const"
+  // CHECK-NEXT: %[[NEG:.*]] = "tf.Neg"
+  // CHECK-NEXT: %[[DIM:.*]] = "tf.Const"
+  // CHECK-NEXT: %[[SCATTER:.*]] = "tf.DTensorReduceScatter"(%[[NEG]], %[[GROUPS]], %[[DIM]])
+  // CHECK-NEXT: "tf.MatMul"
+  // CHECK-NEXT: "tf.Relu"
+  %0:2 = "tf_device.cluster"() ({
+    %groups = "tf.Const"() {value = dense<[[0, 1]]> : tensor<1x2xi32>} : () -> tensor<1x2xi32>
+    %1 = "tf.Neg"(%arg0) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+    %dim = "tf.Const"() {value = dense<0> : tensor<i32>} : () -> tensor<i32>
+    %2 = "tf.MatMul"(%arg1, %arg1) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %3 = "tf.Relu"(%2) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+    %4 = "tf.DTensorReduceScatter"(%1, %groups, %dim) {device_type = "/job:localhost/replica:0/task:0/device:CPU", reduce_op = "Add"} : (tensor<4x4xf32>, tensor<1x2xi32>, tensor<i32>) -> tensor<2x4xf32>
+    tf_device.return %3, %4 : tensor<4x4xf32>, tensor<2x4xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> (tensor<4x4xf32>, tensor<2x4xf32>)
+  func.return %0#0 : tensor<4x4xf32>
+}
+
+// -----
+
+// Check that collectives hoisted to the same producer keep their order.
+// CHECK-LABEL: func @keep_order_of_collectives
+func.func @keep_order_of_collectives(%arg0: tensor<2x4xf32>, %arg1: tensor<2x4xf32>, %arg2: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  // CHECK:      %[[GATHER0:.*]] = "tf.DTensorAllGather"(%arg1)
+  // CHECK-NEXT: %[[GATHER1:.*]] = "tf.DTensorAllGather"(%arg0)
+  // CHECK-NEXT: "tf.MatMul"
+  // CHECK-NEXT: "tf.AddV2"(%{{.*}}, %[[GATHER0]])
+  // CHECK-NEXT: "tf.AddV2"(%{{.*}}, %[[GATHER1]])
+  %0 = "tf_device.cluster"() ({
+    %1 = "tf.MatMul"(%arg2, %arg2) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %2 = "tf.DTensorAllGather"(%arg1) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<2x4xf32>) -> tensor<4x4xf32>
+    %3 = "tf.AddV2"(%1, %2) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %4 = "tf.DTensorAllGather"(%arg0) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<2x4xf32>) -> tensor<4x4xf32>
+    %5 = "tf.AddV2"(%3, %4) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    tf_device.return %5 : tensor<4x4xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> tensor<4x4xf32>
+  func.return %0 : tensor<4x4xf32>
+}
+
+// -----
+
+// Check that all-gathers without static shapes stay where they are, since
+// their extra memory isn't known.
+// CHECK-LABEL: func @keep_dynamic_all_gather
+func.func @keep_dynamic_all_gather(%arg0: tensor<*xf32>, %arg1: tensor<4x4xf32>) -> tensor<*xf32> {
+  // CHECK:      "tf.MatMul"
+  // CHECK-NEXT: "tf.DTensorAllGather"
+  %0 = "tf_device.cluster"() ({
+    %1 = "tf.MatMul"(%arg1, %arg1) : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+    %2 = "tf.DTensorAllGather"(%arg0) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<*xf32>) -> tensor<*xf32>
+    %3 = "tf.AddV2"(%1, %2) : (tensor<4x4xf32>, tensor<*xf32>) -> tensor<*xf32>
+    tf_device.return %3 : tensor<*xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> tensor<*xf32>
+  func.return %0 : tensor<*xf32>
+}
+
+// -----
+
+// Each all-gather below adds 1 MiB of live memory. With the default budget
+// both are hoisted. With a 1 MiB budget only the first one is, since the
+// second would keep both outputs alive over the matmul.
+// CHECK-LABEL: func @all_gather_budget
+// BUDGET-LABEL: func @all_gather_budget
+func.func @all_gather_budget(%arg0: tensor<512x512xf32>, %arg1: tensor<512x512xf32>, %arg2: tensor<1024x512xf32>) -> tensor<1024x512xf32> {
+  // CHECK:      %[[GATHER0:.*]] = "tf.DTensorAllGather"(%arg0)
+  // CHECK-NEXT: %[[GATHER1:.*]] = "tf.DTensorAllGather"(%arg1)
+  // CHECK-NEXT: "tf.Relu"
+  // BUDGET:      %[[GATHER0:.*]] = "tf.DTensorAllGather"(%arg0)
+  // BUDGET-NEXT: %[[RELU:.*]] = "tf.Relu"
+  // BUDGET-NEXT: %[[GATHER1:.*]] = "tf.DTensorAllGather"(%arg1)
+  // BUDGET-NEXT: "tf.AddV2"(%[[GATHER0]], %[[GATHER1]])
+  %0 = "tf_device.cluster"() ({
+    %1 = "tf.Relu"(%arg2) : (tensor<1024x512xf32>) -> tensor<1024x512xf32>
+    %2 = "tf.DTensorAllGather"(%arg0) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<512x512xf32>) -> tensor<1024x512xf32>
+    %3 = "tf.DTensorAllGather"(%arg1) {input_layout = #dtensor.layout<sharding_specs:x,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>, output_layout = #dtensor.layout<sharding_specs:unsharded,unsharded, mesh:mesh|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1>} : (tensor<512x512xf32>) -> tensor<1024x512xf32>
+    %4 = "tf.AddV2"(%2, %3) : (tensor<1024x512xf32>, tensor<1024x512xf32>) -> tensor<1024x512xf32>
+    %5 = "tf.AddV2"(%1, %4) : (tensor<1024x512xf32>, tensor<1024x512xf32>) -> tensor<1024x512xf32>
+    tf_device.return %5 : tensor<1024x512xf32>
+  }) {_mesh = "|x=2|0,1|0,1|/job:localhost/task:0/device:CPU:0,/job:localhost/task:0/device:CPU:1"} : () -> tensor<1024x512xf32>
+  func.return %0 : tensor<1024x512xf32>
+}
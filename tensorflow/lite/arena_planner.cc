@@ -57,7 +57,23 @@ std::intptr_t ArenaPlanner::BasePointer(TfLiteAllocationType type) {
 }
 
 TfLiteStatus ArenaPlanner::ResetAllocations() {
-  TF_LITE_ENSURE_STATUS(arena_.ClearPlan());
+  // The plan of the non-persistent arena is kept, so that tensors can keep
+  // their allocations if they still fit. See CalculateAllocations().
+  const int num_tensors = graph_info_->num_tensors();
+  for (int i = num_tensors; i < static_cast<int>(reusable_allocs_.size());
+       ++i) {
+    TF_LITE_ENSURE_STATUS(arena_.Deallocate(context_, reusable_allocs_[i]));
+  }
+  reusable_allocs_.resize(num_tensors);
+  for (int i = 0; i < static_cast<int>(allocs_.size()); ++i) {
+    if (allocs_[i].size == 0) continue;
+    if (i < num_tensors &&
+        graph_info_->tensor(i)->allocation_type == kTfLiteArenaRw) {
+      reusable_allocs_[i] = allocs_[i];
+    } else {
+      TF_LITE_ENSURE_STATUS(arena_.Deallocate(context_, allocs_[i]));
+    }
+  }
   TF_LITE_ENSURE_STATUS(persistent_arena_.ClearPlan());
   allocs_.clear();
   allocs_.resize(graph_info_->num_tensors());
@@ -80,8 +96,11 @@ TfLiteStatus ArenaPlanner::ResetAllocationsAfter(int node) {
 }
 
 TfLiteStatus ArenaPlanner::PlanAllocations() {
-  // Invalidate any existing data.
+  // Invalidate any existing data. A new plan changes when tensors are used, so
+  // nothing of the previous one can be reused.
   TF_LITE_ENSURE_STATUS(ResetAllocations());
+  TF_LITE_ENSURE_STATUS(arena_.ClearPlan());
+  reusable_allocs_.clear();
   // Maybe other verb instead of 'Assigned'
   alloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
   dealloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
@@ -106,7 +125,7 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
       return kTfLiteOk;
     }
     TF_LITE_ENSURE(context_, dealloc_node_[tensor] == kNodeNotAssigned);
-    dealloc_node_[tensor] = node;
+    dealloc_node_[tensor] = StageEnd(node);
     return kTfLiteOk;
   };
 
@@ -200,7 +219,7 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
       int tensor_index = node_temporaries->data[j];
       alloc_node_[tensor_index] = i;
       if (!preserve_all_tensors_) {
-        dealloc_node_[tensor_index] = i;
+        dealloc_node_[tensor_index] = StageEnd(i);
       }
     }
   }
@@ -245,6 +264,21 @@ bool ArenaPlanner::HasNonPersistentMemory() {
   return arena_.GetBufferSize() != 0;
 }
 
+void ArenaPlanner::SetStageEnds(const std::vector<int>& stage_ends) {
+  stage_ends_ = stage_ends;
+}
+
+int32_t ArenaPlanner::StageEnd(int node) const {
+  // Nodes that run concurrently overlap in time, so a tensor must outlive
+  // every node of the stage it is last used in. It is enough to delay
+  // deallocations: any two tensors used in a stage are then both allocated at
+  // the end of the stage, so they can't share memory.
+  if (static_cast<size_t>(node) < stage_ends_.size()) {
+    return stage_ends_[node];
+  }
+  return node;
+}
+
 void ArenaPlanner::DumpDebugInfo(const std::vector<int>& execution_plan) const {
   arena_.DumpDebugInfo("kTfLiteArenaRw Dump:", execution_plan);
   persistent_arena_.DumpDebugInfo("kTfLiteArenaRwPersistent Dump:",
@@ -309,13 +343,46 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
     if (tensor.allocation_type == kTfLiteArenaRw &&
         allocs_[tensor_index].size != 0) {
       TF_LITE_ENSURE_STATUS(arena_.Deallocate(context_, allocs_[tensor_index]));
+      allocs_[tensor_index].reset();
     }
   }
 
+  // If every tensor still fits the allocation it had before the last
+  // ResetAllocations(), e.g. because inputs shrank, keep the previous plan.
+  // Otherwise plan the tensors from scratch.
+  auto has_reusable_alloc = [this](int tensor_index) {
+    return tensor_index < static_cast<int>(reusable_allocs_.size()) &&
+           reusable_allocs_[tensor_index].size != 0;
+  };
+  bool reuse_allocs = true;
+  for (const auto& tensor_index : tensor_order) {
+    if (!has_reusable_alloc(tensor_index)) continue;
+    const TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
+    const ArenaAllocWithUsageInterval& alloc = reusable_allocs_[tensor_index];
+    if (tensor.allocation_type != kTfLiteArenaRw || tensor.bytes == 0 ||
+        tensor.bytes > alloc.size ||
+        alloc.first_node != alloc_node_[tensor_index] ||
+        alloc.last_node != dealloc_node_[tensor_index]) {
+      reuse_allocs = false;
+      break;
+    }
+  }
+  for (const auto& tensor_index : tensor_order) {
+    if (!has_reusable_alloc(tensor_index)) continue;
+    if (reuse_allocs) {
+      allocs_[tensor_index] = reusable_allocs_[tensor_index];
+    } else {
+      TF_LITE_ENSURE_STATUS(
+          arena_.Deallocate(context_, reusable_allocs_[tensor_index]));
+    }
+    reusable_allocs_[tensor_index].reset();
+  }
+
   // Vector of ids of already allocated tensors, ordered by offset.
   for (const auto& tensor_index : tensor_order) {
     TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
-    if (tensor.allocation_type == kTfLiteArenaRw) {
+    if (tensor.allocation_type == kTfLiteArenaRw &&
+        allocs_[tensor_index].size == 0) {
       TF_LITE_ENSURE_STATUS(
           arena_.Allocate(context_, tensor_alignment_, tensor.bytes,
                           tensor_index, alloc_node_[tensor_index],
@@ -43,6 +43,10 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// Resetting the allocations, e.g. after an input is resized, keeps the previous
+// assignment of the non-persistent arena: if no tensor grew, the tensors keep
+// their offsets and the arena buffer is reused as is.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
@@ -63,6 +67,7 @@ class ArenaPlanner : public MemoryPlanner {
   TfLiteStatus AcquireNonPersistentMemory() override;
   bool HasNonPersistentMemory() override;
   void DumpDebugInfo(const std::vector<int>& execution_plan) const override;
+  void SetStageEnds(const std::vector<int>& stage_ends) override;
 
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
@@ -98,12 +103,20 @@ class ArenaPlanner : public MemoryPlanner {
   // 'node_index'.
   TfLiteStatus CalculateDeallocationOfInternalTensors(int node_index);
 
+  // Returns the node after which a tensor last used by 'node' can be
+  // deallocated, i.e. the last node of its stage.
+  int32_t StageEnd(int node) const;
+
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
 
   // Stores allocation data for all tensors.
   std::vector<ArenaAllocWithUsageInterval> allocs_;
 
+  // The allocations in `arena_` of tensors that haven't been allocated again
+  // since the last ResetAllocations().
+  std::vector<ArenaAllocWithUsageInterval> reusable_allocs_;
+
   // First node, that uses the tensor. It needs to be allocated before
   // execution of the node's operation.
   std::vector<int32_t> alloc_node_;
@@ -127,6 +140,9 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Number of bytes that tensor buffers should be aligned to.
   int tensor_alignment_;
+
+  // See SetStageEnds(). Empty if nodes run one at a time.
+  std::vector<int> stage_ends_;
 };
 
 }  // namespace tflite
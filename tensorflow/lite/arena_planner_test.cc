@@ -201,6 +201,8 @@ class ArenaPlannerTest : public ::testing::Test {
     CHECK(planner_->AcquireNonPersistentMemory() == kTfLiteOk);
   }
 
+  void ResetAllocations() { CHECK(planner_->ResetAllocations() == kTfLiteOk); }
+
   void ResetAllocationsAfter(int node) {
     CHECK(planner_->ResetAllocationsAfter(node) == kTfLiteOk);
   }
@@ -362,6 +364,46 @@ TEST_F(ArenaPlannerTest, SimpleGraphWithResetAllocationsAfter) {
   EXPECT_TRUE(IsUnallocated(5));
 }
 
+TEST_F(ArenaPlannerTest, SimpleGraphWithResetAllocationsAndResizedTensors) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},   // First op
+                      {{2, 0}, {4}, {5}},  // Second op, with temporary
+                      {{4}, {3}, {}}       // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  Execute(0, 10);
+  std::vector<std::ptrdiff_t> offsets;
+  for (int i = 0; i < 6; ++i) {
+    offsets.push_back(GetOffset(i));
+  }
+
+  // Tensors that shrink keep their offsets.
+  (*graph.tensors())[0].bytes = 1;
+  (*graph.tensors())[4].bytes = 2;
+  ResetAllocations();
+  Execute(0, 10);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+
+  // If a tensor grows, all of them are planned again.
+  (*graph.tensors())[4].bytes = 100;
+  ResetAllocations();
+  Execute(0, 10);
+  offsets.clear();
+  for (int i = 0; i < 6; ++i) {
+    offsets.push_back(GetOffset(i));
+  }
+  SetGraph(&graph);
+  Execute(0, 10);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+}
+
 TEST_F(ArenaPlannerTest, SimpleGraphWithPersistentResetAllocationsAfter) {
   TestGraph graph({0, 1},
                   {
@@ -115,6 +115,13 @@ int32_t TfLiteInterpreterGetOutputTensorIndex(
   return interpreter->impl->outputs()[output_index];
 }
 
+TfLiteStatus TfLiteInterpreterSetCustomAllocationForTensor(
+    TfLiteInterpreter* interpreter, int tensor_index,
+    const TfLiteCustomAllocation* allocation, int64_t flags) {
+  return interpreter->impl->SetCustomAllocationForTensor(tensor_index,
+                                                         *allocation, flags);
+}
+
 int32_t TfLiteInterpreterGetSignatureCount(
     const TfLiteInterpreter* interpreter) {
   return static_cast<int32_t>(interpreter->impl->signature_keys().size());
@@ -225,6 +225,29 @@ TFL_CAPI_EXPORT extern int32_t TfLiteInterpreterGetInputTensorIndex(
 TFL_CAPI_EXPORT extern int32_t TfLiteInterpreterGetOutputTensorIndex(
     const TfLiteInterpreter* interpreter, int32_t output_index);
 
+/// Assigns (or reassigns) a custom memory allocation for the given tensor, so
+/// that the interpreter reads or writes the tensor directly in the user-owned
+/// buffer instead of copying it with `TfLiteTensorCopyFromBuffer` or
+/// `TfLiteTensorCopyToBuffer`. `tensor_index` can be obtained with
+/// `TfLiteInterpreterGetInputTensorIndex` or
+/// `TfLiteInterpreterGetOutputTensorIndex`, and `flags` is a bitmask, see
+/// TfLiteCustomAllocationFlags. The runtime does NOT take ownership of the
+/// underlying memory.
+///
+/// Call `TfLiteInterpreterAllocateTensors` after the first assignment, so that
+/// the tensor is left out of the arena. A tensor can then be reassigned
+/// before each `TfLiteInterpreterInvoke`, e.g. to a new camera frame, without
+/// allocating tensors again.
+///
+/// See `tflite::Interpreter::SetCustomAllocationForTensor` for the
+/// requirements on the allocation.
+///
+/// WARNING: This is an experimental API and subject to change.
+TFL_CAPI_EXPORT extern TfLiteStatus
+TfLiteInterpreterSetCustomAllocationForTensor(
+    TfLiteInterpreter* interpreter, int tensor_index,
+    const TfLiteCustomAllocation* allocation, int64_t flags);
+
 /// --------------------------------------------------------------------------
 /// SignatureRunner APIs
 ///
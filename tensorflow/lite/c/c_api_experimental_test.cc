@@ -64,6 +64,62 @@ TEST(CApiExperimentalTest, Smoke) {
   TfLiteModelDelete(model);
 }
 
+TEST(CApiExperimentalTest, CustomAllocationForInputAndOutput) {
+  TfLiteModel* model =
+      TfLiteModelCreateFromFile("tensorflow/lite/testdata/add.bin");
+  ASSERT_NE(model, nullptr);
+  TfLiteInterpreter* interpreter = TfLiteInterpreterCreate(model, nullptr);
+  ASSERT_NE(interpreter, nullptr);
+
+  std::array<int, 1> input_dims = {2};
+  ASSERT_EQ(TfLiteInterpreterResizeInputTensor(
+                interpreter, 0, input_dims.data(), input_dims.size()),
+            kTfLiteOk);
+  const int input_index = TfLiteInterpreterGetInputTensorIndex(interpreter, 0);
+  const int output_index =
+      TfLiteInterpreterGetOutputTensorIndex(interpreter, 0);
+
+  alignas(64) float input[2] = {1.f, 3.f};
+  alignas(64) float output[2] = {0.f, 0.f};
+  TfLiteCustomAllocation input_alloc = {input, sizeof(input)};
+  TfLiteCustomAllocation output_alloc = {output, sizeof(output)};
+  ASSERT_EQ(TfLiteInterpreterSetCustomAllocationForTensor(
+                interpreter, input_index, &input_alloc,
+                kTfLiteCustomAllocationFlagsNone),
+            kTfLiteOk);
+  ASSERT_EQ(TfLiteInterpreterSetCustomAllocationForTensor(
+                interpreter, output_index, &output_alloc,
+                kTfLiteCustomAllocationFlagsNone),
+            kTfLiteOk);
+  ASSERT_EQ(TfLiteInterpreterAllocateTensors(interpreter), kTfLiteOk);
+  ASSERT_EQ(TfLiteInterpreterInvoke(interpreter), kTfLiteOk);
+  EXPECT_EQ(output[0], 3.f);
+  EXPECT_EQ(output[1], 9.f);
+
+  // Other buffers can be bound for the next invocation without allocating
+  // tensors again.
+  alignas(64) float next_input[2] = {2.f, 4.f};
+  alignas(64) float next_output[2] = {0.f, 0.f};
+  input_alloc = {next_input, sizeof(next_input)};
+  output_alloc = {next_output, sizeof(next_output)};
+  ASSERT_EQ(TfLiteInterpreterSetCustomAllocationForTensor(
+                interpreter, input_index, &input_alloc,
+                kTfLiteCustomAllocationFlagsNone),
+            kTfLiteOk);
+  ASSERT_EQ(TfLiteInterpreterSetCustomAllocationForTensor(
+                interpreter, output_index, &output_alloc,
+                kTfLiteCustomAllocationFlagsNone),
+            kTfLiteOk);
+  ASSERT_EQ(TfLiteInterpreterInvoke(interpreter), kTfLiteOk);
+  EXPECT_EQ(next_output[0], 6.f);
+  EXPECT_EQ(next_output[1], 12.f);
+  EXPECT_EQ(TfLiteTensorData(TfLiteInterpreterGetOutputTensor(interpreter, 0)),
+            next_output);
+
+  TfLiteInterpreterDelete(interpreter);
+  TfLiteModelDelete(model);
+}
+
 // Test using TfLiteInterpreterCreateWithSelectedOps.
 TEST(CApiExperimentalTest, SelectedBuiltins) {
   TfLiteModel* model =
@@ -22,12 +22,16 @@ limitations under the License.
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "ruy/thread_pool.h"  // from @ruy
+
 #include "tensorflow/lite/allocation.h"
 #include "tensorflow/lite/builtin_ops.h"
 #include "tensorflow/lite/c/c_api_types.h"
@@ -39,6 +43,7 @@ limitations under the License.
 #include "tensorflow/lite/core/api/tensor_utils.h"
 #include "tensorflow/lite/core/macros.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/memory_planner.h"
 #include "tensorflow/lite/minimal_logging.h"
@@ -126,6 +131,49 @@ bool HasDynamicTensor(const TfLiteContext& context,
                               dynamic_tensor_index);
 }
 
+// The CPU backend context that kernels running on this thread should use
+// instead of the interpreter's, while the thread runs a node of a stage. Each
+// concurrently running node needs its own, since the CPU backend contexts
+// aren't thread-safe.
+thread_local TfLiteExternalContext* inter_op_cpu_backend_context = nullptr;
+
+// Returns true if `node` may run concurrently with other nodes. That excludes
+// nodes whose kernels may not be thread-safe or may touch state shared with
+// other nodes: delegated nodes, custom ops, control flow, resources and
+// variable tensors.
+bool IsInterOpParallelizable(const TfLiteContext& context,
+                             const TfLiteNode& node,
+                             const TfLiteRegistration& registration) {
+  if (node.delegate != nullptr || registration.registration_external) {
+    return false;
+  }
+  switch (registration.builtin_code) {
+    case kTfLiteBuiltinAssignVariable:
+    case kTfLiteBuiltinCallOnce:
+    case kTfLiteBuiltinCustom:
+    case kTfLiteBuiltinDelegate:
+    case kTfLiteBuiltinHashtable:
+    case kTfLiteBuiltinHashtableFind:
+    case kTfLiteBuiltinHashtableImport:
+    case kTfLiteBuiltinHashtableSize:
+    case kTfLiteBuiltinIf:
+    case kTfLiteBuiltinReadVariable:
+    case kTfLiteBuiltinVarHandle:
+    case kTfLiteBuiltinWhile:
+      return false;
+    default:
+      break;
+  }
+  for (const TfLiteIntArray* tensors : {node.inputs, node.outputs}) {
+    for (int i : TfLiteIntArrayView(tensors)) {
+      if (i != kTfLiteOptionalTensor && context.tensors[i].is_variable) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 // Gets the legacy TfLiteQuantizationParams from the current TfLiteQuantization.
 TfLiteQuantizationParams GetLegacyQuantization(
     const TfLiteQuantization& quantization) {
@@ -187,6 +235,63 @@ TfLiteStatus VerifyCustomAllocationForTensor(
 
 }  // namespace
 
+// Runs the nodes of a stage on a thread pool.
+class InterOpExecutor {
+ public:
+  // Runs every function of `invokes` on its own thread with its own CPU
+  // backend context, limited to `threads_per_node` threads, and returns their
+  // statuses.
+  std::vector<TfLiteStatus> Run(
+      const std::vector<std::function<TfLiteStatus()>>& invokes,
+      int threads_per_node) {
+    while (cpu_backend_contexts_.size() < invokes.size()) {
+      cpu_backend_contexts_.push_back(
+          std::make_unique<ExternalCpuBackendContext>());
+    }
+    std::vector<Task> tasks(invokes.size());
+    for (size_t i = 0; i < invokes.size(); ++i) {
+      tasks[i].invoke = &invokes[i];
+      tasks[i].cpu_backend_context = cpu_backend_contexts_[i].get();
+      tasks[i].threads_per_node = threads_per_node;
+    }
+    thread_pool_.Execute(tasks.size(), tasks.data());
+    std::vector<TfLiteStatus> statuses;
+    statuses.reserve(tasks.size());
+    for (const Task& task : tasks) {
+      statuses.push_back(task.status);
+    }
+    return statuses;
+  }
+
+ private:
+  struct Task : ruy::Task {
+    void Run() override {
+      LimitThreads();
+      inter_op_cpu_backend_context = cpu_backend_context;
+      status = (*invoke)();
+      inter_op_cpu_backend_context = nullptr;
+      // The backend context is created by the first kernel that uses it.
+      LimitThreads();
+    }
+
+    void LimitThreads() {
+      if (cpu_backend_context->internal_backend_context() != nullptr) {
+        cpu_backend_context->internal_backend_context()->SetMaxNumThreads(
+            threads_per_node);
+      }
+    }
+
+    const std::function<TfLiteStatus()>* invoke = nullptr;
+    ExternalCpuBackendContext* cpu_backend_context = nullptr;
+    int threads_per_node = 1;
+    TfLiteStatus status = kTfLiteOk;
+  };
+
+  ruy::ThreadPool thread_pool_;
+  // One per node of the largest stage run so far.
+  std::vector<std::unique_ptr<ExternalCpuBackendContext>> cpu_backend_contexts_;
+};
+
 // A trivial implementation of GraphInfo around the Interpreter.
 // NOTE: this interpreter info represents the subset of the
 // graph that is executed according to execution plan. Thus,
@@ -277,6 +382,9 @@ Subgraph::~Subgraph() {
     }
     TfLiteTensorFree(tensor);
   }
+  for (auto& bytes_and_buffer : dynamic_buffer_pool_) {
+    free(bytes_and_buffer.second.data);
+  }
 }
 
 void Subgraph::CleanupNode(int node_index) {
@@ -477,6 +585,10 @@ TfLiteStatus Subgraph::ReplaceNodeSubsetsWithDelegateKernels(
 
 TfLiteExternalContext* Subgraph::GetExternalContext(
     TfLiteExternalContextType type) {
+  if (type == kTfLiteCpuBackendContext &&
+      inter_op_cpu_backend_context != nullptr) {
+    return inter_op_cpu_backend_context;
+  }
   if (static_cast<int>(type) >= 0 && type < kTfLiteMaxExternalContexts) {
     return external_contexts_[type];
   }
@@ -1040,7 +1152,7 @@ TfLiteStatus Subgraph::MayAllocateOpOutput(TfLiteNode* node) {
       TfLiteTensor* tensor = &context_.tensors[tensor_index];
       if (tensor->data.raw == nullptr &&
           tensor->allocation_type == kTfLiteDynamic) {
-        TfLiteTensorRealloc(tensor->bytes, tensor);
+        AllocateDynamicTensorData(tensor, tensor->bytes);
       }
     }
   }
@@ -1093,7 +1205,7 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
                                            ShouldPreserveAllTensors(),
                                            kDefaultTensorAlignment));
 #endif
-    memory_planner_->PlanAllocations();
+    TF_LITE_ENSURE_STATUS(PlanAllocations());
   }
 
   // Prepare original execution plan if any applied delegate wants it.
@@ -1211,7 +1323,11 @@ TfLiteStatus Subgraph::Invoke() {
   }
   TFLITE_SCOPED_TAGGED_DEFAULT_PROFILE(profiler_.get(), "Invoke");
 
-  // Invocations are always done in node order.
+  ++num_invocations_;
+  TrimDynamicBufferPool();
+
+  // Invocations are always done in node order, except that the nodes of a
+  // stage may run concurrently.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
   // called.
@@ -1222,6 +1338,15 @@ TfLiteStatus Subgraph::Invoke() {
       TF_LITE_ENSURE(&context_, next_execution_plan_index_to_prepare_ >=
                                     execution_plan_index);
     }
+    if (stage_ends_.size() == execution_plan_.size() &&
+        stage_ends_[execution_plan_index] > execution_plan_index &&
+        CanInvokeStageConcurrently(execution_plan_index,
+                                   stage_ends_[execution_plan_index])) {
+      const int stage_end = stage_ends_[execution_plan_index];
+      TF_LITE_ENSURE_STATUS(InvokeStage(execution_plan_index, stage_end));
+      execution_plan_index = stage_end;
+      continue;
+    }
     int node_index = execution_plan_[execution_plan_index];
     TfLiteNode& node = nodes_and_registration_[node_index].first;
     const TfLiteRegistration& registration =
@@ -1231,37 +1356,7 @@ TfLiteStatus Subgraph::Invoke() {
     if (profiler_) op_name = GetTFLiteOpName(registration);
     TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(profiler_.get(), op_name, node_index);
 
-    for (int i = 0; i < node.inputs->size; ++i) {
-      int tensor_index = node.inputs->data[i];
-      if (tensor_index == kTfLiteOptionalTensor) {
-        continue;
-      }
-      TfLiteTensor* tensor = &tensors_[tensor_index];
-      if (tensor->delegate && tensor->delegate != node.delegate &&
-          tensor->data_is_stale) {
-        TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
-      }
-      if (tensor->data.raw == nullptr && tensor->bytes > 0) {
-        if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
-            tensor->dims->size != 1) {
-          // In general, having a tensor here with no buffer will be an error.
-          // However, for the reshape operator, the second input tensor is
-          // sometimes only used for the shape, not for the data. Thus, null
-          // buffer is ok in this situation.
-          // The situation where null buffer is not ok for reshape operator is
-          // only when there are 2 inputs given to the node and the one
-          // corresponding to the shape (i == 1) is a vector that contains all
-          // dimensions. See `GetOutputShape()` function in
-          // `tensorflow/lite/kernels/reshape.cc`
-          continue;
-        } else {
-          // In all other cases, we need to return an error as otherwise we will
-          // trigger a null pointer dereference (likely).
-          ReportError("Input tensor %d lacks data", tensor_index);
-          return kTfLiteError;
-        }
-      }
-    }
+    TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(node, registration));
     // Allocate dynamic tensors which memory is required to be allocated
     // before executing the node.
     MayAllocateOpOutput(&node);
@@ -1305,6 +1400,203 @@ TfLiteStatus Subgraph::Invoke() {
   return status;
 }
 
+TfLiteStatus Subgraph::EnsureNodeInputsAreReadable(
+    const TfLiteNode& node, const TfLiteRegistration& registration) {
+  for (int i = 0; i < node.inputs->size; ++i) {
+    int tensor_index = node.inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      continue;
+    }
+    TfLiteTensor* tensor = &tensors_[tensor_index];
+    if (tensor->delegate && tensor->delegate != node.delegate &&
+        tensor->data_is_stale) {
+      TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
+    }
+    if (tensor->data.raw == nullptr && tensor->bytes > 0) {
+      if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
+          tensor->dims->size != 1) {
+        // In general, having a tensor here with no buffer will be an error.
+        // However, for the reshape operator, the second input tensor is
+        // sometimes only used for the shape, not for the data. Thus, null
+        // buffer is ok in this situation.
+        // The situation where null buffer is not ok for reshape operator is
+        // only when there are 2 inputs given to the node and the one
+        // corresponding to the shape (i == 1) is a vector that contains all
+        // dimensions. See `GetOutputShape()` function in
+        // `tensorflow/lite/kernels/reshape.cc`
+        continue;
+      } else {
+        // In all other cases, we need to return an error as otherwise we will
+        // trigger a null pointer dereference (likely).
+        ReportError("Input tensor %d lacks data", tensor_index);
+        return kTfLiteError;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::PlanAllocations() {
+  stage_ends_.clear();
+  const int max_stage_size = options_ ? options_->GetInterOpParallelism() : 1;
+  if (max_stage_size > 1) {
+    PlanInterOpStages(max_stage_size);
+  }
+  memory_planner_->SetStageEnds(stage_ends_);
+  return memory_planner_->PlanAllocations();
+}
+
+void Subgraph::PlanInterOpStages(int max_stage_size) {
+  std::vector<int> new_plan;
+  new_plan.reserve(execution_plan_.size());
+  stage_ends_.reserve(execution_plan_.size());
+
+  auto add_stage = [&](std::vector<int>::const_iterator first,
+                       std::vector<int>::const_iterator last) {
+    new_plan.insert(new_plan.end(), first, last);
+    stage_ends_.insert(stage_ends_.end(), last - first,
+                       static_cast<int>(new_plan.size()) - 1);
+  };
+
+  // Reorders a run of parallelizable nodes by their depth within the run, so
+  // that nodes of the same depth, which don't depend on each other, are
+  // adjacent and form stages.
+  std::vector<int> run;
+  auto flush_run = [&]() {
+    // Depth of the node that last wrote or read each tensor.
+    std::unordered_map<int, int> writer_depth;
+    std::unordered_map<int, int> reader_depth;
+    std::vector<std::pair<int, int>> depth_and_node;
+    for (int node_index : run) {
+      const TfLiteNode& node = nodes_and_registration_[node_index].first;
+      int depth = 0;
+      for (int i : TfLiteIntArrayView(node.inputs)) {
+        auto it = writer_depth.find(i);
+        if (it != writer_depth.end()) depth = std::max(depth, it->second + 1);
+      }
+      for (int i : TfLiteIntArrayView(node.outputs)) {
+        auto it = writer_depth.find(i);
+        if (it != writer_depth.end()) depth = std::max(depth, it->second + 1);
+        it = reader_depth.find(i);
+        if (it != reader_depth.end()) depth = std::max(depth, it->second + 1);
+      }
+      for (int i : TfLiteIntArrayView(node.inputs)) {
+        reader_depth[i] = std::max(reader_depth[i], depth);
+      }
+      for (int i : TfLiteIntArrayView(node.outputs)) {
+        writer_depth[i] = depth;
+      }
+      depth_and_node.emplace_back(depth, node_index);
+    }
+    std::stable_sort(
+        depth_and_node.begin(), depth_and_node.end(),
+        [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+          return a.first < b.first;
+        });
+    std::vector<int> sorted_run;
+    sorted_run.reserve(run.size());
+    for (const auto& entry : depth_and_node) {
+      sorted_run.push_back(entry.second);
+    }
+    for (size_t first = 0; first < sorted_run.size();) {
+      size_t last = first + 1;
+      while (last < sorted_run.size() &&
+             last - first < static_cast<size_t>(max_stage_size) &&
+             depth_and_node[last].first == depth_and_node[first].first) {
+        ++last;
+      }
+      add_stage(sorted_run.begin() + first, sorted_run.begin() + last);
+      first = last;
+    }
+    run.clear();
+  };
+
+  for (int node_index : execution_plan_) {
+    const auto& node_and_registration = nodes_and_registration_[node_index];
+    if (IsInterOpParallelizable(context_, node_and_registration.first,
+                                node_and_registration.second)) {
+      run.push_back(node_index);
+      continue;
+    }
+    // Nodes that can't run concurrently also keep their position relative to
+    // all the others.
+    flush_run();
+    std::vector<int> alone = {node_index};
+    add_stage(alone.begin(), alone.end());
+  }
+  flush_run();
+  execution_plan_ = std::move(new_plan);
+}
+
+bool Subgraph::CanInvokeStageConcurrently(int first_execution_plan_index,
+                                          int last_execution_plan_index) {
+  // Profilers expect the events of an invocation to come from one thread.
+  if (profiler_ != nullptr) return false;
+  if (next_execution_plan_index_to_prepare_ <= last_execution_plan_index) {
+    return false;
+  }
+  // Resizing dynamic tensors changes state shared between the nodes.
+  for (int i = first_execution_plan_index; i <= last_execution_plan_index;
+       ++i) {
+    const TfLiteNode& node = nodes_and_registration_[execution_plan_[i]].first;
+    if (HasDynamicTensor(context_, node.outputs, nullptr) ||
+        HasDynamicTensor(context_, node.temporaries, nullptr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TfLiteStatus Subgraph::InvokeStage(int first_execution_plan_index,
+                                   int last_execution_plan_index) {
+  std::vector<std::function<TfLiteStatus()>> invokes;
+  for (int i = first_execution_plan_index; i <= last_execution_plan_index;
+       ++i) {
+    const int node_index = execution_plan_[i];
+    TfLiteNode& node = nodes_and_registration_[node_index].first;
+    const TfLiteRegistration& registration =
+        nodes_and_registration_[node_index].second;
+    TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(node, registration));
+    MayAllocateOpOutput(&node);
+    invokes.push_back([this, &node, &registration]() {
+      return OpInvoke(registration, &node);
+    });
+  }
+
+  if (check_cancelled_func_ != nullptr &&
+      check_cancelled_func_(cancellation_data_)) {
+    ReportError("Client requested cancel during Invoke()");
+    return kTfLiteError;
+  }
+
+  EnsureTensorsVectorCapacity();
+  if (inter_op_executor_ == nullptr) {
+    inter_op_executor_ = std::make_unique<InterOpExecutor>();
+  }
+  const int threads_per_node = std::max<int>(
+      1, context_.recommended_num_threads / static_cast<int>(invokes.size()));
+  const std::vector<TfLiteStatus> statuses =
+      inter_op_executor_->Run(invokes, threads_per_node);
+
+  for (int i = first_execution_plan_index; i <= last_execution_plan_index;
+       ++i) {
+    const int node_index = execution_plan_[i];
+    const TfLiteNode& node = nodes_and_registration_[node_index].first;
+    if (statuses[i - first_execution_plan_index] != kTfLiteOk) {
+      return ReportOpError(&context_, node,
+                           nodes_and_registration_[node_index].second,
+                           node_index, "failed to invoke");
+    }
+  }
+  for (int i = first_execution_plan_index; i <= last_execution_plan_index;
+       ++i) {
+    const int node_index = execution_plan_[i];
+    MaybeReleaseDynamicTensors(nodes_and_registration_[node_index].first,
+                               node_index);
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus Subgraph::ResizeTensor(TfLiteContext* context,
                                     TfLiteTensor* tensor,
                                     TfLiteIntArray* new_size) {
@@ -1536,7 +1828,12 @@ TfLiteStatus Subgraph::ResizeTensorImpl(TfLiteTensor* tensor,
       }
 
       // Realloc space for heap-allocated tensors.
-      TfLiteTensorRealloc(bytesRequired, tensor);
+      if (tensor->allocation_type == kTfLiteDynamic &&
+          tensor->data.raw == nullptr) {
+        AllocateDynamicTensorData(tensor, bytesRequired);
+      } else {
+        TfLiteTensorRealloc(bytesRequired, tensor);
+      }
       tensor->bytes = bytesRequired;
     }
     if (tensor->dims) TfLiteIntArrayFree(tensor->dims);
@@ -1733,7 +2030,7 @@ void Subgraph::EnsureTensorsVectorCapacity() {
 TfLiteStatus Subgraph::EnsureMemoryAllocations() {
   if (memory_planner_) {
     state_ = kStateUninvokable;
-    TF_LITE_ENSURE_OK(&context_, memory_planner_->PlanAllocations());
+    TF_LITE_ENSURE_OK(&context_, PlanAllocations());
   }
   TF_LITE_ENSURE_OK(&context_, AllocateTensors());
   TF_LITE_ENSURE_EQ(&context_, state_, kStateInvokable);
@@ -1867,6 +2164,18 @@ TfLiteStatus Subgraph::SetCustomAllocationForTensor(
     const intptr_t data_ptr_value = reinterpret_cast<intptr_t>(allocation.data);
     TF_LITE_ENSURE(context(), data_ptr_value % kDefaultTensorAlignment == 0);
   }
+  // Once tensors are allocated, the next Invoke() uses the allocation without
+  // preparing the ops again, so an allocation that is too small must go
+  // through AllocateTensors() first, which reports it.
+  if (tensor->bytes > allocation.bytes) {
+    if (state_ == kStateInvokableAndImmutable) {
+      TF_LITE_KERNEL_LOG(context(),
+                         "Custom allocation is too small for tensor idx: %d",
+                         tensor_index);
+      return kTfLiteError;
+    }
+    if (state_ == kStateInvokable) state_ = kStateUninvokable;
+  }
 
   const auto iter_and_success =
       custom_allocations_.insert({tensor_index, allocation});
@@ -1950,7 +2259,7 @@ void Subgraph::MaybeReleaseDynamicTensors(const TfLiteNode& node,
     auto it = tensor_to_last_op_index_.find(input_tensor_index);
     if (it != tensor_to_last_op_index_.end() && it->second == node_index) {
       if (input_tensor->data.raw) {
-        TfLiteTensorDataFree(input_tensor);
+        ReleaseDynamicTensorData(input_tensor);
       }
     }
   }
@@ -1970,10 +2279,42 @@ void Subgraph::MaybeReleaseDynamicTensors(const TfLiteNode& node,
     auto it = tensor_to_last_op_index_.find(output_tensor_index);
     if (it != tensor_to_last_op_index_.end() && it->second == node_index) {
       if (output_tensor->data.raw) {
-        TfLiteTensorDataFree(output_tensor);
+        ReleaseDynamicTensorData(output_tensor);
       }
     }
   }
 }
 
+void Subgraph::AllocateDynamicTensorData(TfLiteTensor* tensor, size_t bytes) {
+  // Take the smallest released buffer that fits, unless it would waste more
+  // than half of itself.
+  auto it = dynamic_buffer_pool_.lower_bound(bytes);
+  if (bytes > 0 && it != dynamic_buffer_pool_.end() && it->first / 2 < bytes) {
+    tensor->data.raw = it->second.data;
+    tensor->bytes = bytes;
+    dynamic_buffer_pool_.erase(it);
+    return;
+  }
+  TfLiteTensorRealloc(bytes, tensor);
+}
+
+void Subgraph::ReleaseDynamicTensorData(TfLiteTensor* tensor) {
+  // The buffer holds at least `bytes`, it may have been allocated larger.
+  dynamic_buffer_pool_.emplace(
+      tensor->bytes, PooledDynamicBuffer{tensor->data.raw, num_invocations_});
+  tensor->data.raw = nullptr;
+}
+
+void Subgraph::TrimDynamicBufferPool() {
+  for (auto it = dynamic_buffer_pool_.begin();
+       it != dynamic_buffer_pool_.end();) {
+    if (it->second.invocation + 1 < num_invocations_) {
+      free(it->second.data);
+      it = dynamic_buffer_pool_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 }  // namespace tflite
@@ -42,6 +42,7 @@ limitations under the License.
 namespace tflite {
 
 class SingleOpModel;  // Class for friend declarations.
+class InterOpExecutor;
 
 namespace delegates {
 namespace test_utils {
@@ -337,6 +338,10 @@ class Subgraph {
   // NOTE: User needs to call AllocateTensors() after this.
   // Invalid/insufficient buffers will cause an error during AllocateTensors or
   // Invoke (in case of dynamic shapes in the graph).
+  // Once tensors are allocated, a tensor can be reassigned before each
+  // Invoke() without calling AllocateTensors() again. If a reassigned
+  // allocation is too small, AllocateTensors() has to be called again, and
+  // reports the error.
   //
   // Parameters should satisfy the following conditions:
   // 1. tensor->allocation_type == kTfLiteArenaRw or kTfLiteArenaRwPersistent
@@ -716,6 +721,40 @@ class Subgraph {
   // tensors if configured.
   void MaybeReleaseDynamicTensors(const TfLiteNode& node, size_t node_index);
 
+  // Allocates `bytes` of heap memory for the kTfLiteDynamic `tensor`, which
+  // has no data, reusing a released buffer if one is close enough in size.
+  void AllocateDynamicTensorData(TfLiteTensor* tensor, size_t bytes);
+
+  // Releases the data of the kTfLiteDynamic `tensor` to
+  // `dynamic_buffer_pool_`, so that a later allocation can reuse it.
+  void ReleaseDynamicTensorData(TfLiteTensor* tensor);
+
+  // Frees the buffers of `dynamic_buffer_pool_` that weren't reused since the
+  // invocation before the current one.
+  void TrimDynamicBufferPool();
+
+  // Returns an error if an input of `node` can't be read by it.
+  TfLiteStatus EnsureNodeInputsAreReadable(
+      const TfLiteNode& node, const TfLiteRegistration& registration);
+
+  // Plans allocations with `memory_planner_`. If inter-op parallelism is
+  // enabled, first reorders `execution_plan_` so that independent nodes are
+  // adjacent and splits it into stages of nodes that may run concurrently,
+  // which the memory planner has to keep apart.
+  TfLiteStatus PlanAllocations();
+
+  // Computes `stage_ends_` for `execution_plan_`. See PlanAllocations().
+  void PlanInterOpStages(int max_stage_size);
+
+  // Returns true if the stage [first_execution_plan_index,
+  // last_execution_plan_index] can run concurrently in this invocation.
+  bool CanInvokeStageConcurrently(int first_execution_plan_index,
+                                  int last_execution_plan_index);
+
+  // Invokes the nodes of a stage concurrently.
+  TfLiteStatus InvokeStage(int first_execution_plan_index,
+                           int last_execution_plan_index);
+
   // The state of the Interpreter.
   enum State {
     // The interpreter isn't ready to be invoked.
@@ -874,6 +913,28 @@ class Subgraph {
 
   // `InterpreterOptions` object which is being used and owned by Interpreter.
   InterpreterOptions* options_;
+
+  // For each index of the execution plan, the last index of its stage of
+  // nodes that may run concurrently. Empty if inter-op parallelism is off.
+  std::vector<int> stage_ends_;
+
+  // Runs the nodes of a stage. Created on first use.
+  std::unique_ptr<InterOpExecutor> inter_op_executor_;
+
+  // A heap buffer released by a dynamic tensor, and the invocation in which it
+  // was released.
+  struct PooledDynamicBuffer {
+    char* data;
+    uint64_t invocation;
+  };
+
+  // Buffers released by dynamic tensors, keyed by their size in bytes. Lets
+  // models that release their dynamic tensors after last use reuse the same
+  // buffers across invocations instead of going back to the heap allocator.
+  std::multimap<size_t, PooledDynamicBuffer> dynamic_buffer_pool_;
+
+  // The number of invocations started so far.
+  uint64_t num_invocations_ = 0;
 };
 
 }  // namespace tflite
@@ -23,6 +23,7 @@ limitations under the License.
 #include <cstring>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
 #include "tensorflow/lite/delegates/gpu/cl/cl_command_queue.h"
 #include "tensorflow/lite/delegates/gpu/cl/cl_errors.h"
@@ -986,6 +987,12 @@ class InferenceEnvironmentImpl : public InferenceEnvironment {
     return data;
   }
 
+  std::string GetDeviceFingerprint() const final {
+    const OpenClInfo& info = environment_.device().GetInfo().opencl_info;
+    return absl::StrCat(info.device_name, "|", info.vendor_name, "|",
+                        info.platform_version, "|", info.driver_version);
+  }
+
   const InferenceEnvironmentProperties& properties() const {
     return properties_;
   }
@@ -24,6 +24,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include "absl/types/span.h"
 #include "tensorflow/lite/delegates/gpu/api.h"
@@ -105,6 +106,11 @@ class InferenceEnvironment {
   // Returned data is valid only if used on the same device, otherwise it will
   // not be compatible and will be discarded.
   virtual std::vector<uint8_t> GetSerializedBinaryCache() const = 0;
+
+  // Returns a string identifying the device and driver used by this
+  // environment. Serialized models and binary caches can only be reused by
+  // environments that return the same fingerprint.
+  virtual std::string GetDeviceFingerprint() const = 0;
 };
 
 struct InferenceEnvironmentOptions {
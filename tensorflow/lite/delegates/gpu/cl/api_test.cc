@@ -0,0 +1,45 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/gpu/cl/api.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+namespace tflite {
+namespace gpu {
+namespace cl {
+namespace {
+
+TEST(InferenceEnvironmentTest, DeviceFingerprintIsStableForTheSameDevice) {
+  std::unique_ptr<InferenceEnvironment> environment;
+  ASSERT_TRUE(NewInferenceEnvironment(InferenceEnvironmentOptions(),
+                                      &environment, nullptr)
+                  .ok());
+  std::unique_ptr<InferenceEnvironment> other_environment;
+  ASSERT_TRUE(NewInferenceEnvironment(InferenceEnvironmentOptions(),
+                                      &other_environment, nullptr)
+                  .ok());
+
+  EXPECT_FALSE(environment->GetDeviceFingerprint().empty());
+  EXPECT_EQ(environment->GetDeviceFingerprint(),
+            other_environment->GetDeviceFingerprint());
+}
+
+}  // namespace
+}  // namespace cl
+}  // namespace gpu
+}  // namespace tflite
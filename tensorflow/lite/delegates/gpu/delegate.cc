@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
@@ -36,6 +37,7 @@ limitations under the License.
 #include "tensorflow/lite/delegates/gpu/common/model_transformer.h"
 #include "tensorflow/lite/delegates/gpu/common/quantization_util.h"
 #include "tensorflow/lite/delegates/gpu/common/status.h"
+#include "tensorflow/lite/delegates/gpu/serialized_data_key.h"
 #include "tensorflow/lite/delegates/serialization.h"
 #include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
@@ -52,8 +54,6 @@ namespace {
 using delegates::Serialization;
 using delegates::SerializationParams;
 
-constexpr char kSerializedDataPrefix[] = "gpuv2_data_";
-
 InferencePriority ToPriority(int32_t priority) {
   switch (priority) {
     case TFLITE_GPU_INFERENCE_PRIORITY_AUTO:
@@ -369,16 +369,19 @@ class DelegateKernel {
       RETURN_IF_ERROR(cl_environment_->NewInferenceBuilder(
           options, std::move(*graph), builder));
     } else {
+      // Serialized data is specific to the device, so the environment has to
+      // be created before it is looked up.
+      RETURN_IF_ERROR(cl::NewInferenceEnvironment(env_options, &cl_environment_,
+                                                  &properties));
       // If serialization data is found, initialize CL from it & return early.
+      // Otherwise (e.g. the data is missing or the driver changed), compile
+      // and tune the model, and overwrite the stale data.
       if (MaybeInitializeSerializedOpenCL(context, delegate_params, builder,
-                                          &options, &env_options, &properties,
-                                          serialization)
+                                          options, serialization)
               .ok()) {
         return absl::OkStatus();
       }
 
-      RETURN_IF_ERROR(cl::NewInferenceEnvironment(env_options, &cl_environment_,
-                                                  &properties));
       *graph_is_destroyed = true;
       std::vector<uint8_t> serialized_model;
       RETURN_IF_ERROR(cl_environment_->BuildSerializedModel(
@@ -386,7 +389,7 @@ class DelegateKernel {
       RETURN_IF_ERROR(
           cl_environment_->NewInferenceBuilder(serialized_model, builder));
 
-      RETURN_IF_ERROR(SaveSerializedOpenCL(context, delegate_params, &options,
+      RETURN_IF_ERROR(SaveSerializedOpenCL(context, delegate_params, options,
                                            serialization, serialized_model));
     }
 
@@ -395,20 +398,16 @@ class DelegateKernel {
     return absl::OkStatus();
   }
 
-  // Returns Ok only if serialized data is successsfully found.
+  // Returns Ok only if serialized data is successsfully found and loaded into
+  // the already created cl_environment_.
   absl::Status MaybeInitializeSerializedOpenCL(
       TfLiteContext* context, const TfLiteDelegateParams* delegate_params,
-      std::unique_ptr<InferenceBuilder>* builder, cl::InferenceOptions* options,
-      cl::InferenceEnvironmentOptions* env_options,
-      cl::InferenceEnvironmentProperties* properties,
-      Serialization* serialization) {
+      std::unique_ptr<InferenceBuilder>* builder,
+      const cl::InferenceOptions& options, Serialization* serialization) {
     if (!serialization) return absl::InvalidArgumentError("No serialization");
-    // We use a fingerprint of the options to ensure compatibility.
-    std::string options_fingerprint =
-        delegates::StrFingerprint(options, sizeof(cl::InferenceOptions));
     auto data_key = serialization->GetEntryForKernel(
-        std::string(kSerializedDataPrefix) + options_fingerprint, context,
-        delegate_params);
+        SerializedDataKey(options, cl_environment_->GetDeviceFingerprint()),
+        context, delegate_params);
 
     std::string model_data;
     auto model_data_status = data_key.GetData(context, &model_data);
@@ -416,8 +415,6 @@ class DelegateKernel {
       absl::Span<const uint8_t> model_span = absl::Span<const uint8_t>{
           reinterpret_cast<const uint8_t*>(model_data.data()),
           model_data.size()};
-      RETURN_IF_ERROR(cl::NewInferenceEnvironment(
-          *env_options, &cl_environment_, properties));
       RETURN_IF_ERROR(
           cl_environment_->NewInferenceBuilder(model_span, builder));
       TFLITE_LOG_PROD_ONCE(
@@ -432,17 +429,13 @@ class DelegateKernel {
   // Returns Ok only if serialization happens successfully.
   absl::Status SaveSerializedOpenCL(
       TfLiteContext* context, const TfLiteDelegateParams* delegate_params,
-      cl::InferenceOptions* options, Serialization* serialization,
+      const cl::InferenceOptions& options, Serialization* serialization,
       const std::vector<uint8_t>& serialized_model) {
     if (!serialization) return absl::InvalidArgumentError("No serialization");
-    // We use a fingerprint of the options to ensure compatibility.
-    std::string options_fingerprint =
-        delegates::StrFingerprint(options, sizeof(cl::InferenceOptions));
-
     // Save data.
     auto data_key = serialization->GetEntryForKernel(
-        std::string(kSerializedDataPrefix) + options_fingerprint, context,
-        delegate_params);
+        SerializedDataKey(options, cl_environment_->GetDeviceFingerprint()),
+        context, delegate_params);
     auto save_status = data_key.SetData(
         context, reinterpret_cast<const char*>(serialized_model.data()),
         serialized_model.size());
@@ -61,6 +61,10 @@ enum TfLiteGpuExperimentalFlags {
   // Delegate performs serialization the first time it is applied with a new
   // model or inference params. Later initializations are fast.
   // ModifyGraphWithDelegate will fail if data cannot be serialized.
+  // Serialized data holds the compiled kernels and tuned work group sizes, and
+  // is keyed by the model token, the inference options, the GPU device and
+  // driver, and the TFLite version, so stale data is regenerated
+  // automatically.
   //
   // NOTE: User also needs to set serialization_dir & model_token in
   // TfLiteGpuDelegateOptionsV2.
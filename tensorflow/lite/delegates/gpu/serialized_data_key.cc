@@ -0,0 +1,48 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/gpu/serialized_data_key.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/lite/delegates/serialization.h"
+#include "tensorflow/lite/version.h"
+
+namespace tflite {
+namespace gpu {
+namespace {
+
+constexpr char kSerializedDataPrefix[] = "gpuv2_data_";
+// Bumped whenever the serialized data written by the delegate changes in a way
+// that the InferenceContext flatbuffer verification would not detect.
+constexpr int kSerializedDataVersion = 1;
+
+}  // namespace
+
+std::string SerializedDataKey(const InferenceOptions& options,
+                              const std::string& device_fingerprint) {
+  const std::string options_fingerprint =
+      delegates::StrFingerprint(&options, sizeof(InferenceOptions));
+  const std::string environment_key =
+      absl::StrCat(TFLITE_VERSION_STRING, "|", kSerializedDataVersion, "|",
+                   device_fingerprint);
+  return absl::StrCat(kSerializedDataPrefix, options_fingerprint, "_",
+                      delegates::StrFingerprint(environment_key.data(),
+                                                environment_key.size()));
+}
+
+}  // namespace gpu
+}  // namespace tflite
@@ -0,0 +1,37 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_DELEGATES_GPU_SERIALIZED_DATA_KEY_H_
+#define TENSORFLOW_LITE_DELEGATES_GPU_SERIALIZED_DATA_KEY_H_
+
+#include <string>
+
+#include "tensorflow/lite/delegates/gpu/api.h"
+
+namespace tflite {
+namespace gpu {
+
+// Returns the custom key of the serialized data that the GPU delegate builds
+// with `options` in an environment whose device fingerprint is
+// `device_fingerprint`. Serialized data is specific to the TFLite version, the
+// device and its driver, and the inference options, so they are all part of
+// the key.
+std::string SerializedDataKey(const InferenceOptions& options,
+                              const std::string& device_fingerprint);
+
+}  // namespace gpu
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_GPU_SERIALIZED_DATA_KEY_H_
@@ -0,0 +1,96 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/gpu/serialized_data_key.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/gpu/api.h"
+#include "tensorflow/lite/delegates/serialization.h"
+
+namespace tflite {
+namespace gpu {
+namespace {
+
+void EmptyReportError(TfLiteContext* context, const char* format, ...) {}
+
+TEST(SerializedDataKeyTest, DependsOnDeviceAndOptions) {
+  InferenceOptions options;
+  const std::string key = SerializedDataKey(options, "device_a");
+  EXPECT_EQ(key, SerializedDataKey(options, "device_a"));
+
+  // A different device or driver changes the key.
+  EXPECT_NE(key, SerializedDataKey(options, "device_b"));
+  EXPECT_NE(key, SerializedDataKey(options, ""));
+
+  // Different inference options change the key.
+  InferenceOptions other_options;
+  other_options.priority1 = InferencePriority::MIN_LATENCY;
+  EXPECT_NE(key, SerializedDataKey(other_options, "device_a"));
+  other_options = InferenceOptions();
+  other_options.usage = InferenceUsage::FAST_SINGLE_ANSWER;
+  EXPECT_NE(key, SerializedDataKey(other_options, "device_a"));
+}
+
+TEST(SerializedDataKeyTest, DataIsNotReusedAcrossDevices) {
+  const std::string model_token = "mobilenet";
+  const std::string dir = ::testing::TempDir();
+  delegates::SerializationParams params = {model_token.c_str(), dir.c_str()};
+  delegates::Serialization serialization(params);
+
+  TfLiteTensor tensors[2] = {};
+  TfLiteContext context = {};
+  context.tensors_size = 2;
+  context.tensors = tensors;
+  context.ReportError = EmptyReportError;
+  TfLiteIntArray* nodes_to_replace = TfLiteIntArrayCreate(1);
+  nodes_to_replace->data[0] = 0;
+  TfLiteIntArray* input_tensors = TfLiteIntArrayCreate(1);
+  input_tensors->data[0] = 0;
+  TfLiteIntArray* output_tensors = TfLiteIntArrayCreate(1);
+  output_tensors->data[0] = 1;
+  TfLiteDelegateParams delegate_params = {};
+  delegate_params.nodes_to_replace = nodes_to_replace;
+  delegate_params.input_tensors = input_tensors;
+  delegate_params.output_tensors = output_tensors;
+
+  const InferenceOptions options;
+  const std::string data = "serialized model";
+  auto device_a_entry = serialization.GetEntryForKernel(
+      SerializedDataKey(options, "device_a"), &context, &delegate_params);
+  ASSERT_EQ(device_a_entry.SetData(&context, data.data(), data.size()),
+            kTfLiteOk);
+
+  std::string read_data;
+  auto device_b_entry = serialization.GetEntryForKernel(
+      SerializedDataKey(options, "device_b"), &context, &delegate_params);
+  EXPECT_EQ(device_b_entry.GetData(&context, &read_data),
+            kTfLiteDelegateDataNotFound);
+
+  auto device_a_entry_again = serialization.GetEntryForKernel(
+      SerializedDataKey(options, "device_a"), &context, &delegate_params);
+  ASSERT_EQ(device_a_entry_again.GetData(&context, &read_data), kTfLiteOk);
+  EXPECT_EQ(read_data, data);
+
+  TfLiteIntArrayFree(nodes_to_replace);
+  TfLiteIntArrayFree(input_tensors);
+  TfLiteIntArrayFree(output_tensors);
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace tflite
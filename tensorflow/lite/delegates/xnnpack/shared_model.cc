@@ -0,0 +1,87 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/xnnpack/shared_model.h"
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/interpreter_builder.h"
+
+namespace tflite {
+namespace xnnpack {
+
+SharedModel::ExecutionContext::ExecutionContext()
+    : delegate_(nullptr, TfLiteXNNPackDelegateDelete) {}
+
+SharedModel::SharedModel(const FlatBufferModel& model,
+                         const OpResolver& op_resolver,
+                         const TfLiteXNNPackDelegateOptions& delegate_options)
+    : model_(model),
+      op_resolver_(op_resolver),
+      delegate_options_(delegate_options),
+      weights_cache_(TfLiteXNNPackDelegateWeightsCacheCreate(),
+                     TfLiteXNNPackDelegateWeightsCacheDelete) {
+  delegate_options_.weights_cache = weights_cache_.get();
+}
+
+TfLiteStatus SharedModel::CreateExecutionContext(
+    std::unique_ptr<ExecutionContext>* context) {
+  std::unique_ptr<ExecutionContext> new_context(new ExecutionContext());
+  if (InterpreterBuilder(model_, op_resolver_)(&new_context->interpreter_) !=
+      kTfLiteOk) {
+    return kTfLiteError;
+  }
+  new_context->delegate_.reset(TfLiteXNNPackDelegateCreate(&delegate_options_));
+  if (new_context->delegate_ == nullptr) {
+    TF_LITE_REPORT_ERROR(model_.error_reporter(),
+                         "Failed to create the XNNPACK delegate.");
+    return kTfLiteError;
+  }
+
+  {
+    // Before finalization the weights cache may only be filled by one
+    // delegate at a time. Afterwards it only serves lookups, which may run
+    // concurrently.
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (weights_cache_finalized_) {
+      lock.unlock();
+    }
+    if (new_context->interpreter_->ModifyGraphWithDelegate(
+            new_context->delegate_.get()) != kTfLiteOk) {
+      return kTfLiteError;
+    }
+    if (lock.owns_lock()) {
+      if (!TfLiteXNNPackDelegateWeightsCacheFinalizeSoft(
+              weights_cache_.get())) {
+        TF_LITE_REPORT_ERROR(model_.error_reporter(),
+                             "Failed to finalize the XNNPACK weights cache.");
+        return kTfLiteError;
+      }
+      weights_cache_finalized_ = true;
+    }
+  }
+
+  if (new_context->interpreter_->AllocateTensors() != kTfLiteOk) {
+    return kTfLiteError;
+  }
+  *context = std::move(new_context);
+  return kTfLiteOk;
+}
+
+}  // namespace xnnpack
+}  // namespace tflite
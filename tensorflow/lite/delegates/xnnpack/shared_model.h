@@ -0,0 +1,99 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_DELEGATES_XNNPACK_SHARED_MODEL_H_
+#define TENSORFLOW_LITE_DELEGATES_XNNPACK_SHARED_MODEL_H_
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace tflite {
+namespace xnnpack {
+
+// A model served by many interpreters at once, e.g. one per request thread.
+//
+// Every interpreter created from a SharedModel gets its own XNNPACK delegate,
+// tensors and arena, but all the delegates share one weights cache, so the
+// packed weights are created by the first interpreter and reused by the
+// others instead of being packed again for each one.
+//
+// Example:
+//
+//   ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+//   SharedModel shared_model(*model, resolver,
+//                            TfLiteXNNPackDelegateOptionsDefault());
+//   // On each serving thread:
+//   std::unique_ptr<SharedModel::ExecutionContext> context;
+//   if (shared_model.CreateExecutionContext(&context) != kTfLiteOk) ...
+//   context->interpreter()->Invoke();
+class SharedModel {
+ public:
+  // An interpreter created from a SharedModel, with the XNNPACK delegate
+  // applied and its tensors allocated. A context may only be used by one
+  // thread at a time, but different contexts may be used concurrently.
+  class ExecutionContext {
+   public:
+    Interpreter* interpreter() { return interpreter_.get(); }
+
+   private:
+    friend class SharedModel;
+
+    ExecutionContext();
+
+    // Declared before `interpreter_` so that it outlives it.
+    std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> delegate_;
+    std::unique_ptr<Interpreter> interpreter_;
+  };
+
+  // `model` and `op_resolver` must outlive the SharedModel. `op_resolver`
+  // should not apply default delegates, e.g. be a
+  // BuiltinOpResolverWithoutDefaultDelegates, since those would pack weights
+  // for every context. The `weights_cache` in `delegate_options` is replaced
+  // by the shared one.
+  SharedModel(const FlatBufferModel& model, const OpResolver& op_resolver,
+              const TfLiteXNNPackDelegateOptions& delegate_options);
+
+  SharedModel(const SharedModel&) = delete;
+  SharedModel& operator=(const SharedModel&) = delete;
+
+  // Creates a new context. May be called from several threads at once. The
+  // SharedModel must outlive the contexts created from it.
+  TfLiteStatus CreateExecutionContext(
+      std::unique_ptr<ExecutionContext>* context);
+
+ private:
+  const FlatBufferModel& model_;
+  const OpResolver& op_resolver_;
+  TfLiteXNNPackDelegateOptions delegate_options_;
+  std::unique_ptr<TfLiteXNNPackDelegateWeightsCache,
+                  void (*)(TfLiteXNNPackDelegateWeightsCache*)>
+      weights_cache_;
+
+  std::mutex mutex_;
+  // Set once the first context has packed the weights and the cache has been
+  // soft-finalized. Until then contexts are created one at a time.
+  bool weights_cache_finalized_ = false;
+};
+
+}  // namespace xnnpack
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_XNNPACK_SHARED_MODEL_H_
@@ -0,0 +1,80 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/xnnpack/shared_model.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/delegates/xnnpack/conv_2d_tester.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace tflite {
+namespace xnnpack {
+
+// Runs `interpreter` on a fixed input and returns its output.
+std::vector<float> RunOnFixedInput(Interpreter* interpreter) {
+  TfLiteTensor* input = interpreter->input_tensor(0);
+  const size_t input_size = input->bytes / sizeof(float);
+  for (size_t i = 0; i < input_size; i++) {
+    input->data.f[i] = static_cast<float>(i % 7) * 0.25f;
+  }
+  EXPECT_EQ(kTfLiteOk, interpreter->Invoke());
+  const TfLiteTensor* output = interpreter->output_tensor(0);
+  return std::vector<float>(output->data.f,
+                            output->data.f + output->bytes / sizeof(float));
+}
+
+TEST(XNNPACK_SHARED_MODEL, ContextsComputeTheSameResult) {
+  std::vector<char> buffer = Conv2DTester().CreateTfLiteModel();
+  std::unique_ptr<FlatBufferModel> model =
+      FlatBufferModel::BuildFromBuffer(buffer.data(), buffer.size());
+  ASSERT_NE(model, nullptr);
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+  SharedModel shared_model(*model, resolver,
+                           TfLiteXNNPackDelegateOptionsDefault());
+
+  std::unique_ptr<SharedModel::ExecutionContext> first_context;
+  ASSERT_EQ(kTfLiteOk, shared_model.CreateExecutionContext(&first_context));
+  const std::vector<float> expected =
+      RunOnFixedInput(first_context->interpreter());
+
+  // Contexts created after the weights have been packed reuse them, and may
+  // be created and run concurrently.
+  constexpr int kNumThreads = 4;
+  std::vector<std::thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&] {
+      std::unique_ptr<SharedModel::ExecutionContext> context;
+      ASSERT_EQ(kTfLiteOk, shared_model.CreateExecutionContext(&context));
+      EXPECT_EQ(expected, RunOnFixedInput(context->interpreter()));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // The first context is unaffected by the others.
+  EXPECT_EQ(expected, RunOnFixedInput(first_context->interpreter()));
+}
+
+}  // namespace xnnpack
+}  // namespace tflite
@@ -0,0 +1,233 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/xnnpack/unpacked_weights_cache.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+
+namespace tflite {
+namespace xnnpack {
+namespace {
+
+constexpr char kMagic[8] = {'T', 'F', 'L', 'X', 'N', 'N', 'U', 'W'};
+// Bump when the layout of the unpacked weights or of FileHeader changes.
+constexpr uint32_t kVersion = 2;
+
+// Precedes the unpacked weights in a cache file. 64 bytes long, so that the
+// weights keep the alignment of the mapping.
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t fingerprint;
+  uint64_t size;
+  // UnpackedWeightsFingerprint of the unpacked weights, to detect files that
+  // were corrupted after they were written.
+  uint64_t checksum;
+  char padding[24];
+};
+static_assert(sizeof(FileHeader) == 64, "unexpected FileHeader size");
+
+// A missing cache file is expected, and shouldn't be reported as an error.
+class SilentErrorReporter : public ErrorReporter {
+ public:
+  int Report(const char* format, va_list args) override { return 0; }
+};
+
+struct LoadedFile {
+  uint64_t fingerprint;
+  size_t size;
+  std::weak_ptr<const UnpackedWeightsFile> file;
+};
+
+std::mutex& LoadedFilesMutex() {
+  static auto* mutex = new std::mutex();
+  return *mutex;
+}
+
+// Files loaded by this process, by path.
+std::unordered_map<std::string, LoadedFile>& LoadedFiles() {
+  static auto* files = new std::unordered_map<std::string, LoadedFile>();
+  return *files;
+}
+
+uint64_t Checksum(const char* data, size_t size) {
+  UnpackedWeightsFingerprint checksum;
+  checksum.Update(data, size);
+  return checksum.value();
+}
+
+// Creates a new file next to `path` for writing, with a name no other process
+// or thread uses, and stores its name in `temp_path`. Returns nullptr on
+// failure.
+std::FILE* CreateTempFile(const std::string& path, std::string& temp_path) {
+#if defined(_WIN32)
+  // There is no mkstemp(); the process id and a counter make the name unique
+  // among writers, and "x" fails rather than reuse an existing file.
+  static std::atomic<int> counter(0);
+  temp_path = path + ".tmp." + std::to_string(_getpid()) + "." +
+              std::to_string(counter++);
+  return std::fopen(temp_path.c_str(), "wbx");
+#else
+  temp_path = path + ".XXXXXX";
+  const int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    return nullptr;
+  }
+  // mkstemp() creates the file readable by its owner only.
+  fchmod(fd, 0644);
+  std::FILE* file = fdopen(fd, "wb");
+  if (file == nullptr) {
+    close(fd);
+    std::remove(temp_path.c_str());
+  }
+  return file;
+#endif
+}
+
+}  // namespace
+
+void UnpackedWeightsFingerprint::Update(const void* data, size_t size) {
+  // FNV-1a over 64-bit words, then over the remaining bytes.
+  constexpr uint64_t kPrime = 0x100000001b3ull;
+  const char* bytes = static_cast<const char*>(data);
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    value_ = (value_ ^ word) * kPrime;
+    bytes += sizeof(uint64_t);
+  }
+  for (; size > 0; --size) {
+    value_ = (value_ ^ static_cast<uint8_t>(*bytes++)) * kPrime;
+  }
+}
+
+std::shared_ptr<const UnpackedWeightsFile> UnpackedWeightsFile::Load(
+    const std::string& path, uint64_t fingerprint, size_t size) {
+  std::lock_guard<std::mutex> lock(LoadedFilesMutex());
+  LoadedFile& loaded = LoadedFiles()[path];
+  if (loaded.fingerprint == fingerprint && loaded.size == size) {
+    if (auto file = loaded.file.lock()) {
+      return file;
+    }
+  }
+
+  SilentErrorReporter error_reporter;
+  std::unique_ptr<Allocation> allocation;
+  if (MMAPAllocation::IsSupported()) {
+    allocation =
+        std::make_unique<MMAPAllocation>(path.c_str(), &error_reporter);
+  } else {
+    allocation =
+        std::make_unique<FileCopyAllocation>(path.c_str(), &error_reporter);
+  }
+  if (!allocation->valid() ||
+      allocation->bytes() != sizeof(FileHeader) + size) {
+    return nullptr;
+  }
+  FileHeader header;
+  std::memcpy(&header, allocation->base(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.fingerprint != fingerprint ||
+      header.size != size ||
+      header.checksum !=
+          Checksum(static_cast<const char*>(allocation->base()) +
+                       sizeof(FileHeader),
+                   size)) {
+    return nullptr;
+  }
+
+  auto file =
+      std::make_shared<const UnpackedWeightsFile>(std::move(allocation));
+  loaded = {fingerprint, size, file};
+  return file;
+}
+
+bool UnpackedWeightsFile::Save(const std::string& path, uint64_t fingerprint,
+                               const char* data, size_t size) {
+  FileHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.fingerprint = fingerprint;
+  header.size = size;
+  header.checksum = Checksum(data, size);
+
+  // Write to a temporary file of our own first, so that other processes never
+  // map a partially written cache, even if they save the same cache at the
+  // same time.
+  std::string temp_path;
+  std::FILE* file = CreateTempFile(path, temp_path);
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(data, 1, size, file) == size &&
+            std::fflush(file) == 0;
+#if !defined(_WIN32)
+  // Make sure the contents reach the disk before the rename does.
+  ok = ok && fsync(fileno(file)) == 0;
+#endif
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+#if defined(_WIN32)
+    // rename() doesn't replace existing files on Windows. Readers see either
+    // no file or a complete one, and treat a missing file as a cache miss.
+    std::remove(path.c_str());
+    if (std::rename(temp_path.c_str(), path.c_str()) == 0) {
+      return true;
+    }
+#endif
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+UnpackedWeightsFile::UnpackedWeightsFile(std::unique_ptr<Allocation> allocation)
+    : allocation_(std::move(allocation)) {}
+
+const char* UnpackedWeightsFile::data() const {
+  return static_cast<const char*>(allocation_->base()) + sizeof(FileHeader);
+}
+
+size_t UnpackedWeightsFile::size() const {
+  return allocation_->bytes() - sizeof(FileHeader);
+}
+
+}  // namespace xnnpack
+}  // namespace tflite
@@ -0,0 +1,80 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_DELEGATES_XNNPACK_UNPACKED_WEIGHTS_CACHE_H_
+#define TENSORFLOW_LITE_DELEGATES_XNNPACK_UNPACKED_WEIGHTS_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tensorflow/lite/allocation.h"
+
+namespace tflite {
+namespace xnnpack {
+
+// Computes a 64-bit fingerprint of the static data that the delegate unpacks,
+// to tell whether a cache file was written for the same model.
+class UnpackedWeightsFingerprint {
+ public:
+  void Update(const void* data, size_t size);
+
+  template <typename T>
+  void Update(const T& value) {
+    Update(&value, sizeof(value));
+  }
+
+  uint64_t value() const { return value_; }
+
+ private:
+  uint64_t value_ = 0xcbf29ce484222325ull;
+};
+
+// The static weights that the XNNPACK delegate unpacked for a model, i.e.
+// dequantized FP16/INT8 weights and densified sparse weights, saved to a file
+// so that later processes can memory-map them instead of unpacking them again.
+//
+// Loaded files are shared: all delegates in a process that load the same file
+// with the same fingerprint get the same mapping.
+class UnpackedWeightsFile {
+ public:
+  // Returns the contents of the cache file at `path` if it holds `size` bytes
+  // of unpacked weights with the given `fingerprint`, or nullptr if the file
+  // is missing, can't be mapped, was written for different weights, or fails
+  // its checksum.
+  static std::shared_ptr<const UnpackedWeightsFile> Load(
+      const std::string& path, uint64_t fingerprint, size_t size);
+
+  // Writes `size` bytes of unpacked weights with the given `fingerprint` to
+  // the cache file at `path`, replacing it atomically. Safe to call from
+  // several processes at once. Returns false on failure.
+  static bool Save(const std::string& path, uint64_t fingerprint,
+                   const char* data, size_t size);
+
+  explicit UnpackedWeightsFile(std::unique_ptr<Allocation> allocation);
+
+  // The unpacked weights.
+  const char* data() const;
+  size_t size() const;
+
+ private:
+  std::unique_ptr<Allocation> allocation_;
+};
+
+}  // namespace xnnpack
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_XNNPACK_UNPACKED_WEIGHTS_CACHE_H_
@@ -0,0 +1,158 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/delegates/xnnpack/unpacked_weights_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/delegates/xnnpack/conv_2d_tester.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace tflite {
+namespace xnnpack {
+
+TEST(UnpackedWeightsCache, SaveAndLoad) {
+  const std::string path = ::testing::TempDir() + "/save_and_load.xnnpack";
+  const std::vector<char> data = {1, 2, 3, 4, 5};
+  ASSERT_TRUE(UnpackedWeightsFile::Save(path, 42, data.data(), data.size()));
+
+  std::shared_ptr<const UnpackedWeightsFile> file =
+      UnpackedWeightsFile::Load(path, 42, data.size());
+  ASSERT_NE(file, nullptr);
+  ASSERT_EQ(file->size(), data.size());
+  EXPECT_EQ(std::vector<char>(file->data(), file->data() + file->size()),
+            data);
+  // Delegates in the same process share the loaded file.
+  EXPECT_EQ(UnpackedWeightsFile::Load(path, 42, data.size()), file);
+  std::remove(path.c_str());
+}
+
+TEST(UnpackedWeightsCache, RejectsOtherWeights) {
+  const std::string path = ::testing::TempDir() + "/other_weights.xnnpack";
+  const std::vector<char> data = {1, 2, 3, 4, 5};
+  ASSERT_TRUE(UnpackedWeightsFile::Save(path, 42, data.data(), data.size()));
+
+  EXPECT_EQ(UnpackedWeightsFile::Load(path, 43, data.size()), nullptr);
+  EXPECT_EQ(UnpackedWeightsFile::Load(path, 42, data.size() + 1), nullptr);
+  std::remove(path.c_str());
+  EXPECT_EQ(UnpackedWeightsFile::Load(path, 42, data.size()), nullptr);
+}
+
+TEST(UnpackedWeightsCache, RejectsCorruptedFile) {
+  const std::string path = ::testing::TempDir() + "/corrupted.xnnpack";
+  const std::vector<char> data = {1, 2, 3, 4, 5};
+  ASSERT_TRUE(UnpackedWeightsFile::Save(path, 42, data.data(), data.size()));
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put(6);
+  }
+
+  EXPECT_EQ(UnpackedWeightsFile::Load(path, 42, data.size()), nullptr);
+  std::remove(path.c_str());
+}
+
+TEST(UnpackedWeightsCache, SaveReplacesFile) {
+  const std::string path = ::testing::TempDir() + "/replaced.xnnpack";
+  const std::vector<char> data = {1, 2, 3, 4, 5};
+  const std::vector<char> other_data = {6, 7, 8, 9, 10};
+  ASSERT_TRUE(UnpackedWeightsFile::Save(path, 42, data.data(), data.size()));
+  ASSERT_TRUE(UnpackedWeightsFile::Save(path, 43, other_data.data(),
+                                        other_data.size()));
+
+  std::shared_ptr<const UnpackedWeightsFile> file =
+      UnpackedWeightsFile::Load(path, 43, other_data.size());
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(std::vector<char>(file->data(), file->data() + file->size()),
+            other_data);
+  std::remove(path.c_str());
+}
+
+TEST(UnpackedWeightsCache, FingerprintDependsOnData) {
+  const std::vector<char> data(100, 7);
+  UnpackedWeightsFingerprint fingerprint1;
+  fingerprint1.Update(data.data(), data.size());
+  UnpackedWeightsFingerprint fingerprint2;
+  fingerprint2.Update(data.data(), data.size());
+  EXPECT_EQ(fingerprint1.value(), fingerprint2.value());
+
+  std::vector<char> other_data = data;
+  other_data.back() = 8;
+  UnpackedWeightsFingerprint fingerprint3;
+  fingerprint3.Update(other_data.data(), other_data.size());
+  EXPECT_NE(fingerprint1.value(), fingerprint3.value());
+}
+
+TEST(UnpackedWeightsCache, DelegateWritesAndReadsCache) {
+  const std::string path = ::testing::TempDir() + "/conv_2d.xnnpack";
+  std::remove(path.c_str());
+  std::vector<char> buffer = Conv2DTester()
+                                 .InputHeight(11)
+                                 .InputWidth(13)
+                                 .InputChannels(5)
+                                 .OutputChannels(7)
+                                 .FP16Weights()
+                                 .CreateTfLiteModel();
+  const Model* model = GetModel(buffer.data());
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+
+  TfLiteXNNPackDelegateOptions delegate_options =
+      TfLiteXNNPackDelegateOptionsDefault();
+  delegate_options.unpacked_weights_cache_file_path = path.c_str();
+
+  // The first delegate unpacks the FP16 weights and writes the cache, the
+  // second one maps it.
+  std::vector<std::unique_ptr<Interpreter>> interpreters(2);
+  std::vector<std::unique_ptr<TfLiteDelegate,
+                              decltype(&TfLiteXNNPackDelegateDelete)>>
+      delegates;
+  for (std::unique_ptr<Interpreter>& interpreter : interpreters) {
+    delegates.emplace_back(TfLiteXNNPackDelegateCreate(&delegate_options),
+                           TfLiteXNNPackDelegateDelete);
+    ASSERT_EQ(kTfLiteOk, InterpreterBuilder(model, resolver)(&interpreter));
+    ASSERT_EQ(kTfLiteOk,
+              interpreter->ModifyGraphWithDelegate(delegates.back().get()));
+    ASSERT_EQ(kTfLiteOk, interpreter->AllocateTensors());
+    EXPECT_TRUE(std::ifstream(path).good());
+  }
+
+  std::vector<std::vector<float>> outputs;
+  for (std::unique_ptr<Interpreter>& interpreter : interpreters) {
+    TfLiteTensor* input = interpreter->tensor(interpreter->inputs()[0]);
+    float* input_data = interpreter->typed_input_tensor<float>(0);
+    for (size_t i = 0; i < input->bytes / sizeof(float); ++i) {
+      input_data[i] = static_cast<float>(i % 17) / 17.0f;
+    }
+    ASSERT_EQ(kTfLiteOk, interpreter->Invoke());
+    TfLiteTensor* output = interpreter->tensor(interpreter->outputs()[0]);
+    const float* output_data = interpreter->typed_output_tensor<float>(0);
+    outputs.emplace_back(output_data,
+                         output_data + output->bytes / sizeof(float));
+  }
+  EXPECT_EQ(outputs[0], outputs[1]);
+  std::remove(path.c_str());
+}
+
+}  // namespace xnnpack
+}  // namespace tflite
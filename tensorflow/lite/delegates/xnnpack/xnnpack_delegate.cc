@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/delegates/xnnpack/quantization_util.h"
+#include "tensorflow/lite/delegates/xnnpack/unpacked_weights_cache.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
 #include "tensorflow/lite/kernels/internal/utils/sparsity_format_converter.h"
@@ -119,7 +120,20 @@ class Delegate {
 
   xnn_workspace_t workspace() const { return workspace_.get(); }
 
+  const char* static_unpacked_data() const {
+    return static_unpacked_data_file_ != nullptr
+               ? static_unpacked_data_file_->data()
+               : static_unpacked_data_.data();
+  }
+
  private:
+  // Returns the fingerprint of the static data that unpacking the quasi-static
+  // `tensors` reads, and sets `unpacked_size` to the size of the unpacked data.
+  uint64_t FingerprintStaticUnpacking(
+      TfLiteContext* context, const std::vector<int>& tensors,
+      const std::unordered_map<int, int>& quasi_static_tensors_producers,
+      size_t* unpacked_size) const;
+
   TfLiteDelegate delegate_ = {
       reinterpret_cast<void*>(this),  // .data_
       DelegatePrepare,                // .Prepare
@@ -132,6 +146,9 @@ class Delegate {
   // Unpacked data for quasi-static tensors, i.e. tensors produced by
   // dequantizing or unpacking static buffers.
   std::vector<char> static_unpacked_data_;
+  // Unpacked data loaded from the unpacked weights cache file, used instead of
+  // static_unpacked_data_ if set.
+  std::shared_ptr<const UnpackedWeightsFile> static_unpacked_data_file_;
   // Mapping from a tensor index for a quasi-static tensor to the offset to
   // its unpacked data within static_unpacked_data_.
   std::unordered_map<int, size_t> static_unpacked_data_map_;
@@ -496,7 +513,7 @@ class Subgraph {
         // Check for quasi-static data.
         const auto it = delegate.static_unpacked_data_map_.find(t);
         if (it != delegate.static_unpacked_data_map_.end()) {
-          data = delegate.static_unpacked_data_.data() + it->second;
+          data = delegate.static_unpacked_data() + it->second;
         }
       }
       if (inputs.count(t) != 0) {
@@ -4562,6 +4579,7 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
   // Clear previous data, in case the delegate is reused without re-creation.
   static_unpacked_data_map_.clear();
   static_unpacked_data_.clear();
+  static_unpacked_data_file_.reset();
   static_unpack_nodes_.clear();
   static_sparse_weights_.clear();
 
@@ -4706,7 +4724,23 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
                      quasi_static_tensors_producers[t2];
             });
 
+  // With a cache file, load the data unpacked by an earlier delegate instead of
+  // unpacking it again.
+  const char* cache_file_path = options_.unpacked_weights_cache_file_path;
+  const bool use_cache_file = cache_file_path != nullptr &&
+                              !sorted_quasi_static_tensors_to_unpack.empty();
+  uint64_t fingerprint = 0;
+  if (use_cache_file) {
+    size_t unpacked_size = 0;
+    fingerprint = FingerprintStaticUnpacking(
+        context, sorted_quasi_static_tensors_to_unpack,
+        quasi_static_tensors_producers, &unpacked_size);
+    static_unpacked_data_file_ =
+        UnpackedWeightsFile::Load(cache_file_path, fingerprint, unpacked_size);
+  }
+
   // Unpack static data of all tensors
+  size_t static_unpacked_size = 0;
   for (int t : sorted_quasi_static_tensors_to_unpack) {
     const int producer_index = quasi_static_tensors_producers[t];
     // Check if TFLite nodes can be delegated to XNNPACK
@@ -4776,11 +4810,15 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     }
 
     // Align to XNN_EXTRA_BYTES bytes
-    while (static_unpacked_data_.size() % XNN_EXTRA_BYTES != 0) {
-      static_unpacked_data_.push_back(0);
+    const size_t tensor_offset =
+        (static_unpacked_size + XNN_EXTRA_BYTES - 1) / XNN_EXTRA_BYTES *
+        XNN_EXTRA_BYTES;
+    static_unpacked_size = tensor_offset + context->tensors[t].bytes;
+    if (static_unpacked_data_file_ != nullptr) {
+      static_unpacked_data_map_[t] = tensor_offset;
+      continue;
     }
-    const size_t tensor_offset = static_unpacked_data_.size();
-    static_unpacked_data_.resize(tensor_offset + context->tensors[t].bytes);
+    static_unpacked_data_.resize(static_unpacked_size);
 
     char* unpacked_data = static_unpacked_data_.data() + tensor_offset;
     const char* packed_data =
@@ -4894,6 +4932,23 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     static_unpacked_data_map_[t] = tensor_offset;
   }
 
+  if (use_cache_file && static_unpacked_data_file_ == nullptr) {
+    if (UnpackedWeightsFile::Save(cache_file_path, fingerprint,
+                                  static_unpacked_data_.data(),
+                                  static_unpacked_data_.size())) {
+      // Map the file, so that other delegates in the process share the data.
+      static_unpacked_data_file_ = UnpackedWeightsFile::Load(
+          cache_file_path, fingerprint, static_unpacked_data_.size());
+      if (static_unpacked_data_file_ != nullptr) {
+        std::vector<char>().swap(static_unpacked_data_);
+      }
+    } else {
+      TFLITE_LOG_PROD(tflite::TFLITE_LOG_WARNING,
+                      "Failed to write XNNPACK unpacked weights cache to %s.",
+                      cache_file_path);
+    }
+  }
+
   // Add nodes that unpack static data consumed by delegated nodes.
   // Note: this is done purely to avoid the overhead of running these nodes
   // again in TFLite interpreter which would allocate memory for their outputs.
@@ -4921,6 +4976,78 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
   return nodes_to_delegate;
 }
 
+uint64_t Delegate::FingerprintStaticUnpacking(
+    TfLiteContext* context, const std::vector<int>& tensors,
+    const std::unordered_map<int, int>& quasi_static_tensors_producers,
+    size_t* unpacked_size) const {
+  auto update_int_array = [](const TfLiteIntArray* array,
+                             UnpackedWeightsFingerprint* fingerprint) {
+    const int size = array != nullptr ? array->size : -1;
+    fingerprint->Update(size);
+    if (size > 0) fingerprint->Update(array->data, size * sizeof(int));
+  };
+
+  UnpackedWeightsFingerprint fingerprint;
+  *unpacked_size = 0;
+  for (int t : tensors) {
+    const TfLiteTensor& output_tensor = context->tensors[t];
+    *unpacked_size = (*unpacked_size + XNN_EXTRA_BYTES - 1) / XNN_EXTRA_BYTES *
+                         XNN_EXTRA_BYTES +
+                     output_tensor.bytes;
+    fingerprint.Update(t);
+    fingerprint.Update(output_tensor.type);
+    fingerprint.Update(output_tensor.bytes);
+    update_int_array(output_tensor.dims, &fingerprint);
+
+    TfLiteNode* node = nullptr;
+    TfLiteRegistration* registration = nullptr;
+    const auto producer_it = quasi_static_tensors_producers.find(t);
+    if (producer_it == quasi_static_tensors_producers.end() ||
+        context->GetNodeAndRegistration(context, producer_it->second, &node,
+                                        &registration) != kTfLiteOk ||
+        node->inputs->size != 1) {
+      // PrepareOpsToDelegate reports the error.
+      continue;
+    }
+    fingerprint.Update(registration->builtin_code);
+    const int input_index = node->inputs->data[0];
+    const TfLiteTensor& input_tensor = context->tensors[input_index];
+    fingerprint.Update(input_index);
+    fingerprint.Update(input_tensor.type);
+    fingerprint.Update(input_tensor.bytes);
+    update_int_array(input_tensor.dims, &fingerprint);
+    if (input_tensor.allocation_type == kTfLiteMmapRo) {
+      fingerprint.Update(input_tensor.data.raw_const, input_tensor.bytes);
+    }
+    fingerprint.Update(input_tensor.params.scale);
+    fingerprint.Update(input_tensor.params.zero_point);
+    if (input_tensor.quantization.type == kTfLiteAffineQuantization &&
+        input_tensor.quantization.params != nullptr) {
+      const auto* quant_params = static_cast<const TfLiteAffineQuantization*>(
+          input_tensor.quantization.params);
+      if (quant_params->scale != nullptr) {
+        fingerprint.Update(quant_params->scale->data,
+                           quant_params->scale->size * sizeof(float));
+      }
+      update_int_array(quant_params->zero_point, &fingerprint);
+      fingerprint.Update(quant_params->quantized_dimension);
+    }
+    if (input_tensor.sparsity != nullptr) {
+      const TfLiteSparsity& sparsity = *input_tensor.sparsity;
+      update_int_array(sparsity.traversal_order, &fingerprint);
+      update_int_array(sparsity.block_map, &fingerprint);
+      for (int i = 0; i < sparsity.dim_metadata_size; ++i) {
+        const TfLiteDimensionMetadata& metadata = sparsity.dim_metadata[i];
+        fingerprint.Update(metadata.format);
+        fingerprint.Update(metadata.dense_size);
+        update_int_array(metadata.array_segments, &fingerprint);
+        update_int_array(metadata.array_indices, &fingerprint);
+      }
+    }
+  }
+  return fingerprint.value();
+}
+
 void* SubgraphInit(TfLiteContext* context, const char* buffer, size_t length) {
   const TfLiteDelegateParams* params =
       reinterpret_cast<const TfLiteDelegateParams*>(buffer);
@@ -44,6 +44,13 @@ typedef struct {
   // Cache for packed weights, can be shared between multiple instances of
   // delegates.
   struct TfLiteXNNPackDelegateWeightsCache* weights_cache;
+  // Path of a file to cache the static weights that the delegate unpacks when
+  // it is applied, i.e. FP16 and INT8 weights dequantized to FP32 and sparse
+  // weights densified, or NULL to disable the cache. If the file was written
+  // for the same weights, it is memory-mapped instead of unpacking them again,
+  // and shared by all delegates in the process that use it; otherwise it is
+  // (re)written. Use one file per model.
+  const char* unpacked_weights_cache_file_path;
 } TfLiteXNNPackDelegateOptions;
 
 // Returns a structure with the default XNNPack delegate options.
@@ -673,6 +673,10 @@ class Interpreter {
   /// NOTE: User needs to call AllocateTensors() after this.
   /// Invalid/insufficient buffers will cause an error during AllocateTensors or
   /// Invoke (in case of dynamic shapes in the graph).
+  /// Once tensors are allocated, a tensor can be reassigned before each
+  /// Invoke() without calling AllocateTensors() again, e.g. to bind a new input
+  /// frame or output buffer without copies. If a reassigned allocation is too
+  /// small, AllocateTensors() has to be called again, and reports the error.
   ///
   /// Parameters should satisfy the following conditions:
   /// 1. tensor->allocation_type == kTfLiteArenaRw or kTfLiteArenaRwPersistent
@@ -27,7 +27,8 @@ class InterpreterOptions {
   InterpreterOptions()
       : experimental_preserve_all_tensors_(false),
         experimental_ensure_dynamic_tensors_are_released_(false),
-        experimental_optimize_memory_for_large_tensors_(0) {}
+        experimental_optimize_memory_for_large_tensors_(0),
+        experimental_inter_op_parallelism_(1) {}
 
   /// Preserving all intermediates tensors for debugging.
   /// WARNING: This is an experimental API and subject to change.
@@ -76,10 +77,26 @@ class InterpreterOptions {
     return experimental_optimize_memory_for_large_tensors_;
   }
 
+  /// Run up to `value` independent nodes of a subgraph concurrently, each on
+  /// its own thread with its own CPU backend context. Nodes are reordered so
+  /// that independent ones are adjacent in the execution plan, and the memory
+  /// plan keeps the tensors of concurrently running nodes apart, which may
+  /// increase the arena size. Delegated nodes, custom ops, control flow and
+  /// resource variable ops always run alone. A value of 1 or less disables it.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetInterOpParallelism(int value) {
+    experimental_inter_op_parallelism_ = value;
+  }
+
+  /// Returns the maximum number of nodes that may run concurrently.
+  /// WARNING: This is an experimental API and subject to change.
+  int GetInterOpParallelism() { return experimental_inter_op_parallelism_; }
+
  private:
   bool experimental_preserve_all_tensors_;
   bool experimental_ensure_dynamic_tensors_are_released_;
   int experimental_optimize_memory_for_large_tensors_;
+  int experimental_inter_op_parallelism_;
 };
 
 }  // namespace tflite
@@ -1113,6 +1113,58 @@ TEST(BasicInterpreter, ReleaseDynamicTensors) {
   ASSERT_EQ(interpreter.tensor(3)->bytes, sizeof(float) * 6 * 6);
 }
 
+TEST(BasicInterpreter, InterOpParallelism) {
+  // Assemble a graph of two independent chains, (0) -> neg -> (1) -> neg -> (2)
+  // and (0) -> neg -> (3), that are joined by a mul.
+  Interpreter interpreter;
+  interpreter.AddTensors(5);
+  interpreter.SetInputs({0});
+  interpreter.SetOutputs({4});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 5; ++i) {
+    interpreter.SetTensorParametersReadWrite(/*tensor_index=*/i,
+                                             /*type=*/kTfLiteFloat32,
+                                             /*name=*/"", /*dims=*/{2},
+                                             /*quantization=*/quant);
+  }
+  TfLiteRegistration* neg_op = tflite::ops::builtin::Register_NEG();
+  TfLiteRegistration* mul_op = tflite::ops::builtin::Register_MUL();
+  interpreter.AddNodeWithParameters(
+      /*inputs=*/{0}, /*outputs=*/{1}, /*init_data=*/nullptr,
+      /*init_data_size=*/0, /*builtin_data=*/nullptr, /*registration=*/neg_op);
+  interpreter.AddNodeWithParameters(
+      /*inputs=*/{1}, /*outputs=*/{2}, /*init_data=*/nullptr,
+      /*init_data_size=*/0, /*builtin_data=*/nullptr, /*registration=*/neg_op);
+  interpreter.AddNodeWithParameters(
+      /*inputs=*/{0}, /*outputs=*/{3}, /*init_data=*/nullptr,
+      /*init_data_size=*/0, /*builtin_data=*/nullptr, /*registration=*/neg_op);
+  TfLiteMulParams* mul_params =
+      static_cast<TfLiteMulParams*>(malloc(sizeof(TfLiteMulParams)));
+  mul_params->activation = kTfLiteActNone;
+  interpreter.AddNodeWithParameters(
+      /*inputs=*/{2, 3}, /*outputs=*/{4}, /*init_data=*/nullptr,
+      /*init_data_size=*/0, /*builtin_data=*/mul_params,
+      /*registration=*/mul_op);
+
+  InterpreterOptions options;
+  options.SetInterOpParallelism(2);
+  interpreter.ApplyOptions(&options);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  // The independent negations are now adjacent, and run as one stage.
+  EXPECT_THAT(interpreter.execution_plan(), testing::ElementsAre(0, 2, 1, 3));
+
+  for (int run = 0; run < 2; ++run) {
+    float* input = interpreter.typed_tensor<float>(0);
+    input[0] = 3.f;
+    input[1] = -2.f;
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    const float* output = interpreter.typed_tensor<float>(4);
+    EXPECT_EQ(output[0], -9.f);
+    EXPECT_EQ(output[1], -4.f);
+  }
+}
+
 TEST(InterpreterTensorsCapacityTest, TestWithinHeadroom) {
   Interpreter interpreter;
   ASSERT_EQ(interpreter.AddTensors(Interpreter::kTensorsReservedCapacity),
@@ -1740,6 +1792,41 @@ TEST_F(TestCustomAllocation, CustomInputAndOutputAllocs) {
   VerifyInvoke();
 }
 
+TEST_F(TestCustomAllocation, CustomInputAndOutputAllocs_ReassignPerInvoke) {
+  AssignCustomAllocForTensor(interpreter_->inputs()[0],
+                             /*required_alignment=*/kDefaultTensorAlignment);
+  AssignCustomAllocForTensor(interpreter_->outputs()[0],
+                             /*required_alignment=*/kDefaultTensorAlignment);
+  ASSERT_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
+  VerifyInvoke();
+
+  // New buffers can be bound before each Invoke without AllocateTensors.
+  for (int i = 0; i < 3; ++i) {
+    AssignCustomAllocForTensor(interpreter_->inputs()[0],
+                               /*required_alignment=*/kDefaultTensorAlignment);
+    AssignCustomAllocForTensor(interpreter_->outputs()[0],
+                               /*required_alignment=*/kDefaultTensorAlignment);
+    VerifyInvoke();
+    EXPECT_EQ(interpreter_->tensor(interpreter_->outputs()[0])->allocation_type,
+              kTfLiteCustom);
+  }
+}
+
+TEST_F(TestCustomAllocation, CustomInputAlloc_ReassignInsufficientBytes) {
+  AssignCustomAllocForTensor(interpreter_->inputs()[0],
+                             /*required_alignment=*/kDefaultTensorAlignment);
+  ASSERT_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
+  VerifyInvoke();
+
+  // A buffer that is too small is never used by Invoke.
+  auto input_alloc = NewCustomAlloc(4, kDefaultTensorAlignment);
+  ASSERT_EQ(interpreter_->SetCustomAllocationForTensor(
+                interpreter_->inputs()[0], input_alloc),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter_->Invoke(), kTfLiteError);
+  ASSERT_EQ(interpreter_->AllocateTensors(), kTfLiteError);
+}
+
 // Ensure that custom allocs work for tensors on persistent arena as well.
 TEST_F(TestCustomAllocation, CustomAlloc_VariableTensor) {
   // Set custom allocation for one input tensor.
@@ -1193,7 +1193,8 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           fw_output_gate_bias, fw_projection_weights, fw_projection_bias,
           &lstm_params,
           /*forward_sequence=*/true, time_major, /*output_offset=*/0,
-          fw_scratch_buffer, fw_activation_state, fw_cell_state, fw_output,
+          fw_scratch_buffer, /*input_projection_scratch=*/nullptr,
+          fw_activation_state, fw_cell_state, fw_output,
           CpuBackendContext::GetFromContext(context));
       TF_LITE_ENSURE_OK(context, fw_pass_status);
 
@@ -1214,8 +1215,9 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           bw_output_gate_bias, bw_projection_weights, bw_projection_bias,
           &lstm_params,
           /*forward_sequence=*/false, time_major, bw_output_offset,
-          bw_scratch_buffer, bw_activation_state, bw_cell_state,
-          actual_bw_output, CpuBackendContext::GetFromContext(context));
+          bw_scratch_buffer, /*input_projection_scratch=*/nullptr,
+          bw_activation_state, bw_cell_state, actual_bw_output,
+          CpuBackendContext::GetFromContext(context));
       TF_LITE_ENSURE_OK(context, bw_pass_status);
       return kTfLiteOk;
     }
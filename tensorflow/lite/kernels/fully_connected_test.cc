@@ -2071,6 +2071,39 @@ TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x16Test) {
   EXPECT_THAT(m.GetOutput(), ElementsAre(11, 2, 25, 0, 2, 21));
 }
 
+TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x16TestMultiThreaded) {
+  std::vector<float> weight_data = {
+      1,  2,  3,  4,  -1, -2, -3, -4, 1,  2,  3,  4, -4, -3, -2, -1,  // u = 0
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0,  0,  0,  0,   // u = 1
+      -1, -2, -3, -4, 4,  3,  2,  1,  -1, -2, -3, 4, 1,  2,  3,  4,   // u = 2
+  };
+  TensorData weight = {TensorType_INT8, {3, 16}, 0, 0, 1};
+  weight.traversal_order = {0, 1, 2};
+  weight.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  weight.block_map = {1};
+  weight.block_size = {16};
+  for (int num_threads = 1; num_threads <= 4; num_threads++) {
+    SparseQuantizedFullyConnectedOpModel m(
+        GetRegistration(),
+        /*units=*/3, /*batches=*/3,
+        /*input=*/{TensorType_INT8, {3, 16}, 0, 0, 1}, weight, weight_data,
+        /*output=*/{TensorType_INT8, {}, 0, 0, 1},
+        /*bias_tensor_optional=*/false, /*num_threads=*/num_threads);
+
+    m.SetBias({1, 2, 3});
+    m.SetInput({
+        1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4,  // b = 0
+        4, 3, 2, 1, 4, 3, 2, 1, 4, 3, 2, 1, 4, 3, 2, 1,  // b = 1
+        1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4,  // b = 2
+    });
+
+    ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+    EXPECT_THAT(m.GetOutputShape(), ElementsAre(3, 3));
+    EXPECT_THAT(m.GetOutput(), ElementsAre(11, 2, 25, 0, 2, 21, 11, 2, 25));
+  }
+}
+
 TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x16TestNoBias) {
   std::vector<float> weight_data = {
       1,  2,  3,  4,  -1, -2, -3, -4, 1,  2,  3,  4, -4, -3, -2, -1,  // u = 0
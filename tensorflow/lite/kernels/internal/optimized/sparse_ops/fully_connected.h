@@ -151,6 +151,51 @@ inline void FullyConnectedSparseWeight1x4Impl(
   }
 }
 
+struct FullyConnectedSparseWeight1x16Task : cpu_backend_threadpool::Task {
+  FullyConnectedSparseWeight1x16Task(
+      const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+      const RuntimeShape& input_shape, const int8_t* input_data,
+      const RuntimeShape& weights_shape, const int8_t* weights_data,
+      const RuntimeShape& bias_shape, const int32_t* bias_data,
+      const RuntimeShape& output_shape, int8_t* output_data, int thread_start,
+      int thread_end, const CpuBackendContext& cpu_backend_context_x)
+      : sparsity(sparsity),
+        params(params),
+        input_shape(input_shape),
+        input_data(input_data),
+        weights_shape(weights_shape),
+        weights_data(weights_data),
+        bias_shape(bias_shape),
+        bias_data(bias_data),
+        output_shape(output_shape),
+        output_data(output_data),
+        thread_start(thread_start),
+        thread_end(thread_end),
+        cpu_backend_context(cpu_backend_context_x) {}
+
+  void Run() override {
+    FullyConnectedSparseWeight1x16Impl(
+        sparsity, params, input_shape, input_data, weights_shape, weights_data,
+        bias_shape, bias_data, output_shape, output_data, thread_start,
+        thread_end, cpu_backend_context);
+  }
+
+ private:
+  const TfLiteSparsity& sparsity;
+  const FullyConnectedParams& params;
+  const RuntimeShape& input_shape;
+  const int8_t* input_data;
+  const RuntimeShape& weights_shape;
+  const int8_t* weights_data;
+  const RuntimeShape& bias_shape;
+  const int32_t* bias_data;
+  const RuntimeShape& output_shape;
+  int8_t* output_data;
+  int thread_start;
+  int thread_end;
+  const CpuBackendContext& cpu_backend_context;
+};
+
 struct FullyConnectedSparseWeight1x4Task : cpu_backend_threadpool::Task {
   FullyConnectedSparseWeight1x4Task(
       const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
@@ -196,6 +241,8 @@ struct FullyConnectedSparseWeight1x4Task : cpu_backend_threadpool::Task {
   const CpuBackendContext& cpu_backend_context;
 };
 
+// Like FullyConnectedSparseWeight1x4 below, the multi-threaded kernel slices
+// the workload along the batch dimension.
 inline void FullyConnectedSparseWeight1x16(
     const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
     const RuntimeShape& input_shape, const int8_t* input_data,
@@ -206,14 +253,31 @@ inline void FullyConnectedSparseWeight1x16(
   const int output_elements = output_shape.FlatSize();
   memset(output_data, 0, output_elements * sizeof(int8_t));
 
+  const int max_threads = cpu_backend_context->max_num_threads();
   const int batches =
       FlatSizeSkipDim(output_shape, output_shape.DimensionsCount() - 1);
+  const int thread_count = std::max(1, std::min(batches, max_threads));
+  if (thread_count == 1) {
+    return FullyConnectedSparseWeight1x16Impl(
+        sparsity, params, input_shape, input_data, weights_shape, weights_data,
+        bias_shape, bias_data, output_shape, output_data, 0, batches,
+        *cpu_backend_context);
+  }
+  std::vector<FullyConnectedSparseWeight1x16Task> tasks;
+  tasks.reserve(thread_count);
+  int thread_start = 0;
+  for (int i = 0; i < thread_count; ++i) {
+    int thread_end = thread_start + batches / thread_count;
+    if (i < batches % thread_count) thread_end++;
 
-  // TODO(b/220851507): Add multi-thread support for quantized sparse kernel.
-  return FullyConnectedSparseWeight1x16Impl(
-      sparsity, params, input_shape, input_data, weights_shape, weights_data,
-      bias_shape, bias_data, output_shape, output_data, 0, batches,
-      *cpu_backend_context);
+    tasks.emplace_back(sparsity, params, input_shape, input_data, weights_shape,
+                       weights_data, bias_shape, bias_data, output_shape,
+                       output_data, thread_start, thread_end,
+                       *cpu_backend_context);
+    thread_start = thread_end;
+  }
+  cpu_backend_threadpool::Execute(tasks.size(), tasks.data(),
+                                  cpu_backend_context);
 }
 
 // The multi-threaded kernel slices the workload along the batch dimension. If
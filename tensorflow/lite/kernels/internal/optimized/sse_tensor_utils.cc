@@ -25,12 +25,14 @@ limitations under the License.
 #include <immintrin.h>
 #endif
 
+#include <algorithm>
 #include <cstdint>
 
 #include "ruy/profiler/instrumentation.h"  // from @ruy
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/cpu_backend_gemm.h"
 #include "tensorflow/lite/kernels/cpu_backend_gemm_params.h"
+#include "tensorflow/lite/kernels/internal/common.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 
 namespace tflite {
@@ -86,7 +88,6 @@ static inline int32_t ReduceInt32x4(__m128i acc) {
   return _mm_cvtsi128_si32(acc);
 }
 
-#ifdef __AVX2__
 // Horizontally add 4 float values stored in a single XMM register to float.
 static inline float ReduceFloat32x4(__m128 acc) {
   __m128 shuffle = _mm_movehdup_ps(acc);
@@ -96,6 +97,7 @@ static inline float ReduceFloat32x4(__m128 acc) {
   return _mm_cvtss_f32(acc);
 }
 
+#ifdef __AVX2__
 // Horizontally add 8 float values stored in a single XMM register to float.
 static inline float ReduceFloat32x8(__m256 acc) {
   __m128 low = _mm256_extractf128_ps(acc, 0);
@@ -617,6 +619,75 @@ void SseSparseMatrixBatchVectorMultiplyAccumulate(
   }  // for batch
 }
 
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result) {
+  static constexpr std::intptr_t kBlockSize = 4;
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (std::intptr_t batch = 0; batch < n_batch; ++batch) {
+    const float* __restrict__ matrix_ptr = matrix;
+    const float* __restrict__ vector_in_batch = vector + batch * m_cols;
+    for (std::intptr_t row = 0; row < m_rows; ++row) {
+      __m128 acc_fx4 = _mm_setzero_ps();
+      for (std::intptr_t i = segments[row]; i < segments[row + 1]; ++i) {
+        const __m128 vec_fx4 =
+            _mm_loadu_ps(vector_in_batch + indices[i] * kBlockSize);
+        const __m128 row_fx4 = _mm_loadu_ps(matrix_ptr);
+        // acc += vec .* row
+        acc_fx4 = _mm_add_ps(acc_fx4, _mm_mul_ps(vec_fx4, row_fx4));
+        matrix_ptr += kBlockSize;
+      }  // for block
+      result[batch * m_rows + row] += ReduceFloat32x4(acc_fx4);
+    }  // for row
+  }    // for batch
+}
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x16(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  static constexpr std::intptr_t kBlockSize = 16;
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  for (std::intptr_t batch = 0; batch < n_batch; ++batch) {
+    const int8_t* __restrict__ matrix_ptr = matrix;
+    const int8_t* __restrict__ vector_in_batch = vector + batch * m_cols;
+    for (std::intptr_t row = 0; row < m_rows; ++row) {
+      __m128i dotprod_32x4 = _mm_setzero_si128();
+      __m128i row_sum_32x4 = _mm_setzero_si128();
+      for (std::intptr_t i = segments[row]; i < segments[row + 1]; ++i) {
+        const std::intptr_t col_index = indices[i] * kBlockSize;
+        const __m128i vec_8x16 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(vector_in_batch + col_index));
+        const __m128i row_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix_ptr));
+        // dotprod += vec · row
+        dotprod_32x4 =
+            _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, row_8x16));
+        // The row sum folds the input offset into a single multiplication.
+        row_sum_32x4 = _mm_add_epi32(
+            row_sum_32x4,
+            _mm_madd_epi16(_mm_maddubs_epi16(_mm_set1_epi8(1), row_8x16),
+                           _mm_set1_epi16(1)));
+        matrix_ptr += kBlockSize;
+      }  // for block
+      const int32_t row_sum = ReduceInt32x4(row_sum_32x4);
+      const int32_t bias_value = bias_vector != nullptr ? bias_vector[row] : 0;
+      int32_t acc =
+          ReduceInt32x4(dotprod_32x4) + bias_value + input_offset * row_sum;
+      acc = MultiplyByQuantizedMultiplier(acc, output_multiplier, output_shift);
+      acc += output_offset;
+      acc = std::max(acc, output_activation_min);
+      acc = std::min(acc, output_activation_max);
+      result[batch * m_rows + row] = static_cast<int8_t>(acc);
+    }  // for row
+  }    // for batch
+}
+
 void SseReductionSumVector(const int8_t* input_vector, int32_t* output_vector,
                            const int output_size, const int reduction_size) {
   static constexpr std::intptr_t kBlockSize = 16;
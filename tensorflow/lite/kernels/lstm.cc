@@ -1927,8 +1927,9 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           projection_weights, projection_bias, params,
           /*forward_sequence=*/true,
           /*time_major=*/true,
-          /*output_offset=*/0, scratch_buffer, output_state, cell_state, output,
-          CpuBackendContext::GetFromContext(context));
+          /*output_offset=*/0, scratch_buffer,
+          /*input_projection_scratch=*/nullptr, output_state, cell_state,
+          output, CpuBackendContext::GetFromContext(context));
     }
     case kTfLiteUInt8:
     case kTfLiteInt8: {
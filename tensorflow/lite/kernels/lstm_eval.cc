@@ -69,6 +69,31 @@ void MatrixBatchVectorMultiplyAccumulate(
   }
 }
 
+// Computes input_to_gate_weights * input + gate_bias for all 'n_rows' rows of
+// the input at once, i.e. for every timestep and batch of a sequence in a
+// single GEMM. The bias is omitted (nullptr) for layer norm LSTM, which adds
+// it after normalization.
+void CalculateLstmInputProjectionFloat(const float* input,
+                                       const float* input_to_gate_weights,
+                                       const float* gate_bias, int n_rows,
+                                       int n_input, int n_cell,
+                                       float* projection,
+                                       CpuBackendContext* context) {
+  tflite::FullyConnectedParams float_fc_params;
+  float_fc_params.float_activation_min = std::numeric_limits<float>::lowest();
+  float_fc_params.float_activation_max = std::numeric_limits<float>::max();
+  float_fc_params.lhs_cacheable = true;
+  float_fc_params.rhs_cacheable = false;
+
+  tflite::RuntimeShape weight_shape({n_cell, n_input});
+  tflite::RuntimeShape input_shape({n_rows, n_input});
+  tflite::RuntimeShape bias_shape({n_cell});
+  tflite::RuntimeShape output_shape({n_rows, n_cell});
+  tflite::optimized_ops::FullyConnected(
+      float_fc_params, input_shape, input, weight_shape, input_to_gate_weights,
+      bias_shape, gate_bias, output_shape, projection, context);
+}
+
 void ComputeRowSums(
     int32_t* input_to_input_row_sums, int32_t* input_to_forget_row_sums,
     int32_t* input_to_cell_row_sums, int32_t* input_to_output_row_sums,
@@ -178,6 +203,10 @@ inline float GetTensorScale(const TfLiteTensor* tensor) {
 //   activation                                 - activation to use.
 //   is_input_all_zeros, is_aux_input_all_zeros - if input vectors are all zero.
 //   use_layer_norm                             - if doing layer norm LSTM.
+// Optional precomputed input projection (may be nullptr):
+//   input_projection - input_to_gate_weights * input, plus gate_bias unless
+//                      layer norm is used. Replaces the input matmul, and
+//                      requires aux_input to be all zeros or missing.
 inline void CalculateLstmGateFloat(
     const float* input, const float* input_to_gate_weights,
     const float* aux_input, const float* aux_input_to_gate_weights,
@@ -188,25 +217,31 @@ inline void CalculateLstmGateFloat(
     const int n_output, const int n_cell,
     const TfLiteFusedActivation activation, float* gate,
     const bool is_input_all_zeros, const bool is_aux_input_all_zeros,
-    float* output, CpuBackendContext* context) {
+    float* input_projection, float* output, CpuBackendContext* context) {
   const bool use_peephole = (cell_to_gate_weights != nullptr);
   const bool use_layer_norm = (layer_norm_coefficients != nullptr);
 
-  // Initialize scratch buffers with bias for regular lstm or initialize with
-  // zero for layer norm lstm.
-  if (use_layer_norm) {
-    std::fill_n(gate, n_cell * n_batch, 0.0f);
-  } else {
-    tensor_utils::VectorBatchVectorAssign(gate_bias, n_cell, n_batch, gate);
-  }
-  // For each batch and cell: compute input_weight * input.
-  // Skip if input is all zeros.
   float* accumulation_buffer = gate;
-  if (!is_input_all_zeros) {
-    MatrixBatchVectorMultiplyAccumulate(input_to_gate_weights, input,
-                                        accumulation_buffer, output, n_cell,
-                                        n_input, n_batch, context);
-    std::swap(accumulation_buffer, output);
+  if (input_projection != nullptr) {
+    // input_weight * input (+ bias for regular lstm) was computed for the
+    // whole sequence by CalculateLstmInputProjectionFloat.
+    accumulation_buffer = input_projection;
+  } else {
+    // Initialize scratch buffers with bias for regular lstm or initialize with
+    // zero for layer norm lstm.
+    if (use_layer_norm) {
+      std::fill_n(gate, n_cell * n_batch, 0.0f);
+    } else {
+      tensor_utils::VectorBatchVectorAssign(gate_bias, n_cell, n_batch, gate);
+    }
+    // For each batch and cell: compute input_weight * input.
+    // Skip if input is all zeros.
+    if (!is_input_all_zeros) {
+      MatrixBatchVectorMultiplyAccumulate(input_to_gate_weights, input,
+                                          accumulation_buffer, output, n_cell,
+                                          n_input, n_batch, context);
+      std::swap(accumulation_buffer, output);
+    }
   }
   // For each batch and cell: compute aux_input_weight * aux_input.
   // Skip if auxiliary input is not available or all zeros.
@@ -847,6 +882,11 @@ void CalculateLstmOutputInteger8x8_8(
 // for bidirectional LSTMs with merge_outputs. In this case, the batched
 // operations cannot be used since they assume that the batched outputs are
 // contiguous, and we manually loop over the batched outputs.
+//
+// If input_projection_ptr is not nullptr, it holds input_to_gate_weights *
+// input_ptr (plus the gate bias unless layer norm is used) for the forget,
+// cell, output and input gates, in that order and input_projection_gate_stride
+// floats apart, and the input matmuls of this step are skipped.
 // LINT.IfChange
 inline void LstmStepFloat(
     const float* input_ptr, const float* input_to_input_weights_ptr,
@@ -875,7 +915,8 @@ inline void LstmStepFloat(
     int n_aux_input, int n_output, int output_batch_leading_dim,
     float* output_state_ptr, float* cell_state_ptr, float* scratch0,
     float* scratch1, float* scratch2, float* scratch3, float* scratch4,
-    float* output_ptr, CpuBackendContext* context) {
+    float* output_ptr, float* input_projection_ptr,
+    int input_projection_gate_stride, CpuBackendContext* context) {
   ruy::profiler::ScopeLabel label("LstmStepFloat");
   // Since we have already checked that weights are all there or none, we can
   // check the existence of only one to the get the condition.
@@ -888,8 +929,22 @@ inline void LstmStepFloat(
   float* output_gate_scratch = scratch3;
   float* accumulation_scratch_buffer = scratch4;
 
+  // Named views of the precomputed input projections.
+  float* forget_gate_projection = nullptr;
+  float* cell_gate_projection = nullptr;
+  float* output_gate_projection = nullptr;
+  float* input_gate_projection = nullptr;
+  if (input_projection_ptr != nullptr) {
+    const int stride = input_projection_gate_stride;
+    forget_gate_projection = input_projection_ptr;
+    cell_gate_projection = input_projection_ptr + stride;
+    output_gate_projection = input_projection_ptr + 2 * stride;
+    if (!use_cifg) input_gate_projection = input_projection_ptr + 3 * stride;
+  }
+
   // Check if inputs are all zeros so we can skip some computations.
   const bool is_input_all_zeros =
+      input_projection_ptr == nullptr &&
       tensor_utils::IsZeroVector(input_ptr, n_batch * n_input);
   const bool is_aux_input_all_zeros =
       (aux_input_ptr == nullptr ||
@@ -907,7 +962,8 @@ inline void LstmStepFloat(
                            n_output, n_cell,
                            /*activation=*/kTfLiteActSigmoid, input_gate_scratch,
                            is_input_all_zeros, is_aux_input_all_zeros,
-                           accumulation_scratch_buffer, context);
+                           input_gate_projection, accumulation_scratch_buffer,
+                           context);
   }
   // Calculate the forget gate.
   CalculateLstmGateFloat(
@@ -919,7 +975,8 @@ inline void LstmStepFloat(
       forget_layer_norm_coefficients_ptr, forget_gate_bias_ptr, n_batch,
       n_input, n_aux_input, n_output, n_cell,
       /*activation=*/kTfLiteActSigmoid, forget_gate_scratch, is_input_all_zeros,
-      is_aux_input_all_zeros, accumulation_scratch_buffer, context);
+      is_aux_input_all_zeros, forget_gate_projection,
+      accumulation_scratch_buffer, context);
   // Calculate the cell update gate.
   CalculateLstmGateFloat(
       input_ptr, input_to_cell_weights_ptr, aux_input_ptr,
@@ -930,7 +987,8 @@ inline void LstmStepFloat(
       /*cell_to_gate_weights=*/nullptr, cell_layer_norm_coefficients_ptr,
       cell_gate_bias_ptr, n_batch, n_input, n_aux_input, n_output, n_cell,
       params->activation, cell_gate_scratch, is_input_all_zeros,
-      is_aux_input_all_zeros, accumulation_scratch_buffer, context);
+      is_aux_input_all_zeros, cell_gate_projection, accumulation_scratch_buffer,
+      context);
   // Update the cell state.
   UpdateLstmCellFloat(n_batch, n_cell, cell_state_ptr, input_gate_scratch,
                       forget_gate_scratch, cell_gate_scratch, use_cifg,
@@ -945,7 +1003,8 @@ inline void LstmStepFloat(
       output_layer_norm_coefficients_ptr, output_gate_bias_ptr, n_batch,
       n_input, n_aux_input, n_output, n_cell,
       /*activation=*/kTfLiteActSigmoid, output_gate_scratch, is_input_all_zeros,
-      is_aux_input_all_zeros, accumulation_scratch_buffer, context);
+      is_aux_input_all_zeros, output_gate_projection,
+      accumulation_scratch_buffer, context);
   // Update the output state.
   CalculateLstmOutputFloat(n_batch, n_cell, n_output, cell_state_ptr,
                            output_gate_scratch, params->activation,
@@ -1767,7 +1826,8 @@ TfLiteStatus EvalFloat(
     const TfLiteTensor* cell_gate_bias, const TfLiteTensor* output_gate_bias,
     const TfLiteTensor* projection_weights, const TfLiteTensor* projection_bias,
     const TfLiteLSTMParams* params, bool forward_sequence, bool time_major,
-    int output_offset, TfLiteTensor* scratch_buffer, TfLiteTensor* output_state,
+    int output_offset, TfLiteTensor* scratch_buffer,
+    TfLiteTensor* input_projection_scratch, TfLiteTensor* output_state,
     TfLiteTensor* cell_state, TfLiteTensor* output,
     CpuBackendContext* context) {
   TF_LITE_ASSERT(input->dims->size >= 2 && input->dims->size <= 3);
@@ -1811,6 +1871,28 @@ TfLiteStatus EvalFloat(
     accumulation_scratch_buffer = scratch_buffer_ptr + 4 * n_cell * n_batch;
   }
 
+  // Compute the input projections of all timesteps upfront, so that only the
+  // recurrent matmuls remain inside the sequence loop. Rows of a projection
+  // follow the rows of the input, in time or batch major order.
+  float* input_projection = nullptr;
+  const int input_projection_gate_stride = max_time * n_batch * n_cell;
+  if (input_projection_scratch != nullptr && aux_input == nullptr) {
+    input_projection = GetTensorData<float>(input_projection_scratch);
+    const bool use_layer_norm = (forget_layer_norm_coefficients != nullptr);
+    const TfLiteTensor* gate_weights[4] = {
+        input_to_forget_weights, input_to_cell_weights,
+        input_to_output_weights, input_to_input_weights};
+    const TfLiteTensor* gate_biases[4] = {forget_gate_bias, cell_gate_bias,
+                                          output_gate_bias, input_gate_bias};
+    for (int gate = 0; gate < (use_cifg ? 3 : 4); ++gate) {
+      CalculateLstmInputProjectionFloat(
+          GetTensorData<float>(input), GetTensorData<float>(gate_weights[gate]),
+          use_layer_norm ? nullptr : GetTensorData<float>(gate_biases[gate]),
+          max_time * n_batch, n_input, n_cell,
+          input_projection + gate * input_projection_gate_stride, context);
+    }
+  }
+
   const int output_batch_leading_dim =
       output->dims->data[output->dims->size - 1];
   if (time_major) {
@@ -1822,6 +1904,9 @@ TfLiteStatus EvalFloat(
       // backwards.
       const int t_rel = forward_sequence ? t : max_time - t - 1;
       const float* input_ptr = GetTensorData<float>(input) + t_rel * input_step;
+      float* input_projection_ptr =
+          input_projection ? input_projection + t_rel * n_batch * n_cell
+                           : nullptr;
       const float* aux_input_ptr = nullptr;
       if (aux_input) {
         aux_input_ptr = GetTensorData<float>(aux_input) + t_rel * input_step;
@@ -1859,7 +1944,7 @@ TfLiteStatus EvalFloat(
           GetTensorData<float>(output_state), GetTensorData<float>(cell_state),
           input_gate_scratch, forget_gate_scratch, cell_gate_scratch,
           output_gate_scratch, accumulation_scratch_buffer, output_ptr,
-          context);
+          input_projection_ptr, input_projection_gate_stride, context);
     }
   } else {
     for (int b = 0; b < n_batch; b++) {
@@ -1879,6 +1964,9 @@ TfLiteStatus EvalFloat(
         }
         float* output_ptr = GetTensorData<float>(output) +
                             time_offset * output_step + output_offset;
+        float* input_projection_ptr =
+            input_projection ? input_projection + time_offset * n_cell
+                             : nullptr;
 
         // Offset the {output,cell}_state pointers to the right batch.
         float* output_state_ptr =
@@ -1921,7 +2009,7 @@ TfLiteStatus EvalFloat(
             output_state_ptr, cell_state_ptr, input_gate_scratch_ptr,
             forget_gate_scratch_ptr, cell_gate_scratch_ptr,
             output_gate_scratch_ptr, accumulation_scratch_buffer, output_ptr,
-            context);
+            input_projection_ptr, input_projection_gate_stride, context);
       }
     }
   }
@@ -95,6 +95,10 @@ struct IntegerLstmParameter {
   int32_t intermediate_zp[12];
 };
 
+// `input_projection_scratch` may be nullptr. Otherwise it holds
+// max_time * n_batch * n_cell floats per gate (3 gates with CIFG, 4 without),
+// and the input projections of the whole sequence are computed with one GEMM
+// per gate before the recurrent loop. It is not used with an aux_input.
 TfLiteStatus EvalFloat(
     const TfLiteTensor* input, const TfLiteTensor* input_to_input_weights,
     const TfLiteTensor* input_to_forget_weights,
@@ -120,7 +124,8 @@ TfLiteStatus EvalFloat(
     const TfLiteTensor* cell_gate_bias, const TfLiteTensor* output_gate_bias,
     const TfLiteTensor* projection_weights, const TfLiteTensor* projection_bias,
     const TfLiteLSTMParams* params, bool forward_sequence, bool time_major,
-    int output_offset, TfLiteTensor* scratch_buffer, TfLiteTensor* output_state,
+    int output_offset, TfLiteTensor* scratch_buffer,
+    TfLiteTensor* input_projection_scratch, TfLiteTensor* output_state,
     TfLiteTensor* cell_state, TfLiteTensor* output, CpuBackendContext* context);
 
 TfLiteStatus EvalHybrid(
@@ -398,9 +398,16 @@ enum TemporaryTensor {
   kInputZeroPoints = 9,
   kOutputStateZeroPoints = 10,
   kRowSums = 11,
-  kNumTemporaryTensors = 12,
+  kNumHybridTemporaryTensors = 12,
+  // The input projections of the whole sequence for the float kernel.
+  kInputProjection = 12,
+  kNumTemporaryTensors = 13,
 };
 
+// The float kernel only uses the scratch buffer and the input projections,
+// which take this position in node->temporaries.
+constexpr int kFloatInputProjectionSlot = 1;
+
 void* Init(TfLiteContext* context, const char* buffer, size_t length) {
   auto* op_data = new OpData();
   context->AddTensors(context, kNumTemporaryTensors,
@@ -949,11 +956,11 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
 
   TfLiteIntArrayFree(node->temporaries);
   if (IsHybridOp(input, input_to_output_weights)) {
-    node->temporaries = TfLiteIntArrayCreate(kNumTemporaryTensors);
+    node->temporaries = TfLiteIntArrayCreate(kNumHybridTemporaryTensors);
   } else if (is_integer) {
     node->temporaries = TfLiteIntArrayCreate(6);
   } else {
-    node->temporaries = TfLiteIntArrayCreate(1);
+    node->temporaries = TfLiteIntArrayCreate(2);
   }
   node->temporaries->data[kScratchBuffer] =
       scratch_tensor_index + kScratchBuffer;
@@ -982,6 +989,33 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_OK(context, context->ResizeTensor(context, scratch_buffer,
                                                    scratch_buffer_size));
 
+  if (input->type == kTfLiteFloat32 &&
+      input_to_output_weights->type == kTfLiteFloat32) {
+    // Allocate the input projections of all timesteps, one matrix per gate.
+    node->temporaries->data[kFloatInputProjectionSlot] =
+        scratch_tensor_index + kInputProjection;
+    TfLiteTensor* input_projection;
+    TF_LITE_ENSURE_OK(context,
+                      GetTemporarySafe(context, node, kFloatInputProjectionSlot,
+                                       &input_projection));
+    input_projection->type = kTfLiteFloat32;
+    input_projection->allocation_type = kTfLiteArenaRw;
+    const int max_time =
+        time_major ? input->dims->data[0] : input->dims->data[1];
+    const int input_projection_dims[3] = {use_cifg ? 3 : 4, max_time * n_batch,
+                                          n_cell};
+    if (!TfLiteIntArrayEqualsArray(input_projection->dims, 3,
+                                   input_projection_dims)) {
+      TfLiteIntArray* input_projection_size = TfLiteIntArrayCreate(3);
+      input_projection_size->data[0] = input_projection_dims[0];
+      input_projection_size->data[1] = input_projection_dims[1];
+      input_projection_size->data[2] = input_projection_dims[2];
+      TF_LITE_ENSURE_OK(context,
+                        context->ResizeTensor(context, input_projection,
+                                              input_projection_size));
+    }
+  }
+
   if (IsHybridOp(input, input_to_output_weights)) {
     op_data->compute_row_sums = true;
     // Allocate temporary tensors to store quantized values of input,
@@ -1328,6 +1362,10 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
       TfLiteTensor* scratch_buffer;
       TF_LITE_ENSURE_OK(context, GetTemporarySafe(context, node, kScratchBuffer,
                                                   &scratch_buffer));
+      TfLiteTensor* input_projection;
+      TF_LITE_ENSURE_OK(context, GetTemporarySafe(context, node,
+                                                  kFloatInputProjectionSlot,
+                                                  &input_projection));
       return lstm_eval::EvalFloat(
           input, input_to_input_weights, input_to_forget_weights,
           input_to_cell_weights, input_to_output_weights,
@@ -1344,8 +1382,8 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           forget_gate_bias, cell_gate_bias, output_gate_bias,
           projection_weights, projection_bias, &lstm_params,
           /*forward_sequence=*/true, time_major,
-          /*output_offset=*/0, scratch_buffer, output_state, cell_state, output,
-          CpuBackendContext::GetFromContext(context));
+          /*output_offset=*/0, scratch_buffer, input_projection, output_state,
+          cell_state, output, CpuBackendContext::GetFromContext(context));
     }
     case kTfLiteUInt8:
     case kTfLiteInt8: {
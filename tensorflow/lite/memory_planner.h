@@ -62,6 +62,14 @@ class MemoryPlanner {
   // Returns true if the non-persistent memory is available.
   virtual bool HasNonPersistentMemory() = 0;
 
+  // Declares that the execution plan is split into stages of consecutive nodes
+  // that may run concurrently: `stage_ends[i]` is the last execution plan
+  // index of the stage that index `i` belongs to. An empty vector means that
+  // all nodes run one at a time. Planners that let tensors share memory must
+  // keep every tensor used by a node of a stage allocated until the end of the
+  // stage. Takes effect at the next PlanAllocations().
+  virtual void SetStageEnds(const std::vector<int>& stage_ends) = 0;
+
   // Dumps the memory planning information against the specified op node
   // execution plan (i.e. `execution_plan`) for the purpose of debugging.
   virtual void DumpDebugInfo(const std::vector<int>& execution_plan) const = 0;
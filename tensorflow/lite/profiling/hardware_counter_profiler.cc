@@ -0,0 +1,203 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/hardware_counter_profiler.h"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "tensorflow/lite/profiling/time.h"
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+#if defined(__linux__)
+// Opens a user space counter of the calling thread in the group of
+// `group_fd`, or as a new, disabled group leader if `group_fd` is -1.
+int OpenCounter(uint64_t config, int group_fd) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, group_fd, /*flags=*/0));
+}
+#endif
+
+double PerInvocation(uint64_t total, int64_t invocations) {
+  return invocations > 0 ? static_cast<double>(total) / invocations : 0.0;
+}
+
+}  // namespace
+
+HardwareCounterProfiler::HardwareCounterProfiler() {
+  for (int i = 0; i < kNumCounters; ++i) read_index_[i] = -1;
+#if defined(__linux__)
+  const uint64_t configs[kNumCounters] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+  group_fd_ = OpenCounter(configs[kCycles], /*group_fd=*/-1);
+  if (group_fd_ < 0) return;
+  fds_.push_back(group_fd_);
+  read_index_[kCycles] = 0;
+  for (int i = kCycles + 1; i < kNumCounters; ++i) {
+    const int fd = OpenCounter(configs[i], group_fd_);
+    if (fd < 0) continue;
+    read_index_[i] = static_cast<int>(fds_.size());
+    fds_.push_back(fd);
+  }
+  ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+HardwareCounterProfiler::~HardwareCounterProfiler() {
+#if defined(__linux__)
+  // Close the group members before the leader.
+  for (auto it = fds_.rbegin(); it != fds_.rend(); ++it) close(*it);
+#endif
+}
+
+void HardwareCounterProfiler::ReadCounters(
+    uint64_t counts[kNumCounters]) const {
+  for (int i = 0; i < kNumCounters; ++i) counts[i] = 0;
+#if defined(__linux__)
+  if (group_fd_ < 0) return;
+  // Layout of a PERF_FORMAT_GROUP read: the number of counters followed by
+  // their values, in the order they joined the group.
+  uint64_t values[1 + kNumCounters];
+  const ssize_t size = read(group_fd_, values, sizeof(values));
+  if (size < static_cast<ssize_t>(sizeof(uint64_t))) return;
+  for (int i = 0; i < kNumCounters; ++i) {
+    if (read_index_[i] >= 0 &&
+        static_cast<uint64_t>(read_index_[i]) < values[0]) {
+      counts[i] = values[1 + read_index_[i]];
+    }
+  }
+#endif
+}
+
+uint32_t HardwareCounterProfiler::BeginEvent(const char* tag,
+                                             EventType event_type,
+                                             int64_t event_metadata1,
+                                             int64_t event_metadata2) {
+  if (!enabled_ || event_type != EventType::OPERATOR_INVOKE_EVENT) return 0;
+  const uint32_t handle = next_handle_++;
+  if (next_handle_ == 0) next_handle_ = 1;
+
+  ActiveEvent& event = active_events_[handle];
+  event.key = {event_metadata2, event_metadata1};
+  OperatorCounters& op_counters = counters_[event.key];
+  if (op_counters.invocations == 0) {
+    op_counters.subgraph_index = event_metadata2;
+    op_counters.node_index = event_metadata1;
+    op_counters.tag = tag ? tag : "";
+  }
+  event.begin_us = time::NowMicros();
+  // Read the counters last, so that the bookkeeping above is not counted.
+  ReadCounters(event.begin_counts);
+  return handle;
+}
+
+void HardwareCounterProfiler::EndEvent(uint32_t event_handle) {
+  uint64_t end_counts[kNumCounters];
+  ReadCounters(end_counts);
+  const uint64_t end_us = time::NowMicros();
+
+  const auto it = active_events_.find(event_handle);
+  if (it == active_events_.end()) return;
+  const ActiveEvent& event = it->second;
+  OperatorCounters& op_counters = counters_[event.key];
+  op_counters.invocations++;
+  op_counters.elapsed_us += end_us - event.begin_us;
+  op_counters.cycles += end_counts[kCycles] - event.begin_counts[kCycles];
+  op_counters.instructions +=
+      end_counts[kInstructions] - event.begin_counts[kInstructions];
+  op_counters.cache_references +=
+      end_counts[kCacheReferences] - event.begin_counts[kCacheReferences];
+  op_counters.cache_misses +=
+      end_counts[kCacheMisses] - event.begin_counts[kCacheMisses];
+  active_events_.erase(it);
+}
+
+void HardwareCounterProfiler::Reset() {
+  active_events_.clear();
+  counters_.clear();
+}
+
+std::vector<OperatorCounters> HardwareCounterProfiler::GetOperatorCounters()
+    const {
+  std::vector<OperatorCounters> result;
+  result.reserve(counters_.size());
+  for (const auto& entry : counters_) {
+    if (entry.second.invocations > 0) result.push_back(entry.second);
+  }
+  return result;
+}
+
+std::string FormatOperatorCounters(
+    const std::vector<OperatorCounters>& counters, int cache_line_bytes) {
+  std::stringstream stream;
+  stream << "Hardware counters per operator invocation:\n";
+  stream << std::setw(8) << "subgraph" << std::setw(6) << "node"
+         << std::setw(28) << "op" << std::setw(8) << "count" << std::setw(12)
+         << "avg_us" << std::setw(14) << "cycles" << std::setw(14)
+         << "instructions" << std::setw(7) << "IPC" << std::setw(12)
+         << "miss_rate" << std::setw(14) << "miss_bytes" << std::setw(14)
+         << "tensor_bytes" << std::setw(12) << "miss_MB/s" << "\n";
+  for (const auto& op : counters) {
+    const int64_t n = op.invocations;
+    const double avg_us = PerInvocation(op.elapsed_us, n);
+    const double miss_bytes =
+        PerInvocation(op.cache_misses, n) * cache_line_bytes;
+    const double ipc =
+        op.cycles > 0 ? static_cast<double>(op.instructions) / op.cycles : 0.0;
+    const double miss_rate =
+        op.cache_references > 0
+            ? static_cast<double>(op.cache_misses) / op.cache_references
+            : 0.0;
+    // Bytes per microsecond is MB/s.
+    const double miss_mb_per_s = avg_us > 0 ? miss_bytes / avg_us : 0.0;
+    stream << std::setw(8) << op.subgraph_index << std::setw(6)
+           << op.node_index << std::setw(28) << op.tag << std::setw(8) << n
+           << std::fixed << std::setprecision(1) << std::setw(12) << avg_us
+           << std::setprecision(0) << std::setw(14)
+           << PerInvocation(op.cycles, n) << std::setw(14)
+           << PerInvocation(op.instructions, n) << std::setprecision(2)
+           << std::setw(7) << ipc << std::setw(12) << miss_rate
+           << std::setprecision(0) << std::setw(14) << miss_bytes
+           << std::setw(14) << op.tensor_bytes << std::setprecision(1)
+           << std::setw(12) << miss_mb_per_s << "\n";
+  }
+  return stream.str();
+}
+
+}  // namespace profiling
+}  // namespace tflite
@@ -0,0 +1,125 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_HARDWARE_COUNTER_PROFILER_H_
+#define TENSORFLOW_LITE_PROFILING_HARDWARE_COUNTER_PROFILER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/api/profiler.h"
+
+namespace tflite {
+namespace profiling {
+
+// Hardware counter totals of one operator, accumulated over all of its
+// invocations while profiling was enabled.
+struct OperatorCounters {
+  int64_t subgraph_index = 0;
+  int64_t node_index = 0;
+  std::string tag;
+  int64_t invocations = 0;
+  uint64_t elapsed_us = 0;
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t cache_references = 0;
+  uint64_t cache_misses = 0;
+  // Bytes of the operator's input, output and temporary tensors, for one
+  // invocation. Not measured by the profiler; filled in by its user.
+  uint64_t tensor_bytes = 0;
+};
+
+// A profiler that reads Linux perf_event hardware counters (cycles,
+// instructions, cache references and cache misses) around every operator
+// invocation.
+//
+// The counters are opened for the thread that constructs the profiler, which
+// must be the thread calling Interpreter::Invoke(). Work that kernels hand off
+// to other threads is not counted, so the numbers are complete only when the
+// interpreter runs single-threaded. Operators that invoke subgraphs include
+// the counts of the nested operators. Wall time and invocation counts are
+// recorded even when the counters are not available, e.g. on other platforms
+// or when /proc/sys/kernel/perf_event_paranoid forbids user space counting.
+//
+// Like BufferedProfiler, this class is not thread safe.
+class HardwareCounterProfiler : public tflite::Profiler {
+ public:
+  HardwareCounterProfiler();
+  ~HardwareCounterProfiler() override;
+
+  HardwareCounterProfiler(const HardwareCounterProfiler&) = delete;
+  HardwareCounterProfiler& operator=(const HardwareCounterProfiler&) = delete;
+
+  // Returns whether hardware counters could be opened.
+  bool HasHardwareCounters() const { return group_fd_ >= 0; }
+
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override;
+
+  void EndEvent(uint32_t event_handle) override;
+
+  void StartProfiling() { enabled_ = true; }
+  void StopProfiling() { enabled_ = false; }
+  void Reset();
+
+  // Returns the counters of each profiled operator, ordered by subgraph and
+  // node index.
+  std::vector<OperatorCounters> GetOperatorCounters() const;
+
+ private:
+  enum Counter {
+    kCycles = 0,
+    kInstructions,
+    kCacheReferences,
+    kCacheMisses,
+    kNumCounters,
+  };
+
+  struct ActiveEvent {
+    std::pair<int64_t, int64_t> key;
+    uint64_t begin_us;
+    uint64_t begin_counts[kNumCounters];
+  };
+
+  // Reads the current value of every counter; counters that could not be
+  // opened read as zero.
+  void ReadCounters(uint64_t counts[kNumCounters]) const;
+
+  bool enabled_ = false;
+  // The group leader, measuring cycles, or -1 without hardware counters.
+  int group_fd_ = -1;
+  std::vector<int> fds_;
+  // Position of each counter in a group read, or -1 if it is not available.
+  int read_index_[kNumCounters];
+
+  uint32_t next_handle_ = 1;
+  std::map<uint32_t, ActiveEvent> active_events_;
+  // Keyed by (subgraph index, node index).
+  std::map<std::pair<int64_t, int64_t>, OperatorCounters> counters_;
+};
+
+// Returns a table of per-invocation averages of `counters`, suitable for the
+// benchmark tool's summary. The estimated miss traffic assumes
+// `cache_line_bytes` are transferred per cache miss.
+std::string FormatOperatorCounters(
+    const std::vector<OperatorCounters>& counters, int cache_line_bytes = 64);
+
+}  // namespace profiling
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PROFILING_HARDWARE_COUNTER_PROFILER_H_
@@ -0,0 +1,118 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/hardware_counter_profiler.h"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+using ::testing::HasSubstr;
+
+void InvokeOperator(HardwareCounterProfiler* profiler, const char* tag,
+                    int node_index, int subgraph_index) {
+  const uint32_t handle = profiler->BeginEvent(
+      tag, Profiler::EventType::OPERATOR_INVOKE_EVENT, node_index,
+      subgraph_index);
+  // Give the counters something to count.
+  volatile int sum = 0;
+  for (int i = 0; i < 1000; ++i) sum = sum + i;
+  profiler->EndEvent(handle);
+}
+
+TEST(HardwareCounterProfilerTest, AccumulatesPerOperator) {
+  HardwareCounterProfiler profiler;
+  profiler.StartProfiling();
+  for (int run = 0; run < 3; ++run) {
+    InvokeOperator(&profiler, "ADD", /*node_index=*/1, /*subgraph_index=*/0);
+    InvokeOperator(&profiler, "CONV_2D", /*node_index=*/0,
+                   /*subgraph_index=*/0);
+  }
+  InvokeOperator(&profiler, "ADD", /*node_index=*/0, /*subgraph_index=*/1);
+
+  const std::vector<OperatorCounters> counters =
+      profiler.GetOperatorCounters();
+  ASSERT_EQ(counters.size(), 3);
+  EXPECT_EQ(counters[0].tag, "CONV_2D");
+  EXPECT_EQ(counters[0].invocations, 3);
+  EXPECT_EQ(counters[1].tag, "ADD");
+  EXPECT_EQ(counters[1].node_index, 1);
+  EXPECT_EQ(counters[1].invocations, 3);
+  EXPECT_EQ(counters[2].subgraph_index, 1);
+  EXPECT_EQ(counters[2].invocations, 1);
+  if (profiler.HasHardwareCounters()) {
+    EXPECT_GT(counters[0].instructions, 0);
+  } else {
+    EXPECT_EQ(counters[0].instructions, 0);
+  }
+}
+
+TEST(HardwareCounterProfilerTest, IgnoresEventsWhenDisabled) {
+  HardwareCounterProfiler profiler;
+  InvokeOperator(&profiler, "ADD", /*node_index=*/0, /*subgraph_index=*/0);
+  EXPECT_TRUE(profiler.GetOperatorCounters().empty());
+
+  profiler.StartProfiling();
+  InvokeOperator(&profiler, "ADD", /*node_index=*/0, /*subgraph_index=*/0);
+  profiler.StopProfiling();
+  InvokeOperator(&profiler, "ADD", /*node_index=*/0, /*subgraph_index=*/0);
+  ASSERT_EQ(profiler.GetOperatorCounters().size(), 1);
+  EXPECT_EQ(profiler.GetOperatorCounters()[0].invocations, 1);
+
+  profiler.Reset();
+  EXPECT_TRUE(profiler.GetOperatorCounters().empty());
+}
+
+TEST(HardwareCounterProfilerTest, IgnoresOtherEventTypes) {
+  HardwareCounterProfiler profiler;
+  profiler.StartProfiling();
+  const uint32_t handle = profiler.BeginEvent(
+      "Invoke", Profiler::EventType::DEFAULT, /*event_metadata1=*/0,
+      /*event_metadata2=*/0);
+  profiler.EndEvent(handle);
+  EXPECT_TRUE(profiler.GetOperatorCounters().empty());
+}
+
+TEST(HardwareCounterProfilerTest, FormatsAveragesPerInvocation) {
+  OperatorCounters op;
+  op.subgraph_index = 0;
+  op.node_index = 2;
+  op.tag = "FULLY_CONNECTED";
+  op.invocations = 2;
+  op.elapsed_us = 20;
+  op.cycles = 4000;
+  op.instructions = 8000;
+  op.cache_references = 100;
+  op.cache_misses = 50;
+  op.tensor_bytes = 4096;
+
+  const std::string output = FormatOperatorCounters({op});
+  EXPECT_THAT(output, HasSubstr("FULLY_CONNECTED"));
+  // 4000 instructions over 2000 cycles per invocation.
+  EXPECT_THAT(output, HasSubstr(" 2.00"));
+  // 25 misses of 64 bytes in 10us per invocation.
+  EXPECT_THAT(output, HasSubstr(" 1600"));
+  EXPECT_THAT(output, HasSubstr(" 160.0"));
+  EXPECT_THAT(output, HasSubstr(" 4096"));
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace tflite
@@ -114,6 +114,13 @@ TfLiteStatus SimpleMemoryArena::Deallocate(
 TfLiteStatus SimpleMemoryArena::Commit(TfLiteContext* context) {
   size_t required_size = RequiredBufferSize();
   if (required_size > underlying_buffer_size_) {
+    // Grow an existing buffer geometrically, so that plans that keep growing
+    // a little, e.g. for inputs of increasing length, don't reallocate and
+    // copy it every time.
+    if (underlying_buffer_size_ > 0) {
+      required_size = std::max(
+          required_size, underlying_buffer_size_ + underlying_buffer_size_ / 2);
+    }
     char* new_alloc = new char[required_size];
     char* new_underlying_buffer_aligned_ptr = reinterpret_cast<char*>(
         AlignTo(arena_alignment_, reinterpret_cast<intptr_t>(new_alloc)));
@@ -117,6 +117,23 @@ TEST(SimpleMemoryArenaTest, TestClearPlan) {
   EXPECT_EQ(allocs[8].offset, 8192);
 }
 
+TEST(SimpleMemoryArenaTest, GrowsBufferGeometrically) {
+  TfLiteContext context;
+  SimpleMemoryArena arena(64);
+  ArenaAllocWithUsageInterval allocs[2];
+
+  ASSERT_EQ(arena.Allocate(&context, 32, 1000, 0, 0, 2, &allocs[0]), kTfLiteOk);
+  ASSERT_EQ(arena.Commit(&context), kTfLiteOk);
+  const size_t buffer_size = arena.GetBufferSize();
+  EXPECT_EQ(buffer_size, arena.RequiredBufferSize());
+
+  // A slightly larger plan grows the buffer by half.
+  ASSERT_EQ(arena.Allocate(&context, 32, 10, 1, 0, 2, &allocs[1]), kTfLiteOk);
+  ASSERT_LT(buffer_size, arena.RequiredBufferSize());
+  ASSERT_EQ(arena.Commit(&context), kTfLiteOk);
+  EXPECT_EQ(arena.GetBufferSize(), buffer_size + buffer_size / 2);
+}
+
 TEST(SimpleMemoryArenaTest, TestClearBuffer) {
   TfLiteContext context;
   context.ReportError = ReportError;
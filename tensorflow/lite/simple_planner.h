@@ -91,6 +91,8 @@ class SimplePlanner : public MemoryPlanner {
   TfLiteStatus AcquireNonPersistentMemory() override;
   bool HasNonPersistentMemory() override { return true; };
   void DumpDebugInfo(const std::vector<int>& execution_plan) const override{};
+  // Tensors never share memory, so stages need no special treatment.
+  void SetStageEnds(const std::vector<int>& stage_ends) override {}
 
  private:
   // Free all the all allocations.
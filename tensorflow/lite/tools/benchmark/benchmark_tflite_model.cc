@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdarg>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -45,6 +46,7 @@ limitations under the License.
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 #include "tensorflow/lite/string_util.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_utils.h"
+#include "tensorflow/lite/tools/benchmark/delegate_partitioner.h"
 #include "tensorflow/lite/tools/benchmark/profiling_listener.h"
 #include "tensorflow/lite/tools/delegates/delegate_provider.h"
 #include "tensorflow/lite/tools/logging.h"
@@ -327,6 +329,8 @@ BenchmarkParams BenchmarkTfLiteModel::DefaultParams() {
                           BenchmarkParam::Create<bool>(false));
   default_params.AddParam("profiling_output_csv_file",
                           BenchmarkParam::Create<std::string>(""));
+  default_params.AddParam("enable_hardware_counters",
+                          BenchmarkParam::Create<bool>(false));
 
   default_params.AddParam("print_preinvoke_state",
                           BenchmarkParam::Create<bool>(false));
@@ -336,6 +340,12 @@ BenchmarkParams BenchmarkTfLiteModel::DefaultParams() {
                           BenchmarkParam::Create<bool>(false));
   default_params.AddParam("optimize_memory_for_large_tensors",
                           BenchmarkParam::Create<int32_t>(0));
+  default_params.AddParam("partition_delegates",
+                          BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("partition_plan_file",
+                          BenchmarkParam::Create<std::string>(""));
+  default_params.AddParam("partition_num_runs",
+                          BenchmarkParam::Create<int32_t>(10));
 
   tools::ProvidedDelegateList delegate_providers(&default_params);
   delegate_providers.AddAllDelegateParams();
@@ -398,6 +408,9 @@ std::vector<Flag> BenchmarkTfLiteModel::GetFlags() {
           "profiling_output_csv_file", &params_,
           "File path to export profile data as CSV, if not set "
           "prints to stdout."),
+      CreateFlag<bool>("enable_hardware_counters", &params_,
+                       "report per-op hardware counters and estimated memory "
+                       "traffic (Linux only)"),
       CreateFlag<bool>(
           "print_preinvoke_state", &params_,
           "print out the interpreter internals just before calling Invoke. The "
@@ -412,7 +425,23 @@ std::vector<Flag> BenchmarkTfLiteModel::GetFlags() {
                        "are not used."),
       CreateFlag<int32_t>(
           "optimize_memory_for_large_tensors", &params_,
-          "Optimize memory usage for large tensors with sacrificing latency.")};
+          "Optimize memory usage for large tensors with sacrificing latency."),
+      CreateFlag<bool>(
+          "partition_delegates", &params_,
+          "measure the latency of each node with the CPU kernels and with each "
+          "of the enabled delegates, and only let each delegate run the nodes "
+          "for which it minimizes the estimated model latency, including the "
+          "cost of moving data between delegates. The default XNNPACK "
+          "delegate is not applied in this mode."),
+      CreateFlag<std::string>(
+          "partition_plan_file", &params_,
+          "file caching the partitioning chosen by --partition_delegates for "
+          "this model and set of delegates. The measurements are skipped when "
+          "the file holds a matching partitioning, and it is written "
+          "otherwise."),
+      CreateFlag<int32_t>("partition_num_runs", &params_,
+                          "number of runs averaged for each measurement of "
+                          "--partition_delegates.")};
 
   flags.insert(flags.end(), specific_flags.begin(), specific_flags.end());
 
@@ -447,6 +476,8 @@ void BenchmarkTfLiteModel::LogParams() {
                       verbose);
   LOG_BENCHMARK_PARAM(std::string, "profiling_output_csv_file",
                       "CSV File to export profiling data to", verbose);
+  LOG_BENCHMARK_PARAM(bool, "enable_hardware_counters",
+                      "Enable hardware counters", verbose);
   LOG_BENCHMARK_PARAM(bool, "print_preinvoke_state",
                       "Print pre-invoke interpreter state", verbose);
   LOG_BENCHMARK_PARAM(bool, "print_postinvoke_state",
@@ -455,6 +486,12 @@ void BenchmarkTfLiteModel::LogParams() {
                       "Release dynamic tensor memory", verbose);
   LOG_BENCHMARK_PARAM(int32_t, "optimize_memory_for_large_tensors",
                       "Optimize memory usage for large tensors", verbose);
+  LOG_BENCHMARK_PARAM(bool, "partition_delegates", "Partition delegates",
+                      verbose);
+  LOG_BENCHMARK_PARAM(std::string, "partition_plan_file",
+                      "Delegate partition plan file", verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "partition_num_runs",
+                      "Runs per delegate partition measurement", verbose);
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -659,6 +696,12 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   }
 
   AddOwnedListener(MayCreateProfilingListener());
+  // Added after the profiling listener, which replaces any profiler already
+  // installed on the interpreter.
+  if (params_.Get<bool>("enable_hardware_counters")) {
+    AddOwnedListener(std::unique_ptr<BenchmarkListener>(
+        new HardwareCounterListener(interpreter_.get())));
+  }
   AddOwnedListener(std::unique_ptr<BenchmarkListener>(
       new InterpreterStatePrinter(interpreter_.get())));
 
@@ -678,6 +721,9 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   std::unordered_set<int> checked_node_ids;
   tools::ProvidedDelegateList delegate_providers(&params_);
   auto created_delegates = delegate_providers.CreateAllRankedDelegates();
+  if (params_.Get<bool>("partition_delegates") && !created_delegates.empty()) {
+    TF_LITE_ENSURE_STATUS(PartitionDelegates(&created_delegates));
+  }
   TFLITE_MAY_LOG(INFO, (created_delegates.size() >= 2))
       << "Going to apply " << created_delegates.size()
       << " delegates one after another.";
@@ -790,6 +836,200 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   return kTfLiteOk;
 }
 
+TfLiteStatus BenchmarkTfLiteModel::PartitionDelegates(
+    std::vector<tools::ProvidedDelegateList::ProvidedDelegate>* delegates) {
+  const std::vector<int> execution_plan = interpreter_->execution_plan();
+  DelegatePartitionPlan plan;
+  plan.model_fingerprint = FingerprintModel(model_->allocation()->base(),
+                                            model_->allocation()->bytes());
+  plan.backends.push_back("CPU");
+  for (const auto& delegate : *delegates) {
+    plan.backends.push_back(delegate.provider->GetName());
+  }
+
+  const std::string plan_file = params_.Get<std::string>("partition_plan_file");
+  DelegatePartitionPlan cached_plan;
+  if (!plan_file.empty() &&
+      LoadDelegatePartitionPlan(plan_file, &cached_plan) == kTfLiteOk &&
+      cached_plan.model_fingerprint == plan.model_fingerprint &&
+      cached_plan.backends == plan.backends &&
+      cached_plan.node_backends.size() == execution_plan.size()) {
+    TFLITE_LOG(INFO) << "Loaded delegate partitioning from " << plan_file;
+    plan.node_backends = std::move(cached_plan.node_backends);
+  } else {
+    TF_LITE_ENSURE_STATUS(MeasureDelegatePartitions(
+        *delegates, execution_plan, &plan.node_backends));
+    if (!plan_file.empty() &&
+        SaveDelegatePartitionPlan(plan_file, plan) == kTfLiteOk) {
+      TFLITE_LOG(INFO) << "Saved delegate partitioning to " << plan_file;
+    }
+  }
+
+  for (int d = 0; d < delegates->size(); ++d) {
+    std::vector<int> nodes;
+    for (int i = 0; i < execution_plan.size(); ++i) {
+      if (plan.node_backends[i] == d + 1) nodes.push_back(execution_plan[i]);
+    }
+    TFLITE_LOG(INFO) << plan.backends[d + 1] << " delegate is assigned "
+                     << nodes.size() << " of " << execution_plan.size()
+                     << " nodes.";
+    auto& delegate = (*delegates)[d].delegate;
+    delegate = CreateNodeSubsetDelegate(std::move(delegate), nodes);
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::MeasureDelegatePartitions(
+    const std::vector<tools::ProvidedDelegateList::ProvidedDelegate>&
+        delegates,
+    const std::vector<int>& execution_plan, std::vector<int>* node_backends) {
+  std::vector<BackendTimings> backends(delegates.size() + 1);
+  std::unordered_map<int, double> node_latency_us;
+  std::vector<int> delegate_kernels;
+  TF_LITE_ENSURE_STATUS(RunPartitionTrial(/*provider=*/nullptr, {},
+                                          &node_latency_us, &delegate_kernels));
+  backends[0].name = "CPU";
+  for (int node_index : execution_plan) {
+    backends[0].node_latency_us.push_back(node_latency_us[node_index]);
+  }
+
+  for (int d = 0; d < delegates.size(); ++d) {
+    const tools::DelegateProvider* provider = delegates[d].provider;
+    BackendTimings& backend = backends[d + 1];
+    backend.name = provider->GetName();
+    backend.node_latency_us.assign(execution_plan.size(), -1);
+    TFLITE_LOG(INFO) << "Measuring the nodes of the model with the "
+                     << backend.name << " delegate.";
+
+    // Time each node when it is the only one run by the delegate.
+    std::vector<int> supported_nodes;
+    for (int i = 0; i < execution_plan.size(); ++i) {
+      const int node_index = execution_plan[i];
+      node_latency_us.clear();
+      delegate_kernels.clear();
+      if (RunPartitionTrial(provider, {node_index}, &node_latency_us,
+                            &delegate_kernels) != kTfLiteOk ||
+          node_latency_us.count(node_index) || delegate_kernels.empty()) {
+        continue;
+      }
+      double latency_us = 0;
+      for (int kernel : delegate_kernels) latency_us += node_latency_us[kernel];
+      backend.node_latency_us[i] = latency_us;
+      supported_nodes.push_back(node_index);
+    }
+    TFLITE_LOG(INFO) << backend.name << " delegate supports "
+                     << supported_nodes.size() << " of "
+                     << execution_plan.size() << " nodes.";
+    if (supported_nodes.size() < 2) continue;
+
+    // Time all supported nodes together, which tells how much latency the
+    // nodes of a partition save by sharing data transfers and launches.
+    node_latency_us.clear();
+    delegate_kernels.clear();
+    if (RunPartitionTrial(provider, supported_nodes, &node_latency_us,
+                          &delegate_kernels) != kTfLiteOk) {
+      continue;
+    }
+    double separate_latency_us = 0;
+    int num_delegated_nodes = 0;
+    for (int i = 0; i < execution_plan.size(); ++i) {
+      if (backend.node_latency_us[i] >= 0 &&
+          !node_latency_us.count(execution_plan[i])) {
+        separate_latency_us += backend.node_latency_us[i];
+        ++num_delegated_nodes;
+      }
+    }
+    double merged_latency_us = 0;
+    for (int kernel : delegate_kernels) {
+      merged_latency_us += node_latency_us[kernel];
+    }
+    const int num_merged_nodes =
+        num_delegated_nodes - static_cast<int>(delegate_kernels.size());
+    if (num_merged_nodes > 0) {
+      backend.partition_saving_us = std::max(
+          0.0, (separate_latency_us - merged_latency_us) / num_merged_nodes);
+    }
+  }
+
+  double latency_us = 0;
+  *node_backends = PlanDelegatePartitions(backends, &latency_us);
+  if (node_backends->empty() && !execution_plan.empty()) {
+    TFLITE_LOG(ERROR) << "Failed to partition the model between delegates.";
+    return kTfLiteError;
+  }
+  TFLITE_LOG(INFO) << "Estimated latency of the chosen partitioning: "
+                   << latency_us << " us (CPU only: "
+                   << EstimatePartitionsLatency(
+                          backends,
+                          std::vector<int>(execution_plan.size(), 0))
+                   << " us).";
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::RunPartitionTrial(
+    const tools::DelegateProvider* provider, const std::vector<int>& nodes,
+    std::unordered_map<int, double>* node_latency_us,
+    std::vector<int>* delegate_kernels) {
+  // The interpreter becomes dependent on the delegate once the delegate is
+  // used, so the delegate has to outlive the interpreter.
+  tools::TfLiteDelegatePtr delegate = tools::CreateNullDelegate();
+  std::unique_ptr<Interpreter> interpreter;
+  auto resolver = GetOpResolver();
+  tflite::InterpreterBuilder builder(*model_, *resolver);
+  TF_LITE_ENSURE_STATUS(
+      builder.SetNumThreads(params_.Get<int32_t>("num_threads")));
+  builder(&interpreter);
+  if (!interpreter) return kTfLiteError;
+  interpreter->SetAllowFp16PrecisionForFp32(params_.Get<bool>("allow_fp16"));
+
+  if (provider != nullptr) {
+    tools::TfLiteDelegatePtr provided = provider->CreateTfLiteDelegate(params_);
+    if (provided == nullptr) return kTfLiteError;
+    delegate = CreateNodeSubsetDelegate(std::move(provided), nodes);
+    TF_LITE_ENSURE_STATUS(interpreter->ModifyGraphWithDelegate(delegate.get()));
+  }
+
+  const std::vector<int>& interpreter_inputs = interpreter->inputs();
+  for (int j = 0; j < inputs_.size() && j < interpreter_inputs.size(); ++j) {
+    const int i = interpreter_inputs[j];
+    if (interpreter->tensor(i)->type != kTfLiteString) {
+      interpreter->ResizeInputTensor(i, inputs_[j].shape);
+    }
+  }
+  TF_LITE_ENSURE_STATUS(interpreter->AllocateTensors());
+  // The values of the inputs barely matter for the latency of most nodes.
+  for (int i : interpreter_inputs) {
+    TfLiteTensor* t = interpreter->tensor(i);
+    if (t->type == kTfLiteString) {
+      DynamicBuffer().WriteToTensorAsVector(t);
+    } else if (t->data.raw != nullptr) {
+      std::memset(t->data.raw, 0, t->bytes);
+    }
+  }
+
+  NodeLatencyProfiler profiler;
+  // The first run includes one-off initialization, so it is not measured.
+  TF_LITE_ENSURE_STATUS(interpreter->Invoke());
+  interpreter->SetProfiler(&profiler);
+  const int num_runs = std::max(1, params_.Get<int32_t>("partition_num_runs"));
+  for (int run = 0; run < num_runs; ++run) {
+    if (interpreter->Invoke() != kTfLiteOk) {
+      interpreter->SetProfiler(nullptr);
+      return kTfLiteError;
+    }
+  }
+  interpreter->SetProfiler(nullptr);
+
+  for (int node_index : interpreter->execution_plan()) {
+    (*node_latency_us)[node_index] =
+        profiler.GetTotalLatencyUs(node_index) / num_runs;
+    if (interpreter->node_and_registration(node_index)->first.delegate) {
+      delegate_kernels->push_back(node_index);
+    }
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus BenchmarkTfLiteModel::LoadModel() {
   std::string graph = params_.Get<std::string>("graph");
   model_ = tflite::FlatBufferModel::BuildFromFile(graph.c_str());
@@ -806,10 +1046,15 @@ std::unique_ptr<tflite::OpResolver> BenchmarkTfLiteModel::GetOpResolver()
   tflite::ops::builtin::BuiltinOpResolver* resolver = nullptr;
   // When --use_xnnpack is explicitly set to false, skip applying the default
   // XNNPACK delegate in TfLite runtime so that the original execution path
-  // based on the unmodified model graph is still excercised.
-  if (params_.HasParam("use_xnnpack") &&
-      params_.HasValueSet<bool>("use_xnnpack") &&
-      !params_.Get<bool>("use_xnnpack")) {
+  // based on the unmodified model graph is still excercised. The same holds
+  // when delegates are partitioned, so that only the chosen partitioning
+  // decides which nodes are delegated.
+  const bool partition_delegates = params_.HasParam("partition_delegates") &&
+                                   params_.Get<bool>("partition_delegates");
+  if ((params_.HasParam("use_xnnpack") &&
+       params_.HasValueSet<bool>("use_xnnpack") &&
+       !params_.Get<bool>("use_xnnpack")) ||
+      partition_delegates) {
     resolver =
         new tflite::ops::builtin::BuiltinOpResolverWithoutDefaultDelegates();
   } else {
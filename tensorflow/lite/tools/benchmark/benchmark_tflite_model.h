@@ -21,12 +21,14 @@ limitations under the License.
 #include <memory>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "tensorflow/lite/model.h"
 #include "tensorflow/lite/profiling/profiler.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
+#include "tensorflow/lite/tools/delegates/delegate_provider.h"
 #include "tensorflow/lite/tools/utils.h"
 
 namespace tflite {
@@ -117,6 +119,30 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   utils::InputTensorData CreateRandomTensorData(
       const TfLiteTensor& t, const InputLayerInfo* layer_info);
 
+  // Restricts each of `delegates` to the nodes that the partitioning loaded
+  // from "partition_plan_file", or chosen from on-device measurements of the
+  // nodes, assigns to it.
+  TfLiteStatus PartitionDelegates(
+      std::vector<tools::ProvidedDelegateList::ProvidedDelegate>* delegates);
+
+  // Chooses the backend running each node of `execution_plan`, where backend
+  // 0 is the CPU and backend i + 1 is `delegates[i]`, from the latencies
+  // measured by running the model with each delegate restricted to each node.
+  TfLiteStatus MeasureDelegatePartitions(
+      const std::vector<tools::ProvidedDelegateList::ProvidedDelegate>&
+          delegates,
+      const std::vector<int>& execution_plan, std::vector<int>* node_backends);
+
+  // Runs the model "partition_num_runs" times on a new interpreter, with the
+  // delegate created by `provider`, if any, restricted to `nodes`. Returns the
+  // average latency of each node of the resulting execution plan in
+  // `node_latency_us`, and the delegate kernels among them in
+  // `delegate_kernels`.
+  TfLiteStatus RunPartitionTrial(
+      const tools::DelegateProvider* provider, const std::vector<int>& nodes,
+      std::unordered_map<int, double>* node_latency_us,
+      std::vector<int>* delegate_kernels);
+
   void AddOwnedListener(std::unique_ptr<BenchmarkListener> listener) {
     if (listener == nullptr) return;
     owned_listeners_.emplace_back(std::move(listener));
@@ -0,0 +1,273 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/delegate_partitioner.h"
+
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+
+#include "tensorflow/lite/profiling/time.h"
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+constexpr char kPlanFileHeader[] = "tflite_delegate_partition_plan";
+// Bumped whenever the format of the plan file changes.
+constexpr int kPlanFileVersion = 1;
+
+// Relays Prepare() to the wrapped delegate while hiding the nodes that are not
+// in the subset from the execution plan it sees.
+class NodeSubsetDelegate {
+ public:
+  NodeSubsetDelegate(tools::TfLiteDelegatePtr delegate,
+                     const std::vector<int>& nodes)
+      : delegate_(std::move(delegate)),
+        nodes_(nodes.begin(), nodes.end()),
+        wrapper_(TfLiteDelegateCreate()) {
+    wrapper_.data_ = this;
+    wrapper_.Prepare = DelegatePrepare;
+    wrapper_.flags = delegate_->flags;
+  }
+
+  TfLiteDelegate* tflite_delegate() { return &wrapper_; }
+
+ private:
+  static TfLiteStatus DelegatePrepare(TfLiteContext* context,
+                                      TfLiteDelegate* delegate);
+  static TfLiteStatus GetExecutionPlan(TfLiteContext* context,
+                                       TfLiteIntArray** execution_plan);
+
+  // The delegate whose wrapped delegate is being prepared. GetExecutionPlan()
+  // is a plain function pointer of the context, so this is the only way for
+  // it to reach the subset.
+  static thread_local NodeSubsetDelegate* preparing_;
+
+  tools::TfLiteDelegatePtr delegate_;
+  const std::unordered_set<int> nodes_;
+  TfLiteDelegate wrapper_;
+  std::unique_ptr<TfLiteIntArray, void (*)(TfLiteIntArray*)> execution_plan_{
+      nullptr, TfLiteIntArrayFree};
+};
+
+thread_local NodeSubsetDelegate* NodeSubsetDelegate::preparing_ = nullptr;
+
+TfLiteStatus NodeSubsetDelegate::DelegatePrepare(TfLiteContext* context,
+                                                 TfLiteDelegate* delegate) {
+  auto* self = static_cast<NodeSubsetDelegate*>(delegate->data_);
+  TfLiteIntArray* execution_plan = nullptr;
+  TF_LITE_ENSURE_STATUS(context->GetExecutionPlan(context, &execution_plan));
+  self->execution_plan_.reset(TfLiteIntArrayCreate(execution_plan->size));
+  int size = 0;
+  for (int i = 0; i < execution_plan->size; ++i) {
+    if (self->nodes_.count(execution_plan->data[i])) {
+      self->execution_plan_->data[size++] = execution_plan->data[i];
+    }
+  }
+  self->execution_plan_->size = size;
+  if (size == 0) return kTfLiteOk;
+
+  auto* const get_execution_plan = context->GetExecutionPlan;
+  NodeSubsetDelegate* const outer = preparing_;
+  preparing_ = self;
+  context->GetExecutionPlan = GetExecutionPlan;
+  const TfLiteStatus status =
+      self->delegate_->Prepare(context, self->delegate_.get());
+  context->GetExecutionPlan = get_execution_plan;
+  preparing_ = outer;
+  return status;
+}
+
+TfLiteStatus NodeSubsetDelegate::GetExecutionPlan(
+    TfLiteContext* context, TfLiteIntArray** execution_plan) {
+  *execution_plan = preparing_->execution_plan_.get();
+  return kTfLiteOk;
+}
+
+}  // namespace
+
+std::vector<int> PlanDelegatePartitions(
+    const std::vector<BackendTimings>& backends,
+    double* estimated_latency_us) {
+  if (backends.empty()) return {};
+  const int num_nodes = backends[0].node_latency_us.size();
+  const int num_backends = backends.size();
+  constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+  // latency[b] is the lowest latency of the nodes seen so far when the last
+  // one runs on backend b, and previous[i][b] is the backend of node i - 1 for
+  // that latency.
+  std::vector<double> latency(num_backends, 0);
+  std::vector<std::vector<int>> previous(num_nodes,
+                                         std::vector<int>(num_backends, -1));
+  for (int i = 0; i < num_nodes; ++i) {
+    std::vector<double> next(num_backends, kInfinity);
+    for (int b = 0; b < num_backends; ++b) {
+      const double node_latency = backends[b].node_latency_us[i];
+      if (node_latency < 0) continue;
+      if (i == 0) {
+        next[b] = node_latency;
+        continue;
+      }
+      for (int p = 0; p < num_backends; ++p) {
+        double candidate = latency[p] + node_latency;
+        if (p == b) candidate -= backends[b].partition_saving_us;
+        if (candidate < next[b]) {
+          next[b] = candidate;
+          previous[i][b] = p;
+        }
+      }
+    }
+    latency = std::move(next);
+  }
+
+  int backend = 0;
+  for (int b = 1; b < num_backends; ++b) {
+    if (latency[b] < latency[backend]) backend = b;
+  }
+  if (num_nodes > 0 && latency[backend] == kInfinity) return {};
+  if (estimated_latency_us) {
+    *estimated_latency_us = num_nodes > 0 ? latency[backend] : 0;
+  }
+
+  std::vector<int> node_backends(num_nodes);
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    node_backends[i] = backend;
+    backend = previous[i][backend];
+  }
+  return node_backends;
+}
+
+double EstimatePartitionsLatency(const std::vector<BackendTimings>& backends,
+                                 const std::vector<int>& node_backends) {
+  double latency = 0;
+  for (size_t i = 0; i < node_backends.size(); ++i) {
+    const BackendTimings& backend = backends[node_backends[i]];
+    if (backend.node_latency_us[i] < 0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    latency += backend.node_latency_us[i];
+    if (i > 0 && node_backends[i - 1] == node_backends[i]) {
+      latency -= backend.partition_saving_us;
+    }
+  }
+  return latency;
+}
+
+uint64_t FingerprintModel(const void* data, size_t size) {
+  // 64-bit FNV-1a.
+  uint64_t fingerprint = 0xcbf29ce484222325ULL;
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    fingerprint = (fingerprint ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return fingerprint;
+}
+
+TfLiteStatus SaveDelegatePartitionPlan(const std::string& path,
+                                       const DelegatePartitionPlan& plan) {
+  for (const std::string& name : plan.backends) {
+    if (name.empty() || name.find_first_of(" \t\n") != std::string::npos) {
+      TFLITE_LOG(ERROR) << "Invalid backend name '" << name << "'.";
+      return kTfLiteError;
+    }
+  }
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  file << kPlanFileHeader << " " << kPlanFileVersion << "\n"
+       << plan.model_fingerprint << "\n"
+       << plan.backends.size();
+  for (const std::string& name : plan.backends) file << " " << name;
+  file << "\n" << plan.node_backends.size();
+  for (int backend : plan.node_backends) file << " " << backend;
+  file << "\n";
+  file.close();
+  if (!file) {
+    TFLITE_LOG(ERROR) << "Failed to write delegate partition plan to " << path;
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus LoadDelegatePartitionPlan(const std::string& path,
+                                       DelegatePartitionPlan* plan) {
+  std::ifstream file(path);
+  std::string header;
+  int version = 0;
+  file >> header >> version;
+  if (!file || header != kPlanFileHeader || version != kPlanFileVersion) {
+    return kTfLiteError;
+  }
+  DelegatePartitionPlan loaded;
+  size_t num_backends = 0;
+  file >> loaded.model_fingerprint >> num_backends;
+  loaded.backends.resize(num_backends);
+  for (std::string& name : loaded.backends) file >> name;
+  size_t num_nodes = 0;
+  file >> num_nodes;
+  loaded.node_backends.resize(num_nodes);
+  for (int& backend : loaded.node_backends) {
+    file >> backend;
+    if (backend < 0 || backend >= static_cast<int>(num_backends)) {
+      return kTfLiteError;
+    }
+  }
+  if (!file) return kTfLiteError;
+  *plan = std::move(loaded);
+  return kTfLiteOk;
+}
+
+uint32_t NodeLatencyProfiler::BeginEvent(const char* tag, EventType event_type,
+                                         int64_t event_metadata1,
+                                         int64_t event_metadata2) {
+  // Only operators of the primary subgraph are recorded, event_metadata2 being
+  // the subgraph index.
+  if (event_type != EventType::OPERATOR_INVOKE_EVENT || event_metadata2 != 0) {
+    return 0;
+  }
+  const uint32_t handle = next_handle_++;
+  if (next_handle_ == 0) next_handle_ = 1;
+  open_events_[handle] = {static_cast<int>(event_metadata1),
+                          profiling::time::NowMicros()};
+  return handle;
+}
+
+void NodeLatencyProfiler::EndEvent(uint32_t event_handle) {
+  auto it = open_events_.find(event_handle);
+  if (it == open_events_.end()) return;
+  total_latency_us_[it->second.node_index] +=
+      profiling::time::NowMicros() - it->second.start_us;
+  open_events_.erase(it);
+}
+
+double NodeLatencyProfiler::GetTotalLatencyUs(int node_index) const {
+  auto it = total_latency_us_.find(node_index);
+  return it != total_latency_us_.end() ? it->second : 0;
+}
+
+tools::TfLiteDelegatePtr CreateNodeSubsetDelegate(
+    tools::TfLiteDelegatePtr delegate, const std::vector<int>& nodes) {
+  auto* subset_delegate = new NodeSubsetDelegate(std::move(delegate), nodes);
+  return tools::TfLiteDelegatePtr(
+      subset_delegate->tflite_delegate(), [](TfLiteDelegate* delegate) {
+        delete static_cast<NodeSubsetDelegate*>(delegate->data_);
+      });
+}
+
+}  // namespace benchmark
+}  // namespace tflite
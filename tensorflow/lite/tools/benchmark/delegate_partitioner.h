@@ -0,0 +1,113 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_TOOLS_BENCHMARK_DELEGATE_PARTITIONER_H_
+#define TENSORFLOW_LITE_TOOLS_BENCHMARK_DELEGATE_PARTITIONER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/tools/delegates/delegate_provider.h"
+
+namespace tflite {
+namespace benchmark {
+
+// Latencies measured for one backend that can run the nodes of a model, i.e.
+// the TFLite CPU kernels or a delegate.
+struct BackendTimings {
+  std::string name;
+  // Latency, in microseconds, of each node of the original execution plan when
+  // it is the only node run by the backend. This includes moving the inputs
+  // and outputs of the node to and from CPU memory. Negative if the backend
+  // can't run the node.
+  std::vector<double> node_latency_us;
+  // Latency, in microseconds, saved for each node that runs in the same
+  // partition as the preceding node of the execution plan, i.e. the data
+  // transfers and launch overhead shared by the nodes of a partition.
+  double partition_saving_us = 0;
+};
+
+// Returns the index in `backends` of the backend chosen to run each node of
+// the execution plan, such that the estimated latency of the whole plan is
+// minimal. The estimated latency is stored in `estimated_latency_us` if it's
+// not null. Returns an empty vector if some node can't be run by any backend.
+std::vector<int> PlanDelegatePartitions(
+    const std::vector<BackendTimings>& backends,
+    double* estimated_latency_us = nullptr);
+
+// Returns the estimated latency, in microseconds, of running each node of the
+// execution plan with the backend given by `node_backends`.
+double EstimatePartitionsLatency(const std::vector<BackendTimings>& backends,
+                                 const std::vector<int>& node_backends);
+
+// A partitioning chosen for a model, cached to skip the measurements on later
+// loads of the model.
+struct DelegatePartitionPlan {
+  uint64_t model_fingerprint = 0;
+  // Names of the backends, the first one being the CPU.
+  std::vector<std::string> backends;
+  // Index in `backends` of the backend running each node of the original
+  // execution plan.
+  std::vector<int> node_backends;
+};
+
+// Returns a fingerprint of the serialized model in `data`.
+uint64_t FingerprintModel(const void* data, size_t size);
+
+TfLiteStatus SaveDelegatePartitionPlan(const std::string& path,
+                                       const DelegatePartitionPlan& plan);
+TfLiteStatus LoadDelegatePartitionPlan(const std::string& path,
+                                       DelegatePartitionPlan* plan);
+
+// Records the latency of each node invocation of the primary subgraph.
+class NodeLatencyProfiler : public tflite::Profiler {
+ public:
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override;
+  void EndEvent(uint32_t event_handle) override;
+
+  // Returns the total latency, in microseconds, of the invocations of node
+  // `node_index` recorded so far.
+  double GetTotalLatencyUs(int node_index) const;
+
+  void Reset() { total_latency_us_.clear(); }
+
+ private:
+  struct OpenEvent {
+    int node_index;
+    uint64_t start_us;
+  };
+  uint32_t next_handle_ = 1;
+  std::unordered_map<uint32_t, OpenEvent> open_events_;
+  std::unordered_map<int, uint64_t> total_latency_us_;
+};
+
+// Wraps a delegate so that it is only offered the nodes in `nodes` when the
+// wrapped delegate is applied, and leaves all other nodes to the rest of the
+// delegates or the CPU kernels. `nodes` are node indices in the primary
+// subgraph. The returned delegate owns `delegate`.
+tools::TfLiteDelegatePtr CreateNodeSubsetDelegate(
+    tools::TfLiteDelegatePtr delegate, const std::vector<int>& nodes);
+
+}  // namespace benchmark
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_TOOLS_BENCHMARK_DELEGATE_PARTITIONER_H_
@@ -0,0 +1,151 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/tools/benchmark/delegate_partitioner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/utils/dummy_delegate/dummy_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+using ::testing::ElementsAre;
+
+BackendTimings Backend(const std::string& name,
+                       const std::vector<double>& node_latency_us,
+                       double partition_saving_us = 0) {
+  BackendTimings backend;
+  backend.name = name;
+  backend.node_latency_us = node_latency_us;
+  backend.partition_saving_us = partition_saving_us;
+  return backend;
+}
+
+TEST(DelegatePartitionerTest, PlanCpuOnly) {
+  double latency_us = 0;
+  EXPECT_THAT(PlanDelegatePartitions({Backend("CPU", {1, 2, 3})}, &latency_us),
+              ElementsAre(0, 0, 0));
+  EXPECT_EQ(latency_us, 6);
+}
+
+TEST(DelegatePartitionerTest, PlanPicksFastestBackendPerNode) {
+  const std::vector<BackendTimings> backends = {
+      Backend("CPU", {10, 10, 10}), Backend("GPU", {5, -1, 20})};
+  double latency_us = 0;
+  EXPECT_THAT(PlanDelegatePartitions(backends, &latency_us),
+              ElementsAre(1, 0, 0));
+  EXPECT_EQ(latency_us, 25);
+}
+
+TEST(DelegatePartitionerTest, PlanMergesNodesIntoPartitions) {
+  // Alone, each node is slower on the GPU, but a partition of the three
+  // nodes saves 8us twice.
+  const std::vector<BackendTimings> backends = {
+      Backend("CPU", {10, 10, 10}), Backend("GPU", {12, 12, 12}, 8)};
+  double latency_us = 0;
+  EXPECT_THAT(PlanDelegatePartitions(backends, &latency_us),
+              ElementsAre(1, 1, 1));
+  EXPECT_EQ(latency_us, 20);
+  EXPECT_EQ(EstimatePartitionsLatency(backends, {0, 0, 0}), 30);
+  EXPECT_EQ(EstimatePartitionsLatency(backends, {1, 0, 1}), 34);
+}
+
+TEST(DelegatePartitionerTest, PlanAvoidsSwitchingBackendsForSingleNode) {
+  // Node 1 isn't supported by the GPU, which splits the GPU partition and
+  // makes running node 2 on the CPU cheaper.
+  const std::vector<BackendTimings> backends = {
+      Backend("CPU", {10, 10, 6}), Backend("GPU", {12, -1, 12}, 8)};
+  EXPECT_THAT(PlanDelegatePartitions(backends), ElementsAre(0, 0, 0));
+}
+
+TEST(DelegatePartitionerTest, PlanFailsForUnsupportedNode) {
+  EXPECT_TRUE(
+      PlanDelegatePartitions({Backend("CPU", {1, -1}), Backend("GPU", {1, -1})})
+          .empty());
+}
+
+TEST(DelegatePartitionerTest, SaveAndLoadPlan) {
+  const std::string path =
+      std::string(getenv("TEST_TMPDIR") ? getenv("TEST_TMPDIR") : "/tmp") +
+      "/delegate_partition_plan.txt";
+  DelegatePartitionPlan plan;
+  plan.model_fingerprint = FingerprintModel("model", 5);
+  plan.backends = {"CPU", "GPU", "XNNPACK"};
+  plan.node_backends = {2, 1, 0, 1};
+  ASSERT_EQ(SaveDelegatePartitionPlan(path, plan), kTfLiteOk);
+
+  DelegatePartitionPlan loaded;
+  ASSERT_EQ(LoadDelegatePartitionPlan(path, &loaded), kTfLiteOk);
+  EXPECT_EQ(loaded.model_fingerprint, plan.model_fingerprint);
+  EXPECT_EQ(loaded.backends, plan.backends);
+  EXPECT_EQ(loaded.node_backends, plan.node_backends);
+  std::remove(path.c_str());
+
+  EXPECT_NE(LoadDelegatePartitionPlan(path, &loaded), kTfLiteOk);
+  EXPECT_NE(FingerprintModel("model", 5), FingerprintModel("Model", 5));
+}
+
+TEST(DelegatePartitionerTest, NodeSubsetDelegateOnlyDelegatesSubset) {
+  // The interpreter depends on the delegate, so it is destroyed first.
+  DummyDelegateOptions options = TfLiteDummyDelegateOptionsDefault();
+  options.allowed_builtin_code = kTfLiteBuiltinAdd;
+  auto delegate = CreateNodeSubsetDelegate(
+      TfLiteDummyDelegateCreateUnique(&options), {1, 2});
+
+  // Three chained ADD nodes, all of which the dummy delegate supports.
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(5), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0, 1}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({4}), kTfLiteOk);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(
+                  i, kTfLiteFloat32, "", {2}, TfLiteQuantizationParams()),
+              kTfLiteOk);
+  }
+  ops::builtin::BuiltinOpResolver resolver;
+  const TfLiteRegistration* add = resolver.FindOp(BuiltinOperator_ADD, 1);
+  for (int i = 0; i < 3; ++i) {
+    auto* params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    params->activation = kTfLiteActNone;
+    params->pot_scale_int16 = false;
+    ASSERT_EQ(interpreter.AddNodeWithParameters({i == 0 ? 0 : i + 1, 1},
+                                                {i + 2}, nullptr, 0, params,
+                                                add),
+              kTfLiteOk);
+  }
+
+  ASSERT_EQ(interpreter.ModifyGraphWithDelegate(delegate.get()), kTfLiteOk);
+
+  ASSERT_EQ(interpreter.execution_plan().size(), 2);
+  EXPECT_EQ(interpreter.execution_plan()[0], 0);
+  EXPECT_EQ(interpreter.node_and_registration(0)->first.delegate, nullptr);
+  const int kernel = interpreter.execution_plan()[1];
+  EXPECT_NE(interpreter.node_and_registration(kernel)->first.delegate,
+            nullptr);
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace tflite
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "tensorflow/lite/tools/logging.h"
 
@@ -89,5 +90,55 @@ void ProfilingListener::WriteOutput(const std::string& header,
   (*stream) << data << std::endl;
 }
 
+HardwareCounterListener::HardwareCounterListener(Interpreter* interpreter)
+    : interpreter_(interpreter) {
+  TFLITE_TOOLS_CHECK(interpreter);
+  interpreter_->AddProfiler(&profiler_);
+  if (!profiler_.HasHardwareCounters()) {
+    TFLITE_LOG(WARN) << "Hardware counters are unavailable on this platform, "
+                        "only operator timings will be reported.";
+  }
+}
+
+void HardwareCounterListener::OnSingleRunStart(RunType run_type) {
+  if (run_type == REGULAR) {
+    profiler_.StartProfiling();
+  }
+}
+
+void HardwareCounterListener::OnSingleRunEnd() { profiler_.StopProfiling(); }
+
+void HardwareCounterListener::OnBenchmarkEnd(const BenchmarkResults& results) {
+  std::vector<profiling::OperatorCounters> counters =
+      profiler_.GetOperatorCounters();
+  if (counters.empty()) return;
+  for (auto& op : counters) {
+    op.tensor_bytes = NodeTensorBytes(op.subgraph_index, op.node_index);
+  }
+  TFLITE_LOG(INFO) << "Operator-wise Hardware Counters for Regular Benchmark "
+                      "Runs:";
+  TFLITE_LOG(INFO) << profiling::FormatOperatorCounters(counters);
+}
+
+size_t HardwareCounterListener::NodeTensorBytes(int subgraph_index,
+                                                int node_index) const {
+  const Subgraph* subgraph = interpreter_->subgraph(subgraph_index);
+  if (subgraph == nullptr) return 0;
+  const auto* node_and_registration =
+      subgraph->node_and_registration(node_index);
+  if (node_and_registration == nullptr) return 0;
+  const TfLiteNode& node = node_and_registration->first;
+  size_t bytes = 0;
+  for (const TfLiteIntArray* tensors :
+       {node.inputs, node.outputs, node.temporaries}) {
+    if (tensors == nullptr) continue;
+    for (int i = 0; i < tensors->size; ++i) {
+      const TfLiteTensor* tensor = subgraph->tensor(tensors->data[i]);
+      if (tensor != nullptr) bytes += tensor->bytes;
+    }
+  }
+  return bytes;
+}
+
 }  // namespace benchmark
 }  // namespace tflite
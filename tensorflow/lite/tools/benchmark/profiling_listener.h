@@ -20,6 +20,7 @@ limitations under the License.
 #include <string>
 
 #include "tensorflow/lite/profiling/buffered_profiler.h"
+#include "tensorflow/lite/profiling/hardware_counter_profiler.h"
 #include "tensorflow/lite/profiling/profile_summarizer.h"
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
@@ -56,6 +57,29 @@ class ProfilingListener : public BenchmarkListener {
   profiling::BufferedProfiler profiler_;
 };
 
+// Dumps per-operator hardware counters (cycles, instructions and last-level
+// cache misses) collected during the regular benchmark runs, together with an
+// estimate of the memory traffic each operator causes. Counters are only
+// collected for the thread calling Invoke(), so results are most meaningful
+// with a single interpreter thread.
+class HardwareCounterListener : public BenchmarkListener {
+ public:
+  explicit HardwareCounterListener(Interpreter* interpreter);
+
+  void OnSingleRunStart(RunType run_type) override;
+
+  void OnSingleRunEnd() override;
+
+  void OnBenchmarkEnd(const BenchmarkResults& results) override;
+
+ private:
+  // Returns the bytes of the inputs, outputs and temporaries of a node.
+  size_t NodeTensorBytes(int subgraph_index, int node_index) const;
+
+  Interpreter* interpreter_;
+  profiling::HardwareCounterProfiler profiler_;
+};
+
 }  // namespace benchmark
 }  // namespace tflite
 
@@ -25,6 +25,7 @@ See [Importing Data](https://tensorflow.org/guide/datasets) for an overview.
 @@AutoShardPolicy
 @@AutotuneAlgorithm
 @@AutotuneOptions
+@@CacheOptions
 @@CheckpointInputPipelineHook
 @@Counter
 @@CsvDataset
@@ -38,6 +39,7 @@ See [Importing Data](https://tensorflow.org/guide/datasets) for an overview.
 @@RaggedTensorStructure
 @@RandomDataset
 @@Reducer
+@@ShuffleOptions
 @@SparseTensorStructure
 @@SqlDataset
 @@Structure
@@ -148,9 +150,11 @@ from tensorflow.python.data.ops.optional_ops import OptionalSpec as OptionalStru
 from tensorflow.python.data.ops.options import AutoShardPolicy
 from tensorflow.python.data.ops.options import AutotuneAlgorithm
 from tensorflow.python.data.ops.options import AutotuneOptions
+from tensorflow.python.data.ops.options import CacheOptions
 from tensorflow.python.data.ops.options import DistributeOptions
 from tensorflow.python.data.ops.options import ExternalStatePolicy
 from tensorflow.python.data.ops.options import OptimizationOptions
+from tensorflow.python.data.ops.options import ShuffleOptions
 from tensorflow.python.data.ops.options import ThreadingOptions
 from tensorflow.python.data.util.structure import _RaggedTensorStructure as RaggedTensorStructure
 from tensorflow.python.data.util.structure import _SparseTensorStructure as SparseTensorStructure
@@ -109,6 +109,26 @@ class CompressionOpsTest(test_base.DatasetTestBase, parameterized.TestCase):
     dataset = dataset.map(lambda x: compression_ops.uncompress(x, element_spec))
     self.assertDatasetProduces(dataset, [element])
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(
+              element=_test_objects(), codec=["snappy", "zlib", "none"])))
+  def testCompressionWithCodec(self, element, codec):
+    element = element._obj
+
+    compressed = compression_ops.compress(element, codec=codec)
+    uncompressed = compression_ops.uncompress(
+        compressed, structure.type_spec_from_value(element))
+    self.assertValuesEqual(element, self.evaluate(uncompressed))
+
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations()))
+  def testUnknownCodec(self):
+    with self.assertRaisesRegex(errors.NotFoundError,
+                                "Compression codec unknown is not registered"):
+      self.evaluate(compression_ops.compress(1, codec="unknown"))
+
   @combinations.generate(
       combinations.times(test_base.default_test_combinations()))
   def testCompressionOutputDTypeMismatch(self):
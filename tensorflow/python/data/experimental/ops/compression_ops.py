@@ -17,11 +17,15 @@ from tensorflow.python.data.util import structure
 from tensorflow.python.ops import gen_experimental_dataset_ops as ged_ops
 
 
-def compress(element):
+def compress(element, codec=None):
   """Compress a dataset element.
 
   Args:
     element: A nested structure of types supported by Tensorflow.
+    codec: (Optional.) The name of the codec to compress each component of the
+      element with, e.g. "snappy", "zlib" or "none". Only TensorFlow versions
+      that support codecs can uncompress such elements. If None, the components
+      are compressed together with snappy, in the format all versions read.
 
   Returns:
     A variant tensor representing the compressed element. This variant can be
@@ -29,7 +33,9 @@ def compress(element):
   """
   element_spec = structure.type_spec_from_value(element)
   tensor_list = structure.to_tensor_list(element_spec, element)
-  return ged_ops.compress_element(tensor_list)
+  if codec is None:
+    return ged_ops.compress_element(tensor_list)
+  return ged_ops.compress_element(tensor_list, codec=codec)
 
 
 def uncompress(element, output_spec):
@@ -189,9 +189,11 @@ def _validate_job_name(job_name):
 
 def _validate_compression(compression):
   valid_compressions = [COMPRESSION_AUTO, COMPRESSION_NONE]
-  if compression not in valid_compressions:
+  if (compression not in valid_compressions and
+      not isinstance(compression, six.string_types)):
     raise ValueError(f"Invalid `compression` argument: {compression}. "
-                     f"Must be one of {valid_compressions}.")
+                     f"Must be one of {valid_compressions} or the name of a "
+                     "compression codec.")
 
 
 def _get_compression_proto(compression):
@@ -199,8 +201,11 @@ def _get_compression_proto(compression):
     return data_service_pb2.DataServiceMetadata.COMPRESSION_SNAPPY
   if compression == COMPRESSION_NONE:
     return data_service_pb2.DataServiceMetadata.COMPRESSION_OFF
+  if isinstance(compression, six.string_types):
+    return data_service_pb2.DataServiceMetadata.COMPRESSION_CODEC
   raise ValueError(f"Invalid `compression` argument: {compression}. "
-                   f"Must be one of {[COMPRESSION_AUTO, COMPRESSION_NONE]}.")
+                   f"Must be one of {[COMPRESSION_AUTO, COMPRESSION_NONE]} or "
+                   "the name of a compression codec.")
 
 
 def _decide_compression(compression, data_transfer_protocol):
@@ -479,7 +484,10 @@ def _distribute(processing_mode,
       data with the tf.data service. By default, data is transferred using gRPC.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. Any other
+      string names the codec to compress each element component with, e.g.
+      "snappy", "zlib" or "none", which requires workers and clients that
+      support codecs.
     cross_trainer_cache: (Optional.) If a `CrossTrainerCache` object is
       provided, dataset iteration will be shared across concurrently running
       trainers. See
@@ -737,7 +745,10 @@ def distribute(processing_mode,
       data with the tf.data service. By default, data is transferred using gRPC.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. Any other
+      string names the codec to compress each element component with, e.g.
+      "snappy", "zlib" or "none", which requires workers and clients that
+      support codecs.
     cross_trainer_cache: (Optional.) If a `CrossTrainerCache` object is
       provided, dataset iteration will be shared across concurrently running
       trainers. See
@@ -784,7 +795,10 @@ def _register_dataset(service, dataset, compression):
     dataset: A `tf.data.Dataset` to register with the tf.data service.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. Any other
+      string names the codec to compress each element component with, e.g.
+      "snappy", "zlib" or "none", which requires workers and clients that
+      support codecs.
 
   Returns:
     A scalar int64 tensor of the registered dataset's id.
@@ -803,16 +817,23 @@ def _register_dataset(service, dataset, compression):
     encoded_spec = nested_structure_coder.encode_structure(
         dataset.element_spec).SerializeToString()
 
+  codec = None
   if compression == COMPRESSION_AUTO:
     dataset = dataset.map(
         lambda *x: compression_ops.compress(x),
         num_parallel_calls=dataset_ops.AUTOTUNE)
+  elif compression != COMPRESSION_NONE:
+    codec = compression
+    dataset = dataset.map(
+        lambda *x: compression_ops.compress(x, codec=codec),
+        num_parallel_calls=dataset_ops.AUTOTUNE)
   dataset = dataset.prefetch(dataset_ops.AUTOTUNE)
   dataset = dataset._apply_debug_options()  # pylint: disable=protected-access
 
   metadata = data_service_pb2.DataServiceMetadata(
       element_spec=encoded_spec,
-      compression=_get_compression_proto(compression))
+      compression=_get_compression_proto(compression),
+      compression_codec=codec)
   dataset_id = gen_experimental_dataset_ops.register_dataset(
       dataset._variant_tensor,  # pylint: disable=protected-access
       address=address,
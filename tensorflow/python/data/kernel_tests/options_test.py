@@ -139,6 +139,9 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.autotune.cpu_budget = 10
     options.autotune.ram_budget = 20
     options.deterministic = True
+    options.experimental_cache.num_shards = 8
+    options.experimental_cache.ram_budget = 50
+    options.experimental_cache.spill_directory = "/tmp"
     options.experimental_external_state_policy = (
         options_lib.ExternalStatePolicy.FAIL)
     options.experimental_distribute.auto_shard_policy = (
@@ -156,8 +159,12 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_optimization.parallel_batch = True
     options.experimental_optimization.shuffle_and_repeat_fusion = True
     options.experimental_slack = True
+    options.experimental_shuffle.num_shards = 4
+    options.experimental_shuffle.warm_start = True
+    options.experimental_shuffle.global_shuffle = True
     options.threading.max_intra_op_parallelism = 30
     options.threading.private_threadpool_size = 40
+    options.threading.numa_node = 1
     pb = options._to_proto()
     result = options_lib.Options()
     result._from_proto(pb)
@@ -179,10 +186,12 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     result = options._to_proto()
     expected_pb = dataset_options_pb2.Options()
     expected_pb.autotune_options.CopyFrom(dataset_options_pb2.AutotuneOptions())
+    expected_pb.cache_options.CopyFrom(dataset_options_pb2.CacheOptions())
     expected_pb.distribute_options.CopyFrom(
         dataset_options_pb2.DistributeOptions())
     expected_pb.optimization_options.CopyFrom(
         dataset_options_pb2.OptimizationOptions())
+    expected_pb.shuffle_options.CopyFrom(dataset_options_pb2.ShuffleOptions())
     expected_pb.threading_options.CopyFrom(
         dataset_options_pb2.ThreadingOptions())
     self.assertProtoEquals(expected_pb, result)
@@ -27,6 +27,7 @@ from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import readers
 from tensorflow.python.framework import combinations
 from tensorflow.python.framework import constant_op
+from tensorflow.python.lib.io import tf_record
 from tensorflow.python.platform import test
 
 
@@ -136,6 +137,25 @@ class TFRecordDatasetTest(tf_record_test_base.TFRecordTestBase,
     dataset = self._dataset_factory(gzip_files, compression_type="GZIP")
     self.assertDatasetProduces(dataset, expected_output=expected_output)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testReadGzipMembersInParallel(self):
+    gzip_files = []
+    options = tf_record.TFRecordOptions(
+        compression_type="GZIP", gzip_member_size=16)
+    for i in range(self._num_files):
+      gzfn = os.path.join(self.get_temp_dir(), "tfrecord_members_%s.gz" % i)
+      with tf_record.TFRecordWriter(gzfn, options) as writer:
+        for j in range(self._num_records):
+          writer.write(self._record(i, j))
+      gzip_files.append(gzfn)
+    expected_output = []
+    for j in range(self._num_files):
+      expected_output.extend(
+          [self._record(j, i) for i in range(self._num_records)])
+    dataset = readers.TFRecordDataset(
+        gzip_files, compression_type="GZIP", num_inflate_threads=2)
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadWithBuffer(self):
     one_mebibyte = 2**20
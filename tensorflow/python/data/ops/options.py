@@ -40,11 +40,17 @@ class AutotuneAlgorithm(enum.Enum):
 
   MAX_PARALLELISM: Similar to HILL_CLIMB but uses a relaxed stopping condition,
   allowing the optimization to oversubscribe the CPU.
+
+  MEMORY_BUDGETED: Tunes parallelism and buffer sizes jointly, in each
+  optimization step choosing the parameter with the largest improvement per
+  byte of buffer memory. The RAM budget is a hard cap shared by all input
+  pipelines in the process that use this algorithm.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
+  MEMORY_BUDGETED = 4
 
   @classmethod
   def _to_proto(cls, obj):
@@ -56,6 +62,8 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.GRADIENT_DESCENT
     if obj == cls.MAX_PARALLELISM:
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
+    if obj == cls.MEMORY_BUDGETED:
+      return model_pb2.AutotuneAlgorithm.MEMORY_BUDGETED
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` and "
         f"`GRADIENT_DESCENT`. Got {obj.name}.")
@@ -70,6 +78,8 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.GRADIENT_DESCENT
     if pb == model_pb2.AutotuneAlgorithm.MAX_PARALLELISM:
       return cls.MAX_PARALLELISM
+    if pb == model_pb2.AutotuneAlgorithm.MEMORY_BUDGETED:
+      return cls.MEMORY_BUDGETED
     raise ValueError(f"Invalid `pb.` Supported values include `DEFAULT`, "
                      f"`HILL_CLIMB` and `GRADIENT_DESCENT`. Got {pb}.")
 
@@ -248,6 +258,61 @@ class AutotuneOptions(options_lib.OptionsBase):
     object.__setattr__(self, "_mutable", mutable)
 
 
+@tf_export("data.experimental.CacheOptions")
+class CacheOptions(options_lib.OptionsBase):
+  """Represents options for the in-memory cache of `tf.data.Dataset.cache`.
+
+  You can set the cache options of a dataset through the `experimental_cache`
+  property of `tf.data.Options`; the property is an instance of
+  `tf.data.experimental.CacheOptions`.
+
+  ```python
+  options = tf.data.Options()
+  options.experimental_cache.ram_budget = 16 * 1024 * 1024 * 1024
+  options.experimental_cache.spill_directory = "/tmp/cache_spill"
+  dataset = dataset.cache().with_options(options)
+  ```
+  """
+
+  num_shards = options_lib.create_option(
+      name="num_shards",
+      ty=int,
+      docstring="The number of independently locked shards the in-memory "
+      "cache is split into. More shards reduce lock contention between "
+      "iterators reading the same cache. If None, defaults to 16.")
+
+  ram_budget = options_lib.create_option(
+      name="ram_budget",
+      ty=int,
+      docstring="The number of bytes of cached elements to keep in memory. "
+      "Once exceeded, further elements are spilled to `spill_directory`. If "
+      "None or 0, all elements are kept in memory.")
+
+  spill_directory = options_lib.create_option(
+      name="spill_directory",
+      ty=str,
+      docstring="A local directory to spill cached elements to once "
+      "`ram_budget` is exceeded. If None, `ram_budget` is ignored.")
+
+  def _to_proto(self):
+    pb = dataset_options_pb2.CacheOptions()
+    if self.num_shards is not None:
+      pb.num_shards = self.num_shards
+    if self.ram_budget is not None:
+      pb.ram_budget = self.ram_budget
+    if self.spill_directory is not None:
+      pb.spill_directory = self.spill_directory
+    return pb
+
+  def _from_proto(self, pb):
+    if pb.WhichOneof("optional_num_shards") is not None:
+      self.num_shards = pb.num_shards
+    if pb.WhichOneof("optional_ram_budget") is not None:
+      self.ram_budget = pb.ram_budget
+    if pb.WhichOneof("optional_spill_directory") is not None:
+      self.spill_directory = pb.spill_directory
+
+
 @tf_export("data.experimental.DistributeOptions")
 class DistributeOptions(options_lib.OptionsBase):
   """Represents options for distributed data processing.
@@ -435,6 +500,78 @@ class OptimizationOptions(options_lib.OptionsBase):
 
 
 @deprecation.deprecated_endpoints("data.experimental.ThreadingOptions")
+@tf_export("data.experimental.ShuffleOptions")
+class ShuffleOptions(options_lib.OptionsBase):
+  """Represents options for the buffer of `tf.data.Dataset.shuffle`.
+
+  You can set the shuffle options of a dataset through the
+  `experimental_shuffle` property of `tf.data.Options`; the property is an
+  instance of `tf.data.experimental.ShuffleOptions`.
+
+  ```python
+  options = tf.data.Options()
+  options.experimental_shuffle.num_shards = 8
+  options.experimental_shuffle.warm_start = True
+  dataset = dataset.shuffle(1000000).with_options(options)
+  ```
+
+  With more than one shard, the shuffle buffer is split into sub-reservoirs
+  which are filled in parallel from the input, and elements are sampled
+  uniformly across all sub-reservoirs. The order in which the sub-reservoirs
+  are filled is not deterministic, so neither is the output order.
+
+  With `global_shuffle`, the input of the shuffle is not buffered at all.
+  Instead, its elements are read by index, in the order of a pseudorandom
+  permutation of all indices that is computed on the fly. This shuffles each
+  epoch uniformly with constant memory, but requires that the input supports
+  random access (e.g. `range`, `from_tensor_slices` or a shard of a version 3
+  snapshot, optionally followed by transformations such as `map`, `batch` or
+  `zip`).
+  """
+
+  num_shards = options_lib.create_option(
+      name="num_shards",
+      ty=int,
+      docstring="The number of sub-reservoirs the shuffle buffer is split "
+      "into. If None or 1, the buffer is filled sequentially by the consumer "
+      "of the dataset.")
+
+  warm_start = options_lib.create_option(
+      name="warm_start",
+      ty=bool,
+      docstring="Whether to produce elements as soon as the shuffle buffer "
+      "holds any, instead of waiting for it to fill up. The first elements are "
+      "then less well shuffled. Only applies when `num_shards` is greater "
+      "than 1. If None, defaults to False.")
+
+  global_shuffle = options_lib.create_option(
+      name="global_shuffle",
+      ty=bool,
+      docstring="Whether to shuffle the whole input instead of a buffer of "
+      "`buffer_size` elements, by reading the input by index in a "
+      "pseudorandom order. The input must support random access and have a "
+      "known, finite cardinality. Takes precedence over `num_shards`. If None, "
+      "defaults to False.")
+
+  def _to_proto(self):
+    pb = dataset_options_pb2.ShuffleOptions()
+    if self.num_shards is not None:
+      pb.num_shards = self.num_shards
+    if self.warm_start is not None:
+      pb.warm_start = self.warm_start
+    if self.global_shuffle is not None:
+      pb.global_shuffle = self.global_shuffle
+    return pb
+
+  def _from_proto(self, pb):
+    if pb.WhichOneof("optional_num_shards") is not None:
+      self.num_shards = pb.num_shards
+    if pb.WhichOneof("optional_warm_start") is not None:
+      self.warm_start = pb.warm_start
+    if pb.WhichOneof("optional_global_shuffle") is not None:
+      self.global_shuffle = pb.global_shuffle
+
+
 @tf_export("data.experimental.ThreadingOptions", "data.ThreadingOptions")
 class ThreadingOptions(options_lib.OptionsBase):
   """Represents options for dataset threading.
@@ -464,12 +601,24 @@ class ThreadingOptions(options_lib.OptionsBase):
       "The value 0 can be used to indicate that the threadpool size should be "
       "determined at runtime based on the number of available CPU cores.")
 
+  numa_node = options_lib.create_option(
+      name="numa_node",
+      ty=int,
+      docstring=
+      "If set, the dataset threadpool and the threads started by the input "
+      "pipeline (e.g. the workers of parallel `map` and `interleave`) are "
+      "pinned to the given NUMA node, and autotuning budgets their "
+      "parallelism by the cores of that node. The setting is ignored if NUMA "
+      "is not supported on the host or if the node does not exist.")
+
   def _to_proto(self):
     pb = dataset_options_pb2.ThreadingOptions()
     if self.max_intra_op_parallelism is not None:
       pb.max_intra_op_parallelism = self.max_intra_op_parallelism
     if self.private_threadpool_size is not None:
       pb.private_threadpool_size = self.private_threadpool_size
+    if self.numa_node is not None:
+      pb.numa_node = self.numa_node
     return pb
 
   def _from_proto(self, pb):
@@ -477,6 +626,8 @@ class ThreadingOptions(options_lib.OptionsBase):
       self.max_intra_op_parallelism = pb.max_intra_op_parallelism
     if pb.WhichOneof("optional_private_threadpool_size") is not None:
       self.private_threadpool_size = pb.private_threadpool_size
+    if pb.WhichOneof("optional_numa_node") is not None:
+      self.numa_node = pb.numa_node
 
 
 @tf_export("data.Options")
@@ -522,6 +673,14 @@ class Options(options_lib.OptionsBase):
       "Whether the outputs need to be produced in deterministic order. If None,"
       " defaults to True.")
 
+  experimental_cache = options_lib.create_option(
+      name="experimental_cache",
+      ty=CacheOptions,
+      docstring="The options for the in-memory cache of "
+      "`tf.data.Dataset.cache`. See `tf.data.experimental.CacheOptions` for "
+      "more details.",
+      default_factory=CacheOptions)
+
   experimental_deterministic = options_lib.create_option(
       name="experimental_deterministic",
       ty=bool,
@@ -553,6 +712,13 @@ class Options(options_lib.OptionsBase):
       "`tf.data.experimental.OptimizationOptions` for more details.",
       default_factory=OptimizationOptions)
 
+  experimental_shuffle = options_lib.create_option(
+      name="experimental_shuffle",
+      ty=ShuffleOptions,
+      docstring="The options for the buffer of `tf.data.Dataset.shuffle`. See "
+      "`tf.data.experimental.ShuffleOptions` for more details.",
+      default_factory=ShuffleOptions)
+
   experimental_slack = options_lib.create_option(
       name="experimental_slack",
       ty=bool,
@@ -605,6 +771,7 @@ class Options(options_lib.OptionsBase):
     if self.deterministic is not None:
       pb.deterministic = self.deterministic
     pb.autotune_options.CopyFrom(self.autotune._to_proto())  # pylint: disable=protected-access
+    pb.cache_options.CopyFrom(self.experimental_cache._to_proto())  # pylint: disable=protected-access
     pb.distribute_options.CopyFrom(self.experimental_distribute._to_proto())  # pylint: disable=protected-access
     if self.experimental_external_state_policy is not None:
       pb.external_state_policy = (
@@ -613,6 +780,7 @@ class Options(options_lib.OptionsBase):
     pb.optimization_options.CopyFrom(self.experimental_optimization._to_proto())  # pylint: disable=protected-access
     if self.experimental_slack is not None:
       pb.slack = self.experimental_slack
+    pb.shuffle_options.CopyFrom(self.experimental_shuffle._to_proto())  # pylint: disable=protected-access
     pb.threading_options.CopyFrom(self.threading._to_proto())  # pylint: disable=protected-access
     return pb
 
@@ -620,6 +788,7 @@ class Options(options_lib.OptionsBase):
     if pb.WhichOneof("optional_deterministic") is not None:
       self.deterministic = pb.deterministic
     self.autotune._from_proto(pb.autotune_options)  # pylint: disable=protected-access
+    self.experimental_cache._from_proto(pb.cache_options)  # pylint: disable=protected-access
     self.experimental_distribute._from_proto(pb.distribute_options)  # pylint: disable=protected-access
     if pb.WhichOneof("optional_external_state_policy") is not None:
       self.experimental_external_state_policy = (
@@ -628,6 +797,7 @@ class Options(options_lib.OptionsBase):
     self.experimental_optimization._from_proto(pb.optimization_options)  # pylint: disable=protected-access
     if pb.WhichOneof("optional_slack") is not None:
       self.experimental_slack = pb.slack
+    self.experimental_shuffle._from_proto(pb.shuffle_options)  # pylint: disable=protected-access
     self.threading._from_proto(pb.threading_options)  # pylint: disable=protected-access
 
   def _set_mutable(self, mutable):
@@ -635,8 +805,10 @@ class Options(options_lib.OptionsBase):
     # pylint: disable=protected-access
     object.__setattr__(self, "_mutable", mutable)
     self.autotune._set_mutable(mutable)
+    self.experimental_cache._set_mutable(mutable)
     self.experimental_distribute._set_mutable(mutable)
     self.experimental_optimization._set_mutable(mutable)
+    self.experimental_shuffle._set_mutable(mutable)
     self.threading._set_mutable(mutable)
 
   def merge(self, options):
@@ -281,6 +281,7 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
                filenames,
                compression_type=None,
                buffer_size=None,
+               num_inflate_threads=None,
                name=None):
     """Creates a `TFRecordDataset`.
 
@@ -290,6 +291,9 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      num_inflate_threads: (Optional.) A Python integer. If positive, GZIP
+        files written with `gzip_member_size` are inflated on this many
+        threads.
       name: (Optional.) A name for the tf.data operation.
     """
     self._filenames = filenames
@@ -302,11 +306,13 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         "buffer_size",
         buffer_size,
         argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._num_inflate_threads = num_inflate_threads or 0
     self._name = name
 
     variant_tensor = gen_dataset_ops.tf_record_dataset(
         self._filenames, self._compression_type, self._buffer_size,
-        metadata=self._metadata.SerializeToString())
+        metadata=self._metadata.SerializeToString(),
+        num_inflate_threads=self._num_inflate_threads)
     super(_TFRecordDataset, self).__init__(variant_tensor)
 
   @property
@@ -429,6 +435,7 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               num_inflate_threads=None,
                name=None):
     """Creates a `TFRecordDataset` to read one or more TFRecord files.
 
@@ -449,6 +456,11 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
         input pipeline is I/O bottlenecked, consider setting this parameter to a
         value greater than one to parallelize the I/O. If `None`, files will be
         read sequentially.
+      num_inflate_threads: (Optional.) A Python integer representing the number
+        of threads used to inflate each GZIP file written with
+        `tf.io.TFRecordOptions(gzip_member_size=...)`. Other files are inflated
+        on the reading thread. If `None`, files are inflated on the reading
+        thread.
       name: (Optional.) A name for the tf.data operation.
 
     Raises:
@@ -461,10 +473,15 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
     self._compression_type = compression_type
     self._buffer_size = buffer_size
     self._num_parallel_reads = num_parallel_reads
+    self._num_inflate_threads = num_inflate_threads
 
     def creator_fn(filename):
       return _TFRecordDataset(
-          filename, compression_type, buffer_size, name=name)
+          filename,
+          compression_type,
+          buffer_size,
+          num_inflate_threads=num_inflate_threads,
+          name=name)
 
     self._impl = _create_dataset_reader(
         creator_fn, filenames, num_parallel_reads, name=name)
@@ -488,9 +505,15 @@ class TFRecordDatasetV1(dataset_ops.DatasetV1Adapter):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               num_inflate_threads=None,
                name=None):
     wrapped = TFRecordDatasetV2(
-        filenames, compression_type, buffer_size, num_parallel_reads, name=name)
+        filenames,
+        compression_type,
+        buffer_size,
+        num_parallel_reads,
+        num_inflate_threads=num_inflate_threads,
+        name=name)
     super(TFRecordDatasetV1, self).__init__(wrapped)
 
   __init__.__doc__ = TFRecordDatasetV2.__init__.__doc__
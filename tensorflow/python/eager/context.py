@@ -1159,6 +1159,7 @@ class Context(object):
     rewriter_toggle("debug_stripper")
     rewriter_bool("disable_model_pruning")
     rewriter_toggle("scoped_allocator_optimization")
+    rewriter_toggle("horizontal_batching")
     rewriter_toggle("pin_to_host_optimization")
     rewriter_toggle("implementation_selector")
     rewriter_toggle("auto_mixed_precision")
@@ -1810,6 +1811,7 @@ class Context(object):
     rewriter_toggle("debug_stripper")
     rewriter_bool("disable_model_pruning")
     rewriter_toggle("scoped_allocator_optimization")
+    rewriter_toggle("horizontal_batching")
     rewriter_toggle("pin_to_host_optimization")
     rewriter_toggle("implementation_selector")
     rewriter_toggle("auto_mixed_precision")
@@ -227,6 +227,9 @@ def set_optimizer_experimental_options(options):
       - disable_model_pruning: Disable removal of unnecessary ops from the graph
       - scoped_allocator_optimization: Try to allocate some independent Op
         outputs contiguously in order to merge or eliminate downstream Ops.
+      - horizontal_batching: Merge independent MatMul and Conv2D ops that read
+        the same input, or small MatMuls with identical shapes, into a single
+        kernel launch.
       - pin_to_host_optimization: Force small ops onto the CPU.
       - implementation_selector: Enable the swap of kernel implementations based
         on the device placement.
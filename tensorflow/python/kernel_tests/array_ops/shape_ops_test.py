@@ -457,6 +457,18 @@ class TileTest(test.TestCase, parameterized.TestCase):
     self.assertEqual(result.shape, (10, 0))
     self.assertEqual([10, 0], tiled.get_shape())
 
+  def testLargeInnerDimension(self):
+    # Inputs whose innermost dimension is large enough are tiled by copying
+    # whole innermost rows.
+    for shape, multiples in [([5, 40], [1, 3]), ([5, 40], [2, 1]),
+                             ([5, 40], [3, 2]), ([3, 5, 40], [2, 1, 50])]:
+      with self.subTest(shape=shape, multiples=multiples):
+        with self.cached_session(use_gpu=False):
+          inp = np.random.rand(*shape).astype(np.float32)
+          tiled = array_ops.tile(inp, multiples)
+          result = self.evaluate(tiled)
+        self.assertAllEqual(result, np.tile(inp, multiples))
+
   @test_util.run_deprecated_v1
   def testUnknownInputShape(self):
     """Importing can call _TileShape without shape of <multiples> known."""
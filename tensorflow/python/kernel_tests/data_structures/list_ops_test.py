@@ -565,6 +565,27 @@ class ListOpsTest(test_util.TensorFlowTestCase, parameterized.TestCase):
     with context.device("gpu:0"):
       self.testTensorListFromTensor()
 
+  def testStackAndGatherListFromTensor(self):
+    # Elements large enough to be aligned are kept as slices of the tensor.
+    t = np.arange(64, dtype=np.float32).reshape([4, 16])
+    l = list_ops.tensor_list_from_tensor(t, element_shape=[16])
+    self.assertAllEqual(
+        list_ops.tensor_list_stack(l, element_dtype=dtypes.float32), t)
+    self.assertAllEqual(
+        list_ops.tensor_list_gather(l, [1, 2], element_dtype=dtypes.float32),
+        t[1:3])
+    self.assertAllEqual(
+        list_ops.tensor_list_gather(l, [2, 1], element_dtype=dtypes.float32),
+        t[[2, 1]])
+    l = list_ops.tensor_list_set_item(l, 1, np.zeros([16], np.float32))
+    expected = np.copy(t)
+    expected[1] = 0
+    self.assertAllEqual(
+        list_ops.tensor_list_stack(l, element_dtype=dtypes.float32), expected)
+    self.assertAllEqual(
+        list_ops.tensor_list_gather(l, [0, 1], element_dtype=dtypes.float32),
+        expected[0:2])
+
   def testGetSetBool(self):
     t = constant_op.constant([True, False])
     l = list_ops.tensor_list_from_tensor(t, element_shape=[])
@@ -128,6 +128,21 @@ class SegmentReductionOpTest(SegmentReductionHelper):
               # and may therefore vary dynamically.
               self.assertAllEqual(np_ans.shape[1:], tf_ans.shape[1:])
 
+  def testLargeSkewedSegments(self):
+    # Large enough to be reduced in parallel, with most rows in one segment
+    # and some segment ids missing.
+    num_rows, num_cols, num_segments = 20000, 8, 64
+    rng = np.random.RandomState(0)
+    np_x = rng.uniform(size=(num_rows, num_cols))
+    indices = np.sort(
+        np.where(rng.uniform(size=num_rows) < 0.9, 5,
+                 rng.randint(0, num_segments, size=num_rows)))
+    np_sum = np.zeros((indices[-1] + 1, num_cols))
+    np.add.at(np_sum, indices, np_x)
+    with self.session(use_gpu=False):
+      self.assertAllClose(
+          np_sum, self.evaluate(math_ops.segment_sum(np_x, indices)))
+
   @test_util.run_deprecated_v1
   def testSegmentIdsShape(self):
     shape = [4, 4]
@@ -528,6 +543,26 @@ class UnsortedSegmentTest(SegmentReductionHelper):
       unsorted = math_ops.unsorted_segment_sum(data, segment_ids, 2)
       self.assertAllClose(unsorted.eval(), np.zeros((2, 1), dtype=np.float32))
 
+  def testLargeSkewedSegments(self):
+    # Large enough to be reduced in parallel, with most rows in one segment.
+    num_rows, num_cols, num_segments = 20000, 8, 64
+    rng = np.random.RandomState(0)
+    np_x = rng.uniform(size=(num_rows, num_cols))
+    skewed = np.where(rng.uniform(size=num_rows) < 0.9, 5,
+                      rng.randint(-1, num_segments, size=num_rows))
+    for indices in skewed, np.sort(skewed):
+      np_sum = np.zeros((num_segments, num_cols))
+      np_max = np.full((num_segments, num_cols), np.finfo(np.float64).min)
+      kept = indices >= 0
+      np.add.at(np_sum, indices[kept], np_x[kept])
+      np.maximum.at(np_max, indices[kept], np_x[kept])
+      with self.session(use_gpu=False):
+        for tf_op, np_ans in [(math_ops.unsorted_segment_sum, np_sum),
+                              (math_ops.unsorted_segment_max, np_max)]:
+          tf_ans = self.evaluate(
+              tf_op(np_x, segment_ids=indices, num_segments=num_segments))
+          self.assertAllClose(np_ans, tf_ans)
+
 
 class SparseSegmentReductionHelper(SegmentReductionHelper):
 
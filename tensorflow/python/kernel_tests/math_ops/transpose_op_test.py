@@ -444,6 +444,21 @@ class TransposeTest(test.TestCase):
         self._compare_cpu_gpu(
             np.arange(np.prod(shape)).reshape(shape).astype(np.float32))
 
+  def testTiledAndRowCopyCpu(self):
+    # 2-D and batched 2-D transposes are processed in tiles, including partial
+    # ones at the edges, and permutations that keep a large enough innermost
+    # dimension in place copy whole rows.
+    for dtype in [np.int8, np.int16, np.int32, np.int64]:
+      with self.subTest(dtype=dtype):
+        x = np.arange(0, 2 * 130 * 67).astype(dtype)
+        self._compareCpu(x.reshape([2 * 130, 67]), [1, 0])
+        self._compareCpu(x.reshape([2, 130, 67]), [0, 2, 1])
+        self._compareCpu(x.reshape([2, 5, 26, 67]), [2, 0, 1, 3])
+        self._compareCpu(x.reshape([2, 5, 26, 67]), [0, 1, 2, 3])
+    x = (np.arange(0, 48) + 1j * np.arange(48, 96)).astype(np.complex64)
+    self._compareCpu(x.reshape([6, 8]), [1, 0], conjugate=True)
+    self._compareCpu(x.reshape([2, 3, 8]), [1, 0, 2], conjugate=True)
+
   def testTransposeShapes(self):
     self.assertEqual([],
                      array_ops.transpose(
@@ -314,7 +314,11 @@ PYBIND11_MODULE(_pywrap_record_io, m) {
                      &ZlibCompressionOptions::compression_method)
       .def_readwrite("mem_level", &ZlibCompressionOptions::mem_level)
       .def_readwrite("compression_strategy",
-                     &ZlibCompressionOptions::compression_strategy);
+                     &ZlibCompressionOptions::compression_strategy)
+      .def_readwrite("gzip_member_size",
+                     &ZlibCompressionOptions::gzip_member_size)
+      .def_readwrite("num_inflate_threads",
+                     &ZlibCompressionOptions::num_inflate_threads);
 
   using tensorflow::io::RecordWriterOptions;
   py::class_<RecordWriterOptions>(m, "RecordWriterOptions")
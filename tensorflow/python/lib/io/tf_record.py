@@ -53,7 +53,8 @@ class TFRecordOptions(object):
                compression_level=None,
                compression_method=None,
                mem_level=None,
-               compression_strategy=None):
+               compression_strategy=None,
+               gzip_member_size=None):
     # pylint: disable=line-too-long
     """Creates a `TFRecordOptions` instance.
 
@@ -73,6 +74,9 @@ class TFRecordOptions(object):
       compression_method: compression method or `None`.
       mem_level: 1 to 9, or `None`.
       compression_strategy: strategy or `None`. Default: Z_DEFAULT_STRATEGY.
+      gzip_member_size: int or `None`. If positive, GZIP output is written as
+        members of this many input bytes, which `tf.data.TFRecordDataset` can
+        inflate in parallel with `num_inflate_threads`.
 
     Returns:
       A `TFRecordOptions` object.
@@ -93,6 +97,7 @@ class TFRecordOptions(object):
     self.compression_method = compression_method
     self.mem_level = mem_level
     self.compression_strategy = compression_strategy
+    self.gzip_member_size = gzip_member_size
 
   @classmethod
   def get_compression_type_string(cls, options):
@@ -142,6 +147,8 @@ class TFRecordOptions(object):
       options.zlib_options.mem_level = self.mem_level
     if self.compression_strategy is not None:
       options.zlib_options.compression_strategy = self.compression_strategy
+    if self.gzip_member_size is not None:
+      options.zlib_options.gzip_member_size = self.gzip_member_size
     return options
 
 
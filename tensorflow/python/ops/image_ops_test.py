@@ -4487,6 +4487,37 @@ class JpegTest(test_util.TensorFlowTestCase):
           result = image_ops.decode_and_crop_jpeg(jpeg0, crop_window)
           self.evaluate(result)
 
+  def testDecodeCropAndResizeJpeg(self):
+    with self.cached_session():
+      base = "tensorflow/core/lib/jpeg/testdata"
+      jpeg0 = io_ops.read_file(os.path.join(base, "jpeg_merge_test1.jpg"))
+
+      # The crop window is too small to be decoded at a reduced scale, so the
+      # result matches the unfused ops.
+      crop_window = [6, 5, 100, 60]
+      size = [80, 50]
+      image1 = image_ops.decode_and_crop_jpeg(jpeg0, crop_window, channels=3)
+      image1 = array_ops.squeeze(
+          gen_image_ops.resize_bilinear(
+              array_ops.expand_dims(image1, 0), size, half_pixel_centers=True),
+          [0])
+      image2 = gen_image_ops.decode_crop_and_resize_jpeg(
+          jpeg0, crop_window, size, channels=3, half_pixel_centers=True)
+      self.assertAllEqual([80, 50, 3], image2.get_shape().as_list())
+      image1, image2 = self.evaluate([image1, image2])
+      self.assertAllClose(image1, image2)
+
+      # The whole image is decoded at 1/8 scale, which averages 8x8 blocks.
+      crop_window = [0, 0, 256, 128]
+      size = [32, 16]
+      image1 = image_ops.resize_images_v2(
+          image_ops.decode_jpeg(jpeg0, channels=3), size,
+          method=image_ops.ResizeMethod.AREA)
+      image2 = gen_image_ops.decode_crop_and_resize_jpeg(
+          jpeg0, crop_window, size, channels=3, half_pixel_centers=True)
+      image1, image2 = self.evaluate([image1, image2])
+      self.assertLess(np.mean(np.abs(image1 - image2)), 4.0)
+
   def testSynthetic(self):
     with self.cached_session():
       # Encode it, then decode it, then encode it
@@ -116,6 +116,8 @@ enum class Epilogue {
   kReLU = 2,                      // Apply ReLU func point-wise to the results
   kBias = 4,                      // Add broadcasted bias vector to the results
   kBiasThenReLU = kBias | kReLU,  // Apply bias and then ReLU transform
+  kGELU = 32,  // Apply GELU (tanh approximation) point-wise to the results
+  kBiasThenGELU = kBias | kGELU,  // Apply bias and then GELU transform
 };
 
 // Converts a ComputationType to a string.
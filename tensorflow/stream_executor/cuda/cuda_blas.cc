@@ -482,7 +482,7 @@ cublasLtPointerMode_t CUBLASPointerMode(blas::PointerMode pointer_mode) {
       return CUBLASLT_POINTER_MODE_DEVICE;
   }
 }
-cublasLtEpilogue_t CUBLASEpilogue(blas::Epilogue epilogue) {
+port::StatusOr<cublasLtEpilogue_t> CUBLASEpilogue(blas::Epilogue epilogue) {
   switch (epilogue) {
     case blas::Epilogue::kDefault:
       return CUBLASLT_EPILOGUE_DEFAULT;
@@ -492,8 +492,26 @@ cublasLtEpilogue_t CUBLASEpilogue(blas::Epilogue epilogue) {
       return CUBLASLT_EPILOGUE_BIAS;
     case blas::Epilogue::kBiasThenReLU:
       return CUBLASLT_EPILOGUE_RELU_BIAS;
+#if CUDA_VERSION >= 11040
+    case blas::Epilogue::kGELU:
+      return CUBLASLT_EPILOGUE_GELU;
+    case blas::Epilogue::kBiasThenGELU:
+      return CUBLASLT_EPILOGUE_GELU_BIAS;
+#else
+    case blas::Epilogue::kGELU:
+    case blas::Epilogue::kBiasThenGELU:
+      return port::Status(port::error::UNIMPLEMENTED,
+                          "GELU epilogues require CUDA 11.4 or newer");
+#endif  // CUDA_VERSION >= 11040
   }
 }
+
+// Returns true if the epilogue reads a bias vector.
+bool EpilogueHasBias(blas::Epilogue epilogue) {
+  return epilogue == blas::Epilogue::kBias ||
+         epilogue == blas::Epilogue::kBiasThenReLU ||
+         epilogue == blas::Epilogue::kBiasThenGELU;
+}
 #endif  // CUDA_VERSION >= 11000
 
 cudaDataType_t GetCUDADataType(blas::DataType ty) {
@@ -3239,8 +3257,10 @@ port::StatusOr<UniqueOpDesc> CreateCublasLtOperationDesc(
   UniqueOpDesc unique_desc(desc);
   SE_RETURN_IF_ERROR(SetCublasLtAttr(desc, CUBLASLT_MATMUL_DESC_POINTER_MODE,
                                      CUBLASPointerMode(pointer_mode)));
+  SE_ASSIGN_OR_RETURN(cublasLtEpilogue_t cublas_epilogue,
+                      CUBLASEpilogue(epilogue));
   SE_RETURN_IF_ERROR(SetCublasLtAttr(desc, CUBLASLT_MATMUL_DESC_EPILOGUE,
-                                     CUBLASEpilogue(epilogue)));
+                                     cublas_epilogue));
   SE_RETURN_IF_ERROR(SetCublasLtAttr(desc, CUBLASLT_MATMUL_DESC_TRANSA,
                                      CUDABlasTranspose(transa)));
   SE_RETURN_IF_ERROR(SetCublasLtAttr(desc, CUBLASLT_MATMUL_DESC_TRANSB,
@@ -3599,9 +3619,7 @@ bool CUDABlas::DoBlasLtMatmulInternal(
                "pointer_mode for the given alpha/beta.";
     return false;
   }
-  if ((cuda_plan.params().epilogue == blas::Epilogue::kBias ||
-       cuda_plan.params().epilogue == blas::Epilogue::kBiasThenReLU) !=
-      (bias != nullptr)) {
+  if (EpilogueHasBias(cuda_plan.params().epilogue) != (bias != nullptr)) {
     VLOG(2) << "DoBlasLtMatmul returning false because plan has wrong "
                "epilogue for the given bias pointer.";
     return false;
@@ -1070,6 +1070,88 @@ GpuDriver::CreateMemoryHandle(GpuContext* context, uint64_t bytes) {
   return false;
 }
 
+/* static */ port::Status GpuDriver::StreamBeginCapture(GpuContext* context,
+                                                        CUstream stream) {
+  ScopedActivateContext activated{context};
+  CHECK(stream != nullptr);
+  RETURN_IF_CUDA_RES_ERROR(
+      cuStreamBeginCapture(stream, CU_STREAM_CAPTURE_MODE_THREAD_LOCAL),
+      "Failed to begin capturing CUDA stream");
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::StreamEndCapture(GpuContext* context,
+                                                      CUstream stream,
+                                                      CUgraph* graph) {
+  ScopedActivateContext activated{context};
+  CHECK(stream != nullptr);
+  RETURN_IF_CUDA_RES_ERROR(cuStreamEndCapture(stream, graph),
+                           "Failed to end capturing CUDA stream");
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::GraphInstantiate(GpuContext* context,
+                                                      CUgraph graph,
+                                                      CUgraphExec* exec) {
+  ScopedActivateContext activated{context};
+#if CUDA_VERSION >= 12000
+  RETURN_IF_CUDA_RES_ERROR(cuGraphInstantiate(exec, graph, /*flags=*/0),
+                           "Failed to instantiate CUDA graph");
+#else
+  RETURN_IF_CUDA_RES_ERROR(
+      cuGraphInstantiate(exec, graph, /*phErrorNode=*/nullptr,
+                         /*logBuffer=*/nullptr, /*bufferSize=*/0),
+      "Failed to instantiate CUDA graph");
+#endif  // CUDA_VERSION >= 12000
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::GraphExecUpdate(GpuContext* context,
+                                                     CUgraphExec exec,
+                                                     CUgraph graph) {
+  ScopedActivateContext activated{context};
+#if CUDA_VERSION >= 12000
+  CUgraphExecUpdateResultInfo result_info;
+  RETURN_IF_CUDA_RES_ERROR(cuGraphExecUpdate(exec, graph, &result_info),
+                           "Failed to update CUDA graph");
+#else
+  CUgraphNode error_node;
+  CUgraphExecUpdateResult result;
+  RETURN_IF_CUDA_RES_ERROR(cuGraphExecUpdate(exec, graph, &error_node, &result),
+                           "Failed to update CUDA graph");
+#endif  // CUDA_VERSION >= 12000
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::GraphLaunch(GpuContext* context,
+                                                 CUgraphExec exec,
+                                                 CUstream stream) {
+  ScopedActivateContext activated{context};
+  RETURN_IF_CUDA_RES_ERROR(cuGraphLaunch(exec, stream),
+                           "Failed to launch CUDA graph");
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::DestroyGraph(GpuContext* context,
+                                                  CUgraph* graph) {
+  if (*graph == nullptr) return ::tensorflow::OkStatus();
+  ScopedActivateContext activated{context};
+  RETURN_IF_CUDA_RES_ERROR(cuGraphDestroy(*graph),
+                           "Failed to destroy CUDA graph");
+  *graph = nullptr;
+  return ::tensorflow::OkStatus();
+}
+
+/* static */ port::Status GpuDriver::DestroyGraphExec(GpuContext* context,
+                                                      CUgraphExec* exec) {
+  if (*exec == nullptr) return ::tensorflow::OkStatus();
+  ScopedActivateContext activated{context};
+  RETURN_IF_CUDA_RES_ERROR(cuGraphExecDestroy(*exec),
+                           "Failed to destroy CUDA graph executable");
+  *exec = nullptr;
+  return ::tensorflow::OkStatus();
+}
+
 /* static */ port::Status GpuDriver::SynchronousMemcpyD2H(GpuContext* context,
                                                           void* host_dst,
                                                           CUdeviceptr gpu_src,
@@ -16,6 +16,8 @@ limitations under the License.
 #if GOOGLE_CUDA
 #include "tensorflow/stream_executor/cuda/cuda_driver.h"
 
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "third_party/gpus/cuda/include/cuda_runtime_api.h"
 #include "tensorflow/core/platform/test.h"
@@ -70,6 +72,60 @@ TEST(CudaDriverTest, ScopedActivateContextTest) {
   }
 }
 
+TEST(CudaDriverTest, GraphCaptureUpdateAndLaunchTest) {
+  CHECK_CUDA(cuInit(0));
+  CUdevice device;
+  CHECK_CUDA(cuDeviceGet(&device, 0));
+  CUcontext context;
+  CHECK_CUDA(cuCtxCreate(&context, 0, device));
+  GpuContext se_context(context, /*id=*/102);
+  ScopedActivateContext scope(&se_context);
+  CUstream stream;
+  CHECK_CUDA(cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING));
+  constexpr int kNumElements = 1024;
+  CUdeviceptr buffer;
+  CHECK_CUDA(cuMemAlloc(&buffer, kNumElements * sizeof(uint32_t)));
+
+  // Captures a memset of `buffer` to `value` into a new graph.
+  auto capture = [&](uint32_t value) {
+    CUgraph graph = nullptr;
+    TF_CHECK_OK(GpuDriver::StreamBeginCapture(&se_context, stream));
+    CHECK_CUDA(cuMemsetD32Async(buffer, value, kNumElements, stream));
+    TF_CHECK_OK(GpuDriver::StreamEndCapture(&se_context, stream, &graph));
+    return graph;
+  };
+  auto expect_buffer = [&](uint32_t value) {
+    TF_CHECK_OK(GpuDriver::SynchronizeStream(&se_context, stream));
+    std::vector<uint32_t> host(kNumElements);
+    CHECK_CUDA(
+        cuMemcpyDtoH(host.data(), buffer, host.size() * sizeof(uint32_t)));
+    EXPECT_EQ(host, std::vector<uint32_t>(kNumElements, value));
+  };
+
+  // Capturing only records the memset; launching the graph runs it.
+  CHECK_CUDA(cuMemsetD32(buffer, 0, kNumElements));
+  CUgraph graph = capture(7);
+  CUgraphExec exec = nullptr;
+  TF_CHECK_OK(GpuDriver::GraphInstantiate(&se_context, graph, &exec));
+  TF_CHECK_OK(GpuDriver::DestroyGraph(&se_context, &graph));
+  EXPECT_EQ(graph, nullptr);
+  expect_buffer(0);
+  TF_CHECK_OK(GpuDriver::GraphLaunch(&se_context, exec, stream));
+  expect_buffer(7);
+
+  // A capture with the same topology updates the executable graph in place.
+  graph = capture(11);
+  TF_CHECK_OK(GpuDriver::GraphExecUpdate(&se_context, exec, graph));
+  TF_CHECK_OK(GpuDriver::DestroyGraph(&se_context, &graph));
+  TF_CHECK_OK(GpuDriver::GraphLaunch(&se_context, exec, stream));
+  expect_buffer(11);
+
+  TF_CHECK_OK(GpuDriver::DestroyGraphExec(&se_context, &exec));
+  EXPECT_EQ(exec, nullptr);
+  CHECK_CUDA(cuMemFree(buffer));
+  CHECK_CUDA(cuStreamDestroy(stream));
+}
+
 }  // namespace gpu
 }  // namespace stream_executor
 
@@ -409,6 +409,52 @@ class GpuDriver {
   // the stream immediately after this returns).
   static bool IsStreamIdle(GpuContext* context, GpuStreamHandle stream);
 
+  // Starts capturing the work enqueued onto stream into a graph, instead of
+  // executing it, via cuStreamBeginCapture. The capture uses the thread-local
+  // mode, so only the calling thread is barred from making unsafe API calls
+  // (such as synchronous memcpys) until StreamEndCapture.
+  // (supported on CUDA only)
+  static port::Status StreamBeginCapture(GpuContext* context,
+                                         GpuStreamHandle stream);
+
+  // Ends the capture started on stream by StreamBeginCapture and returns the
+  // captured graph in *graph, which the caller owns, via cuStreamEndCapture.
+  // (supported on CUDA only)
+  static port::Status StreamEndCapture(GpuContext* context,
+                                       GpuStreamHandle stream,
+                                       GpuGraphHandle* graph);
+
+  // Creates an executable graph from graph via cuGraphInstantiate. The result
+  // does not depend on graph, which may be destroyed afterwards.
+  // (supported on CUDA only)
+  static port::Status GraphInstantiate(GpuContext* context,
+                                       GpuGraphHandle graph,
+                                       GpuGraphExecHandle* exec);
+
+  // Updates the node parameters of exec (kernel arguments and memory
+  // addresses) in place to those of graph, via cuGraphExecUpdate. Fails if
+  // graph does not have the same topology as the graph exec was instantiated
+  // from, in which case exec keeps its previous parameters.
+  // (supported on CUDA only)
+  static port::Status GraphExecUpdate(GpuContext* context,
+                                      GpuGraphExecHandle exec,
+                                      GpuGraphHandle graph);
+
+  // Enqueues the work of exec onto stream as a single launch, via
+  // cuGraphLaunch.
+  // (supported on CUDA only)
+  static port::Status GraphLaunch(GpuContext* context, GpuGraphExecHandle exec,
+                                  GpuStreamHandle stream);
+
+  // Destroys *graph and turns it into a nullptr, via cuGraphDestroy.
+  // (supported on CUDA only)
+  static port::Status DestroyGraph(GpuContext* context, GpuGraphHandle* graph);
+
+  // Destroys *exec and turns it into a nullptr, via cuGraphExecDestroy.
+  // (supported on CUDA only)
+  static port::Status DestroyGraphExec(GpuContext* context,
+                                       GpuGraphExecHandle* exec);
+
   // Returns whether code in the from context can access memory in the to
   // context via cuDeviceCanAccessPeer.
   // http://docs.nvidia.com/cuda/cuda-driver-api/group__CUDA__PEER__ACCESS.html#group__CUDA__PEER__ACCESS_1g496bdaae1f632ebfb695b99d2c40f19e
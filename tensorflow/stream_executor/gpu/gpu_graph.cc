@@ -0,0 +1,93 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/stream_executor/gpu/gpu_graph.h"
+
+#include "tensorflow/stream_executor/gpu/gpu_executor.h"
+#include "tensorflow/stream_executor/lib/status_macros.h"
+#include "tensorflow/stream_executor/platform/logging.h"
+
+namespace stream_executor {
+namespace gpu {
+
+GpuGraph::GpuGraph(GpuExecutor* parent) : parent_(parent), exec_(nullptr) {}
+
+GpuGraph::~GpuGraph() {
+  if (exec_ == nullptr) return;
+  port::Status status =
+      GpuDriver::DestroyGraphExec(parent_->gpu_context(), &exec_);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+  }
+}
+
+port::Status GpuGraph::Capture(GpuStream* stream,
+                               const std::function<port::Status()>& record) {
+  GpuContext* context = parent_->gpu_context();
+  SE_RETURN_IF_ERROR(
+      GpuDriver::StreamBeginCapture(context, stream->gpu_stream()));
+  const port::Status record_status = record();
+  // Always end the capture, so that the stream can be used again even if
+  // `record` failed.
+  GpuGraphHandle graph = nullptr;
+  const port::Status end_status =
+      GpuDriver::StreamEndCapture(context, stream->gpu_stream(), &graph);
+
+  port::Status status = record_status;
+  status.Update(end_status);
+  if (status.ok() && exec_ != nullptr &&
+      GpuDriver::GraphExecUpdate(context, exec_, graph).ok()) {
+    ++num_updates_;
+  } else if (status.ok()) {
+    // This is the first capture, or the topology changed, e.g. because a
+    // shape did. Only replace the executable graph once the new one exists.
+    if (exec_ != nullptr) {
+      VLOG(2) << "GPU graph changed topology; instantiating it again";
+    }
+    GpuGraphExecHandle exec = nullptr;
+    status = GpuDriver::GraphInstantiate(context, graph, &exec);
+    if (status.ok()) {
+      if (exec_ != nullptr) {
+        port::Status destroy_status =
+            GpuDriver::DestroyGraphExec(context, &exec_);
+        if (!destroy_status.ok()) {
+          LOG(ERROR) << destroy_status;
+        }
+      }
+      exec_ = exec;
+      ++num_instantiations_;
+    }
+  }
+  // The executable graph does not depend on the captured graph.
+  if (graph != nullptr) {
+    port::Status destroy_status = GpuDriver::DestroyGraph(context, &graph);
+    if (!destroy_status.ok()) {
+      LOG(ERROR) << destroy_status;
+    }
+  }
+  return status;
+}
+
+port::Status GpuGraph::Launch(GpuStream* stream) {
+  if (exec_ == nullptr) {
+    return port::Status(port::error::FAILED_PRECONDITION,
+                        "GPU graph must be captured before it is launched");
+  }
+  return GpuDriver::GraphLaunch(parent_->gpu_context(), exec_,
+                                stream->gpu_stream());
+}
+
+}  // namespace gpu
+}  // namespace stream_executor
@@ -0,0 +1,82 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_H_
+#define TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "tensorflow/stream_executor/gpu/gpu_driver.h"
+#include "tensorflow/stream_executor/gpu/gpu_stream.h"
+#include "tensorflow/stream_executor/lib/status.h"
+
+namespace stream_executor {
+namespace gpu {
+
+// GpuGraph records the work enqueued onto a GpuStream into a GPU graph and
+// replays it with a single launch. This removes the per-kernel launch
+// overhead of a fixed sequence of small kernels that runs many times, such as
+// one inference step with static shapes.
+//
+// A graph replays exactly the kernels, arguments and memory addresses it
+// captured. The caller must capture again whenever any of them changes, for
+// example when an input lives in a new buffer. When the new capture has the
+// same topology, the executable graph is updated in place, which is much
+// cheaper than instantiating it again.
+class GpuGraph {
+ public:
+  explicit GpuGraph(GpuExecutor* parent);
+
+  // Destroys the executable graph, if any. The caller must ensure that no
+  // launch of it is still pending.
+  ~GpuGraph();
+
+  GpuGraph(const GpuGraph&) = delete;
+  GpuGraph& operator=(const GpuGraph&) = delete;
+
+  // Captures the work that `record` enqueues onto `stream` into the graph,
+  // without executing it. `record` must only enqueue work, and must not
+  // synchronize with the stream or make other calls that are illegal during a
+  // capture. On failure, the graph keeps its previous contents.
+  port::Status Capture(GpuStream* stream,
+                       const std::function<port::Status()>& record);
+
+  // Enqueues the captured work onto `stream`. Requires a successful Capture.
+  port::Status Launch(GpuStream* stream);
+
+  // Whether the graph holds a capture that can be launched.
+  bool is_instantiated() const { return exec_ != nullptr; }
+
+  // The number of captures that had to instantiate a new executable graph,
+  // and the number that updated the existing one in place.
+  int64_t num_instantiations() const { return num_instantiations_; }
+  int64_t num_updates() const { return num_updates_; }
+
+ private:
+  // The Executor to which this object and its graph are bound.
+  GpuExecutor* parent_;
+
+  // The executable graph of the last successful capture.
+  GpuGraphExecHandle exec_;
+
+  int64_t num_instantiations_ = 0;
+  int64_t num_updates_ = 0;
+};
+
+}  // namespace gpu
+}  // namespace stream_executor
+
+#endif  // TENSORFLOW_STREAM_EXECUTOR_GPU_GPU_GRAPH_H_
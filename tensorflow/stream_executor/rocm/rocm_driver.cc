@@ -840,6 +840,57 @@ GpuDriver::ContextGetSharedMemConfig(GpuContext* context) {
   return false;
 }
 
+/* static */ port::Status GpuDriver::StreamBeginCapture(GpuContext* context,
+                                                        hipStream_t stream) {
+  return port::Status{
+      port::error::UNIMPLEMENTED,
+      "Feature not supported on ROCm platform (StreamBeginCapture)"};
+}
+
+/* static */ port::Status GpuDriver::StreamEndCapture(GpuContext* context,
+                                                      hipStream_t stream,
+                                                      hipGraph_t* graph) {
+  return port::Status{
+      port::error::UNIMPLEMENTED,
+      "Feature not supported on ROCm platform (StreamEndCapture)"};
+}
+
+/* static */ port::Status GpuDriver::GraphInstantiate(GpuContext* context,
+                                                      hipGraph_t graph,
+                                                      hipGraphExec_t* exec) {
+  return port::Status{
+      port::error::UNIMPLEMENTED,
+      "Feature not supported on ROCm platform (GraphInstantiate)"};
+}
+
+/* static */ port::Status GpuDriver::GraphExecUpdate(GpuContext* context,
+                                                     hipGraphExec_t exec,
+                                                     hipGraph_t graph) {
+  return port::Status{
+      port::error::UNIMPLEMENTED,
+      "Feature not supported on ROCm platform (GraphExecUpdate)"};
+}
+
+/* static */ port::Status GpuDriver::GraphLaunch(GpuContext* context,
+                                                 hipGraphExec_t exec,
+                                                 hipStream_t stream) {
+  return port::Status{port::error::UNIMPLEMENTED,
+                      "Feature not supported on ROCm platform (GraphLaunch)"};
+}
+
+/* static */ port::Status GpuDriver::DestroyGraph(GpuContext* context,
+                                                  hipGraph_t* graph) {
+  return port::Status{port::error::UNIMPLEMENTED,
+                      "Feature not supported on ROCm platform (DestroyGraph)"};
+}
+
+/* static */ port::Status GpuDriver::DestroyGraphExec(GpuContext* context,
+                                                      hipGraphExec_t* exec) {
+  return port::Status{
+      port::error::UNIMPLEMENTED,
+      "Feature not supported on ROCm platform (DestroyGraphExec)"};
+}
+
 /* static */ port::Status GpuDriver::SynchronousMemcpyD2H(
     GpuContext* context, void* host_dst, hipDeviceptr_t gpu_src,
     uint64_t size) {
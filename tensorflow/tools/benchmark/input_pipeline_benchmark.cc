@@ -0,0 +1,342 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A C++ binary to benchmark a whole tf.data input pipeline against synthetic
+// storage, for a range of storage models and autotuning settings.
+//
+// See README.md for usage instructions.
+
+#include "tensorflow/tools/benchmark/input_pipeline_benchmark.h"
+
+#include <ctime>
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/numbers.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace input_pipeline_benchmark {
+namespace {
+
+constexpr char kOptionsNodeName[] = "input_pipeline_benchmark/options";
+constexpr char kAutotuneOff[] = "OFF";
+
+// Rewrites the string constants of `nodes` found in `renamed`.
+void RenameStringConstants(
+    const absl::flat_hash_map<std::string, std::string>& renamed,
+    protobuf::RepeatedPtrField<NodeDef>* nodes) {
+  for (NodeDef& node : *nodes) {
+    if (node.op() != "Const") continue;
+    auto it = node.mutable_attr()->find("value");
+    if (it == node.mutable_attr()->end() || !it->second.has_tensor()) continue;
+    TensorProto* tensor = it->second.mutable_tensor();
+    if (tensor->dtype() != DT_STRING) continue;
+    for (std::string& value : *tensor->mutable_string_val()) {
+      auto renamed_it = renamed.find(value);
+      if (renamed_it != renamed.end()) value = renamed_it->second;
+    }
+  }
+}
+
+std::string AutotuneName(const AutotuneConfig& config) {
+  if (!config.enabled) return kAutotuneOff;
+  return data::model::AutotuneAlgorithm_Name(config.algorithm);
+}
+
+bool ParseInt64List(const std::string& text, std::vector<int64_t>* values) {
+  for (const std::string& item : str_util::Split(text, ',')) {
+    int64_t value;
+    if (!strings::safe_strto64(item, &value) || value < 0) return false;
+    values->push_back(value);
+  }
+  return !values->empty();
+}
+
+}  // namespace
+
+double PipelineResult::ElementsPerSecond() const {
+  return wall_seconds > 0 ? elements / wall_seconds : 0;
+}
+
+double PipelineResult::CpuMicrosPerElement() const {
+  return elements > 0 ? cpu_seconds * 1e6 / elements : 0;
+}
+
+Status ApplyAutotuneConfig(const GraphDef& graph_def,
+                           const DataTypeVector& output_dtypes,
+                           const std::vector<PartialTensorShape>& output_shapes,
+                           const AutotuneConfig& config, GraphDef* result) {
+  *result = graph_def;
+  int retval_index = -1;
+  for (int i = 0; i < result->node_size(); ++i) {
+    if (result->node(i).op() == "_Retval") retval_index = i;
+    if (result->node(i).name() == kOptionsNodeName) {
+      return errors::AlreadyExists("Graph already has a node named ",
+                                   kOptionsNodeName);
+    }
+  }
+  if (retval_index < 0 || result->node(retval_index).input_size() == 0) {
+    return errors::NotFound("Failed to find a _Retval op in the given dataset");
+  }
+
+  data::Options options;
+  data::AutotuneOptions* autotune_options = options.mutable_autotune_options();
+  autotune_options->set_enabled(config.enabled);
+  if (config.enabled) {
+    if (config.algorithm != data::model::AutotuneAlgorithm::DEFAULT) {
+      autotune_options->set_autotune_algorithm(config.algorithm);
+    }
+    if (config.cpu_budget > 0) {
+      autotune_options->set_cpu_budget(config.cpu_budget);
+    }
+  }
+
+  NodeDef* retval = result->mutable_node(retval_index);
+  NodeDef* options_node = result->add_node();
+  options_node->set_name(kOptionsNodeName);
+  options_node->set_op("OptionsDataset");
+  options_node->add_input(retval->input(0));
+  AddNodeAttr("serialized_options", options.SerializeAsString(), options_node);
+  AddNodeAttr("output_types", output_dtypes, options_node);
+  AddNodeAttr("output_shapes", output_shapes, options_node);
+  retval->set_input(0, kOptionsNodeName);
+  return OkStatus();
+}
+
+Status StageFiles(const std::string& pattern, GraphDef* graph_def,
+                  std::vector<std::string>* staged_files) {
+  Env* env = Env::Default();
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env->GetMatchingPaths(pattern, &files));
+  if (files.empty()) {
+    return errors::NotFound("No files match ", pattern);
+  }
+  absl::flat_hash_map<std::string, std::string> renamed;
+  for (const std::string& file : files) {
+    std::string contents;
+    TF_RETURN_IF_ERROR(ReadFileToString(env, file, &contents));
+    TF_RETURN_IF_ERROR(
+        WriteStringToFile(env, absl::StrCat("ram://", file), contents));
+    renamed[file] =
+        absl::StrCat(ThrottledRamFileSystem::kScheme, "://", file);
+    staged_files->push_back(renamed[file]);
+  }
+  RenameStringConstants(renamed, graph_def->mutable_node());
+  for (FunctionDef& function :
+       *graph_def->mutable_library()->mutable_function()) {
+    RenameStringConstants(renamed, function.mutable_node_def());
+  }
+  return OkStatus();
+}
+
+Status RunPipeline(const GraphDef& graph_def, const PipelineConfig& config,
+                   PipelineResult* result) {
+  ThrottledRamFileSystem* fs;
+  TF_RETURN_IF_ERROR(ThrottledRamFileSystem::Get(&fs));
+  fs->SetStorageModel(config.storage);
+
+  // The output signature needed to wrap the pipeline is only known once its
+  // graph has run.
+  data::standalone::Dataset::Params params;
+  std::unique_ptr<data::standalone::Dataset> dataset;
+  TF_RETURN_IF_ERROR(
+      data::standalone::Dataset::FromGraph(params, graph_def, &dataset));
+  GraphDef configured_graph_def;
+  TF_RETURN_IF_ERROR(ApplyAutotuneConfig(
+      graph_def, dataset->Get()->output_dtypes(),
+      dataset->Get()->output_shapes(), config.autotune, &configured_graph_def));
+  TF_RETURN_IF_ERROR(data::standalone::Dataset::FromGraph(
+      params, configured_graph_def, &dataset));
+  std::unique_ptr<data::standalone::Iterator> iterator;
+  TF_RETURN_IF_ERROR(dataset->MakeIterator(&iterator));
+
+  bool end_of_input = false;
+  std::vector<Tensor> outputs;
+  for (int64_t i = 0; i < config.warmup_elements && !end_of_input; ++i) {
+    outputs.clear();
+    TF_RETURN_IF_ERROR(iterator->GetNext(&outputs, &end_of_input));
+  }
+
+  Env* env = Env::Default();
+  *result = PipelineResult();
+  const uint64 start_us = env->NowMicros();
+  const std::clock_t start_cpu = std::clock();
+  while (!end_of_input) {
+    if (config.max_elements > 0 && result->elements >= config.max_elements) {
+      break;
+    }
+    if (config.max_seconds > 0 &&
+        (env->NowMicros() - start_us) * 1e-6 >= config.max_seconds) {
+      break;
+    }
+    outputs.clear();
+    TF_RETURN_IF_ERROR(iterator->GetNext(&outputs, &end_of_input));
+    if (!end_of_input) ++result->elements;
+  }
+  result->wall_seconds = (env->NowMicros() - start_us) * 1e-6;
+  result->cpu_seconds =
+      static_cast<double>(std::clock() - start_cpu) / CLOCKS_PER_SEC;
+  return OkStatus();
+}
+
+int Main(int argc, char** argv) {
+  string graph = "";
+  string stage_files = "";
+  string latencies_us = "0";
+  string bandwidths_mb_per_sec = "0";
+  string autotune_algorithms = "OFF,DEFAULT";
+  string cpu_budgets = "0";
+  int64_t warmup_elements = 100;
+  int64_t max_elements = 10000;
+  float max_seconds = 0;
+  string output_csv = "";
+
+  std::vector<Flag> flag_list = {
+      Flag("graph", &graph, "serialized GraphDef of the dataset to benchmark"),
+      Flag("stage_files", &stage_files,
+           "comma-separated file patterns to serve from the throttled storage"),
+      Flag("latency_us", &latencies_us,
+           "comma-separated list of storage latencies, in microseconds"),
+      Flag("bandwidth_mb_per_sec", &bandwidths_mb_per_sec,
+           "comma-separated list of storage bandwidths, in MB/s, 0 for "
+           "unlimited"),
+      Flag("autotune_algorithms", &autotune_algorithms,
+           "comma-separated list of autotune algorithms, or OFF"),
+      Flag("cpu_budgets", &cpu_budgets,
+           "comma-separated list of autotune CPU budgets, 0 for the default"),
+      Flag("warmup_elements", &warmup_elements,
+           "number of elements to produce before measuring"),
+      Flag("max_elements", &max_elements,
+           "number of elements to measure, 0 for no limit"),
+      Flag("max_seconds", &max_seconds,
+           "number of seconds to measure for, 0 for no limit"),
+      Flag("output_csv", &output_csv, "file to write the results to as CSV"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_result = Flags::Parse(&argc, argv, flag_list);
+  if (!parse_result || graph.empty()) {
+    LOG(ERROR) << "--graph is required\n" << usage;
+    return -1;
+  }
+  port::InitMain(argv[0], &argc, &argv);
+  if (argc > 1) {
+    LOG(ERROR) << "Unknown argument " << argv[1] << "\n" << usage;
+    return -1;
+  }
+
+  std::vector<int64_t> latency_list, bandwidth_list, cpu_budget_list;
+  if (!ParseInt64List(latencies_us, &latency_list) ||
+      !ParseInt64List(bandwidths_mb_per_sec, &bandwidth_list) ||
+      !ParseInt64List(cpu_budgets, &cpu_budget_list)) {
+    LOG(ERROR) << "Invalid list of non-negative integers\n" << usage;
+    return -1;
+  }
+  std::vector<AutotuneConfig> autotune_configs;
+  for (const string& name : str_util::Split(autotune_algorithms, ',')) {
+    AutotuneConfig autotune;
+    if (name == kAutotuneOff) {
+      autotune.enabled = false;
+      autotune_configs.push_back(autotune);
+      continue;
+    }
+    if (!data::model::AutotuneAlgorithm_Parse(name, &autotune.algorithm)) {
+      LOG(ERROR) << "Unknown autotune algorithm " << name;
+      return -1;
+    }
+    for (int64_t cpu_budget : cpu_budget_list) {
+      autotune.cpu_budget = cpu_budget;
+      autotune_configs.push_back(autotune);
+    }
+  }
+
+  GraphDef graph_def;
+  Status status = ReadBinaryProto(Env::Default(), graph, &graph_def);
+  if (!status.ok()) status = ReadTextProto(Env::Default(), graph, &graph_def);
+  if (!status.ok()) {
+    LOG(ERROR) << "Could not read graph: " << status;
+    return -1;
+  }
+  for (const string& pattern :
+       str_util::Split(stage_files, ',', str_util::SkipEmpty())) {
+    std::vector<std::string> staged_files;
+    status = StageFiles(pattern, &graph_def, &staged_files);
+    if (!status.ok()) {
+      LOG(ERROR) << "Could not stage " << pattern << ": " << status;
+      return -1;
+    }
+    LOG(INFO) << "Staged " << staged_files.size() << " files for " << pattern;
+  }
+
+  string csv =
+      "latency_us,bandwidth_mb_per_sec,autotune,cpu_budget,elements,"
+      "wall_seconds,elements_per_second,cpu_us_per_element\n";
+  for (int64_t latency_us : latency_list) {
+    for (int64_t bandwidth_mb_per_sec : bandwidth_list) {
+      for (const AutotuneConfig& autotune : autotune_configs) {
+        PipelineConfig config;
+        config.storage.latency_us = latency_us;
+        config.storage.bandwidth_bytes_per_sec = bandwidth_mb_per_sec * 1000000;
+        config.autotune = autotune;
+        config.warmup_elements = warmup_elements;
+        config.max_elements = max_elements;
+        config.max_seconds = max_seconds;
+        PipelineResult result;
+        status = RunPipeline(graph_def, config, &result);
+        if (!status.ok()) {
+          LOG(ERROR) << "Pipeline failed: " << status;
+          return -1;
+        }
+        LOG(INFO) << "latency=" << latency_us << "us"
+                  << " bandwidth=" << bandwidth_mb_per_sec << "MB/s"
+                  << " autotune=" << AutotuneName(autotune)
+                  << " cpu_budget=" << autotune.cpu_budget << ": "
+                  << result.elements << " elements, "
+                  << result.ElementsPerSecond() << " elements/s, "
+                  << result.CpuMicrosPerElement() << " CPU us/element";
+        absl::StrAppend(&csv, latency_us, ",", bandwidth_mb_per_sec, ",",
+                        AutotuneName(autotune), ",", autotune.cpu_budget, ",",
+                        result.elements, ",", result.wall_seconds, ",",
+                        result.ElementsPerSecond(), ",",
+                        result.CpuMicrosPerElement(), "\n");
+      }
+    }
+  }
+  if (!output_csv.empty()) {
+    status = WriteStringToFile(Env::Default(), output_csv, csv);
+    if (!status.ok()) {
+      LOG(ERROR) << "Could not write " << output_csv << ": " << status;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace input_pipeline_benchmark
+}  // namespace tensorflow
@@ -0,0 +1,90 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TOOLS_BENCHMARK_INPUT_PIPELINE_BENCHMARK_H_
+#define TENSORFLOW_TOOLS_BENCHMARK_INPUT_PIPELINE_BENCHMARK_H_
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/tools/benchmark/throttled_file_system.h"
+
+namespace tensorflow {
+namespace input_pipeline_benchmark {
+
+// The autotuning settings a pipeline is measured with. They are applied on top
+// of the options already set by the pipeline.
+struct AutotuneConfig {
+  bool enabled = true;
+  data::model::AutotuneAlgorithm algorithm =
+      data::model::AutotuneAlgorithm::DEFAULT;
+  // 0 keeps the pipeline's CPU budget.
+  int32 cpu_budget = 0;
+};
+
+// One measurement of a pipeline.
+struct PipelineConfig {
+  StorageModel storage;
+  AutotuneConfig autotune;
+  // Elements produced before the measurement starts, so that autotuning and
+  // buffers have settled.
+  int64_t warmup_elements = 100;
+  // The measurement stops after this many elements, after `max_seconds`, or at
+  // the end of the input, whichever comes first. 0 means no limit.
+  int64_t max_elements = 10000;
+  double max_seconds = 0;
+};
+
+struct PipelineResult {
+  int64_t elements = 0;
+  double wall_seconds = 0;
+  // CPU time of the whole process, including the pipeline's background
+  // threads, during the measurement.
+  double cpu_seconds = 0;
+
+  double ElementsPerSecond() const;
+  double CpuMicrosPerElement() const;
+};
+
+// Sets `result` to a copy of the serialized dataset `graph_def` whose output
+// dataset applies `config`. `output_dtypes` and `output_shapes` are those of
+// the output dataset.
+Status ApplyAutotuneConfig(const GraphDef& graph_def,
+                           const DataTypeVector& output_dtypes,
+                           const std::vector<PartialTensorShape>& output_shapes,
+                           const AutotuneConfig& config, GraphDef* result);
+
+// Copies the files matching `pattern` to the throttled file system, and points
+// the string constants of `graph_def` naming them at the copies. Appends the
+// names of the copied files to `staged_files`.
+Status StageFiles(const std::string& pattern, GraphDef* graph_def,
+                  std::vector<std::string>* staged_files);
+
+// Iterates the serialized dataset `graph_def` as described by `config`.
+Status RunPipeline(const GraphDef& graph_def, const PipelineConfig& config,
+                   PipelineResult* result);
+
+// Runs the benchmark tool with the given command line.
+int Main(int argc, char** argv);
+
+}  // namespace input_pipeline_benchmark
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_TOOLS_BENCHMARK_INPUT_PIPELINE_BENCHMARK_H_
@@ -0,0 +1,297 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tools/benchmark/input_pipeline_benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace input_pipeline_benchmark {
+namespace {
+
+// range(10)
+constexpr const char* const kRangeGraphProto = R"proto(
+  node {
+    name: "Const/_0"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_INT64 }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_INT64
+          tensor_shape {}
+          int64_val: 0
+        }
+      }
+    }
+  }
+  node {
+    name: "Const/_1"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_INT64 }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_INT64
+          tensor_shape {}
+          int64_val: 10
+        }
+      }
+    }
+  }
+  node {
+    name: "Const/_2"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_INT64 }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_INT64
+          tensor_shape {}
+          int64_val: 1
+        }
+      }
+    }
+  }
+  node {
+    name: "RangeDataset/_3"
+    op: "RangeDataset"
+    input: "Const/_0"
+    input: "Const/_1"
+    input: "Const/_2"
+    attr {
+      key: "output_shapes"
+      value { list { shape {} } }
+    }
+    attr {
+      key: "output_types"
+      value { list { type: DT_INT64 } }
+    }
+  }
+  node {
+    name: "dataset"
+    op: "_Retval"
+    input: "RangeDataset/_3"
+    attr {
+      key: "T"
+      value { type: DT_VARIANT }
+    }
+    attr {
+      key: "index"
+      value { i: 0 }
+    }
+  }
+  library {}
+  versions { producer: 96 }
+)proto";
+
+// TextLineDataset(filename)
+constexpr const char* const kTextLineGraphProto = R"proto(
+  node {
+    name: "Const/_0"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_STRING }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_STRING
+          tensor_shape {}
+          string_val: "%s"
+        }
+      }
+    }
+  }
+  node {
+    name: "Const/_1"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_STRING }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_STRING
+          tensor_shape {}
+          string_val: ""
+        }
+      }
+    }
+  }
+  node {
+    name: "Const/_2"
+    op: "Const"
+    attr {
+      key: "dtype"
+      value { type: DT_INT64 }
+    }
+    attr {
+      key: "value"
+      value {
+        tensor {
+          dtype: DT_INT64
+          tensor_shape {}
+          int64_val: 256
+        }
+      }
+    }
+  }
+  node {
+    name: "TextLineDataset/_3"
+    op: "TextLineDataset"
+    input: "Const/_0"
+    input: "Const/_1"
+    input: "Const/_2"
+  }
+  node {
+    name: "dataset"
+    op: "_Retval"
+    input: "TextLineDataset/_3"
+    attr {
+      key: "T"
+      value { type: DT_VARIANT }
+    }
+    attr {
+      key: "index"
+      value { i: 0 }
+    }
+  }
+  library {}
+  versions { producer: 96 }
+)proto";
+
+GraphDef ParseGraph(const std::string& text) {
+  GraphDef graph_def;
+  CHECK(protobuf::TextFormat::ParseFromString(text, &graph_def));
+  return graph_def;
+}
+
+TEST(InputPipelineBenchmarkTest, ApplyAutotuneConfig) {
+  AutotuneConfig config;
+  config.algorithm = data::model::AutotuneAlgorithm::HILL_CLIMB;
+  config.cpu_budget = 4;
+  GraphDef graph_def;
+  TF_ASSERT_OK(ApplyAutotuneConfig(ParseGraph(kRangeGraphProto), {DT_INT64},
+                                   {PartialTensorShape({})}, config,
+                                   &graph_def));
+
+  const NodeDef* options_node = nullptr;
+  for (const NodeDef& node : graph_def.node()) {
+    if (node.op() == "_Retval") {
+      ASSERT_EQ(node.input_size(), 1);
+      EXPECT_EQ(node.input(0), "input_pipeline_benchmark/options");
+    }
+    if (node.op() == "OptionsDataset") options_node = &node;
+  }
+  ASSERT_NE(options_node, nullptr);
+  EXPECT_EQ(options_node->input(0), "RangeDataset/_3");
+  data::Options options;
+  ASSERT_TRUE(options.ParseFromString(
+      options_node->attr().at("serialized_options").s()));
+  EXPECT_TRUE(options.autotune_options().enabled());
+  EXPECT_EQ(options.autotune_options().autotune_algorithm(),
+            data::model::AutotuneAlgorithm::HILL_CLIMB);
+  EXPECT_EQ(options.autotune_options().cpu_budget(), 4);
+}
+
+TEST(InputPipelineBenchmarkTest, ApplyAutotuneConfigRequiresRetval) {
+  GraphDef graph_def = ParseGraph(kRangeGraphProto);
+  graph_def.mutable_node()->RemoveLast();
+  GraphDef result;
+  EXPECT_TRUE(errors::IsNotFound(
+      ApplyAutotuneConfig(graph_def, {DT_INT64}, {PartialTensorShape({})},
+                          AutotuneConfig(), &result)));
+}
+
+TEST(InputPipelineBenchmarkTest, RunPipeline) {
+  for (bool enabled : {false, true}) {
+    PipelineConfig config;
+    config.autotune.enabled = enabled;
+    config.warmup_elements = 3;
+    config.max_elements = 0;
+    PipelineResult result;
+    TF_ASSERT_OK(RunPipeline(ParseGraph(kRangeGraphProto), config, &result));
+    EXPECT_EQ(result.elements, 7);
+    EXPECT_GE(result.wall_seconds, 0);
+    EXPECT_GE(result.cpu_seconds, 0);
+  }
+}
+
+TEST(InputPipelineBenchmarkTest, RunPipelineStopsAtMaxElements) {
+  PipelineConfig config;
+  config.warmup_elements = 0;
+  config.max_elements = 4;
+  PipelineResult result;
+  TF_ASSERT_OK(RunPipeline(ParseGraph(kRangeGraphProto), config, &result));
+  EXPECT_EQ(result.elements, 4);
+}
+
+TEST(InputPipelineBenchmarkTest, ReadsStagedFilesFromThrottledStorage) {
+  const std::string filename =
+      io::JoinPath(testing::TmpDir(), "input_pipeline_benchmark_test.txt");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, "a\nb\nc\nd\n"));
+  GraphDef graph_def =
+      ParseGraph(strings::Printf(kTextLineGraphProto, filename.c_str()));
+
+  std::vector<std::string> staged_files;
+  TF_ASSERT_OK(StageFiles(filename, &graph_def, &staged_files));
+  const std::string staged_file = absl::StrCat("throttled://", filename);
+  EXPECT_EQ(staged_files, std::vector<std::string>({staged_file}));
+  EXPECT_EQ(graph_def.node(0).attr().at("value").tensor().string_val(0),
+            staged_file);
+
+  PipelineConfig config;
+  config.storage.latency_us = 10000;
+  config.warmup_elements = 0;
+  PipelineResult result;
+  TF_ASSERT_OK(RunPipeline(graph_def, config, &result));
+  EXPECT_EQ(result.elements, 4);
+  // At least one read pays the storage latency.
+  EXPECT_GE(result.wall_seconds, 0.01);
+  EXPECT_GT(result.ElementsPerSecond(), 0);
+}
+
+}  // namespace
+}  // namespace input_pipeline_benchmark
+}  // namespace tensorflow
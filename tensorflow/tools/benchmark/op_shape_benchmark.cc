@@ -0,0 +1,419 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A C++ binary to benchmark every op shape recorded in a production step on
+// a range of intra-op thread counts.
+//
+// See README.md for usage instructions.
+
+#include "tensorflow/tools/benchmark/op_shape_benchmark.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/numbers.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace op_shape_benchmark {
+namespace {
+
+// Seed of the pseudo-random input values, fixed so that runs are comparable.
+constexpr uint64 kInputSeed = 0x5eed;
+
+template <typename T>
+void FillUniform(random::SimplePhilox* rng, Tensor* tensor) {
+  auto flat = tensor->flat<T>();
+  for (int64_t i = 0; i < flat.size(); ++i) {
+    flat(i) = static_cast<T>(rng->RandFloat() * 2.0f - 1.0f);
+  }
+}
+
+Status MakeInputTensor(const OpInfo::TensorProperties& input,
+                       random::SimplePhilox* rng, Tensor* tensor) {
+  if (input.has_value()) {
+    if (!tensor->FromProto(input.value())) {
+      return errors::InvalidArgument("Invalid input value: ",
+                                     input.value().ShortDebugString());
+    }
+    return OkStatus();
+  }
+  PartialTensorShape partial_shape;
+  TF_RETURN_IF_ERROR(PartialTensorShape::BuildPartialTensorShape(
+      input.shape(), &partial_shape));
+  TensorShape shape;
+  if (!partial_shape.AsTensorShape(&shape)) {
+    return errors::InvalidArgument("Input shape ", partial_shape.DebugString(),
+                                   " is not fully defined");
+  }
+  switch (input.dtype()) {
+    case DT_FLOAT:
+      *tensor = Tensor(DT_FLOAT, shape);
+      FillUniform<float>(rng, tensor);
+      return OkStatus();
+    case DT_DOUBLE:
+      *tensor = Tensor(DT_DOUBLE, shape);
+      FillUniform<double>(rng, tensor);
+      return OkStatus();
+    case DT_HALF:
+      *tensor = Tensor(DT_HALF, shape);
+      FillUniform<Eigen::half>(rng, tensor);
+      return OkStatus();
+    case DT_BFLOAT16:
+      *tensor = Tensor(DT_BFLOAT16, shape);
+      FillUniform<bfloat16>(rng, tensor);
+      return OkStatus();
+    default:
+      break;
+  }
+  // Integer inputs are often indices or sizes, for which zero is valid.
+  if (!DataTypeIsInteger(input.dtype()) && input.dtype() != DT_BOOL) {
+    return errors::Unimplemented("Cannot generate inputs of type ",
+                                 DataTypeString(input.dtype()));
+  }
+  *tensor = Tensor(input.dtype(), shape);
+  std::memset(tensor->data(), 0, tensor->TotalBytes());
+  return OkStatus();
+}
+
+}  // namespace
+
+Status OpShapesFromRunMetadata(const RunMetadata& run_metadata,
+                               std::vector<OpShape>* op_shapes) {
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  for (const GraphDef& graph : run_metadata.partition_graphs()) {
+    for (const NodeDef& node : graph.node()) {
+      name_to_node[node.name()] = &node;
+    }
+  }
+  if (name_to_node.empty()) {
+    return errors::InvalidArgument(
+        "RunMetadata has no partition graphs, run the step with "
+        "RunOptions::FULL_TRACE");
+  }
+
+  // Output properties by slot and number of executions of each node.
+  std::unordered_map<string, std::vector<OpInfo::TensorProperties>> outputs;
+  std::map<string, int64_t> occurrences;
+  for (const DeviceStepStats& dev_stats :
+       run_metadata.step_stats().dev_stats()) {
+    for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+      ++occurrences[node_stats.node_name()];
+      std::vector<OpInfo::TensorProperties>& node_outputs =
+          outputs[node_stats.node_name()];
+      for (const NodeOutput& output : node_stats.output()) {
+        if (output.slot() < 0) continue;
+        if (node_outputs.size() <= static_cast<size_t>(output.slot())) {
+          node_outputs.resize(output.slot() + 1);
+        }
+        OpInfo::TensorProperties& properties = node_outputs[output.slot()];
+        properties.set_dtype(output.tensor_description().dtype());
+        *properties.mutable_shape() = output.tensor_description().shape();
+      }
+    }
+  }
+
+  for (const auto& node_and_occurrences : occurrences) {
+    auto node_it = name_to_node.find(node_and_occurrences.first);
+    if (node_it == name_to_node.end()) continue;
+    const NodeDef& node = *node_it->second;
+    std::vector<OpInfo::TensorProperties> inputs;
+    bool all_inputs_recorded = true;
+    for (const string& input : node.input()) {
+      TensorId tensor_id = ParseTensorName(input);
+      if (tensor_id.index() < 0) continue;  // Control input.
+      auto outputs_it = outputs.find(string(tensor_id.node()));
+      if (outputs_it == outputs.end() ||
+          outputs_it->second.size() <= static_cast<size_t>(tensor_id.index()) ||
+          outputs_it->second[tensor_id.index()].dtype() == DT_INVALID) {
+        all_inputs_recorded = false;
+        break;
+      }
+      inputs.push_back(outputs_it->second[tensor_id.index()]);
+    }
+    // Source ops such as constants and variables are not worth benchmarking.
+    if (!all_inputs_recorded || inputs.empty()) continue;
+    OpShape op_shape;
+    op_shape.op_info =
+        grappler::BuildOpInfoWithoutDevice(node, name_to_node, inputs);
+    op_shape.occurrences = node_and_occurrences.second;
+    op_shapes->push_back(std::move(op_shape));
+  }
+  return OkStatus();
+}
+
+Status ReadOpShapes(const std::string& filename,
+                    std::vector<OpShape>* op_shapes) {
+  OpPerformanceList op_performance_list;
+  Status status =
+      ReadBinaryProto(Env::Default(), filename, &op_performance_list);
+  if (!status.ok()) {
+    TF_RETURN_IF_ERROR(
+        ReadTextProto(Env::Default(), filename, &op_performance_list));
+  }
+  for (const OpPerformance& op_performance :
+       op_performance_list.op_performance()) {
+    OpShape op_shape;
+    op_shape.op_info = op_performance.op();
+    op_shape.occurrences = 1;
+    op_shapes->push_back(std::move(op_shape));
+  }
+  return OkStatus();
+}
+
+std::vector<OpShape> MergeOpShapes(const std::vector<OpShape>& op_shapes) {
+  std::unordered_map<string, OpShape> merged;
+  for (const OpShape& op_shape : op_shapes) {
+    OpInfo op_info = op_shape.op_info;
+    op_info.clear_device();
+    string key;
+    SerializeToStringDeterministic(op_info, &key);
+    auto it = merged.find(key);
+    if (it == merged.end()) {
+      OpShape& merged_op_shape = merged[key];
+      merged_op_shape.op_info = std::move(op_info);
+      merged_op_shape.occurrences = op_shape.occurrences;
+    } else {
+      it->second.occurrences += op_shape.occurrences;
+    }
+  }
+  std::vector<std::pair<string, OpShape>> named;
+  named.reserve(merged.size());
+  for (auto& key_and_op_shape : merged) {
+    named.emplace_back(OpShapeName(key_and_op_shape.second.op_info),
+                       std::move(key_and_op_shape.second));
+  }
+  std::sort(named.begin(), named.end(),
+            [](const std::pair<string, OpShape>& a,
+               const std::pair<string, OpShape>& b) {
+              if (a.second.occurrences != b.second.occurrences) {
+                return a.second.occurrences > b.second.occurrences;
+              }
+              return a.first < b.first;
+            });
+  std::vector<OpShape> result;
+  result.reserve(named.size());
+  for (auto& name_and_op_shape : named) {
+    result.push_back(std::move(name_and_op_shape.second));
+  }
+  return result;
+}
+
+std::string OpShapeName(const OpInfo& op_info) {
+  string dtype = "none";
+  auto type_attr = op_info.attr().find("T");
+  if (type_attr != op_info.attr().end() &&
+      type_attr->second.value_case() == AttrValue::kType) {
+    dtype = DataTypeString(type_attr->second.type());
+  } else if (op_info.inputs_size() > 0) {
+    dtype = DataTypeString(op_info.inputs(0).dtype());
+  }
+  std::vector<string> inputs;
+  inputs.reserve(op_info.inputs_size());
+  for (const OpInfo::TensorProperties& input : op_info.inputs()) {
+    inputs.push_back(
+        absl::StrCat(DataTypeString(input.dtype()),
+                     PartialTensorShape::DebugString(input.shape())));
+  }
+  OpInfo attrs;
+  *attrs.mutable_attr() = op_info.attr();
+  string serialized_attrs;
+  SerializeToStringDeterministic(attrs, &serialized_attrs);
+  return absl::StrCat(
+      op_info.op(), "/", dtype, "/", absl::StrJoin(inputs, ";"), "/attrs:",
+      absl::Hex(Fingerprint64(serialized_attrs), absl::kZeroPad16));
+}
+
+Status BuildOpShapeGraph(const OpInfo& op_info, const std::string& device,
+                         Graph* graph) {
+  const OpDef* op_def = nullptr;
+  TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(op_info.op(), &op_def));
+  if (op_def->is_stateful()) {
+    return errors::Unimplemented(op_info.op(), " is stateful");
+  }
+
+  random::PhiloxRandom philox(kInputSeed);
+  random::SimplePhilox rng(&philox);
+  NodeDef node_def;
+  node_def.set_name("op");
+  node_def.set_op(op_info.op());
+  std::vector<Node*> inputs;
+  for (int i = 0; i < op_info.inputs_size(); ++i) {
+    Tensor tensor;
+    TF_RETURN_IF_ERROR(MakeInputTensor(op_info.inputs(i), &rng, &tensor));
+    inputs.push_back(
+        test::graph::Constant(graph, tensor, absl::StrCat("input_", i)));
+    node_def.add_input(inputs.back()->name());
+  }
+  // Only keep the attributes of the op, OpInfo may carry extra properties.
+  for (const OpDef::AttrDef& attr : op_def->attr()) {
+    auto it = op_info.attr().find(attr.name());
+    if (it != op_info.attr().end()) {
+      (*node_def.mutable_attr())[attr.name()] = it->second;
+    }
+  }
+  AddDefaultsToNodeDef(*op_def, &node_def);
+  TF_RETURN_IF_ERROR(ValidateNodeDef(node_def, *op_def));
+  TF_RETURN_IF_ERROR(FindKernelDef(DeviceType(absl::AsciiStrToUpper(device)),
+                                   node_def, nullptr, nullptr));
+
+  Status status;
+  Node* node = graph->AddNode(node_def, &status);
+  TF_RETURN_IF_ERROR(status);
+  if (node->num_inputs() != static_cast<int>(inputs.size())) {
+    return errors::InvalidArgument(op_info.op(), " expects ",
+                                   node->num_inputs(), " inputs, got ",
+                                   inputs.size());
+  }
+  for (int i = 0; i < node->num_inputs(); ++i) {
+    if (node->input_type(i) != inputs[i]->output_type(0)) {
+      return errors::InvalidArgument(
+          op_info.op(), " expects input ", i, " of type ",
+          DataTypeString(node->input_type(i)), ", got ",
+          DataTypeString(inputs[i]->output_type(0)));
+    }
+    graph->AddEdge(inputs[i], 0, node, i);
+  }
+  return OkStatus();
+}
+
+int RegisterOpShapeBenchmarks(const std::vector<OpShape>& op_shapes,
+                              const std::vector<int>& thread_counts,
+                              const std::string& device) {
+  int num_skipped = 0;
+  for (const OpShape& op_shape : op_shapes) {
+    const string name = OpShapeName(op_shape.op_info);
+    Graph graph(OpRegistry::Global());
+    Status status = BuildOpShapeGraph(op_shape.op_info, device, &graph);
+    if (!status.ok()) {
+      LOG(WARNING) << "Skipping " << name << ": " << status;
+      ++num_skipped;
+      continue;
+    }
+    for (int num_threads : thread_counts) {
+      ::benchmark::RegisterBenchmark(
+          absl::StrCat("BM_OpShape/", name, "/threads:", num_threads).c_str(),
+          [op_shape, device, num_threads](::benchmark::State& state) {
+            Graph* graph = new Graph(OpRegistry::Global());
+            TF_CHECK_OK(BuildOpShapeGraph(op_shape.op_info, device, graph));
+            SessionOptions options;
+            options.config.set_intra_op_parallelism_threads(num_threads);
+            test::Benchmark(device, graph, &options, /*init=*/nullptr,
+                            /*rendez=*/nullptr, /*executor_type=*/"",
+                            /*old_benchmark_api=*/false)
+                .Run(state);
+            state.counters["occurrences"] = op_shape.occurrences;
+          })
+          ->UseRealTime();
+    }
+  }
+  return num_skipped;
+}
+
+int Main(int argc, char** argv) {
+  string op_shapes_file = "";
+  string run_metadata_file = "";
+  string intra_op_threads = "1";
+  string device = "cpu";
+
+  std::vector<Flag> flag_list = {
+      Flag("op_shapes", &op_shapes_file,
+           "OpPerformanceList with the op shapes to benchmark"),
+      Flag("run_metadata", &run_metadata_file,
+           "RunMetadata of a step run with FULL_TRACE, to benchmark the op "
+           "shapes it ran"),
+      Flag("intra_op_threads", &intra_op_threads,
+           "comma-separated list of intra-op thread counts"),
+      Flag("device", &device, "device to benchmark on, cpu or gpu"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_result = Flags::Parse(&argc, argv, flag_list);
+  if (!parse_result || op_shapes_file.empty() == run_metadata_file.empty()) {
+    LOG(ERROR) << "Exactly one of --op_shapes and --run_metadata is required\n"
+               << usage;
+    return -1;
+  }
+  std::vector<int> thread_counts;
+  for (const string& count : str_util::Split(intra_op_threads, ',')) {
+    int num_threads;
+    if (!strings::safe_strto32(count, &num_threads) || num_threads <= 0) {
+      LOG(ERROR) << "Invalid --intra_op_threads=" << intra_op_threads;
+      return -1;
+    }
+    thread_counts.push_back(num_threads);
+  }
+
+  // Leaves the --benchmark_* flags, e.g. --benchmark_format=json, to the
+  // benchmark library.
+  testing::InitializeBenchmarks(&argc, argv);
+  port::InitMain(argv[0], &argc, &argv);
+  if (argc > 1) {
+    LOG(ERROR) << "Unknown argument " << argv[1] << "\n" << usage;
+    return -1;
+  }
+
+  std::vector<OpShape> op_shapes;
+  Status status;
+  if (!op_shapes_file.empty()) {
+    status = ReadOpShapes(op_shapes_file, &op_shapes);
+  } else {
+    RunMetadata run_metadata;
+    status = ReadBinaryProto(Env::Default(), run_metadata_file, &run_metadata);
+    if (status.ok()) status = OpShapesFromRunMetadata(run_metadata, &op_shapes);
+  }
+  if (!status.ok()) {
+    LOG(ERROR) << "Could not read op shapes: " << status;
+    return -1;
+  }
+  op_shapes = MergeOpShapes(op_shapes);
+  const int num_skipped =
+      RegisterOpShapeBenchmarks(op_shapes, thread_counts, device);
+  LOG(INFO) << "Benchmarking " << op_shapes.size() - num_skipped << " of "
+            << op_shapes.size() << " op shapes on " << thread_counts.size()
+            << " thread counts";
+  testing::RunBenchmarks();
+  return 0;
+}
+
+}  // namespace op_shape_benchmark
+}  // namespace tensorflow
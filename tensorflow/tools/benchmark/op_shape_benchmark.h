@@ -0,0 +1,78 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TOOLS_BENCHMARK_OP_SHAPE_BENCHMARK_H_
+#define TENSORFLOW_TOOLS_BENCHMARK_OP_SHAPE_BENCHMARK_H_
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace op_shape_benchmark {
+
+// An op with fixed attributes and input shapes, and how often it ran.
+struct OpShape {
+  OpInfo op_info;
+  int64_t occurrences = 0;
+};
+
+// Extracts the ops that ran in a traced step from the partition graphs and the
+// StepStats of run_metadata. Input shapes are the output shapes recorded for
+// the nodes feeding each op, so the step must have been run with
+// RunOptions::FULL_TRACE. Ops whose inputs were not all recorded are skipped.
+Status OpShapesFromRunMetadata(const RunMetadata& run_metadata,
+                               std::vector<OpShape>* op_shapes);
+
+// Reads the op shapes of an OpPerformanceList, e.g. as produced by
+// grappler::CostGraphToOpPerformanceData, in binary or text format.
+Status ReadOpShapes(const std::string& filename,
+                    std::vector<OpShape>* op_shapes);
+
+// Merges identical op shapes, summing their occurrences. The result is sorted
+// by decreasing occurrences, then by name.
+std::vector<OpShape> MergeOpShapes(const std::vector<OpShape>& op_shapes);
+
+// Returns a name identifying the op, dtype and input shapes of op_info that is
+// stable across runs and builds, e.g.
+// "MatMul/float/float[64,32];float[32,8]/attrs:0123456789abcdef", where the
+// last part is a fingerprint of the attributes.
+std::string OpShapeName(const OpInfo& op_info);
+
+// Builds a graph running op_info once on inputs filled with reproducible
+// pseudo-random values, or constant values if op_info recorded them. Fails if
+// the op cannot be benchmarked in isolation, e.g. if it is stateful, takes
+// resources, or has inputs of unknown shape.
+Status BuildOpShapeGraph(const OpInfo& op_info, const std::string& device,
+                         Graph* graph);
+
+// Registers a benchmark named "BM_OpShape/<OpShapeName>/threads:<n>" for each
+// op shape that can be benchmarked on device and each intra-op thread count.
+// Returns the number of op shapes skipped.
+int RegisterOpShapeBenchmarks(const std::vector<OpShape>& op_shapes,
+                              const std::vector<int>& thread_counts,
+                              const std::string& device);
+
+// Handles all setup and argument parsing.
+int Main(int argc, char** argv);
+
+}  // namespace op_shape_benchmark
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_TOOLS_BENCHMARK_OP_SHAPE_BENCHMARK_H_
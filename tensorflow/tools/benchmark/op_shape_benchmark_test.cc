@@ -0,0 +1,163 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tools/benchmark/op_shape_benchmark.h"
+
+#include "absl/strings/match.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace op_shape_benchmark {
+namespace {
+
+OpInfo::TensorProperties TensorProperties(DataType dtype,
+                                          const TensorShape& shape) {
+  OpInfo::TensorProperties properties;
+  properties.set_dtype(dtype);
+  shape.AsProto(properties.mutable_shape());
+  return properties;
+}
+
+OpShape MatMulShape(int64_t m, int64_t k, int64_t n) {
+  OpShape op_shape;
+  op_shape.op_info.set_op("MatMul");
+  (*op_shape.op_info.mutable_attr())["T"].set_type(DT_FLOAT);
+  *op_shape.op_info.add_inputs() = TensorProperties(DT_FLOAT, {m, k});
+  *op_shape.op_info.add_inputs() = TensorProperties(DT_FLOAT, {k, n});
+  op_shape.occurrences = 1;
+  return op_shape;
+}
+
+void AddNodeStats(const string& node_name, const TensorShape& output_shape,
+                  DeviceStepStats* dev_stats) {
+  NodeExecStats* node_stats = dev_stats->add_node_stats();
+  node_stats->set_node_name(node_name);
+  NodeOutput* output = node_stats->add_output();
+  output->set_slot(0);
+  output->mutable_tensor_description()->set_dtype(DT_FLOAT);
+  output_shape.AsProto(
+      output->mutable_tensor_description()->mutable_shape());
+}
+
+TEST(OpShapeBenchmarkTest, OpShapesFromRunMetadata) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto a = ops::Placeholder(root.WithOpName("a"), DT_FLOAT);
+  auto b = ops::Placeholder(root.WithOpName("b"), DT_FLOAT);
+  ops::MatMul(root.WithOpName("matmul"), a, b);
+  RunMetadata run_metadata;
+  TF_ASSERT_OK(root.ToGraphDef(run_metadata.add_partition_graphs()));
+  DeviceStepStats* dev_stats =
+      run_metadata.mutable_step_stats()->add_dev_stats();
+  AddNodeStats("a", {64, 32}, dev_stats);
+  AddNodeStats("b", {32, 8}, dev_stats);
+  AddNodeStats("matmul", {64, 8}, dev_stats);
+  AddNodeStats("matmul", {64, 8}, dev_stats);
+
+  std::vector<OpShape> op_shapes;
+  TF_ASSERT_OK(OpShapesFromRunMetadata(run_metadata, &op_shapes));
+  // The placeholders have no inputs and are not benchmarked.
+  ASSERT_EQ(op_shapes.size(), 1);
+  EXPECT_EQ(op_shapes[0].occurrences, 2);
+  EXPECT_EQ(op_shapes[0].op_info.op(), "MatMul");
+  ASSERT_EQ(op_shapes[0].op_info.inputs_size(), 2);
+  EXPECT_EQ(TensorShape(op_shapes[0].op_info.inputs(0).shape()),
+            TensorShape({64, 32}));
+  EXPECT_EQ(TensorShape(op_shapes[0].op_info.inputs(1).shape()),
+            TensorShape({32, 8}));
+}
+
+TEST(OpShapeBenchmarkTest, ReadOpShapes) {
+  OpPerformanceList op_performance_list;
+  *op_performance_list.add_op_performance()->mutable_op() =
+      MatMulShape(64, 32, 8).op_info;
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "op_performance_list.pb");
+  TF_ASSERT_OK(
+      WriteBinaryProto(Env::Default(), filename, op_performance_list));
+
+  std::vector<OpShape> op_shapes;
+  TF_ASSERT_OK(ReadOpShapes(filename, &op_shapes));
+  ASSERT_EQ(op_shapes.size(), 1);
+  EXPECT_EQ(op_shapes[0].op_info.op(), "MatMul");
+}
+
+TEST(OpShapeBenchmarkTest, MergeOpShapes) {
+  OpShape with_device = MatMulShape(64, 32, 8);
+  with_device.op_info.mutable_device()->set_type("CPU");
+  std::vector<OpShape> merged = MergeOpShapes(
+      {MatMulShape(2, 2, 2), MatMulShape(64, 32, 8), with_device});
+  ASSERT_EQ(merged.size(), 2);
+  EXPECT_EQ(merged[0].occurrences, 2);
+  EXPECT_EQ(TensorShape(merged[0].op_info.inputs(0).shape()),
+            TensorShape({64, 32}));
+  EXPECT_EQ(merged[1].occurrences, 1);
+}
+
+TEST(OpShapeBenchmarkTest, OpShapeName) {
+  const OpShape op_shape = MatMulShape(64, 32, 8);
+  const string name = OpShapeName(op_shape.op_info);
+  EXPECT_TRUE(absl::StartsWith(name, "MatMul/float/float[64,32];float[32,8]/"))
+      << name;
+  EXPECT_EQ(name, OpShapeName(op_shape.op_info));
+
+  OpShape transposed = MatMulShape(64, 32, 8);
+  (*transposed.op_info.mutable_attr())["transpose_a"].set_b(true);
+  EXPECT_NE(name, OpShapeName(transposed.op_info));
+}
+
+TEST(OpShapeBenchmarkTest, BuildOpShapeGraph) {
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(
+      BuildOpShapeGraph(MatMulShape(64, 32, 8).op_info, "cpu", &graph));
+  // Two constant inputs and the MatMul.
+  EXPECT_EQ(graph.num_op_nodes(), 3);
+}
+
+TEST(OpShapeBenchmarkTest, BuildOpShapeGraphFailsOnUnknownShapes) {
+  OpShape op_shape = MatMulShape(64, 32, 8);
+  op_shape.op_info.mutable_inputs(0)->mutable_shape()->mutable_dim(0)->set_size(
+      -1);
+  Graph graph(OpRegistry::Global());
+  EXPECT_FALSE(BuildOpShapeGraph(op_shape.op_info, "cpu", &graph).ok());
+}
+
+TEST(OpShapeBenchmarkTest, BuildOpShapeGraphFailsOnStatefulOps) {
+  OpInfo op_info;
+  op_info.set_op("RandomUniform");
+  (*op_info.mutable_attr())["dtype"].set_type(DT_FLOAT);
+  (*op_info.mutable_attr())["T"].set_type(DT_INT32);
+  *op_info.add_inputs() = TensorProperties(DT_INT32, {2});
+  Graph graph(OpRegistry::Global());
+  EXPECT_FALSE(BuildOpShapeGraph(op_info, "cpu", &graph).ok());
+}
+
+TEST(OpShapeBenchmarkTest, RegisterOpShapeBenchmarks) {
+  OpShape unknown_op;
+  unknown_op.op_info.set_op("NoSuchOp");
+  EXPECT_EQ(RegisterOpShapeBenchmarks({MatMulShape(4, 4, 4), unknown_op},
+                                      {1, 2}, "cpu"),
+            1);
+}
+
+}  // namespace
+}  // namespace op_shape_benchmark
+}  // namespace tensorflow
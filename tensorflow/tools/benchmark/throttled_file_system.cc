@@ -0,0 +1,239 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tools/benchmark/throttled_file_system.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kThrottledPrefix[] = "throttled://";
+constexpr char kRamPrefix[] = "ram://";
+
+std::string ReplacePrefix(const std::string& name, StringPiece from,
+                          StringPiece to) {
+  if (!absl::StartsWith(name, from)) return name;
+  return absl::StrCat(to, StringPiece(name).substr(from.size()));
+}
+
+std::string ToRam(const std::string& name) {
+  return ReplacePrefix(name, kThrottledPrefix, kRamPrefix);
+}
+
+// Delays every read of the wrapped file by the storage model of `fs`.
+class ThrottledRandomAccessFile : public RandomAccessFile {
+ public:
+  ThrottledRandomAccessFile(std::unique_ptr<RandomAccessFile> file,
+                            ThrottledRamFileSystem* fs)
+      : file_(std::move(file)), fs_(fs) {}
+
+  Status Name(StringPiece* result) const override {
+    return file_->Name(result);
+  }
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    *result = StringPiece();
+    Status s = file_->Read(offset, n, result, scratch);
+    fs_->Throttle(result->size());
+    return s;
+  }
+
+ private:
+  std::unique_ptr<RandomAccessFile> file_;
+  ThrottledRamFileSystem* const fs_;
+};
+
+}  // namespace
+
+constexpr char ThrottledRamFileSystem::kScheme[];
+
+ThrottledRamFileSystem::ThrottledRamFileSystem() {}
+
+Status ThrottledRamFileSystem::Get(ThrottledRamFileSystem** result) {
+  static const Status* registered = new Status(
+      Env::Default()->RegisterFileSystem(kScheme, []() -> FileSystem* {
+        return new ThrottledRamFileSystem;
+      }));
+  TF_RETURN_IF_ERROR(*registered);
+  FileSystem* fs;
+  TF_RETURN_IF_ERROR(
+      Env::Default()->GetFileSystemForFile(kThrottledPrefix, &fs));
+  *result = static_cast<ThrottledRamFileSystem*>(fs);
+  return OkStatus();
+}
+
+void ThrottledRamFileSystem::SetStorageModel(
+    const StorageModel& storage_model) {
+  mutex_lock l(mu_);
+  storage_model_ = storage_model;
+  busy_until_us_ = 0;
+}
+
+StorageModel ThrottledRamFileSystem::storage_model() const {
+  mutex_lock l(mu_);
+  return storage_model_;
+}
+
+void ThrottledRamFileSystem::Throttle(size_t num_bytes) {
+  Env* env = Env::Default();
+  uint64 done_us;
+  {
+    mutex_lock l(mu_);
+    // Transfers are serialized on the shared bandwidth, while the latency of
+    // concurrent reads overlaps.
+    const uint64 start_us = std::max(env->NowMicros(), busy_until_us_);
+    uint64 transfer_us = 0;
+    if (storage_model_.bandwidth_bytes_per_sec > 0) {
+      transfer_us = static_cast<uint64>(num_bytes) * 1000000 /
+                    storage_model_.bandwidth_bytes_per_sec;
+    }
+    busy_until_us_ = start_us + transfer_us;
+    done_us = busy_until_us_ + std::max<int64_t>(storage_model_.latency_us, 0);
+  }
+  const uint64 now_us = env->NowMicros();
+  if (done_us > now_us) {
+    env->SleepForMicroseconds(done_us - now_us);
+  }
+}
+
+Status ThrottledRamFileSystem::GetRamFileSystem(FileSystem** ram_fs) {
+  return Env::Default()->GetFileSystemForFile(kRamPrefix, ram_fs);
+}
+
+Status ThrottledRamFileSystem::NewRandomAccessFile(
+    const std::string& fname, TransactionToken* token,
+    std::unique_ptr<RandomAccessFile>* result) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(ram_fs->NewRandomAccessFile(ToRam(fname), token, &file));
+  *result = std::make_unique<ThrottledRandomAccessFile>(std::move(file), this);
+  return OkStatus();
+}
+
+Status ThrottledRamFileSystem::NewWritableFile(
+    const std::string& fname, TransactionToken* token,
+    std::unique_ptr<WritableFile>* result) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->NewWritableFile(ToRam(fname), token, result);
+}
+
+Status ThrottledRamFileSystem::NewAppendableFile(
+    const std::string& fname, TransactionToken* token,
+    std::unique_ptr<WritableFile>* result) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->NewAppendableFile(ToRam(fname), token, result);
+}
+
+Status ThrottledRamFileSystem::NewReadOnlyMemoryRegionFromFile(
+    const std::string& fname, TransactionToken* token,
+    std::unique_ptr<ReadOnlyMemoryRegion>* result) {
+  // A memory mapped region would be read without going through `Throttle`.
+  return errors::Unimplemented(
+      "ThrottledRamFileSystem does not support memory mapped files: ", fname);
+}
+
+Status ThrottledRamFileSystem::FileExists(const std::string& fname,
+                                          TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->FileExists(ToRam(fname), token);
+}
+
+Status ThrottledRamFileSystem::GetChildren(const std::string& dir,
+                                           TransactionToken* token,
+                                           std::vector<std::string>* result) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->GetChildren(ToRam(dir), token, result);
+}
+
+Status ThrottledRamFileSystem::GetMatchingPaths(
+    const std::string& pattern, TransactionToken* token,
+    std::vector<std::string>* results) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  std::vector<std::string> ram_results;
+  TF_RETURN_IF_ERROR(
+      ram_fs->GetMatchingPaths(ToRam(pattern), token, &ram_results));
+  for (const std::string& ram_result : ram_results) {
+    results->push_back(ReplacePrefix(ram_result, kRamPrefix, kThrottledPrefix));
+  }
+  return OkStatus();
+}
+
+Status ThrottledRamFileSystem::Stat(const std::string& fname,
+                                    TransactionToken* token,
+                                    FileStatistics* stat) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->Stat(ToRam(fname), token, stat);
+}
+
+Status ThrottledRamFileSystem::DeleteFile(const std::string& fname,
+                                          TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->DeleteFile(ToRam(fname), token);
+}
+
+Status ThrottledRamFileSystem::CreateDir(const std::string& dirname,
+                                         TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->CreateDir(ToRam(dirname), token);
+}
+
+Status ThrottledRamFileSystem::RecursivelyCreateDir(const std::string& dirname,
+                                                    TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->RecursivelyCreateDir(ToRam(dirname), token);
+}
+
+Status ThrottledRamFileSystem::DeleteDir(const std::string& dirname,
+                                         TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->DeleteDir(ToRam(dirname), token);
+}
+
+Status ThrottledRamFileSystem::GetFileSize(const std::string& fname,
+                                           TransactionToken* token,
+                                           uint64* file_size) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->GetFileSize(ToRam(fname), token, file_size);
+}
+
+Status ThrottledRamFileSystem::RenameFile(const std::string& src,
+                                          const std::string& target,
+                                          TransactionToken* token) {
+  FileSystem* ram_fs;
+  TF_RETURN_IF_ERROR(GetRamFileSystem(&ram_fs));
+  return ram_fs->RenameFile(ToRam(src), ToRam(target), token);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,116 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TOOLS_BENCHMARK_THROTTLED_FILE_SYSTEM_H_
+#define TENSORFLOW_TOOLS_BENCHMARK_THROTTLED_FILE_SYSTEM_H_
+
+// A synthetic storage device for benchmarking input pipelines.
+//
+// Files live in the process-wide "ram://" file system and are read back
+// through "throttled://" at the latency and bandwidth of a `StorageModel`, so
+// that the same pipeline can be measured against fast local disks and slow
+// remote storage without either being present.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Performance characteristics of a synthetic storage device.
+struct StorageModel {
+  // Time from issuing a read to its first byte, in microseconds. Reads issued
+  // concurrently pay their latency concurrently.
+  int64_t latency_us = 0;
+  // Bandwidth shared by all reads, in bytes per second. 0 means unlimited.
+  int64_t bandwidth_bytes_per_sec = 0;
+};
+
+// File system serving "throttled://<path>" from "ram://<path>". Reads through
+// files opened with `NewRandomAccessFile` are delayed according to the current
+// `StorageModel`; writes and metadata operations are not.
+class ThrottledRamFileSystem : public FileSystem {
+ public:
+  TF_USE_FILESYSTEM_METHODS_WITH_NO_TRANSACTION_SUPPORT;
+
+  static constexpr char kScheme[] = "throttled";
+
+  ThrottledRamFileSystem();
+  ~ThrottledRamFileSystem() override = default;
+
+  // Returns the instance serving `kScheme` in `Env::Default()`, registering it
+  // on first use.
+  static Status Get(ThrottledRamFileSystem** result);
+
+  void SetStorageModel(const StorageModel& storage_model)
+      TF_LOCKS_EXCLUDED(mu_);
+  StorageModel storage_model() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Blocks the caller for as long as the storage device takes to read
+  // `num_bytes` bytes, given the reads already in flight.
+  void Throttle(size_t num_bytes) TF_LOCKS_EXCLUDED(mu_);
+
+  Status NewRandomAccessFile(
+      const std::string& fname, TransactionToken* token,
+      std::unique_ptr<RandomAccessFile>* result) override;
+  Status NewWritableFile(const std::string& fname, TransactionToken* token,
+                         std::unique_ptr<WritableFile>* result) override;
+  Status NewAppendableFile(const std::string& fname, TransactionToken* token,
+                           std::unique_ptr<WritableFile>* result) override;
+  Status NewReadOnlyMemoryRegionFromFile(
+      const std::string& fname, TransactionToken* token,
+      std::unique_ptr<ReadOnlyMemoryRegion>* result) override;
+  Status FileExists(const std::string& fname,
+                    TransactionToken* token) override;
+  Status GetChildren(const std::string& dir, TransactionToken* token,
+                     std::vector<std::string>* result) override;
+  Status GetMatchingPaths(const std::string& pattern, TransactionToken* token,
+                          std::vector<std::string>* results) override;
+  Status Stat(const std::string& fname, TransactionToken* token,
+              FileStatistics* stat) override;
+  Status DeleteFile(const std::string& fname,
+                    TransactionToken* token) override;
+  Status CreateDir(const std::string& dirname,
+                   TransactionToken* token) override;
+  Status RecursivelyCreateDir(const std::string& dirname,
+                              TransactionToken* token) override;
+  Status DeleteDir(const std::string& dirname,
+                   TransactionToken* token) override;
+  Status GetFileSize(const std::string& fname, TransactionToken* token,
+                     uint64* file_size) override;
+  Status RenameFile(const std::string& src, const std::string& target,
+                    TransactionToken* token) override;
+
+ private:
+  // Returns the file system serving "ram://".
+  Status GetRamFileSystem(FileSystem** ram_fs);
+
+  mutable mutex mu_;
+  StorageModel storage_model_ TF_GUARDED_BY(mu_);
+  // Time at which the device finishes transferring the reads issued so far.
+  uint64 busy_until_us_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ThrottledRamFileSystem);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_TOOLS_BENCHMARK_THROTTLED_FILE_SYSTEM_H_
@@ -0,0 +1,116 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tools/benchmark/throttled_file_system.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class ThrottledRamFileSystemTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TF_ASSERT_OK(ThrottledRamFileSystem::Get(&fs_));
+    fs_->SetStorageModel(StorageModel());
+  }
+
+  // Returns how long reading all of `fname` in `chunk_size` reads takes.
+  uint64 TimeRead(const std::string& fname, size_t chunk_size) {
+    std::unique_ptr<RandomAccessFile> file;
+    TF_CHECK_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+    std::string scratch(chunk_size, '\0');
+    const uint64 start_us = Env::Default()->NowMicros();
+    uint64 offset = 0;
+    Status s;
+    while (s.ok()) {
+      StringPiece result;
+      s = file->Read(offset, chunk_size, &result, &scratch[0]);
+      offset += result.size();
+    }
+    return Env::Default()->NowMicros() - start_us;
+  }
+
+  ThrottledRamFileSystem* fs_ = nullptr;
+};
+
+TEST_F(ThrottledRamFileSystemTest, ServesRamFiles) {
+  TF_ASSERT_OK(
+      WriteStringToFile(Env::Default(), "ram://throttled_test/a", "hello"));
+
+  std::string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), "throttled://throttled_test/a",
+                                &contents));
+  EXPECT_EQ(contents, "hello");
+  TF_EXPECT_OK(Env::Default()->FileExists("throttled://throttled_test/a"));
+
+  std::vector<std::string> matches;
+  TF_ASSERT_OK(Env::Default()->GetMatchingPaths("throttled://throttled_test/*",
+                                                &matches));
+  EXPECT_EQ(matches,
+            std::vector<std::string>({"throttled://throttled_test/a"}));
+}
+
+TEST_F(ThrottledRamFileSystemTest, WritesLandInRam) {
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(),
+                                 "throttled://throttled_test/b", "world"));
+
+  std::string contents;
+  TF_ASSERT_OK(
+      ReadFileToString(Env::Default(), "ram://throttled_test/b", &contents));
+  EXPECT_EQ(contents, "world");
+}
+
+TEST_F(ThrottledRamFileSystemTest, AddsLatencyPerRead) {
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), "ram://throttled_test/c",
+                                 std::string(1000, 'x')));
+  StorageModel storage_model;
+  storage_model.latency_us = 10000;
+  fs_->SetStorageModel(storage_model);
+
+  // Four reads of 250 bytes, plus the read reporting the end of the file.
+  EXPECT_GE(TimeRead("throttled://throttled_test/c", 250), 5 * 10000);
+}
+
+TEST_F(ThrottledRamFileSystemTest, LimitsBandwidth) {
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), "ram://throttled_test/d",
+                                 std::string(100000, 'x')));
+  StorageModel storage_model;
+  storage_model.bandwidth_bytes_per_sec = 1000000;
+  fs_->SetStorageModel(storage_model);
+  EXPECT_EQ(fs_->storage_model().bandwidth_bytes_per_sec, 1000000);
+
+  // 100kB at 1MB/s takes 100ms, regardless of the read size.
+  EXPECT_GE(TimeRead("throttled://throttled_test/d", 10000), 100000);
+}
+
+TEST_F(ThrottledRamFileSystemTest, DoesNotThrottleRam) {
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), "ram://throttled_test/e",
+                                 std::string(1000, 'x')));
+  StorageModel storage_model;
+  storage_model.latency_us = 1000000;
+  fs_->SetStorageModel(storage_model);
+
+  EXPECT_LT(TimeRead("ram://throttled_test/e", 1000), 1000000);
+}
+
+}  // namespace
+}  // namespace tensorflow